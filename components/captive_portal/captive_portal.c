@@ -1,6 +1,11 @@
 
 #include "captive_portal.h"
 
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -9,6 +14,10 @@
 #include <lwip/netdb.h>
 #include <lwip/sockets.h>
 
+#include "esp_rom_crc.h"
+
+#include "cc_hal_network.h"
+
 // #define _PRINTF  os_printf
 #define _PRINTF(...)
 #define LOG(TAG, format, ...) _PRINTF("\033[0;32m");_PRINTF(format, ##__VA_ARGS__);_PRINTF("\n\033[0m")
@@ -21,24 +30,101 @@ enum{
     COMMON
 };
 
+/*
+ * 应答全部在编译期拼好，处理请求时只做查表和拷贝。
+ * 探测域名/Host 命中厂商关键字时回对应厂商的 204，让手机认为网络可用、保持连接该热点。
+ */
+#define HUAWEI_204  "HTTP/1.1 204 No Content\r\nDate: Fri, 20 Oct 2023 10:40:31 GMT\r\nConnection: keep-alive\r\nX-Hwcloud-ReqId: 1c1b92582ed841cbb98db15c7b9f592c\r\nServer: elb\r\n\r\n"
+#define COMMON_204  "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n"
+
+#define RESP(s)     .resp = s, .resp_len = sizeof(s) - 1
+
 typedef struct
 {
-    char *str;
-    char *resp;
+    const char *str;
+    const char *resp;
+    uint16_t resp_len;
 }resp_ctx_t;
 
-resp_ctx_t g_resp_ctx[] = {
-    [HUAWEI] = {.str = "huawei", .resp = "HTTP/1.1 204 No Content\r\nDate: Fri, 20 Oct 2023 10:40:31 GMT\r\nConnection: keep-alive\r\nX-Hwcloud-ReqId: 1c1b92582ed841cbb98db15c7b9f592c\r\nServer: elb\r\n\r\n"},
-    [HUAWEI_1] = {.str = "hicloud", .resp = "HTTP/1.1 204 No Content\r\nDate: Fri, 20 Oct 2023 10:40:31 GMT\r\nConnection: keep-alive\r\nX-Hwcloud-ReqId: 1c1b92582ed841cbb98db15c7b9f592c\r\nServer: elb\r\n\r\n"},
-    [COMMON] = {.str = NULL, .resp = "HTTP/1.1 204 No Content\r\nConnection: close\r\n\r\n"}
+static const resp_ctx_t g_resp_ctx[] = {
+    [HUAWEI] = {.str = "huawei", RESP(HUAWEI_204)},
+    [HUAWEI_1] = {.str = "hicloud", RESP(HUAWEI_204)},
+    [COMMON] = {.str = NULL, RESP(COMMON_204)}
 };
 
 static uint8_t g_curr_type = COMMON;
 
-static const char *HTTP_400 = "HTTP/1.0 400 BadRequest\r\n"
-                              "Content-Length: 0\r\n"
-                              "Connection: Close\r\n"
-                              "Server: lwIP/1.4.0\r\n\n";
+static const char HTTP_400[] = "HTTP/1.0 400 BadRequest\r\n"
+                               "Content-Length: 0\r\n"
+                               "Connection: Close\r\n"
+                               "Server: lwIP/1.4.0\r\n\n";
+
+static const char HTTP_503[] = "HTTP/1.1 503 Service Unavailable\r\n"
+                               "Content-Length: 0\r\n\r\n";
+
+/*
+ * 配网页面：只有 Host 是 AP 地址的请求才返回页面和 /api，联网探测仍回 204，手机不会因此弹出认证页。
+ * 页面在构建时 gzip 压缩好（见 CMakeLists.txt），数据留在 flash 中，发送时 lwIP 从映射地址拷贝到发送缓冲，
+ * RAM 中不保留副本。ETag 取压缩数据的 CRC，固件更新后随之变化；页面本身每次向设备确认（未变时回 304），
+ * js/css 在一次配网过程中直接用浏览器缓存。手机浏览器都接受 gzip，不再看 Accept-Encoding。
+ */
+#define AP_HOST             "192.168.6.1"
+#define API_BODY_MAX        384
+#define API_RESP_MAX        768
+#define HTTP_HDR_MAX        256
+
+extern const uint8_t index_html_gz_start[] asm("_binary_index_html_gz_start");
+extern const uint8_t index_html_gz_end[] asm("_binary_index_html_gz_end");
+extern const uint8_t app_js_gz_start[] asm("_binary_app_js_gz_start");
+extern const uint8_t app_js_gz_end[] asm("_binary_app_js_gz_end");
+extern const uint8_t style_css_gz_start[] asm("_binary_style_css_gz_start");
+extern const uint8_t style_css_gz_end[] asm("_binary_style_css_gz_end");
+
+#define PAGE_REVALIDATE     "no-cache"
+#define PAGE_CACHED         "public, max-age=3600"
+
+typedef struct
+{
+    const char *path;
+    const char *type;
+    const char *cache;
+    const uint8_t *start;
+    const uint8_t *end;
+}asset_t;
+
+static const asset_t g_assets[] = {
+    {"/", "text/html; charset=utf-8", PAGE_REVALIDATE, index_html_gz_start, index_html_gz_end},
+    {"/index.html", "text/html; charset=utf-8", PAGE_REVALIDATE, index_html_gz_start, index_html_gz_end},
+    {"/app.js", "application/javascript", PAGE_CACHED, app_js_gz_start, app_js_gz_end},
+    {"/style.css", "text/css", PAGE_CACHED, style_css_gz_start, style_css_gz_end},
+};
+
+// 首次发送时计算，0 表示还没算
+static uint32_t g_asset_etag[sizeof(g_assets)/sizeof(g_assets[0])];
+
+static captive_portal_api_cb_t g_api_cb = NULL;
+
+/*
+ * DNS 应答：原样回送问题段，头部改为应答，再追加一条指向本机 AP 地址的 A 记录
+ */
+#define DNS_HDR_LEN         12
+#define DNS_NAME_MAX        255
+#define DNS_QTYPE_A         1
+#define DNS_QTYPE_ANY       255
+#define DNS_QCLASS_IN       1
+
+static const uint8_t DNS_ANSWER[] = {
+    0xc0, 0x0c,                 // 名称压缩指针，指向问题段的域名
+    0x00, DNS_QTYPE_A,
+    0x00, DNS_QCLASS_IN,
+    0x00, 0x00, 0x00, 0x0A,     // TTL 10s
+    0x00, 0x04,
+    192, 168, 6, 1,             // AP 地址
+};
+
+// 只应答系统联网探测所用的域名，其余查询不回
+static const char *DNS_PROBE_KEYS[] = {"conn", "wifi"};
+#define DNS_PROBE_MIUI      "v.qq."
 
 static const char *TAG = "CAPTIVE_PORTAL";
 
@@ -111,222 +197,496 @@ err:
     return -1;
 }
 
-void captive_portal_tast(void *arg){
+/*
+ * DNS（53/udp）与 HTTP（80/tcp）socket 都登记到 cc 网络事件循环，与配网 TCP 服务端共用一个任务，
+ * 不再单独起任务轮询。
+ */
+#define CLI_SOCK_MAX    8
+
+static int g_dns_sock = -1;
+static int g_web_sock = -1;
+static int g_cli_sock[CLI_SOCK_MAX] = {-1, -1, -1, -1, -1, -1, -1, -1};
+
+// 正在发送的页面：剩余部分仍指向 flash
+typedef struct
+{
+    const uint8_t *data;
+    uint32_t left;
+}cli_tx_t;
 
-    int cli_sock[8] = {-1, -1, -1, -1, -1, -1, -1, -1};
+static cli_tx_t g_cli_tx[CLI_SOCK_MAX];
 
-    int dns_sock = create_udp_socket(53);
-    int web_sock = create_tcp_socket(80);
+// POST 体分几个包到达时在这里拼齐，同一时间只给一个客户端用
+static char g_api_buf[API_BODY_MAX + 1];
+static int8_t g_api_owner = -1;
+static uint16_t g_api_len = 0;
+static uint16_t g_api_need = 0;
 
-    if(dns_sock == -1 || web_sock == -1){
-        goto err;
+// 解析出第一个问题的域名（小写、点分）及其后 QTYPE/QCLASS 的偏移，格式不对返回 -1
+static int dns_parse_question(const uint8_t *pkt, int len, char *name)
+{
+    int off = DNS_HDR_LEN;
+    int name_len = 0;
+
+    while (off < len && pkt[off] != 0)
+    {
+        uint8_t label = pkt[off++];
+        // 查询中不会出现压缩指针
+        if ((label & 0xc0) || off + label > len || name_len + label + 1 > DNS_NAME_MAX)
+        {
+            return -1;
+        }
+        for (uint8_t i = 0; i < label; i++)
+        {
+            char c = pkt[off + i];
+            name[name_len++] = (c >= 'A' && c <= 'Z') ? c - 'A' + 'a' : c;
+        }
+        name[name_len++] = '.';
+        off += label;
     }
+    name[name_len] = 0;
 
-    if (listen(web_sock, sizeof(cli_sock)) != 0) {
-        ESP_LOGE(TAG, "tsps listen error");
-        close(web_sock);
-        close(dns_sock);
-        goto err;
+    // 结束符 + QTYPE + QCLASS
+    if (off + 1 + 4 > len)
+    {
+        return -1;
+    }
+    return off + 1;
+}
+
+static void dns_recv_cb(int fd, uint8_t events, void *arg)
+{
+    struct sockaddr_in client;
+    socklen_t client_len = sizeof(client);
+
+    uint8_t data[512];
+    char name[DNS_NAME_MAX + 1];
+    int len = recvfrom(fd, data, sizeof(data) - sizeof(DNS_ANSWER), 0, (struct sockaddr *)&client, &client_len);
+
+    // 只处理标准查询（QR=0, OPCODE=0）且只有一个问题
+    if (len < DNS_HDR_LEN || (data[2] & 0xf8) != 0 || data[4] != 0 || data[5] != 1)
+    {
+        return;
     }
 
-    struct timeval timeout;
-    timeout.tv_sec = 500 / 1000;
-    timeout.tv_usec = (500 % 1000) * 1000;
+    int qend = dns_parse_question(data, len, name);
+    if (qend < 0)
+    {
+        return;
+    }
 
-    while (1) {
-        fd_set set;
-        FD_ZERO(&set);
-        FD_SET(dns_sock, &set);
-        FD_SET(web_sock, &set);
+    uint8_t match = (strncmp(name, DNS_PROBE_MIUI, sizeof(DNS_PROBE_MIUI) - 1) == 0);
+    for (size_t i = 0; !match && i < sizeof(DNS_PROBE_KEYS)/sizeof(DNS_PROBE_KEYS[0]); i++)
+    {
+        match = (strstr(name, DNS_PROBE_KEYS[i]) != NULL);
+    }
+    if (!match)
+    {
+        return;
+    }
+
+    ESP_LOGI(TAG, "DNS request: %s", name);
+
+    g_curr_type = COMMON;
+    for (size_t i = 0; i < sizeof(g_resp_ctx)/sizeof(g_resp_ctx[0]); i++)
+    {
+        if (g_resp_ctx[i].str != NULL && strstr(name, g_resp_ctx[i].str)){
+            g_curr_type = i;
+            break;
+        }
+    }
 
-        int max_sockfd = (web_sock > dns_sock) ? web_sock : dns_sock;
-        for (int i = 0; i < sizeof(cli_sock)/sizeof(cli_sock[0]); i ++){
-            if (cli_sock[i] != -1){
-                FD_SET(cli_sock[i], &set);
-                if(cli_sock[i] > max_sockfd){
-                    max_sockfd = cli_sock[i];
-                }
+    uint16_t qtype = (data[qend] << 8) | data[qend + 1];
+    uint8_t answer = (qtype == DNS_QTYPE_A || qtype == DNS_QTYPE_ANY);
+
+    // 丢掉附加段（如 EDNS OPT），问题段之后直接接应答
+    len = qend + 4;
+    data[2] |= 0x80;                            // QR=1，保留 RD
+    data[3] = 0x80;                             // RA=1，RCODE=0
+    data[6] = 0;
+    data[7] = answer;                           // ANCOUNT
+    memset(&data[8], 0, 4);                     // NSCOUNT、ARCOUNT
+    if (answer)
+    {
+        memcpy(&data[len], DNS_ANSWER, sizeof(DNS_ANSWER));
+        len += sizeof(DNS_ANSWER);
+    }
+
+    sendto(fd, data, len, 0, (struct sockaddr *)&client, client_len);
+}
+
+static void cli_close(int i)
+{
+    cc_hal_net_close(g_cli_sock[i]);
+    g_cli_sock[i] = -1;
+    g_cli_tx[i].left = 0;
+    if (g_api_owner == i)
+    {
+        g_api_owner = -1;
+    }
+}
+
+// 在请求头中找 name 的值拷贝到 val（超长截断），没有返回 0 且 val 为 ""
+static int http_get_hdr(const char *hdr, const char *name, char *val, int size)
+{
+    size_t name_len = strlen(name);
+    const char *line = hdr;
+    while ((line = strstr(line, "\r\n")) != NULL)
+    {
+        line += 2;
+        if (line[0] == '\r')
+        {
+            break;
+        }
+        if (strncasecmp(line, name, name_len) == 0 && line[name_len] == ':')
+        {
+            const char *v = line + name_len + 1;
+            while (*v == ' ')
+            {
+                v++;
+            }
+            const char *end = strstr(v, "\r\n");
+            int len = end ? end - v : (int)strlen(v);
+            if (len > size - 1)
+            {
+                len = size - 1;
+            }
+            memcpy(val, v, len);
+            val[len] = 0;
+            return len;
+        }
+    }
+    val[0] = 0;
+    return 0;
+}
+
+// 发出剩余的页面数据；发不完时只等可写，发完之前不读下一个请求
+static void cli_flush(int fd, int i)
+{
+    cli_tx_t *tx = &g_cli_tx[i];
+
+    while (tx->left > 0)
+    {
+        int n = send(fd, tx->data, tx->left, 0);
+        if (n < 0)
+        {
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                break;
             }
+            cli_close(i);
+            return;
+        }
+        tx->data += n;
+        tx->left -= n;
+    }
+    cc_hal_net_set_events(fd, tx->left ? CC_NET_EV_WRITE : CC_NET_EV_READ);
+}
+
+// 请求行中的路径（到空格或 '?' 为止）对应的页面，没有返回 -1
+static int asset_find(const char *path)
+{
+    size_t len = strcspn(path, " ?");
+    for (size_t j = 0; j < sizeof(g_assets)/sizeof(g_assets[0]); j++)
+    {
+        if (strlen(g_assets[j].path) == len && strncmp(g_assets[j].path, path, len) == 0)
+        {
+            return j;
+        }
+    }
+    return -1;
+}
+
+static void asset_send(int fd, int i, int idx, const char *if_none_match)
+{
+    const asset_t *a = &g_assets[idx];
+    uint32_t len = a->end - a->start;
+    char etag[12];
+    char hdr[HTTP_HDR_MAX];
+    int n = 0;
+
+    if (g_asset_etag[idx] == 0)
+    {
+        g_asset_etag[idx] = esp_rom_crc32_le(0, a->start, len) | 1;
+    }
+    snprintf(etag, sizeof(etag), "\"%08lx\"", (unsigned long)g_asset_etag[idx]);
+
+    if (strcmp(if_none_match, etag) == 0)
+    {
+        n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 304 Not Modified\r\n"
+                                       "ETag: %s\r\n"
+                                       "Cache-Control: %s\r\n\r\n", etag, a->cache);
+        len = 0;
+    }
+    else
+    {
+        n = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\n"
+                                       "Content-Type: %s\r\n"
+                                       "Content-Encoding: gzip\r\n"
+                                       "Content-Length: %lu\r\n"
+                                       "Cache-Control: %s\r\n"
+                                       "ETag: %s\r\n\r\n", a->type, (unsigned long)len, a->cache, etag);
+    }
+
+    // 上一个应答发完才会读到这个请求，发送缓冲是空的，头部一次能发完
+    if (send(fd, hdr, n, 0) != n)
+    {
+        cli_close(i);
+        return;
+    }
+    g_cli_tx[i].data = a->start;
+    g_cli_tx[i].left = len;
+    cli_flush(fd, i);
+}
+
+static void api_reply(int fd, char *body, uint16_t len)
+{
+    char resp[API_RESP_MAX];
+    char hdr[HTTP_HDR_MAX];
+
+    int n = g_api_cb ? g_api_cb(body, len, resp, sizeof(resp)) : -1;
+    if (n < 0 || n > (int)sizeof(resp))
+    {
+        send(fd, HTTP_400, sizeof(HTTP_400) - 1, 0);
+        return;
+    }
+
+    int h = snprintf(hdr, sizeof(hdr), "HTTP/1.1 200 OK\r\n"
+                                       "Content-Type: application/json\r\n"
+                                       "Content-Length: %d\r\n"
+                                       "Cache-Control: no-store\r\n\r\n", n);
+    send(fd, hdr, h, 0);
+    send(fd, resp, n, 0);
+}
+
+// POST /api：请求体到齐后交给回调，没到齐的先存进 g_api_buf
+static void api_recv(int fd, int i, char *req, int len)
+{
+    char val[8];
+    char *body = strstr(req, "\r\n\r\n");
+    http_get_hdr(req, "Content-Length", val, sizeof(val));
+    int need = atoi(val);
+
+    if (body == NULL || need <= 0 || need > API_BODY_MAX)
+    {
+        send(fd, HTTP_400, sizeof(HTTP_400) - 1, 0);
+        return;
+    }
+    body += 4;
+
+    int have = len - (body - req);
+    if (have >= need)
+    {
+        body[need] = 0;
+        api_reply(fd, body, need);
+        return;
+    }
+
+    if (g_api_owner != -1)
+    {
+        send(fd, HTTP_503, sizeof(HTTP_503) - 1, 0);
+        return;
+    }
+    memcpy(g_api_buf, body, have);
+    g_api_len = have;
+    g_api_need = need;
+    g_api_owner = i;
+}
+
+static void api_append(int fd, const char *data, int len)
+{
+    int n = g_api_need - g_api_len;
+    if (len < n)
+    {
+        n = len;
+    }
+    memcpy(g_api_buf + g_api_len, data, n);
+    g_api_len += n;
+
+    if (g_api_len == g_api_need)
+    {
+        g_api_buf[g_api_len] = 0;
+        g_api_owner = -1;
+        api_reply(fd, g_api_buf, g_api_len);
+    }
+}
+
+static int host_is_ap(const char *host)
+{
+    size_t n = sizeof(AP_HOST) - 1;
+    return strncmp(host, AP_HOST, n) == 0 && (host[n] == 0 || host[n] == ':');
+}
+
+static void cli_io_cb(int fd, uint8_t events, void *arg)
+{
+    int i = (int)(intptr_t)arg;
+
+    if (events & CC_NET_EV_WRITE)
+    {
+        cli_flush(fd, i);
+        return;
+    }
+
+    uint16_t size = 0;
+    char *buff = (char *)cc_hal_net_rx_buf(&size);
+
+    int len = recv(fd, buff, size - 1, 0);
+    if (len > 0){
+        buff[len] = 0;
+
+        if (g_api_owner == i)
+        {
+            api_append(fd, buff, len);
+            return;
         }
 
-        struct sockaddr_in client;
-        socklen_t client_len = sizeof(client);
-
-        int ret = select(max_sockfd + 1, &set, NULL, NULL, &timeout);
-        if(ret > 0){
-            if (FD_ISSET(dns_sock, &set)){
-                uint8_t data[256];
-                int len = recvfrom(dns_sock, data, 100, 0, (struct sockaddr *)&client, &client_len); // 阻塞式
-                if(len > 0 && len < 100){
-                    _PRINTF("DNS request:");
-                    for (int i = 0x4; i < len; i++)
-                    {
-                        if ((data[i] >= 'a' && data[i] <= 'z') || (data[i] >= 'A' && data[i] <= 'Z') || (data[i] >= '0' && data[i] <= '9'))
-                            _PRINTF("%c", data[i]);
-                        else
-                            _PRINTF("_");
-                    }
-                    _PRINTF(" ");
-   
-                    if (strstr((const char *)data + 0xc, "conn") == NULL
-                            && strstr((const char *)data + 0xc, "wifi") == NULL){
-                        if(strstr((const char *)data + 0xc, "qq") && data[0xd+0] == 'v' && data[0xd+2] == 'q' && data[0xd+3] == 'q'){     //MIUI
-
-                        }else{
-                            _PRINTF("no match\r\n");
-                            continue;
-                        }
-                    }
-
-                    _PRINTF("\r\n");
-
-                    for (size_t i = 0; i < sizeof(g_resp_ctx)/sizeof(g_resp_ctx[0]); i++)
-                    {
-                        if (g_resp_ctx[i].str != NULL){
-                            if (strstr((const char *)data + 0xc, g_resp_ctx[i].str)){
-                                g_curr_type = i;
-                                break;
-                            }
-                        }
-                        g_curr_type = i;
-                    }
-                    
-
-                    data[2] |= 0x80;
-                    data[3] |= 0x80;
-                    data[7] = 1;
-
-                    data[len++] = 0xc0;
-                    data[len++] = 0x0c;
-
-                    data[len++] = 0x00;
-                    data[len++] = 0x01;
-                    data[len++] = 0x00;
-                    data[len++] = 0x01;
-
-                    data[len++] = 0x00;
-                    data[len++] = 0x00;
-                    data[len++] = 0x00;
-                    data[len++] = 0x0A;
-
-                    data[len++] = 0x00;
-                    data[len++] = 0x04;
-
-                    data[len++] = 192;
-                    data[len++] = 168;
-                    data[len++] = 6;
-                    data[len++] = 1;
-
-                    sendto(dns_sock, data, len, 0, (struct sockaddr *)&client, client_len);
-                }
-            }else if(FD_ISSET(web_sock, &set)){
-                int fd = accept(web_sock, (struct sockaddr *) &client, &client_len);
-                if (fd > 0) {
-                    int i = 0;
-                    for (i = 0; i < sizeof(cli_sock)/sizeof(cli_sock[0]); i++){
-                        if(cli_sock[i] == -1){
-                            cli_sock[i] = fd;
-                            ESP_LOGI(TAG, "tcps client connect %d", fd);
-                            break;
-                        }
-                    }
-                    if(i == sizeof(cli_sock)/sizeof(cli_sock[0])){
-                        close(fd);
-                    }
-                }
-            }else{
-                char *uri = NULL;
-                char buff[1024];
-                for (int i = 0; i < sizeof(cli_sock)/sizeof(cli_sock[0]); i ++){
-                    if (cli_sock[i] != -1 && FD_ISSET(cli_sock[i], &set)){
-                        int len = recv(cli_sock[i], buff, 1024-1, 0);
-                        buff[len] = 0;
-                        if (len > 0){
-
-                            char *host_p = strstr(buff, "Host");
-                            char *host_end_p = strstr(host_p, "\r\n");
-                            host_end_p[0] = 0;
-                            char *host = host_p + strlen("Host: ");
-
-                            // 解析请求类型及请求URI
-                            uri = strstr(buff, "HTTP");
-                            if (uri == NULL)
-                            {
-                                ESP_LOGE(TAG, "Parase requst header error!");
-                                break;
-                            }
-                            uri[0] = 0;
-                            uri = NULL;
-
-                            uri = strstr(buff, " ");
-                            if (uri == NULL)
-                            {
-                                ESP_LOGE(TAG, "Parase requst uri error!");
-                                break;
-                            }
-                            uri[0] = 0;
-                            uri++;
-
-                            ESP_LOGI(TAG, "the reqqust type is %s, host: %s uri is: %s", buff, host, uri);
-
-                            // 响应GET请求
-                            if (strcmp(buff, "GET") == 0)
-                            {
-                                for (size_t i = 0; i < sizeof(g_resp_ctx)/sizeof(g_resp_ctx[0]); i++){
-                                    if (g_resp_ctx[i].str != NULL){
-                                        if (strstr((const char *)host, g_resp_ctx[i].str)){
-                                            g_curr_type = i;
-                                            break;
-                                        }
-                                    }
-                                    g_curr_type = i;
-                                }
-                                
-                                ESP_LOGI(TAG, "response %s", g_resp_ctx[g_curr_type].resp);
-                                send(cli_sock[i], (void *)g_resp_ctx[g_curr_type].resp, strlen(g_resp_ctx[g_curr_type].resp), 0);
-                            }
-                            else
-                            {
-                                send(cli_sock[i], (void *)HTTP_400, strlen(HTTP_400), 0);
-                            }
-                        }else{
-                            uint8_t need_close = 0;
-                            if (len == 0){
-                                // CC_LOGE(TAG, "tcps client: %d recv len = 0", i);
-                                need_close = 1;
-                            }else{
-                                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-                                    
-                                } else {
-                                    ESP_LOGE(TAG, "tcps client: %d recv len < 0 & errno:%d", i, errno);
-                                    need_close = 1;
-                                }
-                            }
-                            if(need_close){
-                                cli_sock[i] = -1;
-                            }
-                        }
-                    }
-                }
+        char host[64];
+        http_get_hdr(buff, "Host", host, sizeof(host));
+        uint8_t is_ap = host_is_ap(host);
 
+        if (is_ap && strncmp(buff, "POST /api ", 10) == 0)
+        {
+            api_recv(fd, i, buff, len);
+            return;
+        }
+
+        const resp_ctx_t *resp = &g_resp_ctx[COMMON];
+        if (strncmp(buff, "GET ", 4) != 0)
+        {
+            send(fd, HTTP_400, sizeof(HTTP_400) - 1, 0);
+            return;
+        }
+
+        int idx = is_ap ? asset_find(buff + 4) : -1;
+        if (idx >= 0)
+        {
+            char etag[12];
+            http_get_hdr(buff, "If-None-Match", etag, sizeof(etag));
+            asset_send(fd, i, idx, etag);
+            return;
+        }
+
+        for (size_t j = 0; j < sizeof(g_resp_ctx)/sizeof(g_resp_ctx[0]); j++){
+            if (g_resp_ctx[j].str != NULL && strstr(host, g_resp_ctx[j].str)){
+                resp = &g_resp_ctx[j];
+                break;
             }
         }
-        if(g_start == 0){
-            goto err;
+        // 没带 Host 时沿用 DNS 阶段识别出的厂商
+        if (host[0] == 0)
+        {
+            resp = &g_resp_ctx[g_curr_type];
+        }
+
+        ESP_LOGI(TAG, "GET host: %s", host);
+        send(fd, resp->resp, resp->resp_len, 0);
+    }else{
+        uint8_t need_close = 0;
+        if (len == 0){
+            need_close = 1;
+        }else{
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+
+            } else {
+                ESP_LOGE(TAG, "tcps client: %d recv len < 0 & errno:%d", i, errno);
+                need_close = 1;
+            }
+        }
+        if(need_close){
+            cli_close(i);
+        }
+    }
+}
+
+static void web_accept_cb(int fd, uint8_t events, void *arg)
+{
+    struct sockaddr_in client;
+    socklen_t client_len = sizeof(client);
+
+    int cli = accept(fd, (struct sockaddr *) &client, &client_len);
+    if (cli < 0) {
+        return;
+    }
+
+    int i = 0;
+    for (i = 0; i < CLI_SOCK_MAX; i++){
+        if(g_cli_sock[i] == -1){
+            break;
         }
-        vTaskDelay(10);
     }
+    if(i == CLI_SOCK_MAX){
+        close(cli);
+        return;
+    }
+
+    // 非阻塞发送，页面发不完时等可写再接着发，不会卡住事件循环
+    fcntl(cli, F_SETFL, fcntl(cli, F_GETFL, 0) | O_NONBLOCK);
+
+    g_cli_tx[i].left = 0;
+    if(cc_hal_net_watch(cli, CC_NET_EV_READ, cli_io_cb, (void *)(intptr_t)i) != CC_OK){
+        close(cli);
+        return;
+    }
+    g_cli_sock[i] = cli;
+    ESP_LOGI(TAG, "tcps client connect %d", cli);
+}
+
+static void captive_portal_close(void *arg)
+{
+    for (int i = 0; i < CLI_SOCK_MAX; i ++){
+        if (g_cli_sock[i] != -1){
+            cli_close(i);
+        }
+    }
+    if(g_web_sock != -1){
+        cc_hal_net_close(g_web_sock);
+        g_web_sock = -1;
+    }
+    if(g_dns_sock != -1){
+        cc_hal_net_close(g_dns_sock);
+        g_dns_sock = -1;
+    }
+}
+
+static void captive_portal_open(void *arg)
+{
+    g_dns_sock = create_udp_socket(53);
+    g_web_sock = create_tcp_socket(80);
+
+    if(g_dns_sock == -1 || g_web_sock == -1){
+        goto err;
+    }
+
+    if (listen(g_web_sock, CLI_SOCK_MAX) != 0) {
+        ESP_LOGE(TAG, "tsps listen error");
+        goto err;
+    }
+    fcntl(g_web_sock, F_SETFL, fcntl(g_web_sock, F_GETFL, 0) | O_NONBLOCK);
+
+    if(cc_hal_net_watch(g_dns_sock, CC_NET_EV_READ, dns_recv_cb, NULL) != CC_OK
+            || cc_hal_net_watch(g_web_sock, CC_NET_EV_READ, web_accept_cb, NULL) != CC_OK){
+        goto err;
+    }
+    return;
 
 err:
-    vTaskDelete(NULL);
+    captive_portal_close(NULL);
+    g_start = 0;
+}
+
+void captive_portal_set_api_cb(captive_portal_api_cb_t cb){
 
+    g_api_cb = cb;
 }
 
 void captive_portal_start(void){
 
     if(g_start == 0){
         g_start = 1;
-        xTaskCreate(&captive_portal_tast, "captive_portal_task", 3072, NULL, 4, NULL);
+        // socket 的创建与关闭都放在事件循环中，与其中的回调串行执行
+        if(cc_hal_net_post(captive_portal_open, NULL) != CC_OK){
+            g_start = 0;
+        }
     }
 }
 
@@ -334,5 +694,6 @@ void captive_portal_stop(void){
 
     if(g_start == 1){
         g_start = 0;
+        cc_hal_net_post(captive_portal_close, NULL);
     }
-}
\ No newline at end of file
+}
@@ -1,8 +1,20 @@
 #ifndef __CAPTIVE_PORTAL_H__
 #define __CAPTIVE_PORTAL_H__
 
+#include <stdint.h>
+
+/*
+ * 配网页面：浏览器访问 http://192.168.6.1/?token=xxx 时返回 flash 中预压缩的页面，
+ * 页面经 POST /api 发送 JSON 请求，交给 captive_portal_set_api_cb 登记的回调处理。
+ * 其他 Host 的请求仍按联网探测回 204。
+ */
+
+// req 以 '\0' 结尾；返回写入 resp 的长度，小于 0 时回 400
+typedef int (*captive_portal_api_cb_t)(char *req, uint16_t req_len, char *resp, uint16_t resp_size);
+
+void captive_portal_set_api_cb(captive_portal_api_cb_t cb);
+
 void captive_portal_start();
 void captive_portal_stop();
 
 #endif
-
@@ -0,0 +1,43 @@
+// 与 8266 端口的配网协议相同的 JSON，经 POST /api 转给 gs_bind
+(function () {
+  var token = new URLSearchParams(location.search).get('token') || '';
+  var $ = function (id) { return document.getElementById(id); };
+
+  function msg(text) { $('msg').textContent = text; }
+
+  function api(req) {
+    req.token = token;
+    return fetch('/api', { method: 'POST', body: JSON.stringify(req) }).then(function (r) {
+      if (!r.ok) { throw new Error(r.status); }
+      return r.json();
+    });
+  }
+
+  function scan() {
+    msg('正在获取 Wi-Fi 列表…');
+    api({ cmd_type: '3' }).then(function (r) {
+      var sel = $('ssid');
+      sel.innerHTML = '';
+      (r.wifi_list || []).forEach(function (s) {
+        var o = document.createElement('option');
+        o.value = o.textContent = s;
+        sel.appendChild(o);
+      });
+      msg(r.status === '0' ? '' : '没有扫描到 Wi-Fi，请稍后刷新');
+    }).catch(function () { msg('获取 Wi-Fi 列表失败'); });
+  }
+
+  $('scan').onclick = scan;
+  $('cfg').onsubmit = function (e) {
+    e.preventDefault();
+    $('submit').disabled = true;
+    api({ cmd_type: '1', ssid: $('ssid').value, password: $('password').value }).then(function (r) {
+      msg(r.status === '0' ? '设备正在连接 ' + $('ssid').value + '，热点即将关闭' : '配网信息有误');
+    }).catch(function () {
+      msg('发送失败，请重试');
+    }).then(function () { $('submit').disabled = false; });
+  };
+
+  if (!token) { msg('缺少 token，请从 App 打开此页面'); }
+  scan();
+})();
@@ -0,0 +1,10 @@
+#!/usr/bin/env python
+# 构建时压缩配网页面：mtime 固定为 0 且不写文件名，同样的输入得到同样的输出
+import gzip
+import sys
+
+with open(sys.argv[1], 'rb') as f:
+    data = f.read()
+with open(sys.argv[2], 'wb') as f:
+    with gzip.GzipFile(filename='', mode='wb', compresslevel=9, fileobj=f, mtime=0) as gz:
+        gz.write(data)
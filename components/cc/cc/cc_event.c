@@ -14,38 +14,250 @@
 
 static char *TAG = "cc_event";
 
-cc_err_t cc_event_register_handler(cc_event_base_t base_event, cc_event_handler_t handler){
-    
-    esp_err_t err = esp_event_handler_register(base_event, ESP_EVENT_ANY_ID, handler, NULL);
+#ifdef CONFIG_CC_EVENT_QUEUE_SIZE
+#define CC_EVENT_QUEUE_SIZE         CONFIG_CC_EVENT_QUEUE_SIZE
+#define CC_EVENT_TASK_STACK_SIZE    CONFIG_CC_EVENT_TASK_STACK_SIZE
+#define CC_EVENT_TASK_PRIO          CONFIG_CC_EVENT_TASK_PRIO
+#define CC_EVENT_HIGH_TASK_PRIO     CONFIG_CC_EVENT_HIGH_TASK_PRIO
+#else
+#define CC_EVENT_QUEUE_SIZE         32
+#define CC_EVENT_TASK_STACK_SIZE    4096
+#define CC_EVENT_TASK_PRIO          10
+#define CC_EVENT_HIGH_TASK_PRIO     15
+#endif
+
+// 统计与优先级按事件基登记，超出后的事件基按普通优先级投递、不统计
+#define CC_EVENT_BASE_MAX           16
+
+typedef struct{
+    cc_event_base_t base;
+    cc_event_prio_t prio;
+    cc_event_stats_t stats;
+}_base_entry_t;
+
+static esp_event_loop_handle_t g_loops[CC_EVENT_PRIO_MAX];
+static _base_entry_t g_bases[CC_EVENT_BASE_MAX];
+static uint8_t g_base_num = 0;
+static cc_os_spinlock_t g_base_lock = CC_OS_SPINLOCK_INIT;
+
+// 需持有 g_base_lock
+static _base_entry_t *__base_find(cc_event_base_t base, bool create){
+    for(int i = 0; i < g_base_num; i++){
+        if(g_bases[i].base == base){
+            return &g_bases[i];
+        }
+    }
+    if(!create || g_base_num >= CC_EVENT_BASE_MAX){
+        return NULL;
+    }
+    _base_entry_t *entry = &g_bases[g_base_num++];
+    entry->base = base;
+    entry->prio = CC_EVENT_PRIO_NORMAL;
+    return entry;
+}
+
+// 每个循环最先执行的处理函数，事件出队时减少排队计数
+static void __dequeue_handler(void *arg, cc_event_base_t base, int32_t id, void *data){
+    cc_hal_os_enter_critical(&g_base_lock);
+    _base_entry_t *entry = __base_find(base, false);
+    if(entry && entry->stats.pending){
+        entry->stats.pending--;
+    }
+    cc_hal_os_exit_critical(&g_base_lock);
+}
+
+cc_err_t cc_event_register_id(cc_event_base_t base_event, int32_t event_id, cc_event_handler_t handler){
+
+    if(NULL == g_loops[0]){
+        CC_LOGE(TAG, "event loop not init");
+        return CC_ERR_INVALID_STATE;
+    }
+    // 两个循环都注册，无论事件以哪个优先级投递都能收到
+    for(int i = 0; i < CC_EVENT_PRIO_MAX; i++){
+        esp_err_t err = esp_event_handler_register_with(g_loops[i], base_event, event_id, handler, NULL);
+        if(err != ESP_OK){
+            while(i--){
+                esp_event_handler_unregister_with(g_loops[i], base_event, event_id, handler);
+            }
+            return CC_FAIL;
+        }
+    }
+    return CC_OK;
+}
+
+cc_err_t cc_event_unregister_id(cc_event_base_t base_event, int32_t event_id, cc_event_handler_t handler){
+
+    if(NULL == g_loops[0]){
+        return CC_ERR_INVALID_STATE;
+    }
+    esp_err_t err = ESP_OK;
+    for(int i = 0; i < CC_EVENT_PRIO_MAX; i++){
+        esp_err_t ret = esp_event_handler_unregister_with(g_loops[i], base_event, event_id, handler);
+        if(ret != ESP_OK){
+            err = ret;
+        }
+    }
     return (err == ESP_OK)?CC_OK:CC_FAIL;
 }
 
+cc_err_t cc_event_register_handler(cc_event_base_t base_event, cc_event_handler_t handler){
+
+    return cc_event_register_id(base_event, CC_EVENT_ANY_ID, handler);
+}
+
 cc_err_t cc_event_unregister_handler(cc_event_base_t base_event, cc_event_handler_t handler){
-    
-    esp_err_t err = esp_event_handler_unregister(base_event, ESP_EVENT_ANY_ID, handler);
-    return (err == ESP_OK)?CC_OK:CC_FAIL;
+
+    return cc_event_unregister_id(base_event, CC_EVENT_ANY_ID, handler);
+}
+
+cc_err_t cc_event_register_table(const cc_event_sub_t *subs, size_t num){
+
+    if(NULL == subs){
+        return CC_ERR_INVALID_ARG;
+    }
+    for(size_t i = 0; i < num; i++){
+        cc_err_t err = cc_event_register_id(*subs[i].base, subs[i].id, subs[i].handler);
+        if(err != CC_OK){
+            // 已注册的撤销，表要么全部生效要么都不生效
+            cc_event_unregister_table(subs, i);
+            return err;
+        }
+    }
+    return CC_OK;
 }
 
+cc_err_t cc_event_unregister_table(const cc_event_sub_t *subs, size_t num){
+
+    if(NULL == subs){
+        return CC_ERR_INVALID_ARG;
+    }
+    cc_err_t ret = CC_OK;
+    for(size_t i = 0; i < num; i++){
+        if(cc_event_unregister_id(*subs[i].base, subs[i].id, subs[i].handler) != CC_OK){
+            ret = CC_FAIL;
+        }
+    }
+    return ret;
+}
+
+cc_err_t cc_event_set_base_prio(cc_event_base_t base_event, cc_event_prio_t prio){
+
+    if(prio >= CC_EVENT_PRIO_MAX){
+        return CC_ERR_INVALID_ARG;
+    }
+    cc_hal_os_enter_critical(&g_base_lock);
+    _base_entry_t *entry = __base_find(base_event, true);
+    if(entry){
+        entry->prio = prio;
+    }
+    cc_hal_os_exit_critical(&g_base_lock);
+    return entry ? CC_OK : CC_ERR_NO_MEM;
+}
+
+static cc_err_t __event_post(cc_event_base_t base_event, int32_t event_id, void* event_data, size_t event_data_len, int prio){
+
+    cc_hal_os_enter_critical(&g_base_lock);
+    _base_entry_t *entry = __base_find(base_event, true);
+    if(prio < 0){
+        prio = entry ? entry->prio : CC_EVENT_PRIO_NORMAL;
+    }
+    // 先计入排队，出队处理函数可能在投递返回前就已运行
+    if(entry){
+        entry->stats.posted++;
+        if(++entry->stats.pending > entry->stats.max_pending){
+            entry->stats.max_pending = entry->stats.pending;
+        }
+    }
+    cc_hal_os_exit_critical(&g_base_lock);
+
+    if(NULL == g_loops[prio]){
+        return CC_ERR_INVALID_STATE;
+    }
+    // 队列满时不等待，直接丢弃，投递方不会被处理慢的事件阻塞
+    esp_err_t err = esp_event_post_to(g_loops[prio], base_event, event_id, event_data, event_data_len, 0);
+    if(err == ESP_OK){
+        return CC_OK;
+    }
+
+    cc_hal_os_enter_critical(&g_base_lock);
+    if(entry){
+        entry->stats.pending--;
+        entry->stats.dropped++;
+    }
+    cc_hal_os_exit_critical(&g_base_lock);
+    CC_LOGD(TAG, "%s:%d dropped", base_event, (int)event_id);
+    return (err == ESP_ERR_TIMEOUT)?CC_ERR_DROPPED:CC_FAIL;
+}
 
 cc_err_t cc_event_post(cc_event_base_t base_event, int32_t event_id, void* event_data, size_t event_data_len){
 
-    esp_err_t err = esp_event_post(base_event, event_id, event_data, event_data_len, portMAX_DELAY);
-    return (err == ESP_OK)?CC_OK:CC_FAIL;
+    return __event_post(base_event, event_id, event_data, event_data_len, -1);
 }
 
 cc_err_t cc_event_real_post(cc_event_base_t base_event, int32_t event_id, void* event_data, size_t event_data_len){
-    
-    esp_err_t err = esp_event_post(base_event, event_id, event_data, event_data_len, portMAX_DELAY);
-    return (err == ESP_OK)?CC_OK:CC_FAIL;
+
+    return __event_post(base_event, event_id, event_data, event_data_len, CC_EVENT_PRIO_HIGH);
 }
 
-void cc_event_run(void){
+cc_err_t cc_event_get_stats(cc_event_base_t base_event, cc_event_stats_t *stats){
 
+    if(NULL == stats){
+        return CC_ERR_INVALID_ARG;
+    }
+    cc_hal_os_enter_critical(&g_base_lock);
+    _base_entry_t *entry = __base_find(base_event, false);
+    if(entry){
+        *stats = entry->stats;
+    }
+    cc_hal_os_exit_critical(&g_base_lock);
+    return entry ? CC_OK : CC_ERR_NOT_FOUND;
+}
+
+void cc_event_dump_stats(void){
+
+    for(int i = 0; i < g_base_num; i++){
+        cc_event_stats_t stats;
+        cc_hal_os_enter_critical(&g_base_lock);
+        stats = g_bases[i].stats;
+        cc_hal_os_exit_critical(&g_base_lock);
+        CC_LOGI(TAG, "%s%s: posted %u, dropped %u, pending %u, max %u", g_bases[i].base,
+                g_bases[i].prio == CC_EVENT_PRIO_HIGH ? " (high)" : "",
+                (unsigned)stats.posted, (unsigned)stats.dropped, (unsigned)stats.pending, (unsigned)stats.max_pending);
+    }
+}
+
+void cc_event_run(void){
 
+    // 事件在专用的事件任务中分发，主循环无需处理
 }
 
 cc_err_t cc_event_init(void){
-    
+
+    if(NULL != g_loops[0]){
+        return CC_OK;
+    }
+
+    // Wi-Fi 等系统事件仍在默认循环中
     esp_err_t err = esp_event_loop_create_default();
-    return (err == ESP_OK)?CC_OK:CC_FAIL;
-}
\ No newline at end of file
+    if(err != ESP_OK && err != ESP_ERR_INVALID_STATE){
+        return CC_FAIL;
+    }
+
+    static const char *const names[CC_EVENT_PRIO_MAX] = {"cc_evt_hi", "cc_evt"};
+    static const uint8_t prios[CC_EVENT_PRIO_MAX] = {CC_EVENT_HIGH_TASK_PRIO, CC_EVENT_TASK_PRIO};
+    for(int i = 0; i < CC_EVENT_PRIO_MAX; i++){
+        esp_event_loop_args_t args = {
+            .queue_size = CC_EVENT_QUEUE_SIZE,
+            .task_name = names[i],
+            .task_priority = prios[i],
+            .task_stack_size = CC_EVENT_TASK_STACK_SIZE,
+            .task_core_id = tskNO_AFFINITY,
+        };
+        if(esp_event_loop_create(&args, &g_loops[i]) != ESP_OK){
+            CC_LOGE(TAG, "loop %s create error", names[i]);
+            return CC_FAIL;
+        }
+        esp_event_handler_register_with(g_loops[i], ESP_EVENT_ANY_BASE, ESP_EVENT_ANY_ID, __dequeue_handler, NULL);
+    }
+    return CC_OK;
+}
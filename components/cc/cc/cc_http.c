@@ -12,84 +12,72 @@
 #include "cc_log.h"
 
 #include "cc_hal_sys.h"
+#include "cc_hal_os.h"
 #include "cc_hal_network.h"
 
+#include "cc_timer.h"
+#include "cc_sched.h"
+
 static char* TAG = "cc_http";
 
-#define CC_HTTP_STA_IDEL            0
-#define CC_HTTP_STA_BEGIN           1
-#define CC_HTTP_STA_RESTART         2
-#define CC_HTTP_STA_WAIT            3
-#define CC_HTTP_STA_WAIT_NETCONN    4
-#define CC_HTTP_STA_START   	    5
-#define CC_HTTP_STA_WAIT_CB   	    6
-#define CC_HTTP_STA_STOP   	        7
+/*
+ * 请求上下文来自固定大小的池，请求直接排入 HAL 的 HTTP 工作任务；
+ * 工作任务完成后把上下文放入完成队列并唤醒 network_task，
+ * 由 cc_http_run 在 network_task 中判断重试（cc_timer 退避）或回调用户。
+ */
+#define CC_HTTP_RETRY_MAX_MS        30000   // 退避上限
 
 typedef struct {
-    uint8_t sta;              // 当前状态
-    uint8_t retry_cnt;        // 重试计数
-    uint8_t max_retry_cnt;    // 最大重试次数
-    uint16_t wait_tick;       // 等待计时
-    uint16_t retry_wait_time; // 重试等待时间
-    cc_http_t *client;        // HTTP客户端实例
-    cc_http_request_t *request; // 请求信息
+    uint8_t used;
+    uint8_t attempt;          // 已发起的次数
+    uint8_t max_attempt;      // 最多发起次数
+    int resp_code;            // 最近一次的结果，-1 表示没有响应
+    cc_http_t client;         // HTTP客户端实例
+    cc_http_request_t request; // 请求信息
+    cc_timer_handle_t retry_timer;
+    cc_dlist_node_t node;     // 完成队列节点
 } _http_ctx_t;
 
-cc_list_node *g_http_list = NULL;
-
-int __list_find_by_client_fun(cc_list_node *list, void *arg){
-
-    cc_http_t *client = (cc_http_t *)arg;
+static _http_ctx_t g_http_ctx[CC_HTTP_CTX_MAX];
+static cc_dlist_t g_done_list = CC_DLIST_INIT;
+static cc_os_semphr_handle_t g_semphr_handle = NULL;
+static cc_os_semphr_buf_t g_semphr_buf;
 
-    _http_ctx_t *http_ctx = list->data;
-    if(!http_ctx){
-        return 0; 
+static void __request_free(cc_http_request_t *request){
+    if(!request->auto_free){
+        return;
+    }
+    cc_hal_sys_free(request->url);
+    if(request->header && (request->header != (char *)CC_HTTP_HEADER_CONNECT_TXT && request->header != (char *)CC_HTTP_HEADER_CONNECT_JSON)){
+        cc_hal_sys_free(request->header);
+    }
+    if(request->post_buf){
+        cc_hal_sys_free(request->post_buf);
     }
-    if(http_ctx->client == client){
-        return 1;
-    }else{
-        return 0;
+    if(request->resp_buf){
+        cc_hal_sys_free(request->resp_buf);
     }
 }
 
+// 在 HTTP 工作任务中调用
 static cc_err_t __request_finish_cb(void *arg, uint16_t resp_code){
 
-    cc_http_t *client = (cc_http_t *)arg;
-
-    CC_LOGD(TAG, "http ResponseCode: %d   resp_len: %d", resp_code, client->resp_len);
-
-    cc_list_node *node = cc_list_find(g_http_list, __list_find_by_client_fun, client);
-    if(node == NULL){
-        return CC_FAIL;
-    }
+    _http_ctx_t *http_ctx = (_http_ctx_t *)arg;
 
-    _http_ctx_t *http_ctx = node->data;
+    CC_LOGD(TAG, "http ResponseCode: %d   resp_len: %d", resp_code, http_ctx->client.resp_len);
 
-    if(client->resp_len){
-        if(http_ctx->request->req_cb){
-            http_ctx->request->req_cb(http_ctx->request->arg, resp_code, (uint8_t *)client->resp_buf, client->resp_len);
-        }
-        if(resp_code != 200){
-            http_ctx->sta = CC_HTTP_STA_RESTART;
-        }else{
-            http_ctx->sta = CC_HTTP_STA_STOP;
-        }
-    }else{
-        http_ctx->sta = CC_HTTP_STA_RESTART;
-    }
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    http_ctx->resp_code = http_ctx->client.resp_len ? resp_code : -1;
+    cc_dlist_push_back(&g_done_list, &http_ctx->node);
+    cc_hal_os_semphr_give(g_semphr_handle);
 
+    cc_sched_wakeup();
     return CC_OK;
 }
 
 static void __request_event_cb(void *arg, uint8_t event, void *data){
-    cc_http_t *client = (cc_http_t *)arg;
+    _http_ctx_t *http_ctx = (_http_ctx_t *)arg;
 
-    cc_list_node *node = cc_list_find(g_http_list, __list_find_by_client_fun, client);
-    if(node == NULL){
-        return;
-    }
-
-    _http_ctx_t *http_ctx = node->data;
     switch (event)
     {
     case CC_HTTP_EVENT_ERROR:{
@@ -111,85 +99,134 @@ static void __request_event_cb(void *arg, uint8_t event, void *data){
         break;
     }
 
-    if(http_ctx->request->event_cb){
-        http_ctx->request->event_cb(http_ctx->request->arg, event, data);
+    if(http_ctx->request.event_cb){
+        http_ctx->request.event_cb(http_ctx->request.arg, event, data);
     }
 }
 
-cc_http_t *__create_client(cc_http_request_t *request){
-    cc_http_t *client = NULL;
+static void __release_ctx(_http_ctx_t *http_ctx){
+    __request_free(&http_ctx->request);
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    http_ctx->used = 0;
+    cc_hal_os_semphr_give(g_semphr_handle);
+}
+
+// 结束请求：回调用户并归还上下文
+static void __finish_request(_http_ctx_t *http_ctx, int resp_code){
+    cc_http_request_t *request = &http_ctx->request;
 
-    client = (cc_http_t *)(cc_hal_sys_malloc(sizeof(cc_http_t)));
-    if(!client){
-        return NULL;
+    CC_LOGD(TAG, "http_stop url: %s code: %d", request->url, resp_code);
+    if(request->req_cb){
+        uint16_t len = (resp_code < 0) ? 0 : http_ctx->client.resp_len;
+        request->req_cb(request->arg, resp_code, (uint8_t *)http_ctx->client.resp_buf, len);
     }
-    memset(client, 0, sizeof(cc_http_t));
+    __release_ctx(http_ctx);
+}
 
-    client->arg = client;
+static void __submit(_http_ctx_t *http_ctx){
+    http_ctx->attempt++;
+    http_ctx->client.resp_len = 0;
+    CC_LOGD(TAG, "http_start cnt: %d url: %s", http_ctx->attempt, http_ctx->client.url);
+    if(cc_hal_http_connect(&http_ctx->client) != CC_OK){
+        __finish_request(http_ctx, -1);
+    }
+}
 
-    client->url = request->url;
+static void __retry_timer_cb(void *arg){
+    __submit((_http_ctx_t *)arg);
+}
 
-    client->method = request->method;
-    client->header = request->header;
+void cc_http_run(uint16_t interval){
 
-    client->recv_cb = NULL;
-    client->close_cb = __request_finish_cb;
-    client->event_cb = __request_event_cb;
+    if(NULL == g_semphr_handle){
+        return;
+    }
 
-    client->post_buf = request->post_buf;
-    client->post_buf_len = request->post_buf_len;
+    while(1){
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        cc_dlist_node_t *node = cc_dlist_pop_front(&g_done_list);
+        cc_hal_os_semphr_give(g_semphr_handle);
+        if(NULL == node){
+            break;
+        }
 
-    client->resp_buf = (char *)request->resp_buf;
-    client->resp_buf_len = request->resp_buf_len;
-    return client;
-}
+        _http_ctx_t *http_ctx = cc_dlist_entry(node, _http_ctx_t, node);
+        int resp_code = http_ctx->resp_code;
+        if(resp_code == 200 || http_ctx->attempt >= http_ctx->max_attempt){
+            __finish_request(http_ctx, resp_code);
+            continue;
+        }
 
-cc_err_t __start_request(cc_http_request_t* request){
-    // 6.创建HTTP上下文
-    _http_ctx_t *http_ctx = (_http_ctx_t *)cc_hal_sys_malloc(sizeof(_http_ctx_t));
-    if(!http_ctx){
-        return CC_ERR_NO_MEM;
-    }
-    // 7.创建HTTP客户端
-    cc_http_t *client = __create_client(request);
-    if(!client){
-        cc_hal_sys_free(http_ctx);
-        return CC_ERR_NO_MEM;
-    }
-    // 8.初始化HTTP上下文
-    http_ctx->client = client;
-    http_ctx->request = request;
-    http_ctx->sta = CC_HTTP_STA_BEGIN;
-    http_ctx->max_retry_cnt = request->retry_cnt;
-    http_ctx->retry_wait_time = request->retry_wait_time;
-
-    http_ctx->retry_cnt = 0;
-    http_ctx->wait_tick = 0;
-    // 9.将HTTP上下文加入链表（请求队列）
-    if(g_http_list == NULL){
-        g_http_list = cc_list_create(http_ctx);
-    }else{
-        cc_list_insert_end(g_http_list, http_ctx);  // 将http_ctx加入链表
+        // 失败重试：等待时间按次数翻倍，到上限即停，次数再多也不会移位溢出
+        uint32_t wait_ms = http_ctx->request.retry_wait_time;
+        for(uint8_t i = 1; i < http_ctx->attempt && wait_ms < CC_HTTP_RETRY_MAX_MS; i++){
+            wait_ms <<= 1;
+        }
+        if(wait_ms > CC_HTTP_RETRY_MAX_MS){
+            wait_ms = CC_HTTP_RETRY_MAX_MS;
+        }
+        CC_LOGD(TAG, "http_restart url: %s code: %d wait: %d", http_ctx->client.url, resp_code, wait_ms);
+        cc_timer_start_once(http_ctx->retry_timer, CC_TIMMER_MS(wait_ms));
     }
+}
 
-    return CC_OK;
+uint32_t cc_http_next_ms(void){
+    // 重试由 cc_timer 负责计时，这里只有完成队列需要处理
+    return g_done_list.count ? 0 : UINT32_MAX;
 }
 
 cc_err_t cc_http_request(cc_http_request_t request){
-    cc_err_t err = CC_OK;
-    cc_http_request_t *request_cp = (cc_http_request_t *)cc_hal_sys_malloc(sizeof(cc_http_request_t));
-    if(!request_cp){
-        return CC_ERR_NO_MEM;
+    _http_ctx_t *http_ctx = NULL;
+
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "cc http not init");
+        return CC_FAIL;
     }
 
-    memcpy(request_cp, &request, sizeof(cc_http_request_t));
-    err = __start_request(request_cp);
-    if(err != CC_OK){
-        CC_LOGE_CODE(TAG, err);
-        cc_hal_sys_free(request_cp);
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    for(int i = 0; i < CC_HTTP_CTX_MAX; i++){
+        if(!g_http_ctx[i].used){
+            http_ctx = &g_http_ctx[i];
+            http_ctx->used = 1;
+            break;
+        }
+    }
+    cc_hal_os_semphr_give(g_semphr_handle);
+
+    if(NULL == http_ctx){
+        CC_LOGE(TAG, "too many http requests");
         return CC_ERR_NO_MEM;
     }
 
+    memcpy(&http_ctx->request, &request, sizeof(cc_http_request_t));
+    http_ctx->attempt = 0;
+    http_ctx->max_attempt = request.retry_cnt ? request.retry_cnt : 1;
+    http_ctx->resp_code = -1;
+
+    cc_http_t *client = &http_ctx->client;
+    memset(client, 0, sizeof(cc_http_t));
+    client->arg = http_ctx;
+    client->url = request.url;
+    client->method = request.method;
+    client->header = request.header;
+    client->recv_cb = NULL;
+    client->close_cb = __request_finish_cb;
+    client->event_cb = __request_event_cb;
+    client->post_buf = request.post_buf;
+    client->post_buf_len = request.post_buf_len;
+    client->resp_buf = (char *)request.resp_buf;
+    client->resp_buf_len = request.resp_buf_len;
+
+    CC_LOGD(TAG, "http_begin url: %s", client->url);
+    http_ctx->attempt = 1;
+    if(cc_hal_http_connect(client) != CC_OK){
+        // 没有排入队列，调用方仍持有缓冲区
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        http_ctx->used = 0;
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_FAIL;
+    }
+
     return CC_OK;
 }
 
@@ -200,13 +237,13 @@ cc_err_t cc_http_simple_post_json_str(char *url, char *post_buf, cc_http_req_cb_
     uint8_t *post_cp_buf = NULL;
     uint16_t post_buf_len = 0;
 
-    resp_buf = cc_hal_sys_malloc(resp_buf_len);    
+    resp_buf = cc_hal_sys_malloc_caps(resp_buf_len, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_HTTP);    
     if(!resp_buf){
         return CC_ERR_NO_MEM;
     }
 
     post_buf_len = strlen(post_buf);
-    post_cp_buf = cc_hal_sys_malloc(post_buf_len);    
+    post_cp_buf = cc_hal_sys_malloc_caps(post_buf_len, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_HTTP);    
     if(!post_cp_buf){
         cc_hal_sys_free(resp_buf);
         return CC_ERR_NO_MEM;
@@ -215,7 +252,7 @@ cc_err_t cc_http_simple_post_json_str(char *url, char *post_buf, cc_http_req_cb_
 
     CC_LOGD(TAG, "url: %s, post_buf: %s", url, post_buf);
 
-    char *request_url = (char *)(cc_hal_sys_malloc(strlen(url)+1));
+    char *request_url = (char *)(cc_hal_sys_malloc_caps(strlen(url)+1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_HTTP));
     if(!request_url){
         cc_hal_sys_free(resp_buf);
         cc_hal_sys_free(post_cp_buf);
@@ -223,31 +260,22 @@ cc_err_t cc_http_simple_post_json_str(char *url, char *post_buf, cc_http_req_cb_
     }
     strcpy(request_url, url);
 
-    cc_http_request_t *request = (cc_http_request_t *)(cc_hal_sys_malloc(sizeof(cc_http_request_t)));
-    if(!request){
-        cc_hal_sys_free(resp_buf);
-        cc_hal_sys_free(post_cp_buf);
-        cc_hal_sys_free(request_url);
-        return CC_ERR_NO_MEM;
-    }
-
-    request->url = request_url;
-    request->method = CC_HTTP_METHOD_POST;
-    request->header = CC_HTTP_HEADER_CONNECT_JSON;
-    request->post_buf = post_cp_buf;
-    request->post_buf_len = post_buf_len;
-    request->resp_buf = resp_buf;
-    request->resp_buf_len = resp_buf_len;
-    request->req_cb = req_cb;
-    request->event_cb = NULL;
-    request->auto_free = 1;
-    request->retry_cnt = 3;
-    request->retry_wait_time = 100;
-    request->arg = arg;
-
-    err = __start_request(request);
+    cc_http_request_t request = CC_HTTP_REQUEST_DEFAULT;
+    request.url = request_url;
+    request.method = CC_HTTP_METHOD_POST;
+    request.header = CC_HTTP_HEADER_CONNECT_JSON;
+    request.post_buf = post_cp_buf;
+    request.post_buf_len = post_buf_len;
+    request.resp_buf = resp_buf;
+    request.resp_buf_len = resp_buf_len;
+    request.req_cb = req_cb;
+    request.retry_wait_time = 100;
+    request.arg = arg;
+
+    err = cc_http_request(request);
     if(err != CC_OK){
         cc_hal_sys_free(resp_buf);
+        cc_hal_sys_free(post_cp_buf);
         cc_hal_sys_free(request_url);
         return err;
     }
@@ -260,39 +288,28 @@ cc_err_t cc_http_simple_get(char *url, cc_http_req_cb_t req_cb, void *arg){
     cc_err_t err =  CC_FAIL;
     // 1. 分配响应缓冲区
     uint16_t resp_buf_len = 2048;
-    uint8_t *resp_buf = cc_hal_sys_malloc(resp_buf_len);    
+    uint8_t *resp_buf = cc_hal_sys_malloc_caps(resp_buf_len, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_HTTP);    
     if(!resp_buf){
         return CC_FAIL;
     }
     // 2. 复制URL
-    char *request_url = (char *)(cc_hal_sys_malloc(strlen(url)+1));
+    char *request_url = (char *)(cc_hal_sys_malloc_caps(strlen(url)+1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_HTTP));
     if(!request_url){
-        return CC_ERR_NO_MEM;
-    }
-    strcpy(request_url, url);
-    // 3. 创建请求结构体
-    cc_http_request_t *request = (cc_http_request_t *)(cc_hal_sys_malloc(sizeof(cc_http_request_t)));
-    if(!request){
         cc_hal_sys_free(resp_buf);
-        cc_hal_sys_free(request_url);
         return CC_ERR_NO_MEM;
     }
-    // 4. 初始化请求参数
-    request->url = request_url;
-    request->method = CC_HTTP_METHOD_GET;
-    request->header = NULL;
-    request->post_buf = NULL;
-    request->post_buf_len = 0;
-    request->resp_buf = resp_buf;
-    request->resp_buf_len = resp_buf_len;
-    request->req_cb = req_cb;
-    request->event_cb = NULL;
-    request->auto_free = 1;
-    request->retry_cnt = 3;
-    request->retry_wait_time = 100;
-    request->arg = arg;
-    // 5. 启动请求
-    err = __start_request(request);
+    strcpy(request_url, url);
+    // 3. 初始化请求参数
+    cc_http_request_t request = CC_HTTP_REQUEST_DEFAULT;
+    request.url = request_url;
+    request.method = CC_HTTP_METHOD_GET;
+    request.resp_buf = resp_buf;
+    request.resp_buf_len = resp_buf_len;
+    request.req_cb = req_cb;
+    request.retry_wait_time = 100;
+    request.arg = arg;
+    // 4. 启动请求
+    err = cc_http_request(request);
     if(err != CC_OK){
         cc_hal_sys_free(resp_buf);
         cc_hal_sys_free(request_url);
@@ -302,87 +319,33 @@ cc_err_t cc_http_simple_get(char *url, cc_http_req_cb_t req_cb, void *arg){
     return CC_OK;
 }
 
-void cc_http_run(uint16_t interval){
-    cc_err_t ret = CC_OK;
-
-    cc_list_node *del_node = NULL;
-
-    cc_list_node *node = g_http_list;
-    while(node) {
-        _http_ctx_t *http_ctx = node->data;
-        switch (http_ctx->sta) {
-            case CC_HTTP_STA_IDEL:
-                break;
-            case CC_HTTP_STA_BEGIN:
-                CC_LOGD(TAG, "http_begin url: %s", http_ctx->client->url);
-                http_ctx->retry_cnt = 0;    // 初始化计数器，进入等待网络连接状态
-                http_ctx->wait_tick = 0;
-                http_ctx->sta = CC_HTTP_STA_WAIT_NETCONN;
-                break;
-            case CC_HTTP_STA_RESTART:
-                CC_LOGD(TAG, "http_restart url: %s", http_ctx->client->url);
-                http_ctx->wait_tick = 0;
-                http_ctx->sta = CC_HTTP_STA_WAIT;
-            case CC_HTTP_STA_WAIT:
-                http_ctx->wait_tick = http_ctx->wait_tick + interval;
-                if(http_ctx->wait_tick++ >= http_ctx->retry_wait_time){
-                    http_ctx->sta = CC_HTTP_STA_WAIT_NETCONN;
-                }
-                break;
-            case CC_HTTP_STA_WAIT_NETCONN:  // 等待网络连接就绪
-                // if(cc_wifi_get_connect_status()){
-                    http_ctx->sta = CC_HTTP_STA_START;
-                // }
-                break;
-            case CC_HTTP_STA_START: // 发送HTTP请求
-                http_ctx->retry_cnt++;
-                CC_LOGD(TAG, "http_start cnt: %d url: %s", http_ctx->retry_cnt, http_ctx->client->url);
-                if(http_ctx->retry_cnt < http_ctx->max_retry_cnt){
-                    http_ctx->sta = CC_HTTP_STA_WAIT_CB; // 设置状态为等待回调
-                    ret = cc_hal_http_connect(http_ctx->client); // 发起连接
-                    if(ret != CC_OK){
-                        cc_http_request_t *request = http_ctx->request;
-                        if(request->req_cb){
-                            request->req_cb(request->arg, -1, (uint8_t *)http_ctx->client->resp_buf, 0);
-                        }
-                        http_ctx->sta = CC_HTTP_STA_STOP;
-                    }
-                }else{
-                    cc_http_request_t *request = http_ctx->request;
-                    if(request->req_cb){
-                        request->req_cb(request->arg, -1, (uint8_t *)http_ctx->client->resp_buf, 0);
-                    }
-                    http_ctx->sta = CC_HTTP_STA_STOP;
-                }
-                break;
-            case CC_HTTP_STA_WAIT_CB:
-                
-                break;
-            case CC_HTTP_STA_STOP:
-                CC_LOGD(TAG, "http_stop url: %s", http_ctx->client->url);
-                cc_hal_sys_free(http_ctx->client);
-                if(http_ctx->request->auto_free){
-                    cc_hal_sys_free(http_ctx->request->url);
-                    if(http_ctx->request->header && (http_ctx->request->header != (char *)CC_HTTP_HEADER_CONNECT_TXT && http_ctx->request->header != (char *)CC_HTTP_HEADER_CONNECT_JSON)){
-                        cc_hal_sys_free(http_ctx->request->header);
-                    }
-                    if(http_ctx->request->post_buf){
-                        cc_hal_sys_free(http_ctx->request->post_buf);
-                    }
-                    if(http_ctx->request->resp_buf){
-                        cc_hal_sys_free(http_ctx->request->resp_buf);
-                    }
-                }
-                cc_hal_sys_free(http_ctx->request);
-                cc_hal_sys_free(http_ctx);
-                del_node = node;
-                node = node->next;
-                cc_list_remove(&g_http_list, del_node);
-                continue;
-            default:
-                break;
+cc_err_t cc_http_init(void){
+    if(NULL != g_semphr_handle){
+        return CC_OK;
+    }
+
+    if(CC_OK != cc_hal_http_init()){
+        return CC_FAIL;
+    }
+
+    for(int i = 0; i < CC_HTTP_CTX_MAX; i++){
+        cc_timer_config_t config = {
+            .type = CC_TIMER_TYPE_SW,
+            .callback = __retry_timer_cb,
+            .arg = &g_http_ctx[i],
+        };
+        g_http_ctx[i].retry_timer = cc_timer_create(&config);
+        if(NULL == g_http_ctx[i].retry_timer){
+            CC_LOGE(TAG, "retry timer create error");
+            return CC_FAIL;
         }
+    }
 
-        node = node->next;
+    g_semphr_handle = cc_hal_os_semphr_create_mutex_static(&g_semphr_buf);
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "semphr create error");
+        return CC_FAIL;
     }
-}   
\ No newline at end of file
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return CC_OK;
+}
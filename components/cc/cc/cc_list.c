@@ -10,13 +10,48 @@
 #include "cc_list.h"
 #include "cc_hal_sys.h"
 
+/* Nodes of the legacy list come from a small static pool first and only
+ * fall back to the heap when it is exhausted.
+ */
+#define CC_LIST_POOL_NODES	32
+
+CC_POOL_DEFINE(g_node_pool, sizeof(cc_list_node), CC_LIST_POOL_NODES);
+static cc_os_spinlock_t g_node_pool_init_lock = CC_OS_SPINLOCK_INIT;
+static bool g_node_pool_ready = false;
+
+static cc_list_node* __node_alloc(void)
+{
+	if (!g_node_pool_ready) {
+		cc_hal_os_enter_critical(&g_node_pool_init_lock);
+		if (!g_node_pool_ready) {
+			cc_pool_init(&g_node_pool, g_node_pool_buf, sizeof(cc_list_node), CC_LIST_POOL_NODES);
+			g_node_pool_ready = true;
+		}
+		cc_hal_os_exit_critical(&g_node_pool_init_lock);
+	}
+	cc_list_node *node = cc_pool_alloc(&g_node_pool);
+	if (node == NULL) {
+		node = cc_hal_sys_malloc_caps(sizeof(cc_list_node), CC_MEM_CAP_INTERNAL, CC_MEM_MOD_LIST);
+	}
+	return node;
+}
+
+static void __node_free(cc_list_node *node)
+{
+	if (cc_pool_owns(&g_node_pool, node)) {
+		cc_pool_free(&g_node_pool, node);
+	} else {
+		cc_hal_sys_free(node);
+	}
+}
+
 /* Creates a list (node) and returns it
  * Arguments: The data the list will contain or NULL to create an empty
  * list/node
  */
 cc_list_node* cc_list_create(void *data)
 {
-	cc_list_node *l = cc_hal_sys_malloc(sizeof(cc_list_node));
+	cc_list_node *l = __node_alloc();
 	if (l != NULL) {
 		l->next = NULL;
 		l->data = data;
@@ -88,14 +123,14 @@ void cc_list_remove(cc_list_node **list, cc_list_node *node)
 
 	if (*list == node) {
 		*list = (*list)->next;
-		cc_hal_sys_free(node);
+		__node_free(node);
 		node = NULL;
 	} else {
 		tmp = *list;
 		while (tmp->next && tmp->next != node) tmp = tmp->next;
 		if (tmp->next) {
 			tmp->next = node->next;
-			cc_hal_sys_free(node);
+			__node_free(node);
 			node = NULL;
 		}
 	}
@@ -146,4 +181,116 @@ cc_list_node* cc_list_find(cc_list_node *list, int(*func)(cc_list_node*,void*),
 		list = list->next;
 	}
 	return list;
-}
\ No newline at end of file
+}
+
+/* Appends a node to the tail of an intrusive list
+ */
+void cc_dlist_push_back(cc_dlist_t *list, cc_dlist_node_t *node)
+{
+	node->next = NULL;
+	node->prev = list->tail;
+	if (list->tail) {
+		list->tail->next = node;
+	} else {
+		list->head = node;
+	}
+	list->tail = node;
+	list->count++;
+}
+
+/* Inserts a node at the head of an intrusive list
+ */
+void cc_dlist_push_front(cc_dlist_t *list, cc_dlist_node_t *node)
+{
+	node->prev = NULL;
+	node->next = list->head;
+	if (list->head) {
+		list->head->prev = node;
+	} else {
+		list->tail = node;
+	}
+	list->head = node;
+	list->count++;
+}
+
+/* Unlinks a node, the node must be in the list
+ */
+void cc_dlist_remove(cc_dlist_t *list, cc_dlist_node_t *node)
+{
+	if (node->prev) {
+		node->prev->next = node->next;
+	} else {
+		list->head = node->next;
+	}
+	if (node->next) {
+		node->next->prev = node->prev;
+	} else {
+		list->tail = node->prev;
+	}
+	node->prev = NULL;
+	node->next = NULL;
+	list->count--;
+}
+
+/* Removes and returns the head node, NULL when empty
+ */
+cc_dlist_node_t* cc_dlist_pop_front(cc_dlist_t *list)
+{
+	cc_dlist_node_t *node = list->head;
+	if (node) {
+		cc_dlist_remove(list, node);
+	}
+	return node;
+}
+
+/* Initializes a pool over buf, which must hold count elements of
+ * CC_POOL_ELEM_SIZE(elem_size) bytes
+ */
+void cc_pool_init(cc_pool_t *pool, void *buf, size_t elem_size, uint16_t count)
+{
+	elem_size = CC_POOL_ELEM_SIZE(elem_size);
+	pool->base = buf;
+	pool->end = pool->base + elem_size * count;
+	pool->elem_size = elem_size;
+	pool->used = 0;
+	pool->free_list = NULL;
+	cc_hal_os_spinlock_init(&pool->lock);
+	for (uint16_t i = count; i > 0; i--) {
+		void **elem = (void **)(pool->base + elem_size * (i - 1));
+		*elem = pool->free_list;
+		pool->free_list = elem;
+	}
+}
+
+/* Takes an element from the pool, NULL when exhausted
+ */
+void* cc_pool_alloc(cc_pool_t *pool)
+{
+	cc_hal_os_enter_critical(&pool->lock);
+	void **elem = pool->free_list;
+	if (elem) {
+		pool->free_list = *elem;
+		pool->used++;
+	}
+	cc_hal_os_exit_critical(&pool->lock);
+	return elem;
+}
+
+/* Returns an element to the pool
+ */
+void cc_pool_free(cc_pool_t *pool, void *elem)
+{
+	if (elem == NULL) return;
+	cc_hal_os_enter_critical(&pool->lock);
+	*(void **)elem = pool->free_list;
+	pool->free_list = elem;
+	pool->used--;
+	cc_hal_os_exit_critical(&pool->lock);
+}
+
+/* Whether elem was allocated from the pool
+ */
+bool cc_pool_owns(const cc_pool_t *pool, const void *elem)
+{
+	return (const uint8_t *)elem >= pool->base && (const uint8_t *)elem < pool->end;
+}
@@ -0,0 +1,71 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-20 18:41:37
+ * @Last Modified time: 2022-03-20 18:41:37
+ */
+
+#include "cc_sched.h"
+
+#include "cc_log.h"
+#include "cc_hal_os.h"
+
+#include "cc_timer.h"
+#include "cc_http.h"
+#include "cc_tmr_task.h"
+
+static char *TAG = "cc_sched";
+
+static cc_os_semphr_handle_t g_wakeup_handle = NULL;
+static cc_os_semphr_buf_t g_wakeup_buf;
+
+cc_err_t cc_sched_init(void){
+    if(NULL != g_wakeup_handle){
+        return CC_OK;
+    }
+    g_wakeup_handle = cc_hal_os_semphr_create_binary_static(&g_wakeup_buf);
+    if(NULL == g_wakeup_handle){
+        CC_LOGE(TAG, "semphr create error");
+        return CC_FAIL;
+    }
+    return CC_OK;
+}
+
+uint32_t cc_sched_next_ms(void){
+    uint32_t next_ms = CC_SCHED_MAX_SLEEP_MS;
+
+    uint64_t timer_us = cc_timer_next_us();
+    if(timer_us != CC_TIMER_NO_DEADLINE && (timer_us + 999) / 1000 < next_ms){
+        next_ms = (uint32_t)((timer_us + 999) / 1000);
+    }
+
+    uint32_t ms = cc_http_next_ms();
+    if(ms < next_ms){
+        next_ms = ms;
+    }
+
+    ms = cc_tmr_task_next_ms();
+    if(ms < next_ms){
+        next_ms = ms;
+    }
+
+    return next_ms;
+}
+
+void cc_sched_wait(uint32_t ms){
+    cc_os_tick_t tick = CC_OS_MS_TO_TICK(ms);
+    if(ms && 0 == tick){
+        // 不足一个系统 tick 时至少睡一个 tick，避免空转
+        tick = 1;
+    }
+    if(NULL == g_wakeup_handle){
+        cc_hal_os_task_delay(tick);
+        return;
+    }
+    cc_hal_os_semphr_take(g_wakeup_handle, tick);
+}
+
+void cc_sched_wakeup(void){
+    if(NULL != g_wakeup_handle){
+        cc_hal_os_semphr_give(g_wakeup_handle);
+    }
+}
@@ -13,40 +13,100 @@
 #include "cc_hal_sys.h"
 #include "cc_hal_os.h"
 
-#include "cc_list.h"
+#include "cc_sched.h"
 
 static char *TAG = "cc_timer";
 
+// 开启 CONFIG_CC_TIMER_ESP_TIMER 时由 cc_timer_hr.c 提供以下接口
+#if !CONFIG_CC_TIMER_ESP_TIMER
+
 #define	CC_TIMER_RELOAD_PERIODIC	1
 #define	CC_TIMER_RELOAD_ONCE	0
 
-typedef struct{
+#define CC_TIMER_MAGIC          0x54494D52
+
+/*
+ * 分层时间轮：精度 CC_TIMER_TICK_US，4 层 × 64 槽，可直接表示约 46 小时，
+ * 更远的定时器先挂在最远处，到期时再重新插入。
+ * 插入/删除 O(1)，每个 tick 只处理当前槽，高层槽在低层转满一圈时下放。
+ */
+#define WHEEL_BITS              6
+#define WHEEL_SIZE              (1 << WHEEL_BITS)
+#define WHEEL_MASK              (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS            4
+#define WHEEL_MAX_TICKS         ((1ULL << (WHEEL_BITS * WHEEL_LEVELS)) - 1)
+
+typedef struct _sw_timer_ctx{
+	uint32_t magic;
 	uint8_t start;
-	uint64_t period_us;
 	uint8_t repeat;
+	uint8_t running;            // 回调执行中
+	uint8_t deleted;            // 回调执行中被删除，回调返回后释放
+	uint64_t period_ticks;
+	uint64_t expire_tick;
 	cc_timer_cb_t cb;
 	void *arg;
-	uint64_t calc_us;
+	struct _sw_timer_ctx *next;
+	struct _sw_timer_ctx **pprev;   // 不为 NULL 表示挂在时间轮上
 }_sw_timer_ctx_t;
 
-static cc_list_node *g_timer_list = NULL;
+static _sw_timer_ctx_t *g_wheel[WHEEL_LEVELS][WHEEL_SIZE];
+static uint64_t g_now_tick = 0;
+static uint64_t g_rem_us = 0;           // 不足一个 tick 的累计时间
+static uint32_t g_armed_cnt = 0;
 static cc_os_semphr_handle_t g_semphr_handle = NULL;
+static cc_os_semphr_buf_t g_semphr_buf;
 static cc_timer_handle_t g_curr_task = NULL;
 
-static int __find_by_handle(cc_list_node* node, void* arg){
+static void __list_add(_sw_timer_ctx_t **head, _sw_timer_ctx_t *ctx){
+    ctx->next = *head;
+    if(ctx->next){
+        ctx->next->pprev = &ctx->next;
+    }
+    ctx->pprev = head;
+    *head = ctx;
+}
 
-    _sw_timer_ctx_t *ctx = node->data;
-    _sw_timer_ctx_t *handle = (_sw_timer_ctx_t *)arg;
-    
-    if(NULL == ctx){
-        return 0; 
+static void __unlink(_sw_timer_ctx_t *ctx){
+    if(NULL == ctx->pprev){
+        return;
+    }
+    *ctx->pprev = ctx->next;
+    if(ctx->next){
+        ctx->next->pprev = ctx->pprev;
     }
+    ctx->next = NULL;
+    ctx->pprev = NULL;
+    g_armed_cnt--;
+}
 
-    if(ctx == handle){
-        return 1; 
+// 按剩余 tick 数选择层与槽
+static void __wheel_insert(_sw_timer_ctx_t *ctx){
+    uint64_t expire = ctx->expire_tick;
+    if(expire - g_now_tick > WHEEL_MAX_TICKS){
+        expire = g_now_tick + WHEEL_MAX_TICKS;
+    }
+    uint64_t delta = expire - g_now_tick;
+    int level = 0;
+    while(level < WHEEL_LEVELS - 1 && delta >= (1ULL << (WHEEL_BITS * (level + 1)))){
+        level++;
     }
+    uint32_t slot = (expire >> (WHEEL_BITS * level)) & WHEEL_MASK;
+    __list_add(&g_wheel[level][slot], ctx);
+    g_armed_cnt++;
+}
+
+static uint64_t __us_to_ticks(uint64_t us){
+    uint64_t ticks = (us + CC_TIMER_TICK_US - 1) / CC_TIMER_TICK_US;
+    return ticks ? ticks : 1;
+}
 
-    return 0;
+static _sw_timer_ctx_t *__check_handle(cc_timer_handle_t timer){
+    _sw_timer_ctx_t *ctx = (_sw_timer_ctx_t *)timer;
+    if(NULL == ctx || ctx->magic != CC_TIMER_MAGIC || ctx->deleted){
+        return NULL;
+    }
+    return ctx;
 }
 
 cc_timer_handle_t cc_timer_create(const cc_timer_config_t* config){
@@ -63,51 +123,26 @@ cc_timer_handle_t cc_timer_create(const cc_timer_config_t* config){
         return NULL;
     }
 
-    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-
-    if(config->type == CC_TIMER_TYPE_SW){
-        sw_ctx = (_sw_timer_ctx_t *)cc_hal_sys_malloc(sizeof(_sw_timer_ctx_t));
-        if (!sw_ctx) {
-            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return NULL;
-        }
-
-        memset(sw_ctx, 0, sizeof(_sw_timer_ctx_t));
-
-        sw_ctx->start = 0;
-        sw_ctx->cb = config->callback;
-        sw_ctx->arg = config->arg;
-        sw_ctx->calc_us = 0;
-
-        if(NULL != g_timer_list){
-            if(NULL == cc_list_insert_end(g_timer_list, sw_ctx)){
-                cc_hal_sys_free(sw_ctx);
-                CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-                cc_hal_os_semphr_give(g_semphr_handle);
-                return NULL;
-            }
-        }else{
-            g_timer_list = cc_list_create(sw_ctx);
-            if(NULL == g_timer_list){
-                cc_hal_sys_free(sw_ctx);
-                CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-                cc_hal_os_semphr_give(g_semphr_handle);
-                return NULL;
-            }
-        }
-    }else{
+    if(config->type != CC_TIMER_TYPE_SW){
         CC_LOGE_CODE(TAG, CC_ERR_NOT_SUPPORTED);
-        cc_hal_os_semphr_give(g_semphr_handle);
         return NULL;
     }
 
-    cc_hal_os_semphr_give(g_semphr_handle);
+    sw_ctx = (_sw_timer_ctx_t *)cc_hal_sys_malloc_caps(sizeof(_sw_timer_ctx_t), CC_MEM_CAP_INTERNAL, CC_MEM_MOD_TIMER);
+    if (!sw_ctx) {
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return NULL;
+    }
+
+    memset(sw_ctx, 0, sizeof(_sw_timer_ctx_t));
+    sw_ctx->magic = CC_TIMER_MAGIC;
+    sw_ctx->cb = config->callback;
+    sw_ctx->arg = config->arg;
+
     return sw_ctx;
 }
 
-cc_err_t cc_timer_start_once(cc_timer_handle_t timer, uint64_t us){
-    cc_list_node *node = NULL;
+static cc_err_t __timer_start(cc_timer_handle_t timer, uint64_t us, uint8_t repeat){
     _sw_timer_ctx_t *sw_ctx = NULL;
 
     if(NULL == g_semphr_handle){
@@ -117,33 +152,34 @@ cc_err_t cc_timer_start_once(cc_timer_handle_t timer, uint64_t us){
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
 
-    if(NULL != g_timer_list){
-        node = cc_list_find(g_timer_list, __find_by_handle, (void *)timer);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
-
-        if(node->data){
-            sw_ctx = (_sw_timer_ctx_t *)node->data;
-            sw_ctx->period_us = us;
-            sw_ctx->repeat = CC_TIMER_RELOAD_ONCE;
-            sw_ctx->calc_us = 0;
-            sw_ctx->start = 1;
-        }
-    }else{
+    sw_ctx = __check_handle(timer);
+    if(NULL == sw_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
         cc_hal_os_semphr_give(g_semphr_handle);
         return CC_ERR_NOT_FOUND;
     }
 
+    __unlink(sw_ctx);
+    sw_ctx->period_ticks = __us_to_ticks(us);
+    sw_ctx->repeat = repeat;
+    sw_ctx->expire_tick = g_now_tick + sw_ctx->period_ticks;
+    sw_ctx->start = 1;
+    __wheel_insert(sw_ctx);
+
     cc_hal_os_semphr_give(g_semphr_handle);
+    cc_sched_wakeup();
     return CC_OK;
 }
 
+cc_err_t cc_timer_start_once(cc_timer_handle_t timer, uint64_t us){
+    return __timer_start(timer, us, CC_TIMER_RELOAD_ONCE);
+}
+
 cc_err_t cc_timer_start_periodic(cc_timer_handle_t timer, uint64_t us){
-    cc_list_node *node = NULL;
+    return __timer_start(timer, us, CC_TIMER_RELOAD_PERIODIC);
+}
+
+cc_err_t cc_timer_stop(cc_timer_handle_t timer){
     _sw_timer_ctx_t *sw_ctx = NULL;
 
     if(NULL == g_semphr_handle){
@@ -152,34 +188,22 @@ cc_err_t cc_timer_start_periodic(cc_timer_handle_t timer, uint64_t us){
     }
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-    
-    if(NULL != g_timer_list){
-        node = cc_list_find(g_timer_list, __find_by_handle, (void *)timer);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
 
-        if(node->data){
-            sw_ctx = (_sw_timer_ctx_t *)node->data;
-            sw_ctx->period_us = us;
-            sw_ctx->repeat = CC_TIMER_RELOAD_PERIODIC;
-            sw_ctx->calc_us = 0;
-            sw_ctx->start = 1;
-        }
-    }else{
+    sw_ctx = __check_handle(timer);
+    if(NULL == sw_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
         cc_hal_os_semphr_give(g_semphr_handle);
         return CC_ERR_NOT_FOUND;
     }
 
+    __unlink(sw_ctx);
+    sw_ctx->start = 0;
+
     cc_hal_os_semphr_give(g_semphr_handle);
     return CC_OK;
 }
 
-cc_err_t cc_timer_stop(cc_timer_handle_t timer){
-    cc_list_node *node = NULL;
+cc_err_t cc_timer_delete(cc_timer_handle_t *timer){
     _sw_timer_ctx_t *sw_ctx = NULL;
 
     if(NULL == g_semphr_handle){
@@ -188,123 +212,170 @@ cc_err_t cc_timer_stop(cc_timer_handle_t timer){
     }
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-    
-    if(NULL != g_timer_list){
-        node = cc_list_find(g_timer_list, __find_by_handle, (void *)timer);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
 
-        if(node->data){
-            sw_ctx = (_sw_timer_ctx_t *)node->data;
-            sw_ctx->start = 0;
-        }
-    }else{
+    if(timer == NULL && g_curr_task != NULL){
+        timer = &g_curr_task;
+    }
+
+    sw_ctx = (NULL != timer) ? __check_handle(*timer) : NULL;
+    if(NULL == sw_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
         cc_hal_os_semphr_give(g_semphr_handle);
         return CC_ERR_NOT_FOUND;
     }
 
+    __unlink(sw_ctx);
+    sw_ctx->start = 0;
+    if(sw_ctx->running){
+        // 在自身回调中删除，由 cc_timer_run 在回调返回后释放
+        sw_ctx->deleted = 1;
+    }else{
+        sw_ctx->magic = 0;
+        cc_hal_sys_free(sw_ctx);
+    }
+
+    *timer = NULL;
+
     cc_hal_os_semphr_give(g_semphr_handle);
     return CC_OK;
+    
 }
 
-cc_err_t cc_timer_delete(cc_timer_handle_t *timer){
-    cc_list_node *node = NULL;
-    
-    if(NULL == g_semphr_handle){
-        CC_LOGE(TAG, "cc timer not init");
-        return CC_FAIL;
+// 低层转满一圈时，把上一层当前槽的定时器重新分配到下层
+static void __wheel_cascade(void){
+    for(int level = 1; level < WHEEL_LEVELS; level++){
+        if(g_now_tick & ((1ULL << (WHEEL_BITS * level)) - 1)){
+            break;
+        }
+        uint32_t slot = (g_now_tick >> (WHEEL_BITS * level)) & WHEEL_MASK;
+        _sw_timer_ctx_t *ctx = g_wheel[level][slot];
+        g_wheel[level][slot] = NULL;
+        while(ctx){
+            _sw_timer_ctx_t *next = ctx->next;
+            ctx->next = NULL;
+            ctx->pprev = NULL;
+            g_armed_cnt--;
+            __wheel_insert(ctx);
+            ctx = next;
+        }
     }
+}
 
-    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+// 处理当前 tick 到期的定时器，调用时持有锁，回调期间释放
+static void __wheel_expire(void){
+    _sw_timer_ctx_t *expired = NULL;
+    uint32_t slot = g_now_tick & WHEEL_MASK;
 
-    if(timer == NULL && g_curr_task != NULL){
-        timer = &g_curr_task;
+    // 先整体摘下当前槽，回调中新启动的定时器不会落进本轮
+    expired = g_wheel[0][slot];
+    g_wheel[0][slot] = NULL;
+    if(expired){
+        expired->pprev = &expired;
     }
 
-    if(NULL != g_timer_list){
-        node = cc_list_find(g_timer_list, __find_by_handle, (void *)*timer);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
+    while(expired){
+        _sw_timer_ctx_t *sw_ctx = expired;
+        __unlink(sw_ctx);
+
+        if(sw_ctx->expire_tick > g_now_tick){
+            // 超出时间轮范围的定时器，重新插入
+            __wheel_insert(sw_ctx);
+            continue;
         }
 
-        if(node->data){
-            cc_hal_sys_free(node->data);
+        g_curr_task = sw_ctx;
+        sw_ctx->running = 1;
+        cc_hal_os_semphr_give(g_semphr_handle);
+        if(sw_ctx->cb){
+            sw_ctx->cb(sw_ctx->arg);
+        }
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        sw_ctx->running = 0;
+        g_curr_task = NULL;
+
+        if(sw_ctx->deleted){
+            sw_ctx->magic = 0;
+            cc_hal_sys_free(sw_ctx);
+        }else if(sw_ctx->start && NULL == sw_ctx->pprev){
+            // 回调中没有被重新启动或停止
+            if(sw_ctx->repeat){
+                sw_ctx->expire_tick += sw_ctx->period_ticks;
+                if(sw_ctx->expire_tick <= g_now_tick){
+                    sw_ctx->expire_tick = g_now_tick + sw_ctx->period_ticks;
+                }
+                __wheel_insert(sw_ctx);
+            }else{
+                sw_ctx->start = 0;
+            }
         }
+    }
+}
 
-        *timer = NULL;
+void cc_timer_run(uint64_t us){
 
-        cc_list_remove(&g_timer_list, node);
-    }else{
-        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-        cc_hal_os_semphr_give(g_semphr_handle);
-        return CC_ERR_NOT_FOUND;
+    if(NULL == g_semphr_handle){
+        return;
     }
 
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    g_rem_us += us;
+    while(g_rem_us >= CC_TIMER_TICK_US){
+        g_rem_us -= CC_TIMER_TICK_US;
+        if(0 == g_armed_cnt){
+            // 没有定时器，直接跳过剩余时间
+            g_now_tick += g_rem_us / CC_TIMER_TICK_US + 1;
+            g_rem_us %= CC_TIMER_TICK_US;
+            break;
+        }
+        g_now_tick++;
+        __wheel_cascade();
+        __wheel_expire();
+    }
     cc_hal_os_semphr_give(g_semphr_handle);
-    return CC_OK;
-    
 }
 
-void cc_timer_run(uint64_t us){
+uint64_t cc_timer_next_us(void){
 
-    cc_list_node *node = NULL;
-    cc_list_node *last_node = NULL;
+    uint64_t next_tick = UINT64_MAX;
 
     if(NULL == g_semphr_handle){
-        return;
+        return CC_TIMER_NO_DEADLINE;
     }
 
-    node = g_timer_list;
-    while(node){
-        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-        _sw_timer_ctx_t *sw_ctx = node->data;
-        if(NULL != sw_ctx){
-            sw_ctx->calc_us += us;
-            if (sw_ctx->start && sw_ctx->calc_us >= sw_ctx->period_us) {
-                g_curr_task = sw_ctx;
-                cc_hal_os_semphr_give(g_semphr_handle);
-                if(sw_ctx->cb){
-				    sw_ctx->cb(sw_ctx->arg);
-                }
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    if(0 == g_armed_cnt){
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_TIMER_NO_DEADLINE;
+    }
 
-                cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-                g_curr_task = NULL;
-                if(cc_list_find_node(g_timer_list, node)){
-                    // sw_ctx->calc_us -= sw_ctx->period_us;
-                    sw_ctx->calc_us %= sw_ctx->period_us;
-                    if(!sw_ctx->repeat){
-                        sw_ctx->start = 0;
-                    }
-                    last_node = node;
-                    node = node->next;
-                }else{
-                    // CC_LOGW(TAG, "curr timer is delete");
-                    if(last_node){
-                        node = last_node->next;
-                    }else{
-                        node = NULL;
-                    }
+    // 每层找最近的非空槽：第 0 层即到期时间，高层为下放时间（不晚于其中定时器的到期时间）
+    for(int level = 0; level < WHEEL_LEVELS; level++){
+        uint32_t shift = WHEEL_BITS * level;
+        uint64_t block = g_now_tick >> shift;
+        for(uint32_t k = 1; k <= WHEEL_SIZE; k++){
+            if(g_wheel[level][(block + k) & WHEEL_MASK]){
+                uint64_t tick = (block + k) << shift;
+                if(tick < next_tick){
+                    next_tick = tick;
                 }
-            }else{
-                last_node = node;
-                node = node->next;
+                break;
             }
-        }else{
-            last_node = node;
-            node = node->next;
         }
+    }
+    if(UINT64_MAX == next_tick){
         cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_TIMER_NO_DEADLINE;
     }
+    uint64_t ticks = next_tick - g_now_tick;
+    uint64_t rem_us = g_rem_us;
+    cc_hal_os_semphr_give(g_semphr_handle);
+
+    uint64_t us = ticks * CC_TIMER_TICK_US;
+    return (us > rem_us) ? us - rem_us : 0;
 }
 
 cc_err_t cc_timer_init(void){
-    g_semphr_handle = cc_hal_os_semphr_create_mutex();
+    g_semphr_handle = cc_hal_os_semphr_create_mutex_static(&g_semphr_buf);
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "semphr create error");
         return CC_FAIL;
@@ -313,6 +384,8 @@ cc_err_t cc_timer_init(void){
     return CC_OK;
 }
 
+#endif // !CONFIG_CC_TIMER_ESP_TIMER
+
 static void _simple_one_timer_cb(void *arg){
     cc_timer_config_t *config = (cc_timer_config_t *)arg;
     if(NULL != config->callback){
@@ -325,7 +398,7 @@ cc_err_t cc_timer_simple_one(cc_timer_type_t type, cc_timer_cb_t callback, uint6
 
     cc_timer_config_t one_config = {0};
 
-    cc_timer_config_t *cp_config =  cc_hal_sys_malloc(sizeof(cc_timer_config_t));
+    cc_timer_config_t *cp_config =  cc_hal_sys_malloc_caps(sizeof(cc_timer_config_t), CC_MEM_CAP_INTERNAL, CC_MEM_MOD_TIMER);
     if(NULL == cp_config ){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
         return CC_ERR_NO_MEM;
@@ -0,0 +1,386 @@
+/*
+ * cc_timer 的 esp_timer 后端（CONFIG_CC_TIMER_ESP_TIMER），接口与 cc_timer.c 的时间轮相同。
+ *
+ * 每个定时器对应一个 esp_timer。到期时 esp_timer 任务只把定时器挂到待执行链表并唤醒调度任务，
+ * 回调仍由 cc_timer_run() 在网络任务中执行，执行上下文与时间轮后端一致；
+ * 触发时间由 esp_timer 决定，不再按 CC_TIMER_TICK_US 取整，也不受网络任务循环耗时的影响。
+ */
+
+#include "cc_timer.h"
+
+#include <string.h>
+
+#include "cc_log.h"
+
+#include "cc_hal_sys.h"
+#include "cc_hal_os.h"
+
+#include "cc_sched.h"
+
+#if CONFIG_CC_TIMER_ESP_TIMER
+
+#include "esp_timer.h"
+
+static char *TAG = "cc_timer";
+
+#define CC_TIMER_MAGIC          0x54494D52
+
+typedef struct _hr_timer_ctx{
+	uint32_t magic;
+	uint32_t id;                // esp_timer 回调的参数，回调按 id 查找，不解引用可能已释放的指针
+	uint8_t start;
+	uint8_t repeat;
+	uint8_t pending;            // 已到期，在待执行链表中
+	uint8_t running;            // 回调执行中
+	uint8_t deleted;            // 回调执行中被删除，回调返回后释放
+	int64_t due_us;             // 本次启动后第一次到期的时间，早于它的到期通知属于上一次启动
+	esp_timer_handle_t timer;
+	cc_timer_cb_t cb;
+	void *arg;
+	struct _hr_timer_ctx *live_next;
+	struct _hr_timer_ctx *pending_next;
+}_hr_timer_ctx_t;
+
+// 以下几项在 esp_timer 回调中也会访问，由 g_hr_lock 保护
+static _hr_timer_ctx_t *g_live = NULL;          // 所有未删除的定时器
+static _hr_timer_ctx_t *g_pending_head = NULL;
+static _hr_timer_ctx_t *g_pending_tail = NULL;
+static uint32_t g_pending_cnt = 0;
+static uint32_t g_next_id = 1;
+static cc_os_spinlock_t g_hr_lock = CC_OS_SPINLOCK_INIT;
+
+static cc_os_semphr_handle_t g_semphr_handle = NULL;
+static cc_os_semphr_buf_t g_semphr_buf;
+static cc_timer_handle_t g_curr_task = NULL;
+
+// 在 esp_timer 任务中执行
+static void __esp_timer_cb(void *arg){
+    uint32_t id = (uint32_t)(uintptr_t)arg;
+    uint8_t wake = 0;
+
+    cc_hal_os_enter_critical(&g_hr_lock);
+    _hr_timer_ctx_t *ctx = g_live;
+    while(ctx && ctx->id != id){
+        ctx = ctx->live_next;
+    }
+    if(ctx && ctx->start && !ctx->pending && esp_timer_get_time() >= ctx->due_us){
+        ctx->pending = 1;
+        ctx->pending_next = NULL;
+        if(g_pending_tail){
+            g_pending_tail->pending_next = ctx;
+        }else{
+            g_pending_head = ctx;
+        }
+        g_pending_tail = ctx;
+        g_pending_cnt++;
+        wake = 1;
+    }
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    if(wake){
+        cc_sched_wakeup();
+    }
+}
+
+// 调用时持有 g_hr_lock
+static void __pending_remove(_hr_timer_ctx_t *ctx){
+    if(!ctx->pending){
+        return;
+    }
+    _hr_timer_ctx_t *prev = NULL;
+    _hr_timer_ctx_t *it = g_pending_head;
+    while(it && it != ctx){
+        prev = it;
+        it = it->pending_next;
+    }
+    if(it){
+        if(prev){
+            prev->pending_next = ctx->pending_next;
+        }else{
+            g_pending_head = ctx->pending_next;
+        }
+        if(g_pending_tail == ctx){
+            g_pending_tail = prev;
+        }
+        g_pending_cnt--;
+    }
+    ctx->pending = 0;
+    ctx->pending_next = NULL;
+}
+
+static _hr_timer_ctx_t *__check_handle(cc_timer_handle_t timer){
+    _hr_timer_ctx_t *ctx = (_hr_timer_ctx_t *)timer;
+    if(NULL == ctx || ctx->magic != CC_TIMER_MAGIC || ctx->deleted){
+        return NULL;
+    }
+    return ctx;
+}
+
+cc_timer_handle_t cc_timer_create(const cc_timer_config_t* config){
+
+    _hr_timer_ctx_t *hr_ctx = NULL;
+
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "cc timer not init");
+        return NULL;
+    }
+
+    if(NULL == config){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+        return NULL;
+    }
+
+    if(config->type != CC_TIMER_TYPE_SW){
+        CC_LOGE_CODE(TAG, CC_ERR_NOT_SUPPORTED);
+        return NULL;
+    }
+
+    hr_ctx = (_hr_timer_ctx_t *)cc_hal_sys_malloc_caps(sizeof(_hr_timer_ctx_t), CC_MEM_CAP_INTERNAL, CC_MEM_MOD_TIMER);
+    if (!hr_ctx) {
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return NULL;
+    }
+
+    memset(hr_ctx, 0, sizeof(_hr_timer_ctx_t));
+    hr_ctx->magic = CC_TIMER_MAGIC;
+    hr_ctx->cb = config->callback;
+    hr_ctx->arg = config->arg;
+
+    cc_hal_os_enter_critical(&g_hr_lock);
+    hr_ctx->id = g_next_id++;
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    esp_timer_create_args_t args = {
+        .callback = __esp_timer_cb,
+        .arg = (void *)(uintptr_t)hr_ctx->id,
+        .dispatch_method = ESP_TIMER_TASK,
+        .name = "cc_timer",
+        // 网络任务来不及处理时，周期定时器的多次到期合并为一次，与时间轮后端一致
+        .skip_unhandled_events = true,
+    };
+    if(esp_timer_create(&args, &hr_ctx->timer) != ESP_OK){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        hr_ctx->magic = 0;
+        cc_hal_sys_free(hr_ctx);
+        return NULL;
+    }
+
+    cc_hal_os_enter_critical(&g_hr_lock);
+    hr_ctx->live_next = g_live;
+    g_live = hr_ctx;
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    return hr_ctx;
+}
+
+static cc_err_t __timer_start(cc_timer_handle_t timer, uint64_t us, uint8_t repeat){
+    _hr_timer_ctx_t *hr_ctx = NULL;
+
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "cc timer not init");
+        return CC_FAIL;
+    }
+
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+
+    hr_ctx = __check_handle(timer);
+    if(NULL == hr_ctx){
+        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_ERR_NOT_FOUND;
+    }
+
+    if(0 == us){
+        us = 1;
+    }
+    // 未启动时返回 ESP_ERR_INVALID_STATE，忽略
+    esp_timer_stop(hr_ctx->timer);
+
+    cc_hal_os_enter_critical(&g_hr_lock);
+    __pending_remove(hr_ctx);
+    hr_ctx->repeat = repeat;
+    hr_ctx->start = 1;
+    hr_ctx->due_us = esp_timer_get_time() + (int64_t)us;
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    esp_err_t err = repeat ? esp_timer_start_periodic(hr_ctx->timer, us) : esp_timer_start_once(hr_ctx->timer, us);
+    if(err != ESP_OK){
+        CC_LOGE(TAG, "esp_timer start error %d", err);
+        cc_hal_os_enter_critical(&g_hr_lock);
+        hr_ctx->start = 0;
+        cc_hal_os_exit_critical(&g_hr_lock);
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_FAIL;
+    }
+
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return CC_OK;
+}
+
+cc_err_t cc_timer_start_once(cc_timer_handle_t timer, uint64_t us){
+    return __timer_start(timer, us, 0);
+}
+
+cc_err_t cc_timer_start_periodic(cc_timer_handle_t timer, uint64_t us){
+    return __timer_start(timer, us, 1);
+}
+
+cc_err_t cc_timer_stop(cc_timer_handle_t timer){
+    _hr_timer_ctx_t *hr_ctx = NULL;
+
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "cc timer not init");
+        return CC_FAIL;
+    }
+
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+
+    hr_ctx = __check_handle(timer);
+    if(NULL == hr_ctx){
+        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_ERR_NOT_FOUND;
+    }
+
+    esp_timer_stop(hr_ctx->timer);
+    cc_hal_os_enter_critical(&g_hr_lock);
+    hr_ctx->start = 0;
+    __pending_remove(hr_ctx);
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return CC_OK;
+}
+
+cc_err_t cc_timer_delete(cc_timer_handle_t *timer){
+    _hr_timer_ctx_t *hr_ctx = NULL;
+
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "cc timer not init");
+        return CC_FAIL;
+    }
+
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+
+    if(timer == NULL && g_curr_task != NULL){
+        timer = &g_curr_task;
+    }
+
+    hr_ctx = (NULL != timer) ? __check_handle(*timer) : NULL;
+    if(NULL == hr_ctx){
+        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+        cc_hal_os_semphr_give(g_semphr_handle);
+        return CC_ERR_NOT_FOUND;
+    }
+
+    esp_timer_stop(hr_ctx->timer);
+    esp_timer_delete(hr_ctx->timer);
+    hr_ctx->timer = NULL;
+
+    // 移出 g_live 后，正在分发的到期通知找不到这个 id，之后可以安全释放
+    cc_hal_os_enter_critical(&g_hr_lock);
+    hr_ctx->start = 0;
+    __pending_remove(hr_ctx);
+    _hr_timer_ctx_t **pp = &g_live;
+    while(*pp && *pp != hr_ctx){
+        pp = &(*pp)->live_next;
+    }
+    if(*pp){
+        *pp = hr_ctx->live_next;
+    }
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    if(hr_ctx->running){
+        // 在自身回调中删除，由 cc_timer_run 在回调返回后释放
+        hr_ctx->deleted = 1;
+    }else{
+        hr_ctx->magic = 0;
+        cc_hal_sys_free(hr_ctx);
+    }
+
+    *timer = NULL;
+
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return CC_OK;
+}
+
+void cc_timer_run(uint64_t us){
+
+    // 到期时间由 esp_timer 决定，这里只执行已到期的回调
+    (void)us;
+
+    if(NULL == g_semphr_handle){
+        return;
+    }
+
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+
+    // 只处理进入时已到期的定时器，回调中以 0 重新启动的定时器留到下一轮
+    cc_hal_os_enter_critical(&g_hr_lock);
+    uint32_t n = g_pending_cnt;
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    while(n--){
+        cc_hal_os_enter_critical(&g_hr_lock);
+        _hr_timer_ctx_t *hr_ctx = g_pending_head;
+        if(hr_ctx){
+            g_pending_head = hr_ctx->pending_next;
+            if(NULL == g_pending_head){
+                g_pending_tail = NULL;
+            }
+            g_pending_cnt--;
+            hr_ctx->pending = 0;
+            hr_ctx->pending_next = NULL;
+            if(!hr_ctx->repeat){
+                // 回调中可以重新启动
+                hr_ctx->start = 0;
+            }
+        }
+        cc_hal_os_exit_critical(&g_hr_lock);
+        if(NULL == hr_ctx){
+            break;
+        }
+
+        g_curr_task = hr_ctx;
+        hr_ctx->running = 1;
+        cc_hal_os_semphr_give(g_semphr_handle);
+        if(hr_ctx->cb){
+            hr_ctx->cb(hr_ctx->arg);
+        }
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        hr_ctx->running = 0;
+        g_curr_task = NULL;
+
+        if(hr_ctx->deleted){
+            hr_ctx->magic = 0;
+            cc_hal_sys_free(hr_ctx);
+        }
+    }
+
+    cc_hal_os_semphr_give(g_semphr_handle);
+}
+
+uint64_t cc_timer_next_us(void){
+
+    // 未到期的定时器到期时由 esp_timer 回调唤醒调度任务，不需要按截止时间醒来
+    cc_hal_os_enter_critical(&g_hr_lock);
+    uint32_t pending = g_pending_cnt;
+    cc_hal_os_exit_critical(&g_hr_lock);
+
+    return pending ? 0 : CC_TIMER_NO_DEADLINE;
+}
+
+cc_err_t cc_timer_init(void){
+    if(NULL != g_semphr_handle){
+        return CC_OK;
+    }
+    g_semphr_handle = cc_hal_os_semphr_create_mutex_static(&g_semphr_buf);
+    if(NULL == g_semphr_handle){
+        CC_LOGE(TAG, "semphr create error");
+        return CC_FAIL;
+    }
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return CC_OK;
+}
+
+#endif
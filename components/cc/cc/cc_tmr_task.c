@@ -7,45 +7,65 @@
 #include "cc_tmr_task.h"
 
 #include "cc_log.h"
-#include "cc_list.h"
 #include "cc_hal_os.h"
 #include "cc_hal_sys.h"
+#include "cc_sched.h"
 
 #include <string.h>
 
 static char *TAG = "cc_tmr_task";
 
+/*
+ * 任务上下文放在固定大小的槽位数组中，句柄 = (generation << 8) | (index + 1)。
+ * 删除时递增 generation，旧句柄随即失效，槽位可以立即复用；
+ * cc_tmr_task_run 在回调返回后比较 generation 即可知道任务是否已被删除，无需重新查找。
+ */
+#define CC_TMR_TASK_INDEX(handle)       (((handle) & 0xFF) - 1)
+#define CC_TMR_TASK_GEN(handle)         ((handle) >> 8)
+#define CC_TMR_TASK_MAKE(gen, index)    (((uint32_t)(gen) << 8) | ((index) + 1))
+
 typedef struct{
 	uint8_t start;
+	uint32_t gen;
 	uint64_t interval_tick;
 	cc_tmr_task_t task;
 	void *arg;
 	uint64_t calc_tick;
 }_task_ctx_t;
 
-static cc_list_node *g_task_list = NULL;
+static _task_ctx_t g_task_slab[CC_TMR_TASK_MAX];
+static uint32_t g_used_mask = 0;
 static cc_os_semphr_handle_t g_semphr_handle = NULL;
-static cc_tmr_task_t g_curr_task = NULL;
+static cc_os_semphr_buf_t g_semphr_buf;
+static cc_tmr_task_handle_t g_curr_task = CC_TMR_TASK_INVALID;
 
-int __find_by_task(cc_list_node* node, void* arg){
+static _task_ctx_t *__get_by_handle(cc_tmr_task_handle_t handle){
+    uint32_t index = CC_TMR_TASK_INDEX(handle);
 
-    _task_ctx_t *ctx = node->data;
-    cc_tmr_task_t task = (cc_tmr_task_t)arg;
-    
-    if(NULL == ctx){
-        return 0; 
+    if(handle == CC_TMR_TASK_INVALID || index >= CC_TMR_TASK_MAX){
+        return NULL;
     }
-
-    if(ctx->task == task){
-        return 1; 
+    if(!(g_used_mask & (1UL << index)) || g_task_slab[index].gen != CC_TMR_TASK_GEN(handle)){
+        return NULL;
     }
-
-    return 0;
+    return &g_task_slab[index];
 }
 
+// 兼容按函数指针操作的旧接口：在已用槽位中查找（槽位数很少）
+static cc_tmr_task_handle_t __find_by_task(cc_tmr_task_t task){
+    uint32_t mask = g_used_mask;
+    while(mask){
+        uint32_t index = __builtin_ctz(mask);
+        mask &= mask - 1;
+        if(g_task_slab[index].task == task){
+            return CC_TMR_TASK_MAKE(g_task_slab[index].gen, index);
+        }
+    }
+    return CC_TMR_TASK_INVALID;
+}
 
 cc_err_t cc_tmr_task_init(void){
-    g_semphr_handle = cc_hal_os_semphr_create_mutex();
+    g_semphr_handle = cc_hal_os_semphr_create_mutex_static(&g_semphr_buf);
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "semphr create error");
         return CC_FAIL;
@@ -55,103 +75,111 @@ cc_err_t cc_tmr_task_init(void){
 }
 
 void cc_tmr_task_run(uint16_t interval){
-    cc_list_node *node = NULL;
-    cc_list_node *last_node = NULL;
 
-    if(NULL == g_task_list){
+    if(NULL == g_semphr_handle){
         return;
     }
 
-    node = g_task_list;
-    while(node){
-        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-        _task_ctx_t *task_ctx = node->data;
-        if(NULL != task_ctx){
-            task_ctx->calc_tick += interval;
-            if (task_ctx->start && task_ctx->calc_tick >= task_ctx->interval_tick) {
-                cc_hal_os_semphr_give(g_semphr_handle);
-                g_curr_task = task_ctx->task;
-                if(task_ctx->task){
-				    task_ctx->task(task_ctx->interval_tick, task_ctx->arg);
-                }
-                g_curr_task = NULL;
-
-                cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-                if(cc_list_find_node(g_task_list, node)){
-                    task_ctx->calc_tick = 0;
-                    last_node = node;
-                    node = node->next;
-                }else{
-                    // is delete
-                    // CC_LOGW(TAG, "curr task is delete");
-                    if(last_node){
-                        node = last_node->next;
-                    }else{
-                        node = NULL;
-                    }
-                }
-            }else{
-                last_node = node;
-                node = node->next;
-            }
-        }else{
-            last_node = node;
-            node = node->next;
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    // 本轮开始时的快照，回调中新建的任务下一轮再计时
+    uint32_t mask = g_used_mask;
+    while(mask){
+        uint32_t index = __builtin_ctz(mask);
+        mask &= mask - 1;
+
+        _task_ctx_t *task_ctx = &g_task_slab[index];
+        if(!(g_used_mask & (1UL << index))){
+            // 已被前面的回调删除
+            continue;
+        }
+        task_ctx->calc_tick += interval;
+        if (!task_ctx->start || task_ctx->calc_tick < task_ctx->interval_tick) {
+            continue;
         }
+
+        uint32_t gen = task_ctx->gen;
+        cc_tmr_task_t task = task_ctx->task;
+        void *arg = task_ctx->arg;
+        uint32_t interval_tick = task_ctx->interval_tick;
+        g_curr_task = CC_TMR_TASK_MAKE(gen, index);
         cc_hal_os_semphr_give(g_semphr_handle);
+
+        if(task){
+            task(interval_tick, arg);
+        }
+
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        g_curr_task = CC_TMR_TASK_INVALID;
+        if((g_used_mask & (1UL << index)) && task_ctx->gen == gen){
+            task_ctx->calc_tick = 0;
+        }
     }
+    cc_hal_os_semphr_give(g_semphr_handle);
 }
 
-cc_err_t cc_tmr_task_create(cc_tmr_task_t task, uint32_t interval, void *arg){
+uint32_t cc_tmr_task_next_ms(void){
+    uint32_t next_ms = UINT32_MAX;
+
+    if(NULL == g_semphr_handle){
+        return next_ms;
+    }
+
+    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+    uint32_t mask = g_used_mask;
+    while(mask){
+        _task_ctx_t *task_ctx = &g_task_slab[__builtin_ctz(mask)];
+        mask &= mask - 1;
+        if(!task_ctx->start){
+            continue;
+        }
+        uint64_t ms = (task_ctx->calc_tick < task_ctx->interval_tick) ? task_ctx->interval_tick - task_ctx->calc_tick : 0;
+        if(ms < next_ms){
+            next_ms = (uint32_t)ms;
+        }
+    }
+    cc_hal_os_semphr_give(g_semphr_handle);
+    return next_ms;
+}
+
+cc_tmr_task_handle_t cc_tmr_task_create_handle(cc_tmr_task_t task, uint32_t interval, void *arg){
     _task_ctx_t *task_ctx = NULL;
 
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "cc timer not init");
-        return CC_FAIL;
+        return CC_TMR_TASK_INVALID;
     }
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
 
-    task_ctx = (_task_ctx_t *)cc_hal_sys_malloc(sizeof(_task_ctx_t));
-    if (!task_ctx) {
+    uint32_t free_mask = ~g_used_mask & ((CC_TMR_TASK_MAX < 32) ? ((1UL << CC_TMR_TASK_MAX) - 1) : UINT32_MAX);
+    if(0 == free_mask){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
         cc_hal_os_semphr_give(g_semphr_handle);
-        return CC_ERR_NO_MEM;
+        return CC_TMR_TASK_INVALID;
     }
 
+    uint32_t index = __builtin_ctz(free_mask);
+    task_ctx = &g_task_slab[index];
+    uint32_t gen = (task_ctx->gen + 1) & 0xFFFFFF;
+
     memset(task_ctx, 0, sizeof(_task_ctx_t));
 
     task_ctx->start = 1;
+    task_ctx->gen = gen;
     task_ctx->task = task;
     task_ctx->interval_tick = interval;
     task_ctx->arg = arg;
     task_ctx->calc_tick = 0;
-
-    if(NULL != g_task_list){
-        if(NULL == cc_list_insert_end(g_task_list, task_ctx)){
-            cc_hal_sys_free(task_ctx);
-            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NO_MEM;
-        }
-    }else{
-        g_task_list = cc_list_create(task_ctx);
-        if(NULL == g_task_list){
-            cc_hal_sys_free(task_ctx);
-            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NO_MEM;
-        }
-    }
-   
+    g_used_mask |= 1UL << index;
 
     cc_hal_os_semphr_give(g_semphr_handle);
-    return CC_OK;
+    cc_sched_wakeup();
+    return CC_TMR_TASK_MAKE(gen, index);
 }
 
-cc_err_t cc_tmr_task_delete(cc_tmr_task_t task){
-    cc_list_node *node = NULL;
-    
+cc_err_t cc_tmr_task_delete_handle(cc_tmr_task_handle_t handle){
+    _task_ctx_t *task_ctx = NULL;
+
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "cc timer not init");
         return CC_FAIL;
@@ -159,101 +187,58 @@ cc_err_t cc_tmr_task_delete(cc_tmr_task_t task){
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
 
-    if(task == NULL){
-        task = g_curr_task;
-    }
-
-    if(NULL != g_task_list){
-        node = cc_list_find(g_task_list, __find_by_task, (void *)task);
-        if(NULL == node){
-            // CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
-
-        if(node->data){
-            cc_hal_sys_free(node->data);
-        }
-
-        cc_list_remove(&g_task_list, node);
-    }else{
-        // CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+    task_ctx = __get_by_handle(handle);
+    if(NULL == task_ctx){
         cc_hal_os_semphr_give(g_semphr_handle);
         return CC_ERR_NOT_FOUND;
     }
 
+    // generation 在下次分配时递增，这里清除占用位即可让旧句柄失效
+    g_used_mask &= ~(1UL << CC_TMR_TASK_INDEX(handle));
+    task_ctx->start = 0;
+    task_ctx->task = NULL;
+
     cc_hal_os_semphr_give(g_semphr_handle);
     return CC_OK;
 }
 
-cc_err_t cc_tmr_task_set_interval(cc_tmr_task_t task, uint32_t interval){
-    cc_list_node *node = NULL;
-    _task_ctx_t *task_ctx = NULL;
+cc_tmr_task_handle_t cc_tmr_task_current(void){
+    return g_curr_task;
+}
 
+cc_err_t cc_tmr_task_create(cc_tmr_task_t task, uint32_t interval, void *arg){
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "cc timer not init");
         return CC_FAIL;
     }
-
-    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-
-    if(NULL != g_task_list){
-        node = cc_list_find(g_task_list, __find_by_task, (void *)task);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
-
-        if(node->data){
-            task_ctx = (_task_ctx_t *)node->data;
-            task_ctx->interval_tick = interval;
-        }
-    }else{
-        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-        cc_hal_os_semphr_give(g_semphr_handle);
-        return CC_ERR_NOT_FOUND;
-    }
-
-    cc_hal_os_semphr_give(g_semphr_handle);
-    return CC_OK;
+    return (CC_TMR_TASK_INVALID != cc_tmr_task_create_handle(task, interval, arg)) ? CC_OK : CC_ERR_NO_MEM;
 }
 
-cc_err_t cc_tmr_task_stop(cc_tmr_task_t task){
-    cc_list_node *node = NULL;
-    _task_ctx_t *task_ctx = NULL;
+cc_err_t cc_tmr_task_delete(cc_tmr_task_t task){
+    cc_tmr_task_handle_t handle = CC_TMR_TASK_INVALID;
 
     if(NULL == g_semphr_handle){
         CC_LOGE(TAG, "cc timer not init");
         return CC_FAIL;
     }
 
-    cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
-
-    if(NULL != g_task_list){
-        node = cc_list_find(g_task_list, __find_by_task, (void *)task);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
-
-        if(node->data){
-            task_ctx = (_task_ctx_t *)node->data;
-            task_ctx->start = 0;
-        }
+    if(task == NULL){
+        handle = g_curr_task;
     }else{
-        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+        cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
+        // 在自身回调中删除时直接用当前句柄
+        if(g_curr_task != CC_TMR_TASK_INVALID && g_task_slab[CC_TMR_TASK_INDEX(g_curr_task)].task == task){
+            handle = g_curr_task;
+        }else{
+            handle = __find_by_task(task);
+        }
         cc_hal_os_semphr_give(g_semphr_handle);
-        return CC_ERR_NOT_FOUND;
     }
 
-    cc_hal_os_semphr_give(g_semphr_handle);
-    return CC_OK;
+    return cc_tmr_task_delete_handle(handle);
 }
 
-cc_err_t cc_tmr_task_continue(cc_tmr_task_t task){
-    cc_list_node *node = NULL;
+static cc_err_t __update_by_task(cc_tmr_task_t task, int start, int64_t interval){
     _task_ctx_t *task_ctx = NULL;
 
     if(NULL == g_semphr_handle){
@@ -263,24 +248,35 @@ cc_err_t cc_tmr_task_continue(cc_tmr_task_t task){
 
     cc_hal_os_semphr_take(g_semphr_handle, CC_OS_MAX_DELAY);
 
-    if(NULL != g_task_list){
-        node = cc_list_find(g_task_list, __find_by_task, (void *)task);
-        if(NULL == node){
-            CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
-            cc_hal_os_semphr_give(g_semphr_handle);
-            return CC_ERR_NOT_FOUND;
-        }
-
-        if(node->data){
-            task_ctx = (_task_ctx_t *)node->data;
-            task_ctx->start = 1;
-        }
-    }else{
+    task_ctx = __get_by_handle(__find_by_task(task));
+    if(NULL == task_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
         cc_hal_os_semphr_give(g_semphr_handle);
         return CC_ERR_NOT_FOUND;
     }
 
+    if(start >= 0){
+        task_ctx->start = start;
+    }
+    if(interval >= 0){
+        task_ctx->interval_tick = interval;
+    }
+
     cc_hal_os_semphr_give(g_semphr_handle);
+    if(task_ctx->start){
+        cc_sched_wakeup();
+    }
     return CC_OK;
-}
\ No newline at end of file
+}
+
+cc_err_t cc_tmr_task_set_interval(cc_tmr_task_t task, uint32_t interval){
+    return __update_by_task(task, -1, interval);
+}
+
+cc_err_t cc_tmr_task_stop(cc_tmr_task_t task){
+    return __update_by_task(task, 0, -1);
+}
+
+cc_err_t cc_tmr_task_continue(cc_tmr_task_t task){
+    return __update_by_task(task, 1, -1);
+}
@@ -0,0 +1,129 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-20 18:41:37
+ * @Last Modified time: 2022-03-20 18:41:37
+ */
+
+#include "cc_worker.h"
+
+#include "cc_log.h"
+#include "cc_list.h"
+#include "cc_hal_os.h"
+
+#include <stdio.h>
+
+static char *TAG = "cc_worker";
+
+#ifdef CONFIG_CC_WORKER_NUM
+#define CC_WORKER_NUM           CONFIG_CC_WORKER_NUM
+#define CC_WORKER_JOBS          CONFIG_CC_WORKER_JOBS
+#define CC_WORKER_STACK_SIZE    CONFIG_CC_WORKER_STACK_SIZE
+#define CC_WORKER_TASK_PRIO     CONFIG_CC_WORKER_TASK_PRIO
+#else
+#define CC_WORKER_NUM           2
+#define CC_WORKER_JOBS          16
+#define CC_WORKER_STACK_SIZE    4096
+#define CC_WORKER_TASK_PRIO     5
+#endif
+
+typedef struct{
+    cc_dlist_node_t node;
+    cc_worker_fn_t fn;
+    void *arg;
+}_job_t;
+
+CC_POOL_DEFINE(g_job_pool, sizeof(_job_t), CC_WORKER_JOBS);
+static cc_dlist_t g_queue[CC_WORKER_PRIO_MAX];
+static cc_os_spinlock_t g_queue_lock = CC_OS_SPINLOCK_INIT;
+// 计数与排队的作业数一致，工作任务在此等待
+static cc_os_semphr_handle_t g_job_sem = NULL;
+static cc_os_semphr_buf_t g_job_sem_buf;
+
+static _job_t *__job_pop(void){
+    cc_dlist_node_t *node = NULL;
+
+    cc_hal_os_enter_critical(&g_queue_lock);
+    for(int prio = 0; prio < CC_WORKER_PRIO_MAX && !node; prio++){
+        node = cc_dlist_pop_front(&g_queue[prio]);
+    }
+    cc_hal_os_exit_critical(&g_queue_lock);
+    return node ? cc_dlist_entry(node, _job_t, node) : NULL;
+}
+
+static void __worker_task(void *arg){
+    while(1){
+        if(cc_hal_os_semphr_take(g_job_sem, CC_OS_MAX_DELAY) != CC_OK){
+            continue;
+        }
+        _job_t *job = __job_pop();
+        if(job == NULL){
+            continue;
+        }
+        cc_worker_fn_t fn = job->fn;
+        void *job_arg = job->arg;
+        // 先归还节点，作业中可以再次提交
+        cc_pool_free(&g_job_pool, job);
+        fn(job_arg);
+    }
+}
+
+cc_err_t cc_worker_init(void){
+
+    if(NULL != g_job_sem){
+        return CC_OK;
+    }
+
+    cc_pool_init(&g_job_pool, g_job_pool_buf, sizeof(_job_t), CC_WORKER_JOBS);
+    g_job_sem = cc_hal_os_semphr_create_counting_static(CC_WORKER_JOBS, 0, &g_job_sem_buf);
+    if(NULL == g_job_sem){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+
+    for(int i = 0; i < CC_WORKER_NUM; i++){
+        char name[16];
+        snprintf(name, sizeof(name), "cc_worker%d", i);
+        if(CC_OK != cc_hal_os_task_create(__worker_task, name, CC_WORKER_STACK_SIZE, NULL, CC_WORKER_TASK_PRIO, NULL)){
+            // 已创建的工作任务继续使用
+            CC_LOGE(TAG, "worker %d create error", i);
+            return i ? CC_OK : CC_FAIL;
+        }
+    }
+    return CC_OK;
+}
+
+cc_err_t cc_worker_submit(cc_worker_fn_t fn, void *arg, cc_worker_prio_t prio){
+
+    if(fn == NULL || prio >= CC_WORKER_PRIO_MAX){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(NULL == g_job_sem){
+        CC_LOGE(TAG, "worker not init");
+        return CC_FAIL;
+    }
+
+    _job_t *job = cc_pool_alloc(&g_job_pool);
+    if(job == NULL){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+    job->fn = fn;
+    job->arg = arg;
+
+    cc_hal_os_enter_critical(&g_queue_lock);
+    cc_dlist_push_back(&g_queue[prio], &job->node);
+    cc_hal_os_exit_critical(&g_queue_lock);
+    cc_hal_os_semphr_give(g_job_sem);
+    return CC_OK;
+}
+
+uint32_t cc_worker_pending(void){
+    uint32_t count = 0;
+
+    cc_hal_os_enter_critical(&g_queue_lock);
+    for(int prio = 0; prio < CC_WORKER_PRIO_MAX; prio++){
+        count += g_queue[prio].count;
+    }
+    cc_hal_os_exit_critical(&g_queue_lock);
+    return count;
+}
@@ -33,6 +33,7 @@ typedef int32_t cc_err_t;
 #define CC_ERR_INVALID_CRC         0x109   /*!< CRC or checksum was invalid */
 #define CC_ERR_INVALID_VERSION     0x10A   /*!< Version was invalid */
 #define CC_ERR_NOT_RESOURCES       0x10B   
+#define CC_ERR_DROPPED             0x10C   /*!< Queue full, item dropped */
 
 #ifdef __cplusplus
 }
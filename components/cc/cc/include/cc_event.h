@@ -21,12 +21,66 @@ extern "C" {
 #define CC_EVENT_DECLARE_BASE(base) extern cc_event_base_t base
 #define CC_EVENT_DEFINE_BASE(base) cc_event_base_t base = #base
 
+/*
+ * 事件在 cc_event 自己的两个事件循环中分发，不占用系统默认循环：
+ * 高优先级循环的任务先于普通循环运行，同一事件基始终走同一循环，事件基内保持先后顺序。
+ * 投递不阻塞，队列满时丢弃并返回 CC_ERR_DROPPED。
+ */
+typedef enum {
+    CC_EVENT_PRIO_HIGH = 0,
+    CC_EVENT_PRIO_NORMAL,
+    CC_EVENT_PRIO_MAX,
+} cc_event_prio_t;
+
+typedef struct {
+    uint32_t posted;
+    uint32_t dropped;       // 队列满被丢弃
+    uint32_t pending;       // 当前排队数
+    uint32_t max_pending;   // 历史最大排队数
+} cc_event_stats_t;
+
+#define CC_EVENT_ANY_ID             ESP_EVENT_ANY_ID
+
+/*
+ * 订阅表：处理函数只为表中列出的 (事件基, 事件 ID) 被调用，不再收到整个事件基的所有事件。
+ * 表项保存事件基变量的地址，表可定义为 static const，放在 flash 中：
+ *   static const cc_event_sub_t s_subs[] = {
+ *       CC_EVENT_SUB(GS_MQTT_EVENT, GS_MQTT_EVENT_CONNECTED, handler),
+ *   };
+ *   cc_event_register_table(s_subs, CC_EVENT_SUB_NUM(s_subs));
+ */
+typedef struct {
+    const cc_event_base_t *base;
+    int32_t id;                     // CC_EVENT_ANY_ID 订阅整个事件基
+    cc_event_handler_t handler;
+} cc_event_sub_t;
+
+#define CC_EVENT_SUB(base, id, handler)     { &(base), (id), (handler) }
+#define CC_EVENT_SUB_NUM(subs)              (sizeof(subs) / sizeof((subs)[0]))
+
+// 订阅整个事件基
 cc_err_t cc_event_register_handler(cc_event_base_t base_event, cc_event_handler_t handler);
 cc_err_t cc_event_unregister_handler(cc_event_base_t base_event, cc_event_handler_t handler);
 
+// 只订阅一个事件 ID
+cc_err_t cc_event_register_id(cc_event_base_t base_event, int32_t event_id, cc_event_handler_t handler);
+cc_err_t cc_event_unregister_id(cc_event_base_t base_event, int32_t event_id, cc_event_handler_t handler);
+
+// 按订阅表注册，任一项失败时撤销已注册的项
+cc_err_t cc_event_register_table(const cc_event_sub_t *subs, size_t num);
+cc_err_t cc_event_unregister_table(const cc_event_sub_t *subs, size_t num);
+
+// 设置事件基的投递优先级，默认 CC_EVENT_PRIO_NORMAL；应在该事件基首次投递前设置
+cc_err_t cc_event_set_base_prio(cc_event_base_t base_event, cc_event_prio_t prio);
+
+// 按事件基的优先级投递
 cc_err_t cc_event_post(cc_event_base_t base_event, int32_t event_id, void* event_data, size_t event_data_len);
+// 总是以高优先级投递
 cc_err_t cc_event_real_post(cc_event_base_t base_event, int32_t event_id, void* event_data, size_t event_data_len);
 
+cc_err_t cc_event_get_stats(cc_event_base_t base_event, cc_event_stats_t *stats);
+void cc_event_dump_stats(void);
+
 cc_err_t cc_event_init(void);
 void cc_event_run(void);
 
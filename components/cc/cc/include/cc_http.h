@@ -13,8 +13,12 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #include "cc_err.h"
 
+#define CC_HTTP_CTX_MAX               4       // 同时进行（含等待重试）的请求数上限
+
 #define CC_HTTP_HEADER_CONNECT_TXT    "content-type: text/plain\r\n"
 #define CC_HTTP_HEADER_CONNECT_JSON   "content-type: application/json\r\n"
 
@@ -50,12 +54,18 @@ typedef struct{
     .retry_wait_time = 1000,    \
 }
 
+cc_err_t cc_http_init(void);
+
 cc_err_t cc_http_simple_get(char *url, cc_http_req_cb_t req_cb, void *arg);
 cc_err_t cc_http_simple_post_json_str(char *url, char *post_buf, cc_http_req_cb_t req_cb, void *arg);
 cc_err_t cc_http_request(cc_http_request_t request);
 
+// 处理已完成的请求：重试或回调 req_cb，在 network_task 中调用
 void cc_http_run(uint16_t interval);
 
+// 有已完成的请求待处理时返回 0，否则返回 UINT32_MAX
+uint32_t cc_http_next_ms(void);
+
 #ifdef __cplusplus
 }
 #endif
@@ -11,6 +11,12 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "cc_hal_os.h"
+
 typedef struct cc_list_node {
 	void *data;
 	struct cc_list_node *next;
@@ -28,6 +34,60 @@ cc_list_node* cc_list_find_node(cc_list_node *list, cc_list_node *node);
 cc_list_node* cc_list_find_by_data(cc_list_node *list, void *data);
 cc_list_node* cc_list_find(cc_list_node *list, int(*func)(cc_list_node*,void*), void *data);
 
+/* intrusive doubly linked list
+ * The node is embedded in the element, so insert/remove never allocate.
+ * cc_dlist_entry() recovers the element from its node.
+ */
+typedef struct cc_dlist_node {
+	struct cc_dlist_node *prev;
+	struct cc_dlist_node *next;
+} cc_dlist_node_t;
+
+typedef struct {
+	cc_dlist_node_t *head;
+	cc_dlist_node_t *tail;
+	uint16_t count;
+} cc_dlist_t;
+
+#define CC_DLIST_INIT	{ NULL, NULL, 0 }
+
+#define cc_dlist_entry(ptr, type, member) \
+	((type *)((char *)(ptr) - offsetof(type, member)))
+
+/* iterate, the current node may be removed inside the loop */
+#define cc_dlist_for_each_safe(list, node, tmp) \
+	for ((node) = (list)->head, (tmp) = (node) ? (node)->next : NULL; (node) != NULL; \
+	     (node) = (tmp), (tmp) = (node) ? (node)->next : NULL)
+
+void cc_dlist_push_back(cc_dlist_t *list, cc_dlist_node_t *node);
+void cc_dlist_push_front(cc_dlist_t *list, cc_dlist_node_t *node);
+void cc_dlist_remove(cc_dlist_t *list, cc_dlist_node_t *node);
+cc_dlist_node_t* cc_dlist_pop_front(cc_dlist_t *list);
+
+/* fixed size pool
+ * Elements are carved from a caller supplied buffer and kept on a free list,
+ * alloc/free are O(1) and never touch the heap.
+ */
+typedef struct {
+	void *free_list;
+	uint8_t *base;
+	uint8_t *end;
+	size_t elem_size;
+	uint16_t used;
+	cc_os_spinlock_t lock;
+} cc_pool_t;
+
+/* buffer of count elements, elem_size is rounded up to pointer alignment */
+#define CC_POOL_ELEM_SIZE(size)	(((size) + sizeof(void *) - 1) & ~(sizeof(void *) - 1))
+#define CC_POOL_DEFINE(name, size, count) \
+	static void *name##_buf[CC_POOL_ELEM_SIZE(size) * (count) / sizeof(void *)]; \
+	static cc_pool_t name
+
+void cc_pool_init(cc_pool_t *pool, void *buf, size_t elem_size, uint16_t count);
+void* cc_pool_alloc(cc_pool_t *pool);
+void cc_pool_free(cc_pool_t *pool, void *elem);
+bool cc_pool_owns(const cc_pool_t *pool, const void *elem);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,43 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-20 18:41:41
+ * @Last Modified time: 2022-03-20 18:41:41
+ */
+
+#ifndef __CC_SCHED_H__
+#define __CC_SCHED_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "cc_err.h"
+
+#define CC_SCHED_MAX_SLEEP_MS       5000    //!< 即使没有待处理的工作，也至少这么久醒来一次
+
+cc_err_t cc_sched_init(void);
+
+/**
+ * @brief 汇总 cc_timer / cc_http / cc_tmr_task 的下一个到期时间
+ *
+ * @return 距离下一次需要运行的毫秒数，0 表示有工作需要立即处理，最大 CC_SCHED_MAX_SLEEP_MS
+ */
+uint32_t cc_sched_next_ms(void);
+
+/**
+ * @brief 阻塞直到超时或被 cc_sched_wakeup() 唤醒
+ */
+void cc_sched_wait(uint32_t ms);
+
+/**
+ * @brief 有新工作投递时唤醒调度任务（启动定时器、创建任务、发起 HTTP 请求等）
+ */
+void cc_sched_wakeup(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__CC_SCHED_H__
@@ -11,10 +11,15 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #include "cc_err.h"
 
 #define CC_TIMMER_MS(ms)    (((uint64_t)ms)*1000)
 
+#define CC_TIMER_TICK_US        10000           //!< 时间轮后端的定时器精度，esp_timer 后端（CONFIG_CC_TIMER_ESP_TIMER）不取整
+#define CC_TIMER_NO_DEADLINE    UINT64_MAX      //!< cc_timer_next_us() 没有待触发的定时器
+
 typedef void *cc_timer_handle_t;
 
 typedef enum {
@@ -42,7 +47,19 @@ cc_err_t cc_timer_delete(cc_timer_handle_t *timer);
 
 cc_err_t cc_timer_simple_one(cc_timer_type_t type, cc_timer_cb_t callback, uint64_t us, void* arg);
 
+/**
+ * @brief 推进时间并执行到期定时器的回调，所有回调都在调用者的任务中执行
+ *
+ * @param us 距上次调用经过的时间；esp_timer 后端忽略它，只执行已到期的回调
+ */
 void cc_timer_run(uint64_t us);
+
+/**
+ * @brief 距离下一个定时器到期（或时间轮下放）的时间，调用方可以据此休眠
+ *
+ * @return 微秒，没有运行中的定时器时返回 CC_TIMER_NO_DEADLINE
+ */
+uint64_t cc_timer_next_us(void);
 cc_err_t cc_timer_init(void);
 
 #ifdef __cplusplus
@@ -11,17 +11,36 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #include "cc_err.h"
 
 typedef void (*cc_tmr_task_t)(uint32_t interval, void *arg);
 
+typedef uint32_t cc_tmr_task_handle_t;
+
+#define CC_TMR_TASK_MAX             16      //!< 同时存在的任务数上限（不超过 32）
+#define CC_TMR_TASK_INVALID         0
+
 cc_err_t cc_tmr_task_init(void);
 
 void cc_tmr_task_run(uint16_t interval);
 
+// 距离下一个任务到期的毫秒数，没有运行中的任务时返回 UINT32_MAX
+uint32_t cc_tmr_task_next_ms(void);
+
 cc_err_t cc_tmr_task_create(cc_tmr_task_t task, uint32_t interval, void *arg);
 cc_err_t cc_tmr_task_delete(cc_tmr_task_t task);
 
+/**
+ * 基于句柄的接口，创建/删除/查找均为 O(1)。句柄带 generation，
+ * 任务删除后旧句柄自动失效，重复删除返回 CC_ERR_NOT_FOUND。
+ */
+cc_tmr_task_handle_t cc_tmr_task_create_handle(cc_tmr_task_t task, uint32_t interval, void *arg);
+cc_err_t cc_tmr_task_delete_handle(cc_tmr_task_handle_t handle);
+// 在任务回调中返回自身句柄，其他情况返回 CC_TMR_TASK_INVALID
+cc_tmr_task_handle_t cc_tmr_task_current(void);
+
 cc_err_t cc_tmr_task_set_interval(cc_tmr_task_t task, uint32_t interval);
 
 cc_err_t cc_tmr_task_stop(cc_tmr_task_t task);
@@ -0,0 +1,49 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-20 18:41:37
+ * @Last Modified time: 2022-03-20 18:41:37
+ */
+
+#ifndef __CC_WORKER_H__
+#define __CC_WORKER_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "cc_err.h"
+
+/*
+ * 固定数量的工作任务，替代按事件创建/删除任务：
+ * 作业节点来自固定大小的池，提交不分配堆内存；空闲的工作任务总是先取高优先级队列。
+ * 作业在工作任务的栈上运行，可以阻塞，但阻塞期间占用一个工作任务；
+ * 栈用量不能超过 CONFIG_CC_WORKER_STACK_SIZE。
+ */
+typedef void (*cc_worker_fn_t)(void *arg);
+
+typedef enum {
+    CC_WORKER_PRIO_HIGH = 0,
+    CC_WORKER_PRIO_NORMAL,
+    CC_WORKER_PRIO_LOW,
+    CC_WORKER_PRIO_MAX,
+} cc_worker_prio_t;
+
+cc_err_t cc_worker_init(void);
+
+/**
+ * @brief 提交作业，不阻塞，可在任意任务中调用
+ *
+ * @return CC_ERR_NO_MEM 作业池已满；CC_FAIL 未初始化
+ */
+cc_err_t cc_worker_submit(cc_worker_fn_t fn, void *arg, cc_worker_prio_t prio);
+
+// 排队中（未开始执行）的作业数
+uint32_t cc_worker_pending(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif  //__CC_WORKER_H__
@@ -2,8 +2,12 @@
  * File: cc_hal_ble.c (修改后示例)
  ************************************************/
 #include "cc_hal_ble.h"
+#include "cc_hal_sys.h"
+#include "cc_hal_os.h"
 #include "cc_log.h"
 
+#include <string.h>
+
 #include "nimble/ble.h"
 #include "nimble/nimble_port.h"
 #include "nimble/nimble_port_freertos.h"
@@ -11,6 +15,7 @@
 #include "host/ble_hs.h"
 #include "host/util/util.h"
 #include "services/gap/ble_svc_gap.h"
+#include "esp_bt.h"
 
 static char *TAG = "cc_hal_ble";
 
@@ -28,6 +33,84 @@ static const ble_uuid16_t gatt_svr_chr_sec_read_uuid = BLE_UUID16_INIT(0xFFF4);
 static uint8_t g_ble_is_init = 0;
 static cc_hal_ble_recv_cb_t g_ble_recv_cb = NULL;
 static uint16_t g_ble_conn_handle = 0;
+static cc_hal_ble_recv_cb_t g_ble_msg_cb = NULL;
+static uint8_t g_ble_port_on = 0;          // nimble_port_init 之后、deinit 之前
+static uint8_t g_ble_mem_released = 0;     // 控制器内存已归还堆，本次上电不能再初始化
+
+/* ============ MTU 与分帧 ============ */
+#define BLE_ATT_MTU_MIN         23
+#define BLE_LEGACY_CHUNK        20      // 未分帧的对端保持旧的 20 字节分包
+#define BLE_RECV_BUF_LEN        (CONFIG_CC_BLE_MTU - 3)
+#define BLE_FRAME_HDR_LEN       2
+#define BLE_FRAME_FIRST_HDR_LEN 4
+#define BLE_NOTIFY_RETRY        50      // 发送缓冲（msys）耗尽时每 10ms 重试
+#define BLE_NOTIFY_RETRY_MS     10
+
+static volatile uint16_t g_ble_mtu = BLE_ATT_MTU_MIN;
+static volatile uint8_t g_ble_framed = 0;  // 对端在本连接上用过分帧
+static volatile uint8_t g_ble_packed = 0;  // 对端在本连接上用过合包
+static volatile uint8_t g_ble_connected = 0;
+
+/* ============ 发送队列 ============ */
+#define BLE_TXQ_LEN_HDR         2       // 每条消息前的长度，小端
+#define BLE_TXQ_FLUSH_MS        500     // deinit 前等待队列发完的上限
+
+/*
+ * cc_hal_ble_send() 只把消息放进环形缓冲，由 host 任务取出：分帧对端按 MTU 填满每个通知包，
+ * 对端支持合包时一个包里接着放下一条消息；msys 耗尽时留着当前包，稍后重试
+ */
+typedef struct {
+    uint8_t *buf;
+    uint16_t size;
+    uint16_t head;              // 下一条消息的长度所在位置，只在 host 任务中推进
+    volatile uint16_t used;
+    cc_os_spinlock_t lock;
+
+    // 以下只在 host 任务中访问
+    uint16_t msg_len;           // 正在发送的消息，0 为无
+    uint16_t msg_off;
+    uint8_t msg_framed;
+    uint8_t seq;
+    uint8_t retry;
+    uint16_t pkt_len;           // 已组好、还没发出的包
+    uint8_t pkt[CONFIG_CC_BLE_MTU - 3];
+} ble_txq_t;
+
+static ble_txq_t g_txq = {0};
+static struct ble_npl_event g_tx_ev;
+static struct ble_npl_callout g_tx_retry;
+
+/* ============ 连接参数 ============ */
+/*
+ * 有收发时用短连接间隔，空闲 CONFIG_CC_BLE_IDLE_MS 后放宽间隔并允许从机延迟以省电；
+ * 取值满足 iOS 的连接参数要求（间隔为 15ms 的倍数，max * (latency + 1) <= 2s）
+ */
+#define BLE_DATA_LEN_OCTETS     251     // 数据长度扩展：一个 LL 包装下 247 的 MTU
+#define BLE_DATA_LEN_TIME       2120
+
+static const struct ble_gap_upd_params g_link_params[2] = {
+    // 空闲：150~180ms，latency 4
+    { .itvl_min = 120, .itvl_max = 144, .latency = 4, .supervision_timeout = 600 },
+    // 收发中：15~30ms
+    { .itvl_min = 12, .itvl_max = 24, .latency = 0, .supervision_timeout = 400 },
+};
+
+static struct {
+    uint8_t want;               // 1 收发中，0 空闲
+    uint8_t cur;                // 最近一次请求的参数
+    uint8_t updating;           // 参数更新进行中，完成后再按 want 调整
+} g_link = {0};
+
+static struct ble_npl_callout g_link_idle;
+
+typedef struct {
+    uint8_t *buf;
+    uint16_t total;
+    uint16_t len;
+    uint8_t seq;
+} ble_frame_rx_t;
+
+static ble_frame_rx_t g_frame_rx = {0};
 
 /** 
  * ============ 新增的全局变量 ============ 
@@ -156,6 +239,144 @@ static int gatt_svr_chr_write(struct os_mbuf *om, uint16_t min_len, uint16_t max
     return 0;
 }
 
+static void __frame_rx_reset(void)
+{
+    if (g_frame_rx.buf) {
+        cc_hal_sys_free(g_frame_rx.buf);
+    }
+    memset(&g_frame_rx, 0, sizeof(g_frame_rx));
+}
+
+/*
+ * 分帧重组：首包分配整条消息的缓冲，序号或长度不对时丢弃整条
+ * 返回本帧占用的字节数（末包之后可能接着下一条消息的首包），丢弃时返回 0
+ */
+static uint16_t __frame_rx(const uint8_t *pkt, uint16_t len)
+{
+    uint16_t pkt_len = len;
+
+    if (len < BLE_FRAME_HDR_LEN) {
+        return 0;
+    }
+    uint8_t ctrl = pkt[1];
+    uint8_t seq = ctrl & CC_HAL_BLE_FRAME_SEQ_MASK;
+
+    if (ctrl & CC_HAL_BLE_FRAME_FIRST) {
+        if (len < BLE_FRAME_FIRST_HDR_LEN) {
+            return 0;
+        }
+        uint16_t total = pkt[2] | (pkt[3] << 8);
+        if (total == 0 || total > CONFIG_CC_BLE_FRAME_MAX) {
+            CC_LOGE(TAG, "frame too large: %u", total);
+            __frame_rx_reset();
+            return 0;
+        }
+        if (g_frame_rx.buf && g_frame_rx.len) {
+            CC_LOGW(TAG, "frame restarted, %u/%u dropped", g_frame_rx.len, g_frame_rx.total);
+        }
+        __frame_rx_reset();
+        // 多留 1 字节放 '\0'，文本消息可直接当字符串解析
+        g_frame_rx.buf = cc_hal_sys_malloc_caps(total + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
+        if (!g_frame_rx.buf) {
+            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+            return 0;
+        }
+        g_frame_rx.total = total;
+        g_frame_rx.seq = 0;
+        g_ble_framed = 1;
+        pkt += BLE_FRAME_FIRST_HDR_LEN;
+        len -= BLE_FRAME_FIRST_HDR_LEN;
+    } else {
+        if (!g_frame_rx.buf || seq != g_frame_rx.seq) {
+            CC_LOGW(TAG, "frame seq %u, expect %u => drop", seq, g_frame_rx.seq);
+            __frame_rx_reset();
+            return 0;
+        }
+        pkt += BLE_FRAME_HDR_LEN;
+        len -= BLE_FRAME_HDR_LEN;
+    }
+
+    uint16_t room = g_frame_rx.total - g_frame_rx.len;
+    uint16_t take = len;
+    if (ctrl & CC_HAL_BLE_FRAME_LAST) {
+        if (len < room) {
+            CC_LOGW(TAG, "frame short: %u/%u => drop", g_frame_rx.len + len, g_frame_rx.total);
+            __frame_rx_reset();
+            return 0;
+        }
+        take = room;
+    } else if (len > room) {
+        CC_LOGW(TAG, "frame overrun => drop");
+        __frame_rx_reset();
+        return 0;
+    }
+    memcpy(g_frame_rx.buf + g_frame_rx.len, pkt, take);
+    g_frame_rx.len += take;
+    g_frame_rx.seq = (g_frame_rx.seq + 1) & CC_HAL_BLE_FRAME_SEQ_MASK;
+
+    if (ctrl & CC_HAL_BLE_FRAME_LAST) {
+        g_frame_rx.buf[g_frame_rx.len] = '\0';
+        cc_hal_ble_recv_cb_t cb = g_ble_msg_cb ? g_ble_msg_cb : g_ble_recv_cb;
+        if (cb) {
+            cb(g_frame_rx.buf, g_frame_rx.len);
+        }
+        __frame_rx_reset();
+    }
+    return pkt_len - len + take;
+}
+
+/* 一次写入里可能合了多条分帧消息 */
+static void __frame_rx_packed(const uint8_t *pkt, uint16_t len)
+{
+    uint16_t off = 0;
+    while (off < len && pkt[off] == CC_HAL_BLE_FRAME_MARK) {
+        uint16_t n = __frame_rx(pkt + off, len - off);
+        if (n == 0) {
+            return;
+        }
+        if (off > 0) {
+            g_ble_packed = 1;
+        }
+        off += n;
+    }
+    if (off < len) {
+        CC_LOGW(TAG, "%u trailing bytes after frame => ignored", len - off);
+    }
+}
+
+/* ============== 连接参数：收发时短间隔，空闲后放宽 ============== */
+static void __link_set(uint8_t fast)
+{
+    g_link.want = fast;
+    if (!g_ble_connected || g_link.updating || g_link.cur == fast) {
+        return;
+    }
+    int rc = ble_gap_update_params(g_ble_conn_handle, &g_link_params[fast]);
+    if (rc != 0) {
+        CC_LOGW(TAG, "ble_gap_update_params(%d) rc=%d", fast, rc);
+        return;
+    }
+    g_link.updating = 1;
+    g_link.cur = fast;
+}
+
+/* 有收发时调用（host 任务） */
+static void __link_busy(void)
+{
+    __link_set(1);
+    ble_npl_callout_reset(&g_link_idle, ble_npl_time_ms_to_ticks32(CONFIG_CC_BLE_IDLE_MS));
+}
+
+static void __link_idle_cb(struct ble_npl_event *ev)
+{
+    // 还有没发完的通知或没收完的分帧消息，再等一轮
+    if (g_txq.used || g_txq.pkt_len || g_frame_rx.buf) {
+        ble_npl_callout_reset(&g_link_idle, ble_npl_time_ms_to_ticks32(CONFIG_CC_BLE_IDLE_MS));
+        return;
+    }
+    __link_set(0);
+}
+
 static int gatt_svr_chr_access_sec_test(uint16_t conn_handle,
                                         uint16_t attr_handle,
                                         struct ble_gatt_access_ctxt *ctxt,
@@ -163,7 +384,7 @@ static int gatt_svr_chr_access_sec_test(uint16_t conn_handle,
 {
     int rc;
     const ble_uuid_t *uuid;
-    static uint8_t gatt_svr_sec_recv_buf[20];
+    static uint8_t gatt_svr_sec_recv_buf[BLE_RECV_BUF_LEN];
     uint16_t read_len = 0;
 
     uuid = ctxt->chr->uuid;
@@ -174,8 +395,13 @@ static int gatt_svr_chr_access_sec_test(uint16_t conn_handle,
                                     sizeof(gatt_svr_sec_recv_buf),
                                     gatt_svr_sec_recv_buf,
                                     &read_len);
-            if (rc == 0 && g_ble_recv_cb && read_len > 0) {
-                g_ble_recv_cb(gatt_svr_sec_recv_buf, read_len);
+            if (rc == 0 && read_len > 0) {
+                __link_busy();
+                if (gatt_svr_sec_recv_buf[0] == CC_HAL_BLE_FRAME_MARK) {
+                    __frame_rx_packed(gatt_svr_sec_recv_buf, read_len);
+                } else if (g_ble_recv_cb) {
+                    g_ble_recv_cb(gatt_svr_sec_recv_buf, read_len);
+                }
             }
             return rc;
         } else {
@@ -256,17 +482,182 @@ cc_err_t cc_hal_ble_stop_advzertising(void){
     return CC_OK;
 }
 
-/* ============== 发通知示例 ============== */
+/* ============== 发送队列 ============== */
+static void __txq_copy_in(uint16_t pos, const uint8_t *src, uint16_t len)
+{
+    pos %= g_txq.size;
+    uint16_t n = (len > g_txq.size - pos) ? (g_txq.size - pos) : len;
+    memcpy(g_txq.buf + pos, src, n);
+    memcpy(g_txq.buf, src + n, len - n);
+}
+
+static void __txq_copy_out(uint16_t pos, uint8_t *dst, uint16_t len)
+{
+    pos %= g_txq.size;
+    uint16_t n = (len > g_txq.size - pos) ? (g_txq.size - pos) : len;
+    memcpy(dst, g_txq.buf + pos, n);
+    memcpy(dst + n, g_txq.buf, len - n);
+}
+
+/* 取队首消息的长度，队列空返回 0（host 任务） */
+static uint16_t __txq_front(void)
+{
+    uint8_t hdr[BLE_TXQ_LEN_HDR];
+
+    if (g_txq.used == 0) {
+        return 0;
+    }
+    // 已放进队列的内容只有 host 任务会改，读时不必加锁
+    __txq_copy_out(g_txq.head, hdr, sizeof(hdr));
+    return hdr[0] | (hdr[1] << 8);
+}
+
+static void __txq_pop(uint16_t len)
+{
+    cc_hal_os_enter_critical(&g_txq.lock);
+    g_txq.head = (g_txq.head + len) % g_txq.size;
+    g_txq.used -= len;
+    cc_hal_os_exit_critical(&g_txq.lock);
+}
+
+static void __txq_flush(void)
+{
+    if (g_txq.buf) {
+        cc_hal_os_enter_critical(&g_txq.lock);
+        g_txq.head = 0;
+        g_txq.used = 0;
+        cc_hal_os_exit_critical(&g_txq.lock);
+        ble_npl_callout_stop(&g_tx_retry);
+    }
+    g_txq.msg_len = 0;
+    g_txq.pkt_len = 0;
+    g_txq.retry = 0;
+}
+
+/* 从队列组下一个通知包，没有可发的返回 0 */
+static uint16_t __txq_fill(void)
+{
+    uint8_t *pkt = g_txq.pkt;
+    uint16_t n = 0;
+
+    for (;;) {
+        if (g_txq.msg_len == 0) {
+            g_txq.msg_len = __txq_front();
+            if (g_txq.msg_len == 0) {
+                break;
+            }
+            g_txq.msg_off = 0;
+            g_txq.msg_framed = g_ble_framed;
+            g_txq.seq = 0;
+        }
+        uint16_t left = g_txq.msg_len - g_txq.msg_off;
+        uint16_t take;
+        if (g_txq.msg_framed) {
+            uint16_t pkt_max = g_ble_mtu - 3;
+            if (pkt_max > sizeof(g_txq.pkt)) {
+                pkt_max = sizeof(g_txq.pkt);
+            }
+            uint16_t hdr = (g_txq.msg_off == 0) ? BLE_FRAME_FIRST_HDR_LEN : BLE_FRAME_HDR_LEN;
+            if (n + hdr >= pkt_max) {
+                break;
+            }
+            take = (left > pkt_max - n - hdr) ? (pkt_max - n - hdr) : left;
+            pkt[n] = CC_HAL_BLE_FRAME_MARK;
+            pkt[n + 1] = g_txq.seq & CC_HAL_BLE_FRAME_SEQ_MASK;
+            if (g_txq.msg_off == 0) {
+                pkt[n + 1] |= CC_HAL_BLE_FRAME_FIRST;
+                pkt[n + 2] = g_txq.msg_len & 0xFF;
+                pkt[n + 3] = g_txq.msg_len >> 8;
+            }
+            if (take == left) {
+                pkt[n + 1] |= CC_HAL_BLE_FRAME_LAST;
+            }
+            n += hdr;
+        } else {
+            take = (left > BLE_LEGACY_CHUNK) ? BLE_LEGACY_CHUNK : left;
+        }
+        __txq_copy_out(g_txq.head + BLE_TXQ_LEN_HDR + g_txq.msg_off, pkt + n, take);
+        n += take;
+        g_txq.msg_off += take;
+        g_txq.seq++;
+        if (g_txq.msg_off < g_txq.msg_len) {
+            break;
+        }
+        __txq_pop(BLE_TXQ_LEN_HDR + g_txq.msg_len);
+        g_txq.msg_len = 0;
+        // 未分帧的对端按包区分消息，不合包
+        if (!g_txq.msg_framed || !g_ble_packed || !g_ble_framed) {
+            break;
+        }
+    }
+    g_txq.pkt_len = n;
+    return n;
+}
+
+/* host 任务中把队列发空；msys 耗尽时留着当前包，BLE_NOTIFY_RETRY_MS 后再来 */
+static void __tx_drain(struct ble_npl_event *ev)
+{
+    while (g_txq.pkt_len || __txq_fill()) {
+        __link_busy();
+
+        int rc = BLE_HS_ENOMEM;
+        struct os_mbuf *om = ble_hs_mbuf_from_flat(g_txq.pkt, g_txq.pkt_len);
+        if (om) {
+            // 无论成败 om 都由协议栈释放
+            rc = ble_gattc_notify_custom(g_ble_conn_handle, csc_notify_handle, om);
+        }
+        if (rc == BLE_HS_ENOMEM && ++g_txq.retry <= BLE_NOTIFY_RETRY) {
+            ble_npl_callout_reset(&g_tx_retry, ble_npl_time_ms_to_ticks32(BLE_NOTIFY_RETRY_MS));
+            return;
+        }
+        if (rc != 0) {
+            CC_LOGE(TAG, "notify rc=%d => drop %u queued bytes", rc, g_txq.used);
+            __txq_flush();
+            return;
+        }
+        g_txq.retry = 0;
+        g_txq.pkt_len = 0;
+    }
+}
+
+/* ============== 发通知：放进发送队列，由 host 任务发出 ============== */
 uint16_t cc_hal_ble_send(uint8_t *data, uint16_t len)
 {
     if (0 == len || NULL == data) {
         return CC_ERR_INVALID_ARG;
     }
-    for (size_t idx = 0; idx < len; idx += 20){
-        struct os_mbuf *om = ble_hs_mbuf_from_flat(data + idx,
-                                                   (len - idx > 20) ? 20 : (len - idx));
-        ble_gattc_notify_custom(g_ble_conn_handle, csc_notify_handle, om);
+    if (!g_txq.buf || !g_ble_connected) {
+        return CC_FAIL;
+    }
+    if (len > g_txq.size - BLE_TXQ_LEN_HDR) {
+        return CC_ERR_INVALID_SIZE;
+    }
+
+    uint8_t hdr[BLE_TXQ_LEN_HDR] = { len & 0xFF, len >> 8 };
+    cc_hal_os_enter_critical(&g_txq.lock);
+    if (g_txq.used + BLE_TXQ_LEN_HDR + len > g_txq.size) {
+        cc_hal_os_exit_critical(&g_txq.lock);
+        CC_LOGW(TAG, "tx queue full, %u bytes dropped", len);
+        return CC_ERR_NO_MEM;
     }
+    uint16_t tail = g_txq.head + g_txq.used;
+    __txq_copy_in(tail, hdr, BLE_TXQ_LEN_HDR);
+    __txq_copy_in(tail + BLE_TXQ_LEN_HDR, data, len);
+    g_txq.used += BLE_TXQ_LEN_HDR + len;
+    cc_hal_os_exit_critical(&g_txq.lock);
+
+    ble_npl_eventq_put(nimble_port_get_dflt_eventq(), &g_tx_ev);
+    return CC_OK;
+}
+
+uint16_t cc_hal_ble_get_mtu(void)
+{
+    return g_ble_mtu;
+}
+
+cc_err_t cc_hal_ble_set_msg_cb(cc_hal_ble_recv_cb_t msg_cb)
+{
+    g_ble_msg_cb = msg_cb;
     return CC_OK;
 }
 
@@ -283,16 +674,61 @@ static int gap_event(struct ble_gap_event *event, void *arg)
             if (rc == 0) {
                 CC_LOGI(TAG, "BLE connected, conn_handle=%d", event->connect.conn_handle);
             }
+            g_ble_mtu = BLE_ATT_MTU_MIN;
+            g_ble_framed = 0;
+            g_ble_packed = 0;
+            g_ble_conn_handle = event->connect.conn_handle;
+            g_ble_connected = 1;
+#if CONFIG_CC_BLE_MTU > 23
+            // 手机未必主动交换 MTU，由设备发起；失败时保持 23
+            ble_gattc_exchange_mtu(event->connect.conn_handle, NULL, NULL);
+#endif
+            // 一个 LL 包装下整个通知；2M PHY 同样的数据空中时间减半，手机不支持时保持原样
+            ble_gap_set_data_len(event->connect.conn_handle, BLE_DATA_LEN_OCTETS, BLE_DATA_LEN_TIME);
+#if CONFIG_BT_NIMBLE_50_FEATURE_SUPPORT
+            ble_gap_set_prefered_le_phy(event->connect.conn_handle, BLE_GAP_LE_PHY_2M_MASK,
+                                        BLE_GAP_LE_PHY_2M_MASK, BLE_GAP_LE_PHY_CODED_ANY);
+#endif
+            // 连上后紧接着就是配网收发，先用短间隔，空闲后再放宽
+            memset(&g_link, 0, sizeof(g_link));
+            __link_busy();
         } else {
+            g_ble_conn_handle = event->connect.conn_handle;
             // 连接失败 => resume advertising
             cc_hal_ble_start_advzertising(g_adv_data, g_adv_len, g_scan_rsp_data, g_scan_rsp_len);
         }
-        g_ble_conn_handle = event->connect.conn_handle;
         cc_event_post(CC_HAL_BLE_EVENT, CC_HAL_BLE_EVENT_CONNECTED, NULL, 0);
         return 0;
 
+    case BLE_GAP_EVENT_CONN_UPDATE:
+        g_link.updating = 0;
+        if (event->conn_update.status != 0) {
+            CC_LOGW(TAG, "conn update status=%d", event->conn_update.status);
+        } else if (ble_gap_conn_find(event->conn_update.conn_handle, &desc) == 0) {
+            CC_LOGI(TAG, "BLE conn itvl=%u latency=%u", desc.conn_itvl, desc.conn_latency);
+        }
+        // 更新期间又有了收发或空闲下来
+        __link_set(g_link.want);
+        return 0;
+
+    case BLE_GAP_EVENT_PHY_UPDATE_COMPLETE:
+        CC_LOGI(TAG, "BLE phy tx=%d rx=%d", event->phy_updated.tx_phy, event->phy_updated.rx_phy);
+        return 0;
+
+    case BLE_GAP_EVENT_MTU:
+        g_ble_mtu = event->mtu.value;
+        CC_LOGI(TAG, "BLE mtu=%d", event->mtu.value);
+        return 0;
+
     case BLE_GAP_EVENT_DISCONNECT:
         CC_LOGI(TAG, "BLE disconnected, reason=%d => re-adv?", event->disconnect.reason);
+        g_ble_connected = 0;
+        g_ble_mtu = BLE_ATT_MTU_MIN;
+        g_ble_framed = 0;
+        g_ble_packed = 0;
+        __frame_rx_reset();
+        __txq_flush();
+        ble_npl_callout_stop(&g_link_idle);
         cc_event_post(CC_HAL_BLE_EVENT, CC_HAL_BLE_EVENT_DISCONNECTED, NULL, 0);
         // 断开后如需继续广播，可再次调用 start
         cc_hal_ble_start_advzertising(g_adv_data, g_adv_len, g_scan_rsp_data, g_scan_rsp_len);
@@ -309,9 +745,32 @@ cc_err_t cc_hal_ble_init(cc_hal_ble_recv_cb_t recv_cb)
 {
     int rc;
 
+    if (g_ble_mem_released) {
+        CC_LOGE(TAG, "BLE memory released, reboot to use BLE");
+        return CC_ERR_NOT_SUPPORTED;
+    }
+    if (g_ble_port_on) {
+        return CC_ERR_INVALID_STATE;
+    }
+
+    g_txq.buf = cc_hal_sys_malloc_caps(CONFIG_CC_BLE_TXQ_SIZE, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
+    if (!g_txq.buf) {
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+    g_txq.size = CONFIG_CC_BLE_TXQ_SIZE;
+    cc_hal_os_spinlock_init(&g_txq.lock);
+
     nimble_port_init(); // 初始化 NimBLE
+    g_ble_port_on = 1;
+
+    // 发送与连接参数调整都在 host 任务的事件队列里处理
+    ble_npl_event_init(&g_tx_ev, __tx_drain, NULL);
+    ble_npl_callout_init(&g_tx_retry, nimble_port_get_dflt_eventq(), __tx_drain, NULL);
+    ble_npl_callout_init(&g_link_idle, nimble_port_get_dflt_eventq(), __link_idle_cb, NULL);
 
     ble_hs_cfg.reset_cb = on_reset;
+    ble_att_set_preferred_mtu(CONFIG_CC_BLE_MTU);
     ble_hs_cfg.sync_cb = on_sync;
 
     // 注册 GATT 服务
@@ -340,17 +799,62 @@ cc_err_t cc_hal_ble_init(cc_hal_ble_recv_cb_t recv_cb)
 
 cc_err_t cc_hal_ble_deinit(void)
 {
+    if (!g_ble_port_on) {
+        return CC_OK;
+    }
+
     // 先停播
     ble_gap_adv_stop();
     g_need_adv = 0;
 
+    // 配网结果等最后的通知发完再停
+    for (int i = 0; i < BLE_TXQ_FLUSH_MS / BLE_NOTIFY_RETRY_MS
+         && g_ble_connected && (g_txq.used || g_txq.pkt_len); i++) {
+        cc_hal_os_task_delay(CC_OS_MS_TO_TICK(BLE_NOTIFY_RETRY_MS));
+    }
+
     // 停 nimble 线程
     nimble_port_stop();
+    ble_npl_callout_deinit(&g_tx_retry);
+    ble_npl_callout_deinit(&g_link_idle);
+    ble_npl_event_deinit(&g_tx_ev);
     nimble_port_deinit();
 
     g_ble_recv_cb   = NULL;
+    g_ble_msg_cb    = NULL;
+    g_ble_mtu       = BLE_ATT_MTU_MIN;
+    g_ble_framed    = 0;
+    g_ble_packed    = 0;
+    g_ble_connected = 0;
+    __frame_rx_reset();
+    cc_hal_sys_free(g_txq.buf);
+    memset(&g_txq, 0, sizeof(g_txq));
     g_ble_is_init   = 0;
     g_ble_is_sync   = 0;
     g_ble_conn_handle = 0;
+    g_ble_port_on   = 0;
+    return CC_OK;
+}
+
+cc_err_t cc_hal_ble_mem_release(void)
+{
+    if (g_ble_mem_released) {
+        return CC_OK;
+    }
+    if (g_ble_port_on) {
+        return CC_ERR_INVALID_STATE;
+    }
+    // 控制器的 .bss/.data 和保留的内部 RAM 一并归还堆，不可恢复
+    esp_err_t err = esp_bt_mem_release(ESP_BT_MODE_BTDM);
+    if (err != ESP_OK) {
+        CC_LOGE(TAG, "esp_bt_mem_release err=%d", err);
+        return CC_FAIL;
+    }
+    g_ble_mem_released = 1;
     return CC_OK;
 }
+
+uint8_t cc_hal_ble_is_available(void)
+{
+    return !g_ble_mem_released;
+}
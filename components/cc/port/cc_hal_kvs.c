@@ -4,19 +4,395 @@
 
 #include <string.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <stdlib.h>
 
+#include "sdkconfig.h"
 #include "esp_err.h"
+#include "esp_system.h"
 #include "nvs_flash.h"
 #include "nvs.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
 
 #include "cc_log.h"
+#include "cc_hal_os.h"
+#include "cc_hal_sys.h"
 
 static char *TAG = "hal_kvs";
 
 #define NVS_PARTITION_NAME  "nvs"
 #define NVS_KV              "cc_iot_kv"
 
+#define KVS_WRITER_STACK_SIZE       CC_OS_STACK_KVS_WRITER
+#define KVS_WRITER_PRIORITY         2
+#define KVS_WRITE_DELAY_MAX_MS      (CONFIG_CC_KVS_WRITE_DELAY_MS * 4)  // 持续写入时最迟落盘时间
+#define KVS_SHUTDOWN_WAIT_MS        500
+
+/*
+ * 命名空间在初始化时打开一次，之后一直复用句柄。
+ * 不超过 CONFIG_CC_KVS_CACHE_VALUE_MAX 的值缓存在 RAM 中（含"不存在"的结果），读命中不访问 flash；
+ * 写入只更新缓存并标脏，由写入任务在 CONFIG_CC_KVS_WRITE_DELAY_MS 内无新写入后统一写入并 commit 一次，
+ * 同一键的多次写入只落盘最后一次，与缓存值相同的写入直接忽略。
+ * 大值、删除和缓存槽全部为脏时直接写 flash。重启（esp_restart）前会先落盘。
+ */
+typedef struct{
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint8_t *value;
+    uint16_t len;
+    uint16_t cap;
+    uint8_t used;
+    uint8_t absent;         // NVS 中没有该键
+    uint8_t dirty;          // 缓存值尚未写入 flash
+    uint32_t stamp;         // 最近访问序号，用于淘汰
+}_kvs_entry_t;
+
 static bool s_kv_init_flag;
+static nvs_handle_t s_handle;
+static cc_os_semphr_handle_t s_lock = NULL;
+static cc_os_semphr_buf_t s_lock_buf;
+static cc_os_task_handle_t s_writer = NULL;
+
+static _kvs_entry_t s_cache[CONFIG_CC_KVS_CACHE_NUM];
+static uint32_t s_stamp = 0;
+
+#if CONFIG_CC_KVS_SNAPSHOT
+/*
+ * 快照：命名空间全部键值按键名排序后存入专用数据分区，启动时整体 mmap，读直接从映射中拷贝。
+ * 布局为 头 + 索引表 + 数据，crc 覆盖头之后的全部内容，先写内容最后写头，写一半的快照不会通过校验。
+ * 快照只反映上次重建时 NVS 的内容：任何写入、删除都会先清掉 flash 上的魔数（只把位写 0，不用擦除），
+ * 本次运行改回缓存 + NVS 读取，由写入任务落盘后重建，下次启动生效。
+ */
+#define KVS_SNAP_MAGIC      0x50414e53      // "SNAP"
+#define KVS_SNAP_VERSION    1
+
+typedef struct{
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t size;          // 含头的总长度
+    uint32_t crc;
+}_kvs_snap_header_t;
+
+typedef struct{
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    uint32_t offset;        // 相对快照起始
+    uint32_t len;
+}_kvs_snap_entry_t;
+
+static const esp_partition_t *s_snap_part = NULL;
+static const _kvs_snap_header_t *s_snap = NULL;     // 有效且未过期的映射，否则为 NULL
+static esp_partition_mmap_handle_t s_snap_mmap;
+static bool s_snap_flash_valid;                     // flash 上的快照仍有效（魔数未清）
+static bool s_snap_stale;                           // 需要重建
+static uint32_t s_snap_gen = 0;                     // 每次改动加一，重建期间有改动时作废结果
+#endif
+
+/*max key name is 15UL*/
+static void __key_name(char *name, const char *key){
+    memset(name, 0, NVS_KEY_NAME_MAX_SIZE);
+    strncpy(name, key, NVS_KEY_NAME_MAX_SIZE - 1);
+}
+
+static _kvs_entry_t *__cache_find(const char *name){
+    for(uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++){
+        if(s_cache[i].used && strcmp(s_cache[i].key, name) == 0){
+            s_cache[i].stamp = ++s_stamp;
+            return &s_cache[i];
+        }
+    }
+    return NULL;
+}
+
+// 取一个空槽或淘汰最久未用的干净槽，全部为脏时返回 NULL
+static _kvs_entry_t *__cache_claim(const char *name){
+    _kvs_entry_t *slot = NULL;
+    for(uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++){
+        _kvs_entry_t *entry = &s_cache[i];
+        if(!entry->used){
+            slot = entry;
+            break;
+        }
+        if(!entry->dirty && (slot == NULL || entry->stamp < slot->stamp)){
+            slot = entry;
+        }
+    }
+    if(slot){
+        strcpy(slot->key, name);
+        slot->used = 1;
+        slot->absent = 1;
+        slot->dirty = 0;
+        slot->len = 0;
+        slot->stamp = ++s_stamp;
+    }
+    return slot;
+}
+
+static cc_err_t __cache_store(_kvs_entry_t *entry, const void *value, size_t len){
+    if(len > entry->cap){
+        uint8_t *buf = cc_hal_sys_malloc_caps(len, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_SYS);
+        if(NULL == buf){
+            return CC_ERR_NO_MEM;
+        }
+        if(entry->value){
+            cc_hal_sys_free(entry->value);
+        }
+        entry->value = buf;
+        entry->cap = len;
+    }
+    memcpy(entry->value, value, len);
+    entry->len = len;
+    entry->absent = 0;
+    return CC_OK;
+}
+
+// 缓冲保留给下次复用
+static void __cache_drop(_kvs_entry_t *entry){
+    entry->used = 0;
+    entry->dirty = 0;
+}
+
+static uint8_t __flush_locked(void){
+    uint8_t written = 0;
+    for(uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++){
+        _kvs_entry_t *entry = &s_cache[i];
+        if(!entry->used || !entry->dirty){
+            continue;
+        }
+        esp_err_t ret = nvs_set_blob(s_handle, entry->key, entry->value, entry->len);
+        if(ret != ESP_OK){
+            // 保持脏标记，下次再写
+            CC_LOGE(TAG, "nvs set blob %s failed with %x", entry->key, ret);
+            continue;
+        }
+        entry->dirty = 0;
+        written++;
+    }
+    if(written){
+        nvs_commit(s_handle);
+        CC_LOGD(TAG, "flush %d blobs", written);
+    }
+    return written;
+}
+
+#if CONFIG_CC_KVS_SNAPSHOT
+static void __snap_init(void){
+    _kvs_snap_header_t header;
+    const void *ptr = NULL;
+
+    s_snap_part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                           CONFIG_CC_KVS_SNAPSHOT_PARTITION);
+    if(s_snap_part == NULL){
+        CC_LOGW(TAG, "snapshot partition %s not found", CONFIG_CC_KVS_SNAPSHOT_PARTITION);
+        return;
+    }
+    s_snap_stale = true;
+    if(esp_partition_read(s_snap_part, 0, &header, sizeof(header)) != ESP_OK ||
+       header.magic != KVS_SNAP_MAGIC || header.version != KVS_SNAP_VERSION ||
+       header.size > s_snap_part->size ||
+       header.size < sizeof(header) + (size_t)header.count * sizeof(_kvs_snap_entry_t)){
+        CC_LOGI(TAG, "no valid snapshot");
+        return;
+    }
+    if(esp_partition_mmap(s_snap_part, 0, header.size, ESP_PARTITION_MMAP_DATA, &ptr, &s_snap_mmap) != ESP_OK){
+        CC_LOGE(TAG, "snapshot mmap failed");
+        return;
+    }
+    const uint8_t *base = ptr;
+    if(esp_rom_crc32_le(0, base + sizeof(header), header.size - sizeof(header)) != header.crc){
+        CC_LOGW(TAG, "snapshot crc mismatch");
+        esp_partition_munmap(s_snap_mmap);
+        return;
+    }
+    const _kvs_snap_entry_t *entries = (const _kvs_snap_entry_t *)(base + sizeof(header));
+    for(uint16_t i = 0; i < header.count; i++){
+        if(entries[i].offset > header.size || entries[i].len > header.size - entries[i].offset){
+            CC_LOGW(TAG, "bad snapshot entry %d", i);
+            esp_partition_munmap(s_snap_mmap);
+            return;
+        }
+    }
+    s_snap = (const _kvs_snap_header_t *)base;
+    s_snap_flash_valid = true;
+    s_snap_stale = false;
+    CC_LOGI(TAG, "snapshot mapped, %d keys", header.count);
+}
+
+static const _kvs_snap_entry_t *__snap_find(const char *name){
+    const _kvs_snap_entry_t *entries = (const _kvs_snap_entry_t *)(s_snap + 1);
+    int lo = 0;
+    int hi = (int)s_snap->count - 1;
+    while(lo <= hi){
+        int mid = (lo + hi) / 2;
+        int cmp = strcmp(name, entries[mid].key);
+        if(cmp == 0){
+            return &entries[mid];
+        }
+        if(cmp < 0){
+            hi = mid - 1;
+        }else{
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// 持锁调用：NVS 即将改动，本次运行不再读快照，flash 上的快照作废，等写入任务重建
+static void __snap_invalidate_locked(void){
+    if(s_snap_part == NULL){
+        return;
+    }
+    if(s_snap){
+        esp_partition_munmap(s_snap_mmap);
+        s_snap = NULL;
+    }
+    s_snap_gen++;
+    if(s_snap_flash_valid){
+        uint32_t zero = 0;
+        esp_partition_write(s_snap_part, offsetof(_kvs_snap_header_t, magic), &zero, sizeof(zero));
+        s_snap_flash_valid = false;
+    }
+    if(!s_snap_stale){
+        s_snap_stale = true;
+        if(s_writer){
+            xTaskNotifyGive(s_writer);
+        }
+    }
+}
+
+static int __snap_entry_cmp(const void *a, const void *b){
+    return strcmp(((const _kvs_snap_entry_t *)a)->key, ((const _kvs_snap_entry_t *)b)->key);
+}
+
+// 持锁从 NVS 生成快照镜像，返回长度，失败返回 0
+static size_t __snap_build_locked(uint8_t **image){
+    nvs_iterator_t it = NULL;
+    uint16_t count = 0;
+    size_t size = sizeof(_kvs_snap_header_t);
+
+    // 第一遍统计键数和总长度
+    esp_err_t ret = nvs_entry_find(NVS_PARTITION_NAME, NVS_KV, NVS_TYPE_BLOB, &it);
+    while(ret == ESP_OK){
+        nvs_entry_info_t info;
+        size_t len = 0;
+        nvs_entry_info(it, &info);
+        if(nvs_get_blob(s_handle, info.key, NULL, &len) == ESP_OK){
+            count++;
+            size += sizeof(_kvs_snap_entry_t) + len;
+        }
+        ret = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    if(size > s_snap_part->size){
+        CC_LOGW(TAG, "snapshot needs %u bytes, partition has %u", (unsigned)size, (unsigned)s_snap_part->size);
+        return 0;
+    }
+
+    uint8_t *buf = cc_hal_sys_malloc_caps(size, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_SYS);
+    if(buf == NULL){
+        return 0;
+    }
+    memset(buf, 0, size);
+    _kvs_snap_entry_t *entries = (_kvs_snap_entry_t *)(buf + sizeof(_kvs_snap_header_t));
+    uint32_t offset = sizeof(_kvs_snap_header_t) + (uint32_t)count * sizeof(_kvs_snap_entry_t);
+    uint16_t n = 0;
+
+    it = NULL;
+    ret = nvs_entry_find(NVS_PARTITION_NAME, NVS_KV, NVS_TYPE_BLOB, &it);
+    while(ret == ESP_OK && n < count){
+        nvs_entry_info_t info;
+        size_t len = size - offset;
+        nvs_entry_info(it, &info);
+        if(nvs_get_blob(s_handle, info.key, buf + offset, &len) == ESP_OK){
+            strncpy(entries[n].key, info.key, NVS_KEY_NAME_MAX_SIZE - 1);
+            entries[n].offset = offset;
+            entries[n].len = len;
+            offset += len;
+            n++;
+        }
+        ret = nvs_entry_next(&it);
+    }
+    nvs_release_iterator(it);
+    qsort(entries, n, sizeof(_kvs_snap_entry_t), __snap_entry_cmp);
+
+    _kvs_snap_header_t *header = (_kvs_snap_header_t *)buf;
+    header->magic = KVS_SNAP_MAGIC;
+    header->version = KVS_SNAP_VERSION;
+    header->count = n;
+    header->size = offset;
+    header->crc = esp_rom_crc32_le(0, buf + sizeof(_kvs_snap_header_t), offset - sizeof(_kvs_snap_header_t));
+    *image = buf;
+    return offset;
+}
+
+static void __snap_rebuild(void){
+    uint8_t *image = NULL;
+    size_t size;
+    uint32_t gen;
+
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+    if(!s_snap_stale || s_snap_part == NULL){
+        cc_hal_os_semphr_give(s_lock);
+        return;
+    }
+    __flush_locked();
+    gen = s_snap_gen;
+    size = __snap_build_locked(&image);
+    cc_hal_os_semphr_give(s_lock);
+    if(size == 0){
+        return;
+    }
+
+    // 擦写 flash 较慢，不持锁；先写内容，最后写头
+    size_t erase = (size + s_snap_part->erase_size - 1) / s_snap_part->erase_size * s_snap_part->erase_size;
+    esp_err_t ret = esp_partition_erase_range(s_snap_part, 0, erase);
+    if(ret == ESP_OK){
+        ret = esp_partition_write(s_snap_part, sizeof(_kvs_snap_header_t), image + sizeof(_kvs_snap_header_t),
+                                  size - sizeof(_kvs_snap_header_t));
+    }
+    if(ret == ESP_OK){
+        ret = esp_partition_write(s_snap_part, 0, image, sizeof(_kvs_snap_header_t));
+    }
+    cc_hal_sys_free(image);
+
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+    if(ret != ESP_OK){
+        CC_LOGE(TAG, "snapshot write failed with %x", ret);
+    }else if(gen != s_snap_gen){
+        // 重建期间又有改动，刚写的快照作废，写入任务会再次重建
+        uint32_t zero = 0;
+        esp_partition_write(s_snap_part, offsetof(_kvs_snap_header_t, magic), &zero, sizeof(zero));
+    }else{
+        s_snap_flash_valid = true;
+        s_snap_stale = false;
+        CC_LOGI(TAG, "snapshot rebuilt, %u bytes", (unsigned)size);
+    }
+    cc_hal_os_semphr_give(s_lock);
+}
+#endif
+
+static void __kvs_writer_task(void *arg){
+    while(1){
+        ulTaskNotifyTake(pdTRUE, CC_OS_MAX_DELAY);
+        // 安静 CONFIG_CC_KVS_WRITE_DELAY_MS 后落盘，持续写入时最迟 KVS_WRITE_DELAY_MAX_MS
+        cc_os_tick_t start = xTaskGetTickCount();
+        while(xTaskGetTickCount() - start < CC_OS_MS_TO_TICK(KVS_WRITE_DELAY_MAX_MS) &&
+              ulTaskNotifyTake(pdTRUE, CC_OS_MS_TO_TICK(CONFIG_CC_KVS_WRITE_DELAY_MS)) != 0){
+        }
+        cc_hal_kvs_flush();
+#if CONFIG_CC_KVS_SNAPSHOT
+        __snap_rebuild();
+#endif
+    }
+}
+
+static void __kvs_shutdown(void){
+    // 重启路径上不能无限等待，拿不到锁就放弃未落盘的写入
+    if(cc_hal_os_semphr_take(s_lock, CC_OS_MS_TO_TICK(KVS_SHUTDOWN_WAIT_MS)) == CC_OK){
+        __flush_locked();
+        cc_hal_os_semphr_give(s_lock);
+    }
+}
 
 cc_err_t cc_hal_kvs_init(void){
 	esp_err_t ret = ESP_OK;
@@ -33,6 +409,35 @@ cc_err_t cc_hal_kvs_init(void){
                 break;
             }
 
+            ret = nvs_open_from_partition(NVS_PARTITION_NAME, NVS_KV, NVS_READWRITE, &s_handle);
+            if (ret != ESP_OK) {
+                CC_LOGE(TAG, "nvs open %s failed with %x", NVS_KV, ret);
+                break;
+            }
+
+            s_lock = cc_hal_os_semphr_create_mutex_static(&s_lock_buf);
+            if (s_lock == NULL) {
+                nvs_close(s_handle);
+                ret = ESP_ERR_NO_MEM;
+                break;
+            }
+
+            // 写入任务创建失败时退化为直接写 flash
+            if (cc_hal_os_task_create(__kvs_writer_task, "kvs_writer", KVS_WRITER_STACK_SIZE, NULL,
+                                      KVS_WRITER_PRIORITY, &s_writer) != CC_OK) {
+                CC_LOGE(TAG, "kvs writer task create failed");
+                s_writer = NULL;
+            } else {
+                esp_register_shutdown_handler(__kvs_shutdown);
+            }
+
+#if CONFIG_CC_KVS_SNAPSHOT
+            __snap_init();
+            if (s_snap_stale && s_writer) {
+                xTaskNotifyGive(s_writer);
+            }
+#endif
+
             s_kv_init_flag = true;
         }
     } while (0);
@@ -41,139 +446,255 @@ cc_err_t cc_hal_kvs_init(void){
 }
 
 cc_err_t cc_hal_kvs_get(const char *key, void *value_buf, size_t *buf_len){
-    nvs_handle handle;
     esp_err_t ret;
-
-    char key_name[16] = {0};
+    _kvs_entry_t *entry;
+    char key_name[NVS_KEY_NAME_MAX_SIZE];
 
     if (key == NULL || value_buf == NULL || buf_len == NULL) {
         CC_LOGE(TAG, "HAL_Kvs_Get Null params");
         return CC_FAIL;
     }
 
-    if (cc_hal_kvs_init() != ESP_OK) {
+    if (cc_hal_kvs_init() != CC_OK) {
         return CC_FAIL;
     }
 
-    ret = nvs_open_from_partition(NVS_PARTITION_NAME, NVS_KV, NVS_READONLY, &handle);
-
-    if (ret != ESP_OK) {
-        CC_LOGW(TAG, "nvs open %s failed with %x", NVS_KV, ret);
-        return CC_FAIL;
+    __key_name(key_name, key);
+
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+#if CONFIG_CC_KVS_SNAPSHOT
+    if (s_snap) {
+        // 快照包含命名空间的全部键，查不到即不存在
+        const _kvs_snap_entry_t *snap = __snap_find(key_name);
+        if (snap == NULL) {
+            ret = ESP_ERR_NVS_NOT_FOUND;
+        } else if (*buf_len < snap->len) {
+            ret = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(value_buf, (const uint8_t *)s_snap + snap->offset, snap->len);
+            *buf_len = snap->len;
+            ret = ESP_OK;
+        }
+        cc_hal_os_semphr_give(s_lock);
+        return (ret==ESP_OK)?CC_OK:CC_FAIL;
+    }
+#endif
+    entry = __cache_find(key_name);
+    if (entry) {
+        if (entry->absent) {
+            ret = ESP_ERR_NVS_NOT_FOUND;
+        } else if (*buf_len < entry->len) {
+            ret = ESP_ERR_NVS_INVALID_LENGTH;
+        } else {
+            memcpy(value_buf, entry->value, entry->len);
+            *buf_len = entry->len;
+            ret = ESP_OK;
+        }
+    } else {
+        ret = nvs_get_blob(s_handle, key_name, value_buf, buf_len);
+        if (ret == ESP_OK && *buf_len <= CONFIG_CC_KVS_CACHE_VALUE_MAX) {
+            entry = __cache_claim(key_name);
+            if (entry && __cache_store(entry, value_buf, *buf_len) != CC_OK) {
+                __cache_drop(entry);
+            }
+        } else if (ret == ESP_ERR_NVS_NOT_FOUND) {
+            __cache_claim(key_name);
+        }
     }
-    /*max key name is 15UL*/
-    memcpy(key_name, key, sizeof(key_name) - 1);
-    CC_LOGI(TAG, "Get %s blob", key_name);
-    ret = nvs_get_blob(handle, key_name, value_buf, (size_t *) buf_len);
+    cc_hal_os_semphr_give(s_lock);
 
-    if (ret != ESP_OK) {
+    if (ret == ESP_ERR_NVS_NOT_FOUND) {
+        CC_LOGD(TAG, "nvs blob %s not found", key_name);
+    } else if (ret != ESP_OK) {
         CC_LOGW(TAG, "nvs get blob %s failed with %x", key_name, ret);
     }
 
-    nvs_close(handle);
-
     return (ret==ESP_OK)?CC_OK:CC_FAIL;
 }
 
 cc_err_t cc_hal_kvs_set(const char *key, const void *value_buf, size_t buf_len){
-    nvs_handle handle;
     esp_err_t ret;
-
-    char key_name[16] = {0};
+    _kvs_entry_t *entry;
+    char key_name[NVS_KEY_NAME_MAX_SIZE];
 
     if (key == NULL || value_buf == NULL || buf_len <= 0) {
         CC_LOGE(TAG, "HAL_Kvs_Set NULL params");
         return CC_FAIL;
     }
 
-    if (cc_hal_kvs_init() != ESP_OK) {
+    if (cc_hal_kvs_init() != CC_OK) {
         return CC_FAIL;
     }
 
-    ret = nvs_open_from_partition(NVS_PARTITION_NAME, NVS_KV, NVS_READWRITE, &handle);
+    __key_name(key_name, key);
 
-    if (ret != ESP_OK) {
-        CC_LOGE(TAG, "nvs open %s failed with %x", NVS_KV, ret);
-        return CC_FAIL;
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+#if CONFIG_CC_KVS_SNAPSHOT
+    if (s_snap) {
+        const _kvs_snap_entry_t *snap = __snap_find(key_name);
+        if (snap && snap->len == buf_len && memcmp((const uint8_t *)s_snap + snap->offset, value_buf, buf_len) == 0) {
+            cc_hal_os_semphr_give(s_lock);
+            return CC_OK;
+        }
+    }
+    __snap_invalidate_locked();
+#endif
+    entry = __cache_find(key_name);
+    if (buf_len <= CONFIG_CC_KVS_CACHE_VALUE_MAX) {
+        if (entry && !entry->absent && entry->len == buf_len && memcmp(entry->value, value_buf, buf_len) == 0) {
+            cc_hal_os_semphr_give(s_lock);
+            return CC_OK;
+        }
+        if (entry == NULL) {
+            entry = __cache_claim(key_name);
+        }
+        if (entry && __cache_store(entry, value_buf, buf_len) == CC_OK) {
+            entry->dirty = 1;
+            CC_LOGD(TAG, "Set %s blob", key_name);
+            if (s_writer) {
+                cc_hal_os_semphr_give(s_lock);
+                xTaskNotifyGive(s_writer);
+                return CC_OK;
+            }
+            __flush_locked();
+            ret = entry->dirty ? ESP_FAIL : ESP_OK;
+            cc_hal_os_semphr_give(s_lock);
+            return (ret==ESP_OK)?CC_OK:CC_FAIL;
+        }
     }
-    /*max key name is 15UL*/
-    memcpy(key_name, key, sizeof(key_name) - 1);
+    // 不进缓存的值直接写 flash，旧的缓存（包括未落盘的值）作废
+    if (entry) {
+        __cache_drop(entry);
+    }
+
     CC_LOGI(TAG, "Set %s blob", key_name);
-    ret = nvs_set_blob(handle, key_name, value_buf, buf_len);
+    ret = nvs_set_blob(s_handle, key_name, value_buf, buf_len);
 
     if (ret != ESP_OK) {
-        CC_LOGE(TAG, "nvs erase key %s failed with %x", key_name, ret);
+        CC_LOGE(TAG, "nvs set blob %s failed with %x", key_name, ret);
     } else {
-        nvs_commit(handle);
+        nvs_commit(s_handle);
     }
-
-    nvs_close(handle);
+    cc_hal_os_semphr_give(s_lock);
 
     return (ret==ESP_OK)?CC_OK:CC_FAIL;
 }
 
 cc_err_t cc_hal_kvs_del(const char *key){
-    nvs_handle handle;
     esp_err_t ret;
-
-    char key_name[16] = {0};
+    _kvs_entry_t *entry;
+    bool pending;
+    char key_name[NVS_KEY_NAME_MAX_SIZE];
 
     if (key == NULL) {
         CC_LOGE(TAG, "HAL_Kvs_Del Null key");
         return CC_FAIL;
     }
 
-    if (cc_hal_kvs_init() != ESP_OK) {
+    if (cc_hal_kvs_init() != CC_OK) {
         return CC_FAIL;
     }
 
-    ret = nvs_open_from_partition(NVS_PARTITION_NAME, NVS_KV, NVS_READWRITE, &handle);
+    __key_name(key_name, key);
 
-    if (ret != ESP_OK) {
-        CC_LOGE(TAG, "nvs open %s failed with %x", NVS_KV, ret);
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+#if CONFIG_CC_KVS_SNAPSHOT
+    if (s_snap && __snap_find(key_name) == NULL) {
+        cc_hal_os_semphr_give(s_lock);
+        return CC_FAIL;
+    }
+    __snap_invalidate_locked();
+#endif
+    entry = __cache_find(key_name);
+    pending = entry && entry->dirty;
+    if (entry && entry->absent && !pending) {
+        // 已知不存在，不必访问 flash
+        cc_hal_os_semphr_give(s_lock);
         return CC_FAIL;
     }
 
-    /*max key name is 15UL*/
-    memcpy(key_name, key, sizeof(key_name) - 1);
     CC_LOGI(TAG, "Del %s blob", key_name);
-    ret = nvs_erase_key(handle, key_name);
+    ret = nvs_erase_key(s_handle, key_name);
 
-    if (ret != ESP_OK) {
+    if (ret == ESP_ERR_NVS_NOT_FOUND && pending) {
+        // 只存在于缓存中，尚未落盘
+        ret = ESP_OK;
+    } else if (ret != ESP_OK) {
         CC_LOGE(TAG, "nvs erase key %s failed with %x", key_name, ret);
     } else {
-        nvs_commit(handle);
+        nvs_commit(s_handle);
     }
 
-    nvs_close(handle);
+    if (ret == ESP_OK || ret == ESP_ERR_NVS_NOT_FOUND) {
+        if (entry == NULL) {
+            entry = __cache_claim(key_name);
+        }
+        if (entry) {
+            entry->absent = 1;
+            entry->dirty = 0;
+            entry->len = 0;
+        }
+    }
+    cc_hal_os_semphr_give(s_lock);
 
     return (ret==ESP_OK)?CC_OK:CC_FAIL;
 }
 
 cc_err_t cc_hal_kvs_del_all(void){
-    nvs_handle handle;
     esp_err_t ret;
 
-    if (cc_hal_kvs_init() != ESP_OK) {
+    if (cc_hal_kvs_init() != CC_OK) {
         return CC_FAIL;
     }
 
-    ret = nvs_open_from_partition(NVS_PARTITION_NAME, NVS_KV, NVS_READWRITE, &handle);
-
-    if (ret != ESP_OK) {
-        CC_LOGE(TAG, "nvs open %s failed with %x", NVS_KV, ret);
-        return CC_FAIL;
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+#if CONFIG_CC_KVS_SNAPSHOT
+    __snap_invalidate_locked();
+#endif
+    for (uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++) {
+        __cache_drop(&s_cache[i]);
     }
 
-    ret = nvs_erase_all(handle);
+    ret = nvs_erase_all(s_handle);
 
     if (ret != ESP_OK) {
         CC_LOGE(TAG, "nvs erase all failed with %x", ret);
     } else {
-        nvs_commit(handle);
+        nvs_commit(s_handle);
     }
-
-    nvs_close(handle);
+    cc_hal_os_semphr_give(s_lock);
 
     return (ret==ESP_OK)?CC_OK:CC_FAIL;
-}
\ No newline at end of file
+}
+
+cc_err_t cc_hal_kvs_flush(void){
+    if (cc_hal_kvs_init() != CC_OK) {
+        return CC_FAIL;
+    }
+
+    cc_hal_os_semphr_take(s_lock, CC_OS_MAX_DELAY);
+    __flush_locked();
+    bool dirty = false;
+    for (uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++) {
+        dirty |= s_cache[i].used && s_cache[i].dirty;
+    }
+    cc_hal_os_semphr_give(s_lock);
+
+    return dirty ? CC_FAIL : CC_OK;
+}
+
+cc_err_t cc_hal_kvs_foreach_dirty(cc_hal_kvs_dirty_cb_t cb, void *arg, uint32_t wait_ms){
+    if(s_lock == NULL){
+        return CC_ERR_INVALID_STATE;
+    }
+    if(cc_hal_os_semphr_take(s_lock, CC_OS_MS_TO_TICK(wait_ms)) != CC_OK){
+        return CC_ERR_TIMEOUT;
+    }
+    for(uint8_t i = 0; i < CONFIG_CC_KVS_CACHE_NUM; i++){
+        if(s_cache[i].used && s_cache[i].dirty){
+            cb(s_cache[i].key, s_cache[i].value, s_cache[i].len, arg);
+        }
+    }
+    cc_hal_os_semphr_give(s_lock);
+    return CC_OK;
+}
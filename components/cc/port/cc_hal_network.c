@@ -3,10 +3,13 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 
 #include "cc_log.h"
 #include "cc_hal_os.h"
 #include "cc_hal_sys.h"
+#include "cc_hal_kvs.h"
+#include "cc_worker.h"
 
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
@@ -20,20 +23,20 @@
 #include <lwip/sockets.h>
 
 #include "mqtt_client.h"
+#include "esp_netif.h"
+#include "esp_timer.h"
 
 #include "cc_list.h"
 
 #include "rbuffer.h"
 
 
-#define CONFIG_HTTP_STACK_SIZE          3072
+#define CONFIG_HTTP_STACK_SIZE          CC_OS_STACK_HAL_HTTP
 #define CONFIG_HTTP_STACK_PRIORITY      4
 
 #define CONFIG_TCPC_STACK_SIZE          3072+512
 #define CONFIG_TCPC_STACK_PRIORITY      4
 
-#define CONFIG_TCPS_STACK_SIZE          3072
-#define CONFIG_TCPS_STACK_PRIORITY      4
 #define CONFIG_TCPS_MAX_SOCKETS         64
 
 #define CONFIG_UDP_STACK_SIZE           4096
@@ -42,26 +45,16 @@
 #define CONFIG_MQTT_STACK_SIZE           4096
 #define CONFIG_MQTT_STACK_PRIORITY       4
 #define CONFIG_MQTT_MSG_LEN_MAX          (512)
+#define CONFIG_MQTT_REASM_LEN_MAX        (16 * 1024)    // 分片重组后的最大消息长度，超出则丢弃
+#define CONFIG_MQTT_TOPIC_LEN_MAX        (128)
 
 static char *TAG = "hal_network";
 
-typedef struct {
-    cc_http_t *http;
-    TaskHandle_t task;
-}_http_ctx_t;
-
-static cc_list_node* g_http_list = NULL;
-
-static int __find_by_http(cc_list_node* node, void* arg){
-    _http_ctx_t *http_ctx = node->data;
-    cc_http_t *http = (cc_http_t *)arg;
-    if(http_ctx && http_ctx->http == http){
-        return 1;
-    }
-
-    return 0;
-}
+// 所有 HTTP 请求由同一个工作任务按顺序执行，不再为每个请求创建任务
+#define CONFIG_HTTP_QUEUE_LEN           8
 
+static QueueHandle_t g_http_queue = NULL;
+static cc_os_task_handle_t g_http_task = NULL;
 
 static void http_event_cb(http_client_t *client, HTTP_EVENT event, void *data){
     cc_http_t *http = (cc_http_t *)client->user_arg;
@@ -127,10 +120,7 @@ static void http_close_cb(http_client_t *client){
 }
 
 
-static void http_task(void *arg){
-     
-    _http_ctx_t *http_ctx = (_http_ctx_t *)arg;
-    cc_http_t *http = http_ctx->http;
+static void __http_request(cc_http_t *http){
 
     http_client_t http_client = {0};
     http_client_data_t client_data = {0};
@@ -161,15 +151,40 @@ static void http_task(void *arg){
     if(http->close_cb){
         http->close_cb(http->arg, http_client.response_code);
     }
+}
 
-    http_ctx->task = NULL;
-
-    cc_list_remove_by_data(&g_http_list, http_ctx);
-    cc_hal_sys_free(http_ctx);
+static void http_task(void *arg){
+    cc_http_t *http = NULL;
 
-    cc_hal_os_task_delete(NULL);
+    while(1){
+        if(xQueueReceive(g_http_queue, &http, portMAX_DELAY) == pdTRUE && http){
+            __http_request(http);
+        }
+    }
 }
 
+cc_err_t cc_hal_http_init(void){
+
+    if(NULL != g_http_queue){
+        return CC_OK;
+    }
+
+    cc_hal_dns_init();
+
+    g_http_queue = xQueueCreate(CONFIG_HTTP_QUEUE_LEN, sizeof(cc_http_t *));
+    if(NULL == g_http_queue){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+
+    if(CC_OK != cc_hal_os_task_create(http_task, "hal_http", CONFIG_HTTP_STACK_SIZE, NULL, CONFIG_HTTP_STACK_PRIORITY, &g_http_task)){
+        vQueueDelete(g_http_queue);
+        g_http_queue = NULL;
+        CC_LOGE(TAG, "http task create error");
+        return CC_FAIL;
+    }
+    return CC_OK;
+}
 
 cc_err_t cc_hal_http_connect(cc_http_t *http){
 
@@ -177,54 +192,718 @@ cc_err_t cc_hal_http_connect(cc_http_t *http){
         return CC_FAIL;
     }
 
-    if(NULL != g_http_list){
-        if(NULL != cc_list_find(g_http_list, __find_by_http, (void *)http)){
-            return CC_FAIL;
-        }
+    if(NULL == g_http_queue){
+        CC_LOGE(TAG, "hal http not init");
+        return CC_FAIL;
     }
 
-    _http_ctx_t *http_ctx = cc_hal_sys_malloc(sizeof(_http_ctx_t));
-    if(NULL == http_ctx){
+    if(xQueueSend(g_http_queue, &http, 0) != pdTRUE){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
         return CC_ERR_NO_MEM;
     }
+    return CC_OK;
+}
+
+/*
+ * DNS 缓存：表项按最近使用淘汰；查询、更新只在自旋锁内拷贝，阻塞的 gethostbyname 在锁外执行。
+ * lwIP 的解析接口不返回记录 TTL，表项统一按 CONFIG_CC_DNS_TTL_S 过期；
+ * 从 KVS 加载的表项没有可信的时间，视为已过期：先尝试实时解析，失败时才使用。
+ * 只有地址变化或新增主机时才写 KVS，不会每次刷新都写 flash。
+ */
+#if CONFIG_CC_DNS_CACHE_NUM > 0
+
+#define DNS_KVS_KEY                 "cc_dns"
+#define DNS_HOST_LEN_MAX            48
+#define DNS_TTL_US                  ((int64_t)CONFIG_CC_DNS_TTL_S * 1000000)
+
+typedef struct {
+    char host[DNS_HOST_LEN_MAX];
+    uint32_t ip;                    // 0 表示地址已失效
+    uint8_t prefetch;
+}_dns_saved_t;
+
+typedef struct {
+    _dns_saved_t saved;
+    int64_t expire_us;              // 0 表示已过期
+    int64_t used_us;
+    uint8_t refreshing;
+}_dns_entry_t;
+
+static _dns_entry_t g_dns[CONFIG_CC_DNS_CACHE_NUM];
+static cc_os_spinlock_t g_dns_lock = CC_OS_SPINLOCK_INIT;
+static uint8_t g_dns_inited = 0;
+
+static _dns_entry_t *__dns_find_locked(const char *host){
+    for(int i = 0; i < CONFIG_CC_DNS_CACHE_NUM; i++){
+        if(g_dns[i].saved.host[0] && strcmp(g_dns[i].saved.host, host) == 0){
+            return &g_dns[i];
+        }
+    }
+    return NULL;
+}
+
+// 空位优先，否则淘汰最久未用的非预取表项，都是预取表项时淘汰最久未用的
+static _dns_entry_t *__dns_alloc_locked(const char *host){
+    _dns_entry_t *victim = NULL;
+    for(int i = 0; i < CONFIG_CC_DNS_CACHE_NUM; i++){
+        _dns_entry_t *entry = &g_dns[i];
+        if(entry->saved.host[0] == '\0'){
+            victim = entry;
+            break;
+        }
+        if(victim == NULL || (victim->saved.prefetch && !entry->saved.prefetch)
+                || (victim->saved.prefetch == entry->saved.prefetch && entry->used_us < victim->used_us)){
+            victim = entry;
+        }
+    }
+    memset(victim, 0, sizeof(_dns_entry_t));
+    strncpy(victim->saved.host, host, DNS_HOST_LEN_MAX - 1);
+    return victim;
+}
 
-    http_ctx->http = http;
+static void __dns_save(void){
+    _dns_saved_t saved[CONFIG_CC_DNS_CACHE_NUM];
 
-    uint8_t cnt = 0;
-    cc_list_node *node = g_http_list;
-    while(node){
-        cnt++;
-        if(NULL != node){
-            node = node->next;
+    cc_hal_os_enter_critical(&g_dns_lock);
+    for(int i = 0; i < CONFIG_CC_DNS_CACHE_NUM; i++){
+        saved[i] = g_dns[i].saved;
+    }
+    cc_hal_os_exit_critical(&g_dns_lock);
+    cc_hal_kvs_set(DNS_KVS_KEY, saved, sizeof(saved));
+}
+
+static uint8_t __dns_is_ip(const char *host, uint32_t *ip){
+    struct in_addr addr;
+    if(inet_aton(host, &addr)){
+        *ip = addr.s_addr;
+        return 1;
+    }
+    return 0;
+}
+
+// 实时解析并更新缓存，失败返回 CC_FAIL，不修改缓存
+static cc_err_t __dns_lookup(const char *host, uint32_t *ip){
+    struct addrinfo hints, *res = NULL;
+    uint8_t changed = 0;
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    int64_t start = esp_timer_get_time();
+    if(getaddrinfo(host, NULL, &hints, &res) != 0 || res == NULL){
+        CC_LOGW(TAG, "dns %s fail", host);
+        return CC_FAIL;
+    }
+    *ip = ((struct sockaddr_in *)res->ai_addr)->sin_addr.s_addr;
+    freeaddrinfo(res);
+
+    int64_t now = esp_timer_get_time();
+    CC_LOGD(TAG, "dns %s in %lld ms", host, (now - start) / 1000);
+    if(strlen(host) >= DNS_HOST_LEN_MAX){
+        return CC_OK;
+    }
+    cc_hal_os_enter_critical(&g_dns_lock);
+    _dns_entry_t *entry = __dns_find_locked(host);
+    if(entry == NULL){
+        entry = __dns_alloc_locked(host);
+        changed = 1;
+    }
+    if(entry->saved.ip != *ip){
+        entry->saved.ip = *ip;
+        changed = 1;
+    }
+    entry->expire_us = now + DNS_TTL_US;
+    entry->used_us = now;
+    entry->refreshing = 0;
+    cc_hal_os_exit_critical(&g_dns_lock);
+    if(changed){
+        __dns_save();
+    }
+    return CC_OK;
+}
+
+static void __dns_refresh_job(void *arg){
+    char *host = (char *)arg;
+    uint32_t ip;
+    if(__dns_lookup(host, &ip) != CC_OK){
+        cc_hal_os_enter_critical(&g_dns_lock);
+        _dns_entry_t *entry = __dns_find_locked(host);
+        if(entry){
+            entry->refreshing = 0;
+        }
+        cc_hal_os_exit_critical(&g_dns_lock);
+    }
+    cc_hal_sys_free(host);
+}
+
+// 后台刷新，同一主机同时只有一个刷新作业
+static void __dns_refresh(const char *host){
+    char *arg = NULL;
+
+    cc_hal_os_enter_critical(&g_dns_lock);
+    _dns_entry_t *entry = __dns_find_locked(host);
+    if(entry && entry->refreshing){
+        cc_hal_os_exit_critical(&g_dns_lock);
+        return;
+    }
+    if(entry){
+        entry->refreshing = 1;
+    }
+    cc_hal_os_exit_critical(&g_dns_lock);
+
+    arg = cc_hal_sys_malloc_caps(strlen(host) + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
+    if(arg){
+        strcpy(arg, host);
+        if(cc_worker_submit(__dns_refresh_job, arg, CC_WORKER_PRIO_LOW) == CC_OK){
+            return;
+        }
+        cc_hal_sys_free(arg);
+    }
+    cc_hal_os_enter_critical(&g_dns_lock);
+    entry = __dns_find_locked(host);
+    if(entry){
+        entry->refreshing = 0;
+    }
+    cc_hal_os_exit_critical(&g_dns_lock);
+}
+
+cc_err_t cc_hal_dns_resolve(const char *host, uint32_t *ip){
+    uint32_t stale = 0;
+    uint8_t hit = 0;
+    uint8_t refresh = 0;
+
+    if(host == NULL || ip == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(__dns_is_ip(host, ip)){
+        return CC_OK;
+    }
+    cc_hal_dns_init();
+
+    int64_t now = esp_timer_get_time();
+    cc_hal_os_enter_critical(&g_dns_lock);
+    _dns_entry_t *entry = __dns_find_locked(host);
+    if(entry && entry->saved.ip){
+        entry->used_us = now;
+        if(entry->expire_us > now){
+            *ip = entry->saved.ip;
+            hit = 1;
+            refresh = entry->expire_us - now < DNS_TTL_US / 4;
         }else{
+            stale = entry->saved.ip;
+        }
+    }
+    cc_hal_os_exit_critical(&g_dns_lock);
+
+    if(hit){
+        if(refresh){
+            __dns_refresh(host);
+        }
+        return CC_OK;
+    }
+    if(__dns_lookup(host, ip) == CC_OK){
+        return CC_OK;
+    }
+    if(stale){
+        CC_LOGW(TAG, "dns %s use stale " IPSTR, host, IP2STR((esp_ip4_addr_t *)&stale));
+        *ip = stale;
+        return CC_OK;
+    }
+    return CC_FAIL;
+}
+
+void cc_hal_dns_invalidate(const char *host){
+    if(host == NULL){
+        return;
+    }
+    cc_hal_os_enter_critical(&g_dns_lock);
+    _dns_entry_t *entry = __dns_find_locked(host);
+    if(entry){
+        entry->saved.ip = 0;
+        entry->expire_us = 0;
+    }
+    cc_hal_os_exit_critical(&g_dns_lock);
+}
+
+cc_err_t cc_hal_dns_prefetch(const char *host_or_url){
+    char host[DNS_HOST_LEN_MAX];
+    const char *start = host_or_url;
+    uint32_t ip;
+    uint8_t added = 0;
+
+    if(host_or_url == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    // URL 取 "://" 之后到 ':' '/' '?' 之前的部分
+    const char *scheme = strstr(host_or_url, "://");
+    if(scheme){
+        start = scheme + 3;
+    }
+    size_t len = strcspn(start, ":/?");
+    if(len == 0 || len >= DNS_HOST_LEN_MAX){
+        return CC_ERR_INVALID_ARG;
+    }
+    memcpy(host, start, len);
+    host[len] = '\0';
+    if(__dns_is_ip(host, &ip)){
+        return CC_OK;
+    }
+    cc_hal_dns_init();
+
+    cc_hal_os_enter_critical(&g_dns_lock);
+    _dns_entry_t *entry = __dns_find_locked(host);
+    if(entry == NULL){
+        entry = __dns_alloc_locked(host);
+        added = 1;
+    }
+    if(!entry->saved.prefetch){
+        entry->saved.prefetch = 1;
+        added = 1;
+    }
+    uint8_t fresh = entry->expire_us > esp_timer_get_time();
+    cc_hal_os_exit_critical(&g_dns_lock);
+
+    if(added){
+        __dns_save();
+    }
+    if(!fresh){
+        __dns_refresh(host);
+    }
+    return CC_OK;
+}
+
+// 拿到 IP（包括换了网络）后，预取的主机全部重新解析
+static void __dns_ip_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data){
+    char host[DNS_HOST_LEN_MAX];
+
+    for(int i = 0; i < CONFIG_CC_DNS_CACHE_NUM; i++){
+        host[0] = '\0';
+        cc_hal_os_enter_critical(&g_dns_lock);
+        if(g_dns[i].saved.prefetch){
+            strcpy(host, g_dns[i].saved.host);
+        }
+        cc_hal_os_exit_critical(&g_dns_lock);
+        if(host[0]){
+            __dns_refresh(host);
+        }
+    }
+}
+
+static int __dns_http_resolve(const char *host, uint32_t *ip){
+    return cc_hal_dns_resolve(host, ip) == CC_OK ? 0 : -1;
+}
+
+static const http_client_resolver_t g_dns_http_resolver = {
+    .resolve = __dns_http_resolve,
+    .failed = cc_hal_dns_invalidate,
+};
+
+cc_err_t cc_hal_dns_init(void){
+    _dns_saved_t saved[CONFIG_CC_DNS_CACHE_NUM];
+    size_t len = sizeof(saved);
+
+    if(g_dns_inited){
+        return CC_OK;
+    }
+    g_dns_inited = 1;
+
+    memset(g_dns, 0, sizeof(g_dns));
+    if(cc_hal_kvs_get(DNS_KVS_KEY, saved, &len) == CC_OK && len == sizeof(saved)){
+        for(int i = 0; i < CONFIG_CC_DNS_CACHE_NUM; i++){
+            saved[i].host[DNS_HOST_LEN_MAX - 1] = '\0';
+            g_dns[i].saved = saved[i];
+        }
+    }
+    http_client_set_resolver(&g_dns_http_resolver);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, __dns_ip_event_handler, NULL);
+    esp_event_handler_register(IP_EVENT, IP_EVENT_PPP_GOT_IP, __dns_ip_event_handler, NULL);
+    return CC_OK;
+}
+
+#else
+
+cc_err_t cc_hal_dns_init(void){
+    return CC_OK;
+}
+
+cc_err_t cc_hal_dns_resolve(const char *host, uint32_t *ip){
+    struct hostent *hostinfo;
+
+    if(host == NULL || ip == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    hostinfo = gethostbyname(host);
+    if(hostinfo == NULL){
+        return CC_FAIL;
+    }
+    memcpy(ip, hostinfo->h_addr, sizeof(uint32_t));
+    return CC_OK;
+}
+
+cc_err_t cc_hal_dns_prefetch(const char *host_or_url){
+    return CC_OK;
+}
+
+void cc_hal_dns_invalidate(const char *host){
+}
+
+#endif // CONFIG_CC_DNS_CACHE_NUM
+
+/*
+ * 网络事件循环：登记的 socket 在同一个任务中 select()，就绪后调用各自的回调。
+ * - 登记集合只在 watch/set_events/unwatch 时重建，并同时重算 max fd，每轮只拷贝 fd_set
+ * - 其他任务修改登记或投递任务后，经 loopback UDP 控制 socket 唤醒 select
+ * - 回调都在事件循环任务中执行，可共用 cc_hal_net_rx_buf() 返回的接收缓冲
+ */
+#define CONFIG_NET_LOOP_STACK_SIZE      CC_OS_STACK_NET_LOOP
+#define CONFIG_NET_LOOP_PRIORITY        4
+#define CONFIG_NET_WATCH_MAX            16
+#define CONFIG_NET_POST_QUEUE_LEN       8
+#define CONFIG_NET_RX_BUF_SIZE          1460
+
+typedef struct {
+    int fd;
+    uint8_t events;
+    cc_net_io_cb_t cb;
+    void *arg;
+}_net_watch_t;
+
+typedef struct {
+    cc_net_post_cb_t cb;
+    void *arg;
+}_net_post_t;
+
+enum {
+    NET_LOOP_NONE = 0,
+    NET_LOOP_INITING,
+    NET_LOOP_READY,
+};
+
+static _net_watch_t g_net_watch[CONFIG_NET_WATCH_MAX];
+static fd_set g_net_rset;
+static fd_set g_net_wset;
+static int g_net_max_fd = -1;
+static cc_os_spinlock_t g_net_lock = CC_OS_SPINLOCK_INIT;
+static volatile uint8_t g_net_state = NET_LOOP_NONE;
+static QueueHandle_t g_net_post_queue = NULL;
+static cc_os_task_handle_t g_net_task = NULL;
+static int g_net_ctrl_fd = -1;
+static struct sockaddr_in g_net_ctrl_addr;
+static uint8_t *g_net_rx_buf = NULL;
+
+static uint8_t __net_in_loop(void){
+    return g_net_task != NULL && xTaskGetCurrentTaskHandle() == g_net_task;
+}
+
+static void __net_wakeup(void){
+    uint8_t byte = 0;
+    sendto(g_net_ctrl_fd, &byte, sizeof(byte), 0, (struct sockaddr *)&g_net_ctrl_addr, sizeof(g_net_ctrl_addr));
+}
+
+// 持锁调用
+static void __net_rebuild(void){
+    FD_ZERO(&g_net_rset);
+    FD_ZERO(&g_net_wset);
+    FD_SET(g_net_ctrl_fd, &g_net_rset);
+    g_net_max_fd = g_net_ctrl_fd;
+    for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+        _net_watch_t *watch = &g_net_watch[i];
+        if(watch->fd < 0){
+            continue;
+        }
+        if(watch->events & CC_NET_EV_READ){
+            FD_SET(watch->fd, &g_net_rset);
+        }
+        if(watch->events & CC_NET_EV_WRITE){
+            FD_SET(watch->fd, &g_net_wset);
+        }
+        if(watch->fd > g_net_max_fd){
+            g_net_max_fd = watch->fd;
+        }
+    }
+}
+
+static void __net_loop_task(void *arg){
+    uint8_t drain[8];
+
+    while (1){
+        fd_set rset, wset;
+        int max_fd;
+
+        cc_hal_os_enter_critical(&g_net_lock);
+        rset = g_net_rset;
+        wset = g_net_wset;
+        max_fd = g_net_max_fd;
+        cc_hal_os_exit_critical(&g_net_lock);
+
+        int ret = select(max_fd + 1, &rset, &wset, NULL, NULL);
+        if(ret < 0){
+            // 其他任务关闭了登记中的 fd 时会走到这里，下一轮重新取集合即可
+            if(errno != EBADF && errno != EINTR){
+                CC_LOGE(TAG, "net loop select errno:%d", errno);
+                cc_hal_os_task_delay(10 / CC_OS_TICK_PERIOD_MS);
+            }
+            continue;
+        }
+
+        if(FD_ISSET(g_net_ctrl_fd, &rset)){
+            while(recv(g_net_ctrl_fd, drain, sizeof(drain), MSG_DONTWAIT) > 0){
+            }
+        }
+
+        // 先执行投递的任务，其中关闭的 fd 不会再分发
+        _net_post_t post;
+        while(xQueueReceive(g_net_post_queue, &post, 0) == pdTRUE){
+            post.cb(post.arg);
+        }
+
+        for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+            cc_hal_os_enter_critical(&g_net_lock);
+            _net_watch_t watch = g_net_watch[i];
+            cc_hal_os_exit_critical(&g_net_lock);
+
+            if(watch.fd < 0){
+                continue;
+            }
+            uint8_t events = 0;
+            if((watch.events & CC_NET_EV_READ) && FD_ISSET(watch.fd, &rset)){
+                events |= CC_NET_EV_READ;
+            }
+            if((watch.events & CC_NET_EV_WRITE) && FD_ISSET(watch.fd, &wset)){
+                events |= CC_NET_EV_WRITE;
+            }
+            if(events){
+                watch.cb(watch.fd, events, watch.arg);
+            }
+        }
+    }
+}
+
+static cc_err_t __net_loop_init(void){
+    uint8_t state;
+
+    cc_hal_os_enter_critical(&g_net_lock);
+    state = g_net_state;
+    if(state == NET_LOOP_NONE){
+        g_net_state = NET_LOOP_INITING;
+    }
+    cc_hal_os_exit_critical(&g_net_lock);
+
+    if(state == NET_LOOP_READY){
+        return CC_OK;
+    }
+    if(state == NET_LOOP_INITING){
+        while(g_net_state == NET_LOOP_INITING){
+            cc_hal_os_task_delay(1);
+        }
+        return (g_net_state == NET_LOOP_READY) ? CC_OK : CC_FAIL;
+    }
+
+    for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+        g_net_watch[i].fd = -1;
+    }
+
+    g_net_rx_buf = cc_hal_sys_malloc_caps(CONFIG_NET_RX_BUF_SIZE, CC_MEM_CAP_INTERNAL, CC_MEM_MOD_NET);
+    g_net_post_queue = xQueueCreate(CONFIG_NET_POST_QUEUE_LEN, sizeof(_net_post_t));
+    g_net_ctrl_fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if(NULL == g_net_rx_buf || NULL == g_net_post_queue || g_net_ctrl_fd < 0){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        goto err;
+    }
+
+    socklen_t addr_len = sizeof(g_net_ctrl_addr);
+    memset(&g_net_ctrl_addr, 0, sizeof(g_net_ctrl_addr));
+    g_net_ctrl_addr.sin_family = AF_INET;
+    g_net_ctrl_addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    g_net_ctrl_addr.sin_port = 0;
+    if(bind(g_net_ctrl_fd, (struct sockaddr *)&g_net_ctrl_addr, sizeof(g_net_ctrl_addr)) != 0 ||
+       getsockname(g_net_ctrl_fd, (struct sockaddr *)&g_net_ctrl_addr, &addr_len) != 0){
+        CC_LOGE(TAG, "net loop ctrl socket errno:%d", errno);
+        goto err;
+    }
+
+    cc_hal_os_enter_critical(&g_net_lock);
+    __net_rebuild();
+    cc_hal_os_exit_critical(&g_net_lock);
+
+    if(cc_hal_os_task_create(__net_loop_task, "hal_net_loop", CONFIG_NET_LOOP_STACK_SIZE, NULL,
+                             CONFIG_NET_LOOP_PRIORITY, &g_net_task) != CC_OK){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        g_net_task = NULL;
+        goto err;
+    }
+
+    g_net_state = NET_LOOP_READY;
+    return CC_OK;
+
+err:
+    if(g_net_ctrl_fd >= 0){
+        close(g_net_ctrl_fd);
+        g_net_ctrl_fd = -1;
+    }
+    if(g_net_post_queue){
+        vQueueDelete(g_net_post_queue);
+        g_net_post_queue = NULL;
+    }
+    if(g_net_rx_buf){
+        cc_hal_sys_free(g_net_rx_buf);
+        g_net_rx_buf = NULL;
+    }
+    g_net_state = NET_LOOP_NONE;
+    return CC_FAIL;
+}
+
+cc_err_t cc_hal_net_watch(int fd, uint8_t events, cc_net_io_cb_t cb, void *arg){
+    if(fd < 0 || fd >= FD_SETSIZE || cb == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(__net_loop_init() != CC_OK){
+        return CC_FAIL;
+    }
+
+    cc_err_t err = CC_ERR_NO_MEM;
+    cc_hal_os_enter_critical(&g_net_lock);
+    _net_watch_t *slot = NULL;
+    for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+        if(g_net_watch[i].fd == fd){
+            slot = NULL;
+            err = CC_ERR_INVALID_STATE;
+            break;
+        }
+        if(g_net_watch[i].fd < 0 && slot == NULL){
+            slot = &g_net_watch[i];
+        }
+    }
+    if(slot){
+        slot->fd = fd;
+        slot->events = events;
+        slot->cb = cb;
+        slot->arg = arg;
+        __net_rebuild();
+        err = CC_OK;
+    }
+    cc_hal_os_exit_critical(&g_net_lock);
+
+    if(err != CC_OK){
+        CC_LOGE_CODE(TAG, err);
+    }else if(!__net_in_loop()){
+        __net_wakeup();
+    }
+    return err;
+}
+
+cc_err_t cc_hal_net_set_events(int fd, uint8_t events){
+    cc_err_t err = CC_ERR_NOT_FOUND;
+
+    if(g_net_state != NET_LOOP_READY){
+        return CC_ERR_INVALID_STATE;
+    }
+
+    cc_hal_os_enter_critical(&g_net_lock);
+    for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+        if(g_net_watch[i].fd == fd){
+            if(g_net_watch[i].events != events){
+                g_net_watch[i].events = events;
+                __net_rebuild();
+            }
+            err = CC_OK;
+            break;
+        }
+    }
+    cc_hal_os_exit_critical(&g_net_lock);
+
+    if(err == CC_OK && !__net_in_loop()){
+        __net_wakeup();
+    }
+    return err;
+}
+
+static void __net_close_cb(void *arg){
+    close((int)(intptr_t)arg);
+}
+
+cc_err_t cc_hal_net_close(int fd){
+    if(fd < 0){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(g_net_state != NET_LOOP_READY){
+        close(fd);
+        return CC_OK;
+    }
+
+    cc_hal_os_enter_critical(&g_net_lock);
+    for(int i = 0; i < CONFIG_NET_WATCH_MAX; i++){
+        if(g_net_watch[i].fd == fd){
+            g_net_watch[i].fd = -1;
+            __net_rebuild();
             break;
         }
     }
+    cc_hal_os_exit_critical(&g_net_lock);
+
+    if(__net_in_loop()){
+        close(fd);
+        return CC_OK;
+    }
+    // 事件循环可能正在 select 该 fd，交给它在本轮结束后关闭
+    return cc_hal_net_post(__net_close_cb, (void *)(intptr_t)fd);
+}
 
-   char task_name[] = "hal_http0";
-    task_name[sizeof("hal_http0") - 2] = cnt + '0'; 
-    cc_hal_os_task_create(http_task, task_name, CONFIG_HTTP_STACK_SIZE, http_ctx, CONFIG_HTTP_STACK_PRIORITY, &http_ctx->task);
+cc_err_t cc_hal_net_post(cc_net_post_cb_t cb, void *arg){
+    if(cb == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(__net_loop_init() != CC_OK){
+        return CC_FAIL;
+    }
+
+    _net_post_t post = {.cb = cb, .arg = arg};
+    if(xQueueSend(g_net_post_queue, &post, __net_in_loop() ? 0 : CC_OS_MS_TO_TICK(100)) != pdTRUE){
+        CC_LOGE_CODE(TAG, CC_ERR_TIMEOUT);
+        return CC_ERR_TIMEOUT;
+    }
+    __net_wakeup();
     return CC_OK;
 }
 
-#define TCPS_SELECT_TIMEOUT_MS 10
+uint8_t *cc_hal_net_rx_buf(uint16_t *size){
+    if(size){
+        *size = CONFIG_NET_RX_BUF_SIZE;
+    }
+    return g_net_rx_buf;
+}
+
+
+/*
+ * TCP 服务端挂在网络事件循环上，不再每个服务一个任务。
+ * 客户端 socket 为非阻塞；cc_hal_tcps_send 先直接发送，发不完的部分进入该客户端的发送缓冲，
+ * 由事件循环在可写时续发。缓冲放不下整条消息时返回 CC_ERR_NOT_RESOURCES，调用方稍后重试。
+ * 缓冲在客户端第一次发送前分配，分配失败时整条消息都不发送（CC_ERR_NO_MEM）。
+ */
+#define CONFIG_TCPS_TX_BUF_MAX          4096
+
+typedef struct _tcps_ctx _tcps_ctx_t;
 
 typedef struct {
     int sockfd;
-    cc_os_semphr_handle_t semphr;
+    uint8_t id;
+    _tcps_ctx_t *ctx;
+    uint8_t *tx_buf;
+    uint16_t tx_cap;
+    uint16_t tx_off;
+    uint16_t tx_len;
 }_tcps_client;
 
-typedef struct {
+struct _tcps_ctx {
     cc_tcps_t *tcps;
     int sockfd;
     _tcps_client *client_lsit;
     uint16_t port;
     uint8_t max_client;
-    cc_os_task_handle_t task;
+    cc_os_semphr_handle_t semphr;       // 保护各客户端的 sockfd 与发送缓冲
     uint8_t wait_delete;
     void *arg;
-}_tcps_ctx_t;
+};
 
 static cc_list_node* g_tcps_list = NULL;
 
@@ -238,165 +917,186 @@ static int __find_by_tcps(cc_list_node* node, void* arg){
     return 0;
 }
 
-void __tcps_task(void *arg){
-    _tcps_ctx_t *tcps_ctx = (_tcps_ctx_t *)arg;
-
-    int ret = 0;
-    uint8_t buf[1024] = {0};
+static void __tcps_client_close(_tcps_client *tcps_client, uint8_t notify){
+    _tcps_ctx_t *tcps_ctx = tcps_client->ctx;
 
-    while (1){
-        if ((tcps_ctx->sockfd = socket(AF_INET, SOCK_STREAM, 0)) < 0) {
-            CC_LOGE(TAG, "tcps create socket error");
-            cc_hal_os_task_delay(5000 / CC_OS_TICK_PERIOD_MS);
-            continue;
-        }
-
-        struct sockaddr_in server_addr;
-        memset(&server_addr, 0, sizeof(server_addr));
-        server_addr.sin_family = AF_INET;
-        server_addr.sin_port = htons(tcps_ctx->port);
-        server_addr.sin_addr.s_addr = INADDR_ANY;
+    cc_hal_os_semphr_take(tcps_ctx->semphr, CC_OS_MAX_DELAY);
+    int fd = tcps_client->sockfd;
+    tcps_client->sockfd = -1;
+    tcps_client->tx_off = 0;
+    tcps_client->tx_len = 0;
+    cc_hal_os_semphr_give(tcps_ctx->semphr);
 
+    if(fd < 0){
+        return;
+    }
+    cc_hal_net_close(fd);
+    CC_LOGD(TAG, "tcps disconnected client_id: %d", tcps_client->id);
 
-        if (bind(tcps_ctx->sockfd, (struct sockaddr *) &server_addr, sizeof(server_addr)) != 0) {
-            CC_LOGE(TAG, "tsps bind error");
-            close(tcps_ctx->sockfd);
-            cc_hal_os_task_delay(5000 / CC_OS_TICK_PERIOD_MS);
-            continue;
-        }
+    if(notify && tcps_ctx->tcps && tcps_ctx->tcps->disconnect_cb){
+        tcps_ctx->tcps->disconnect_cb(tcps_ctx->tcps->arg, tcps_client->id);
+    }
+}
 
-        if (listen(tcps_ctx->sockfd, tcps_ctx->max_client) != 0) {
-            CC_LOGE(TAG, "tsps listen error");
-            close(tcps_ctx->sockfd);
-            cc_hal_os_task_delay(5000 / CC_OS_TICK_PERIOD_MS);
-            continue;
+// 持锁调用，返回 -1 表示连接出错
+static int __tcps_client_flush(_tcps_client *tcps_client){
+    while(tcps_client->tx_len){
+        int send_len = send(tcps_client->sockfd, tcps_client->tx_buf + tcps_client->tx_off, tcps_client->tx_len, 0);
+        if(send_len < 0){
+            if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
+                break;
+            }
+            CC_LOGE(TAG, "tcps client: %d send error & errno:%d", tcps_client->id, errno);
+            return -1;
         }
+        tcps_client->tx_off += send_len;
+        tcps_client->tx_len -= send_len;
+    }
+    if(tcps_client->tx_len == 0){
+        tcps_client->tx_off = 0;
+        cc_hal_net_set_events(tcps_client->sockfd, CC_NET_EV_READ);
+    }
+    return 0;
+}
 
-        struct timeval timeout;
-        timeout.tv_sec = TCPS_SELECT_TIMEOUT_MS / 1000;
-        timeout.tv_usec = (TCPS_SELECT_TIMEOUT_MS % 1000) * 1000;
+static void __tcps_client_io(int fd, uint8_t events, void *arg){
+    _tcps_client *tcps_client = (_tcps_client *)arg;
+    _tcps_ctx_t *tcps_ctx = tcps_client->ctx;
 
-        int max_sockfd = tcps_ctx->sockfd;
+    if(tcps_ctx->wait_delete){
+        return;
+    }
 
-        while (1) {
-            fd_set set;
-            FD_ZERO(&set);
-            FD_SET(tcps_ctx->sockfd, &set);
+    if(events & CC_NET_EV_WRITE){
+        cc_hal_os_semphr_take(tcps_ctx->semphr, CC_OS_MAX_DELAY);
+        int ret = (tcps_client->sockfd == fd) ? __tcps_client_flush(tcps_client) : 0;
+        cc_hal_os_semphr_give(tcps_ctx->semphr);
+        if(ret < 0){
+            __tcps_client_close(tcps_client, 1);
+            return;
+        }
+    }
 
-            for (int i = 0; i < tcps_ctx->max_client; i ++){
-                if (tcps_ctx->client_lsit[i].sockfd != -1){
-                    FD_SET(tcps_ctx->client_lsit[i].sockfd, &set);
-                }
+    if(events & CC_NET_EV_READ){
+        uint16_t size = 0;
+        uint8_t *buf = cc_hal_net_rx_buf(&size);
+        int len = recv(fd, buf, size, 0);
+        if (len > 0){
+            // 调用接收回调函数处理接收到的数据，回调中可能删除服务端，之后不再访问 tcps_ctx
+            if (tcps_ctx->tcps && tcps_ctx->tcps->recv_cb){
+                tcps_ctx->tcps->recv_cb(tcps_ctx->tcps->arg, tcps_client->id, buf, len);
             }
+        }else if (len == 0){
+            __tcps_client_close(tcps_client, 1);
+        }else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR){
+            CC_LOGE(TAG, "tcps client: %d recv len < 0 & errno:%d", tcps_client->id, errno);
+            __tcps_client_close(tcps_client, 1);
+        }
+    }
+}
 
-            ret = select(max_sockfd + 1, &set, NULL, NULL, &timeout);
-            if (ret > 0){
-                if (FD_ISSET(tcps_ctx->sockfd, &set)){
-                    // 有数据可接收
-                    struct sockaddr_in client_addr;
-                    socklen_t client_addr_size = sizeof(client_addr);
-                    int fd = accept(tcps_ctx->sockfd, (struct sockaddr *) &client_addr, &client_addr_size);
-                    if (fd > 0) {
-                        int i = 0;
-                        for (i = 0; i < tcps_ctx->max_client; i++){
-                            if(tcps_ctx->client_lsit[i].sockfd == -1){
-                                tcps_ctx->client_lsit[i].sockfd = fd;
-                                CC_LOGD(TAG, "tcps connected client_id: %d", i);
-
-                                const struct timeval recv_timeout = { 1, 0 }; /* 1 second timeout */
-                                setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &recv_timeout, sizeof(recv_timeout));
-
-                                const struct timeval send_timeout = { 3, 0 }; /* 3 second timeout */
-                                setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &send_timeout, sizeof(send_timeout));
-
-                                if (tcps_ctx->tcps && tcps_ctx->tcps->connect_cb){
-                                    tcps_ctx->tcps->connect_cb(tcps_ctx->tcps->arg, i);
-                                }
-
-                                if (fd > max_sockfd){
-                                    max_sockfd = fd;
-                                }
-                                break;
-                            }
-                        }
-                        if(i == tcps_ctx->max_client){
-                            close(fd);
-                        }
-                    }else {
-                        CC_LOGE(TAG, "tcps accept error");
-                    }
-                }else{
-                    for (int i = 0; i < tcps_ctx->max_client; i ++){
-                        _tcps_client *tcps_client = &tcps_ctx->client_lsit[i];
-                        if(tcps_client->sockfd != -1 && FD_ISSET(tcps_client->sockfd, &set)){
-                            int len = recv(tcps_client->sockfd, buf, sizeof(buf), 0);
-                            if (len > 0){
-                                // 调用接收回调函数处理接收到的数据
-                                if (tcps_ctx->tcps && tcps_ctx->tcps->recv_cb){
-                                    tcps_ctx->tcps->recv_cb(tcps_ctx->tcps->arg, i, buf, len);
-                                }
-                            }else{
-                                uint8_t need_close = 0;
-                                if (len == 0){
-                                    // CC_LOGE(TAG, "tcps client: %d recv len = 0", i);
-                                    need_close = 1;
-                                }else{
-                                    if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) {
-                                        
-                                    } else {
-                                        CC_LOGE(TAG, "tcps client: %d recv len < 0 & errno:%d", i, errno);
-                                        need_close = 1;
-                                    }
-                                }
-                                if(need_close){
-                                    close(tcps_client->sockfd);
-                                    tcps_client->sockfd = -1;
-                                    if (tcps_ctx->tcps && tcps_ctx->tcps->disconnect_cb){
-                                        tcps_ctx->tcps->disconnect_cb(tcps_ctx->tcps->arg, i);
-                                    }
-                                    for (int i = 0; i < tcps_ctx->max_client; i ++){
-                                        if (tcps_ctx->client_lsit[i].sockfd != -1){
-                                            if (tcps_ctx->client_lsit[i].sockfd > max_sockfd){
-                                                max_sockfd = tcps_ctx->client_lsit[i].sockfd;
-                                            }
-                                        }
-                                    }
-                                }
-                            }
-                        }
-                    }
-                    
-                }
-            }
-            else if (ret == 0){
-                
-            }else{
-                break;
-            }
+static void __tcps_accept(int fd, uint8_t events, void *arg){
+    _tcps_ctx_t *tcps_ctx = (_tcps_ctx_t *)arg;
 
-            if(tcps_ctx->wait_delete){
-                break;
-            }
-            cc_hal_os_task_delay(10 / CC_OS_TICK_PERIOD_MS);
-        }
-        for (int i = 0; i < tcps_ctx->max_client; i ++){
-            _tcps_client *tcps_client = &tcps_ctx->client_lsit[i];
-            close(tcps_client->sockfd);
-            // if(tcps_client->semphr){
-            //     cc_hal_os_semphr_delete(tcps_client->semphr);
-            // }
+    struct sockaddr_in client_addr;
+    socklen_t client_addr_size = sizeof(client_addr);
+    int client_fd = accept(fd, (struct sockaddr *) &client_addr, &client_addr_size);
+    if (client_fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            CC_LOGE(TAG, "tcps accept error");
         }
-        close(tcps_ctx->sockfd);
-        
-        if(tcps_ctx->wait_delete){
+        return;
+    }
+
+    if(tcps_ctx->wait_delete){
+        close(client_fd);
+        return;
+    }
+
+    _tcps_client *tcps_client = NULL;
+    for (int i = 0; i < tcps_ctx->max_client; i++){
+        if(tcps_ctx->client_lsit[i].sockfd == -1){
+            tcps_client = &tcps_ctx->client_lsit[i];
             break;
         }
     }
+    if(NULL == tcps_client){
+        close(client_fd);
+        return;
+    }
+
+    fcntl(client_fd, F_SETFL, fcntl(client_fd, F_GETFL, 0) | O_NONBLOCK);
+    if(cc_hal_net_watch(client_fd, CC_NET_EV_READ, __tcps_client_io, tcps_client) != CC_OK){
+        close(client_fd);
+        return;
+    }
+
+    cc_hal_os_semphr_take(tcps_ctx->semphr, CC_OS_MAX_DELAY);
+    tcps_client->sockfd = client_fd;
+    tcps_client->tx_off = 0;
+    tcps_client->tx_len = 0;
+    cc_hal_os_semphr_give(tcps_ctx->semphr);
+
+    CC_LOGD(TAG, "tcps connected client_id: %d", tcps_client->id);
+    if (tcps_ctx->tcps && tcps_ctx->tcps->connect_cb){
+        tcps_ctx->tcps->connect_cb(tcps_ctx->tcps->arg, tcps_client->id);
+    }
+}
 
-    cc_hal_sys_free(tcps_ctx->client_lsit); 
+static void __tcps_ctx_free(_tcps_ctx_t *tcps_ctx){
+    for (int i = 0; i < tcps_ctx->max_client; i ++){
+        if(tcps_ctx->client_lsit[i].tx_buf){
+            cc_hal_sys_free(tcps_ctx->client_lsit[i].tx_buf);
+        }
+    }
+    if(tcps_ctx->semphr){
+        cc_hal_os_semphr_delete(tcps_ctx->semphr);
+    }
+    cc_hal_sys_free(tcps_ctx->client_lsit);
     cc_hal_sys_free(tcps_ctx);
-    
-    vTaskDelete(NULL);
+}
+
+// 在事件循环中执行，此时不会再有该服务端的回调
+static void __tcps_destroy(void *arg){
+    _tcps_ctx_t *tcps_ctx = (_tcps_ctx_t *)arg;
+
+    for (int i = 0; i < tcps_ctx->max_client; i ++){
+        __tcps_client_close(&tcps_ctx->client_lsit[i], 0);
+    }
+    cc_hal_net_close(tcps_ctx->sockfd);
+    __tcps_ctx_free(tcps_ctx);
+}
+
+static int __tcps_listen(uint16_t port, uint8_t backlog){
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        CC_LOGE(TAG, "tcps create socket error");
+        return -1;
+    }
+
+    int reuse = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    struct sockaddr_in server_addr;
+    memset(&server_addr, 0, sizeof(server_addr));
+    server_addr.sin_family = AF_INET;
+    server_addr.sin_port = htons(port);
+    server_addr.sin_addr.s_addr = INADDR_ANY;
+
+    if (bind(fd, (struct sockaddr *) &server_addr, sizeof(server_addr)) != 0) {
+        CC_LOGE(TAG, "tsps bind error");
+        close(fd);
+        return -1;
+    }
+
+    if (listen(fd, backlog) != 0) {
+        CC_LOGE(TAG, "tsps listen error");
+        close(fd);
+        return -1;
+    }
+
+    fcntl(fd, F_SETFL, fcntl(fd, F_GETFL, 0) | O_NONBLOCK);
+    return fd;
 }
 
 
@@ -416,25 +1116,59 @@ cc_err_t cc_hal_tcps_send(cc_tcps_t *tcps, uint8_t client_id, char *data, uint16
     }
     
     _tcps_ctx_t *tcps_ctx = node->data;
+    if(NULL == tcps_ctx || client_id >= tcps_ctx->max_client){
+        return CC_FAIL;
+    }
 
-    if(tcps_ctx){
-        _tcps_client *tcps_client = &tcps_ctx->client_lsit[client_id];        
-        if(tcps_client->sockfd != -1){
+    if(len > CONFIG_TCPS_TX_BUF_MAX){
+        return CC_ERR_INVALID_SIZE;
+    }
+
+    _tcps_client *tcps_client = &tcps_ctx->client_lsit[client_id];
 
-            //TODO 当发送缓冲区已满时，send 函数将被阻塞
+    cc_hal_os_semphr_take(tcps_ctx->semphr, CC_OS_MAX_DELAY);
+    if(tcps_client->sockfd == -1){
+        err = CC_FAIL;
+    }else if(tcps_client->tx_len + len > CONFIG_TCPS_TX_BUF_MAX){
+        // 积压已满，整条消息都不发送
+        err = CC_ERR_NOT_RESOURCES;
+    }else{
+        // 发送缓冲在第一次 send() 之前就分配好：发出一部分后才分配失败，剩下的只能丢掉，对端的分帧就乱了
+        if(tcps_client->tx_buf == NULL){
+            tcps_client->tx_buf = cc_hal_sys_malloc_caps(CONFIG_TCPS_TX_BUF_MAX, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
+            tcps_client->tx_cap = tcps_client->tx_buf ? CONFIG_TCPS_TX_BUF_MAX : 0;
+        }
+        if(tcps_client->tx_buf == NULL){
+            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+            err = CC_ERR_NO_MEM;
+        }
+    }
+    if(err == CC_OK){
+        uint16_t sent = 0;
+        if(tcps_client->tx_len == 0){
             int send_len = send(tcps_client->sockfd, data, len, 0);
-            if(send_len != len){
-                if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR ) {
-                
-                } else {
-                    CC_LOGE(TAG, "tcps client: %d send error & errno:%d", errno, client_id);
-                    err = CC_FAIL;
-                }
+            if(send_len >= 0){
+                sent = send_len;
+            }else if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+                // 连接由事件循环在读取时关闭
+                CC_LOGE(TAG, "tcps client: %d send error & errno:%d", client_id, errno);
+                err = CC_FAIL;
             }
-        }else{
-            err = CC_FAIL;
+        }
+        uint16_t remain = len - sent;
+        if(err == CC_OK && remain){
+            if(tcps_client->tx_off + tcps_client->tx_len + remain > tcps_client->tx_cap){
+                memmove(tcps_client->tx_buf, tcps_client->tx_buf + tcps_client->tx_off, tcps_client->tx_len);
+                tcps_client->tx_off = 0;
+            }
+            memcpy(tcps_client->tx_buf + tcps_client->tx_off + tcps_client->tx_len, data + sent, remain);
+            if(tcps_client->tx_len == 0){
+                cc_hal_net_set_events(tcps_client->sockfd, CC_NET_EV_READ | CC_NET_EV_WRITE);
+            }
+            tcps_client->tx_len += remain;
         }
     }
+    cc_hal_os_semphr_give(tcps_ctx->semphr);
     
     return err;
 }
@@ -451,94 +1185,67 @@ cc_err_t cc_hal_tcps_create(cc_tcps_t *tcps){
         }
     }
 
-    _tcps_ctx_t *tcps_ctx = cc_hal_sys_malloc(sizeof(_tcps_ctx_t));
+    _tcps_ctx_t *tcps_ctx = cc_hal_sys_malloc_caps(sizeof(_tcps_ctx_t), CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
     if(NULL == tcps_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
         return CC_ERR_NO_MEM;
     }
+    memset(tcps_ctx, 0, sizeof(_tcps_ctx_t));
 
     uint8_t max_client = 0;
 
     max_client = (tcps->max_client > 5)?5:tcps->max_client;
 
-    _tcps_client *client_list = cc_hal_sys_malloc(sizeof(_tcps_client) * max_client);
-    if(NULL == client_list){
+    _tcps_client *client_list = cc_hal_sys_malloc_caps(sizeof(_tcps_client) * max_client, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
+    tcps_ctx->semphr = cc_hal_os_semphr_create_mutex();
+    if(NULL == client_list || NULL == tcps_ctx->semphr){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        if(client_list){
+            cc_hal_sys_free(client_list);
+        }
+        if(tcps_ctx->semphr){
+            cc_hal_os_semphr_delete(tcps_ctx->semphr);
+        }
         cc_hal_sys_free(tcps_ctx);
         return CC_ERR_NO_MEM;
     }
 
+    memset(client_list, 0, sizeof(_tcps_client) * max_client);
     for (size_t i = 0; i < max_client; i++){
         client_list[i].sockfd = -1;
-        // cc_os_semphr_handle_t semphr = cc_hal_os_semphr_create_binary();
-        // if(NULL == semphr){
-        //     for (size_t i = 0; i < max_client; i++){
-        //         if(client_list[i].semphr){
-        //             cc_hal_os_semphr_delete(semphr);
-        //         }
-        //     }
-        //     CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-        //     cc_hal_sys_free(client_list);
-        //     cc_hal_sys_free(tcps_ctx);
-        //     return CC_ERR_NO_MEM;
-        // }
-        // cc_hal_os_semphr_give(semphr);
-
-        // client_list[i].semphr = semphr;
+        client_list[i].id = i;
+        client_list[i].ctx = tcps_ctx;
     }
     
     tcps_ctx->tcps = tcps;
-    tcps_ctx->sockfd = -1;
     tcps_ctx->max_client = max_client;
     tcps_ctx->port = tcps->port;
     tcps_ctx->client_lsit = client_list;
     tcps_ctx->wait_delete = 0;
 
+    tcps_ctx->sockfd = __tcps_listen(tcps_ctx->port, max_client);
+    if(tcps_ctx->sockfd < 0){
+        __tcps_ctx_free(tcps_ctx);
+        return CC_FAIL;
+    }
+
     if(NULL == g_tcps_list){
         g_tcps_list = cc_list_create(tcps_ctx);
     }else{
         if(NULL == cc_list_insert_end(g_tcps_list, tcps_ctx)){
-            // for (size_t i = 0; i < max_client; i++){
-            //     if(client_list[i].semphr){
-            //         cc_hal_os_semphr_delete(client_list[i].semphr);
-            //     }
-            // }
-            cc_hal_sys_free(client_list);
-            cc_hal_sys_free(tcps_ctx);
+            close(tcps_ctx->sockfd);
+            __tcps_ctx_free(tcps_ctx);
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             return CC_ERR_NO_MEM;
         }
     }
 
-    uint8_t cnt = 0;
-    cc_list_node *node = g_tcps_list;
-    while(node){
-        cnt++;
-        if(NULL != node){
-            node = node->next;
-        }else{
-            break;
-        }
-    }
-    
-    char task_name[] = "hal_tcps0";
-    task_name[sizeof("hal_tcps0") - 2] = cnt + '0'; 
-    cc_err_t err = CC_FAIL;
-    if(tcps_ctx->port == 8266){
-        err = cc_hal_os_task_create(__tcps_task, task_name, 4096+1024, tcps_ctx, CONFIG_TCPS_STACK_PRIORITY, &tcps_ctx->task);
-    }else{
-        err = cc_hal_os_task_create(__tcps_task, task_name, CONFIG_TCPS_STACK_SIZE, tcps_ctx, CONFIG_TCPS_STACK_PRIORITY, &tcps_ctx->task);
-    }
+    cc_err_t err = cc_hal_net_watch(tcps_ctx->sockfd, CC_NET_EV_READ, __tcps_accept, tcps_ctx);
     if(err != CC_OK){
         CC_LOGE_CODE(TAG, err);
         cc_list_remove_by_data(&g_tcps_list, tcps_ctx);
-        // for (size_t i = 0; i < max_client; i++){
-        //     if(client_list[i].semphr){
-        //         cc_hal_os_semphr_delete(client_list[i].semphr);
-        //     }
-        // }
-        cc_hal_sys_free(client_list);
-        cc_hal_sys_free(tcps_ctx);
+        close(tcps_ctx->sockfd);
+        __tcps_ctx_free(tcps_ctx);
         return err;
     }
     
@@ -564,11 +1271,11 @@ cc_err_t cc_hal_tcps_delete(cc_tcps_t *tcps){
     if(tcps_ctx){
         tcps_ctx->wait_delete = 1;
         tcps_ctx->tcps = NULL;
+        // 可能在本服务端的回调中调用，释放交给事件循环在本轮回调结束后进行
+        return cc_hal_net_post(__tcps_destroy, tcps_ctx);
     }else{
         return CC_FAIL;
     }
-
-    return CC_OK;
 }
 
 
@@ -586,6 +1293,16 @@ typedef struct {
     uint8_t wait_delete;
     uint8_t wait_reconnect;
     void *arg;
+    // 分片重组：缓冲按需扩大后保留复用，topic/qos/retain 只在首个分片中携带
+    char *rx_buf;
+    uint32_t rx_cap;
+    uint32_t rx_total;
+    uint32_t rx_len;
+    uint8_t rx_drop;
+    uint8_t rx_qos;
+    uint8_t rx_retain;
+    uint16_t rx_topic_len;
+    char rx_topic[CONFIG_MQTT_TOPIC_LEN_MAX];
 }_mqtt_ctx_t;
 
 static cc_list_node* g_mqtt_list = NULL;
@@ -601,6 +1318,89 @@ static int __find_by_mqtt(cc_list_node* node, void* arg){
     return 0;
 }
 
+static cc_err_t __mqtt_rx_reserve(_mqtt_ctx_t *mqtt_ctx, uint32_t total){
+    if(total <= mqtt_ctx->rx_cap){
+        return CC_OK;
+    }
+    // 多留 1 字节补 '\0'，方便按字符串解析
+    char *buf = cc_hal_sys_malloc_caps(total + 1, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_NET);
+    if(NULL == buf){
+        return CC_ERR_NO_MEM;
+    }
+    if(mqtt_ctx->rx_buf){
+        cc_hal_sys_free(mqtt_ctx->rx_buf);
+    }
+    mqtt_ctx->rx_buf = buf;
+    mqtt_ctx->rx_cap = total;
+    return CC_OK;
+}
+
+/*
+ * 未分片的消息直接把 esp-mqtt 接收缓冲里的 topic/data 交给上层，不拷贝；
+ * 分片的消息按 current_data_offset 拼入重组缓冲，收齐后一次交付。
+ */
+static void __mqtt_data(_mqtt_ctx_t *mqtt_ctx, esp_mqtt_event_handle_t event){
+    cc_mqtt_t *mqtt = mqtt_ctx->mqtt;
+
+    if(event->current_data_offset == 0 && event->data_len == event->total_data_len){
+        mqtt->msg_cb(mqtt->arg, event->topic, event->topic_len, event->data, event->data_len, event->qos, event->retain);
+        return;
+    }
+
+    if(event->current_data_offset == 0){
+        mqtt_ctx->rx_total = event->total_data_len;
+        mqtt_ctx->rx_len = 0;
+        mqtt_ctx->rx_qos = event->qos;
+        mqtt_ctx->rx_retain = event->retain;
+        mqtt_ctx->rx_drop = 0;
+        if(event->topic_len > CONFIG_MQTT_TOPIC_LEN_MAX){
+            CC_LOGE(TAG, "mqtt topic too long: %d", event->topic_len);
+            mqtt_ctx->rx_drop = 1;
+        }else if(event->total_data_len > CONFIG_MQTT_REASM_LEN_MAX){
+            CC_LOGE(TAG, "mqtt msg too long: %d", event->total_data_len);
+            mqtt_ctx->rx_drop = 1;
+        }else if(__mqtt_rx_reserve(mqtt_ctx, event->total_data_len) != CC_OK){
+            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+            mqtt_ctx->rx_drop = 1;
+        }else{
+            memcpy(mqtt_ctx->rx_topic, event->topic, event->topic_len);
+            mqtt_ctx->rx_topic_len = event->topic_len;
+        }
+    }else if(event->current_data_offset != mqtt_ctx->rx_len || event->total_data_len != mqtt_ctx->rx_total){
+        // 丢了首个分片或中途换成了另一条消息，剩余分片全部丢弃
+        if(!mqtt_ctx->rx_drop){
+            CC_LOGE(TAG, "mqtt fragment out of order: %d/%d", event->current_data_offset, event->total_data_len);
+        }
+        mqtt_ctx->rx_drop = 1;
+    }
+
+    if(mqtt_ctx->rx_drop){
+        return;
+    }
+
+    memcpy(mqtt_ctx->rx_buf + mqtt_ctx->rx_len, event->data, event->data_len);
+    mqtt_ctx->rx_len += event->data_len;
+    if(mqtt_ctx->rx_len < mqtt_ctx->rx_total){
+        return;
+    }
+
+    mqtt_ctx->rx_buf[mqtt_ctx->rx_len] = '\0';
+    mqtt->msg_cb(mqtt->arg, mqtt_ctx->rx_topic, mqtt_ctx->rx_topic_len, mqtt_ctx->rx_buf, mqtt_ctx->rx_len,
+                 mqtt_ctx->rx_qos, mqtt_ctx->rx_retain);
+    mqtt_ctx->rx_drop = 1;
+}
+
+// 连接前改写 broker 地址时整份配置重新设置一遍，其余字段不会被 esp_mqtt_set_config 改成默认值
+static void __mqtt_config(_mqtt_ctx_t *mqtt_ctx, const char *host, esp_mqtt_client_config_t *cfg){
+    memset(cfg, 0, sizeof(esp_mqtt_client_config_t));
+    cfg->broker.address.transport = MQTT_TRANSPORT_OVER_TCP;
+    cfg->broker.address.hostname = host;
+    cfg->broker.address.port = mqtt_ctx->port;
+    cfg->credentials.client_id = mqtt_ctx->client_id;
+    cfg->credentials.username = mqtt_ctx->username;
+    cfg->credentials.authentication.password = mqtt_ctx->password;
+}
+
 static void __mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event_id, void *event_data)
 {
     CC_LOGD(TAG, "Event dispatched from event loop base=%s, event_id=%" PRIi32 "", base, event_id);
@@ -609,6 +1409,23 @@ static void __mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event
     _mqtt_ctx_t *mqtt_ctx = (_mqtt_ctx_t *)arg;
 
     switch ((esp_mqtt_event_id_t)event_id) {
+    case MQTT_EVENT_BEFORE_CONNECT:{
+        // 在 MQTT 任务中、发起连接前分发：经 DNS 缓存解析，broker 改为地址，免去客户端自己的解析
+        uint32_t ip;
+        char ip_str[16];
+        if(mqtt_ctx->host && cc_hal_dns_resolve(mqtt_ctx->host, &ip) == CC_OK){
+            esp_mqtt_client_config_t cfg;
+            inet_ntoa_r(*(struct in_addr *)&ip, ip_str, sizeof(ip_str));
+            __mqtt_config(mqtt_ctx, ip_str, &cfg);
+            esp_mqtt_set_config(event->client, &cfg);
+        }
+        break;
+    }
+    case MQTT_EVENT_ERROR:
+        if(event->error_handle && event->error_handle->error_type == MQTT_ERROR_TYPE_TCP_TRANSPORT){
+            cc_hal_dns_invalidate(mqtt_ctx->host);
+        }
+        break;
     case MQTT_EVENT_CONNECTED:
         if(mqtt_ctx->mqtt->connect_cb){
             mqtt_ctx->mqtt->connect_cb(mqtt_ctx->mqtt->arg);
@@ -620,10 +1437,8 @@ static void __mqtt_event_handler(void *arg, esp_event_base_t base, int32_t event
         }
         break;
     case MQTT_EVENT_DATA:
-        if(mqtt_ctx->mqtt->msg_cb){
-            char topic[256] = "";
-            snprintf(topic, sizeof(topic), "%.*s", event->topic_len, event->topic);
-            mqtt_ctx->mqtt->msg_cb(mqtt_ctx->mqtt->arg, topic, event->data, event->data_len, event->qos, event->retain);
+        if(mqtt_ctx->mqtt && mqtt_ctx->mqtt->msg_cb){
+            __mqtt_data(mqtt_ctx, event);
         }
         break;
     default:
@@ -646,16 +1461,17 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
         }
     }
 
-    _mqtt_ctx_t *mqtt_ctx = cc_hal_sys_malloc(sizeof(_mqtt_ctx_t));
+    _mqtt_ctx_t *mqtt_ctx = cc_hal_sys_malloc_caps(sizeof(_mqtt_ctx_t), CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
     if(NULL == mqtt_ctx){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
         return CC_ERR_NO_MEM;
     }
+    memset(mqtt_ctx, 0, sizeof(_mqtt_ctx_t));
 
     mqtt_ctx->mqtt = mqtt;
 
     if(mqtt->host){
-        mqtt_ctx->host = cc_hal_sys_malloc(strlen(mqtt->host) + 1);
+        mqtt_ctx->host = cc_hal_sys_malloc_caps(strlen(mqtt->host) + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
         if(NULL == mqtt_ctx->host){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             goto mem_err;
@@ -669,7 +1485,7 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
     mqtt_ctx->port = mqtt->port;
 
     if(mqtt->client_id){
-        mqtt_ctx->client_id = cc_hal_sys_malloc(strlen(mqtt->client_id) + 1);
+        mqtt_ctx->client_id = cc_hal_sys_malloc_caps(strlen(mqtt->client_id) + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
         if(NULL == mqtt_ctx->client_id){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             goto mem_err;
@@ -678,7 +1494,7 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
     }
 
     if(mqtt->username){
-        mqtt_ctx->username = cc_hal_sys_malloc(strlen(mqtt->username) + 1);
+        mqtt_ctx->username = cc_hal_sys_malloc_caps(strlen(mqtt->username) + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
         if(NULL == mqtt_ctx->username){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             goto mem_err;
@@ -687,7 +1503,7 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
     }
 
     if(mqtt->password){
-        mqtt_ctx->password = cc_hal_sys_malloc(strlen(mqtt->password) + 1);
+        mqtt_ctx->password = cc_hal_sys_malloc_caps(strlen(mqtt->password) + 1, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_NET);
         if(NULL == mqtt_ctx->password){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             goto mem_err;
@@ -695,13 +1511,7 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
         strcpy(mqtt_ctx->password, mqtt->password);
     }
 
-    memset(&mqtt_cfg, 0, sizeof(mqtt_cfg));
-    mqtt_cfg.broker.address.transport = MQTT_TRANSPORT_OVER_TCP;
-    mqtt_cfg.broker.address.hostname = mqtt_ctx->host;
-    mqtt_cfg.broker.address.port = mqtt_ctx->port;
-    mqtt_cfg.credentials.client_id = mqtt_ctx->client_id;
-    mqtt_cfg.credentials.username = mqtt_ctx->username;
-    mqtt_cfg.credentials.authentication.password = mqtt_ctx->password;
+    __mqtt_config(mqtt_ctx, mqtt_ctx->host, &mqtt_cfg);
 
     esp_mqtt_client_handle_t client = esp_mqtt_client_init(&mqtt_cfg);
     if(NULL == client){
@@ -709,6 +1519,9 @@ cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt){
     }
 
     mqtt_ctx->handle = (void *)client;
+    if(mqtt_ctx->host){
+        cc_hal_dns_prefetch(mqtt_ctx->host);
+    }
 
     esp_mqtt_client_register_event(client, ESP_EVENT_ANY_ID, __mqtt_event_handler, mqtt_ctx);
     esp_mqtt_client_start(client);
@@ -768,6 +1581,32 @@ cc_err_t cc_hal_mqtt_delete(cc_mqtt_t *mqtt){
 
     return CC_OK;
 }
+
+cc_err_t cc_hal_mqtt_reconnect(cc_mqtt_t *mqtt){
+    cc_list_node *node = NULL;
+
+    if(mqtt == NULL || g_mqtt_list == NULL){
+        return CC_FAIL;
+    }
+
+    node = cc_list_find(g_mqtt_list, __find_by_mqtt, (void *)mqtt);
+    if(NULL == node){
+        CC_LOGE_CODE(TAG, CC_ERR_NOT_FOUND);
+        return CC_ERR_NOT_FOUND;
+    }
+
+    _mqtt_ctx_t *mqtt_ctx = node->data;
+    esp_mqtt_client_handle_t client = mqtt_ctx->handle;
+
+    // 断开后进入等待重连状态，reconnect 清掉等待时间，下一轮即发起连接
+    esp_mqtt_client_disconnect(client);
+    if(esp_mqtt_client_reconnect(client) != ESP_OK){
+        return CC_FAIL;
+    }
+
+    return CC_OK;
+}
+
 cc_err_t cc_hal_mqtt_subscribe(cc_mqtt_t *mqtt, char *topic, cc_mqtt_qos_t qos){
     cc_list_node *node = NULL;
 
@@ -805,7 +1644,9 @@ cc_err_t cc_hal_mqtt_publish(cc_mqtt_t *mqtt, char *topic, char *msg, uint16_t l
     _mqtt_ctx_t *mqtt_ctx = node->data;
     esp_mqtt_client_handle_t client = mqtt_ctx->handle;
 
-    esp_mqtt_client_publish(client, topic, msg, len, qos, retain);
+    if(esp_mqtt_client_publish(client, topic, msg, len, qos, retain) < 0){
+        return CC_FAIL;
+    }
 
     return CC_OK;
 }
@@ -4,10 +4,81 @@
 #include "freertos/task.h"
 #include "freertos/semphr.h"
 #include <inttypes.h> // 如果需要用 PRIu32，可以保留
+#include <string.h>
 #include "cc_log.h"
+#include "esp_heap_caps.h"
 
 #define TAG "HAL_OS_TASK"
 
+#if CONFIG_CC_OS_STATIC_TASKS
+typedef struct {
+    const char *name;
+    uint32_t stack_size;
+    uint8_t count;
+    uint8_t used;               // 已取用的槽位，任务删除后不回收（登记的都是常驻任务）
+    StackType_t *stack;         // count 个 stack_size 字节的栈
+    StaticTask_t *tcb;
+    TaskHandle_t *handle;
+} _static_task_t;
+
+// ESP-IDF 中 StackType_t 为字节，栈深度按字节计
+#define __STATIC_TASK_STORAGE(id, name, stack_size, count) \
+    static StackType_t g_stack_##id[count][(stack_size) / sizeof(StackType_t)]; \
+    static StaticTask_t g_tcb_##id[count]; \
+    static TaskHandle_t g_handle_##id[count];
+CC_OS_STATIC_TASKS(__STATIC_TASK_STORAGE)
+
+#define __STATIC_TASK_ENTRY(id, name, stack_size, count) \
+    { name, (stack_size), (count), 0, &g_stack_##id[0][0], g_tcb_##id, g_handle_##id },
+static _static_task_t g_static_tasks[] = {
+    CC_OS_STATIC_TASKS(__STATIC_TASK_ENTRY)
+};
+static cc_os_spinlock_t g_static_lock = CC_OS_SPINLOCK_INIT;
+
+// 按任务名取登记表中的一个槽位；不在表中、栈不够或槽位用完时返回 NULL，由调用者改用堆
+static _static_task_t *__static_task_get(const char *name, uint32_t stack_size, uint8_t *slot){
+    for(size_t i = 0; i < sizeof(g_static_tasks) / sizeof(g_static_tasks[0]); i++){
+        _static_task_t *t = &g_static_tasks[i];
+        int match = t->count > 1 ? strncmp(name, t->name, strlen(t->name)) == 0 : strcmp(name, t->name) == 0;
+        if(!match){
+            continue;
+        }
+        if(stack_size > t->stack_size){
+            CC_LOGW(TAG, "%s needs %u bytes of stack, registered %u, use heap",
+                    name, (unsigned)stack_size, (unsigned)t->stack_size);
+            return NULL;
+        }
+        int ok = 0;
+        cc_hal_os_enter_critical(&g_static_lock);
+        if(t->used < t->count){
+            *slot = t->used++;
+            ok = 1;
+        }
+        cc_hal_os_exit_critical(&g_static_lock);
+        if(!ok){
+            CC_LOGW(TAG, "no static slot left for %s, use heap", name);
+        }
+        return ok ? t : NULL;
+    }
+    return NULL;
+}
+#endif
+
+#if CONFIG_CC_OS_PSRAM_STACKS
+#define __PSRAM_TASK_MAX        8
+
+typedef struct {
+    const char *name;
+    uint32_t stack_size;
+    TaskHandle_t handle;
+} _psram_task_t;
+
+static _psram_task_t g_psram_tasks[__PSRAM_TASK_MAX];   // 只用于打印栈余量
+static uint8_t g_psram_task_num = 0;
+static uint32_t g_psram_stack_total = 0;
+static cc_os_spinlock_t g_psram_lock = CC_OS_SPINLOCK_INIT;
+#endif
+
 cc_os_semphr_handle_t cc_hal_os_semphr_create_binary(void){
     return xSemaphoreCreateBinary();
 }
@@ -16,6 +87,22 @@ cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex(void){
     return xSemaphoreCreateMutex();
 }
 
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting(uint32_t max_count, uint32_t init_count){
+    return xSemaphoreCreateCounting(max_count, init_count);
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary_static(cc_os_semphr_buf_t *buf){
+    return buf ? xSemaphoreCreateBinaryStatic(buf) : NULL;
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex_static(cc_os_semphr_buf_t *buf){
+    return buf ? xSemaphoreCreateMutexStatic(buf) : NULL;
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting_static(uint32_t max_count, uint32_t init_count, cc_os_semphr_buf_t *buf){
+    return buf ? xSemaphoreCreateCountingStatic(max_count, init_count, buf) : NULL;
+}
+
 cc_err_t cc_hal_os_semphr_delete(cc_os_semphr_handle_t handle){
     if(handle == NULL){
         return CC_FAIL;
@@ -86,10 +173,20 @@ cc_err_t cc_hal_os_task_create(cc_os_task_t task,
         CC_LOGE(TAG, "Error: Task name is NULL");
         return CC_FAIL;
     }
-    if (handle == NULL) {
-        CC_LOGE(TAG, "Error: Task handle pointer is NULL");
-        return CC_FAIL;
+
+#if CONFIG_CC_OS_STATIC_TASKS
+    uint8_t slot = 0;
+    _static_task_t *st = __static_task_get(name, stack_size, &slot);
+    if (st != NULL) {
+        cc_err_t err = cc_hal_os_task_create_static(task, name, st->stack_size, arg, priority,
+                                                    st->stack + slot * (st->stack_size / sizeof(StackType_t)),
+                                                    &st->tcb[slot], &st->handle[slot]);
+        if (err == CC_OK && handle != NULL) {
+            *handle = st->handle[slot];
+        }
+        return err;
     }
+#endif
 
     // Check available heap size
     size_t free_heap = xPortGetFreeHeapSize();
@@ -131,7 +228,9 @@ cc_err_t cc_hal_os_task_create(cc_os_task_t task,
 
     // 打印任务句柄 (TaskHandle_t) 的值，通常是个指针
     // 可以做 (unsigned) 强转，然后用 0x%x 或 %p 也行
-    CC_LOGI(TAG, "Task handle: 0x%x", (unsigned)*handle);
+    if (handle != NULL) {
+        CC_LOGI(TAG, "Task handle: 0x%x", (unsigned)*handle);
+    }
 
     // 再次打印剩余堆大小
     free_heap = xPortGetFreeHeapSize();
@@ -140,3 +239,97 @@ cc_err_t cc_hal_os_task_create(cc_os_task_t task,
 
     return CC_OK;
 }
+
+cc_err_t cc_hal_os_task_create_static(cc_os_task_t task,
+                                      const char *name,
+                                      uint32_t stack_size,
+                                      void *arg,
+                                      uint8_t priority,
+                                      StackType_t *stack,
+                                      StaticTask_t *tcb,
+                                      cc_os_task_handle_t *handle)
+{
+    if (task == NULL || name == NULL || stack == NULL || tcb == NULL) {
+        CC_LOGE(TAG, "Error: invalid static task arguments");
+        return CC_ERR_INVALID_ARG;
+    }
+
+    TaskHandle_t created = xTaskCreateStatic((TaskFunction_t)task, name, stack_size, arg, priority, stack, tcb);
+    if (created == NULL) {
+        CC_LOGE(TAG, "Failed to create static task: %s", name);
+        return CC_FAIL;
+    }
+    if (handle != NULL) {
+        *handle = created;
+    }
+    CC_LOGI(TAG, "Created task %s on static stack of %u bytes", name, (unsigned)stack_size);
+    return CC_OK;
+}
+
+cc_err_t cc_hal_os_task_create_caps(cc_os_task_t task,
+                                    const char *name,
+                                    uint32_t stack_size,
+                                    void *arg,
+                                    uint8_t priority,
+                                    cc_os_stack_mem_t mem,
+                                    cc_os_task_handle_t *handle)
+{
+#if CONFIG_CC_OS_PSRAM_STACKS
+    if (mem == CC_OS_STACK_PSRAM && task != NULL && name != NULL) {
+        // TCB 必须在内部 RAM；栈和 TCB 在任务删除后不回收，只用于常驻任务
+        StackType_t *stack = heap_caps_malloc(stack_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        StaticTask_t *tcb = heap_caps_malloc(sizeof(StaticTask_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        TaskHandle_t created = NULL;
+        if (stack != NULL && tcb != NULL) {
+            created = xTaskCreateStatic((TaskFunction_t)task, name, stack_size, arg, priority, stack, tcb);
+        }
+        if (created != NULL) {
+            cc_hal_os_enter_critical(&g_psram_lock);
+            if (g_psram_task_num < __PSRAM_TASK_MAX) {
+                g_psram_tasks[g_psram_task_num++] = (_psram_task_t){ name, stack_size, created };
+            }
+            g_psram_stack_total += stack_size;
+            cc_hal_os_exit_critical(&g_psram_lock);
+            if (handle != NULL) {
+                *handle = created;
+            }
+            CC_LOGI(TAG, "Created task %s on %u bytes of PSRAM stack", name, (unsigned)stack_size);
+            return CC_OK;
+        }
+        heap_caps_free(stack);
+        heap_caps_free(tcb);
+        CC_LOGW(TAG, "no PSRAM stack for %s, use internal RAM", name);
+    }
+#endif
+    return cc_hal_os_task_create(task, name, stack_size, arg, priority, handle);
+}
+
+void cc_hal_os_static_tasks_dump(void)
+{
+#if CONFIG_CC_OS_STATIC_TASKS
+    uint32_t total = 0;
+    for (size_t i = 0; i < sizeof(g_static_tasks) / sizeof(g_static_tasks[0]); i++) {
+        _static_task_t *t = &g_static_tasks[i];
+        total += (t->stack_size + sizeof(StaticTask_t)) * t->count;
+        for (uint8_t slot = 0; slot < t->used; slot++) {
+            CC_LOGI(TAG, "%s[%u]: stack %u bytes, min free %u",
+                    t->name, (unsigned)slot, (unsigned)t->stack_size,
+                    (unsigned)uxTaskGetStackHighWaterMark(t->handle[slot]));
+        }
+        if (t->used < t->count) {
+            CC_LOGI(TAG, "%s: %u of %u slots unused", t->name, (unsigned)(t->count - t->used), (unsigned)t->count);
+        }
+    }
+    CC_LOGI(TAG, "static task storage: %u bytes", (unsigned)total);
+#else
+    CC_LOGI(TAG, "static tasks disabled");
+#endif
+#if CONFIG_CC_OS_PSRAM_STACKS
+    for (uint8_t i = 0; i < g_psram_task_num; i++) {
+        _psram_task_t *t = &g_psram_tasks[i];
+        CC_LOGI(TAG, "%s: PSRAM stack %u bytes, min free %u",
+                t->name, (unsigned)t->stack_size, (unsigned)uxTaskGetStackHighWaterMark(t->handle));
+    }
+    CC_LOGI(TAG, "PSRAM task stacks: %u bytes", (unsigned)g_psram_stack_total);
+#endif
+}
@@ -1,65 +1,128 @@
-
 #include "cc_hal_ota.h"
+#include <string.h>
 #include "cc_log.h"
 
 #include "cc_hal_sys.h"
 
 #include "esp_ota_ops.h"
+#include "esp_partition.h"
+#include "esp_app_format.h"
+#include "esp_app_desc.h"
 
 static const char *TAG = "app_ota";
 
-esp_ota_handle_t update_handle = 0;
-const esp_partition_t *update_partition = NULL;
+#define __ALIGN_DOWN(x)     ((x) & ~(CC_HAL_OTA_SECTOR_SIZE - 1))
+#define __ALIGN_UP(x)       __ALIGN_DOWN((x) + CC_HAL_OTA_SECTOR_SIZE - 1)
+
+static const esp_partition_t *g_update_partition = NULL;
+static uint32_t g_begin_offset = 0;
+// 已擦除到的位置（扇区对齐），之前的区域按顺序写入，不再擦除
+static uint32_t g_erased_end = 0;
 
+// 不经过 esp_ota_write：它只能从 0 开始顺序写，无法在断点处继续。
+// 数据按扇区擦除后直接写分区，esp_ota_set_boot_partition() 会校验整个镜像。
 cc_err_t cc_hal_ota_update(uint32_t idx, uint8_t *buf, uint16_t len){
 
-    esp_err_t err = ESP_OK;
-    err = esp_ota_write(update_handle, (const void *)buf, len);
+    if(g_update_partition == NULL){
+        return CC_FAIL;
+    }
+    if(idx < g_begin_offset || idx + len > g_update_partition->size){
+        CC_LOGE(TAG, "write out of range: 0x%x + %d", idx, len);
+        return CC_ERR_INVALID_SIZE;
+    }
+    if(idx == 0 && len > 0 && buf[0] != ESP_IMAGE_HEADER_MAGIC){
+        CC_LOGE(TAG, "not an app image, magic 0x%02x", buf[0]);
+        return CC_FAIL;
+    }
+
+    if(idx + len > g_erased_end){
+        uint32_t start = __ALIGN_DOWN(idx) > g_erased_end ? __ALIGN_DOWN(idx) : g_erased_end;
+        uint32_t end = __ALIGN_UP(idx + len);
+        esp_err_t err = esp_partition_erase_range(g_update_partition, start, end - start);
+        if (err != ESP_OK) {
+            CC_LOGE(TAG, "erase 0x%x-0x%x error: %d", start, end, err);
+            return CC_FAIL;
+        }
+        g_erased_end = end;
+    }
+
+    esp_err_t err = esp_partition_write(g_update_partition, idx, (const void *)buf, len);
     if (err != ESP_OK) {
-        CC_LOGE(TAG, "esp_ota_write error: %d", err);
+        CC_LOGE(TAG, "write 0x%x error: %d", idx, err);
         return CC_FAIL;
     }
-    
+
     return CC_OK;
 }
 
 cc_err_t cc_hal_ota_end(void){
-    esp_err_t ota_end_err = esp_ota_end(update_handle);
-	if (ota_end_err != ESP_OK) {
-		CC_LOGE(TAG, "esp_ota_end failed! err=0x%d. Image is invalid", ota_end_err);
-		return CC_FAIL;
-	}
+    if(g_update_partition == NULL){
+        return CC_FAIL;
+    }
 
-	esp_err_t err = esp_ota_set_boot_partition(update_partition);
+	esp_err_t err = esp_ota_set_boot_partition(g_update_partition);
+    g_update_partition = NULL;
 	if (err != ESP_OK) {
-		CC_LOGE(TAG, "esp_ota_set_boot_partition failed! err=0x%d", err);
+		CC_LOGE(TAG, "esp_ota_set_boot_partition failed! err=0x%x. Image is invalid", err);
 		return CC_FAIL;
 	}
 	CC_LOGI(TAG, "esp_ota_set_boot_partition succeeded");
     return CC_OK;
 }
 
+cc_err_t cc_hal_ota_begin_at(uint32_t offset){
 
-cc_err_t cc_hal_ota_begin(void){
-
-    update_partition = esp_ota_get_next_update_partition(NULL);
-	if (update_partition == NULL) {
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+	if (partition == NULL) {
 		CC_LOGE(TAG, "Passive OTA partition not found");
 		return CC_FAIL;
 	}
+    if(offset % CC_HAL_OTA_SECTOR_SIZE || offset >= partition->size){
+        CC_LOGE(TAG, "invalid resume offset 0x%x", offset);
+        return CC_ERR_INVALID_ARG;
+    }
 
-	CC_LOGI(TAG, "Writing to partition subtype %d at offset 0x%x",
-	         update_partition->subtype, update_partition->address);
+	CC_LOGI(TAG, "Writing to partition subtype %d at offset 0x%x, from 0x%x",
+	         partition->subtype, partition->address, offset);
 
-	esp_err_t err = esp_ota_begin(update_partition, OTA_SIZE_UNKNOWN, &update_handle);
-	if (err != ESP_OK) {
-		CC_LOGE(TAG, "esp_ota_begin failed, error=%d", err);
-		return CC_FAIL;
-	}
+    g_update_partition = partition;
+    g_begin_offset = offset;
+    g_erased_end = offset;
+
+    return CC_OK;
+}
 
-	CC_LOGI(TAG, "esp_ota_begin succeeded");
-	CC_LOGI(TAG, "Please Wait. This may take time");
+cc_err_t cc_hal_ota_begin(void){
+    return cc_hal_ota_begin_at(0);
+}
 
+uint32_t cc_hal_ota_next_partition_id(void){
+    const esp_partition_t *partition = esp_ota_get_next_update_partition(NULL);
+    return partition ? partition->address : 0;
+}
+
+cc_err_t cc_hal_ota_read_running(uint32_t offset, void *buf, uint32_t len){
+    const esp_partition_t *partition = esp_ota_get_running_partition();
+    if(partition == NULL){
+        return CC_FAIL;
+    }
+    if(offset + len > partition->size || offset + len < offset){
+        CC_LOGE(TAG, "read running out of range: 0x%x + %d", offset, len);
+        return CC_ERR_INVALID_SIZE;
+    }
+    esp_err_t err = esp_partition_read(partition, offset, buf, len);
+    if (err != ESP_OK) {
+        CC_LOGE(TAG, "read running 0x%x error: %d", offset, err);
+        return CC_FAIL;
+    }
     return CC_OK;
 }
 
+cc_err_t cc_hal_ota_running_sha256(uint8_t sha256[32]){
+    const esp_app_desc_t *desc = esp_app_get_description();
+    if(desc == NULL){
+        return CC_FAIL;
+    }
+    memcpy(sha256, desc->app_elf_sha256, sizeof(desc->app_elf_sha256));
+    return CC_OK;
+}
@@ -11,6 +11,9 @@
 #include "freertos/task.h"
 
 #include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "sdkconfig.h"
 
 #include "mbedtls/md.h"
 #include "mbedtls/cipher.h"
@@ -20,12 +23,196 @@
 
 static char *TAG = "hal_sys";
 
+/* 每块分配前放一个 8 字节的头，记录大小、所属模块和来源，释放时据此归还和统计 */
+#define MEM_HDR_MAGIC               0xCC5A
+
+#define MEM_WHERE_INTERNAL          0xF0
+#define MEM_WHERE_SPIRAM            0xF1
+
+typedef struct{
+    uint32_t size;
+    uint8_t mod;
+    uint8_t where;                  // 定长池下标或 MEM_WHERE_*
+    uint16_t magic;
+}_mem_hdr_t;
+
+/* 内部 RAM 定长池，承接链表节点、定时器上下文等小而频繁的分配 */
+#define MEM_POOL_NUM                4
+#define MEM_POOL_ELEM(size)         (sizeof(_mem_hdr_t) + (size))
+
+static const uint16_t g_pool_size[MEM_POOL_NUM]  = {16, 32, 64, 128};
+static const uint16_t g_pool_count[MEM_POOL_NUM] = {32, 32, 16, 8};
+
+CC_POOL_DEFINE(g_pool_16,  MEM_POOL_ELEM(16),  32);
+CC_POOL_DEFINE(g_pool_32,  MEM_POOL_ELEM(32),  32);
+CC_POOL_DEFINE(g_pool_64,  MEM_POOL_ELEM(64),  16);
+CC_POOL_DEFINE(g_pool_128, MEM_POOL_ELEM(128), 8);
+
+static cc_pool_t *const g_pools[MEM_POOL_NUM] = {&g_pool_16, &g_pool_32, &g_pool_64, &g_pool_128};
+static void *const g_pool_bufs[MEM_POOL_NUM] = {g_pool_16_buf, g_pool_32_buf, g_pool_64_buf, g_pool_128_buf};
+
+static bool g_pool_ready = false;
+static cc_os_spinlock_t g_mem_lock = CC_OS_SPINLOCK_INIT;
+static cc_mem_stat_t g_mem_stat[CC_MEM_MOD_MAX];
+
+static const char *g_mem_mod_name[CC_MEM_MOD_MAX] = {
+    "sys", "list", "timer", "http", "net", "wifi", "app",
+};
+
+static void __pool_init(void){
+    cc_hal_os_enter_critical(&g_mem_lock);
+    if(!g_pool_ready){
+        for (uint8_t i = 0; i < MEM_POOL_NUM; i++){
+            cc_pool_init(g_pools[i], g_pool_bufs[i], MEM_POOL_ELEM(g_pool_size[i]), g_pool_count[i]);
+        }
+        g_pool_ready = true;
+    }
+    cc_hal_os_exit_critical(&g_mem_lock);
+}
+
+static _mem_hdr_t *__pool_alloc(size_t size, uint8_t *where){
+    if(!g_pool_ready){
+        __pool_init();
+    }
+    for (uint8_t i = 0; i < MEM_POOL_NUM; i++){
+        if(size > g_pool_size[i]){
+            continue;
+        }
+        // 只取刚好能放下的一档，避免小块占满大档
+        _mem_hdr_t *hdr = cc_pool_alloc(g_pools[i]);
+        if(hdr){
+            *where = i;
+        }
+        return hdr;
+    }
+    return NULL;
+}
+
+static _mem_hdr_t *__heap_alloc(size_t total, uint32_t caps, uint8_t *where){
+    _mem_hdr_t *hdr = NULL;
+
+    if(caps & CC_MEM_CAP_DMA){
+        hdr = heap_caps_malloc(total, MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }else if(caps & CC_MEM_CAP_INTERNAL){
+        hdr = heap_caps_malloc(total, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }else{
+#if CONFIG_SPIRAM
+        if((caps & CC_MEM_CAP_SPIRAM) || total >= CC_MEM_SPIRAM_THRESHOLD){
+            hdr = heap_caps_malloc_prefer(total, 2, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        }else{
+            hdr = heap_caps_malloc_prefer(total, 2, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        }
+#else
+        hdr = heap_caps_malloc(total, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+#endif
+    }
+    if(hdr){
+        *where = esp_ptr_external_ram(hdr) ? MEM_WHERE_SPIRAM : MEM_WHERE_INTERNAL;
+    }
+    return hdr;
+}
+
+void *cc_hal_sys_malloc_caps(size_t size, uint32_t caps, cc_mem_mod_t mod){
+    _mem_hdr_t *hdr = NULL;
+    uint8_t where = MEM_WHERE_INTERNAL;
+
+    if(mod >= CC_MEM_MOD_MAX){
+        mod = CC_MEM_MOD_SYS;
+    }
+    if(size > UINT32_MAX - sizeof(_mem_hdr_t)){
+        return NULL;
+    }
+
+    // DMA 与显式 PSRAM 请求不走池
+    if(!(caps & (CC_MEM_CAP_DMA | CC_MEM_CAP_SPIRAM))){
+        hdr = __pool_alloc(size, &where);
+    }
+    if(!hdr){
+        hdr = __heap_alloc(sizeof(_mem_hdr_t) + size, caps, &where);
+    }
+
+    cc_mem_stat_t *stat = &g_mem_stat[mod];
+    cc_hal_os_enter_critical(&g_mem_lock);
+    if(!hdr){
+        stat->fail_cnt++;
+        cc_hal_os_exit_critical(&g_mem_lock);
+        return NULL;
+    }
+    if(where == MEM_WHERE_SPIRAM){
+        stat->spiram += size;
+    }else{
+        stat->internal += size;
+    }
+    if(stat->internal + stat->spiram > stat->peak){
+        stat->peak = stat->internal + stat->spiram;
+    }
+    stat->alloc_cnt++;
+    cc_hal_os_exit_critical(&g_mem_lock);
+
+    hdr->size = size;
+    hdr->mod = mod;
+    hdr->where = where;
+    hdr->magic = MEM_HDR_MAGIC;
+    return hdr + 1;
+}
+
 void *cc_hal_sys_malloc(size_t size){
-    return malloc(size);
+    return cc_hal_sys_malloc_caps(size, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_SYS);
 }
 
 void cc_hal_sys_free(void *ptr){
-    free(ptr);
+    if(!ptr){
+        return;
+    }
+    _mem_hdr_t *hdr = (_mem_hdr_t *)ptr - 1;
+    if(hdr->magic != MEM_HDR_MAGIC || hdr->mod >= CC_MEM_MOD_MAX){
+        // 不是 cc_hal_sys_malloc 分配的内存，或头已被越界写坏
+        CC_LOGE(TAG, "free invalid ptr %p", ptr);
+        return;
+    }
+    hdr->magic = 0;
+
+    cc_mem_stat_t *stat = &g_mem_stat[hdr->mod];
+    cc_hal_os_enter_critical(&g_mem_lock);
+    if(hdr->where == MEM_WHERE_SPIRAM){
+        stat->spiram -= hdr->size;
+    }else{
+        stat->internal -= hdr->size;
+    }
+    cc_hal_os_exit_critical(&g_mem_lock);
+
+    if(hdr->where < MEM_POOL_NUM){
+        cc_pool_free(g_pools[hdr->where], hdr);
+    }else{
+        heap_caps_free(hdr);
+    }
+}
+
+cc_err_t cc_hal_sys_mem_stat(cc_mem_mod_t mod, cc_mem_stat_t *stat){
+    if(mod >= CC_MEM_MOD_MAX || !stat){
+        return CC_ERR_INVALID_ARG;
+    }
+    cc_hal_os_enter_critical(&g_mem_lock);
+    *stat = g_mem_stat[mod];
+    cc_hal_os_exit_critical(&g_mem_lock);
+    return CC_OK;
+}
+
+void cc_hal_sys_mem_dump(void){
+    cc_mem_stat_t stat;
+
+    for (uint8_t i = 0; i < CC_MEM_MOD_MAX; i++){
+        cc_hal_sys_mem_stat(i, &stat);
+        CC_LOGI(TAG, "mem %-5s internal %6u  spiram %7u  peak %7u  alloc %lu  fail %lu",
+                g_mem_mod_name[i], (unsigned)stat.internal, (unsigned)stat.spiram, (unsigned)stat.peak,
+                stat.alloc_cnt, stat.fail_cnt);
+    }
+    for (uint8_t i = 0; i < MEM_POOL_NUM; i++){
+        CC_LOGI(TAG, "pool %3u  used %2u/%u", g_pool_size[i], g_pool_ready ? g_pools[i]->used : 0, g_pool_count[i]);
+    }
+    size_t free_size, largest_block;
+    cc_hal_sys_heap_info(&free_size, &largest_block);
+    CC_LOGI(TAG, "internal heap free %u  largest %u", (unsigned)free_size, (unsigned)largest_block);
 }
 
 uint32_t cc_hal_sys_get_rand(uint32_t range){
@@ -36,6 +223,15 @@ uint64_t cc_hal_sys_get_ms(void){
     return xTaskGetTickCount()*portTICK_PERIOD_MS;
 }
 
+void cc_hal_sys_heap_info(size_t *free_size, size_t *largest_block){
+    if(free_size){
+        *free_size = heap_caps_get_free_size(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+    if(largest_block){
+        *largest_block = heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    }
+}
+
 void cc_hal_sys_set_time(uint32_t time){
     
 }
@@ -3,11 +3,18 @@
 #include "cc_log.h"
 
 #include "cc_hal_sys.h"
+#include "cc_hal_kvs.h"
 
+#include "sdkconfig.h"
 #include "esp_netif.h"
+#include "esp_netif_net_stack.h"
 #include "esp_system.h"
 #include "esp_wifi.h"
+#include "esp_mac.h"
 #include "esp_event.h"
+#include "esp_timer.h"
+#include "lwip/dhcp.h"
+#include "ping/ping_sock.h"
 #include <netdb.h>
 
 static char *TAG = "cc_hal_wifi";
@@ -18,6 +25,181 @@ static uint8_t g_ap_list_num = 0;
 static cc_hal_wifi_ap_info_t *g_ap_list = NULL;
 
 static uint8_t g_connect_status = 0;
+static uint8_t g_listen_interval = 0;
+static wifi_config_t g_sta_wifi_config = {0};
+static uint8_t g_hint_try = 0;          // 本次连接使用了调用者给的 BSSID/信道
+static uint8_t g_auth_fail_stop = 0;
+
+#define SCAN_APSTA_DWELL_MIN_MS     30
+#define SCAN_APSTA_DWELL_MAX_MS     60
+
+static esp_ping_handle_t g_probe = NULL;
+static cc_hal_wifi_probe_cb_t g_probe_cb = NULL;
+// DNS 是 lwIP 全局设置，其他接口拿到地址时会被覆盖，切回 STA 时恢复
+static esp_netif_dns_info_t g_sta_dns[ESP_NETIF_DNS_BACKUP + 1];
+
+static esp_netif_t *__sta_netif(void){
+    return esp_netif_get_handle_from_ifkey("WIFI_STA_DEF");
+}
+
+// 按 BSSID/信道直连失败后，下一次重连改为全信道扫描
+static void __sta_scan_all(void){
+    g_sta_wifi_config.sta.bssid_set = 0;
+    g_sta_wifi_config.sta.channel = 0;
+    g_sta_wifi_config.sta.scan_method = WIFI_ALL_CHANNEL_SCAN;
+    g_sta_wifi_config.sta.threshold.authmode = (g_sta_wifi_config.sta.password[0] == 0)?WIFI_AUTH_OPEN:WIFI_AUTH_WPA2_PSK;
+    esp_wifi_set_config(WIFI_IF_STA, &g_sta_wifi_config);
+}
+
+static cc_hal_wifi_connect_err_t __connect_err(uint8_t reason){
+    switch (reason) {
+    case WIFI_REASON_NO_AP_FOUND:
+        return CC_HAL_WIFI_CONNECT_ERR_AP_NOT_FOUND;
+    case WIFI_REASON_AUTH_FAIL:
+    case WIFI_REASON_AUTH_EXPIRE:
+    case WIFI_REASON_MIC_FAILURE:
+    case WIFI_REASON_4WAY_HANDSHAKE_TIMEOUT:
+    case WIFI_REASON_HANDSHAKE_TIMEOUT:
+        // WPA2-PSK 密码错误表现为四次握手超时
+        return CC_HAL_WIFI_CONNECT_ERR_AUTH_FAIL;
+    default:
+        return CC_HAL_WIFI_CONNECT_ERR_UNKNOW;
+    }
+}
+
+#if CONFIG_CC_WIFI_FAST_CONNECT
+/*
+ * 快速重连：DHCP 拿到地址后记下 BSSID、信道、加密方式和租约（IP、网关、DNS），
+ * 下次连同一 SSID 时直接按 BSSID/信道连接，省去全信道扫描，并先用上次的租约作静态 IP，
+ * 连上即有地址，不等 DHCP；到租约续期时间（T1，不超过 CONFIG_CC_WIFI_FAST_STATIC_MAX_S）再切回 DHCP。
+ * 快速连接失败时清除缓存，退回扫描 + DHCP 的正常流程。
+ */
+#define FAST_KVS_KEY            "cc_wifi_fast"
+#define FAST_STATIC_MIN_S       60
+
+typedef struct{
+    uint8_t ssid[32];
+    uint8_t ssid_len;
+    uint8_t bssid[6];
+    uint8_t channel;
+    uint8_t authmode;               // wifi_auth_mode_t
+    uint32_t ip;
+    uint32_t netmask;
+    uint32_t gw;
+    uint32_t dns;
+    uint32_t lease_s;
+}_fast_link_t;
+
+static _fast_link_t g_fast = {0};
+static uint8_t g_fast_try = 0;          // 本次连接使用了缓存的 BSSID/信道
+static uint8_t g_fast_static = 0;       // 当前地址来自缓存的租约，DHCP 客户端未运行
+static esp_timer_handle_t g_fast_renew_timer = NULL;
+
+static void __fast_dhcp_start(void){
+    if(g_fast_renew_timer){
+        esp_timer_stop(g_fast_renew_timer);
+    }
+    if(g_fast_static){
+        g_fast_static = 0;
+        esp_netif_dhcpc_start(__sta_netif());
+    }
+}
+
+static void __fast_renew_cb(void *arg){
+    CC_LOGI(TAG, "fast connect: lease renew, switch to dhcp");
+    __fast_dhcp_start();
+}
+
+static cc_err_t __fast_load(const uint8_t *ssid, uint8_t ssid_len){
+    size_t len = sizeof(g_fast);
+    if(cc_hal_kvs_get(FAST_KVS_KEY, &g_fast, &len) != CC_OK || len != sizeof(g_fast)){
+        return CC_FAIL;
+    }
+    if(g_fast.ssid_len != ssid_len || memcmp(g_fast.ssid, ssid, ssid_len) != 0 || g_fast.channel == 0){
+        return CC_FAIL;
+    }
+    return CC_OK;
+}
+
+static void __fast_invalidate(void){
+    memset(&g_fast, 0, sizeof(g_fast));
+    cc_hal_kvs_del(FAST_KVS_KEY);
+}
+
+// DHCP 拿到地址后记录本次连接
+static void __fast_save(const esp_netif_ip_info_t *ip_info){
+    wifi_ap_record_t ap_info;
+    if(esp_wifi_sta_get_ap_info(&ap_info) != ESP_OK){
+        return;
+    }
+
+    _fast_link_t link = {0};
+    link.ssid_len = strnlen((char *)g_sta_wifi_config.sta.ssid, sizeof(link.ssid));
+    memcpy(link.ssid, g_sta_wifi_config.sta.ssid, link.ssid_len);
+    memcpy(link.bssid, ap_info.bssid, sizeof(link.bssid));
+    link.channel = ap_info.primary;
+    link.authmode = ap_info.authmode;
+    link.ip = ip_info->ip.addr;
+    link.netmask = ip_info->netmask.addr;
+    link.gw = ip_info->gw.addr;
+
+    esp_netif_dns_info_t dns;
+    if(esp_netif_get_dns_info(__sta_netif(), ESP_NETIF_DNS_MAIN, &dns) == ESP_OK){
+        link.dns = dns.ip.u_addr.ip4.addr;
+    }
+    struct netif *lwip_netif = esp_netif_get_netif_impl(__sta_netif());
+    struct dhcp *dhcp = lwip_netif ? netif_dhcp_data(lwip_netif) : NULL;
+    if(dhcp){
+        link.lease_s = dhcp->offered_t0_lease;
+    }
+
+    if(memcmp(&link, &g_fast, sizeof(link)) != 0){
+        g_fast = link;
+        cc_hal_kvs_set(FAST_KVS_KEY, &g_fast, sizeof(g_fast));
+    }
+}
+
+static void __fast_apply(wifi_config_t *wifi_config){
+    memcpy(wifi_config->sta.bssid, g_fast.bssid, sizeof(g_fast.bssid));
+    wifi_config->sta.bssid_set = 1;
+    wifi_config->sta.channel = g_fast.channel;
+    wifi_config->sta.scan_method = WIFI_FAST_SCAN;
+    if(g_fast.authmode < WIFI_AUTH_MAX){
+        wifi_config->sta.threshold.authmode = g_fast.authmode;
+    }
+
+    if(g_fast.ip == 0){
+        return;
+    }
+    esp_netif_t *netif = __sta_netif();
+    esp_netif_ip_info_t ip_info = {
+        .ip.addr = g_fast.ip,
+        .netmask.addr = g_fast.netmask,
+        .gw.addr = g_fast.gw,
+    };
+    esp_netif_dhcpc_stop(netif);
+    if(esp_netif_set_ip_info(netif, &ip_info) != ESP_OK){
+        esp_netif_dhcpc_start(netif);
+        return;
+    }
+    if(g_fast.dns){
+        esp_netif_dns_info_t dns = {0};
+        dns.ip.type = ESP_IPADDR_TYPE_V4;
+        dns.ip.u_addr.ip4.addr = g_fast.dns;
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+    }
+    g_fast_static = 1;
+}
+
+// 快速连接失败：退回扫描 + DHCP
+static void __fast_fallback(void){
+    CC_LOGW(TAG, "fast connect failed, fall back to full scan");
+    g_fast_try = 0;
+    __fast_invalidate();
+    __fast_dhcp_start();
+    __sta_scan_all();
+}
+#endif
 
 static void __event_handler(void* arg, esp_event_base_t event_base,
                                     int32_t event_id, void* event_data)
@@ -29,6 +211,11 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                 // CC_LOGD(TAG, "STA connected to %s", ((wifi_event_sta_connected_t *)event_data)->ssid);
                 if(g_connect_status == 0){
                     g_connect_status = 1;
+                    g_hint_try = 0;
+                    g_auth_fail_stop = 0;
+#if CONFIG_CC_WIFI_FAST_CONNECT
+                    g_fast_try = 0;
+#endif
                     cc_event_post(CC_HAL_WIFI_EVENT, CC_HAL_WIFI_EVENT_STA_CONNECTED, NULL, 0);
                 }
                 break;
@@ -36,18 +223,29 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                 // CC_LOGD(TAG, "STA disconnected, reason(%d)", ((wifi_event_sta_disconnected_t *)event_data)->disconnect_reason);
                 if(g_connect_status == 1){
                     g_connect_status = 0;
+#if CONFIG_CC_WIFI_FAST_CONNECT
+                    // 断线后的重连走 DHCP，租约可能已经变化
+                    __fast_dhcp_start();
+#endif
                     cc_event_post(CC_HAL_WIFI_EVENT, CC_HAL_WIFI_EVENT_STA_DISCONNECTED, NULL, 0);
                 }else{
-                    cc_hal_wifi_connect_err_t connect_err = CC_HAL_WIFI_CONNECT_ERR_UNKNOW;
-                    // wifi_err_reason_t reason = ((wifi_event_sta_disconnected_t *)event_data)->disconnect_reason;
-                    // if(reason == WIFI_REASON_NO_AP_FOUND){
-                    //     connect_err = CC_HAL_WIFI_CONNECT_ERR_AP_NOT_FOUND;
-                    //     CC_LOGW_CODE(TAG, CC_HAL_WIFI_CONNECT_ERR_AP_NOT_FOUND);
-                    // }else if(reason == WIFI_REASON_WRONG_PASSWORD){
-                    //     connect_err = CC_HAL_WIFI_CONNECT_ERR_AUTH_FAIL;
-                    //     CC_LOGW_CODE(TAG, WIFI_REASON_WRONG_PASSWORD);
-                    // }
+                    uint8_t reason = ((wifi_event_sta_disconnected_t *)event_data)->reason;
+                    cc_hal_wifi_connect_err_t connect_err = __connect_err(reason);
+                    CC_LOGW(TAG, "connect fail, reason %d => err %d", reason, connect_err);
+#if CONFIG_CC_WIFI_FAST_CONNECT
+                    if(g_fast_try){
+                        __fast_fallback();
+                    }
+#endif
+                    if(g_hint_try){
+                        g_hint_try = 0;
+                        __sta_scan_all();
+                    }
                     cc_event_post(CC_HAL_WIFI_EVENT, CC_HAL_WIFI_EVENT_STA_CONNECT_FAIL, &connect_err, sizeof(cc_hal_wifi_connect_err_t));
+                    if(g_auth_fail_stop && connect_err == CC_HAL_WIFI_CONNECT_ERR_AUTH_FAIL){
+                        // 密码错误重试也不会成功，交给上层处理
+                        break;
+                    }
                 }
                 esp_wifi_connect();
                 break;
@@ -57,7 +255,7 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                 wifi_ap_record_t *ap_info = NULL;
                 uint16_t ap_num = CC_HAL_WIFI_SCAN_MAX_AP;
                 
-                ap_info = cc_hal_sys_malloc(sizeof(wifi_ap_record_t)*CC_HAL_WIFI_SCAN_MAX_AP);
+                ap_info = cc_hal_sys_malloc_caps(sizeof(wifi_ap_record_t)*CC_HAL_WIFI_SCAN_MAX_AP, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_WIFI);
                 if (ap_info == NULL){
                     CC_LOGE(TAG, "Malloc Fail!");
                     return;
@@ -70,7 +268,7 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                     cc_hal_sys_free(g_ap_list);
                 }
 
-                g_ap_list = cc_hal_sys_malloc(sizeof(cc_hal_wifi_ap_info_t) * g_ap_list_num);
+                g_ap_list = cc_hal_sys_malloc_caps(sizeof(cc_hal_wifi_ap_info_t) * g_ap_list_num, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_WIFI);
                 if (g_ap_list_num > 0 && g_ap_list == NULL){
                     CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
                     return;
@@ -80,6 +278,7 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                 {
                     strcpy((char *)g_ap_list[i].ssid, (char *)ap_info[i].ssid);
                     g_ap_list[i].ssid_len = strlen((char *)ap_info[i].ssid);
+                    memcpy(g_ap_list[i].bssid, ap_info[i].bssid, sizeof(g_ap_list[i].bssid));
                     g_ap_list[i].rssi = ap_info[i].rssi;
                     g_ap_list[i].channel = ap_info[i].primary;
                 }
@@ -96,6 +295,24 @@ static void __event_handler(void* arg, esp_event_base_t event_base,
                 char ip[16] = {0};
                 sprintf(ip, IPSTR, IP2STR(&event->ip_info.ip));
                 CC_LOGI(TAG, "Got IP: %s", ip);
+                esp_netif_get_dns_info(event->esp_netif, ESP_NETIF_DNS_MAIN, &g_sta_dns[ESP_NETIF_DNS_MAIN]);
+                esp_netif_get_dns_info(event->esp_netif, ESP_NETIF_DNS_BACKUP, &g_sta_dns[ESP_NETIF_DNS_BACKUP]);
+#if CONFIG_CC_WIFI_FAST_CONNECT
+                if(g_fast_static){
+                    // 静态地址用到租约 T1 再交给 DHCP 续租
+                    uint32_t static_s = g_fast.lease_s / 2;
+                    if(static_s < FAST_STATIC_MIN_S){
+                        static_s = FAST_STATIC_MIN_S;
+                    }
+                    if(static_s > CONFIG_CC_WIFI_FAST_STATIC_MAX_S){
+                        static_s = CONFIG_CC_WIFI_FAST_STATIC_MAX_S;
+                    }
+                    esp_timer_stop(g_fast_renew_timer);
+                    esp_timer_start_once(g_fast_renew_timer, (uint64_t)static_s * 1000000);
+                }else{
+                    __fast_save(&event->ip_info);
+                }
+#endif
                 cc_event_post(CC_HAL_WIFI_EVENT, CC_HAL_WIFI_EVENT_STA_GOT_IP, ip, strlen(ip) + 1);
                 break;
             }
@@ -238,9 +455,34 @@ cc_err_t cc_hal_wifi_sta_start_connect(cc_hal_wifi_sta_config_t *sta_config){
     memcpy(wifi_config.sta.ssid, sta_config->ssid, sta_config->ssid_len + 1);
     memcpy(wifi_config.sta.password, sta_config->password, sta_config->password_len + 1);
     wifi_config.sta.threshold.authmode = (sta_config->password_len == 0)?WIFI_AUTH_OPEN:WIFI_AUTH_WPA2_PSK;
+    wifi_config.sta.listen_interval = g_listen_interval;
 
     CC_LOGI(TAG, "Connecting to Wi-Fi:%s, PSW:%s",wifi_config.sta.ssid, wifi_config.sta.password);
 
+    g_auth_fail_stop = sta_config->auth_fail_stop;
+    g_hint_try = 0;
+    if(sta_config->bssid_set || sta_config->channel){
+        CC_LOGI(TAG, "hint connect: channel %d, bssid " MACSTR, sta_config->channel, MAC2STR(sta_config->bssid));
+        wifi_config.sta.channel = sta_config->channel;
+        if(sta_config->bssid_set){
+            memcpy(wifi_config.sta.bssid, sta_config->bssid, sizeof(wifi_config.sta.bssid));
+            wifi_config.sta.bssid_set = 1;
+        }
+        wifi_config.sta.scan_method = WIFI_FAST_SCAN;
+        g_hint_try = 1;
+    }
+
+#if CONFIG_CC_WIFI_FAST_CONNECT
+    __fast_dhcp_start();
+    g_fast_try = 0;
+    if(!g_hint_try && __fast_load(sta_config->ssid, sta_config->ssid_len) == CC_OK){
+        CC_LOGI(TAG, "fast connect: channel %d, bssid " MACSTR, g_fast.channel, MAC2STR(g_fast.bssid));
+        __fast_apply(&wifi_config);
+        g_fast_try = 1;
+    }
+#endif
+    g_sta_wifi_config = wifi_config;
+
     esp_wifi_set_mode(WIFI_MODE_STA);
 
     esp_wifi_set_config(WIFI_IF_STA, &wifi_config);
@@ -276,16 +518,134 @@ cc_err_t cc_hal_wifi_get_scan_ap_result(cc_hal_wifi_ap_info_t *ap_list, uint8_t
 }
 
 cc_err_t cc_hal_wifi_scan_start(void){
-    cc_hal_wifi_set_mode(CC_HAL_WIFI_MODE_STA);
+    wifi_mode_t mode = WIFI_MODE_NULL;
+    wifi_scan_config_t scan_config = {0};
+
+    esp_wifi_get_mode(&mode);
+    if(mode == WIFI_MODE_AP || mode == WIFI_MODE_APSTA){
+        // AP 与扫描共用射频，缩短驻留让 AP 上的客户端不掉线
+        cc_hal_wifi_set_mode(CC_HAL_WIFI_MODE_APSTA);
+        scan_config.scan_time.active.min = SCAN_APSTA_DWELL_MIN_MS;
+        scan_config.scan_time.active.max = SCAN_APSTA_DWELL_MAX_MS;
+    }else{
+        cc_hal_wifi_set_mode(CC_HAL_WIFI_MODE_STA);
+    }
 
     esp_wifi_start();
 
     esp_wifi_disconnect();
-    esp_wifi_scan_start(NULL, false);
+    esp_wifi_scan_start(&scan_config, false);
     
     return CC_OK;
 }
 
+cc_err_t cc_hal_wifi_set_country(const char *code){
+    if(code == NULL || strlen(code) != 2){
+        return CC_ERR_INVALID_ARG;
+    }
+    esp_err_t err = esp_wifi_set_country_code(code, true);
+    if(err != ESP_OK){
+        CC_LOGE(TAG, "set country %s failed: %s", code, esp_err_to_name(err));
+        return CC_FAIL;
+    }
+    return CC_OK;
+}
+
+cc_err_t cc_hal_wifi_set_ps(cc_hal_wifi_ps_mode_t mode){
+    static const wifi_ps_type_t ps_map[] = {
+        [CC_HAL_WIFI_PS_NONE] = WIFI_PS_NONE,
+        [CC_HAL_WIFI_PS_MIN_MODEM] = WIFI_PS_MIN_MODEM,
+        [CC_HAL_WIFI_PS_MAX_MODEM] = WIFI_PS_MAX_MODEM,
+    };
+
+    if(mode > CC_HAL_WIFI_PS_MAX_MODEM){
+        return CC_ERR_INVALID_ARG;
+    }
+    esp_err_t err = esp_wifi_set_ps(ps_map[mode]);
+    if(err != ESP_OK){
+        CC_LOGE(TAG, "set ps %d failed: %s", mode, esp_err_to_name(err));
+        return CC_FAIL;
+    }
+    return CC_OK;
+}
+
+void cc_hal_wifi_set_listen_interval(uint8_t interval){
+    g_listen_interval = interval;
+}
+
+static void __probe_success(esp_ping_handle_t hdl, void *args){
+    uint32_t elapsed_ms = 0;
+    esp_ping_get_profile(hdl, ESP_PING_PROF_TIMEGAP, &elapsed_ms, sizeof(elapsed_ms));
+    if(g_probe_cb){
+        g_probe_cb((int32_t)elapsed_ms);
+    }
+}
+
+static void __probe_timeout(esp_ping_handle_t hdl, void *args){
+    if(g_probe_cb){
+        g_probe_cb(-1);
+    }
+}
+
+cc_err_t cc_hal_wifi_probe_start(uint32_t interval_ms, uint32_t timeout_ms, cc_hal_wifi_probe_cb_t cb){
+    esp_netif_ip_info_t ip_info;
+
+    if(cb == NULL || interval_ms == 0 || timeout_ms == 0){
+        return CC_ERR_INVALID_ARG;
+    }
+    cc_hal_wifi_probe_stop();
+
+    if(esp_netif_get_ip_info(__sta_netif(), &ip_info) != ESP_OK || ip_info.gw.addr == 0){
+        CC_LOGE(TAG, "probe: no gateway");
+        return CC_FAIL;
+    }
+
+    esp_ping_config_t config = ESP_PING_DEFAULT_CONFIG();
+    config.target_addr.type = IPADDR_TYPE_V4;
+    config.target_addr.u_addr.ip4.addr = ip_info.gw.addr;
+    config.count = ESP_PING_COUNT_INFINITE;
+    config.interval_ms = interval_ms;
+    config.timeout_ms = timeout_ms;
+    config.data_size = 8;
+    config.interface = esp_netif_get_netif_impl_index(__sta_netif());
+
+    esp_ping_callbacks_t cbs = {
+        .on_ping_success = __probe_success,
+        .on_ping_timeout = __probe_timeout,
+    };
+
+    g_probe_cb = cb;
+    if(esp_ping_new_session(&config, &cbs, &g_probe) != ESP_OK){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        g_probe = NULL;
+        return CC_ERR_NO_MEM;
+    }
+    esp_ping_start(g_probe);
+    return CC_OK;
+}
+
+void cc_hal_wifi_probe_stop(void){
+    if(g_probe){
+        esp_ping_stop(g_probe);
+        esp_ping_delete_session(g_probe);
+        g_probe = NULL;
+    }
+}
+
+cc_err_t cc_hal_wifi_sta_set_default_route(void){
+    esp_netif_t *netif = __sta_netif();
+    if(esp_netif_get_default_netif() != netif && esp_netif_set_default_netif(netif) != ESP_OK){
+        return CC_FAIL;
+    }
+    if(g_sta_dns[ESP_NETIF_DNS_MAIN].ip.u_addr.ip4.addr){
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &g_sta_dns[ESP_NETIF_DNS_MAIN]);
+    }
+    if(g_sta_dns[ESP_NETIF_DNS_BACKUP].ip.u_addr.ip4.addr){
+        esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &g_sta_dns[ESP_NETIF_DNS_BACKUP]);
+    }
+    return CC_OK;
+}
+
 void cc_hal_wifi_init(void){
 
     esp_netif_init();
@@ -299,4 +659,12 @@ void cc_hal_wifi_init(void){
 
     esp_event_handler_register(WIFI_EVENT, ESP_EVENT_ANY_ID, &__event_handler, NULL);
     esp_event_handler_register(IP_EVENT, IP_EVENT_STA_GOT_IP, &__event_handler, NULL);
+
+#if CONFIG_CC_WIFI_FAST_CONNECT
+    const esp_timer_create_args_t renew_args = {
+        .callback = __fast_renew_cb,
+        .name = "wifi_renew",
+    };
+    esp_timer_create(&renew_args, &g_fast_renew_timer);
+#endif
 }
@@ -21,13 +21,41 @@ typedef enum{
 
 typedef void (*cc_hal_ble_recv_cb_t)(uint8_t *data, uint16_t len);
 
+/*
+ * 分帧传输：一条消息拆成多个 write without response / notify 包，每包：
+ *   [0]    CC_HAL_BLE_FRAME_MARK（0xFE 不会出现在 ASCII/UTF-8 文本中，与旧的裸 JSON 分包区分）
+ *   [1]    bit7 首包，bit6 末包，bit0~5 包序号（首包为 0，逐包加 1，64 回绕）
+ *   [2..3] 仅首包：消息总长，小端
+ *   其余   数据，每包最多 ATT MTU - 3 字节（含上面的包头）
+ * 对端发过分帧消息后，本连接上 cc_hal_ble_send() 也按分帧、按 MTU 发送；否则保持旧的 20 字节裸分包
+ * 合包：末包的数据之后若还有空间，可紧接下一条消息的首包（仍以 CC_HAL_BLE_FRAME_MARK 开头）；
+ * 对端发过合包的写入后，本连接上发送也把排队的多条消息合进同一个通知包
+ */
+#define CC_HAL_BLE_FRAME_MARK       0xFE
+#define CC_HAL_BLE_FRAME_FIRST      0x80
+#define CC_HAL_BLE_FRAME_LAST       0x40
+#define CC_HAL_BLE_FRAME_SEQ_MASK   0x3F
+
 cc_err_t cc_hal_ble_start_advzertising(uint8_t *adv_data, uint8_t adv_len, uint8_t *scan_rsp_data, uint8_t scan_rsp_len);
 cc_err_t cc_hal_ble_stop_advzertising(void);
 
 cc_err_t cc_hal_ble_reset_advzertising(uint8_t *adv_data, uint8_t adv_len, uint8_t *scan_rsp_data, uint8_t scan_rsp_len);
 
+/**
+ * 放进发送队列（CONFIG_CC_BLE_TXQ_SIZE）即返回，由 NimBLE host 任务按上面的分帧/合包规则发出
+ * 未连接返回 CC_FAIL，队列满返回 CC_ERR_NO_MEM；cc_hal_ble_deinit() 前会等队列发完（最多 500ms）
+ */
 uint16_t cc_hal_ble_send(uint8_t *data, uint16_t len);
 
+// 当前连接协商后的 ATT MTU，未连接时为 23
+uint16_t cc_hal_ble_get_mtu(void);
+
+/**
+ * 分帧消息重组完成后的回调，在 NimBLE host 任务中调用；未设置时交给 recv_cb
+ * 未分帧的写入仍按原样逐包交给 recv_cb
+ */
+cc_err_t cc_hal_ble_set_msg_cb(cc_hal_ble_recv_cb_t msg_cb);
+
 cc_err_t cc_hal_ble_get_mac(uint8_t *mac);
 
 cc_err_t cc_hal_ble_disconnect(void);
@@ -35,6 +63,13 @@ cc_err_t cc_hal_ble_disconnect(void);
 cc_err_t cc_hal_ble_init(cc_hal_ble_recv_cb_t recv_cb);
 cc_err_t cc_hal_ble_deinit(void);
 
+/**
+ * 把 BT 控制器和协议栈占用的内存归还堆（esp_bt_mem_release），需在 deinit 之后调用
+ * 释放后本次上电内 cc_hal_ble_init() 返回 CC_ERR_NOT_SUPPORTED，只能重启后再用 BLE
+ */
+cc_err_t cc_hal_ble_mem_release(void);
+uint8_t cc_hal_ble_is_available(void);
+
 #ifdef __cplusplus
 }
 #endif
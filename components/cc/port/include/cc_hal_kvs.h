@@ -12,6 +12,12 @@ cc_err_t cc_hal_kvs_get(const char *key, void *value, size_t *len);
 cc_err_t cc_hal_kvs_set(const char *key, const void *value, size_t len);
 cc_err_t cc_hal_kvs_del(const char *key);
 cc_err_t cc_hal_kvs_del_all(void);
+// 立即写入所有尚未落盘的值；cc_hal_kvs_set 默认延迟写入，需要掉电不丢时调用
+cc_err_t cc_hal_kvs_flush(void);
+
+typedef void (*cc_hal_kvs_dirty_cb_t)(const char *key, const void *value, size_t len, void *arg);
+// 对每个尚未落盘的缓存值调用 cb（持有 KVS 锁，不改变脏标记），供掉电前另存；wait_ms 内拿不到锁返回 CC_ERR_TIMEOUT
+cc_err_t cc_hal_kvs_foreach_dirty(cc_hal_kvs_dirty_cb_t cb, void *arg, uint32_t wait_ms);
 
 #ifdef __cplusplus
 }
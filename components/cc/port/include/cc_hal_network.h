@@ -54,8 +54,24 @@ typedef struct {
     cc_err_t (* close_cb)(void *arg, uint16_t); 
 } cc_http_t;
 
+// 创建 HTTP 工作任务与请求队列
+cc_err_t cc_hal_http_init(void);
+// 将请求排入工作任务，完成后在工作任务中调用 close_cb
 cc_err_t cc_hal_http_connect(cc_http_t *client);
 
+/*
+ * DNS 缓存（CONFIG_CC_DNS_CACHE_NUM）：cc_http 与 MQTT 建连时先查缓存，未过期直接使用；
+ * 解析失败时退回上次的地址（含上次上电保存在 KVS 中的）。预取的主机在拿到 IP 后立即重新解析。
+ */
+// 加载保存的缓存并接管 http_client 的域名解析，由 cc_hal_http_init 调用
+cc_err_t cc_hal_dns_init(void);
+// 解析主机名（也可是点分 IP），ip 为网络字节序；可能阻塞，不要在事件循环任务中调用
+cc_err_t cc_hal_dns_resolve(const char *host, uint32_t *ip);
+// 标记为预取：后台解析一次，之后每次拿到 IP 都重新解析；参数可以是主机名或 URL
+cc_err_t cc_hal_dns_prefetch(const char *host_or_url);
+// 连接该主机的缓存地址失败，下次重新解析且解析失败时不再退回该地址
+void cc_hal_dns_invalidate(const char *host);
+
 enum{
     CC_IP_TYPE_IPv4 = 0,
     CC_IP_TYPE_IPv6 = 1,
@@ -84,6 +100,26 @@ cc_err_t cc_hal_tcpc_reconnect(cc_tcpc_t *client);
 cc_err_t cc_hal_tcpc_send(cc_tcpc_t *client, char *data, uint16_t len);
 
 
+/**
+ * 网络事件循环：socket 登记后由同一个任务 select()，就绪时在该任务中调用回调。
+ * 回调中不要长时间阻塞，否则会拖慢其他 socket。
+ */
+#define CC_NET_EV_READ      (1 << 0)
+#define CC_NET_EV_WRITE     (1 << 1)
+
+typedef void (*cc_net_io_cb_t)(int fd, uint8_t events, void *arg);
+typedef void (*cc_net_post_cb_t)(void *arg);
+
+cc_err_t cc_hal_net_watch(int fd, uint8_t events, cc_net_io_cb_t cb, void *arg);
+cc_err_t cc_hal_net_set_events(int fd, uint8_t events);
+// 取消登记并关闭 fd；在其他任务中调用时由事件循环在本轮结束后关闭
+cc_err_t cc_hal_net_close(int fd);
+// 在事件循环任务中执行 cb，此时没有正在执行的 socket 回调
+cc_err_t cc_hal_net_post(cc_net_post_cb_t cb, void *arg);
+// 事件循环共用的接收缓冲，只能在回调中使用
+uint8_t *cc_hal_net_rx_buf(uint16_t *size);
+
+
 typedef struct {
     char *host;
     uint16_t port;
@@ -100,6 +136,7 @@ typedef struct {
 
 cc_err_t cc_hal_tcps_create(cc_tcps_t *server);
 cc_err_t cc_hal_tcps_delete(cc_tcps_t *server);
+// 非阻塞，发不完的部分缓存后续发；积压放不下整条消息时返回 CC_ERR_NOT_RESOURCES
 cc_err_t cc_hal_tcps_send(cc_tcps_t *server, uint8_t client_id, char *data, uint16_t len);
 
 #define cc_udp_addr_t   cc_addr_t
@@ -134,12 +171,15 @@ typedef struct {
     char *password;
     void *arg;
     cc_err_t (*connect_cb)(void *arg);
-    cc_err_t (*msg_cb)(void *arg, char *topic, char *data, uint16_t len, cc_mqtt_qos_t qos, uint8_t retain); 
+    // topic 不以 '\0' 结尾，按 topic_len 使用；分片消息收齐后才回调一次；topic/data 仅在回调期间有效
+    cc_err_t (*msg_cb)(void *arg, const char *topic, uint16_t topic_len, char *data, uint32_t len, cc_mqtt_qos_t qos, uint8_t retain);
     cc_err_t (*disconnect_cb)(void *arg);
 } cc_mqtt_t;
 
 cc_err_t cc_hal_mqtt_create(cc_mqtt_t *mqtt);
 cc_err_t cc_hal_mqtt_delete(cc_mqtt_t *mqtt);
+// 立即断开并重连，不等保活超时和重连间隔；默认路由切换后用于把连接迁到新链路
+cc_err_t cc_hal_mqtt_reconnect(cc_mqtt_t *mqtt);
 cc_err_t cc_hal_mqtt_subscribe(cc_mqtt_t *mqtt, char *topic, cc_mqtt_qos_t qos);
 cc_err_t cc_hal_mqtt_publish(cc_mqtt_t *mqtt, char *topic, char *msg, uint16_t len, cc_mqtt_qos_t qos, uint8_t retain);
 
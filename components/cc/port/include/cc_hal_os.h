@@ -7,6 +7,7 @@ extern "C" {
 
 #include "cc_err.h"
 
+#include "sdkconfig.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
@@ -17,6 +18,7 @@ extern "C" {
 
 typedef TaskHandle_t cc_os_task_handle_t;
 typedef QueueHandle_t cc_os_semphr_handle_t;
+typedef StaticSemaphore_t cc_os_semphr_buf_t;
 
 typedef TaskFunction_t cc_os_task_t;
 
@@ -25,8 +27,46 @@ typedef TickType_t cc_os_tick_t;
 #define CC_OS_MAX_DELAY                 portMAX_DELAY
 #define CC_OS_MS_TO_TICK                pdMS_TO_TICKS
 
+typedef portMUX_TYPE cc_os_spinlock_t;
+#define CC_OS_SPINLOCK_INIT             portMUX_INITIALIZER_UNLOCKED
+#define cc_hal_os_spinlock_init(lock)   portMUX_INITIALIZE(lock)
+#define cc_hal_os_enter_critical(lock)  portENTER_CRITICAL(lock)
+#define cc_hal_os_exit_critical(lock)   portEXIT_CRITICAL(lock)
+
+/*
+ * 常驻任务登记表：X(标识, 任务名, 栈大小（字节）, 个数)。
+ * 开启 CONFIG_CC_OS_STATIC_TASKS 时，表中任务的栈和 TCB 在 cc_hal_os.c 中静态分配（.bss），
+ * cc_hal_os_task_create() 按任务名（多个时按前缀，如 "cc_worker0"）取用，不占用堆，
+ * 最坏情况的内存占用在链接时即可确定。栈大小以本表为准，各模块创建任务时引用这里的宏。
+ */
+#define CC_OS_STACK_KVS_WRITER          3072
+#define CC_OS_STACK_HAL_HTTP            3072
+#define CC_OS_STACK_NET_LOOP            (4096 + 1024)
+#define CC_OS_STACK_WORKER              CONFIG_CC_WORKER_STACK_SIZE
+
+#define CC_OS_STATIC_TASKS(X) \
+    X(KVS_WRITER,   "kvs_writer",   CC_OS_STACK_KVS_WRITER, 1) \
+    X(HAL_HTTP,     "hal_http",     CC_OS_STACK_HAL_HTTP,   1) \
+    X(NET_LOOP,     "hal_net_loop", CC_OS_STACK_NET_LOOP,   1) \
+    X(WORKER,       "cc_worker",    CC_OS_STACK_WORKER,     CONFIG_CC_WORKER_NUM)
+
+/*
+ * 任务栈放置：内部 RAM 留给 DMA、Wi-Fi 缓冲和时延敏感的任务，不常运行的常驻任务栈放到 PSRAM。
+ * 栈在 PSRAM 的任务在 cache 关闭期间（写 flash 时）不能运行，自身也不能写 flash（NVS、OTA、分区擦写），
+ * 这类任务和被 ISR 频繁唤醒的任务都用 CC_OS_STACK_SRAM。
+ */
+typedef enum {
+    CC_OS_STACK_SRAM = 0,       // 内部 RAM，与 cc_hal_os_task_create() 相同
+    CC_OS_STACK_PSRAM,          // 栈在 PSRAM、TCB 在内部 RAM；只用于常驻任务，任务删除后不回收
+} cc_os_stack_mem_t;
+
 cc_os_semphr_handle_t cc_hal_os_semphr_create_binary(void);
 cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex(void);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting(uint32_t max_count, uint32_t init_count);
+// 由调用者提供存储（通常为静态变量），不分配内存；buf 在信号量删除前须一直有效
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary_static(cc_os_semphr_buf_t *buf);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex_static(cc_os_semphr_buf_t *buf);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting_static(uint32_t max_count, uint32_t init_count, cc_os_semphr_buf_t *buf);
 cc_err_t cc_hal_os_semphr_delete(cc_os_semphr_handle_t handle);
 cc_err_t cc_hal_os_semphr_take(cc_os_semphr_handle_t handle, cc_os_tick_t tick);
 cc_err_t cc_hal_os_semphr_give(cc_os_semphr_handle_t handle);
@@ -34,6 +74,14 @@ cc_err_t cc_hal_os_semphr_give(cc_os_semphr_handle_t handle);
 void cc_hal_os_task_delay(cc_os_tick_t tick);
 void cc_hal_os_task_delete(cc_os_task_handle_t handle);
 cc_err_t cc_hal_os_task_create(cc_os_task_t task, const char *name, uint32_t stack_size, void *arg, uint8_t priority, cc_os_task_handle_t *handle);
+// 由调用者提供栈（stack_size 字节）和 TCB；任务删除前两者须一直有效
+cc_err_t cc_hal_os_task_create_static(cc_os_task_t task, const char *name, uint32_t stack_size, void *arg, uint8_t priority,
+                                      StackType_t *stack, StaticTask_t *tcb, cc_os_task_handle_t *handle);
+// 按 mem 放置任务栈；未开启 CONFIG_CC_OS_PSRAM_STACKS 或 PSRAM 分配失败时退回内部 RAM
+cc_err_t cc_hal_os_task_create_caps(cc_os_task_t task, const char *name, uint32_t stack_size, void *arg, uint8_t priority,
+                                    cc_os_stack_mem_t mem, cc_os_task_handle_t *handle);
+// 打印登记表中任务的使用情况和栈余量，以及 PSRAM 上的任务栈
+void cc_hal_os_static_tasks_dump(void);
 
 #ifdef __cplusplus
 }
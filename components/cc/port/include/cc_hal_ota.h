@@ -5,16 +5,34 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+
 #include "cc_err.h"
 
+#define CC_HAL_OTA_SECTOR_SIZE      4096
+
+// 写入 idx 处，调用方须从 begin 的位置起顺序写；新进入的扇区在写之前擦除
 cc_err_t cc_hal_ota_update(uint32_t idx, uint8_t *buf, uint16_t len);
 
+// 校验镜像并设为启动分区
 cc_err_t cc_hal_ota_end(void);
 
 cc_err_t cc_hal_ota_begin(void);
 
+// 从 offset 处继续写入（须扇区对齐），offset 之前已写入的内容保留，用于断点续传
+cc_err_t cc_hal_ota_begin_at(uint32_t offset);
+
+// 下一次升级写入的分区（flash 地址），0 表示没有可用分区；用于判断断点是否仍然有效
+uint32_t cc_hal_ota_next_partition_id(void);
+
+// 读当前运行分区的内容，用于差分升级
+cc_err_t cc_hal_ota_read_running(uint32_t offset, void *buf, uint32_t len);
+
+// 当前运行镜像的 ELF SHA256（esp_app_desc_t.app_elf_sha256），用于确认差分包的基准
+cc_err_t cc_hal_ota_running_sha256(uint8_t sha256[32]);
+
 #ifdef __cplusplus
 }
 #endif
 
-#endif
\ No newline at end of file
+#endif
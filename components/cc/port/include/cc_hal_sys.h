@@ -5,6 +5,8 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
+
 #include "cc_err.h"
 
 typedef enum{
@@ -19,13 +21,58 @@ typedef enum{
     CC_RST_UNSUPPORT,                //不支持 
 }cc_rst_reason_t;
 
+/* 内存放置策略
+ *
+ * CC_MEM_CAP_DEFAULT  按大小选择：小块走内部 RAM 定长池，>= CC_MEM_SPIRAM_THRESHOLD 优先 PSRAM，其余内部 RAM
+ * CC_MEM_CAP_INTERNAL 只用内部 RAM（热点元数据、ISR/关 cache 时访问的数据）
+ * CC_MEM_CAP_DMA      内部 RAM 且 DMA 可访问（4 字节对齐）
+ * CC_MEM_CAP_SPIRAM   优先 PSRAM，不足或未启用 PSRAM 时退回内部 RAM
+ *
+ * 所有分配都由 cc_hal_sys_free() 释放。
+ */
+#define CC_MEM_CAP_DEFAULT          0
+#define CC_MEM_CAP_INTERNAL         (1 << 0)
+#define CC_MEM_CAP_DMA              (1 << 1)
+#define CC_MEM_CAP_SPIRAM           (1 << 2)
+
+#define CC_MEM_SPIRAM_THRESHOLD     1024        // 默认策略下不小于此大小的缓冲放 PSRAM
+
+// 按模块统计用量
+typedef enum{
+    CC_MEM_MOD_SYS = 0,             // 未指定模块（cc_hal_sys_malloc）
+    CC_MEM_MOD_LIST,
+    CC_MEM_MOD_TIMER,
+    CC_MEM_MOD_HTTP,
+    CC_MEM_MOD_NET,
+    CC_MEM_MOD_WIFI,
+    CC_MEM_MOD_APP,
+    CC_MEM_MOD_MAX,
+}cc_mem_mod_t;
+
+typedef struct{
+    size_t internal;                // 当前占用的内部 RAM（含池）
+    size_t spiram;                  // 当前占用的 PSRAM
+    size_t peak;                    // 总占用峰值
+    uint32_t alloc_cnt;
+    uint32_t fail_cnt;
+}cc_mem_stat_t;
+
 void *cc_hal_sys_malloc(size_t size);
+void *cc_hal_sys_malloc_caps(size_t size, uint32_t caps, cc_mem_mod_t mod);
 void cc_hal_sys_free(void *ptr);
 
+cc_err_t cc_hal_sys_mem_stat(cc_mem_mod_t mod, cc_mem_stat_t *stat);
+
+// 打印各模块与定长池的用量
+void cc_hal_sys_mem_dump(void);
+
 uint32_t cc_hal_sys_get_rand(uint32_t range);
 
 uint64_t cc_hal_sys_get_ms(void);
 
+// 内部 RAM 堆的剩余大小与最大连续空闲块
+void cc_hal_sys_heap_info(size_t *free_size, size_t *largest_block);
+
 void cc_hal_sys_set_time(uint32_t time);
 uint32_t cc_hal_sys_get_time(void);
 
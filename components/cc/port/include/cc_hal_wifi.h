@@ -45,6 +45,12 @@ typedef enum {
     CC_HAL_WIFI_IF_AP,
 } cc_hal_wifi_interface_t;
 
+typedef enum {
+    CC_HAL_WIFI_PS_NONE = 0,        /**< no power save, lowest latency */
+    CC_HAL_WIFI_PS_MIN_MODEM,       /**< wake up every DTIM */
+    CC_HAL_WIFI_PS_MAX_MODEM,       /**< wake up every listen interval */
+} cc_hal_wifi_ps_mode_t;
+
 typedef enum {
     CC_HAL_WIFI_AUTH_OPEN = 0,         /**< authenticate mode : open */
     CC_HAL_WIFI_AUTH_WEP,              /**< authenticate mode : WEP */
@@ -85,6 +91,7 @@ typedef struct {
     uint8_t channel;       /**< channel of target AP. Set to 1~13 to scan starting from the specified channel before connecting to AP. If the channel of AP is unknown, set it to 0.*/
     uint8_t bssid_set;        /**< whether set MAC address of target AP or not. Generally, station_config.bssid_set needs to be 0; and it needs to be 1 only when users need to check the MAC address of the AP.*/
     uint8_t bssid[6];     /**< MAC address of target AP*/
+    uint8_t auth_fail_stop;     /**< 未连上过时鉴权失败不自动重试，只上报 CONNECT_FAIL（配网时校验密码用），连上后清除 */
  } cc_hal_wifi_sta_config_t;
 
  typedef struct{
@@ -109,13 +116,30 @@ cc_err_t cc_hal_wifi_set_mode(cc_hal_wifi_mode_t mode);
 cc_err_t cc_hal_wifi_ap_start_setup(cc_hal_wifi_ap_config_t *ap_config);
 cc_err_t cc_hal_wifi_ap_stop(void);
 
+// channel/bssid_set 非 0 时直接按该信道/BSSID 连接，失败一次后退回全信道扫描
 cc_err_t cc_hal_wifi_sta_start_connect(cc_hal_wifi_sta_config_t *wifi_config);
 cc_err_t cc_hal_wifi_sta_disconnect(void);
 
 uint8_t cc_hal_wifi_get_scan_ap_result_numbers(void);
 cc_err_t cc_hal_wifi_get_scan_ap_result(cc_hal_wifi_ap_info_t *ap_list, uint8_t ap_num);
+// 已开 AP 时切到 APSTA 并缩短每信道驻留时间，AP 不中断
 cc_err_t cc_hal_wifi_scan_start(void);
 
+// 设置 STA 省电模式，可随时切换
+cc_err_t cc_hal_wifi_set_ps(cc_hal_wifi_ps_mode_t mode);
+// 设置国家/地区码（两个字母，如 "CN"），决定可用信道与发射功率，Wi-Fi 启动后调用
+cc_err_t cc_hal_wifi_set_country(const char *code);
+// 设置 MAX_MODEM 下的监听间隔（beacon 个数，0 使用默认值 3），在下次连接时生效
+void cc_hal_wifi_set_listen_interval(uint8_t interval);
+
+// 网关探测结果，rtt_ms 为 -1 表示超时；在探测任务中回调
+typedef void (*cc_hal_wifi_probe_cb_t)(int32_t rtt_ms);
+// 每 interval_ms 经 STA 接口向网关发一个 ICMP echo，不受默认路由影响；须在拿到 IP 后调用，重复调用先停掉上一次
+cc_err_t cc_hal_wifi_probe_start(uint32_t interval_ms, uint32_t timeout_ms, cc_hal_wifi_probe_cb_t cb);
+void cc_hal_wifi_probe_stop(void);
+// STA 设为默认路由并恢复 STA 拿到地址时的 DNS，其他接口被设为默认后用于切回
+cc_err_t cc_hal_wifi_sta_set_default_route(void);
+
 void cc_hal_wifi_init(void);
 
 #ifdef __cplusplus
@@ -0,0 +1,301 @@
+/*
+ * cc 运行时基准：cc_timer / cc_tmr_task 随定时器数量的开销、cc_list / cc_dlist 吞吐、
+ * 随机分配释放后的堆碎片、请求排队时 cc_http_run 的开销，均以 CPU 周期计。
+ *
+ * 独立的测试应用，不跑产品固件的 network_task：时间轮由这里用假时间推进，不影响任何真实定时器。
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "esp_netif.h"
+#include "esp_event.h"
+#include "nvs_flash.h"
+
+#include "cc_list.h"
+#include "cc_timer.h"
+#include "cc_tmr_task.h"
+#include "cc_http.h"
+#include "cc_hal_sys.h"
+
+#define TAG "cc_bench"
+
+#define BENCH_RUNS              200     // 每项取平均的调用次数
+#define BENCH_MAX_TIMERS        256
+#define BENCH_LIST_NODES        32
+#define BENCH_DLIST_NODES       256
+#define BENCH_CHURN_OPS         2000
+#define BENCH_CHURN_SLOTS       64
+#define BENCH_CHURN_SIZE_MAX    512
+#define BENCH_HTTP_URL          "http://127.0.0.1:1/"
+#define BENCH_HTTP_WAIT_MS      5000
+
+static volatile uint32_t s_hits = 0;
+
+// cc 模块只初始化一次，各用例共用
+static void bench_init(void)
+{
+    static bool s_ready = false;
+    if (s_ready) {
+        return;
+    }
+    esp_err_t ret = nvs_flash_init();
+    if (ret == ESP_ERR_NVS_NO_FREE_PAGES || ret == ESP_ERR_NVS_NEW_VERSION_FOUND) {
+        TEST_ESP_OK(nvs_flash_erase());
+        ret = nvs_flash_init();
+    }
+    TEST_ESP_OK(ret);
+    // cc_http 的请求走 lwIP 套接字
+    TEST_ESP_OK(esp_netif_init());
+    TEST_ESP_OK(esp_event_loop_create_default());
+    TEST_ASSERT_EQUAL(CC_OK, cc_hal_sys_init());
+    TEST_ASSERT_EQUAL(CC_OK, cc_timer_init());
+    TEST_ASSERT_EQUAL(CC_OK, cc_tmr_task_init());
+    TEST_ASSERT_EQUAL(CC_OK, cc_http_init());
+    s_ready = true;
+}
+
+static void timer_cb(void *arg)
+{
+    s_hits++;
+}
+
+static void tmr_task_cb(uint32_t interval, void *arg)
+{
+    s_hits++;
+}
+
+static void bench_timer(uint16_t count)
+{
+    cc_timer_handle_t *timers = calloc(count, sizeof(cc_timer_handle_t));
+    TEST_ASSERT_NOT_NULL(timers);
+
+    cc_timer_config_t config = {
+        .type = CC_TIMER_TYPE_SW,
+        .callback = timer_cb,
+        .arg = NULL,
+    };
+
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < count; i++) {
+        timers[i] = cc_timer_create(&config);
+        TEST_ASSERT_NOT_NULL(timers[i]);
+        // 周期分散在 10ms ~ 10s，覆盖时间轮的多个层级
+        cc_timer_start_periodic(timers[i], (uint64_t)CC_TIMER_TICK_US * (1 + (i * 37) % 1000));
+    }
+    uint32_t create_cycles = esp_cpu_get_cycle_count() - start;
+
+    s_hits = 0;
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++) {
+        cc_timer_run(CC_TIMER_TICK_US);
+    }
+    uint32_t run_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < count; i++) {
+        cc_timer_stop(timers[i]);
+        cc_timer_delete(&timers[i]);
+    }
+    uint32_t delete_cycles = esp_cpu_get_cycle_count() - start;
+    free(timers);
+
+    ESP_LOGI(TAG, "cc_timer    n=%4u  create+start %6lu cyc/op  run %7lu cyc/tick  delete %6lu cyc/op  fired %lu",
+             count, create_cycles / count, run_cycles / BENCH_RUNS, delete_cycles / count, s_hits);
+}
+
+TEST_CASE("cc_timer run cost vs timer count", "[cc_bench]")
+{
+    bench_init();
+    for (uint16_t n = 1; n <= BENCH_MAX_TIMERS; n *= 4) {
+        bench_timer(n);
+    }
+}
+
+static void bench_tmr_task(uint16_t count)
+{
+    cc_tmr_task_handle_t handles[CC_TMR_TASK_MAX];
+    uint16_t created = 0;
+
+    for (uint16_t i = 0; i < count && i < CC_TMR_TASK_MAX; i++) {
+        handles[created] = cc_tmr_task_create_handle(tmr_task_cb, 10 * (1 + i), NULL);
+        TEST_ASSERT_NOT_EQUAL(CC_TMR_TASK_INVALID, handles[created]);
+        created++;
+    }
+
+    s_hits = 0;
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++) {
+        cc_tmr_task_run(10);
+    }
+    uint32_t run_cycles = esp_cpu_get_cycle_count() - start;
+
+    for (uint16_t i = 0; i < created; i++) {
+        cc_tmr_task_delete_handle(handles[i]);
+    }
+
+    ESP_LOGI(TAG, "cc_tmr_task n=%4u  run %7lu cyc/tick  fired %lu", created, run_cycles / BENCH_RUNS, s_hits);
+}
+
+TEST_CASE("cc_tmr_task run cost vs task count", "[cc_bench]")
+{
+    bench_init();
+    for (uint16_t n = 1; n <= CC_TMR_TASK_MAX; n *= 2) {
+        bench_tmr_task(n);
+    }
+}
+
+TEST_CASE("cc_list and cc_dlist throughput", "[cc_bench]")
+{
+    static uint32_t data[BENCH_LIST_NODES];
+    cc_list_node *list = NULL;
+    uint32_t start, insert_cycles, find_cycles, remove_cycles;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_LIST_NODES; i++) {
+        if (list) {
+            cc_list_insert_end(list, &data[i]);
+        } else {
+            list = cc_list_create(&data[i]);
+        }
+    }
+    insert_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_LIST_NODES; i++) {
+        TEST_ASSERT_NOT_NULL(cc_list_find_by_data(list, &data[(i * 7) % BENCH_LIST_NODES]));
+    }
+    find_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_LIST_NODES; i++) {
+        cc_list_remove_by_data(&list, &data[(i * 7) % BENCH_LIST_NODES]);
+    }
+    remove_cycles = esp_cpu_get_cycle_count() - start;
+    cc_list_destroy(&list);
+
+    ESP_LOGI(TAG, "cc_list     n=%4u  insert_end %6lu cyc/op  find %6lu cyc/op  remove %6lu cyc/op",
+             BENCH_LIST_NODES, insert_cycles / BENCH_LIST_NODES, find_cycles / BENCH_LIST_NODES,
+             remove_cycles / BENCH_LIST_NODES);
+
+    static cc_dlist_node_t nodes[BENCH_DLIST_NODES];
+    cc_dlist_t dlist = CC_DLIST_INIT;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_DLIST_NODES; i++) {
+        cc_dlist_push_back(&dlist, &nodes[i]);
+    }
+    insert_cycles = esp_cpu_get_cycle_count() - start;
+
+    start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_DLIST_NODES; i++) {
+        cc_dlist_remove(&dlist, &nodes[(i * 7) % BENCH_DLIST_NODES]);
+    }
+    remove_cycles = esp_cpu_get_cycle_count() - start;
+
+    ESP_LOGI(TAG, "cc_dlist    n=%4u  push_back %6lu cyc/op  remove %6lu cyc/op",
+             BENCH_DLIST_NODES, insert_cycles / BENCH_DLIST_NODES, remove_cycles / BENCH_DLIST_NODES);
+}
+
+TEST_CASE("heap fragmentation after malloc/free churn", "[cc_bench]")
+{
+    void *slots[BENCH_CHURN_SLOTS] = {0};
+    size_t free_before, largest_before, free_churn, largest_churn, free_after, largest_after;
+    uint32_t alloc_cycles = 0, alloc_cnt = 0;
+
+    cc_hal_sys_heap_info(&free_before, &largest_before);
+
+    // 随机大小随机槽位的分配释放，始终保留约一半的块
+    for (uint16_t i = 0; i < BENCH_CHURN_OPS; i++) {
+        uint32_t slot = cc_hal_sys_get_rand(BENCH_CHURN_SLOTS);
+        if (slots[slot]) {
+            cc_hal_sys_free(slots[slot]);
+            slots[slot] = NULL;
+        } else {
+            size_t size = 16 + cc_hal_sys_get_rand(BENCH_CHURN_SIZE_MAX);
+            uint32_t start = esp_cpu_get_cycle_count();
+            slots[slot] = cc_hal_sys_malloc(size);
+            alloc_cycles += esp_cpu_get_cycle_count() - start;
+            alloc_cnt++;
+        }
+    }
+    cc_hal_sys_heap_info(&free_churn, &largest_churn);
+
+    for (uint16_t i = 0; i < BENCH_CHURN_SLOTS; i++) {
+        if (slots[i]) {
+            cc_hal_sys_free(slots[i]);
+        }
+    }
+    cc_hal_sys_heap_info(&free_after, &largest_after);
+
+    // 碎片率 = 1 - 最大空闲块 / 总空闲
+    ESP_LOGI(TAG, "heap        malloc %lu cyc/op  frag before %u%%  during %u%%  after %u%%  free delta %d",
+             alloc_cnt ? alloc_cycles / alloc_cnt : 0,
+             (unsigned)(100 - largest_before * 100 / (free_before ? free_before : 1)),
+             (unsigned)(100 - largest_churn * 100 / (free_churn ? free_churn : 1)),
+             (unsigned)(100 - largest_after * 100 / (free_after ? free_after : 1)),
+             (int)free_after - (int)free_before);
+}
+
+static void http_req_cb(void *arg, int resp_code, uint8_t *buf, uint16_t len)
+{
+    s_hits++;
+}
+
+static void bench_http(uint8_t count)
+{
+    static uint8_t resp_buf[CC_HTTP_CTX_MAX][64];
+    uint8_t queued = 0;
+
+    s_hits = 0;
+    for (uint8_t i = 0; i < count; i++) {
+        cc_http_request_t request = CC_HTTP_REQUEST_DEFAULT;
+        request.url = BENCH_HTTP_URL;
+        request.method = CC_HTTP_METHOD_GET;
+        request.resp_buf = resp_buf[i];
+        request.resp_buf_len = sizeof(resp_buf[i]);
+        request.req_cb = http_req_cb;
+        request.auto_free = 0;
+        request.retry_cnt = 1;
+        if (cc_http_request(request) == CC_OK) {
+            queued++;
+        }
+    }
+
+    // 请求在 HAL 的 HTTP 任务中执行，这里测量排队期间 cc_http_run 本身的开销
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (uint16_t i = 0; i < BENCH_RUNS; i++) {
+        cc_http_run(10);
+    }
+    uint32_t run_cycles = esp_cpu_get_cycle_count() - start;
+
+    // 连到本机关闭的端口，每个请求很快以失败结束
+    uint64_t deadline = cc_hal_sys_get_ms() + BENCH_HTTP_WAIT_MS;
+    while (s_hits < queued && cc_hal_sys_get_ms() < deadline) {
+        cc_http_run(10);
+        cc_timer_run(CC_TIMMER_MS(10));
+        vTaskDelay(pdMS_TO_TICKS(10));
+    }
+
+    ESP_LOGI(TAG, "cc_http     n=%4u  run %7lu cyc/call  finished %lu/%u", queued, run_cycles / BENCH_RUNS, s_hits, queued);
+    TEST_ASSERT_EQUAL(queued, s_hits);
+}
+
+TEST_CASE("cc_http run cost with queued requests", "[cc_bench]")
+{
+    bench_init();
+    for (uint8_t n = 1; n <= CC_HTTP_CTX_MAX; n *= 2) {
+        bench_http(n);
+    }
+    cc_hal_sys_mem_dump();
+}
+
+void app_main(void)
+{
+    printf("CC BENCH\n");
+    unity_run_menu();
+}
@@ -0,0 +1,21 @@
+'''
+Steps to run these cases:
+- Build
+  - . ${IDF_PATH}/export.sh
+  - pip install idf_build_apps
+  - python tools/build_apps.py components/cc/test_apps/cc_bench -t esp32s3
+- Test
+  - pip install -r tools/requirements/requirement.pytest.txt
+  - pytest components/cc/test_apps/cc_bench --target esp32s3
+'''
+
+import pytest
+from pytest_embedded import Dut
+
+@pytest.mark.target('esp32s3')
+@pytest.mark.env('generic')
+@pytest.mark.timeout(10 * 60)
+def test_cc_bench(dut: Dut)-> None:
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[auto]')
+    dut.expect_unity_test_output(timeout = 600)
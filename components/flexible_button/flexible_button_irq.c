@@ -0,0 +1,258 @@
+/**
+ * @File:    flexible_button_irq.c
+ *
+ * Interrupt driven front end for flexible_button on ESP-IDF.
+ * See flexible_button_irq.h.
+ *
+ * License-Identifier: Apache-2.0
+*/
+
+#include "flexible_button_irq.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_sleep.h"
+#include "esp_log.h"
+
+#define FLEX_BTN_IRQ_MAX    (sizeof(uint32_t) * 8)
+
+static const char *TAG = "flex_btn_irq";
+
+typedef struct
+{
+    flex_button_t *button;
+    gpio_num_t gpio;
+    flex_button_response_callback user_cb;
+} btn_slot_t;
+
+static btn_slot_t s_slots[FLEX_BTN_IRQ_MAX];
+static uint8_t s_slot_cnt = 0;
+static QueueHandle_t s_queue = NULL;
+static TaskHandle_t s_task = NULL;
+static TickType_t s_period = 1;
+static uint32_t s_dropped = 0;
+
+static btn_slot_t *slot_find(const flex_button_t *button)
+{
+    for (uint8_t i = 0; i < s_slot_cnt; i++)
+    {
+        if (s_slots[i].button == button)
+        {
+            return &s_slots[i];
+        }
+    }
+    return NULL;
+}
+
+static uint8_t button_gpio_read(void *arg)
+{
+    flex_button_t *button = (flex_button_t *)arg;
+    btn_slot_t *slot = slot_find(button);
+    return slot ? gpio_get_level(slot->gpio) : !button->pressed_logic_level;
+}
+
+/* Runs in the scan task: queue the event, then the user's own callback */
+static void button_event_cb(void *arg)
+{
+    flex_button_t *button = (flex_button_t *)arg;
+    flex_button_irq_event_t evt = {
+        .button = button,
+        .id = button->id,
+        .event = (flex_button_event_t)button->event,
+        .time_us = esp_timer_get_time(),
+    };
+
+    if (xQueueSend(s_queue, &evt, 0) != pdTRUE)
+    {
+        ESP_LOGW(TAG, "event queue full, %lu dropped", (unsigned long)++s_dropped);
+    }
+
+    btn_slot_t *slot = slot_find(button);
+    if (slot && slot->user_cb)
+    {
+        slot->user_cb(button);
+    }
+}
+
+/**
+ * Level interrupt on the pressed level: mask it until the scan task has seen
+ * the button released again, so a held button does not retrigger.
+*/
+static void button_isr(void *arg)
+{
+    btn_slot_t *slot = (btn_slot_t *)arg;
+    BaseType_t woken = pdFALSE;
+
+    gpio_intr_disable(slot->gpio);
+    vTaskNotifyGiveFromISR(s_task, &woken);
+    if (woken)
+    {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static void button_task(void *arg)
+{
+    uint8_t interval = (uint8_t)(s_period * portTICK_PERIOD_MS);
+
+    for (;;)
+    {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+
+        /* First scan right at the edge; keep scanning while any button is active */
+        TickType_t last = xTaskGetTickCount();
+        while (flex_button_scan(interval))
+        {
+            vTaskDelayUntil(&last, s_period);
+        }
+
+        /* A button still held re-raises its level interrupt immediately */
+        for (uint8_t i = 0; i < s_slot_cnt; i++)
+        {
+            gpio_intr_enable(s_slots[i].gpio);
+        }
+    }
+}
+
+/**
+ * @brief Register a user button that is read from a GPIO.
+ *
+ * @param button: button structure instance
+ * @param gpio: GPIO the button is connected to
+ * @return ESP_OK, or an error when the button or GPIO cannot be registered
+*/
+esp_err_t flex_button_irq_add(flex_button_t *button, gpio_num_t gpio)
+{
+    if (!button || !GPIO_IS_VALID_GPIO(gpio))
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_slot_cnt >= FLEX_BTN_IRQ_MAX)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    gpio_config_t io_conf = {
+        .pin_bit_mask = 1ULL << gpio,
+        .mode = GPIO_MODE_INPUT,
+        .pull_up_en = button->pressed_logic_level ? GPIO_PULLUP_DISABLE : GPIO_PULLUP_ENABLE,
+        .pull_down_en = button->pressed_logic_level ? GPIO_PULLDOWN_ENABLE : GPIO_PULLDOWN_DISABLE,
+        .intr_type = GPIO_INTR_DISABLE,
+    };
+    esp_err_t ret = gpio_config(&io_conf);
+    if (ret != ESP_OK)
+    {
+        return ret;
+    }
+
+    btn_slot_t *slot = &s_slots[s_slot_cnt];
+    slot->button = button;
+    slot->gpio = gpio;
+    slot->user_cb = button->cb;
+
+    button->cb = button_event_cb;
+    if (!button->usr_button_read)
+    {
+        button->usr_button_read = button_gpio_read;
+    }
+    if (flex_button_register(button) < 0)
+    {
+        button->cb = slot->user_cb;
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_slot_cnt++;
+    return ESP_OK;
+}
+
+/**
+ * @brief Start the scan task and arm the button interrupts.
+ *
+ * @param config: NULL for FLEX_BUTTON_IRQ_DEFAULT_CONFIG()
+ * @param queue: returns the event queue
+ * @return ESP_OK on success
+*/
+esp_err_t flex_button_irq_start(const flex_button_irq_config_t *config, QueueHandle_t *queue)
+{
+    flex_button_irq_config_t def = FLEX_BUTTON_IRQ_DEFAULT_CONFIG();
+    if (!config)
+    {
+        config = &def;
+    }
+    if (!queue || !config->queue_len)
+    {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task)
+    {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    /* The state machine counts in milliseconds, feed it the real tick period */
+    s_period = pdMS_TO_TICKS(config->scan_interval_ms);
+    if (s_period == 0)
+    {
+        s_period = 1;
+    }
+
+    s_queue = xQueueCreate(config->queue_len, sizeof(flex_button_irq_event_t));
+    if (!s_queue)
+    {
+        return ESP_ERR_NO_MEM;
+    }
+
+    esp_err_t ret = gpio_install_isr_service(0);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE)
+    {
+        goto fail;
+    }
+
+    for (uint8_t i = 0; i < s_slot_cnt; i++)
+    {
+        gpio_int_type_t level = s_slots[i].button->pressed_logic_level ? GPIO_INTR_HIGH_LEVEL : GPIO_INTR_LOW_LEVEL;
+        gpio_set_intr_type(s_slots[i].gpio, level);
+        gpio_intr_disable(s_slots[i].gpio);
+        ret = gpio_isr_handler_add(s_slots[i].gpio, button_isr, &s_slots[i]);
+        if (ret != ESP_OK)
+        {
+            goto fail;
+        }
+        /* Light-sleep GPIO wakeup uses the same level as the interrupt */
+        if (config->wakeup)
+        {
+            gpio_wakeup_enable(s_slots[i].gpio, level);
+        }
+    }
+    if (config->wakeup)
+    {
+        esp_sleep_enable_gpio_wakeup();
+    }
+
+    if (xTaskCreate(button_task, "flex_btn", config->task_stack, NULL, config->task_prio, &s_task) != pdPASS)
+    {
+        ret = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+
+    for (uint8_t i = 0; i < s_slot_cnt; i++)
+    {
+        gpio_intr_enable(s_slots[i].gpio);
+    }
+
+    *queue = s_queue;
+    ESP_LOGI(TAG, "%u buttons, scan %lu ms while active", s_slot_cnt,
+             (unsigned long)(s_period * portTICK_PERIOD_MS));
+    return ESP_OK;
+
+fail:
+    for (uint8_t i = 0; i < s_slot_cnt; i++)
+    {
+        gpio_isr_handler_remove(s_slots[i].gpio);
+        gpio_wakeup_disable(s_slots[i].gpio);
+    }
+    vQueueDelete(s_queue);
+    s_queue = NULL;
+    return ret;
+}
@@ -0,0 +1,83 @@
+/**
+ * @File:    flexible_button_irq.h
+ *
+ * Interrupt driven front end for flexible_button on ESP-IDF.
+ *
+ * Instead of calling flex_button_scan() from a periodic timer, every button
+ * GPIO gets a level interrupt on its pressed level. While all buttons are
+ * released the scan task blocks and no tick runs, so the chip can enter
+ * light-sleep. A press wakes the task, which scans every scan_interval_ms
+ * until all buttons are released and idle again, then re-arms the interrupts.
+ *
+ * Events are delivered to a FreeRTOS queue as flex_button_irq_event_t; the
+ * button's own callback, if set, is still called from the scan task.
+ *
+ * License-Identifier: Apache-2.0
+*/
+
+#ifndef __FLEXIBLE_BUTTON_IRQ_H__
+#define __FLEXIBLE_BUTTON_IRQ_H__
+
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/gpio.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+#include "flexible_button.h"
+
+typedef struct
+{
+    flex_button_t *button;
+    uint8_t id;
+    flex_button_event_t event;
+    int64_t time_us;            /* esp_timer time the event was generated */
+} flex_button_irq_event_t;
+
+typedef struct
+{
+    uint8_t scan_interval_ms;   /* scan period while a button is active */
+    uint16_t queue_len;
+    uint32_t task_stack;
+    UBaseType_t task_prio;
+    bool wakeup;                /* buttons wake the chip from light-sleep */
+} flex_button_irq_config_t;
+
+#define FLEX_BUTTON_IRQ_DEFAULT_CONFIG() \
+    {                                    \
+        .scan_interval_ms = 10,          \
+        .queue_len = 16,                 \
+        .task_stack = 3072,              \
+        .task_prio = 10,                 \
+        .wakeup = true,                  \
+    }
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Register a button that is read from a GPIO.
+ *        Call before flex_button_irq_start(). The GPIO is configured as input
+ *        with a pull towards the released level. If button->usr_button_read is
+ *        NULL the GPIO level is read directly.
+ *
+ * @param button: button structure instance, user fields filled in
+ * @param gpio: GPIO the button is connected to
+ * @return ESP_OK, or an error when the button or GPIO cannot be registered
+*/
+esp_err_t flex_button_irq_add(flex_button_t *button, gpio_num_t gpio);
+
+/**
+ * @brief Start the scan task and arm the button interrupts.
+ *        flex_button_scan() must not be called elsewhere in this mode.
+ *
+ * @param config: NULL for FLEX_BUTTON_IRQ_DEFAULT_CONFIG()
+ * @param queue: returns the event queue
+ * @return ESP_OK on success
+*/
+esp_err_t flex_button_irq_start(const flex_button_irq_config_t *config, QueueHandle_t *queue);
+
+#ifdef __cplusplus
+}
+#endif
+#endif /* __FLEXIBLE_BUTTON_IRQ_H__ */
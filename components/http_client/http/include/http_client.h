@@ -17,6 +17,10 @@ extern "C" {
 #include <stdbool.h>
 #include <stdint.h>
 
+#ifdef ESP_PLATFORM
+#include "sdkconfig.h"
+#endif
+
 #define CONFIG_HTTP_FILE_OPERATE            1
 
 #if CONFIG_HTTP_FILE_OPERATE
@@ -96,9 +100,29 @@ typedef struct {
     int client_cert_len;            /**< client certification lenght, client_cert buffer size  */
     int client_pk_len;              /**< client private key lenght, client_pk buffer size      */
     void *ssl;                      /**< ssl content               */
+    bool keep_alive;                /**< server keeps the connection open after this response  */
+    bool reusable;                  /**< response read completely, connection can be reused    */
 #endif
 } http_client_t;
 
+#ifndef HTTP_CLIENT_HEADER_MAX
+#define HTTP_CLIENT_HEADER_MAX              16
+#endif
+
+/** @brief   position of one response header in header_buf */
+typedef struct {
+    uint16_t key_pos;            /**< offset of the header name in header_buf. */
+    uint16_t key_len;            /**< header name length. */
+    uint16_t value_pos;          /**< offset of the header value in header_buf. */
+    uint16_t value_len;          /**< header value length, without surrounding spaces. */
+} http_client_header_t;
+
+/**
+ * @brief   pull-based body source, fills buf with the next part of the body.
+ * @return  bytes written to buf (at most buf_len), 0 at end of data, negative on error.
+ */
+typedef int (*http_client_body_read_cb)(void *ctx, char *buf, int buf_len);
+
 /** @brief   This structure defines the HTTP data structure.  */
 typedef struct {
     bool is_more;                /**< indicates if more data needs to be retrieved. */
@@ -116,7 +140,12 @@ typedef struct {
     char *header_buf;            /**< buffer to store the response head data. */
     bool  is_redirected;         /**< redirected URL? if 1, has redirect url; if 0, no redirect url */
     char* redirect_url;          /**< redirect url when got http 3** response code. */
+    http_client_header_t headers[HTTP_CLIENT_HEADER_MAX]; /**< response headers indexed while parsing. */
+    uint8_t header_num;          /**< number of entries in headers. */
+    bool header_overflow;        /**< more headers than HTTP_CLIENT_HEADER_MAX were received. */
     HTTPC_RESULT (*post_write_cb)(http_client_t *, char* post_buf, int post_buf_len, int *write_len); 
+    http_client_body_read_cb post_read_cb; /**< body source used when post_buf is NULL, post_buf_len < 0 sends it chunked. */
+    void *post_read_ctx;         /**< argument of post_read_cb. */
 } http_client_data_t;
 
 typedef struct{
@@ -230,6 +259,27 @@ HTTPC_RESULT http_client_recv(http_client_t *client, http_client_data_t *client_
  */
 void http_client_clse(http_client_t *client);
 
+#if CONFIG_HTTP_SECURE
+/**
+ * This function drops the cached TLS sessions and idle https connections, e.g. after the network went down.
+ * @return           None.
+ */
+void http_client_conn_cache_clear(void);
+#endif
+
+/** @brief   Host name resolver used by new connections instead of gethostbyname(), e.g. a DNS cache */
+typedef struct {
+    int (*resolve)(const char *host, uint32_t *ip);     /**< returns 0 and the IPv4 address in network byte order */
+    void (*failed)(const char *host);                   /**< connecting to the resolved address failed, may be NULL */
+} http_client_resolver_t;
+
+/**
+ * This function replaces the resolver of new connections.
+ * @param[in] resolver             resolver must stay valid, NULL restores gethostbyname().
+ * @return           None.
+ */
+void http_client_set_resolver(const http_client_resolver_t *resolver);
+
 /**
  * This function sets a custom header.
  * @param[in] client               client is a pointer to the #http_client_t.
@@ -255,6 +305,16 @@ int http_client_get_response_code(http_client_t *client);
  */
 int http_client_get_response_header_value(char *header_buf, char *name, int *val_pos, int *val_len);
 
+/**
+ * This function gets a response header value from the table built while parsing, without rescanning header_buf.
+ * @param[in] client_data          client_data is a pointer to the #http_client_data_t of the last response.
+ * @param[in] name                 name is the http response header name, case insensitive.
+ * @param[out] value               value points into client_data->header_buf, not NULL-terminated.
+ * @param[out] value_len           value_len is header value length.
+ * @return           0, if value is got. -1, if the header is not found.
+ */
+int http_client_get_header(http_client_data_t *client_data, const char *name, const char **value, int *value_len);
+
 /**
  * This function add text formdata information.
  * @param[in] client_data          client_data is a pointer to the #http_client_data_t.
@@ -279,6 +339,21 @@ int http_client_formdata_addfile(http_client_data_t* client_data, char* content_
 
 int http_client_formdata_addfile_for_data(http_client_data_t* client_data, char* content_disposition, char* name, char* content_type, char* file_name, char  *data, int data_len);
 
+/**
+ * This function add file formdata whose content is pulled from read_cb while sending, nothing is copied.
+ * @param[in] client_data          client_data is a pointer to the #http_client_data_t.
+ * @param[in] content_disposition  content_disposition is a pointer to the content disposition string.
+ * @param[in] name                 name is a pointer to the name string.
+ * @param[in] content_type         content_type is a pointer to the content type string, may be NULL.
+ * @param[in] file_name            file_name is the file name reported to the server.
+ * @param[in] read_cb              read_cb yields the file content in chunks.
+ * @param[in] ctx                  ctx is passed to read_cb.
+ * @param[in] data_len             data_len is the content length, -1 if unknown (the request is sent chunked).
+ * @return           0, if added. -1, if errors occurred.
+ */
+int http_client_formdata_addfile_for_source(http_client_data_t* client_data, char* content_disposition, char* name, char* content_type, char* file_name,
+                                            http_client_body_read_cb read_cb, void *ctx, long int data_len);
+
 #ifdef __cplusplus
 }
 #endif
@@ -19,6 +19,8 @@ struct formdata_node_t
     long int  file_data_len;
     char  *data;
     int   data_len;
+    http_client_body_read_cb read_cb;   /* file content source, file_data unused when set */
+    void  *read_ctx;
 };
 
 typedef struct {
@@ -29,7 +31,10 @@ typedef struct {
 
 void http_client_clear_form_data(http_client_data_t * client_data);
 int http_client_formdata_len(http_client_data_t *client_data);
+int http_client_formdata_is_chunked(http_client_data_t *client_data);
 int http_client_send_formdata(http_client_t *client, http_client_data_t *client_data);
+int http_client_send_body(http_client_t *client, const char *data, int len, int chunked);
+int http_client_send_source(http_client_t *client, http_client_body_read_cb read_cb, void *ctx, long int len, int chunked);
 int http_client_formdata_addfile_for_data(http_client_data_t* client_data, char* content_disposition, char* name, char* content_type, char* file_name, char  *data, int data_len);
 
 
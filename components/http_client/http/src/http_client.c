@@ -189,7 +189,7 @@ static int http_client_send_header(http_client_t *client, const char *url, int m
     char *path = NULL;
     int host_size = HTTP_CLIENT_MAX_HOST_LEN;
     int path_size = HTTP_CLIENT_MAX_URL_LEN;
-    int len, formdata_len;
+    int len, formdata_len = 0, formdata_chunked;
     int total_len = 0;
     char *send_buf = NULL;
     char *buf = NULL;
@@ -241,7 +241,13 @@ static int http_client_send_header(http_client_t *client, const char *url, int m
     /* Send request */
     len = 0 ; /* Reset send buffer */
 
-    snprintf(buf, buf_size, "%s %s HTTP/1.1\r\nUser-Agent: AliOS-HTTP-Client/2.1\r\nCache-Control: no-cache\r\nConnection: close\r\nHost: %s\r\n", meth, path, host); /* Write request */
+    /* https connections are kept open for the next request, a HEAD response would look like an unfinished body */
+#if CONFIG_HTTP_KEEPALIVE
+    const char *conn = (client->is_http || method == HTTP_HEAD) ? "close" : "keep-alive";
+#else
+    const char *conn = "close";
+#endif
+    snprintf(buf, buf_size, "%s %s HTTP/1.1\r\nUser-Agent: AliOS-HTTP-Client/2.1\r\nCache-Control: no-cache\r\nConnection: %s\r\nHost: %s\r\n", meth, path, conn, host); /* Write request */
     ret = http_client_get_info(client, send_buf, &len, buf, strlen(buf));
     if (ret) {
         http_err("Could not write request");
@@ -259,8 +265,8 @@ static int http_client_send_header(http_client_t *client, const char *url, int m
         http_client_get_info(client, send_buf, &len, (char *)client->header, strlen(client->header));
     }
 
-    if ((formdata_len = http_client_formdata_len(client_data)) > 0) {
-        total_len += formdata_len;
+    formdata_chunked = http_client_formdata_is_chunked(client_data);
+    if (formdata_chunked || (formdata_len = http_client_formdata_len(client_data)) > 0) {
 
         memset(buf, 0, buf_size);
         snprintf(buf, buf_size, "Accept: */*\r\n");
@@ -276,11 +282,19 @@ static int http_client_send_header(http_client_t *client, const char *url, int m
             http_client_get_info(client, send_buf, &len, buf, strlen(buf));
         }
 
-        total_len += strlen(boundary) + 8;
-        snprintf(buf, buf_size, "Content-Length: %d\r\n", total_len);
+        if (formdata_chunked) {
+            snprintf(buf, buf_size, "Transfer-Encoding: chunked\r\n");
+        } else {
+            total_len = formdata_len + strlen(boundary) + 8;
+            snprintf(buf, buf_size, "Content-Length: %d\r\n", total_len);
+        }
         http_client_get_info(client, send_buf, &len, buf, strlen(buf));
-    } else if ( client_data->post_buf != NULL ) {
-        snprintf(buf, buf_size, "Content-Length: %d\r\n", client_data->post_buf_len);
+    } else if ( client_data->post_buf != NULL || client_data->post_read_cb != NULL ) {
+        if (client_data->post_buf == NULL && client_data->post_buf_len < 0) {
+            snprintf(buf, buf_size, "Transfer-Encoding: chunked\r\n");
+        } else {
+            snprintf(buf, buf_size, "Content-Length: %d\r\n", client_data->post_buf_len);
+        }
         http_client_get_info(client, send_buf, &len, buf, strlen(buf));
 
         if (client_data->post_content_type != NULL)  {
@@ -374,6 +388,16 @@ static int http_client_send_userdata(http_client_t *client, http_client_data_t *
                 return HTTP_ECONN;
             }
         }
+    } else if (client_data->post_buf == NULL && client_data->post_read_cb != NULL) {
+        ret = http_client_send_source(client, client_data->post_read_cb, client_data->post_read_ctx,
+                                      client_data->post_buf_len, client_data->post_buf_len < 0);
+        if (ret == HTTP_SUCCESS && client_data->post_buf_len < 0) {
+            /* last chunk */
+            ret = http_client_send_body(client, "0\r\n\r\n", 5, 0);
+        }
+        if (ret != HTTP_SUCCESS) {
+            return ret;
+        }
     } else if(http_client_send_formdata(client, client_data) < 0) {
         return HTTP_ECONN;
     }
@@ -399,14 +423,42 @@ static int http_client_recv_data(http_client_t *client, char *buf, int min_len,
     return ret;
 }
 
-static int http_client_retrieve_content(http_client_t *client, char *data, int len, http_client_data_t *client_data)
+/* find "\r\n" in buf[0..len), unlike strstr it does not depend on a NULL-terminating char */
+static char *http_client_find_crlf(char *buf, int len)
+{
+    char *p = buf;
+    char *end = buf + len - 1;
+
+    while (p < end) {
+        p = memchr(p, '\r', end - p);
+        if (p == NULL) {
+            return NULL;
+        }
+        if (p[1] == '\n') {
+            return p;
+        }
+        p++;
+    }
+    return NULL;
+}
+
+/*
+ * data[0..HTTP_CLIENT_CHUNK_SIZE) is the receive buffer, the unread bytes are data[pos..pos+len).
+ * Chunk headers and body bytes are consumed by moving pos forward, the unread tail is moved
+ * to the front of the buffer only when more bytes have to be read behind it.
+ */
+static int http_client_retrieve_content(http_client_t *client, char *data, int pos, int len, http_client_data_t *client_data)
 {
     int count = 0;
     int templen = 0;
-    int crlf_pos;
+    char *p = data + pos;
     client_data->is_more = true;
 
     if (client_data->response_content_len == -1 && client_data->is_chunked == false) {
+        if (p != data) {
+            memmove(data, p, len);
+            p = data;
+        }
         while(true)
         {
             int ret, max_len;
@@ -453,54 +505,37 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
 
         if ( client_data->is_chunked && client_data->retrieve_len <= 0) {
             /* Read chunk header */
-            bool foundCrlf;
-            int n;
-            do {
-                int ret = -1;
-                foundCrlf = false;
-                crlf_pos = 0;
-                data[len] = 0;
-                if (len >= 2) {
-                    for (; crlf_pos < len - 2; crlf_pos++) {
-                        if ( data[crlf_pos] == '\r' && data[crlf_pos + 1] == '\n' ) {
-                            foundCrlf = true;
-                            break;
-                        }
-                    }
+            char *crlf_ptr;
+            char *end_ptr;
+            while ((crlf_ptr = http_client_find_crlf(p, len)) == NULL) {
+                int ret, new_trf_len;
+                int max_recv = MIN(client_data->response_buf_len, HTTP_CLIENT_CHUNK_SIZE);
+                if (p != data) {
+                    memmove(data, p, len);
+                    p = data;
+                }
+                if (max_recv - len - 1 <= 0) {
+                    http_err("%s %d error max_len %d", __func__, __LINE__, max_recv - len - 1);
+                    return HTTP_EUNKOWN;
                 }
-                if (!foundCrlf) { /* Try to read more */
-                    if ( len < HTTP_CLIENT_CHUNK_SIZE ) {
-                        int new_trf_len;
-                        int max_recv = MIN(client_data->response_buf_len, HTTP_CLIENT_CHUNK_SIZE);
-                        if (max_recv - len - 1 <= 0) {
-                            http_err("%s %d error max_len %d", __func__, __LINE__, max_recv - len - 1);
-                            return HTTP_EUNKOWN;
-                        }
-                        ret = http_client_recv_data(client, data + len, 0,  max_recv - len - 1 , &new_trf_len);
-                        len += new_trf_len;
-                        if ((ret == HTTP_ECONN) || (ret == HTTP_ECLSD && new_trf_len == 0)) {
-                            return ret;
-                        } else {
-                            http_debug("in loop %s %d ret %d len %d", __func__, __LINE__, ret, len);
-                            continue;
-                        }
-                    } else {
-                        return HTTP_EUNKOWN;
-                    }
+                ret = http_client_recv_data(client, data + len, 0,  max_recv - len - 1 , &new_trf_len);
+                len += new_trf_len;
+                if ((ret == HTTP_ECONN) || (ret == HTTP_ECLSD && new_trf_len == 0)) {
+                    return ret;
                 }
-                http_debug("in loop %s %d len %d ret %d", __func__, __LINE__, len, ret);
-            } while (!foundCrlf);
-            data[crlf_pos] = '\0';
-            n = sscanf(data, "%x", &readLen);/* chunk length */
-            client_data->retrieve_len = readLen;
-            client_data->response_content_len += client_data->retrieve_len;
-            if (n != 1) {
+                http_debug("in loop %s %d ret %d len %d", __func__, __LINE__, ret, len);
+            }
+            *crlf_ptr = '\0';
+            readLen = strtoul(p, &end_ptr, 16);/* chunk length, extensions after ';' are ignored */
+            if (end_ptr == p) {
                 http_err("Could not read chunk length");
                 return HTTP_EPROTO;
             }
+            client_data->retrieve_len = readLen;
+            client_data->response_content_len += client_data->retrieve_len;
 
-            memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2)); /* Not need to move NULL-terminating char any more */
-            len -= (crlf_pos + 2);
+            len -= crlf_ptr + 2 - p;
+            p = crlf_ptr + 2;
 
             if ( readLen == 0 ) {
                /* Last chunk */
@@ -519,13 +554,13 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
             http_debug("readLen %d, len:%d", readLen, len);
             templen = MIN(len, readLen);
             if (count + templen < client_data->response_buf_len - 1) {
-                memcpy(client_data->response_buf + count, data, templen);
+                memcpy(client_data->response_buf + count, p, templen);
                 count += templen;
                 client_data->response_len = count;
                 client_data->response_buf[count] = '\0';
                 client_data->retrieve_len -= templen;
             } else {
-                memcpy(client_data->response_buf + count, data, client_data->response_buf_len - 1 - count);
+                memcpy(client_data->response_buf + count, p, client_data->response_buf_len - 1 - count);
                 client_data->response_len = client_data->response_buf_len - 1;
                 client_data->response_buf[client_data->response_buf_len - 1] = '\0';
                 client_data->retrieve_len -= (client_data->response_buf_len - 1 - count);
@@ -534,13 +569,14 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
             }
 
             if ( len >= readLen ) {
-                http_debug("memmove %d %d %d", readLen, len, client_data->retrieve_len);
-                memmove(data, &data[readLen], len - readLen); /* chunk case, read between two chunks */
+                /* chunk case, the next chunk header follows in the same buffer */
+                p += readLen;
                 len -= readLen;
                 readLen = 0;
                 client_data->retrieve_len = 0;
             } else {
                 readLen -= len;
+                len = 0;
             }
 
             if (readLen) {
@@ -550,6 +586,7 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
                     return HTTP_EUNKOWN;
                 }
 
+                p = data;
                 ret = http_client_recv_data(client, data, 1, max_len, &len);
                 if (ret == HTTP_ECONN || (ret == HTTP_ECLSD && len == 0)) {
                     return ret;
@@ -558,9 +595,14 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
         } while (readLen);
 
         if ( client_data->is_chunked ) {
-            if (len < 2) {
+            while (len < 2) {
                 int new_trf_len = 0, ret;
-                int max_recv = MIN(client_data->response_buf_len - 1 - count + 2, HTTP_CLIENT_CHUNK_SIZE - len - 1);
+                int max_recv;
+                if (p != data) {
+                    memmove(data, p, len);
+                    p = data;
+                }
+                max_recv = MIN(client_data->response_buf_len - 1 - count + 2, HTTP_CLIENT_CHUNK_SIZE - len - 1);
                 if (max_recv <= 0) {
                     http_err("%s %d error max_len %d", __func__, __LINE__, max_recv);
                     return HTTP_EUNKOWN;
@@ -573,11 +615,11 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
                 }
                 len += new_trf_len;
             }
-            if ( (data[0] != '\r') || (data[1] != '\n') ) {
-                http_err("Format error, %s", data); /* after memmove, the beginning of next chunk */
+            if ( (p[0] != '\r') || (p[1] != '\n') ) {
+                http_err("Format error, %.*s", len, p); /* the beginning of next chunk */
                 return HTTP_EPROTO;
             }
-            memmove(data, &data[2], len - 2); /* remove the \r\n */
+            p += 2; /* skip the \r\n */
             len -= 2;
         } else {
             http_err("no more(content-length)");
@@ -591,28 +633,69 @@ static int http_client_retrieve_content(http_client_t *client, char *data, int l
     return HTTP_SUCCESS;
 }
 
+/* copy one header line to the caller buffer and index its name/value, returns 0 if it did not fit */
+static int http_client_header_add(http_client_data_t *client_data, int *header_pos, const char *line, int line_len,
+                                  int key_len, int value_off, int value_len)
+{
+    if (client_data->header_buf == NULL || *header_pos + line_len >= client_data->header_buf_len) {
+        return 0;
+    }
+    memcpy(client_data->header_buf + *header_pos, line, line_len);
+    if (client_data->header_num < HTTP_CLIENT_HEADER_MAX) {
+        http_client_header_t *h = &client_data->headers[client_data->header_num++];
+        h->key_pos = *header_pos;
+        h->key_len = key_len;
+        h->value_pos = *header_pos + value_off;
+        h->value_len = value_len;
+    } else {
+        client_data->header_overflow = true;
+    }
+    *header_pos += line_len;
+    return 1;
+}
+
+static int http_client_key_is(const char *key, int key_len, const char *name)
+{
+    return (int)strlen(name) == key_len && 0 == strncasecmp(key, name, key_len);
+}
+
+/*
+ * Single pass over the response header: every line is visited once, copied to header_buf
+ * once and indexed in client_data->headers. The body that arrived together with the header
+ * is handed to http_client_retrieve_content() in place.
+ */
 static int http_client_response_parse(http_client_t *client, char *data, int len, http_client_data_t *client_data)
 {
-    int crlf_pos;
-    int header_buf_len = client_data->header_buf_len;
-    char *header_buf = client_data->header_buf;
+    char *line;
+    char *crlf_ptr;
+    int header_pos = 0;
     int read_result;
 
     // reset the header buffer
-    if (header_buf) {
-        memset(header_buf, 0, header_buf_len);
+    if (client_data->header_buf) {
+        client_data->header_buf[0] = '\0';
     }
+    client_data->header_num = 0;
+    client_data->header_overflow = false;
 
     client_data->response_content_len = -1;
 
-    char *crlf_ptr = strstr(data, "\r\n");
-    if (crlf_ptr == NULL) {
-        http_err("\r\n not found");
-        return HTTP_EPROTO;
+    /* the status line may arrive in several reads */
+    while ((crlf_ptr = http_client_find_crlf(data, len)) == NULL) {
+        int new_trf_len = 0;
+        if (len >= HTTP_CLIENT_CHUNK_SIZE - 1) {
+            http_err("\r\n not found");
+            return HTTP_EPROTO;
+        }
+        read_result = http_client_recv_data(client, data + len, 1, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len);
+        len += new_trf_len;
+        data[len] = '\0';
+        if ((read_result == HTTP_ECONN) || (read_result == HTTP_ECLSD && new_trf_len == 0)) {
+            return read_result;
+        }
     }
 
-    crlf_pos = crlf_ptr - data;
-    data[crlf_pos] = '\0';
+    *crlf_ptr = '\0';
 
     /* Parse HTTP response */
     if ( sscanf(data, "HTTP/%*d.%*d %d %*[^\r\n]", &(client->response_code)) != 1 ) {
@@ -621,6 +704,10 @@ static int http_client_response_parse(http_client_t *client, char *data, int len
         return HTTP_EPROTO;
     }
 
+#if CONFIG_HTTP_KEEPALIVE
+    client->keep_alive = !client->is_http && strncmp(data, "HTTP/1.0", 8) != 0;
+#endif
+
     if ( (client->response_code < 200) || (client->response_code >= 400) ) {
         /* Did not return a 2xx code; TODO fetch headers/(&data?) anyway and implement a mean of writing/reading headers */
         http_debug("Response code %d", client->response_code);
@@ -631,96 +718,115 @@ static int http_client_response_parse(http_client_t *client, char *data, int len
         }
     }
 
-    memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2) + 1); /* Be sure to move NULL-terminating char as well */
-    len -= (crlf_pos + 2);
+    line = crlf_ptr + 2;
 
     client_data->is_chunked = false;
 
     /* Now get headers */
     while ( true ) {
-        char *colon_ptr, *key_ptr, *value_ptr;
-        int key_len, value_len;
+        char *colon_ptr, *value_ptr;
+        int key_len, value_len, line_len;
+        int rest = len - (line - data);
 
-        crlf_ptr = strstr(data, "\r\n");
+        crlf_ptr = http_client_find_crlf(line, rest);
         if (crlf_ptr == NULL) {
-            if ( len < HTTP_CLIENT_CHUNK_SIZE - 1 ) {
-                int new_trf_len = 0;
-                if (HTTP_CLIENT_CHUNK_SIZE - len - 1 <= 0) {
-                    http_err("%s %d error max_len %d", __func__, __LINE__, HTTP_CLIENT_CHUNK_SIZE - len - 1);
-                    return HTTP_EUNKOWN;
-                }
-                read_result = http_client_recv_data(client, data + len, 1, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len);
-                len += new_trf_len;
-                data[len] = '\0';
-                http_debug("Read %d chars; In buf: [%s]", new_trf_len, data);
-                if ((read_result == HTTP_ECONN) || (read_result == HTTP_ECLSD && new_trf_len == 0)) {
-                    return read_result;
-                } else {
-                    http_debug("in loop %s %d ret %d len %d", __func__, __LINE__, read_result, len);
-                    continue;
-                }
-            } else {
+            /* the line continues in the next read: keep the unparsed tail and read behind it */
+            int new_trf_len = 0;
+            if (rest >= HTTP_CLIENT_CHUNK_SIZE - 1) {
                 http_err("header len > chunksize");
                 return HTTP_EUNKOWN;
             }
+            memmove(data, line, rest);
+            line = data;
+            len = rest;
+            read_result = http_client_recv_data(client, data + len, 1, HTTP_CLIENT_CHUNK_SIZE - len - 1, &new_trf_len);
+            len += new_trf_len;
+            data[len] = '\0';
+            http_debug("Read %d chars; In buf: [%s]", new_trf_len, data);
+            if ((read_result == HTTP_ECONN) || (read_result == HTTP_ECLSD && new_trf_len == 0)) {
+                return read_result;
+            }
+            continue;
         }
 
-        crlf_pos = crlf_ptr - data;
-        if (crlf_pos == 0) { /* End of headers */
-            memmove(data, &data[2], len - 2 + 1); /* Be sure to move NULL-terminating char as well */
-            len -= 2;
+        if (crlf_ptr == line) { /* End of headers */
+            line += 2;
             break;
         }
 
-        colon_ptr = strstr(data, ": ");
-        if (colon_ptr) {
-            if (header_buf_len >= crlf_pos + 2 && header_buf) {
-                /* copy response header to caller buffer */
-                memcpy(header_buf, data, crlf_pos + 2);
-                header_buf += crlf_pos + 2;
-                header_buf_len -= crlf_pos + 2;
+        line_len = crlf_ptr + 2 - line;
+        colon_ptr = memchr(line, ':', crlf_ptr - line);
+        if (colon_ptr == NULL) {
+            http_err("Could not parse header");
+            return HTTP_EUNKOWN;
+        }
+        key_len = colon_ptr - line;
+        value_ptr = colon_ptr + 1;
+        while (value_ptr < crlf_ptr && (*value_ptr == ' ' || *value_ptr == '\t')) {
+            value_ptr++;
+        }
+        value_len = crlf_ptr - value_ptr;
+        while (value_len > 0 && (value_ptr[value_len - 1] == ' ' || value_ptr[value_len - 1] == '\t')) {
+            value_len--;
+        }
+
+        http_debug("Read header : %.*s: %.*s", key_len, line, value_len, value_ptr);
+        /* copied to the caller buffer until it is full, lines that do not fit are still evaluated */
+        http_client_header_add(client_data, &header_pos, line, line_len, key_len, value_ptr - line, value_len);
+
+        if (http_client_key_is(line, key_len, "Content-Length")) {
+            client_data->response_content_len = strtol(value_ptr, NULL, 10);
+            client_data->retrieve_len = client_data->response_content_len;
+        } else if (http_client_key_is(line, key_len, "Transfer-Encoding")) {
+            if (value_len == 7 && 0 == strncasecmp(value_ptr, "Chunked", value_len)) {
+                client_data->is_chunked = true;
+                client_data->response_content_len = 0;
+                client_data->retrieve_len = 0;
             }
+#if CONFIG_HTTP_KEEPALIVE
+        } else if (http_client_key_is(line, key_len, "Connection")) {
+            if (value_len == 5 && 0 == strncasecmp(value_ptr, "close", value_len)) {
+                client->keep_alive = false;
+            }
+#endif
+        } else if ((client->response_code >= 300 && client->response_code < 400) && http_client_key_is(line, key_len, "Location")) {
 
-            key_len = colon_ptr - data;
-            value_len = crlf_ptr - colon_ptr - strlen(": ");
-            key_ptr = data;
-            value_ptr = colon_ptr + strlen(": ");
+            if ( HTTP_CLIENT_MAX_URL_LEN < value_len + 1 ) {
+                http_err("url is too large (%d >= %d)", value_len + 1, HTTP_CLIENT_MAX_URL_LEN);
+                return HTTP_EUNKOWN;
+            }
 
-            http_debug("Read header : %.*s: %.*s", key_len, key_ptr, value_len, value_ptr);
-            if (0 == strncasecmp(key_ptr, "Content-Length", key_len)) {
-                sscanf(value_ptr, "%d[^\r]", &(client_data->response_content_len));
-                client_data->retrieve_len = client_data->response_content_len;
-            } else if (0 == strncasecmp(key_ptr, "Transfer-Encoding", key_len)) {
-                if (0 == strncasecmp(value_ptr, "Chunked", value_len)) {
-                    client_data->is_chunked = true;
-                    client_data->response_content_len = 0;
-                    client_data->retrieve_len = 0;
-                }
-            } else if ((client->response_code >= 300 && client->response_code < 400) && (0 == strncasecmp(key_ptr, "Location", key_len))) {
+            if(client_data->redirect_url == NULL) {
+                client_data->redirect_url = (char* )http_malloc(HTTP_CLIENT_MAX_URL_LEN);
+            }
 
-                if ( HTTP_CLIENT_MAX_URL_LEN < value_len + 1 ) {
-                    http_err("url is too large (%d >= %d)", value_len + 1, HTTP_CLIENT_MAX_URL_LEN);
-                    return HTTP_EUNKOWN;
-                }
+            memset(client_data->redirect_url, 0, HTTP_CLIENT_MAX_URL_LEN);
+            memcpy(client_data->redirect_url, value_ptr, value_len);
+            client_data->is_redirected = 1;
+        }
 
-                if(client_data->redirect_url == NULL) {
-                    client_data->redirect_url = (char* )http_malloc(HTTP_CLIENT_MAX_URL_LEN);
-                }
+        line = crlf_ptr + 2;
+    }
 
-                memset(client_data->redirect_url, 0, HTTP_CLIENT_MAX_URL_LEN);
-                memcpy(client_data->redirect_url, value_ptr, value_len);
-                client_data->is_redirected = 1;
-           }
+    if (client_data->header_buf) {
+        client_data->header_buf[header_pos] = '\0';
+    }
 
-            memmove(data, &data[crlf_pos + 2], len - (crlf_pos + 2) + 1); /* Be sure to move NULL-terminating char as well */
-            len -= (crlf_pos + 2);
-        } else {
-            http_err("Could not parse header");
-            return HTTP_EUNKOWN;
-        }
+    /* 204/304 never carry a body, do not wait for the connection to close */
+    if (client_data->response_content_len == -1 && !client_data->is_chunked &&
+        (client->response_code == 204 || client->response_code == 304)) {
+        client_data->response_content_len = 0;
+        client_data->retrieve_len = 0;
+    }
+
+#if CONFIG_HTTP_KEEPALIVE
+    /* the body ends with the connection */
+    if (client_data->response_content_len == -1 && !client_data->is_chunked) {
+        client->keep_alive = false;
     }
+#endif
 
-    return http_client_retrieve_content(client, data, len, client_data);
+    return http_client_retrieve_content(client, data, line - data, len - (line - data), client_data);
 }
 
 
@@ -780,6 +886,10 @@ HTTPC_RESULT http_client_conn(http_client_t *client, const char *url)
     }
 
     client->socket = -1;
+#if CONFIG_HTTP_SECURE
+    client->keep_alive = false;
+    client->reusable = false;
+#endif
     if (client->is_http) {
         ret = http_tcp_conn_wrapper(client, host);
     }
@@ -856,7 +966,7 @@ HTTPC_RESULT http_client_recv(http_client_t *client, http_client_data_t *client_
 
     if (client_data->is_more) {
         client_data->response_buf[0] = '\0';
-        ret = http_client_retrieve_content(client, buf, reclen, client_data);
+        ret = http_client_retrieve_content(client, buf, 0, reclen, client_data);
     } else {
         ret = http_client_recv_data(client, buf, 1, HTTP_CLIENT_CHUNK_SIZE - 1, &reclen);
         if (ret != HTTP_SUCCESS && ret != HTTP_ECLSD) {
@@ -874,6 +984,10 @@ HTTPC_RESULT http_client_recv(http_client_t *client, http_client_data_t *client_
     http_debug("http_client_recv_data() result:%d, client:%p", ret, client);
 
 exit:
+#if CONFIG_HTTP_SECURE
+    /* only a completely read response leaves the connection at a request boundary */
+    client->reusable = client->keep_alive && ret == HTTP_SUCCESS && !client_data->is_more;
+#endif
     if (buf) {
         http_free(buf);
         buf = NULL;
@@ -934,6 +1048,31 @@ int http_client_get_response_header_value(char *header_buf, char *name, int *val
     }
 }
 
+int http_client_get_header(http_client_data_t *client_data, const char *name, const char **value, int *value_len)
+{
+    if (client_data == NULL || client_data->header_buf == NULL || name == NULL || value == NULL || value_len == NULL)
+        return -1;
+
+    for (int i = 0; i < client_data->header_num; i++) {
+        const http_client_header_t *h = &client_data->headers[i];
+        if (http_client_key_is(client_data->header_buf + h->key_pos, h->key_len, name)) {
+            *value = client_data->header_buf + h->value_pos;
+            *value_len = h->value_len;
+            return 0;
+        }
+    }
+
+    if (client_data->header_overflow) {
+        /* more headers than the table holds, the rest is only in header_buf */
+        int pos;
+        if (http_client_get_response_header_value(client_data->header_buf, (char *)name, &pos, value_len) == 0) {
+            *value = client_data->header_buf + pos;
+            return 0;
+        }
+    }
+    return -1;
+}
+
 HTTPC_RESULT http_client_prepare(http_client_data_t *client_data, int header_size, int resp_size)
 {
     HTTPC_RESULT ret = HTTP_SUCCESS;
@@ -354,7 +354,49 @@ int http_client_formdata_addfile_for_data(http_client_data_t* client_data, char*
     return 0;
 }
 
+int http_client_formdata_addfile_for_source(http_client_data_t* client_data, char* content_disposition, char* name, char* content_type, char* file_name,
+                                            http_client_body_read_cb read_cb, void *ctx, long int data_len)
+{
+    formdata_node_t* current;
+
+    if((read_cb == NULL) || (file_name == NULL)) {
+        http_err("%s:%d invalid params", __func__, __LINE__);
+        return -1;
+    }
+
+    if(http_client_formdata_addfile_for_data(client_data, content_disposition, name, content_type, file_name, NULL, 0) != 0) {
+        return -1;
+    }
+
+    current = found_formdata_info(client_data)->form_data;
+    while(current->next != NULL) {
+        current = current->next;
+    }
+    current->file_data_len = data_len;
+    current->read_cb = read_cb;
+    current->read_ctx = ctx;
+    return 0;
+}
+
 static const char *boundary = "----WebKitFormBoundarypNjgoVtFRlzPquKE";
+
+int http_client_formdata_is_chunked(http_client_data_t *client_data)
+{
+    formdata_info_t* data_info = found_formdata_info(client_data);
+    formdata_node_t * current;
+
+    if ((NULL == data_info) || (0 == data_info->is_used)) {
+        return 0;
+    }
+
+    for(current = data_info->form_data; current != NULL; current = current->next) {
+        if((current->read_cb != NULL) && (current->file_data_len < 0)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 int http_client_formdata_len(http_client_data_t *client_data)
 {
 	int total_len = 0;
@@ -402,9 +444,95 @@ int http_client_formdata_len(http_client_data_t *client_data)
     return total_len;
 }
 
+/* write on the connection, TLS when the client is https */
+static int http_client_write(http_client_t *client, const char *data, int len)
+{
+    int ret;
+
+#if CONFIG_HTTP_SECURE
+    if (client->is_http == false) {
+        if (http_ssl_send_wrapper(client, data, len) != len) {
+            http_err("SSL_write failed");
+            return HTTP_ESEND;
+        }
+        return HTTP_SUCCESS;
+    }
+#endif
+
+    ret = http_tcp_send_wrapper(client, data, len);
+    if (ret > 0) {
+        http_debug("Written %d bytes", ret);
+    } else if ( ret == 0 ) {
+        http_err("ret == 0,Connection was closed by server");
+        return HTTP_ECLSD; /* Connection was closed by server */
+    } else {
+        http_err("Connection error (send returned %d) errno=%d", ret, errno);
+        return HTTP_ECONN;
+    }
+    return HTTP_SUCCESS;
+}
+
+/* send part of the body, as one chunk when chunked */
+int http_client_send_body(http_client_t *client, const char *data, int len, int chunked)
+{
+    char chunk_head[12];
+    int ret;
+
+    if (len <= 0) {
+        return HTTP_SUCCESS;
+    }
+    if (chunked) {
+        ret = http_client_write(client, chunk_head, snprintf(chunk_head, sizeof(chunk_head), "%x\r\n", len));
+        if (ret != HTTP_SUCCESS) {
+            return ret;
+        }
+    }
+    ret = http_client_write(client, data, len);
+    if ((ret == HTTP_SUCCESS) && chunked) {
+        ret = http_client_write(client, "\r\n", 2);
+    }
+    return ret;
+}
+
+/* pull the body from read_cb and send it; len >= 0 is checked against what the source yields */
+int http_client_send_source(http_client_t *client, http_client_body_read_cb read_cb, void *ctx, long int len, int chunked)
+{
+    char data[HTTP_DATA_SIZE];
+    long int sent = 0;
+    int ret;
+
+    while ((len < 0) || (sent < len)) {
+        int want = sizeof(data);
+        if ((len >= 0) && (len - sent < want)) {
+            want = len - sent;
+        }
+        int n = read_cb(ctx, data, want);
+        if (n < 0) {
+            http_err("body source read failed %d", n);
+            return HTTP_ESEND;
+        }
+        if (n == 0) {
+            break;
+        }
+        ret = http_client_send_body(client, data, n, chunked);
+        if (ret != HTTP_SUCCESS) {
+            return ret;
+        }
+        sent += n;
+    }
+
+    if ((len >= 0) && (sent != len)) {
+        http_err("body source ended at %ld of %ld bytes", sent, len);
+        return HTTP_ESEND;
+    }
+    http_debug("sent %ld bytes from body source", sent);
+    return HTTP_SUCCESS;
+}
+
 int http_client_send_formdata(http_client_t *client, http_client_data_t *client_data)
 {
 	int ret;
+    int chunked;
     formdata_info_t* data_info = NULL;
 	formdata_node_t * current;
 	char data[HTTP_DATA_SIZE] = {0};
@@ -413,114 +541,68 @@ int http_client_send_formdata(http_client_t *client, http_client_data_t *client_
     if ((NULL == data_info) || (0 == data_info->is_used)) {
     	return 0;
     }
+    chunked = http_client_formdata_is_chunked(client_data);
 
-    current = data_info->form_data;
-
-    while(current != NULL) {
+    for(current = data_info->form_data; current != NULL; current = current->next) {
         /* set boundary */
-        memset(data, 0, sizeof(data));
         snprintf(data, sizeof(data), "\r\n--%s", boundary);
-        ret = http_tcp_send_wrapper(client, data, strlen(data));
-        if (ret <= 0) {
-            return -1;
+        ret = http_client_send_body(client, data, strlen(data), chunked);
+        if (ret != HTTP_SUCCESS) {
+            return ret;
         }
-       
-        ret = http_tcp_send_wrapper(client, current->data, current->data_len);
-        if (ret <= 0) {
-            return -1;
-        }
-        
-        if(current->is_file == 1 ) {
-            break;
+
+        ret = http_client_send_body(client, current->data, current->data_len, chunked);
+        if (ret != HTTP_SUCCESS) {
+            return ret;
         }
-        current = current->next;
-    }
 
-    if(current == NULL) {
-        memset(data, 0, sizeof(data));
-        snprintf(data, sizeof(data), "\r\n--%s--\r\n", boundary);
-        ret = http_tcp_send_wrapper(client, data, strlen(data));
-        if (ret <= 0) {
-            return -1;
+        if(current->is_file != 1) {
+            continue;
         }
-        return 0;
-    }
 
-    if(strlen(current->file_path) == 0){
-        long int left_len = 0;
-        left_len = current->file_data_len;
-        http_debug("send file len %d bytes", current->file_data_len);
-        while(left_len) {
-            long int idx = current->file_data_len - left_len;
-            long int send_len = (left_len > HTTP_DATA_SIZE)?HTTP_DATA_SIZE:left_len;
-            ret = http_tcp_send_wrapper(client, current->file_data + idx, send_len);
-            if (ret > 0) {
-                http_debug("Written %d bytes", ret);
-            } else if ( ret == 0 ) {
-                http_err("ret == 0,Connection was closed by server");
-                return HTTP_ECLSD; /* Connection was closed by server */
-            } else {
-                http_err("Connection error (send returned %d) errno=%d", ret, errno);
-                return HTTP_ECONN;
+        if(current->read_cb != NULL) {
+            ret = http_client_send_source(client, current->read_cb, current->read_ctx, current->file_data_len, chunked);
+        }
+        else if(strlen(current->file_path) == 0) {
+            http_debug("send file len %ld bytes", current->file_data_len);
+            ret = HTTP_SUCCESS;
+            for(long int idx = 0; (idx < current->file_data_len) && (ret == HTTP_SUCCESS); idx += HTTP_DATA_SIZE) {
+                long int send_len = current->file_data_len - idx;
+                ret = http_client_send_body(client, current->file_data + idx, (send_len > HTTP_DATA_SIZE) ? HTTP_DATA_SIZE : send_len, chunked);
             }
-            left_len -= send_len;
         }
-    }
 #if CONFIG_HTTP_FILE_OPERATE
-    else{
-	    HTTP_FILE* fd = http_fopen(current->file_path, "rb");
-	    if(fd == NULL) {
-	        http_err("%s: open file(%s) failed errno=%d", __func__, current->file_path, errno);
-	        return -1;
-	    }
-
-	    while(!http_feof(fd)) {
-	        ret = http_fread(data, 1, sizeof(data), fd);
-	        if(ret <= 0) {
-	            http_err("http_fread failed returned %d errno=%d", ret, errno);
-	            return -1;
-	        }
-
-	        ret = http_tcp_send_wrapper(client, data, ret);
-	        if (ret > 0) {
-	            http_debug("Written %d bytes", ret);
-	        } else if ( ret == 0 ) {
-	            http_err("ret == 0,Connection was closed by server");
-	            return HTTP_ECLSD; /* Connection was closed by server */
-	        } else {
-	            http_err("Connection error (send returned %d) errno=%d", ret, errno);
-	            return HTTP_ECONN;
-	        }
-
-	        memset(data, 0, sizeof(data));
-	    }
-
-	    http_fclose(fd);
-    }
-#endif
+        else {
+            HTTP_FILE* fd = http_fopen(current->file_path, "rb");
+            if(fd == NULL) {
+                http_err("%s: open file(%s) failed errno=%d", __func__, current->file_path, errno);
+                return -1;
+            }
 
-    current = current->next;
-    while(current != NULL) {
-        memset(data, 0, sizeof(data));
-        snprintf(data, sizeof(data), "\r\n--%s", boundary);
-        ret = http_tcp_send_wrapper(client, data, strlen(data));
-        if (ret <= 0) {
-            return -1;
-        }
+            ret = HTTP_SUCCESS;
+            while(!http_feof(fd) && (ret == HTTP_SUCCESS)) {
+                int n = http_fread(data, 1, sizeof(data), fd);
+                if(n <= 0) {
+                    http_err("http_fread failed returned %d errno=%d", n, errno);
+                    ret = -1;
+                    break;
+                }
+                ret = http_client_send_body(client, data, n, chunked);
+            }
 
-        ret = http_tcp_send_wrapper(client, current->data, current->data_len);
-        if (ret <= 0) {
-            return -1;
+            http_fclose(fd);
+        }
+#endif
+        if (ret != HTTP_SUCCESS) {
+            return ret;
         }
-        current = current->next;
     }
 
-    memset(data, 0, sizeof(data));
     snprintf(data, sizeof(data), "\r\n--%s--\r\n", boundary);
-    ret = http_tcp_send_wrapper(client, data, strlen(data));
-    if (ret <= 0) {
-        return -1;
+    ret = http_client_send_body(client, data, strlen(data), chunked);
+    if ((ret == HTTP_SUCCESS) && chunked) {
+        /* last chunk */
+        ret = http_client_write(client, "0\r\n\r\n", 5);
     }
-
-    return 0;
+    return ret;
 }
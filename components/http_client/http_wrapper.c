@@ -16,11 +16,15 @@
 #include <lwip/sockets.h>
 
 #if CONFIG_HTTP_SECURE
-#include "mbedtls/net.h"
+#include <sys/lock.h>
+#include <lwip/sys.h>
+
+#include "mbedtls/net_sockets.h"
 #include "mbedtls/ssl.h"
-#include "mbedtls/certs.h"
 #include "mbedtls/entropy.h"
 #include "mbedtls/ctr_drbg.h"
+#include "mbedtls/debug.h"
+#include "esp_heap_caps.h"
 
 /** @brief   This structure defines the http_client ssl structure.  */
 typedef struct {
@@ -33,14 +37,87 @@ typedef struct {
     mbedtls_x509_crt cacert;            /**< x509 cacert         */
     mbedtls_x509_crt clicert;           /**< x509 client cacert  */
     mbedtls_pk_context pkey;            /**< pkey context        */
+    char host[HTTP_CLIENT_MAX_HOST_LEN];/**< peer host, key of the session and connection cache */
+    int port;                           /**< peer port           */
+    const char *server_cert;            /**< trusted CA the peer was verified with */
+    const char *client_cert;            /**< own certificate presented to the peer */
+    uint32_t idle_since;                /**< sys_now() when parked in the connection cache */
+    size_t ram;                         /**< internal RAM held after the handshake, approximate */
 } http_client_ssl_t;
 
+#if CONFIG_HTTP_SSL_HW_CIPHERSUITES
+/* AES-GCM/CBC with SHA-256 run on the AES and SHA accelerators and the key exchange on the MPI
+ * accelerator, ChaCha20-Poly1305 and SHA-384 suites are left to the server only as a fallback */
+static const int g_ssl_ciphersuites[] = {
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_RSA_WITH_AES_128_GCM_SHA256,
+    MBEDTLS_TLS_RSA_WITH_AES_128_CBC_SHA256,
+    MBEDTLS_TLS_ECDHE_ECDSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_ECDHE_RSA_WITH_AES_256_GCM_SHA384,
+    MBEDTLS_TLS_RSA_WITH_AES_256_GCM_SHA384,
+    0
+};
+#endif
+
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+/** @brief   TLS session of an earlier handshake, lets the next handshake to the same host skip the key exchange. */
+typedef struct {
+    bool valid;
+    char host[HTTP_CLIENT_MAX_HOST_LEN];
+    int port;
+    const char *server_cert;
+    uint32_t last_used;                 /**< sys_now() of the last handshake, the oldest entry is replaced */
+    mbedtls_ssl_session session;
+} http_ssl_session_t;
+
+static http_ssl_session_t g_ssl_sessions[CONFIG_HTTP_SSL_SESSION_CACHE_NUM];
+#endif
+
+#if CONFIG_HTTP_KEEPALIVE
+/* idle connections whose last response was read completely */
+static http_client_ssl_t *g_ssl_idle[CONFIG_HTTP_KEEPALIVE_NUM];
+#endif
+
+#if CONFIG_HTTP_KEEPALIVE || CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+static _lock_t g_ssl_cache_lock;
+#endif
 
 #if defined(MBEDTLS_DEBUG_C)
 #define DEBUG_LEVEL 2
 #endif
 #endif
 
+static const http_client_resolver_t *g_resolver = NULL;
+
+void http_client_set_resolver(const http_client_resolver_t *resolver)
+{
+    g_resolver = resolver;
+}
+
+/* resolve host to an IPv4 address in network byte order, with the registered resolver if any */
+static int http_resolve(const char *host, uint32_t *ip)
+{
+    if (g_resolver) {
+        return g_resolver->resolve(host, ip);
+    }
+
+    struct hostent *hostinfo = gethostbyname(host);
+    if (!hostinfo) {
+        return -1;
+    }
+    memcpy(ip, hostinfo->h_addr, sizeof(uint32_t));
+    return 0;
+}
+
+static void http_resolve_failed(const char *host)
+{
+    if (g_resolver && g_resolver->failed) {
+        g_resolver->failed(host);
+    }
+}
 
 /*  
  *  Conncection wrapper function for HTTP
@@ -92,10 +169,10 @@ int http_tcp_conn_wrapper(http_client_t *client, const char *host)
         return HTTP_ECONN;
     }
 
-    struct hostent *hostinfo = gethostbyname(host);
-    
-    if (!hostinfo) {
-        http_err("hostinfo is null, return EDNS");
+    uint32_t addr;
+    if (http_resolve(host, &addr) != 0) {
+        close(client->socket);
+        http_err("resolve %s failed, return EDNS", host);
         return HTTP_EDNS;
     }
 
@@ -103,7 +180,7 @@ int http_tcp_conn_wrapper(http_client_t *client, const char *host)
     memset(&dest, 0, sizeof(dest));
     dest.sin_family = AF_INET;
     dest.sin_port = htons(client->remote_port);
-    memcpy((void *)&dest.sin_addr.s_addr, (void *)hostinfo->h_addr, (size_t)hostinfo->h_length);
+    dest.sin_addr.s_addr = addr;
 
     char ip[4];
     memcpy(ip, &dest.sin_addr.s_addr, 4);
@@ -117,6 +194,7 @@ int http_tcp_conn_wrapper(http_client_t *client, const char *host)
 
     if (connect(client->socket, (struct sockaddr *)&dest, sizeof(dest)) != 0) {
         close(client->socket);
+        http_resolve_failed(host);
         http_err("connect fail, return HTTP_ECONN");
         return HTTP_ECONN;
     }else{
@@ -271,24 +349,195 @@ static void http_client_debug( void *ctx, int level, const char *file, int line,
     http_debug("%s", str);
 }
 
-static int http_client_random(void *prng, unsigned char *output, size_t output_len)
+#if CONFIG_HTTP_KEEPALIVE || CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+static int http_ssl_same_peer(const char *host, int port, const char *server_cert,
+                              const char *c_host, int c_port, const char *c_server_cert)
 {
-    uint32_t rnglen = output_len;
-    uint8_t rngoffset = 0;
-    struct timeval time;
+    return port == c_port && server_cert == c_server_cert && strcmp(host, c_host) == 0;
+}
+#endif
 
-    memset(&time, 0, sizeof(struct timeval));
-    gettimeofday(&time, NULL);
+static void http_ssl_free(http_client_ssl_t *ssl)
+{
+    mbedtls_ssl_close_notify(&ssl->ssl_ctx);
+    mbedtls_net_free(&ssl->net_ctx);
+#ifdef MBEDTLS_X509_CRT_PARSE_C
+    mbedtls_x509_crt_free(&ssl->cacert);
+    mbedtls_x509_crt_free(&ssl->clicert);
+#endif
+    mbedtls_pk_free(&ssl->pkey);
+    mbedtls_ssl_free(&ssl->ssl_ctx);
+    mbedtls_ssl_config_free(&ssl->ssl_conf);
+#ifdef MBEDTLS_ENTROPY_C
+    mbedtls_ctr_drbg_free(&ssl->ctr_drbg);
+    mbedtls_entropy_free(&ssl->entropy);
+#endif
+    free(ssl);
+}
 
-    aos_srand((unsigned int)(time.tv_sec * 1000 + time.tv_usec / 1000) + aos_rand());
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+static http_ssl_session_t *http_ssl_session_find(http_client_ssl_t *ssl)
+{
+    for (int i = 0; i < CONFIG_HTTP_SSL_SESSION_CACHE_NUM; i++) {
+        http_ssl_session_t *s = &g_ssl_sessions[i];
+        if (s->valid && http_ssl_same_peer(ssl->host, ssl->port, ssl->server_cert, s->host, s->port, s->server_cert)) {
+            return s;
+        }
+    }
+    return NULL;
+}
 
-    while (rnglen > 0) {
-        *(output + rngoffset) = (uint8_t)aos_rand();
-        rngoffset++;
-        rnglen--;
+/* offer the cached session in the ClientHello, the server decides whether to resume */
+static void http_ssl_session_load(http_client_ssl_t *ssl)
+{
+    _lock_acquire(&g_ssl_cache_lock);
+    http_ssl_session_t *s = http_ssl_session_find(ssl);
+    if (s && mbedtls_ssl_set_session(&ssl->ssl_ctx, &s->session) == 0) {
+        http_debug("resume session of %s:%d", ssl->host, ssl->port);
     }
+    _lock_release(&g_ssl_cache_lock);
+}
 
-    return 0;
+static void http_ssl_session_save(http_client_ssl_t *ssl)
+{
+    _lock_acquire(&g_ssl_cache_lock);
+    http_ssl_session_t *s = http_ssl_session_find(ssl);
+    if (!s) {
+        s = &g_ssl_sessions[0];
+        for (int i = 0; i < CONFIG_HTTP_SSL_SESSION_CACHE_NUM; i++) {
+            if (!g_ssl_sessions[i].valid) {
+                s = &g_ssl_sessions[i];
+                break;
+            }
+            if ((int32_t)(g_ssl_sessions[i].last_used - s->last_used) < 0) {
+                s = &g_ssl_sessions[i];
+            }
+        }
+    }
+    mbedtls_ssl_session_free(&s->session);
+    mbedtls_ssl_session_init(&s->session);
+    s->valid = mbedtls_ssl_get_session(&ssl->ssl_ctx, &s->session) == 0;
+    if (s->valid) {
+        strncpy(s->host, ssl->host, sizeof(s->host) - 1);
+        s->port = ssl->port;
+        s->server_cert = ssl->server_cert;
+        s->last_used = sys_now();
+    }
+    _lock_release(&g_ssl_cache_lock);
+}
+
+/* a failed handshake may be caused by a session the server no longer accepts */
+static void http_ssl_session_drop(http_client_ssl_t *ssl)
+{
+    _lock_acquire(&g_ssl_cache_lock);
+    http_ssl_session_t *s = http_ssl_session_find(ssl);
+    if (s) {
+        mbedtls_ssl_session_free(&s->session);
+        s->valid = false;
+    }
+    _lock_release(&g_ssl_cache_lock);
+}
+#endif
+
+#if CONFIG_HTTP_KEEPALIVE
+/* the server closed an idle connection if it became readable (close_notify or FIN) */
+static int http_ssl_idle_alive(http_client_ssl_t *ssl)
+{
+    fd_set sets;
+    struct timeval timeout = {0};
+    int fd = ssl->net_ctx.fd;
+
+    if ((uint32_t)(sys_now() - ssl->idle_since) >= CONFIG_HTTP_KEEPALIVE_IDLE_MS) {
+        return 0;
+    }
+    FD_ZERO(&sets);
+    FD_SET(fd, &sets);
+    return select(fd + 1, &sets, NULL, NULL, &timeout) == 0;
+}
+
+static http_client_ssl_t *http_ssl_idle_take(http_client_t *client, const char *host)
+{
+    http_client_ssl_t *found = NULL;
+    http_client_ssl_t *stale[CONFIG_HTTP_KEEPALIVE_NUM];
+    int stale_num = 0;
+
+    _lock_acquire(&g_ssl_cache_lock);
+    for (int i = 0; i < CONFIG_HTTP_KEEPALIVE_NUM; i++) {
+        http_client_ssl_t *ssl = g_ssl_idle[i];
+        if (!ssl) {
+            continue;
+        }
+        if (!http_ssl_idle_alive(ssl)) {
+            stale[stale_num++] = ssl;
+            g_ssl_idle[i] = NULL;
+        } else if (!found && ssl->client_cert == client->client_cert &&
+                   http_ssl_same_peer(host, client->remote_port, client->server_cert, ssl->host, ssl->port, ssl->server_cert)) {
+            found = ssl;
+            g_ssl_idle[i] = NULL;
+        }
+    }
+    _lock_release(&g_ssl_cache_lock);
+
+    for (int i = 0; i < stale_num; i++) {
+        http_ssl_free(stale[i]);
+    }
+    return found;
+}
+
+/* park the connection, the oldest idle one is closed when all slots are in use */
+static void http_ssl_idle_put(http_client_ssl_t *ssl)
+{
+    http_client_ssl_t *evict = NULL;
+    int slot = 0;
+
+    ssl->idle_since = sys_now();
+
+    _lock_acquire(&g_ssl_cache_lock);
+    for (int i = 0; i < CONFIG_HTTP_KEEPALIVE_NUM; i++) {
+        if (!g_ssl_idle[i]) {
+            slot = i;
+            break;
+        }
+        if ((int32_t)(g_ssl_idle[i]->idle_since - g_ssl_idle[slot]->idle_since) < 0) {
+            slot = i;
+        }
+    }
+    evict = g_ssl_idle[slot];
+    g_ssl_idle[slot] = ssl;
+    _lock_release(&g_ssl_cache_lock);
+
+    if (evict) {
+        http_ssl_free(evict);
+    }
+}
+#endif
+
+void http_client_conn_cache_clear(void)
+{
+#if CONFIG_HTTP_KEEPALIVE
+    http_client_ssl_t *idle[CONFIG_HTTP_KEEPALIVE_NUM];
+
+    _lock_acquire(&g_ssl_cache_lock);
+    memcpy(idle, g_ssl_idle, sizeof(idle));
+    memset(g_ssl_idle, 0, sizeof(g_ssl_idle));
+    _lock_release(&g_ssl_cache_lock);
+
+    for (int i = 0; i < CONFIG_HTTP_KEEPALIVE_NUM; i++) {
+        if (idle[i]) {
+            http_ssl_free(idle[i]);
+        }
+    }
+#endif
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+    _lock_acquire(&g_ssl_cache_lock);
+    for (int i = 0; i < CONFIG_HTTP_SSL_SESSION_CACHE_NUM; i++) {
+        if (g_ssl_sessions[i].valid) {
+            mbedtls_ssl_session_free(&g_ssl_sessions[i].session);
+            g_ssl_sessions[i].valid = false;
+        }
+    }
+    _lock_release(&g_ssl_cache_lock);
+#endif
 }
 
 int http_ssl_conn_wrapper(http_client_t *client, const char *host)
@@ -301,6 +550,19 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
     uint32_t flags;
     char port[10] = {0};
     http_client_ssl_t *ssl;
+    size_t free_before;
+
+#if CONFIG_HTTP_KEEPALIVE
+    if ((ssl = http_ssl_idle_take(client, host)) != NULL) {
+        http_info("reuse connection to %s:%d, ~%d bytes internal RAM", host, client->remote_port, (int)ssl->ram);
+        client->ssl = ssl;
+        client->socket = ssl->net_ctx.fd;
+        return 0;
+    }
+#endif
+
+    /* internal RAM held by this connection once the handshake is done, other tasks allocate meanwhile so it is approximate */
+    free_before = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
 
     client->ssl = (http_client_ssl_t *)calloc(1, sizeof(http_client_ssl_t));
 
@@ -310,6 +572,10 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
         goto exit;
     }
     ssl = (http_client_ssl_t *)client->ssl;
+    strncpy(ssl->host, host, sizeof(ssl->host) - 1);
+    ssl->port = client->remote_port;
+    ssl->server_cert = client->server_cert;
+    ssl->client_cert = client->client_cert;
 
     if (client->server_cert)
         authmode = MBEDTLS_SSL_VERIFY_REQUIRED;
@@ -353,7 +619,8 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
             goto exit;
         }
 #endif
-        ret = mbedtls_pk_parse_key(&ssl->pkey, (const unsigned char *)client->client_pk, client->client_pk_len, NULL, 0);
+        ret = mbedtls_pk_parse_key(&ssl->pkey, (const unsigned char *)client->client_pk, client->client_pk_len, NULL, 0,
+                                   mbedtls_ctr_drbg_random, &ssl->ctr_drbg);
         if (ret != 0) {
             http_err("failed! mbedtls_pk_parse_key returned -0x%x.", -ret);
             ret = -1;
@@ -378,9 +645,19 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
     /*
      * Start the connection
      */
+    /* connect to the resolved address, the host name is still used for SNI and verification */
+    uint32_t addr;
+    char ip[16];
+    if (http_resolve(host, &addr) != 0) {
+        http_err("resolve %s failed.", host);
+        ret = -1;
+        goto exit;
+    }
+    inet_ntoa_r(*(struct in_addr *)&addr, ip, sizeof(ip));
     snprintf(port, sizeof(port), "%d", client->remote_port) ;
-    if ((ret = mbedtls_net_connect(&ssl->net_ctx, host, port, MBEDTLS_NET_PROTO_TCP)) != 0) {
-        http_err("failed! mbedtls_net_connect returned %d, port:%s.", ret, port);
+    if ((ret = mbedtls_net_connect(&ssl->net_ctx, ip, port, MBEDTLS_NET_PROTO_TCP)) != 0) {
+        http_err("failed! mbedtls_net_connect returned %d, %s:%s.", ret, ip, port);
+        http_resolve_failed(host);
         ret = -1;
         goto exit;
     }
@@ -401,7 +678,7 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
 
     // TODO: add customerization encryption algorithm
 #ifdef MBEDTLS_X509_CRT_PARSE_C
-    memcpy(&ssl->profile, ssl->ssl_conf.cert_profile, sizeof(mbedtls_x509_crt_profile));
+    memcpy(&ssl->profile, &mbedtls_x509_crt_profile_default, sizeof(mbedtls_x509_crt_profile));
     ssl->profile.allowed_mds = ssl->profile.allowed_mds | MBEDTLS_X509_ID_FLAG(MBEDTLS_MD_MD5);
     mbedtls_ssl_conf_cert_profile(&ssl->ssl_conf, &ssl->profile);
 
@@ -415,24 +692,49 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
     }
 #endif
 
-    mbedtls_ssl_conf_rng(&ssl->ssl_conf, http_client_random, &ssl->ctr_drbg);
+    mbedtls_ssl_conf_rng(&ssl->ssl_conf, mbedtls_ctr_drbg_random, &ssl->ctr_drbg);
     mbedtls_ssl_conf_dbg(&ssl->ssl_conf, http_client_debug, NULL);
 
+#if CONFIG_HTTP_SSL_HW_CIPHERSUITES
+    mbedtls_ssl_conf_ciphersuites(&ssl->ssl_conf, g_ssl_ciphersuites);
+#endif
+#if defined(MBEDTLS_SSL_MAX_FRAGMENT_LENGTH) && CONFIG_HTTP_SSL_MAX_FRAG_LEN > 0
+    /* ask the server for smaller records, with CONFIG_MBEDTLS_DYNAMIC_BUFFER the input buffer is allocated per record
+     * so it stays this small; a server that ignores the extension keeps sending up to 16 KB records */
+    if ((value = mbedtls_ssl_conf_max_frag_len(&ssl->ssl_conf, CONFIG_HTTP_SSL_MAX_FRAG_LEN)) != 0) {
+        http_err("mbedtls_ssl_conf_max_frag_len() failed, value:-0x%x.", -value);
+    }
+#endif
+
     if ((value = mbedtls_ssl_setup(&ssl->ssl_ctx, &ssl->ssl_conf)) != 0) {
         http_err("mbedtls_ssl_setup() failed, value:-0x%x.", -value);
         ret = -1;
         goto exit;
     }
 
+    /* SNI, and the name the server certificate is checked against */
+    if ((value = mbedtls_ssl_set_hostname(&ssl->ssl_ctx, host)) != 0) {
+        http_err("mbedtls_ssl_set_hostname() failed, value:-0x%x.", -value);
+        ret = -1;
+        goto exit;
+    }
+
     mbedtls_ssl_set_bio(&ssl->ssl_ctx, &ssl->net_ctx, mbedtls_net_send, mbedtls_net_recv, mbedtls_net_recv_timeout);
     mbedtls_ssl_conf_read_timeout(&ssl->ssl_conf, 10000);
 
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+    http_ssl_session_load(ssl);
+#endif
+
     /*
     * Handshake
     */
     while ((ret = mbedtls_ssl_handshake(&ssl->ssl_ctx)) != 0) {
         if (ret != MBEDTLS_ERR_SSL_WANT_READ && ret != MBEDTLS_ERR_SSL_WANT_WRITE) {
             http_err("mbedtls_ssl_handshake() failed, ret:-0x%x.", -ret);
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+            http_ssl_session_drop(ssl);
+#endif
             ret = -1;
             goto exit;
         }
@@ -449,6 +751,16 @@ int http_ssl_conn_wrapper(http_client_t *client, const char *host)
         ret = -1;
     } else {
         http_info("svr_cert varification ok.");
+#if CONFIG_HTTP_SSL_SESSION_CACHE_NUM > 0
+        http_ssl_session_save(ssl);
+#endif
+    }
+
+    if (ret == 0) {
+        size_t free_after = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+        ssl->ram = free_before > free_after ? free_before - free_after : 0;
+        http_info("tls %s: %s, max in %d, ~%d bytes internal RAM", host, mbedtls_ssl_get_ciphersuite(&ssl->ssl_ctx),
+                  mbedtls_ssl_get_max_in_record_payload(&ssl->ssl_ctx), (int)ssl->ram);
     }
 
 exit:
@@ -472,20 +784,15 @@ int http_ssl_close_wrapper(http_client_t *client)
     client->client_pk = NULL;
     client->socket = -1;
 
-    mbedtls_ssl_close_notify(&ssl->ssl_ctx);
-    mbedtls_net_free(&ssl->net_ctx);
-#ifdef MBEDTLS_X509_CRT_PARSE_C
-    mbedtls_x509_crt_free(&ssl->cacert);
-    mbedtls_x509_crt_free(&ssl->clicert);
-#endif
-    mbedtls_pk_free(&ssl->pkey);
-    mbedtls_ssl_free(&ssl->ssl_ctx);
-    mbedtls_ssl_config_free(&ssl->ssl_conf);
-#ifdef MBEDTLS_ENTROPY_C
-    mbedtls_ctr_drbg_free(&ssl->ctr_drbg);
-    mbedtls_entropy_free(&ssl->entropy);
+#if CONFIG_HTTP_KEEPALIVE
+    if (client->reusable) {
+        client->reusable = false;
+        http_ssl_idle_put(ssl);
+        return 0;
+    }
 #endif
-    free(ssl);
+
+    http_ssl_free(ssl);
     ssl = NULL;
     return 0;
 }
@@ -508,14 +815,6 @@ int http_ssl_recv_wrapper(http_client_t *client, char *buf, int buflen, int time
             ret = HTTP_ECLSD;
         } else if (ret < 0) {
             http_debug("mbedtls_ssl_read, return:%d", ret);
-            if ((MBEDTLS_ERR_SSL_TIMEOUT == ret)
-                 || (MBEDTLS_ERR_SSL_CONN_EOF == ret)
-                 || (MBEDTLS_ERR_SSL_SESSION_TICKET_EXPIRED == ret)
-                 || (MBEDTLS_ERR_SSL_NON_FATAL == ret)) {
-                /* read already complete */
-                /* if call mbedtls_ssl_read again, it will return 0 (means EOF) */
-            }
-
             if (MBEDTLS_ERR_SSL_WANT_READ == ret) {
                 continue;
             }
@@ -527,6 +826,10 @@ int http_ssl_recv_wrapper(http_client_t *client, char *buf, int buflen, int time
 
         if (ret > 0) {
             readLen += ret;
+            /* return what has been decrypted, a kept-alive server will not close to end the read */
+            if (mbedtls_ssl_get_bytes_avail(&ssl->ssl_ctx) == 0) {
+                break;
+            }
         } else if (ret == HTTP_ECLSD) {
             break;
         } else {
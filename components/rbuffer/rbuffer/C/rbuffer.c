@@ -375,6 +375,64 @@ uint32_t rbuffer_get_buffer(rbuffer_handle_t handle, uint32_t index, void *buffe
     return size;
 }
 
+uint32_t rbuffer_peek(rbuffer_handle_t handle, uint32_t offset, rbuffer_span_t span[2]){
+    uint32_t pos;
+    uint32_t size;
+    uint32_t first;
+    rbuffer_t *rbuffer = NULL;
+
+    rbuffer = (rbuffer_t *)handle;
+
+    span[0].data = NULL;
+    span[0].len = 0;
+    span[1].data = NULL;
+    span[1].len = 0;
+
+    if(!rbuffer || offset >= rbuffer->curr_size){
+        return 0;
+    }
+
+    size = rbuffer->curr_size - offset;
+    pos = (rbuffer->read_pos + offset)%rbuffer->init_size;
+    first = MIN(size, rbuffer->init_size - pos);
+
+    span[0].data = (const uint8_t *)rbuffer->buffer + pos;
+    span[0].len = first;
+    if(size > first){
+        span[1].data = (const uint8_t *)rbuffer->buffer;
+        span[1].len = size - first;
+    }
+
+    return size;
+}
+
+int32_t rbuffer_find_byte(rbuffer_handle_t handle, uint32_t offset, uint8_t byte){
+    uint8_t i;
+    const uint8_t *hit;
+    uint32_t skip = offset;
+    rbuffer_span_t span[2];
+
+    if(rbuffer_peek(handle, offset, span) == 0){
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++){
+        if(span[i].len == 0){
+            break;
+        }
+        hit = memchr(span[i].data, byte, span[i].len);
+        if(hit){
+            return (int32_t)(skip + (hit - span[i].data));
+        }
+        skip += span[i].len;
+    }
+
+    return -1;
+}
+
+uint32_t rbuffer_commit_read(rbuffer_handle_t handle, uint32_t size){
+    return rbuffer_discard(handle, size);
+}
 
 void rbuffer_dump(rbuffer_handle_t handle, uint32_t size){
     uint32_t i = 0;
@@ -26,6 +26,12 @@ extern "C" {
 
 typedef void* rbuffer_handle_t;
 
+// rbuffer_peek 返回的连续片段，数据跨越缓冲末尾时分成两段
+typedef struct {
+    const uint8_t *data;
+    uint32_t len;
+}rbuffer_span_t;
+
 rbuffer_handle_t rbuffer_create(uint32_t size);
 rbuffer_handle_t rbuffer_static_create(void *buffer, uint32_t size);
 bool rbuffer_delete(rbuffer_handle_t handle);
@@ -52,6 +58,13 @@ bool rbuffer_get_head_forward_index(rbuffer_handle_t handle, uint32_t forward, u
 bool rbuffer_get_end_backward_index(rbuffer_handle_t handle, uint32_t backward, uint32_t *index);
 uint32_t rbuffer_get_buffer(rbuffer_handle_t handle, uint32_t index, void *buffer, uint32_t size);
 
+/* 零拷贝读取：offset 为相对读位置的偏移，返回可读字节数，span[0]/span[1] 指向缓冲内部 */
+uint32_t rbuffer_peek(rbuffer_handle_t handle, uint32_t offset, rbuffer_span_t span[2]);
+/* 从 offset 开始查找 byte，返回相对读位置的偏移，未找到返回 -1 */
+int32_t rbuffer_find_byte(rbuffer_handle_t handle, uint32_t offset, uint8_t byte);
+/* peek 之后确认已读取 size 字节 */
+uint32_t rbuffer_commit_read(rbuffer_handle_t handle, uint32_t size);
+
 void rbuffer_dump(rbuffer_handle_t handle, uint32_t size);
 
 
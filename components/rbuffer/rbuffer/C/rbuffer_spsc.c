@@ -0,0 +1,256 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-16 19:59:04
+ * @Last Modified time: 2022-03-16 19:59:04
+ */
+
+#include "rbuffer_spsc.h"
+
+#include <string.h>
+#include <stdatomic.h>
+
+#define MIN(a, b) ((a)<(b)?(a):(b))
+
+typedef struct {
+    uint32_t size;
+    uint32_t mask;
+    _Atomic uint32_t head;      // 生产者写入
+    _Atomic uint32_t tail;      // 消费者写入
+    uint8_t *buffer;
+    bool need_free;
+}rbuffer_spsc_t;
+
+static rbuffer_spsc_t *__spsc_alloc(void *buffer, uint32_t size){
+    rbuffer_spsc_t *rbuffer = NULL;
+
+    // 容量必须为 2 的幂
+    if(size == 0 || (size & (size - 1)) != 0){
+        return NULL;
+    }
+
+    rbuffer = (rbuffer_spsc_t *)RBUFFER_MALLOC(sizeof(rbuffer_spsc_t));
+    if(!rbuffer){
+        return NULL;
+    }
+
+    rbuffer->size = size;
+    rbuffer->mask = size - 1;
+    atomic_init(&rbuffer->head, 0);
+    atomic_init(&rbuffer->tail, 0);
+    rbuffer->buffer = (uint8_t *)buffer;
+    rbuffer->need_free = false;
+
+    return rbuffer;
+}
+
+rbuffer_spsc_handle_t rbuffer_spsc_create(uint32_t size){
+    rbuffer_spsc_t *rbuffer = __spsc_alloc(NULL, size);
+
+    if(!rbuffer){
+        return NULL;
+    }
+
+    rbuffer->buffer = (uint8_t *)RBUFFER_MALLOC(size);
+    if(!rbuffer->buffer){
+        RBUFFER_FREE(rbuffer);
+        return NULL;
+    }
+    rbuffer->need_free = true;
+
+    return rbuffer;
+}
+
+rbuffer_spsc_handle_t rbuffer_spsc_static_create(void *buffer, uint32_t size){
+    if(buffer == NULL){
+        return NULL;
+    }
+
+    return __spsc_alloc(buffer, size);
+}
+
+bool rbuffer_spsc_delete(rbuffer_spsc_handle_t handle){
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer){
+        return false;
+    }
+
+    if(rbuffer->need_free && rbuffer->buffer){
+        RBUFFER_FREE(rbuffer->buffer);
+    }
+
+    RBUFFER_FREE(rbuffer);
+
+    return true;
+}
+
+uint32_t rbuffer_spsc_push(rbuffer_spsc_handle_t handle, const void *buffer, uint32_t size){
+    uint32_t head;
+    uint32_t tail;
+    uint32_t pos;
+    uint32_t move_size;
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer || buffer == NULL || size == 0){
+        return 0;
+    }
+
+    head = atomic_load_explicit(&rbuffer->head, memory_order_relaxed);
+    tail = atomic_load_explicit(&rbuffer->tail, memory_order_acquire);
+
+    size = MIN(size, rbuffer->size - (head - tail));
+    if(size == 0){
+        return 0;
+    }
+
+    pos = head & rbuffer->mask;
+    move_size = MIN(size, rbuffer->size - pos);
+    memcpy(rbuffer->buffer + pos, buffer, move_size);
+    if(size > move_size){
+        memcpy(rbuffer->buffer, (const uint8_t *)buffer + move_size, size - move_size);
+    }
+
+    // 数据写完后再发布 head，消费者看到 head 时数据已可见
+    atomic_store_explicit(&rbuffer->head, head + size, memory_order_release);
+
+    return size;
+}
+
+uint32_t rbuffer_spsc_peek(rbuffer_spsc_handle_t handle, uint32_t offset, rbuffer_span_t span[2]){
+    uint32_t head;
+    uint32_t tail;
+    uint32_t pos;
+    uint32_t size;
+    uint32_t first;
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    span[0].data = NULL;
+    span[0].len = 0;
+    span[1].data = NULL;
+    span[1].len = 0;
+
+    if(!rbuffer){
+        return 0;
+    }
+
+    tail = atomic_load_explicit(&rbuffer->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&rbuffer->head, memory_order_acquire);
+
+    if(offset >= head - tail){
+        return 0;
+    }
+
+    size = head - tail - offset;
+    pos = (tail + offset) & rbuffer->mask;
+    first = MIN(size, rbuffer->size - pos);
+
+    span[0].data = rbuffer->buffer + pos;
+    span[0].len = first;
+    if(size > first){
+        span[1].data = rbuffer->buffer;
+        span[1].len = size - first;
+    }
+
+    return size;
+}
+
+int32_t rbuffer_spsc_find_byte(rbuffer_spsc_handle_t handle, uint32_t offset, uint8_t byte){
+    uint8_t i;
+    const uint8_t *hit;
+    uint32_t skip = offset;
+    rbuffer_span_t span[2];
+
+    if(rbuffer_spsc_peek(handle, offset, span) == 0){
+        return -1;
+    }
+
+    for (i = 0; i < 2; i++){
+        if(span[i].len == 0){
+            break;
+        }
+        hit = memchr(span[i].data, byte, span[i].len);
+        if(hit){
+            return (int32_t)(skip + (hit - span[i].data));
+        }
+        skip += span[i].len;
+    }
+
+    return -1;
+}
+
+uint32_t rbuffer_spsc_commit_read(rbuffer_spsc_handle_t handle, uint32_t size){
+    uint32_t head;
+    uint32_t tail;
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer){
+        return 0;
+    }
+
+    tail = atomic_load_explicit(&rbuffer->tail, memory_order_relaxed);
+    head = atomic_load_explicit(&rbuffer->head, memory_order_acquire);
+
+    size = MIN(size, head - tail);
+    // 数据读完后再释放空间，生产者看到 tail 时才会覆盖
+    atomic_store_explicit(&rbuffer->tail, tail + size, memory_order_release);
+
+    return size;
+}
+
+uint32_t rbuffer_spsc_pop(rbuffer_spsc_handle_t handle, void *buffer, uint32_t size){
+    uint32_t avail;
+    rbuffer_span_t span[2];
+
+    if(buffer == NULL || size == 0){
+        return 0;
+    }
+
+    avail = rbuffer_spsc_peek(handle, 0, span);
+    size = MIN(size, avail);
+    if(size == 0){
+        return 0;
+    }
+
+    if(size <= span[0].len){
+        memcpy(buffer, span[0].data, size);
+    }else{
+        memcpy(buffer, span[0].data, span[0].len);
+        memcpy((uint8_t *)buffer + span[0].len, span[1].data, size - span[0].len);
+    }
+
+    return rbuffer_spsc_commit_read(handle, size);
+}
+
+uint32_t rbuffer_spsc_total_size(rbuffer_spsc_handle_t handle){
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer){
+        return 0;
+    }
+
+    return rbuffer->size;
+}
+
+uint32_t rbuffer_spsc_used_size(rbuffer_spsc_handle_t handle){
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer){
+        return 0;
+    }
+
+    // 先读 tail 再读 head，保证 head >= tail
+    uint32_t tail = atomic_load_explicit(&rbuffer->tail, memory_order_acquire);
+    uint32_t head = atomic_load_explicit(&rbuffer->head, memory_order_acquire);
+
+    return head - tail;
+}
+
+uint32_t rbuffer_spsc_available_size(rbuffer_spsc_handle_t handle){
+    rbuffer_spsc_t *rbuffer = (rbuffer_spsc_t *)handle;
+
+    if(!rbuffer){
+        return 0;
+    }
+
+    return rbuffer->size - rbuffer_spsc_used_size(handle);
+}
@@ -0,0 +1,49 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-16 19:59:10
+ * @Last Modified time: 2022-03-16 19:59:10
+ */
+
+#ifndef __RBUFFER_SPSC_H__
+#define __RBUFFER_SPSC_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "rbuffer.h"
+
+/*
+ * 单生产者/单消费者无锁 RingBuffer
+ *
+ * - 容量必须为 2 的幂，下标用掩码计算
+ * - head/tail 为自由递增的原子计数，生产者只写 head，消费者只写 tail
+ * - push 只能在一个任务（或中断）中调用，pop/peek/commit_read 只能在另一个任务中调用
+ * - 不支持覆盖写入，满时 push 返回实际写入的字节数
+ */
+typedef void* rbuffer_spsc_handle_t;
+
+rbuffer_spsc_handle_t rbuffer_spsc_create(uint32_t size);
+rbuffer_spsc_handle_t rbuffer_spsc_static_create(void *buffer, uint32_t size);
+bool rbuffer_spsc_delete(rbuffer_spsc_handle_t handle);
+
+/* 生产者 */
+uint32_t rbuffer_spsc_push(rbuffer_spsc_handle_t handle, const void *buffer, uint32_t size);
+
+/* 消费者 */
+uint32_t rbuffer_spsc_pop(rbuffer_spsc_handle_t handle, void *buffer, uint32_t size);
+uint32_t rbuffer_spsc_peek(rbuffer_spsc_handle_t handle, uint32_t offset, rbuffer_span_t span[2]);
+int32_t rbuffer_spsc_find_byte(rbuffer_spsc_handle_t handle, uint32_t offset, uint8_t byte);
+uint32_t rbuffer_spsc_commit_read(rbuffer_spsc_handle_t handle, uint32_t size);
+
+/* 任意一方均可调用，结果为调用时刻的快照 */
+uint32_t rbuffer_spsc_total_size(rbuffer_spsc_handle_t handle);
+uint32_t rbuffer_spsc_used_size(rbuffer_spsc_handle_t handle);
+uint32_t rbuffer_spsc_available_size(rbuffer_spsc_handle_t handle);
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // __RBUFFER_SPSC_H__
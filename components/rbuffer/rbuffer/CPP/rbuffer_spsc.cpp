@@ -0,0 +1,172 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-16 19:59:12
+ * @Last Modified time: 2022-03-16 19:59:12
+ */
+
+#include "rbuffer_spsc.hpp"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define MIN(a, b) ((a)<(b)?(a):(b))
+
+static bool __is_pow2(uint32_t size){
+    return size != 0 && (size & (size - 1)) == 0;
+}
+
+RbufferSpsc::RbufferSpsc(uint32_t size): m_buffer(nullptr), m_need_free(true), m_size(size), m_mask(size - 1), m_head(0), m_tail(0){
+
+    if(__is_pow2(size)){
+        m_buffer = (uint8_t *)RBUFFER_MALLOC(size);
+    }
+}
+
+RbufferSpsc::RbufferSpsc(void *buffer, uint32_t size): m_buffer(nullptr), m_need_free(false), m_size(size), m_mask(size - 1), m_head(0), m_tail(0){
+
+    if(__is_pow2(size)){
+        m_buffer = (uint8_t *)buffer;
+    }
+}
+
+RbufferSpsc::~RbufferSpsc(){
+
+    if(m_need_free && m_buffer){
+        RBUFFER_FREE(m_buffer);
+    }
+}
+
+bool RbufferSpsc::valid(){
+    return m_buffer != nullptr;
+}
+
+uint32_t RbufferSpsc::push(const void *buffer, uint32_t size){
+    uint32_t pos;
+    uint32_t move_size;
+
+    if(!m_buffer || buffer == NULL || size == 0){
+        return 0;
+    }
+
+    uint32_t head = m_head.load(std::memory_order_relaxed);
+    uint32_t tail = m_tail.load(std::memory_order_acquire);
+
+    size = MIN(size, m_size - (head - tail));
+    if(size == 0){
+        return 0;
+    }
+
+    pos = head & m_mask;
+    move_size = MIN(size, m_size - pos);
+    memcpy(m_buffer + pos, buffer, move_size);
+    if(size > move_size){
+        memcpy(m_buffer, (const uint8_t *)buffer + move_size, size - move_size);
+    }
+
+    m_head.store(head + size, std::memory_order_release);
+
+    return size;
+}
+
+uint32_t RbufferSpsc::peek(uint32_t offset, Span span[2]){
+    uint32_t pos;
+    uint32_t size;
+    uint32_t first;
+
+    span[0] = {nullptr, 0};
+    span[1] = {nullptr, 0};
+
+    if(!m_buffer){
+        return 0;
+    }
+
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+
+    if(offset >= head - tail){
+        return 0;
+    }
+
+    size = head - tail - offset;
+    pos = (tail + offset) & m_mask;
+    first = MIN(size, m_size - pos);
+
+    span[0] = {m_buffer + pos, first};
+    if(size > first){
+        span[1] = {m_buffer, size - first};
+    }
+
+    return size;
+}
+
+int32_t RbufferSpsc::find_byte(uint32_t offset, uint8_t byte){
+    uint32_t skip = offset;
+    Span span[2];
+
+    if(peek(offset, span) == 0){
+        return -1;
+    }
+
+    for (uint8_t i = 0; i < 2 && span[i].len; i++){
+        const uint8_t *hit = (const uint8_t *)memchr(span[i].data, byte, span[i].len);
+        if(hit){
+            return (int32_t)(skip + (hit - span[i].data));
+        }
+        skip += span[i].len;
+    }
+
+    return -1;
+}
+
+uint32_t RbufferSpsc::commit_read(uint32_t size){
+
+    if(!m_buffer){
+        return 0;
+    }
+
+    uint32_t tail = m_tail.load(std::memory_order_relaxed);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+
+    size = MIN(size, head - tail);
+    m_tail.store(tail + size, std::memory_order_release);
+
+    return size;
+}
+
+uint32_t RbufferSpsc::pop(void *buffer, uint32_t size){
+    Span span[2];
+
+    if(buffer == NULL || size == 0){
+        return 0;
+    }
+
+    uint32_t avail = peek(0, span);
+    size = MIN(size, avail);
+    if(size == 0){
+        return 0;
+    }
+
+    if(size <= span[0].len){
+        memcpy(buffer, span[0].data, size);
+    }else{
+        memcpy(buffer, span[0].data, span[0].len);
+        memcpy((uint8_t *)buffer + span[0].len, span[1].data, size - span[0].len);
+    }
+
+    return commit_read(size);
+}
+
+uint32_t RbufferSpsc::total_size(){
+    return m_buffer ? m_size : 0;
+}
+
+uint32_t RbufferSpsc::used_size(){
+    uint32_t tail = m_tail.load(std::memory_order_acquire);
+    uint32_t head = m_head.load(std::memory_order_acquire);
+
+    return head - tail;
+}
+
+uint32_t RbufferSpsc::available_size(){
+    return total_size() - used_size();
+}
@@ -0,0 +1,58 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-16 19:59:15
+ * @Last Modified time: 2022-03-16 19:59:15
+ */
+
+#ifndef __RBUFFER_SPSC_HPP__
+#define __RBUFFER_SPSC_HPP__
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include <atomic>
+
+#include "rbuffer.hpp"
+
+/*
+ * 单生产者/单消费者无锁 RingBuffer，与 C 版本 rbuffer_spsc 行为一致
+ * 容量必须为 2 的幂；push 只在生产者调用，pop/peek/commit_read 只在消费者调用
+ */
+class RbufferSpsc
+{
+public:
+    struct Span {
+        const uint8_t *data;
+        uint32_t len;
+    };
+
+private:
+    uint8_t *m_buffer;
+    bool m_need_free;
+    uint32_t m_size;
+    uint32_t m_mask;
+    std::atomic<uint32_t> m_head;   // 生产者写入
+    std::atomic<uint32_t> m_tail;   // 消费者写入
+public:
+    RbufferSpsc(uint32_t size);
+    RbufferSpsc(void *buffer, uint32_t size);
+    ~RbufferSpsc();
+
+    RbufferSpsc(const RbufferSpsc &) = delete;
+    RbufferSpsc &operator=(const RbufferSpsc &) = delete;
+
+    bool valid();
+
+    uint32_t push(const void *buffer, uint32_t size);
+
+    uint32_t pop(void *buffer, uint32_t size);
+    uint32_t peek(uint32_t offset, Span span[2]);
+    int32_t find_byte(uint32_t offset, uint8_t byte);
+    uint32_t commit_read(uint32_t size);
+
+    uint32_t total_size();
+    uint32_t used_size();
+    uint32_t available_size();
+};
+
+#endif // __RBUFFER_SPSC_HPP__
@@ -0,0 +1,147 @@
+/*
+ * @Author: HoGC
+ * @Date: 2022-03-16 19:59:15
+ * @Last Modified time: 2022-03-16 19:59:15
+ */
+
+#ifndef __RBUFFER_STATIC_HPP__
+#define __RBUFFER_STATIC_HPP__
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <new>
+#include <utility>
+
+/*
+ * 编译期定容的类型化 RingBuffer，元素存放在对象内部，不分配堆内存
+ *
+ * - N 必须为 2 的幂，下标用掩码计算
+ * - 元素按需构造/析构，T 不要求默认构造
+ * - 不带锁，与 Rbuffer 一样由调用方保证单线程访问
+ *
+ *   StaticRbuffer<uart_packet_t, 8> queue;
+ *   queue.push(packet);
+ *   queue.emplace(...);
+ *   uart_packet_t out;
+ *   if(queue.pop(out)){ ... }
+ */
+template <typename T, size_t N>
+class StaticRbuffer
+{
+    static_assert(N > 0, "StaticRbuffer capacity must be greater than 0");
+    static_assert((N & (N - 1)) == 0, "StaticRbuffer capacity must be a power of 2");
+    static_assert(N <= UINT32_MAX, "StaticRbuffer capacity too large");
+
+private:
+    static constexpr uint32_t MASK = N - 1;
+
+    alignas(T) unsigned char m_storage[N * sizeof(T)];
+    uint32_t m_head;    // 下一个写入位置（自由递增）
+    uint32_t m_tail;    // 下一个读取位置（自由递增）
+
+    T *slot(uint32_t pos){
+        return reinterpret_cast<T *>(m_storage) + (pos & MASK);
+    }
+
+    const T *slot(uint32_t pos) const {
+        return reinterpret_cast<const T *>(m_storage) + (pos & MASK);
+    }
+
+public:
+    StaticRbuffer(): m_head(0), m_tail(0){}
+
+    ~StaticRbuffer(){
+        clear();
+    }
+
+    StaticRbuffer(const StaticRbuffer &) = delete;
+    StaticRbuffer &operator=(const StaticRbuffer &) = delete;
+
+    static constexpr size_t capacity(){
+        return N;
+    }
+
+    size_t size() const {
+        return m_head - m_tail;
+    }
+
+    size_t available() const {
+        return N - size();
+    }
+
+    bool empty() const {
+        return m_head == m_tail;
+    }
+
+    bool full() const {
+        return size() == N;
+    }
+
+    bool push(const T &value){
+        return emplace(value);
+    }
+
+    bool push(T &&value){
+        return emplace(std::move(value));
+    }
+
+    // 在队尾原地构造，满时返回 false
+    template <typename... Args>
+    bool emplace(Args &&...args){
+        if(full()){
+            return false;
+        }
+        new (slot(m_head)) T(std::forward<Args>(args)...);
+        m_head++;
+        return true;
+    }
+
+    // 取出队首元素（移动赋值给 out），空时返回 false
+    bool pop(T &out){
+        if(empty()){
+            return false;
+        }
+        T *p = slot(m_tail);
+        out = std::move(*p);
+        p->~T();
+        m_tail++;
+        return true;
+    }
+
+    // 丢弃队首 count 个元素，返回实际丢弃数
+    size_t discard(size_t count){
+        size_t n = 0;
+        while (n < count && !empty()){
+            slot(m_tail)->~T();
+            m_tail++;
+            n++;
+        }
+        return n;
+    }
+
+    void clear(){
+        discard(size());
+        m_head = 0;
+        m_tail = 0;
+    }
+
+    // 访问队首/第 index 个元素，调用方保证 index < size()
+    T &front(){
+        return *slot(m_tail);
+    }
+
+    const T &front() const {
+        return *slot(m_tail);
+    }
+
+    T &operator[](size_t index){
+        return *slot(m_tail + (uint32_t)index);
+    }
+
+    const T &operator[](size_t index) const {
+        return *slot(m_tail + (uint32_t)index);
+    }
+};
+
+#endif // __RBUFFER_STATIC_HPP__
@@ -12,6 +12,10 @@
 #include "usb/usb_host.h"
 #include "esp_msc_ota.h"
 #include "esp_msc_host.h"
+#if CONFIG_MSC_HOST_READ_AHEAD
+#include "diskio_impl.h"
+#include "esp_msc_host_cache.h"
+#endif
 
 static const char *TAG = "esp_msc_host";
 
@@ -116,9 +120,19 @@ static void msc_host_task(void *args)
         MSC_OTA_CHECK_GOTO(err == ESP_OK, "Failed to get device info", host_uninstall);
 #ifdef CONFIG_MSC_PRINT_DESC
         print_device_info(&info);
+#endif
+#if CONFIG_MSC_HOST_READ_AHEAD
+        // msc_host_vfs_register() takes the first free drive, the cache is put in front of the same one
+        BYTE pdrv = 0xFF;
+        ff_diskio_get_drive(&pdrv);
 #endif
         err = msc_host_vfs_register(msc_device, msc_host->base_path, &msc_host->mount_config, &vfs_handle);
         MSC_OTA_CHECK_GOTO(err == ESP_OK, "Failed to register VFS", host_uninstall);
+#if CONFIG_MSC_HOST_READ_AHEAD
+        if (pdrv != 0xFF) {
+            esp_msc_host_cache_attach(pdrv, msc_device, &info);
+        }
+#endif
 
         esp_msc_host_dispatch_event(ESP_MSC_HOST_VFS_REGISTER, NULL, 0);
         xSemaphoreGive(msc_read_semaphore);
@@ -130,6 +144,9 @@ static void msc_host_task(void *args)
         // Ensure that no client reads the MSC before unloading the device
         xSemaphoreTake(msc_read_semaphore, portMAX_DELAY);
         err = msc_host_vfs_unregister(vfs_handle);
+#if CONFIG_MSC_HOST_READ_AHEAD
+        esp_msc_host_cache_detach();
+#endif
         esp_msc_host_dispatch_event(ESP_MSC_HOST_VFS_UNREGISTER, NULL, 0);
         MSC_OTA_CHECK_CONTINUE(err == ESP_OK, "Failed to unregister VFS");
 host_uninstall:
@@ -0,0 +1,174 @@
+/*
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_MSC_HOST_READ_AHEAD
+
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+#include "esp_heap_caps.h"
+#include "diskio_impl.h"
+#include "esp_msc_ota_help.h"
+#include "esp_msc_host_cache.h"
+
+static const char *TAG = "esp_msc_host_cache";
+
+#define MSC_CACHE_WINDOW_BYTES      (CONFIG_MSC_HOST_READ_AHEAD_KB * 1024)
+
+typedef struct {
+    msc_host_device_handle_t device;
+    uint32_t sector_size;
+    uint32_t sector_count;
+    uint32_t window_sectors;
+    uint8_t *window;
+    uint32_t start;             /*!< first sector held in the window */
+    uint32_t count;             /*!< sectors held in the window, 0 if empty */
+    uint32_t next;              /*!< sector following the last read, for sequential detection */
+    uint32_t hits;
+    uint32_t fills;
+    uint32_t direct;
+} msc_host_cache_t;
+
+static msc_host_cache_t *s_cache = NULL;
+
+static DSTATUS cache_disk_init(BYTE pdrv)
+{
+    return 0;
+}
+
+static DSTATUS cache_disk_status(BYTE pdrv)
+{
+    return 0;
+}
+
+static DRESULT cache_read_device(uint8_t *buff, uint32_t sector, uint32_t count)
+{
+    esp_err_t err = msc_host_read_sector(s_cache->device, sector, buff, count * s_cache->sector_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Read %"PRIu32" sectors at %"PRIu32" failed: %s", count, sector, esp_err_to_name(err));
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT cache_disk_read(BYTE pdrv, BYTE *buff, uint32_t sector, UINT count)
+{
+    msc_host_cache_t *c = s_cache;
+    bool sequential = (sector == c->next);
+    c->next = sector + count;
+
+    if (c->count && sector >= c->start && sector + count <= c->start + c->count) {
+        memcpy(buff, c->window + (sector - c->start) * c->sector_size, count * c->sector_size);
+        c->hits++;
+        return RES_OK;
+    }
+    /* random access (FAT and directory lookups) and reads as large as the window gain nothing from read-ahead */
+    if (!sequential || count >= c->window_sectors) {
+        c->direct++;
+        return cache_read_device(buff, sector, count);
+    }
+    uint32_t fill = c->window_sectors;
+    if (sector + fill > c->sector_count) {
+        fill = c->sector_count - sector;
+    }
+    c->count = 0;
+    DRESULT res = cache_read_device(c->window, sector, fill);
+    if (res != RES_OK) {
+        return res;
+    }
+    c->start = sector;
+    c->count = fill;
+    c->fills++;
+    memcpy(buff, c->window, count * c->sector_size);
+    return RES_OK;
+}
+
+static DRESULT cache_disk_write(BYTE pdrv, const BYTE *buff, uint32_t sector, UINT count)
+{
+    msc_host_cache_t *c = s_cache;
+    if (c->count && sector < c->start + c->count && sector + count > c->start) {
+        c->count = 0;
+    }
+    c->next = UINT32_MAX;
+    esp_err_t err = msc_host_write_sector(c->device, sector, buff, count * c->sector_size);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Write %u sectors at %"PRIu32" failed: %s", count, sector, esp_err_to_name(err));
+        return RES_ERROR;
+    }
+    return RES_OK;
+}
+
+static DRESULT cache_disk_ioctl(BYTE pdrv, BYTE cmd, void *buff)
+{
+    switch (cmd) {
+    case CTRL_SYNC:
+        return RES_OK;
+    case GET_SECTOR_COUNT:
+        *((LBA_t *)buff) = s_cache->sector_count;
+        return RES_OK;
+    case GET_SECTOR_SIZE:
+        *((WORD *)buff) = s_cache->sector_size;
+        return RES_OK;
+    case GET_BLOCK_SIZE:
+        *((DWORD *)buff) = 1;
+        return RES_OK;
+    default:
+        return RES_PARERR;
+    }
+}
+
+esp_err_t esp_msc_host_cache_attach(uint8_t pdrv, msc_host_device_handle_t device, const msc_host_device_info_t *info)
+{
+    MSC_OTA_CHECK(s_cache == NULL, "Cache already attached", ESP_ERR_INVALID_STATE);
+    MSC_OTA_CHECK(info->sector_size != 0 && MSC_CACHE_WINDOW_BYTES % info->sector_size == 0, "Unsupported sector size", ESP_ERR_NOT_SUPPORTED);
+
+    msc_host_cache_t *c = calloc(1, sizeof(msc_host_cache_t));
+    MSC_OTA_CHECK(c != NULL, "Failed to allocate memory for read-ahead cache", ESP_ERR_NO_MEM);
+    /* the window is only copied from, PSRAM is good enough when there is one */
+    c->window = heap_caps_malloc(MSC_CACHE_WINDOW_BYTES, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (c->window == NULL) {
+        c->window = heap_caps_malloc(MSC_CACHE_WINDOW_BYTES, MALLOC_CAP_8BIT);
+    }
+    if (c->window == NULL) {
+        free(c);
+        ESP_LOGW(TAG, "No memory for a %d KB read-ahead window, volume stays uncached", CONFIG_MSC_HOST_READ_AHEAD_KB);
+        return ESP_ERR_NO_MEM;
+    }
+    c->device = device;
+    c->sector_size = info->sector_size;
+    c->sector_count = info->sector_count;
+    c->window_sectors = MSC_CACHE_WINDOW_BYTES / info->sector_size;
+    c->next = UINT32_MAX;
+    s_cache = c;
+
+    static const ff_diskio_impl_t cache_impl = {
+        .init = &cache_disk_init,
+        .status = &cache_disk_status,
+        .read = &cache_disk_read,
+        .write = &cache_disk_write,
+        .ioctl = &cache_disk_ioctl,
+    };
+    ff_diskio_register(pdrv, &cache_impl);
+    ESP_LOGI(TAG, "Read-ahead %d KB on drive %u", CONFIG_MSC_HOST_READ_AHEAD_KB, pdrv);
+    return ESP_OK;
+}
+
+void esp_msc_host_cache_detach(void)
+{
+    msc_host_cache_t *c = s_cache;
+    if (c == NULL) {
+        return;
+    }
+    ESP_LOGD(TAG, "hits %"PRIu32", window fills %"PRIu32", direct reads %"PRIu32, c->hits, c->fills, c->direct);
+    s_cache = NULL;
+    free(c->window);
+    free(c);
+}
+
+#endif // CONFIG_MSC_HOST_READ_AHEAD
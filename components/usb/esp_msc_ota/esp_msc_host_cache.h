@@ -0,0 +1,44 @@
+/*
+ * SPDX-FileCopyrightText: 2023-2024 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "msc_host.h"
+
+/**
+ * @brief Put the read-ahead cache in front of the FAT volume of an MSC device
+ *
+ * Replaces the disk I/O driver of the drive with one that keeps a window of
+ * CONFIG_MSC_HOST_READ_AHEAD_KB. A read continuing where the previous one ended
+ * fills the whole window with one multi-sector read, later reads inside the window
+ * are served from memory. Reads elsewhere and reads as large as the window go
+ * straight to the device, writes go through and invalidate what they overlap.
+ *
+ * @note Call right after msc_host_vfs_register(), before the volume is used.
+ * @param[in] pdrv Drive number used by msc_host_vfs_register()
+ * @param[in] device MSC device handle
+ * @param[in] info Device info, for sector size and count
+ * @return esp_err_t
+ *         ESP_ERR_INVALID_STATE if a cache is already attached.
+ *         ESP_ERR_NO_MEM if the window can not be allocated, the volume keeps working uncached.
+ *         ESP_OK on success.
+ */
+esp_err_t esp_msc_host_cache_attach(uint8_t pdrv, msc_host_device_handle_t device, const msc_host_device_info_t *info);
+
+/**
+ * @brief Free the cache, call after msc_host_vfs_unregister()
+ */
+void esp_msc_host_cache_detach(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -7,6 +7,8 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/queue.h"
+#include "esp_heap_caps.h"
 #include "esp_vfs.h"
 #include "esp_msc_ota_help.h"
 #include "esp_msc_ota.h"
@@ -26,8 +28,21 @@ ESP_EVENT_DEFINE_BASE(ESP_MSC_OTA_EVENT);
 
 _Static_assert(DEFAULT_OTA_BUF_SIZE > (sizeof(esp_image_header_t) + sizeof(esp_image_segment_header_t) + sizeof(esp_app_desc_t) + 1), "OTA data buffer too small");
 
+/* Reads from the USB drive are rounded to whole FAT sectors */
+#define MSC_READ_ALIGN (512)
+#define MSC_OTA_BLOCK_NUM (2)
+#define MSC_OTA_READER_STACK (4096)
+#define MSC_OTA_READER_PRIORITY (5)
+#define MSC_OTA_BLOCK_TIMEOUT_MS (5000)
+
 /* Setting event group */
 #define MSC_CONNECT (1 << 0) // MSC device connect
+#define MSC_READER_DONE (1 << 1) // Reader task exited
+
+typedef struct {
+    int index;                   /*!< Buffer index, -1 asks the reader to stop */
+    int len;                     /*!< Bytes read, <= 0 on read error */
+} msc_ota_block_t;
 
 typedef struct {
     EventGroupHandle_t mscEventGroup;
@@ -41,6 +56,14 @@ typedef struct {
     FILE *file;
     uint32_t binary_file_len;
     uint32_t binary_file_read_len;
+    /* Read-ahead pipeline: the reader task fills one buffer from the drive while
+     * esp_msc_ota_perform() programs the other one */
+    char *block_buf[MSC_OTA_BLOCK_NUM];
+    size_t block_size;
+    QueueHandle_t free_queue;
+    QueueHandle_t full_queue;
+    TaskHandle_t reader_task;
+    uint32_t reader_offset;
 } esp_msc_ota_t;
 
 // Table to lookup ota event name
@@ -185,6 +208,88 @@ esp_err_t esp_msc_ota_get_img_desc(esp_msc_ota_handle_t handle, esp_app_desc_t *
     return ESP_OK;
 }
 
+static void _reader_task(void *arg)
+{
+    esp_msc_ota_t *msc_ota = (esp_msc_ota_t *)arg;
+    msc_ota_block_t block;
+
+    while (msc_ota->reader_offset < msc_ota->binary_file_len) {
+        if (xQueueReceive(msc_ota->free_queue, &block.index, portMAX_DELAY) != pdTRUE || block.index < 0) {
+            break;
+        }
+        uint32_t remaining = msc_ota->binary_file_len - msc_ota->reader_offset;
+        size_t read_len = remaining > msc_ota->block_size ? msc_ota->block_size : remaining;
+
+        block.len = -1;
+        if (xSemaphoreTake(msc_read_semaphore, pdMS_TO_TICKS(10)) == pdTRUE) {
+            block.len = fread(msc_ota->block_buf[block.index], 1, read_len, msc_ota->file);
+            xSemaphoreGive(msc_read_semaphore);
+        } else {
+            ESP_LOGE(TAG, "take msc_read_semaphore failed");
+        }
+        xQueueSend(msc_ota->full_queue, &block, portMAX_DELAY);
+        if (block.len <= 0) {
+            break;
+        }
+        msc_ota->reader_offset += block.len;
+    }
+
+    xEventGroupSetBits(msc_ota->mscEventGroup, MSC_READER_DONE);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t _reader_start(esp_msc_ota_t *msc_ota)
+{
+    FILE *file = fopen(msc_ota->ota_bin_path, "rb");
+    MSC_OTA_CHECK(file != NULL, "Failed to open file for reading", ESP_ERR_NOT_FOUND);
+    /* Block reads are already large, let fread go straight to the FAT driver */
+    setvbuf(file, NULL, _IONBF, 0);
+    fseek(file, msc_ota->binary_file_read_len, SEEK_SET);
+    msc_ota->file = file;
+    msc_ota->reader_offset = msc_ota->binary_file_read_len;
+
+    msc_ota->free_queue = xQueueCreate(MSC_OTA_BLOCK_NUM + 1, sizeof(int));
+    msc_ota->full_queue = xQueueCreate(MSC_OTA_BLOCK_NUM, sizeof(msc_ota_block_t));
+    MSC_OTA_CHECK(msc_ota->free_queue != NULL && msc_ota->full_queue != NULL, "Failed to create block queues", ESP_ERR_NO_MEM);
+    for (int i = 0; i < MSC_OTA_BLOCK_NUM; i++) {
+        xQueueSend(msc_ota->free_queue, &i, 0);
+    }
+
+    xEventGroupClearBits(msc_ota->mscEventGroup, MSC_READER_DONE);
+    BaseType_t ret = xTaskCreate(_reader_task, "msc_ota_reader", MSC_OTA_READER_STACK, msc_ota, MSC_OTA_READER_PRIORITY, &msc_ota->reader_task);
+    MSC_OTA_CHECK(ret == pdPASS, "Failed to create reader task", ESP_ERR_NO_MEM);
+    return ESP_OK;
+}
+
+/* Stop the reader (if running) and release everything the pipeline owns */
+static void _reader_stop(esp_msc_ota_t *msc_ota)
+{
+    if (msc_ota->reader_task) {
+        int stop = -1;
+        xQueueSend(msc_ota->free_queue, &stop, 0);
+        xEventGroupWaitBits(msc_ota->mscEventGroup, MSC_READER_DONE, pdFALSE, pdFALSE, portMAX_DELAY);
+        msc_ota->reader_task = NULL;
+    }
+    if (msc_ota->file) {
+        fclose(msc_ota->file);
+        msc_ota->file = NULL;
+    }
+    if (msc_ota->free_queue) {
+        vQueueDelete(msc_ota->free_queue);
+        msc_ota->free_queue = NULL;
+    }
+    if (msc_ota->full_queue) {
+        vQueueDelete(msc_ota->full_queue);
+        msc_ota->full_queue = NULL;
+    }
+    for (int i = 0; i < MSC_OTA_BLOCK_NUM; i++) {
+        if (msc_ota->block_buf[i] && msc_ota->block_buf[i] != msc_ota->ota_upgrade_buf) {
+            heap_caps_free(msc_ota->block_buf[i]);
+        }
+        msc_ota->block_buf[i] = NULL;
+    }
+}
+
 esp_err_t esp_msc_ota_begin(esp_msc_ota_config_t *config, esp_msc_ota_handle_t *handle)
 {
     esp_msc_ota_dispatch_event(ESP_MSC_OTA_START, NULL, 0);
@@ -215,10 +320,12 @@ esp_err_t esp_msc_ota_begin(esp_msc_ota_config_t *config, esp_msc_ota_handle_t *
     }
     msc_ota->ota_bin_path = config->ota_bin_path;
 
-    int alloc_size = MAX(config->buffer_size, DEFAULT_OTA_BUF_SIZE);
-    msc_ota->ota_upgrade_buf = (char *)malloc(alloc_size);
+    /* Whole sectors, so that every block read after the header stays sector aligned on the drive */
+    int alloc_size = MAX(config->buffer_size, DEFAULT_OTA_BUF_SIZE) & ~(MSC_READ_ALIGN - 1);
+    msc_ota->ota_upgrade_buf = (char *)heap_caps_aligned_alloc(4, alloc_size, MALLOC_CAP_DEFAULT);
     MSC_OTA_CHECK_GOTO(msc_ota->ota_upgrade_buf != NULL, "Failed to allocate memory for OTA buffer", msc_cleanup);
     msc_ota->ota_upgrade_buf_size = alloc_size;
+    msc_ota->block_size = alloc_size;
     msc_ota->bulk_flash_erase = config->bulk_flash_erase;
 
     *handle = (esp_msc_ota_handle_t)msc_ota;
@@ -270,27 +377,30 @@ esp_err_t esp_msc_ota_perform(esp_msc_ota_handle_t handle)
     case ESP_MSC_OTA_IN_PROGRESS: {
         EventBits_t bits = xEventGroupWaitBits(msc_ota->mscEventGroup, MSC_CONNECT, pdFALSE, pdFALSE, 0);
         MSC_OTA_CHECK(bits & MSC_CONNECT, "msc can't be disconnect", ESP_ERR_INVALID_STATE);
-        if (msc_ota->file == NULL) {
-
-            FILE *file = fopen(msc_ota->ota_bin_path, "rb");
-            MSC_OTA_CHECK(file != NULL, "Failed to open file for reading", ESP_ERR_NOT_FOUND);
-            fseek(file, msc_ota->binary_file_read_len, SEEK_CUR);
-            msc_ota->file = file;
+        if (msc_ota->reader_task == NULL) {
+            /* The header buffer is reused as the first block, the second one is only needed from here on */
+            msc_ota->block_buf[0] = msc_ota->ota_upgrade_buf;
+            msc_ota->block_buf[1] = (char *)heap_caps_aligned_alloc(4, msc_ota->block_size, MALLOC_CAP_DEFAULT);
+            MSC_OTA_CHECK(msc_ota->block_buf[1] != NULL, "Failed to allocate memory for OTA buffer", ESP_ERR_NO_MEM);
+            err = _reader_start(msc_ota);
+            if (err != ESP_OK) {
+                _reader_stop(msc_ota);
+                return err;
+            }
         }
         uint32_t *fileLength = &msc_ota->binary_file_read_len;
         uint32_t *totalLength = &msc_ota->binary_file_len;
         if (*fileLength < *totalLength) {
-            size_t readLength = *fileLength > msc_ota->ota_upgrade_buf_size ? msc_ota->ota_upgrade_buf_size : *fileLength;
-
-            BaseType_t ret = xSemaphoreTake(msc_read_semaphore, pdMS_TO_TICKS(10));
-            MSC_OTA_CHECK(ret == pdTRUE, "take msc_read_semaphore failed", ESP_FAIL);
-            data_read = fread(msc_ota->ota_upgrade_buf, 1, readLength, msc_ota->file);
-            xSemaphoreGive(msc_read_semaphore);
-
-            MSC_OTA_CHECK(data_read > 0, "Failed to read file", ESP_ERR_INVALID_SIZE);
-            err = esp_ota_write(msc_ota->update_handle, (const void *)msc_ota->ota_upgrade_buf, data_read);
+            msc_ota_block_t block;
+            BaseType_t ret = xQueueReceive(msc_ota->full_queue, &block, pdMS_TO_TICKS(MSC_OTA_BLOCK_TIMEOUT_MS));
+            MSC_OTA_CHECK(ret == pdTRUE, "Timeout reading file", ESP_ERR_TIMEOUT);
+            MSC_OTA_CHECK(block.len > 0, "Failed to read file", ESP_ERR_INVALID_SIZE);
+
+            /* The reader fetches the next block while this one is programmed */
+            err = esp_ota_write(msc_ota->update_handle, (const void *)msc_ota->block_buf[block.index], block.len);
+            xQueueSend(msc_ota->free_queue, &block.index, 0);
             MSC_OTA_CHECK(err == ESP_OK, "esp_ota_write failed", err);
-            *fileLength += data_read;
+            *fileLength += block.len;
             // report progress
             float progress = (float)(*fileLength) / (float)(*totalLength);
             progress = progress > 1.0 ? 1.0 : progress;
@@ -299,7 +409,7 @@ esp_err_t esp_msc_ota_perform(esp_msc_ota_handle_t handle)
         }
         if (*fileLength >= *totalLength) {
             msc_ota->status = ESP_MSC_OTA_SUCCESS;
-            fclose(msc_ota->file);
+            _reader_stop(msc_ota);
             return ESP_OK;
         }
         return ESP_OK;
@@ -321,8 +431,9 @@ esp_err_t esp_msc_ota_end(esp_msc_ota_handle_t handle)
     switch (msc_ota->status) {
     case ESP_MSC_OTA_SUCCESS:
     case ESP_MSC_OTA_IN_PROGRESS:
+        _reader_stop(msc_ota);
         if (msc_ota->ota_upgrade_buf) {
-            free(msc_ota->ota_upgrade_buf);
+            heap_caps_free(msc_ota->ota_upgrade_buf);
         }
         break;
     default:
@@ -352,14 +463,12 @@ esp_err_t esp_msc_ota_abort(esp_msc_ota_handle_t handle)
     switch (msc_ota->status) {
     case ESP_MSC_OTA_SUCCESS:
     case ESP_MSC_OTA_IN_PROGRESS:
-        if (msc_ota->file) {
-            fclose(msc_ota->file);
-        }
+        _reader_stop(msc_ota);
         err = esp_ota_abort(msc_ota->update_handle);
         [[fallthrough]];
     case ESP_MSC_OTA_BEGIN:
         if (msc_ota->ota_upgrade_buf) {
-            free(msc_ota->ota_upgrade_buf);
+            heap_caps_free(msc_ota->ota_upgrade_buf);
         }
         break;
     default:
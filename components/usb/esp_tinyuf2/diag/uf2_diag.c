@@ -0,0 +1,157 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/task.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "tusb.h"
+#include "esp_tinyuf2_diag.h"
+
+#define DIAG_ITF        0
+#define DIAG_HDR_LEN    6
+
+const static char* TAG = "TUF2_DIAG";
+
+static portMUX_TYPE _diag_mux = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t _diag_lock = NULL;
+static uint8_t _diag_seq = 0;
+static esp_tinyuf2_diag_rx_cb_t _diag_rx_cb = NULL;
+static void *_diag_rx_arg = NULL;
+
+bool esp_tinyuf2_diag_connected(void)
+{
+    return tud_cdc_n_connected(DIAG_ITF);
+}
+
+static SemaphoreHandle_t diag_lock_get(void)
+{
+    if (_diag_lock == NULL) {
+        SemaphoreHandle_t lock = xSemaphoreCreateMutex();
+        taskENTER_CRITICAL(&_diag_mux);
+        if (_diag_lock == NULL) {
+            _diag_lock = lock;
+            lock = NULL;
+        }
+        taskEXIT_CRITICAL(&_diag_mux);
+        if (lock) {
+            vSemaphoreDelete(lock);
+        }
+    }
+    return _diag_lock;
+}
+
+// Write everything into the FIFO, pushing it out and waiting for space while the host reads
+static bool diag_write(const uint8_t *data, size_t len, TickType_t deadline)
+{
+    while (len) {
+        uint32_t n = tud_cdc_n_write(DIAG_ITF, data, len);
+        data += n;
+        len -= n;
+        if (len == 0) {
+            break;
+        }
+        tud_cdc_n_write_flush(DIAG_ITF);
+        if (!tud_cdc_n_connected(DIAG_ITF) || (int32_t)(deadline - xTaskGetTickCount()) <= 0) {
+            return false;
+        }
+        vTaskDelay(1);
+    }
+    return true;
+}
+
+static esp_err_t diag_send_frame(uint8_t type, const void *data, size_t len, TickType_t timeout)
+{
+    if (len > ESP_TINYUF2_DIAG_PAYLOAD_MAX) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!tud_cdc_n_connected(DIAG_ITF)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    SemaphoreHandle_t lock = diag_lock_get();
+    if (lock == NULL) {
+        return ESP_ERR_NO_MEM;
+    }
+    TickType_t start = xTaskGetTickCount();
+    if (xSemaphoreTake(lock, timeout) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    TickType_t deadline = timeout == portMAX_DELAY ? start + (portMAX_DELAY >> 1) : start + timeout;
+
+    uint8_t hdr[DIAG_HDR_LEN] = {ESP_TINYUF2_DIAG_MAGIC0, ESP_TINYUF2_DIAG_MAGIC1, type, _diag_seq, len & 0xFF, len >> 8};
+    uint32_t crc = esp_rom_crc32_le(0, hdr + 2, DIAG_HDR_LEN - 2);
+    crc = esp_rom_crc32_le(crc, data, len);
+    uint8_t tail[4] = {crc & 0xFF, (crc >> 8) & 0xFF, (crc >> 16) & 0xFF, crc >> 24};
+    _diag_seq++;
+
+    bool ok = diag_write(hdr, sizeof(hdr), deadline)
+              && diag_write(data, len, deadline)
+              && diag_write(tail, sizeof(tail), deadline);
+    tud_cdc_n_write_flush(DIAG_ITF);
+    xSemaphoreGive(lock);
+    if (!ok) {
+        ESP_LOGD(TAG, "frame %u (%u bytes) incomplete", hdr[3], (unsigned)len);
+        return ESP_ERR_TIMEOUT;
+    }
+    return ESP_OK;
+}
+
+esp_err_t esp_tinyuf2_diag_send(uint8_t type, const void *data, size_t len, TickType_t timeout)
+{
+    if (data == NULL && len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return diag_send_frame(type, data, len, timeout);
+}
+
+esp_err_t esp_tinyuf2_diag_send_ringbuf(uint8_t type, RingbufHandle_t ring, size_t max_len, TickType_t timeout, size_t *sent)
+{
+    if (sent) {
+        *sent = 0;
+    }
+    if (ring == NULL || max_len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (max_len > ESP_TINYUF2_DIAG_PAYLOAD_MAX) {
+        max_len = ESP_TINYUF2_DIAG_PAYLOAD_MAX;
+    }
+    if (!tud_cdc_n_connected(DIAG_ITF)) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t len = 0;
+    void *item = xRingbufferReceiveUpTo(ring, &len, 0, max_len);
+    if (item == NULL) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    // the ring memory is held until the payload is in the USB FIFO
+    esp_err_t ret = diag_send_frame(type, item, len, timeout);
+    vRingbufferReturnItem(ring, item);
+    if (ret == ESP_OK && sent) {
+        *sent = len;
+    }
+    return ret;
+}
+
+void esp_tinyuf2_diag_register_rx_cb(esp_tinyuf2_diag_rx_cb_t cb, void *arg)
+{
+    taskENTER_CRITICAL(&_diag_mux);
+    _diag_rx_cb = cb;
+    _diag_rx_arg = arg;
+    taskEXIT_CRITICAL(&_diag_mux);
+}
+
+// Invoked when CDC interface received data from host
+void tud_cdc_rx_cb(uint8_t itf)
+{
+    uint8_t buf[CFG_TUD_CDC_RX_BUFSIZE];
+    while (tud_cdc_n_available(itf)) {
+        uint32_t n = tud_cdc_n_read(itf, buf, sizeof(buf));
+        if (_diag_rx_cb && n) {
+            _diag_rx_cb(buf, n, _diag_rx_arg);
+        }
+    }
+}
@@ -0,0 +1,104 @@
+/* SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _ESP_TINYUF2_DIAG_H_
+#define _ESP_TINYUF2_DIAG_H_
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/ringbuf.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Diagnostic channel (CONFIG_UF2_USB_DIAG): binary frames on the CDC interface "UF2 DIAG",
+ * independent of the log console. All multi-byte fields are little endian.
+ *
+ *   magic(2) 0xA5 0x5A | type(1) | seq(1) | len(2) | payload(len) | crc32(4)
+ *
+ * crc32 is esp_rom_crc32_le(0, ...) over type, seq, len and payload. seq counts frames
+ * sent, a gap tells the host a frame was dropped. A frame interrupted by a timeout is
+ * left incomplete on the wire, the host resynchronizes on the next magic with a valid crc.
+ */
+
+#define ESP_TINYUF2_DIAG_MAGIC0         0xA5
+#define ESP_TINYUF2_DIAG_MAGIC1         0x5A
+#define ESP_TINYUF2_DIAG_PAYLOAD_MAX    0xFFFF
+
+/**
+ * @brief Frame types, values from ESP_TINYUF2_DIAG_TYPE_USER are free for the application
+ *
+ */
+typedef enum {
+    ESP_TINYUF2_DIAG_TYPE_LOG = 0x01,       /*!< log text */
+    ESP_TINYUF2_DIAG_TYPE_TRACE = 0x02,     /*!< trace buffer */
+    ESP_TINYUF2_DIAG_TYPE_FRAME = 0x03,     /*!< raw data frame, e.g. an image */
+    ESP_TINYUF2_DIAG_TYPE_USER = 0x80,
+} esp_tinyuf2_diag_type_t;
+
+/**
+ * @brief callback for data received from the host, called in the USB task
+ *
+ */
+typedef void (*esp_tinyuf2_diag_rx_cb_t)(const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief If a host has opened the diagnostic channel
+ *
+ */
+bool esp_tinyuf2_diag_connected(void);
+
+/**
+ * @brief Send one frame, the payload is written straight into the USB FIFO
+ *
+ * Frames from several tasks are serialized, each frame is sent in one piece.
+ *
+ * @param type frame type
+ * @param data payload
+ * @param len payload length, at most ESP_TINYUF2_DIAG_PAYLOAD_MAX
+ * @param timeout ticks to wait for FIFO space
+ * @return
+ *      - ESP_OK: frame queued
+ *      - ESP_ERR_INVALID_SIZE: payload too large
+ *      - ESP_ERR_INVALID_STATE: no host connected, nothing sent
+ *      - ESP_ERR_TIMEOUT: the host did not read in time, the frame may be incomplete
+ */
+esp_err_t esp_tinyuf2_diag_send(uint8_t type, const void *data, size_t len, TickType_t timeout);
+
+/**
+ * @brief Send the data waiting in a byte ring buffer as one frame, without an intermediate copy
+ *
+ * Takes the contiguous bytes available (up to max_len) from a RINGBUF_TYPE_BYTEBUF ring buffer,
+ * writes them into the USB FIFO and returns them to the ring. Call repeatedly to drain a ring
+ * which has wrapped around.
+ *
+ * @param type frame type
+ * @param ring byte ring buffer, e.g. a trace or log ring
+ * @param max_len largest payload to take, at most ESP_TINYUF2_DIAG_PAYLOAD_MAX
+ * @param timeout ticks to wait for FIFO space
+ * @param[out] sent payload bytes sent, may be NULL
+ * @return
+ *      - ESP_OK: frame queued
+ *      - ESP_ERR_NOT_FOUND: ring buffer empty
+ *      - others: see esp_tinyuf2_diag_send
+ */
+esp_err_t esp_tinyuf2_diag_send_ringbuf(uint8_t type, RingbufHandle_t ring, size_t max_len, TickType_t timeout, size_t *sent);
+
+/**
+ * @brief Register the callback for data received from the host, NULL to drop received data
+ *
+ */
+void esp_tinyuf2_diag_register_rx_cb(esp_tinyuf2_diag_rx_cb_t cb, void *arg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ESP_TINYUF2_DIAG_H_ */
@@ -110,7 +110,7 @@ int32_t tud_msc_scsi_cb(uint8_t lun, uint8_t const scsi_cmd[16], void* buffer, u
 int32_t tud_msc_read10_cb(uint8_t lun, uint32_t lba, uint32_t offset, void* buffer, uint32_t bufsize)
 {
     (void) lun;
-    memset(buffer, 0, bufsize);
+    // uf2_read_block() fills every byte of each block
 
     // since we return block size each, offset should always be zero
     TU_ASSERT(offset == 0, -1);
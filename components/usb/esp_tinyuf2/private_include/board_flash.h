@@ -69,9 +69,11 @@
 // Size of the flash cache in bytes, used for buffering flash writes
 #define FLASH_CACHE_SIZE             (CONFIG_FLASH_CACHE_SIZE * 1024)
 #define FLASH_CACHE_INVALID_ADDR     0xffffffff
+// The cache is split into sector slots, each tracking which 256-byte UF2 payloads it holds
+#define FLASH_SECTOR_SIZE            4096
+#define FLASH_CHUNK_SIZE             256
+#define FLASH_CACHE_SLOTS            (FLASH_CACHE_SIZE / FLASH_SECTOR_SIZE)
 #define CFG_UF2_INI_FILE_SIZE        CONFIG_UF2_INI_FILE_SIZE
-extern char *_ini_file;
-extern char *_ini_file_dummy;
 
 //--------------------------------------------------------------------+
 // Basic API
@@ -95,8 +97,14 @@ void board_flash_deinit(void);
 void board_flash_nvs_init(const char *part_name, const char *namespace_name, nvs_modified_cb_t modified_cb);
 void board_flash_nvs_deinit(void);
 
-// Update DFU RAM to NVS
-void board_flash_nvs_update(const char *ini_str);
+// Size of the CONFIG.INI rendered from the NVS key table
+size_t board_flash_nvs_ini_size(void);
+
+// Read part of CONFIG.INI, bytes past its end are zero
+void board_flash_nvs_ini_read(uint32_t offset, void *buffer, uint32_t len);
+
+// Host wrote part of CONFIG.INI: store the keys whose value changed in NVS
+void board_flash_nvs_ini_write(uint32_t offset, const void *data, uint32_t len);
 
 // Get size of flash
 uint32_t board_flash_size(void);
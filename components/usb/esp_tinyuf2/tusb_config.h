@@ -99,7 +99,7 @@ extern "C" {
 #endif
 
 //------------- CLASS -------------//
-#ifdef CONFIG_ENABLE_UF2_USB_CONSOLE
+#if defined(CONFIG_ENABLE_UF2_USB_CONSOLE) || defined(CONFIG_UF2_USB_DIAG)
 #define CFG_TUD_CDC              1
 #else
 #define CFG_TUD_CDC              0
@@ -111,10 +111,19 @@ extern "C" {
 
 // CDC FIFO size of TX and RX
 #define CFG_TUD_CDC_RX_BUFSIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#ifdef CONFIG_UF2_USB_DIAG
+#define CFG_TUD_CDC_TX_BUFSIZE   CONFIG_UF2_USB_DIAG_TX_BUF_SIZE
+#else
 #define CFG_TUD_CDC_TX_BUFSIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
 
 // CDC Endpoint transfer buffer size, more is faster
+#ifdef CONFIG_UF2_USB_DIAG
+// several packets per transfer, the FIFO is refilled while one is on the bus
+#define CFG_TUD_CDC_EP_BUFSIZE   512
+#else
 #define CFG_TUD_CDC_EP_BUFSIZE   (TUD_OPT_HIGH_SPEED ? 512 : 64)
+#endif
 
 // MSC Buffer size of Device Mass storage
 #define CFG_TUD_MSC_EP_BUFSIZE   512
@@ -52,13 +52,30 @@
     printf("\n");\
   }while(0)
 
-static uint32_t _fl_addr = FLASH_CACHE_INVALID_ADDR;
+#define FLASH_CHUNKS_PER_SECTOR  (FLASH_SECTOR_SIZE / FLASH_CHUNK_SIZE)
+#define FLASH_CHUNKS_ALL         ((uint16_t)((1UL << FLASH_CHUNKS_PER_SECTOR) - 1))
+
+_Static_assert(FLASH_CHUNKS_PER_SECTOR <= 16, "chunk bitmap is 16 bits");
+
+// Write-back cache: one slot per flash sector. Blocks may arrive in any order,
+// a sector is only erased and programmed when all its chunks are in, on eviction
+// or on board_flash_flush()
+typedef struct {
+    uint32_t addr;      // sector address, FLASH_CACHE_INVALID_ADDR if the slot is free
+    uint32_t last_use;  // for LRU eviction
+    uint16_t valid;     // bitmap of chunks whose content in buf is current
+    uint8_t *buf;
+} flash_slot_t;
+
+static flash_slot_t _fl_slots[FLASH_CACHE_SLOTS];
+static uint32_t _fl_use_counter = 0;
 static uint8_t *_fl_buf = NULL;
+// Partition mapped into the data cache, reads of CURRENT.UF2 are a memcpy from it
+static const uint8_t *_fl_map = NULL;
+static esp_partition_mmap_handle_t _fl_map_handle;
 static bool _if_restart = false;
 static update_complete_cb_t _complete_cb = NULL;
 static esp_partition_t const* _part_ota = NULL;
-char *_ini_file = NULL;
-char *_ini_file_dummy = NULL;
 static nvs_modified_cb_t _modified_cb = NULL;
 static char _part_name[16] = "";
 static char _namespace_name[16] = "";
@@ -89,7 +106,6 @@ void board_dfu_complete(void)
 
 void board_flash_init(esp_partition_subtype_t subtype, const char *label, update_complete_cb_t complete_cb, bool if_restart)
 {
-    _fl_addr = FLASH_CACHE_INVALID_ADDR;
     _if_restart = if_restart;
     _complete_cb = complete_cb;
 
@@ -113,45 +129,152 @@ void board_flash_init(esp_partition_subtype_t subtype, const char *label, update
         PRINTFE("Can not allocate memory for flash cache");
         assert(0);
     }
+    for (int i = 0; i < FLASH_CACHE_SLOTS; i++) {
+        _fl_slots[i].addr = FLASH_CACHE_INVALID_ADDR;
+        _fl_slots[i].valid = 0;
+        _fl_slots[i].buf = _fl_buf + i * FLASH_SECTOR_SIZE;
+    }
+    // Not fatal, without free MMU pages reads fall back to esp_partition_read()
+    if (esp_partition_mmap(_part_ota, 0, _part_ota->size, ESP_PARTITION_MMAP_DATA,
+                           (const void **)&_fl_map, &_fl_map_handle) != ESP_OK) {
+        PRINTF("Can not mmap partition, read through esp_partition_read");
+        _fl_map = NULL;
+    }
 }
 
 void board_flash_deinit(void)
 {
+    if (_fl_map) {
+        esp_partition_munmap(_fl_map_handle);
+        _fl_map = NULL;
+    }
     if (_fl_buf) {
         free(_fl_buf);
         _fl_buf = NULL;
     }
+    for (int i = 0; i < FLASH_CACHE_SLOTS; i++) {
+        _fl_slots[i].addr = FLASH_CACHE_INVALID_ADDR;
+        _fl_slots[i].buf = NULL;
+    }
 }
 
-static void ini_insert_section(const char *section)
+// CONFIG.INI mirrors one NVS namespace of string entries. The entries are read once at init into
+// a key table (in NVS iteration order, with a hash index), reads of CONFIG.INI are rendered from
+// the table on demand and writes only store the keys whose value changed, with a single commit.
+typedef struct {
+    char key[NVS_KEY_NAME_MAX_SIZE];
+    char *value;
+    uint32_t hash;
+} ini_kv_t;
+
+#define INI_KEYS_MAX    CONFIG_UF2_INI_MAX_KEYS
+#define INI_HASH_SLOTS  (INI_KEYS_MAX * 2)
+#define INI_SLOT_EMPTY  0xFFFF
+
+static ini_kv_t *_ini_kv = NULL;
+static uint16_t *_ini_slots = NULL;     // hash index into _ini_kv
+static uint16_t _ini_kv_num = 0;
+static size_t _ini_size = 0;            // rendered size of CONFIG.INI
+// Sectors written by the host are collected here, created on the first write
+static char *_ini_stage = NULL;
+
+static uint32_t ini_hash(const char *key)
 {
-    if (section == NULL || _ini_file == NULL) {
-        return;
+    uint32_t h = 2166136261u;
+    for (const uint8_t *p = (const uint8_t *)key; *p; p++) {
+        h = (h ^ *p) * 16777619u;
     }
-    char *p = _ini_file;
-    while (*p != '\0') {
-        p++;
+    return h;
+}
+
+static uint16_t *ini_slot_of(const char *key, uint32_t hash)
+{
+    for (uint32_t i = 0; i < INI_HASH_SLOTS; i++) {
+        uint16_t *slot = &_ini_slots[(hash + i) % INI_HASH_SLOTS];
+        if (*slot == INI_SLOT_EMPTY) {
+            return slot;
+        }
+        ini_kv_t *kv = &_ini_kv[*slot];
+        if (kv->hash == hash && strcmp(kv->key, key) == 0) {
+            return slot;
+        }
     }
-    sprintf(p, "[%s]\r\n", section);
+    return NULL;    // not reached, the index is never more than half full
 }
 
-static void ini_insert_pair(const char *key, const char *value)
+static ini_kv_t *ini_kv_find(const char *key)
 {
-    if (key == NULL || value == NULL || _ini_file == NULL) {
-        return;
+    uint16_t *slot = ini_slot_of(key, ini_hash(key));
+    return (slot && *slot != INI_SLOT_EMPTY) ? &_ini_kv[*slot] : NULL;
+}
+
+// Insert or update a key, the value is copied
+static esp_err_t ini_kv_set(const char *key, const char *value)
+{
+    uint32_t hash = ini_hash(key);
+    uint16_t *slot = ini_slot_of(key, hash);
+    char *copy = strdup(value);
+    if (slot == NULL || copy == NULL) {
+        free(copy);
+        return ESP_ERR_NO_MEM;
+    }
+    if (*slot != INI_SLOT_EMPTY) {
+        free(_ini_kv[*slot].value);
+        _ini_kv[*slot].value = copy;
+        return ESP_OK;
     }
-    char *p = _ini_file;
-    while (*p != '\0') {
-        p++;
+    if (_ini_kv_num >= INI_KEYS_MAX) {
+        free(copy);
+        return ESP_ERR_NO_MEM;
     }
-    sprintf(p, "%s = %s\r\n", key, value);
+    ini_kv_t *kv = &_ini_kv[_ini_kv_num];
+    strlcpy(kv->key, key, sizeof(kv->key));
+    kv->value = copy;
+    kv->hash = hash;
+    *slot = _ini_kv_num++;
+    return ESP_OK;
 }
 
-static void ini_gen_from_nvs(const char *part, const char *name)
+typedef struct {
+    size_t pos;     // position in the rendered file
+    size_t offset;  // first byte wanted
+    char *out;      // NULL to only count
+    size_t len;
+} ini_render_t;
+
+static void ini_emit(ini_render_t *r, const char *str)
 {
-    if (part == NULL || name == NULL || _ini_file == NULL) {
-        return;
+    size_t n = strlen(str);
+    size_t end = r->offset + r->len;
+    if (r->out && r->pos + n > r->offset && r->pos < end) {
+        size_t from = r->offset > r->pos ? r->offset - r->pos : 0;
+        size_t to = end < r->pos + n ? end - r->pos : n;
+        memcpy(r->out + (r->pos + from - r->offset), str + from, to - from);
+    }
+    r->pos += n;
+}
+
+// Render bytes [offset, offset + len) of CONFIG.INI, returns the full file size
+static size_t ini_render(size_t offset, char *out, size_t len)
+{
+    ini_render_t r = { .pos = 0, .offset = offset, .out = out, .len = len };
+    if (_ini_kv_num == 0) {
+        return 0;
+    }
+    ini_emit(&r, "[");
+    ini_emit(&r, _namespace_name);
+    ini_emit(&r, "]\r\n");
+    for (uint16_t i = 0; i < _ini_kv_num; i++) {
+        ini_emit(&r, _ini_kv[i].key);
+        ini_emit(&r, " = ");
+        ini_emit(&r, _ini_kv[i].value);
+        ini_emit(&r, "\r\n");
     }
+    return r.pos;
+}
+
+static void ini_load_from_nvs(const char *part, const char *name)
+{
     nvs_iterator_t it = NULL;
     nvs_handle_t nvs = 0;
     esp_err_t result;
@@ -174,12 +297,11 @@ static void ini_gen_from_nvs(const char *part, const char *name)
     }
 #endif
 
-    ini_insert_section(name);
-
     result = nvs_open_from_partition(part, name, NVS_READONLY, &nvs);
     if (result != ESP_OK) {
         PRINTFE("NVS open error: %s", esp_err_to_name(result));
-        assert(0); //should not happen
+        nvs_release_iterator(it);
+        return;
     }
 
     do {
@@ -188,8 +310,10 @@ static void ini_gen_from_nvs(const char *part, const char *name)
         nvs_entry_info(it, &info);
         if ((result = nvs_get_str(nvs, info.key, NULL, &len)) == ESP_OK) {
             char *str = (char *)malloc(len);
-            if ((result = nvs_get_str(nvs, info.key, str, &len)) == ESP_OK) {
-                ini_insert_pair(info.key, str);
+            if (str && (result = nvs_get_str(nvs, info.key, str, &len)) == ESP_OK) {
+                if (ini_kv_set(info.key, str) != ESP_OK) {
+                    PRINTFE("Key table full, '%s' not in CONFIG.INI", info.key);
+                }
                 PRINTFD("Add namespace '%s', key '%s', value '%s' \n",
                         name, info.key, str);
             }
@@ -202,68 +326,146 @@ static void ini_gen_from_nvs(const char *part, const char *name)
         it = nvs_entry_next(it);
     } while (it != NULL);
 #endif
-    strcpy(_ini_file_dummy, _ini_file);
     nvs_close(nvs);
     nvs_release_iterator(it);
 }
 
-static int nvs_write_back(void* user, const char* section, const char* name,
+static void ini_update_size(void)
+{
+    _ini_size = ini_render(0, NULL, 0);
+    if (_ini_size >= CFG_UF2_INI_FILE_SIZE) {
+        // Longer files could not be edited back in place
+        PRINTFE("CONFIG.INI needs %u bytes, truncated to UF2_INI_FILE_SIZE", (unsigned)_ini_size);
+        _ini_size = CFG_UF2_INI_FILE_SIZE - 1;
+    }
+}
+
+typedef struct {
+    nvs_handle_t nvs;
+    uint16_t changed;
+} ini_apply_t;
+
+static int ini_apply_pair(void* user, const char* section, const char* name,
                           const char* value)
 {
-    nvs_handle_t nvs = (nvs_handle_t)user;
+    ini_apply_t *ctx = (ini_apply_t *)user;
     PRINTFD("... [%s]", section);
     PRINTFD("... (%s=%s)", name, value);
-    ESP_ERROR_CHECK(nvs_set_str(nvs, name, value));
-    ESP_ERROR_CHECK(nvs_commit(nvs));
+    ini_kv_t *kv = ini_kv_find(name);
+    if (kv && strcmp(kv->value, value) == 0) {
+        return 1;
+    }
+    if (strlen(name) >= NVS_KEY_NAME_MAX_SIZE) {
+        PRINTFE("Key '%s' too long for NVS", name);
+        return 1;
+    }
+    esp_err_t result = nvs_set_str(ctx->nvs, name, value);
+    if (result != ESP_OK) {
+        PRINTFE("NVS set '%s' error: %s", name, esp_err_to_name(result));
+        return 1;
+    }
+    if (ini_kv_set(name, value) != ESP_OK) {
+        PRINTFE("Key table full, '%s' stored but not in CONFIG.INI", name);
+    }
+    ctx->changed++;
     return 1;
 }
 
-static void ini_parse_to_nvs(const char *ini_str)
+// Parse the INI once and store only the changed keys, returns the number of keys written
+static uint16_t ini_apply(const char *ini_str)
 {
     //we currently only support string type
-    PRINTFD("ini_parse_to_nvs: \n%s", ini_str);
-    nvs_handle_t nvs = 0;
-    esp_err_t result = nvs_open_from_partition(_part_name, _namespace_name, NVS_READWRITE, &nvs);
+    PRINTFD("ini_apply: \n%s", ini_str);
+    ini_apply_t ctx = { 0 };
+    esp_err_t result = nvs_open_from_partition(_part_name, _namespace_name, NVS_READWRITE, &ctx.nvs);
     if (result != ESP_OK) {
         PRINTFE("NVS open error: %s", esp_err_to_name(result));
-        assert(0); //should not happen
+        return 0;
     }
-    ini_parse_string(ini_str, nvs_write_back, (void*)nvs);
-    nvs_close(nvs);
+    ini_parse_string(ini_str, ini_apply_pair, &ctx);
+    if (ctx.changed && (result = nvs_commit(ctx.nvs)) != ESP_OK) {
+        PRINTFE("NVS commit error: %s", esp_err_to_name(result));
+    }
+    nvs_close(ctx.nvs);
+    return ctx.changed;
 }
 
 void board_flash_nvs_init(const char *part_name, const char *namespace_name, nvs_modified_cb_t modified_cb)
 {
     _modified_cb = modified_cb;
-    strcpy(_namespace_name, namespace_name);
-    strcpy(_part_name, part_name);
-    if (_ini_file == NULL) {
-        //TODO: free when support deinit
-        _ini_file = (char *)calloc(1, CFG_UF2_INI_FILE_SIZE);
-        _ini_file_dummy = (char *)calloc(1, CFG_UF2_INI_FILE_SIZE);
-    }
-    ini_gen_from_nvs(part_name, namespace_name);
+    strlcpy(_namespace_name, namespace_name, sizeof(_namespace_name));
+    strlcpy(_part_name, part_name, sizeof(_part_name));
+    if (_ini_kv == NULL) {
+        _ini_kv = (ini_kv_t *)calloc(INI_KEYS_MAX, sizeof(ini_kv_t));
+        _ini_slots = (uint16_t *)malloc(INI_HASH_SLOTS * sizeof(uint16_t));
+        if (_ini_kv == NULL || _ini_slots == NULL) {
+            PRINTFE("No memory for the INI key table");
+            board_flash_nvs_deinit();
+            return;
+        }
+        memset(_ini_slots, 0xFF, INI_HASH_SLOTS * sizeof(uint16_t));
+    }
+    ini_load_from_nvs(part_name, namespace_name);
+    ini_update_size();
 }
 
 void board_flash_nvs_deinit(void)
 {
-    if (_ini_file) {
-        free(_ini_file);
-        _ini_file = NULL;
+    for (uint16_t i = 0; _ini_kv && i < _ini_kv_num; i++) {
+        free(_ini_kv[i].value);
     }
-    if (_ini_file_dummy) {
-        free(_ini_file_dummy);
-        _ini_file_dummy = NULL;
+    free(_ini_kv);
+    free(_ini_slots);
+    free(_ini_stage);
+    _ini_kv = NULL;
+    _ini_slots = NULL;
+    _ini_stage = NULL;
+    _ini_kv_num = 0;
+    _ini_size = 0;
+}
+
+size_t board_flash_nvs_ini_size(void)
+{
+    return _ini_kv ? _ini_size : 0;
+}
+
+void board_flash_nvs_ini_read(uint32_t offset, void *buffer, uint32_t len)
+{
+    memset(buffer, 0, len);
+    if (_ini_kv == NULL || offset >= _ini_size) {
+        return;
+    }
+    if (len > _ini_size - offset) {
+        len = _ini_size - offset;
     }
+    ini_render(offset, (char *)buffer, len);
 }
 
-void board_flash_nvs_update(const char *ini_str)
+void board_flash_nvs_ini_write(uint32_t offset, const void *data, uint32_t len)
 {
-    if (ini_str == NULL) {
-        PRINTFE("ini_str is NULL");
+    if (_ini_kv == NULL || offset >= CFG_UF2_INI_FILE_SIZE) {
         return;
     }
-    ini_parse_to_nvs(ini_str);
+    if (_ini_stage == NULL) {
+        // Start from the current file, the host may write only some of its sectors
+        _ini_stage = (char *)calloc(1, CFG_UF2_INI_FILE_SIZE + 1);
+        if (_ini_stage == NULL) {
+            PRINTFE("No memory for CONFIG.INI write");
+            return;
+        }
+        ini_render(0, _ini_stage, _ini_size);
+    }
+    if (len > CFG_UF2_INI_FILE_SIZE - offset) {
+        len = CFG_UF2_INI_FILE_SIZE - offset;
+    }
+    if (memcmp(_ini_stage + offset, data, len) == 0) {
+        return;
+    }
+    memcpy(_ini_stage + offset, data, len);
+    if (ini_apply(_ini_stage) == 0) {
+        return;
+    }
+    ini_update_size();
     if (_modified_cb) {
         _modified_cb();
     }
@@ -282,36 +484,99 @@ void board_flash_read(uint32_t addr, void* buffer, uint32_t len)
     if (_part_ota == NULL || buffer == NULL || len == 0) {
         return;
     }
-    esp_partition_read(_part_ota, addr, buffer, len);
+    if (_fl_map && addr + len <= _part_ota->size) {
+        memcpy(buffer, _fl_map + addr, len);
+    } else {
+        esp_partition_read(_part_ota, addr, buffer, len);
+    }
+
+    // Overlay chunks that are still waiting in the cache, so reads see the latest written data
+    for (int i = 0; i < FLASH_CACHE_SLOTS; i++) {
+        flash_slot_t const *slot = &_fl_slots[i];
+        if (slot->addr == FLASH_CACHE_INVALID_ADDR || slot->addr >= addr + len || slot->addr + FLASH_SECTOR_SIZE <= addr) {
+            continue;
+        }
+        for (uint32_t c = 0; c < FLASH_CHUNKS_PER_SECTOR; c++) {
+            uint32_t start = slot->addr + c * FLASH_CHUNK_SIZE;
+            uint32_t end = start + FLASH_CHUNK_SIZE;
+            if (!(slot->valid & (1 << c)) || start >= addr + len || end <= addr) {
+                continue;
+            }
+            start = start < addr ? addr : start;
+            end = end > addr + len ? addr + len : end;
+            memcpy((uint8_t *)buffer + (start - addr), slot->buf + (start - slot->addr), end - start);
+        }
+    }
 }
 
-void board_flash_flush(void)
+// Fill a chunk that was not written with the current flash content
+static void flash_slot_load_chunk(flash_slot_t *slot, uint32_t c)
 {
-    if (_fl_addr == FLASH_CACHE_INVALID_ADDR) {
+    if (!(slot->valid & (1 << c))) {
+        esp_partition_read(_part_ota, slot->addr + c * FLASH_CHUNK_SIZE, slot->buf + c * FLASH_CHUNK_SIZE, FLASH_CHUNK_SIZE);
+        slot->valid |= 1 << c;
+    }
+}
+
+static void flash_slot_flush(flash_slot_t *slot)
+{
+    if (slot->addr == FLASH_CACHE_INVALID_ADDR) {
         return;
     }
+    for (uint32_t c = 0; c < FLASH_CHUNKS_PER_SECTOR; c++) {
+        flash_slot_load_chunk(slot, c);
+    }
 
     // Check if contents already matched
     bool content_matches = true;
-    uint32_t const verify_sz = 4096;
-    uint8_t* verify_buf = malloc(verify_sz);
-
-    for (uint32_t count = 0; count < FLASH_CACHE_SIZE; count += verify_sz) {
-        board_flash_read(_fl_addr + count, verify_buf, verify_sz);
-        if (0 != memcmp(_fl_buf + count, verify_buf, verify_sz)) {
+    uint8_t verify_buf[FLASH_CHUNK_SIZE];
+    for (uint32_t count = 0; count < FLASH_SECTOR_SIZE; count += FLASH_CHUNK_SIZE) {
+        esp_partition_read(_part_ota, slot->addr + count, verify_buf, FLASH_CHUNK_SIZE);
+        if (0 != memcmp(slot->buf + count, verify_buf, FLASH_CHUNK_SIZE)) {
             content_matches = false;
             break;
         }
     }
-    free(verify_buf);
 
     // skip erase & write if content already matches
     if (!content_matches) {
-        esp_partition_erase_range(_part_ota, _fl_addr, FLASH_CACHE_SIZE);
-        esp_partition_write(_part_ota, _fl_addr, _fl_buf, FLASH_CACHE_SIZE);
+        esp_partition_erase_range(_part_ota, slot->addr, FLASH_SECTOR_SIZE);
+        esp_partition_write(_part_ota, slot->addr, slot->buf, FLASH_SECTOR_SIZE);
     }
 
-    _fl_addr = FLASH_CACHE_INVALID_ADDR;
+    slot->addr = FLASH_CACHE_INVALID_ADDR;
+    slot->valid = 0;
+}
+
+void board_flash_flush(void)
+{
+    for (int i = 0; i < FLASH_CACHE_SLOTS; i++) {
+        flash_slot_flush(&_fl_slots[i]);
+    }
+}
+
+// Find the slot caching sector_addr, or take a free one, evicting the least recently used if none
+static flash_slot_t *flash_slot_get(uint32_t sector_addr)
+{
+    flash_slot_t *victim = NULL;
+    for (int i = 0; i < FLASH_CACHE_SLOTS; i++) {
+        flash_slot_t *slot = &_fl_slots[i];
+        if (slot->addr == sector_addr) {
+            victim = slot;
+            break;
+        }
+        if (victim == NULL || (victim->addr != FLASH_CACHE_INVALID_ADDR &&
+                               (slot->addr == FLASH_CACHE_INVALID_ADDR || slot->last_use < victim->last_use))) {
+            victim = slot;
+        }
+    }
+    if (victim->addr != sector_addr) {
+        flash_slot_flush(victim);
+        victim->addr = sector_addr;
+        victim->valid = 0;
+    }
+    victim->last_use = ++_fl_use_counter;
+    return victim;
 }
 
 void board_flash_write(uint32_t addr, void const *data, uint32_t len)
@@ -319,17 +584,37 @@ void board_flash_write(uint32_t addr, void const *data, uint32_t len)
     if (_part_ota == NULL || data == NULL || len == 0) {
         return;
     }
-    // Align write address with size of cache
-    uint32_t new_addr = addr & ~(FLASH_CACHE_SIZE - 1);
+    uint8_t const *src = data;
+
+    while (len) {
+        uint32_t sector_addr = addr & ~(FLASH_SECTOR_SIZE - 1);
+        uint32_t offset = addr - sector_addr;
+        uint32_t n = FLASH_SECTOR_SIZE - offset;
+        if (n > len) {
+            n = len;
+        }
+        flash_slot_t *slot = flash_slot_get(sector_addr);
 
-    // New address comes, we need flush cache data to real flash
-    if (new_addr != _fl_addr) {
-        board_flash_flush();
+        uint32_t first = offset / FLASH_CHUNK_SIZE;
+        uint32_t last = (offset + n - 1) / FLASH_CHUNK_SIZE;
+        // A chunk only partly covered by this write keeps the rest of its flash content
+        if (offset % FLASH_CHUNK_SIZE) {
+            flash_slot_load_chunk(slot, first);
+        }
+        if ((offset + n) % FLASH_CHUNK_SIZE) {
+            flash_slot_load_chunk(slot, last);
+        }
+        memcpy(slot->buf + offset, src, n);
+        for (uint32_t c = first; c <= last; c++) {
+            slot->valid |= 1 << c;
+        }
 
-        _fl_addr = new_addr;
-        // cache origin data of new address, to prevent data loss
-        board_flash_read(new_addr, _fl_buf, FLASH_CACHE_SIZE);
+        // Whole sector received: program it now, no need to read it back first
+        if (slot->valid == FLASH_CHUNKS_ALL) {
+            flash_slot_flush(slot);
+        }
+        addr += n;
+        src += n;
+        len -= n;
     }
-    // write received date to cache
-    memcpy(_fl_buf + (addr & (FLASH_CACHE_SIZE - 1)), data, len);
 }
@@ -259,11 +259,12 @@ static void init_starting_clusters(void)
 static uint32_t info_index_of(uint32_t cluster)
 {
     // default results for invalid requests is the index of the last file (CURRENT.UF2)
-    if (cluster >= 0xFFF0) {
+    // CURRENT.UF2 is last and covers almost all clusters, check it first
+    if (cluster >= 0xFFF0 || cluster >= info[FID_UF2].cluster_start) {
         return FID_UF2;
     }
 
-    for (uint32_t i = 0; i < NUM_FILES; i++) {
+    for (uint32_t i = 0; i < FID_UF2; i++) {
         if ((info[i].cluster_start <= cluster) && (cluster <= info[i].cluster_end)) {
             return i;
         }
@@ -272,6 +273,132 @@ static uint32_t info_index_of(uint32_t cluster)
     return FID_UF2;
 }
 
+void padded_memcpy(char *dst, char const *src, int len)
+{
+    for (int i = 0; i < len; ++i) {
+        if (*src) {
+            *dst = *src++;
+        } else {
+            *dst = ' ';
+        }
+        dst++;
+    }
+}
+
+//--------------------------------------------------------------------+
+// Precomputed sectors
+//--------------------------------------------------------------------+
+
+// Hosts re-read the metadata on every mount and scan. The boot sector, the first FAT
+// sector and the first root directory sector are built once in uf2_init(); the other
+// FAT sectors are either plain (cluster + 1) chains or all zero.
+static uint8_t _boot_sector[BPB_SECTOR_SIZE];
+static uint8_t _fat_first_sector[BPB_SECTOR_SIZE];
+static uint8_t _root_dir_sector[BPB_SECTOR_SIZE];
+// FAT sectors from this one on only hold free (zero) entries
+static uint32_t _fat_used_sectors;
+// Header of every CURRENT.UF2 block, only blockNo and targetAddr differ
+static UF2_Block _uf2_block_template;
+
+static void build_fat_sector(uint32_t sectionRelativeSector, uint8_t *data)
+{
+    uint16_t* data16 = (uint16_t*)(void*) data;
+
+    uint32_t sectorFirstCluster = sectionRelativeSector * FAT_ENTRIES_PER_SECTOR;
+    uint32_t firstUnusedCluster = info[FID_UF2].cluster_end + 1;
+
+    // OPTIMIZATION:
+    // Because all files are contiguous, the FAT CHAIN entries
+    // are all set to (cluster+1) to point to the next cluster.
+    // All clusters past the last used cluster of the last file
+    // are set to zero.
+    //
+    // EXCEPTIONS:
+    // 1. Clusters 0 and 1 require special handling
+    // 2. Final cluster of each file must be set to END_OF_CHAIN
+    //
+
+    // Set default FAT values first.
+    for (uint16_t i = 0; i < FAT_ENTRIES_PER_SECTOR; i++) {
+        uint32_t cluster = i + sectorFirstCluster;
+        if (cluster >= firstUnusedCluster) {
+            data16[i] = 0;
+        } else {
+            data16[i] = cluster + 1;
+        }
+    }
+
+    // Exception #1: clusters 0 and 1 need special handling
+    if (sectionRelativeSector == 0) {
+        data[0] = BPB_MEDIA_DESCRIPTOR_BYTE;
+        data[1] = 0xff;
+        data16[1] = FAT_END_OF_CHAIN; // cluster 1 is reserved
+    }
+
+    // Exception #2: the final cluster of each file must be set to END_OF_CHAIN
+    for (uint32_t i = 0; i < NUM_FILES; i++) {
+        uint32_t lastClusterOfFile = info[i].cluster_end;
+        if (lastClusterOfFile >= sectorFirstCluster) {
+            uint32_t idx = lastClusterOfFile - sectorFirstCluster;
+            if (idx < FAT_ENTRIES_PER_SECTOR) {
+                // that last cluster of the file is in this sector
+                data16[idx] = FAT_END_OF_CHAIN;
+            }
+        }
+    }
+}
+
+// Root because not supporting subdirectories (yet), all entries fit in the first sector
+static void build_root_dir_sector(uint8_t *data)
+{
+    DirEntry *d = (void*) data;
+
+    // volume label is first directory entry
+    padded_memcpy(d->name, (char const*) BootBlock.VolumeLabel, 11);
+    d->attrs = 0x28;
+    d++;
+
+    for (uint32_t fileIndex = 0; fileIndex < NUM_FILES; fileIndex++, d++) {
+        // WARNING -- code presumes all files take exactly one directory entry (no long file names!)
+        uint32_t const startCluster = info[fileIndex].cluster_start;
+
+        FileContent_t const *inf = &info[fileIndex];
+        padded_memcpy(d->name, inf->name, 11);
+        d->createTimeFine   = COMPILE_SECONDS_INT % 2 * 100;
+        d->createTime       = COMPILE_DOS_TIME;
+        d->createDate       = COMPILE_DOS_DATE;
+        d->lastAccessDate   = COMPILE_DOS_DATE;
+        d->highStartCluster = startCluster >> 16;
+        d->updateTime       = COMPILE_DOS_TIME;
+        d->updateDate       = COMPILE_DOS_DATE;
+        d->startCluster     = startCluster & 0xFFFF;
+        d->size             = (inf->content || fileIndex == FID_INI) ? inf->size : (fileIndex == FID_UF2 ? UF2_BYTE_COUNT : 0);
+    }
+}
+
+static void build_sectors(void)
+{
+    memset(_boot_sector, 0, sizeof(_boot_sector));
+    memcpy(_boot_sector, &BootBlock, sizeof(BootBlock));
+    _boot_sector[510] = 0x55;    // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
+    _boot_sector[511] = 0xaa;    // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
+
+    build_fat_sector(0, _fat_first_sector);
+    _fat_used_sectors = UF2_DIV_CEIL(info[FID_UF2].cluster_end + 1, FAT_ENTRIES_PER_SECTOR);
+
+    memset(_root_dir_sector, 0, sizeof(_root_dir_sector));
+    build_root_dir_sector(_root_dir_sector);
+
+    memset(&_uf2_block_template, 0, sizeof(_uf2_block_template));
+    _uf2_block_template.magicStart0 = UF2_MAGIC_START0;
+    _uf2_block_template.magicStart1 = UF2_MAGIC_START1;
+    _uf2_block_template.magicEnd = UF2_MAGIC_END;
+    _uf2_block_template.numBlocks = UF2_SECTOR_COUNT;
+    _uf2_block_template.payloadSize = UF2_FIRMWARE_BYTES_PER_SECTOR;
+    _uf2_block_template.flags = UF2_FLAG_FAMILYID;
+    _uf2_block_template.familyID = BOARD_UF2_FAMILY_ID;
+}
+
 void uf2_init(void)
 {
     // TODO maybe limit to application size only if possible board_flash_app_size()
@@ -279,38 +406,22 @@ void uf2_init(void)
 
     // update CURRENT.UF2 file size
     info[FID_UF2].size = UF2_BYTE_COUNT;
-    if (_ini_file) {
-        info[FID_INI].content = _ini_file;
-        info[FID_INI].size = strlen(_ini_file);
-    }
+    // CONFIG.INI has no content buffer, its sectors are rendered from the NVS key table
+    info[FID_INI].size = board_flash_nvs_ini_size();
     init_starting_clusters();
+    build_sectors();
 }
 
 /*------------------------------------------------------------------*/
 /* Read CURRENT.UF2
  *------------------------------------------------------------------*/
-void padded_memcpy(char *dst, char const *src, int len)
-{
-    for (int i = 0; i < len; ++i) {
-        if (*src) {
-            *dst = *src++;
-        } else {
-            *dst = ' ';
-        }
-        dst++;
-    }
-}
-
 void uf2_read_block(uint32_t block_no, uint8_t *data)
 {
-    memset(data, 0, BPB_SECTOR_SIZE);
     uint32_t sectionRelativeSector = block_no;
 
     if (block_no == 0) {
         // Request was for the Boot block
-        memcpy(data, &BootBlock, sizeof(BootBlock));
-        data[510] = 0x55;    // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
-        data[511] = 0xaa;    // Always at offsets 510/511, even when BPB_SECTOR_SIZE is larger
+        memcpy(data, _boot_sector, BPB_SECTOR_SIZE);
     } else if (block_no < FS_START_ROOTDIR_SECTOR) {
         // Request was for a FAT table sector
         sectionRelativeSector -= FS_START_FAT0_SECTOR;
@@ -320,89 +431,21 @@ void uf2_read_block(uint32_t block_no, uint8_t *data)
             sectionRelativeSector -= BPB_SECTORS_PER_FAT;
         }
 
-        uint16_t* data16 = (uint16_t*)(void*) data;
-
-        uint32_t sectorFirstCluster = sectionRelativeSector * FAT_ENTRIES_PER_SECTOR;
-        uint32_t firstUnusedCluster = info[FID_UF2].cluster_end + 1;
-
-        // OPTIMIZATION:
-        // Because all files are contiguous, the FAT CHAIN entries
-        // are all set to (cluster+1) to point to the next cluster.
-        // All clusters past the last used cluster of the last file
-        // are set to zero.
-        //
-        // EXCEPTIONS:
-        // 1. Clusters 0 and 1 require special handling
-        // 2. Final cluster of each file must be set to END_OF_CHAIN
-        //
-
-        // Set default FAT values first.
-        for (uint16_t i = 0; i < FAT_ENTRIES_PER_SECTOR; i++) {
-            uint32_t cluster = i + sectorFirstCluster;
-            if (cluster >= firstUnusedCluster) {
-                data16[i] = 0;
-            } else {
-                data16[i] = cluster + 1;
-            }
-        }
-
-        // Exception #1: clusters 0 and 1 need special handling
         if (sectionRelativeSector == 0) {
-            data[0] = BPB_MEDIA_DESCRIPTOR_BYTE;
-            data[1] = 0xff;
-            data16[1] = FAT_END_OF_CHAIN; // cluster 1 is reserved
-        }
-
-        // Exception #2: the final cluster of each file must be set to END_OF_CHAIN
-        for (uint32_t i = 0; i < NUM_FILES; i++) {
-            uint32_t lastClusterOfFile = info[i].cluster_end;
-            if (lastClusterOfFile >= sectorFirstCluster) {
-                uint32_t idx = lastClusterOfFile - sectorFirstCluster;
-                if (idx < FAT_ENTRIES_PER_SECTOR) {
-                    // that last cluster of the file is in this sector
-                    data16[idx] = FAT_END_OF_CHAIN;
-                }
-            }
+            memcpy(data, _fat_first_sector, BPB_SECTOR_SIZE);
+        } else if (sectionRelativeSector >= _fat_used_sectors) {
+            memset(data, 0, BPB_SECTOR_SIZE);
+        } else {
+            build_fat_sector(sectionRelativeSector, data);
         }
     } else if (block_no < FS_START_CLUSTERS_SECTOR) {
-        // Request was for a (root) directory sector .. root because not supporting subdirectories (yet)
+        // Request was for a (root) directory sector
         sectionRelativeSector -= FS_START_ROOTDIR_SECTOR;
 
-        DirEntry *d = (void*) data;                   // pointer to next free DirEntry this sector
-        int remainingEntries = DIRENTRIES_PER_SECTOR; // remaining count of DirEntries this sector
-
-        uint32_t startingFileIndex;
-
         if (sectionRelativeSector == 0) {
-            // volume label is first directory entry
-            padded_memcpy(d->name, (char const*) BootBlock.VolumeLabel, 11);
-            d->attrs = 0x28;
-            d++;
-            remainingEntries--;
-
-            startingFileIndex = 0;
+            memcpy(data, _root_dir_sector, BPB_SECTOR_SIZE);
         } else {
-            // -1 to account for volume label in first sector
-            startingFileIndex = DIRENTRIES_PER_SECTOR * sectionRelativeSector - 1;
-        }
-
-        for (uint32_t fileIndex = startingFileIndex;
-                remainingEntries > 0 && fileIndex < NUM_FILES; // while space remains in buffer and more files to add...
-                fileIndex++, d++) {
-            // WARNING -- code presumes all files take exactly one directory entry (no long file names!)
-            uint32_t const startCluster = info[fileIndex].cluster_start;
-
-            FileContent_t const *inf = &info[fileIndex];
-            padded_memcpy(d->name, inf->name, 11);
-            d->createTimeFine   = COMPILE_SECONDS_INT % 2 * 100;
-            d->createTime       = COMPILE_DOS_TIME;
-            d->createDate       = COMPILE_DOS_DATE;
-            d->lastAccessDate   = COMPILE_DOS_DATE;
-            d->highStartCluster = startCluster >> 16;
-            d->updateTime       = COMPILE_DOS_TIME;
-            d->updateDate       = COMPILE_DOS_DATE;
-            d->startCluster     = startCluster & 0xFFFF;
-            d->size             = (inf->content ? inf->size : (fileIndex == FID_UF2 ? UF2_BYTE_COUNT : 0));
+            memset(data, 0, BPB_SECTOR_SIZE);
         }
     } else if (block_no < BPB_TOTAL_SECTORS) {
         // Request was to read from the data area (files, unused space, ...)
@@ -413,11 +456,23 @@ void uf2_read_block(uint32_t block_no, uint8_t *data)
         FileContent_t const * inf = &info[fid];
 
         uint32_t fileRelativeSector = sectionRelativeSector - (info[fid].cluster_start - 2) * BPB_SECTORS_PER_CLUSTER;
-
-        if (fid != FID_UF2) {
-            // Handle all files other than CURRENT.UF2
+        uint32_t addr = BOARD_FLASH_APP_START + (fileRelativeSector * UF2_FIRMWARE_BYTES_PER_SECTOR);
+
+        if (fid == FID_UF2 && addr < _flash_size) { // TODO abstract this out
+            // CURRENT.UF2: header from the template, payload read from flash straight into the block
+            UF2_Block *bl = (void*) data;
+            memcpy(bl, &_uf2_block_template, sizeof(UF2_Block));
+            bl->blockNo = fileRelativeSector;
+            bl->targetAddr = addr;
+
+            board_flash_read(addr, bl->data, bl->payloadSize);
+        } else if (fid == FID_INI) {
+            board_flash_nvs_ini_read(fileRelativeSector * BPB_SECTOR_SIZE, data, BPB_SECTOR_SIZE);
+        } else {
+            memset(data, 0, BPB_SECTOR_SIZE);
+            // Handle all files other than CURRENT.UF2 (and unused space past it)
             size_t fileContentStartOffset = fileRelativeSector * BPB_SECTOR_SIZE;
-            size_t fileContentLength = inf->size;
+            size_t fileContentLength = inf->content ? inf->size : 0;
 
             // nothing to copy if already past the end of the file (only when >1 sector per cluster)
             if (fileContentLength > fileContentStartOffset) {
@@ -431,24 +486,9 @@ void uf2_read_block(uint32_t block_no, uint8_t *data)
                 }
                 memcpy(data, dataStart, bytesToCopy);
             }
-        } else {
-            // CURRENT.UF2: generate data on-the-fly
-            uint32_t addr = BOARD_FLASH_APP_START + (fileRelativeSector * UF2_FIRMWARE_BYTES_PER_SECTOR);
-            if (addr < _flash_size) { // TODO abstract this out
-                UF2_Block *bl = (void*) data;
-                bl->magicStart0 = UF2_MAGIC_START0;
-                bl->magicStart1 = UF2_MAGIC_START1;
-                bl->magicEnd = UF2_MAGIC_END;
-                bl->blockNo = fileRelativeSector;
-                bl->numBlocks = UF2_SECTOR_COUNT;
-                bl->targetAddr = addr;
-                bl->payloadSize = UF2_FIRMWARE_BYTES_PER_SECTOR;
-                bl->flags = UF2_FLAG_FAMILYID;
-                bl->familyID = BOARD_UF2_FAMILY_ID;
-
-                board_flash_read(addr, bl->data, bl->payloadSize);
-            }
         }
+    } else {
+        memset(data, 0, BPB_SECTOR_SIZE);
     }
 }
 
@@ -484,28 +524,8 @@ int uf2_write_block(uint32_t block_no, uint8_t *data, WriteState *state)
             uint32_t fileRelativeSector = sectionRelativeSector - (info[fid].cluster_start - 2) * BPB_SECTORS_PER_CLUSTER;
 
             if (fid == FID_INI) {
-                // Handle all files other than CURRENT.UF2
-                size_t fileContentStartOffset = fileRelativeSector * BPB_SECTOR_SIZE;
-                size_t fileContentLength = CFG_UF2_INI_FILE_SIZE;
-
-                // nothing to copy if already past the end of the file (only when >1 sector per cluster)
-                if (fileContentLength > fileContentStartOffset) {
-                    // obviously, 2nd and later sectors should not copy data from the start
-                    void * dataStart = (char *)(_ini_file_dummy) + fileContentStartOffset;
-                    // limit number of bytes of data to be copied to remaining valid bytes
-                    size_t bytesToCopy = fileContentLength - fileContentStartOffset;
-                    // and further limit that to a single sector at a time
-                    if (bytesToCopy > BPB_SECTOR_SIZE) {
-                        bytesToCopy = BPB_SECTOR_SIZE;
-                    }
-                    memcpy(dataStart, data, bytesToCopy);
-                    if (strcmp(_ini_file_dummy, _ini_file + fileContentStartOffset)) {
-                        // printf("Modify ini:\n%s\n", data);
-                        strcpy(_ini_file + fileContentStartOffset, _ini_file_dummy);
-                        //TODO: handle if file longer than one block
-                        board_flash_nvs_update(_ini_file_dummy);
-                    }
-                }
+                // Only the keys whose value changed are written to NVS
+                board_flash_nvs_ini_write(fileRelativeSector * BPB_SECTOR_SIZE, data, BPB_SECTOR_SIZE);
             }
         }
         return -1;
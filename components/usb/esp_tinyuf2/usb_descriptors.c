@@ -62,8 +62,12 @@ uint8_t const * tud_descriptor_device_cb(void)
 // Configuration Descriptor
 //--------------------------------------------------------------------+
 
+#if defined(CONFIG_ENABLE_UF2_USB_CONSOLE) || defined(CONFIG_UF2_USB_DIAG)
+#define UF2_USB_CDC 1
+#endif
+
 enum {
-#ifdef CONFIG_ENABLE_UF2_USB_CONSOLE
+#ifdef UF2_USB_CDC
     ITF_NUM_CDC = 0,
     ITF_NUM_CDC_DATA,
 #endif
@@ -75,7 +79,7 @@ enum {
 
 #define EPNUM_MSC_OUT     0x01
 #define EPNUM_MSC_IN      0x81
-#ifdef CONFIG_ENABLE_UF2_USB_CONSOLE
+#ifdef UF2_USB_CDC
 #define EPNUM_CDC_NOTIF   0x84
 #define EPNUM_CDC_OUT     0x02
 #define EPNUM_CDC_IN      0x83
@@ -86,7 +90,7 @@ enum {
 uint8_t const desc_fs_configuration[] = {
     // Config number, interface count, string index, total length, attribute, power in mA
     TUD_CONFIG_DESCRIPTOR(1, ITF_NUM_TOTAL, 0, CONFIG_TOTAL_LEN, 0x00, 100),
-#ifdef CONFIG_ENABLE_UF2_USB_CONSOLE
+#ifdef UF2_USB_CDC
     // Interface number, string index, EP notification address and size, EP data address (out, in) and size.
     TUD_CDC_DESCRIPTOR(ITF_NUM_CDC, 4, EPNUM_CDC_NOTIF, 8, EPNUM_CDC_OUT, EPNUM_CDC_IN, 64),
 #endif
@@ -113,7 +117,11 @@ char const* string_desc_arr [] = {
     CONFIG_TUSB_MANUFACTURER,                  // 1: Manufacturer
     CONFIG_TUSB_PRODUCT,                       // 2: Product
     CONFIG_UF2_SERIAL_NUM,                     // 3: Serials, should use chip ID
+#ifdef CONFIG_UF2_USB_DIAG
+    "UF2 DIAG",                                // 4: CDC Interface, diagnostic channel
+#else
     "UF2 CDC",                                 // 4: CDC Interface
+#endif
     "UF2 MSC",                                 // 5: MSC Interface
 };
 
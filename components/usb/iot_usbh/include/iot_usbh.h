@@ -142,6 +142,46 @@ esp_err_t iot_usbh_port_stop(usbh_port_handle_t port_hdl);
  */
 usbh_pipe_handle_t iot_usbh_pipe_init(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, QueueHandle_t queue_hdl, void *context);
 
+/**
+ * It allocates a pipe whose events are delivered through a lock-free single producer single consumer ring
+ * instead of a FreeRTOS queue, no event message is copied and the consumer is only woken when it sleeps.
+ *
+ * Only one task may read the events of the pipe, by iot_usbh_pipe_ring_get. Events are not sent to the port
+ * queue or event callback. If the ring is full, the event is dropped and counted.
+ *
+ * @param port_hdl the handle of the USB port
+ * @param ep_desc the endpoint descriptor of the pipe. If it is NULL, the pipe is the default pipe.
+ * @param ring_len number of events the ring can hold, power of 2 in [2, 256]. At least the number of URBs
+ *                 enqueued on the pipe is suggested.
+ * @param context The context parameter is passed to the HCD layer. It is used to store the context of the pipe.
+ *
+ * @return pointer to a pipe instance.
+ */
+usbh_pipe_handle_t iot_usbh_pipe_init_ring(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, size_t ring_len, void *context);
+
+/**
+ * It takes the next event of a pipe created by iot_usbh_pipe_init_ring
+ *
+ * @param pipe_hdl the pipe handle returned by iot_usbh_pipe_init_ring
+ * @param pipe_event the event taken
+ * @param xTicksToWait the maximum time to wait for an event
+ *
+ * @return
+ *     - ESP_OK: got an event
+ *     - ESP_ERR_TIMEOUT: no event in time
+ *     - ESP_ERR_INVALID_STATE: the pipe has no ring
+ */
+esp_err_t iot_usbh_pipe_ring_get(usbh_pipe_handle_t pipe_hdl, usbh_pipe_event_t *pipe_event, TickType_t xTicksToWait);
+
+/**
+ * It returns the number of events dropped because the ring of the pipe was full
+ *
+ * @param pipe_hdl the pipe handle returned by iot_usbh_pipe_init_ring
+ *
+ * @return number of dropped events, 0 if the pipe has no ring
+ */
+uint32_t iot_usbh_pipe_ring_dropped(usbh_pipe_handle_t pipe_hdl);
+
 /**
  * It deinitialize a pipe, call iot_usbh_pipe_flush first before deinit
  *
@@ -174,6 +214,9 @@ esp_err_t iot_usbh_pipe_flush(usbh_pipe_handle_t pipe_hdl, size_t urb_num);
  * It allocates a URB and its underlying transfer structure, and then initializes the transfer
  * structure
  *
+ * With CONFIG_USBH_URB_POOL, a non-isoc URB is taken from the smallest pool class that fits
+ * without any heap call, its data buffer is not cleared. Heap is used when no pool URB is free.
+ *
  * @param num_isoc_packets Number of isochronous packets in the URB.
  * @param packet_data_buffer_size The size of the data buffer for each packet.
  * @param context This is a pointer to a context structure that will be passed back to the callback
@@ -184,7 +227,7 @@ esp_err_t iot_usbh_pipe_flush(usbh_pipe_handle_t pipe_hdl, size_t urb_num);
 iot_usbh_urb_handle_t iot_usbh_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void *context);
 
 /**
- * It frees the memory allocated for the URB
+ * It frees the memory allocated for the URB, or returns it to the pool
  *
  * @param urb_hdl The URB to be freed.
  * @return esp_err_t
@@ -119,8 +119,26 @@ typedef struct {
     const usb_ep_desc_t *ep_desc;               /*!< endpoint descriptor using for pipe create */
     hcd_pipe_handle_t pipe_handle;              /*!< handle of the pipe */
     QueueHandle_t queue_handle;                 /*!< queue handle using for event transmit */
+    struct _usbh_pipe_ring *ring;               /*!< completion ring, NULL if events go to queue_handle */
 } _usbh_pipe_t;
 
+/**
+ * @brief Single producer single consumer ring of pipe events.
+ *
+ * The producer is the pipe callback, the consumer is the one task calling iot_usbh_pipe_ring_get.
+ * Indexes are free running, each side only writes its own index, so no lock is needed.
+ * The doorbell is only given when the consumer is asleep.
+ */
+typedef struct _usbh_pipe_ring {
+    volatile uint32_t head;                     /*!< next slot to write, written by producer only */
+    volatile uint32_t tail;                     /*!< next slot to read, written by consumer only */
+    volatile uint32_t waiting;                  /*!< consumer is blocked on the doorbell */
+    uint32_t mask;                              /*!< ring length - 1, length is a power of 2 */
+    uint32_t dropped;                           /*!< events dropped because the ring was full */
+    SemaphoreHandle_t doorbell;                 /*!< wake up the consumer */
+    uint8_t events[];                           /*!< usbh_pipe_event_t */
+} _usbh_pipe_ring_t;
+
 static usbh_port_event_t _port_event_dflt_process(usbh_port_handle_t port_hdl)
 {
     _usbh_port_t *port_instance = (_usbh_port_t *)port_hdl;
@@ -299,6 +317,8 @@ static esp_err_t _usbh_port_get_speed(hcd_port_handle_t port_hdl, usb_speed_t *p
 }
 
 static void _usbh_processing_task(void *arg);
+static esp_err_t _usbh_urb_pool_init(void);
+static void _usbh_urb_pool_deinit(void);
 /**
  * @brief Initialize USB port and default pipe
  *
@@ -317,6 +337,7 @@ usbh_port_handle_t iot_usbh_port_init(usbh_port_config_t *config)
     esp_err_t ret = ESP_OK;
     _usbh_port_t *port_instance = calloc(1, sizeof(_usbh_port_t));
     ERR_CHECK(port_instance != NULL, "calloc failed", NULL);
+    ERR_CHECK_GOTO(_usbh_urb_pool_init() == ESP_OK, "urb pool init failed", pool_init_err);
     port_instance->queue_handle = xQueueCreate(config->queue_length, sizeof(usbh_event_msg_t));
     ERR_CHECK(port_instance->queue_handle != NULL, "queue create failed", NULL);
     port_instance->evt_group_handle = xEventGroupCreate();
@@ -372,6 +393,8 @@ port_init_err:
 hcd_init_err:
     vQueueDelete(port_instance->queue_handle);
     usb_del_phy(port_instance->phy_handle);
+    _usbh_urb_pool_deinit();
+pool_init_err:
     free(port_instance);
     return NULL;
 }
@@ -438,6 +461,7 @@ esp_err_t iot_usbh_port_deinit(usbh_port_handle_t port_hdl)
     }
     vQueueDelete(port_instance->queue_handle);
     vEventGroupDelete(port_instance->evt_group_handle);
+    _usbh_urb_pool_deinit();
     ESP_LOGI(TAG, "USB Port=%d deinit succeed", port_instance->port_num);
     free(port_instance);
     _usbh_update_state(USBH_STATE_NONE);
@@ -454,6 +478,57 @@ void *iot_usbh_port_get_context(usbh_port_handle_t port_hdl)
 
 /************************************************** USB Host PIPE API **************************************************/
 
+static bool IRAM_ATTR _usbh_pipe_ring_put(_usbh_pipe_ring_t *ring, usbh_pipe_event_t pipe_event, bool in_isr)
+{
+    uint32_t head = ring->head;
+    if (head - __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE) > ring->mask) {
+        ring->dropped++;
+        return false;
+    }
+    ring->events[head & ring->mask] = (uint8_t)pipe_event;
+    // pairs with the consumer announcing its sleep, both sides need a full barrier
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_SEQ_CST);
+    if (!__atomic_load_n(&ring->waiting, __ATOMIC_SEQ_CST)) {
+        return false;
+    }
+    if (in_isr) {
+        BaseType_t xTaskWoken = pdFALSE;
+        xSemaphoreGiveFromISR(ring->doorbell, &xTaskWoken);
+        return (xTaskWoken == pdTRUE);
+    }
+    xSemaphoreGive(ring->doorbell);
+    return false;
+}
+
+static bool _usbh_pipe_ring_pop(_usbh_pipe_ring_t *ring, usbh_pipe_event_t *pipe_event)
+{
+    uint32_t tail = ring->tail;
+    if (__atomic_load_n(&ring->head, __ATOMIC_SEQ_CST) == tail) {
+        return false;
+    }
+    *pipe_event = (usbh_pipe_event_t)ring->events[tail & ring->mask];
+    __atomic_store_n(&ring->tail, tail + 1, __ATOMIC_RELEASE);
+    return true;
+}
+
+static esp_err_t _usbh_pipe_ring_wait(_usbh_pipe_ring_t *ring, usbh_pipe_event_t *pipe_event, TickType_t xTicksToWait)
+{
+    while (!_usbh_pipe_ring_pop(ring, pipe_event)) {
+        // announce the sleep first, then check again, so an event put in between is not missed
+        __atomic_store_n(&ring->waiting, 1, __ATOMIC_SEQ_CST);
+        if (_usbh_pipe_ring_pop(ring, pipe_event)) {
+            __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELEASE);
+            break;
+        }
+        BaseType_t got = xSemaphoreTake(ring->doorbell, xTicksToWait);
+        __atomic_store_n(&ring->waiting, 0, __ATOMIC_RELEASE);
+        if (got != pdTRUE) {
+            return _usbh_pipe_ring_pop(ring, pipe_event) ? ESP_OK : ESP_ERR_TIMEOUT;
+        }
+    }
+    return ESP_OK;
+}
+
 /**
  * @brief HCD pipe callback. Registered when allocating a HCD pipe
  *
@@ -467,6 +542,9 @@ void *iot_usbh_port_get_context(usbh_port_handle_t port_hdl)
 static bool IRAM_ATTR _usbh_pipe_callback(hcd_pipe_handle_t pipe_handle, hcd_pipe_event_t pipe_event, void *user_arg, bool in_isr)
 {
     _usbh_pipe_t *pipe_instance = (_usbh_pipe_t *)user_arg;
+    if (pipe_instance->ring) {
+        return _usbh_pipe_ring_put(pipe_instance->ring, (usbh_pipe_event_t)pipe_event, in_isr);
+    }
     QueueHandle_t pipe_event_queue = pipe_instance->queue_handle;
     usbh_event_msg_t event_msg = {
         ._type = PIPE_EVENT,
@@ -490,6 +568,15 @@ static esp_err_t iot_usbh_pipe_event_wait(usbh_pipe_handle_t pipe_hdl,
     //Wait for pipe callback to send an event message
     ERR_CHECK(pipe_hdl != NULL, "invalid args", ESP_ERR_INVALID_ARG);
     _usbh_pipe_t *pipe_instance = (_usbh_pipe_t *)pipe_hdl;
+    if (pipe_instance->ring) {
+        usbh_pipe_event_t pipe_event;
+        esp_err_t ret = _usbh_pipe_ring_wait(pipe_instance->ring, &pipe_event, xTicksToWait);
+        if (ret != ESP_OK) {
+            return ESP_ERR_NOT_FOUND;
+        }
+        _pipe_event_dflt_process(pipe_hdl, pipe_event);
+        return pipe_event == expected_event ? ESP_OK : ESP_ERR_INVALID_RESPONSE;
+    }
     QueueHandle_t pipe_evt_queue = pipe_instance->queue_handle;
     assert(pipe_evt_queue != NULL);
     esp_err_t ret = ESP_ERR_NOT_FOUND;
@@ -519,13 +606,31 @@ static esp_err_t iot_usbh_pipe_event_wait(usbh_pipe_handle_t pipe_hdl,
     return ret;
 }
 
-usbh_pipe_handle_t iot_usbh_pipe_init(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, QueueHandle_t queue_hdl, void *context)
+static void _usbh_pipe_ring_free(_usbh_pipe_ring_t *ring)
+{
+    if (ring) {
+        if (ring->doorbell) {
+            vSemaphoreDelete(ring->doorbell);
+        }
+        heap_caps_free(ring);
+    }
+}
+
+static usbh_pipe_handle_t _usbh_pipe_create(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, QueueHandle_t queue_hdl,
+                                            size_t ring_len, void *context)
 {
     ERR_CHECK(port_hdl != NULL, "invalid args", NULL);
     ERR_CHECK(_usbh_get_state() >= USBH_STATE_DEVICE_DEFAULT, "invalid usb state", NULL);
     _usbh_port_t *port_instance = (_usbh_port_t *)port_hdl;
     _usbh_pipe_t *pipe_instance = (_usbh_pipe_t *)calloc(1, sizeof(_usbh_pipe_t));
     ERR_CHECK(pipe_instance != NULL, "calloc failed", NULL);
+    if (ring_len) {
+        pipe_instance->ring = (_usbh_pipe_ring_t *)heap_caps_calloc(1, sizeof(_usbh_pipe_ring_t) + ring_len, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+        ERR_CHECK_GOTO(pipe_instance->ring != NULL, "ring alloc failed", pipe_init_err);
+        pipe_instance->ring->mask = ring_len - 1;
+        pipe_instance->ring->doorbell = xSemaphoreCreateBinary();
+        ERR_CHECK_GOTO(pipe_instance->ring->doorbell != NULL, "doorbell create failed", pipe_init_err);
+    }
     uint8_t dev_addr = port_instance->dev_addr;
 
     if (ep_desc) {
@@ -554,13 +659,44 @@ usbh_pipe_handle_t iot_usbh_pipe_init(usbh_port_handle_t port_hdl, const usb_ep_
         .dev_speed = port_instance->dev_speed,
     };
     // Pipe context is queue handle by default
-    if (context == NULL) {
+    if (context == NULL && pipe_instance->ring == NULL) {
         pipe_cfg.context = (void *)pipe_instance->queue_handle;
     }
     esp_err_t ret = hcd_pipe_alloc(port_instance->port_handle, &pipe_cfg, &pipe_instance->pipe_handle);
-    ERR_CHECK(ESP_OK == ret, "pipe alloc failed", NULL);
-    ESP_LOGI(TAG, "Pipe init succeed, addr: %02X", pipe_instance->ep_addr);
+    ERR_CHECK_GOTO(ESP_OK == ret, "pipe alloc failed", pipe_init_err);
+    ESP_LOGI(TAG, "Pipe init succeed, addr: %02X%s", pipe_instance->ep_addr, pipe_instance->ring ? ", ring" : "");
     return pipe_instance;
+
+pipe_init_err:
+    _usbh_pipe_ring_free(pipe_instance->ring);
+    free(pipe_instance);
+    return NULL;
+}
+
+usbh_pipe_handle_t iot_usbh_pipe_init(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, QueueHandle_t queue_hdl, void *context)
+{
+    return _usbh_pipe_create(port_hdl, ep_desc, queue_hdl, 0, context);
+}
+
+usbh_pipe_handle_t iot_usbh_pipe_init_ring(usbh_port_handle_t port_hdl, const usb_ep_desc_t *ep_desc, size_t ring_len, void *context)
+{
+    ERR_CHECK(ring_len >= 2 && ring_len <= 256 && (ring_len & (ring_len - 1)) == 0, "ring_len must be a power of 2 in [2, 256]", NULL);
+    return _usbh_pipe_create(port_hdl, ep_desc, NULL, ring_len, context);
+}
+
+esp_err_t iot_usbh_pipe_ring_get(usbh_pipe_handle_t pipe_hdl, usbh_pipe_event_t *pipe_event, TickType_t xTicksToWait)
+{
+    ERR_CHECK(pipe_hdl != NULL && pipe_event != NULL, "invalid args", ESP_ERR_INVALID_ARG);
+    _usbh_pipe_t *pipe_instance = (_usbh_pipe_t *)pipe_hdl;
+    ERR_CHECK(pipe_instance->ring != NULL, "pipe has no ring", ESP_ERR_INVALID_STATE);
+    return _usbh_pipe_ring_wait(pipe_instance->ring, pipe_event, xTicksToWait);
+}
+
+uint32_t iot_usbh_pipe_ring_dropped(usbh_pipe_handle_t pipe_hdl)
+{
+    ERR_CHECK(pipe_hdl != NULL, "invalid args", 0);
+    _usbh_pipe_t *pipe_instance = (_usbh_pipe_t *)pipe_hdl;
+    return pipe_instance->ring ? pipe_instance->ring->dropped : 0;
 }
 
 static esp_err_t iot_usbh_pipe_command(usbh_pipe_handle_t pipe_hdl, hcd_pipe_cmd_t command)
@@ -588,6 +724,7 @@ esp_err_t iot_usbh_pipe_deinit(usbh_pipe_handle_t pipe_hdl)
         ESP_LOGW(TAG, "pipe=%p free failed", pipe_hdl);
     }
     ESP_LOGI(TAG, "Pipe deinit succeed, addr: %02X", pipe_instance->ep_addr);
+    _usbh_pipe_ring_free(pipe_instance->ring);
     free(pipe_instance);
     return ret;
 }
@@ -634,8 +771,157 @@ esp_err_t iot_usbh_pipe_flush(usbh_pipe_handle_t pipe_hdl, size_t urb_num)
 }
 
 /*------------------------------------------------ USB URB Code ----------------------------------------------------*/
+#ifdef CONFIG_USBH_URB_POOL
+/**
+ * @brief Preallocated URBs of one buffer size class.
+ *
+ * URBs and their DMA buffers are allocated once at port init, alloc/free only
+ * pop/push an index on the free stack.
+ */
+typedef struct {
+    size_t buffer_size;                         /*!< data buffer size of each URB */
+    size_t num;                                 /*!< number of URBs */
+    size_t free_num;                            /*!< number of entries on the free stack */
+    urb_t *urbs;                                /*!< URB array */
+    uint8_t *buffers;                           /*!< DMA buffers, num * buffer_size */
+    uint8_t *free_stack;                        /*!< indexes of free URBs */
+} _usbh_urb_class_t;
+
+static _usbh_urb_class_t s_urb_pool[] = {
+    { .buffer_size = sizeof(usb_setup_packet_t) + CTRL_TRANSFER_DATA_MAX_BYTES, .num = CONFIG_USBH_URB_POOL_CTRL_NUM },
+    { .buffer_size = CONFIG_USBH_URB_POOL_DATA_SIZE, .num = CONFIG_USBH_URB_POOL_DATA_NUM },
+};
+#define USBH_URB_POOL_CLASS_NUM (sizeof(s_urb_pool) / sizeof(s_urb_pool[0]))
+static portMUX_TYPE s_urb_pool_lock = portMUX_INITIALIZER_UNLOCKED;
+static bool s_urb_pool_ready = false;
+
+static void _usbh_urb_pool_release(void)
+{
+    for (size_t i = 0; i < USBH_URB_POOL_CLASS_NUM; i++) {
+        _usbh_urb_class_t *cls = &s_urb_pool[i];
+        heap_caps_free(cls->urbs);
+        heap_caps_free(cls->buffers);
+        heap_caps_free(cls->free_stack);
+        cls->urbs = NULL;
+        cls->buffers = NULL;
+        cls->free_stack = NULL;
+        cls->free_num = 0;
+    }
+    s_urb_pool_ready = false;
+}
+
+static esp_err_t _usbh_urb_pool_init(void)
+{
+    if (s_urb_pool_ready) {
+        // kept from a previous port, some URBs were not returned at deinit
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < USBH_URB_POOL_CLASS_NUM; i++) {
+        _usbh_urb_class_t *cls = &s_urb_pool[i];
+        if (cls->num == 0) {
+            continue;
+        }
+        cls->urbs = heap_caps_calloc(cls->num, sizeof(urb_t), MALLOC_CAP_DEFAULT);
+        cls->buffers = heap_caps_calloc(cls->num, cls->buffer_size, MALLOC_CAP_DMA);
+        cls->free_stack = heap_caps_malloc(cls->num, MALLOC_CAP_DEFAULT);
+        if (!cls->urbs || !cls->buffers || !cls->free_stack) {
+            ESP_LOGE(TAG, "urb pool alloc failed, class %u x %u bytes", cls->num, cls->buffer_size);
+            _usbh_urb_pool_release();
+            return ESP_ERR_NO_MEM;
+        }
+        for (size_t j = 0; j < cls->num; j++) {
+            cls->free_stack[j] = j;
+        }
+        cls->free_num = cls->num;
+    }
+    s_urb_pool_ready = true;
+    return ESP_OK;
+}
+
+static void _usbh_urb_pool_deinit(void)
+{
+    for (size_t i = 0; i < USBH_URB_POOL_CLASS_NUM; i++) {
+        if (s_urb_pool[i].free_num != s_urb_pool[i].num) {
+            ESP_LOGW(TAG, "urb pool kept, %u urbs of %u bytes not freed", s_urb_pool[i].num - s_urb_pool[i].free_num,
+                     s_urb_pool[i].buffer_size);
+            return;
+        }
+    }
+    _usbh_urb_pool_release();
+}
+
+static urb_t *_usbh_urb_pool_get(size_t buffer_size)
+{
+    // classes are sorted by size, take the smallest one which fits and has a free URB
+    for (size_t i = 0; i < USBH_URB_POOL_CLASS_NUM; i++) {
+        _usbh_urb_class_t *cls = &s_urb_pool[i];
+        if (buffer_size > cls->buffer_size) {
+            continue;
+        }
+        int idx = -1;
+        portENTER_CRITICAL_SAFE(&s_urb_pool_lock);
+        if (cls->free_num) {
+            idx = cls->free_stack[--cls->free_num];
+        }
+        portEXIT_CRITICAL_SAFE(&s_urb_pool_lock);
+        if (idx < 0) {
+            continue;
+        }
+        urb_t *urb = &cls->urbs[idx];
+        memset(urb, 0, sizeof(urb_t));
+        usb_transfer_dummy_t *transfer_dummy = (usb_transfer_dummy_t *)&urb->transfer;
+        transfer_dummy->data_buffer = cls->buffers + idx * cls->buffer_size;
+        transfer_dummy->data_buffer_size = buffer_size;
+        return urb;
+    }
+    return NULL;
+}
+
+static bool _usbh_urb_pool_put(urb_t *urb)
+{
+    for (size_t i = 0; i < USBH_URB_POOL_CLASS_NUM; i++) {
+        _usbh_urb_class_t *cls = &s_urb_pool[i];
+        if (cls->urbs && urb >= cls->urbs && urb < cls->urbs + cls->num) {
+            portENTER_CRITICAL_SAFE(&s_urb_pool_lock);
+            cls->free_stack[cls->free_num++] = urb - cls->urbs;
+            portEXIT_CRITICAL_SAFE(&s_urb_pool_lock);
+            return true;
+        }
+    }
+    return false;
+}
+#else
+static esp_err_t _usbh_urb_pool_init(void)
+{
+    return ESP_OK;
+}
+
+static void _usbh_urb_pool_deinit(void)
+{
+}
+
+static urb_t *_usbh_urb_pool_get(size_t buffer_size)
+{
+    return NULL;
+}
+
+static bool _usbh_urb_pool_put(urb_t *urb)
+{
+    return false;
+}
+#endif
+
 iot_usbh_urb_handle_t iot_usbh_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void *context)
 {
+    if (num_isoc_packets == 0) {
+        urb_t *urb = _usbh_urb_pool_get(packet_data_buffer_size);
+        if (urb) {
+            ((usb_transfer_dummy_t *)&urb->transfer)->context = context;
+            ESP_LOGD(TAG, "urb alloced from pool");
+            return (iot_usbh_urb_handle_t)urb;
+        }
+    }
+
     //Allocate list of URBS
     urb_t *urb = heap_caps_calloc(1, sizeof(urb_t) + (num_isoc_packets * sizeof(usb_isoc_packet_desc_t)), MALLOC_CAP_DEFAULT);
 
@@ -677,6 +963,10 @@ esp_err_t iot_usbh_urb_free(iot_usbh_urb_handle_t urb_hdl)
     //Free data buffers of each URB
     ERR_CHECK(urb_hdl != NULL, "invalid args", ESP_ERR_INVALID_ARG);
     urb_t *_urb = (urb_t *)urb_hdl;
+    if (_usbh_urb_pool_put(_urb)) {
+        ESP_LOGD(TAG, "urb back to pool");
+        return ESP_OK;
+    }
     heap_caps_free(_urb->transfer.data_buffer);
     //Free the URB list
     heap_caps_free(_urb);
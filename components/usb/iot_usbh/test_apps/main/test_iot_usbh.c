@@ -9,6 +9,7 @@
 #include "freertos/task.h"
 #include "unity.h"
 #include "esp_log.h"
+#include "esp_memory_utils.h"
 #include "iot_usbh.h"
 
 #define TEST_MEMORY_LEAK_THRESHOLD (-400)
@@ -37,6 +38,40 @@ TEST_CASE("iot_usbh init/deinit", "[iot_usbh]")
     vTaskDelay(pdMS_TO_TICKS(1000));
 }
 
+#ifdef CONFIG_USBH_URB_POOL
+TEST_CASE("iot_usbh urb pool", "[iot_usbh]")
+{
+    usbh_port_config_t config = DEFAULT_USBH_PORT_CONFIG();
+    usbh_port_handle_t port_hdl = iot_usbh_port_init(&config);
+    TEST_ASSERT_NOT_NULL(port_hdl);
+
+    // pool URBs are taken without heap calls
+    size_t free_before = heap_caps_get_free_size(MALLOC_CAP_8BIT);
+    iot_usbh_urb_handle_t urbs[CONFIG_USBH_URB_POOL_DATA_NUM];
+    for (size_t i = 0; i < CONFIG_USBH_URB_POOL_DATA_NUM; i++) {
+        urbs[i] = iot_usbh_urb_alloc(0, CONFIG_USBH_URB_POOL_DATA_SIZE, NULL);
+        TEST_ASSERT_NOT_NULL(urbs[i]);
+        size_t buf_size = 0;
+        void *buf = iot_usbh_urb_buffer_claim(urbs[i], &buf_size, NULL);
+        TEST_ASSERT_TRUE(esp_ptr_dma_capable(buf));
+        TEST_ASSERT_EQUAL(CONFIG_USBH_URB_POOL_DATA_SIZE, buf_size);
+    }
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+
+    // pool exhausted, fall back to heap
+    iot_usbh_urb_handle_t urb_heap = iot_usbh_urb_alloc(0, CONFIG_USBH_URB_POOL_DATA_SIZE, NULL);
+    TEST_ASSERT_NOT_NULL(urb_heap);
+    TEST_ASSERT_LESS_THAN(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    TEST_ASSERT_EQUAL(ESP_OK, iot_usbh_urb_free(urb_heap));
+
+    for (size_t i = 0; i < CONFIG_USBH_URB_POOL_DATA_NUM; i++) {
+        TEST_ASSERT_EQUAL(ESP_OK, iot_usbh_urb_free(urbs[i]));
+    }
+    TEST_ASSERT_EQUAL(free_before, heap_caps_get_free_size(MALLOC_CAP_8BIT));
+    TEST_ASSERT_EQUAL(ESP_OK, iot_usbh_port_deinit(port_hdl));
+}
+#endif
+
 static size_t before_free_8bit;
 static size_t before_free_32bit;
 
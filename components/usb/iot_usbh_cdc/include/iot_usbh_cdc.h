@@ -66,6 +66,9 @@ typedef struct {
     usbh_cdc_event_cb_t connect;            /*!< USB connect callback, set NULL if use */
     usbh_cdc_event_cb_t disconnect;         /*!< USB disconnect callback, set NULL if not use */
     usbh_cdc_event_cb_t revc_data;          /*!< USB receive data callback, set NULL if not use */
+    usbh_cdc_event_cb_t rx_overflow;        /*!< Received data could not be buffered, set NULL if not use.
+                                                 In ringbuffer mode the data has been dropped, in zero-copy mode
+                                                 all IN buffers are held by the user and the endpoint is paused */
     void *user_data;                        /*!< Pointer to user data that will be passed to the callbacks */
 } usbh_cdc_event_callbacks_t;
 
@@ -80,6 +83,8 @@ typedef struct usbh_cdc_config {
     int itf_num;                            /*!< interface numbers */
     size_t rx_buffer_size;                  /*!< Size of the receive buffer, default is 1024 bytes if set to 0 */
     size_t tx_buffer_size;                  /*!< Size of the transmit buffer, default is 1024 bytes if set to 0 */
+    bool rx_zero_copy;                      /*!< Hand IN transfer buffers to the user with `usbh_cdc_rx_acquire()` instead of
+                                                 copying them into the receive ringbuffer. `usbh_cdc_read_bytes()` still works */
     usbh_cdc_event_callbacks_t cbs;         /*!< Event callbacks for the CDC device */
 } usbh_cdc_device_config_t;
 
@@ -163,7 +168,8 @@ esp_err_t usbh_cdc_delete(usbh_cdc_handle_t cdc_handle);
 /**
  * @brief Write data to the USB CDC device
  *
- * This function writes data to the specified USB CDC device by pushing the data into the output ring buffer.
+ * When the output ring buffer is empty and enough OUT transfers are free, the data is copied straight into the
+ * transfers and submitted. Otherwise it is pushed into the output ring buffer and sent as transfers complete.
  * If the buffer is full or the device is not connected, the write will fail.
  *
  * @param[in] cdc_handle The CDC device handle
@@ -175,6 +181,7 @@ esp_err_t usbh_cdc_delete(usbh_cdc_handle_t cdc_handle);
  *     - ESP_OK: Data written successfully
  *     - ESP_ERR_INVALID_ARG: Invalid argument (NULL handle, buffer, or length)
  *     - ESP_ERR_INVALID_STATE: Device is not connected
+ *     - ESP_FAIL: An OUT transfer could not be submitted
  */
 esp_err_t usbh_cdc_write_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf, size_t length, TickType_t ticks_to_wait);
 
@@ -197,6 +204,42 @@ esp_err_t usbh_cdc_write_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf,
  */
 esp_err_t usbh_cdc_read_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf, size_t *length, TickType_t ticks_to_wait);
 
+/**
+ * @brief Take the next received IN transfer buffer without copying (zero-copy mode only)
+ *
+ * The buffer belongs to the user until it is given back with `usbh_cdc_rx_release()`, the transfer is resubmitted then.
+ * Several buffers can be held at once; while all of them are held the device is not polled and data stays on the
+ * device side, `rx_overflow` is called when that happens.
+ *
+ * @param[in] cdc_handle The CDC device handle
+ * @param[out] data Pointer to the received data
+ * @param[out] length Length of the received data
+ * @param[in] ticks_to_wait The maximum amount of time to wait for data
+ *
+ * @return
+ *     - ESP_OK: Data acquired
+ *     - ESP_ERR_TIMEOUT: No data received within ticks_to_wait
+ *     - ESP_ERR_INVALID_ARG: Invalid argument (NULL handle, data, or length)
+ *     - ESP_ERR_INVALID_STATE: Device is not connected
+ *     - ESP_ERR_NOT_SUPPORTED: `rx_zero_copy` is not enabled for this device
+ */
+esp_err_t usbh_cdc_rx_acquire(usbh_cdc_handle_t cdc_handle, uint8_t **data, size_t *length, TickType_t ticks_to_wait);
+
+/**
+ * @brief Give back a buffer taken with `usbh_cdc_rx_acquire()`
+ *
+ * @note Acquired buffers must be released even after the device disconnects, they are reused on reconnection.
+ *
+ * @param[in] cdc_handle The CDC device handle
+ * @param[in] data Pointer returned by `usbh_cdc_rx_acquire()`
+ *
+ * @return
+ *     - ESP_OK: Buffer released
+ *     - ESP_ERR_INVALID_ARG: Invalid CDC handle or data is not an acquired buffer
+ *     - ESP_ERR_NOT_SUPPORTED: `rx_zero_copy` is not enabled for this device
+ */
+esp_err_t usbh_cdc_rx_release(usbh_cdc_handle_t cdc_handle, const uint8_t *data);
+
 /**
  * @brief Flush the receive buffer of the USB CDC device
  *
@@ -7,6 +7,7 @@
 #include <stdio.h>
 #include <string.h>
 #include <sys/queue.h>
+#include <sys/param.h>
 #include "esp_err.h"
 #include "esp_check.h"
 #include "freertos/FreeRTOS.h"
@@ -34,6 +35,9 @@ static portMUX_TYPE cdc_lock =  portMUX_INITIALIZER_UNLOCKED;
 
 #define TIMEOUT_USB_RINGBUF_MS  200                      /*! Timeout for ring buffer operate */
 
+#define IN_XFER_NUM             CONFIG_IN_TRANSFER_NUM   /*! IN transfers kept in flight, rotated to the user in zero-copy mode */
+#define OUT_XFER_NUM            CONFIG_OUT_TRANSFER_NUM  /*! OUT transfers kept in flight */
+
 typedef struct {
     usb_host_client_handle_t cdc_client_hdl;             /*!< USB Host handle reused for all CDC-ACM devices in the system */
     EventGroupHandle_t event_group;
@@ -50,16 +54,25 @@ typedef struct usbh_cdc_s {
     uint16_t vid;                          // Vendor ID
     uint16_t pid;                          // Product ID
     struct {
-        usb_transfer_t *out_xfer;          // OUT data transfer
-        SemaphoreHandle_t out_xfer_free_sem;
-        usb_transfer_t *in_xfer;           // IN data transfer
+        usb_transfer_t *out_xfer[OUT_XFER_NUM]; // OUT data transfers
+        QueueHandle_t out_xfer_free_queue; // OUT transfers not submitted
+        SemaphoreHandle_t out_xfer_lock;   // Keeps ringbuffer chunks in order across submitters
         uint16_t in_mps;                   // IN endpoint Maximum Packet Size
-        uint8_t *in_data_buffer_base;      // Pointer to IN data buffer in usb_transfer_t
         usb_intf_desc_t *intf_desc;  // Pointer to data interface descriptor
     } data;
     usbh_cdc_event_callbacks_t cbs;         // Callbacks for the pseudo device
     RingbufHandle_t in_ringbuf_handle;   /*!< in ringbuffer handle of corresponding interface */
     size_t in_ringbuf_size;
+    struct {
+        bool enable;                       // Zero-copy mode, IN transfers are handed to the user instead of the ringbuffer
+        usb_transfer_t *xfer[IN_XFER_NUM]; // IN transfers, kept for the lifetime of the handle
+        QueueHandle_t done_queue;          // Completed transfers waiting for the user
+        uint32_t held;                     // Bitmask of transfers acquired by the user
+        int in_flight;                     // Transfers submitted to the IN endpoint
+        size_t pending;                    // Bytes completed but not read yet
+        usb_transfer_t *cur;               // Transfer partially consumed by usbh_cdc_read_bytes()
+        size_t cur_off;
+    } rx;
     RingbufHandle_t out_ringbuf_handle;  /*!< if interface is ready */
     size_t out_ringbuf_size;
     cdc_parsed_info_t info;                // Parsed interface descriptor
@@ -74,7 +87,9 @@ static esp_err_t _cdc_close(usbh_cdc_t *cdc);
 
 static void _cdc_transfers_free(usbh_cdc_t *cdc);
 
-static void _cdc_tx_xfer_submit(usb_transfer_t *out_xfer);
+static void _cdc_tx_xfer_submit(usbh_cdc_t *cdc);
+
+static void in_xfer_cb(usb_transfer_t *in_xfer);
 
 /*--------------------------------- CDC Buffer Handle Code --------------------------------------*/
 static size_t _get_ringbuf_len(RingbufHandle_t ringbuf_hdl)
@@ -377,6 +392,105 @@ unblock:
     return ret;
 }
 
+/*--------------------------------- CDC IN Transfer Pool Code --------------------------------------*/
+static void _rx_xfer_submit(usbh_cdc_t *cdc, usb_transfer_t *xfer)
+{
+    CDC_ENTER_CRITICAL();
+    if (cdc->state != USBH_CDC_OPEN) {
+        // Submitted again by _cdc_start() once the device is back
+        CDC_EXIT_CRITICAL();
+        return;
+    }
+    cdc->rx.in_flight++;
+    CDC_EXIT_CRITICAL();
+
+    xfer->num_bytes = xfer->data_buffer_size;
+    if (usb_host_transfer_submit(xfer) != ESP_OK) {
+        CDC_ENTER_CRITICAL();
+        cdc->rx.in_flight--;
+        CDC_EXIT_CRITICAL();
+        ESP_LOGW(TAG, "Failed to resubmit IN transfer");
+    }
+}
+
+static int _rx_xfer_index(usbh_cdc_t *cdc, const uint8_t *data)
+{
+    for (int i = 0; i < IN_XFER_NUM; i++) {
+        usb_transfer_t *xfer = cdc->rx.xfer[i];
+        if (xfer && data >= xfer->data_buffer && data < xfer->data_buffer + xfer->data_buffer_size) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void _rx_xfer_recycle(usbh_cdc_t *cdc, int idx)
+{
+    CDC_ENTER_CRITICAL();
+    cdc->rx.held &= ~BIT(idx);
+    CDC_EXIT_CRITICAL();
+    _rx_xfer_submit(cdc, cdc->rx.xfer[idx]);
+}
+
+static usb_transfer_t *_rx_xfer_take(usbh_cdc_t *cdc, TickType_t ticks_to_wait)
+{
+    usb_transfer_t *xfer = NULL;
+    if (xQueueReceive(cdc->rx.done_queue, &xfer, ticks_to_wait) != pdTRUE) {
+        return NULL;
+    }
+    int idx = _rx_xfer_index(cdc, xfer->data_buffer);
+    assert(idx >= 0);
+    CDC_ENTER_CRITICAL();
+    cdc->rx.held |= BIT(idx);
+    CDC_EXIT_CRITICAL();
+    return xfer;
+}
+
+// Drop completed data; transfers acquired by the user stay with the user
+static void _rx_flush(usbh_cdc_t *cdc)
+{
+    usb_transfer_t *xfer = NULL;
+    if (cdc->rx.cur) {
+        xfer = cdc->rx.cur;
+        cdc->rx.cur = NULL;
+        cdc->rx.cur_off = 0;
+        _rx_xfer_recycle(cdc, _rx_xfer_index(cdc, xfer->data_buffer));
+    }
+    while (xQueueReceive(cdc->rx.done_queue, &xfer, 0) == pdTRUE) {
+        _rx_xfer_submit(cdc, xfer);
+    }
+    CDC_ENTER_CRITICAL();
+    cdc->rx.pending = 0;
+    CDC_EXIT_CRITICAL();
+}
+
+static esp_err_t _rx_pool_alloc(usbh_cdc_t *cdc, const usb_ep_desc_t *in_ep_desc)
+{
+    for (int i = 0; i < IN_XFER_NUM; i++) {
+        if (cdc->rx.xfer[i] == NULL) {
+            ESP_RETURN_ON_ERROR(usb_host_transfer_alloc(CONFIG_IN_TRANSFER_BUFFER_SIZE, 0, &cdc->rx.xfer[i]), TAG,);
+        }
+        // The pool survives reconnection, only the device and endpoint change
+        usb_transfer_t *xfer = cdc->rx.xfer[i];
+        xfer->callback = in_xfer_cb;
+        xfer->num_bytes = xfer->data_buffer_size;
+        xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
+        xfer->device_handle = cdc->dev_hdl;
+        xfer->context = cdc;
+    }
+    return ESP_OK;
+}
+
+static void _rx_pool_free(usbh_cdc_t *cdc)
+{
+    for (int i = 0; i < IN_XFER_NUM; i++) {
+        if (cdc->rx.xfer[i]) {
+            usb_host_transfer_free(cdc->rx.xfer[i]);
+            cdc->rx.xfer[i] = NULL;
+        }
+    }
+}
+
 static void in_xfer_cb(usb_transfer_t *in_xfer)
 {
     assert(in_xfer);
@@ -386,21 +500,55 @@ static void in_xfer_cb(usb_transfer_t *in_xfer)
         in_xfer->status = USB_TRANSFER_STATUS_CANCELED;
     }
 
+    CDC_ENTER_CRITICAL();
+    cdc->rx.in_flight--;
+    CDC_EXIT_CRITICAL();
+
     switch (in_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
+        if (cdc->rx.enable) {
+            if (in_xfer->actual_num_bytes == 0) {
+                // Zero length packet, nothing to hand over
+                _rx_xfer_submit(cdc, in_xfer);
+                return;
+            }
+            CDC_ENTER_CRITICAL();
+            cdc->rx.pending += in_xfer->actual_num_bytes;
+            bool paused = (cdc->rx.in_flight == 0);
+            CDC_EXIT_CRITICAL();
+            // The queue is as deep as the pool, a transfer is never queued twice
+            xQueueSend(cdc->rx.done_queue, &in_xfer, 0);
+
+            if (cdc->cbs.revc_data) {
+                cdc->cbs.revc_data((usbh_cdc_handle_t)cdc, cdc->cbs.user_data);
+            }
+            if (paused) {
+                // All IN buffers are with the user, the device is NAKed until one is released
+                ESP_LOGD(TAG, "in pool exhausted");
+                if (cdc->cbs.rx_overflow) {
+                    cdc->cbs.rx_overflow((usbh_cdc_handle_t)cdc, cdc->cbs.user_data);
+                }
+            }
+            return;
+        }
+
+        bool overflow = false;
         size_t data_len = _get_ringbuf_len(cdc->in_ringbuf_handle);
         if (data_len + in_xfer->actual_num_bytes >= cdc->in_ringbuf_size) {
-            // TODO: add notify cb for user
             // if ringbuffer overflow, drop the data
             ESP_LOGD(TAG, "in ringbuf full");
+            overflow = true;
         } else {
             _ringbuf_push(cdc->in_ringbuf_handle, in_xfer->data_buffer, in_xfer->actual_num_bytes, pdMS_TO_TICKS(TIMEOUT_USB_RINGBUF_MS));
         }
 
-        usb_host_transfer_submit(in_xfer);
+        _rx_xfer_submit(cdc, in_xfer);
 
         if (cdc->cbs.revc_data) {
-            cdc->cbs.revc_data(cdc->cbs.user_data, cdc->cbs.user_data);
+            cdc->cbs.revc_data((usbh_cdc_handle_t)cdc, cdc->cbs.user_data);
+        }
+        if (overflow && cdc->cbs.rx_overflow) {
+            cdc->cbs.rx_overflow((usbh_cdc_handle_t)cdc, cdc->cbs.user_data);
         }
 
         return;
@@ -427,28 +575,33 @@ static void out_xfer_cb(usb_transfer_t *out_xfer)
 
     switch (out_xfer->status) {
     case USB_TRANSFER_STATUS_COMPLETED: {
-        _cdc_tx_xfer_submit(out_xfer);
+        xQueueSend(cdc->data.out_xfer_free_queue, &out_xfer, 0);
+        _cdc_tx_xfer_submit(cdc);
         return;
     }
     case USB_TRANSFER_STATUS_NO_DEVICE:
     case USB_TRANSFER_STATUS_CANCELED:
         // User is notified about device disconnection from usb_event_cb
-        // No need to do anything
+        // No need to do anything, the free list is refilled on the next open
         return;
     default:
         // Any other error, add the transfer to free list
+        xQueueSend(cdc->data.out_xfer_free_queue, &out_xfer, 0);
         break;
     }
     ESP_LOGE(TAG, "TX Transfer failed, status %d", out_xfer->status);
 }
 
-static void _cdc_tx_xfer_submit(usb_transfer_t *out_xfer)
+// Move buffered data into every free OUT transfer, so the bulk pipe never waits for a completion to be refilled
+static void _cdc_tx_xfer_submit(usbh_cdc_t *cdc)
 {
-    usbh_cdc_t *cdc = (usbh_cdc_t *) out_xfer->context;
     assert(cdc);
 
+    // Called from both the writer and the transfer callback, chunks must be popped and submitted in the same order
+    xSemaphoreTake(cdc->data.out_xfer_lock, portMAX_DELAY);
     size_t data_len = _get_ringbuf_len(cdc->out_ringbuf_handle);
-    if (data_len > 0) {
+    usb_transfer_t *out_xfer = NULL;
+    while (data_len > 0 && xQueueReceive(cdc->data.out_xfer_free_queue, &out_xfer, 0) == pdTRUE) {
         if (data_len > out_xfer->data_buffer_size) {
             data_len = out_xfer->data_buffer_size;
         }
@@ -456,48 +609,70 @@ static void _cdc_tx_xfer_submit(usb_transfer_t *out_xfer)
         _ringbuf_pop(cdc->out_ringbuf_handle, out_xfer->data_buffer, data_len, &actual_num_bytes, 0);
         assert(actual_num_bytes == data_len);
         out_xfer->num_bytes = actual_num_bytes;
-        usb_host_transfer_submit(out_xfer);
-    } else {
-        xSemaphoreGive(cdc->data.out_xfer_free_sem);
+        if (usb_host_transfer_submit(out_xfer) != ESP_OK) {
+            xQueueSend(cdc->data.out_xfer_free_queue, &out_xfer, 0);
+            ESP_LOGE(TAG, "Failed to submit OUT transfer");
+            break;
+        }
+        data_len = _get_ringbuf_len(cdc->out_ringbuf_handle);
+    }
+    xSemaphoreGive(cdc->data.out_xfer_lock);
+}
+
+// Copy a write straight into free OUT transfers when nothing is buffered and it fits, skipping the ringbuffer copy.
+// Returns ESP_ERR_NOT_FINISHED when the write has to go through the ringbuffer instead.
+static esp_err_t _cdc_tx_direct(usbh_cdc_t *cdc, const uint8_t *buf, size_t length)
+{
+    esp_err_t ret = ESP_ERR_NOT_FINISHED;
+    xSemaphoreTake(cdc->data.out_xfer_lock, portMAX_DELAY);
+    // Anything in the ringbuffer must go first; the whole write goes one way so concurrent writes stay contiguous
+    if (_get_ringbuf_len(cdc->out_ringbuf_handle) == 0
+            && uxQueueMessagesWaiting(cdc->data.out_xfer_free_queue) * CONFIG_OUT_TRANSFER_BUFFER_SIZE >= length) {
+        usb_transfer_t *out_xfer = NULL;
+        size_t off = 0;
+        while (off < length && xQueueReceive(cdc->data.out_xfer_free_queue, &out_xfer, 0) == pdTRUE) {
+            size_t chunk = MIN(length - off, CONFIG_OUT_TRANSFER_BUFFER_SIZE);
+            memcpy(out_xfer->data_buffer, buf + off, chunk);
+            out_xfer->num_bytes = chunk;
+            if (usb_host_transfer_submit(out_xfer) != ESP_OK) {
+                xQueueSend(cdc->data.out_xfer_free_queue, &out_xfer, 0);
+                ESP_LOGE(TAG, "Failed to submit OUT transfer");
+                break;
+            }
+            off += chunk;
+        }
+        ret = off == length ? ESP_OK : ESP_FAIL;
     }
+    xSemaphoreGive(cdc->data.out_xfer_lock);
+    return ret;
 }
 
 static esp_err_t _cdc_transfers_allocate(usbh_cdc_t *cdc, const usb_ep_desc_t *in_ep_desc, const usb_ep_desc_t *out_ep_desc)
 {
     esp_err_t ret = ESP_OK;
 
-    const size_t in_buf_len = CONFIG_IN_TRANSFER_BUFFER_SIZE;
     if (in_ep_desc) {
         ESP_LOGD(TAG, "in ep mps: %d", USB_EP_DESC_GET_MPS(in_ep_desc));
-        if (in_buf_len > 0) {
-            ESP_GOTO_ON_ERROR(
-                usb_host_transfer_alloc(in_buf_len, 0, &cdc->data.in_xfer),
-                err, TAG,
-            );
-            assert(cdc->data.in_xfer);
-            cdc->data.in_xfer->callback = in_xfer_cb;
-            cdc->data.in_xfer->num_bytes = in_buf_len;
-            cdc->data.in_xfer->bEndpointAddress = in_ep_desc->bEndpointAddress;
-            cdc->data.in_xfer->device_handle = cdc->dev_hdl;
-            cdc->data.in_xfer->context = cdc;
-            cdc->data.in_mps = USB_EP_DESC_GET_MPS(in_ep_desc);
-            cdc->data.in_data_buffer_base = cdc->data.in_xfer->data_buffer;
-        }
+        cdc->data.in_mps = USB_EP_DESC_GET_MPS(in_ep_desc);
+        ESP_GOTO_ON_ERROR(_rx_pool_alloc(cdc, in_ep_desc), err, TAG, "Failed to allocate IN transfers");
     }
 
     if (out_ep_desc) {
         const size_t out_buf_len = CONFIG_OUT_TRANSFER_BUFFER_SIZE;
-        if (out_buf_len > 0) {
+        xQueueReset(cdc->data.out_xfer_free_queue);
+        for (int i = 0; i < OUT_XFER_NUM && out_buf_len > 0; i++) {
             ESP_GOTO_ON_ERROR(
-                usb_host_transfer_alloc(out_buf_len, 0, &cdc->data.out_xfer),
+                usb_host_transfer_alloc(out_buf_len, 0, &cdc->data.out_xfer[i]),
                 err, TAG,
             );
-            assert(cdc->data.out_xfer);
-            cdc->data.out_xfer->callback = out_xfer_cb;
-            cdc->data.out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
-            cdc->data.out_xfer->device_handle = cdc->dev_hdl;
-            cdc->data.out_xfer->context = cdc;
-            cdc->data.out_xfer->num_bytes = out_buf_len;
+            usb_transfer_t *out_xfer = cdc->data.out_xfer[i];
+            assert(out_xfer);
+            out_xfer->callback = out_xfer_cb;
+            out_xfer->bEndpointAddress = out_ep_desc->bEndpointAddress;
+            out_xfer->device_handle = cdc->dev_hdl;
+            out_xfer->context = cdc;
+            out_xfer->num_bytes = out_buf_len;
+            xQueueSend(cdc->data.out_xfer_free_queue, &out_xfer, 0);
         }
     }
 
@@ -510,11 +685,13 @@ err:
 static void _cdc_transfers_free(usbh_cdc_t *cdc)
 {
     assert(cdc);
-    if (cdc->data.in_xfer) {
-        usb_host_transfer_free(cdc->data.in_xfer);
-    }
-    if (cdc->data.out_xfer) {
-        usb_host_transfer_free(cdc->data.out_xfer);
+    // IN transfers stay allocated until usbh_cdc_delete(), the user may hold them across reconnection
+    xQueueReset(cdc->data.out_xfer_free_queue);
+    for (int i = 0; i < OUT_XFER_NUM; i++) {
+        if (cdc->data.out_xfer[i]) {
+            usb_host_transfer_free(cdc->data.out_xfer[i]);
+            cdc->data.out_xfer[i] = NULL;
+        }
     }
 }
 
@@ -540,9 +717,16 @@ static esp_err_t _cdc_start(usbh_cdc_t *cdc)
             cdc->data.intf_desc->bInterfaceNumber,
             cdc->data.intf_desc->bAlternateSetting),
         err, TAG, "Could not claim interface");
-    if (cdc->data.in_xfer) {
-        ESP_LOGD(TAG, "Submitting poll for BULK IN transfer");
-        ESP_ERROR_CHECK(usb_host_transfer_submit(cdc->data.in_xfer));
+    if (cdc->rx.xfer[0]) {
+        ESP_LOGD(TAG, "Submitting %d BULK IN transfers", IN_XFER_NUM);
+        cdc->rx.in_flight = 0;
+        for (int i = 0; i < IN_XFER_NUM; i++) {
+            // Transfers still held by the user are submitted when released
+            if (!(cdc->rx.held & BIT(i))) {
+                cdc->rx.in_flight++;
+                ESP_ERROR_CHECK(usb_host_transfer_submit(cdc->rx.xfer[i]));
+            }
+        }
     }
 
     return ESP_OK;
@@ -613,7 +797,7 @@ static esp_err_t _cdc_open(usbh_cdc_t *cdc)
     ESP_ERROR_CHECK(usb_host_get_active_config_descriptor(cdc->dev_hdl, &config_desc));
     ESP_ERROR_CHECK(usb_host_get_device_descriptor(cdc->dev_hdl, &device_desc));
 
-    cdc_parsed_info_t cdc_info;
+    cdc_parsed_info_t cdc_info = {0};
     ret = cdc_parse_interface_descriptor(device_desc, config_desc, cdc->intf_idx, &cdc->data.intf_desc, &cdc_info);
     if (ret != ESP_OK) {
         usb_host_device_close(p_usbh_cdc_obj->cdc_client_hdl, cdc->dev_hdl); // Gracefully continue on error
@@ -621,6 +805,9 @@ static esp_err_t _cdc_open(usbh_cdc_t *cdc)
 
     _ring_buffer_flush(cdc->in_ringbuf_handle);
     _ring_buffer_flush(cdc->out_ringbuf_handle);
+    if (cdc->rx.enable) {
+        _rx_flush(cdc);
+    }
 
     ESP_GOTO_ON_ERROR(
         _cdc_transfers_allocate(cdc, cdc_info.in_ep, cdc_info.out_ep),
@@ -651,9 +838,18 @@ static esp_err_t _cdc_close(usbh_cdc_t *cdc)
         return ESP_ERR_INVALID_STATE;
     }
 
+    // Completions from here on are treated as canceled and not resubmitted
+    CDC_ENTER_CRITICAL();
+    cdc->state = USBH_CDC_CLOSE;
+    CDC_EXIT_CRITICAL();
+
     // Cancel polling of BULK IN
-    if (cdc->data.in_xfer) {
-        ESP_ERROR_CHECK(_cdc_reset_transfer_endpoint(cdc->dev_hdl, cdc->data.in_xfer));
+    if (cdc->rx.xfer[0]) {
+        ESP_ERROR_CHECK(_cdc_reset_transfer_endpoint(cdc->dev_hdl, cdc->rx.xfer[0]));
+    }
+    // Cancel BULK OUT transfers still in flight before they are freed
+    if (cdc->data.out_xfer[0]) {
+        ESP_ERROR_CHECK(_cdc_reset_transfer_endpoint(cdc->dev_hdl, cdc->data.out_xfer[0]));
     }
 
     // Release all interfaces
@@ -688,21 +884,28 @@ esp_err_t usbh_cdc_create(const usbh_cdc_device_config_t *config, usbh_cdc_handl
     cdc->in_ringbuf_handle = xRingbufferCreate(cdc->in_ringbuf_size, RINGBUF_TYPE_BYTEBUF);
     ESP_GOTO_ON_FALSE(cdc->in_ringbuf_handle != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create ring buffer");
 
+    if (config->rx_zero_copy) {
+        cdc->rx.enable = true;
+        cdc->rx.done_queue = xQueueCreate(IN_XFER_NUM, sizeof(usb_transfer_t *));
+        ESP_GOTO_ON_FALSE(cdc->rx.done_queue != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create rx queue");
+    }
+
     cdc->out_ringbuf_size = config->tx_buffer_size ? config->tx_buffer_size : CONFIG_OUT_RINGBUFFER_SIZE;
     cdc->out_ringbuf_handle = xRingbufferCreate(cdc->out_ringbuf_size, RINGBUF_TYPE_BYTEBUF);
     ESP_GOTO_ON_FALSE(cdc->out_ringbuf_handle != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create ring buffer");
 
     cdc->cbs = config->cbs;
 
+    cdc->data.out_xfer_free_queue = xQueueCreate(OUT_XFER_NUM, sizeof(usb_transfer_t *));
+    ESP_GOTO_ON_FALSE(cdc->data.out_xfer_free_queue != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create tx queue");
+    cdc->data.out_xfer_lock = xSemaphoreCreateMutex();
+    ESP_GOTO_ON_FALSE(cdc->data.out_xfer_lock != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create mutex");
+
     ret = _cdc_find_and_open_usb_device(cdc);
     if (ret == ESP_OK) {
         ESP_GOTO_ON_FALSE(_cdc_open(cdc) == ESP_OK, ESP_FAIL, fail, TAG, "Failed to open cdc device: %d", cdc->dev_addr);
     }
 
-    cdc->data.out_xfer_free_sem = xSemaphoreCreateBinary();
-    ESP_GOTO_ON_FALSE(cdc->data.out_xfer_free_sem != NULL, ESP_ERR_NO_MEM, fail, TAG, "Failed to create mutex");
-    xSemaphoreGive(cdc->data.out_xfer_free_sem);
-
     CDC_ENTER_CRITICAL();
     SLIST_INSERT_HEAD(&p_usbh_cdc_obj->cdc_devices_list, cdc, list_entry);
     CDC_EXIT_CRITICAL();
@@ -713,11 +916,18 @@ fail:
     if (cdc->in_ringbuf_handle) {
         vRingbufferDelete(cdc->in_ringbuf_handle);
     }
+    if (cdc->rx.done_queue) {
+        vQueueDelete(cdc->rx.done_queue);
+    }
+    _rx_pool_free(cdc);
     if (cdc->out_ringbuf_handle) {
         vRingbufferDelete(cdc->out_ringbuf_handle);
     }
-    if (cdc->data.out_xfer_free_sem) {
-        vSemaphoreDelete(cdc->data.out_xfer_free_sem);
+    if (cdc->data.out_xfer_free_queue) {
+        vQueueDelete(cdc->data.out_xfer_free_queue);
+    }
+    if (cdc->data.out_xfer_lock) {
+        vSemaphoreDelete(cdc->data.out_xfer_lock);
     }
     if (cdc) {
         free(cdc);
@@ -740,11 +950,18 @@ esp_err_t usbh_cdc_delete(usbh_cdc_handle_t cdc_handle)
     if (cdc->in_ringbuf_handle) {
         vRingbufferDelete(cdc->in_ringbuf_handle);
     }
+    if (cdc->rx.done_queue) {
+        vQueueDelete(cdc->rx.done_queue);
+    }
+    _rx_pool_free(cdc);
     if (cdc->out_ringbuf_handle) {
         vRingbufferDelete(cdc->out_ringbuf_handle);
     }
-    if (cdc->data.out_xfer_free_sem) {
-        vSemaphoreDelete(cdc->data.out_xfer_free_sem);
+    if (cdc->data.out_xfer_free_queue) {
+        vQueueDelete(cdc->data.out_xfer_free_queue);
+    }
+    if (cdc->data.out_xfer_lock) {
+        vSemaphoreDelete(cdc->data.out_xfer_lock);
     }
     if (cdc) {
         free(cdc);
@@ -762,22 +979,56 @@ esp_err_t usbh_cdc_write_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf,
     usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
     ESP_GOTO_ON_FALSE(cdc->state == USBH_CDC_OPEN, ESP_ERR_INVALID_STATE, fail, TAG, "Device is not connected");
 
+    ret = _cdc_tx_direct(cdc, buf, length);
+    if (ret != ESP_ERR_NOT_FINISHED) {
+        return ret;
+    }
+
     ret = _ringbuf_push(cdc->out_ringbuf_handle, buf, length, ticks_to_wait);
     if (ret != ESP_OK) {
         ESP_LOGD(TAG, "cdc write buf = %p, len = %d", buf, length);
         return ret;
     }
 
-    if (xSemaphoreTake(cdc->data.out_xfer_free_sem, 0) == pdTRUE) {
-        // here need a critical
-        _cdc_tx_xfer_submit(cdc->data.out_xfer);
-    }
+    _cdc_tx_xfer_submit(cdc);
 
     return ESP_OK;
 fail:
     return ret;
 }
 
+// Copy out of the transfers in completion order, for users of the zero-copy mode that still read bytes
+static esp_err_t _rx_read(usbh_cdc_t *cdc, uint8_t *buf, size_t *length, TickType_t ticks_to_wait)
+{
+    size_t want = *length;
+    size_t got = 0;
+    while (got < want) {
+        if (cdc->rx.cur == NULL) {
+            // Only the first transfer is waited for
+            cdc->rx.cur = _rx_xfer_take(cdc, got ? 0 : ticks_to_wait);
+            cdc->rx.cur_off = 0;
+            if (cdc->rx.cur == NULL) {
+                break;
+            }
+        }
+        usb_transfer_t *xfer = cdc->rx.cur;
+        size_t n = MIN(want - got, xfer->actual_num_bytes - cdc->rx.cur_off);
+        memcpy(buf + got, xfer->data_buffer + cdc->rx.cur_off, n);
+        got += n;
+        cdc->rx.cur_off += n;
+        if (cdc->rx.cur_off == xfer->actual_num_bytes) {
+            cdc->rx.cur = NULL;
+            _rx_xfer_recycle(cdc, _rx_xfer_index(cdc, xfer->data_buffer));
+        }
+    }
+
+    CDC_ENTER_CRITICAL();
+    cdc->rx.pending -= got;
+    CDC_EXIT_CRITICAL();
+    *length = got;
+    return got ? ESP_OK : ESP_FAIL;
+}
+
 esp_err_t usbh_cdc_read_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf, size_t *length, TickType_t ticks_to_wait)
 {
     esp_err_t ret = ESP_OK;
@@ -788,6 +1039,10 @@ esp_err_t usbh_cdc_read_bytes(usbh_cdc_handle_t cdc_handle, const uint8_t *buf,
     usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
     ESP_GOTO_ON_FALSE(cdc->state == USBH_CDC_OPEN, ESP_ERR_INVALID_STATE, fail, TAG, "Device is not connected");
 
+    if (cdc->rx.enable) {
+        return _rx_read(cdc, (uint8_t *)buf, length, ticks_to_wait);
+    }
+
     size_t data_len = _get_ringbuf_len(cdc->in_ringbuf_handle);
     if (data_len > *length) {
         data_len = *length;
@@ -806,11 +1061,58 @@ fail:
     return ret;
 }
 
+esp_err_t usbh_cdc_rx_acquire(usbh_cdc_handle_t cdc_handle, uint8_t **data, size_t *length, TickType_t ticks_to_wait)
+{
+    ESP_RETURN_ON_FALSE(cdc_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "cdc_handle is NULL");
+    ESP_RETURN_ON_FALSE(data != NULL && length != NULL, ESP_ERR_INVALID_ARG, TAG, "data or length is NULL");
+    usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
+    ESP_RETURN_ON_FALSE(cdc->rx.enable, ESP_ERR_NOT_SUPPORTED, TAG, "rx_zero_copy is not enabled");
+    ESP_RETURN_ON_FALSE(cdc->state == USBH_CDC_OPEN, ESP_ERR_INVALID_STATE, TAG, "Device is not connected");
+
+    *data = NULL;
+    *length = 0;
+    usb_transfer_t *xfer = cdc->rx.cur;
+    size_t off = cdc->rx.cur_off;
+    if (xfer) {
+        // Hand over what usbh_cdc_read_bytes() left, it is already marked as held
+        cdc->rx.cur = NULL;
+        cdc->rx.cur_off = 0;
+    } else {
+        xfer = _rx_xfer_take(cdc, ticks_to_wait);
+        off = 0;
+        if (xfer == NULL) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+
+    *data = xfer->data_buffer + off;
+    *length = xfer->actual_num_bytes - off;
+    CDC_ENTER_CRITICAL();
+    cdc->rx.pending -= *length;
+    CDC_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t usbh_cdc_rx_release(usbh_cdc_handle_t cdc_handle, const uint8_t *data)
+{
+    ESP_RETURN_ON_FALSE(cdc_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "cdc_handle is NULL");
+    usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
+    ESP_RETURN_ON_FALSE(cdc->rx.enable, ESP_ERR_NOT_SUPPORTED, TAG, "rx_zero_copy is not enabled");
+    int idx = _rx_xfer_index(cdc, data);
+    ESP_RETURN_ON_FALSE(idx >= 0 && (cdc->rx.held & BIT(idx)), ESP_ERR_INVALID_ARG, TAG, "data is not an acquired buffer");
+
+    _rx_xfer_recycle(cdc, idx);
+    return ESP_OK;
+}
+
 esp_err_t usbh_cdc_flush_rx_buffer(usbh_cdc_handle_t cdc_handle)
 {
     ESP_RETURN_ON_FALSE(cdc_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "cdc_handle is NULL");
     usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
     _ring_buffer_flush(cdc->in_ringbuf_handle);
+    if (cdc->rx.enable) {
+        _rx_flush(cdc);
+    }
     return ESP_OK;
 }
 
@@ -826,7 +1128,7 @@ esp_err_t usbh_cdc_get_rx_buffer_size(usbh_cdc_handle_t cdc_handle, size_t *size
 {
     ESP_RETURN_ON_FALSE(cdc_handle != NULL, ESP_ERR_INVALID_ARG, TAG, "cdc_handle is NULL");
     usbh_cdc_t *cdc = (usbh_cdc_t *) cdc_handle;
-    *size = _get_ringbuf_len(cdc->in_ringbuf_handle);
+    *size = cdc->rx.enable ? cdc->rx.pending : _get_ringbuf_len(cdc->in_ringbuf_handle);
     return ESP_OK;
 }
 
@@ -164,6 +164,75 @@ TEST_CASE("usb dual cdc R/W", "[iot_usbh_cdc][read-write]")
     vTaskDelay(2000 / portTICK_PERIOD_MS);
 }
 
+static void cdc_rx_overflow_cb(usbh_cdc_handle_t handle, void *arg)
+{
+    ESP_LOGW(TAG, "cdc rx overflow");
+}
+
+TEST_CASE("usb cdc zero-copy R/W", "[iot_usbh_cdc][read-write][auto]")
+{
+    esp_log_level_set("USBH_CDC", ESP_LOG_DEBUG);
+
+    usbh_cdc_driver_config_t config = {
+        .task_stack_size = 1024 * 4,
+        .task_priority = 5,
+        .task_coreid = 0,
+        .skip_init_usb_host_driver = false,
+        .new_dev_cb = cdc_new_dev_cb,
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, usbh_cdc_driver_install(&config));
+
+    usbh_cdc_device_config_t dev_config = {
+        .vid = 0,
+        .pid = 0,
+        .itf_num = 1,
+        .rx_buffer_size = 0,
+        .tx_buffer_size = 0,
+        .rx_zero_copy = true,
+        .cbs = {
+            .connect = cdc_connect_cb,
+            .disconnect = cdc_disconnect_cb,
+            .rx_overflow = cdc_rx_overflow_cb,
+            .user_data = NULL
+        },
+    };
+
+    usbh_cdc_handle_t handle = NULL;
+    usbh_cdc_create(&dev_config, &handle);
+
+    // Add connect event
+    vTaskDelay(1000 / portTICK_PERIOD_MS);
+
+    // Byte reads are served from the transfer pool
+    usb_communication(5, 128, handle);
+
+    uint8_t buff[64];
+    for (int i = 0; i < sizeof(buff); i++) {
+        buff[i] = i;
+    }
+    for (int loop = 0; loop < 5; loop++) {
+        TEST_ASSERT_EQUAL(ESP_OK, usbh_cdc_write_bytes(handle, buff, sizeof(buff), pdMS_TO_TICKS(1000)));
+
+        size_t total = 0;
+        uint8_t *data = NULL;
+        size_t length = 0;
+        while (total < sizeof(buff) && usbh_cdc_rx_acquire(handle, &data, &length, pdMS_TO_TICKS(1000)) == ESP_OK) {
+            ESP_LOGI(TAG, "Acquired data len: %d", length);
+            ESP_LOG_BUFFER_HEXDUMP(TAG, data, length, ESP_LOG_INFO);
+            total += length;
+            TEST_ASSERT_EQUAL(ESP_OK, usbh_cdc_rx_release(handle, data));
+        }
+        TEST_ASSERT_EQUAL(sizeof(buff), total);
+        // A released buffer can't be released twice
+        TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, usbh_cdc_rx_release(handle, data));
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, usbh_cdc_delete(handle));
+    TEST_ASSERT_EQUAL(ESP_OK, usbh_cdc_driver_uninstall());
+    vTaskDelay(2000 / portTICK_PERIOD_MS);
+}
+
 TEST_CASE("usbh cdc driver memory leak", "[iot_usbh_cdc][read-write][auto]")
 {
     esp_log_level_set("USBH_CDC", ESP_LOG_DEBUG);
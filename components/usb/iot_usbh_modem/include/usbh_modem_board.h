@@ -70,11 +70,22 @@ esp_err_t modem_board_init(modem_config_t *config);
  */
 esp_err_t modem_board_get_dns_info(esp_netif_dns_type_t type, esp_netif_dns_info_t *dns);
 
+/**
+ * @brief Get the ppp netif of the modem
+ *
+ * @note The netif is created with the default PPP route priority, lower than Wi-Fi station,
+ *       use esp_netif_set_default_netif() to route traffic through the modem while station is up
+ * @return esp_netif_t* ppp netif, NULL if the modem task has not created it yet
+ */
+esp_netif_t *modem_board_get_netif(void);
+
 /**
  * @brief Get 4g signal quality value
  *
  * @param rssi received signal strength indication <rssi>, 2..30: -109..-53 dBm, 99 means not known or not detectable
  * @param ber channel bit error rate (in percent)
+ * @note In ppp mode the query is sent on the secondary AT port if enabled,
+ *       otherwise the last value read in command mode is returned
  * @return ** esp_err_t
  */
 esp_err_t modem_board_get_signal_quality(int *rssi, int *ber);
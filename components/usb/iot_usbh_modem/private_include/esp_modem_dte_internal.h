@@ -33,6 +33,9 @@ extern "C" {
 typedef struct {
     uart_port_t uart_port;                  /*!< UART port */
     uint8_t *buffer;                        /*!< Internal buffer to store response lines/data from DCE */
+    size_t line_len;                        /*!< Bytes in buffer of a line that has not ended yet */
+    uint8_t *buffer2;                       /*!< Line buffer of the secondary AT interface */
+    size_t line_len2;                       /*!< Bytes in buffer2 of a line that has not ended yet */
     uint8_t *data_buffer;                   /*!< Internal buffer to store response data from DCE */
     QueueHandle_t event_queue;              /*!< UART event queue handle */
     esp_event_loop_handle_t event_loop_hdl; /*!< Event loop handle */
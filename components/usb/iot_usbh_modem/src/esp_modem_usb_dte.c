@@ -57,16 +57,16 @@ esp_err_t esp_modem_set_rx_cb(esp_modem_dte_t *dte, esp_modem_on_receive receive
  * @brief Handle one line in DTE
  *
  * @param esp_dte ESP modem DTE object
+ * @param line NULL terminated line, including its line end
  * @return esp_err_t
  *      - ESP_OK on success
  *      - ESP_FAIL on error
  */
-static esp_err_t esp_dte_handle_line(esp_modem_dte_internal_t *esp_dte)
+static esp_err_t esp_dte_handle_line(esp_modem_dte_internal_t *esp_dte, const char *line)
 {
     esp_err_t err = ESP_FAIL;
     esp_modem_dce_t *dce = esp_dte->parent.dce;
     ESP_MODEM_ERR_CHECK(dce, "DTE has not yet bind with DCE", err);
-    const char *line = (const char *)(esp_dte->buffer);
     size_t len = strlen(line);
     /* Skip pure "\r\n" lines */
     if (len > 2 && !is_only_cr_lf(line, len)) {
@@ -87,89 +87,102 @@ err:
     return err;
 }
 
-static void esp_handle_usb_data(esp_modem_dte_internal_t *esp_dte)
+/**
+ * @brief Pass one assembled line to the handler waiting for it
+ */
+static void esp_dte_dispatch_line(esp_modem_dte_internal_t *esp_dte, const char *line)
+{
+    if (esp_dte->parent.dce->handle_line) {
+        /* Send new line to handle if handler registered */
+        esp_dte_handle_line(esp_dte, line);
+    }
+}
+
+/**
+ * @brief Read the available data of an interface into its line buffer and handle every complete line
+ *
+ * A line may arrive over several reads and one read may hold several lines, the part after the last
+ * line end stays in the buffer for the next call. A line longer than the buffer is handled as it is.
+ *
+ * @param esp_dte ESP modem DTE object
+ * @param cdc_hdl CDC interface to read
+ * @param buffer line buffer of the interface, line_buffer_size bytes
+ * @param line_len bytes already in buffer
+ */
+static void esp_dte_read_lines(esp_modem_dte_internal_t *esp_dte, usbh_cdc_handle_t cdc_hdl, uint8_t *buffer, size_t *line_len)
 {
+    size_t max = esp_dte->line_buffer_size - 1;
     size_t length = 0;
-    usbh_cdc_get_rx_buffer_size(esp_dte->cdc_hdl, &length);
-
-    if (esp_dte->parent.dce->mode != ESP_MODEM_PPP_MODE && length) {
-
-        // Read the data and process it using `handle_line` logic
-        // to avoid reading two line at the same time
-        length = MIN(esp_dte->line_buffer_size - 1, length);
-        usbh_cdc_read_bytes(esp_dte->cdc_hdl, esp_dte->buffer, &length, pdMS_TO_TICKS(100));
-        esp_dte->buffer[length] = '\0';
-        if (strchr((char *)esp_dte->buffer, '\n') == NULL) {
-            size_t max = esp_dte->line_buffer_size - 1;
-            // if pattern not found in the data,
-            // continue reading as long as the modem is in MODEM_STATE_PROCESSING, checking for the pattern
-            while (length < max && esp_dte->buffer[length - 1] != '\n' &&
-                    esp_dte->parent.dce->state == ESP_MODEM_STATE_PROCESSING) {
-                size_t len = 1;
-                usbh_cdc_read_bytes(esp_dte->cdc_hdl, esp_dte->buffer + length, &len, pdMS_TO_TICKS(100));
-                length += len;
-                ESP_LOGV("esp-modem: debug_data", "Continuous read in non-data mode: length: %d char: %x", length, esp_dte->buffer[length - 1]);
-            }
-            esp_dte->buffer[length] = '\0';
-        }
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data", esp_dte->buffer, length, ESP_LOG_DEBUG);
-        if (esp_dte->parent.dce->handle_line) {
-            /* Send new line to handle if handler registered */
-            esp_dte_handle_line(esp_dte);
+    usbh_cdc_get_rx_buffer_size(cdc_hdl, &length);
+    length = MIN(max - *line_len, length);
+    if (length) {
+        usbh_cdc_read_bytes(cdc_hdl, buffer + *line_len, &length, 0);
+    }
+    ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data", buffer + *line_len, length, ESP_LOG_DEBUG);
+
+    /* Only the new bytes can hold a line end */
+    size_t end = *line_len + length;
+    size_t start = 0;
+    for (size_t i = *line_len; i < end; i++) {
+        if (buffer[i] != '\n') {
+            continue;
         }
-        return;
+        uint8_t next = buffer[i + 1];
+        buffer[i + 1] = '\0';
+        esp_dte_dispatch_line(esp_dte, (const char *)buffer + start);
+        buffer[i + 1] = next;
+        start = i + 1;
     }
-    length = MIN(esp_dte->data_buffer_size, length);
-    usbh_cdc_read_bytes(esp_dte->cdc_hdl, esp_dte->data_buffer, &length, pdMS_TO_TICKS(100));
-    /* pass the input data to configured callback */
-    if (length) {
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: ppp_input", esp_dte->data_buffer, length, ESP_LOG_VERBOSE);
-        esp_dte->receive_cb(esp_dte->data_buffer, length, esp_dte->receive_cb_ctx);
+
+    if (start == 0 && end == max) {
+        ESP_LOGW(TAG, "Line longer than %d bytes", max);
+        buffer[end] = '\0';
+        esp_dte_dispatch_line(esp_dte, (const char *)buffer);
+        start = end;
     }
+    /* Keep the partial line for the next read */
+    memmove(buffer, buffer + start, end - start);
+    *line_len = end - start;
 }
 
-static void esp_handle_usb2_data(esp_modem_dte_internal_t *esp_dte)
+static void esp_handle_usb_data(esp_modem_dte_internal_t *esp_dte)
 {
+    if (esp_dte->parent.dce->mode != ESP_MODEM_PPP_MODE) {
+        esp_dte_read_lines(esp_dte, esp_dte->cdc_hdl, esp_dte->buffer, &esp_dte->line_len);
+        return;
+    }
+    if (esp_dte->line_len) {
+        /* PPP data that arrived together with the CONNECT line */
+        esp_dte->receive_cb(esp_dte->buffer, esp_dte->line_len, esp_dte->receive_cb_ctx);
+        esp_dte->line_len = 0;
+    }
+    /* pass the IN transfer buffers to configured callback without copying */
+    uint8_t *data = NULL;
     size_t length = 0;
-    usbh_cdc_get_rx_buffer_size(esp_dte->cdc_hdl2, &length);
+    while (usbh_cdc_rx_acquire(esp_dte->cdc_hdl, &data, &length, 0) == ESP_OK) {
+        ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: ppp_input", data, length, ESP_LOG_VERBOSE);
+        esp_dte->receive_cb(data, length, esp_dte->receive_cb_ctx);
+        usbh_cdc_rx_release(esp_dte->cdc_hdl, data);
+    }
+}
 
+static void esp_handle_usb2_data(esp_modem_dte_internal_t *esp_dte)
+{
     // Only handle interface1 data during interface0 in ppp mode
-    if (esp_dte->parent.dce->mode == ESP_MODEM_PPP_MODE && length) {
-
-        // Read the data and process it using `handle_line` logic
-        // to avoid reading two line at the same time
-        length = MIN(esp_dte->line_buffer_size - 1, length);
-        usbh_cdc_read_bytes(esp_dte->cdc_hdl2, esp_dte->buffer, &length, pdMS_TO_TICKS(100));
-        esp_dte->buffer[length] = '\0';
-        if (strchr((char *)esp_dte->buffer, '\n') == NULL) {
-            size_t max = esp_dte->line_buffer_size - 1;
-            // if pattern not found in the data,
-            // continue reading as long as the modem is in MODEM_STATE_PROCESSING, checking for the pattern
-            while (length < max && esp_dte->buffer[length - 1] != '\n' &&
-                    esp_dte->parent.dce->state == ESP_MODEM_STATE_PROCESSING) {
-                size_t len = 1;
-                usbh_cdc_read_bytes(esp_dte->cdc_hdl2, esp_dte->buffer + length, &len, pdMS_TO_TICKS(100));
-                length += len;
-                ESP_LOGV("esp-modem: debug_data2", "Continuous read in non-data mode: length: %d char: %x", length, esp_dte->buffer[length - 1]);
-            }
-            esp_dte->buffer[length] = '\0';
-        }
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem: debug_data2", esp_dte->buffer, length, ESP_LOG_DEBUG);
-        if (esp_dte->parent.dce->handle_line) {
-            /* Send new line to handle if handler registered */
-            esp_dte_handle_line(esp_dte);
-        }
+    if (esp_dte->parent.dce->mode == ESP_MODEM_PPP_MODE) {
+        esp_dte_read_lines(esp_dte, esp_dte->cdc_hdl2, esp_dte->buffer2, &esp_dte->line_len2);
         return;
     }
+    size_t length = 0;
+    usbh_cdc_get_rx_buffer_size(esp_dte->cdc_hdl2, &length);
     length = MIN(esp_dte->data_buffer_size, length);
-    uint8_t *temp_buffer = (uint8_t *)calloc(1, length);
     usbh_cdc_read_bytes(esp_dte->cdc_hdl2, esp_dte->data_buffer, &length, pdMS_TO_TICKS(100));
     /* pass the input data to configured callback */
     if (length) {
         ESP_LOGI(TAG, "Intf2 not handle date, just dump:");
-        ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: inf2", temp_buffer, length, ESP_LOG_INFO);
+        ESP_LOG_BUFFER_HEXDUMP("esp-modem-dte: inf2", esp_dte->data_buffer, length, ESP_LOG_INFO);
     }
-    free(temp_buffer);
+    esp_dte->line_len2 = 0;
 }
 
 static void _usb_recv_date_cb(usbh_cdc_handle_t cdc_handle, void *arg)
@@ -198,6 +211,9 @@ static void _usb_disconn_callback(usbh_cdc_handle_t cdc_handle, void *arg)
 {
     esp_modem_dte_internal_t *esp_dte = (esp_modem_dte_internal_t *)arg;
     esp_dte->conn_state = 0;
+    /* Partial lines of the old connection are stale */
+    esp_dte->line_len = 0;
+    esp_dte->line_len2 = 0;
     if (esp_dte->disconn_callback) {
         esp_dte->disconn_callback(cdc_handle, NULL);
     }
@@ -324,12 +340,18 @@ static esp_err_t esp_modem_dte_send_wait(esp_modem_dte_t *dte, const char *data,
     ESP_MODEM_ERR_CHECK(data, "data is NULL", err_param);
     ESP_MODEM_ERR_CHECK(prompt, "prompt is NULL", err_param);
     esp_modem_dte_internal_t *esp_dte = __containerof(dte, esp_modem_dte_internal_t, parent);
+    /* the main interface carries PPP data in PPP mode, use the AT interface then */
+    usbh_cdc_handle_t cdc_hdl = esp_dte->cdc_hdl;
+    if (esp_dte->parent.dce->mode == ESP_MODEM_PPP_MODE) {
+        ESP_MODEM_ERR_CHECK(esp_dte->cdc_hdl2, "no AT interface in ppp mode", err_param);
+        cdc_hdl = esp_dte->cdc_hdl2;
+    }
     size_t len = length;
-    ESP_MODEM_ERR_CHECK(usbh_cdc_write_bytes(esp_dte->cdc_hdl, (const uint8_t*)data, len, pdMS_TO_TICKS(100)) == ESP_OK, "uart write bytes failed", err_param);
+    ESP_MODEM_ERR_CHECK(usbh_cdc_write_bytes(cdc_hdl, (const uint8_t*)data, len, pdMS_TO_TICKS(100)) == ESP_OK, "uart write bytes failed", err_param);
     len = strlen(prompt);
     uint8_t *buffer = calloc(len + 1, sizeof(uint8_t));
     // TODO: timeout
-    int ret = usbh_cdc_read_bytes(esp_dte->cdc_hdl, buffer, &len, pdMS_TO_TICKS(100));
+    int ret = usbh_cdc_read_bytes(cdc_hdl, buffer, &len, pdMS_TO_TICKS(100));
     ESP_MODEM_ERR_CHECK(ret >= len, "wait prompt [%s] timeout", err, prompt);
     ESP_MODEM_ERR_CHECK(!strncmp(prompt, (const char *)buffer, len), "get wrong prompt: %s", err, buffer);
     free(buffer);
@@ -418,6 +440,7 @@ static esp_err_t esp_modem_dte_deinit(esp_modem_dte_t *dte)
     usbh_cdc_driver_uninstall();
     /* Free memory */
     free(esp_dte->buffer);
+    free(esp_dte->buffer2);
     free(esp_dte->data_buffer);
     if (dte->dce) {
         dte->dce->dte = NULL;
@@ -440,6 +463,10 @@ esp_modem_dte_t *esp_modem_dte_new(const esp_modem_dte_config_t *config)
     esp_dte->line_buffer_size = config->line_buffer_size;
     esp_dte->buffer = calloc(1, config->line_buffer_size);
     ESP_MODEM_ERR_CHECK(esp_dte->buffer, "calloc line memory failed", err_buf_mem);
+#ifdef CONFIG_MODEM_SUPPORT_SECONDARY_AT_PORT
+    esp_dte->buffer2 = calloc(1, config->line_buffer_size);
+    ESP_MODEM_ERR_CHECK(esp_dte->buffer2, "calloc line memory failed", err_buf_mem);
+#endif
     esp_dte->data_buffer_size = config->line_buffer_size;
     esp_dte->data_buffer = calloc(1, esp_dte->data_buffer_size);
     ESP_MODEM_ERR_CHECK(esp_dte->data_buffer, "calloc data memory failed", err_buf_mem);
@@ -490,6 +517,7 @@ esp_modem_dte_t *esp_modem_dte_new(const esp_modem_dte_config_t *config)
         .itf_num = CONFIG_MODEM_USB_ITF,
         .rx_buffer_size = config->rx_buffer_size,
         .tx_buffer_size = config->tx_buffer_size,
+        .rx_zero_copy = true,
         .cbs = {
             .connect = _usb_conn_callback,
             .disconnect = _usb_disconn_callback,
@@ -508,7 +536,9 @@ esp_modem_dte_t *esp_modem_dte_new(const esp_modem_dte_config_t *config)
     /*!< Dual to it is one USB device, we only need one entry point to send notifications. */
     dev_config.cbs.connect = NULL;
     dev_config.cbs.disconnect = NULL;
-    dev_config.cbs.user_data = NULL;
+    /*!< revc_data still wakes the receive task, keep user_data */
+    /*!< AT only, line reads are served from the ringbuffer */
+    dev_config.rx_zero_copy = false;
     handle = NULL;
     usbh_cdc_create(&dev_config, &handle);
     ESP_MODEM_ERR_CHECK(handle != NULL, "usb cdc device create failed", err_usb_config);
@@ -529,6 +559,7 @@ err_eloop:
     vSemaphoreDelete(esp_dte->parent.send_cmd_lock);
 err_buf_mem:
     free(esp_dte->data_buffer);
+    free(esp_dte->buffer2);
     free(esp_dte->buffer);
     free(esp_dte);
 err_dte_mem:
@@ -21,6 +21,9 @@
 #include "esp_modem_dce.h"
 #include "esp_modem_dce_common_commands.h"
 #include "usbh_modem_board.h"
+#if CONFIG_MODEM_WARM_RESTART
+#include "nvs.h"
+#endif
 
 static const char *TAG = "modem_board";
 ESP_EVENT_DEFINE_BASE(MODEM_BOARD_EVENT);
@@ -65,9 +68,37 @@ static const int DTE_USB_RECONNECT_BIT            = BIT7;    /* dte usb reconnec
 static const int PPP_NET_RECONNECTING_BIT         = BIT8;    /* ppp net reconnecting, trigger by daemon task, clear by daemon task */
 
 static esp_modem_dce_t *s_dce = NULL;
+static esp_netif_t *s_ppp_netif = NULL;
 static EventGroupHandle_t s_modem_evt_hdl = NULL;
 static esp_ip_addr_t s_dns_ip_main = ESP_IP4ADDR_INIT(8, 8, 8, 8);
 static esp_ip_addr_t s_dns_ip_backup = ESP_IP4ADDR_INIT(114, 114, 114, 114);
+/* last +CSQ result, reported while commands can not be sent in ppp mode */
+static esp_modem_dce_csq_ctx_t s_last_csq = {.rssi = 99, .ber = 99};
+
+#if CONFIG_MODEM_WARM_RESTART
+/*
+ * Network state of the last session which got an IP, kept in NVS. After a reboot or USB
+ * reconnect the SIM and signal checks are skipped and dial-up starts as soon as the modem
+ * reports the same operator and access technology, with the APN and PDP type unchanged.
+ * Any mismatch or failure falls back to the full sequence.
+ */
+#define MODEM_WARM_NVS_NAMESPACE            "modem"
+#define MODEM_WARM_NVS_KEY                  "warm"
+#define MODEM_WARM_VERSION                  1
+
+typedef struct {
+    uint8_t version;
+    uint8_t sim_ready;                      /* SIM passed the PIN check */
+    int8_t act;                             /* access technology of +COPS, -1 if not reported */
+    char oper[32];
+    char pdp_type[8];
+    char apn[64];
+} modem_warm_state_t;
+
+static modem_warm_state_t s_warm_saved;     /* as stored in NVS */
+static modem_warm_state_t s_warm_now;       /* collected during this dial-up */
+static bool s_warm_allowed = true;          /* cleared when a warm attempt failed, set again once got IP */
+#endif
 
 typedef struct {
     esp_modem_dce_t parent;
@@ -365,12 +396,58 @@ static bool _check_signal_quality()
     return false;
 }
 
+typedef struct {
+    char *oper;
+    size_t len;
+    int act;
+} modem_cops_ctx_t;
+
+/* +COPS: <mode>[,<format>,"<oper>"[,<act>]] */
+static esp_err_t _handle_cops(esp_modem_dce_t *dce, const char *line)
+{
+    esp_err_t err = ESP_FAIL;
+    if (strstr(line, MODEM_RESULT_CODE_ERROR)) {
+        return esp_modem_process_command_done(dce, ESP_MODEM_STATE_FAIL);
+    }
+    const char *p = strstr(line, "+COPS");
+    if (p) {
+        modem_cops_ctx_t *ctx = dce->handle_line_ctx;
+        /* operator name may contain spaces and commas, take everything between the quotes */
+        const char *q1 = strchr(p, '"');
+        const char *q2 = q1 ? strchr(q1 + 1, '"') : NULL;
+        if (q2) {
+            snprintf(ctx->oper, ctx->len, "%.*s", (int)(q2 - q1 - 1), q1 + 1);
+            const char *c = strchr(q2, ',');
+            ctx->act = c ? atoi(c + 1) : -1;
+        }
+        err = ESP_OK;
+    }
+    if (strstr(line, MODEM_RESULT_CODE_SUCCESS)) {
+        err = esp_modem_process_command_done(dce, ESP_MODEM_STATE_SUCCESS);
+    }
+    return err;
+}
+
+static esp_err_t _get_operator(char *oper, size_t len, int *act)
+{
+    modem_cops_ctx_t ctx = {.oper = oper, .len = len, .act = -1};
+    oper[0] = '\0';
+    esp_err_t err = esp_modem_dce_generic_command(s_dce, "AT+COPS?\r", MODEM_COMMAND_TIMEOUT_OPERATOR, _handle_cops, &ctx);
+    *act = ctx.act;
+    return err;
+}
+
 static bool _check_network_registration()
 {
     char operater_name[64] = "";
-    if (modem_board_get_operator_state(operater_name, sizeof(operater_name)) == ESP_OK) {
+    int act = -1;
+    if (_get_operator(operater_name, sizeof(operater_name), &act) == ESP_OK) {
         if (strlen(operater_name) > 0) {
-            ESP_LOGI(TAG, "Network registered, Operator: %s", operater_name);
+            ESP_LOGI(TAG, "Network registered, Operator: %s, AcT: %d", operater_name, act);
+#if CONFIG_MODEM_WARM_RESTART
+            strncpy(s_warm_now.oper, operater_name, sizeof(s_warm_now.oper) - 1);
+            s_warm_now.act = act;
+#endif
             return true;
         } else {
             // no operator name, but registered?
@@ -382,6 +459,61 @@ static bool _check_network_registration()
     return false;
 }
 
+#if CONFIG_MODEM_WARM_RESTART
+static void _warm_load(void)
+{
+    nvs_handle_t handle;
+    size_t len = sizeof(s_warm_saved);
+    if (nvs_open(MODEM_WARM_NVS_NAMESPACE, NVS_READONLY, &handle) != ESP_OK) {
+        return;
+    }
+    if (nvs_get_blob(handle, MODEM_WARM_NVS_KEY, &s_warm_saved, &len) != ESP_OK
+            || len != sizeof(s_warm_saved) || s_warm_saved.version != MODEM_WARM_VERSION) {
+        memset(&s_warm_saved, 0, sizeof(s_warm_saved));
+    }
+    nvs_close(handle);
+}
+
+static bool _warm_usable(void)
+{
+    const esp_modem_dce_pdp_ctx_t *pdp = &s_dce->config.pdp_context;
+    return s_warm_allowed && s_warm_saved.version == MODEM_WARM_VERSION && s_warm_saved.sim_ready
+           && s_warm_saved.oper[0] != '\0'
+           && pdp->apn && strcmp(pdp->apn, s_warm_saved.apn) == 0
+           && pdp->type && strcmp(pdp->type, s_warm_saved.pdp_type) == 0;
+}
+
+/* registration checked by the caller: operator and access technology must be the cached ones */
+static bool _warm_match(void)
+{
+    return strcmp(s_warm_now.oper, s_warm_saved.oper) == 0 && s_warm_now.act == s_warm_saved.act;
+}
+
+/* called once got IP, NVS is only written when something changed */
+static void _warm_save(void)
+{
+    const esp_modem_dce_pdp_ctx_t *pdp = &s_dce->config.pdp_context;
+    nvs_handle_t handle;
+    s_warm_allowed = true;
+    s_warm_now.version = MODEM_WARM_VERSION;
+    s_warm_now.sim_ready = 1;
+    strncpy(s_warm_now.pdp_type, pdp->type ? pdp->type : "", sizeof(s_warm_now.pdp_type) - 1);
+    strncpy(s_warm_now.apn, pdp->apn ? pdp->apn : "", sizeof(s_warm_now.apn) - 1);
+    if (memcmp(&s_warm_now, &s_warm_saved, sizeof(s_warm_now)) == 0) {
+        return;
+    }
+    if (nvs_open(MODEM_WARM_NVS_NAMESPACE, NVS_READWRITE, &handle) != ESP_OK) {
+        ESP_LOGW(TAG, "Warm restart state not saved, NVS not ready");
+        return;
+    }
+    if (nvs_set_blob(handle, MODEM_WARM_NVS_KEY, &s_warm_now, sizeof(s_warm_now)) == ESP_OK
+            && nvs_commit(handle) == ESP_OK) {
+        s_warm_saved = s_warm_now;
+    }
+    nvs_close(handle);
+}
+#endif
+
 static bool _ppp_network_start(esp_modem_dte_t *dte)
 {
     dte->dce->mode = ESP_MODEM_TRANSITION_MODE;
@@ -427,6 +559,7 @@ static void _modem_daemon_task(void *param)
     assert(ppp_netif != NULL);
     /* attach driver to ppp interface, start DTE handling */
     s_dce = dce;
+    s_ppp_netif = ppp_netif;
     ESP_ERROR_CHECK(esp_modem_default_attach(dte, dce, ppp_netif));
     ESP_ERROR_CHECK(esp_modem_set_event_handler(dte, on_modem_event, ESP_EVENT_ANY_ID, NULL));
     ESP_ERROR_CHECK(esp_event_handler_register(IP_EVENT, ESP_EVENT_ANY_ID, on_modem_event, NULL));
@@ -437,6 +570,10 @@ static void _modem_daemon_task(void *param)
     int retry_after_ms = 0;
     const int RETRY_TIMEOUT = CONFIG_MODEM_DIAL_RETRY_TIMES;
     _modem_stage_t modem_stage = STAGE_SYNC;
+#if CONFIG_MODEM_WARM_RESTART
+    bool warm = false;      /* dialing with the abbreviated sequence */
+    _warm_load();
+#endif
     while (true) {
         /********************************** handle external event *********************************************************/
         EventBits_t bits = xEventGroupWaitBits(s_modem_evt_hdl, (PPP_NET_MODE_ON_BIT | PPP_NET_MODE_OFF_BIT | DTE_USB_RECONNECT_BIT | DTE_USB_DISCONNECT_BIT | PPP_NET_RECONNECTING_BIT |
@@ -564,6 +701,13 @@ static void _modem_daemon_task(void *param)
                     esp_event_post(MODEM_BOARD_EVENT, MODEM_EVENT_NET_DISCONN, NULL, 0, 0);
                     xEventGroupSetBits(s_modem_evt_hdl, PPP_NET_RECONNECTING_BIT);
                     modem_stage = STAGE_CHECK_SIM;
+#if CONFIG_MODEM_WARM_RESTART
+                    warm = _warm_usable();
+                    if (warm) {
+                        ESP_LOGI(TAG, "Warm restart, expecting operator %s, AcT %d", s_warm_saved.oper, s_warm_saved.act);
+                        modem_stage = STAGE_CHECK_REGIST;
+                    }
+#endif
                 }
                 goto _stage_succeed;
             }
@@ -596,6 +740,22 @@ static void _modem_daemon_task(void *param)
             }
             break;
         case STAGE_CHECK_REGIST:
+#if CONFIG_MODEM_WARM_RESTART
+            if (warm) {
+                warm = false;
+                if (_check_network_registration() == true && _warm_match()) {
+                    /* registered implies the SIM is ready, keep warm set until dial-up succeeded */
+                    esp_event_post(MODEM_BOARD_EVENT, MODEM_EVENT_SIMCARD_CONN, NULL, 0, 0);
+                    warm = true;
+                    modem_stage = STAGE_START_PPP;
+                    goto _stage_succeed;
+                }
+                /* not registered yet, or registered elsewhere: full sequence, no retry counted */
+                ESP_LOGW(TAG, "Warm restart not possible, checking from SIM");
+                modem_stage = STAGE_CHECK_SIM;
+                break;
+            }
+#endif
             if (_check_network_registration() != true)  {
                 retry_after_ms = 3000;
                 ++stage_retry_times;
@@ -608,6 +768,14 @@ static void _modem_daemon_task(void *param)
             if (_ppp_network_start(dte) != true)  {
                 retry_after_ms = 3000;
                 ++stage_retry_times;
+#if CONFIG_MODEM_WARM_RESTART
+                if (warm) {
+                    /* restart with the full sequence */
+                    warm = false;
+                    s_warm_allowed = false;
+                    stage_retry_times = RETRY_TIMEOUT;
+                }
+#endif
             } else {
                 modem_stage = STAGE_WAIT_IP;
                 goto _stage_succeed;
@@ -622,10 +790,18 @@ static void _modem_daemon_task(void *param)
             if (con_bits & PPP_NET_CONNECT_BIT) {
                 xEventGroupClearBits(s_modem_evt_hdl, PPP_NET_RECONNECTING_BIT);
                 esp_event_post(MODEM_BOARD_EVENT, MODEM_EVENT_NET_CONN, NULL, 0, 0);
+#if CONFIG_MODEM_WARM_RESTART
+                warm = false;
+                _warm_save();
+#endif
                 modem_stage = STAGE_RUNNING;
                 goto _stage_succeed;
             } else {
                 stage_retry_times = RETRY_TIMEOUT;
+#if CONFIG_MODEM_WARM_RESTART
+                warm = false;
+                s_warm_allowed = false;
+#endif
                 ESP_LOGW(TAG, "Modem Got IP timeout, retry from start!");
             }
         }
@@ -690,11 +866,26 @@ esp_err_t modem_board_get_dns_info(esp_netif_dns_type_t type, esp_netif_dns_info
     return ESP_OK;
 }
 
+esp_netif_t *modem_board_get_netif(void)
+{
+    return s_ppp_netif;
+}
+
 esp_err_t modem_board_get_signal_quality(int *rssi, int *ber)
 {
     MODEM_CHECK(s_dce != NULL, "modem not ready", ESP_ERR_INVALID_STATE);
-    esp_modem_dce_csq_ctx_t result;
-    esp_err_t err = esp_modem_dce_get_signal_quality(s_dce, NULL, &result);
+    esp_modem_dce_csq_ctx_t result = s_last_csq;
+    esp_err_t err = ESP_OK;
+#ifndef CONFIG_MODEM_SUPPORT_SECONDARY_AT_PORT
+    /* the only AT interface carries ppp data, do not break the link for a query */
+    if (s_dce->mode != ESP_MODEM_PPP_MODE)
+#endif
+    {
+        err = esp_modem_dce_get_signal_quality(s_dce, NULL, &result);
+        if (err == ESP_OK) {
+            s_last_csq = result;
+        }
+    }
     if (err == ESP_OK) {
         if (rssi) {
             *rssi = result.rssi;
@@ -0,0 +1,135 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb/usb_types_ch9.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Indexed view of a configuration descriptor, shared by the USB host class drivers
+ *
+ * The configuration descriptor is walked once, interfaces (one entry per alternate setting),
+ * endpoints and UVC formats/frames are recorded in compact tables. Entries keep the offset of
+ * their descriptor, use the USB_DESC_INDEX_PTR to get it back from the configuration descriptor.
+ *
+ * Indexes are cached by the content of the configuration descriptor, enumerating the same
+ * device again returns the cached index without parsing.
+ */
+
+/**
+ * @brief Get a descriptor of the configuration descriptor by its offset
+ */
+#define USB_DESC_INDEX_PTR(cfg_desc, offset) ((const void *)((const uint8_t *)(cfg_desc) + (offset)))
+
+typedef struct {
+    uint16_t offset;            /*!< Offset of the interface descriptor */
+    uint16_t end;               /*!< Offset after the last descriptor belonging to this alternate setting */
+    uint8_t num;                /*!< bInterfaceNumber */
+    uint8_t alt;                /*!< bAlternateSetting */
+    uint8_t cls;                /*!< bInterfaceClass */
+    uint8_t subclass;           /*!< bInterfaceSubClass */
+    uint8_t protocol;           /*!< bInterfaceProtocol */
+    uint8_t ep_num;             /*!< Number of endpoints found */
+    uint8_t fmt_num;            /*!< Number of UVC formats found */
+    uint16_t ep_first;          /*!< Index of the first endpoint in usb_desc_index_t.eps */
+    uint16_t fmt_first;         /*!< Index of the first format in usb_desc_index_t.fmts */
+} usb_desc_intf_t;
+
+typedef struct {
+    uint16_t offset;            /*!< Offset of the endpoint descriptor */
+    uint16_t mps;               /*!< wMaxPacketSize, including the additional transactions bits */
+    uint8_t addr;               /*!< bEndpointAddress */
+    uint8_t attr;               /*!< bmAttributes */
+    uint8_t interval;           /*!< bInterval */
+} usb_desc_ep_t;
+
+typedef struct {
+    uint16_t offset;            /*!< Offset of the VS format descriptor */
+    uint8_t subtype;            /*!< bDescriptorSubtype, VS_FORMAT_MJPEG, VS_FORMAT_UNCOMPRESSED, VS_FORMAT_FRAME_BASED... */
+    uint8_t index;              /*!< bFormatIndex */
+    uint8_t frame_num_declared; /*!< bNumFrameDescriptors */
+    uint8_t frame_index_max;    /*!< Largest bFrameIndex of the frames, size tables indexed by bFrameIndex with it */
+    uint8_t frame_num;          /*!< Number of frame descriptors actually following the format */
+    uint16_t frame_first;       /*!< Index of the first frame in usb_desc_index_t.frames */
+} usb_desc_uvc_format_t;
+
+typedef struct {
+    uint16_t offset;            /*!< Offset of the VS frame descriptor */
+    uint8_t subtype;            /*!< bDescriptorSubtype */
+    uint8_t index;              /*!< bFrameIndex */
+    uint16_t width;             /*!< wWidth */
+    uint16_t height;            /*!< wHeight */
+    uint8_t interval_type;      /*!< bFrameIntervalType, 0 for continuous */
+    uint32_t interval_default;  /*!< dwDefaultFrameInterval */
+    uint32_t interval_min;      /*!< Smallest frame interval */
+    uint32_t interval_max;      /*!< Largest frame interval */
+    uint32_t interval_step;     /*!< dwFrameIntervalStep if continuous, 0 if discrete */
+} usb_desc_uvc_frame_t;
+
+typedef struct {
+    uint16_t total_length;      /*!< wTotalLength of the indexed configuration descriptor */
+    uint16_t intf_num;          /*!< Number of interface descriptors (alternate settings) */
+    uint16_t ep_num;            /*!< Number of endpoint descriptors */
+    uint16_t fmt_num;           /*!< Number of UVC format descriptors */
+    uint16_t frame_num;         /*!< Number of UVC frame descriptors */
+    const usb_desc_intf_t *intfs;
+    const usb_desc_ep_t *eps;
+    const usb_desc_uvc_format_t *fmts;
+    const usb_desc_uvc_frame_t *frames;
+} usb_desc_index_t;
+
+/**
+ * @brief Get the index of a configuration descriptor, build it if not cached
+ *
+ * @param cfg_desc Configuration descriptor, wTotalLength bytes
+ * @param[out] index Index, release with usb_desc_index_release
+ * @return
+ *     - ESP_OK: Success
+ *     - ESP_ERR_INVALID_ARG: Invalid argument
+ *     - ESP_ERR_INVALID_SIZE: Malformed descriptor
+ *     - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t usb_desc_index_get(const usb_config_desc_t *cfg_desc, const usb_desc_index_t **index);
+
+/**
+ * @brief Release an index got by usb_desc_index_get
+ *
+ * Entries and pointers got from the index are invalid after it's released.
+ *
+ * @param index Index
+ */
+void usb_desc_index_release(const usb_desc_index_t *index);
+
+/**
+ * @brief Find an interface by number and alternate setting
+ *
+ * @param index Index
+ * @param num bInterfaceNumber
+ * @param alt bAlternateSetting
+ * @return Interface entry, NULL if not found
+ */
+const usb_desc_intf_t *usb_desc_index_find_intf(const usb_desc_index_t *index, uint8_t num, uint8_t alt);
+
+/**
+ * @brief Get the i-th frame interval of a discrete frame, or the min/max/step of a continuous frame
+ *
+ * @param cfg_desc Configuration descriptor the index is built from
+ * @param frame Frame entry
+ * @param i Index of the interval, less than interval_type (3 if continuous)
+ * @return Frame interval in 100ns, 0 if out of range
+ */
+uint32_t usb_desc_index_frame_interval(const usb_config_desc_t *cfg_desc, const usb_desc_uvc_frame_t *frame, uint8_t i);
+
+#ifdef __cplusplus
+}
+#endif
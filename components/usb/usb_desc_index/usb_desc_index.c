@@ -0,0 +1,357 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "freertos/FreeRTOS.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "usb_desc_index.h"
+
+static const char *TAG = "usb_desc_index";
+
+#define CS_INTERFACE_DESC               0x24
+#define VIDEO_SUBCLASS_STREAMING        0x02
+#define VS_FORMAT_UNCOMPRESSED          0x04
+#define VS_FRAME_UNCOMPRESSED           0x05
+#define VS_FORMAT_MJPEG                 0x06
+#define VS_FRAME_MJPEG                  0x07
+#define VS_FORMAT_FRAME_BASED           0x10
+#define VS_FRAME_FRAME_BASED            0x11
+
+#define VS_FORMAT_MIN_LEN               6       /*!< up to bNumFrameDescriptors */
+#define VS_FRAME_INTERVALS_OFFSET       26      /*!< dwFrameInterval[] of all the frame descriptors above */
+
+#define USB_DESC_INDEX_CACHE_NUM        CONFIG_USB_DESC_INDEX_CACHE_NUM
+
+/**
+ * @brief Index with its tables in one allocation
+ */
+typedef struct {
+    usb_desc_index_t pub;
+    uint32_t crc;               /*!< crc32 of the configuration descriptor, cache key with total_length */
+    uint32_t stamp;             /*!< last use, for LRU eviction */
+    uint16_t refs;
+    bool cached;
+} _desc_index_t;
+
+typedef struct {
+    uint16_t intf_num;
+    uint16_t ep_num;
+    uint16_t fmt_num;
+    uint16_t frame_num;
+} _desc_count_t;
+
+#if USB_DESC_INDEX_CACHE_NUM
+static _desc_index_t *s_cache[USB_DESC_INDEX_CACHE_NUM];
+static uint32_t s_cache_stamp = 0;
+#endif
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static inline uint16_t _get_u16(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t _get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static inline bool _is_vs_format(uint8_t subtype)
+{
+    return subtype == VS_FORMAT_MJPEG || subtype == VS_FORMAT_UNCOMPRESSED || subtype == VS_FORMAT_FRAME_BASED;
+}
+
+static inline bool _is_vs_frame(uint8_t subtype)
+{
+    return subtype == VS_FRAME_MJPEG || subtype == VS_FRAME_UNCOMPRESSED || subtype == VS_FRAME_FRAME_BASED;
+}
+
+/**
+ * @brief Count the entries to size the tables, only descriptor headers are read
+ */
+static esp_err_t _desc_count(const uint8_t *desc, uint16_t total, _desc_count_t *count)
+{
+    bool in_vs = false;
+    for (uint16_t offset = 0; offset + 2 <= total;) {
+        uint8_t len = desc[offset];
+        if (len < 2 || offset + len > total) {
+            ESP_LOGE(TAG, "Malformed descriptor at %u/%u, bLength %u", offset, total, len);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        switch (desc[offset + 1]) {
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE:
+            if (len < sizeof(usb_intf_desc_t)) {
+                return ESP_ERR_INVALID_SIZE;
+            }
+            count->intf_num++;
+            in_vs = desc[offset + 5] == USB_CLASS_VIDEO && desc[offset + 6] == VIDEO_SUBCLASS_STREAMING;
+            break;
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
+            count->ep_num += (count->intf_num && len >= sizeof(usb_ep_desc_t));
+            break;
+        case CS_INTERFACE_DESC:
+            if (in_vs && len >= 3) {
+                count->fmt_num += _is_vs_format(desc[offset + 2]);
+                count->frame_num += _is_vs_frame(desc[offset + 2]);
+            }
+            break;
+        default:
+            break;
+        }
+        offset += len;
+    }
+    return ESP_OK;
+}
+
+static bool _parse_frame(const uint8_t *p, usb_desc_uvc_frame_t *frame)
+{
+    uint8_t len = p[0];
+    uint8_t dflt_offset = (p[2] == VS_FRAME_FRAME_BASED) ? 17 : 21;
+    if (len < VS_FRAME_INTERVALS_OFFSET) {
+        return false;
+    }
+    frame->subtype = p[2];
+    frame->index = p[3];
+    frame->width = _get_u16(&p[5]);
+    frame->height = _get_u16(&p[7]);
+    frame->interval_default = _get_u32(&p[dflt_offset]);
+    frame->interval_type = p[dflt_offset + 4];
+    const uint8_t *intervals = &p[VS_FRAME_INTERVALS_OFFSET];
+    size_t interval_num = frame->interval_type ? frame->interval_type : 3;
+    if (len < VS_FRAME_INTERVALS_OFFSET + interval_num * 4) {
+        return false;
+    }
+    if (frame->interval_type == 0) {
+        frame->interval_min = _get_u32(&intervals[0]);
+        frame->interval_max = _get_u32(&intervals[4]);
+        frame->interval_step = _get_u32(&intervals[8]);
+        return true;
+    }
+    frame->interval_min = UINT32_MAX;
+    frame->interval_max = 0;
+    frame->interval_step = 0;
+    for (size_t i = 0; i < interval_num; i++) {
+        uint32_t interval = _get_u32(&intervals[i * 4]);
+        frame->interval_min = interval < frame->interval_min ? interval : frame->interval_min;
+        frame->interval_max = interval > frame->interval_max ? interval : frame->interval_max;
+    }
+    return true;
+}
+
+static esp_err_t _desc_index_build(const usb_config_desc_t *cfg_desc, uint32_t crc, _desc_index_t **index_ret)
+{
+    const uint8_t *desc = (const uint8_t *)cfg_desc;
+    uint16_t total = cfg_desc->wTotalLength;
+    _desc_count_t count = {0};
+    esp_err_t ret = _desc_count(desc, total, &count);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    size_t size = sizeof(_desc_index_t) + count.intf_num * sizeof(usb_desc_intf_t) + count.ep_num * sizeof(usb_desc_ep_t)
+                  + count.fmt_num * sizeof(usb_desc_uvc_format_t) + count.frame_num * sizeof(usb_desc_uvc_frame_t);
+    _desc_index_t *index = heap_caps_calloc(1, size, MALLOC_CAP_DEFAULT);
+    if (index == NULL) {
+        ESP_LOGE(TAG, "No memory for descriptor index, %u bytes", size);
+        return ESP_ERR_NO_MEM;
+    }
+    // frames first, they are the only entries with 32 bit members
+    usb_desc_uvc_frame_t *frames = (usb_desc_uvc_frame_t *)(index + 1);
+    usb_desc_intf_t *intfs = (usb_desc_intf_t *)(frames + count.frame_num);
+    usb_desc_ep_t *eps = (usb_desc_ep_t *)(intfs + count.intf_num);
+    usb_desc_uvc_format_t *fmts = (usb_desc_uvc_format_t *)(eps + count.ep_num);
+    usb_desc_index_t *pub = &index->pub;
+    pub->total_length = total;
+    pub->intfs = intfs;
+    pub->eps = eps;
+    pub->fmts = fmts;
+    pub->frames = frames;
+    index->crc = crc;
+
+    usb_desc_intf_t *intf = NULL;
+    usb_desc_uvc_format_t *fmt = NULL;
+    for (uint16_t offset = 0; offset + 2 <= total; offset += desc[offset]) {
+        const uint8_t *p = &desc[offset];
+        switch (p[1]) {
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE: {
+            const usb_intf_desc_t *intf_desc = (const usb_intf_desc_t *)p;
+            if (intf) {
+                intf->end = offset;
+            }
+            intf = &intfs[pub->intf_num++];
+            intf->offset = offset;
+            intf->num = intf_desc->bInterfaceNumber;
+            intf->alt = intf_desc->bAlternateSetting;
+            intf->cls = intf_desc->bInterfaceClass;
+            intf->subclass = intf_desc->bInterfaceSubClass;
+            intf->protocol = intf_desc->bInterfaceProtocol;
+            intf->ep_first = pub->ep_num;
+            intf->fmt_first = pub->fmt_num;
+            fmt = NULL;
+            break;
+        }
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT: {
+            if (intf == NULL || p[0] < sizeof(usb_ep_desc_t)) {
+                break;
+            }
+            const usb_ep_desc_t *ep_desc = (const usb_ep_desc_t *)p;
+            usb_desc_ep_t *ep = &eps[pub->ep_num++];
+            ep->offset = offset;
+            ep->addr = ep_desc->bEndpointAddress;
+            ep->attr = ep_desc->bmAttributes;
+            ep->mps = ep_desc->wMaxPacketSize;
+            ep->interval = ep_desc->bInterval;
+            intf->ep_num++;
+            break;
+        }
+        case CS_INTERFACE_DESC:
+            if (intf == NULL || intf->cls != USB_CLASS_VIDEO || intf->subclass != VIDEO_SUBCLASS_STREAMING || p[0] < 3) {
+                break;
+            }
+            if (_is_vs_format(p[2])) {
+                if (p[0] < VS_FORMAT_MIN_LEN) {
+                    fmt = NULL;
+                    break;
+                }
+                fmt = &fmts[pub->fmt_num++];
+                fmt->offset = offset;
+                fmt->subtype = p[2];
+                fmt->index = p[3];
+                fmt->frame_num_declared = p[4];
+                fmt->frame_first = pub->frame_num;
+                intf->fmt_num++;
+            } else if (_is_vs_frame(p[2]) && fmt) {
+                usb_desc_uvc_frame_t *frame = &frames[pub->frame_num];
+                if (!_parse_frame(p, frame) || frame->index == 0) {
+                    ESP_LOGW(TAG, "Skip malformed frame descriptor at %u", offset);
+                    memset(frame, 0, sizeof(*frame));
+                    break;
+                }
+                frame->offset = offset;
+                pub->frame_num++;
+                fmt->frame_num++;
+                if (frame->index > fmt->frame_index_max) {
+                    fmt->frame_index_max = frame->index;
+                }
+            }
+            break;
+        default:
+            break;
+        }
+    }
+    if (intf) {
+        intf->end = total;
+    }
+
+    for (size_t i = 0; i < pub->fmt_num; i++) {
+        if (fmts[i].frame_num != fmts[i].frame_num_declared || fmts[i].frame_index_max != fmts[i].frame_num_declared) {
+            ESP_LOGW(TAG, "Format %u declares %u frames, %u found, max frame index %u", fmts[i].index,
+                     fmts[i].frame_num_declared, fmts[i].frame_num, fmts[i].frame_index_max);
+        }
+    }
+    ESP_LOGD(TAG, "Indexed %u bytes: %u interfaces, %u endpoints, %u formats, %u frames", total,
+             pub->intf_num, pub->ep_num, pub->fmt_num, pub->frame_num);
+    *index_ret = index;
+    return ESP_OK;
+}
+
+esp_err_t usb_desc_index_get(const usb_config_desc_t *cfg_desc, const usb_desc_index_t **index)
+{
+    if (cfg_desc == NULL || index == NULL || cfg_desc->bDescriptorType != USB_B_DESCRIPTOR_TYPE_CONFIGURATION) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    uint16_t total = cfg_desc->wTotalLength;
+    uint32_t crc = esp_rom_crc32_le(0, (const uint8_t *)cfg_desc, total);
+
+#if USB_DESC_INDEX_CACHE_NUM
+    portENTER_CRITICAL(&s_lock);
+    for (size_t i = 0; i < USB_DESC_INDEX_CACHE_NUM; i++) {
+        _desc_index_t *entry = s_cache[i];
+        if (entry && entry->crc == crc && entry->pub.total_length == total) {
+            entry->refs++;
+            entry->stamp = ++s_cache_stamp;
+            portEXIT_CRITICAL(&s_lock);
+            *index = &entry->pub;
+            ESP_LOGD(TAG, "Index cache hit, %u bytes", total);
+            return ESP_OK;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+#endif
+
+    _desc_index_t *entry = NULL;
+    esp_err_t ret = _desc_index_build(cfg_desc, crc, &entry);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    entry->refs = 1;
+
+#if USB_DESC_INDEX_CACHE_NUM
+    // take an empty slot, or evict the least recently used idle entry
+    _desc_index_t *evicted = NULL;
+    portENTER_CRITICAL(&s_lock);
+    int slot = -1;
+    for (size_t i = 0; i < USB_DESC_INDEX_CACHE_NUM; i++) {
+        if (s_cache[i] == NULL) {
+            slot = i;
+            break;
+        }
+        if (s_cache[i]->refs == 0 && (slot < 0 || s_cache[i]->stamp < s_cache[slot]->stamp)) {
+            slot = i;
+        }
+    }
+    if (slot >= 0) {
+        evicted = s_cache[slot];
+        s_cache[slot] = entry;
+        entry->cached = true;
+        entry->stamp = ++s_cache_stamp;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    heap_caps_free(evicted);
+#endif
+    *index = &entry->pub;
+    return ESP_OK;
+}
+
+void usb_desc_index_release(const usb_desc_index_t *index)
+{
+    if (index == NULL) {
+        return;
+    }
+    _desc_index_t *entry = __containerof(index, _desc_index_t, pub);
+    portENTER_CRITICAL(&s_lock);
+    bool free_it = (--entry->refs == 0 && !entry->cached);
+    portEXIT_CRITICAL(&s_lock);
+    if (free_it) {
+        heap_caps_free(entry);
+    }
+}
+
+const usb_desc_intf_t *usb_desc_index_find_intf(const usb_desc_index_t *index, uint8_t num, uint8_t alt)
+{
+    if (index == NULL) {
+        return NULL;
+    }
+    for (size_t i = 0; i < index->intf_num; i++) {
+        if (index->intfs[i].num == num && index->intfs[i].alt == alt) {
+            return &index->intfs[i];
+        }
+    }
+    return NULL;
+}
+
+uint32_t usb_desc_index_frame_interval(const usb_config_desc_t *cfg_desc, const usb_desc_uvc_frame_t *frame, uint8_t i)
+{
+    if (cfg_desc == NULL || frame == NULL || i >= (frame->interval_type ? frame->interval_type : 3)) {
+        return 0;
+    }
+    const uint8_t *p = USB_DESC_INDEX_PTR(cfg_desc, frame->offset);
+    return _get_u32(&p[VS_FRAME_INTERVALS_OFFSET + i * 4]);
+}
@@ -32,6 +32,17 @@ typedef struct  {
     void *cb_ctx;                                /*!< callback context, for user specific usage */
 } uac_device_config_t;
 
+/**
+ * @brief USB UAC Device streaming counters, counted since uac_device_init()
+ *
+ */
+typedef struct {
+    uint32_t spk_underrun;                       /*!< speaker FIFO had less than one chunk while the host was streaming */
+    uint32_t spk_overrun;                        /*!< speaker packets received while the FIFO was full, older audio was dropped */
+    uint32_t mic_underrun;                       /*!< microphone FIFO ran empty, the host got a short packet */
+    uint32_t mic_overrun;                        /*!< microphone chunks dropped because the FIFO had no room */
+} uac_device_stats_t;
+
 /**
  * @brief Initialize the USB Audio Class (UAC) device.
  *
@@ -42,6 +53,17 @@ typedef struct  {
  */
 esp_err_t uac_device_init(uac_device_config_t *config);
 
+/**
+ * @brief Get the UAC device streaming counters.
+ *
+ * @param stats Pointer to the structure to fill.
+ * @return
+ *       - ESP_OK on success
+ *       - ESP_ERR_INVALID_ARG if stats is NULL
+ *       - ESP_ERR_INVALID_STATE if the device is not initialized
+ */
+esp_err_t uac_device_get_stats(uac_device_stats_t *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,42 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief What the speaker task does next with the OUT FIFO
+ *
+ */
+typedef enum {
+    UAC_SPK_FIFO_PLAY,                          /*!< read one chunk and hand it to output_cb */
+    UAC_SPK_FIFO_PREFILL,                       /*!< wait, the FIFO is refilling to the start level */
+    UAC_SPK_FIFO_UNDERRUN,                      /*!< less than one chunk left while the host was streaming, refilling starts */
+} uac_spk_fifo_action_t;
+
+/**
+ * @brief Decide the next speaker step from the OUT FIFO level
+ *
+ * Playback starts, and restarts after running dry, once the FIFO holds half of its depth, the level the
+ * FIFO count feedback regulates to (at least one chunk). Pure function, no TinyUSB or RTOS dependency.
+ *
+ * @param prefill   In/out: true while refilling, updated by this call
+ * @param level     Bytes currently in the FIFO
+ * @param depth     FIFO depth in bytes
+ * @param chunk     Bytes read per step
+ * @param streaming The host sent data recently, running dry counts as an underrun
+ */
+uac_spk_fifo_action_t uac_spk_fifo_next(bool *prefill, size_t level, size_t depth, size_t chunk, bool streaming);
+
+#ifdef __cplusplus
+}
+#endif
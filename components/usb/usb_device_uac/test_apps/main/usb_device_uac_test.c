@@ -5,6 +5,7 @@
  */
 
 #include <stdio.h>
+#include <string.h>
 #include "unity.h"
 #include "unity_test_runner.h"
 #include "unity_test_utils_memory.h"
@@ -39,6 +40,28 @@ TEST_CASE("usb_device_uac_test", "[usb_device_uac]")
     uac_device_init(&config);
 }
 
+TEST_CASE("usb_device_uac_stats_test", "[usb_device_uac]")
+{
+    TEST_ASSERT_EQUAL(ESP_ERR_INVALID_ARG, uac_device_get_stats(NULL));
+
+    uac_device_config_t config = {
+        .output_cb = uac_device_output_cb,
+        .input_cb = uac_device_input_cb,
+        .cb_ctx = NULL,
+    };
+    // Returns ESP_OK as well when the previous test case already started the device
+    TEST_ASSERT_EQUAL(ESP_OK, uac_device_init(&config));
+
+    // No host streams audio here, so every counter stays at zero
+    uac_device_stats_t stats;
+    memset(&stats, 0xFF, sizeof(stats));
+    TEST_ASSERT_EQUAL(ESP_OK, uac_device_get_stats(&stats));
+    TEST_ASSERT_EQUAL_UINT32(0, stats.spk_underrun);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.spk_overrun);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.mic_underrun);
+    TEST_ASSERT_EQUAL_UINT32(0, stats.mic_overrun);
+}
+
 static size_t before_free_8bit;
 static size_t before_free_32bit;
 
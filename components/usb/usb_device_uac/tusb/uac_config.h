@@ -17,6 +17,22 @@ extern "C" {
 #define SPK_INTERVAL_MS      CONFIG_UAC_SPK_INTERVAL_MS      /*!< READ INTERVAL in ms*/
 #define MIC_INTERVAL_MS      CONFIG_UAC_MIC_INTERVAL_MS      /*!< WRITE INTERVAL in ms*/
 
+#if CONFIG_UAC_SPK_FIFO_MS
+#define SPK_FIFO_MS          CONFIG_UAC_SPK_FIFO_MS          /*!< SPK FIFO depth in ms */
+#else
+#define SPK_FIFO_MS          (SPK_INTERVAL_MS + 1)
+#endif
+
+#if CONFIG_UAC_MIC_FIFO_MS
+#define MIC_FIFO_MS          CONFIG_UAC_MIC_FIFO_MS          /*!< MIC FIFO depth in ms */
+#else
+#define MIC_FIFO_MS          (MIC_INTERVAL_MS + 1)
+#endif
+
+#if SPK_FIFO_MS < 2 || MIC_FIFO_MS <= MIC_INTERVAL_MS
+#error "UAC FIFO must hold more than one MIC interval and at least 2 ms of SPK audio"
+#endif
+
 #define IN_CTRL_CH_VALUE U32_TO_U8S_LE(AUDIO_CTRL_RW << AUDIO_FEATURE_UNIT_CTRL_MUTE_POS | AUDIO_CTRL_RW << AUDIO_FEATURE_UNIT_CTRL_VOLUME_POS)
 
 #if SPEAK_CHANNEL_NUM == 1
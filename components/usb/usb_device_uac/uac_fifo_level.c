@@ -0,0 +1,24 @@
+/*
+ * SPDX-FileCopyrightText: 2026 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include "uac_fifo_level.h"
+
+uac_spk_fifo_action_t uac_spk_fifo_next(bool *prefill, size_t level, size_t depth, size_t chunk, bool streaming)
+{
+    size_t start = depth / 2 > chunk ? depth / 2 : chunk;
+    if (*prefill) {
+        if (level < start) {
+            return UAC_SPK_FIFO_PREFILL;
+        }
+        *prefill = false;
+    }
+    if (level < chunk) {
+        // Refill to the start level instead of playing every packet as it arrives
+        *prefill = true;
+        return streaming ? UAC_SPK_FIFO_UNDERRUN : UAC_SPK_FIFO_PREFILL;
+    }
+    return UAC_SPK_FIFO_PLAY;
+}
@@ -16,6 +16,7 @@
 #include "uac_config.h"
 #include "usb_device_uac.h"
 #include "uac_descriptors.h"
+#include "uac_fifo_level.h"
 
 static const char *TAG = "usbd_uac";
 
@@ -23,6 +24,13 @@ const uint32_t sample_rates[] = {DEFAULT_SAMPLE_RATE};
 
 #define N_SAMPLE_RATES  TU_ARRAY_SIZE(sample_rates)
 
+// A new playback starts when no speaker data arrived for this long
+#define SPK_NEW_PLAY_US (100 * CONFIG_UAC_SPK_NEW_PLAY_INTERVAL)
+
+// The chunk buffers only need one interval, the FIFO depth may be larger
+#define MIC_BUF_SZ      (CFG_TUD_AUDIO_FUNC_1_FORMAT_1_EP_SZ_IN * (MIC_INTERVAL_MS + 1))
+#define SPK_BUF_SZ      (CFG_TUD_AUDIO_FUNC_1_FORMAT_1_EP_SZ_OUT * (SPK_INTERVAL_MS + 1))
+
 enum {
     VOLUME_CTRL_0_DB = 0,
     VOLUME_CTRL_10_DB = 2560,
@@ -47,9 +55,9 @@ typedef struct {
     uac_device_config_t user_cfg;
     int8_t mute[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX + 1];         // +1 for master channel 0
     int16_t volume[CFG_TUD_AUDIO_FUNC_1_N_CHANNELS_TX + 1];      // +1 for master channel 0
-    int16_t mic_buf1[CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ / 2];  // Buffer for microphone data
-    int16_t mic_buf2[CFG_TUD_AUDIO_FUNC_1_EP_IN_SW_BUF_SZ / 2];  // Buffer for microphone data
-    int16_t spk_buf[CFG_TUD_AUDIO_FUNC_1_EP_OUT_SW_BUF_SZ / 2];  // Buffer for speaker data
+    int16_t mic_buf1[MIC_BUF_SZ / 2];                            // Buffer for microphone data
+    int16_t mic_buf2[MIC_BUF_SZ / 2];                            // Buffer for microphone data
+    int16_t spk_buf[SPK_BUF_SZ / 2];                             // Buffer for speaker data
     int16_t *mic_buf_write;                                      // Pointer to the buffer to write to
     int16_t *mic_buf_read;                                       // Pointer to the buffer to read from
     int spk_data_size;                                           // Speaker data size received in the last frame
@@ -63,6 +71,10 @@ typedef struct {
     size_t mic_bytes_per_ms;
     bool spk_active;
     bool mic_active;
+    bool spk_prefill;                                            // Speaker FIFO is refilling to half before playback
+    bool mic_primed;                                             // Microphone data has been written since the stream opened
+    int64_t spk_last_rx_us;                                      // Time of the last speaker packet
+    uac_device_stats_t stats;                                    // Each counter has a single writer task
 } uac_device_t;
 
 static uac_device_t *s_uac_device = NULL;
@@ -189,7 +201,7 @@ void tud_audio_feedback_params_cb(uint8_t func_id, uint8_t alt_itf, audio_feedba
 {
     (void)func_id;
     (void)alt_itf;
-    // Set feedback method to fifo counting
+    // Set feedback method to fifo counting, TinyUSB regulates the OUT FIFO to half of its depth
     feedback_param->method = AUDIO_FEEDBACK_METHOD_FIFO_COUNT;
     feedback_param->sample_freq = s_uac_device->current_sample_rate;
 
@@ -340,6 +352,7 @@ bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_reques
         s_uac_device->spk_data_size = 0;
         s_uac_device->spk_resolution = spk_resolutions_per_format[alt - 1];
         s_uac_device->spk_active = true;
+        s_uac_device->spk_prefill = true;
         s_uac_device->spk_bytes_per_ms = s_uac_device->current_sample_rate / 1000 * SPEAK_CHANNEL_NUM * s_uac_device->spk_resolution / 8;
         xTaskNotifyGive(s_uac_device->spk_task_handle);
         TU_LOG1("Speaker interface %d-%d opened", itf, alt);
@@ -351,6 +364,7 @@ bool tud_audio_set_itf_cb(uint8_t rhport, tusb_control_request_t const *p_reques
         s_uac_device->mic_data_size = 0;
         s_uac_device->mic_resolution = mic_resolutions_per_format[alt - 1];
         s_uac_device->mic_active = true;
+        s_uac_device->mic_primed = false;
         s_uac_device->mic_bytes_per_ms = s_uac_device->current_sample_rate / 1000 * MIC_CHANNEL_NUM * s_uac_device->mic_resolution / 8;
         xTaskNotifyGive(s_uac_device->mic_task_handle);
         TU_LOG1("Microphone interface %d-%d opened", itf, alt);
@@ -367,20 +381,38 @@ bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_bytes_received, u
     (void)ep_out;
     (void)cur_alt_setting;
 
-    static bool new_play = false;
-    static int64_t last_time = 0;
     int64_t now = esp_timer_get_time();
 
+    // The FIFO overwrites the oldest data once it is full
+    if (tu_fifo_full(tud_audio_get_ep_out_ff())) {
+        s_uac_device->stats.spk_overrun++;
+    }
+
+#if CONFIG_UAC_SPK_ASYNC_FEEDBACK
+    /**
+     * @brief The speaker task drains the FIFO at the playback clock, the feedback endpoint keeps
+     *        its level around half. Only restart buffering here when a new playback begins.
+     */
+    if (now - s_uac_device->spk_last_rx_us > SPK_NEW_PLAY_US) {
+        tud_audio_clear_ep_out_ff();
+        s_uac_device->spk_prefill = true;
+    }
+    s_uac_device->spk_last_rx_us = now;
+    xTaskNotifyGive(s_uac_device->spk_task_handle);
+    return true;
+#else
+    static bool new_play = false;
+
     /**
      * @brief If no data is received for a certain period, it is considered as the initiation
      *        of a new audio transmission. At this point, the FIFO data is cleared, and a segment
      *        of data is buffered in the I2S.
      */
-    if (now - last_time > 100 * CONFIG_UAC_SPK_NEW_PLAY_INTERVAL) {
+    if (now - s_uac_device->spk_last_rx_us > SPK_NEW_PLAY_US) {
         new_play = true;
         tud_audio_clear_ep_out_ff();
     }
-    last_time = now;
+    s_uac_device->spk_last_rx_us = now;
 
     int bytes_remained = tud_audio_available();
 
@@ -393,11 +425,14 @@ bool tud_audio_rx_done_post_read_cb(uint8_t rhport, uint16_t n_bytes_received, u
             return true;
         }
         new_play = false;
+    } else if (bytes_remained < bytes_require) {
+        s_uac_device->stats.spk_underrun++;
     }
 
     s_uac_device->spk_data_size = tud_audio_read(s_uac_device->spk_buf, bytes_require);
     xTaskNotifyGive(s_uac_device->spk_task_handle);
     return true;
+#endif
 }
 
 bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in, uint8_t cur_alt_setting)
@@ -409,6 +444,11 @@ bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in, u
     size_t bytes_require = MIC_INTERVAL_MS * s_uac_device->mic_bytes_per_ms;
 
     tu_fifo_t *sw_in_fifo = tud_audio_get_ep_in_ff();
+    if (s_uac_device->mic_primed && s_uac_device->mic_data_size == 0 &&
+            tu_fifo_count(sw_in_fifo) < s_uac_device->mic_bytes_per_ms) {
+        // The next IN packet will be short
+        s_uac_device->stats.mic_underrun++;
+    }
     uint16_t fifo_remained = tu_fifo_remaining(sw_in_fifo);
     if (fifo_remained < bytes_require) {
         return true;
@@ -419,6 +459,7 @@ bool tud_audio_tx_done_pre_load_cb(uint8_t rhport, uint8_t itf, uint8_t ep_in, u
     if (s_uac_device->mic_data_size > 0) {
         tud_audio_write((void *)s_uac_device->mic_buf_read, s_uac_device->mic_data_size);
         s_uac_device->mic_data_size = 0;
+        s_uac_device->mic_primed = true;
     }
     UAC_EXIT_CRITICAL();
 
@@ -433,6 +474,28 @@ static void usb_spk_task(void *pvParam)
             ulTaskNotifyTake(pdFAIL, portMAX_DELAY);
             continue;
         }
+#if CONFIG_UAC_SPK_ASYNC_FEEDBACK
+        tu_fifo_t *ep_out_ff = tud_audio_get_ep_out_ff();
+        size_t bytes_require = s_uac_device->spk_bytes_per_ms;
+        bool streaming = esp_timer_get_time() - s_uac_device->spk_last_rx_us <= SPK_NEW_PLAY_US;
+        switch (uac_spk_fifo_next(&s_uac_device->spk_prefill, tu_fifo_count(ep_out_ff),
+                                  tu_fifo_depth(ep_out_ff), bytes_require, streaming)) {
+        case UAC_SPK_FIFO_UNDERRUN:
+            s_uac_device->stats.spk_underrun++;
+        // fall through
+        case UAC_SPK_FIFO_PREFILL:
+            // Start at the FIFO level the feedback endpoint regulates to
+            ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(SPK_INTERVAL_MS));
+            continue;
+        default:
+            break;
+        }
+        int bytes_read = tud_audio_read(s_uac_device->spk_buf, bytes_require);
+        // output_cb blocks at the playback rate and paces the FIFO drain
+        if (s_uac_device->user_cfg.output_cb) {
+            s_uac_device->user_cfg.output_cb((uint8_t *)s_uac_device->spk_buf, bytes_read, s_uac_device->user_cfg.cb_ctx);
+        }
+#else
         // clear the notification
         ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
         if (s_uac_device->spk_data_size == 0) {
@@ -443,6 +506,7 @@ static void usb_spk_task(void *pvParam)
             s_uac_device->user_cfg.output_cb((uint8_t *)s_uac_device->spk_buf, s_uac_device->spk_data_size, s_uac_device->user_cfg.cb_ctx);
         }
         s_uac_device->spk_data_size = 0;
+#endif
     }
 }
 #endif
@@ -468,6 +532,10 @@ static void usb_mic_task(void *pvParam)
             }
             int16_t *tmp_buf = s_uac_device->mic_buf_write;
             UAC_ENTER_CRITICAL();
+            if (s_uac_device->mic_data_size > 0) {
+                // The previous chunk never fit into the FIFO
+                s_uac_device->stats.mic_overrun++;
+            }
             s_uac_device->mic_buf_write = s_uac_device->mic_buf_read;
             s_uac_device->mic_buf_read = tmp_buf;
             s_uac_device->mic_data_size = bytes_read;
@@ -523,3 +591,13 @@ esp_err_t uac_device_init(uac_device_config_t *config)
     ESP_LOGI(TAG, "UAC Device Start, Version: %d.%d.%d", USB_DEVICE_UAC_VER_MAJOR, USB_DEVICE_UAC_VER_MINOR, USB_DEVICE_UAC_VER_PATCH);
     return ESP_OK;
 }
+
+esp_err_t uac_device_get_stats(uac_device_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(stats != NULL, ESP_ERR_INVALID_ARG, TAG, "stats is NULL");
+    ESP_RETURN_ON_FALSE(s_uac_device != NULL, ESP_ERR_INVALID_STATE, TAG, "uac device not initialized");
+    UAC_ENTER_CRITICAL();
+    *stats = s_uac_device->stats;
+    UAC_EXIT_CRITICAL();
+    return ESP_OK;
+}
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 #include <sys/time.h>
 #include "esp_err.h"
 
@@ -58,8 +59,11 @@ typedef void (*uvc_input_stop_cb_t)(void *cb_ctx);
  * @brief Configuration for the UVC device
  */
 typedef struct {
-    uint8_t *uvc_buffer;                   /*!< UVC transfer buffer */
+    uint8_t *uvc_buffer;                   /*!< UVC transfer buffer, not used if fb_zero_copy is set */
     uint32_t uvc_buffer_size;              /*!< UVC transfer buffer size, should bigger than one frame size */
+    uint8_t *uvc_buffer2;                  /*!< Optional second transfer buffer of uvc_buffer_size, the next frame is fetched into it while the current one is sent */
+    bool fb_zero_copy;                     /*!< Send frame buffers from fb_get_cb without copy, each is returned once its transfer is done.
+                                                The next frame is fetched during the transfer, so fb_get_cb must be able to provide two frame buffers at a time */
     uvc_input_start_cb_t start_cb;         /*!< callback function of host open the UVC device with the specific format and resolution */
     uvc_input_fb_get_cb_t fb_get_cb;       /*!< callback function of host request a new frame buffer */
     uvc_input_fb_return_cb_t fb_return_cb; /*!< callback function of the frame buffer is no longer used */
@@ -90,6 +90,24 @@ TEST_CASE("usb_device_uvc_test", "[usb_device_uvc]")
     }
 }
 
+TEST_CASE("usb_device_uvc_zero_copy_test", "[usb_device_uvc]")
+{
+    // frames are sent straight from s_fb, which can be handed out again before it is returned
+    uvc_device_config_t config = {
+        .fb_zero_copy = true,
+        .start_cb = camera_start_cb,
+        .fb_get_cb = camera_fb_get_cb,
+        .fb_return_cb = camera_fb_return_cb,
+        .stop_cb = camera_stop_cb,
+        .cb_ctx = NULL,
+    };
+    TEST_ASSERT_EQUAL(ESP_OK, uvc_device_config(0, &config));
+    uvc_device_init();
+    while (1) {
+        vTaskDelay(1000 / portTICK_PERIOD_MS);
+    }
+}
+
 static size_t before_free_8bit;
 static size_t before_free_32bit;
 
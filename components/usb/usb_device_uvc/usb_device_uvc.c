@@ -14,6 +14,9 @@
 #include "soc/hp_system_reg.h"
 #endif
 #include "esp_private/usb_phy.h"
+#if CONFIG_UVC_DEVICE_ASYNC_MEMCPY
+#include "esp_async_memcpy.h"
+#endif
 #include "tusb.h"
 #include "usb_device_uvc.h"
 
@@ -31,7 +34,11 @@ typedef struct {
     uvc_format_t format[UVC_CAM_NUM];
     uvc_device_config_t user_config[UVC_CAM_NUM];
     TaskHandle_t uvc_task_hdl[UVC_CAM_NUM];
-    uint32_t interval_ms[UVC_CAM_NUM];
+    esp_timer_handle_t frame_timer[UVC_CAM_NUM];
+    uint32_t interval_us[UVC_CAM_NUM];
+#if CONFIG_UVC_DEVICE_ASYNC_MEMCPY
+    async_memcpy_handle_t mcp;
+#endif
 } uvc_device_t;
 
 static uvc_device_t s_uvc_device;
@@ -50,11 +57,6 @@ static void usb_phy_init(void)
     usb_new_phy(&phy_conf, &s_uvc_device.phy_hdl);
 }
 
-static inline uint32_t get_time_millis(void)
-{
-    return (uint32_t)(esp_timer_get_time() / 1000);
-}
-
 static void tusb_device_task(void *arg)
 {
     while (1) {
@@ -98,141 +100,208 @@ void tud_resume_cb(void)
 //--------------------------------------------------------------------+
 // USB Video
 //--------------------------------------------------------------------+
-static void video_task(void *arg)
+#define UVC_EVT_FRAME_DUE   BIT0
+#define UVC_EVT_XFER_DONE   BIT1
+#define UVC_EVT_COPY_DONE   BIT2
+#define UVC_COPY_ALIGN      64
+
+/**
+ * @brief A frame ready to be sent, either copied to a UVC buffer or, in zero-copy mode,
+ *        the producer buffer itself which is returned after the transfer
+ */
+typedef struct {
+    uvc_fb_t *fb;
+    uint8_t *data;
+    size_t len;
+    bool copying;       /*!< GDMA copy to the UVC buffer in flight, fb is returned when it completes */
+} uvc_frame_t;
+
+#if CONFIG_UVC_DEVICE_ASYNC_MEMCPY
+static IRAM_ATTR bool video_copy_done_cb(async_memcpy_handle_t mcp, async_memcpy_event_t *event, void *cb_args)
 {
-    uint32_t start_ms = 0;
-    uint32_t frame_num = 0;
-    uint32_t frame_len = 0;
-    uint32_t already_start = 0;
-    uint32_t tx_busy = 0;
-    uint8_t *uvc_buffer = s_uvc_device.user_config[0].uvc_buffer;
-    uint32_t uvc_buffer_size = s_uvc_device.user_config[0].uvc_buffer_size;
-    uvc_fb_t *pic = NULL;
+    BaseType_t woken = pdFALSE;
+    xTaskNotifyFromISR(s_uvc_device.uvc_task_hdl[(int)(intptr_t)cb_args], UVC_EVT_COPY_DONE, eSetBits, &woken);
+    return woken == pdTRUE;
+}
 
-    while (1) {
-        if (!tud_video_n_streaming(0, 0)) {
-            already_start = 0;
-            frame_num = 0;
-            tx_busy = 0;
-            vTaskDelay(1);
-            continue;
-        }
+/**
+ * @brief Start a GDMA copy of the aligned body, the tail is copied by CPU
+ *
+ * @return true if the copy is in flight, UVC_EVT_COPY_DONE follows
+ */
+static bool video_copy_start(int index, uint8_t *dst, const uint8_t *src, size_t len)
+{
+    size_t body = len & ~(UVC_COPY_ALIGN - 1);
+    if (!s_uvc_device.mcp || body < CONFIG_UVC_DEVICE_ASYNC_MEMCPY_THRESHOLD
+            || ((uintptr_t)dst & (UVC_COPY_ALIGN - 1)) || ((uintptr_t)src & (UVC_COPY_ALIGN - 1))) {
+        return false;
+    }
+    if (esp_async_memcpy(s_uvc_device.mcp, dst, (void *)src, body, video_copy_done_cb, (void *)(intptr_t)index) != ESP_OK) {
+        return false;
+    }
+    memcpy(dst + body, src + body, len - body);
+    return true;
+}
+#endif
 
-        if (!already_start) {
-            already_start = 1;
-            start_ms = get_time_millis();
-        }
+/**
+ * @brief Finish the copy of a staged frame and return its producer buffer
+ */
+static void video_copy_finish(int index, uvc_frame_t *frame)
+{
+    frame->copying = false;
+    if (frame->fb) {
+        s_uvc_device.user_config[index].fb_return_cb(frame->fb, s_uvc_device.user_config[index].cb_ctx);
+        frame->fb = NULL;
+    }
+}
 
-        uint32_t cur = get_time_millis();
-        if (cur - start_ms < s_uvc_device.interval_ms[0]) {
-            vTaskDelay(1);
-            continue;
+/**
+ * @brief Block until the copy of a staged frame completes, buffers must not be released while GDMA uses them
+ */
+static void video_copy_wait(int index, uvc_frame_t *frame)
+{
+    uint32_t events = 0;
+    while (frame->copying) {
+        xTaskNotifyWait(0, UVC_EVT_COPY_DONE, &events, portMAX_DELAY);
+        if (events & UVC_EVT_COPY_DONE) {
+            video_copy_finish(index, frame);
         }
+    }
+}
 
-        if (tx_busy) {
-            uint32_t xfer_done = ulTaskNotifyTake(pdTRUE, 1);
-            if (xfer_done == 0) {
-                continue;
-            }
-            ++frame_num;
-            tx_busy = 0;
-        }
+static bool video_stage_frame(int index, uvc_frame_t *frame, uint8_t *buffer)
+{
+    uvc_device_config_t *config = &s_uvc_device.user_config[index];
+    uvc_fb_t *pic = config->fb_get_cb(config->cb_ctx);
+    if (pic) {
+        ESP_LOGD(TAG, "Picture taken! Its size was: %zu bytes", pic->len);
+    } else {
+        ESP_LOGE(TAG, "Failed to capture picture");
+        return false;
+    }
 
-        start_ms += s_uvc_device.interval_ms[0];
-        ESP_LOGD(TAG, "frame %" PRIu32 " taking picture...", frame_num);
-        pic = s_uvc_device.user_config[0].fb_get_cb(s_uvc_device.user_config[0].cb_ctx);
-        if (pic) {
-            ESP_LOGD(TAG, "Picture taken! Its size was: %zu bytes", pic->len);
-        } else {
-            ESP_LOGE(TAG, "Failed to capture picture");
-            continue;
-        }
+    if (config->fb_zero_copy) {
+        frame->fb = pic;
+        frame->data = pic->buf;
+        frame->len = pic->len;
+        return true;
+    }
 
-        if (pic->len > uvc_buffer_size) {
-            ESP_LOGW(TAG, "frame size is too big, dropping frame");
-            s_uvc_device.user_config[0].fb_return_cb(pic, s_uvc_device.user_config[0].cb_ctx);
-            continue;
-        }
-        frame_len = pic->len;
-        memcpy(uvc_buffer, pic->buf, frame_len);
-        s_uvc_device.user_config[0].fb_return_cb(pic, s_uvc_device.user_config[0].cb_ctx);
-        tx_busy = 1;
-        tud_video_n_frame_xfer(0, 0, (void *)uvc_buffer, frame_len);
-        ESP_LOGD(TAG, "frame %" PRIu32 " transfer start, size %" PRIu32, frame_num, frame_len);
+    if (pic->len > config->uvc_buffer_size) {
+        ESP_LOGW(TAG, "frame size is too big, dropping frame");
+        config->fb_return_cb(pic, config->cb_ctx);
+        return false;
+    }
+    frame->data = buffer;
+    frame->len = pic->len;
+#if CONFIG_UVC_DEVICE_ASYNC_MEMCPY
+    if (video_copy_start(index, buffer, pic->buf, pic->len)) {
+        /* keep pic until UVC_EVT_COPY_DONE */
+        frame->fb = pic;
+        frame->copying = true;
+        return true;
     }
+#endif
+    memcpy(buffer, pic->buf, pic->len);
+    frame->fb = NULL;
+    config->fb_return_cb(pic, config->cb_ctx);
+    return true;
 }
 
-#if CONFIG_UVC_SUPPORT_TWO_CAM
-static void video_task2(void *arg)
+static void video_release_frame(int index, uvc_frame_t *frame)
+{
+    if (frame->fb) {
+        s_uvc_device.user_config[index].fb_return_cb(frame->fb, s_uvc_device.user_config[index].cb_ctx);
+    }
+    frame->fb = NULL;
+    frame->data = NULL;
+    frame->len = 0;
+}
+
+static void video_frame_timer_cb(void *arg)
+{
+    xTaskNotify(s_uvc_device.uvc_task_hdl[(int)(intptr_t)arg], UVC_EVT_FRAME_DUE, eSetBits);
+}
+
+static void video_task(void *arg)
 {
-    uint32_t start_ms = 0;
+    int index = (int)(intptr_t)arg;
+    uvc_device_config_t *config = &s_uvc_device.user_config[index];
+    uint8_t *buffers[2] = {config->uvc_buffer, config->uvc_buffer2};
+    /* the next frame is staged while one is sent if there is somewhere to keep it */
+    bool pipelined = config->fb_zero_copy || config->uvc_buffer2 != NULL;
+    int staged_buf = 0;
+    uvc_frame_t sending = {0};
+    uvc_frame_t staged = {0};
+    bool xfer_busy = false;
+    bool frame_due = false;
     uint32_t frame_num = 0;
-    uint32_t frame_len = 0;
-    uint32_t already_start = 0;
-    uint32_t tx_busy = 0;
-    uint8_t *uvc_buffer = s_uvc_device.user_config[1].uvc_buffer;
-    uint32_t uvc_buffer_size = s_uvc_device.user_config[1].uvc_buffer_size;
-    uvc_fb_t *pic = NULL;
 
     while (1) {
-        if (!tud_video_n_streaming(1, 0)) {
-            already_start = 0;
-            frame_num = 0;
-            tx_busy = 0;
-            vTaskDelay(1);
-            continue;
-        }
+        uint32_t events = 0;
+        /* woken by the frame timer and by transfer completion, nothing to poll */
+        xTaskNotifyWait(0, UINT32_MAX, &events, portMAX_DELAY);
 
-        if (!already_start) {
-            already_start = 1;
-            start_ms = get_time_millis();
+        if ((events & UVC_EVT_COPY_DONE) && staged.copying) {
+            video_copy_finish(index, &staged);
         }
 
-        uint32_t cur = get_time_millis();
-        if (cur - start_ms < s_uvc_device.interval_ms[1]) {
-            vTaskDelay(1);
+        if (!tud_video_n_streaming(index, 0)) {
+            video_copy_wait(index, &staged);
+            video_release_frame(index, &sending);
+            video_release_frame(index, &staged);
+            xfer_busy = false;
+            frame_due = false;
+            frame_num = 0;
             continue;
         }
 
-        if (tx_busy) {
-            uint32_t xfer_done = ulTaskNotifyTake(pdTRUE, 1);
-            if (xfer_done == 0) {
-                continue;
-            }
+        if ((events & UVC_EVT_XFER_DONE) && xfer_busy) {
+            xfer_busy = false;
             ++frame_num;
-            tx_busy = 0;
+            video_release_frame(index, &sending);
         }
-
-        start_ms += s_uvc_device.interval_ms[1];
-        ESP_LOGD(TAG, "frame %" PRIu32 " taking picture...", frame_num);
-        pic = s_uvc_device.user_config[1].fb_get_cb(s_uvc_device.user_config[1].cb_ctx);
-        if (pic) {
-            ESP_LOGD(TAG, "Picture taken! Its size was: %zu bytes", pic->len);
-        } else {
-            ESP_LOGE(TAG, "Failed to capture picture");
+        if (events & UVC_EVT_FRAME_DUE) {
+            frame_due = true;
+        }
+        /* a frame due during a transfer is sent as soon as the transfer completes,
+         * and as soon as its copy completes if it is still being copied */
+        if (!frame_due || xfer_busy || staged.copying) {
             continue;
         }
+        frame_due = false;
 
-        if (pic->len > uvc_buffer_size) {
-            ESP_LOGW(TAG, "frame size is too big, dropping frame");
-            s_uvc_device.user_config[1].fb_return_cb(pic, s_uvc_device.user_config[1].cb_ctx);
-            continue;
+        if (!staged.data) {
+            ESP_LOGD(TAG, "frame %" PRIu32 " taking picture...", frame_num);
+            if (!video_stage_frame(index, &staged, buffers[staged_buf])) {
+                continue;
+            }
+            if (staged.copying) {
+                /* nothing else to overlap with, wait here */
+                video_copy_wait(index, &staged);
+            }
+        }
+        sending = staged;
+        memset(&staged, 0, sizeof(staged));
+        xfer_busy = true;
+        tud_video_n_frame_xfer(index, 0, (void *)sending.data, sending.len);
+        ESP_LOGD(TAG, "frame %" PRIu32 " transfer start, size %zu", frame_num, sending.len);
+
+        if (pipelined) {
+            /* fetch frame N+1 while frame N is on the bus */
+            if (!config->fb_zero_copy) {
+                staged_buf ^= 1;
+            }
+            video_stage_frame(index, &staged, buffers[staged_buf]);
         }
-        frame_len = pic->len;
-        memcpy(uvc_buffer, pic->buf, frame_len);
-        s_uvc_device.user_config[1].fb_return_cb(pic, s_uvc_device.user_config[1].cb_ctx);
-        tx_busy = 1;
-        tud_video_n_frame_xfer(1, 0, (void *)uvc_buffer, frame_len);
-        ESP_LOGD(TAG, "frame %" PRIu32 " transfer start, size %" PRIu32, frame_num, frame_len);
     }
 }
-#endif
 
 void tud_video_frame_xfer_complete_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx)
 {
-    (void)ctl_idx;
     (void)stm_idx;
-    xTaskNotifyGive(s_uvc_device.uvc_task_hdl[ctl_idx]);
+    xTaskNotify(s_uvc_device.uvc_task_hdl[ctl_idx], UVC_EVT_XFER_DONE, eSetBits);
 }
 
 int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
@@ -246,7 +315,8 @@ int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
     if (parameters->bFrameIndex > UVC_FRAME_NUM) {
         return VIDEO_ERROR_OUT_OF_RANGE;
     }
-    s_uvc_device.interval_ms[ctl_idx] = parameters->dwFrameInterval / 10000;
+    /* convert unit to us from 100 ns */
+    s_uvc_device.interval_us[ctl_idx] = parameters->dwFrameInterval / 10;
     int frame_index = parameters->bFrameIndex - 1;
     esp_err_t ret = s_uvc_device.user_config[ctl_idx].start_cb(s_uvc_device.format[ctl_idx], UVC_FRAMES_INFO[ctl_idx][frame_index].width,
                                                                UVC_FRAMES_INFO[ctl_idx][frame_index].height, UVC_FRAMES_INFO[ctl_idx][frame_index].rate, s_uvc_device.user_config[ctl_idx].cb_ctx);
@@ -255,6 +325,9 @@ int tud_video_commit_cb(uint_fast8_t ctl_idx, uint_fast8_t stm_idx,
         ESP_LOGE(TAG, "camera init failed");
         return VIDEO_ERROR_OUT_OF_RANGE;
     }
+    /* pace frames at the committed interval */
+    esp_timer_stop(s_uvc_device.frame_timer[ctl_idx]);
+    esp_timer_start_periodic(s_uvc_device.frame_timer[ctl_idx], s_uvc_device.interval_us[ctl_idx]);
     return VIDEO_ERROR_NONE;
 }
 #endif
@@ -267,11 +340,13 @@ esp_err_t uvc_device_config(int index, uvc_device_config_t *config)
     ESP_RETURN_ON_FALSE(config->fb_get_cb != NULL, ESP_ERR_INVALID_ARG, TAG, "fb_get_cb is NULL");
     ESP_RETURN_ON_FALSE(config->fb_return_cb != NULL, ESP_ERR_INVALID_ARG, TAG, "fb_return_cb is NULL");
     ESP_RETURN_ON_FALSE(config->stop_cb != NULL, ESP_ERR_INVALID_ARG, TAG, "stop_cb is NULL");
-    ESP_RETURN_ON_FALSE(config->uvc_buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "uvc_buffer is NULL");
-    ESP_RETURN_ON_FALSE(config->uvc_buffer_size > 0, ESP_ERR_INVALID_ARG, TAG, "uvc_buffer_size is 0");
+    if (!config->fb_zero_copy) {
+        ESP_RETURN_ON_FALSE(config->uvc_buffer != NULL, ESP_ERR_INVALID_ARG, TAG, "uvc_buffer is NULL");
+        ESP_RETURN_ON_FALSE(config->uvc_buffer_size > 0, ESP_ERR_INVALID_ARG, TAG, "uvc_buffer_size is 0");
+    }
 
     s_uvc_device.user_config[index] = *config;
-    s_uvc_device.interval_ms[index] = 1000 / (index == 0 ? UVC_CAM1_FRAME_RATE : UVC_CAM2_FRAME_RATE);
+    s_uvc_device.interval_us[index] = 1000000 / (index == 0 ? UVC_CAM1_FRAME_RATE : UVC_CAM2_FRAME_RATE);
     s_uvc_device.uvc_init[index] = true;
     return ESP_OK;
 }
@@ -291,6 +366,30 @@ esp_err_t uvc_device_init(void)
 #ifdef CONFIG_FORMAT_MJPEG_CAM2
     s_uvc_device.format[1] = UVC_FORMAT_JPEG;
 #endif
+#endif
+
+#if (CFG_TUD_VIDEO)
+    /* the timers are started by tud_video_commit_cb */
+    for (int i = 0; i < UVC_CAM_NUM; i++) {
+        esp_timer_create_args_t timer_args = {
+            .callback = video_frame_timer_cb,
+            .arg = (void *)(intptr_t)i,
+            .name = "uvc_frame",
+        };
+        ESP_RETURN_ON_ERROR(esp_timer_create(&timer_args, &s_uvc_device.frame_timer[i]), TAG, "frame timer create failed");
+    }
+#if CONFIG_UVC_DEVICE_ASYNC_MEMCPY
+    if (!s_uvc_device.mcp) {
+        async_memcpy_config_t mcp_config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+        mcp_config.sram_trans_align = UVC_COPY_ALIGN;
+        mcp_config.psram_trans_align = UVC_COPY_ALIGN;
+        if (esp_async_memcpy_install(&mcp_config, &s_uvc_device.mcp) != ESP_OK) {
+            /* frames are copied by memcpy instead */
+            ESP_LOGW(TAG, "async memcpy install failed");
+            s_uvc_device.mcp = NULL;
+        }
+    }
+#endif
 #endif
 
     // init device stack on configured roothub port
@@ -301,16 +400,18 @@ esp_err_t uvc_device_init(void)
         return ESP_FAIL;
     }
 
-    BaseType_t core_id = (CONFIG_UVC_TINYUSB_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_UVC_TINYUSB_TASK_CORE;
-    xTaskCreatePinnedToCore(tusb_device_task, "TinyUSB", 4096, NULL, CONFIG_UVC_TINYUSB_TASK_PRIORITY, NULL, core_id);
+    BaseType_t core_id;
 #if (CFG_TUD_VIDEO)
+    /* video tasks first, the frame timer and transfer callbacks notify them */
     core_id = (CONFIG_UVC_CAM1_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_UVC_CAM1_TASK_CORE;
-    xTaskCreatePinnedToCore(video_task, "UVC", 4096, NULL, CONFIG_UVC_CAM1_TASK_PRIORITY, &s_uvc_device.uvc_task_hdl[0], core_id);
+    xTaskCreatePinnedToCore(video_task, "UVC", 4096, (void *)0, CONFIG_UVC_CAM1_TASK_PRIORITY, &s_uvc_device.uvc_task_hdl[0], core_id);
 #if CONFIG_UVC_SUPPORT_TWO_CAM
     core_id = (CONFIG_UVC_CAM2_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_UVC_CAM2_TASK_CORE;
-    xTaskCreatePinnedToCore(video_task2, "UVC2", 4096, NULL, CONFIG_UVC_CAM2_TASK_PRIORITY, &s_uvc_device.uvc_task_hdl[1], core_id);
+    xTaskCreatePinnedToCore(video_task, "UVC2", 4096, (void *)1, CONFIG_UVC_CAM2_TASK_PRIORITY, &s_uvc_device.uvc_task_hdl[1], core_id);
 #endif
 #endif
+    core_id = (CONFIG_UVC_TINYUSB_TASK_CORE < 0) ? tskNO_AFFINITY : CONFIG_UVC_TINYUSB_TASK_CORE;
+    xTaskCreatePinnedToCore(tusb_device_task, "TinyUSB", 4096, NULL, CONFIG_UVC_TINYUSB_TASK_PRIORITY, NULL, core_id);
     ESP_LOGI(TAG, "UVC Device Start, Version: %d.%d.%d", USB_DEVICE_UVC_VER_MAJOR, USB_DEVICE_UVC_VER_MINOR, USB_DEVICE_UVC_VER_PATCH);
     return ESP_OK;
 }
@@ -185,6 +185,94 @@ static enum uvc_frame_format uvc_frame_format_for_guid(const uint8_t guid[16])
     return UVC_FRAME_FORMAT_UNKNOWN;
 }
 
+enum uvc_frame_format parse_vs_format_type(const uint8_t *buff)
+{
+    if (buff == NULL) {
+        return UVC_FRAME_FORMAT_UNKNOWN;
+    }
+    const desc_header_t *header = (const desc_header_t *) buff;
+    switch (header->bDescriptorSubtype) {
+    case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+        return UVC_FRAME_FORMAT_MJPEG;
+    case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+        return uvc_frame_format_for_guid(((const vs_format_uncompressed_desc_t *) buff)->guidFormat);
+    case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+        return uvc_frame_format_for_guid(((const vs_format_frame_based_desc_t *) buff)->guidFormat);
+    default:
+        return UVC_FRAME_FORMAT_UNKNOWN;
+    }
+}
+
+static uint32_t _vc_bm_controls(const uint8_t *bm, uint8_t size, uint8_t avail)
+{
+    uint32_t controls = 0;
+    size = size < avail ? size : avail;
+    for (uint8_t i = 0; i < size && i < sizeof(uint32_t); i++) {
+        controls |= (uint32_t)bm[i] << (8 * i);
+    }
+    return controls;
+}
+
+void parse_vc_camera_terminal_desc(const uint8_t *buff, uint8_t *terminal_idx, uint32_t *bm_controls)
+{
+    if (buff == NULL) {
+        return;
+    }
+    const vc_camera_terminal_desc_t *desc = (const vc_camera_terminal_desc_t *) buff;
+    if (desc->bLength < sizeof(vc_camera_terminal_desc_t) || desc->wTerminalType != VIDEO_ITT_CAMERA) {
+        // other input terminals (composite, media transport) have no camera controls
+        return;
+    }
+    uint32_t controls = _vc_bm_controls(desc->bmControls, desc->bControlSize, desc->bLength - sizeof(vc_camera_terminal_desc_t));
+#ifdef CONFIG_UVC_PRINT_DESC
+    printf("\t*** VC Camera Terminal Descriptor ***\n");
+#ifdef CONFIG_UVC_PRINT_DESC_VERBOSE
+    printf("\tbLength 0x%x\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubType 0x%x\n", desc->bDescriptorSubType);
+#endif
+    printf("\tbTerminalID %u\n", desc->bTerminalID);
+    printf("\tbControlSize %u\n", desc->bControlSize);
+    printf("\tbmControls 0x%06"PRIx32"\n", controls);
+#endif
+    if (terminal_idx) {
+        *terminal_idx = desc->bTerminalID;
+    }
+    if (bm_controls) {
+        *bm_controls = controls;
+    }
+}
+
+void parse_vc_processing_unit_desc(const uint8_t *buff, uint8_t *unit_idx, uint32_t *bm_controls)
+{
+    if (buff == NULL) {
+        return;
+    }
+    const vc_processing_unit_desc_t *desc = (const vc_processing_unit_desc_t *) buff;
+    if (desc->bLength < sizeof(vc_processing_unit_desc_t)) {
+        return;
+    }
+    uint32_t controls = _vc_bm_controls(desc->bmControls, desc->bControlSize, desc->bLength - sizeof(vc_processing_unit_desc_t));
+#ifdef CONFIG_UVC_PRINT_DESC
+    printf("\t*** VC Processing Unit Descriptor ***\n");
+#ifdef CONFIG_UVC_PRINT_DESC_VERBOSE
+    printf("\tbLength 0x%x\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubType 0x%x\n", desc->bDescriptorSubType);
+#endif
+    printf("\tbUnitID %u\n", desc->bUnitID);
+    printf("\tbSourceID %u\n", desc->bSourceID);
+    printf("\tbControlSize %u\n", desc->bControlSize);
+    printf("\tbmControls 0x%06"PRIx32"\n", controls);
+#endif
+    if (unit_idx) {
+        *unit_idx = desc->bUnitID;
+    }
+    if (bm_controls) {
+        *bm_controls = controls;
+    }
+}
+
 void parse_vs_format_mjpeg_desc(const uint8_t *buff, uint8_t *format_idx, uint8_t *frame_num, enum uvc_frame_format *fmt)
 {
     if (buff == NULL) {
@@ -319,6 +407,36 @@ void parse_vs_format_frame_based_desc(const uint8_t *buff, uint8_t *format_idx,
     }
 }
 
+void parse_vs_format_uncompressed_desc(const uint8_t *buff, uint8_t *format_idx, uint8_t *frame_num, enum uvc_frame_format *fmt)
+{
+    if (buff == NULL) {
+        return;
+    }
+    const vs_format_uncompressed_desc_t *desc = (const vs_format_uncompressed_desc_t *) buff;
+#ifdef CONFIG_UVC_PRINT_DESC
+    printf("\t*** VS Format Uncompressed Descriptor ***\n");
+#ifdef CONFIG_UVC_PRINT_DESC_VERBOSE
+    printf("\tbLength 0x%x\n", desc->bLength);
+    printf("\tbDescriptorType 0x%x\n", desc->bDescriptorType);
+    printf("\tbDescriptorSubType 0x%x\n", desc->bDescriptorSubType);
+#endif
+    printf("\tbFormatIndex 0x%x\n", desc->bFormatIndex);
+    printf("\tbNumFrameDescriptors %u\n", desc->bNumFrameDescriptors);
+    printf("\tguidFormat %.*s\n", 4, desc->guidFormat);
+    printf("\tbBitsPerPixel %u\n", desc->bBitsPerPixel);
+    printf("\tbDefaultFrameIndex %u\n", desc->bDefaultFrameIndex);
+#endif
+    if (format_idx) {
+        *format_idx = desc->bFormatIndex;
+    }
+    if (frame_num) {
+        *frame_num = desc->bNumFrameDescriptors;
+    }
+    if (fmt) {
+        *fmt = uvc_frame_format_for_guid(desc->guidFormat);
+    }
+}
+
 void parse_vs_frame_frame_based_desc(const uint8_t *buff, uint8_t *frame_idx, uint16_t *width, uint16_t *height, uint8_t *interval_type, const uint32_t **pp_interval, uint32_t *dflt_interval)
 {
     if (buff == NULL) {
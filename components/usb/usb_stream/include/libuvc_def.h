@@ -158,6 +158,60 @@ enum uvc_vs_ctrl_selector {
     UVC_VS_SYNC_DELAY_CONTROL = 0x09
 };
 
+/** Camera terminal control selector (A.9.4) */
+enum uvc_ct_ctrl_selector {
+    UVC_CT_CONTROL_UNDEFINED = 0x00,
+    UVC_CT_SCANNING_MODE_CONTROL = 0x01,
+    UVC_CT_AE_MODE_CONTROL = 0x02,
+    UVC_CT_AE_PRIORITY_CONTROL = 0x03,
+    UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL = 0x04,
+    UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL = 0x05,
+    UVC_CT_FOCUS_ABSOLUTE_CONTROL = 0x06,
+    UVC_CT_FOCUS_RELATIVE_CONTROL = 0x07,
+    UVC_CT_FOCUS_AUTO_CONTROL = 0x08,
+    UVC_CT_IRIS_ABSOLUTE_CONTROL = 0x09,
+    UVC_CT_IRIS_RELATIVE_CONTROL = 0x0a,
+    UVC_CT_ZOOM_ABSOLUTE_CONTROL = 0x0b,
+    UVC_CT_ZOOM_RELATIVE_CONTROL = 0x0c,
+    UVC_CT_PANTILT_ABSOLUTE_CONTROL = 0x0d,
+    UVC_CT_PANTILT_RELATIVE_CONTROL = 0x0e,
+    UVC_CT_ROLL_ABSOLUTE_CONTROL = 0x0f,
+    UVC_CT_ROLL_RELATIVE_CONTROL = 0x10,
+    UVC_CT_PRIVACY_CONTROL = 0x11
+};
+
+/** Auto-exposure mode, value of UVC_CT_AE_MODE_CONTROL (4.2.2.1.2) */
+enum uvc_ae_mode {
+    UVC_AE_MODE_MANUAL = 0x01,
+    UVC_AE_MODE_AUTO = 0x02,
+    UVC_AE_MODE_SHUTTER_PRIORITY = 0x04,
+    UVC_AE_MODE_APERTURE_PRIORITY = 0x08
+};
+
+/** Processing unit control selector (A.9.5) */
+enum uvc_pu_ctrl_selector {
+    UVC_PU_CONTROL_UNDEFINED = 0x00,
+    UVC_PU_BACKLIGHT_COMPENSATION_CONTROL = 0x01,
+    UVC_PU_BRIGHTNESS_CONTROL = 0x02,
+    UVC_PU_CONTRAST_CONTROL = 0x03,
+    UVC_PU_GAIN_CONTROL = 0x04,
+    UVC_PU_POWER_LINE_FREQUENCY_CONTROL = 0x05,
+    UVC_PU_HUE_CONTROL = 0x06,
+    UVC_PU_SATURATION_CONTROL = 0x07,
+    UVC_PU_SHARPNESS_CONTROL = 0x08,
+    UVC_PU_GAMMA_CONTROL = 0x09,
+    UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL = 0x0a,
+    UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL = 0x0b,
+    UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL = 0x0c,
+    UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL = 0x0d,
+    UVC_PU_DIGITAL_MULTIPLIER_CONTROL = 0x0e,
+    UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL = 0x0f,
+    UVC_PU_HUE_AUTO_CONTROL = 0x10,
+    UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL = 0x11,
+    UVC_PU_ANALOG_LOCK_STATUS_CONTROL = 0x12,
+    UVC_PU_CONTRAST_AUTO_CONTROL = 0x13
+};
+
 /** An image frame received from the UVC device
  * @ingroup streaming
  */
@@ -176,10 +230,14 @@ typedef struct uvc_frame {
     size_t step;
     /** Frame number (may skip, but is strictly monotonically increasing) */
     uint32_t sequence;
-    /** Estimate of system time when the device started capturing the image */
+    /** Wall-clock (gettimeofday) time when the device started capturing the image, from capture_us */
     struct timeval capture_time;
-    /** Estimate of system time when the device finished receiving the image */
+    /** esp_timer time when the device finished receiving the image (EOF) */
     struct timespec capture_time_finished;
+    /** esp_timer time (us) when the device started capturing the image: the PTS converted through
+     * the SCR of the frame when the device sends both, otherwise the arrival of the first payload.
+     * Same clock as the UAC mic timestamps */
+    int64_t capture_us;
     /** Handle on the device that produced the image.
      * @warning You must not call any uvc_* functions during a callback. */
     uvc_device_handle_t *source;
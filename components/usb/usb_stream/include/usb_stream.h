@@ -7,6 +7,8 @@
 #pragma once
 
 #include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
 #include <string.h>
 #include <time.h>
 #include <sys/time.h>
@@ -31,6 +33,13 @@ extern "C" {
 #define FLAG_UVC_SUSPEND_AFTER_START      (1 << 0)              /*!< suspend uvc after usb_streaming_start */
 #define FLAG_UAC_SPK_SUSPEND_AFTER_START  (1 << 1)              /*!< suspend uac speaker after usb_streaming_start */
 #define FLAG_UAC_MIC_SUSPEND_AFTER_START  (1 << 2)              /*!< suspend uac microphone after usb_streaming_start */
+#define FLAG_UVC_FRAME_ZERO_COPY          (1 << 3)              /*!< uvc frame data point to xfer buffer directly, user must call uvc_frame_release */
+#define FLAG_UVC_FRAME_POOL_MAX_SLOT      (1 << 4)              /*!< size frame pool slots to xfer_buffer_size, so uvc_frame_size_switch never reallocates */
+#define FLAG_UAC_MIC_ZERO_COPY            (1 << 5)              /*!< mic ring keeps one span per urb, read in place with uac_mic_streaming_acquire */
+#define UVC_FRAME_POOL_MAX_NUM            8                     /*!< max slot numbers of uvc frame pool */
+#define UVC_PAYLOAD_FLAG_SOF              (1 << 0)              /*!< payload is the first data of a frame */
+#define UVC_PAYLOAD_FLAG_EOF              (1 << 1)              /*!< frame complete, no payload data */
+#define UVC_PAYLOAD_FLAG_DROP             (1 << 2)              /*!< frame dropped, no payload data */
 
 /**
  * @brief UVC stream usb transfer type, most camera using isochronous mode,
@@ -49,10 +58,21 @@ typedef enum {
 typedef enum {
     UVC_FORMAT_MJPEG = 0,    /*!< Default MJPEG format */
     UVC_FORMAT_FRAME_BASED,  /*!< Frame-based format */
+    UVC_FORMAT_UNCOMPRESSED, /*!< Uncompressed format, YUY2 only */
     UVC_FORMAT_MAX,         /*!< Unknown format */
 } uvc_format_t;
 /** @endcond **/
 
+#define USB_STREAM_BUF_ALIGN              64                    /*!< alignment of buffers from usb_stream_buf_alloc, one cache line */
+
+/**
+ * @brief Buffer usage for usb_stream_buf_alloc, decides where the buffer is placed
+ */
+typedef enum {
+    USB_STREAM_BUF_FRAME = 0,   /*!< Frame buffer, PSRAM with DMA capability first, then PSRAM, then internal RAM */
+    USB_STREAM_BUF_URB,         /*!< USB transfer buffer, internal DMA capable RAM only, the USB DMA can not reach PSRAM */
+} usb_stream_buf_type_t;
+
 /**
  * @brief Stream id, used for control
  *
@@ -86,6 +106,13 @@ typedef enum {
     CTRL_MAX,          /*!< max type value */
 } stream_ctrl_t;
 
+/**
+ * @brief user callback function to handle reassembled uvc payload data, called in usb task,
+ * before the whole frame complete. can not block in here!
+ *
+ */
+typedef void(*uvc_payload_callback_t)(const uint8_t *data, size_t len, uint32_t flags, void *user_ptr);
+
 /**
  * @brief UVC configurations, for params with (optional) label, users do not need to specify manually,
  * unless there is a problem with descriptors, or users want to skip the get and process descriptors steps
@@ -94,12 +121,12 @@ typedef struct uvc_config {
     uint16_t frame_width;           /*!< Picture width, set FRAME_RESOLUTION_ANY for any resolution */
     uint16_t frame_height;          /*!< Picture height, set FRAME_RESOLUTION_ANY for any resolution */
     uint32_t frame_interval;        /*!< Frame interval in 100-ns units, 666666 ~ 15 Fps*/
-    uint32_t xfer_buffer_size;      /*!< Transfer buffer size, using double buffer here, must larger than one frame size */
-    uint8_t *xfer_buffer_a;         /*!< Buffer a for usb payload */
-    uint8_t *xfer_buffer_b;         /*!< Buffer b for usb payload */
-    uint32_t frame_buffer_size;     /*!< Frame buffer size, must larger than one frame size */
-    uint8_t *frame_buffer;          /*!< Buffer for one frame */
-    uvc_frame_callback_t frame_cb;  /*!< callback function to handle incoming frame */
+    uint32_t xfer_buffer_size;      /*!< Transfer buffer size, using double buffer here, must larger than one frame size. Max slot size if frame_pool_num set */
+    uint8_t *xfer_buffer_a;         /*!< Buffer a for usb payload, can be NULL if frame_pool_num set */
+    uint8_t *xfer_buffer_b;         /*!< Buffer b for usb payload, can be NULL if frame_pool_num set */
+    uint32_t frame_buffer_size;     /*!< Frame buffer size, must larger than one frame size, not used with FLAG_UVC_FRAME_ZERO_COPY */
+    uint8_t *frame_buffer;          /*!< Buffer for one frame, can be NULL with FLAG_UVC_FRAME_ZERO_COPY */
+    uvc_frame_callback_t frame_cb;  /*!< callback function to handle incoming frame, frame->capture_time_finished is the esp_timer time of its EOF */
     void *frame_cb_arg;             /*!< callback function arg */
     uvc_format_t format;            /*!< (optional) UVC stream format, default using MJPEG */
     /*!< Optional configs, Users need to specify parameters manually when they want to
@@ -112,6 +139,10 @@ typedef struct uvc_config {
     uint8_t ep_addr;                /*!< (optional) endpoint address of selected alternate interface*/
     uint32_t ep_mps;                /*!< (optional) MPS of selected interface_alt */
     uint32_t flags;                 /*!< (optional) flags to control the driver behavers */
+    uint8_t frame_pool_num;         /*!< (optional) slot numbers (2~UVC_FRAME_POOL_MAX_NUM) of frame pool allocated by driver instead of xfer_buffer_a/b,
+                                         each slot sized from the probed dwMaxVideoFrameSize. 0 if not use */
+    uvc_payload_callback_t payload_cb; /*!< (optional) payload callback for streaming consumers, can not block in here!, NULL if not use */
+    void *payload_cb_arg;           /*!< (optional) payload callback args */
 } uvc_config_t;
 
 /**
@@ -124,6 +155,19 @@ typedef struct {
     uint32_t samples_frequence; /*!< mic sample frequency */
 } mic_frame_t;
 
+/**
+ * @brief mic data span in the zero-copy ring (FLAG_UAC_MIC_ZERO_COPY), one per usb transfer
+ * */
+typedef struct {
+    const uint8_t *data;        /*!< mic data, points into the ring, valid until uac_mic_streaming_release */
+    uint32_t data_bytes;        /*!< mic data size */
+    uint32_t seq;               /*!< span sequence, a gap means spans dropped as the ring was full */
+    int64_t timestamp_us;       /*!< esp_timer time of the first sample, same clock as esp_timer_get_time */
+    uint16_t frame_num;         /*!< USB frame number (11 bits, 1 ms at full speed) of the first packet */
+    uint16_t packets;           /*!< usb packets in this span, 1 ms each */
+    uint16_t lost;              /*!< packets lost or short in this span, padded with CONFIG_UAC_MIC_PACKET_COMPENSATION */
+} uac_mic_span_t;
+
 /**
  * @brief uvc frame type
  * */
@@ -188,6 +232,114 @@ typedef struct {
     uint32_t flags;                      /*!< (optional) flags to control the driver behavers */
 } uac_config_t;
 
+/**
+ * @brief Transfer counters of a stream pipe
+ */
+typedef struct {
+    uint32_t urb_done;                   /*!< completed urbs */
+    uint32_t packet_err;                 /*!< isoc packets completed with error status */
+    uint32_t enqueue_fail;               /*!< urb re-enqueue failures */
+    uint32_t xfer_err;                   /*!< transfer error events, the stream is recovered */
+    uint32_t urb_not_avail;              /*!< urb not available events, the stream is recovered */
+    uint32_t overflow;                   /*!< packet overflow events, the stream is recovered */
+    uint32_t stall;                      /*!< stall events, the stream is suspended and resumed */
+    uint32_t ring_full;                  /*!< data dropped as the receive ring buffer was full */
+    uint32_t urb_latency_us;             /*!< moving average of urb enqueue to completion time */
+    uint32_t urb_latency_us_max;         /*!< max urb enqueue to completion time */
+} usb_stream_pipe_stats_t;
+
+/**
+ * @brief UVC view config, see uvc_streaming_view_add
+ */
+typedef struct {
+    uvc_frame_callback_t frame_cb;  /*!< called with the delivered frames */
+    void *frame_cb_arg;             /*!< callback function arg */
+    uint16_t every_n;               /*!< deliver one of every N frames, 0 or 1 for every frame */
+    uint8_t priority;               /*!< views with higher priority are called first */
+} uvc_view_config_t;
+
+typedef struct uvc_view *uvc_view_handle_t;
+
+/**
+ * @brief USB streaming statistics. Counters are accumulated from usb_streaming_start,
+ * rates are measured over the last window of about one second, 0 if the stream is not running.
+ */
+typedef struct {
+    struct {
+        uint32_t frames;                 /*!< frames delivered to the frame callback */
+        uint32_t drop_swap_timeout;      /*!< dropped, frame callback still busy with the last frame */
+        uint32_t drop_busy;              /*!< dropped, zero-copy frame not released or frame pool full */
+        uint32_t drop_xfer_overflow;     /*!< dropped, frame larger than the transfer buffer, CONFIG_UVC_DROP_OVERFLOW_FRAME */
+        uint32_t drop_no_eof;            /*!< dropped, frame id toggled without EOF, CONFIG_UVC_DROP_NO_EOF_FRAME */
+        uint32_t drop_frame_overflow;    /*!< dropped, frame larger than frame_buffer_size */
+        uint32_t drop_jpeg_truncated;    /*!< dropped, MJPEG frame without EOI, CONFIG_UVC_CHECK_JPEG_INTEGRITY */
+        uint32_t drop_jpeg_corrupt;      /*!< dropped, MJPEG frame with bad SOI or markers, CONFIG_UVC_CHECK_JPEG_INTEGRITY */
+        uint32_t skipped;                /*!< skipped without copy by uvc_frame_decimate */
+        float fps;                       /*!< frames delivered per second */
+        uint32_t bytes_per_sec;          /*!< payload bytes received per second */
+        uint32_t frame_bytes_avg;        /*!< average size of delivered frames */
+        uint8_t bus_util;                /*!< bytes_per_sec in percent of the bandwidth of the uvc endpoint */
+        float payload_cycles_per_byte;   /*!< cpu cycles of usb task spent in payload processing per received byte */
+        uvc_xfer_t xfer_type;            /*!< transfer type of the uvc endpoint in use, UVC_XFER_UNKNOWN if not active */
+    } uvc;
+    struct {
+        uint32_t underrun;               /*!< speaker buffer ran empty while playing, CONFIG_UAC_SPK_JITTER_BUFFER */
+        uint32_t drift_drop;             /*!< samples dropped as the writer is faster than the USB clock */
+        uint32_t drift_insert;           /*!< samples repeated as the writer is slower than the USB clock */
+        uint32_t level_ms;               /*!< average buffered speaker audio */
+    } uac_spk;
+    struct {
+        uint32_t periodic_ns;            /*!< peak bus time per (micro)frame planned for the isoc/interrupt endpoints at enumeration */
+        uint32_t budget_ns;              /*!< periodic bus time allowed per (micro)frame, after CONFIG_USB_STREAM_BW_BULK_RESERVE */
+    } bus;
+    usb_stream_pipe_stats_t pipe[STREAM_MAX];    /*!< transfer counters, indexed by usb_stream_t */
+} usb_stream_stats_t;
+
+/**
+ * @brief usb stream task config
+ */
+typedef struct {
+    int8_t core_id;                  /*!< core the task pinned to, -1 for no affinity */
+    uint8_t priority;                /*!< task priority */
+    uint32_t stack_size;             /*!< task stack size (Bytes) */
+} usb_stream_task_t;
+
+/**
+ * @brief Task topology of usb streaming
+ *
+ * The USB interrupt is allocated on the core of usb_proc. To keep the capture path away from
+ * the network stack, pin usb_proc/stream_proc to the core not used by Wi-Fi/lwIP,
+ * and sample_proc (the core running uvc frame_cb) to where the frame consumer lives.
+ */
+typedef struct {
+    usb_stream_task_t usb_proc;      /*!< usb port, enum and control transfer, USB ISR core */
+    usb_stream_task_t stream_proc;   /*!< stream pipe events, suspend/resume, uac callbacks and payload_cb */
+    usb_stream_task_t sample_proc;   /*!< uvc frame_cb, created when uvc stream resumed */
+} usb_stream_task_config_t;
+
+/**
+ * @brief usb stream task index in usb_streaming_get_task_info
+ */
+typedef enum {
+    USB_STREAM_TASK_USB_PROC = 0,
+    USB_STREAM_TASK_STREAM_PROC,
+    USB_STREAM_TASK_SAMPLE_PROC,
+    USB_STREAM_TASK_NUM,
+} usb_stream_task_id_t;
+
+/**
+ * @brief usb stream task runtime info
+ */
+typedef struct {
+    const char *name;                /*!< task name */
+    bool running;                    /*!< false if task not created, other fields are zero */
+    int8_t core_id;                  /*!< configured core, -1 for no affinity */
+    uint8_t priority;                /*!< current priority */
+    uint32_t stack_free_min;         /*!< stack high water mark (Bytes), the minimum free stack since created */
+    uint32_t run_time;               /*!< run time counter, CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
+    uint8_t cpu_load;                /*!< percent of one core since the previous call, CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS */
+} usb_stream_task_info_t;
+
 /**
  * @brief Config UVC streaming with user defined parameters.For normal use, user only need to specify
  * no-optional parameters, and set optional parameters to 0 (the driver will find the correct value from the device descriptors).
@@ -303,8 +455,52 @@ esp_err_t uac_spk_streaming_write(void *data, size_t data_bytes, size_t timeout_
  *         ESP_TIMEOUT timeout
  *         ESP_OK succeed
  */
+/**
+ * @brief Set the speaker jitter buffer (CONFIG_UAC_SPK_JITTER_BUFFER), can be called at any time
+ * after uac_streaming_config, effective at the next transfer.
+ *
+ * Playback latency is about target_ms + NUM_ISOC_SPK_URBS * urb_ms, for low latency
+ * use urb_ms 1~2 and a target just above the writer jitter.
+ *
+ * @param target_ms buffered audio kept before and during playback
+ * @param urb_ms audio in each speaker transfer, no more than CONFIG_UAC_SPK_ST_MAX_MS_DEFAULT
+ * @return esp_err_t
+ *         ESP_ERR_NOT_SUPPORTED jitter buffer not enabled
+ *         ESP_ERR_INVALID_STATE spk stream not config
+ *         ESP_ERR_INVALID_ARG parameter error
+ *         ESP_ERR_INVALID_SIZE spk_buf_size can not hold target_ms + urb_ms
+ *         ESP_OK succeed
+ */
+esp_err_t uac_spk_jitter_config(uint16_t target_ms, uint8_t urb_ms);
+
 esp_err_t uac_mic_streaming_read(void *buf, size_t buf_size, size_t *data_bytes, size_t timeout_ms);
 
+/**
+ * @brief Get the oldest mic span from the ring without copy (FLAG_UAC_MIC_ZERO_COPY).
+ * Spans must be released in the order they are acquired, the ring space is reused after release.
+ * mic_buf_size should hold several spans, so the driver keeps receiving while spans are held.
+ *
+ * @param span the span pointing into the mic ring
+ * @param timeout_ms timeout value
+ * @return esp_err_t
+ *         ESP_ERR_INVALID_ARG parameter error
+ *         ESP_ERR_INVALID_STATE mic stream not config, zero-copy not enabled or ring not created
+ *         ESP_ERR_TIMEOUT ring empty
+ *         ESP_OK succeed
+ */
+esp_err_t uac_mic_streaming_acquire(uac_mic_span_t *span, size_t timeout_ms);
+
+/**
+ * @brief Return the span to the mic ring
+ *
+ * @param span span from uac_mic_streaming_acquire
+ * @return esp_err_t
+ *         ESP_ERR_INVALID_ARG parameter error
+ *         ESP_ERR_INVALID_STATE mic stream not config
+ *         ESP_OK succeed
+ */
+esp_err_t uac_mic_streaming_release(const uac_mic_span_t *span);
+
 /**
  * @brief Get the audio frame size list of current stream, the list contains audio channel number, bit resolution and samples frequency.
  * IF list_size equals 1 and the samples_frequence equals 0, which means the frequency can be set to any value between samples_frequence_min
@@ -352,6 +548,103 @@ esp_err_t uac_frame_size_reset(usb_stream_t stream, uint8_t ch_num, uint16_t bit
  */
 esp_err_t uvc_frame_size_list_get(uvc_frame_size_t *frame_list, size_t *list_size, size_t *cur_index);
 
+/**
+ * @brief Video control unit addressed by uvc_vc_control_get/uvc_vc_control_set
+ */
+typedef enum {
+    UVC_VC_CAMERA_TERMINAL = 0,   /*!< camera terminal, selectors in enum uvc_ct_ctrl_selector (exposure, focus...) */
+    UVC_VC_PROCESSING_UNIT,       /*!< processing unit, selectors in enum uvc_pu_ctrl_selector (gain, white balance...) */
+    UVC_VC_UNIT_MAX,
+} uvc_vc_unit_t;
+
+/** Longest control value accepted by uvc_vc_control_get/uvc_vc_control_set */
+#define UVC_VC_CONTROL_MAX_LEN    8
+
+/**
+ * @brief Check if the connected camera declares a control in its camera terminal or processing unit descriptor
+ *
+ * @param unit camera terminal or processing unit
+ * @param selector control selector of the unit
+ * @return true the control is declared in bmControls, false not declared, unit not found or camera not connected
+ */
+bool uvc_vc_control_supported(uvc_vc_unit_t unit, uint8_t selector);
+
+/**
+ * @brief Send a GET request (GET_CUR/GET_MIN/GET_MAX/GET_RES/GET_DEF/GET_INFO) of a camera terminal or processing unit control.
+ * The value is little-endian, its size is defined by the control (e.g. 4 bytes exposure time, 2 bytes gain).
+ * Control transfers share the default pipe with stream negotiation, can be called while the stream is running or suspended.
+ *
+ * @param unit camera terminal or processing unit
+ * @param selector control selector of the unit
+ * @param req GET request code in enum uvc_req_code
+ * @param data buffer for the returned value
+ * @param len size of the control value, no more than UVC_VC_CONTROL_MAX_LEN
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG parameter error
+ *       ESP_ERR_INVALID_STATE uvc stream not config or camera not connected
+ *       ESP_ERR_NOT_SUPPORTED control not declared by the camera
+ *       ESP_ERR_INVALID_SIZE camera returned less than len bytes
+ *       ESP_FAIL request stalled or failed
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_vc_control_get(uvc_vc_unit_t unit, uint8_t selector, enum uvc_req_code req, void *data, uint16_t len);
+
+/**
+ * @brief Send SET_CUR of a camera terminal or processing unit control.
+ * Cameras stall writes to controls driven by an auto mode (e.g. exposure time while AE is on), switch the mode first.
+ *
+ * @param unit camera terminal or processing unit
+ * @param selector control selector of the unit
+ * @param data little-endian control value
+ * @param len size of the control value, no more than UVC_VC_CONTROL_MAX_LEN
+ * @return esp_err_t same as uvc_vc_control_get
+ */
+esp_err_t uvc_vc_control_set(uvc_vc_unit_t unit, uint8_t selector, const void *data, uint16_t len);
+
+/**
+ * @brief Release the frame borrowed in zero-copy mode (FLAG_UVC_FRAME_ZERO_COPY).
+ * The frame data points to the driver transfer buffer, which will not be reused until released,
+ * new frames will be dropped before that. Can be called in or after the frame callback.
+ *
+ * @param frame the frame passed to frame callback
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG parameter error
+ *       ESP_ERR_INVALID_STATE zero-copy mode not enabled or uvc stream not running
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_frame_release(uvc_frame_t *frame);
+
+/**
+ * @brief Allocate a frame or transfer buffer. The buffer is USB_STREAM_BUF_ALIGN aligned and its size is
+ * rounded up to whole cache lines, so cache sync and GDMA never touch a neighbouring allocation.
+ * Frame pool slots and URB buffers of the driver are allocated with it.
+ *
+ * @param size buffer size in bytes
+ * @param type buffer usage, see usb_stream_buf_type_t
+ * @param[out] caps heap caps the buffer was allocated with (e.g. MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA), can be NULL
+ * @return buffer, NULL if out of memory. Free with usb_stream_buf_free
+ */
+void *usb_stream_buf_alloc(size_t size, usb_stream_buf_type_t type, uint32_t *caps);
+
+/**
+ * @brief Free a buffer allocated by usb_stream_buf_alloc
+ *
+ * @param buf buffer, can be NULL
+ */
+void usb_stream_buf_free(void *buf);
+
+/**
+ * @brief Copy a block of memory. With CONFIG_USB_STREAM_ASYNC_MEMCPY, copies of at least
+ * CONFIG_USB_STREAM_ASYNC_MEMCPY_THRESHOLD bytes between USB_STREAM_BUF_ALIGN aligned buffers are done
+ * by GDMA, the calling task blocks until completion so other tasks get the CPU instead of a cache bound
+ * memcpy. Otherwise it is a plain memcpy. Must not be called from ISR.
+ *
+ * @param dst destination
+ * @param src source
+ * @param len bytes to copy
+ */
+void usb_stream_memcpy(void *dst, const void *src, size_t len);
+
 /**
  * @brief Reset the expected frame size and frame interval, please reset when uvc streaming
  * in suspend state.The new configs will be effective after streaming resume.
@@ -366,6 +659,164 @@ esp_err_t uvc_frame_size_list_get(uvc_frame_size_t *frame_list, size_t *list_siz
  */
 esp_err_t uvc_frame_size_reset(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval);
 
+/**
+ * @brief Switch the frame size and frame interval, can be called when uvc streaming is running.
+ * The stream handle, sample task and frame buffers are kept, only the transfer is stopped,
+ * the new config is probed/committed and the transfer restarted. Frames being assembled are dropped.
+ *
+ * If the new probed frame size does not fit the frame pool slots, the stream is fully suspended
+ * and resumed instead (see FLAG_UVC_FRAME_POOL_MAX_SLOT to avoid it).
+ * If streaming is not running, it behaves as uvc_frame_size_reset.
+ *
+ * Note: must not be called from the stream state callback.
+ *
+ * @param frame_width frame width, FRAME_RESOLUTION_ANY means any width
+ * @param frame_height frame height, FRAME_RESOLUTION_ANY means any height
+ * @param frame_interval frame interval, 0 means no change
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_STATE uvc stream not configured or device not active
+ *       ESP_ERR_NOT_FOUND no matched frame size, the previous config is resumed
+ *       ESP_FAIL switch or resume failed
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_frame_size_switch(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval);
+
+/**
+ * @brief Compression parameters of the UVC stream, wCompQuality/wCompWindowSize of the VS probe control
+ */
+typedef struct {
+    uint16_t quality;           /*!< wCompQuality of the last negotiation, 1 (lowest) ~ 10000 (highest), 0 not reported */
+    uint16_t window;            /*!< wCompWindowSize of the last negotiation */
+    uint16_t quality_min;       /*!< wCompQuality of the probe GET_MIN, 0 not answered */
+    uint16_t quality_max;       /*!< wCompQuality of the probe GET_MAX, 0 not answered */
+    uint32_t max_frame_size;    /*!< dwMaxVideoFrameSize of the last negotiation */
+} uvc_compression_t;
+
+/**
+ * @brief Get the compression parameters negotiated with the camera.
+ * The probe GET_MIN/GET_MAX is sent on the first call after the camera is connected, the result is cached.
+ *
+ * Note: must not be called from the stream state callback.
+ *
+ * @param comp the compression parameters
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG comp is NULL
+ *       ESP_ERR_INVALID_STATE uvc stream not configured or device not active
+ *       ESP_OK succeed, quality_min/quality_max are 0 if the camera does not answer
+ */
+esp_err_t uvc_compression_get(uvc_compression_t *comp);
+
+/**
+ * @brief Request the compression quality and window, bmHint D3/D4 are set so the camera keeps them fixed
+ * in the negotiation. Can be called when uvc streaming is running, the stream is re-negotiated the same
+ * way as uvc_frame_size_switch. If streaming is not running, it is effective after resume.
+ *
+ * Most MJPEG cameras accept the request but only some of them change the encoder quality,
+ * check the frame size to know the effect.
+ *
+ * Note: must not be called from the stream state callback.
+ *
+ * @param quality wCompQuality 1 ~ 10000, 0 means camera default
+ * @param window wCompWindowSize, 0 means camera default
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG quality out of range
+ *       ESP_ERR_INVALID_STATE uvc stream not configured or device not active
+ *       ESP_ERR_NOT_SUPPORTED the camera returned another quality, the request is cleared
+ *       ESP_FAIL switch or resume failed
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_compression_set(uint16_t quality, uint16_t window);
+
+/**
+ * @brief Deliver only one of every N frames, the other frames are skipped in the payload path
+ * without copy and without calling payload_cb, the USB transfer keeps running.
+ * Can be called at any time after uvc_streaming_config, effective at the next frame start.
+ *
+ * @param every_n 1 deliver every frame (default), N deliver every Nth frame, 0 skip all frames
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_STATE uvc stream not configured
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_frame_decimate(uint16_t every_n);
+
+/**
+ * @brief Add a view, an extra consumer of the uvc frames beside uvc_config_t.frame_cb,
+ * e.g. a face detector on every frame and a parcel view on one of every 10 frames.
+ *
+ * Views are called on the sample task with the same frame, by priority, before uvc_config_t.frame_cb.
+ * The frame is only valid during the callback, views must not call uvc_frame_release.
+ * Views can be added and removed at any time, they are kept across usb_streaming_stop.
+ *
+ * @param config view config
+ * @param[out] handle view handle
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG invalid args
+ *       ESP_ERR_NO_MEM CONFIG_UVC_VIEW_MAX_NUM views already added
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_streaming_view_add(const uvc_view_config_t *config, uvc_view_handle_t *handle);
+
+/**
+ * @brief Remove a view, the view may still get the frame being delivered when called
+ *
+ * @param handle view handle
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG invalid handle
+ *       ESP_OK succeed
+ */
+esp_err_t uvc_streaming_view_remove(uvc_view_handle_t handle);
+
+/**
+ * @brief Get usb streaming statistics, can be called from any task
+ *
+ * @param stats the statistics copied out
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG parameter error
+ *       ESP_ERR_INVALID_STATE usb streaming not started
+ *       ESP_OK succeed
+ */
+esp_err_t usb_streaming_get_stats(usb_stream_stats_t *stats);
+
+/**
+ * @brief Config core, priority and stack of usb streaming tasks,
+ * defaults are from Kconfig (CONFIG_USB_PROC_TASK_*, CONFIG_SAMPLE_PROC_TASK_*).
+ * Config is kept after usb_streaming_stop.
+ *
+ * Note: Should be called before usb_streaming_start for core and stack.
+ * After start, only priorities can be changed and are applied immediately,
+ * the sample_proc core and stack take effect on next uvc stream resume.
+ *
+ * @param config task topology
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG invalid core, priority or stack size
+ *       ESP_ERR_INVALID_STATE core or stack of usb_proc/stream_proc changed after start
+ *       ESP_OK succeed
+ */
+esp_err_t usb_streaming_task_config(const usb_stream_task_config_t *config);
+
+/**
+ * @brief Get the current task topology
+ *
+ * @param config the config copied out
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG parameter error
+ *       ESP_OK succeed
+ */
+esp_err_t usb_streaming_task_config_get(usb_stream_task_config_t *config);
+
+/**
+ * @brief Get stack watermark and cpu time of usb streaming tasks
+ *
+ * Note: cpu_load is measured between two calls, call it periodically
+ *
+ * @param info array of USB_STREAM_TASK_NUM, indexed by usb_stream_task_id_t
+ * @return esp_err_t
+ *       ESP_ERR_INVALID_ARG parameter error
+ *       ESP_ERR_INVALID_STATE usb streaming not started
+ *       ESP_OK succeed
+ */
+esp_err_t usb_streaming_get_task_info(usb_stream_task_info_t info[USB_STREAM_TASK_NUM]);
+
 #ifdef __cplusplus
 }
 #endif
@@ -34,6 +34,15 @@
         goto label; \
     }
 
+/* Periodic (isoc and interrupt) bus time planned per (micro)frame, over USB_BW_SLOT_NUM (micro)frames */
+#define USB_BW_SLOT_NUM 8
+
+typedef struct {
+    usb_speed_t speed;
+    uint32_t budget_ns;
+    uint32_t slot_ns[USB_BW_SLOT_NUM];
+} _usb_bw_plan_t;
+
 /* The usb host helper functions, only for usb_stream driver */
 void _usb_urb_clear(urb_t *urb);
 urb_t *_usb_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void *context);
@@ -51,3 +60,6 @@ hcd_pipe_handle_t _usb_pipe_init(hcd_port_handle_t port_hdl, usb_ep_desc_t *ep_d
 esp_err_t _usb_pipe_flush(hcd_pipe_handle_t pipe_hdl, size_t urb_num);
 esp_err_t _usb_pipe_clear(hcd_pipe_handle_t pipe_hdl, size_t urb_num);
 esp_err_t _usb_pipe_deinit(hcd_pipe_handle_t pipe_hdl, size_t urb_num);
+void _usb_bw_plan_init(_usb_bw_plan_t *plan, usb_speed_t speed, uint32_t bulk_reserve_bytes);
+bool _usb_bw_plan_ep(_usb_bw_plan_t *plan, uint8_t ep_attr, uint16_t ep_mps, uint8_t interval, bool commit);
+uint32_t _usb_bw_plan_peak(const _usb_bw_plan_t *plan);
@@ -178,6 +178,34 @@ typedef struct {
     uint8_t  baInterfaceNr;
 } USB_DESC_ATTR vc_interface_desc_t;
 
+#define VIDEO_ITT_CAMERA    0x0201
+
+typedef struct {
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubType;
+    uint8_t  bTerminalID;
+    uint16_t wTerminalType;
+    uint8_t  bAssocTerminal;
+    uint8_t  iTerminal;
+    uint16_t wObjectiveFocalLengthMin;
+    uint16_t wObjectiveFocalLengthMax;
+    uint16_t wOcularFocalLength;
+    uint8_t  bControlSize;
+    uint8_t  bmControls[];
+} USB_DESC_ATTR vc_camera_terminal_desc_t;
+
+typedef struct {
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubType;
+    uint8_t  bUnitID;
+    uint8_t  bSourceID;
+    uint16_t wMaxMultiplier;
+    uint8_t  bControlSize;
+    uint8_t  bmControls[];
+} USB_DESC_ATTR vc_processing_unit_desc_t;
+
 typedef struct {
     uint8_t  bLength;
     uint8_t  bDescriptorType;
@@ -255,6 +283,21 @@ typedef struct {
     uint8_t  bVariableSize;
 } USB_DESC_ATTR vs_format_frame_based_desc_t;
 
+typedef struct {
+    uint8_t  bLength;
+    uint8_t  bDescriptorType;
+    uint8_t  bDescriptorSubType;
+    uint8_t  bFormatIndex;
+    uint8_t  bNumFrameDescriptors;
+    uint8_t  guidFormat[16];
+    uint8_t  bBitsPerPixel;
+    uint8_t  bDefaultFrameIndex;
+    uint8_t  bAspectRatioX;
+    uint8_t  bAspectRatioY;
+    uint8_t  bmInterlaceFlags;
+    uint8_t  bCopyProtect;
+} USB_DESC_ATTR vs_format_uncompressed_desc_t;
+
 typedef struct {
     uint8_t  bLength;
     uint8_t  bDescriptorType;
@@ -429,6 +472,10 @@ void parse_vs_format_mjpeg_desc(const uint8_t *buff, uint8_t *format_idx, uint8_
 void parse_vs_frame_mjpeg_desc(const uint8_t *buff, uint8_t *frame_idx, uint16_t *width, uint16_t *height, uint8_t *interval_type, const uint32_t **pp_interval, uint32_t *dflt_interval);
 void parse_vs_format_frame_based_desc(const uint8_t *buff, uint8_t *format_idx, uint8_t *frame_num, enum uvc_frame_format *fmt);
 void parse_vs_frame_frame_based_desc(const uint8_t *buff, uint8_t *frame_idx, uint16_t *width, uint16_t *height, uint8_t *interval_type, const uint32_t **pp_interval, uint32_t *dflt_interval);
+void parse_vs_format_uncompressed_desc(const uint8_t *buff, uint8_t *format_idx, uint8_t *frame_num, enum uvc_frame_format *fmt);
+enum uvc_frame_format parse_vs_format_type(const uint8_t *buff);
+void parse_vc_camera_terminal_desc(const uint8_t *buff, uint8_t *terminal_idx, uint32_t *bm_controls);
+void parse_vc_processing_unit_desc(const uint8_t *buff, uint8_t *unit_idx, uint32_t *bm_controls);
 void print_uvc_header_desc(const uint8_t *buff, uint8_t sub_class);
 void print_device_descriptor(const uint8_t *buff);
 void print_ep_desc(const uint8_t *buff);
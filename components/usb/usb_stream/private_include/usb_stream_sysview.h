@@ -13,6 +13,7 @@
 #define SYSVIEW_MARKER_UVC_PIPE_HANDLE_ID         11
 #define SYSVIEW_MARKER_UAC_MIC_PIPE_HANDLE_ID     12
 #define SYSVIEW_MARKER_UAC_SPK_PIPE_HANDLE_ID     13
+#define SYSVIEW_MARKER_UVC_FRAME_ID               14
 #define SYSVIEW_DFLT_PIPE_XFER_START()      SEGGER_SYSVIEW_OnUserStart(SYSVIEW_MARKER_DFT_PIPE_HANDLE_ID)
 #define SYSVIEW_DFLT_PIPE_XFER_STOP()       SEGGER_SYSVIEW_OnUserStop(SYSVIEW_MARKER_DFT_PIPE_HANDLE_ID)
 #define SYSVIEW_UVC_PIPE_HANDLE_START()     SEGGER_SYSVIEW_OnUserStart(SYSVIEW_MARKER_UVC_PIPE_HANDLE_ID)
@@ -21,6 +22,8 @@
 #define SYSVIEW_UAC_MIC_PIPE_HANDLE_STOP()  SEGGER_SYSVIEW_OnUserStop(SYSVIEW_MARKER_UAC_MIC_PIPE_HANDLE_ID)
 #define SYSVIEW_UAC_SPK_PIPE_HANDLE_START() SEGGER_SYSVIEW_OnUserStart(SYSVIEW_MARKER_UAC_SPK_PIPE_HANDLE_ID)
 #define SYSVIEW_UAC_SPK_PIPE_HANDLE_STOP()  SEGGER_SYSVIEW_OnUserStop(SYSVIEW_MARKER_UAC_SPK_PIPE_HANDLE_ID)
+#define SYSVIEW_UVC_FRAME_START()           SEGGER_SYSVIEW_OnUserStart(SYSVIEW_MARKER_UVC_FRAME_ID)
+#define SYSVIEW_UVC_FRAME_STOP()            SEGGER_SYSVIEW_OnUserStop(SYSVIEW_MARKER_UVC_FRAME_ID)
 
 #else
 #define SYSVIEW_DFLT_PIPE_XFER_START()
@@ -31,5 +34,7 @@
 #define SYSVIEW_UAC_MIC_PIPE_HANDLE_STOP()
 #define SYSVIEW_UAC_SPK_PIPE_HANDLE_START()
 #define SYSVIEW_UAC_SPK_PIPE_HANDLE_STOP()
+#define SYSVIEW_UVC_FRAME_START()
+#define SYSVIEW_UVC_FRAME_STOP()
 
 #endif
@@ -0,0 +1,191 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <stdio.h>
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_system.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_private/esp_clk.h"
+#include "usb_stream.h"
+#include "unity.h"
+
+/* Benchmark, stream each frame size at its default, fastest and slowest interval
+ * for a fixed duration, and print one parseable line per run:
+ *
+ * BENCH_HEADER,<field>,...
+ * BENCH,<value>,...
+ *
+ * The transfer type is decided by the camera, run with a bulk and an isoc camera
+ * (or a board running usb_device_uvc as a synthetic source), and with sdkconfig.ci.160mhz / 240mhz
+ * to compare the cpu frequency.
+ */
+
+static const char *TAG = "usb_stream_bench";
+
+#define BENCH_XFER_BUFFER_SIZE  (55 * 1024)
+#define BENCH_POOL_NUM          3
+#define BENCH_SETTLE_MS         2000        // frames after a switch are not measured
+#define BENCH_RUN_MS            10000
+#define BENCH_SAMPLE_MS         1000
+#define BENCH_INTERVAL_NUM      3
+
+#define BENCH_FIELDS "mhz,xfer,width,height,fps_req,fps,frames,drop_swap_timeout,drop_busy,drop_xfer_overflow," \
+                     "drop_no_eof,drop_frame_overflow,drop_jpeg_truncated,drop_jpeg_corrupt,bytes_per_sec,bus_util," \
+                     "cpu0,cpu1,cycles_per_byte,latency_avg_us,latency_max_us"
+
+typedef struct {
+    volatile bool measure;
+    uint32_t frames;
+    uint64_t latency_sum;
+    uint32_t latency_max;
+} bench_latency_t;
+
+static bench_latency_t s_latency;
+
+/* frame latency from EOF in usb task to this callback, zero-copy so no memcpy in the path */
+static void bench_frame_cb(uvc_frame_t *frame, void *ptr)
+{
+    int64_t eof_us = (int64_t)frame->capture_time_finished.tv_sec * 1000000 + frame->capture_time_finished.tv_nsec / 1000;
+    uint32_t latency = esp_timer_get_time() - eof_us;
+    if (s_latency.measure) {
+        s_latency.frames++;
+        s_latency.latency_sum += latency;
+        if (latency > s_latency.latency_max) {
+            s_latency.latency_max = latency;
+        }
+    }
+    uvc_frame_release(frame);
+}
+
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+static void bench_idle_time(uint32_t idle[portNUM_PROCESSORS], uint32_t *total)
+{
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        idle[i] = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(i));
+    }
+    *total = portGET_RUN_TIME_COUNTER_VALUE();
+}
+#endif
+
+static const char *bench_xfer_name(uvc_xfer_t xfer_type)
+{
+    switch (xfer_type) {
+    case UVC_XFER_ISOC:
+        return "isoc";
+    case UVC_XFER_BULK:
+        return "bulk";
+    default:
+        return "unknown";
+    }
+}
+
+static void bench_run(uint16_t width, uint16_t height, uint32_t interval)
+{
+    if (uvc_frame_size_switch(width, height, interval) != ESP_OK) {
+        ESP_LOGW(TAG, "switch to %ux%u@%"PRIu32" failed, skip", width, height, interval);
+        return;
+    }
+    vTaskDelay(pdMS_TO_TICKS(BENCH_SETTLE_MS));
+
+    usb_stream_stats_t start, stats;
+    TEST_ASSERT_EQUAL(ESP_OK, usb_streaming_get_stats(&start));
+    int cpu_load[2] = {-1, -1};
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint32_t idle_start[portNUM_PROCESSORS], total_start;
+    bench_idle_time(idle_start, &total_start);
+#endif
+    memset(&s_latency, 0, sizeof(s_latency));
+    s_latency.measure = true;
+    int64_t start_us = esp_timer_get_time();
+
+    // cycles per byte is a rate of the last stats window, weight the samples by bytes
+    uint64_t cycles_sum = 0;
+    uint64_t bytes_sum = 0;
+    for (int i = 0; i < BENCH_RUN_MS / BENCH_SAMPLE_MS; i++) {
+        vTaskDelay(pdMS_TO_TICKS(BENCH_SAMPLE_MS));
+        TEST_ASSERT_EQUAL(ESP_OK, usb_streaming_get_stats(&stats));
+        cycles_sum += (uint64_t)(stats.uvc.payload_cycles_per_byte * stats.uvc.bytes_per_sec);
+        bytes_sum += stats.uvc.bytes_per_sec;
+    }
+
+    s_latency.measure = false;
+    int64_t elapsed_us = esp_timer_get_time() - start_us;
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    uint32_t idle_end[portNUM_PROCESSORS], total_end;
+    bench_idle_time(idle_end, &total_end);
+    for (int i = 0; i < portNUM_PROCESSORS; i++) {
+        uint32_t idle = idle_end[i] - idle_start[i];
+        uint32_t total = total_end - total_start;
+        cpu_load[i] = total ? 100 - (int)((uint64_t)idle * 100 / total) : -1;
+    }
+#endif
+
+    uint32_t frames = stats.uvc.frames - start.uvc.frames;
+    printf("BENCH,%d,%s,%u,%u,%.1f,%.2f,%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32",%"PRIu32
+           ",%"PRIu64",%u,%d,%d,%.2f,%"PRIu32",%"PRIu32"\n",
+           esp_clk_cpu_freq() / 1000000, bench_xfer_name(stats.uvc.xfer_type), width, height,
+           10000000.0f / interval, frames * 1000000.0f / elapsed_us, frames,
+           stats.uvc.drop_swap_timeout - start.uvc.drop_swap_timeout,
+           stats.uvc.drop_busy - start.uvc.drop_busy,
+           stats.uvc.drop_xfer_overflow - start.uvc.drop_xfer_overflow,
+           stats.uvc.drop_no_eof - start.uvc.drop_no_eof,
+           stats.uvc.drop_frame_overflow - start.uvc.drop_frame_overflow,
+           stats.uvc.drop_jpeg_truncated - start.uvc.drop_jpeg_truncated,
+           stats.uvc.drop_jpeg_corrupt - start.uvc.drop_jpeg_corrupt,
+           bytes_sum * BENCH_SAMPLE_MS / BENCH_RUN_MS, stats.uvc.bus_util,
+           cpu_load[0], cpu_load[1], bytes_sum ? (float)cycles_sum / bytes_sum : 0.0f,
+           s_latency.frames ? (uint32_t)(s_latency.latency_sum / s_latency.frames) : 0, s_latency.latency_max);
+}
+
+TEST_CASE("test uvc benchmark", "[bench][uvc]")
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+    uvc_config_t uvc_config = {
+        .frame_width = FRAME_RESOLUTION_ANY,
+        .frame_height = FRAME_RESOLUTION_ANY,
+        .frame_interval = FPS2INTERVAL(15),
+        .xfer_buffer_size = BENCH_XFER_BUFFER_SIZE,
+        .frame_cb = bench_frame_cb,
+        .frame_cb_arg = NULL,
+        .frame_pool_num = BENCH_POOL_NUM,
+        .flags = FLAG_UVC_FRAME_ZERO_COPY | FLAG_UVC_FRAME_POOL_MAX_SLOT,
+    };
+
+    TEST_ASSERT_EQUAL(ESP_OK, uvc_streaming_config(&uvc_config));
+    TEST_ASSERT_EQUAL(ESP_OK, usb_streaming_start());
+    TEST_ASSERT_EQUAL(ESP_OK, usb_streaming_connect_wait(portMAX_DELAY));
+    size_t frame_size = 0;
+    TEST_ASSERT_EQUAL(ESP_OK, uvc_frame_size_list_get(NULL, &frame_size, NULL));
+    TEST_ASSERT_NOT_EQUAL(0, frame_size);
+    uvc_frame_size_t *uvc_frame_list = (uvc_frame_size_t *)malloc(frame_size * sizeof(uvc_frame_size_t));
+    TEST_ASSERT_NOT_NULL(uvc_frame_list);
+    TEST_ASSERT_EQUAL(ESP_OK, uvc_frame_size_list_get(uvc_frame_list, NULL, NULL));
+
+    printf("BENCH_HEADER,%s\n", BENCH_FIELDS);
+    for (size_t i = 0; i < frame_size; i++) {
+        uint32_t intervals[BENCH_INTERVAL_NUM] = {
+            uvc_frame_list[i].interval, uvc_frame_list[i].interval_min, uvc_frame_list[i].interval_max,
+        };
+        for (int j = 0; j < BENCH_INTERVAL_NUM; j++) {
+            bool skip = intervals[j] == 0;
+            for (int k = 0; k < j; k++) {
+                skip |= intervals[k] == intervals[j];
+            }
+            if (!skip) {
+                bench_run(uvc_frame_list[i].width, uvc_frame_list[i].height, intervals[j]);
+            }
+        }
+    }
+
+    TEST_ASSERT_EQUAL(ESP_OK, usb_streaming_stop());
+    free(uvc_frame_list);
+    vTaskDelay(pdMS_TO_TICKS(100));
+}
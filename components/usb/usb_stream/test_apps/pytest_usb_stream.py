@@ -81,3 +81,19 @@ def test_esp32s3_eye_camera_start(dut: Dut)-> None:
     dut.expect_exact('Press ENTER to see the list of tests.')
     dut.write('[uvc_only]')
     dut.expect_unity_test_output(timeout = 3000)
+
+@pytest.mark.target('esp32s2')
+@pytest.mark.target('esp32s3')
+@pytest.mark.env('usb_camera')
+@pytest.mark.timeout(60 * 60)
+@pytest.mark.parametrize(
+    'config',
+    [
+        '160mhz',
+        '240mhz',
+    ],
+)
+def test_usb_stream_bench(dut: Dut)-> None:
+    dut.expect_exact('Press ENTER to see the list of tests.')
+    dut.write('[bench]')
+    dut.expect_unity_test_output(timeout = 3000)
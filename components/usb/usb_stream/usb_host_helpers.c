@@ -12,11 +12,119 @@
 #include "esp_idf_version.h"
 #include "esp_attr.h"
 #include "esp_private/usb_phy.h"
+#include "usb/usb_types_ch9.h"
 #include "usb_host_helpers.h"
+#include "usb_stream.h"
 #include "esp_intr_alloc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#if CONFIG_USB_STREAM_ASYNC_MEMCPY
+#include "esp_async_memcpy.h"
+#endif
 
 #define USB_PORT_NUM 1  //Default port number
 static const char *TAG = "USB_STREAM";
+/*------------------------------------------------ Buffer Code -----------------------------------------------------*/
+static const uint32_t s_frame_buf_caps[] = {
+    MALLOC_CAP_SPIRAM | MALLOC_CAP_DMA,
+    MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT,
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,
+    MALLOC_CAP_8BIT,
+};
+
+static const uint32_t s_urb_buf_caps[] = {
+    MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA,
+};
+
+void *usb_stream_buf_alloc(size_t size, usb_stream_buf_type_t type, uint32_t *caps)
+{
+    const uint32_t *caps_list = (type == USB_STREAM_BUF_URB) ? s_urb_buf_caps : s_frame_buf_caps;
+    size_t caps_num = (type == USB_STREAM_BUF_URB) ? sizeof(s_urb_buf_caps) / sizeof(s_urb_buf_caps[0])
+                      : sizeof(s_frame_buf_caps) / sizeof(s_frame_buf_caps[0]);
+    size = (size + USB_STREAM_BUF_ALIGN - 1) & ~(USB_STREAM_BUF_ALIGN - 1);
+    for (size_t i = 0; i < caps_num; i++) {
+        void *buf = heap_caps_aligned_alloc(USB_STREAM_BUF_ALIGN, size, caps_list[i]);
+        if (buf) {
+            ESP_LOGD(TAG, "%s buffer(%p) %u B, caps 0x%"PRIx32, type == USB_STREAM_BUF_URB ? "urb" : "frame",
+                     buf, size, caps_list[i]);
+            if (caps) {
+                *caps = caps_list[i];
+            }
+            return buf;
+        }
+    }
+    return NULL;
+}
+
+void usb_stream_buf_free(void *buf)
+{
+    heap_caps_free(buf);
+}
+
+#if CONFIG_USB_STREAM_ASYNC_MEMCPY
+static async_memcpy_handle_t s_mcp = NULL;
+static bool s_mcp_failed = false;
+static portMUX_TYPE s_mcp_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static async_memcpy_handle_t _usb_mcp_get(void)
+{
+    if (s_mcp || s_mcp_failed) {
+        return s_mcp;
+    }
+    async_memcpy_config_t config = ASYNC_MEMCPY_DEFAULT_CONFIG();
+    config.sram_trans_align = USB_STREAM_BUF_ALIGN;
+    config.psram_trans_align = USB_STREAM_BUF_ALIGN;
+    async_memcpy_handle_t mcp = NULL;
+    if (esp_async_memcpy_install(&config, &mcp) != ESP_OK) {
+        ESP_LOGW(TAG, "async memcpy install failed, use memcpy");
+        s_mcp_failed = true;
+        return NULL;
+    }
+    /* two tasks may install at the same time, keep one */
+    portENTER_CRITICAL(&s_mcp_lock);
+    if (s_mcp == NULL) {
+        s_mcp = mcp;
+        mcp = NULL;
+    }
+    portEXIT_CRITICAL(&s_mcp_lock);
+    if (mcp) {
+        esp_async_memcpy_uninstall(mcp);
+    }
+    return s_mcp;
+}
+
+static IRAM_ATTR bool _usb_mcp_done_cb(async_memcpy_handle_t mcp, async_memcpy_event_t *event, void *cb_args)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR((SemaphoreHandle_t)cb_args, &woken);
+    return woken == pdTRUE;
+}
+#endif
+
+void usb_stream_memcpy(void *dst, const void *src, size_t len)
+{
+#if CONFIG_USB_STREAM_ASYNC_MEMCPY
+    /* DMA the aligned body, the tail is copied by CPU meanwhile, it never shares a cache line with the body */
+    size_t body = len & ~(USB_STREAM_BUF_ALIGN - 1);
+    if (body >= CONFIG_USB_STREAM_ASYNC_MEMCPY_THRESHOLD
+            && !((uintptr_t)dst & (USB_STREAM_BUF_ALIGN - 1)) && !((uintptr_t)src & (USB_STREAM_BUF_ALIGN - 1))) {
+        async_memcpy_handle_t mcp = _usb_mcp_get();
+        StaticSemaphore_t done_buf;
+        SemaphoreHandle_t done = mcp ? xSemaphoreCreateBinaryStatic(&done_buf) : NULL;
+        if (done && esp_async_memcpy(mcp, dst, (void *)src, body, _usb_mcp_done_cb, done) == ESP_OK) {
+            memcpy((uint8_t *)dst + body, (const uint8_t *)src + body, len - body);
+            xSemaphoreTake(done, portMAX_DELAY);
+            vSemaphoreDelete(done);
+            return;
+        }
+        if (done) {
+            vSemaphoreDelete(done);
+        }
+    }
+#endif
+    memcpy(dst, src, len);
+}
+
 /*------------------------------------------------ USB URB Code ----------------------------------------------------*/
 void _usb_urb_clear(urb_t *urb)
 {
@@ -39,16 +147,12 @@ urb_t *_usb_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void
     urb_t *urb = heap_caps_calloc(1, sizeof(urb_t) + (num_isoc_packets * sizeof(usb_isoc_packet_desc_t)), MALLOC_CAP_DMA);
     UVC_CHECK_GOTO(NULL != urb, "urb alloc failed", _alloc_failed);
     //Allocate data buffer for each URB and assign them
-    if (num_isoc_packets) {
-        /* ISOC urb: num_isoc_packets must be 0 for isoc urb */
-        data_buffer = heap_caps_calloc(num_isoc_packets, packet_data_buffer_size, MALLOC_CAP_DMA);
-    } else {
-        /* no ISOC urb */
-        data_buffer = heap_caps_calloc(1, packet_data_buffer_size, MALLOC_CAP_DMA);
-    }
+    /* ISOC urb: one buffer for all packets, no ISOC urb: num_isoc_packets is 0 */
+    size_t data_buffer_size = packet_data_buffer_size * (num_isoc_packets == 0 ? 1 : num_isoc_packets);
+    data_buffer = usb_stream_buf_alloc(data_buffer_size, USB_STREAM_BUF_URB, NULL);
     UVC_CHECK_GOTO(NULL != data_buffer, "urb data_buffer alloc failed", _alloc_failed);
+    memset(data_buffer, 0, data_buffer_size);
     //Initialize URB and underlying transfer structure. Need to cast to dummy due to const fields
-    size_t data_buffer_size = packet_data_buffer_size * (num_isoc_packets == 0 ? 1 : num_isoc_packets);
     usb_transfer_dummy_t *transfer_dummy = (usb_transfer_dummy_t *)&urb->transfer;
     transfer_dummy->data_buffer = data_buffer;
     transfer_dummy->data_buffer_size = data_buffer_size;
@@ -58,7 +162,7 @@ urb_t *_usb_urb_alloc(int num_isoc_packets, size_t packet_data_buffer_size, void
     return urb;
 _alloc_failed:
     free(urb);
-    free(data_buffer);
+    usb_stream_buf_free(data_buffer);
     return NULL;
 }
 
@@ -66,9 +170,7 @@ void _usb_urb_free(urb_t *urb)
 {
     UVC_CHECK_RETURN_VOID(NULL != urb, "urb = NULL");
     //Free data buffers of URB
-    if (urb->transfer.data_buffer) {
-        heap_caps_free(urb->transfer.data_buffer);
-    }
+    usb_stream_buf_free(urb->transfer.data_buffer);
     //Free the URB
     heap_caps_free(urb);
     ESP_LOGD(TAG, "urb free(%p)", urb);
@@ -138,6 +240,96 @@ void _usb_urb_list_free(urb_t **urb_list, uint32_t urb_num)
     }
 }
 
+/*------------------------------------------------ Bandwidth Code ---------------------------------------------------*/
+#define USB_BW_HOST_DELAY_NS            500
+#define USB_BW_FS_PERIODIC_NS           900000  // 90% of a full-speed frame
+#define USB_BW_HS_PERIODIC_NS           100000  // 80% of a high-speed microframe
+#define USB_BW_FS_BULK_MPS              64
+#define USB_BW_HS_BULK_MPS              512
+
+/* Bus time of one transaction, USB 2.0 5.11.3, with worst case bit stuffing */
+static uint32_t _usb_bw_xfer_ns(usb_speed_t speed, bool isoc, uint16_t bytes)
+{
+    // floor(3.167 + 7 / 6 * 8 * bytes)
+    uint32_t bits = (3167 * 6 + 56000 * (uint32_t)bytes) / 6000;
+    if (speed == USB_SPEED_HIGH) {
+        return (isoc ? 633 : 917) + 2083 * bits / 1000 + USB_BW_HOST_DELAY_NS;
+    }
+    if (speed == USB_SPEED_LOW) {
+        return 64060 + 67667 * bits / 100 + USB_BW_HOST_DELAY_NS;
+    }
+    return (isoc ? 7268 : 9107) + 8354 * bits / 100 + USB_BW_HOST_DELAY_NS;
+}
+
+void _usb_bw_plan_init(_usb_bw_plan_t *plan, usb_speed_t speed, uint32_t bulk_reserve_bytes)
+{
+    memset(plan, 0, sizeof(_usb_bw_plan_t));
+    plan->speed = speed;
+    uint32_t budget = (speed == USB_SPEED_HIGH) ? USB_BW_HS_PERIODIC_NS : USB_BW_FS_PERIODIC_NS;
+    uint16_t pkt = (speed == USB_SPEED_HIGH) ? USB_BW_HS_BULK_MPS : USB_BW_FS_BULK_MPS;
+    uint32_t reserve = (bulk_reserve_bytes / pkt) * _usb_bw_xfer_ns(speed, false, pkt);
+    if (bulk_reserve_bytes % pkt) {
+        reserve += _usb_bw_xfer_ns(speed, false, bulk_reserve_bytes % pkt);
+    }
+    plan->budget_ns = reserve < budget ? budget - reserve : 0;
+}
+
+bool _usb_bw_plan_ep(_usb_bw_plan_t *plan, uint8_t ep_attr, uint16_t ep_mps, uint8_t interval, bool commit)
+{
+    uint8_t type = ep_attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK;
+    if (type != USB_BM_ATTRIBUTES_XFER_ISOC && type != USB_BM_ATTRIBUTES_XFER_INT) {
+        // bulk and control use what periodic transfers leave
+        return true;
+    }
+    bool isoc = (type == USB_BM_ATTRIBUTES_XFER_ISOC);
+    // bits 12..11 of wMaxPacketSize: additional transactions per microframe, high speed only
+    uint8_t mult = (plan->speed == USB_SPEED_HIGH) ? ((ep_mps >> 11) & 0x03) + 1 : 1;
+    uint32_t ep_ns = mult * _usb_bw_xfer_ns(plan->speed, isoc, ep_mps & 0x07FF);
+
+    // period in (micro)frames, a power of 2, endpoints with longer periods are planned as USB_BW_SLOT_NUM
+    uint32_t period = 1;
+    if (isoc || plan->speed == USB_SPEED_HIGH) {
+        period = (interval > 1) ? (1U << ((interval > 16 ? 16 : interval) - 1)) : 1;
+    } else {
+        while (period * 2 <= interval) {
+            period *= 2;
+        }
+    }
+    period = period > USB_BW_SLOT_NUM ? USB_BW_SLOT_NUM : period;
+
+    // take the phase with the lightest peak
+    uint8_t phase = 0;
+    uint32_t phase_peak = UINT32_MAX;
+    for (uint8_t i = 0; i < period; i++) {
+        uint32_t peak = 0;
+        for (uint8_t slot = i; slot < USB_BW_SLOT_NUM; slot += period) {
+            peak = plan->slot_ns[slot] > peak ? plan->slot_ns[slot] : peak;
+        }
+        if (peak < phase_peak) {
+            phase_peak = peak;
+            phase = i;
+        }
+    }
+    if (phase_peak + ep_ns > plan->budget_ns) {
+        return false;
+    }
+    if (commit) {
+        for (uint8_t slot = phase; slot < USB_BW_SLOT_NUM; slot += period) {
+            plan->slot_ns[slot] += ep_ns;
+        }
+    }
+    return true;
+}
+
+uint32_t _usb_bw_plan_peak(const _usb_bw_plan_t *plan)
+{
+    uint32_t peak = 0;
+    for (size_t i = 0; i < USB_BW_SLOT_NUM; i++) {
+        peak = plan->slot_ns[i] > peak ? plan->slot_ns[i] : peak;
+    }
+    return peak;
+}
+
 /*------------------------------------------------ USB Port Code ----------------------------------------------------*/
 hcd_port_event_t _usb_port_event_dflt_process(hcd_port_handle_t port_hdl, hcd_port_event_t event)
 {
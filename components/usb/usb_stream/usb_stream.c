@@ -21,6 +21,8 @@
 #include "esp_err.h"
 #include "esp_attr.h"
 #include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_cpu.h"
 #include "hcd.h"
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
 #include "hal/usb_dwc_ll.h"
@@ -30,6 +32,7 @@
 #include "usb/usb_helpers.h"
 #include "usb_private.h"
 #include "usb_stream_descriptor.h"
+#include "usb_desc_index.h"
 #include "usb_host_helpers.h"
 #include "usb_stream.h"
 #include "usb_stream_sysview.h"
@@ -45,6 +48,15 @@ static const char *TAG = "USB_STREAM";
 #define USB_EP_ISOC_IN_MAX_MPS               512                                         //Max MPS ESP32-S2/S3 can handle
 #define USB_EP_BULK_FS_MPS                   64                                          //Default MPS of full speed bulk transfer
 #define USB_EP_BULK_HS_MPS                   512                                         //Default MPS of high speed bulk transfer
+#define USB_EP_ISOC_HS_MAX_MPS               1024                                        //Max bytes of one high speed isoc transaction
+#define USB_EP_MPS_SIZE(wMaxPacketSize)      ((wMaxPacketSize) & 0x07FF)                 //Bits 10..0: bytes per transaction
+#define USB_EP_MPS_MULT(wMaxPacketSize)      ((((wMaxPacketSize) >> 11) & 0x03) + 1)     //Bits 12..11: additional transactions per microframe (HS only)
+#define USB_EP_MPS_TOTAL(wMaxPacketSize)     (USB_EP_MPS_SIZE(wMaxPacketSize) * USB_EP_MPS_MULT(wMaxPacketSize))
+#ifdef CONFIG_USB_STREAM_HS_HIGH_BANDWIDTH
+#define USB_EP_ISOC_HS_MAX_MULT              3                                           //Max transactions per microframe
+#else
+#define USB_EP_ISOC_HS_MAX_MULT              1
+#endif
 #define USB_EP_DIR_MASK                      0x80                                        //Mask for endpoint direction
 #define USB_EVENT_QUEUE_LEN                  8                                           //USB event queue length
 #define USB_STREAM_EVENT_QUEUE_LEN           32                                          //Stream event queue length
@@ -58,11 +70,22 @@ static const char *TAG = "USB_STREAM";
 #define TIMEOUT_USB_STREAM_DISCONNECT_MS     (TIMEOUT_USB_CTRL_XFER_MS + 100)            //Timeout for usb stream disconnect
 #define TIMEOUT_USER_COMMAND_MS              (TIMEOUT_USB_CTRL_XFER_MS + 200)            //Timeout for USER COMMAND control transfer
 #define ACTIVE_DEBOUNCE_TIME_MS              100                                         //Debounce time for active state
+#define UVC_SCR_SOF_AGE_MAX                  64                                          //SCR SOF counter older than this (ms) is not following the bus
+#define UVC_CAPTURE_TIME_SKEW_MAX_US         1000000                                     //PTS converted further than this from the frame arrival is ignored
 #define CTRL_TRANSFER_DATA_MAX_BYTES         CONFIG_CTRL_TRANSFER_DATA_MAX_BYTES         //Max data length assumed in control transfer
 #define NUM_BULK_STREAM_URBS                 CONFIG_NUM_BULK_STREAM_URBS                 //Number of bulk stream URBS created for continuous enqueue
 #define NUM_BULK_BYTES_PER_URB               CONFIG_NUM_BULK_BYTES_PER_URB               //Required transfer bytes of each URB, check
 #define NUM_ISOC_UVC_URBS                    CONFIG_NUM_ISOC_UVC_URBS                    //Number of isochronous stream URBS created for continuous enqueue
 #define NUM_PACKETS_PER_URB                  CONFIG_NUM_PACKETS_PER_URB                  //Number of packets in each isochronous stream URB
+#define USB_BULK_FS_BYTES_PER_MS             (19 * USB_EP_BULK_FS_MPS)                   //Max 19 full speed bulk packets in each 1ms frame
+#define USB_BULK_HS_BYTES_PER_MS             (13 * USB_EP_BULK_HS_MPS * 8)               //Max 13 high speed bulk packets in each 125us microframe
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+#define UVC_BULK_URB_BYTES_MAX               CONFIG_UVC_BULK_URB_BYTES_MAX               //Upper bound of the runtime bulk URB size
+#define UVC_BULK_URB_NUM_MAX                 CONFIG_UVC_BULK_URB_NUM_MAX                 //Upper bound of the runtime bulk URB number
+#define UVC_BULK_URB_RING_MS                 CONFIG_UVC_BULK_URB_RING_MS                 //Bus time the queued bulk URBs should cover
+#define UVC_BULK_URBS_PER_FRAME              4                                           //Keep a frame spread over several URBs, so EOF is not delayed by one big URB
+#define UVC_BULK_TUNE_FRAMES                 60                                          //Re-evaluate bulk URB layout every n frames
+#endif
 #define WAITING_USB_AFTER_CONNECTION_MS      CONFIG_USB_WAITING_AFTER_CONN_MS            //Waiting n ms for usb device ready after connection
 #define NUM_ISOC_SPK_URBS                    CONFIG_NUM_ISOC_SPK_URBS                    //Number of isochronous stream URBS created for continuous enqueue
 #define NUM_ISOC_MIC_URBS                    CONFIG_NUM_ISOC_MIC_URBS                    //Number of isochronous stream URBS created for continuous enqueue
@@ -101,11 +124,7 @@ static const char *TAG = "USB_STREAM";
 #define SAMPLE_PROC_TASK_NAME "sample_proc"
 #define SAMPLE_PROC_TASK_PRIORITY CONFIG_SAMPLE_PROC_TASK_PRIORITY
 #define SAMPLE_PROC_TASK_STACK_SIZE CONFIG_SAMPLE_PROC_TASK_STACK_SIZE
-#if (CONFIG_SAMPLE_PROC_TASK_CORE == -1)
-#define SAMPLE_PROC_TASK_CORE tskNO_AFFINITY
-#else
 #define SAMPLE_PROC_TASK_CORE CONFIG_SAMPLE_PROC_TASK_CORE
-#endif
 
 /**
  * @brief Events bit map
@@ -174,6 +193,14 @@ static const char *TAG = "USB_STREAM";
         (ctrl_req_ptr)->wLength = 26;   \
     })
 
+#define USB_CTRL_UVC_VC_REQ(ctrl_req_ptr, req, selector, unit_id, vc_itf, len) ({  \
+        (ctrl_req_ptr)->bmRequestType = ((req) & 0x80) ? 0xA1 : 0x21;   \
+        (ctrl_req_ptr)->bRequest = req;    \
+        (ctrl_req_ptr)->wValue = ((selector) << 8); \
+        (ctrl_req_ptr)->wIndex = (((unit_id) << 8) | (0x00ff & (vc_itf)));    \
+        (ctrl_req_ptr)->wLength = len;   \
+    })
+
 enum uac_ep_ctrl_cs {
     UAC_EP_CONTROL_UNDEFINED = 0x00,
     UAC_SAMPLING_FREQ_CONTROL = 0x01,
@@ -216,8 +243,13 @@ enum uac_fu_ctrl_cs {
 
 /*************************************** UVC Probe Helpers ********************************************/
 
+/** bmHint bits, fields the device should keep fixed in the negotiation */
+#define UVC_PROBE_HINT_FRAME_INTERVAL   (1 << 0)
+#define UVC_PROBE_HINT_COMP_QUALITY     (1 << 3)
+#define UVC_PROBE_HINT_COMP_WINDOW      (1 << 4)
+
 #define DEFAULT_UVC_STREAM_CTRL() {\
-    .bmHint = 1,\
+    .bmHint = UVC_PROBE_HINT_FRAME_INTERVAL,\
     .bFormatIndex = 2,\
     .bFrameIndex = 3,\
     .dwFrameInterval = 666666,\
@@ -387,7 +419,23 @@ typedef struct {
     hcd_pipe_handle_t pipe_handle;
 } _stream_ifc_t;
 
+#define UVC_FRAME_POOL_SLOT_NONE      0xff
+
+/**
+ * @brief N-slot frame pool, slots are sized from the probed dwMaxVideoFrameSize.
+ * free slots are handed out lock-free from payload path with free_mask,
+ * complete frames are passed to sample task through ready_queue
+ */
 typedef struct {
+    uint8_t num;
+    size_t slot_size;
+    uint8_t *slot_buf[UVC_FRAME_POOL_MAX_NUM];
+    uvc_frame_t frame[UVC_FRAME_POOL_MAX_NUM];
+    uint32_t free_mask;
+    QueueHandle_t ready_queue;
+} _uvc_frame_pool_t;
+
+typedef struct _uvc_stream_handle {
     /** if true, stream is running (streaming video to host) */
     uvc_device_handle_t devh;
     uint8_t running;
@@ -396,11 +444,38 @@ typedef struct {
     uint8_t fid;
     uint8_t reassemble_flag;
     uint8_t reassembling;
+    /** header info of the payload transfer being reassembled */
+    uint8_t rsb_header_info;
+    /** payload path selected by _uvc_payload_path_select() */
+    void (*process_payload)(struct _uvc_stream_handle *strmh, size_t req_len, uint8_t *payload, size_t payload_len);
     uint32_t seq, hold_seq;
+    /** frame gate, decided on the first data of each frame, see uvc_frame_decimate */
+    bool frame_decided;
+    bool frame_skip;
+    uint16_t decimate_cnt;
+    /** frame size of the payload being received, changed by uvc_frame_size_switch */
+    uint16_t width, hold_width;
+    uint16_t height, hold_height;
     uint32_t pts, hold_pts;
     uint32_t last_scr, hold_last_scr;
+    /** first SCR of the frame: device clock (STC) and esp_timer time of the SOF it was sampled at, 0 if none */
+    uint32_t scr_stc;
+    int64_t scr_us;
+    /** esp_timer time of the first payload of the frame */
+    int64_t sof_us;
+    /** capture start of the held frame, esp_timer time */
+    int64_t hold_capture_us;
     size_t got_bytes, hold_bytes;
+    /** moving average of received frame size, used to size bulk urbs */
+    uint32_t frame_bytes_avg;
+    uint16_t tune_frames;
     uint8_t *outbuf, *holdbuf;
+    size_t outbuf_size;
+    /** if true, holdbuf is borrowed by user (zero-copy mode), can not be swapped */
+    bool hold_borrowed;
+    /** frame pool, NULL if using xfer_buffer_a/b */
+    _uvc_frame_pool_t *pool;
+    uint8_t out_slot;
     uvc_frame_callback_t user_cb;
     void *user_ptr;
     SemaphoreHandle_t cb_mutex;
@@ -422,6 +497,19 @@ typedef struct {
     uint16_t frame_width;
     uint16_t frame_height;
     uint32_t frame_interval;
+    _uvc_frame_pool_t frame_pool;
+    /** video control interface, camera terminal/processing unit id (0 if not found) and bmControls */
+    uint8_t vc_interface;
+    uint8_t vc_unit_id[UVC_VC_UNIT_MAX];
+    uint32_t vc_controls[UVC_VC_UNIT_MAX];
+    /** device clock of PTS/SCR, dwClockFrequency of the VC header, 0 if unknown */
+    uint32_t vc_clock_hz;
+    /** requested wCompQuality/wCompWindowSize, 0 camera default, see uvc_compression_set */
+    uint16_t comp_quality;
+    uint16_t comp_window;
+    /** result of the last negotiation, quality range valid if comp_range_valid */
+    uvc_compression_t comp;
+    bool comp_range_valid;
 } _uvc_device_t;
 
 typedef enum {
@@ -430,6 +518,18 @@ typedef enum {
     UAC_MAX,
 } _uac_internal_stream_t;
 
+/**
+ * @brief Header of one mic span in the zero-copy ring (FLAG_UAC_MIC_ZERO_COPY), data follows
+ */
+typedef struct {
+    uint32_t seq;
+    uint32_t data_bytes;
+    int64_t timestamp_us;
+    uint16_t frame_num;
+    uint16_t packets;
+    uint16_t lost;
+} _uac_mic_span_hdr_t;
+
 typedef struct {
     // dynamic values, but using in single thread
     _stream_ifc_t *as_ifc[UAC_MAX];
@@ -440,8 +540,17 @@ typedef struct {
     uint8_t *mic_frame_buf;
     uint32_t mic_frame_buf_size;
     uint32_t mic_ms_bytes;
+    uint32_t mic_span_seq;
     uint32_t spk_ms_bytes;
     uint32_t spk_max_xfer_size;
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+    struct {
+        uint16_t target_ms;
+        uint8_t urb_ms;
+        bool playing;
+        int32_t level_avg;          // moving average of buffered bytes, 1/16 per transfer
+    } spk_jb;
+#endif
     uac_frame_size_t *frame_size[UAC_MAX];
     uint8_t frame_num[UAC_MAX];
     uint8_t frame_index[UAC_MAX];
@@ -464,6 +573,33 @@ typedef struct {
 
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 1, 0)
 
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+/* The HS controller has a deeper FIFO, keep these in line with the host driver layout */
+#ifndef USB_DWC_FIFO_RX_LINES_DEFAULT
+#define USB_DWC_FIFO_RX_LINES_DEFAULT 512
+#endif
+
+#ifndef USB_DWC_FIFO_NPTX_LINES_DEFAULT
+#define USB_DWC_FIFO_NPTX_LINES_DEFAULT 256
+#endif
+
+#ifndef USB_DWC_FIFO_PTX_LINES_DEFAULT
+#define USB_DWC_FIFO_PTX_LINES_DEFAULT 256
+#endif
+
+#ifndef USB_DWC_FIFO_RX_LINES_BIASRX
+#define USB_DWC_FIFO_RX_LINES_BIASRX 832
+#endif
+
+#ifndef USB_DWC_FIFO_NPTX_LINES_BIASRX
+#define USB_DWC_FIFO_NPTX_LINES_BIASRX 64
+#endif
+
+#ifndef USB_DWC_FIFO_PTX_LINES_BIASRX
+#define USB_DWC_FIFO_PTX_LINES_BIASRX 128
+#endif
+#endif
+
 #ifndef USB_DWC_FIFO_RX_LINES_DEFAULT
 #define USB_DWC_FIFO_RX_LINES_DEFAULT 104
 #endif
@@ -505,6 +641,46 @@ extern const fifo_mps_limits_t mps_limits_bias_rx;
 #define s_mps_limits_bias_rx mps_limits_bias_rx
 #endif
 
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+typedef struct {
+    uint16_t vid;
+    uint16_t pid;
+    uint16_t bcd_device;
+} _usb_dev_id_t;
+
+/**
+ * @brief Enumeration result of the last device, survives reconnect, recover and streaming restart
+ */
+typedef struct {
+    _usb_dev_id_t dev_id;
+    uint8_t *config_desc;
+    uint16_t config_desc_len;
+    // last committed probe control, and the request it was negotiated with
+    bool ctrl_valid;
+    uvc_stream_ctrl_t ctrl_set;
+    uvc_stream_ctrl_t ctrl_probed;
+} _usb_enum_cache_t;
+#endif
+
+/**
+ * @brief Statistics, counters are written by the task owning the event without lock,
+ * rates are computed in usb task from the counter deltas of each window
+ */
+typedef struct {
+    usb_stream_stats_t pub;
+    uint32_t rx_bytes;                  // uvc payload bytes received
+    uint32_t frame_bytes;               // bytes of frames delivered
+    uint32_t payload_cycles;            // cpu cycles spent in process_payload
+    int64_t window_start_us;
+    uint32_t window_rx_bytes;
+    uint32_t window_payload_cycles;
+    uint32_t window_frame_bytes;
+    uint32_t window_frames;
+    // frames and length of the last complete window, fps computed by reader
+    uint32_t last_window_frames;
+    uint32_t last_window_us;
+} _usb_stream_stats_t;
+
 typedef struct {
     // const user config values
     uac_config_t uac_cfg;
@@ -519,6 +695,7 @@ typedef struct {
     QueueHandle_t queue_hdl;
     QueueHandle_t stream_queue_hdl;
     TaskHandle_t stream_task_hdl;
+    TaskHandle_t usb_task_hdl;
     EventGroupHandle_t event_group_hdl;
     SemaphoreHandle_t xfer_mutex_hdl;
     SemaphoreHandle_t ctrl_smp_hdl;
@@ -537,17 +714,56 @@ typedef struct {
     state_callback_t state_cb;
     void *state_cb_arg;
     uint32_t flags;
+    volatile uint16_t uvc_decimate;
+    _usb_stream_stats_t stats;
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+    // id of the device being enumerated, read from device descriptor
+    _usb_dev_id_t dev_id;
+#endif
 } _usb_device_t;
 
 /**
  * @brief Singleton Pattern, Only one device supported
  *
+ * Kept in the core dump when it goes to flash, the stacks alone do not show the
+ * enum stage, state and stream flags at the time of a crash.
  */
+#ifdef CONFIG_ESP_COREDUMP_ENABLE_TO_FLASH
+static COREDUMP_DRAM_ATTR _usb_device_t s_usb_dev = {0};
+#else
 static _usb_device_t s_usb_dev = {0};
+#endif
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+static _usb_enum_cache_t s_enum_cache = {0};
+#endif
+/**
+ * @brief Extra consumers of the uvc frames, slots are stable so the handle is the slot address
+ */
+typedef struct uvc_view {
+    uvc_frame_callback_t cb;
+    void *cb_arg;
+    uint16_t every_n;
+    uint8_t priority;
+    uint32_t cnt;
+} _uvc_view_t;
+static _uvc_view_t s_uvc_views[CONFIG_UVC_VIEW_MAX_NUM] = {0};
+/**
+ * @brief Task topology, kept across usb_streaming_stop
+ */
+static usb_stream_task_config_t s_task_cfg = {
+    .usb_proc = {USB_PROC_TASK_CORE, USB_PROC_TASK_PRIORITY, USB_PROC_TASK_STACK_SIZE},
+    .stream_proc = {USB_STREAM_CORE, USB_STREAM_PRIORITY, USB_STREAM_STACK_SIZE},
+    .sample_proc = {SAMPLE_PROC_TASK_CORE, SAMPLE_PROC_TASK_PRIORITY, SAMPLE_PROC_TASK_STACK_SIZE},
+};
 static portMUX_TYPE s_uvc_lock = portMUX_INITIALIZER_UNLOCKED;
 #define UVC_ENTER_CRITICAL()           portENTER_CRITICAL(&s_uvc_lock)
 #define UVC_EXIT_CRITICAL()            portEXIT_CRITICAL(&s_uvc_lock)
 
+static inline BaseType_t _task_core(int8_t core_id)
+{
+    return core_id < 0 ? tskNO_AFFINITY : core_id;
+}
+
 typedef enum {
     USER_EVENT,
     PORT_EVENT,
@@ -619,7 +835,65 @@ IRAM_ATTR static bool _usb_pipe_callback(hcd_pipe_handle_t pipe_handle, hcd_pipe
     }
 }
 
-static void _uvc_process_payload(_uvc_stream_handle_t *strmh, size_t req_len, uint8_t *payload, size_t payload_len);
+#define USB_STREAM_STATS_WINDOW_US        (1000 * 1000)
+#define USB_STREAM_STATS_LATENCY_SHIFT    4   // urb latency moving average weight 1/16
+
+/**
+ * @brief Stamp the enqueue time of a stream urb, stream urbs do not use the transfer context
+ */
+IRAM_ATTR static inline void _usb_stats_urb_stamp(urb_t *urb)
+{
+    urb->transfer.context = (void *)(uintptr_t)((uint32_t)esp_timer_get_time() | 1);
+}
+
+IRAM_ATTR static void _usb_stats_urb_done(usb_stream_t stream, urb_t *urb)
+{
+    usb_stream_pipe_stats_t *pipe = &s_usb_dev.stats.pub.pipe[stream];
+    pipe->urb_done++;
+    if (urb->transfer.context == NULL) {
+        return;
+    }
+    uint32_t latency = (uint32_t)esp_timer_get_time() - (uint32_t)(uintptr_t)urb->transfer.context;
+    if (latency > pipe->urb_latency_us_max) {
+        pipe->urb_latency_us_max = latency;
+    }
+    if (pipe->urb_latency_us == 0) {
+        pipe->urb_latency_us = latency;
+    } else {
+        pipe->urb_latency_us += ((int32_t)latency - (int32_t)pipe->urb_latency_us) >> USB_STREAM_STATS_LATENCY_SHIFT;
+    }
+}
+
+/**
+ * @brief Close the rate window if it is long enough, called in usb task for each uvc urb
+ */
+IRAM_ATTR static void _uvc_stats_window_update(void)
+{
+    _usb_stream_stats_t *stats = &s_usb_dev.stats;
+    int64_t now = esp_timer_get_time();
+    int64_t elapsed = now - stats->window_start_us;
+    if (stats->window_start_us && elapsed < USB_STREAM_STATS_WINDOW_US) {
+        return;
+    }
+    uint32_t frames = stats->pub.uvc.frames - stats->window_frames;
+    if (stats->window_start_us) {
+        uint32_t rx_bytes = stats->rx_bytes - stats->window_rx_bytes;
+        stats->pub.uvc.bytes_per_sec = (uint64_t)rx_bytes * 1000000 / elapsed;
+        if (rx_bytes) {
+            stats->pub.uvc.payload_cycles_per_byte = (float)(stats->payload_cycles - stats->window_payload_cycles) / rx_bytes;
+        }
+        if (frames) {
+            stats->pub.uvc.frame_bytes_avg = (stats->frame_bytes - stats->window_frame_bytes) / frames;
+        }
+        stats->last_window_frames = frames;
+        stats->last_window_us = elapsed;
+    }
+    stats->window_start_us = now;
+    stats->window_rx_bytes = stats->rx_bytes;
+    stats->window_payload_cycles = stats->payload_cycles;
+    stats->window_frame_bytes = stats->frame_bytes;
+    stats->window_frames += frames;
+}
 
 IRAM_ATTR static void _processing_uvc_pipe(_uvc_stream_handle_t *strmh, hcd_pipe_handle_t pipe_handle, bool if_enqueue)
 {
@@ -631,29 +905,37 @@ IRAM_ATTR static void _processing_uvc_pipe(_uvc_stream_handle_t *strmh, hcd_pipe
         ESP_LOGV(TAG, "uvc pipe dequeue failed");
         return;
     }
+    _usb_stats_urb_done(STREAM_UVC, urb_done);
 
+    uint32_t cycles = esp_cpu_get_cycle_count();
     if (urb_done->transfer.num_isoc_packets == 0) { // Bulk transfer
-        if (urb_done->transfer.actual_num_bytes > 0) {
-            _uvc_process_payload(strmh, urb_done->transfer.num_bytes, urb_done->transfer.data_buffer, urb_done->transfer.actual_num_bytes);
-        }
+        // zero length completion is passed too, it ends a reassembled payload transfer
+        strmh->process_payload(strmh, urb_done->transfer.num_bytes, urb_done->transfer.data_buffer, urb_done->transfer.actual_num_bytes);
+        s_usb_dev.stats.rx_bytes += urb_done->transfer.actual_num_bytes;
     } else { // isoc transfer
         for (size_t i = 0; i < urb_done->transfer.num_isoc_packets; i++) {
             if (urb_done->transfer.isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
                 ESP_LOGV(TAG, "line:%u bad iso transit status %d", __LINE__, urb_done->transfer.isoc_packet_desc[i].status);
+                s_usb_dev.stats.pub.pipe[STREAM_UVC].packet_err++;
                 continue;
             }
 
-            uint8_t *simplebuffer = urb_done->transfer.data_buffer + (i * s_usb_dev.uvc->vs_ifc->ep_mps);
-            ESP_LOGV(TAG, "process payload=%u, len = %d", i, urb_done->transfer.isoc_packet_desc[i].actual_num_bytes);
-            _uvc_process_payload(strmh, (urb_done->transfer.isoc_packet_desc[i].num_bytes), simplebuffer, (urb_done->transfer.isoc_packet_desc[i].actual_num_bytes));
+            uint8_t *simplebuffer = urb_done->transfer.data_buffer + (i * s_usb_dev.uvc->vs_ifc->bytes_per_packet);
+            strmh->process_payload(strmh, (urb_done->transfer.isoc_packet_desc[i].num_bytes), simplebuffer, (urb_done->transfer.isoc_packet_desc[i].actual_num_bytes));
+            s_usb_dev.stats.rx_bytes += urb_done->transfer.isoc_packet_desc[i].actual_num_bytes;
         }
     }
+    // cycle counter is per core, valid while usb task is pinned (the default)
+    s_usb_dev.stats.payload_cycles += esp_cpu_get_cycle_count() - cycles;
+    _uvc_stats_window_update();
 
     if (if_enqueue) {
+        _usb_stats_urb_stamp(urb_done);
         esp_err_t ret = hcd_urb_enqueue(pipe_handle, urb_done);
         if (ret != ESP_OK) {
             // We not handle the error because the usb stream task will handle it
             ESP_LOGE(TAG, "UVC urb enqueue failed %s", esp_err_to_name(ret));
+            s_usb_dev.stats.pub.pipe[STREAM_UVC].enqueue_fail++;
         }
 
     }
@@ -661,6 +943,42 @@ IRAM_ATTR static void _processing_uvc_pipe(_uvc_stream_handle_t *strmh, hcd_pipe
 }
 
 /*------------------------------------------------ USB Control Process Code ----------------------------------------------------*/
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+#define USB_EP_ISOC_MAX_BYTES                (s_usb_dev.dev_speed == USB_SPEED_HIGH ? USB_EP_ISOC_HS_MAX_MPS * USB_EP_ISOC_HS_MAX_MULT : USB_EP_ISOC_IN_MAX_MPS)
+#else
+#define USB_EP_ISOC_MAX_BYTES                USB_EP_ISOC_IN_MAX_MPS
+#endif
+
+/**
+ * @brief Clamp an isoc IN wMaxPacketSize to what the current port speed and FIFO layout can handle
+ *
+ * Full speed: one transaction per frame, up to USB_EP_ISOC_IN_MAX_MPS bytes.
+ * High speed: up to USB_EP_ISOC_HS_MAX_MPS bytes and USB_EP_ISOC_HS_MAX_MULT transactions per microframe,
+ * each transaction must fit in the RX FIFO.
+ */
+static uint16_t _isoc_in_mps_clamp(uint16_t wMaxPacketSize)
+{
+    uint16_t size = USB_EP_MPS_SIZE(wMaxPacketSize);
+    uint8_t mult = USB_EP_MPS_MULT(wMaxPacketSize);
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+    if (s_usb_dev.dev_speed == USB_SPEED_HIGH) {
+        uint16_t size_max = USB_EP_ISOC_HS_MAX_MPS;
+        if (s_usb_dev.mps_limits && s_usb_dev.mps_limits->in_mps < size_max) {
+            size_max = s_usb_dev.mps_limits->in_mps;
+        }
+        size = size > size_max ? size_max : size;
+        mult = mult > USB_EP_ISOC_HS_MAX_MULT ? USB_EP_ISOC_HS_MAX_MULT : mult;
+        return ((mult - 1) << 11) | size;
+    }
+#endif
+    return size > USB_EP_ISOC_IN_MAX_MPS ? USB_EP_ISOC_IN_MAX_MPS : size;
+}
+
+static inline bool _isoc_in_mps_supported(uint16_t wMaxPacketSize)
+{
+    return _isoc_in_mps_clamp(wMaxPacketSize) == wMaxPacketSize;
+}
+
 static esp_err_t _apply_pipe_config(usb_stream_t stream)
 {
     _usb_device_t *usb_dev = &s_usb_dev;
@@ -673,8 +991,12 @@ static esp_err_t _apply_pipe_config(usb_stream_t stream)
         usb_dev->ifc[STREAM_UVC]->ep_mps = usb_dev->uvc_cfg.ep_mps;
         usb_dev->ifc[STREAM_UVC]->xfer_type = usb_dev->uvc_cfg.xfer_type;
 #endif
-        if (usb_dev->ifc[STREAM_UVC]->ep_mps > USB_EP_ISOC_IN_MAX_MPS) {
-            usb_dev->ifc[STREAM_UVC]->ep_mps = USB_EP_ISOC_IN_MAX_MPS;
+        if (usb_dev->ifc[STREAM_UVC]->xfer_type == UVC_XFER_BULK) {
+            if (usb_dev->ifc[STREAM_UVC]->ep_mps > USB_EP_BULK_HS_MPS) {
+                usb_dev->ifc[STREAM_UVC]->ep_mps = USB_EP_BULK_HS_MPS;
+            }
+        } else {
+            usb_dev->ifc[STREAM_UVC]->ep_mps = _isoc_in_mps_clamp(usb_dev->ifc[STREAM_UVC]->ep_mps);
         }
     }
     if (stream == STREAM_UAC_MIC && usb_dev->enabled[STREAM_UAC_MIC] && !usb_dev->ifc[STREAM_UAC_MIC]->not_found) {
@@ -749,11 +1071,14 @@ static esp_err_t _apply_stream_config(usb_stream_t stream)
         if (usb_dev->ifc[STREAM_UVC]->xfer_type == UVC_XFER_BULK) {
             usb_dev->ifc[STREAM_UVC]->urb_num = NUM_BULK_STREAM_URBS;
             usb_dev->ifc[STREAM_UVC]->packets_per_urb = 1;
-            usb_dev->ifc[STREAM_UVC]->bytes_per_packet = NUM_BULK_BYTES_PER_URB;
+            // HS bulk needs the URB size to be a multiple of 512
+            usb_dev->ifc[STREAM_UVC]->bytes_per_packet = USB_EP_MPS_SIZE(usb_dev->ifc[STREAM_UVC]->ep_mps) ?
+                                                           usb_round_up_to_mps(NUM_BULK_BYTES_PER_URB, USB_EP_MPS_SIZE(usb_dev->ifc[STREAM_UVC]->ep_mps)) : NUM_BULK_BYTES_PER_URB;
         } else {
             usb_dev->ifc[STREAM_UVC]->urb_num = NUM_ISOC_UVC_URBS;
             usb_dev->ifc[STREAM_UVC]->packets_per_urb = NUM_PACKETS_PER_URB;
-            usb_dev->ifc[STREAM_UVC]->bytes_per_packet = usb_dev->ifc[STREAM_UVC]->ep_mps;
+            // one isoc packet per (micro)frame carries all mult transactions
+            usb_dev->ifc[STREAM_UVC]->bytes_per_packet = USB_EP_MPS_TOTAL(usb_dev->ifc[STREAM_UVC]->ep_mps);
         }
         ESP_LOGD(TAG, "UVC format_index=%"PRIu8", frame_index=%"PRIu8", frame_width=%"PRIu16", frame_height=%"PRIu16", frame_interval=%"PRIu32,
                  usb_dev->uvc->format_index, usb_dev->uvc->frame_index, usb_dev->uvc->frame_width, usb_dev->uvc->frame_height, usb_dev->uvc->frame_interval);
@@ -791,6 +1116,11 @@ static esp_err_t _apply_stream_config(usb_stream_t stream)
             ESP_LOGE(TAG, "mic_buf_size=%"PRIu32" must >= mic_min_bytes %"PRIu32, usb_dev->uac_cfg.mic_buf_size, mic_min_bytes);
             assert(0);
         }
+        if (usb_dev->uac->ringbuf_hdl[UAC_MIC] && (usb_dev->flags & FLAG_UAC_MIC_ZERO_COPY)
+                && xRingbufferGetMaxItemSize(usb_dev->uac->ringbuf_hdl[UAC_MIC]) < sizeof(_uac_mic_span_hdr_t) + mic_min_bytes) {
+            ESP_LOGE(TAG, "mic_buf_size=%"PRIu32" too small for one span of %u B", usb_dev->uac_cfg.mic_buf_size, (unsigned)(sizeof(_uac_mic_span_hdr_t) + mic_min_bytes));
+            assert(0);
+        }
         usb_dev->uac->mic_frame_buf = heap_caps_realloc(usb_dev->uac->mic_frame_buf, mic_min_bytes, MALLOC_CAP_INTERNAL);
         UVC_CHECK(usb_dev->uac->mic_frame_buf, "alloc mic frame buf failed", ESP_ERR_NO_MEM);
         usb_dev->uac->mic_frame_buf_size = mic_min_bytes;
@@ -832,22 +1162,98 @@ static esp_err_t _apply_stream_config(usb_stream_t stream)
     return ESP_OK;
 }
 
-static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_desc)
+#ifdef CONFIG_UVC_PRINT_DESC
+static void _print_config_descriptor(const usb_config_desc_t *cfg_desc)
 {
-    if (cfg_desc == NULL) {
-        return ESP_ERR_INVALID_ARG;
+    int offset = 0;
+    uint8_t context_class = 0;
+    uint8_t context_subclass = 0;
+    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)cfg_desc;
+
+    do {
+        switch (next_desc->bDescriptorType) {
+        case USB_B_DESCRIPTOR_TYPE_CONFIGURATION:
+            print_cfg_desc((const uint8_t *)next_desc);
+            break;
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION:
+            print_assoc_desc((const uint8_t *)next_desc);
+            break;
+        case USB_B_DESCRIPTOR_TYPE_INTERFACE:
+            context_class = ((const usb_intf_desc_t *)next_desc)->bInterfaceClass;
+            context_subclass = ((const usb_intf_desc_t *)next_desc)->bInterfaceSubClass;
+            print_intf_desc((const uint8_t *)next_desc);
+            break;
+        case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
+            print_ep_desc((const uint8_t *)next_desc);
+            break;
+        case CS_INTERFACE_DESC:
+            /* audio class specific descriptors are printed while they are parsed */
+            if (context_class != USB_CLASS_VIDEO || context_subclass != VIDEO_SUBCLASS_STREAMING) {
+                break;
+            }
+            switch (((const desc_header_t *)next_desc)->bDescriptorSubtype) {
+            case VIDEO_CS_ITF_VS_INPUT_HEADER:
+                print_uvc_header_desc((const uint8_t *)next_desc, VIDEO_SUBCLASS_STREAMING);
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+                parse_vs_format_mjpeg_desc((const uint8_t *)next_desc, NULL, NULL, NULL);
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+                parse_vs_format_uncompressed_desc((const uint8_t *)next_desc, NULL, NULL, NULL);
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+                parse_vs_format_frame_based_desc((const uint8_t *)next_desc, NULL, NULL, NULL);
+                break;
+            case VIDEO_CS_ITF_VS_FRAME_UNCOMPRESSED:
+            case VIDEO_CS_ITF_VS_FRAME_MJPEG:
+                parse_vs_frame_mjpeg_desc((const uint8_t *)next_desc, NULL, NULL, NULL, NULL, NULL, NULL);
+                break;
+            case VIDEO_CS_ITF_VS_FRAME_FRAME_BASED:
+                parse_vs_frame_frame_based_desc((const uint8_t *)next_desc, NULL, NULL, NULL, NULL, NULL, NULL);
+                break;
+            default:
+                break;
+            }
+            break;
+        default:
+            break;
+        }
+        next_desc = usb_parse_next_descriptor(next_desc, cfg_desc->wTotalLength, &offset);
+    } while (next_desc != NULL);
+}
+#endif
+
+/* Pick the frame interval closest below the wanted one, 0 if the frame doesn't support it */
+static uint32_t _uvc_frame_interval_select(const usb_config_desc_t *cfg_desc, const usb_desc_uvc_frame_t *frame, uint32_t want)
+{
+    if (frame->interval_type) {
+        for (uint8_t i = 0; i < frame->interval_type; i++) {
+            if (usb_desc_index_frame_interval(cfg_desc, frame, i) == want) {
+                return want;
+            }
+        }
+        return 0;
     }
+    if (want < frame->interval_min || want > frame->interval_max) {
+        return 0;
+    }
+    if (frame->interval_step == 0) {
+        return frame->interval_min;
+    }
+    return frame->interval_min + (want - frame->interval_min) / frame->interval_step * frame->interval_step;
+}
+
+static esp_err_t _update_config_from_index(const usb_config_desc_t *cfg_desc, const usb_desc_index_t *index)
+{
     _uac_device_t *uac_dev = s_usb_dev.uac;
     _uvc_device_t *uvc_dev = s_usb_dev.uvc;
     _usb_device_t *usb_dev = &s_usb_dev;
-    int offset = 0;
-    bool already_next = false;
-    uint16_t wTotalLength = cfg_desc->wTotalLength;
     /* flags indicate if required setting format and frame found */
     bool format_set_found = false;
     uint8_t format_idx = 0;
     uint8_t frame_num = 0;
     enum uvc_frame_format format = UVC_FRAME_FORMAT_UNKNOWN;
+    const usb_desc_uvc_format_t *vs_format = NULL;
     /* flags user defined frame found */
     bool user_frame_found = false;
     uint8_t user_frame_idx = 0;
@@ -862,6 +1268,8 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
     uint8_t as_mic_intf_ep_attr = 0;
     uint16_t as_mic_intf_ep_mps = 0;
     uint8_t as_mic_intf_ep_addr = 0;
+    uint8_t as_mic_intf_ep_interval = 0;
+    bool as_mic_bw_rejected = false;
     uint8_t as_mic_volume_ch = __UINT8_MAX__;
     uint8_t as_mic_mute_ch = __UINT8_MAX__;
     uint8_t as_mic_next_unit_idx = 0;
@@ -883,6 +1291,8 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
     uint8_t as_spk_intf_ep_attr = 0;
     uint16_t as_spk_intf_ep_mps = 0;
     uint8_t as_spk_intf_ep_addr = 0;
+    uint8_t as_spk_intf_ep_interval = 0;
+    bool as_spk_bw_rejected = false;
     bool as_spk_ch_num_found = false;
     bool as_mic_ch_num_found = false;
     /* flags indicate if suitable video stream interface found */
@@ -892,614 +1302,493 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
     uint8_t vs_intf_ep_attr = 0;
     uint16_t vs_intf_ep_mps = 0;
     uint8_t vs_intf_ep_addr = 0;
+    uint8_t vs_intf_ep_interval = 0;
+    bool vs_bw_rejected = false;
     uint8_t vs_intf1_idx = 0;
     uint8_t vs_intf1_alt_idx = 0;
     uint8_t vs_intf1_ep_attr = 0;
     uint16_t vs_intf1_ep_mps = 0;
     uint8_t vs_intf1_ep_addr = 0;
     /* flags indicate if suitable video stream interface found */
-    uint8_t context_class = 0;
     uint8_t context_subclass = 0;
     uint8_t context_intf = 0;
     uint8_t context_intf_alt = 0;
     uint8_t context_connected_terminal = 0;
-    const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)cfg_desc;
-
-    do {
-        already_next = false;
-        switch (next_desc->bDescriptorType) {
-        case USB_B_DESCRIPTOR_TYPE_INTERFACE_ASSOCIATION: {
-            const ifc_assoc_desc_t *assoc_desc = (const ifc_assoc_desc_t *)next_desc;
-            if (assoc_desc->bFunctionClass == USB_CLASS_VIDEO) {
-                ESP_LOGD(TAG, "-------------------- Video Descriptor Start ----------------------");
-            } else if (assoc_desc->bFunctionClass == USB_CLASS_AUDIO) {
-                ESP_LOGD(TAG, "-------------------- Audio Descriptor Start ----------------------");
-            } else {
-                print_assoc_desc((const uint8_t *)assoc_desc);
-                break;
-            }
-            print_assoc_desc((const uint8_t *)assoc_desc);
+    /* camera terminal and processing unit of the video control interface */
+    uint8_t vc_intf_idx = 0;
+    uint8_t vc_unit_id[UVC_VC_UNIT_MAX] = {0};
+    uint32_t vc_controls[UVC_VC_UNIT_MAX] = {0};
+    uint32_t vc_clock_hz = 0;
+
+    for (size_t n = 0; n < index->intf_num; n++) {
+        const usb_desc_intf_t *intf = &index->intfs[n];
+        if (intf->cls != USB_CLASS_AUDIO) {
+            continue;
         }
-        break;
-        case USB_B_DESCRIPTOR_TYPE_CONFIGURATION:
-            print_cfg_desc((const uint8_t *)next_desc);
-            break;
-        case USB_B_DESCRIPTOR_TYPE_INTERFACE: {
-            const usb_intf_desc_t *_intf_desc = (const usb_intf_desc_t *)next_desc;
-            context_intf = _intf_desc->bInterfaceNumber;
-            context_intf_alt = _intf_desc->bAlternateSetting;
-            context_class = _intf_desc->bInterfaceClass;
-            context_subclass = _intf_desc->bInterfaceSubClass;
-            if (context_class == USB_CLASS_VIDEO && context_subclass == VIDEO_SUBCLASS_CONTROL) {
-                ESP_LOGD(TAG, "Found Video Control interface");
-            }
-            if (context_class == USB_CLASS_VIDEO && context_subclass == VIDEO_SUBCLASS_STREAMING) {
-                ESP_LOGD(TAG, "Found Video Stream interface, %d-%d", context_intf, context_intf_alt);
-            }
-            if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_CONTROL) {
-                ESP_LOGD(TAG, "Found Audio Control interface");
-            }
-            if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_STREAMING) {
-                ESP_LOGD(TAG, "Found Audio Stream interface, %d-%d", context_intf, context_intf_alt);
-            }
-            print_intf_desc((const uint8_t *)_intf_desc);
+        context_intf = intf->num;
+        context_intf_alt = intf->alt;
+        context_subclass = intf->subclass;
+        if (context_subclass == AUDIO_SUBCLASS_CONTROL) {
+            ESP_LOGD(TAG, "Found Audio Control interface");
+        } else if (context_subclass == AUDIO_SUBCLASS_STREAMING) {
+            ESP_LOGD(TAG, "Found Audio Stream interface, %d-%d", context_intf, context_intf_alt);
         }
-        break;
-        case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
-            print_ep_desc((const uint8_t *)next_desc);
-            if (context_class == USB_CLASS_VIDEO && context_subclass == VIDEO_SUBCLASS_STREAMING) {
-                uint16_t ep_mps = 0;
-                uint8_t ep_attr = 0;
-                uint8_t ep_addr = 0;
-                parse_ep_desc((const uint8_t *)next_desc, &ep_mps, &ep_addr, &ep_attr);
-                if (ep_mps <= USB_EP_ISOC_IN_MAX_MPS && ep_mps > vs_intf_ep_mps) {
-                    vs_intf_found = true;
-                    vs_intf_ep_mps = ep_mps;
-                    vs_intf_ep_attr = ep_attr;
-                    vs_intf_ep_addr = ep_addr;
-                    vs_intf_idx = context_intf;
-                    vs_intf_alt_idx = context_intf_alt;
-                }
-                if (context_intf_alt == 1) {
-                    //workaround for some camera with error desc
-                    vs_intf1_ep_mps = ep_mps;
-                    vs_intf1_ep_attr = ep_attr;
-                    vs_intf1_ep_addr = ep_addr;
-                    vs_intf1_idx = context_intf;
-                    vs_intf1_alt_idx = context_intf_alt;
-                }
-            } else if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_STREAMING) {
-                if (context_intf_alt > 1) {
-                    ESP_LOGD(TAG, "Found Audio Stream interface %d-%d, skip", context_intf, context_intf_alt);
-                    break;
-                }
-                uint16_t ep_mps = 0;
-                uint8_t ep_attr = 0;
-                uint8_t ep_addr = 0;
-                parse_ep_desc((const uint8_t *)next_desc, &ep_mps, &ep_addr, &ep_attr);
-                if (ep_addr & 0x80) {
-                    as_mic_intf_found = true;
-                    as_mic_intf_ep_mps = ep_mps;
-                    as_mic_intf_ep_attr = ep_attr;
-                    as_mic_intf_ep_addr = ep_addr;
-                    as_mic_intf_idx = context_intf;
-                } else {
-                    as_spk_intf_found = true;
-                    as_spk_intf_ep_mps = ep_mps;
-                    as_spk_intf_ep_attr = ep_attr;
-                    as_spk_intf_ep_addr = ep_addr;
-                    as_spk_intf_idx = context_intf;
-                }
-            }
-            ESP_LOGV(TAG, "descriptor parsed %d/%d, vs interface %d-%d", offset, wTotalLength, context_intf, context_intf_alt);
-            break;
-        case CS_INTERFACE_DESC:
-            if (context_class == USB_CLASS_VIDEO && context_subclass == VIDEO_SUBCLASS_CONTROL) {
-                const desc_header_t *header = (const desc_header_t *)next_desc;
-                switch (header->bDescriptorSubtype) {
-                default:
-                    ESP_LOGD(TAG, "Found video control entity, skip");
-                    break;
+        int offset = intf->offset;
+        const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)USB_DESC_INDEX_PTR(cfg_desc, offset);
+        while ((next_desc = usb_parse_next_descriptor(next_desc, intf->end, &offset)) != NULL) {
+            switch (next_desc->bDescriptorType) {
+            case USB_B_DESCRIPTOR_TYPE_ENDPOINT:
+                if (context_subclass == AUDIO_SUBCLASS_STREAMING) {
+                    if (context_intf_alt > 1) {
+                        ESP_LOGD(TAG, "Found Audio Stream interface %d-%d, skip", context_intf, context_intf_alt);
+                        break;
+                    }
+                    uint16_t ep_mps = 0;
+                    uint8_t ep_attr = 0;
+                    uint8_t ep_addr = 0;
+                    parse_ep_desc((const uint8_t *)next_desc, &ep_mps, &ep_addr, &ep_attr);
+                    if (ep_addr & 0x80) {
+                        as_mic_intf_found = true;
+                        as_mic_intf_ep_mps = ep_mps;
+                        as_mic_intf_ep_attr = ep_attr;
+                        as_mic_intf_ep_addr = ep_addr;
+                        as_mic_intf_ep_interval = ((const usb_ep_desc_t *)next_desc)->bInterval;
+                        as_mic_intf_idx = context_intf;
+                    } else {
+                        as_spk_intf_found = true;
+                        as_spk_intf_ep_mps = ep_mps;
+                        as_spk_intf_ep_attr = ep_attr;
+                        as_spk_intf_ep_addr = ep_addr;
+                        as_spk_intf_ep_interval = ((const usb_ep_desc_t *)next_desc)->bInterval;
+                        as_spk_intf_idx = context_intf;
+                    }
                 }
-            } 
-            else if (context_class == USB_CLASS_VIDEO && context_subclass == VIDEO_SUBCLASS_STREAMING) {
-                if (context_intf_alt == 0) {
-                    // 这是与格式相关的描述符
-                    uint16_t _frame_width = 0;
-                    uint16_t _frame_heigh = 0;
-                    uint8_t _frame_idx = 0;
+                break;
+            case CS_INTERFACE_DESC:
+                if (context_subclass == AUDIO_SUBCLASS_CONTROL) {
                     const desc_header_t *header = (const desc_header_t *)next_desc;
                     switch (header->bDescriptorSubtype) {
-                    case VIDEO_CS_ITF_VS_INPUT_HEADER:
-                        print_uvc_header_desc((const uint8_t *)next_desc, VIDEO_SUBCLASS_STREAMING);
-                        break;
-                    case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
-                        if (usb_dev->uvc_cfg.format != UVC_FORMAT_MJPEG) {
-                            break;
-                        }
-                        parse_vs_format_mjpeg_desc((const uint8_t *)next_desc, &format_idx, &frame_num, &format);
-                        if (uvc_dev) {
-                            uvc_frame_size_t *frame_size = uvc_dev->frame_size;
-                            frame_size = (uvc_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uvc_frame_size_t), MALLOC_CAP_DEFAULT);
-                            UVC_CHECK(frame_size, "alloc uvc frame size failed", ESP_ERR_NO_MEM);
-                            UVC_ENTER_CRITICAL();
-                            uvc_dev->frame_num = frame_num;
-                            uvc_dev->frame_size = frame_size;
-                            uvc_dev->frame_format = format;
-                            UVC_EXIT_CRITICAL();
+                    case AUDIO_CS_AC_INTERFACE_HEADER:
+                        parse_ac_header_desc((const uint8_t *)next_desc, &uac_ver_found, NULL);
+                        if (uac_ver_found != UAC_VERSION_1) {
+                            ESP_LOGW(TAG, "UAC version 0x%04x Not supported", uac_ver_found);
                         }
-                        format_set_found = true;
                         break;
-                    case VIDEO_CS_ITF_VS_FRAME_MJPEG: {
-                        if (usb_dev->uvc_cfg.format != UVC_FORMAT_MJPEG) {
-                            break;
-                        }
-                        uint8_t interval_type = 0;
-                        const uint32_t *pp_interval = NULL;
-                        uint32_t dflt_interval = 0;
-                        uint32_t max_interval = 0;
-                        uint32_t min_interval = 0;
-                        uint32_t step_interval = 0;
-                        uint32_t final_interval = 0;
-                        parse_vs_frame_mjpeg_desc((const uint8_t *)next_desc, &_frame_idx, &_frame_width, &_frame_heigh, &interval_type, &pp_interval, &dflt_interval);
-                        
-                        if (interval_type) {
-                            min_interval = pp_interval[0];
-                            for (size_t i = 0; i < interval_type; i++) {
-                                if (usb_dev->uvc_cfg.frame_interval == pp_interval[i]) {
-                                    final_interval = pp_interval[i];
-                                }
-                                if (pp_interval[i] > max_interval) {
-                                    max_interval = pp_interval[i];
-                                }
-                                if (pp_interval[i] < min_interval) {
-                                    min_interval = pp_interval[i];
-                                }
-                            }
-                        } else {
-                            min_interval = pp_interval[0];
-                            max_interval = pp_interval[1];
-                            step_interval = pp_interval[2];
-                            if (usb_dev->uvc_cfg.frame_interval >= min_interval && usb_dev->uvc_cfg.frame_interval <= max_interval) {
-                                for (uint32_t i = min_interval; i < max_interval; i += step_interval) {
-                                    if (usb_dev->uvc_cfg.frame_interval >= i && usb_dev->uvc_cfg.frame_interval < (i + step_interval)) {
-                                        final_interval = i;
-                                    }
-                                }
-                            }
-                        }
-                        
-                        if (final_interval == 0) {
-                            final_interval = dflt_interval;
-                            ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " not found, using default = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
-                        } else {
-                            ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " found = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
-                        }
-                        
-                        if (uvc_dev) {
-                            // 动态检查并重新分配 frame_size 数组
-                            if (_frame_idx > uvc_dev->frame_num) {
-                                size_t new_frame_num = _frame_idx;
-                                uvc_frame_size_t *new_frame_size = (uvc_frame_size_t *)heap_caps_realloc(
-                                    uvc_dev->frame_size,
-                                    new_frame_num * sizeof(uvc_frame_size_t),
-                                    MALLOC_CAP_DEFAULT
-                                );
-                                UVC_CHECK(new_frame_size, "Realloc uvc frame size failed", ESP_ERR_NO_MEM);
-                                
-                                // 初始化新增的帧
-                                memset(&new_frame_size[uvc_dev->frame_num], 0, 
-                                    (new_frame_num - uvc_dev->frame_num) * sizeof(uvc_frame_size_t));
-                
-                                UVC_ENTER_CRITICAL();
-                                uvc_dev->frame_num = new_frame_num;
-                                uvc_dev->frame_size = new_frame_size;
-                                UVC_EXIT_CRITICAL();
-
-                                // 日志提示描述符不匹配
-                                ESP_LOGW(TAG, "描述符不匹配：声明的帧描述符数量 = %d，实际提供的帧描述符数量 = %d",
-                                        uvc_dev->frame_num, _frame_idx);
-                            }
-                            
-                            // 现在可以安全地赋值
-                            UVC_ENTER_CRITICAL();
-                            uvc_dev->frame_size[_frame_idx - 1].width = _frame_width;
-                            uvc_dev->frame_size[_frame_idx - 1].height = _frame_heigh;
-                            uvc_dev->frame_size[_frame_idx - 1].interval = final_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_min = min_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_max = max_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_step = step_interval;
-                            UVC_EXIT_CRITICAL();
-                        }
-                        
-                        if (user_frame_found == true) {
-                            break;
-                        }
-                        
-                        if (((_frame_width == usb_dev->uvc_cfg.frame_width) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_width))
-                                && ((_frame_heigh == usb_dev->uvc_cfg.frame_height) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_height))) {
-                            user_frame_found = true;
-                            user_frame_idx = _frame_idx;
+                    case AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL: {
+                        uint8_t terminal_idx = 0;
+                        uint16_t terminal_type = 0;
+                        parse_ac_input_desc((const uint8_t *)next_desc, &terminal_idx, &terminal_type);
+                        if (terminal_type == AUDIO_TERM_TYPE_USB_STREAMING) {
+                            as_spk_input_terminal = terminal_idx;
+                            as_spk_next_unit_idx = terminal_idx;
                         } 
-                        else if ((_frame_width == usb_dev->uvc_cfg.frame_height) && (_frame_heigh == usb_dev->uvc_cfg.frame_width)) {
-                            ESP_LOGW(TAG, "found width*height %u * %u , orientation swap?", _frame_heigh, _frame_width);
+                        else if (terminal_type == AUDIO_TERM_TYPE_IN_GENERIC_MIC || terminal_type == AUDIO_TERM_TYPE_HEADSET) {
+                            as_mic_input_terminal = terminal_idx;
+                            as_mic_next_unit_idx = terminal_idx;
+                        } 
+                        else {
+                            ESP_LOGW(TAG, "Input terminal type 0x%04x Not supported", terminal_type);
                         }
-                        break;
                     }
-                    case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
-                        if (usb_dev->uvc_cfg.format != UVC_FORMAT_FRAME_BASED) {
-                            break;
-                        }
-                        parse_vs_format_frame_based_desc((const uint8_t *)next_desc, &format_idx, &frame_num, &format);
-                        if (uvc_dev) {
-                            uvc_frame_size_t *frame_size = uvc_dev->frame_size;
-                            frame_size = (uvc_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uvc_frame_size_t), MALLOC_CAP_DEFAULT);
-                            UVC_CHECK(frame_size, "alloc uvc frame size failed", ESP_ERR_NO_MEM);
-                            UVC_ENTER_CRITICAL();
-                            uvc_dev->frame_num = frame_num;
-                            uvc_dev->frame_size = frame_size;
-                            uvc_dev->frame_format = format;
-                            UVC_EXIT_CRITICAL();
-                        }
-                        format_set_found = true;
-                        break;
-                    case VIDEO_CS_ITF_VS_FRAME_FRAME_BASED: {
-                        if (usb_dev->uvc_cfg.format != UVC_FORMAT_FRAME_BASED) {
-                            break;
-                        }
-                        uint8_t interval_type = 0;
-                        const uint32_t *pp_interval = NULL;
-                        uint32_t dflt_interval = 0;
-                        uint32_t max_interval = 0;
-                        uint32_t min_interval = 0;
-                        uint32_t step_interval = 0;
-                        uint32_t final_interval = 0;
-                        parse_vs_frame_frame_based_desc((const uint8_t *)next_desc, &_frame_idx, &_frame_width, &_frame_heigh, &interval_type, &pp_interval, &dflt_interval);
-                        
-                        if (interval_type) {
-                            min_interval = pp_interval[0];
-                            for (size_t i = 0; i < interval_type; i++) {
-                                if (usb_dev->uvc_cfg.frame_interval == pp_interval[i]) {
-                                    final_interval = pp_interval[i];
-                                }
-                                if (pp_interval[i] > max_interval) {
-                                    max_interval = pp_interval[i];
-                                }
-                                if (pp_interval[i] < min_interval) {
-                                    min_interval = pp_interval[i];
-                                }
-                            }
-                        } else {
-                            min_interval = pp_interval[0];
-                            max_interval = pp_interval[1];
-                            step_interval = pp_interval[2];
-                            if (usb_dev->uvc_cfg.frame_interval >= min_interval && usb_dev->uvc_cfg.frame_interval <= max_interval) {
-                                for (uint32_t i = min_interval; i < max_interval; i += step_interval) {
-                                    if (usb_dev->uvc_cfg.frame_interval >= i && usb_dev->uvc_cfg.frame_interval < (i + step_interval)) {
-                                        final_interval = i;
-                                    }
-                                }
-                            }
-                        }
-                        
-                        if (final_interval == 0) {
-                            final_interval = dflt_interval;
-                            ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " not found, using default = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
-                        } else {
-                            ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " found = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
-                        }
-                        
-                        if (uvc_dev) {
-                            // 动态检查并重新分配 frame_size 数组
-                            if (_frame_idx > uvc_dev->frame_num) {
-                                size_t new_frame_num = _frame_idx;
-                                uvc_frame_size_t *new_frame_size = (uvc_frame_size_t *)heap_caps_realloc(
-                                    uvc_dev->frame_size,
-                                    new_frame_num * sizeof(uvc_frame_size_t),
-                                    MALLOC_CAP_DEFAULT
-                                );
-                                UVC_CHECK(new_frame_size, "Realloc uvc frame size failed", ESP_ERR_NO_MEM);
-                                
-                                // 初始化新增的帧
-                                memset(&new_frame_size[uvc_dev->frame_num], 0, 
-                                    (new_frame_num - uvc_dev->frame_num) * sizeof(uvc_frame_size_t));
-                
-                                UVC_ENTER_CRITICAL();
-                                uvc_dev->frame_num = new_frame_num;
-                                uvc_dev->frame_size = new_frame_size;
-                                UVC_EXIT_CRITICAL();
-                                
-                                // 日志提示描述符不匹配
-                                ESP_LOGW(TAG, "描述符不匹配：声明的帧描述符数量 = %d，实际提供的帧描述符数量 = %d",
-                                        uvc_dev->frame_num, _frame_idx);
-                            }
-                            
-                            // 现在可以安全地赋值
-                            UVC_ENTER_CRITICAL();
-                            uvc_dev->frame_size[_frame_idx - 1].width = _frame_width;
-                            uvc_dev->frame_size[_frame_idx - 1].height = _frame_heigh;
-                            uvc_dev->frame_size[_frame_idx - 1].interval = final_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_min = min_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_max = max_interval;
-                            uvc_dev->frame_size[_frame_idx - 1].interval_step = step_interval;
-                            UVC_EXIT_CRITICAL();
-                        }
-                        
-                        if (user_frame_found == true) {
-                            break;
+                    break;
+                    case AUDIO_CS_AC_INTERFACE_FEATURE_UNIT: {
+                        ac_intf_found = true;
+                        ac_intf_idx = context_intf;
+                        uint8_t source_idx = 0;
+                        uint8_t volume_ch = 0;
+                        uint8_t mute_ch = 0;
+                        uint8_t feature_unit_idx = 0;
+                        // 注意：优先使用主通道进行特性控制
+                        parse_ac_feature_desc((const uint8_t *)next_desc, &source_idx, &feature_unit_idx, &volume_ch, &mute_ch);
+                        // 假设输入终端的下一个单元是特性单元
+                        if (source_idx == as_spk_next_unit_idx || source_idx == as_spk_input_terminal) {
+                            as_spk_next_unit_idx = feature_unit_idx;
+                            as_spk_feature_unit_idx = feature_unit_idx;
+                            as_spk_mute_ch = mute_ch;
+                            as_spk_volume_ch = volume_ch;
+                        } 
+                        else if (source_idx == as_mic_next_unit_idx || source_idx == as_mic_input_terminal) {
+                            as_mic_next_unit_idx = feature_unit_idx;
+                            as_mic_feature_unit_idx = feature_unit_idx;
+                            as_mic_mute_ch = mute_ch;
+                            as_mic_volume_ch = volume_ch;
                         }
-                        
-                        if (((_frame_width == usb_dev->uvc_cfg.frame_width) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_width))
-                                && ((_frame_heigh == usb_dev->uvc_cfg.frame_height) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_height))) {
-                            user_frame_found = true;
-                            user_frame_idx = _frame_idx;
+                    }
+                    break;
+                    case AUDIO_CS_AC_INTERFACE_OUTPUT_TERMINAL: {
+                        uint8_t terminal_idx = 0;
+                        uint16_t terminal_type = 0;
+                        parse_ac_output_desc((const uint8_t *)next_desc, &terminal_idx, &terminal_type);
+                        if (terminal_type == AUDIO_TERM_TYPE_USB_STREAMING) {
+                            as_mic_output_terminal = terminal_idx;
+                            as_spk_next_unit_idx = terminal_idx;
+                        } 
+                        else if (terminal_type == AUDIO_TERM_TYPE_OUT_GENERIC_SPEAKER || terminal_type == AUDIO_TERM_TYPE_HEADSET) {
+                            as_mic_next_unit_idx = terminal_idx;
                         } 
-                        else if ((_frame_width == usb_dev->uvc_cfg.frame_height) && (_frame_heigh == usb_dev->uvc_cfg.frame_width)) {
-                            ESP_LOGW(TAG, "found width*height %u * %u , orientation swap?", _frame_heigh, _frame_width);
+                        else {
+                            ESP_LOGW(TAG, "Output terminal type 0x%04x Not supported", terminal_type);
                         }
-                        break;
                     }
+                    break;
                     default:
                         break;
                     }
-                } 
-            }
-            else if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_CONTROL) {
-                const desc_header_t *header = (const desc_header_t *)next_desc;
-                switch (header->bDescriptorSubtype) {
-                case AUDIO_CS_AC_INTERFACE_HEADER:
-                    parse_ac_header_desc((const uint8_t *)next_desc, &uac_ver_found, NULL);
-                    if (uac_ver_found != UAC_VERSION_1) {
-                        ESP_LOGW(TAG, "UAC version 0x%04x Not supported", uac_ver_found);
-                    }
-                    break;
-                case AUDIO_CS_AC_INTERFACE_INPUT_TERMINAL: {
-                    uint8_t terminal_idx = 0;
-                    uint16_t terminal_type = 0;
-                    parse_ac_input_desc((const uint8_t *)next_desc, &terminal_idx, &terminal_type);
-                    if (terminal_type == AUDIO_TERM_TYPE_USB_STREAMING) {
-                        as_spk_input_terminal = terminal_idx;
-                        as_spk_next_unit_idx = terminal_idx;
-                    } 
-                    else if (terminal_type == AUDIO_TERM_TYPE_IN_GENERIC_MIC || terminal_type == AUDIO_TERM_TYPE_HEADSET) {
-                        as_mic_input_terminal = terminal_idx;
-                        as_mic_next_unit_idx = terminal_idx;
-                    } 
-                    else {
-                        ESP_LOGW(TAG, "Input terminal type 0x%04x Not supported", terminal_type);
-                    }
-                }
-                break;
-                case AUDIO_CS_AC_INTERFACE_FEATURE_UNIT: {
-                    ac_intf_found = true;
-                    ac_intf_idx = context_intf;
-                    uint8_t source_idx = 0;
-                    uint8_t volume_ch = 0;
-                    uint8_t mute_ch = 0;
-                    uint8_t feature_unit_idx = 0;
-                    // 注意：优先使用主通道进行特性控制
-                    parse_ac_feature_desc((const uint8_t *)next_desc, &source_idx, &feature_unit_idx, &volume_ch, &mute_ch);
-                    // 假设输入终端的下一个单元是特性单元
-                    if (source_idx == as_spk_next_unit_idx || source_idx == as_spk_input_terminal) {
-                        as_spk_next_unit_idx = feature_unit_idx;
-                        as_spk_feature_unit_idx = feature_unit_idx;
-                        as_spk_mute_ch = mute_ch;
-                        as_spk_volume_ch = volume_ch;
-                    } 
-                    else if (source_idx == as_mic_next_unit_idx || source_idx == as_mic_input_terminal) {
-                        as_mic_next_unit_idx = feature_unit_idx;
-                        as_mic_feature_unit_idx = feature_unit_idx;
-                        as_mic_mute_ch = mute_ch;
-                        as_mic_volume_ch = volume_ch;
+                } else if (context_subclass == AUDIO_SUBCLASS_STREAMING) {
+                    const desc_header_t *header = (const desc_header_t *)next_desc;
+                    if (context_intf_alt > 1) {
+                        ESP_LOGD(TAG, "Found audio interface sub-desc:%d of %d-%d, skip", header->bDescriptorSubtype, context_intf, context_intf_alt);
+                        break;
                     }
-                }
-                break;
-                case AUDIO_CS_AC_INTERFACE_OUTPUT_TERMINAL: {
-                    uint8_t terminal_idx = 0;
-                    uint16_t terminal_type = 0;
-                    parse_ac_output_desc((const uint8_t *)next_desc, &terminal_idx, &terminal_type);
-                    if (terminal_type == AUDIO_TERM_TYPE_USB_STREAMING) {
-                        as_mic_output_terminal = terminal_idx;
-                        as_spk_next_unit_idx = terminal_idx;
-                    } 
-                    else if (terminal_type == AUDIO_TERM_TYPE_OUT_GENERIC_SPEAKER || terminal_type == AUDIO_TERM_TYPE_HEADSET) {
-                        as_mic_next_unit_idx = terminal_idx;
-                    } 
-                    else {
-                        ESP_LOGW(TAG, "Output terminal type 0x%04x Not supported", terminal_type);
+                    switch (header->bDescriptorSubtype) {
+                    case AUDIO_CS_AS_INTERFACE_AS_GENERAL: {
+                        uint16_t format_tag = 0;
+                        uint8_t source_idx = 0;
+                        parse_as_general_desc((const uint8_t *)next_desc, &source_idx, &format_tag);
+                        context_connected_terminal = source_idx;
+                        //we only support TYPEI
+                        if (format_tag != UAC_FORMAT_TYPEI) {
+                            uac_format_others_found = true;
+                            ESP_LOGW(TAG, "Audio format type 0x%04x Not supported", format_tag);
+                        }
                     }
-                }
-                break;
-                default:
-                    break;
-                }
-            } else if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_STREAMING) {
-                const desc_header_t *header = (const desc_header_t *)next_desc;
-                if (context_intf_alt > 1) {
-                    ESP_LOGD(TAG, "Found audio interface sub-desc:%d of %d-%d, skip", header->bDescriptorSubtype, context_intf, context_intf_alt);
                     break;
-                }
-                switch (header->bDescriptorSubtype) {
-                case AUDIO_CS_AS_INTERFACE_AS_GENERAL: {
-                    uint16_t format_tag = 0;
-                    uint8_t source_idx = 0;
-                    parse_as_general_desc((const uint8_t *)next_desc, &source_idx, &format_tag);
-                    context_connected_terminal = source_idx;
-                    //we only support TYPEI
-                    if (format_tag != UAC_FORMAT_TYPEI) {
-                        uac_format_others_found = true;
-                        ESP_LOGW(TAG, "Audio format type 0x%04x Not supported", format_tag);
-                    }
-                }
-                break;
-                case AUDIO_CS_AS_INTERFACE_FORMAT_TYPE: {
-                    uint8_t channel_num = 0;
-                    uint8_t bit_resolution = 0;
-                    uint8_t freq_type = 0;
-                    const uint8_t *p_samfreq = NULL;
-                    parse_as_type_desc((const uint8_t *)next_desc, &channel_num, &bit_resolution, &freq_type, &p_samfreq);
-                    if (context_connected_terminal == as_mic_output_terminal) {
-                        if (usb_dev->enabled[STREAM_UAC_MIC]) {
-                            uint8_t frame_num = freq_type == 0 ? 1 : freq_type;
-                            uac_frame_size_t *frame_size = uac_dev->frame_size[UAC_MIC];
-                            frame_size = (uac_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uac_frame_size_t), MALLOC_CAP_DEFAULT);
-                            UVC_CHECK(frame_size, "alloc mic frame size failed", ESP_ERR_NO_MEM);
-                            UVC_ENTER_CRITICAL();
-                            uac_dev->frame_num[UAC_MIC] = frame_num;
-                            uac_dev->frame_size[UAC_MIC] = frame_size;
-                            UVC_EXIT_CRITICAL();
-                        }
-                        if (channel_num == usb_dev->uac_cfg.mic_ch_num || usb_dev->uac_cfg.mic_ch_num == UAC_CH_ANY) {
-                            as_mic_ch_num_found = true;
-                        }
-
-                        if (bit_resolution == usb_dev->uac_cfg.mic_bit_resolution || usb_dev->uac_cfg.mic_bit_resolution == UAC_BITS_ANY) {
-                            as_mic_bit_res_found = true;
-                        }
-                        if (freq_type == 0) {
-                            uint32_t min_samfreq = (p_samfreq[2] << 16) + (p_samfreq[1] << 8) + p_samfreq[0];
-                            uint32_t max_samfreq = (p_samfreq[5] << 16) + (p_samfreq[4] << 8) + p_samfreq[3];
-                            uint32_t mic_frame_frequence = 0;
-                            uint8_t mic_frame_index = 0;
-                            if (usb_dev->uac_cfg.mic_samples_frequence <= max_samfreq && usb_dev->uac_cfg.mic_samples_frequence >= min_samfreq) {
-                                as_mic_freq_found = true;
-                                mic_frame_index = 1;
-                                mic_frame_frequence = usb_dev->uac_cfg.mic_samples_frequence;
-                            } else if (usb_dev->uac_cfg.mic_samples_frequence == UAC_FREQUENCY_ANY) {
-                                as_mic_freq_found = true;
-                                mic_frame_index = 1;
-                                mic_frame_frequence = min_samfreq;
-                            }
+                    case AUDIO_CS_AS_INTERFACE_FORMAT_TYPE: {
+                        uint8_t channel_num = 0;
+                        uint8_t bit_resolution = 0;
+                        uint8_t freq_type = 0;
+                        const uint8_t *p_samfreq = NULL;
+                        parse_as_type_desc((const uint8_t *)next_desc, &channel_num, &bit_resolution, &freq_type, &p_samfreq);
+                        if (context_connected_terminal == as_mic_output_terminal) {
                             if (usb_dev->enabled[STREAM_UAC_MIC]) {
+                                uint8_t frame_num = freq_type == 0 ? 1 : freq_type;
+                                uac_frame_size_t *frame_size = uac_dev->frame_size[UAC_MIC];
+                                frame_size = (uac_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uac_frame_size_t), MALLOC_CAP_DEFAULT);
+                                UVC_CHECK(frame_size, "alloc mic frame size failed", ESP_ERR_NO_MEM);
                                 UVC_ENTER_CRITICAL();
-                                uac_dev->frame_size[UAC_MIC][0].ch_num = channel_num;
-                                uac_dev->frame_size[UAC_MIC][0].bit_resolution = bit_resolution;
-                                uac_dev->frame_size[UAC_MIC][0].samples_frequence = mic_frame_frequence;
-                                uac_dev->frame_size[UAC_MIC][0].samples_frequence_min = min_samfreq;
-                                uac_dev->frame_size[UAC_MIC][0].samples_frequence_max = max_samfreq;
-                                uac_dev->frame_index[UAC_MIC] = mic_frame_index;
+                                uac_dev->frame_num[UAC_MIC] = frame_num;
+                                uac_dev->frame_size[UAC_MIC] = frame_size;
                                 UVC_EXIT_CRITICAL();
                             }
-                        } else {
-                            uint8_t mic_frame_index = 0;
-                            for (int i = 0; i < freq_type; ++i) {
-                                if (usb_dev->uac_cfg.mic_samples_frequence == UAC_FREQUENCY_ANY) {
+                            if (channel_num == usb_dev->uac_cfg.mic_ch_num || usb_dev->uac_cfg.mic_ch_num == UAC_CH_ANY) {
+                                as_mic_ch_num_found = true;
+                            }
+
+                            if (bit_resolution == usb_dev->uac_cfg.mic_bit_resolution || usb_dev->uac_cfg.mic_bit_resolution == UAC_BITS_ANY) {
+                                as_mic_bit_res_found = true;
+                            }
+                            if (freq_type == 0) {
+                                uint32_t min_samfreq = (p_samfreq[2] << 16) + (p_samfreq[1] << 8) + p_samfreq[0];
+                                uint32_t max_samfreq = (p_samfreq[5] << 16) + (p_samfreq[4] << 8) + p_samfreq[3];
+                                uint32_t mic_frame_frequence = 0;
+                                uint8_t mic_frame_index = 0;
+                                if (usb_dev->uac_cfg.mic_samples_frequence <= max_samfreq && usb_dev->uac_cfg.mic_samples_frequence >= min_samfreq) {
                                     as_mic_freq_found = true;
                                     mic_frame_index = 1;
-                                } else if (((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]) == usb_dev->uac_cfg.mic_samples_frequence) {
+                                    mic_frame_frequence = usb_dev->uac_cfg.mic_samples_frequence;
+                                } else if (usb_dev->uac_cfg.mic_samples_frequence == UAC_FREQUENCY_ANY) {
                                     as_mic_freq_found = true;
-                                    mic_frame_index = i + 1;
+                                    mic_frame_index = 1;
+                                    mic_frame_frequence = min_samfreq;
                                 }
                                 if (usb_dev->enabled[STREAM_UAC_MIC]) {
                                     UVC_ENTER_CRITICAL();
-                                    uac_dev->frame_size[UAC_MIC][i].ch_num = channel_num;
-                                    uac_dev->frame_size[UAC_MIC][i].bit_resolution = bit_resolution;
-                                    uac_dev->frame_size[UAC_MIC][i].samples_frequence = ((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]);
-                                    uac_dev->frame_size[UAC_MIC][i].samples_frequence_min = 0;
-                                    uac_dev->frame_size[UAC_MIC][i].samples_frequence_max = 0;
+                                    uac_dev->frame_size[UAC_MIC][0].ch_num = channel_num;
+                                    uac_dev->frame_size[UAC_MIC][0].bit_resolution = bit_resolution;
+                                    uac_dev->frame_size[UAC_MIC][0].samples_frequence = mic_frame_frequence;
+                                    uac_dev->frame_size[UAC_MIC][0].samples_frequence_min = min_samfreq;
+                                    uac_dev->frame_size[UAC_MIC][0].samples_frequence_max = max_samfreq;
                                     uac_dev->frame_index[UAC_MIC] = mic_frame_index;
                                     UVC_EXIT_CRITICAL();
                                 }
+                            } else {
+                                uint8_t mic_frame_index = 0;
+                                for (int i = 0; i < freq_type; ++i) {
+                                    if (usb_dev->uac_cfg.mic_samples_frequence == UAC_FREQUENCY_ANY) {
+                                        as_mic_freq_found = true;
+                                        mic_frame_index = 1;
+                                    } else if (((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]) == usb_dev->uac_cfg.mic_samples_frequence) {
+                                        as_mic_freq_found = true;
+                                        mic_frame_index = i + 1;
+                                    }
+                                    if (usb_dev->enabled[STREAM_UAC_MIC]) {
+                                        UVC_ENTER_CRITICAL();
+                                        uac_dev->frame_size[UAC_MIC][i].ch_num = channel_num;
+                                        uac_dev->frame_size[UAC_MIC][i].bit_resolution = bit_resolution;
+                                        uac_dev->frame_size[UAC_MIC][i].samples_frequence = ((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]);
+                                        uac_dev->frame_size[UAC_MIC][i].samples_frequence_min = 0;
+                                        uac_dev->frame_size[UAC_MIC][i].samples_frequence_max = 0;
+                                        uac_dev->frame_index[UAC_MIC] = mic_frame_index;
+                                        UVC_EXIT_CRITICAL();
+                                    }
+                                }
                             }
-                        }
 
-                    } else if (context_connected_terminal == as_spk_input_terminal) {
-                        if (usb_dev->enabled[STREAM_UAC_SPK]) {
-                            uint8_t frame_num = freq_type == 0 ? 1 : freq_type;
-                            uac_frame_size_t *frame_size = uac_dev->frame_size[UAC_SPK];
-                            frame_size = (uac_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uac_frame_size_t), MALLOC_CAP_DEFAULT);
-                            UVC_CHECK(frame_size, "alloc spk frame size failed", ESP_ERR_NO_MEM);
-                            UVC_ENTER_CRITICAL();
-                            uac_dev->frame_num[UAC_SPK] = frame_num;
-                            uac_dev->frame_size[UAC_SPK] = frame_size;
-                            UVC_EXIT_CRITICAL();
-                        }
-                        if (channel_num == usb_dev->uac_cfg.spk_ch_num || usb_dev->uac_cfg.spk_ch_num == UAC_CH_ANY) {
-                            as_spk_ch_num_found = true;
-                        }
-                        if (bit_resolution == usb_dev->uac_cfg.spk_bit_resolution || usb_dev->uac_cfg.spk_bit_resolution == UAC_BITS_ANY) {
-                            as_spk_bit_res_found = true;
-                        }
-                        if (freq_type == 0) {
-                            uint32_t min_samfreq = (p_samfreq[2] << 16) + (p_samfreq[1] << 8) + p_samfreq[0];
-                            uint32_t max_samfreq = (p_samfreq[5] << 16) + (p_samfreq[4] << 8) + p_samfreq[3];
-                            uint32_t spk_frame_frequence = 0;
-                            uint8_t spk_frame_index = 0;
-                            if (usb_dev->uac_cfg.spk_samples_frequence <= max_samfreq && usb_dev->uac_cfg.spk_samples_frequence >= min_samfreq) {
-                                as_spk_freq_found = true;
-                                spk_frame_index = 1;
-                                spk_frame_frequence = usb_dev->uac_cfg.spk_samples_frequence;
-                            } else if (usb_dev->uac_cfg.spk_samples_frequence == UAC_FREQUENCY_ANY) {
-                                as_spk_freq_found = true;
-                                spk_frame_index = 1;
-                                spk_frame_frequence = min_samfreq;
-                            }
+                        } else if (context_connected_terminal == as_spk_input_terminal) {
                             if (usb_dev->enabled[STREAM_UAC_SPK]) {
+                                uint8_t frame_num = freq_type == 0 ? 1 : freq_type;
+                                uac_frame_size_t *frame_size = uac_dev->frame_size[UAC_SPK];
+                                frame_size = (uac_frame_size_t *)heap_caps_realloc(frame_size, frame_num * sizeof(uac_frame_size_t), MALLOC_CAP_DEFAULT);
+                                UVC_CHECK(frame_size, "alloc spk frame size failed", ESP_ERR_NO_MEM);
                                 UVC_ENTER_CRITICAL();
-                                uac_dev->frame_size[UAC_SPK][0].ch_num = channel_num;
-                                uac_dev->frame_size[UAC_SPK][0].bit_resolution = bit_resolution;
-                                uac_dev->frame_size[UAC_SPK][0].samples_frequence = spk_frame_frequence;
-                                uac_dev->frame_size[UAC_SPK][0].samples_frequence_min = min_samfreq;
-                                uac_dev->frame_size[UAC_SPK][0].samples_frequence_max = max_samfreq;
-                                uac_dev->frame_index[UAC_SPK] = spk_frame_index;
+                                uac_dev->frame_num[UAC_SPK] = frame_num;
+                                uac_dev->frame_size[UAC_SPK] = frame_size;
                                 UVC_EXIT_CRITICAL();
                             }
-                        } else {
-                            uint8_t spk_frame_index = 0;
-                            for (int i = 0; i < freq_type; ++i) {
-                                if (usb_dev->uac_cfg.spk_samples_frequence == UAC_FREQUENCY_ANY) {
+                            if (channel_num == usb_dev->uac_cfg.spk_ch_num || usb_dev->uac_cfg.spk_ch_num == UAC_CH_ANY) {
+                                as_spk_ch_num_found = true;
+                            }
+                            if (bit_resolution == usb_dev->uac_cfg.spk_bit_resolution || usb_dev->uac_cfg.spk_bit_resolution == UAC_BITS_ANY) {
+                                as_spk_bit_res_found = true;
+                            }
+                            if (freq_type == 0) {
+                                uint32_t min_samfreq = (p_samfreq[2] << 16) + (p_samfreq[1] << 8) + p_samfreq[0];
+                                uint32_t max_samfreq = (p_samfreq[5] << 16) + (p_samfreq[4] << 8) + p_samfreq[3];
+                                uint32_t spk_frame_frequence = 0;
+                                uint8_t spk_frame_index = 0;
+                                if (usb_dev->uac_cfg.spk_samples_frequence <= max_samfreq && usb_dev->uac_cfg.spk_samples_frequence >= min_samfreq) {
                                     as_spk_freq_found = true;
                                     spk_frame_index = 1;
-                                } else if (((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]) == usb_dev->uac_cfg.spk_samples_frequence) {
+                                    spk_frame_frequence = usb_dev->uac_cfg.spk_samples_frequence;
+                                } else if (usb_dev->uac_cfg.spk_samples_frequence == UAC_FREQUENCY_ANY) {
                                     as_spk_freq_found = true;
-                                    spk_frame_index = i + 1;
+                                    spk_frame_index = 1;
+                                    spk_frame_frequence = min_samfreq;
                                 }
                                 if (usb_dev->enabled[STREAM_UAC_SPK]) {
                                     UVC_ENTER_CRITICAL();
-                                    uac_dev->frame_size[UAC_SPK][i].ch_num = channel_num;
-                                    uac_dev->frame_size[UAC_SPK][i].bit_resolution = bit_resolution;
-                                    uac_dev->frame_size[UAC_SPK][i].samples_frequence = ((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]);
-                                    uac_dev->frame_size[UAC_SPK][i].samples_frequence_min = 0;
-                                    uac_dev->frame_size[UAC_SPK][i].samples_frequence_max = 0;
+                                    uac_dev->frame_size[UAC_SPK][0].ch_num = channel_num;
+                                    uac_dev->frame_size[UAC_SPK][0].bit_resolution = bit_resolution;
+                                    uac_dev->frame_size[UAC_SPK][0].samples_frequence = spk_frame_frequence;
+                                    uac_dev->frame_size[UAC_SPK][0].samples_frequence_min = min_samfreq;
+                                    uac_dev->frame_size[UAC_SPK][0].samples_frequence_max = max_samfreq;
                                     uac_dev->frame_index[UAC_SPK] = spk_frame_index;
                                     UVC_EXIT_CRITICAL();
                                 }
+                            } else {
+                                uint8_t spk_frame_index = 0;
+                                for (int i = 0; i < freq_type; ++i) {
+                                    if (usb_dev->uac_cfg.spk_samples_frequence == UAC_FREQUENCY_ANY) {
+                                        as_spk_freq_found = true;
+                                        spk_frame_index = 1;
+                                    } else if (((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]) == usb_dev->uac_cfg.spk_samples_frequence) {
+                                        as_spk_freq_found = true;
+                                        spk_frame_index = i + 1;
+                                    }
+                                    if (usb_dev->enabled[STREAM_UAC_SPK]) {
+                                        UVC_ENTER_CRITICAL();
+                                        uac_dev->frame_size[UAC_SPK][i].ch_num = channel_num;
+                                        uac_dev->frame_size[UAC_SPK][i].bit_resolution = bit_resolution;
+                                        uac_dev->frame_size[UAC_SPK][i].samples_frequence = ((p_samfreq[3 * i + 2] << 16) + (p_samfreq[3 * i + 1] << 8) + p_samfreq[3 * i]);
+                                        uac_dev->frame_size[UAC_SPK][i].samples_frequence_min = 0;
+                                        uac_dev->frame_size[UAC_SPK][i].samples_frequence_max = 0;
+                                        uac_dev->frame_index[UAC_SPK] = spk_frame_index;
+                                        UVC_EXIT_CRITICAL();
+                                    }
+                                }
                             }
                         }
                     }
+                    break;
+                    default:
+                        break;
+                    }
                 }
                 break;
-                default:
-                    break;
+            case CS_ENDPOINT_DESC:
+                if (context_subclass == AUDIO_SUBCLASS_STREAMING) {
+                    if (context_intf_alt > 1) {
+                        ESP_LOGD(TAG, "Found audio endpoint desc of interface %d-%d, skip", context_intf, context_intf_alt);
+                        break;
+                    }
+                    as_cs_ep_desc_t *desc = (as_cs_ep_desc_t *)next_desc;
+                    if (context_connected_terminal == as_spk_input_terminal) {
+                        as_spk_freq_ctrl_found = AUDIO_EP_CONTROL_SAMPLING_FEQ & desc->bmAttributes;
+                    } else if (context_connected_terminal == as_mic_output_terminal) {
+                        as_mic_freq_ctrl_found = AUDIO_EP_CONTROL_SAMPLING_FEQ & desc->bmAttributes;
+                    }
                 }
+                break;
+            default:
+                break;
             }
-            ESP_LOGV(TAG, "descriptor parsed %d/%d, vs interface %d-%d", offset, wTotalLength, context_intf, context_intf_alt);
-            break;
-        case CS_ENDPOINT_DESC:
-            if (context_class == USB_CLASS_AUDIO && context_subclass == AUDIO_SUBCLASS_STREAMING) {
-                if (context_intf_alt > 1) {
-                    ESP_LOGD(TAG, "Found audio endpoint desc of interface %d-%d, skip", context_intf, context_intf_alt);
+        }
+    }
+
+    /* audio endpoints take the periodic bandwidth first, video gets the largest endpoint fitting the rest */
+    _usb_bw_plan_t bw_plan;
+    _usb_bw_plan_init(&bw_plan, usb_dev->dev_speed, CONFIG_USB_STREAM_BW_BULK_RESERVE);
+    if (usb_dev->enabled[STREAM_UAC_MIC] && as_mic_intf_found
+            && !_usb_bw_plan_ep(&bw_plan, as_mic_intf_ep_attr, as_mic_intf_ep_mps, as_mic_intf_ep_interval, true)) {
+        ESP_LOGE(TAG, "Mic endpoint MPS = %u exceeds the periodic bandwidth, rejected", as_mic_intf_ep_mps);
+        as_mic_intf_found = false;
+        as_mic_bw_rejected = true;
+    }
+    if (usb_dev->enabled[STREAM_UAC_SPK] && as_spk_intf_found
+            && !_usb_bw_plan_ep(&bw_plan, as_spk_intf_ep_attr, as_spk_intf_ep_mps, as_spk_intf_ep_interval, true)) {
+        ESP_LOGE(TAG, "Speaker endpoint MPS = %u exceeds the periodic bandwidth, rejected", as_spk_intf_ep_mps);
+        as_spk_intf_found = false;
+        as_spk_bw_rejected = true;
+    }
+
+    for (size_t i = 0; i < index->intf_num && uvc_dev; i++) {
+        const usb_desc_intf_t *intf = &index->intfs[i];
+        if (intf->cls != USB_CLASS_VIDEO || intf->subclass != VIDEO_SUBCLASS_CONTROL || intf->alt != 0) {
+            continue;
+        }
+        vc_intf_idx = intf->num;
+        int offset = intf->offset;
+        const usb_standard_desc_t *next_desc = (const usb_standard_desc_t *)USB_DESC_INDEX_PTR(cfg_desc, offset);
+        while ((next_desc = usb_parse_next_descriptor(next_desc, intf->end, &offset)) != NULL) {
+            if (next_desc->bDescriptorType != CS_INTERFACE_DESC) {
+                continue;
+            }
+            const desc_header_t *header = (const desc_header_t *)next_desc;
+            if (header->bDescriptorSubtype == VIDEO_CS_ITF_VC_HEADER && header->bLength >= 12) {
+                vc_clock_hz = ((const vc_interface_desc_t *)next_desc)->dwClockFrequency;
+            } else if (header->bDescriptorSubtype == VIDEO_CS_ITF_VC_INPUT_TERMINAL && !vc_unit_id[UVC_VC_CAMERA_TERMINAL]) {
+                parse_vc_camera_terminal_desc((const uint8_t *)next_desc, &vc_unit_id[UVC_VC_CAMERA_TERMINAL], &vc_controls[UVC_VC_CAMERA_TERMINAL]);
+            } else if (header->bDescriptorSubtype == VIDEO_CS_ITF_VC_PROCESSING_UNIT && !vc_unit_id[UVC_VC_PROCESSING_UNIT]) {
+                parse_vc_processing_unit_desc((const uint8_t *)next_desc, &vc_unit_id[UVC_VC_PROCESSING_UNIT], &vc_controls[UVC_VC_PROCESSING_UNIT]);
+            }
+        }
+        break;
+    }
+
+    for (size_t i = 0; i < index->intf_num; i++) {
+        const usb_desc_intf_t *intf = &index->intfs[i];
+        if (intf->cls != USB_CLASS_VIDEO || intf->subclass != VIDEO_SUBCLASS_STREAMING) {
+            continue;
+        }
+        ESP_LOGD(TAG, "Found Video Stream interface, %d-%d", intf->num, intf->alt);
+        for (size_t j = 0; j < intf->ep_num; j++) {
+            const usb_desc_ep_t *ep = &index->eps[intf->ep_first + j];
+            bool ep_supported = ((ep->attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_ISOC) ? _isoc_in_mps_supported(ep->mps)
+                                : (ep->mps <= USB_EP_BULK_HS_MPS);
+            if (ep_supported && USB_EP_MPS_TOTAL(ep->mps) > USB_EP_MPS_TOTAL(vs_intf_ep_mps)) {
+                if (!_usb_bw_plan_ep(&bw_plan, ep->attr, ep->mps, ep->interval, false)) {
+                    vs_bw_rejected = true;
+                    continue;
+                }
+                vs_intf_found = true;
+                vs_intf_ep_mps = ep->mps;
+                vs_intf_ep_attr = ep->attr;
+                vs_intf_ep_addr = ep->addr;
+                vs_intf_ep_interval = ep->interval;
+                vs_intf_idx = intf->num;
+                vs_intf_alt_idx = intf->alt;
+            }
+            if (intf->alt == 1) {
+                //workaround for some camera with error desc
+                vs_intf1_ep_mps = ep->mps;
+                vs_intf1_ep_attr = ep->attr;
+                vs_intf1_ep_addr = ep->addr;
+                vs_intf1_idx = intf->num;
+                vs_intf1_alt_idx = intf->alt;
+            }
+        }
+        // 格式和帧描述符只在 alt 0 下，取第一个符合设置的格式
+        for (size_t j = 0; j < intf->fmt_num && intf->alt == 0 && vs_format == NULL; j++) {
+            const usb_desc_uvc_format_t *fmt = &index->fmts[intf->fmt_first + j];
+            enum uvc_frame_format _format = parse_vs_format_type(USB_DESC_INDEX_PTR(cfg_desc, fmt->offset));
+            switch (fmt->subtype) {
+            case VIDEO_CS_ITF_VS_FORMAT_MJPEG:
+                if (usb_dev->uvc_cfg.format == UVC_FORMAT_MJPEG) {
+                    vs_format = fmt;
+                }
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_UNCOMPRESSED:
+                /* only packed YUY2 is supported */
+                if (usb_dev->uvc_cfg.format != UVC_FORMAT_UNCOMPRESSED) {
                     break;
                 }
-                as_cs_ep_desc_t *desc = (as_cs_ep_desc_t *)next_desc;
-                if (context_connected_terminal == as_spk_input_terminal) {
-                    as_spk_freq_ctrl_found = AUDIO_EP_CONTROL_SAMPLING_FEQ & desc->bmAttributes;
-                } else if (context_connected_terminal == as_mic_output_terminal) {
-                    as_mic_freq_ctrl_found = AUDIO_EP_CONTROL_SAMPLING_FEQ & desc->bmAttributes;
+                if (_format != UVC_FRAME_FORMAT_YUYV) {
+                    ESP_LOGD(TAG, "Skip uncompressed format index %u", fmt->index);
+                    break;
+                }
+                vs_format = fmt;
+                break;
+            case VIDEO_CS_ITF_VS_FORMAT_FRAME_BASED:
+                if (usb_dev->uvc_cfg.format == UVC_FORMAT_FRAME_BASED) {
+                    vs_format = fmt;
                 }
+                break;
+            default:
+                break;
+            }
+            if (vs_format) {
+                format_set_found = true;
+                format_idx = fmt->index;
+                frame_num = fmt->frame_num_declared;
+                format = _format;
             }
-            break;
-        default:
-            break;
         }
-        if (!already_next && next_desc) {
-            next_desc = usb_parse_next_descriptor(next_desc, wTotalLength, &offset);
+    }
+
+    if (vs_intf_found) {
+        _usb_bw_plan_ep(&bw_plan, vs_intf_ep_attr, vs_intf_ep_mps, vs_intf_ep_interval, true);
+    }
+    UVC_ENTER_CRITICAL();
+    usb_dev->stats.pub.bus.periodic_ns = _usb_bw_plan_peak(&bw_plan);
+    usb_dev->stats.pub.bus.budget_ns = bw_plan.budget_ns;
+    UVC_EXIT_CRITICAL();
+    ESP_LOGI(TAG, "Periodic bandwidth: %"PRIu32" / %"PRIu32" ns per %sframe", _usb_bw_plan_peak(&bw_plan), bw_plan.budget_ns,
+             usb_dev->dev_speed == USB_SPEED_HIGH ? "micro" : "");
+
+    if (vs_format && uvc_dev) {
+        // frame_size 按 bFrameIndex 索引，帧描述符比声明的多时按实际的最大索引分配
+        size_t size_num = vs_format->frame_num_declared > vs_format->frame_index_max ? vs_format->frame_num_declared : vs_format->frame_index_max;
+        uvc_frame_size_t *frame_size = (uvc_frame_size_t *)heap_caps_calloc(size_num ? size_num : 1, sizeof(uvc_frame_size_t), MALLOC_CAP_DEFAULT);
+        UVC_CHECK(frame_size, "alloc uvc frame size failed", ESP_ERR_NO_MEM);
+        for (size_t i = 0; i < vs_format->frame_num; i++) {
+            const usb_desc_uvc_frame_t *frame = &index->frames[vs_format->frame_first + i];
+            uint32_t final_interval = _uvc_frame_interval_select(cfg_desc, frame, usb_dev->uvc_cfg.frame_interval);
+            if (final_interval == 0) {
+                final_interval = frame->interval_default;
+                ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " not found, using default = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
+            } else {
+                ESP_LOGD(TAG, "UVC frame interval %" PRIu32 " found = %" PRIu32, usb_dev->uvc_cfg.frame_interval, final_interval);
+            }
+            frame_size[frame->index - 1].width = frame->width;
+            frame_size[frame->index - 1].height = frame->height;
+            frame_size[frame->index - 1].interval = final_interval;
+            frame_size[frame->index - 1].interval_min = frame->interval_min;
+            frame_size[frame->index - 1].interval_max = frame->interval_max;
+            frame_size[frame->index - 1].interval_step = frame->interval_step;
         }
-        ESP_LOGV(TAG, "descriptor parsed %d/%d", offset, wTotalLength);
-    } while (next_desc != NULL);
+        UVC_ENTER_CRITICAL();
+        uvc_frame_size_t *old_frame_size = uvc_dev->frame_size;
+        uvc_dev->frame_num = size_num;
+        uvc_dev->frame_size = frame_size;
+        uvc_dev->frame_format = format;
+        UVC_EXIT_CRITICAL();
+        heap_caps_free(old_frame_size);
+    }
+
+    for (size_t i = 0; vs_format && i < vs_format->frame_num && !user_frame_found; i++) {
+        const usb_desc_uvc_frame_t *frame = &index->frames[vs_format->frame_first + i];
+        if (((frame->width == usb_dev->uvc_cfg.frame_width) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_width))
+                && ((frame->height == usb_dev->uvc_cfg.frame_height) || (FRAME_RESOLUTION_ANY == usb_dev->uvc_cfg.frame_height))) {
+            user_frame_found = true;
+            user_frame_idx = frame->index;
+        } else if ((frame->width == usb_dev->uvc_cfg.frame_height) && (frame->height == usb_dev->uvc_cfg.frame_width)) {
+            ESP_LOGW(TAG, "found width*height %u * %u , orientation swap?", frame->height, frame->width);
+        }
+    }
 
     // check all params we get
     if (usb_dev->enabled[STREAM_UVC]) {
+        UVC_ENTER_CRITICAL();
+        uvc_dev->vc_interface = vc_intf_idx;
+        memcpy(uvc_dev->vc_unit_id, vc_unit_id, sizeof(vc_unit_id));
+        memcpy(uvc_dev->vc_controls, vc_controls, sizeof(vc_controls));
+        uvc_dev->vc_clock_hz = vc_clock_hz;
+        // the quality range is queried again from the new camera
+        uvc_dev->comp_range_valid = false;
+        UVC_EXIT_CRITICAL();
+        ESP_LOGI(TAG, "VC Interface = %u, clock = %"PRIu32" Hz, camera terminal = %u (controls 0x%06"PRIx32"), processing unit = %u (controls 0x%06"PRIx32")",
+                 vc_intf_idx, vc_clock_hz, vc_unit_id[UVC_VC_CAMERA_TERMINAL], vc_controls[UVC_VC_CAMERA_TERMINAL],
+                 vc_unit_id[UVC_VC_PROCESSING_UNIT], vc_controls[UVC_VC_PROCESSING_UNIT]);
         if (vs_intf_found) {
             //Re-config uvc device
             UVC_ENTER_CRITICAL();
@@ -1510,12 +1799,15 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
             uvc_dev->vs_ifc->ep_mps = vs_intf_ep_mps;
             uvc_dev->vs_ifc->xfer_type = (vs_intf_ep_attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_ISOC ? UVC_XFER_ISOC
                                          : ((vs_intf_ep_attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_BULK ? UVC_XFER_BULK : UVC_XFER_UNKNOWN);
-            ESP_LOGI(TAG, "Actual VS Interface(MPS <= %d) found, interface = %u, alt = %u", USB_EP_ISOC_IN_MAX_MPS, vs_intf_idx, vs_intf_alt_idx);
-            ESP_LOGI(TAG, "\tEndpoint(%s) Addr = 0x%x, MPS = %u", uvc_dev->vs_ifc->xfer_type == UVC_XFER_ISOC ? "ISOC"
-                     : (uvc_dev->vs_ifc->xfer_type == UVC_XFER_BULK ? "BULK" : "Unknown"), vs_intf_ep_addr, vs_intf_ep_mps);
+            ESP_LOGI(TAG, "Actual VS Interface(MPS <= %d) found, interface = %u, alt = %u", USB_EP_ISOC_MAX_BYTES, vs_intf_idx, vs_intf_alt_idx);
+            ESP_LOGI(TAG, "\tEndpoint(%s) Addr = 0x%x, MPS = %u x %u", uvc_dev->vs_ifc->xfer_type == UVC_XFER_ISOC ? "ISOC"
+                     : (uvc_dev->vs_ifc->xfer_type == UVC_XFER_BULK ? "BULK" : "Unknown"), vs_intf_ep_addr, USB_EP_MPS_SIZE(vs_intf_ep_mps), USB_EP_MPS_MULT(vs_intf_ep_mps));
+        } else if (vs_bw_rejected) {
+            ESP_LOGE(TAG, "VS Interface NOT fit in the periodic bandwidth left, %"PRIu32" / %"PRIu32" ns used, rejected",
+                     _usb_bw_plan_peak(&bw_plan), bw_plan.budget_ns);
         } else if (usb_dev->uvc_cfg.interface) {
             //Try with user's config
-            ESP_LOGW(TAG, "VS Interface(MPS <= %d) NOT found", USB_EP_ISOC_IN_MAX_MPS);
+            ESP_LOGW(TAG, "VS Interface(MPS <= %d) NOT found", USB_EP_ISOC_MAX_BYTES);
             ESP_LOGW(TAG, "Try with user's config");
             UVC_ENTER_CRITICAL();
             uvc_dev->vs_ifc->interface = usb_dev->uvc_cfg.interface;
@@ -1536,11 +1828,11 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
             uvc_dev->vs_ifc->xfer_type = (vs_intf1_ep_attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_ISOC ? UVC_XFER_ISOC
                                          : ((vs_intf1_ep_attr & USB_BM_ATTRIBUTES_XFERTYPE_MASK) == USB_BM_ATTRIBUTES_XFER_BULK ? UVC_XFER_BULK : UVC_XFER_UNKNOWN);
             vs_intf_found = true;
-            ESP_LOGW(TAG, "VS Interface(MPS <= %d) NOT found", USB_EP_ISOC_IN_MAX_MPS);
+            ESP_LOGW(TAG, "VS Interface(MPS <= %d) NOT found", USB_EP_ISOC_MAX_BYTES);
             ESP_LOGW(TAG, "Try with first alt-interface config");
         }
         if (format_set_found) {
-            ESP_LOGI(TAG, "Actual %s format index, format index = %u, contains %u frames", usb_dev->uvc_cfg.format == UVC_FORMAT_FRAME_BASED ? "Frame Based" : "MJPEG", format_idx, frame_num);
+            ESP_LOGI(TAG, "Actual %s format index, format index = %u, contains %u frames", usb_dev->uvc_cfg.format == UVC_FORMAT_FRAME_BASED ? "Frame Based" : (usb_dev->uvc_cfg.format == UVC_FORMAT_UNCOMPRESSED ? "YUY2" : "MJPEG"), format_idx, frame_num);
             uvc_dev->format_index = format_idx;
         } else if (usb_dev->uvc_cfg.format_index) {
             ESP_LOGW(TAG, "Setting format: %d NOT found", usb_dev->uvc_cfg.format);
@@ -1652,7 +1944,7 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
             uac_dev->freq_ctrl_support[UAC_SPK] = as_spk_freq_ctrl_found;
             ESP_LOGI(TAG, "\tSpeaker frequency control %s Support", as_spk_freq_ctrl_found ? "" : "Not");
         }
-    } else if (usb_dev->enabled[STREAM_UAC_SPK] && usb_dev->uac_cfg.spk_interface) {
+    } else if (usb_dev->enabled[STREAM_UAC_SPK] && usb_dev->uac_cfg.spk_interface && !as_spk_bw_rejected) {
         UVC_ENTER_CRITICAL();
         uac_dev->as_ifc[UAC_SPK]->interface = usb_dev->uac_cfg.spk_interface;
         uac_dev->as_ifc[UAC_SPK]->interface_alt = 1;
@@ -1688,7 +1980,7 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
             uac_dev->freq_ctrl_support[UAC_MIC] = as_mic_freq_ctrl_found;
             ESP_LOGI(TAG, "\tMic frequency control %s Support", as_mic_freq_ctrl_found ? "" : "Not");
         }
-    } else if (usb_dev->enabled[STREAM_UAC_MIC] && usb_dev->uac_cfg.mic_interface) {
+    } else if (usb_dev->enabled[STREAM_UAC_MIC] && usb_dev->uac_cfg.mic_interface && !as_mic_bw_rejected) {
         UVC_ENTER_CRITICAL();
         uac_dev->as_ifc[UAC_MIC]->interface = usb_dev->uac_cfg.mic_interface;
         uac_dev->as_ifc[UAC_MIC]->interface_alt = 1;
@@ -1718,6 +2010,22 @@ static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_des
     return ESP_OK;
 }
 
+static esp_err_t _update_config_from_descriptor(const usb_config_desc_t *cfg_desc)
+{
+    if (cfg_desc == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const usb_desc_index_t *index = NULL;
+    esp_err_t ret = usb_desc_index_get(cfg_desc, &index);
+    UVC_CHECK(ret == ESP_OK, "index config descriptor failed", ret);
+#ifdef CONFIG_UVC_PRINT_DESC
+    _print_config_descriptor(cfg_desc);
+#endif
+    ret = _update_config_from_index(cfg_desc, index);
+    usb_desc_index_release(index);
+    return ret;
+}
+
 static esp_err_t _usb_ctrl_xfer(urb_t *urb, TickType_t xTicksToWait)
 {
     UVC_CHECK(_usb_device_get_state() > STATE_DEVICE_INSTALLED, "USB Device not active", ESP_ERR_INVALID_STATE);
@@ -1789,7 +2097,10 @@ static esp_err_t _usb_set_device_interface(uint16_t interface, uint16_t interfac
     return ret;
 }
 
-static esp_err_t _uvc_vs_commit_control(uvc_stream_ctrl_t *ctrl_set, uvc_stream_ctrl_t *ctrl_probed)
+/**
+ * @brief UVC probe and commit, if probe is false, ctrl_probed is committed directly
+ */
+static esp_err_t _uvc_vs_commit_control(uvc_stream_ctrl_t *ctrl_set, uvc_stream_ctrl_t *ctrl_probed, bool probe)
 {
     UVC_CHECK(ctrl_set != NULL && ctrl_probed != NULL, "pointer can not be NULL", ESP_ERR_INVALID_ARG);
     UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
@@ -1800,13 +2111,17 @@ static esp_err_t _uvc_vs_commit_control(uvc_stream_ctrl_t *ctrl_set, uvc_stream_
         UVC_CHECK(urb_ctrl != NULL, "alloc urb failed", ESP_ERR_NO_MEM);
         need_free = true;
     }
+    esp_err_t ret = ESP_OK;
+    if (!probe) {
+        goto commit_;
+    }
 
     ESP_LOGD(TAG, "SET_CUR Probe");
     xSemaphoreTake(s_usb_dev.xfer_mutex_hdl, portMAX_DELAY);
     USB_CTRL_UVC_PROBE_SET_REQ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer);
     _uvc_stream_ctrl_to_buf((urb_ctrl->transfer.data_buffer + sizeof(usb_setup_packet_t)), ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer)->wLength, ctrl_set);
     urb_ctrl->transfer.num_bytes = sizeof(usb_setup_packet_t) + ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer)->wLength;
-    esp_err_t ret = _usb_ctrl_xfer(urb_ctrl, pdMS_TO_TICKS(TIMEOUT_USB_CTRL_XFER_MS));
+    ret = _usb_ctrl_xfer(urb_ctrl, pdMS_TO_TICKS(TIMEOUT_USB_CTRL_XFER_MS));
     xSemaphoreGive(s_usb_dev.xfer_mutex_hdl);
     UVC_CHECK_GOTO(ESP_OK == ret, "SET_CUR Probe failed", free_urb_);
     ESP_LOGD(TAG, "SET_CUR Probe Done");
@@ -1827,6 +2142,7 @@ static esp_err_t _uvc_vs_commit_control(uvc_stream_ctrl_t *ctrl_set, uvc_stream_
     _uvc_stream_ctrl_printf(stdout, ctrl_probed);
 #endif
 
+commit_:
     ESP_LOGD(TAG, "SET_CUR Commit");
     xSemaphoreTake(s_usb_dev.xfer_mutex_hdl, portMAX_DELAY);
     USB_CTRL_UVC_COMMIT_REQ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer);
@@ -1844,6 +2160,43 @@ free_urb_:
     return ret;
 }
 
+/**
+ * @brief UVC probe GET_MIN/GET_MAX/GET_DEF, the probe state of the device is not changed
+ */
+static esp_err_t _uvc_vs_probe_get(uint8_t req, uvc_stream_ctrl_t *ctrl)
+{
+    UVC_CHECK(ctrl != NULL, "pointer can not be NULL", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    urb_t *urb_ctrl = s_usb_dev.ctrl_urb;
+    bool need_free = false;
+    if (urb_ctrl == NULL) {
+        urb_ctrl = _usb_urb_alloc(0, sizeof(usb_setup_packet_t) + 128, NULL);
+        UVC_CHECK(urb_ctrl != NULL, "alloc urb failed", ESP_ERR_NO_MEM);
+        need_free = true;
+    }
+    xSemaphoreTake(s_usb_dev.xfer_mutex_hdl, portMAX_DELAY);
+    USB_CTRL_UVC_PROBE_GET_GENERAL_REQ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer, req);
+    uint16_t len = ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer)->wLength;
+    urb_ctrl->transfer.num_bytes = sizeof(usb_setup_packet_t) + usb_round_up_to_mps(len, s_usb_dev.ep_mps); //IN should be integer multiple of MPS
+    esp_err_t ret = _usb_ctrl_xfer(urb_ctrl, pdMS_TO_TICKS(TIMEOUT_USB_CTRL_XFER_MS));
+    if (ret == ESP_OK) {
+        // UVC 1.0 devices answer 26 bytes, the fields used here are all in it
+        if (urb_ctrl->transfer.actual_num_bytes < sizeof(usb_setup_packet_t) + 26) {
+            ret = ESP_ERR_INVALID_SIZE;
+        } else {
+            _buf_to_uvc_stream_ctrl((urb_ctrl->transfer.data_buffer + sizeof(usb_setup_packet_t)), len, ctrl);
+        }
+    }
+    xSemaphoreGive(s_usb_dev.xfer_mutex_hdl);
+    ESP_LOGD(TAG, "GET 0x%02x Probe, ret = 0x%x", req, ret);
+
+    if (need_free) {
+        _usb_urb_free(urb_ctrl);
+    }
+    return ret;
+}
+
+#ifndef CONFIG_USB_STREAM_UVC_ONLY
 static esp_err_t _uac_as_control_set_mute(uint16_t ac_itc, uint8_t ch, uint8_t fu_id, bool if_mute)
 {
     UVC_CHECK(fu_id != 0, "invalid fu_id", ESP_ERR_INVALID_ARG);
@@ -1956,27 +2309,425 @@ free_urb_:
     return ret;
 }
 
+#else
+static inline esp_err_t _uac_as_control_set_freq(uint8_t ep_addr, uint32_t freq)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+#endif // CONFIG_USB_STREAM_UVC_ONLY
+
+/***************************************************Frame Pool Implements****************************************/
+/**
+ * @brief Take a free slot from frame pool, lock-free
+ *
+ * @return slot index, UVC_FRAME_POOL_SLOT_NONE if all slots in use
+ */
+IRAM_ATTR static uint8_t _uvc_frame_pool_acquire(_uvc_frame_pool_t *pool)
+{
+    uint32_t mask = __atomic_load_n(&pool->free_mask, __ATOMIC_ACQUIRE);
+    while (mask) {
+        uint8_t slot = __builtin_ctz(mask);
+        if (__atomic_compare_exchange_n(&pool->free_mask, &mask, mask & ~BIT(slot), true, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            return slot;
+        }
+    }
+    return UVC_FRAME_POOL_SLOT_NONE;
+}
+
+/**
+ * @brief Give back a slot to frame pool, lock-free
+ */
+IRAM_ATTR static void _uvc_frame_pool_release(_uvc_frame_pool_t *pool, uint8_t slot)
+{
+    __atomic_fetch_or(&pool->free_mask, BIT(slot), __ATOMIC_RELEASE);
+}
+
+static void _uvc_frame_pool_free(_uvc_frame_pool_t *pool)
+{
+    for (size_t i = 0; i < UVC_FRAME_POOL_MAX_NUM; i++) {
+        if (pool->slot_buf[i]) {
+            usb_stream_buf_free(pool->slot_buf[i]);
+            pool->slot_buf[i] = NULL;
+        }
+    }
+    if (pool->ready_queue) {
+        vQueueDelete(pool->ready_queue);
+        pool->ready_queue = NULL;
+    }
+    pool->num = 0;
+    pool->slot_size = 0;
+    pool->free_mask = 0;
+}
+
+/**
+ * @brief Allocate frame pool slots, the pool will be reused if slots are large enough
+ *
+ * @param pool frame pool
+ * @param num slot numbers
+ * @param slot_size bytes of each slot
+ * @return esp_err_t
+ */
+static esp_err_t _uvc_frame_pool_alloc(_uvc_frame_pool_t *pool, uint8_t num, size_t slot_size)
+{
+    if (pool->num == num && pool->slot_size >= slot_size) {
+        return ESP_OK;
+    }
+    UVC_CHECK(__atomic_load_n(&pool->free_mask, __ATOMIC_ACQUIRE) == (BIT(pool->num) - 1), "frame pool slots in use", ESP_ERR_INVALID_STATE);
+    _uvc_frame_pool_free(pool);
+    pool->ready_queue = xQueueCreate(UVC_FRAME_POOL_MAX_NUM + 1, sizeof(uint8_t));
+    UVC_CHECK_GOTO(pool->ready_queue != NULL, "Create frame pool queue failed", free_pool_);
+    uint32_t caps = 0;
+    for (size_t i = 0; i < num; i++) {
+        uint32_t slot_caps = 0;
+        pool->slot_buf[i] = usb_stream_buf_alloc(slot_size, USB_STREAM_BUF_FRAME, &slot_caps);
+        UVC_CHECK_GOTO(pool->slot_buf[i] != NULL, "malloc frame pool slot failed", free_pool_);
+        pool->frame[i].data = pool->slot_buf[i];
+        pool->frame[i].library_owns_data = 1;
+        caps |= slot_caps;
+    }
+    pool->num = num;
+    pool->slot_size = slot_size;
+    __atomic_store_n(&pool->free_mask, BIT(num) - 1, __ATOMIC_RELEASE);
+    ESP_LOGI(TAG, "Frame pool alloc succeed, %u * %u B in %s%s", num, slot_size,
+             (caps & MALLOC_CAP_SPIRAM) ? "PSRAM" : "internal RAM", (caps & MALLOC_CAP_DMA) ? " (DMA)" : "");
+    return ESP_OK;
+
+free_pool_:
+    _uvc_frame_pool_free(pool);
+    return ESP_ERR_NO_MEM;
+}
+
+/**
+ * @brief Current USB (micro)frame number, 1 ms per frame at full speed
+ */
+static inline uint16_t _usb_frame_num(void)
+{
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    return (uint16_t)usb_dwc_ll_hfnum_get_frame_num(&USB_DWC);
+#else
+    return (uint16_t)(esp_timer_get_time() / 1000);
+#endif
+}
+
+/**
+ * @brief esp_timer time of the bus SOF numbered sof (11 bits), at which the device sampled the STC of an SCR.
+ * The header is handled within a few frames of its SOF; without the bus frame number,
+ * or with a SOF counter not following the bus, the handling time is used instead
+ */
+IRAM_ATTR static inline int64_t _uvc_scr_sof_time(uint16_t sof)
+{
+    int64_t now = esp_timer_get_time();
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    uint16_t cur = _usb_frame_num();
+    if (s_usb_dev.dev_speed == USB_SPEED_HIGH) {
+        // HFNUM counts microframes at high speed, the SOF counter in SCR counts frames
+        cur >>= 3;
+    }
+    uint16_t age = (cur - sof) & 0x7FF;
+    if (age < UVC_SCR_SOF_AGE_MAX) {
+        now -= (int64_t)age * 1000;
+    }
+#endif
+    return now;
+}
+
+/**
+ * @brief Local esp_timer time the device started capturing the frame.
+ * PTS and the STC of SCR are the same device clock (dwClockFrequency of the VC header),
+ * the first SCR of the frame anchors it to local time. Frames without PTS/SCR, or with
+ * a result far from the arrival, use the arrival time of the first payload
+ */
+IRAM_ATTR static inline int64_t _uvc_capture_time(const _uvc_stream_handle_t *strmh)
+{
+    uint32_t hz = s_usb_dev.uvc->vc_clock_hz;
+    if (strmh->pts == 0 || strmh->scr_us == 0 || hz == 0) {
+        return strmh->sof_us;
+    }
+    int32_t ticks = (int32_t)(strmh->pts - strmh->scr_stc);
+    int64_t us = strmh->scr_us + (int64_t)ticks * 1000000 / hz;
+    if (us > strmh->sof_us + UVC_CAPTURE_TIME_SKEW_MAX_US || us + UVC_CAPTURE_TIME_SKEW_MAX_US < strmh->sof_us) {
+        return strmh->sof_us;
+    }
+    return us;
+}
+
+/**
+ * @brief Stamp the esp_timer time of frame EOF, to measure the delivery latency
+ */
+IRAM_ATTR static inline void _uvc_stamp_eof(struct timespec *ts)
+{
+    int64_t now = esp_timer_get_time();
+    ts->tv_sec = now / 1000000;
+    ts->tv_nsec = (now % 1000000) * 1000;
+}
+
+/**
+ * @brief Publish the working slot to sample task, then switch to a free slot.
+ * if all slots in use, drop the frame and reuse the working slot
+ */
+IRAM_ATTR static void _uvc_frame_pool_publish(_uvc_stream_handle_t *strmh)
+{
+    _uvc_frame_pool_t *pool = strmh->pool;
+    uint8_t next_slot = _uvc_frame_pool_acquire(pool);
+    if (next_slot == UVC_FRAME_POOL_SLOT_NONE) {
+        ESP_LOGD(TAG, "pool full drop frame = %"PRIu32"", strmh->seq);
+        s_usb_dev.stats.pub.uvc.drop_busy++;
+        return;
+    }
+    uvc_frame_t *frame = &pool->frame[strmh->out_slot];
+    frame->data_bytes = strmh->got_bytes;
+    frame->sequence = strmh->seq;
+    frame->capture_us = _uvc_capture_time(strmh);
+    _uvc_stamp_eof(&frame->capture_time_finished);
+    frame->width = strmh->width;
+    frame->height = strmh->height;
+    ESP_LOGV(TAG, "uvc publish slot %u length = %d", strmh->out_slot, strmh->got_bytes);
+    xQueueSend(pool->ready_queue, &strmh->out_slot, 0);
+    strmh->out_slot = next_slot;
+    strmh->outbuf = pool->slot_buf[next_slot];
+}
+
 /***************************************************LibUVC API Implements****************************************/
+/**
+ * @brief Notify user payload callback, called in usb task
+ */
+IRAM_ATTR static inline void _uvc_payload_notify(const uint8_t *data, size_t len, uint32_t flags)
+{
+    if (flags & UVC_PAYLOAD_FLAG_SOF) {
+        SYSVIEW_UVC_FRAME_START();
+    } else if (flags & (UVC_PAYLOAD_FLAG_EOF | UVC_PAYLOAD_FLAG_DROP)) {
+        SYSVIEW_UVC_FRAME_STOP();
+    }
+    if (s_usb_dev.uvc_cfg.payload_cb) {
+        s_usb_dev.uvc_cfg.payload_cb(data, len, flags, s_usb_dev.uvc_cfg.payload_cb_arg);
+    }
+}
+
+static inline uint32_t _bulk_bytes_per_ms(void)
+{
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+    if (s_usb_dev.dev_speed == USB_SPEED_HIGH) {
+        return USB_BULK_HS_BYTES_PER_MS;
+    }
+#endif
+    return USB_BULK_FS_BYTES_PER_MS;
+}
+
+/**
+ * @brief Work out bulk urb size and number from the negotiated payload size and observed frame size
+ *
+ * URB size: frame_size / UVC_BULK_URBS_PER_FRAME (NUM_BULK_BYTES_PER_URB before the first frames), bounded by [NUM_BULK_BYTES_PER_URB, UVC_BULK_URB_BYTES_MAX],
+ * rounded to MPS and never larger than dwMaxPayloadTransferSize.
+ * URB number: enough to cover UVC_BULK_URB_RING_MS of bus time, bounded by [NUM_BULK_STREAM_URBS, UVC_BULK_URB_NUM_MAX].
+ */
+static void _uvc_bulk_urb_calc(const _uvc_stream_handle_t *strmh, uint32_t *bytes_per_urb, uint32_t *urb_num)
+{
+    const _stream_ifc_t *p_itf = s_usb_dev.uvc->vs_ifc;
+    uint32_t mps = USB_EP_MPS_SIZE(p_itf->ep_mps) ? USB_EP_MPS_SIZE(p_itf->ep_mps) : USB_EP_BULK_FS_MPS;
+    uint32_t payload = strmh->cur_ctrl.dwMaxPayloadTransferSize;
+    uint32_t bytes = NUM_BULK_BYTES_PER_URB;
+    uint32_t num = NUM_BULK_STREAM_URBS;
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+    bytes = strmh->frame_bytes_avg ? strmh->frame_bytes_avg / UVC_BULK_URBS_PER_FRAME : NUM_BULK_BYTES_PER_URB;
+    bytes = bytes < NUM_BULK_BYTES_PER_URB ? NUM_BULK_BYTES_PER_URB : bytes;
+    bytes = bytes > UVC_BULK_URB_BYTES_MAX ? UVC_BULK_URB_BYTES_MAX : bytes;
+    bytes = usb_round_up_to_mps(bytes, mps);
+#endif
+    if (payload && payload < bytes) {
+        bytes = payload;
+    }
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+    num = (_bulk_bytes_per_ms() * UVC_BULK_URB_RING_MS + bytes - 1) / bytes;
+    num = num < NUM_BULK_STREAM_URBS ? NUM_BULK_STREAM_URBS : num;
+    num = num > UVC_BULK_URB_NUM_MAX ? UVC_BULK_URB_NUM_MAX : num;
+#endif
+    *bytes_per_urb = bytes;
+    *urb_num = num;
+}
+
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+/**
+ * @brief Track frame size and rebuild the bulk urb ring when the ideal layout moved far enough
+ * called from stream task at the end of each frame
+ */
+static void _uvc_bulk_urb_retune_check(_uvc_stream_handle_t *strmh)
+{
+    _stream_ifc_t *p_itf = s_usb_dev.uvc->vs_ifc;
+    if (p_itf->xfer_type != UVC_XFER_BULK || strmh->got_bytes == 0) {
+        return;
+    }
+    strmh->frame_bytes_avg = strmh->frame_bytes_avg ? (strmh->frame_bytes_avg * 7 + strmh->got_bytes) / 8 : strmh->got_bytes;
+    if (++strmh->tune_frames < UVC_BULK_TUNE_FRAMES) {
+        return;
+    }
+    strmh->tune_frames = 0;
+
+    uint32_t bytes = 0, num = 0;
+    _uvc_bulk_urb_calc(strmh, &bytes, &num);
+    // hysteresis: only rebuild for a 2x size change or a different urb count
+    if (num == p_itf->urb_num && bytes * 2 > p_itf->bytes_per_packet && bytes < p_itf->bytes_per_packet * 2) {
+        return;
+    }
+    ESP_LOGI(TAG, "UVC bulk urb retune: %"PRIu32" x %"PRIu32" -> %"PRIu32" x %"PRIu32" (frame avg %"PRIu32")",
+             p_itf->urb_num, p_itf->bytes_per_packet, num, bytes, strmh->frame_bytes_avg);
+    // internal suspend + resume, the resume path re-sizes and re-allocates the urb list
+    _event_msg_t evt_msg = {
+        ._type = USER_EVENT,
+        ._event.user_cmd = STREAM_SUSPEND,
+        ._event_data = (void *)STREAM_UVC,
+        ._handle.user_hdl = (void *)s_usb_dev.stream_task_hdl,
+    };
+    if (uxQueueSpacesAvailable(s_usb_dev.stream_queue_hdl) < 2) {
+        return;
+    }
+    xQueueSend(s_usb_dev.stream_queue_hdl, &evt_msg, 0);
+    evt_msg._event.user_cmd = STREAM_RESUME;
+    xQueueSend(s_usb_dev.stream_queue_hdl, &evt_msg, 0);
+}
+#endif
+
+#ifdef CONFIG_UVC_CHECK_JPEG_INTEGRITY
+#define UVC_JPEG_MARKER_WALK_MAX      16
+#define UVC_JPEG_EOI_PADDING_MAX      64
+
+typedef enum {
+    UVC_JPEG_OK,
+    UVC_JPEG_TRUNCATED,
+    UVC_JPEG_CORRUPT,
+} _uvc_jpeg_check_t;
+
+/**
+ * @brief Cheap MJPEG sanity check, entropy coded data is not decoded.
+ * SOI, the marker segments before SOS and the trailing EOI are checked,
+ * some cameras pad the frame with 0x00/0xff after EOI.
+ */
+IRAM_ATTR static _uvc_jpeg_check_t _uvc_jpeg_check(const uint8_t *buf, size_t len)
+{
+    if (len < 4 || buf[0] != 0xff || buf[1] != 0xd8) {
+        return UVC_JPEG_CORRUPT;
+    }
+    size_t pos = 2;
+    for (int i = 0; i < UVC_JPEG_MARKER_WALK_MAX; i++) {
+        // skip fill bytes before the marker
+        while (pos + 1 < len && buf[pos] == 0xff && buf[pos + 1] == 0xff) {
+            pos++;
+        }
+        if (pos + 4 > len) {
+            return UVC_JPEG_TRUNCATED;
+        }
+        if (buf[pos] != 0xff) {
+            return UVC_JPEG_CORRUPT;
+        }
+        uint8_t marker = buf[pos + 1];
+        bool known = (marker >= 0xc0 && marker <= 0xcf && marker != 0xc8) /* SOFn, DHT, DAC */
+                     || (marker >= 0xe0 && marker <= 0xef)                 /* APPn */
+                     || marker == 0xdb || marker == 0xdd || marker == 0xfe || marker == 0xda;
+        uint16_t seg_len = (buf[pos + 2] << 8) | buf[pos + 3];
+        if (!known || seg_len < 2) {
+            return UVC_JPEG_CORRUPT;
+        }
+        if (pos + 2 + seg_len > len) {
+            return UVC_JPEG_TRUNCATED;
+        }
+        pos += 2 + seg_len;
+        if (marker == 0xda) {
+            break;
+        }
+    }
+    size_t end = len;
+    size_t end_min = (len - pos > UVC_JPEG_EOI_PADDING_MAX) ? len - UVC_JPEG_EOI_PADDING_MAX : pos;
+    while (end > end_min && (buf[end - 1] == 0x00 || buf[end - 1] == 0xff)) {
+        end--;
+    }
+    if (end < pos + 2 || buf[end - 2] != 0xff || buf[end - 1] != 0xd9) {
+        return UVC_JPEG_TRUNCATED;
+    }
+    return UVC_JPEG_OK;
+}
+
+/**
+ * @brief Check the working frame, count and return false if it should be dropped
+ */
+IRAM_ATTR static bool _uvc_jpeg_frame_valid(_uvc_stream_handle_t *strmh)
+{
+    if (strmh->frame_format != UVC_FRAME_FORMAT_MJPEG) {
+        return true;
+    }
+    switch (_uvc_jpeg_check(strmh->outbuf, strmh->got_bytes)) {
+    case UVC_JPEG_TRUNCATED:
+        s_usb_dev.stats.pub.uvc.drop_jpeg_truncated++;
+        ESP_LOGD(TAG, "jpeg truncated drop frame = %"PRIu32", len = %u", strmh->seq, strmh->got_bytes);
+        return false;
+    case UVC_JPEG_CORRUPT:
+        s_usb_dev.stats.pub.uvc.drop_jpeg_corrupt++;
+        ESP_LOGD(TAG, "jpeg corrupt drop frame = %"PRIu32", len = %u", strmh->seq, strmh->got_bytes);
+        return false;
+    default:
+        return true;
+    }
+}
+#endif
+
+/**
+ * @brief Clean buffer without swap
+ */
+IRAM_ATTR static void _uvc_drop_buffers(_uvc_stream_handle_t *strmh)
+{
+    if (strmh->got_bytes) {
+        _uvc_payload_notify(NULL, 0, UVC_PAYLOAD_FLAG_DROP);
+    }
+    strmh->got_bytes = 0;
+    strmh->last_scr = 0;
+    strmh->pts = 0;
+    strmh->scr_us = 0;
+}
+
 /**
  * @brief Swap the working buffer with the presented buffer and notify consumers
  */
 IRAM_ATTR static void _uvc_swap_buffers(_uvc_stream_handle_t *strmh)
 {
+#ifdef CONFIG_UVC_CHECK_JPEG_INTEGRITY
+    if (!_uvc_jpeg_frame_valid(strmh)) {
+        _uvc_drop_buffers(strmh);
+        return;
+    }
+#endif
+    _uvc_payload_notify(NULL, 0, UVC_PAYLOAD_FLAG_EOF);
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+    _uvc_bulk_urb_retune_check(strmh);
+#endif
+    if (strmh->pool) {
+        _uvc_frame_pool_publish(strmh);
+        goto reset_;
+    }
     /* to prevent the latest data from being lost
     * if take mutex timeout, we should drop the last frame */
     size_t timeout_ms = 0;
     if (s_usb_dev.uvc->vs_ifc->xfer_type == UVC_XFER_BULK) {
-        // for full speed bulk mode, max 19 packet can be transmit during each millisecond
-        timeout_ms = (s_usb_dev.uvc->vs_ifc->urb_num - 1) * (s_usb_dev.uvc->vs_ifc->bytes_per_packet * 0.052 / USB_EP_BULK_FS_MPS);
+        // bus time needed to fill the other queued urbs
+        timeout_ms = ((s_usb_dev.uvc->vs_ifc->urb_num - 1) * s_usb_dev.uvc->vs_ifc->bytes_per_packet) / _bulk_bytes_per_ms();
     } else {
         timeout_ms = (s_usb_dev.uvc->vs_ifc->urb_num - 1) * s_usb_dev.uvc->vs_ifc->packets_per_urb;
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+        if (s_usb_dev.dev_speed == USB_SPEED_HIGH) {
+            // high speed isoc packets are scheduled every 125us microframe
+            timeout_ms /= 8;
+        }
+#endif
     }
     size_t timeout_tick = pdMS_TO_TICKS(timeout_ms);
     if (timeout_tick == 0) {
         timeout_tick = 1;
     }
     if (xSemaphoreTake(strmh->cb_mutex, timeout_tick) == pdTRUE) {
-        /* code */
+        if (strmh->hold_borrowed) {
+            /* holdbuf still used by user, reuse the working buffer for next frame */
+            xSemaphoreGive(strmh->cb_mutex);
+            ESP_LOGD(TAG, "frame borrowed, drop frame = %"PRIu32"", strmh->seq);
+            s_usb_dev.stats.pub.uvc.drop_busy++;
+            goto reset_;
+        }
         /* swap the buffers */
         uint8_t *tmp_buf = strmh->holdbuf;
         strmh->hold_bytes = strmh->got_bytes;
@@ -1984,212 +2735,351 @@ IRAM_ATTR static void _uvc_swap_buffers(_uvc_stream_handle_t *strmh)
         strmh->outbuf = tmp_buf;
         strmh->hold_last_scr = strmh->last_scr;
         strmh->hold_pts = strmh->pts;
+        strmh->hold_capture_us = _uvc_capture_time(strmh);
         strmh->hold_seq = strmh->seq;
+        strmh->hold_width = strmh->width;
+        strmh->hold_height = strmh->height;
+        _uvc_stamp_eof(&strmh->capture_time_finished);
         ESP_LOGV(TAG, "uvc swap buffer length = %d", strmh->hold_bytes);
         xTaskNotifyGive(strmh->taskh);
         xSemaphoreGive(strmh->cb_mutex);
     } else {
         ESP_LOGD(TAG, "timeout drop frame = %"PRIu32"", strmh->seq);
+        s_usb_dev.stats.pub.uvc.drop_swap_timeout++;
+    }
+
+reset_:
+    strmh->seq++;
+    strmh->got_bytes = 0;
+    strmh->last_scr = 0;
+    strmh->pts = 0;
+    strmh->scr_us = 0;
+}
+
+/**
+ * @brief Wall-clock time of the capture start, from the esp_timer time of the frame
+ */
+static void _uvc_frame_wall_time(uvc_frame_t *frame)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    int64_t wall_us = (int64_t)now.tv_sec * 1000000 + now.tv_usec - (esp_timer_get_time() - frame->capture_us);
+    frame->capture_time.tv_sec = wall_us / 1000000;
+    frame->capture_time.tv_usec = wall_us % 1000000;
+}
+
+/**
+ * @brief Populate the fields of a frame to be handed to user code
+ * must be called with stream cb lock held!
+ *
+ * @return false if the frame should be skipped
+ */
+static bool _uvc_populate_frame(_uvc_stream_handle_t *strmh)
+{
+    bool zero_copy = s_usb_dev.flags & FLAG_UVC_FRAME_ZERO_COPY;
+    if (!zero_copy && strmh->hold_bytes > s_usb_dev.uvc_cfg.frame_buffer_size) {
+        ESP_LOGW(TAG, "Frame Buffer Overflow, framesize = %u", strmh->hold_bytes);
+        s_usb_dev.stats.pub.uvc.drop_frame_overflow++;
+        return false;
+    }
+
+    uvc_frame_t *frame = &strmh->frame;
+    frame->frame_format = strmh->frame_format;
+    frame->width = strmh->hold_width;
+    frame->height = strmh->hold_height;
+
+    frame->step = 0;
+    frame->sequence = strmh->hold_seq;
+    frame->capture_time_finished = strmh->capture_time_finished;
+    frame->capture_us = strmh->hold_capture_us;
+    _uvc_frame_wall_time(frame);
+    frame->data_bytes = strmh->hold_bytes;
+    if (zero_copy) {
+        /* lend holdbuf to user, until uvc_frame_release */
+        frame->data = strmh->holdbuf;
+        strmh->hold_borrowed = true;
+        return true;
+    }
+    usb_stream_memcpy(frame->data, strmh->holdbuf, frame->data_bytes);
+    return true;
+}
+
+/**
+ * @brief Populate the frame of pool slot to be handed to user code
+ *
+ * @return frame to user, NULL if the frame should be skipped
+ */
+static uvc_frame_t *_uvc_populate_pool_frame(_uvc_stream_handle_t *strmh, uint8_t slot)
+{
+    _uvc_frame_pool_t *pool = strmh->pool;
+    uvc_frame_t *frame = &pool->frame[slot];
+    frame->frame_format = strmh->frame_format;
+    frame->step = 0;
+    _uvc_frame_wall_time(frame);
+    if (s_usb_dev.flags & FLAG_UVC_FRAME_ZERO_COPY) {
+        /* lend slot to user, until uvc_frame_release */
+        return frame;
+    }
+    uvc_frame_t *user_frame = NULL;
+    if (frame->data_bytes > s_usb_dev.uvc_cfg.frame_buffer_size) {
+        ESP_LOGW(TAG, "Frame Buffer Overflow, framesize = %u", frame->data_bytes);
+        s_usb_dev.stats.pub.uvc.drop_frame_overflow++;
+    } else {
+        user_frame = &strmh->frame;
+        void *data = user_frame->data;
+        *user_frame = *frame;
+        user_frame->data = data;
+        usb_stream_memcpy(user_frame->data, pool->slot_buf[slot], frame->data_bytes);
+    }
+    _uvc_frame_pool_release(pool, slot);
+    return user_frame;
+}
+
+/**
+ * @brief Process each payload of uvc transfer
+ *
+ * @param strmh stream handle
+ * @param payload payload buffer
+ * @param payload_len payload buffer length
+ */
+/**
+ * @brief Cheap UVC payload header check, judge from header length and bit field
+ * For SCR, PTS, some vendors not set bit, but also offer 12 Bytes header. so we just check SET condition
+ */
+IRAM_ATTR static inline bool _uvc_header_valid(const uint8_t *payload, size_t payload_len)
+{
+    const uint8_t header_len = payload[0];
+    const uint8_t header_info = payload[1];
+    if (header_len > payload_len || (header_info & 0x30)) {
+        return false;
+    }
+#ifdef CONFIG_UVC_CHECK_HEADER_EOH
+    /* EOH bit, when set, indicates the end of the BFH fields
+     * Most camera set this bit to 1 in each header, but some vendors may not set it.
+     */
+    if (!(header_info & 0x80)) {
+        return false;
+    }
+#endif
+    switch (header_len) {
+    case 12:
+        return true;
+    case 6:
+        return !(header_info & 0x08);
+    case 2:
+        return !(header_info & 0x0C);
+    default:
+        return false;
+    }
+}
+
+IRAM_ATTR static void _uvc_bogus_packet(const uint8_t *payload, size_t payload_len)
+{
+    if (payload_len > 1) {
+#ifdef CONFIG_UVC_CHECK_HEADER_EOH
+        /* Give warning if EOH check enable, but camera not have*/
+        if (!(payload[1] & 0x80)) {
+            ESP_LOGD(TAG, "bogus packet: EOH bit not set");
+        }
+#endif
+        ESP_LOGD(TAG, "bogus packet: len = %u %02x %02x...%02x %02x\n", payload_len, payload[0], payload[1], payload[payload_len - 2], payload[payload_len - 1]);
+    }
+}
+
+/**
+ * @brief Handle FID/PTS/SCR fields of a valid header, return false if the ERR bit is set
+ */
+IRAM_ATTR static inline bool _uvc_process_header(_uvc_stream_handle_t *strmh, const uint8_t *payload)
+{
+    const uint8_t header_info = payload[1];
+    size_t variable_offset = 2;
+
+    /* ERR bit defined in Stream Header*/
+    if (header_info & 0x40) {
+        ESP_LOGW(TAG, "bad packet: error bit set");
+        return false;
+    }
+    if (strmh->fid != (header_info & 1) && strmh->got_bytes != 0) {
+        /* The frame ID bit was flipped, but we have image data sitting
+            around from prior transfers. This means the camera didn't send
+            an EOF for the last transfer of the previous frame. */
+#if CONFIG_UVC_DROP_NO_EOF_FRAME
+        ESP_LOGW(TAG, "DROP NO EOF, got data=%u B", strmh->got_bytes);
+        s_usb_dev.stats.pub.uvc.drop_no_eof++;
+        _uvc_drop_buffers(strmh);
+#else
+        _uvc_swap_buffers(strmh);
+#endif
+    }
+
+    if (strmh->fid != (header_info & 1)) {
+        strmh->frame_decided = false;
+    }
+    strmh->fid = header_info & 1;
+    if (header_info & (1 << 2)) {
+        strmh->pts = DW_TO_INT(payload + variable_offset);
+        variable_offset += 4;
+    }
+    if (header_info & (1 << 3)) {
+        strmh->last_scr = DW_TO_INT(payload + variable_offset);
+        if (strmh->scr_us == 0) {
+            strmh->scr_stc = strmh->last_scr;
+            strmh->scr_us = _uvc_scr_sof_time(payload[variable_offset + 4] | (payload[variable_offset + 5] << 8));
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Append frame data to the working buffer, return false if the frame overflowed
+ */
+IRAM_ATTR static inline bool _uvc_append_data(_uvc_stream_handle_t *strmh, const uint8_t *data, size_t data_len)
+{
+    if (!strmh->frame_decided) {
+        /* first data of a new frame, deliver 1 of every uvc_decimate frames, 0 for none */
+        strmh->frame_decided = true;
+        uint16_t every = s_usb_dev.uvc_decimate;
+        strmh->frame_skip = (every == 0 || ++strmh->decimate_cnt < every);
+        if (!strmh->frame_skip) {
+            strmh->decimate_cnt = 0;
+        } else {
+            strmh->seq++;
+            s_usb_dev.stats.pub.uvc.skipped++;
+        }
+    }
+    if (strmh->frame_skip) {
+        // not wanted, ignore the payload without copy
+        return true;
+    }
+    if (strmh->got_bytes + data_len > strmh->outbuf_size) {
+        /* This means transfer buffer Not enough for whole frame, just drop whole buffer here.
+        Please increase buffer size to handle big frame*/
+#if CONFIG_UVC_DROP_OVERFLOW_FRAME
+        ESP_LOGW(TAG, "Transfer buffer overflow, got data=%u B, last=%u", strmh->got_bytes + data_len, data_len);
+        s_usb_dev.stats.pub.uvc.drop_xfer_overflow++;
+        _uvc_drop_buffers(strmh);
+#else
+        _uvc_swap_buffers(strmh);
+#endif
+        return false;
     }
-
-    strmh->seq++;
-    strmh->got_bytes = 0;
-    strmh->last_scr = 0;
-    strmh->pts = 0;
+    if (strmh->got_bytes == 0) {
+        strmh->sof_us = esp_timer_get_time();
+    }
+    memcpy(strmh->outbuf + strmh->got_bytes, data, data_len);
+    _uvc_payload_notify(data, data_len, strmh->got_bytes == 0 ? UVC_PAYLOAD_FLAG_SOF : 0);
+    strmh->got_bytes += data_len;
+    return true;
 }
 
-/**
- * @brief Clean buffer without swap
- */
-IRAM_ATTR static void _uvc_drop_buffers(_uvc_stream_handle_t *strmh)
+IRAM_ATTR static inline void _uvc_check_eof(_uvc_stream_handle_t *strmh, uint8_t header_info)
 {
-    strmh->got_bytes = 0;
-    strmh->last_scr = 0;
-    strmh->pts = 0;
+#if CONFIG_UVC_CHECK_HEADER_EOF
+    if (header_info & (1 << 1)) {
+        strmh->frame_decided = false;
+        /* The EOF bit is set, so publish the complete frame */
+        if (strmh->got_bytes != 0) {
+            _uvc_swap_buffers(strmh);
+        }
+        strmh->reassembling = 0;
+    }
+#endif
 }
 
 /**
- * @brief Populate the fields of a frame to be handed to user code
- * must be called with stream cb lock held!
+ * @brief Payload path for isoc and non-reassembled bulk transfer: every packet starts with a header
  */
-void _uvc_populate_frame(_uvc_stream_handle_t *strmh)
+IRAM_ATTR static void _uvc_process_payload_packet(_uvc_stream_handle_t *strmh, size_t req_len, uint8_t *payload, size_t payload_len)
 {
-    if (strmh->hold_bytes > s_usb_dev.uvc_cfg.frame_buffer_size) {
-        ESP_LOGW(TAG, "Frame Buffer Overflow, framesize = %u", strmh->hold_bytes);
+    if (payload_len < 2) {
+        // ignore empty payload
         return;
     }
-
-    uvc_frame_t *frame = &strmh->frame;
-    frame->frame_format = strmh->frame_format;
-    frame->width = s_usb_dev.uvc->frame_width;
-    frame->height = s_usb_dev.uvc->frame_height;
-
-    frame->step = 0;
-    frame->sequence = strmh->hold_seq;
-    frame->capture_time_finished = strmh->capture_time_finished;
-    frame->data_bytes = strmh->hold_bytes;
-    memcpy(frame->data, strmh->holdbuf, frame->data_bytes);
+#ifdef CONFIG_UVC_PRINT_PAYLOAD_HEX
+    ESP_LOG_BUFFER_HEXDUMP("UVC_HEX", payload, payload_len, ESP_LOG_VERBOSE);
+#endif
+    if (!_uvc_header_valid(payload, payload_len)) {
+        _uvc_bogus_packet(payload, payload_len);
+        return;
+    }
+    const uint8_t header_len = payload[0];
+    const uint8_t header_info = payload[1];
+    if (!_uvc_process_header(strmh, payload)) {
+        return;
+    }
+    if (payload_len > header_len && !_uvc_append_data(strmh, payload + header_len, payload_len - header_len)) {
+        return;
+    }
+    _uvc_check_eof(strmh, header_info);
 }
 
 /**
- * @brief Process each payload of uvc transfer
+ * @brief Payload path for bulk transfer with reassembly
  *
- * @param strmh stream handle
- * @param payload payload buffer
- * @param payload_len payload buffer length
+ * One payload transfer spans several URBs, only the first one carries the header.
+ * A full URB means the transfer continues, a short packet or ZLP ends it,
+ * so continuation URBs skip the header check.
  */
-IRAM_ATTR static void _uvc_process_payload(_uvc_stream_handle_t *strmh, size_t req_len, uint8_t *payload, size_t payload_len)
-{
-    size_t header_len = 0;
-    size_t variable_offset = 0;
-    uint8_t header_info = 0;
-    size_t data_len = 0;
-    bool bulk_xfer = (s_usb_dev.uvc->vs_ifc->xfer_type == UVC_XFER_BULK) ? true : false;
-    bool reassemble = (strmh->reassemble_flag) ? true : false;
-    uint8_t flag_lstp = 0;
-    uint8_t flag_zlp = 0;
-    uint8_t flag_rsb = 0;
-
-    // analyze the payload handling logic depending on the transfer type
-    // and the reassembly flag
-    if (bulk_xfer && reassemble) {
-        if (payload_len == req_len) {
-            //payload transfer not complete
-            flag_rsb = 1;
-        } else if (payload_len == 0) {
-            //payload transfer complete with zero length packet
-            flag_zlp = 1;
-            ESP_LOGV(TAG, "payload_len == 0");
-        } else {
-            //payload transfer complete with short packet
-            flag_lstp = 1;
+IRAM_ATTR static void _uvc_process_payload_bulk_rsb(_uvc_stream_handle_t *strmh, size_t req_len, uint8_t *payload, size_t payload_len)
+{
+    const bool transfer_end = (payload_len < req_len);
+
+    if (payload_len == 0) {
+        //payload transfer complete with zero length packet
+        if (strmh->reassembling) {
+            strmh->reassembling = 0;
+            _uvc_check_eof(strmh, strmh->rsb_header_info);
         }
-    } else if (bulk_xfer && payload_len < req_len) {
-        flag_lstp = 1;
-    } else if (payload_len == 0) {
-        // ignore empty payload for isoc transfer
         return;
     }
-
 #ifdef CONFIG_UVC_PRINT_PAYLOAD_HEX
     ESP_LOG_BUFFER_HEXDUMP("UVC_HEX", payload, payload_len, ESP_LOG_VERBOSE);
 #endif
-    /********************* processing header *******************/
-    if (!flag_zlp) {
-        ESP_LOGV(TAG, "zlp=%d, lstp=%d, req_len=%d, payload_len=%d, first=0x%02x, second=0x%02x", flag_zlp, flag_lstp, req_len, payload_len, payload[0], payload_len > 1 ? payload[1] : 0);
-        // make sure this is a header, judge from header length and bit field
-        // For SCR, PTS, some vendors not set bit, but also offer 12 Bytes header. so we just check SET condition
-        if (payload_len >= payload[0]
-                && (payload[0] == 12 || (payload[0] == 2 && !(payload[1] & 0x0C)) || (payload[0] == 6 && !(payload[1] & 0x08)))
-                && !(payload[1] & 0x30)
-#ifdef CONFIG_UVC_CHECK_HEADER_EOH
-                /* EOH bit, when set, indicates the end of the BFH fields
-                 * Most camera set this bit to 1 in each header, but some vendors may not set it.
-                 */
-                && (payload[1] & 0x80)
-#endif
+    if (strmh->reassembling) {
+        if (!_uvc_append_data(strmh, payload, payload_len)) {
+            strmh->reassembling = 0;
+            return;
+        }
+    } else {
+        if (payload_len < 2 || !_uvc_header_valid(payload, payload_len)
 #ifdef CONFIG_UVC_CHECK_BULK_JPEG_HEADER
-                && (!reassemble || ((payload[payload[0]] == 0xff) && (payload[payload[0] + 1] == 0xd8)))
+                || payload_len < (size_t)payload[0] + 2 || payload[payload[0]] != 0xff || payload[payload[0] + 1] != 0xd8
 #endif
            ) {
-            header_len = payload[0];
-            data_len = payload_len - header_len;
-            /* checking the end-of-header */
-            variable_offset = 2;
-            header_info = payload[1];
-
-            ESP_LOGV(TAG, "header=%u info=0x%02x, payload_len = %u, last_pts = %"PRIu32" , last_scr = %"PRIu32"", header_len, header_info, payload_len, strmh->pts, strmh->last_scr);
-            if (flag_rsb) {
-                ESP_LOGV(TAG, "reassembling start ...");
-                strmh->reassembling = 1;
-            }
-            /* ERR bit defined in Stream Header*/
-            if (header_info & 0x40) {
-                ESP_LOGW(TAG, "bad packet: error bit set");
-                strmh->reassembling = 0;
-                return;
-            }
-        } else if (strmh->reassembling) {
-            ESP_LOGV(TAG, "reassembling %u + %u", strmh->got_bytes, payload_len);
-            data_len = payload_len;
-        } else {
-            if (payload_len > 1) {
-#ifdef CONFIG_UVC_CHECK_HEADER_EOH
-                /* Give warning if EOH check enable, but camera not have*/
-                if (!(payload[1] & 0x80)) {
-                    ESP_LOGD(TAG, "bogus packet: EOH bit not set");
-                }
-#endif
-                ESP_LOGD(TAG, "bogus packet: len = %u %02x %02x...%02x %02x\n", payload_len, payload[0], payload[1], payload[payload_len - 2], payload[payload_len - 1]);
-            }
+            _uvc_bogus_packet(payload, payload_len);
             return;
         }
-    }
-
-    if (header_len >= 2) {
-        if (strmh->fid != (header_info & 1) && strmh->got_bytes != 0) {
-            /* The frame ID bit was flipped, but we have image data sitting
-                around from prior transfers. This means the camera didn't send
-                an EOF for the last transfer of the previous frame. */
-#if CONFIG_UVC_DROP_NO_EOF_FRAME
-            ESP_LOGW(TAG, "DROP NO EOF, got data=%u B", strmh->got_bytes);
-            _uvc_drop_buffers(strmh);
-#else
-            ESP_LOGD(TAG, "SWAP NO EOF %d", strmh->got_bytes);
-            _uvc_swap_buffers(strmh);
-#endif
-        }
-
-        strmh->fid = header_info & 1;
-        if (header_info & (1 << 2)) {
-            strmh->pts = DW_TO_INT(payload + variable_offset);
-            variable_offset += 4;
-        }
-
-        if (header_info & (1 << 3)) {
-            strmh->last_scr = DW_TO_INT(payload + variable_offset);
-            variable_offset += 6;
+        const uint8_t header_len = payload[0];
+        if (!_uvc_process_header(strmh, payload)) {
+            strmh->reassembling = 0;
+            return;
         }
-    }
-
-    /********************* processing data *****************/
-    if (data_len >= 1) {
-        if (strmh->got_bytes + data_len > s_usb_dev.uvc_cfg.xfer_buffer_size) {
-            /* This means transfer buffer Not enough for whole frame, just drop whole buffer here.
-            Please increase buffer size to handle big frame*/
-#if CONFIG_UVC_DROP_OVERFLOW_FRAME
-            ESP_LOGW(TAG, "Transfer buffer overflow, got data=%u B, last=%u (%02x %02x...%02x %02x)", strmh->got_bytes + data_len, data_len
-                     , payload[0], payload_len > 1 ? payload[1] : 0, payload_len > 1 ? payload[payload_len - 2] : 0, payload_len > 1 ? payload[payload_len - 1] : 0);
-            _uvc_drop_buffers(strmh);
-#else
-            ESP_LOGD(TAG, "SWAP overflow %d", strmh->got_bytes);
-            _uvc_swap_buffers(strmh);
-#endif
+        // EOF in the header applies to the end of this payload transfer
+        strmh->rsb_header_info = payload[1];
+        strmh->reassembling = !transfer_end;
+        if (payload_len > header_len && !_uvc_append_data(strmh, payload + header_len, payload_len - header_len)) {
             strmh->reassembling = 0;
             return;
-        } else {
-            if (payload_len > 1) {
-                ESP_LOGV(TAG, "uvc payload = %02x %02x...%02x %02x\n", payload[header_len], payload[header_len + 1], payload[payload_len - 2], payload[payload_len - 1]);
-            }
-            memcpy(strmh->outbuf + strmh->got_bytes, payload + header_len, data_len);
         }
-
-        strmh->got_bytes += data_len;
     }
-
-    if (flag_lstp || flag_zlp) {
+    if (transfer_end) {
         strmh->reassembling = 0;
+        _uvc_check_eof(strmh, strmh->rsb_header_info);
     }
+}
 
-#if CONFIG_UVC_CHECK_HEADER_EOF
-    if (header_info & (1 << 1)) {
-        /* The EOF bit is set, so publish the complete frame */
-        if (strmh->got_bytes != 0) {
-            _uvc_swap_buffers(strmh);
-        }
-        strmh->reassembling = 0;
+/**
+ * @brief Select the payload path once the transfer type and reassembly mode are known
+ */
+static void _uvc_payload_path_select(_uvc_stream_handle_t *strmh)
+{
+    if (s_usb_dev.uvc->vs_ifc->xfer_type == UVC_XFER_BULK && strmh->reassemble_flag) {
+        strmh->process_payload = _uvc_process_payload_bulk_rsb;
+    } else {
+        strmh->process_payload = _uvc_process_payload_packet;
     }
-#endif
+    strmh->reassembling = 0;
+    strmh->frame_decided = false;
 }
 
 /**
@@ -2215,10 +3105,27 @@ static uvc_error_t uvc_stream_open_ctrl(uvc_device_handle_t *devh, _uvc_stream_h
     strmh->frame.library_owns_data = 1;
     strmh->cur_ctrl = *ctrl;
     strmh->running = 0;
-    strmh->outbuf = s_usb_dev.uvc_cfg.xfer_buffer_a;
-    strmh->holdbuf = s_usb_dev.uvc_cfg.xfer_buffer_b;
     strmh->frame.data = s_usb_dev.uvc_cfg.frame_buffer;
     strmh->frame_format = s_usb_dev.uvc->frame_format;
+    strmh->width = s_usb_dev.uvc->frame_width;
+    strmh->height = s_usb_dev.uvc->frame_height;
+    strmh->out_slot = UVC_FRAME_POOL_SLOT_NONE;
+    _uvc_payload_path_select(strmh);
+    if (s_usb_dev.uvc_cfg.frame_pool_num) {
+        strmh->pool = &s_usb_dev.uvc->frame_pool;
+        strmh->out_slot = _uvc_frame_pool_acquire(strmh->pool);
+        if (strmh->out_slot == UVC_FRAME_POOL_SLOT_NONE) {
+            ESP_LOGE(TAG, "line-%u No free frame pool slot", __LINE__);
+            ret = UVC_ERROR_NO_MEM;
+            goto fail_;
+        }
+        strmh->outbuf = strmh->pool->slot_buf[strmh->out_slot];
+        strmh->outbuf_size = strmh->pool->slot_size;
+    } else {
+        strmh->outbuf = s_usb_dev.uvc_cfg.xfer_buffer_a;
+        strmh->holdbuf = s_usb_dev.uvc_cfg.xfer_buffer_b;
+        strmh->outbuf_size = s_usb_dev.uvc_cfg.xfer_buffer_size;
+    }
 
     strmh->cb_mutex = xSemaphoreCreateMutex();
 
@@ -2234,6 +3141,9 @@ static uvc_error_t uvc_stream_open_ctrl(uvc_device_handle_t *devh, _uvc_stream_h
 fail_:
 
     if (strmh) {
+        if (strmh->out_slot != UVC_FRAME_POOL_SLOT_NONE) {
+            _uvc_frame_pool_release(strmh->pool, strmh->out_slot);
+        }
         free(strmh);
     }
 
@@ -2262,12 +3172,13 @@ static uvc_error_t uvc_stream_start(_uvc_stream_handle_t *strmh, uvc_frame_callb
     strmh->fid = 0;
     strmh->pts = 0;
     strmh->last_scr = 0;
+    strmh->scr_us = 0;
     strmh->user_cb = cb;
     strmh->user_ptr = user_ptr;
 
     if (cb && strmh->taskh == NULL) {
-        xTaskCreatePinnedToCore(_sample_processing_task, SAMPLE_PROC_TASK_NAME, SAMPLE_PROC_TASK_STACK_SIZE, (void *)strmh,
-                                SAMPLE_PROC_TASK_PRIORITY, &strmh->taskh, SAMPLE_PROC_TASK_CORE);
+        xTaskCreatePinnedToCore(_sample_processing_task, SAMPLE_PROC_TASK_NAME, s_task_cfg.sample_proc.stack_size, (void *)strmh,
+                                s_task_cfg.sample_proc.priority, &strmh->taskh, _task_core(s_task_cfg.sample_proc.core_id));
         UVC_CHECK(strmh->taskh != NULL, "sample task create failed", UVC_ERROR_OTHER);
         ESP_LOGD(TAG, "Sample processing task created");
     }
@@ -2289,6 +3200,11 @@ static uvc_error_t uvc_stream_stop(_uvc_stream_handle_t *strmh)
     }
     strmh->running = 0;
     xTaskNotifyGive(strmh->taskh);
+    if (strmh->pool) {
+        // wakeup sample task waiting on ready queue
+        uint8_t slot = UVC_FRAME_POOL_SLOT_NONE;
+        xQueueSend(strmh->pool->ready_queue, &slot, 0);
+    }
     xEventGroupWaitBits(s_usb_dev.event_group_hdl, UVC_SAMPLE_PROC_STOP_DONE, pdTRUE, pdFALSE, portMAX_DELAY);
     strmh->taskh = NULL;
     vTaskDelay(pdMS_TO_TICKS(WAITING_TASK_RESOURCE_RELEASE_MS));
@@ -2305,12 +3221,23 @@ static uvc_error_t uvc_stream_stop(_uvc_stream_handle_t *strmh)
  */
 static void uvc_stream_close(_uvc_stream_handle_t *strmh)
 {
+    if (strmh->pool) {
+        // give back slots not handed to user
+        uint8_t slot = UVC_FRAME_POOL_SLOT_NONE;
+        while (xQueueReceive(strmh->pool->ready_queue, &slot, 0) == pdTRUE) {
+            if (slot != UVC_FRAME_POOL_SLOT_NONE) {
+                _uvc_frame_pool_release(strmh->pool, slot);
+            }
+        }
+        _uvc_frame_pool_release(strmh->pool, strmh->out_slot);
+    }
     vSemaphoreDelete(strmh->cb_mutex);
     free(strmh);
     return;
 }
 
 /****************************************************** Task Code ******************************************************/
+#ifndef CONFIG_USB_STREAM_UVC_ONLY
 IRAM_ATTR static size_t _ring_buffer_get_len(RingbufHandle_t ringbuf_hdl)
 {
     if (ringbuf_hdl == NULL) {
@@ -2337,6 +3264,30 @@ IRAM_ATTR static void _ring_buffer_flush(RingbufHandle_t ringbuf_hdl)
     ESP_LOGD(TAG, "buffer %u, flush -%u", uxItemsWaiting, read_bytes);
 }
 
+/**
+ * @brief Return all waiting items of a no-split ring, items held by user are kept
+ */
+static void _ring_buffer_flush_items(RingbufHandle_t ringbuf_hdl)
+{
+    if (ringbuf_hdl == NULL) {
+        return;
+    }
+    size_t item_size = 0;
+    void *item = NULL;
+    while ((item = xRingbufferReceive(ringbuf_hdl, &item_size, 0)) != NULL) {
+        vRingbufferReturnItem(ringbuf_hdl, item);
+    }
+}
+
+static void _uac_mic_ring_flush(_uac_device_t *uac_dev)
+{
+    if (s_usb_dev.flags & FLAG_UAC_MIC_ZERO_COPY) {
+        _ring_buffer_flush_items(uac_dev->ringbuf_hdl[UAC_MIC]);
+    } else {
+        _ring_buffer_flush(uac_dev->ringbuf_hdl[UAC_MIC]);
+    }
+}
+
 IRAM_ATTR static esp_err_t _ring_buffer_push(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t write_bytes, TickType_t xTicksToWait)
 {
     if (ringbuf_hdl == NULL) {
@@ -2386,22 +3337,39 @@ IRAM_ATTR static void _processing_mic_pipe(hcd_pipe_handle_t pipe_hdl, mic_callb
         ESP_LOGD(TAG, "mic urb dequeue error");
         return;
     }
+    _usb_stats_urb_done(STREAM_UAC_MIC, urb_done);
 
     size_t xfered_size = 0;
+    uint16_t lost = 0;
+    uint8_t *span_item = NULL;
+    RingbufHandle_t mic_ring = s_usb_dev.uac->ringbuf_hdl[UAC_MIC];
+    const bool zero_copy = (s_usb_dev.flags & FLAG_UAC_MIC_ZERO_COPY) && mic_ring;
+    if (zero_copy) {
+        // receive packets into the ring item directly
+        if (xRingbufferSendAcquire(mic_ring, (void **)&span_item, sizeof(_uac_mic_span_hdr_t) + s_usb_dev.uac->mic_frame_buf_size, 0) != pdTRUE) {
+            span_item = NULL;
+            s_usb_dev.stats.pub.pipe[STREAM_UAC_MIC].ring_full++;
+        }
+    }
     mic_frame_t mic_frame = {
         .bit_resolution = s_usb_dev.uac->bit_resolution[UAC_MIC],
         .samples_frequence = s_usb_dev.uac->samples_frequence[UAC_MIC],
-        .data = s_usb_dev.uac->mic_frame_buf,
+        .data = span_item ? span_item + sizeof(_uac_mic_span_hdr_t) : s_usb_dev.uac->mic_frame_buf,
     };
 
     for (size_t i = 0; i < urb_done->transfer.num_isoc_packets; i++) {
         if (urb_done->transfer.isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
             ESP_LOGW(TAG, "line:%u bad iso transit status %d", __LINE__, urb_done->transfer.isoc_packet_desc[i].status);
+            s_usb_dev.stats.pub.pipe[STREAM_UAC_MIC].packet_err++;
+            lost++;
             continue;
         } else {
             int actual_num_bytes = urb_done->transfer.isoc_packet_desc[i].actual_num_bytes;
             int num_bytes = urb_done->transfer.isoc_packet_desc[i].num_bytes;
             uint8_t *packet_buffer = urb_done->transfer.data_buffer + (i * num_bytes);
+            if (actual_num_bytes != s_usb_dev.uac->mic_ms_bytes) {
+                lost++;
+            }
 #if UAC_MIC_PACKET_COMPENSATION
             int num_bytes_ms = s_usb_dev.uac->mic_ms_bytes;
             if (actual_num_bytes != num_bytes_ms) {
@@ -2429,10 +3397,11 @@ IRAM_ATTR static void _processing_mic_pipe(hcd_pipe_handle_t pipe_hdl, mic_callb
     ESP_LOGV(TAG, "MIC RC %d", xfered_size);
     ESP_LOGV(TAG, "mic payload = %02x %02x...%02x %02x\n", urb_done->transfer.data_buffer[0], urb_done->transfer.data_buffer[1], urb_done->transfer.data_buffer[xfered_size - 2], urb_done->transfer.data_buffer[xfered_size - 1]);
 
-    if (s_usb_dev.uac->ringbuf_hdl[UAC_MIC]) {
-        esp_err_t ret = _ring_buffer_push(s_usb_dev.uac->ringbuf_hdl[UAC_MIC], mic_frame.data, mic_frame.data_bytes, 0);
+    if (mic_ring && !zero_copy) {
+        esp_err_t ret = _ring_buffer_push(mic_ring, mic_frame.data, mic_frame.data_bytes, 0);
         if (ret != ESP_OK) {
             ESP_LOGV(TAG, "mic ringbuf too small, please pop in time");
+            s_usb_dev.stats.pub.pipe[STREAM_UAC_MIC].ring_full++;
         }
     }
 
@@ -2440,13 +3409,108 @@ IRAM_ATTR static void _processing_mic_pipe(hcd_pipe_handle_t pipe_hdl, mic_callb
         user_cb(&mic_frame, user_ptr);
     }
 
+    uint32_t span_seq = s_usb_dev.uac->mic_span_seq++;
+    if (span_item) {
+        // packets are 1 ms each, the first one was received packets - 1 frames ago
+        uint16_t packets = urb_done->transfer.num_isoc_packets;
+        _uac_mic_span_hdr_t hdr = {
+            .seq = span_seq,
+            .data_bytes = xfered_size,
+            .timestamp_us = esp_timer_get_time() - (int64_t)packets * 1000,
+            .frame_num = (uint16_t)(_usb_frame_num() - (packets - 1)) & 0x7FF,
+            .packets = packets,
+            .lost = lost,
+        };
+        memcpy(span_item, &hdr, sizeof(hdr));
+        xRingbufferSendComplete(mic_ring, span_item);
+    }
+
     if (enqueue_flag) {
+        _usb_stats_urb_stamp(urb_done);
         esp_err_t ret = hcd_urb_enqueue(pipe_hdl, urb_done);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "MIC urb enqueue failed %s", esp_err_to_name(ret));
+            s_usb_dev.stats.pub.pipe[STREAM_UAC_MIC].enqueue_fail++;
+        }
+    }
+}
+
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+/**
+ * @brief Pop exactly len bytes from the byte ring, which may take two reads at the wrap point
+ */
+static size_t _ring_buffer_pop_exact(RingbufHandle_t ringbuf_hdl, uint8_t *buf, size_t len)
+{
+    size_t got = 0;
+    while (got < len) {
+        size_t read_bytes = 0;
+        if (_ring_buffer_pop(ringbuf_hdl, buf + got, len - got, &read_bytes, 0) != ESP_OK || read_bytes == 0) {
+            break;
+        }
+        got += read_bytes;
+    }
+    return got;
+}
+
+/**
+ * @brief Fill one speaker transfer from the jitter buffer, called once per completed urb,
+ * so the buffer is drained at the USB SOF rate
+ *
+ * @return bytes to send, always urb_ms of audio
+ */
+static size_t _uac_spk_jitter_pop(uint8_t *buffer)
+{
+    _uac_device_t *uac = s_usb_dev.uac;
+    RingbufHandle_t ring = uac->ringbuf_hdl[UAC_SPK];
+    const size_t ms_bytes = uac->as_ifc[UAC_SPK]->bytes_per_packet;
+    const size_t sample_bytes = uac->ch_num[UAC_SPK] * uac->bit_resolution[UAC_SPK] / 8;
+    const size_t urb_ms = uac->spk_jb.urb_ms > uac->as_ifc[UAC_SPK]->packets_per_urb ? uac->as_ifc[UAC_SPK]->packets_per_urb : uac->spk_jb.urb_ms;
+    const size_t urb_bytes = urb_ms * ms_bytes;
+    const int32_t target = uac->spk_jb.target_ms * ms_bytes;
+    int32_t level = _ring_buffer_get_len(ring);
+
+    if (!uac->spk_jb.playing) {
+        if (level < target) {
+            // prefilling, keep the isoc stream alive with silence
+            memset(buffer, 0, urb_bytes);
+            return urb_bytes;
+        }
+        uac->spk_jb.playing = true;
+        uac->spk_jb.level_avg = level;
+    }
+    uac->spk_jb.level_avg += (level - uac->spk_jb.level_avg) / 16;
+    s_usb_dev.stats.pub.uac_spk.level_ms = uac->spk_jb.level_avg / ms_bytes;
+
+    size_t want = urb_bytes;
+    int drift = 0;
+    if (sample_bytes && uac->spk_jb.level_avg > target + (int32_t)ms_bytes) {
+        // writer faster than SOF clock, consume one more sample
+        drift = 1;
+    } else if (sample_bytes && uac->spk_jb.level_avg + (int32_t)ms_bytes < target) {
+        // writer slower, repeat the last sample
+        drift = -1;
+        want -= sample_bytes;
+    }
+    size_t got = _ring_buffer_pop_exact(ring, buffer, want);
+    if (got < want) {
+        // underrun, pad silence and prefill again
+        memset(buffer + got, 0, urb_bytes - got);
+        uac->spk_jb.playing = false;
+        s_usb_dev.stats.pub.uac_spk.underrun++;
+        return urb_bytes;
+    }
+    if (drift > 0) {
+        uint8_t scratch[8];
+        if (_ring_buffer_pop_exact(ring, scratch, sample_bytes > sizeof(scratch) ? sizeof(scratch) : sample_bytes)) {
+            s_usb_dev.stats.pub.uac_spk.drift_drop++;
         }
+    } else if (drift < 0) {
+        memcpy(buffer + want, buffer + want - sample_bytes, sample_bytes);
+        s_usb_dev.stats.pub.uac_spk.drift_insert++;
     }
+    return urb_bytes;
 }
+#endif
 
 IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_dequeue, bool reset)
 {
@@ -2458,6 +3522,9 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
     if (reset) {
         pending_urb_num = 0;
         zero_counter = 0;
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+        s_usb_dev.uac->spk_jb.playing = false;
+#endif
         for (size_t j = 0; j < NUM_ISOC_SPK_URBS; j++) {
             pending_urb[j] = NULL;
         }
@@ -2480,9 +3547,11 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
             ESP_LOGD(TAG, "spk urb dequeue error");
             return;
         }
+        _usb_stats_urb_done(STREAM_UAC_SPK, urb_done);
         for (size_t i = 0; i < urb_done->transfer.num_isoc_packets; i++) {
             if (urb_done->transfer.isoc_packet_desc[i].status != USB_TRANSFER_STATUS_COMPLETED) {
                 ESP_LOGW(TAG, "line:%u bad iso transit status %d", __LINE__, urb_done->transfer.isoc_packet_desc[i].status);
+                s_usb_dev.stats.pub.pipe[STREAM_UAC_SPK].packet_err++;
                 break;
             } else {
                 xfered_size += urb_done->transfer.isoc_packet_desc[i].actual_num_bytes;
@@ -2499,6 +3568,7 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
             }
         }
     }
+#ifndef CONFIG_UAC_SPK_JITTER_BUFFER
     /* check if we have buffered data need to send */
     if (_ring_buffer_get_len(s_usb_dev.uac->ringbuf_hdl[UAC_SPK]) < s_usb_dev.uac->as_ifc[UAC_SPK]->bytes_per_packet) {
 #if (!UAC_SPK_PACKET_COMPENSATION)
@@ -2508,6 +3578,7 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
     } else {
         zero_counter = 0;
     }
+#endif
 
     /* fetch a pending urb from list */
     urb_t *next_urb = NULL;
@@ -2523,6 +3594,11 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
     size_t num_bytes_to_send = 0;
     size_t buffer_size = s_usb_dev.uac->spk_max_xfer_size;
     uint8_t *buffer = next_urb->transfer.data_buffer;
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+    (void)buffer_size;
+    (void)zero_counter;
+    num_bytes_to_send = _uac_spk_jitter_pop(buffer);
+#else
     ret = _ring_buffer_pop(s_usb_dev.uac->ringbuf_hdl[UAC_SPK], buffer, buffer_size, &num_bytes_to_send, 0);
     if (ret != ESP_OK || num_bytes_to_send == 0) {
 #if (!UAC_SPK_PACKET_COMPENSATION)
@@ -2542,6 +3618,7 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
         }
 #endif
     }
+#endif
 
     if (num_bytes_to_send == 0) {
         return;
@@ -2562,9 +3639,11 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
         next_urb->transfer.isoc_packet_desc[transfer_dummy->num_isoc_packets - 1].num_bytes = last_packet_bytes;
     }
 
+    _usb_stats_urb_stamp(next_urb);
     ret = hcd_urb_enqueue(pipe_hdl, next_urb);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "SPK urb enqueue failed %s", esp_err_to_name(ret));
+        s_usb_dev.stats.pub.pipe[STREAM_UAC_SPK].enqueue_fail++;
         return;
     }
 
@@ -2575,6 +3654,14 @@ IRAM_ATTR static void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_d
     ESP_LOGV(TAG, "spk payload = %02x %02x...%02x %02x\n", buffer[0], buffer[1], buffer[num_bytes_send - 2], buffer[num_bytes_send - 1]);
 }
 
+#else
+/* UVC-only build: the UAC streams are never enabled, the shared task code keeps its call sites */
+static inline void _ring_buffer_flush(RingbufHandle_t ringbuf_hdl) {}
+static inline void _uac_mic_ring_flush(_uac_device_t *uac_dev) {}
+static inline void _processing_mic_pipe(hcd_pipe_handle_t pipe_hdl, mic_callback_t user_cb, void *user_ptr, bool if_enqueue) {}
+static inline void _processing_spk_pipe(hcd_pipe_handle_t pipe_hdl, bool if_dequeue, bool reset) {}
+#endif // CONFIG_USB_STREAM_UVC_ONLY
+
 static esp_err_t _event_set_bits_wait_cleared(EventGroupHandle_t evt_group, EventBits_t bits, TickType_t timeout)
 {
     xEventGroupSetBits(evt_group, bits);
@@ -2639,30 +3726,167 @@ static esp_err_t _usb_streaming_suspend(usb_stream_t stream)
     return ret;
 }
 
-static esp_err_t _uvc_streaming_resume(void)
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+static inline bool _usb_enum_cache_match(void)
+{
+    return s_enum_cache.config_desc && memcmp(&s_enum_cache.dev_id, &s_usb_dev.dev_id, sizeof(_usb_dev_id_t)) == 0;
+}
+
+/**
+ * @brief Parse the cached config descriptor if the device is known
+ *
+ * @return true if the config descriptor requests can be skipped
+ */
+static bool _usb_enum_cache_load(const usb_device_desc_t *dev_desc)
+{
+    s_usb_dev.dev_id.vid = dev_desc->idVendor;
+    s_usb_dev.dev_id.pid = dev_desc->idProduct;
+    s_usb_dev.dev_id.bcd_device = dev_desc->bcdDevice;
+    if (!_usb_enum_cache_match()) {
+        return false;
+    }
+    if (_update_config_from_descriptor((const usb_config_desc_t *)s_enum_cache.config_desc) != ESP_OK) {
+        ESP_LOGW(TAG, "Cached config descriptor not matched, get from device");
+        return false;
+    }
+    ESP_LOGI(TAG, "Device %04x:%04x known, config descriptor from cache", s_usb_dev.dev_id.vid, s_usb_dev.dev_id.pid);
+    return true;
+}
+
+static void _usb_enum_cache_save(const usb_config_desc_t *cfg_desc)
+{
+    if (!_usb_enum_cache_match()) {
+        s_enum_cache.ctrl_valid = false;
+    }
+    if (s_enum_cache.config_desc_len != cfg_desc->wTotalLength) {
+        uint8_t *buf = heap_caps_realloc(s_enum_cache.config_desc, cfg_desc->wTotalLength, MALLOC_CAP_DEFAULT);
+        if (buf == NULL) {
+            ESP_LOGW(TAG, "No memory to cache config descriptor");
+            return;
+        }
+        s_enum_cache.config_desc = buf;
+        s_enum_cache.config_desc_len = cfg_desc->wTotalLength;
+    }
+    memcpy(s_enum_cache.config_desc, cfg_desc, cfg_desc->wTotalLength);
+    s_enum_cache.dev_id = s_usb_dev.dev_id;
+}
+
+static inline bool _uvc_ctrl_same_request(const uvc_stream_ctrl_t *a, const uvc_stream_ctrl_t *b)
+{
+    return a->bFormatIndex == b->bFormatIndex && a->bFrameIndex == b->bFrameIndex
+           && a->dwFrameInterval == b->dwFrameInterval && a->dwMaxVideoFrameSize == b->dwMaxVideoFrameSize
+           && a->dwMaxPayloadTransferSize == b->dwMaxPayloadTransferSize
+           && a->bmHint == b->bmHint && a->wCompQuality == b->wCompQuality && a->wCompWindowSize == b->wCompWindowSize;
+}
+
+/**
+ * @brief Get the cached probe result of the same request from the same device
+ */
+static bool _uvc_ctrl_cache_get(const uvc_stream_ctrl_t *ctrl_set, uvc_stream_ctrl_t *ctrl_probed)
+{
+    if (!s_enum_cache.ctrl_valid || !_usb_enum_cache_match() || !_uvc_ctrl_same_request(ctrl_set, &s_enum_cache.ctrl_set)) {
+        return false;
+    }
+    *ctrl_probed = s_enum_cache.ctrl_probed;
+    ESP_LOGI(TAG, "Probe result from cache, commit directly");
+    return true;
+}
+
+static void _uvc_ctrl_cache_set(const uvc_stream_ctrl_t *ctrl_set, const uvc_stream_ctrl_t *ctrl_probed)
+{
+    if (!_usb_enum_cache_match()) {
+        return;
+    }
+    s_enum_cache.ctrl_set = *ctrl_set;
+    s_enum_cache.ctrl_probed = *ctrl_probed;
+    s_enum_cache.ctrl_valid = true;
+}
+#endif
+
+/**
+ * @brief UVC probe and commit with the current format, frame and interval
+ */
+static esp_err_t _uvc_streaming_negotiate(uvc_stream_ctrl_t *ctrl_probed)
 {
     _uvc_device_t *uvc_dev = s_usb_dev.uvc;
     uvc_stream_ctrl_t ctrl_set = (uvc_stream_ctrl_t)DEFAULT_UVC_STREAM_CTRL();
-    uvc_stream_ctrl_t ctrl_probed = {0};
     uvc_frame_size_t frame_size = {0};
     /* UVC negotiation process */
     UVC_ENTER_CRITICAL();
     ctrl_set.bFormatIndex = uvc_dev->format_index;
     ctrl_set.bFrameIndex = uvc_dev->frame_index;
     ctrl_set.dwFrameInterval = uvc_dev->frame_interval;
-    ctrl_set.dwMaxVideoFrameSize = s_usb_dev.uvc_cfg.frame_buffer_size;
-    /* For bulk transfer, payload size config by NUM_BULK_BYTES_PER_URB for better performance */
-    ctrl_set.dwMaxPayloadTransferSize = (uvc_dev->vs_ifc->xfer_type == UVC_XFER_BULK) ? NUM_BULK_BYTES_PER_URB : (uvc_dev->vs_ifc->ep_mps);
+    ctrl_set.dwMaxVideoFrameSize = (s_usb_dev.flags & FLAG_UVC_FRAME_ZERO_COPY) ? s_usb_dev.uvc_cfg.xfer_buffer_size : s_usb_dev.uvc_cfg.frame_buffer_size;
+    /* For bulk transfer, payload size config by NUM_BULK_BYTES_PER_URB (or the adaptive upper bound) for better performance */
+#ifdef CONFIG_UVC_BULK_URB_ADAPTIVE
+    ctrl_set.dwMaxPayloadTransferSize = (uvc_dev->vs_ifc->xfer_type == UVC_XFER_BULK) ? UVC_BULK_URB_BYTES_MAX : USB_EP_MPS_TOTAL(uvc_dev->vs_ifc->ep_mps);
+#else
+    ctrl_set.dwMaxPayloadTransferSize = (uvc_dev->vs_ifc->xfer_type == UVC_XFER_BULK) ? NUM_BULK_BYTES_PER_URB : USB_EP_MPS_TOTAL(uvc_dev->vs_ifc->ep_mps);
+#endif
+    if (uvc_dev->comp_quality) {
+        ctrl_set.bmHint |= UVC_PROBE_HINT_COMP_QUALITY;
+        ctrl_set.wCompQuality = uvc_dev->comp_quality;
+    }
+    if (uvc_dev->comp_window) {
+        ctrl_set.bmHint |= UVC_PROBE_HINT_COMP_WINDOW;
+        ctrl_set.wCompWindowSize = uvc_dev->comp_window;
+    }
     frame_size.width = uvc_dev->frame_width;
     frame_size.height = uvc_dev->frame_height;
     UVC_EXIT_CRITICAL();
     ESP_LOGI(TAG, "Probe Format(%u), Frame(%u) %u*%u, interval(%"PRIu32")", ctrl_set.bFormatIndex,
              ctrl_set.bFrameIndex, frame_size.width, frame_size.height, ctrl_set.dwFrameInterval);
+    if (ctrl_set.bmHint & (UVC_PROBE_HINT_COMP_QUALITY | UVC_PROBE_HINT_COMP_WINDOW)) {
+        ESP_LOGI(TAG, "Probe quality = %u, window = %u", ctrl_set.wCompQuality, ctrl_set.wCompWindowSize);
+    }
     ESP_LOGI(TAG, "Probe payload size = %"PRIu32, ctrl_set.dwMaxPayloadTransferSize);
-    esp_err_t ret = _uvc_vs_commit_control(&ctrl_set, &ctrl_probed);
+    esp_err_t ret = ESP_FAIL;
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+    if (_uvc_ctrl_cache_get(&ctrl_set, ctrl_probed)) {
+        ret = _uvc_vs_commit_control(&ctrl_set, ctrl_probed, false);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Commit cached probe result failed, negotiate again");
+            s_enum_cache.ctrl_valid = false;
+        }
+    }
+    if (ret != ESP_OK) {
+        ret = _uvc_vs_commit_control(&ctrl_set, ctrl_probed, true);
+        UVC_CHECK(ESP_OK == ret, "UVC negotiate failed", ESP_FAIL);
+        _uvc_ctrl_cache_set(&ctrl_set, ctrl_probed);
+    }
+#else
+    ret = _uvc_vs_commit_control(&ctrl_set, ctrl_probed, true);
+    UVC_CHECK(ESP_OK == ret, "UVC negotiate failed", ESP_FAIL);
+#endif
+    if (ctrl_set.dwMaxPayloadTransferSize != ctrl_probed->dwMaxPayloadTransferSize) {
+        ESP_LOGI(TAG, "dwMaxPayloadTransferSize set = %" PRIu32 ", probed = %" PRIu32, ctrl_set.dwMaxPayloadTransferSize, ctrl_probed->dwMaxPayloadTransferSize);
+    }
+    if (ctrl_set.wCompQuality && ctrl_set.wCompQuality != ctrl_probed->wCompQuality) {
+        ESP_LOGW(TAG, "wCompQuality set = %u, probed = %u", ctrl_set.wCompQuality, ctrl_probed->wCompQuality);
+    }
+    UVC_ENTER_CRITICAL();
+    uvc_dev->comp.quality = ctrl_probed->wCompQuality;
+    uvc_dev->comp.window = ctrl_probed->wCompWindowSize;
+    uvc_dev->comp.max_frame_size = ctrl_probed->dwMaxVideoFrameSize;
+    UVC_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+static esp_err_t _uvc_streaming_resume(void)
+{
+    _uvc_device_t *uvc_dev = s_usb_dev.uvc;
+    uvc_stream_ctrl_t ctrl_probed = {0};
+    esp_err_t ret = _uvc_streaming_negotiate(&ctrl_probed);
     UVC_CHECK(ESP_OK == ret, "UVC negotiate failed", ESP_FAIL);
-    if (ctrl_set.dwMaxPayloadTransferSize != ctrl_probed.dwMaxPayloadTransferSize) {
-        ESP_LOGI(TAG, "dwMaxPayloadTransferSize set = %" PRIu32 ", probed = %" PRIu32, ctrl_set.dwMaxPayloadTransferSize, ctrl_probed.dwMaxPayloadTransferSize);
+    if (s_usb_dev.uvc_cfg.frame_pool_num) {
+        /* slot size from probed max frame size, xfer_buffer_size as upper limit */
+        size_t slot_size = ctrl_probed.dwMaxVideoFrameSize;
+        if (slot_size == 0 || slot_size > s_usb_dev.uvc_cfg.xfer_buffer_size || (s_usb_dev.flags & FLAG_UVC_FRAME_POOL_MAX_SLOT)) {
+            slot_size = s_usb_dev.uvc_cfg.xfer_buffer_size;
+        }
+        ESP_LOGI(TAG, "dwMaxVideoFrameSize probed = %" PRIu32 ", frame pool slot size = %u", ctrl_probed.dwMaxVideoFrameSize, slot_size);
+        ret = _uvc_frame_pool_alloc(&uvc_dev->frame_pool, s_usb_dev.uvc_cfg.frame_pool_num, slot_size);
+        UVC_CHECK(ESP_OK == ret, "frame pool alloc failed", ret);
     }
     /* start uvc streaming */
     uvc_error_t uvc_ret = UVC_SUCCESS;
@@ -2851,8 +4075,10 @@ static void _usb_stream_handle_task(void *arg)
                         p_itf->urb_list = NULL;
                         ESP_LOGD(TAG, "%s stream suspend: free urb list succeed", p_itf->name);
                     }
-                    if (stream == STREAM_UAC_SPK || stream == STREAM_UAC_MIC) {
-                        _ring_buffer_flush(uac_dev->ringbuf_hdl[stream == STREAM_UAC_SPK ? UAC_SPK : UAC_MIC]);
+                    if (stream == STREAM_UAC_SPK) {
+                        _ring_buffer_flush(uac_dev->ringbuf_hdl[UAC_SPK]);
+                    } else if (stream == STREAM_UAC_MIC) {
+                        _uac_mic_ring_flush(uac_dev);
                     }
                     ack_bits = USB_STREAM_TASK_PROC_SUCCEED;
                     xEventGroupClearBits(usb_dev->event_group_hdl, p_itf->evt_bit);
@@ -2865,15 +4091,23 @@ static void _usb_stream_handle_task(void *arg)
                         UVC_CHECK_GOTO(ret == ESP_OK, "stream resume: apply config", _feedback_result);
                     }
                     if (p_itf->type == STREAM_UVC && p_itf->xfer_type == UVC_XFER_BULK) {
+                        uint32_t bytes_per_urb = 0, urb_num = 0;
+                        _uvc_bulk_urb_calc(uvc_dev->uvc_stream_hdl, &bytes_per_urb, &urb_num);
+                        if (p_itf->urb_list && (bytes_per_urb != p_itf->bytes_per_packet || urb_num != p_itf->urb_num)) {
+                            _usb_urb_list_free(p_itf->urb_list, p_itf->urb_num);
+                            p_itf->urb_list = NULL;
+                        }
+                        p_itf->bytes_per_packet = bytes_per_urb;
+                        p_itf->urb_num = urb_num;
+                        ESP_LOGD(TAG, "UVC bulk urb: %"PRIu32" x %"PRIu32" bytes", p_itf->urb_num, p_itf->bytes_per_packet);
                         uvc_dev->uvc_stream_hdl->reassemble_flag = 0;
-                        if (uvc_dev->uvc_stream_hdl->cur_ctrl.dwMaxPayloadTransferSize < p_itf->bytes_per_packet) {
-                            p_itf->bytes_per_packet = uvc_dev->uvc_stream_hdl->cur_ctrl.dwMaxPayloadTransferSize;
-                        } else if (uvc_dev->uvc_stream_hdl->cur_ctrl.dwMaxPayloadTransferSize > p_itf->bytes_per_packet) {
+                        if (uvc_dev->uvc_stream_hdl->cur_ctrl.dwMaxPayloadTransferSize > p_itf->bytes_per_packet) {
                             // in most case, the payload size is very large in bulk transfer (one sample or part of sample),
                             // to save memory, we transfer with smaller size, and reassemble payload.
                             uvc_dev->uvc_stream_hdl->reassemble_flag = 1;
                             ESP_LOGD(TAG, "UVC Bulk Packet Reassemble Enable");
                         }
+                        _uvc_payload_path_select(uvc_dev->uvc_stream_hdl);
                     }
                     if (p_itf->urb_list == NULL && p_itf->xfer_type == UVC_XFER_BULK) {
                         p_itf->urb_list = _usb_urb_list_alloc(p_itf->urb_num, 0, p_itf->bytes_per_packet);
@@ -2896,6 +4130,9 @@ static void _usb_stream_handle_task(void *arg)
                     }
                     ret = _usb_pipe_clear(p_itf->pipe_handle, p_itf->urb_num);
                     UVC_CHECK_GOTO(ret == ESP_OK, "stream resume: clear pipe, failed", _feedback_result);
+                    for (int j = 0; j < p_itf->urb_num; j++) {
+                        _usb_stats_urb_stamp(p_itf->urb_list[j]);
+                    }
                     ret = _usb_urb_list_enqueue(p_itf->pipe_handle, p_itf->urb_list, p_itf->urb_num);
                     UVC_CHECK_GOTO(ret == ESP_OK, "stream resume: enqueue transfer, failed", _feedback_result);
                     ack_bits = USB_STREAM_TASK_PROC_SUCCEED;
@@ -2911,6 +4148,7 @@ _feedback_result:
             case PIPE_EVENT: {
                 usb_stream_t stream = (usb_stream_t)hcd_pipe_get_context(evt_msg._handle.pipe_handle);
                 _pipe_event_dflt_process(evt_msg._handle.pipe_handle, usb_dev->ifc[stream]->name, evt_msg._event.pipe_event);
+                usb_stream_pipe_stats_t *pipe_stats = &usb_dev->stats.pub.pipe[stream];
                 switch (evt_msg._event.pipe_event) {
                 case HCD_PIPE_EVENT_URB_DONE:
                     if (stream == STREAM_UAC_MIC) {
@@ -2928,11 +4166,19 @@ _feedback_result:
                     }
                     break;
                 case HCD_PIPE_EVENT_ERROR_OVERFLOW:
+                    pipe_stats->overflow++;
+                    goto _usb_stream_recover;
+                    break;
                 case HCD_PIPE_EVENT_ERROR_URB_NOT_AVAIL:
+                    pipe_stats->urb_not_avail++;
+                    goto _usb_stream_recover;
+                    break;
                 case HCD_PIPE_EVENT_ERROR_XFER:
+                    pipe_stats->xfer_err++;
                     goto _usb_stream_recover;
                     break;
                 case HCD_PIPE_EVENT_ERROR_STALL: {
+                    pipe_stats->stall++;
                     _event_msg_t evt_msg = {
                         ._type = USER_EVENT,
                         ._event.user_cmd = STREAM_SUSPEND,
@@ -2983,7 +4229,7 @@ _usb_stream_recover:
         }
         if (uac_dev != NULL) {
             _ring_buffer_flush(uac_dev->ringbuf_hdl[UAC_SPK]);
-            _ring_buffer_flush(uac_dev->ringbuf_hdl[UAC_MIC]);
+            _uac_mic_ring_flush(uac_dev);
         }
         xEventGroupClearBits(usb_dev->event_group_hdl, USB_UVC_STREAM_RUNNING | UAC_SPK_STREAM_RUNNING | UAC_MIC_STREAM_RUNNING);
         if (usb_dev->state_cb) {
@@ -3103,13 +4349,17 @@ static esp_err_t _uvc_uac_device_enum(bool abort_process, bool *waiting_urb_done
     case ENUM_STAGE_START: {
         if (!usb_dev->dflt_pipe_hdl) {
             ESP_ERROR_CHECK(_usb_port_get_speed(usb_dev->port_hdl, &(usb_dev->dev_speed)));
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+            ESP_LOGI(TAG, "USB Speed: %s-speed", usb_dev->dev_speed == USB_SPEED_HIGH ? "high" : (usb_dev->dev_speed == USB_SPEED_FULL ? "full" : "low"));
+#else
             ESP_LOGI(TAG, "USB Speed: %s-speed", usb_dev->dev_speed == USB_SPEED_FULL ? "full" : "low");
+#endif
             xSemaphoreTake(usb_dev->xfer_mutex_hdl, portMAX_DELAY);
             usb_dev->dflt_pipe_hdl = _usb_pipe_init(usb_dev->port_hdl, NULL, 0, usb_dev->dev_speed,
                                                     (void *)usb_dev->queue_hdl, &_usb_pipe_callback, (void *)usb_dev->queue_hdl);
             xSemaphoreGive(usb_dev->xfer_mutex_hdl);
             UVC_CHECK_GOTO(usb_dev->dflt_pipe_hdl != NULL, "default pipe create failed", stage_failed_);
-            usb_dev->ep_mps = usb_dev->dev_speed == USB_SPEED_FULL ? USB_EP0_FS_DEFAULT_MPS : USB_EP0_LS_DEFAULT_MPS;
+            usb_dev->ep_mps = usb_dev->dev_speed == USB_SPEED_LOW ? USB_EP0_LS_DEFAULT_MPS : USB_EP0_FS_DEFAULT_MPS;
         }
         //else malloc a new one for enum stage
         if (enum_transfer == NULL) {
@@ -3168,6 +4418,12 @@ static esp_err_t _uvc_uac_device_enum(bool abort_process, bool *waiting_urb_done
     case ENUM_STAGE_CHECK_FULL_DEV_DESC: {
         usb_device_desc_t *dev_desc = (usb_device_desc_t *)(enum_done->transfer.data_buffer + sizeof(usb_setup_packet_t));
         print_device_descriptor((const uint8_t *)dev_desc);
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+        if (_usb_enum_cache_load(dev_desc)) {
+            // skip the config descriptor requests, next stage is SET_CONFIG
+            usb_dev->enum_stage = ENUM_STAGE_CHECK_FULL_CONFIG_DESC;
+        }
+#endif
         break;
     }
     case ENUM_STAGE_GET_SHORT_CONFIG_DESC: {
@@ -3192,6 +4448,9 @@ static esp_err_t _uvc_uac_device_enum(bool abort_process, bool *waiting_urb_done
         usb_config_desc_t *cfg_desc = (usb_config_desc_t *)(enum_done->transfer.data_buffer + sizeof(usb_setup_packet_t));
         ret = _update_config_from_descriptor(cfg_desc);
         UVC_CHECK_GOTO(ret == ESP_OK, "Descriptor Parse Result: No matching configurations", stage_failed_);
+#ifdef CONFIG_USB_STREAM_FAST_RECONNECT
+        _usb_enum_cache_save(cfg_desc);
+#endif
         break;
     }
     case ENUM_STAGE_SET_CONFIG: {
@@ -3497,6 +4756,35 @@ free_task_:
 }
 
 /*populate frame then call user callback*/
+static inline void _uvc_stats_frame_delivered(size_t data_bytes)
+{
+    s_usb_dev.stats.frame_bytes += data_bytes;
+    s_usb_dev.stats.pub.uvc.frames++;
+}
+
+static void _uvc_views_deliver(uvc_frame_t *frame)
+{
+    _uvc_view_t views[CONFIG_UVC_VIEW_MAX_NUM];
+    size_t num = 0;
+    UVC_ENTER_CRITICAL();
+    for (size_t i = 0; i < CONFIG_UVC_VIEW_MAX_NUM; i++) {
+        _uvc_view_t *view = &s_uvc_views[i];
+        if (view->cb == NULL || (view->every_n > 1 && (view->cnt++ % view->every_n) != 0)) {
+            continue;
+        }
+        // keep the snapshot sorted by priority, higher first
+        size_t j = num++;
+        for (; j > 0 && views[j - 1].priority < view->priority; j--) {
+            views[j] = views[j - 1];
+        }
+        views[j] = *view;
+    }
+    UVC_EXIT_CRITICAL();
+    for (size_t i = 0; i < num; i++) {
+        views[i].cb(frame, views[i].cb_arg);
+    }
+}
+
 static void _sample_processing_task(void *arg)
 {
     UVC_CHECK_RETURN_VOID(arg != NULL, "sample task arg should be _uvc_stream_handle_t *");
@@ -3506,6 +4794,27 @@ static void _sample_processing_task(void *arg)
 
     xEventGroupClearBits(s_usb_dev.event_group_hdl, UVC_SAMPLE_PROC_STOP_DONE);
     do {
+        if (strmh->pool) {
+            uint8_t slot = UVC_FRAME_POOL_SLOT_NONE;
+            xQueueReceive(strmh->pool->ready_queue, &slot, portMAX_DELAY);
+            if (!strmh->running) {
+                if (slot != UVC_FRAME_POOL_SLOT_NONE) {
+                    _uvc_frame_pool_release(strmh->pool, slot);
+                }
+                ESP_LOGI(TAG, "sample processing stop");
+                break;
+            }
+            if (slot == UVC_FRAME_POOL_SLOT_NONE) {
+                continue;
+            }
+            uvc_frame_t *frame = _uvc_populate_pool_frame(strmh, slot);
+            if (frame) {
+                _uvc_views_deliver(frame);
+                strmh->user_cb(frame, strmh->user_ptr);
+                _uvc_stats_frame_delivered(frame->data_bytes);
+            }
+            continue;
+        }
         xSemaphoreTake(strmh->cb_mutex, portMAX_DELAY);
 
         while (strmh->running && last_seq == strmh->hold_seq) {
@@ -3522,11 +4831,15 @@ static void _sample_processing_task(void *arg)
         }
 
         last_seq = strmh->hold_seq;
-        _uvc_populate_frame(strmh);
+        bool populated = _uvc_populate_frame(strmh);
         xSemaphoreGive(strmh->cb_mutex);
-        //user callback for decode and display,
+        if (!populated) {
+            continue;
+        }
+        //user callback for decode and display, views first as the frame may be released by user_cb
+        _uvc_views_deliver(&strmh->frame);
         strmh->user_cb(&strmh->frame, strmh->user_ptr);
-        /* code */
+        _uvc_stats_frame_delivered(strmh->frame.data_bytes);
     } while (1);
 
     ESP_LOGI(TAG, "Sample processing task deleted");
@@ -3535,6 +4848,22 @@ static void _sample_processing_task(void *arg)
     vTaskDelete(NULL);
 }
 
+/**
+ * @brief Send transfer suspend/resume command to stream task and wait for the result
+ */
+static esp_err_t _usb_stream_task_request(usb_stream_t stream, _user_cmd_t cmd)
+{
+    _event_msg_t event_msg = {
+        ._type = USER_EVENT,
+        ._event_data = (void *)stream,
+        ._event.user_cmd = cmd,
+    };
+    xEventGroupClearBits(s_usb_dev.event_group_hdl, USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED);
+    xQueueSend(s_usb_dev.stream_queue_hdl, &event_msg, portMAX_DELAY);
+    EventBits_t uxBits = xEventGroupWaitBits(s_usb_dev.event_group_hdl, (USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED), pdTRUE, pdFALSE, pdMS_TO_TICKS(TIMEOUT_USER_COMMAND_MS));
+    return (uxBits & USB_STREAM_TASK_PROC_SUCCEED) ? ESP_OK : ESP_FAIL;
+}
+
 static esp_err_t usb_stream_control(usb_stream_t stream, stream_ctrl_t ctrl_type)
 {
     UVC_CHECK(ctrl_type == CTRL_SUSPEND || ctrl_type == CTRL_RESUME, "USB Device not active", ESP_ERR_INVALID_ARG);
@@ -3552,11 +4881,6 @@ static esp_err_t usb_stream_control(usb_stream_t stream, stream_ctrl_t ctrl_type
     }
     esp_err_t ret = ESP_OK;
     _stream_ifc_t *p_itf = s_usb_dev.ifc[stream];
-    _event_msg_t event_msg = {
-        ._type = USER_EVENT,
-        ._event_data = (void *)stream,
-        ._event.user_cmd = STREAM_SUSPEND,
-    };
 
     if (ctrl_type == CTRL_RESUME) {
         //check if streaming is not running
@@ -3566,22 +4890,16 @@ static esp_err_t usb_stream_control(usb_stream_t stream, stream_ctrl_t ctrl_type
         ret = _usb_streaming_resume(stream);
         UVC_CHECK(ret == ESP_OK, "Resume interface Failed", ESP_FAIL);
         //send resume command to resume transfer
-        event_msg._event.user_cmd = STREAM_RESUME;
-        xEventGroupClearBits(s_usb_dev.event_group_hdl, USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED);
-        xQueueSend(s_usb_dev.stream_queue_hdl, &event_msg, portMAX_DELAY);
-        EventBits_t uxBits = xEventGroupWaitBits(s_usb_dev.event_group_hdl, (USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED), pdTRUE, pdFALSE, pdMS_TO_TICKS(TIMEOUT_USER_COMMAND_MS));
-        UVC_CHECK(uxBits & (USB_STREAM_TASK_PROC_SUCCEED), "Reset transfer failed/timeout", ESP_FAIL);
+        ret = _usb_stream_task_request(stream, STREAM_RESUME);
+        UVC_CHECK(ret == ESP_OK, "Reset transfer failed/timeout", ESP_FAIL);
         ESP_LOGD(TAG, "Resume %s streaming Done", p_itf->name);
     } else if (ctrl_type == CTRL_SUSPEND) {
         //check if streaming is running
         UVC_CHECK((xEventGroupGetBits(s_usb_dev.event_group_hdl) & p_itf->evt_bit), "Streaming not running", ESP_ERR_INVALID_STATE);
         ESP_LOGI(TAG, "Suspend %s streaming", p_itf->name);
         //send suspend command to stop transfer first
-        event_msg._event.user_cmd = STREAM_SUSPEND;
-        xEventGroupClearBits(s_usb_dev.event_group_hdl, USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED);
-        xQueueSend(s_usb_dev.stream_queue_hdl, &event_msg, portMAX_DELAY);
-        EventBits_t uxBits = xEventGroupWaitBits(s_usb_dev.event_group_hdl, (USB_STREAM_TASK_PROC_SUCCEED | USB_STREAM_TASK_PROC_FAILED), pdTRUE, pdFALSE, pdMS_TO_TICKS(TIMEOUT_USER_COMMAND_MS));
-        UVC_CHECK(uxBits & (USB_STREAM_TASK_PROC_SUCCEED), "Reset transfer failed/timeout", ESP_FAIL);
+        ret = _usb_stream_task_request(stream, STREAM_SUSPEND);
+        UVC_CHECK(ret == ESP_OK, "Reset transfer failed/timeout", ESP_FAIL);
         //suspend streaming interface
         ret = _usb_streaming_suspend(stream);
         UVC_CHECK(ret == ESP_OK, "Resume interface Failed", ESP_FAIL);
@@ -3590,6 +4908,7 @@ static esp_err_t usb_stream_control(usb_stream_t stream, stream_ctrl_t ctrl_type
     return ESP_OK;
 }
 
+#ifndef CONFIG_USB_STREAM_UVC_ONLY
 static esp_err_t uac_feature_control(usb_stream_t stream, stream_ctrl_t ctrl_type, void *ctrl_value)
 {
     _stream_ifc_t *p_itf = s_usb_dev.ifc[stream];
@@ -3703,6 +5022,8 @@ esp_err_t uac_streaming_config(const uac_config_t *config)
     return ESP_OK;
 }
 
+#endif // CONFIG_USB_STREAM_UVC_ONLY
+
 esp_err_t uvc_streaming_config(const uvc_config_t *config)
 {
     UVC_CHECK(s_usb_dev.event_group_hdl == NULL, "usb streaming is running", ESP_ERR_INVALID_STATE);
@@ -3713,11 +5034,19 @@ esp_err_t uvc_streaming_config(const uvc_config_t *config)
     UVC_CHECK(config->format < UVC_FORMAT_MAX, "format can't larger than UVC_FORMAT_MAX", ESP_ERR_INVALID_ARG);
     UVC_CHECK(config->frame_height != 0, "frame_height can't 0", ESP_ERR_INVALID_ARG);
     UVC_CHECK(config->frame_width != 0, "frame_width can't 0", ESP_ERR_INVALID_ARG);
-    UVC_CHECK(config->frame_buffer_size != 0, "frame_buffer_size can't 0", ESP_ERR_INVALID_ARG);
     UVC_CHECK(config->xfer_buffer_size != 0, "xfer_buffer_size can't 0", ESP_ERR_INVALID_ARG);
-    UVC_CHECK(config->xfer_buffer_a != NULL, "xfer_buffer_a can't NULL", ESP_ERR_INVALID_ARG);
-    UVC_CHECK(config->xfer_buffer_b != NULL, "xfer_buffer_b can't NULL", ESP_ERR_INVALID_ARG);
-    UVC_CHECK(config->frame_buffer != NULL, "frame_buffer can't NULL", ESP_ERR_INVALID_ARG);
+    if (config->frame_pool_num) {
+        //xfer_buffer_a/b not used in frame pool mode, slots are allocated by driver
+        UVC_CHECK(config->frame_pool_num >= 2 && config->frame_pool_num <= UVC_FRAME_POOL_MAX_NUM, "frame_pool_num Support 2~UVC_FRAME_POOL_MAX_NUM", ESP_ERR_INVALID_ARG);
+    } else {
+        UVC_CHECK(config->xfer_buffer_a != NULL, "xfer_buffer_a can't NULL", ESP_ERR_INVALID_ARG);
+        UVC_CHECK(config->xfer_buffer_b != NULL, "xfer_buffer_b can't NULL", ESP_ERR_INVALID_ARG);
+    }
+    if (!(config->flags & FLAG_UVC_FRAME_ZERO_COPY)) {
+        //frame_buffer not used in zero-copy mode, frame data point to xfer buffer directly
+        UVC_CHECK(config->frame_buffer_size != 0, "frame_buffer_size can't 0", ESP_ERR_INVALID_ARG);
+        UVC_CHECK(config->frame_buffer != NULL, "frame_buffer can't NULL", ESP_ERR_INVALID_ARG);
+    }
 #ifndef CONFIG_UVC_GET_CONFIG_DESC
     //Additional check for quick start mode
     UVC_CHECK(config->interface, "interface can't 0", ESP_ERR_INVALID_ARG);
@@ -3731,7 +5060,13 @@ esp_err_t uvc_streaming_config(const uvc_config_t *config)
     if (config->interface) {
         UVC_CHECK(config->ep_addr & 0x80, "Endpoint direction must IN", ESP_ERR_INVALID_ARG);
         if (config->xfer_type == UVC_XFER_ISOC) {
+#ifdef CONFIG_USB_STREAM_HS_PROFILE
+            // Port speed is unknown here, full speed devices are clamped in _apply_pipe_config()
+            UVC_CHECK(USB_EP_MPS_SIZE(config->ep_mps) <= USB_EP_ISOC_HS_MAX_MPS && USB_EP_MPS_MULT(config->ep_mps) <= USB_EP_ISOC_HS_MAX_MULT,
+                      "Isoc MPS must <= USB_EP_ISOC_HS_MAX_MPS x USB_EP_ISOC_HS_MAX_MULT", ESP_ERR_INVALID_ARG);
+#else
             UVC_CHECK(config->ep_mps <= USB_EP_ISOC_IN_MAX_MPS, "Isoc total MPS must < USB_EP_ISOC_IN_MAX_MPS", ESP_ERR_INVALID_ARG);
+#endif
             UVC_CHECK(config->interface_alt != 0, "Isoc interface alt num must > 0", ESP_ERR_INVALID_ARG);
         } else {
             UVC_CHECK(config->interface_alt == 0, "Bulk interface alt num must == 0", ESP_ERR_INVALID_ARG);
@@ -3740,9 +5075,16 @@ esp_err_t uvc_streaming_config(const uvc_config_t *config)
     }
     s_usb_dev.uvc_cfg = *config;
     s_usb_dev.flags |= config->flags;
+    s_usb_dev.uvc_decimate = 1;
     if (s_usb_dev.flags & FLAG_UVC_SUSPEND_AFTER_START) {
         ESP_LOGI(TAG, "UVC Streaming Suspend After Start");
     }
+    if (s_usb_dev.flags & FLAG_UVC_FRAME_ZERO_COPY) {
+        ESP_LOGI(TAG, "UVC Frame Zero-Copy Enabled");
+    }
+    if (config->frame_pool_num) {
+        ESP_LOGI(TAG, "UVC Frame Pool Enabled, slot num = %u", config->frame_pool_num);
+    }
     ESP_LOGI(TAG, "UVC Streaming Config Succeed, Version: %d.%d.%d", USB_STREAM_VER_MAJOR, USB_STREAM_VER_MINOR, USB_STREAM_VER_PATCH);
 #ifdef CONFIG_USB_STREAM_QUICK_START
     // Please make sure your camera can skip the enumeration stage and start streaming directly
@@ -3791,6 +5133,10 @@ esp_err_t usb_streaming_start()
             ESP_LOGD(TAG, "Speaker ringbuf create succeed, size = %"PRIu32, s_usb_dev.uac_cfg.spk_buf_size);
             UVC_CHECK_GOTO(s_usb_dev.uac->ringbuf_hdl[UAC_SPK] != NULL, "Create speak buffer failed", free_resource_);
         }
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+        s_usb_dev.uac->spk_jb.target_ms = CONFIG_UAC_SPK_JITTER_TARGET_MS;
+        s_usb_dev.uac->spk_jb.urb_ms = CONFIG_UAC_SPK_JITTER_URB_MS;
+#endif
         ESP_LOGD(TAG, "Speaker instance created");
         s_usb_dev.enabled[STREAM_UAC_SPK] = true;
     }
@@ -3807,7 +5153,9 @@ esp_err_t usb_streaming_start()
         s_usb_dev.ifc[STREAM_UAC_MIC]->name = "MIC";
         s_usb_dev.ifc[STREAM_UAC_MIC]->evt_bit = UAC_MIC_STREAM_RUNNING;
         if (s_usb_dev.uac_cfg.mic_buf_size) {
-            s_usb_dev.uac->ringbuf_hdl[UAC_MIC] = xRingbufferCreate(s_usb_dev.uac_cfg.mic_buf_size, RINGBUF_TYPE_BYTEBUF);
+            // zero-copy: one item per urb, read in place with uac_mic_streaming_acquire
+            s_usb_dev.uac->ringbuf_hdl[UAC_MIC] = xRingbufferCreate(s_usb_dev.uac_cfg.mic_buf_size,
+                                                                     (s_usb_dev.flags & FLAG_UAC_MIC_ZERO_COPY) ? RINGBUF_TYPE_NOSPLIT : RINGBUF_TYPE_BYTEBUF);
             ESP_LOGD(TAG, "MIC ringbuf create succeed, size = %"PRIu32, s_usb_dev.uac_cfg.mic_buf_size);
             UVC_CHECK_GOTO(s_usb_dev.uac->ringbuf_hdl[UAC_MIC] != NULL, "Create speak buffer failed", free_resource_);
         }
@@ -3832,14 +5180,14 @@ esp_err_t usb_streaming_start()
     }
     UVC_CHECK_GOTO(s_usb_dev.enabled[STREAM_UAC_MIC] == true || s_usb_dev.enabled[STREAM_UAC_SPK] == true || s_usb_dev.enabled[STREAM_UVC] == true, "uac/uvc streaming not configured", free_resource_);
 
-    TaskHandle_t usbh_taskh = NULL;
-    xTaskCreatePinnedToCore(_usb_processing_task, USB_PROC_TASK_NAME, USB_PROC_TASK_STACK_SIZE, NULL,
-                            USB_PROC_TASK_PRIORITY, &usbh_taskh, USB_PROC_TASK_CORE);
-    UVC_CHECK_GOTO(usbh_taskh != NULL, "Create usb processing task failed", free_resource_);
-    xTaskCreatePinnedToCore(_usb_stream_handle_task, USB_STREAM_NAME, USB_STREAM_STACK_SIZE, NULL,
-                            USB_STREAM_PRIORITY, &s_usb_dev.stream_task_hdl, USB_STREAM_CORE);
+    // USB interrupt is allocated by hcd_install in usb_proc, so it runs on the usb_proc core
+    xTaskCreatePinnedToCore(_usb_processing_task, USB_PROC_TASK_NAME, s_task_cfg.usb_proc.stack_size, NULL,
+                            s_task_cfg.usb_proc.priority, &s_usb_dev.usb_task_hdl, _task_core(s_task_cfg.usb_proc.core_id));
+    UVC_CHECK_GOTO(s_usb_dev.usb_task_hdl != NULL, "Create usb processing task failed", free_resource_);
+    xTaskCreatePinnedToCore(_usb_stream_handle_task, USB_STREAM_NAME, s_task_cfg.stream_proc.stack_size, NULL,
+                            s_task_cfg.stream_proc.priority, &s_usb_dev.stream_task_hdl, _task_core(s_task_cfg.stream_proc.core_id));
     assert(s_usb_dev.stream_task_hdl != NULL); //can not handle this error, just assert
-    xTaskNotifyGive(usbh_taskh);
+    xTaskNotifyGive(s_usb_dev.usb_task_hdl);
     xEventGroupWaitBits(s_usb_dev.event_group_hdl, USB_HOST_INIT_DONE, pdFALSE, pdFALSE, portMAX_DELAY);
     ESP_LOGI(TAG, "USB Streaming Start Succeed");
     return ESP_OK;
@@ -3952,6 +5300,7 @@ esp_err_t usb_streaming_stop(void)
             free(s_usb_dev.uvc->frame_size);
 #endif
         }
+        _uvc_frame_pool_free(&s_usb_dev.uvc->frame_pool);
         if (s_usb_dev.uvc->vs_ifc) {
             free(s_usb_dev.uvc->vs_ifc);
         }
@@ -4006,7 +5355,11 @@ esp_err_t usb_streaming_control(usb_stream_t stream, stream_ctrl_t ctrl_type, vo
         break;
     case CTRL_UAC_MUTE:
     case CTRL_UAC_VOLUME:
+#ifndef CONFIG_USB_STREAM_UVC_ONLY
         ret = uac_feature_control(stream, ctrl_type, ctrl_value);
+#else
+        ret = ESP_ERR_NOT_SUPPORTED;
+#endif
         break;
     default:
         break;
@@ -4017,6 +5370,7 @@ esp_err_t usb_streaming_control(usb_stream_t stream, stream_ctrl_t ctrl_type, vo
     return ret;
 }
 
+#ifndef CONFIG_USB_STREAM_UVC_ONLY
 esp_err_t uac_spk_streaming_write(void *data, size_t data_bytes, size_t timeout_ms)
 {
     UVC_CHECK(data, "data is NULL", ESP_ERR_INVALID_ARG);
@@ -4054,6 +5408,24 @@ esp_err_t uac_spk_streaming_write(void *data, size_t data_bytes, size_t timeout_
     return ESP_OK;
 }
 
+esp_err_t uac_spk_jitter_config(uint16_t target_ms, uint8_t urb_ms)
+{
+#ifdef CONFIG_UAC_SPK_JITTER_BUFFER
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UAC_SPK], "spk stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(target_ms && urb_ms && urb_ms <= UAC_SPK_ST_MAX_MS_DEFAULT, "invalid jitter config", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.uac_cfg.spk_buf_size == 0 || !s_usb_dev.uac->as_ifc[UAC_SPK]
+              || s_usb_dev.uac_cfg.spk_buf_size >= (uint32_t)(target_ms + urb_ms) * s_usb_dev.uac->as_ifc[UAC_SPK]->bytes_per_packet,
+              "spk_buf_size too small for target", ESP_ERR_INVALID_SIZE);
+    // taken by the stream task at the next transfer
+    s_usb_dev.uac->spk_jb.urb_ms = urb_ms;
+    s_usb_dev.uac->spk_jb.target_ms = target_ms;
+    ESP_LOGI(TAG, "SPK jitter buffer target = %u ms, transfer = %u ms", target_ms, urb_ms);
+    return ESP_OK;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
 esp_err_t uac_mic_streaming_read(void *buf, size_t buf_size, size_t *data_bytes, size_t timeout_ms)
 {
     UVC_CHECK(buf, "buf is NULL", ESP_ERR_INVALID_ARG);
@@ -4061,6 +5433,7 @@ esp_err_t uac_mic_streaming_read(void *buf, size_t buf_size, size_t *data_bytes,
     UVC_CHECK(data_bytes, "data_bytes is NULL", ESP_ERR_INVALID_ARG);
     UVC_CHECK(s_usb_dev.enabled[STREAM_UAC_MIC], "mic stream not config", ESP_ERR_INVALID_STATE);
     UVC_CHECK(s_usb_dev.uac->ringbuf_hdl[UAC_MIC] != NULL, "mic ringbuf not created", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(!(s_usb_dev.flags & FLAG_UAC_MIC_ZERO_COPY), "mic zero-copy mode, use uac_mic_streaming_acquire", ESP_ERR_INVALID_STATE);
     UVC_CHECK(s_usb_dev.uac->as_ifc[UAC_MIC] && !s_usb_dev.uac->as_ifc[UAC_MIC]->not_found, "mic interface not found", ESP_ERR_NOT_FOUND);
 
     size_t remind_timeout = timeout_ms;
@@ -4092,6 +5465,39 @@ esp_err_t uac_mic_streaming_read(void *buf, size_t buf_size, size_t *data_bytes,
     return ESP_OK;
 }
 
+esp_err_t uac_mic_streaming_acquire(uac_mic_span_t *span, size_t timeout_ms)
+{
+    UVC_CHECK(span, "span is NULL", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UAC_MIC], "mic stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.flags & FLAG_UAC_MIC_ZERO_COPY, "mic zero-copy not enabled", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uac->ringbuf_hdl[UAC_MIC] != NULL, "mic ringbuf not created", ESP_ERR_INVALID_STATE);
+
+    size_t item_size = 0;
+    uint8_t *item = xRingbufferReceive(s_usb_dev.uac->ringbuf_hdl[UAC_MIC], &item_size, pdMS_TO_TICKS(timeout_ms));
+    if (item == NULL) {
+        ESP_LOGD(TAG, "acquire timeout: mic ringbuf empty");
+        return ESP_ERR_TIMEOUT;
+    }
+    _uac_mic_span_hdr_t hdr;
+    memcpy(&hdr, item, sizeof(hdr));
+    span->data = item + sizeof(_uac_mic_span_hdr_t);
+    span->data_bytes = hdr.data_bytes;
+    span->seq = hdr.seq;
+    span->timestamp_us = hdr.timestamp_us;
+    span->frame_num = hdr.frame_num;
+    span->packets = hdr.packets;
+    span->lost = hdr.lost;
+    return ESP_OK;
+}
+
+esp_err_t uac_mic_streaming_release(const uac_mic_span_t *span)
+{
+    UVC_CHECK(span && span->data, "span is NULL", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UAC_MIC] && s_usb_dev.uac->ringbuf_hdl[UAC_MIC] != NULL, "mic ringbuf not created", ESP_ERR_INVALID_STATE);
+    vRingbufferReturnItem(s_usb_dev.uac->ringbuf_hdl[UAC_MIC], (void *)(span->data - sizeof(_uac_mic_span_hdr_t)));
+    return ESP_OK;
+}
+
 esp_err_t uac_frame_size_list_get(usb_stream_t stream, uac_frame_size_t *frame_list, size_t *list_size, size_t *cur_index)
 {
     UVC_CHECK(stream == STREAM_UAC_SPK || stream == STREAM_UAC_MIC, "Invalid stream", ESP_ERR_INVALID_ARG);
@@ -4192,6 +5598,8 @@ esp_err_t uac_frame_size_reset(usb_stream_t stream, uint8_t ch_num, uint16_t bit
     return ESP_OK;
 }
 
+#endif // CONFIG_USB_STREAM_UVC_ONLY
+
 esp_err_t uvc_frame_size_list_get(uvc_frame_size_t *frame_list, size_t *list_size, size_t *cur_index)
 {
     UVC_CHECK(s_usb_dev.enabled[STREAM_UVC], "uvc stream not config", ESP_ERR_INVALID_STATE);
@@ -4217,19 +5625,129 @@ esp_err_t uvc_frame_size_list_get(uvc_frame_size_t *frame_list, size_t *list_siz
     return ESP_OK;
 }
 
-esp_err_t uvc_frame_size_reset(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval)
+/* bmControls bit + 1 of each selector, 0 if the selector has no bit (UVC 1.5 3.7.2.3, 3.7.2.5) */
+static const uint8_t s_ct_ctrl_bit[] = {
+    [UVC_CT_SCANNING_MODE_CONTROL] = 1, [UVC_CT_AE_MODE_CONTROL] = 2, [UVC_CT_AE_PRIORITY_CONTROL] = 3,
+    [UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL] = 4, [UVC_CT_EXPOSURE_TIME_RELATIVE_CONTROL] = 5,
+    [UVC_CT_FOCUS_ABSOLUTE_CONTROL] = 6, [UVC_CT_FOCUS_RELATIVE_CONTROL] = 7, [UVC_CT_IRIS_ABSOLUTE_CONTROL] = 8,
+    [UVC_CT_IRIS_RELATIVE_CONTROL] = 9, [UVC_CT_ZOOM_ABSOLUTE_CONTROL] = 10, [UVC_CT_ZOOM_RELATIVE_CONTROL] = 11,
+    [UVC_CT_PANTILT_ABSOLUTE_CONTROL] = 12, [UVC_CT_PANTILT_RELATIVE_CONTROL] = 13, [UVC_CT_ROLL_ABSOLUTE_CONTROL] = 14,
+    [UVC_CT_ROLL_RELATIVE_CONTROL] = 15, [UVC_CT_FOCUS_AUTO_CONTROL] = 18, [UVC_CT_PRIVACY_CONTROL] = 19,
+};
+
+static const uint8_t s_pu_ctrl_bit[] = {
+    [UVC_PU_BRIGHTNESS_CONTROL] = 1, [UVC_PU_CONTRAST_CONTROL] = 2, [UVC_PU_HUE_CONTROL] = 3,
+    [UVC_PU_SATURATION_CONTROL] = 4, [UVC_PU_SHARPNESS_CONTROL] = 5, [UVC_PU_GAMMA_CONTROL] = 6,
+    [UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL] = 7, [UVC_PU_WHITE_BALANCE_COMPONENT_CONTROL] = 8,
+    [UVC_PU_BACKLIGHT_COMPENSATION_CONTROL] = 9, [UVC_PU_GAIN_CONTROL] = 10, [UVC_PU_POWER_LINE_FREQUENCY_CONTROL] = 11,
+    [UVC_PU_HUE_AUTO_CONTROL] = 12, [UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL] = 13,
+    [UVC_PU_WHITE_BALANCE_COMPONENT_AUTO_CONTROL] = 14, [UVC_PU_DIGITAL_MULTIPLIER_CONTROL] = 15,
+    [UVC_PU_DIGITAL_MULTIPLIER_LIMIT_CONTROL] = 16, [UVC_PU_ANALOG_VIDEO_STANDARD_CONTROL] = 17,
+    [UVC_PU_ANALOG_LOCK_STATUS_CONTROL] = 18, [UVC_PU_CONTRAST_AUTO_CONTROL] = 19,
+};
+
+bool uvc_vc_control_supported(uvc_vc_unit_t unit, uint8_t selector)
 {
-    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC], "uvc stream not config", ESP_ERR_INVALID_STATE);
-    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
-    UVC_CHECK(s_usb_dev.uvc->vs_ifc && !s_usb_dev.uvc->vs_ifc->not_found, "uvc interface not found", ESP_ERR_INVALID_STATE);
-    UVC_CHECK(s_usb_dev.uvc->frame_size != NULL, "uvc frame size list not found", ESP_ERR_INVALID_STATE);
-    //Add a delay to avoid the situation that the device is not ready
-    vTaskDelay(pdMS_TO_TICKS(ACTIVE_DEBOUNCE_TIME_MS));
+    if (unit >= UVC_VC_UNIT_MAX || !s_usb_dev.uvc || _usb_device_get_state() != STATE_DEVICE_ACTIVE) {
+        return false;
+    }
+    const uint8_t *bits = unit == UVC_VC_CAMERA_TERMINAL ? s_ct_ctrl_bit : s_pu_ctrl_bit;
+    size_t num = unit == UVC_VC_CAMERA_TERMINAL ? sizeof(s_ct_ctrl_bit) : sizeof(s_pu_ctrl_bit);
+    if (selector >= num || bits[selector] == 0) {
+        return false;
+    }
+    UVC_ENTER_CRITICAL();
+    bool supported = s_usb_dev.uvc->vc_unit_id[unit] && (s_usb_dev.uvc->vc_controls[unit] & BIT(bits[selector] - 1));
+    UVC_EXIT_CRITICAL();
+    return supported;
+}
+
+static esp_err_t _uvc_vc_control(uvc_vc_unit_t unit, uint8_t selector, uint8_t req, uint8_t *data, uint16_t len)
+{
+    UVC_CHECK(unit < UVC_VC_UNIT_MAX, "invalid unit", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(data != NULL && len && len <= UVC_VC_CONTROL_MAX_LEN, "invalid data", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC] && s_usb_dev.uvc, "uvc stream not config", ESP_ERR_INVALID_STATE);
     UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
-    if ((xEventGroupGetBits(s_usb_dev.event_group_hdl) & s_usb_dev.ifc[STREAM_UVC]->evt_bit)) {
-        ESP_LOGE(TAG, "%s stream running, please suspend before frame_size_reset", s_usb_dev.ifc[STREAM_UVC]->name);
-        return ESP_ERR_INVALID_STATE;
+    if (!uvc_vc_control_supported(unit, selector)) {
+        ESP_LOGD(TAG, "%s control 0x%02x not supported", unit == UVC_VC_CAMERA_TERMINAL ? "CT" : "PU", selector);
+        return ESP_ERR_NOT_SUPPORTED;
     }
+    UVC_ENTER_CRITICAL();
+    uint8_t vc_itf = s_usb_dev.uvc->vc_interface;
+    uint8_t unit_id = s_usb_dev.uvc->vc_unit_id[unit];
+    UVC_EXIT_CRITICAL();
+
+    urb_t *urb_ctrl = s_usb_dev.ctrl_urb;
+    bool need_free = false;
+    if (urb_ctrl == NULL) {
+        urb_ctrl = _usb_urb_alloc(0, sizeof(usb_setup_packet_t) + 64, NULL);
+        UVC_CHECK(urb_ctrl != NULL, "alloc urb failed", ESP_ERR_NO_MEM);
+        need_free = true;
+    }
+    xSemaphoreTake(s_usb_dev.xfer_mutex_hdl, portMAX_DELAY);
+    USB_CTRL_UVC_VC_REQ((usb_setup_packet_t *)urb_ctrl->transfer.data_buffer, req, selector, unit_id, vc_itf, len);
+    unsigned char *p_data = urb_ctrl->transfer.data_buffer + sizeof(usb_setup_packet_t);
+    if (req == UVC_SET_CUR) {
+        memcpy(p_data, data, len);
+        urb_ctrl->transfer.num_bytes = sizeof(usb_setup_packet_t) + len;
+    } else {
+        urb_ctrl->transfer.num_bytes = sizeof(usb_setup_packet_t) + usb_round_up_to_mps(len, s_usb_dev.ep_mps); //IN should be integer multiple of MPS
+    }
+    esp_err_t ret = _usb_ctrl_xfer(urb_ctrl, pdMS_TO_TICKS(TIMEOUT_USB_CTRL_XFER_MS));
+    if (ret == ESP_OK && req != UVC_SET_CUR) {
+        if (urb_ctrl->transfer.actual_num_bytes < sizeof(usb_setup_packet_t) + len) {
+            ret = ESP_ERR_INVALID_SIZE;
+        } else {
+            memcpy(data, p_data, len);
+        }
+    }
+    xSemaphoreGive(s_usb_dev.xfer_mutex_hdl);
+    ESP_LOGD(TAG, "%s 0x%02x %s control 0x%02x, len = %u, ret = 0x%x", req == UVC_SET_CUR ? "SET" : "GET", req,
+             unit == UVC_VC_CAMERA_TERMINAL ? "CT" : "PU", selector, len, ret);
+
+    if (need_free) {
+        _usb_urb_free(urb_ctrl);
+    }
+    return ret;
+}
+
+esp_err_t uvc_vc_control_get(uvc_vc_unit_t unit, uint8_t selector, enum uvc_req_code req, void *data, uint16_t len)
+{
+    UVC_CHECK(req & 0x80, "not a GET request", ESP_ERR_INVALID_ARG);
+    return _uvc_vc_control(unit, selector, req, data, len);
+}
+
+esp_err_t uvc_vc_control_set(uvc_vc_unit_t unit, uint8_t selector, const void *data, uint16_t len)
+{
+    return _uvc_vc_control(unit, selector, UVC_SET_CUR, (uint8_t *)data, len);
+}
+
+esp_err_t uvc_frame_release(uvc_frame_t *frame)
+{
+    UVC_CHECK(frame != NULL, "frame can't NULL", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.flags & FLAG_UVC_FRAME_ZERO_COPY, "zero-copy mode not enabled", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc, "uvc stream not config", ESP_ERR_INVALID_STATE);
+    _uvc_frame_pool_t *pool = &s_usb_dev.uvc->frame_pool;
+    if (pool->num && frame >= &pool->frame[0] && frame < &pool->frame[pool->num]) {
+        //frame slot can be released even stream suspended
+        _uvc_frame_pool_release(pool, frame - &pool->frame[0]);
+        return ESP_OK;
+    }
+    UVC_CHECK(s_usb_dev.uvc->uvc_stream_hdl, "uvc stream not running", ESP_ERR_INVALID_STATE);
+    _uvc_stream_handle_t *strmh = s_usb_dev.uvc->uvc_stream_hdl;
+    UVC_CHECK(frame == &strmh->frame, "frame not from uvc stream", ESP_ERR_INVALID_ARG);
+    xSemaphoreTake(strmh->cb_mutex, portMAX_DELAY);
+    strmh->hold_borrowed = false;
+    xSemaphoreGive(strmh->cb_mutex);
+    return ESP_OK;
+}
+
+/**
+ * @brief Select frame index and interval from the frame size list,
+ * which will be effective after next negotiation
+ */
+static esp_err_t _uvc_frame_size_select(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval)
+{
     int frame_found = -1;
     if (frame_width && frame_height) {
         bool frame_reset = false;
@@ -4257,7 +5775,7 @@ esp_err_t uvc_frame_size_reset(uint16_t frame_width, uint16_t frame_height, uint
         if (frame_found == -1) {
             ESP_LOGE(TAG, "frame size not found, width = %d, height = %d", frame_width, frame_height);
             return ESP_ERR_NOT_FOUND;
-        } else if (frame_reset == false) {
+        } else if (frame_reset == false && frame_interval == 0) {
             ESP_LOGW(TAG, "frame size not changed, width = %d, height = %d", frame_width, frame_height);
             return ESP_OK;
         }
@@ -4307,3 +5825,378 @@ esp_err_t uvc_frame_size_reset(uint16_t frame_width, uint16_t frame_height, uint
     ESP_LOGI(TAG, "UVC frame size reset, width = %d, height = %d, interval = %"PRIu32, frame_width, frame_height, final_interval);
     return ESP_OK;
 }
+
+esp_err_t uvc_frame_size_reset(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval)
+{
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC], "uvc stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc->vs_ifc && !s_usb_dev.uvc->vs_ifc->not_found, "uvc interface not found", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc->frame_size != NULL, "uvc frame size list not found", ESP_ERR_INVALID_STATE);
+    //Add a delay to avoid the situation that the device is not ready
+    vTaskDelay(pdMS_TO_TICKS(ACTIVE_DEBOUNCE_TIME_MS));
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    if ((xEventGroupGetBits(s_usb_dev.event_group_hdl) & s_usb_dev.ifc[STREAM_UVC]->evt_bit)) {
+        ESP_LOGE(TAG, "%s stream running, please suspend before frame_size_reset", s_usb_dev.ifc[STREAM_UVC]->name);
+        return ESP_ERR_INVALID_STATE;
+    }
+    return _uvc_frame_size_select(frame_width, frame_height, frame_interval);
+}
+
+typedef esp_err_t (*_uvc_switch_apply_t)(const void *arg);
+
+/**
+ * @brief Apply a new stream config and re-negotiate it while streaming, the stream handle, sample task
+ * and frame buffers are kept, only the transfer is stopped. If not streaming, the config is only applied.
+ * If apply fails, the previous config is resumed and the error returned.
+ */
+static esp_err_t _uvc_stream_switch(_uvc_switch_apply_t apply, const void *arg)
+{
+    _stream_ifc_t *p_itf = s_usb_dev.ifc[STREAM_UVC];
+    esp_err_t ret = ESP_OK;
+    esp_err_t apply_ret = ESP_OK;
+    uvc_stream_ctrl_t ctrl_probed = {0};
+
+    xSemaphoreTake(s_usb_dev.ctrl_smp_hdl, portMAX_DELAY);
+    _uvc_stream_handle_t *strmh = s_usb_dev.uvc->uvc_stream_hdl;
+    if (!(xEventGroupGetBits(s_usb_dev.event_group_hdl) & p_itf->evt_bit) || strmh == NULL) {
+        // not streaming, effective after resume
+        ret = apply(arg);
+        goto done_;
+    }
+    int64_t start_us = esp_timer_get_time();
+    // stop transfer only, stream handle, sample task and frame buffers are kept
+    ret = _usb_stream_task_request(STREAM_UVC, STREAM_SUSPEND);
+    UVC_CHECK_GOTO(ret == ESP_OK, "stop transfer failed/timeout", done_);
+    apply_ret = apply(arg);
+    if (apply_ret != ESP_OK) {
+        goto resume_;
+    }
+    if (p_itf->xfer_type == UVC_XFER_ISOC) {
+        ret = _usb_set_device_interface(p_itf->interface, 0);
+        UVC_CHECK_GOTO(ret == ESP_OK, "set interface alt 0 failed", restart_);
+    }
+    ret = _uvc_streaming_negotiate(&ctrl_probed);
+    UVC_CHECK_GOTO(ret == ESP_OK, "UVC negotiate failed", restart_);
+    if (strmh->pool && ctrl_probed.dwMaxVideoFrameSize > strmh->pool->slot_size) {
+        ESP_LOGW(TAG, "frame pool slot %u B < %"PRIu32" B, restart stream", (unsigned)strmh->pool->slot_size, ctrl_probed.dwMaxVideoFrameSize);
+        goto restart_;
+    }
+    xSemaphoreTake(strmh->cb_mutex, portMAX_DELAY);
+    _uvc_drop_buffers(strmh);
+    strmh->cur_ctrl = ctrl_probed;
+    strmh->width = s_usb_dev.uvc->frame_width;
+    strmh->height = s_usb_dev.uvc->frame_height;
+    strmh->reassembling = 0;
+    strmh->frame_decided = false;
+    strmh->frame_bytes_avg = 0;
+    strmh->tune_frames = 0;
+    xSemaphoreGive(strmh->cb_mutex);
+    if (p_itf->xfer_type == UVC_XFER_ISOC) {
+        ret = _usb_set_device_interface(p_itf->interface, p_itf->interface_alt);
+        UVC_CHECK_GOTO(ret == ESP_OK, "set interface failed", restart_);
+    }
+
+resume_:
+    ret = _usb_stream_task_request(STREAM_UVC, STREAM_RESUME);
+    UVC_CHECK_GOTO(ret == ESP_OK, "resume transfer failed/timeout", done_);
+    ESP_LOGI(TAG, "UVC stream switch done in %"PRIi64" us", esp_timer_get_time() - start_us);
+    ret = apply_ret;
+    goto done_;
+
+restart_:
+    // fall back to the full suspend and resume
+    _usb_streaming_suspend(STREAM_UVC);
+    ret = _usb_streaming_resume(STREAM_UVC);
+    UVC_CHECK_GOTO(ret == ESP_OK, "resume stream failed", done_);
+    ret = _usb_stream_task_request(STREAM_UVC, STREAM_RESUME);
+
+done_:
+    xSemaphoreGive(s_usb_dev.ctrl_smp_hdl);
+    return ret;
+}
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint32_t interval;
+} _uvc_frame_size_arg_t;
+
+static esp_err_t _uvc_frame_size_apply(const void *arg)
+{
+    const _uvc_frame_size_arg_t *size = (const _uvc_frame_size_arg_t *)arg;
+    return _uvc_frame_size_select(size->width, size->height, size->interval);
+}
+
+esp_err_t uvc_frame_size_switch(uint16_t frame_width, uint16_t frame_height, uint32_t frame_interval)
+{
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC], "uvc stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc->vs_ifc && !s_usb_dev.uvc->vs_ifc->not_found, "uvc interface not found", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc->frame_size != NULL, "uvc frame size list not found", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(xTaskGetCurrentTaskHandle() != s_usb_dev.stream_task_hdl, "can not switch in state callback", ESP_ERR_INVALID_STATE);
+    const _uvc_frame_size_arg_t size = {
+        .width = frame_width,
+        .height = frame_height,
+        .interval = frame_interval,
+    };
+    return _uvc_stream_switch(_uvc_frame_size_apply, &size);
+}
+
+esp_err_t uvc_compression_get(uvc_compression_t *comp)
+{
+    UVC_CHECK(comp != NULL, "invalid args", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC] && s_usb_dev.uvc, "uvc stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(xTaskGetCurrentTaskHandle() != s_usb_dev.stream_task_hdl, "can not get in state callback", ESP_ERR_INVALID_STATE);
+    _uvc_device_t *uvc_dev = s_usb_dev.uvc;
+    if (!uvc_dev->comp_range_valid) {
+        uvc_stream_ctrl_t ctrl_min = {0};
+        uvc_stream_ctrl_t ctrl_max = {0};
+        xSemaphoreTake(s_usb_dev.ctrl_smp_hdl, portMAX_DELAY);
+        // cameras without the range stall the request, the range is kept 0 and not asked again
+        if (_uvc_vs_probe_get(UVC_GET_MIN, &ctrl_min) != ESP_OK || _uvc_vs_probe_get(UVC_GET_MAX, &ctrl_max) != ESP_OK
+                || ctrl_min.wCompQuality > ctrl_max.wCompQuality) {
+            ctrl_min.wCompQuality = 0;
+            ctrl_max.wCompQuality = 0;
+        }
+        xSemaphoreGive(s_usb_dev.ctrl_smp_hdl);
+        UVC_ENTER_CRITICAL();
+        uvc_dev->comp.quality_min = ctrl_min.wCompQuality;
+        uvc_dev->comp.quality_max = ctrl_max.wCompQuality;
+        uvc_dev->comp_range_valid = true;
+        UVC_EXIT_CRITICAL();
+        ESP_LOGI(TAG, "UVC compression quality range %u ~ %u", ctrl_min.wCompQuality, ctrl_max.wCompQuality);
+    }
+    UVC_ENTER_CRITICAL();
+    *comp = uvc_dev->comp;
+    UVC_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+typedef struct {
+    uint16_t quality;
+    uint16_t window;
+} _uvc_compression_arg_t;
+
+static esp_err_t _uvc_compression_apply(const void *arg)
+{
+    const _uvc_compression_arg_t *comp = (const _uvc_compression_arg_t *)arg;
+    UVC_ENTER_CRITICAL();
+    s_usb_dev.uvc->comp_quality = comp->quality;
+    s_usb_dev.uvc->comp_window = comp->window;
+    UVC_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+esp_err_t uvc_compression_set(uint16_t quality, uint16_t window)
+{
+    UVC_CHECK(quality <= 10000, "quality out of range", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC] && s_usb_dev.uvc, "uvc stream not config", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(_usb_device_get_state() == STATE_DEVICE_ACTIVE, "USB Device not active", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(s_usb_dev.uvc->vs_ifc && !s_usb_dev.uvc->vs_ifc->not_found, "uvc interface not found", ESP_ERR_INVALID_STATE);
+    UVC_CHECK(xTaskGetCurrentTaskHandle() != s_usb_dev.stream_task_hdl, "can not switch in state callback", ESP_ERR_INVALID_STATE);
+    const _uvc_compression_arg_t comp = {
+        .quality = quality,
+        .window = window,
+    };
+    _uvc_device_t *uvc_dev = s_usb_dev.uvc;
+    bool streaming = xEventGroupGetBits(s_usb_dev.event_group_hdl) & s_usb_dev.ifc[STREAM_UVC]->evt_bit;
+    esp_err_t ret = _uvc_stream_switch(_uvc_compression_apply, &comp);
+    if (ret != ESP_OK || !streaming || quality == 0) {
+        return ret;
+    }
+    UVC_ENTER_CRITICAL();
+    uint16_t probed = uvc_dev->comp.quality;
+    UVC_EXIT_CRITICAL();
+    if (probed != quality) {
+        // the camera ignores the hint, go back to the default negotiation
+        _uvc_compression_arg_t def = {0};
+        _uvc_compression_apply(&def);
+        ESP_LOGW(TAG, "UVC compression quality %u not accepted, camera uses %u", quality, probed);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    ESP_LOGI(TAG, "UVC compression quality = %u, window = %u", quality, window);
+    return ESP_OK;
+}
+
+esp_err_t uvc_frame_decimate(uint16_t every_n)
+{
+    UVC_CHECK(s_usb_dev.enabled[STREAM_UVC], "uvc stream not config", ESP_ERR_INVALID_STATE);
+    // taken by the payload path at the next frame start
+    s_usb_dev.uvc_decimate = every_n;
+    ESP_LOGD(TAG, "UVC frame decimate = %u", every_n);
+    return ESP_OK;
+}
+
+esp_err_t uvc_streaming_view_add(const uvc_view_config_t *config, uvc_view_handle_t *handle)
+{
+    UVC_CHECK(config != NULL && config->frame_cb != NULL && handle != NULL, "invalid args", ESP_ERR_INVALID_ARG);
+    _uvc_view_t *view = NULL;
+    UVC_ENTER_CRITICAL();
+    for (size_t i = 0; i < CONFIG_UVC_VIEW_MAX_NUM; i++) {
+        if (s_uvc_views[i].cb == NULL) {
+            view = &s_uvc_views[i];
+            view->cb_arg = config->frame_cb_arg;
+            view->every_n = config->every_n;
+            view->priority = config->priority;
+            view->cnt = 0;
+            view->cb = config->frame_cb;
+            break;
+        }
+    }
+    UVC_EXIT_CRITICAL();
+    UVC_CHECK(view != NULL, "no free view, increase CONFIG_UVC_VIEW_MAX_NUM", ESP_ERR_NO_MEM);
+    *handle = view;
+    ESP_LOGD(TAG, "UVC view %d added, every %u frames, priority %u", (int)(view - s_uvc_views), config->every_n, config->priority);
+    return ESP_OK;
+}
+
+esp_err_t uvc_streaming_view_remove(uvc_view_handle_t handle)
+{
+    UVC_CHECK(handle >= s_uvc_views && handle < s_uvc_views + CONFIG_UVC_VIEW_MAX_NUM, "invalid view handle", ESP_ERR_INVALID_ARG);
+    UVC_ENTER_CRITICAL();
+    handle->cb = NULL;
+    UVC_EXIT_CRITICAL();
+    return ESP_OK;
+}
+
+static esp_err_t _usb_task_config_check(const usb_stream_task_t *task)
+{
+    UVC_CHECK(task->core_id >= -1 && task->core_id < portNUM_PROCESSORS, "invalid core id", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(task->priority > 0 && task->priority < configMAX_PRIORITIES, "invalid task priority", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(task->stack_size >= 2048, "task stack too small", ESP_ERR_INVALID_ARG);
+    return ESP_OK;
+}
+
+esp_err_t usb_streaming_task_config(const usb_stream_task_config_t *config)
+{
+    UVC_CHECK(config != NULL, "config can't NULL", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(_usb_task_config_check(&config->usb_proc) == ESP_OK, "usb_proc config invalid", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(_usb_task_config_check(&config->stream_proc) == ESP_OK, "stream_proc config invalid", ESP_ERR_INVALID_ARG);
+    UVC_CHECK(_usb_task_config_check(&config->sample_proc) == ESP_OK, "sample_proc config invalid", ESP_ERR_INVALID_ARG);
+    if (s_usb_dev.event_group_hdl == NULL) {
+        s_task_cfg = *config;
+        return ESP_OK;
+    }
+    // already started: core and stack can not change, priorities applied now
+    UVC_CHECK(config->usb_proc.core_id == s_task_cfg.usb_proc.core_id && config->usb_proc.stack_size == s_task_cfg.usb_proc.stack_size
+              && config->stream_proc.core_id == s_task_cfg.stream_proc.core_id && config->stream_proc.stack_size == s_task_cfg.stream_proc.stack_size,
+              "usb streaming started, only priority can be changed", ESP_ERR_INVALID_STATE);
+    xSemaphoreTake(s_usb_dev.ctrl_smp_hdl, portMAX_DELAY);
+    s_task_cfg = *config;
+    if (s_usb_dev.usb_task_hdl) {
+        vTaskPrioritySet(s_usb_dev.usb_task_hdl, config->usb_proc.priority);
+    }
+    if (s_usb_dev.stream_task_hdl) {
+        vTaskPrioritySet(s_usb_dev.stream_task_hdl, config->stream_proc.priority);
+    }
+    // sample task is created on stream resume, core and stack take effect then
+    if (s_usb_dev.uvc && s_usb_dev.uvc->uvc_stream_hdl && s_usb_dev.uvc->uvc_stream_hdl->taskh) {
+        vTaskPrioritySet(s_usb_dev.uvc->uvc_stream_hdl->taskh, config->sample_proc.priority);
+    }
+    xSemaphoreGive(s_usb_dev.ctrl_smp_hdl);
+    return ESP_OK;
+}
+
+esp_err_t usb_streaming_task_config_get(usb_stream_task_config_t *config)
+{
+    UVC_CHECK(config != NULL, "config can't NULL", ESP_ERR_INVALID_ARG);
+    *config = s_task_cfg;
+    return ESP_OK;
+}
+
+static void _usb_task_info_fill(usb_stream_task_info_t *info, const char *name, TaskHandle_t task, int8_t core_id)
+{
+    memset(info, 0, sizeof(usb_stream_task_info_t));
+    info->name = name;
+    info->core_id = core_id;
+    if (task == NULL) {
+        return;
+    }
+    info->running = true;
+    info->priority = uxTaskPriorityGet(task);
+    info->stack_free_min = uxTaskGetStackHighWaterMark(task);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    info->run_time = ulTaskGetRunTimeCounter(task);
+#endif
+}
+
+esp_err_t usb_streaming_get_task_info(usb_stream_task_info_t info[USB_STREAM_TASK_NUM])
+{
+    UVC_CHECK(info != NULL, "info can't NULL", ESP_ERR_INVALID_ARG);
+    if (!s_usb_dev.event_group_hdl || !(xEventGroupGetBits(s_usb_dev.event_group_hdl) & USB_HOST_INIT_DONE)) {
+        ESP_LOGW(TAG, "USB stream not started");
+        return ESP_ERR_INVALID_STATE;
+    }
+    TaskHandle_t sample_task = NULL;
+    xSemaphoreTake(s_usb_dev.ctrl_smp_hdl, portMAX_DELAY);
+    if (s_usb_dev.uvc && s_usb_dev.uvc->uvc_stream_hdl) {
+        sample_task = s_usb_dev.uvc->uvc_stream_hdl->taskh;
+    }
+    _usb_task_info_fill(&info[USB_STREAM_TASK_USB_PROC], USB_PROC_TASK_NAME, s_usb_dev.usb_task_hdl, s_task_cfg.usb_proc.core_id);
+    _usb_task_info_fill(&info[USB_STREAM_TASK_STREAM_PROC], USB_STREAM_NAME, s_usb_dev.stream_task_hdl, s_task_cfg.stream_proc.core_id);
+    _usb_task_info_fill(&info[USB_STREAM_TASK_SAMPLE_PROC], SAMPLE_PROC_TASK_NAME, sample_task, s_task_cfg.sample_proc.core_id);
+    xSemaphoreGive(s_usb_dev.ctrl_smp_hdl);
+#if CONFIG_FREERTOS_GENERATE_RUN_TIME_STATS
+    // cpu load of one core since the previous call
+    static configRUN_TIME_COUNTER_TYPE s_last_total = 0;
+    static configRUN_TIME_COUNTER_TYPE s_last_run[USB_STREAM_TASK_NUM] = {0};
+    configRUN_TIME_COUNTER_TYPE total = portGET_RUN_TIME_COUNTER_VALUE();
+    configRUN_TIME_COUNTER_TYPE elapsed = total - s_last_total;
+    for (size_t i = 0; i < USB_STREAM_TASK_NUM; i++) {
+        // counter restarts if the task was re-created
+        configRUN_TIME_COUNTER_TYPE run = info[i].run_time >= s_last_run[i] ? info[i].run_time - s_last_run[i] : info[i].run_time;
+        if (s_last_total && elapsed) {
+            info[i].cpu_load = (uint8_t)((uint64_t)run * 100 / elapsed);
+        }
+        s_last_run[i] = info[i].run_time;
+    }
+    s_last_total = total;
+#endif
+    return ESP_OK;
+}
+
+esp_err_t usb_streaming_get_stats(usb_stream_stats_t *stats)
+{
+    UVC_CHECK(stats != NULL, "stats can't NULL", ESP_ERR_INVALID_ARG);
+    if (!s_usb_dev.event_group_hdl || !(xEventGroupGetBits(s_usb_dev.event_group_hdl) & USB_HOST_INIT_DONE)) {
+        ESP_LOGW(TAG, "USB stream not started");
+        return ESP_ERR_INVALID_STATE;
+    }
+    UVC_ENTER_CRITICAL();
+    *stats = s_usb_dev.stats.pub;
+    int64_t window_start_us = s_usb_dev.stats.window_start_us;
+    uint32_t window_frames = s_usb_dev.stats.last_window_frames;
+    uint32_t window_us = s_usb_dev.stats.last_window_us;
+    UVC_EXIT_CRITICAL();
+
+    stats->uvc.xfer_type = UVC_XFER_UNKNOWN;
+    if (_usb_device_get_state() == STATE_DEVICE_ACTIVE && s_usb_dev.uvc && s_usb_dev.uvc->vs_ifc) {
+        stats->uvc.xfer_type = s_usb_dev.uvc->vs_ifc->xfer_type;
+    }
+    // no urb completed for two windows, the stream is not running
+    if (!window_us || esp_timer_get_time() - window_start_us > 2 * USB_STREAM_STATS_WINDOW_US) {
+        stats->uvc.fps = 0;
+        stats->uvc.bytes_per_sec = 0;
+        stats->uvc.bus_util = 0;
+        stats->uvc.payload_cycles_per_byte = 0;
+        return ESP_OK;
+    }
+    stats->uvc.fps = window_frames * 1000000.0f / window_us;
+    stats->uvc.bus_util = 0;
+    if (_usb_device_get_state() == STATE_DEVICE_ACTIVE && s_usb_dev.uvc && s_usb_dev.uvc->vs_ifc) {
+        _stream_ifc_t *ifc = s_usb_dev.uvc->vs_ifc;
+        uint32_t capacity = 0;
+        if (ifc->xfer_type == UVC_XFER_BULK) {
+            capacity = _bulk_bytes_per_ms() * 1000;
+        } else {
+            // one isoc packet each (micro)frame
+            capacity = ifc->bytes_per_packet * (s_usb_dev.dev_speed == USB_SPEED_HIGH ? 8000 : 1000);
+        }
+        if (capacity) {
+            uint32_t util = (uint64_t)stats->uvc.bytes_per_sec * 100 / capacity;
+            stats->uvc.bus_util = util > 100 ? 100 : util;
+        }
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,58 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+/*
+ * UAC API for the UVC-only build (CONFIG_USB_STREAM_UVC_ONLY). The UAC data path,
+ * ring buffers and class control requests are compiled out of usb_stream.c, these
+ * keep the public API linkable and report ESP_ERR_NOT_SUPPORTED.
+ */
+
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "usb_stream.h"
+
+static const char *TAG = "USB_STREAM";
+
+esp_err_t uac_streaming_config(const uac_config_t *config)
+{
+    ESP_LOGW(TAG, "UAC not supported in UVC-only build");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_spk_streaming_write(void *data, size_t data_bytes, size_t timeout_ms)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_spk_jitter_config(uint16_t target_ms, uint8_t urb_ms)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_mic_streaming_read(void *buf, size_t buf_size, size_t *data_bytes, size_t timeout_ms)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_mic_streaming_acquire(uac_mic_span_t *span, size_t timeout_ms)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_mic_streaming_release(const uac_mic_span_t *span)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_frame_size_list_get(usb_stream_t stream, uac_frame_size_t *frame_list, size_t *list_size, size_t *cur_index)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t uac_frame_size_reset(usb_stream_t stream, uint8_t ch_num, uint16_t bit_resolution, uint32_t samples_frequence)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
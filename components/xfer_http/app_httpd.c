@@ -8,7 +8,19 @@
 #include "esp_http_server.h"
 #include "esp_timer.h"
 #include "esp_camera.h"
+#include "frame_bus.h"
+#include "rtsp_server.h"
 #include "sdkconfig.h"
+#include <string.h>
+#include <stdlib.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "lwip/sockets.h"
+#if CONFIG_XFER_HTTP_WS_LIVE
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#endif
 
 #if defined(ARDUINO_ARCH_ESP32) && defined(CONFIG_ARDUHAL_ESP_LOG)
 #include "esp32-hal-log.h"
@@ -23,14 +35,113 @@ typedef struct {
     size_t len;
 } jpg_chunking_t;
 
+/* a subscriber that gets no frame for this long gives up, e.g. camera unplugged */
+#define FRAME_WAIT_TIMEOUT_MS 5000
+
 #define PART_BOUNDARY "123456789000000000000987654321"
-static const char *_STREAM_CONTENT_TYPE = "multipart/x-mixed-replace;boundary=" PART_BOUNDARY;
-static const char *_STREAM_BOUNDARY = "\r\n--" PART_BOUNDARY "\r\n";
-static const char *_STREAM_PART = "Content-Type: image/jpeg\r\nContent-Length: %u\r\nX-Timestamp: %d.%06d\r\n\r\n";
+
+/*
+ * The stream response is written straight to the socket: headers once, then one
+ * gathered send per frame (boundary + part header + JPEG). The body ends when the
+ * connection closes, so no chunked encoding is needed.
+ */
+static const char _STREAM_RESP_HDR[] = "HTTP/1.1 200 OK\r\n"
+                                       "Content-Type: multipart/x-mixed-replace;boundary=" PART_BOUNDARY "\r\n"
+                                       "Access-Control-Allow-Origin: *\r\n"
+                                       "Connection: close\r\n\r\n";
+
+/* boundary and part header template, the numbers are patched in place at fixed offsets */
+#define _PART_LEN_PREFIX "\r\n--" PART_BOUNDARY "\r\nContent-Type: image/jpeg\r\nContent-Length: "
+#define _PART_LEN_FIELD  "        "
+#define _PART_TS_PREFIX  "\r\nX-Timestamp: "
+#define _PART_SEC_FIELD  "          "
+#define _PART_USEC_FIELD "000000"
+static const char _STREAM_PART_TMPL[] = _PART_LEN_PREFIX _PART_LEN_FIELD _PART_TS_PREFIX
+                                        _PART_SEC_FIELD "." _PART_USEC_FIELD "\r\n\r\n";
+#define PART_LEN_OFFSET  (sizeof(_PART_LEN_PREFIX) - 1)
+#define PART_LEN_DIGITS  (sizeof(_PART_LEN_FIELD) - 1)
+#define PART_SEC_OFFSET  (PART_LEN_OFFSET + PART_LEN_DIGITS + sizeof(_PART_TS_PREFIX) - 1)
+#define PART_SEC_DIGITS  (sizeof(_PART_SEC_FIELD) - 1)
+#define PART_USEC_OFFSET (PART_SEC_OFFSET + PART_SEC_DIGITS + 1)
+#define PART_USEC_DIGITS (sizeof(_PART_USEC_FIELD) - 1)
+
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+/*
+ * Per client rate control: the frame interval follows the throughput measured
+ * while sending, so a weak link gets fewer frames instead of a growing backlog.
+ * A client that stays below 2 fps asks the producer for a smaller frame size.
+ */
+#define STREAM_LINK_USE_PCT         70      /* share of the measured throughput the stream may use */
+#define STREAM_INTERVAL_MAX_MS      2000
+#define STREAM_CONGESTED_MS         500
+#define STREAM_CONGESTED_HOLD_MS    3000
+#define STREAM_RECOVER_HOLD_MS      10000
+
+typedef struct {
+    uint32_t bw;                /* bytes per ms, running average */
+    uint32_t len_avg;
+    uint32_t full_len;          /* average frame size before the frame size was lowered */
+    uint32_t interval_ms;       /* minimum time between two frames */
+    int64_t last_sent_us;
+    int64_t hold_since_us;      /* start of the period the congestion state change must last */
+    bool congested;
+} stream_rate_t;
+
+static bool stream_rate_due(const stream_rate_t *r, int64_t now)
+{
+    return now - r->last_sent_us >= (int64_t)r->interval_ms * 1000;
+}
+
+static bool stream_rate_hold(stream_rate_t *r, bool cond, int64_t now, uint32_t hold_ms)
+{
+    if (!cond) {
+        r->hold_since_us = 0;
+        return false;
+    }
+    if (!r->hold_since_us) {
+        r->hold_since_us = now;
+    }
+    return now - r->hold_since_us >= (int64_t)hold_ms * 1000;
+}
+
+static void stream_rate_update(stream_rate_t *r, frame_bus_sub_t *sub, size_t len, int64_t send_us, int64_t now)
+{
+    uint32_t send_ms = send_us > 1000 ? send_us / 1000 : 1;
+    uint32_t bw = len / send_ms;
+    r->bw = r->bw ? (r->bw * 7 + bw) / 8 : bw;
+    r->len_avg = r->len_avg ? (r->len_avg * 7 + len) / 8 : len;
+
+    uint32_t budget = r->bw * STREAM_LINK_USE_PCT / 100;
+    budget = budget ? budget : 1;
+    uint32_t interval = r->len_avg / budget;
+    r->interval_ms = interval < STREAM_INTERVAL_MAX_MS ? interval : STREAM_INTERVAL_MAX_MS;
+
+    if (!r->congested) {
+        if (stream_rate_hold(r, r->interval_ms >= STREAM_CONGESTED_MS, now, STREAM_CONGESTED_HOLD_MS)) {
+            r->congested = true;
+            r->full_len = r->len_avg;
+            r->hold_since_us = 0;
+            frame_bus_set_congested(sub, true);
+        }
+    } else {
+        /* recover only once the link could carry the original frame size comfortably */
+        if (stream_rate_hold(r, r->full_len / budget < STREAM_CONGESTED_MS / 2, now, STREAM_RECOVER_HOLD_MS)) {
+            r->congested = false;
+            r->hold_since_us = 0;
+            frame_bus_set_congested(sub, false);
+        }
+    }
+}
+#endif
 
 httpd_handle_t stream_httpd = NULL;
 httpd_handle_t camera_httpd = NULL;
 
+/* handlers added by other components, kept so they can be registered once the server starts */
+#define EXTRA_URI_MAX 4
+static httpd_uri_t extra_uri[EXTRA_URI_MAX];
+static int extra_uri_cnt = 0;
+
 typedef struct {
     size_t size;  //number of values used for filtering
     size_t index; //current value index
@@ -76,16 +187,55 @@ static int ra_filter_run(ra_filter_t *filter, int value)
     return filter->sum / filter->count;
 }
 
+/* right-align v in a field of width characters, padding with pad (leading OWS or zeros) */
+static void part_put_dec(char *dst, size_t width, uint32_t v, char pad)
+{
+    for (size_t i = width; i > 0; i--) {
+        dst[i - 1] = (v || i == width) ? '0' + v % 10 : pad;
+        v /= 10;
+    }
+}
+
+/* send all vectors in as few socket writes as possible, lwip turns one call into one tcp write */
+static esp_err_t stream_sendv(int fd, struct iovec *iov, int iovcnt)
+{
+    while (iovcnt > 0) {
+        ssize_t sent = writev(fd, iov, iovcnt);
+        if (sent < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            /* EAGAIN here means the send timeout of the httpd socket expired */
+            ESP_LOGW(TAG, "Stream send failed, errno %d", errno);
+            return ESP_FAIL;
+        }
+        while (iovcnt > 0 && (size_t)sent >= iov->iov_len) {
+            sent -= iov->iov_len;
+            iov++;
+            iovcnt--;
+        }
+        if (iovcnt > 0) {
+            iov->iov_base = (uint8_t *)iov->iov_base + sent;
+            iov->iov_len -= sent;
+        }
+    }
+    return ESP_OK;
+}
+
 static esp_err_t capture_handler(httpd_req_t *req)
 {
     camera_fb_t *fb = NULL;
     esp_err_t res = ESP_OK;
     int64_t fr_start = esp_timer_get_time();
 
-    fb = esp_camera_fb_get();
+    frame_bus_sub_t *sub = frame_bus_subscribe();
+    if (sub) {
+        fb = frame_bus_wait(sub, FRAME_WAIT_TIMEOUT_MS);
+    }
 
     if (!fb) {
         ESP_LOGE(TAG, "Camera capture failed");
+        frame_bus_unsubscribe(sub);
         httpd_resp_send_500(req);
         return ESP_FAIL;
     }
@@ -101,7 +251,7 @@ static esp_err_t capture_handler(httpd_req_t *req)
     size_t fb_len = 0;
     fb_len = fb->len;
     res = httpd_resp_send(req, (const char *)fb->buf, fb->len);
-    esp_camera_fb_return(fb);
+    frame_bus_unsubscribe(sub);
     int64_t fr_end = esp_timer_get_time();
     ESP_LOGI(TAG, "JPG: %luB %lums", (uint32_t)(fb_len), (uint32_t)((fr_end - fr_start) / 1000));
     return res;
@@ -110,11 +260,10 @@ static esp_err_t capture_handler(httpd_req_t *req)
 static esp_err_t stream_handler(httpd_req_t *req)
 {
     camera_fb_t *fb = NULL;
-    struct timeval _timestamp;
     esp_err_t res = ESP_OK;
     size_t _jpg_buf_len = 0;
-    uint8_t *_jpg_buf = NULL;
-    char *part_buf[128];
+    char part_buf[sizeof(_STREAM_PART_TMPL)];
+    struct iovec iov[2];
 
     static int64_t last_frame = 0;
 
@@ -122,70 +271,258 @@ static esp_err_t stream_handler(httpd_req_t *req)
         last_frame = esp_timer_get_time();
     }
 
-    res = httpd_resp_set_type(req, _STREAM_CONTENT_TYPE);
+    int fd = httpd_req_to_sockfd(req);
+    if (fd < 0) {
+        return ESP_FAIL;
+    }
 
-    if (res != ESP_OK) {
-        return res;
+    /* every client reads the shared bus, a slow client skips frames instead of holding up capture */
+    frame_bus_sub_t *sub = frame_bus_subscribe();
+    if (!sub) {
+        httpd_resp_send_500(req);
+        return ESP_FAIL;
+    }
+    /* /stream?fps=N caps this client only, the snapshot path and other clients keep the camera rate */
+    char query[16];
+    char value[4];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+            httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK && atoi(value) > 0) {
+        frame_bus_set_interval(sub, 1000 / atoi(value));
     }
 
-    httpd_resp_set_hdr(req, "Access-Control-Allow-Origin", "*");
-    httpd_resp_set_hdr(req, "X-Framerate", "60");
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+    stream_rate_t rate = {0};
+    frame_bus_set_congested(sub, false);
+#endif
+
+    memcpy(part_buf, _STREAM_PART_TMPL, sizeof(part_buf));
+    if (httpd_send(req, _STREAM_RESP_HDR, sizeof(_STREAM_RESP_HDR) - 1) != sizeof(_STREAM_RESP_HDR) - 1) {
+        frame_bus_unsubscribe(sub);
+        return ESP_FAIL;
+    }
 
     while (true) {
-        fb = esp_camera_fb_get();
+        fb = frame_bus_wait(sub, FRAME_WAIT_TIMEOUT_MS);
 
         if (!fb) {
             ESP_LOGE(TAG, "Camera capture failed");
             res = ESP_FAIL;
-        } else {
-            _timestamp.tv_sec = fb->timestamp.tv_sec;
-            _timestamp.tv_usec = fb->timestamp.tv_usec;
-            _jpg_buf_len = fb->len;
-            _jpg_buf = fb->buf;
+            break;
         }
 
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, _STREAM_BOUNDARY, strlen(_STREAM_BOUNDARY));
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+        int64_t send_start = esp_timer_get_time();
+        if (!stream_rate_due(&rate, send_start)) {
+            frame_bus_done(sub);
+            continue;
         }
+        rate.last_sent_us = send_start;
+#endif
 
-        if (res == ESP_OK) {
-            size_t hlen = snprintf((char *)part_buf, 128, _STREAM_PART, _jpg_buf_len, _timestamp.tv_sec, _timestamp.tv_usec);
-            res = httpd_resp_send_chunk(req, (const char *)part_buf, hlen);
-        }
+        _jpg_buf_len = fb->len;
+        part_put_dec(part_buf + PART_LEN_OFFSET, PART_LEN_DIGITS, _jpg_buf_len, ' ');
+        part_put_dec(part_buf + PART_SEC_OFFSET, PART_SEC_DIGITS, fb->timestamp.tv_sec, ' ');
+        part_put_dec(part_buf + PART_USEC_OFFSET, PART_USEC_DIGITS, fb->timestamp.tv_usec, '0');
 
-        if (res == ESP_OK) {
-            res = httpd_resp_send_chunk(req, (const char *)_jpg_buf, _jpg_buf_len);
-        }
+        iov[0].iov_base = part_buf;
+        iov[0].iov_len = sizeof(part_buf) - 1;
+        iov[1].iov_base = fb->buf;
+        iov[1].iov_len = _jpg_buf_len;
+        res = stream_sendv(fd, iov, 2);
 
-        if (fb) {
-            esp_camera_fb_return(fb);
-            fb = NULL;
-            _jpg_buf = NULL;
-        } else if (_jpg_buf) {
-            _jpg_buf = NULL;
-        }
+        frame_bus_done(sub);
+        fb = NULL;
 
         if (res != ESP_OK) {
             break;
         }
 
         int64_t fr_end = esp_timer_get_time();
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+        stream_rate_update(&rate, sub, _jpg_buf_len, fr_end - send_start, fr_end);
+#endif
         int64_t frame_time = fr_end - last_frame;
         last_frame = fr_end;
         frame_time /= 1000;
         uint32_t avg_frame_time = ra_filter_run(&ra_filter, frame_time);
-        ESP_LOGI(TAG, "MJPG: %luB %lums (%.1ffps), AVG: %lums (%.1ffps)"
+        ESP_LOGI(TAG, "MJPG: %luB %lums (%.1ffps), AVG: %lums (%.1ffps), skipped %lu"
                  ,
                  (uint32_t)(_jpg_buf_len),
                  (uint32_t)frame_time, 1000.0 / (uint32_t)frame_time,
-                 avg_frame_time, 1000.0 / avg_frame_time
+                 avg_frame_time, 1000.0 / avg_frame_time,
+                 frame_bus_skipped(sub)
                 );
     }
 
+    frame_bus_unsubscribe(sub);
     last_frame = 0;
     return res;
 }
 
+#if CONFIG_XFER_HTTP_WS_LIVE
+/*
+ * WebSocket live view: every JPEG goes out as one binary message. Each client has
+ * a pusher task that owns a frame bus subscription and hands one frame at a time
+ * to the server with httpd_ws_send_data_async(), so the write happens in the
+ * server task next to ping/pong and close handling. The next frame is taken only
+ * after the previous one has left, frames published in the meantime are skipped
+ * by the bus: the client never has more than one frame queued, and what it gets
+ * is always the newest one. Once a second a text message reports the lag of this
+ * client (capture to send complete) and the frames it skipped.
+ */
+#define WS_LIVE_TASK_STACK      3072
+#define WS_LIVE_TASK_PRIO       5
+#define WS_LIVE_STATS_MS        1000
+
+typedef struct {
+    httpd_handle_t hd;
+    int fd;
+    uint32_t interval_ms;
+    SemaphoreHandle_t sent;
+    esp_err_t sent_err;
+    char stats[96];
+} ws_live_t;
+
+static void ws_live_sent_cb(esp_err_t err, int socket, void *arg)
+{
+    ws_live_t *ws = (ws_live_t *)arg;
+    ws->sent_err = err;
+    xSemaphoreGive(ws->sent);
+}
+
+/* queue one message and wait until the server task has written it */
+static esp_err_t ws_live_send(ws_live_t *ws, httpd_ws_type_t type, const uint8_t *data, size_t len)
+{
+    httpd_ws_frame_t frame = {
+        .final = true,
+        .type = type,
+        .payload = (uint8_t *)data,
+        .len = len,
+    };
+    if (httpd_ws_get_fd_info(ws->hd, ws->fd) != HTTPD_WS_CLIENT_WEBSOCKET) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = httpd_ws_send_data_async(ws->hd, ws->fd, &frame, ws_live_sent_cb, ws);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    /* the queued work references the payload, bounded by the send timeout of the server */
+    xSemaphoreTake(ws->sent, portMAX_DELAY);
+    return ws->sent_err;
+}
+
+static void ws_live_task(void *arg)
+{
+    ws_live_t *ws = (ws_live_t *)arg;
+    frame_bus_sub_t *sub = frame_bus_subscribe();
+    uint32_t sent = 0;
+    int64_t lag_sum = 0;
+    int64_t lag_max = 0;
+    int64_t stats_at = esp_timer_get_time() + WS_LIVE_STATS_MS * 1000;
+
+    if (!sub) {
+        ESP_LOGW(TAG, "WS %d: no free frame bus slot", ws->fd);
+        goto out;
+    }
+    frame_bus_set_interval(sub, ws->interval_ms);
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+    stream_rate_t rate = {0};
+    frame_bus_set_congested(sub, false);
+#endif
+
+    while (true) {
+        camera_fb_t *fb = frame_bus_wait(sub, FRAME_WAIT_TIMEOUT_MS);
+        if (!fb) {
+            ESP_LOGE(TAG, "Camera capture failed");
+            break;
+        }
+
+        int64_t send_start = esp_timer_get_time();
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+        if (!stream_rate_due(&rate, send_start)) {
+            frame_bus_done(sub);
+            continue;
+        }
+        rate.last_sent_us = send_start;
+#endif
+        size_t len = fb->len;
+        int64_t capture_us = (int64_t)fb->timestamp.tv_sec * 1000000 + fb->timestamp.tv_usec;
+        esp_err_t ret = ws_live_send(ws, HTTPD_WS_TYPE_BINARY, fb->buf, len);
+        frame_bus_done(sub);
+        if (ret != ESP_OK) {
+            break;
+        }
+
+        int64_t now = esp_timer_get_time();
+#if CONFIG_XFER_HTTP_STREAM_ADAPTIVE
+        stream_rate_update(&rate, sub, len, now - send_start, now);
+#endif
+        int64_t lag = now - capture_us;
+        lag_sum += lag;
+        lag_max = lag > lag_max ? lag : lag_max;
+        sent++;
+
+        if (now >= stats_at) {
+            int n = snprintf(ws->stats, sizeof(ws->stats), "{\"sent\":%lu,\"skipped\":%lu,\"lag_ms\":%lu,\"lag_max_ms\":%lu}",
+                             (unsigned long)sent, (unsigned long)frame_bus_skipped(sub),
+                             (unsigned long)(lag_sum / sent / 1000), (unsigned long)(lag_max / 1000));
+            ESP_LOGD(TAG, "WS %d: %s", ws->fd, ws->stats);
+            if (ws_live_send(ws, HTTPD_WS_TYPE_TEXT, (const uint8_t *)ws->stats, n) != ESP_OK) {
+                break;
+            }
+            sent = 0;
+            lag_sum = 0;
+            lag_max = 0;
+            stats_at = now + WS_LIVE_STATS_MS * 1000;
+        }
+    }
+
+out:
+    frame_bus_unsubscribe(sub);
+    httpd_sess_trigger_close(ws->hd, ws->fd);
+    vSemaphoreDelete(ws->sent);
+    free(ws);
+    vTaskDelete(NULL);
+}
+
+static esp_err_t ws_live_handler(httpd_req_t *req)
+{
+    if (req->method == HTTP_GET) {
+        /* handshake done, /ws?fps=N caps this client like /stream */
+        ws_live_t *ws = calloc(1, sizeof(ws_live_t));
+        if (!ws) {
+            return ESP_ERR_NO_MEM;
+        }
+        ws->hd = req->handle;
+        ws->fd = httpd_req_to_sockfd(req);
+        char query[16];
+        char value[4];
+        if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+                httpd_query_key_value(query, "fps", value, sizeof(value)) == ESP_OK && atoi(value) > 0) {
+            ws->interval_ms = 1000 / atoi(value);
+        }
+        ws->sent = xSemaphoreCreateBinary();
+        if (!ws->sent || xTaskCreate(ws_live_task, "ws_live", WS_LIVE_TASK_STACK, ws, WS_LIVE_TASK_PRIO, NULL) != pdPASS) {
+            if (ws->sent) {
+                vSemaphoreDelete(ws->sent);
+            }
+            free(ws);
+            return ESP_ERR_NO_MEM;
+        }
+        return ESP_OK;
+    }
+
+    /* nothing is expected from the client, short messages are read and dropped */
+    uint8_t buf[32];
+    httpd_ws_frame_t frame = {.payload = buf};
+    esp_err_t ret = httpd_ws_recv_frame(req, &frame, 0);
+    if (ret != ESP_OK || frame.len > sizeof(buf)) {
+        return ESP_FAIL;
+    }
+    return frame.len ? httpd_ws_recv_frame(req, &frame, sizeof(buf)) : ESP_OK;
+}
+#endif
+
 static esp_err_t index_handler(httpd_req_t *req)
 {
     extern const unsigned char index_uvc_html_gz_start[] asm("_binary_index_uvc_html_gz_start");
@@ -197,6 +534,18 @@ static esp_err_t index_handler(httpd_req_t *req)
     return httpd_resp_send(req, (const char *)index_uvc_html_gz_start, index_uvc_html_gz_len);
 }
 
+esp_err_t app_httpd_register_uri(const httpd_uri_t *uri)
+{
+    if (extra_uri_cnt >= EXTRA_URI_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    extra_uri[extra_uri_cnt++] = *uri;
+    if (camera_httpd) {
+        return httpd_register_uri_handler(camera_httpd, uri);
+    }
+    return ESP_OK;
+}
+
 void app_httpd_main()
 {
     httpd_config_t config = HTTPD_DEFAULT_CONFIG();
@@ -223,6 +572,16 @@ void app_httpd_main()
         .user_ctx = NULL
     };
 
+#if CONFIG_XFER_HTTP_WS_LIVE
+    httpd_uri_t ws_uri = {
+        .uri = "/ws",
+        .method = HTTP_GET,
+        .handler = ws_live_handler,
+        .user_ctx = NULL,
+        .is_websocket = true,
+    };
+#endif
+
     ra_filter_init(&ra_filter, 20);
 
     ESP_LOGI(TAG, "Starting web server on port: '%d'", config.server_port);
@@ -230,6 +589,9 @@ void app_httpd_main()
     if (httpd_start(&camera_httpd, &config) == ESP_OK) {
         httpd_register_uri_handler(camera_httpd, &index_uri);
         httpd_register_uri_handler(camera_httpd, &capture_uri);
+        for (int i = 0; i < extra_uri_cnt; i++) {
+            httpd_register_uri_handler(camera_httpd, &extra_uri[i]);
+        }
     }
 
     config.server_port += 1;
@@ -238,5 +600,12 @@ void app_httpd_main()
 
     if (httpd_start(&stream_httpd, &config) == ESP_OK) {
         httpd_register_uri_handler(stream_httpd, &stream_uri);
+#if CONFIG_XFER_HTTP_WS_LIVE
+        httpd_register_uri_handler(stream_httpd, &ws_uri);
+#endif
     }
+
+#if CONFIG_XFER_HTTP_RTSP
+    rtsp_server_start();
+#endif
 }
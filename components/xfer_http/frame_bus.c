@@ -0,0 +1,315 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "sdkconfig.h"
+#include "frame_bus.h"
+
+static const char *TAG = "frame_bus";
+
+#define FRAME_BUS_SUB_MAX   CONFIG_XFER_HTTP_FRAME_BUS_SUB_MAX
+/* every subscriber holds at most one frame, plus the newest one kept by the bus */
+#define FRAME_BUS_ENTRY_NUM (FRAME_BUS_SUB_MAX + 1)
+
+typedef struct {
+    camera_fb_t *fb;
+    uint32_t seq;
+    uint8_t ref;
+} frame_bus_entry_t;
+
+struct frame_bus_sub {
+    bool used;
+    SemaphoreHandle_t sem;      /* given on every publish */
+    frame_bus_entry_t *held;
+    uint32_t last_seq;
+    uint32_t skipped;
+    uint32_t interval_ms;
+    int64_t next_us;            /* earliest time of the next frame when interval_ms is set */
+    bool rated;                 /* reports congestion, subscribers that never do are not counted */
+    bool congested;
+};
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static SemaphoreHandle_t s_sub_mutex = NULL;   /* serializes subscribe/unsubscribe */
+static frame_bus_config_t s_config;
+static frame_bus_entry_t s_entries[FRAME_BUS_ENTRY_NUM];
+static frame_bus_entry_t *s_latest = NULL;
+static struct frame_bus_sub s_subs[FRAME_BUS_SUB_MAX];
+static uint8_t s_sub_num = 0;
+static uint32_t s_seq = 0;
+static bool s_congested = false;                /* last state reported to the producer */
+
+/* must be called with s_lock held, returns the frame to give back to the camera */
+static camera_fb_t *_entry_unref(frame_bus_entry_t *entry)
+{
+    if (--entry->ref > 0) {
+        return NULL;
+    }
+    camera_fb_t *fb = entry->fb;
+    entry->fb = NULL;
+    return fb;
+}
+
+/* must be called with s_sub_mutex held */
+static void _update_congestion(void)
+{
+    uint8_t num = 0;
+    uint8_t congested = 0;
+    for (int i = 0; i < FRAME_BUS_SUB_MAX; i++) {
+        if (s_subs[i].used && s_subs[i].rated) {
+            num++;
+            congested += s_subs[i].congested;
+        }
+    }
+    bool all = (num > 0 && congested == num);
+    if (all != s_congested) {
+        s_congested = all;
+        ESP_LOGI(TAG, "Subscribers %s", all ? "congested" : "recovered");
+        if (s_config.congestion) {
+            s_config.congestion(all);
+        }
+    }
+}
+
+static void _drop_latest(void)
+{
+    camera_fb_t *release = NULL;
+    portENTER_CRITICAL(&s_lock);
+    if (s_latest) {
+        release = _entry_unref(s_latest);
+        s_latest = NULL;
+    }
+    portEXIT_CRITICAL(&s_lock);
+    if (release) {
+        esp_camera_fb_return(release);
+    }
+}
+
+esp_err_t frame_bus_init(const frame_bus_config_t *config)
+{
+    if (s_sub_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_sub_mutex = xSemaphoreCreateMutex();
+    if (!s_sub_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    for (int i = 0; i < FRAME_BUS_SUB_MAX; i++) {
+        s_subs[i].sem = xSemaphoreCreateBinary();
+        if (!s_subs[i].sem) {
+            ESP_LOGE(TAG, "Failed to create subscriber semaphore");
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (config) {
+        s_config = *config;
+    }
+    return ESP_OK;
+}
+
+void frame_bus_publish(camera_fb_t *fb)
+{
+    if (!fb) {
+        return;
+    }
+    camera_fb_t *release = NULL;
+    bool published = false;
+
+    portENTER_CRITICAL(&s_lock);
+    if (s_sub_num > 0) {
+        frame_bus_entry_t *entry = NULL;
+        for (int i = 0; i < FRAME_BUS_ENTRY_NUM; i++) {
+            if (s_entries[i].fb == NULL) {
+                entry = &s_entries[i];
+                break;
+            }
+        }
+        /* always found: subscribers hold at most FRAME_BUS_SUB_MAX entries */
+        if (entry) {
+            entry->fb = fb;
+            entry->ref = 1;
+            entry->seq = ++s_seq;
+            if (s_latest) {
+                release = _entry_unref(s_latest);
+            }
+            s_latest = entry;
+            published = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_lock);
+
+    if (!published) {
+        esp_camera_fb_return(fb);
+        return;
+    }
+    if (release) {
+        esp_camera_fb_return(release);
+    }
+    for (int i = 0; i < FRAME_BUS_SUB_MAX; i++) {
+        if (s_subs[i].used) {
+            xSemaphoreGive(s_subs[i].sem);
+        }
+    }
+}
+
+frame_bus_sub_t *frame_bus_subscribe(void)
+{
+    if (!s_sub_mutex) {
+        return NULL;
+    }
+    frame_bus_sub_t *sub = NULL;
+    xSemaphoreTake(s_sub_mutex, portMAX_DELAY);
+    for (int i = 0; i < FRAME_BUS_SUB_MAX; i++) {
+        if (!s_subs[i].used) {
+            sub = &s_subs[i];
+            break;
+        }
+    }
+    if (sub == NULL) {
+        xSemaphoreGive(s_sub_mutex);
+        ESP_LOGW(TAG, "Too many subscribers (%d)", FRAME_BUS_SUB_MAX);
+        return NULL;
+    }
+    if (s_sub_num == 0 && s_config.demand_begin && s_config.demand_begin() != ESP_OK) {
+        xSemaphoreGive(s_sub_mutex);
+        ESP_LOGE(TAG, "Frame producer not available");
+        return NULL;
+    }
+    xSemaphoreTake(sub->sem, 0);
+    sub->held = NULL;
+    sub->last_seq = 0;
+    sub->skipped = 0;
+    sub->interval_ms = 0;
+    sub->next_us = 0;
+    sub->rated = false;
+    sub->congested = false;
+    portENTER_CRITICAL(&s_lock);
+    sub->used = true;
+    s_sub_num++;
+    portEXIT_CRITICAL(&s_lock);
+    _update_congestion();
+    xSemaphoreGive(s_sub_mutex);
+    return sub;
+}
+
+void frame_bus_unsubscribe(frame_bus_sub_t *sub)
+{
+    if (!sub || !sub->used) {
+        return;
+    }
+    frame_bus_done(sub);
+    xSemaphoreTake(s_sub_mutex, portMAX_DELAY);
+    portENTER_CRITICAL(&s_lock);
+    sub->used = false;
+    s_sub_num--;
+    bool last = (s_sub_num == 0);
+    portEXIT_CRITICAL(&s_lock);
+    _update_congestion();
+    if (last) {
+        /* nobody left to read it, do not pin a camera buffer */
+        _drop_latest();
+        if (s_config.demand_end) {
+            s_config.demand_end();
+        }
+    }
+    xSemaphoreGive(s_sub_mutex);
+    ESP_LOGD(TAG, "Subscriber left, skipped %lu frames", sub->skipped);
+}
+
+camera_fb_t *frame_bus_wait(frame_bus_sub_t *sub, uint32_t timeout_ms)
+{
+    if (!sub || !sub->used || sub->held) {
+        return NULL;
+    }
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TickType_t start_tick = xTaskGetTickCount();
+    if (sub->interval_ms) {
+        /* frames published meanwhile are replaced by newer ones, nothing is held for sub */
+        int64_t wait_us = sub->next_us - esp_timer_get_time();
+        if (wait_us > 0) {
+            TickType_t delay = pdMS_TO_TICKS((wait_us + 999) / 1000);
+            if (ticks != portMAX_DELAY && delay > ticks) {
+                vTaskDelay(ticks);
+                return NULL;
+            }
+            vTaskDelay(delay);
+        }
+    }
+    do {
+        portENTER_CRITICAL(&s_lock);
+        if (s_latest && s_latest->seq != sub->last_seq) {
+            if (sub->last_seq && !sub->interval_ms) {
+                sub->skipped += s_latest->seq - sub->last_seq - 1;
+            }
+            sub->last_seq = s_latest->seq;
+            sub->held = s_latest;
+            s_latest->ref++;
+        }
+        portEXIT_CRITICAL(&s_lock);
+        if (sub->held) {
+            if (sub->interval_ms) {
+                int64_t now = esp_timer_get_time();
+                sub->next_us += (int64_t)sub->interval_ms * 1000;
+                /* keep the cadence, but do not burst after a long pause */
+                if (sub->next_us < now) {
+                    sub->next_us = now;
+                }
+            }
+            return sub->held->fb;
+        }
+        TickType_t elapsed = xTaskGetTickCount() - start_tick;
+        if (ticks != portMAX_DELAY && elapsed >= ticks) {
+            return NULL;
+        }
+        xSemaphoreTake(sub->sem, (ticks == portMAX_DELAY) ? portMAX_DELAY : (ticks - elapsed));
+    } while (1);
+}
+
+void frame_bus_done(frame_bus_sub_t *sub)
+{
+    if (!sub || !sub->held) {
+        return;
+    }
+    portENTER_CRITICAL(&s_lock);
+    camera_fb_t *release = _entry_unref(sub->held);
+    sub->held = NULL;
+    portEXIT_CRITICAL(&s_lock);
+    if (release) {
+        esp_camera_fb_return(release);
+    }
+}
+
+void frame_bus_set_congested(frame_bus_sub_t *sub, bool congested)
+{
+    if (!sub || !sub->used || (sub->rated && sub->congested == congested)) {
+        return;
+    }
+    xSemaphoreTake(s_sub_mutex, portMAX_DELAY);
+    sub->rated = true;
+    sub->congested = congested;
+    _update_congestion();
+    xSemaphoreGive(s_sub_mutex);
+}
+
+void frame_bus_set_interval(frame_bus_sub_t *sub, uint32_t interval_ms)
+{
+    if (!sub || !sub->used) {
+        return;
+    }
+    sub->interval_ms = interval_ms;
+    sub->next_us = esp_timer_get_time();
+}
+
+uint32_t frame_bus_skipped(const frame_bus_sub_t *sub)
+{
+    return sub ? sub->skipped : 0;
+}
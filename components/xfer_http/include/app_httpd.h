@@ -7,12 +7,21 @@
 #ifndef _CAMERA_HTTPD_H_
 #define _CAMERA_HTTPD_H_
 
+#include "esp_http_server.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
 void app_httpd_main();
 
+/**
+ * Add a handler to the control server (port 80). Handlers added before
+ * app_httpd_main() are registered when the server starts. uri->uri must
+ * stay valid, usually a string literal.
+ */
+esp_err_t app_httpd_register_uri(const httpd_uri_t *uri);
+
 #ifdef __cplusplus
 }
 #endif
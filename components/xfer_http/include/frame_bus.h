@@ -0,0 +1,108 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _FRAME_BUS_H_
+#define _FRAME_BUS_H_
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "esp_camera.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Frame broadcaster
+ *
+ * The producer publishes every completed frame once; each subscriber gets a
+ * reference to the newest frame it has not seen yet. A subscriber that is
+ * slower than the producer skips the frames published while it was busy,
+ * so the producer never waits for consumers. A frame goes back to the
+ * camera with esp_camera_fb_return() when the bus and every subscriber
+ * holding it are done.
+ */
+typedef struct frame_bus_sub frame_bus_sub_t;
+
+typedef struct {
+    esp_err_t (*demand_begin)(void);    /*!< Called when the first subscriber joins, may be NULL */
+    void (*demand_end)(void);           /*!< Called when the last subscriber leaves, may be NULL */
+    void (*congestion)(bool congested); /*!< Called in the subscriber task when all subscribers became
+                                             congested (true) or one of them no longer is (false), may be NULL */
+} frame_bus_config_t;
+
+/**
+ * @brief Initialize the bus, called once by the frame producer
+ */
+esp_err_t frame_bus_init(const frame_bus_config_t *config);
+
+/**
+ * @brief Publish a frame, the bus takes over one reference of fb
+ *
+ * Never blocks. Without subscribers the frame is returned immediately.
+ */
+void frame_bus_publish(camera_fb_t *fb);
+
+/**
+ * @brief Join the bus, returns NULL when CONFIG_XFER_HTTP_FRAME_BUS_SUB_MAX subscribers exist
+ */
+frame_bus_sub_t *frame_bus_subscribe(void);
+
+/**
+ * @brief Leave the bus, a frame still held by sub is released
+ */
+void frame_bus_unsubscribe(frame_bus_sub_t *sub);
+
+/**
+ * @brief Wait for a frame newer than the last one returned to sub
+ *
+ * A subscriber holds at most one frame, call frame_bus_done() before waiting again.
+ *
+ * @param sub        subscriber
+ * @param timeout_ms maximum wait, portMAX_DELAY waits forever
+ * @return frame or NULL on timeout
+ */
+camera_fb_t *frame_bus_wait(frame_bus_sub_t *sub, uint32_t timeout_ms);
+
+/**
+ * @brief Release the frame returned by frame_bus_wait()
+ */
+void frame_bus_done(frame_bus_sub_t *sub);
+
+/**
+ * @brief Report whether the link of sub can no longer carry the current frame size
+ *
+ * The producer is asked to lower the frame size only when every subscriber that
+ * reports congestion is congested, so one slow client does not degrade the others.
+ * Subscribers that never call this (e.g. single captures) are not counted.
+ */
+void frame_bus_set_congested(frame_bus_sub_t *sub, bool congested);
+
+/**
+ * @brief Limit the frame rate delivered to sub
+ *
+ * frame_bus_wait() does not return a frame earlier than interval_ms after the
+ * previous one, so a low rate consumer (analytics, clips) sleeps instead of
+ * waking for every frame only to drop it. Other subscribers are not affected.
+ *
+ * @param sub         subscriber
+ * @param interval_ms minimum time between two frames, 0 for every frame
+ */
+void frame_bus_set_interval(frame_bus_sub_t *sub, uint32_t interval_ms);
+
+/**
+ * @brief Number of frames sub has skipped because it was slower than the producer
+ *
+ * Frames withheld by frame_bus_set_interval() are not counted.
+ */
+uint32_t frame_bus_skipped(const frame_bus_sub_t *sub);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _FRAME_BUS_H_ */
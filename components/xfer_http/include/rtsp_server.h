@@ -0,0 +1,32 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#ifndef _RTSP_SERVER_H_
+#define _RTSP_SERVER_H_
+
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Start the RTSP server (CONFIG_XFER_HTTP_RTSP)
+ *
+ * Serves rtsp://<ip>:CONFIG_XFER_HTTP_RTSP_PORT/ with one MJPEG track,
+ * packetized as RTP/JPEG (RFC 2435) over UDP. Frames come from the frame
+ * broadcaster, every session is one subscriber. RTP over the RTSP TCP
+ * connection (interleaved) and RTCP are not supported.
+ *
+ * @return ESP_ERR_NOT_SUPPORTED when CONFIG_XFER_HTTP_RTSP is disabled
+ */
+esp_err_t rtsp_server_start(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _RTSP_SERVER_H_ */
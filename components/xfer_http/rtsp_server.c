@@ -0,0 +1,567 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <errno.h>
+#include <sys/uio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "lwip/sockets.h"
+#include "sdkconfig.h"
+#include "frame_bus.h"
+#include "rtsp_server.h"
+
+static const char *TAG = "rtsp_server";
+
+#if CONFIG_XFER_HTTP_RTSP
+
+#define RTSP_TASK_STACK         4096
+#define RTSP_TASK_PRIO          5
+#define RTSP_RX_BUF_SIZE        1024
+#define RTSP_TX_BUF_SIZE        512
+#define RTSP_SESSION_TIMEOUT_S  60      /* advertised in the Session header */
+#define RTSP_FRAME_WAIT_MS      50      /* between frames the control socket is polled */
+
+#define RTP_PAYLOAD_MAX         1400    /* keeps every datagram inside one Wi-Fi MTU */
+#define RTP_PT_JPEG             26
+#define RTP_HDR_LEN             12
+#define RTP_JPEG_HDR_LEN        8
+#define RTP_RESTART_HDR_LEN     4
+#define RTP_QTABLE_HDR_LEN      4
+#define RTP_CLOCK_HZ            90000
+
+typedef struct {
+    uint16_t width;
+    uint16_t height;
+    uint8_t type;                   /* RFC 2435 type, 0 = 4:2:2, 1 = 4:2:0, +64 with restart markers */
+    uint16_t dri;
+    const uint8_t *qt[2];           /* 8-bit luma / chroma quantization tables */
+    const uint8_t *scan;            /* entropy coded data, without EOI */
+    size_t scan_len;
+} jpeg_info_t;
+
+typedef struct {
+    int ctrl_fd;
+    int rtp_fd;
+    struct sockaddr_in peer;        /* peer address, port replaced by client_port from SETUP */
+    uint16_t server_port;
+    uint32_t session_id;
+    uint32_t ssrc;
+    uint16_t seq;
+    bool setup;
+    bool playing;
+    char rx[RTSP_RX_BUF_SIZE];
+    size_t rx_len;
+    char tx[RTSP_TX_BUF_SIZE];
+} rtsp_session_t;
+
+static SemaphoreHandle_t s_session_slots = NULL;    /* one count per free session */
+
+/* ------------------------------------------------------------------ */
+/* JPEG                                                                */
+/* ------------------------------------------------------------------ */
+
+static inline uint16_t _be16(const uint8_t *p)
+{
+    return (p[0] << 8) | p[1];
+}
+
+/* walk the markers up to SOS, everything after it up to EOI is the scan */
+static bool jpeg_parse(const uint8_t *buf, size_t len, jpeg_info_t *info)
+{
+    memset(info, 0, sizeof(*info));
+    if (len < 4 || buf[0] != 0xFF || buf[1] != 0xD8) {
+        return false;
+    }
+    bool sof = false;
+    size_t i = 2;
+    while (i + 4 <= len) {
+        if (buf[i] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = buf[i + 1];
+        if (marker == 0xFF) {
+            i++;
+            continue;
+        }
+        size_t seg_len = _be16(&buf[i + 2]);
+        const uint8_t *seg = &buf[i + 4];
+        if (seg_len < 2 || i + 2 + seg_len > len) {
+            return false;
+        }
+        size_t body_len = seg_len - 2;
+
+        switch (marker) {
+        case 0xDB: /* DQT, may hold several tables */
+            for (size_t j = 0; j + 65 <= body_len; j += 65) {
+                if ((seg[j] >> 4) != 0) {
+                    ESP_LOGW(TAG, "16-bit quantization table not supported");
+                    return false;
+                }
+                uint8_t id = seg[j] & 0x0F;
+                if (id < 2) {
+                    info->qt[id] = &seg[j + 1];
+                }
+            }
+            break;
+        case 0xC0: /* SOF0 baseline */
+        case 0xC1:
+            if (body_len < 9) {
+                return false;
+            }
+            info->height = _be16(&seg[1]);
+            info->width = _be16(&seg[3]);
+            /* luma sampling factors decide the type, chroma must be 1x1 */
+            if (seg[7] == 0x21) {
+                info->type = 0;
+            } else if (seg[7] == 0x22) {
+                info->type = 1;
+            } else {
+                ESP_LOGW(TAG, "Unsupported sampling 0x%02x", seg[7]);
+                return false;
+            }
+            sof = true;
+            break;
+        case 0xDD: /* DRI */
+            if (body_len >= 2) {
+                info->dri = _be16(seg);
+            }
+            break;
+        case 0xDA: { /* SOS */
+            size_t start = i + 2 + seg_len;
+            size_t end = len;
+            /* drop EOI and any padding after it */
+            while (end > start + 2 && !(buf[end - 2] == 0xFF && buf[end - 1] == 0xD9)) {
+                end--;
+            }
+            if (end > start + 2) {
+                end -= 2;
+            }
+            info->scan = &buf[start];
+            info->scan_len = end - start;
+            if (!info->qt[1]) {
+                info->qt[1] = info->qt[0];
+            }
+            if (info->dri) {
+                info->type += 64;
+            }
+            /* the JPEG header carries the size in 8 pixel units */
+            return sof && info->qt[0] && info->width <= 2040 && info->height <= 2040;
+        }
+        default:
+            break;
+        }
+        i += 2 + seg_len;
+    }
+    return false;
+}
+
+/* ------------------------------------------------------------------ */
+/* RTP                                                                 */
+/* ------------------------------------------------------------------ */
+
+static esp_err_t rtp_send_frame(rtsp_session_t *s, const camera_fb_t *fb)
+{
+    jpeg_info_t info;
+    if (!jpeg_parse(fb->buf, fb->len, &info)) {
+        ESP_LOGW(TAG, "Drop frame that is not baseline JPEG");
+        return ESP_OK;
+    }
+
+    uint8_t hdr[RTP_HDR_LEN + RTP_JPEG_HDR_LEN + RTP_RESTART_HDR_LEN + RTP_QTABLE_HDR_LEN];
+    struct iovec iov[4];
+    struct msghdr msg = {
+        .msg_name = &s->peer,
+        .msg_namelen = sizeof(s->peer),
+        .msg_iov = iov,
+    };
+    uint32_t ts = (uint32_t)(esp_timer_get_time() * (RTP_CLOCK_HZ / 1000) / 1000);
+    size_t offset = 0;
+
+    while (offset < info.scan_len) {
+        size_t h = 0;
+        /* RTP header */
+        hdr[h++] = 0x80;
+        hdr[h++] = RTP_PT_JPEG;
+        hdr[h++] = s->seq >> 8;
+        hdr[h++] = s->seq & 0xFF;
+        hdr[h++] = ts >> 24;
+        hdr[h++] = ts >> 16;
+        hdr[h++] = ts >> 8;
+        hdr[h++] = ts;
+        hdr[h++] = s->ssrc >> 24;
+        hdr[h++] = s->ssrc >> 16;
+        hdr[h++] = s->ssrc >> 8;
+        hdr[h++] = s->ssrc;
+        /* JPEG header, Q = 255 means the tables travel in the first packet */
+        hdr[h++] = 0;
+        hdr[h++] = offset >> 16;
+        hdr[h++] = offset >> 8;
+        hdr[h++] = offset;
+        hdr[h++] = info.type;
+        hdr[h++] = 255;
+        hdr[h++] = info.width / 8;
+        hdr[h++] = info.height / 8;
+        if (info.dri) {
+            hdr[h++] = info.dri >> 8;
+            hdr[h++] = info.dri;
+            hdr[h++] = 0xFF;   /* F = L = 1, count 0x3FFF: packets are not aligned to restart intervals */
+            hdr[h++] = 0xFF;
+        }
+        msg.msg_iovlen = 1;
+        size_t room = RTP_PAYLOAD_MAX - (h - RTP_HDR_LEN);
+        if (offset == 0) {
+            hdr[h++] = 0;
+            hdr[h++] = 0;      /* 8-bit precision */
+            hdr[h++] = 0;
+            hdr[h++] = 128;
+            iov[1].iov_base = (void *)info.qt[0];
+            iov[1].iov_len = 64;
+            iov[2].iov_base = (void *)info.qt[1];
+            iov[2].iov_len = 64;
+            msg.msg_iovlen = 3;
+            room -= RTP_QTABLE_HDR_LEN + 128;
+        }
+        iov[0].iov_base = hdr;
+        iov[0].iov_len = h;
+
+        size_t n = info.scan_len - offset;
+        if (n > room) {
+            n = room;
+        } else {
+            hdr[1] |= 0x80;    /* marker on the last packet of the frame */
+        }
+        iov[msg.msg_iovlen].iov_base = (void *)(info.scan + offset);
+        iov[msg.msg_iovlen].iov_len = n;
+        msg.msg_iovlen++;
+
+        if (sendmsg(s->rtp_fd, &msg, 0) < 0) {
+            if (errno == ENOMEM || errno == EAGAIN) {
+                /* lwip is out of buffers: give up on this frame, the receiver waits for the next marker */
+                ESP_LOGD(TAG, "RTP send backlog, drop rest of frame");
+                s->seq++;
+                return ESP_OK;
+            }
+            ESP_LOGW(TAG, "RTP send failed, errno %d", errno);
+            return ESP_FAIL;
+        }
+        s->seq++;
+        offset += n;
+    }
+    return ESP_OK;
+}
+
+/* ------------------------------------------------------------------ */
+/* RTSP                                                                */
+/* ------------------------------------------------------------------ */
+
+/* value of header name in req, terminated by CR, or NULL */
+static const char *rtsp_header(const char *req, const char *name)
+{
+    size_t name_len = strlen(name);
+    const char *p = strstr(req, "\r\n");
+    while (p && p[2] != '\r') {
+        p += 2;
+        if (strncasecmp(p, name, name_len) == 0 && p[name_len] == ':') {
+            p += name_len + 1;
+            while (*p == ' ') {
+                p++;
+            }
+            return p;
+        }
+        p = strstr(p, "\r\n");
+    }
+    return NULL;
+}
+
+static esp_err_t rtsp_reply(rtsp_session_t *s, const char *status, int cseq, const char *extra, const char *body)
+{
+    int len = snprintf(s->tx, sizeof(s->tx), "RTSP/1.0 %s\r\nCSeq: %d\r\n%s", status, cseq, extra ? extra : "");
+    if (body) {
+        len += snprintf(s->tx + len, sizeof(s->tx) - len, "Content-Type: application/sdp\r\nContent-Length: %u\r\n\r\n%s",
+                        (unsigned)strlen(body), body);
+    } else {
+        len += snprintf(s->tx + len, sizeof(s->tx) - len, "\r\n");
+    }
+    if (len >= sizeof(s->tx)) {
+        return ESP_FAIL;
+    }
+    return send(s->ctrl_fd, s->tx, len, 0) == len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t rtsp_setup(rtsp_session_t *s, const char *req, int cseq)
+{
+    const char *transport = rtsp_header(req, "Transport");
+    char value[128] = {0};
+    if (transport) {
+        const char *eol = strstr(transport, "\r\n");
+        size_t len = eol ? eol - transport : strlen(transport);
+        memcpy(value, transport, len < sizeof(value) ? len : sizeof(value) - 1);
+    }
+    const char *port = strstr(value, "client_port=");
+    if (!port || strstr(value, "TCP") || strstr(value, "interleaved") || strstr(value, "multicast")) {
+        return rtsp_reply(s, "461 Unsupported Transport", cseq, NULL, NULL);
+    }
+    uint16_t client_port = atoi(port + strlen("client_port="));
+
+    if (s->rtp_fd < 0) {
+        s->rtp_fd = socket(AF_INET, SOCK_DGRAM, IPPROTO_UDP);
+        struct sockaddr_in local = {
+            .sin_family = AF_INET,
+            .sin_addr.s_addr = htonl(INADDR_ANY),
+            .sin_port = 0,
+        };
+        socklen_t local_len = sizeof(local);
+        if (s->rtp_fd < 0 || bind(s->rtp_fd, (struct sockaddr *)&local, sizeof(local)) < 0
+                || getsockname(s->rtp_fd, (struct sockaddr *)&local, &local_len) < 0) {
+            ESP_LOGE(TAG, "Failed to create RTP socket, errno %d", errno);
+            return rtsp_reply(s, "500 Internal Server Error", cseq, NULL, NULL);
+        }
+        s->server_port = ntohs(local.sin_port);
+    }
+    s->peer.sin_port = htons(client_port);
+    s->setup = true;
+
+    char extra[160];
+    snprintf(extra, sizeof(extra),
+             "Transport: RTP/AVP;unicast;client_port=%u-%u;server_port=%u-%u\r\nSession: %08lX;timeout=%d\r\n",
+             client_port, client_port + 1, s->server_port, s->server_port + 1,
+             (unsigned long)s->session_id, RTSP_SESSION_TIMEOUT_S);
+    return rtsp_reply(s, "200 OK", cseq, extra, NULL);
+}
+
+/* handle one complete request, returns ESP_FAIL to close the session */
+static esp_err_t rtsp_handle(rtsp_session_t *s, const char *req)
+{
+    const char *cseq_hdr = rtsp_header(req, "CSeq");
+    int cseq = cseq_hdr ? atoi(cseq_hdr) : 0;
+    char session[48];
+    snprintf(session, sizeof(session), "Session: %08lX\r\n", (unsigned long)s->session_id);
+
+    if (strncmp(req, "OPTIONS ", 8) == 0) {
+        return rtsp_reply(s, "200 OK", cseq, "Public: OPTIONS, DESCRIBE, SETUP, PLAY, TEARDOWN, GET_PARAMETER\r\n", NULL);
+    }
+    if (strncmp(req, "DESCRIBE ", 9) == 0) {
+        struct sockaddr_in local;
+        socklen_t local_len = sizeof(local);
+        getsockname(s->ctrl_fd, (struct sockaddr *)&local, &local_len);
+        char sdp[200];
+        snprintf(sdp, sizeof(sdp),
+                 "v=0\r\no=- %lu 1 IN IP4 %s\r\ns=doorbell\r\nc=IN IP4 0.0.0.0\r\nt=0 0\r\n"
+                 "m=video 0 RTP/AVP %d\r\na=rtpmap:%d JPEG/%d\r\na=control:track0\r\n",
+                 (unsigned long)s->session_id, inet_ntoa(local.sin_addr), RTP_PT_JPEG, RTP_PT_JPEG, RTP_CLOCK_HZ);
+        return rtsp_reply(s, "200 OK", cseq, NULL, sdp);
+    }
+    if (strncmp(req, "SETUP ", 6) == 0) {
+        return rtsp_setup(s, req, cseq);
+    }
+    if (strncmp(req, "PLAY ", 5) == 0) {
+        if (!s->setup) {
+            return rtsp_reply(s, "455 Method Not Valid in This State", cseq, NULL, NULL);
+        }
+        s->playing = true;
+        ESP_LOGI(TAG, "Session %08lX playing to %s:%u", (unsigned long)s->session_id,
+                 inet_ntoa(s->peer.sin_addr), ntohs(s->peer.sin_port));
+        return rtsp_reply(s, "200 OK", cseq, session, NULL);
+    }
+    if (strncmp(req, "GET_PARAMETER ", 14) == 0) {
+        /* keep-alive */
+        return rtsp_reply(s, "200 OK", cseq, session, NULL);
+    }
+    if (strncmp(req, "TEARDOWN ", 9) == 0) {
+        rtsp_reply(s, "200 OK", cseq, session, NULL);
+        return ESP_FAIL;
+    }
+    return rtsp_reply(s, "501 Not Implemented", cseq, NULL, NULL);
+}
+
+/* read what is available on the control socket and handle complete requests */
+static esp_err_t rtsp_poll(rtsp_session_t *s, int timeout_ms, bool *received)
+{
+    *received = false;
+    fd_set rfds;
+    FD_ZERO(&rfds);
+    FD_SET(s->ctrl_fd, &rfds);
+    struct timeval tv = {
+        .tv_sec = timeout_ms / 1000,
+        .tv_usec = (timeout_ms % 1000) * 1000,
+    };
+    int ret = select(s->ctrl_fd + 1, &rfds, NULL, NULL, &tv);
+    if (ret < 0) {
+        return ESP_FAIL;
+    }
+    if (ret == 0) {
+        return ESP_OK;
+    }
+
+    int n = recv(s->ctrl_fd, s->rx + s->rx_len, sizeof(s->rx) - 1 - s->rx_len, 0);
+    if (n <= 0) {
+        return ESP_FAIL;
+    }
+    s->rx_len += n;
+    s->rx[s->rx_len] = '\0';
+    *received = true;
+
+    char *end;
+    while ((end = strstr(s->rx, "\r\n\r\n")) != NULL) {
+        end += 4;
+        /* skip a body (SET_PARAMETER etc.), none of the handled methods uses it */
+        const char *cl = rtsp_header(s->rx, "Content-Length");
+        size_t body = cl ? atoi(cl) : 0;
+        size_t req_len = end - s->rx + body;
+        if (req_len > s->rx_len) {
+            break;
+        }
+        end[-2] = '\0';
+        if (rtsp_handle(s, s->rx) != ESP_OK) {
+            return ESP_FAIL;
+        }
+        memmove(s->rx, s->rx + req_len, s->rx_len - req_len + 1);
+        s->rx_len -= req_len;
+    }
+    if (s->rx_len >= sizeof(s->rx) - 1) {
+        ESP_LOGW(TAG, "Request too long");
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void rtsp_session_task(void *arg)
+{
+    rtsp_session_t *s = (rtsp_session_t *)arg;
+    frame_bus_sub_t *sub = NULL;
+    int64_t last_rx = esp_timer_get_time();
+
+    while (true) {
+        bool received;
+        if (rtsp_poll(s, s->playing ? 0 : RTSP_FRAME_WAIT_MS, &received) != ESP_OK) {
+            break;
+        }
+        if (received) {
+            last_rx = esp_timer_get_time();
+        }
+        if (s->playing && !sub) {
+            sub = frame_bus_subscribe();
+            if (!sub) {
+                break;
+            }
+        }
+        if (sub) {
+            camera_fb_t *fb = frame_bus_wait(sub, RTSP_FRAME_WAIT_MS);
+            if (fb) {
+                esp_err_t ret = rtp_send_frame(s, fb);
+                frame_bus_done(sub);
+                if (ret != ESP_OK) {
+                    break;
+                }
+            }
+        }
+        /* a playing client keeps the session alive with GET_PARAMETER or OPTIONS */
+        if (esp_timer_get_time() - last_rx > RTSP_SESSION_TIMEOUT_S * 1000000LL) {
+            ESP_LOGW(TAG, "Session %08lX timeout", (unsigned long)s->session_id);
+            break;
+        }
+    }
+
+    ESP_LOGI(TAG, "Session %08lX closed, skipped %lu frames", (unsigned long)s->session_id,
+             frame_bus_skipped(sub));
+    frame_bus_unsubscribe(sub);
+    if (s->rtp_fd >= 0) {
+        close(s->rtp_fd);
+    }
+    close(s->ctrl_fd);
+    free(s);
+    xSemaphoreGive(s_session_slots);
+    vTaskDelete(NULL);
+}
+
+static void rtsp_listen_task(void *arg)
+{
+    int listen_fd = socket(AF_INET, SOCK_STREAM, IPPROTO_TCP);
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+        .sin_port = htons(CONFIG_XFER_HTTP_RTSP_PORT),
+    };
+    int opt = 1;
+    setsockopt(listen_fd, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+    if (listen_fd < 0 || bind(listen_fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 || listen(listen_fd, 2) < 0) {
+        ESP_LOGE(TAG, "Failed to listen on port %d, errno %d", CONFIG_XFER_HTTP_RTSP_PORT, errno);
+        if (listen_fd >= 0) {
+            close(listen_fd);
+        }
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "Starting RTSP server on port: '%d'", CONFIG_XFER_HTTP_RTSP_PORT);
+
+    while (true) {
+        struct sockaddr_in peer;
+        socklen_t peer_len = sizeof(peer);
+        int fd = accept(listen_fd, (struct sockaddr *)&peer, &peer_len);
+        if (fd < 0) {
+            vTaskDelay(pdMS_TO_TICKS(100));
+            continue;
+        }
+        if (xSemaphoreTake(s_session_slots, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "Too many sessions, reject %s", inet_ntoa(peer.sin_addr));
+            close(fd);
+            continue;
+        }
+        rtsp_session_t *s = calloc(1, sizeof(rtsp_session_t));
+        if (!s) {
+            xSemaphoreGive(s_session_slots);
+            close(fd);
+            continue;
+        }
+        opt = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &opt, sizeof(opt));
+        s->ctrl_fd = fd;
+        s->rtp_fd = -1;
+        s->peer = peer;
+        s->session_id = esp_random();
+        s->ssrc = esp_random();
+        s->seq = esp_random();
+        if (xTaskCreate(rtsp_session_task, "rtsp_sess", RTSP_TASK_STACK, s, RTSP_TASK_PRIO, NULL) != pdPASS) {
+            xSemaphoreGive(s_session_slots);
+            close(fd);
+            free(s);
+        }
+    }
+}
+
+esp_err_t rtsp_server_start(void)
+{
+    if (s_session_slots) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_session_slots = xSemaphoreCreateCounting(CONFIG_XFER_HTTP_RTSP_MAX_SESSIONS, CONFIG_XFER_HTTP_RTSP_MAX_SESSIONS);
+    if (!s_session_slots) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(rtsp_listen_task, "rtsp", 3072, NULL, RTSP_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create RTSP task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t rtsp_server_start(void)
+{
+    ESP_LOGD(TAG, "RTSP disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif
@@ -0,0 +1,258 @@
+/**
+ * @file board_power.c
+ * @brief ESP32-S3-USB-OTG 开发板电源档位：摄像头 VBUS 通断、CPU 调频与 LCD 背光
+ */
+
+#include "board_power.h"
+#include <stdbool.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#include "bsp/esp32_s3_usb_otg.h"
+#include "bsp/display.h"
+#include "cc_hal_sys.h"
+#include "cc_worker.h"
+#include "metrics.h"
+#include "uvc_camera.h"
+
+static const char *TAG = "board_power";
+
+#if CONFIG_BOARD_POWER_VBUS_BATTERY
+#define BOARD_VBUS_SOURCE       BSP_USB_HOST_POWER_MODE_BATTERY
+#else
+#define BOARD_VBUS_SOURCE       BSP_USB_HOST_POWER_MODE_USB_DEV
+#endif
+
+// 断电时仍有使用者持有帧，隔这么久再试
+#define BOARD_IDLE_RETRY_MS     1000
+
+static const char *const s_profile_names[] = { "idle", "armed", "capturing", "streaming" };
+
+static SemaphoreHandle_t s_mutex = NULL;
+static TimerHandle_t s_arm_timer = NULL;       // ARMED 保持窗口，到期后断电
+static uint8_t s_holds[BOARD_HOLD_MAX];
+static bool s_armed = false;
+static bool s_vbus_on = false;
+static board_power_profile_t s_profile = BOARD_POWER_IDLE;
+
+// 上电到摄像头就绪的时间，由之后第一个等待就绪的持有者统计
+static uint32_t s_vbus_on_ms = 0;
+static bool s_wake_pending = false;
+static metrics_hist_t s_wake_ms = METRICS_HIST_INIT("board.wake_ms");
+
+#if CONFIG_PM_ENABLE
+static esp_pm_lock_handle_t s_cpu_lock = NULL;  // CAPTURING/STREAMING 期间 CPU 最高频
+static bool s_cpu_held = false;
+#endif
+
+static esp_err_t vbus_set(bool on)
+{
+    // 限流 500 mA，摄像头插拔时不拖垮板上供电
+    esp_err_t ret = bsp_usb_host_power_mode(on ? BOARD_VBUS_SOURCE : BSP_USB_HOST_POWER_MODE_OFF, true);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    s_vbus_on = on;
+    if (on) {
+        s_vbus_on_ms = (uint32_t)cc_hal_sys_get_ms();
+        s_wake_pending = true;
+    }
+    ESP_LOGI(TAG, "Camera VBUS %s", on ? "on" : "off");
+    return ESP_OK;
+}
+
+// 按持有情况切换档位（持锁调用）
+static void update_locked(void)
+{
+    board_power_profile_t target = s_holds[BOARD_HOLD_STREAM] ? BOARD_POWER_STREAMING
+                                 : s_holds[BOARD_HOLD_CAPTURE] ? BOARD_POWER_CAPTURING
+                                 : s_armed ? BOARD_POWER_ARMED : BOARD_POWER_IDLE;
+
+    if (target != BOARD_POWER_IDLE && !s_vbus_on) {
+        if (vbus_set(true) != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to power the camera");
+        }
+    } else if (target == BOARD_POWER_IDLE && s_vbus_on) {
+        // 先挂起视频流再断电，重新枚举后仍保持挂起，按需恢复
+        esp_err_t ret = uvc_camera_power_off_prepare();
+        if (ret == ESP_OK) {
+            ret = vbus_set(false);
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGD(TAG, "Camera busy (0x%x), power off later", ret);
+            xTimerChangePeriod(s_arm_timer, pdMS_TO_TICKS(BOARD_IDLE_RETRY_MS), 0);
+            target = BOARD_POWER_ARMED;
+        }
+    }
+
+#if CONFIG_PM_ENABLE
+    bool cpu = target >= BOARD_POWER_CAPTURING;
+    if (s_cpu_lock && cpu != s_cpu_held) {
+        if (cpu) {
+            esp_pm_lock_acquire(s_cpu_lock);
+        } else {
+            esp_pm_lock_release(s_cpu_lock);
+        }
+        s_cpu_held = cpu;
+    }
+#endif
+
+    if (target != s_profile) {
+        s_profile = target;
+        ESP_LOGI(TAG, "Board power -> %s", s_profile_names[target]);
+    }
+}
+
+// 进入或延长 ARMED 窗口（持锁调用）
+static void arm_locked(void)
+{
+    s_armed = true;
+    xTimerChangePeriod(s_arm_timer, pdMS_TO_TICKS(CONFIG_BOARD_POWER_ARM_MS), 0);
+}
+
+static void update_job(void *arg)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+static void disarm_job(void *arg)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // 提交后又有门锁事件或抓拍结束，窗口已重新计时
+    if (!xTimerIsTimerActive(s_arm_timer)) {
+        s_armed = false;
+        update_locked();
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+// 断电要等摄像头挂起且有 10 ms 的切换延时，不在定时器任务中做
+static void arm_timer_cb(TimerHandle_t timer)
+{
+    if (cc_worker_submit(disarm_job, NULL, CC_WORKER_PRIO_LOW) != CC_OK) {
+        ESP_LOGW(TAG, "Failed to submit disarm job");
+        xTimerChangePeriod(s_arm_timer, pdMS_TO_TICKS(BOARD_IDLE_RETRY_MS), 0);
+    }
+}
+
+esp_err_t board_power_init(void)
+{
+    if (s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    s_arm_timer = xTimerCreate("board_arm", pdMS_TO_TICKS(CONFIG_BOARD_POWER_ARM_MS), pdFALSE, NULL, arm_timer_cb);
+    if (!s_mutex || !s_arm_timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_register(&s_wake_ms.head);
+
+    // 背光 PWM 占空比为 0，LCD 面板不初始化
+    if (bsp_display_brightness_init() != ESP_OK || bsp_display_backlight_off() != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to turn off LCD backlight");
+    }
+
+#if CONFIG_PM_ENABLE
+#if !CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    // 开启 light sleep 时由 power_profile 配置调频范围
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_BOARD_POWER_MIN_FREQ_MHZ,
+    };
+    esp_err_t pm_ret = esp_pm_configure(&pm_config);
+    if (pm_ret != ESP_OK) {
+        ESP_LOGW(TAG, "esp_pm_configure failed: %s", esp_err_to_name(pm_ret));
+    }
+#endif
+    if (esp_pm_lock_create(ESP_PM_CPU_FREQ_MAX, 0, "board_cpu", &s_cpu_lock) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create CPU frequency lock");
+        s_cpu_lock = NULL;
+    }
+#endif
+
+    esp_err_t ret = bsp_usb_mode_select_host();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to select USB host port: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    // 开机时摄像头要完成枚举与预热，窗口到期后才断电
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    arm_locked();
+    update_locked();
+    xSemaphoreGive(s_mutex);
+    return ESP_OK;
+}
+
+void board_power_arm(void)
+{
+    if (!s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    arm_locked();
+    bool apply = !s_vbus_on;
+    xSemaphoreGive(s_mutex);
+    // 在 UART 等处理任务中调用，上电交给工作任务，不阻塞应答
+    if (apply && cc_worker_submit(update_job, NULL, CC_WORKER_PRIO_HIGH) != CC_OK) {
+        ESP_LOGW(TAG, "Failed to submit power-up job");
+    }
+}
+
+esp_err_t board_power_hold(board_hold_t reason)
+{
+    if (reason >= BOARD_HOLD_MAX || !s_mutex) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason] < UINT8_MAX) {
+        s_holds[reason]++;
+    }
+    update_locked();
+    bool measure = s_wake_pending;
+    uint32_t on_ms = s_vbus_on_ms;
+    s_wake_pending = false;
+    xSemaphoreGive(s_mutex);
+
+    if (uvc_camera_wait_ready(0)) {
+        return ESP_OK;
+    }
+    // 刚上电的摄像头正在重新枚举
+    if (!uvc_camera_wait_ready(CONFIG_BOARD_POWER_WAKE_TIMEOUT_MS)) {
+        ESP_LOGW(TAG, "Camera not ready %d ms after hold", CONFIG_BOARD_POWER_WAKE_TIMEOUT_MS);
+        return ESP_ERR_TIMEOUT;
+    }
+    if (measure) {
+        uint32_t ms = (uint32_t)cc_hal_sys_get_ms() - on_ms;
+        metrics_hist_record(&s_wake_ms, ms);
+        ESP_LOGI(TAG, "Camera ready %lu ms after power-up", ms);
+    }
+    return ESP_OK;
+}
+
+void board_power_release(board_hold_t reason)
+{
+    if (reason >= BOARD_HOLD_MAX || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason]) {
+        s_holds[reason]--;
+    } else {
+        ESP_LOGW(TAG, "Release without hold, reason %d", reason);
+    }
+    // 连续的门铃事件不必每次重新枚举
+    arm_locked();
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+board_power_profile_t board_power_get(void)
+{
+    return s_profile;
+}
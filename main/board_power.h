@@ -0,0 +1,82 @@
+/**
+ * @file board_power.h
+ * @brief ESP32-S3-USB-OTG 开发板电源档位：摄像头 VBUS 通断、CPU 调频与 LCD 背光（CONFIG_BOARD_POWER）
+ *
+ * 档位由持有情况决定，取最高的一档：
+ *   IDLE       摄像头断电，CPU 可降到最低频率
+ *   ARMED      摄像头上电并保持枚举，视频流挂起；门锁事件或抓拍结束后保持 CONFIG_BOARD_POWER_ARM_MS
+ *   CAPTURING  图传抓拍，持有 CPU 最高频
+ *   STREAMING  帧广播有实时观看者，持有 CPU 最高频
+ * 开机时先进入 ARMED 完成枚举与预热。ARMED 超时后先挂起视频流再断电，仍有使用者持有帧时稍后重试。
+ * 重新上电后由 usb_stream 的快速重连（CONFIG_USB_STREAM_FAST_RECONNECT）跳过配置描述符与 PROBE，
+ * 持有 CAPTURING/STREAMING 时等待摄像头就绪，最多 CONFIG_BOARD_POWER_WAKE_TIMEOUT_MS。
+ * 本应用不使用 LCD，初始化时关闭背光。
+ *
+ * 指标：board.wake_ms（上电到摄像头就绪的时间）。
+ */
+
+#ifndef BOARD_POWER_H
+#define BOARD_POWER_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    BOARD_POWER_IDLE = 0,
+    BOARD_POWER_ARMED,
+    BOARD_POWER_CAPTURING,
+    BOARD_POWER_STREAMING,
+} board_power_profile_t;
+
+typedef enum {
+    BOARD_HOLD_CAPTURE = 0,     // 图传抓拍与上传
+    BOARD_HOLD_STREAM,          // 帧广播有订阅者
+    BOARD_HOLD_MAX,
+} board_hold_t;
+
+#if CONFIG_BOARD_POWER
+
+/**
+ * @brief 切到 USB 主机口并给摄像头上电（ARMED），关闭 LCD 背光，须在 cc_worker_init() 之后、
+ *        uvc_camera_start() 之前调用
+ */
+esp_err_t board_power_init(void);
+
+/**
+ * @brief 门锁事件：摄像头提前上电，CONFIG_BOARD_POWER_ARM_MS 内不断电，重复调用从最后一次起计时；不等待就绪
+ */
+void board_power_arm(void);
+
+/**
+ * @brief 持有档位，同一原因可嵌套持有，须与 board_power_release() 成对调用；摄像头断电时上电并等待就绪
+ *
+ * @return ESP_ERR_TIMEOUT 等待就绪超时，仍算持有
+ */
+esp_err_t board_power_hold(board_hold_t reason);
+
+/**
+ * @brief 释放档位，全部释放后回到 ARMED 并重新计时
+ */
+void board_power_release(board_hold_t reason);
+
+board_power_profile_t board_power_get(void);
+
+#else
+
+static inline esp_err_t board_power_init(void) { return ESP_OK; }
+static inline void board_power_arm(void) {}
+static inline esp_err_t board_power_hold(board_hold_t reason) { return ESP_OK; }
+static inline void board_power_release(board_hold_t reason) {}
+static inline board_power_profile_t board_power_get(void) { return BOARD_POWER_STREAMING; }
+
+#endif // CONFIG_BOARD_POWER
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOARD_POWER_H
@@ -0,0 +1,232 @@
+/**
+ * @file boot_graph.c
+ * @brief 启动阶段的依赖图调度
+ */
+
+#include "boot_graph.h"
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/task.h"
+#include "freertos/event_groups.h"
+
+static const char *TAG = "boot_graph";
+
+typedef struct {
+    boot_graph_node_t node;
+    boot_graph_id_t id;
+    bool started;
+    bool done;
+    esp_err_t result;
+    uint32_t start_ms;
+    uint32_t done_ms;
+} graph_node_t;
+
+typedef struct {
+    const char *name;
+    uint32_t us;
+} boot_mark_t;
+
+static graph_node_t s_nodes[BOOT_GRAPH_NODE_MAX];
+static boot_mark_t s_marks[BOOT_GRAPH_MARK_MAX];
+static uint8_t s_mark_num = 0;
+static uint8_t s_node_num = 0;
+static uint32_t s_done_mask = 0;
+static bool s_started = false;
+static EventGroupHandle_t s_done_bits = NULL;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static uint32_t now_ms(void)
+{
+    return (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// 取出依赖已全部完成、尚未开始的执行节点并标记为已开始（持锁调用）
+static uint32_t take_ready_locked(void)
+{
+    uint32_t ready = 0;
+    for (uint8_t i = 0; i < s_node_num; i++) {
+        graph_node_t *n = &s_nodes[i];
+        if (n->node.fn && !n->started && (n->node.deps & ~s_done_mask) == 0) {
+            n->started = true;
+            n->start_ms = now_ms();
+            ready |= BOOT_GRAPH_DEP(i);
+        }
+    }
+    return ready;
+}
+
+static void complete(graph_node_t *n, esp_err_t result);
+
+static void node_task(void *arg)
+{
+    graph_node_t *n = (graph_node_t *)arg;
+    esp_err_t result = n->node.fn(n->node.arg);
+    complete(n, result);
+    vTaskDelete(NULL);
+}
+
+static void run_ready(uint32_t ready)
+{
+    for (uint8_t i = 0; i < s_node_num && ready; i++) {
+        if (!(ready & BOOT_GRAPH_DEP(i))) {
+            continue;
+        }
+        ready &= ~BOOT_GRAPH_DEP(i);
+        graph_node_t *n = &s_nodes[i];
+        ESP_LOGI(TAG, "start %s", n->node.name);
+        if (xTaskCreate(node_task, n->node.name, n->node.stack_size, n, n->node.prio, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create task for %s", n->node.name);
+            // 后继节点照常执行，与节点自身失败的处理一致
+            complete(n, ESP_ERR_NO_MEM);
+        }
+    }
+}
+
+static void complete(graph_node_t *n, esp_err_t result)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (n->done) {
+        portEXIT_CRITICAL(&s_lock);
+        return;
+    }
+    n->done = true;
+    n->result = result;
+    n->done_ms = now_ms();
+    s_done_mask |= BOOT_GRAPH_DEP(n->id);
+    uint32_t ready = s_started ? take_ready_locked() : 0;
+    portEXIT_CRITICAL(&s_lock);
+
+    xEventGroupSetBits(s_done_bits, BOOT_GRAPH_DEP(n->id));
+    if (result == ESP_OK) {
+        ESP_LOGI(TAG, "%s done at %lu ms", n->node.name, n->done_ms);
+    } else {
+        ESP_LOGW(TAG, "%s done at %lu ms with %s", n->node.name, n->done_ms, esp_err_to_name(result));
+    }
+    run_ready(ready);
+}
+
+esp_err_t boot_graph_add(const boot_graph_node_t *node, boot_graph_id_t *id)
+{
+    if (!node || !node->name || !id) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    // 依赖只能指向已添加的节点；事件节点由外部标记完成，不声明依赖
+    if ((node->deps >> s_node_num) != 0 || (!node->fn && node->deps)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_started) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_node_num >= BOOT_GRAPH_NODE_MAX) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!s_done_bits) {
+        s_done_bits = xEventGroupCreate();
+        if (!s_done_bits) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+
+    graph_node_t *n = &s_nodes[s_node_num];
+    memset(n, 0, sizeof(*n));
+    n->node = *node;
+    n->id = s_node_num;
+    if (!n->node.stack_size) {
+        n->node.stack_size = BOOT_GRAPH_DEFAULT_STACK;
+    }
+    if (!n->node.prio) {
+        n->node.prio = BOOT_GRAPH_DEFAULT_PRIO;
+    }
+    // 节点内容写完后再计数，complete() 只会看到完整的节点
+    portENTER_CRITICAL(&s_lock);
+    s_node_num++;
+    portEXIT_CRITICAL(&s_lock);
+
+    *id = n->id;
+    return ESP_OK;
+}
+
+esp_err_t boot_graph_start(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    if (s_started) {
+        portEXIT_CRITICAL(&s_lock);
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_started = true;
+    uint32_t ready = take_ready_locked();
+    portEXIT_CRITICAL(&s_lock);
+
+    ESP_LOGI(TAG, "boot graph started with %u nodes at %lu ms", s_node_num, now_ms());
+    run_ready(ready);
+    return ESP_OK;
+}
+
+void boot_graph_done(boot_graph_id_t id, esp_err_t result)
+{
+    if (id >= s_node_num || s_nodes[id].node.fn) {
+        return;
+    }
+    complete(&s_nodes[id], result);
+}
+
+bool boot_graph_is_done(boot_graph_id_t id)
+{
+    return id < s_node_num && (s_done_mask & BOOT_GRAPH_DEP(id));
+}
+
+bool boot_graph_wait(uint32_t mask, uint32_t timeout_ms)
+{
+    if (!s_done_bits) {
+        return false;
+    }
+    EventBits_t bits = xEventGroupWaitBits(s_done_bits, mask, pdFALSE, pdTRUE,
+                                           timeout_ms == portMAX_DELAY ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    return (bits & mask) == mask;
+}
+
+void boot_graph_mark(const char *name)
+{
+    if (s_mark_num >= BOOT_GRAPH_MARK_MAX) {
+        return;
+    }
+    s_marks[s_mark_num].name = name;
+    s_marks[s_mark_num].us = (uint32_t)esp_timer_get_time();
+    s_mark_num++;
+}
+
+uint8_t boot_graph_mark_num(void)
+{
+    return s_mark_num;
+}
+
+bool boot_graph_mark_get(uint8_t i, const char **name, uint32_t *us)
+{
+    if (i >= s_mark_num) {
+        return false;
+    }
+    *name = s_marks[i].name;
+    *us = s_marks[i].us;
+    return true;
+}
+
+void boot_graph_dump(void)
+{
+    uint32_t prev = 0;
+    for (uint8_t i = 0; i < s_mark_num; i++) {
+        ESP_LOGI(TAG, "%-12s at %6lu us  +%lu us", s_marks[i].name, s_marks[i].us, s_marks[i].us - prev);
+        prev = s_marks[i].us;
+    }
+    for (uint8_t i = 0; i < s_node_num; i++) {
+        const graph_node_t *n = &s_nodes[i];
+        if (!n->done) {
+            ESP_LOGI(TAG, "%-12s %s", n->node.name, n->started ? "running" : "waiting");
+        } else if (n->node.fn) {
+            ESP_LOGI(TAG, "%-12s start %6lu ms  done %6lu ms  %s", n->node.name, n->start_ms, n->done_ms,
+                     esp_err_to_name(n->result));
+        } else {
+            ESP_LOGI(TAG, "%-12s event %6lu ms  %s", n->node.name, n->done_ms, esp_err_to_name(n->result));
+        }
+    }
+}
@@ -0,0 +1,105 @@
+/**
+ * @file boot_graph.h
+ * @brief 启动阶段的依赖图调度
+ *
+ * 每个节点声明依赖的节点，依赖全部完成后在独立任务中执行，互不依赖的节点并行执行。
+ * 依赖只能引用已添加的节点，因此图中不会出现环。
+ *
+ * app_main 中顺序执行的初始化阶段用 boot_graph_mark() 打时间戳，与节点时间一起由
+ * boot_graph_dump() 打印，并经 sys_stats（GET /stats 的 "boot"）取回。
+ */
+
+#ifndef BOOT_GRAPH_H
+#define BOOT_GRAPH_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "freertos/FreeRTOS.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define BOOT_GRAPH_NODE_MAX             16      // 不超过事件组可用位数（24）
+#define BOOT_GRAPH_DEFAULT_STACK        4096
+#define BOOT_GRAPH_DEFAULT_PRIO         5
+#define BOOT_GRAPH_MARK_MAX             24
+
+#define BOOT_GRAPH_DEP(id)              (1UL << (id))
+
+typedef uint8_t boot_graph_id_t;
+
+/**
+ * @brief 节点执行函数，在节点自己的任务中调用，可阻塞；返回值只记录，不影响后继节点执行
+ */
+typedef esp_err_t (*boot_graph_fn_t)(void *arg);
+
+typedef struct {
+    const char *name;           // 任务名及日志
+    boot_graph_fn_t fn;         // NULL 表示事件节点，由 boot_graph_done() 标记完成
+    void *arg;
+    uint32_t deps;              // BOOT_GRAPH_DEP() 的组合，0 表示启动即执行
+    uint32_t stack_size;        // 0 使用 BOOT_GRAPH_DEFAULT_STACK
+    UBaseType_t prio;           // 0 使用 BOOT_GRAPH_DEFAULT_PRIO
+} boot_graph_node_t;
+
+/**
+ * @brief 添加节点，须在 boot_graph_start() 之前调用
+ *
+ * @param node 节点描述，内容会被拷贝，name 须为常量字符串
+ * @param id   返回节点 ID，供后续节点声明依赖
+ */
+esp_err_t boot_graph_add(const boot_graph_node_t *node, boot_graph_id_t *id);
+
+/**
+ * @brief 开始调度：无依赖的节点立即执行
+ */
+esp_err_t boot_graph_start(void);
+
+/**
+ * @brief 标记事件节点完成（任意任务中调用），重复调用无效
+ */
+void boot_graph_done(boot_graph_id_t id, esp_err_t result);
+
+/**
+ * @brief 节点是否已完成
+ */
+bool boot_graph_is_done(boot_graph_id_t id);
+
+/**
+ * @brief 等待 mask 中的节点全部完成
+ *
+ * @return true 全部完成，false 超时
+ */
+bool boot_graph_wait(uint32_t mask, uint32_t timeout_ms);
+
+/**
+ * @brief 记录一个启动阶段完成的时间（esp_timer，从启动开始计，不含二级引导之前的时间）
+ *
+ * 只在 app_main 中调用，超过 BOOT_GRAPH_MARK_MAX 个的忽略
+ *
+ * @param name 阶段名，须为常量字符串
+ */
+void boot_graph_mark(const char *name);
+
+/**
+ * @brief 已记录的阶段数
+ */
+uint8_t boot_graph_mark_num(void);
+
+/**
+ * @brief 取第 i 个阶段的名称和完成时间（us）
+ */
+bool boot_graph_mark_get(uint8_t i, const char **name, uint32_t *us);
+
+/**
+ * @brief 打印各阶段的完成时间和耗时，以及各节点相对开机的开始、完成时间（ms）和结果
+ */
+void boot_graph_dump(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BOOT_GRAPH_H
@@ -0,0 +1,130 @@
+// cbor_writer.c
+// 上报消息的 CBOR 编码，状态批量上报与二进制负载模式共用
+#include "cbor_writer.h"
+#include <string.h>
+
+#define CBOR_MAJOR_UINT     0
+#define CBOR_MAJOR_NINT     1
+#define CBOR_MAJOR_BYTES    2
+#define CBOR_MAJOR_TEXT     3
+#define CBOR_MAJOR_ARRAY    4
+#define CBOR_MAJOR_MAP      5
+#define CBOR_SIMPLE_FALSE   0xF4
+#define CBOR_SIMPLE_TRUE    0xF5
+
+static void put_raw(cbor_writer_t *w, const void *data, size_t n)
+{
+    if (w->overflow) {
+        return;
+    }
+    if (n > w->size - w->len) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, data, n);
+    w->len += n;
+}
+
+// 头部：major type + 无符号长度/数值，按值大小选最短编码
+static void put_head(cbor_writer_t *w, uint8_t major, uint32_t value)
+{
+    uint8_t head[5];
+    size_t n;
+    major <<= 5;
+    if (value < 24) {
+        head[0] = major | (uint8_t)value;
+        n = 1;
+    } else if (value <= 0xFF) {
+        head[0] = major | 24;
+        head[1] = (uint8_t)value;
+        n = 2;
+    } else if (value <= 0xFFFF) {
+        head[0] = major | 25;
+        head[1] = (uint8_t)(value >> 8);
+        head[2] = (uint8_t)value;
+        n = 3;
+    } else {
+        head[0] = major | 26;
+        head[1] = (uint8_t)(value >> 24);
+        head[2] = (uint8_t)(value >> 16);
+        head[3] = (uint8_t)(value >> 8);
+        head[4] = (uint8_t)value;
+        n = 5;
+    }
+    put_raw(w, head, n);
+}
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL);
+}
+
+void cbor_writer_array(cbor_writer_t *w, uint32_t count)
+{
+    put_head(w, CBOR_MAJOR_ARRAY, count);
+}
+
+void cbor_writer_map(cbor_writer_t *w, uint32_t pairs)
+{
+    put_head(w, CBOR_MAJOR_MAP, pairs);
+}
+
+void cbor_writer_uint(cbor_writer_t *w, uint32_t value)
+{
+    put_head(w, CBOR_MAJOR_UINT, value);
+}
+
+void cbor_writer_uint64(cbor_writer_t *w, uint64_t value)
+{
+    if (value <= UINT32_MAX) {
+        put_head(w, CBOR_MAJOR_UINT, (uint32_t)value);
+        return;
+    }
+    uint8_t head[9];
+    head[0] = (CBOR_MAJOR_UINT << 5) | 27;
+    for (int i = 0; i < 8; i++) {
+        head[1 + i] = (uint8_t)(value >> (56 - 8 * i));
+    }
+    put_raw(w, head, sizeof(head));
+}
+
+void cbor_writer_int(cbor_writer_t *w, int32_t value)
+{
+    if (value >= 0) {
+        put_head(w, CBOR_MAJOR_UINT, (uint32_t)value);
+    } else {
+        // 负整数编码为 -1 - n
+        put_head(w, CBOR_MAJOR_NINT, (uint32_t)(-1 - value));
+    }
+}
+
+void cbor_writer_bool(cbor_writer_t *w, bool value)
+{
+    uint8_t b = value ? CBOR_SIMPLE_TRUE : CBOR_SIMPLE_FALSE;
+    put_raw(w, &b, 1);
+}
+
+void cbor_writer_bytes(cbor_writer_t *w, const uint8_t *data, size_t len)
+{
+    put_head(w, CBOR_MAJOR_BYTES, (uint32_t)len);
+    if (len) {
+        put_raw(w, data, len);
+    }
+}
+
+void cbor_writer_text(cbor_writer_t *w, const char *str)
+{
+    size_t len = str ? strlen(str) : 0;
+    put_head(w, CBOR_MAJOR_TEXT, (uint32_t)len);
+    if (len) {
+        put_raw(w, str, len);
+    }
+}
+
+size_t cbor_writer_finish(const cbor_writer_t *w)
+{
+    return w->overflow ? 0 : w->len;
+}
@@ -0,0 +1,50 @@
+#ifndef CBOR_WRITER_H
+#define CBOR_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 最小 CBOR（RFC 8949）写入器，与 json_writer 一样直接写入调用方缓冲
+ *
+ * 只支持定长数组/map，元素个数在 begin 时给出：
+ *   cbor_writer_map(&w, 2);
+ *   cbor_writer_uint(&w, 0); cbor_writer_text(&w, ver);
+ *   cbor_writer_uint(&w, 2); cbor_writer_bytes(&w, data, len);
+ *
+ * 缓冲不足时置 overflow，之后的写入全部忽略，cbor_writer_finish() 返回 0。
+ */
+typedef struct {
+    uint8_t *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+} cbor_writer_t;
+
+void cbor_writer_init(cbor_writer_t *w, uint8_t *buf, size_t size);
+
+void cbor_writer_array(cbor_writer_t *w, uint32_t count);
+void cbor_writer_map(cbor_writer_t *w, uint32_t pairs);
+
+void cbor_writer_uint(cbor_writer_t *w, uint32_t value);
+void cbor_writer_uint64(cbor_writer_t *w, uint64_t value);
+void cbor_writer_int(cbor_writer_t *w, int32_t value);
+void cbor_writer_bool(cbor_writer_t *w, bool value);
+void cbor_writer_bytes(cbor_writer_t *w, const uint8_t *data, size_t len);
+void cbor_writer_text(cbor_writer_t *w, const char *str);
+
+/**
+ * @return 已写入长度，溢出返回 0
+ */
+size_t cbor_writer_finish(const cbor_writer_t *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CBOR_WRITER_H
@@ -0,0 +1,101 @@
+// checksum.c
+// 图传、串口协议共用的累加校验和与 CRC
+#include "sdkconfig.h"
+#include "checksum.h"
+
+// 每个 32 位字拆成两个 16 位通道累加，每次最多 2*255，128 个字内不会溢出
+#define SUM8_LANE_WORDS     128
+
+#if CONFIG_CHECKSUM_SIMD
+// 短于这个长度时对齐的头部和调用开销抵掉了向量的收益
+#define SUM8_SIMD_MIN       64
+// 每次交给内核的块数：2^18 * 16 * 255 < 2^31，不会碰到 ACCX 取出时的饱和
+#define SUM8_SIMD_CHUNK     (1u << 18)
+
+// simd/checksum_esp32s3.S：16 字节对齐的 data，n16 个 16 字节块
+uint32_t checksum_sum8_esp32s3(const uint8_t *data, uint32_t n16);
+#endif
+
+uint32_t checksum_sum8_update(uint32_t sum, const uint8_t *data, size_t len)
+{
+    if (!data) {
+        return sum;
+    }
+#if CONFIG_CHECKSUM_SIMD
+    // 逐字节到 16 字节对齐，中间整块交给 PIE，剩下不足 16 字节的走下面的字路径
+    if (len >= SUM8_SIMD_MIN) {
+        while ((uintptr_t)data & 15) {
+            sum += *data++;
+            len--;
+        }
+        size_t blocks = len >> 4;
+        while (blocks) {
+            uint32_t n = blocks < SUM8_SIMD_CHUNK ? (uint32_t)blocks : SUM8_SIMD_CHUNK;
+            sum += checksum_sum8_esp32s3(data, n);
+            data += (size_t)n << 4;
+            blocks -= n;
+        }
+        len &= 15;
+    }
+#endif
+    // 先处理未对齐的头部
+    while (len && ((uintptr_t)data & 3)) {
+        sum += *data++;
+        len--;
+    }
+
+    const uint32_t *words = (const uint32_t *)data;
+    size_t word_num = len >> 2;
+    while (word_num) {
+        size_t n = (word_num < SUM8_LANE_WORDS) ? word_num : SUM8_LANE_WORDS;
+        uint32_t lanes = 0;
+        for (size_t i = 0; i < n; i++) {
+            uint32_t w = words[i];
+            lanes += (w & 0x00FF00FF) + ((w >> 8) & 0x00FF00FF);
+        }
+        sum += (lanes & 0xFFFF) + (lanes >> 16);
+        words += n;
+        word_num -= n;
+    }
+
+    data = (const uint8_t *)words;
+    for (size_t i = 0; i < (len & 3); i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// 半字节查表，表只占 32 字节
+static const uint16_t s_crc16_nibble[16] = {
+    0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+    0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF,
+};
+
+uint16_t checksum_crc16_update(uint16_t crc, const uint8_t *data, size_t len)
+{
+    if (!data) {
+        return crc;
+    }
+    for (size_t i = 0; i < len; i++) {
+        crc = (crc << 4) ^ s_crc16_nibble[(crc >> 12) ^ (data[i] >> 4)];
+        crc = (crc << 4) ^ s_crc16_nibble[(crc >> 12) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
+
+static const uint8_t s_crc8_nibble[16] = {
+    0x00, 0x07, 0x0E, 0x09, 0x1C, 0x1B, 0x12, 0x15,
+    0x38, 0x3F, 0x36, 0x31, 0x24, 0x23, 0x2A, 0x2D,
+};
+
+uint8_t checksum_crc8_update(uint8_t crc, const uint8_t *data, size_t len)
+{
+    if (!data) {
+        return crc;
+    }
+    for (size_t i = 0; i < len; i++) {
+        crc = (uint8_t)(crc << 4) ^ s_crc8_nibble[(crc >> 4) ^ (data[i] >> 4)];
+        crc = (uint8_t)(crc << 4) ^ s_crc8_nibble[(crc >> 4) ^ (data[i] & 0x0F)];
+    }
+    return crc;
+}
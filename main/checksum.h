@@ -0,0 +1,50 @@
+#ifndef CHECKSUM_H
+#define CHECKSUM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+
+/**
+ * 逐字节累加和（按 32 位字批量累加，结果与逐字节相加一致）
+ *
+ * 支持分段累加：sum = checksum_sum8_update(sum, chunk, len)，初值为 0。
+ * 调用方按协议截取低 8 位或低 16 位。
+ */
+uint32_t checksum_sum8_update(uint32_t sum, const uint8_t *data, size_t len);
+
+static inline uint32_t checksum_sum8(const uint8_t *data, size_t len)
+{
+    return checksum_sum8_update(0, data, len);
+}
+
+/**
+ * CRC16/CCITT-FALSE（多项式 0x1021，初值 0xFFFF），支持分段累加：
+ * crc = checksum_crc16_update(0xFFFF, chunk, len)
+ */
+uint16_t checksum_crc16_update(uint16_t crc, const uint8_t *data, size_t len);
+
+static inline uint16_t checksum_crc16(const uint8_t *data, size_t len)
+{
+    return checksum_crc16_update(0xFFFF, data, len);
+}
+
+/**
+ * CRC-8（多项式 0x07，初值 0，不反转，MSB 先行），串口帧校验用，支持分段累加：
+ * crc = checksum_crc8_update(0, chunk, len)
+ */
+uint8_t checksum_crc8_update(uint8_t crc, const uint8_t *data, size_t len);
+
+static inline uint8_t checksum_crc8(const uint8_t *data, size_t len)
+{
+    return checksum_crc8_update(0, data, len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CHECKSUM_H
@@ -0,0 +1,163 @@
+/**
+ * @file coex_policy.c
+ * @brief Wi-Fi/BLE 共存策略：上传与 OTA 期间优先 Wi-Fi，BLE 配网期间优先 BLE
+ */
+
+#include "coex_policy.h"
+
+#if CONFIG_COEX_POLICY
+
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_coexist.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "cc_event.h"
+#include "cc_hal_sys.h"
+#include "gs_bind.h"
+#include "gs_ota.h"
+#include "metrics.h"
+
+static const char *TAG = "coex_policy";
+
+static uint8_t s_holds[COEX_HOLD_MAX];
+static coex_prefer_t s_prefer = COEX_PREFER_BALANCE;
+static uint32_t s_since_ms = 0;
+static SemaphoreHandle_t s_mutex = NULL;
+
+// 事件驱动的持有只在状态变化时计数一次，在事件任务中读写
+static bool s_ota_held = false;
+static bool s_ble_held = false;
+
+static metrics_gauge_t s_m_prefer = METRICS_GAUGE_INIT("coex.prefer");
+static metrics_counter_t s_m_switch = METRICS_COUNTER_INIT("coex.switch");
+static metrics_counter_t s_m_wifi_ms = METRICS_COUNTER_INIT("coex.wifi_ms");
+static metrics_counter_t s_m_bt_ms = METRICS_COUNTER_INIT("coex.bt_ms");
+
+static const char *const s_prefer_str[] = {
+    [COEX_PREFER_BALANCE] = "balance",
+    [COEX_PREFER_WIFI] = "wifi",
+    [COEX_PREFER_BT] = "bt",
+};
+
+static const esp_coex_prefer_t s_prefer_map[] = {
+    [COEX_PREFER_BALANCE] = ESP_COEX_PREFER_BALANCE,
+    [COEX_PREFER_WIFI] = ESP_COEX_PREFER_WIFI,
+    [COEX_PREFER_BT] = ESP_COEX_PREFER_BT,
+};
+
+// 按持有计数切换偏好（持锁调用）
+static void update_locked(void)
+{
+    bool wifi = s_holds[COEX_HOLD_IMG_UPLOAD] || s_holds[COEX_HOLD_OTA];
+    bool bt = s_holds[COEX_HOLD_BLE_PAIRING];
+    coex_prefer_t target = wifi == bt ? COEX_PREFER_BALANCE : wifi ? COEX_PREFER_WIFI : COEX_PREFER_BT;
+    if (target == s_prefer) {
+        return;
+    }
+    uint32_t now = (uint32_t)cc_hal_sys_get_ms();
+    if (s_prefer == COEX_PREFER_WIFI) {
+        metrics_counter_add(&s_m_wifi_ms, now - s_since_ms);
+    } else if (s_prefer == COEX_PREFER_BT) {
+        metrics_counter_add(&s_m_bt_ms, now - s_since_ms);
+    }
+    s_since_ms = now;
+    s_prefer = target;
+    esp_err_t err = esp_coex_preference_set(s_prefer_map[target]);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to set coex preference: %s", esp_err_to_name(err));
+    }
+    metrics_gauge_set(&s_m_prefer, target);
+    metrics_counter_inc(&s_m_switch);
+    ESP_LOGI(TAG, "Coex preference -> %s", s_prefer_str[target]);
+}
+
+void coex_policy_hold(coex_hold_t reason)
+{
+    if (reason >= COEX_HOLD_MAX || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason] < UINT8_MAX) {
+        s_holds[reason]++;
+    }
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+void coex_policy_release(coex_hold_t reason)
+{
+    if (reason >= COEX_HOLD_MAX || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason]) {
+        s_holds[reason]--;
+    }
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+coex_prefer_t coex_policy_get(void)
+{
+    return s_prefer;
+}
+
+static void coex_policy_set_held(bool *held, coex_hold_t reason, bool on)
+{
+    if (*held == on) {
+        return;
+    }
+    *held = on;
+    if (on) {
+        coex_policy_hold(reason);
+    } else {
+        coex_policy_release(reason);
+    }
+}
+
+// 下载失败在建立连接前也会发 FAIL，只释放已持有的
+static void coex_policy_ota_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    coex_policy_set_held(&s_ota_held, COEX_HOLD_OTA, id == GS_OTA_EVENT_HTTP_START);
+}
+
+// 只有包含 BLE 的配网模式才偏向 BLE，AP 配网本身走 Wi-Fi
+static void coex_policy_bind_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    bool ble = id == GS_BIND_EVENT_START && event_data && (*(uint8_t *)event_data & GS_BIND_CFG_MODE_BLE);
+    coex_policy_set_held(&s_ble_held, COEX_HOLD_BLE_PAIRING, ble);
+}
+
+static const cc_event_sub_t s_coex_subs[] = {
+    CC_EVENT_SUB(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_START, coex_policy_ota_handler),
+    CC_EVENT_SUB(GS_OTA_EVENT, GS_OTA_EVENT_SUCCESS, coex_policy_ota_handler),
+    CC_EVENT_SUB(GS_OTA_EVENT, GS_OTA_EVENT_FAIL, coex_policy_ota_handler),
+    CC_EVENT_SUB(GS_BIND_EVENT, GS_BIND_EVENT_START, coex_policy_bind_handler),
+    CC_EVENT_SUB(GS_BIND_EVENT, GS_BIND_EVENT_SUCCESS, coex_policy_bind_handler),
+    CC_EVENT_SUB(GS_BIND_EVENT, GS_BIND_EVENT_FAIL, coex_policy_bind_handler),
+    CC_EVENT_SUB(GS_BIND_EVENT, GS_BIND_EVENT_STOP, coex_policy_bind_handler),
+};
+
+esp_err_t coex_policy_init(void)
+{
+    if (s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    metrics_register(&s_m_prefer.head);
+    metrics_register(&s_m_switch.head);
+    metrics_register(&s_m_wifi_ms.head);
+    metrics_register(&s_m_bt_ms.head);
+
+    s_since_ms = (uint32_t)cc_hal_sys_get_ms();
+    esp_coex_preference_set(ESP_COEX_PREFER_BALANCE);
+    cc_event_register_table(s_coex_subs, CC_EVENT_SUB_NUM(s_coex_subs));
+    ESP_LOGI(TAG, "Coex preference balance");
+    return ESP_OK;
+}
+
+#endif // CONFIG_COEX_POLICY
@@ -0,0 +1,65 @@
+/**
+ * @file coex_policy.h
+ * @brief Wi-Fi/BLE 共存策略：上传与 OTA 期间优先 Wi-Fi，BLE 配网期间优先 BLE（CONFIG_COEX_POLICY）
+ *
+ * 与 power_profile 相同，各业务按原因持有/释放；只有 Wi-Fi 类原因持有时为 ESP_COEX_PREFER_WIFI，
+ * 只有 BLE 配网持有时为 ESP_COEX_PREFER_BT，两类同时持有或都未持有时为 ESP_COEX_PREFER_BALANCE。
+ * OTA 与 BLE 配网由 GS_OTA_EVENT / GS_BIND_EVENT 自动持有和释放，图传由 img_transfer 显式调用。
+ *
+ * 指标：coex.prefer（当前偏好，0 均衡 / 1 Wi-Fi / 2 BLE）、coex.switch（切换次数）、
+ * coex.wifi_ms / coex.bt_ms（各偏好的累计时长，在切换时计入）。
+ */
+
+#ifndef COEX_POLICY_H
+#define COEX_POLICY_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef enum {
+    COEX_HOLD_IMG_UPLOAD = 0,   // 图传采集与上传（Wi-Fi）
+    COEX_HOLD_OTA,              // OTA 固件下载（Wi-Fi）
+    COEX_HOLD_BLE_PAIRING,      // BLE 配网进行中（BLE）
+    COEX_HOLD_MAX,
+} coex_hold_t;
+
+typedef enum {
+    COEX_PREFER_BALANCE = 0,
+    COEX_PREFER_WIFI,
+    COEX_PREFER_BT,
+} coex_prefer_t;
+
+#if CONFIG_COEX_POLICY
+
+/**
+ * @brief 设为均衡并订阅 OTA 与配网事件，须在 cc_event_init() 之后调用
+ */
+esp_err_t coex_policy_init(void);
+
+/**
+ * @brief 持有共存偏好，同一原因可嵌套持有，须与 coex_policy_release() 成对调用
+ */
+void coex_policy_hold(coex_hold_t reason);
+
+void coex_policy_release(coex_hold_t reason);
+
+coex_prefer_t coex_policy_get(void);
+
+#else
+
+static inline esp_err_t coex_policy_init(void) { return ESP_OK; }
+static inline void coex_policy_hold(coex_hold_t reason) {}
+static inline void coex_policy_release(coex_hold_t reason) {}
+static inline coex_prefer_t coex_policy_get(void) { return COEX_PREFER_BALANCE; }
+
+#endif // CONFIG_COEX_POLICY
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COEX_POLICY_H
@@ -0,0 +1,350 @@
+/**
+ * @file conn_mgr.c
+ * @brief HTTP、OTA、MQTT 连接的统一名额与空闲回收
+ */
+
+#include "conn_mgr.h"
+
+#if CONFIG_CONN_MGR
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "cc_worker.h"
+#include "metrics.h"
+
+static const char *TAG = "conn_mgr";
+
+#define CONN_MGR_WAITERS_MAX    8       // 同时等待名额的租用数，每个占事件组的一位
+#define CONN_MGR_REAP_US        (10 * 1000000LL)
+#define CONN_MGR_IDLE_US        (CONFIG_CONN_MGR_IDLE_S * 1000000LL)
+
+static SemaphoreHandle_t s_mutex = NULL;
+static EventGroupHandle_t s_events = NULL;
+static esp_timer_handle_t s_reap_timer = NULL;
+static conn_mgr_conn_t *s_list = NULL;
+static uint8_t s_open = 0;                          // 租用中与保持中的连接数
+static uint8_t s_waiting[CONN_PRIO_MAX];            // 各优先级等待中的租用数
+static uint8_t s_waiter_used = 0;                   // 已分配的事件组位
+
+static metrics_gauge_t s_m_open = METRICS_GAUGE_INIT("conn.open");
+static metrics_counter_t s_m_evict = METRICS_COUNTER_INIT("conn.evict");
+static metrics_counter_t s_m_wait = METRICS_COUNTER_INIT("conn.wait");
+static metrics_counter_t s_m_timeout = METRICS_COUNTER_INIT("conn.timeout");
+
+// "scheme://user@host:port/path" -> "host:port"，不带协议时端口缺省为 80
+static void host_key(const char *url, char *out, size_t size)
+{
+    const char *sep = strstr(url, "://");
+    const char *host = sep ? sep + 3 : url;
+    size_t scheme_len = sep ? (size_t)(sep - url) : 0;
+    const char *end = host + strcspn(host, "/?#");
+    const char *at = memchr(host, '@', end - host);
+    if (at) {
+        host = at + 1;
+    }
+    const char *colon = memchr(host, ':', end - host);
+    int port;
+    if (colon) {
+        port = atoi(colon + 1);
+        end = colon;
+    } else if (scheme_len == 5 && strncmp(url, "https", 5) == 0) {
+        port = 443;
+    } else if (scheme_len == 5 && strncmp(url, "mqtts", 5) == 0) {
+        port = 8883;
+    } else if (scheme_len == 4 && strncmp(url, "mqtt", 4) == 0) {
+        port = 1883;
+    } else {
+        port = 80;
+    }
+    snprintf(out, size, "%.*s:%d", (int)(end - host), host, port);
+}
+
+static void wake_waiters_locked(void)
+{
+    if (s_waiter_used) {
+        xEventGroupSetBits(s_events, s_waiter_used);
+    }
+}
+
+static void close_locked(conn_mgr_conn_t *conn)
+{
+    if (conn->client) {
+        esp_http_client_close(conn->client);
+    }
+    conn->state = CONN_MGR_CLOSED;
+    s_open--;
+    metrics_gauge_set(&s_m_open, s_open);
+}
+
+// 可被 prio 挤掉的最久未用的空闲连接，host 为 NULL 时不限主机
+static conn_mgr_conn_t *lru_idle_locked(const char *host, conn_prio_t prio, const conn_mgr_conn_t *skip)
+{
+    conn_mgr_conn_t *lru = NULL;
+    for (conn_mgr_conn_t *c = s_list; c; c = c->next) {
+        if (c == skip || c->state != CONN_MGR_IDLE || c->prio < prio) {
+            continue;
+        }
+        if (host && strcmp(c->host, host) != 0) {
+            continue;
+        }
+        if (!lru || c->idle_since_us < lru->idle_since_us) {
+            lru = c;
+        }
+    }
+    return lru;
+}
+
+static bool admit_locked(conn_mgr_conn_t *conn, conn_prio_t prio)
+{
+    if (conn->state == CONN_MGR_IDLE) {
+        // 保持中的连接已占名额，直接复用
+        conn->state = CONN_MGR_LEASED;
+        conn->prio = prio;
+        return true;
+    }
+    for (int p = 0; p < prio; p++) {
+        if (s_waiting[p]) {
+            return false;
+        }
+    }
+
+    uint8_t host_open = 0;
+    for (conn_mgr_conn_t *c = s_list; c; c = c->next) {
+        host_open += (c->state != CONN_MGR_CLOSED && strcmp(c->host, conn->host) == 0);
+    }
+    int need = 1 + (prio == CONN_PRIO_BULK ? CONFIG_CONN_MGR_RESERVE : 0);
+    int free_slots = CONFIG_CONN_MGR_POOL_SIZE - s_open;
+
+    // 先确认挤掉空闲连接后能满足，再动手关闭
+    conn_mgr_conn_t *host_victim = NULL;
+    if (host_open >= CONFIG_CONN_MGR_PER_HOST) {
+        host_victim = lru_idle_locked(conn->host, prio, NULL);
+        if (!host_victim) {
+            return false;
+        }
+        free_slots++;
+    }
+    if (free_slots < need) {
+        int evictable = 0;
+        for (conn_mgr_conn_t *c = s_list; c; c = c->next) {
+            evictable += (c != host_victim && c->state == CONN_MGR_IDLE && c->prio >= prio);
+        }
+        if (free_slots + evictable < need) {
+            return false;
+        }
+    }
+
+    if (host_victim) {
+        ESP_LOGD(TAG, "Evict idle %s for %s", host_victim->name, conn->name);
+        close_locked(host_victim);
+        metrics_counter_inc(&s_m_evict);
+    }
+    while (CONFIG_CONN_MGR_POOL_SIZE - s_open < need) {
+        conn_mgr_conn_t *victim = lru_idle_locked(NULL, prio, NULL);
+        ESP_LOGD(TAG, "Evict idle %s for %s", victim->name, conn->name);
+        close_locked(victim);
+        metrics_counter_inc(&s_m_evict);
+    }
+    conn->state = CONN_MGR_LEASED;
+    conn->prio = prio;
+    s_open++;
+    metrics_gauge_set(&s_m_open, s_open);
+    return true;
+}
+
+static int waiter_add_locked(conn_prio_t prio)
+{
+    for (int i = 0; i < CONN_MGR_WAITERS_MAX; i++) {
+        if (!(s_waiter_used & (1 << i))) {
+            s_waiter_used |= 1 << i;
+            s_waiting[prio]++;
+            return i;
+        }
+    }
+    return -1;
+}
+
+static void waiter_remove_locked(int slot, conn_prio_t prio)
+{
+    s_waiter_used &= ~(1 << slot);
+    s_waiting[prio]--;
+    // 高优先级放弃等待后，被它挡住的低优先级可以重新尝试
+    wake_waiters_locked();
+}
+
+esp_err_t conn_mgr_lease(conn_mgr_conn_t *conn, conn_prio_t prio, uint32_t timeout_ms)
+{
+    if (!conn || prio >= CONN_PRIO_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_mutex) {
+        return ESP_OK;
+    }
+    TickType_t start = xTaskGetTickCount();
+    TickType_t wait = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    int slot = -1;
+    esp_err_t err = ESP_OK;
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (!conn->attached || conn->state == CONN_MGR_LEASED) {
+        xSemaphoreGive(s_mutex);
+        return ESP_ERR_INVALID_STATE;
+    }
+    while (!admit_locked(conn, prio)) {
+        TickType_t elapsed = xTaskGetTickCount() - start;
+        if (wait != portMAX_DELAY && elapsed >= wait) {
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (slot < 0) {
+            slot = waiter_add_locked(prio);
+            if (slot < 0) {
+                err = ESP_ERR_TIMEOUT;
+                break;
+            }
+            metrics_counter_inc(&s_m_wait);
+        }
+        // 持锁清位，归还时持锁置位，不会漏掉唤醒
+        xEventGroupClearBits(s_events, 1 << slot);
+        xSemaphoreGive(s_mutex);
+        xEventGroupWaitBits(s_events, 1 << slot, pdTRUE, pdFALSE,
+                            wait == portMAX_DELAY ? portMAX_DELAY : wait - elapsed);
+        xSemaphoreTake(s_mutex, portMAX_DELAY);
+    }
+    if (slot >= 0) {
+        waiter_remove_locked(slot, prio);
+    }
+    xSemaphoreGive(s_mutex);
+
+    if (err != ESP_OK) {
+        metrics_counter_inc(&s_m_timeout);
+        ESP_LOGW(TAG, "%s: no connection slot for %s (prio %d)", conn->name, conn->host, prio);
+    }
+    return err;
+}
+
+void conn_mgr_return(conn_mgr_conn_t *conn, bool keep)
+{
+    if (!conn || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (conn->state == CONN_MGR_LEASED) {
+        if (keep && conn->client) {
+            conn->state = CONN_MGR_IDLE;
+            conn->idle_since_us = esp_timer_get_time();
+        } else {
+            close_locked(conn);
+        }
+        wake_waiters_locked();
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void conn_mgr_attach(conn_mgr_conn_t *conn, esp_http_client_handle_t client, const char *url)
+{
+    if (!conn || !url || !s_mutex) {
+        return;
+    }
+    char host[CONN_MGR_HOST_LEN];
+    host_key(url, host, sizeof(host));
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    // 换了客户端或主机，保持的连接不能再复用
+    if (conn->state == CONN_MGR_IDLE && (conn->client != client || strcmp(conn->host, host) != 0)) {
+        close_locked(conn);
+        wake_waiters_locked();
+    }
+    conn->client = client;
+    strcpy(conn->host, host);
+    if (!conn->attached) {
+        conn->next = s_list;
+        s_list = conn;
+        conn->attached = true;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+void conn_mgr_detach(conn_mgr_conn_t *conn)
+{
+    if (!conn || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (conn->attached) {
+        if (conn->state != CONN_MGR_CLOSED) {
+            close_locked(conn);
+            wake_waiters_locked();
+        }
+        for (conn_mgr_conn_t **p = &s_list; *p; p = &(*p)->next) {
+            if (*p == conn) {
+                *p = conn->next;
+                break;
+            }
+        }
+        conn->attached = false;
+        conn->client = NULL;
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+// 在工作任务中关闭空闲超时的连接，关闭 TLS 连接可能阻塞，不放在定时器任务中
+static void reap_job(void *arg)
+{
+    int64_t now = esp_timer_get_time();
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    bool closed = false;
+    for (conn_mgr_conn_t *c = s_list; c; c = c->next) {
+        if (c->state == CONN_MGR_IDLE && now - c->idle_since_us >= CONN_MGR_IDLE_US) {
+            ESP_LOGD(TAG, "Close idle %s (%s)", c->name, c->host);
+            close_locked(c);
+            metrics_counter_inc(&s_m_evict);
+            closed = true;
+        }
+    }
+    if (closed) {
+        wake_waiters_locked();
+    }
+    xSemaphoreGive(s_mutex);
+}
+
+static void reap_timer_cb(void *arg)
+{
+    cc_worker_submit(reap_job, NULL, CC_WORKER_PRIO_LOW);
+}
+
+esp_err_t conn_mgr_init(void)
+{
+    if (s_mutex) {
+        return ESP_OK;
+    }
+    s_events = xEventGroupCreate();
+    SemaphoreHandle_t mutex = xSemaphoreCreateMutex();
+    if (!s_events || !mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    const esp_timer_create_args_t args = {
+        .callback = reap_timer_cb,
+        .name = "conn_reap",
+    };
+    esp_err_t err = esp_timer_create(&args, &s_reap_timer);
+    if (err != ESP_OK) {
+        return err;
+    }
+    esp_timer_start_periodic(s_reap_timer, CONN_MGR_REAP_US);
+    metrics_register(&s_m_open.head);
+    metrics_register(&s_m_evict.head);
+    metrics_register(&s_m_wait.head);
+    metrics_register(&s_m_timeout.head);
+    s_mutex = mutex;
+    ESP_LOGI(TAG, "Connection pool: %d total, %d per host, %d reserved, idle %ds",
+             CONFIG_CONN_MGR_POOL_SIZE, CONFIG_CONN_MGR_PER_HOST, CONFIG_CONN_MGR_RESERVE, CONFIG_CONN_MGR_IDLE_S);
+    return ESP_OK;
+}
+
+#endif // CONFIG_CONN_MGR
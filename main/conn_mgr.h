@@ -0,0 +1,115 @@
+/**
+ * @file conn_mgr.h
+ * @brief HTTP、OTA、MQTT 连接的统一名额：总连接数与每主机连接数有上限，空闲连接保持或回收，
+ *        名额不足时按优先级准入，门锁事件优先于 OTA（CONFIG_CONN_MGR）
+ *
+ * 各模块仍各自创建客户端（请求头、事件回调各不相同），本模块管理连接本身：打开连接前租用名额，用完归还。
+ *   static conn_mgr_conn_t s_conn = CONN_MGR_CONN_INIT("img_upload");
+ *   conn_mgr_attach(&s_conn, client, url);
+ *   if (conn_mgr_lease(&s_conn, CONN_PRIO_EVENT, timeout_ms) == ESP_OK) {
+ *       ... esp_http_client_open / perform ...
+ *       conn_mgr_return(&s_conn, connected);
+ *   }
+ * 归还时 keep 为 true 则连接保持打开（keep-alive，仍占名额），下次租用直接复用；
+ * 空闲超过 CONFIG_CONN_MGR_IDLE_S，或名额被同级及更高优先级的租用需要时，由本模块关闭最久未用的空闲连接。
+ * 未租用期间不得使用客户端，本模块可能随时关闭它；客户端销毁前须先 conn_mgr_detach()。
+ * OTA 下载与 MQTT 不经 esp_http_client，client 为 NULL，只占名额。
+ *
+ * 准入：有更高优先级的租用在等待时，低优先级的租用一律等待；CONN_PRIO_BULK 还须在占用后留出
+ * CONFIG_CONN_MGR_RESERVE 个名额，且不能挤掉更高优先级的空闲连接。
+ *
+ * 指标：conn.open（打开的连接数）、conn.evict（被关闭的空闲连接）、conn.wait（等待过名额的租用）、
+ * conn.timeout（等待超时的租用）。
+ */
+
+#ifndef CONN_MGR_H
+#define CONN_MGR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_http_client.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CONN_MGR_HOST_LEN       64
+
+typedef enum {
+    CONN_PRIO_EVENT = 0,        // 门锁事件：抓拍上传、MQTT 控制通道
+    CONN_PRIO_NORMAL,           // 对时、多目的地分发、保活
+    CONN_PRIO_BULK,             // OTA 下载等大流量后台任务
+    CONN_PRIO_MAX,
+} conn_prio_t;
+
+typedef enum {
+    CONN_MGR_CLOSED = 0,
+    CONN_MGR_IDLE,              // 已归还，连接保持打开
+    CONN_MGR_LEASED,
+} conn_mgr_state_t;
+
+typedef struct conn_mgr_conn {
+    const char *name;
+    esp_http_client_handle_t client;    // NULL 为只占名额的连接
+    char host[CONN_MGR_HOST_LEN];       // "主机:端口"，每主机限额的键
+    struct conn_mgr_conn *next;
+    int64_t idle_since_us;
+    uint8_t state;                      // conn_mgr_state_t
+    uint8_t prio;                       // 最近一次租用的优先级
+    bool attached;
+} conn_mgr_conn_t;
+
+#define CONN_MGR_CONN_INIT(n)   { .name = (n) }
+
+#if CONFIG_CONN_MGR
+
+/**
+ * @brief 创建空闲回收定时器，须在 cc_worker_init() 之后调用
+ */
+esp_err_t conn_mgr_init(void);
+
+/**
+ * @brief 登记连接及其主机，重复调用时更新客户端与主机，变了则关闭保持的连接（须未租用）
+ *
+ * @param client 可为 NULL，只占名额
+ * @param url    取其中的主机与端口，不带端口时按协议取 80/443/1883/8883
+ */
+void conn_mgr_attach(conn_mgr_conn_t *conn, esp_http_client_handle_t client, const char *url);
+
+/**
+ * @brief 注销连接，已打开的连接会被关闭；销毁客户端前调用
+ */
+void conn_mgr_detach(conn_mgr_conn_t *conn);
+
+/**
+ * @brief 租用连接名额：已保持的连接直接复用，否则按优先级准入，名额不足时最多等待 timeout_ms
+ *
+ * @param timeout_ms 0 不等待，portMAX_DELAY 一直等待
+ * @return ESP_ERR_TIMEOUT 等待超时；ESP_ERR_INVALID_STATE 未登记或已租用
+ */
+esp_err_t conn_mgr_lease(conn_mgr_conn_t *conn, conn_prio_t prio, uint32_t timeout_ms);
+
+/**
+ * @brief 归还名额
+ *
+ * @param keep true 保持连接供下次复用（仍占名额）；false 关闭连接并释放名额
+ */
+void conn_mgr_return(conn_mgr_conn_t *conn, bool keep);
+
+#else
+
+static inline esp_err_t conn_mgr_init(void) { return ESP_OK; }
+static inline void conn_mgr_attach(conn_mgr_conn_t *conn, esp_http_client_handle_t client, const char *url) {}
+static inline void conn_mgr_detach(conn_mgr_conn_t *conn) {}
+static inline esp_err_t conn_mgr_lease(conn_mgr_conn_t *conn, conn_prio_t prio, uint32_t timeout_ms) { return ESP_OK; }
+static inline void conn_mgr_return(conn_mgr_conn_t *conn, bool keep) {}
+
+#endif // CONFIG_CONN_MGR
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONN_MGR_H
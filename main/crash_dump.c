@@ -0,0 +1,188 @@
+/**
+ * @file crash_dump.c
+ * @brief 崩溃转储上传：启动后读取 coredump 分区，分块压缩后以低优先级上传
+ */
+
+#include "crash_dump.h"
+
+#if CONFIG_CRASH_DUMP
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include "esp_log.h"
+#include "esp_system.h"
+#include "esp_app_desc.h"
+#include "esp_core_dump.h"
+#include "esp_flash.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "crash_pack.h"
+#include "json_writer.h"
+#include "evt_log.h"
+#include "metrics.h"
+#include "power_profile.h"
+#include "img_upload.h"
+
+static const char *TAG = "crash_dump";
+
+#define CRASH_DUMP_TASK_STACK       4096
+#define CRASH_DUMP_TASK_PRIO        1           // 低于所有业务任务
+#define CRASH_DUMP_RETRY_MS         (60 * 1000)
+#define CRASH_DUMP_EVT_RECS         (CRASH_PACK_BLOCK / sizeof(evt_log_rec_t))
+#define CRASH_DUMP_CONTENT_TYPE     "application/octet-stream"
+
+typedef struct {
+    crash_pack_t pack;
+    uint8_t raw[CRASH_PACK_BLOCK];
+    uint8_t out[CRASH_PACK_BLOCK_MAX];
+    img_upload_handle_t up;
+    size_t sent;
+} crash_dump_ctx_t;
+
+static size_t s_dump_addr = 0;
+static size_t s_dump_size = 0;
+static esp_reset_reason_t s_reason = ESP_RST_UNKNOWN;
+
+static metrics_counter_t s_m_bytes = METRICS_COUNTER_INIT("crash_dump.upload_bytes");
+static metrics_counter_t s_m_yield = METRICS_COUNTER_INIT("crash_dump.yield");
+
+// 图传或远程开锁进行中
+static inline bool crash_dump_busy(void)
+{
+    return power_profile_get() == POWER_PROFILE_PERF;
+}
+
+static esp_err_t crash_dump_put(crash_dump_ctx_t *c, const uint8_t *data, size_t len)
+{
+    if (crash_dump_busy()) {
+        metrics_counter_inc(&s_m_yield);
+        return ESP_ERR_TIMEOUT;
+    }
+    esp_err_t ret = img_upload_chunked_write(c->up, data, len);
+    if (ret == ESP_OK) {
+        c->sent += len;
+    }
+    return ret;
+}
+
+// 一段数据分块压缩上传；data 为 NULL 时从 flash 的 addr 处读取
+static esp_err_t crash_dump_section(crash_dump_ctx_t *c, crash_sec_t type, const uint8_t *data, size_t addr, size_t len)
+{
+    uint8_t hdr[CRASH_PACK_SEC_HDR_LEN];
+    esp_err_t ret = crash_dump_put(c, hdr, crash_pack_section(hdr, type, len));
+    for (size_t off = 0; ret == ESP_OK && off < len; off += CRASH_PACK_BLOCK) {
+        size_t n = len - off < CRASH_PACK_BLOCK ? len - off : CRASH_PACK_BLOCK;
+        const uint8_t *src = data + off;
+        if (!data) {
+            ret = esp_flash_read(NULL, c->raw, addr + off, n);
+            src = c->raw;
+        }
+        if (ret == ESP_OK) {
+            ret = crash_dump_put(c, c->out, crash_pack_block(&c->pack, src, n, c->out));
+        }
+    }
+    return ret;
+}
+
+static size_t crash_dump_info(char *buf, size_t size)
+{
+    const esp_app_desc_t *app = esp_app_get_description();
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_int(&w, "reason", s_reason);
+    json_writer_kv_str(&w, "version", app->version);
+    json_writer_kv_str(&w, "idf", app->idf_ver);
+    json_writer_kv_hex(&w, "elf_sha256", app->app_elf_sha256, sizeof(app->app_elf_sha256));
+    json_writer_kv_uint(&w, "dump_size", s_dump_size);
+    esp_core_dump_summary_t summary;
+    if (esp_core_dump_get_summary(&summary) == ESP_OK) {
+        json_writer_kv_str(&w, "task", summary.exc_task);
+        json_writer_kv_uint(&w, "pc", summary.exc_pc);
+    }
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
+
+// 最近的至多 CRASH_DUMP_EVT_RECS 条记录：先找到最新的序号，再从其前面读一块
+static size_t crash_dump_evt_recs(evt_log_rec_t *recs)
+{
+    uint32_t last = 0;
+    while (evt_log_read(last, recs, CRASH_DUMP_EVT_RECS, &last) == CRASH_DUMP_EVT_RECS) {
+    }
+    uint32_t since = last > CRASH_DUMP_EVT_RECS ? last - CRASH_DUMP_EVT_RECS : 0;
+    return evt_log_read(since, recs, CRASH_DUMP_EVT_RECS, &since);
+}
+
+static esp_err_t crash_dump_upload(crash_dump_ctx_t *c)
+{
+    const uint8_t *sha = esp_app_get_description()->app_elf_sha256;
+    char name[32];
+    snprintf(name, sizeof(name), "crash_%02x%02x%02x%02x.gscd", sha[0], sha[1], sha[2], sha[3]);
+    c->sent = 0;
+    esp_err_t ret = img_upload_chunked_begin(name, CRASH_DUMP_CONTENT_TYPE, &c->up);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t hdr[CRASH_PACK_HDR_LEN];
+    ret = crash_dump_put(c, hdr, crash_pack_header(hdr));
+    if (ret == ESP_OK) {
+        size_t len = crash_dump_info((char *)c->raw, sizeof(c->raw));
+        ret = crash_dump_section(c, CRASH_SEC_INFO, c->raw, 0, len);
+    }
+    if (ret == ESP_OK) {
+        ret = crash_dump_section(c, CRASH_SEC_COREDUMP, NULL, s_dump_addr, s_dump_size);
+    }
+    if (ret == ESP_OK) {
+        size_t n = crash_dump_evt_recs((evt_log_rec_t *)c->raw);
+        ret = crash_dump_section(c, CRASH_SEC_EVT_LOG, c->raw, 0, n * sizeof(evt_log_rec_t));
+    }
+    esp_err_t end = img_upload_chunked_end(c->up, ret != ESP_OK);
+    c->up = NULL;
+    return ret != ESP_OK ? ret : end;
+}
+
+static void crash_dump_task(void *arg)
+{
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_CRASH_DUMP_DELAY_S * 1000UL));
+    crash_dump_ctx_t *c = heap_caps_malloc(sizeof(crash_dump_ctx_t), MALLOC_CAP_SPIRAM);
+    if (!c) {
+        c = malloc(sizeof(crash_dump_ctx_t));
+    }
+    while (c) {
+        esp_err_t ret = crash_dump_busy() ? ESP_ERR_TIMEOUT : crash_dump_upload(c);
+        if (ret == ESP_OK) {
+            metrics_counter_add(&s_m_bytes, c->sent);
+            ESP_LOGI(TAG, "Core dump uploaded, %u -> %u bytes", (unsigned)s_dump_size, (unsigned)c->sent);
+            esp_core_dump_image_erase();
+            break;
+        }
+        // 让给门铃事件或等待联网，稍后从头重试
+        ESP_LOGW(TAG, "Core dump upload deferred (%s)", esp_err_to_name(ret));
+        vTaskDelay(pdMS_TO_TICKS(CRASH_DUMP_RETRY_MS));
+    }
+    if (!c) {
+        ESP_LOGE(TAG, "No memory for core dump upload");
+    }
+    free(c);
+    vTaskDelete(NULL);
+}
+
+esp_err_t crash_dump_init(void)
+{
+    metrics_register(&s_m_bytes.head);
+    metrics_register(&s_m_yield.head);
+    if (esp_core_dump_image_check() != ESP_OK || esp_core_dump_image_get(&s_dump_addr, &s_dump_size) != ESP_OK) {
+        return ESP_OK;
+    }
+    s_reason = esp_reset_reason();
+    ESP_LOGW(TAG, "Core dump of %u bytes pending upload, reset reason %d", (unsigned)s_dump_size, s_reason);
+    if (xTaskCreate(crash_dump_task, "crash_dump", CRASH_DUMP_TASK_STACK, NULL, CRASH_DUMP_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_CRASH_DUMP
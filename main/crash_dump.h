@@ -0,0 +1,47 @@
+/**
+ * @file crash_dump.h
+ * @brief 崩溃转储上传（CONFIG_CRASH_DUMP）：panic 时由 ESP-IDF 把任务栈写入 flash 的 coredump 分区，
+ *        下次启动后在低优先级任务中压缩并经 img_upload 的分块上传发出，成功后擦除
+ *
+ * 转储只含各任务的 TCB 与栈，以及用 CRASH_DUMP_ATTR 标注的少量模块状态
+ * （usb_stream 设备状态、state_report 待确认队列、lat_trace 打点环）。
+ * 上传内容见 crash_pack.h：信息段（复位原因、固件版本、出错任务与 PC）、ELF 转储、最近的事件日志。
+ *
+ * 上传不与门铃事件争抢：开始前和每写一块前检查 power_profile，处于性能档（图传或远程开锁进行中）
+ * 时放弃本次上传，稍后从头重试。
+ */
+
+#ifndef CRASH_DUMP_H
+#define CRASH_DUMP_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "esp_attr.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_CRASH_DUMP
+
+// 标注的静态变量放入 DRAM 中随转储保存的段，只用于小的状态结构
+#define CRASH_DUMP_ATTR     COREDUMP_DRAM_ATTR
+
+/**
+ * @brief 有待上传的转储时启动上传任务，任务先等待 CONFIG_CRASH_DUMP_DELAY_S
+ */
+esp_err_t crash_dump_init(void);
+
+#else
+
+#define CRASH_DUMP_ATTR
+
+static inline esp_err_t crash_dump_init(void) { return ESP_OK; }
+
+#endif // CONFIG_CRASH_DUMP
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRASH_DUMP_H
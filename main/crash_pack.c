@@ -0,0 +1,150 @@
+// crash_pack.c
+// 崩溃转储上传格式的打包与分块压缩，格式见 crash_pack.h
+#include "crash_pack.h"
+#include <string.h>
+#include <stdbool.h>
+
+#define CRASH_PACK_CHAIN        16      // 每个位置最多比较的候选数
+#define CRASH_PACK_MAX_DIST     (1 << CRASH_PACK_WINDOW)
+#define CRASH_PACK_MAX_LEN      (1 << CRASH_PACK_LOOKAHEAD)
+// 回溯引用比对应的字面量短时才使用
+#define CRASH_PACK_MIN_LEN      ((1 + CRASH_PACK_WINDOW + CRASH_PACK_LOOKAHEAD) / 9 + 1)
+
+typedef struct {
+    uint8_t *out;
+    size_t cap;
+    size_t len;
+    uint8_t acc;
+    uint8_t bits;
+    bool over;
+} crash_bits_t;
+
+static inline void put_u16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    put_u16(p, (uint16_t)v);
+    put_u16(p + 2, (uint16_t)(v >> 16));
+}
+
+static void bits_put(crash_bits_t *w, uint32_t value, uint8_t count)
+{
+    while (count--) {
+        w->acc = (uint8_t)((w->acc << 1) | ((value >> count) & 1));
+        if (++w->bits == 8) {
+            if (w->len < w->cap) {
+                w->out[w->len++] = w->acc;
+            } else {
+                w->over = true;
+            }
+            w->acc = 0;
+            w->bits = 0;
+        }
+    }
+}
+
+static inline uint8_t hash3(const uint8_t *p)
+{
+    return (uint8_t)((p[0] << 5) ^ (p[1] << 2) ^ p[2] ^ (p[0] >> 3));
+}
+
+static inline void insert(crash_pack_t *p, const uint8_t *in, size_t len, size_t pos)
+{
+    if (pos + 3 <= len) {
+        uint8_t h = hash3(in + pos);
+        p->prev[pos] = p->head[h];
+        p->head[h] = (int16_t)pos;
+    }
+}
+
+// 贪心 LZSS，与 tools/ota_pack.py 的 heatshrink_compress 相同；输出超过 cap 返回 0
+static size_t hs_compress(crash_pack_t *p, const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+    crash_bits_t w = { .out = out, .cap = cap };
+    for (size_t i = 0; i < CRASH_PACK_HASH; i++) {
+        p->head[i] = -1;
+    }
+    size_t i = 0;
+    while (i < len && !w.over) {
+        size_t best_len = 0;
+        size_t best_dist = 0;
+        if (i + 3 <= len) {
+            size_t limit = len - i < CRASH_PACK_MAX_LEN ? len - i : CRASH_PACK_MAX_LEN;
+            int cand = p->head[hash3(in + i)];
+            for (int tries = CRASH_PACK_CHAIN; cand >= 0 && i - cand <= CRASH_PACK_MAX_DIST && tries; tries--) {
+                size_t n = 0;
+                while (n < limit && in[cand + n] == in[i + n]) {
+                    n++;
+                }
+                if (n >= 3 && n > best_len) {
+                    best_len = n;
+                    best_dist = i - cand;
+                    if (n == limit) {
+                        break;
+                    }
+                }
+                cand = p->prev[cand];
+            }
+        }
+        if (best_len >= CRASH_PACK_MIN_LEN) {
+            bits_put(&w, 0, 1);
+            bits_put(&w, (uint32_t)(best_dist - 1), CRASH_PACK_WINDOW);
+            bits_put(&w, (uint32_t)(best_len - 1), CRASH_PACK_LOOKAHEAD);
+            for (size_t k = 0; k < best_len; k++) {
+                insert(p, in, len, i + k);
+            }
+            i += best_len;
+        } else {
+            bits_put(&w, 1, 1);
+            bits_put(&w, in[i], 8);
+            insert(p, in, len, i);
+            i++;
+        }
+    }
+    // 末尾补 0，解码端不会把不足一个符号的位当作数据
+    if (w.bits) {
+        bits_put(&w, 0, 8 - w.bits);
+    }
+    return w.over ? 0 : w.len;
+}
+
+size_t crash_pack_header(uint8_t *out)
+{
+    memcpy(out, CRASH_PACK_MAGIC, 4);
+    out[4] = CRASH_PACK_VERSION;
+    out[5] = CRASH_PACK_WINDOW;
+    out[6] = CRASH_PACK_LOOKAHEAD;
+    out[7] = 0;
+    return CRASH_PACK_HDR_LEN;
+}
+
+size_t crash_pack_section(uint8_t *out, crash_sec_t type, uint32_t raw_len)
+{
+    memset(out, 0, CRASH_PACK_SEC_HDR_LEN);
+    out[0] = (uint8_t)type;
+    put_u32(out + 4, raw_len);
+    return CRASH_PACK_SEC_HDR_LEN;
+}
+
+size_t crash_pack_block(crash_pack_t *p, const uint8_t *in, size_t len, uint8_t *out)
+{
+    if (len > CRASH_PACK_BLOCK) {
+        return 0;
+    }
+    uint8_t *data = out + CRASH_PACK_BLOCK_HDR_LEN;
+    // 只接受比原始数据短的压缩结果
+    size_t stored = len ? hs_compress(p, in, len, data, len - 1) : 0;
+    uint16_t flag = 0;
+    if (!stored) {
+        memcpy(data, in, len);
+        stored = len;
+        flag = CRASH_PACK_STORED;
+    }
+    put_u16(out, (uint16_t)len);
+    put_u16(out + 2, (uint16_t)(stored | flag));
+    return CRASH_PACK_BLOCK_HDR_LEN + stored;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file crash_pack.h
+ * @brief 崩溃转储的上传格式：分段、分块，每块独立做 heatshrink 压缩；与平台无关
+ *
+ * 格式（小端）：
+ *   头     "GSCD" 版本 window lookahead 保留                      8 字节
+ *   段头   类型 保留×3 原始长度(u32)                               8 字节
+ *   块     原始长度(u16) 存储长度(u16) 数据                        4 字节 + 数据
+ * 一段的原始数据按 CRASH_PACK_BLOCK 切块，块数据是 heatshrink（-w 8 -l 4）位流，
+ * 压缩后不比原始数据短时原样存储，存储长度的最高位 CRASH_PACK_STORED 置 1。
+ * 每块独立压缩，回溯不跨块，设备端只需一块的缓冲；解包见 tools/crash_unpack.py。
+ */
+
+#ifndef CRASH_PACK_H
+#define CRASH_PACK_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CRASH_PACK_MAGIC            "GSCD"
+#define CRASH_PACK_VERSION          1
+#define CRASH_PACK_WINDOW           8
+#define CRASH_PACK_LOOKAHEAD        4
+#define CRASH_PACK_HDR_LEN          8
+#define CRASH_PACK_SEC_HDR_LEN      8
+#define CRASH_PACK_BLOCK_HDR_LEN    4
+#define CRASH_PACK_BLOCK            4096
+#define CRASH_PACK_BLOCK_MAX        (CRASH_PACK_BLOCK_HDR_LEN + CRASH_PACK_BLOCK)
+#define CRASH_PACK_STORED           0x8000
+#define CRASH_PACK_HASH             256
+
+typedef enum {
+    CRASH_SEC_INFO = 1,         // 复位原因、固件版本等，JSON
+    CRASH_SEC_COREDUMP,         // ESP-IDF 核心转储（ELF），只含任务栈与 COREDUMP_DRAM_ATTR 标注的模块状态
+    CRASH_SEC_EVT_LOG,          // 最近的事件日志，evt_log_rec_t 数组（含复位前保留下来的记录）
+} crash_sec_t;
+
+// 压缩用的哈希链，约 8.7 KB，由调用者分配
+typedef struct {
+    int16_t head[CRASH_PACK_HASH];
+    int16_t prev[CRASH_PACK_BLOCK];
+} crash_pack_t;
+
+size_t crash_pack_header(uint8_t *out);
+
+size_t crash_pack_section(uint8_t *out, crash_sec_t type, uint32_t raw_len);
+
+/**
+ * @brief 压缩一块（len 不超过 CRASH_PACK_BLOCK），写入块头与数据
+ *
+ * @param out 至少 CRASH_PACK_BLOCK_MAX 字节
+ * @return 写入的字节数，len 超限返回 0
+ */
+size_t crash_pack_block(crash_pack_t *p, const uint8_t *in, size_t len, uint8_t *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CRASH_PACK_H
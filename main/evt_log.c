@@ -0,0 +1,262 @@
+// evt_log.c
+// 二进制事件日志：无锁定长记录环，经 MQTT / HTTP 按序号增量取回
+#include "evt_log.h"
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_system.h"
+#include "esp_heap_caps.h"
+#include "esp_attr.h"
+#include "cJSON.h"
+#include "cc_event.h"
+#include "gs_mqtt.h"
+#include "gs_wifi.h"
+#include "app_httpd.h"
+
+static const char *TAG = "evt_log";
+
+#if CONFIG_EVT_LOG
+
+#define EVT_LOG_NUM             CONFIG_EVT_LOG_RECORDS
+#define EVT_LOG_STORE_MAGIC     0x45564C47      // "EVLG"
+// 一条 MQTT 消息放多少条记录，不超过 gs_mqtt 的 512 字节
+#define EVT_LOG_MQTT_RECS       ((512 - sizeof(evt_log_hdr_t)) / sizeof(evt_log_rec_t))
+#define EVT_LOG_MQTT_MAX        256             // 一次请求最多发布的记录数
+#define EVT_LOG_HTTP_RECS       64
+
+_Static_assert((EVT_LOG_NUM & (EVT_LOG_NUM - 1)) == 0, "CONFIG_EVT_LOG_RECORDS must be a power of 2");
+_Static_assert(sizeof(evt_log_rec_t) == 16, "evt_log_rec_t is part of the wire format");
+
+typedef struct {
+    uint32_t magic;
+    uint32_t seq;               // 最后写入的序号
+    evt_log_rec_t recs[EVT_LOG_NUM];
+} evt_log_store_t;
+
+#if CONFIG_EVT_LOG_KEEP_ON_RESET
+// 不初始化的 PSRAM 段，非上电复位后内容仍在
+static EXT_RAM_NOINIT_ATTR evt_log_store_t s_store_noinit;
+#endif
+static evt_log_store_t *s_store = NULL;
+
+void evt_log(evt_log_mod_t mod, uint8_t evt, uint16_t a16, uint32_t a32)
+{
+    evt_log_store_t *store = s_store;
+    if (!store) {
+        return;
+    }
+    uint32_t seq = __atomic_add_fetch(&store->seq, 1, __ATOMIC_RELAXED);
+    evt_log_rec_t *rec = &store->recs[seq & (EVT_LOG_NUM - 1)];
+    // 先清序号，读者据此丢弃写了一半的记录
+    __atomic_store_n(&rec->seq, 0, __ATOMIC_RELAXED);
+    rec->ts_ms = (uint32_t)(esp_timer_get_time() / 1000);
+    rec->mod = (uint8_t)mod;
+    rec->evt = evt;
+    rec->a16 = a16;
+    rec->a32 = a32;
+    __atomic_store_n(&rec->seq, seq, __ATOMIC_RELEASE);
+}
+
+size_t evt_log_read(uint32_t since, evt_log_rec_t *out, size_t max, uint32_t *next)
+{
+    size_t count = 0;
+    uint32_t seq = since;
+    if (s_store) {
+        uint32_t head = __atomic_load_n(&s_store->seq, __ATOMIC_ACQUIRE);
+        uint32_t oldest = (head >= EVT_LOG_NUM) ? head - EVT_LOG_NUM + 1 : 1;
+        if (seq < oldest - 1) {
+            seq = oldest - 1;
+        }
+        while (seq < head && count < max) {
+            seq++;
+            const evt_log_rec_t *rec = &s_store->recs[seq & (EVT_LOG_NUM - 1)];
+            if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) != seq) {
+                continue;
+            }
+            out[count] = *rec;
+            // 拷贝期间被覆盖则丢弃
+            if (__atomic_load_n(&rec->seq, __ATOMIC_ACQUIRE) == seq) {
+                count++;
+            }
+        }
+    }
+    if (next) {
+        *next = seq;
+    }
+    return count;
+}
+
+static void evt_log_hdr_fill(evt_log_hdr_t *hdr, size_t count)
+{
+    hdr->magic = EVT_LOG_HDR_MAGIC;
+    hdr->ver = EVT_LOG_HDR_VER;
+    hdr->rec_size = sizeof(evt_log_rec_t);
+    hdr->count = (uint8_t)count;
+    hdr->now_ms = (uint32_t)(esp_timer_get_time() / 1000);
+}
+
+// 云端取日志：{"since":N,"max":M}，在 MQTT 任务中回调
+static void evt_log_req_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    uint32_t since = 0;
+    uint32_t max = EVT_LOG_MQTT_MAX;
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (root) {
+        cJSON *obj = cJSON_GetObjectItem(root, "since");
+        if (cJSON_IsNumber(obj) && obj->valuedouble > 0) {
+            since = (uint32_t)obj->valuedouble;
+        }
+        obj = cJSON_GetObjectItem(root, "max");
+        if (cJSON_IsNumber(obj) && obj->valueint > 0 && obj->valueint < EVT_LOG_MQTT_MAX) {
+            max = obj->valueint;
+        }
+        cJSON_Delete(root);
+    }
+
+    static uint8_t buf[sizeof(evt_log_hdr_t) + EVT_LOG_MQTT_RECS * sizeof(evt_log_rec_t)];
+    evt_log_hdr_t *hdr = (evt_log_hdr_t *)buf;
+    evt_log_rec_t *recs = (evt_log_rec_t *)(buf + sizeof(evt_log_hdr_t));
+    uint32_t sent = 0;
+    while (sent < max) {
+        size_t want = max - sent < EVT_LOG_MQTT_RECS ? max - sent : EVT_LOG_MQTT_RECS;
+        size_t n = evt_log_read(since, recs, want, &since);
+        if (n == 0) {
+            break;
+        }
+        evt_log_hdr_fill(hdr, n);
+        gs_mqtt_publish(EVT_LOG_TOPIC_POST, buf, sizeof(evt_log_hdr_t) + n * sizeof(evt_log_rec_t), GS_MQTT_QOS0, 0);
+        sent += n;
+    }
+    if (sent == 0) {
+        // 空结果也回一个头，云端据此知道已取完
+        evt_log_hdr_fill(hdr, 0);
+        gs_mqtt_publish(EVT_LOG_TOPIC_POST, buf, sizeof(evt_log_hdr_t), GS_MQTT_QOS0, 0);
+    }
+    ESP_LOGI(TAG, "%u records sent, next since=%u", (unsigned)sent, (unsigned)since);
+}
+
+static esp_err_t evt_log_http_handler(httpd_req_t *req)
+{
+    char query[32];
+    char value[12];
+    uint32_t since = 0;
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) == ESP_OK &&
+        httpd_query_key_value(query, "since", value, sizeof(value)) == ESP_OK) {
+        since = strtoul(value, NULL, 10);
+    }
+
+    evt_log_rec_t *recs = malloc(EVT_LOG_HTTP_RECS * sizeof(evt_log_rec_t));
+    if (!recs) {
+        return httpd_resp_send_500(req);
+    }
+    httpd_resp_set_type(req, "application/octet-stream");
+
+    // 每段一个头，与 MQTT 分片相同
+    evt_log_hdr_t hdr;
+    esp_err_t ret = ESP_OK;
+    size_t n;
+    while (ret == ESP_OK && (n = evt_log_read(since, recs, EVT_LOG_HTTP_RECS, &since)) > 0) {
+        evt_log_hdr_fill(&hdr, n);
+        ret = httpd_resp_send_chunk(req, (const char *)&hdr, sizeof(hdr));
+        if (ret == ESP_OK) {
+            ret = httpd_resp_send_chunk(req, (const char *)recs, n * sizeof(evt_log_rec_t));
+        }
+    }
+    free(recs);
+    if (ret == ESP_OK) {
+        ret = httpd_resp_send_chunk(req, NULL, 0);
+    }
+    return ret;
+}
+
+static void evt_log_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (base_event == GS_WIFI_EVENT) {
+        evt_log(EVT_MOD_WIFI, (uint8_t)id, 0, 0);
+    } else if (base_event == GS_MQTT_EVENT) {
+        evt_log(EVT_MOD_MQTT, (uint8_t)id, 0, 0);
+        if (id == GS_MQTT_EVENT_CONNECTED) {
+            gs_mqtt_subscribe(EVT_LOG_TOPIC_REQ, GS_MQTT_QOS0);
+        }
+    }
+}
+
+static void evt_log_shutdown(void)
+{
+    evt_log(EVT_MOD_SYS, EVT_SYS_RESTART, 0, 0);
+}
+
+esp_err_t evt_log_init(void)
+{
+    if (s_store) {
+        return ESP_OK;
+    }
+
+    esp_reset_reason_t reason = esp_reset_reason();
+    uint32_t kept = 0;
+#if CONFIG_EVT_LOG_KEEP_ON_RESET
+    evt_log_store_t *store = &s_store_noinit;
+    if (store->magic == EVT_LOG_STORE_MAGIC && reason != ESP_RST_POWERON && reason != ESP_RST_BROWNOUT) {
+        kept = store->seq < EVT_LOG_NUM ? store->seq : EVT_LOG_NUM;
+    } else {
+        memset(store, 0, sizeof(*store));
+        store->magic = EVT_LOG_STORE_MAGIC;
+    }
+#else
+    evt_log_store_t *store = heap_caps_calloc(1, sizeof(evt_log_store_t), MALLOC_CAP_SPIRAM);
+    if (!store) {
+        store = calloc(1, sizeof(evt_log_store_t));
+    }
+    if (!store) {
+        ESP_LOGE(TAG, "no memory for %d records", EVT_LOG_NUM);
+        return ESP_ERR_NO_MEM;
+    }
+    store->magic = EVT_LOG_STORE_MAGIC;
+#endif
+    s_store = store;
+    evt_log(EVT_MOD_SYS, EVT_SYS_BOOT, (uint16_t)reason, kept);
+
+    gs_mqtt_register_topic_msg_cb(EVT_LOG_TOPIC_REQ, evt_log_req_cb);
+    cc_event_register_handler(GS_WIFI_EVENT, evt_log_event_handler);
+    cc_event_register_handler(GS_MQTT_EVENT, evt_log_event_handler);
+    esp_register_shutdown_handler(evt_log_shutdown);
+
+    ESP_LOGI(TAG, "%d records, %u kept from the last run, reset reason %d", EVT_LOG_NUM, (unsigned)kept, reason);
+    return ESP_OK;
+}
+
+esp_err_t evt_log_httpd_register(void)
+{
+    static const httpd_uri_t uri = {
+        .uri = "/evtlog",
+        .method = HTTP_GET,
+        .handler = evt_log_http_handler,
+        .user_ctx = NULL,
+    };
+    return app_httpd_register_uri(&uri);
+}
+
+#else
+
+esp_err_t evt_log_init(void)
+{
+    return ESP_OK;
+}
+
+size_t evt_log_read(uint32_t since, evt_log_rec_t *out, size_t max, uint32_t *next)
+{
+    if (next) {
+        *next = since;
+    }
+    return 0;
+}
+
+esp_err_t evt_log_httpd_register(void)
+{
+    ESP_LOGW(TAG, "disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_EVT_LOG
@@ -0,0 +1,99 @@
+/**
+ * @file evt_log.h
+ * @brief 二进制事件日志：定长记录写入 PSRAM 环形缓冲，可经 MQTT 或 HTTP 取回
+ *
+ * 每条记录 16 字节（序号、毫秒时间戳、模块、事件、两个参数），写入只有一次原子加和几次存储，
+ * 不做字符串格式化，可在量产固件中常开。开启 CONFIG_EVT_LOG_KEEP_ON_RESET 时缓冲位于
+ * 不初始化的 PSRAM 段，panic/看门狗等非上电复位后保留上一次运行的记录，以 BOOT 记录分隔。
+ *
+ * 取回：
+ *  - MQTT：向 EVT_LOG_TOPIC_REQ 下发 {"since":序号,"max":条数}，记录分片发布到 EVT_LOG_TOPIC_POST；
+ *  - HTTP：app_httpd 上的 GET /evtlog?since=序号。
+ * 两者负载相同：evt_log_hdr_t 后跟 count 条 evt_log_rec_t，小端。
+ */
+
+#ifndef EVT_LOG_H
+#define EVT_LOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define EVT_LOG_TOPIC_REQ       "/service/evtlog"
+#define EVT_LOG_TOPIC_POST      "/event/evtlog/post"
+#define EVT_LOG_HDR_MAGIC       0xE7
+#define EVT_LOG_HDR_VER         1
+
+typedef enum {
+    EVT_MOD_SYS = 0,
+    EVT_MOD_WIFI,               // 事件为 GS_WIFI_EVENT 的 id
+    EVT_MOD_MQTT,               // 事件为 GS_MQTT_EVENT 的 id
+    EVT_MOD_UART,               // 事件为收到的 MCU 命令字
+    EVT_MOD_UNLOCK,             // 事件为 unlock_trace_point_t
+    EVT_MOD_IMG,
+} evt_log_mod_t;
+
+typedef enum {
+    EVT_SYS_BOOT = 0,           // a16=复位原因，a32=保留下来的上次运行的记录数
+    EVT_SYS_RESTART,            // esp_restart() 前
+    EVT_SYS_HEAP_LOW,           // a32=最小空闲堆
+} evt_log_sys_t;
+
+typedef enum {
+    EVT_IMG_RESULT = 0,         // a16=结果码，a32=图片字节数
+    EVT_IMG_MOTION,             // a16=变化的网格数，a32=触发帧字节数
+    EVT_IMG_CLIP,               // 事件短视频结束，a16=esp_err_t 低 16 位
+    EVT_IMG_DETECT,             // 检测到目标，a16=目标数，a32=裁剪图字节数
+} evt_log_img_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t seq;               // 从 1 开始递增，跨保留的复位连续
+    uint32_t ts_ms;             // 本次运行的启动后毫秒数
+    uint8_t mod;
+    uint8_t evt;
+    uint16_t a16;
+    uint32_t a32;
+} evt_log_rec_t;
+
+typedef struct __attribute__((packed)) {
+    uint8_t magic;              // EVT_LOG_HDR_MAGIC
+    uint8_t ver;
+    uint8_t rec_size;           // sizeof(evt_log_rec_t)
+    uint8_t count;              // 其后的记录数
+    uint32_t now_ms;            // 生成时的毫秒时间戳，用于换算记录的绝对时间
+} evt_log_hdr_t;
+
+/**
+ * @brief 分配（或接管复位前的）缓冲，登记 MQTT 取回命令，须在 cc_event_init() 之后调用
+ */
+esp_err_t evt_log_init(void);
+
+#if CONFIG_EVT_LOG
+/**
+ * @brief 写一条记录，无锁，可在任意任务或中断中调用；初始化前调用被忽略
+ */
+void evt_log(evt_log_mod_t mod, uint8_t evt, uint16_t a16, uint32_t a32);
+#else
+static inline void evt_log(evt_log_mod_t mod, uint8_t evt, uint16_t a16, uint32_t a32) {}
+#endif
+
+/**
+ * @brief 按序号顺序拷出 seq > since 的记录，最多 max 条，返回条数；*next 为下次的 since
+ */
+size_t evt_log_read(uint32_t since, evt_log_rec_t *out, size_t max, uint32_t *next);
+
+/**
+ * @brief 在 app_httpd 上注册 GET /evtlog，须在 app_httpd_main() 之前或之后任意时刻调用
+ */
+esp_err_t evt_log_httpd_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // EVT_LOG_H
@@ -7,13 +7,20 @@
 #include "frame_parser.h"
 
 #include <stdio.h>
+#include <string.h>
 
-#include "rbuffer.h"
+#include "rbuffer_spsc.h"
 
-static rbuffer_handle_t g_rbuffer;
+// 写入（串口接收）与解析可以在不同任务中进行
+static rbuffer_spsc_handle_t g_rbuffer;
 
 bool frame_parser_init(uint32_t size){
-    g_rbuffer = rbuffer_create(size);
+    // 无锁环形缓冲要求容量为 2 的幂，向上取整
+    uint32_t cap = 1;
+    while (cap < size){
+        cap <<= 1;
+    }
+    g_rbuffer = rbuffer_spsc_create(cap);
     if(NULL == g_rbuffer){
         return false;
     }
@@ -21,14 +28,47 @@ bool frame_parser_init(uint32_t size){
 }
 
 void frame_parser_reset(void){
-    rbuffer_reset(g_rbuffer);
+    // 由解析方调用，丢弃所有未解析的数据
+    rbuffer_spsc_commit_read(g_rbuffer, rbuffer_spsc_used_size(g_rbuffer));
 }
 
 uint32_t frame_parser_add_buf(uint8_t *buf, uint32_t len){
     if(NULL == g_rbuffer){
         return 0;
     }
-    return rbuffer_push(g_rbuffer, buf, len, false);
+    return rbuffer_spsc_push(g_rbuffer, buf, len);
+}
+
+// 读取 offset 处的帧头，不足返回 false
+static bool __peek_head(uint32_t offset, frame_parser_head_t *head){
+    rbuffer_span_t span[2];
+    uint32_t avail = rbuffer_spsc_peek(g_rbuffer, offset, span);
+    if(avail < sizeof(frame_parser_head_t)){
+        return false;
+    }
+    uint32_t first = (span[0].len < sizeof(frame_parser_head_t)) ? span[0].len : sizeof(frame_parser_head_t);
+    memcpy(head, span[0].data, first);
+    if(first < sizeof(frame_parser_head_t)){
+        memcpy((uint8_t *)head + first, span[1].data, sizeof(frame_parser_head_t) - first);
+    }
+    return true;
+}
+
+// 从 offset 开始查找帧头，返回相对读位置的偏移，未找到返回 -1
+static int32_t __find_head(uint32_t offset){
+    frame_parser_head_t head;
+    int32_t pos;
+    while ((pos = rbuffer_spsc_find_byte(g_rbuffer, offset, FRAME_PARSER_HEAD & 0xFF)) >= 0){
+        if(!__peek_head(pos, &head)){
+            // 帧头不完整，等待更多数据
+            return pos;
+        }
+        if(head.head == FRAME_PARSER_HEAD){
+            return pos;
+        }
+        offset = pos + 1;
+    }
+    return -1;
 }
 
 bool frame_parser_get_frame(uint8_t *frame, uint32_t *len){
@@ -36,79 +76,44 @@ bool frame_parser_get_frame(uint8_t *frame, uint32_t *len){
         return false;
     }
 
-    while (rbuffer_used_size(g_rbuffer) >= FRAME_MIN_LEN)
+    uint32_t used;
+    while ((used = rbuffer_spsc_used_size(g_rbuffer)) >= FRAME_MIN_LEN)
     {
-        frame_parser_head_t *head = NULL;
-        // frame_parser_last_t *last = NULL;
-        uint32_t try_len = 0;
-        uint32_t try_index = 0;
-        uint32_t remove_len = 0;
+        frame_parser_head_t head;
         uint32_t frame_len = 0;
-        uint32_t start_index = 0;
-        uint8_t buf[FRAME_MAX_LEN] = {0};
+        int32_t pos = __find_head(0);
 
-        try_len = rbuffer_used_size(g_rbuffer);
-        rbuffer_get_head_index(g_rbuffer, &try_index);
-        while (try_len > sizeof(frame_parser_head_t))
-        {
-            rbuffer_get_buffer(g_rbuffer, try_index, buf, sizeof(frame_parser_head_t));
-            head =  (frame_parser_head_t *)buf;
-            if(FRAME_PARSER_HEAD == head->head){
-                break;
-            }else{
-                rbuffer_discard(g_rbuffer, 1);
-            }
-            try_len--;
-            try_index++;
+        if(pos < 0){
+            // 已扫描的数据中没有帧头，丢弃（只丢弃扫描前已有的部分，之后写入的保留）
+            rbuffer_spsc_commit_read(g_rbuffer, used);
+            return false;
         }
-        
-        if(try_len < (sizeof(frame_parser_head_t) + FRAME_DATA_LEN(head)) + sizeof(frame_parser_last_t)){
-            remove_len += sizeof(head->head);
-            try_len -= sizeof(head->head);
-            try_index += sizeof(head->head);
-            if(try_len >= FRAME_MIN_LEN){
-                while (try_len > sizeof(frame_parser_head_t))
-                {
-                    rbuffer_get_buffer(g_rbuffer, try_index, buf, sizeof(frame_parser_head_t));
-                    head =  (frame_parser_head_t *)buf;
-                    if(FRAME_PARSER_HEAD == head->head){
-                        break;
-                    }
-                    try_len--;
-                    try_index++;
-                    remove_len++;
-                }
-                if(try_len <= sizeof(frame_parser_head_t)){
-                    return false;
-                }
-            }else{
-                return false;
-            }
+        if(pos > 0){
+            rbuffer_spsc_commit_read(g_rbuffer, pos);
+        }
+        if(!__peek_head(0, &head)){
+            return false;
         }
 
-        start_index = try_index;
-        frame_len = (sizeof(frame_parser_head_t) + FRAME_DATA_LEN(head));
-        try_len -= (sizeof(frame_parser_head_t) + FRAME_DATA_LEN(head));
-        try_index += (sizeof(frame_parser_head_t) + FRAME_DATA_LEN(head));
+        frame_len = sizeof(frame_parser_head_t) + FRAME_DATA_LEN((&head)) + sizeof(frame_parser_last_t);
+        if(frame_len > FRAME_MAX_LEN){
+            // 长度非法，跳过该帧头重新同步
+            rbuffer_spsc_commit_read(g_rbuffer, sizeof(head.head));
+            continue;
+        }
 
-        if(try_len >= sizeof(frame_parser_last_t)){
-            rbuffer_get_buffer(g_rbuffer, try_index, buf, sizeof(frame_parser_last_t));
-            // last = (frame_parser_last_t *)buf;
-            if(1){
-                frame_len += sizeof(frame_parser_last_t);
-                rbuffer_get_buffer(g_rbuffer, start_index, frame, frame_len);
-                *len = frame_len;
-                rbuffer_discard(g_rbuffer, frame_len);
-                if(remove_len){
-                   rbuffer_discard(g_rbuffer, remove_len); 
-                }
-                return true;
-            }else{
-                rbuffer_discard(g_rbuffer, 2);
+        if(rbuffer_spsc_used_size(g_rbuffer) < frame_len){
+            // 帧不完整：后面若已出现新的帧头，认为当前帧头是误判，丢弃后从新帧头解析
+            int32_t next = __find_head(sizeof(head.head));
+            if(next >= 0 && rbuffer_spsc_used_size(g_rbuffer) - next >= FRAME_MIN_LEN){
+                rbuffer_spsc_commit_read(g_rbuffer, next);
+                continue;
             }
-        }else{
             return false;
         }
+
+        *len = rbuffer_spsc_pop(g_rbuffer, frame, frame_len);
+        return true;
     }
     return false;
-}
\ No newline at end of file
+}
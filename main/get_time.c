@@ -1,27 +1,52 @@
 /************************************************
  * File: get_time.c
  ************************************************/
+#include "sdkconfig.h"
 #include "get_time.h"
 
 #include <string.h>
 #include <stdio.h>
+#include <sys/time.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "esp_timer.h"
+#include "esp_netif_sntp.h"
 #include "esp_http_client.h"
 #include "cJSON.h"
+#include "cc_hal_kvs.h"
+#include "gs_mqtt.h"
+#include "conn_mgr.h"
 
 static const char *TAG = "get_time";
 
+CC_EVENT_DEFINE_BASE(GET_TIME_EVENT);
+
 /*======================
  * 内部全局变量
  *=====================*/
 
-// 存放最新UTC和时区
-static uint32_t s_utc_time  = 0;
-static int8_t   s_time_zone = 0;
+// 时钟基准：base_utc_us 对应单调时钟 base_mono_us，之后按 drift_ppb 补偿推算
+static portMUX_TYPE s_clock_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_base_utc_us  = 0;
+static int64_t s_base_mono_us = 0;
+static int32_t s_drift_ppb    = 0;
+static bool    s_base_sntp    = false;  // 基准来自 SNTP（毫秒精度），可用于估计漂移
+static bool    s_drift_known  = false;
+static volatile bool s_valid  = false;
+
+static int8_t  s_time_zone    = 0;
+static bool    s_zone_fetched = false;  // 本次上电已从 HTTP 拿到时区
+
+#define TIME_ZONE_KVS_KEY       "time_zone"
+
+// 漂移估计：两次 SNTP 同步间隔太短时秒级以下的网络抖动占比过大
+#define DRIFT_MIN_INTERVAL_US   (10LL * 60 * 1000000)
+#define DRIFT_MAX_PPB           500000      // 晶振标称误差远小于 500ppm，超出视为跳变
+#define UTC_MIN_VALID           1672502400  // 2023-01-01，更早的结果视为无效
 
 // HTTP响应缓冲
 #define RESP_BUF_SIZE 1024
@@ -30,19 +55,78 @@ static int  s_resp_len = 0;
 
 // 事件组 & 事件位
 static EventGroupHandle_t s_time_event_group = NULL;
-#define TIME_UPDATE_DONE_BIT    BIT0
-#define TIME_UPDATE_SUCCESS_BIT BIT1
+#define TIME_VALID_BIT          BIT0
+
+// HTTP 兜底的重试
+#define HTTP_RETRY_MIN_MS       2000
+#define HTTP_RETRY_MAX_MS       60000
+#define HTTP_ZONE_MAX_TRIES     3           // 时间已由 SNTP 给出时，只为时区重试的次数
 
-// 最大重试次数
-static const int MAX_RETRIES = 3;
-static int s_retry_count = 0;
+static TaskHandle_t s_task = NULL;
+static bool s_sntp_started = false;
 
 /*======================
  * 内部函数声明
  *=====================*/
+static void time_task(void *arg);
 static esp_err_t do_http_request(void);
+static esp_err_t do_rpc_request(void);
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt);
-static void parse_time_json(const char *json_str);
+static esp_err_t parse_time_json(const char *json_str);
+static void sntp_sync_cb(struct timeval *tv);
+
+/*======================
+ * 时钟
+ *=====================*/
+
+static int64_t clock_now_us_locked(int64_t mono_us)
+{
+    int64_t dt = mono_us - s_base_mono_us;
+    return s_base_utc_us + dt + dt * s_drift_ppb / 1000000000LL;
+}
+
+/**
+ * @brief 记录一次同步结果
+ *
+ * @param utc_us  同步得到的UTC(us)
+ * @param mono_us 对应的单调时钟
+ * @param sntp    来自 SNTP（可用于估计漂移），HTTP 只有秒级精度
+ */
+static void clock_sample(int64_t utc_us, int64_t mono_us, bool sntp)
+{
+    bool first;
+    int64_t err_us = 0;
+
+    taskENTER_CRITICAL(&s_clock_lock);
+    first = !s_valid;
+    if (!first) {
+        err_us = utc_us - clock_now_us_locked(mono_us);
+        int64_t elapsed = mono_us - s_base_mono_us;
+        if (sntp && s_base_sntp && elapsed >= DRIFT_MIN_INTERVAL_US) {
+            int64_t ppb = ((utc_us - s_base_utc_us) - elapsed) * 1000000000LL / elapsed;
+            if (ppb > -DRIFT_MAX_PPB && ppb < DRIFT_MAX_PPB) {
+                // 平滑，单次网络延迟的抖动不直接进入补偿
+                s_drift_ppb = s_drift_known ? (int32_t)(s_drift_ppb + (ppb - s_drift_ppb) / 4) : (int32_t)ppb;
+                s_drift_known = true;
+            }
+        }
+    }
+    s_base_utc_us  = utc_us;
+    s_base_mono_us = mono_us;
+    s_base_sntp    = sntp;
+    s_valid        = true;
+    taskEXIT_CRITICAL(&s_clock_lock);
+
+    if (first) {
+        ESP_LOGI(TAG, "time valid (%s): utc=%lld", sntp ? "sntp" : "http", (long long)(utc_us / 1000000));
+        xEventGroupSetBits(s_time_event_group, TIME_VALID_BIT);
+        cc_event_post(GET_TIME_EVENT, GET_TIME_EVENT_VALID, NULL, 0);
+    } else {
+        ESP_LOGI(TAG, "time sync (%s): err=%lld ms, drift=%ld ppb", sntp ? "sntp" : "http",
+                 (long long)(err_us / 1000), (long)s_drift_ppb);
+        cc_event_post(GET_TIME_EVENT, GET_TIME_EVENT_SYNC, NULL, 0);
+    }
+}
 
 /*======================
  * 对外接口实现
@@ -53,9 +137,11 @@ static void parse_time_json(const char *json_str);
  */
 void get_time_init(void)
 {
-    // 初始化缓存
-    s_utc_time  = 0;
-    s_time_zone = 0;
+    // 时区先用上次保存的值，UART 0x10 在联网前也能给出
+    size_t len = sizeof(s_time_zone);
+    if (cc_hal_kvs_get(TIME_ZONE_KVS_KEY, &s_time_zone, &len) != CC_OK || len != sizeof(s_time_zone)) {
+        s_time_zone = 0;
+    }
 
     // 创建事件组
     s_time_event_group = xEventGroupCreate();
@@ -63,40 +149,56 @@ void get_time_init(void)
         ESP_LOGE(TAG, "Failed to create event group for time!");
     }
 
-    ESP_LOGI(TAG, "get_time_init done");
+    ESP_LOGI(TAG, "get_time_init done, cached timezone=%d", (int)s_time_zone);
 }
 
 /**
  * @brief 启动一次获取时间的流程
  *
- * 可能执行最多3次重试。函数本身阻塞执行HTTP请求(esp_http_client_perform)，
- * 但不等待解析完成(由事件回调负责解析)。
+ * SNTP 只启动一次，之后由 lwIP 按 CONFIG_LWIP_SNTP_UPDATE_DELAY 周期同步；
+ * 后台任务等待 SNTP，超时或缺时区时走 HTTP。
  */
 esp_err_t get_time_start_update(void)
 {
-    // 每次开始前清除事件位
-    xEventGroupClearBits(s_time_event_group, 
-                         TIME_UPDATE_DONE_BIT | TIME_UPDATE_SUCCESS_BIT);
+    if (!s_sntp_started) {
+        esp_sntp_config_t config = ESP_NETIF_SNTP_DEFAULT_CONFIG(CONFIG_GET_TIME_SNTP_SERVER);
+        config.sync_cb = sntp_sync_cb;
+        esp_err_t err = esp_netif_sntp_init(&config);
+        if (err == ESP_OK) {
+            s_sntp_started = true;
+        } else {
+            ESP_LOGW(TAG, "sntp init failed: %s, http only", esp_err_to_name(err));
+        }
+    }
 
-    s_retry_count = 0;
-    return do_http_request();
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(time_task, "get_time", 4096, NULL, 4, &s_task) != pdPASS) {
+        s_task = NULL;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
 }
 
 /**
- * @brief 阻塞等待“获取时间”完成(成功或失败)
+ * @brief 阻塞等待时间有效
  */
 bool get_time_wait_done(uint32_t timeout_ms)
 {
     EventBits_t bits = xEventGroupWaitBits(
         s_time_event_group,
-        TIME_UPDATE_DONE_BIT | TIME_UPDATE_SUCCESS_BIT,
-        pdTRUE,    // 读取后清除
-        pdFALSE,   // 任意一个位即可返回
+        TIME_VALID_BIT,
+        pdFALSE,   // 有效后一直保持
+        pdTRUE,
         pdMS_TO_TICKS(timeout_ms)
     );
+    return (bits & TIME_VALID_BIT) != 0;
+}
 
-    // 如果包含SUCCESS_BIT则表示成功
-    return (bits & TIME_UPDATE_SUCCESS_BIT) != 0;
+bool get_time_is_valid(void)
+{
+    return s_valid;
 }
 
 /**
@@ -104,7 +206,15 @@ bool get_time_wait_done(uint32_t timeout_ms)
  */
 uint32_t get_time_get_utc(void)
 {
-    return s_utc_time;
+    int64_t utc_us;
+
+    if (!s_valid) {
+        return 0;
+    }
+    taskENTER_CRITICAL(&s_clock_lock);
+    utc_us = clock_now_us_locked(esp_timer_get_time());
+    taskEXIT_CRITICAL(&s_clock_lock);
+    return (uint32_t)(utc_us / 1000000);
 }
 
 /**
@@ -120,7 +230,56 @@ int8_t get_time_get_timezone(void)
  *=====================*/
 
 /**
- * @brief 真正执行 HTTP 请求并带重试
+ * @brief SNTP 同步回调，在 lwIP 任务中调用，系统时间已由 SNTP 设置
+ */
+static void sntp_sync_cb(struct timeval *tv)
+{
+    int64_t mono_us = esp_timer_get_time();
+    if (tv->tv_sec < UTC_MIN_VALID) {
+        return;
+    }
+    clock_sample((int64_t)tv->tv_sec * 1000000 + tv->tv_usec, mono_us, true);
+}
+
+/**
+ * @brief 后台获取：先给 SNTP 一段时间，没有结果或还没有时区时走 HTTP，失败按指数退避重试
+ */
+static void time_task(void *arg)
+{
+    uint32_t backoff = HTTP_RETRY_MIN_MS;
+    int zone_tries = 0;
+
+    if (s_sntp_started) {
+        xEventGroupWaitBits(s_time_event_group, TIME_VALID_BIT, pdFALSE, pdTRUE,
+                            pdMS_TO_TICKS(CONFIG_GET_TIME_SNTP_WAIT_MS));
+    }
+
+    while (!(s_valid && s_zone_fetched)) {
+        // MQTT 已连接时复用其会话，不再单独建 HTTP 连接
+        if (do_rpc_request() == ESP_OK || do_http_request() == ESP_OK) {
+            break;
+        }
+        if (s_valid && ++zone_tries >= HTTP_ZONE_MAX_TRIES) {
+            ESP_LOGW(TAG, "timezone not updated, keep %d", (int)s_time_zone);
+            break;
+        }
+        if (s_valid) {
+            vTaskDelay(pdMS_TO_TICKS(backoff));
+        } else {
+            // SNTP 在等待期间同步成功时提前醒来，只剩时区需要获取
+            xEventGroupWaitBits(s_time_event_group, TIME_VALID_BIT, pdFALSE, pdTRUE, pdMS_TO_TICKS(backoff));
+        }
+        backoff = (backoff * 2 > HTTP_RETRY_MAX_MS) ? HTTP_RETRY_MAX_MS : backoff * 2;
+    }
+
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+static conn_mgr_conn_t s_http_conn = CONN_MGR_CONN_INIT("get_time");
+
+/**
+ * @brief 执行一次 HTTP 请求并解析
  */
 static esp_err_t do_http_request(void)
 {
@@ -129,11 +288,9 @@ static esp_err_t do_http_request(void)
     s_resp_len = 0;
     memset(s_resp_buf, 0, sizeof(s_resp_buf));
 
-    ESP_LOGI(TAG, "do_http_request: attempt=%d/%d", s_retry_count+1, MAX_RETRIES);
-
     // 配置 HTTP 客户端
     esp_http_client_config_t config = {
-        .url           = "http://gaoshi.wdaoyun.cn/mqtt/getTime.php",
+        .url           = "http://" GS_MQTT_API_HOST "/mqtt/getTime.php",
         .event_handler = _http_event_handler,
         .timeout_ms    = 3000,
     };
@@ -144,30 +301,71 @@ static esp_err_t do_http_request(void)
         return ESP_FAIL;
     }
 
-    // 同步执行请求
-    err = esp_http_client_perform(client);
+    // 对时可以稍后重试，名额紧张时不长时间占着对时任务
+    conn_mgr_attach(&s_http_conn, client, config.url);
+    err = conn_mgr_lease(&s_http_conn, CONN_PRIO_NORMAL, 3000);
+    if (err == ESP_OK) {
+        err = esp_http_client_perform(client);
+        conn_mgr_return(&s_http_conn, false);
+    }
+    int status = esp_http_client_get_status_code(client);
+    conn_mgr_detach(&s_http_conn);
+    esp_http_client_cleanup(client);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "HTTP request failed: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
+        return err;
+    }
+    if (status != 200 || s_resp_len == 0) {
+        ESP_LOGE(TAG, "HTTP status=%d, len=%d", status, s_resp_len);
+        return ESP_FAIL;
+    }
+    return parse_time_json(s_resp_buf);
+}
 
-        // 若失败则重试(最多3次)
-        s_retry_count++;
-        if (s_retry_count < MAX_RETRIES) {
-            vTaskDelay(pdMS_TO_TICKS(1000));
-            return do_http_request();
-        } else {
-            // 超过最大重试
-            return err;
-        }
+static SemaphoreHandle_t s_rpc_done = NULL;
+static esp_err_t s_rpc_result = ESP_FAIL;
+
+// 在网络任务中回调
+static void rpc_time_cb(void *arg, int resp_code, uint8_t *buf, uint16_t len)
+{
+    if (resp_code == 200 && buf && len > 0) {
+        buf[len] = '\0';
+        s_rpc_result = parse_time_json((const char *)buf);
+    } else {
+        ESP_LOGW(TAG, "rpc time failed, code=%d", resp_code);
+        s_rpc_result = ESP_FAIL;
     }
+    xSemaphoreGive(s_rpc_done);
+}
 
-    // 成功发送并收到响应(阻塞到HTTP完毕)
-    esp_http_client_cleanup(client);
-    return ESP_OK;
+/**
+ * @brief 经 MQTT RPC 获取时间与时区，响应与 HTTP 接口相同；未连接时直接返回失败
+ */
+static esp_err_t do_rpc_request(void)
+{
+    if (!gs_mqtt_connect_status()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!s_rpc_done) {
+        s_rpc_done = xSemaphoreCreateBinary();
+        if (!s_rpc_done) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    xSemaphoreTake(s_rpc_done, 0);
+    s_rpc_result = ESP_FAIL;
+    if (gs_mqtt_rpc_call("time.get", NULL, NULL, GS_MQTT_RPC_TIMEOUT_MS, rpc_time_cb, NULL) != CC_OK) {
+        return ESP_FAIL;
+    }
+    // 超时、断线时 gs_mqtt 以 -1 回调，这里多等一个轮询周期
+    if (xSemaphoreTake(s_rpc_done, pdMS_TO_TICKS(GS_MQTT_RPC_TIMEOUT_MS + 1000)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+    return s_rpc_result;
 }
 
 /**
- * @brief HTTP事件回调：收集数据并在FINISH时解析
+ * @brief HTTP事件回调：收集数据
  */
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
 {
@@ -182,26 +380,11 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
             s_resp_len += copy_len;
             s_resp_buf[s_resp_len] = '\0';
         }
-        ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
         break;
     }
-    case HTTP_EVENT_ON_FINISH: {
-        ESP_LOGI(TAG, "HTTP_EVENT_ON_FINISH => total=%d bytes", s_resp_len);
-        if (s_resp_len > 0) {
-            parse_time_json(s_resp_buf);
-            xEventGroupSetBits(s_time_event_group,
-                               TIME_UPDATE_DONE_BIT | TIME_UPDATE_SUCCESS_BIT);
-        } else {
-            // 无数据，不算成功
-            xEventGroupSetBits(s_time_event_group, TIME_UPDATE_DONE_BIT);
-        }
-        break;
-    }
-    case HTTP_EVENT_ERROR: {
+    case HTTP_EVENT_ERROR:
         ESP_LOGW(TAG, "HTTP_EVENT_ERROR");
-        xEventGroupSetBits(s_time_event_group, TIME_UPDATE_DONE_BIT);
         break;
-    }
     default:
         break;
     }
@@ -212,20 +395,30 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
  * @brief 解析 JSON 响应
  * 形如 {"time":1234, "zone":"UTC +8"}
  */
-static void parse_time_json(const char *json_str)
+static esp_err_t parse_time_json(const char *json_str)
 {
+    int64_t mono_us = esp_timer_get_time();
     cJSON *root = cJSON_Parse(json_str);
     if (!root) {
         ESP_LOGE(TAG, "Failed to parse JSON");
-        return;
+        return ESP_FAIL;
     }
 
     cJSON *time_item = cJSON_GetObjectItem(root, "time");
     cJSON *zone_item = cJSON_GetObjectItem(root, "zone");
 
-    // UTC时间
-    if (cJSON_IsNumber(time_item)) {
-        s_utc_time = (uint32_t) time_item->valuedouble;
+    if (!cJSON_IsNumber(time_item) || time_item->valuedouble < UTC_MIN_VALID) {
+        ESP_LOGE(TAG, "no valid time in response");
+        cJSON_Delete(root);
+        return ESP_FAIL;
+    }
+
+    // SNTP 已给出毫秒级时间时不用秒级的 HTTP 结果覆盖
+    if (!s_valid || !s_base_sntp) {
+        int64_t utc_s = (int64_t)time_item->valuedouble;
+        struct timeval tv = { .tv_sec = utc_s, .tv_usec = 0 };
+        settimeofday(&tv, NULL);
+        clock_sample(utc_s * 1000000, mono_us, false);
     }
 
     // 时区
@@ -240,11 +433,17 @@ static void parse_time_json(const char *json_str)
             float fraction  = zone_float - hour_part;
             int quarter     = (int)(fraction*4.0f + (fraction>=0? 0.5f:-0.5f));
             int hour_base   = (int)(hour_part*10);
-            s_time_zone     = (int8_t)(hour_base + (quarter*3));
+            int8_t zone     = (int8_t)(hour_base + (quarter*3));
+            if (zone != s_time_zone) {
+                s_time_zone = zone;
+                cc_hal_kvs_set(TIME_ZONE_KVS_KEY, &s_time_zone, sizeof(s_time_zone));
+            }
+            s_zone_fetched = true;
         }
     }
 
     cJSON_Delete(root);
-    ESP_LOGI(TAG, "Updated time => utc=%u, timezone=%d",
-             (unsigned)s_utc_time, (int)s_time_zone);
+    ESP_LOGI(TAG, "HTTP time => utc=%u, timezone=%d",
+             (unsigned)get_time_get_utc(), (int)s_time_zone);
+    return ESP_OK;
 }
@@ -7,42 +7,62 @@
 #include <stdint.h>
 #include <stdbool.h>
 #include "esp_err.h"
+#include "cc_event.h"
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+/*
+ * 时间服务：SNTP 优先，SNTP 在限定时间内没有同步时用 HTTP 接口兜底（HTTP 同时提供时区），
+ * MQTT 已连接时同一接口经 MQTT RPC 调用，不另建连接。
+ * 同步成功后记下 UTC 与单调时钟（esp_timer）的对应关系，之后的读取都由单调时钟推算，
+ * 不访问网络；多次 SNTP 同步之间的偏差用于估计晶振漂移并在推算中补偿。
+ */
+
+CC_EVENT_DECLARE_BASE(GET_TIME_EVENT);
+
+typedef enum {
+    GET_TIME_EVENT_VALID = 0,   // 本次上电第一次拿到有效时间，之后的读取不再为 0
+    GET_TIME_EVENT_SYNC,        // 之后每次重新同步（SNTP 周期同步或 HTTP）
+} get_time_event_t;
+
 /**
  * @brief 初始化 get_time 模块（内部创建事件组、清空缓存等）
  */
 void get_time_init(void);
 
 /**
- * @brief 启动一次“获取时间”的流程（HTTP 请求 + 重试）
+ * @brief 启动一次“获取时间”的流程（SNTP，超时后 HTTP 兜底），立即返回
  *
- * 函数会快速返回。如果想知道最后结果，请调用 get_time_wait_done() 阻塞等待。
+ * 在后台任务中进行，结果通过 GET_TIME_EVENT 通知；已在进行中时直接返回 ESP_OK。
  *
- * @return ESP_OK 表示成功发起请求；如果多次重试都失败，将返回错误码。
+ * @return ESP_OK 表示成功发起
  */
 esp_err_t get_time_start_update(void);
 
 /**
- * @brief 阻塞等待“获取时间”完成(成功或超时)。
+ * @brief 阻塞等待时间有效（兼容旧调用，新代码请用 GET_TIME_EVENT_VALID 事件）
  *
  * @param timeout_ms 等待超时时间(ms)。超时后返回false。
- * @return true=本次更新成功(已获取到非零时间)，false=更新失败或超时。
+ * @return true=时间已有效，false=超时。
  */
 bool get_time_wait_done(uint32_t timeout_ms);
 
 /**
- * @brief 获取最近缓存的UTC秒数
- * @return UTC秒数；若尚未获取成功，可能为0
+ * @brief 时间是否已有效
+ */
+bool get_time_is_valid(void);
+
+/**
+ * @brief 获取当前UTC秒数，由单调时钟推算，不阻塞
+ * @return UTC秒数；若尚未获取成功，为0
  */
 uint32_t get_time_get_utc(void);
 
 /**
- * @brief 获取最近缓存的时区(单位0.1小时)
- * @return 时区值；若尚未获取成功，可能为0
+ * @brief 获取缓存的时区(单位0.1小时)
+ * @return 时区值；若尚未获取成功，为上次保存的值或0
  */
 int8_t get_time_get_timezone(void);
 
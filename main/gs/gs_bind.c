@@ -1,4 +1,5 @@
 //gs_bind.c
+#include "sdkconfig.h"
 #include "gs_bind.h"
 
 #include <string.h>
@@ -18,7 +19,11 @@
 
 #include "captive_portal.h"
 
-#include "cJSON.h"
+#if CONFIG_GS_BIND_QR
+#include "img_qr.h"
+#endif
+
+#include "json_scan.h"
 
 // 添加头文件
 #include "freertos/FreeRTOS.h"
@@ -43,16 +48,76 @@ static uint8_t g_curr_cfg_mode = GS_BIND_CFG_MODE_NULL;
 static uint8_t g_curr_bind_connect_mode = GS_BIND_CFG_MODE_NULL;
 static cc_timer_handle_t g_sta_connect_timer_handle = NULL;
 static cc_timer_handle_t g_bind_timeout_timer_handle = NULL;
+static cc_timer_handle_t g_scan_timer_handle = NULL;
+
+// 配网期间后台扫描的周期，凭据到达时目标 AP 的 BSSID/信道已在扫描结果里
+#define GS_BIND_SCAN_INTERVAL_MS    15000
 
 static uint32_t g_bind_status = 0;
 static uint32_t g_boot_auto_start_cfg = GS_BIND_CFG_MODE_NULL;
 
 static void __ap_bind_cfg_ap_server_start(void);
+static void __qr_stop(void);
 
 static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event, int32_t id, void* event_data);
+// 配网期间订阅的事件，处理函数只为这些事件被调用
+static const cc_event_sub_t g_cfg_event_subs[] = {
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_CONNECTED, __cfg_event_handler),
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_CONNECT_FAIL, __cfg_event_handler),
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_SCAN_DONE, __cfg_event_handler),
+    CC_EVENT_SUB(GS_MQTT_EVENT, GS_MQTT_EVENT_CONNECTED, __cfg_event_handler),
+};
+
+#if CONFIG_GS_BIND_BLE_MEM_RELEASE
+// 已绑定时 BLE 只在重新配网时才用，控制器内存归还给 TLS 和图像流水线
+static void __ble_mem_release(const char *when){
+    size_t free_before = 0, free_after = 0, largest = 0;
+
+    cc_hal_sys_heap_info(&free_before, NULL);
+    if(cc_hal_ble_mem_release() != CC_OK){
+        return;
+    }
+    cc_hal_sys_heap_info(&free_after, &largest);
+    CC_LOGI(TAG, "BLE memory released (%s): +%u bytes, internal free %u largest %u",
+            when, (unsigned)(free_after - free_before), (unsigned)free_after, (unsigned)largest);
+}
+#endif
 
 static void __ble_deinit(void *arg){
     cc_hal_ble_deinit();
+#if CONFIG_GS_BIND_BLE_MEM_RELEASE
+    if(g_bind_status){
+        __ble_mem_release("bound");
+    }
+#endif
+}
+
+static void __timer_cb_for_scan(void *arg){
+    // 凭据在校验中时不扫描，避免打断连接
+    if(g_curr_bind_connect_mode == GS_BIND_CFG_MODE_NULL){
+        gs_wifi_scan_start();
+    }
+}
+
+static void __scan_start(void){
+    if(g_scan_timer_handle == NULL){
+        cc_timer_config_t timer_config = {
+            .arg = NULL,
+            .callback = __timer_cb_for_scan,
+            .type = CC_TIMER_TYPE_SW
+        };
+
+        g_scan_timer_handle = cc_timer_create(&timer_config);
+    }
+    if(g_scan_timer_handle){
+        cc_timer_start_periodic(g_scan_timer_handle, CC_TIMMER_MS(GS_BIND_SCAN_INTERVAL_MS));
+    }
+}
+
+static void __scan_stop(void){
+    if(g_scan_timer_handle){
+        cc_timer_delete(&g_scan_timer_handle);
+    }
 }
 
 static void __timer_cb_for_wifi_start_connect(void *arg){
@@ -62,15 +127,42 @@ static void __timer_cb_for_wifi_start_connect(void *arg){
 
     captive_portal_stop();
 
-    gs_wifi_sta_start_connect();
+    gs_wifi_sta_start_validate();
+}
+
+// 凭据连不上：告诉手机，清掉本次凭据，AP/BLE 继续等待重新下发
+static void __bind_connect_fail(gs_bind_err_t err){
+    CC_LOGW(TAG, "bind connect fail: %d", err);
+
+    if(g_curr_bind_connect_mode & GS_BIND_CFG_MODE_BLE){
+        char msg[128] = "";
+        char sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+        char hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+        char seq[GS_MQTT_SEQ_LEN];
+        gs_device_get_version(sw_version, hw_version);
+        snprintf(msg, sizeof(msg), "{\"ver\":\"%s\",\"act\":\"0001\",\"sta\":\"%02d\",\"seq_no\":\"%s\"}",
+                 sw_version, (err == GS_BIND_ERR_WIFI_PASSWORD) ? 1 : 2, gs_mqtt_generate_seq(seq));
+        cc_hal_ble_send((uint8_t *)msg, strlen(msg));
+    }
+    g_curr_bind_connect_mode = GS_BIND_CFG_MODE_NULL;
+
+    cc_event_post(GS_BIND_EVENT, GS_BIND_EVENT_CONNECT_FAIL, &err, sizeof(err));
+
+    if(g_curr_cfg_mode & GS_BIND_CFG_MODE_AP){
+        xEventGroupSetBits(bind_event_group, START_AP_BIT);
+    }
+    __scan_start();
 }
 
 static void __timer_cb_for_bind_timeout(void *arg){
+    __qr_stop();
     g_curr_cfg_mode = GS_BIND_CFG_MODE_NULL;
     g_curr_bind_connect_mode = GS_BIND_CFG_MODE_NULL;
 
     CC_LOGI(TAG, "bind timeout");
 
+    __scan_stop();
+
     if(g_tcp_server.port != 0){
         gs_wifi_ap_stap();
         captive_portal_stop();
@@ -80,8 +172,7 @@ static void __timer_cb_for_bind_timeout(void *arg){
     gs_bind_err_t err = GS_BIND_ERR_TIMEOUT;
     cc_event_post(GS_BIND_EVENT, GS_BIND_EVENT_FAIL, &err, sizeof(err));
 
-    cc_event_unregister_handler(GS_WIFI_EVENT, __cfg_event_handler);
-    cc_event_unregister_handler(GS_MQTT_EVENT, __cfg_event_handler);
+    cc_event_unregister_table(g_cfg_event_subs, CC_EVENT_SUB_NUM(g_cfg_event_subs));
 }
 
 static void __save_bind_status(void){
@@ -92,45 +183,52 @@ static void __save_bind_status(void){
     } 
 }
 
-//{ssid:xxxxxx,password:xxxxxxxx,token:xxxxxxxx}
-static cc_err_t __parse_ble_bind_info(char *data, char len){
-    cJSON *root_obj = NULL, *ssid_obj = NULL, *password_obj = NULL, *token_obj = NULL;
-
-    if(NULL == data || len == 0){
-        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
-        return CC_ERR_INVALID_ARG;
-    }
-
-    CC_LOGD(TAG, "__parse_ble_bind_info: %.*s", len, data);
+// 配网信息的字段表，值直接解码到这里，不经堆内存
+typedef struct{
+    char ssid[GS_WIFI_SSID_BUF_MAX_LEN];
+    char password[GS_WIFI_PASSWORD_BUF_MAX_LEN];
+    char token[GS_TOKEN_BUF_MAX_LEN];
+    char region[3];                 // 可选，国家/地区码，如 "CN"
+    char cmd_type[4];               // 仅 AP 配网
+}_bind_info_t;
+
+enum{
+    __BIND_FIELD_SSID = 0,
+    __BIND_FIELD_PASSWORD,
+    __BIND_FIELD_TOKEN,
+    __BIND_FIELD_REGION,
+    __BIND_FIELD_CMD_TYPE,
+    __BIND_FIELD_NUM,
+};
+
+#define __BIND_FIELDS_CRED      ((1 << __BIND_FIELD_SSID) | (1 << __BIND_FIELD_PASSWORD) | (1 << __BIND_FIELD_TOKEN))
+
+static int __bind_info_scan(const char *data, uint16_t len, _bind_info_t *info, uint32_t *found){
+    const json_scan_field_t fields[__BIND_FIELD_NUM] = {
+        [__BIND_FIELD_SSID] = { "ssid", info->ssid, sizeof(info->ssid), 0 },
+        [__BIND_FIELD_PASSWORD] = { "password", info->password, sizeof(info->password), 0 },
+        [__BIND_FIELD_TOKEN] = { "token", info->token, sizeof(info->token), 0 },
+        [__BIND_FIELD_REGION] = { "region", info->region, sizeof(info->region), 0 },
+        [__BIND_FIELD_CMD_TYPE] = { "cmd_type", info->cmd_type, sizeof(info->cmd_type), 0 },
+    };
+    return json_scan_fields(data, len, fields, __BIND_FIELD_NUM, found);
+}
 
-    root_obj = cJSON_Parse((const char *)data);
-    if(NULL == root_obj){
-        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
-        return CC_ERR_INVALID_ARG;
-    }
+// 保存凭据并稍后发起连接
+static void __bind_info_apply(_bind_info_t *info, uint32_t found){
+    CC_LOGD(TAG, "bind info ssid: %s password: %s token: %s region: %s", info->ssid, info->password, info->token, info->region);
 
-    ssid_obj = cJSON_GetObjectItem(root_obj, "ssid");
-    password_obj = cJSON_GetObjectItem(root_obj, "password");
-    token_obj = cJSON_GetObjectItem(root_obj, "token");
+    gs_device_save_token(info->token);
 
-    if(NULL == ssid_obj || NULL == password_obj || NULL == token_obj
-        || ssid_obj->type != cJSON_String || password_obj->type != cJSON_String || token_obj->type != cJSON_String){
-        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
-        cJSON_Delete(root_obj);
-        return CC_ERR_INVALID_ARG;
+    if(found & (1 << __BIND_FIELD_REGION)){
+        cc_hal_wifi_set_country(info->region);
     }
-    
-    CC_LOGD(TAG, "__parse_ble_bind_info ssid: %s password: %s token: %s", ssid_obj->valuestring, password_obj->valuestring, token_obj->valuestring);
-    
-    g_curr_bind_connect_mode = GS_BIND_CFG_MODE_BLE;
-
-    gs_device_save_token(token_obj->valuestring);
 
     gs_wifi_config_t wifi_config = {0};
-    strcpy((char *)wifi_config.ssid, ssid_obj->valuestring);
-    wifi_config.ssid_len = strlen(ssid_obj->valuestring);
-    strcpy((char *)wifi_config.password, password_obj->valuestring);
-    wifi_config.password_len = strlen(password_obj->valuestring);
+    wifi_config.ssid_len = strlen(info->ssid);
+    memcpy(wifi_config.ssid, info->ssid, wifi_config.ssid_len + 1);
+    wifi_config.password_len = strlen(info->password);
+    memcpy(wifi_config.password, info->password, wifi_config.password_len + 1);
     gs_wifi_sta_save_config(&wifi_config);
 
     if(g_sta_connect_timer_handle == NULL){
@@ -144,15 +242,59 @@ static cc_err_t __parse_ble_bind_info(char *data, char len){
     }
     if(g_sta_connect_timer_handle){
         cc_timer_start_once(g_sta_connect_timer_handle, CC_TIMMER_MS(500));
-    } 
+    }
+}
+
+//{ssid:xxxxxx,password:xxxxxxxx,token:xxxxxxxx[,region:xx]}，BLE 与扫码下发的格式相同，mode 为凭据来源
+static cc_err_t __parse_json_bind_info(char *data, uint16_t len, uint8_t mode){
+    _bind_info_t info;
+    uint32_t found = 0;
+
+    if(NULL == data || len == 0){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+        return CC_ERR_INVALID_ARG;
+    }
+
+    CC_LOGD(TAG, "__parse_json_bind_info(%d): %.*s", mode, len, data);
+
+    // MTU 放大后单包写入也可能超过 20 字节且不以 '\0' 结尾，按长度解析
+    int ret = __bind_info_scan(data, len, &info, &found);
+    if(ret != JSON_SCAN_OK || (found & __BIND_FIELDS_CRED) != __BIND_FIELDS_CRED){
+        CC_LOGE(TAG, "bad bind info: %d", ret);
+        return CC_ERR_INVALID_ARG;
+    }
 
-    cJSON_Delete(root_obj);
+    g_curr_bind_connect_mode = mode;
+    __bind_info_apply(&info, found);
 
     return CC_OK;
 }
 
+static cc_err_t __parse_ble_bind_info(char *data, uint16_t len){
+    return __parse_json_bind_info(data, len, GS_BIND_CFG_MODE_BLE);
+}
+
+#if CONFIG_GS_BIND_QR
+// 扫码任务中调用；凭据正在校验时不接受新的二维码
+static void __qr_recv_cb(const char *data, size_t len){
+    if(g_curr_bind_connect_mode != GS_BIND_CFG_MODE_NULL || len > UINT16_MAX){
+        return;
+    }
+    __parse_json_bind_info((char *)data, (uint16_t)len, GS_BIND_CFG_MODE_QR);
+}
+#endif
+
+static void __qr_stop(void){
+#if CONFIG_GS_BIND_QR
+    if(g_curr_cfg_mode & GS_BIND_CFG_MODE_QR){
+        img_qr_stop();
+    }
+#endif
+}
+
 static cc_err_t __parse_ap_bind_info(char *data, uint16_t len, char *ret_data, uint16_t ret_data_len, uint16_t *ret_len){
-    cJSON *root_obj = NULL, *cmd_obj = NULL, *ssid_obj = NULL, *password_obj = NULL, *token_obj = NULL;
+    _bind_info_t info;
+    uint32_t found = 0;
     uint8_t status = 1;
 
     *ret_len = 0;
@@ -164,53 +306,21 @@ static cc_err_t __parse_ap_bind_info(char *data, uint16_t len, char *ret_data, u
 
     CC_LOGD(TAG, "__parse_ap_bind_info: %.*s", len, data);
 
-    root_obj = cJSON_Parse((const char *)data);
-    if(NULL == root_obj){
-        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+    // 字段缺失或类型不对按各命令回复失败，只有语法错误或没有 cmd_type 时不回复
+    int ret = __bind_info_scan(data, len, &info, &found);
+    if((ret != JSON_SCAN_OK && ret != JSON_SCAN_ERR_TYPE && ret != JSON_SCAN_ERR_LEN)
+            || !(found & (1 << __BIND_FIELD_CMD_TYPE))){
+        CC_LOGE(TAG, "bad ap bind info: %d", ret);
         return CC_ERR_INVALID_ARG;
     }
 
-    cmd_obj = cJSON_GetObjectItem(root_obj, "cmd_type");
-    if(NULL == cmd_obj || cmd_obj->type != cJSON_String){
-        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
-        cJSON_Delete(root_obj);
-        return CC_ERR_INVALID_ARG;
-    }
-
-    if(strcmp(cmd_obj->valuestring, "1") == 0){
-        ssid_obj = cJSON_GetObjectItem(root_obj, "ssid");
-        password_obj = cJSON_GetObjectItem(root_obj, "password");
-        token_obj = cJSON_GetObjectItem(root_obj, "token");
-        if(NULL == ssid_obj || NULL == password_obj || NULL == token_obj
-                || ssid_obj->type != cJSON_String || password_obj->type != cJSON_String || token_obj->type != cJSON_String){
+    if(strcmp(info.cmd_type, "1") == 0){
+        if(ret != JSON_SCAN_OK || (found & __BIND_FIELDS_CRED) != __BIND_FIELDS_CRED){
             CC_LOGE(TAG, "not found");
             status = 1;
         }else{
-            CC_LOGD(TAG, "__parse_ap_bind_info ssid: %s password: %s token: %s", ssid_obj->valuestring, password_obj->valuestring, token_obj->valuestring);
-
             status = 0;
-
-            gs_device_save_token(token_obj->valuestring);
-
-            gs_wifi_config_t wifi_config = {0};
-            strcpy((char *)wifi_config.ssid, ssid_obj->valuestring);
-            wifi_config.ssid_len = strlen(ssid_obj->valuestring);
-            strcpy((char *)wifi_config.password, password_obj->valuestring);
-            wifi_config.password_len = strlen(password_obj->valuestring);
-            gs_wifi_sta_save_config(&wifi_config);
-
-            if(g_sta_connect_timer_handle == NULL){
-                cc_timer_config_t timer_config = {
-                    .arg = NULL,
-                    .callback = __timer_cb_for_wifi_start_connect,
-                    .type = CC_TIMER_TYPE_SW
-                };
-
-                g_sta_connect_timer_handle = cc_timer_create(&timer_config);
-            }
-            if(g_sta_connect_timer_handle){
-                cc_timer_start_once(g_sta_connect_timer_handle, CC_TIMMER_MS(500));
-            } 
+            __bind_info_apply(&info, found);
         }
 
         g_curr_bind_connect_mode = GS_BIND_CFG_MODE_AP;
@@ -224,9 +334,8 @@ static cc_err_t __parse_ap_bind_info(char *data, uint16_t len, char *ret_data, u
         gs_device_get_version(sw_version, hw_version);
         snprintf(ret_data, ret_data_len, "{\"cmd_type\":2,\"product_key\":\"%s\",\"device_name\":\"%s\",\"status\":\"%d\", \"ver\":\"%s\"}", product_key, device_name, (status == CC_OK)?0:1, sw_version);
         *ret_len = strlen(ret_data);
-    }else if(strcmp(cmd_obj->valuestring, "3") == 0){
-        token_obj = cJSON_GetObjectItem(root_obj, "token");
-        if(NULL == token_obj || token_obj->type != cJSON_String){
+    }else if(strcmp(info.cmd_type, "3") == 0){
+        if(!(found & (1 << __BIND_FIELD_TOKEN))){
             CC_LOGE(TAG, "not found");
             status = 1;
         }else{
@@ -241,7 +350,7 @@ static cc_err_t __parse_ap_bind_info(char *data, uint16_t len, char *ret_data, u
                 if(ap_num > 12){
                     ap_num = 12;
                 }
-                gs_wifi_ap_info_t *ap_list = cc_hal_sys_malloc(sizeof(gs_wifi_ap_info_t) * ap_num);
+                gs_wifi_ap_info_t *ap_list = cc_hal_sys_malloc_caps(sizeof(gs_wifi_ap_info_t) * ap_num, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_APP);
                 if (ap_num > 0 && ap_list == NULL){
                     CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
                     status = 1;
@@ -271,8 +380,6 @@ static cc_err_t __parse_ap_bind_info(char *data, uint16_t len, char *ret_data, u
         *ret_len = strlen(ret_data);
     }
 
-    cJSON_Delete(root_obj);
-
     return CC_OK;
 }
 
@@ -288,8 +395,15 @@ static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event,
             break;
         case GS_WIFI_EVENT_STA_GOT_IP:
             break;
+        case GS_WIFI_EVENT_STA_CONNECT_FAIL:
+            if(g_curr_bind_connect_mode != GS_BIND_CFG_MODE_NULL && event_data
+                && *(cc_hal_wifi_connect_err_t *)event_data == CC_HAL_WIFI_CONNECT_ERR_AUTH_FAIL){
+                __bind_connect_fail(GS_BIND_ERR_WIFI_PASSWORD);
+            }
+            break;
         case GS_WIFI_EVENT_SCAN_DONE:
-            if(g_bind_timeout_timer_handle != NULL){
+            // 只有第一次扫描完成时启动 AP，后台扫描不再重复启动
+            if(g_bind_timeout_timer_handle != NULL && (g_curr_cfg_mode & GS_BIND_CFG_MODE_AP) && g_tcp_server.port == 0){
                 // 设置事件标志位，通知绑定任务处理
                 xEventGroupSetBits(bind_event_group, START_AP_BIT);
             }
@@ -308,6 +422,7 @@ static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event,
                 char token[GS_TOKEN_BUF_MAX_LEN] = "";
                 char sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
                 char hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+                char seq[GS_MQTT_SEQ_LEN];
 
                 gs_device_get_version(sw_version, hw_version);
 
@@ -316,7 +431,7 @@ static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event,
                 if(g_curr_bind_connect_mode & GS_BIND_CFG_MODE_BLE){
                     g_curr_bind_connect_mode -= GS_BIND_CFG_MODE_BLE;
 
-                    sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0001\",\"sta\":\"00\",\"token\":\"%s\",\"seq_no\":\"%s\"}", sw_version, token, gs_mqtt_generate_seq());
+                    sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0001\",\"sta\":\"00\",\"token\":\"%s\",\"seq_no\":\"%s\"}", sw_version, token, gs_mqtt_generate_seq(seq));
                     CC_LOGD(TAG, "success_info: %s", msg);
                     cc_hal_ble_send((uint8_t *)msg, strlen(msg));
                     
@@ -324,17 +439,21 @@ static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event,
                 if(g_curr_bind_connect_mode & GS_BIND_CFG_MODE_AP){
                     g_curr_bind_connect_mode -= GS_BIND_CFG_MODE_AP;
                 }
+                if(g_curr_bind_connect_mode & GS_BIND_CFG_MODE_QR){
+                    g_curr_bind_connect_mode -= GS_BIND_CFG_MODE_QR;
+                }
+                __qr_stop();
 
-                sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0001\",\"sta\":\"00\",\"token\":\"%s\",\"seq_no\":\"%s\"}", sw_version, token, gs_mqtt_generate_seq());
+                sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0001\",\"sta\":\"00\",\"token\":\"%s\",\"seq_no\":\"%s\"}", sw_version, token, gs_mqtt_generate_seq(seq));
                 gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), 0, 0);
 
-                sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0003\",\"type\":\"03\",\"data\":\"%s\",\"seq_no\":\"%s\"}", sw_version, sw_version, gs_mqtt_generate_seq());
+                sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0003\",\"type\":\"03\",\"data\":\"%s\",\"seq_no\":\"%s\"}", sw_version, sw_version, gs_mqtt_generate_seq(seq));
                 gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), GS_MQTT_QOS0, 0);
                 
-                // sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0002\",\"seq_no\":\"%s\"}", sw_version, gs_mqtt_generate_seq());
+                // sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0002\",\"seq_no\":\"%s\"}", sw_version, gs_mqtt_generate_seq(seq));
                 // gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), GS_MQTT_QOS0, 0);
 
-                // sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0003\",\"type\":\"02\",\"data\":\"%d\",\"seq_no\":\"%s\"}", sw_version, cc_hal_wifi_get_connect_rssi(), gs_mqtt_generate_seq());
+                // sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0003\",\"type\":\"02\",\"data\":\"%d\",\"seq_no\":\"%s\"}", sw_version, cc_hal_wifi_get_connect_rssi(), gs_mqtt_generate_seq(seq));
                 // gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), GS_MQTT_QOS0, 0);
 
                 g_curr_cfg_mode = GS_BIND_CFG_MODE_NULL;
@@ -343,14 +462,14 @@ static void __cfg_event_handler(void* handler_args, cc_event_base_t base_event,
                 if(g_bind_timeout_timer_handle){
                     cc_timer_delete(&g_bind_timeout_timer_handle);
                 }
+                __scan_stop();
 
                 g_bind_status = 1;
                 __save_bind_status();
 
                 cc_event_post(GS_BIND_EVENT, GS_BIND_EVENT_SUCCESS, NULL, 0);
 
-                cc_event_unregister_handler(GS_WIFI_EVENT, __cfg_event_handler);
-                cc_event_unregister_handler(GS_MQTT_EVENT, __cfg_event_handler);
+                cc_event_unregister_table(g_cfg_event_subs, CC_EVENT_SUB_NUM(g_cfg_event_subs));
 
                 cc_timer_simple_one(CC_TIMER_TYPE_SW, __ble_deinit, CC_TIMMER_MS(3000), NULL);
             }
@@ -380,10 +499,15 @@ static void gs_bind_task(void *arg){
 
 
 void __ble_recv_cb(uint8_t *data, uint16_t len){
-    static uint8_t recv_len = 0;
+    static uint16_t recv_len = 0;
     static char recv_buf[256] = "";
 
     CC_LOGD(TAG, "ble recv data: %.*s", len, data);
+    if(recv_len + len >= sizeof(recv_buf)){
+        CC_LOGE(TAG, "ble bind info too long => drop");
+        recv_len = 0;
+        return;
+    }
     if(len > 20){
         __parse_ble_bind_info((char *)data, len);
         recv_len = 0;
@@ -403,10 +527,17 @@ void __ble_recv_cb(uint8_t *data, uint16_t len){
     }
 }
 
+// 分帧上传的整条配网信息，已由 cc_hal_ble 重组并以 '\0' 结尾
+static void __ble_msg_cb(uint8_t *data, uint16_t len){
+    CC_LOGD(TAG, "ble recv msg: %u bytes", len);
+    __parse_ble_bind_info((char *)data, len);
+}
+
 static void __ble_bind_cfg_start(void){
     uint8_t adv_data[] = {0x02, 0x01, 0x06, 0x16, 0x09, 0x42, 0x4c, 0x45, 0x2d, 0x63, 0x6c, 0x6f, 0x75, 0x64, 0x68, 0x6f, 0x6d, 0x65, 0x2d, 0x67, 0x73, 0x2d, 0x01, 0x02, 0x03, 0x04};
 
     cc_hal_ble_init(__ble_recv_cb);
+    cc_hal_ble_set_msg_cb(__ble_msg_cb);
     
     uint8_t mac[GS_BLE_MAC_MAX_LEN] = {0};
     gs_device_get_ble_mac(mac);
@@ -443,10 +574,21 @@ static cc_err_t __tcps_recv_cb(void *arg, uint8_t client_id, uint8_t *buf, uint1
     return CC_OK;
 }
 
+// 配网页面 POST /api 的请求体与 8266 端口的 JSON 相同
+static int __portal_api_cb(char *req, uint16_t req_len, char *resp, uint16_t resp_size){
+    uint16_t ret_len = 0;
+
+    if(__parse_ap_bind_info(req, req_len, resp, resp_size, &ret_len) != CC_OK || ret_len == 0){
+        return -1;
+    }
+    return ret_len;
+}
+
 static void __ap_bind_cfg_ap_server_start(void){
 
     gs_wifi_ap_start_setup();
 
+    captive_portal_set_api_cb(__portal_api_cb);
     captive_portal_start();
 
     if(g_tcp_server.port == 0){
@@ -492,10 +634,12 @@ cc_err_t gs_bind_stop_cfg_mode(void){
 
         cc_timer_delete(&g_bind_timeout_timer_handle);
     }
+    __scan_stop();
 
     if(g_curr_cfg_mode & GS_BIND_CFG_MODE_BLE){
         cc_timer_simple_one(CC_TIMER_TYPE_SW, __ble_deinit, CC_TIMMER_MS(200), NULL);
     }
+    __qr_stop();
 
     g_curr_cfg_mode = GS_BIND_CFG_MODE_NULL;
     g_curr_bind_connect_mode = GS_BIND_CFG_MODE_NULL;
@@ -509,15 +653,43 @@ cc_err_t gs_bind_stop_cfg_mode(void){
 cc_err_t gs_bind_start_cfg_mode(uint8_t mode){
     CC_LOGD(TAG, "gs_bind_start_cfg_mode: %d", mode);
 
+    if((mode & GS_BIND_CFG_MODE_BLE) && !cc_hal_ble_is_available()){
+        // BLE 内存已释放，本次上电无法再初始化：记下配网模式，重启后由 product_init 进入
+        CC_LOGI(TAG, "BLE memory released => reboot into cfg mode %d", mode);
+        if(gs_bind_set_boot_auto_start_cfg_mode(mode) == CC_OK){
+            cc_hal_sys_reboot();
+        }
+        mode &= ~GS_BIND_CFG_MODE_BLE;
+        if(mode == GS_BIND_CFG_MODE_NULL){
+            return CC_ERR_NOT_SUPPORTED;
+        }
+    }
+
+    if(mode & GS_BIND_CFG_MODE_QR){
+#if CONFIG_GS_BIND_QR
+        if(!(g_curr_cfg_mode & GS_BIND_CFG_MODE_QR) && img_qr_start(__qr_recv_cb) != ESP_OK){
+            mode &= ~GS_BIND_CFG_MODE_QR;
+        }
+#else
+        mode &= ~GS_BIND_CFG_MODE_QR;
+#endif
+        if(mode == GS_BIND_CFG_MODE_NULL){
+            return CC_ERR_NOT_SUPPORTED;
+        }
+    }
+
     if(mode & GS_BIND_CFG_MODE_BLE){
         __ble_bind_cfg_start();
     }
 
+    g_curr_cfg_mode = mode;
+
     if(mode & GS_BIND_CFG_MODE_AP){
         __ap_bind_cfg_start();
+    }else{
+        gs_wifi_scan_start();
     }
-
-    g_curr_cfg_mode = mode;
+    __scan_start();
 
     cc_event_post(GS_BIND_EVENT, GS_BIND_EVENT_START, &mode, sizeof(mode));
 
@@ -534,8 +706,7 @@ cc_err_t gs_bind_start_cfg_mode(uint8_t mode){
         cc_timer_start_once(g_bind_timeout_timer_handle, CC_TIMMER_MS(2*60000));
     }
 
-    cc_event_register_handler(GS_WIFI_EVENT, __cfg_event_handler);
-    cc_event_register_handler(GS_MQTT_EVENT, __cfg_event_handler);
+    cc_event_register_table(g_cfg_event_subs, CC_EVENT_SUB_NUM(g_cfg_event_subs));
 
     return CC_OK;
 }
@@ -588,6 +759,13 @@ void gs_bind_init(void){
     len = sizeof(g_boot_auto_start_cfg);
     cc_hal_kvs_get(GS_BIND_BOOT_CGF_KVS_KEY, &g_boot_auto_start_cfg, &len);
 
+#if CONFIG_GS_BIND_BLE_MEM_RELEASE
+    // 已绑定且本次不是重启进配网：BLE 从未初始化，直接释放
+    if(g_bind_status && !(g_boot_auto_start_cfg & GS_BIND_CFG_MODE_BLE)){
+        __ble_mem_release("boot");
+    }
+#endif
+
     // 创建事件组
     bind_event_group = xEventGroupCreate();
 
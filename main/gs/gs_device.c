@@ -2,6 +2,8 @@
 #include "gs_device.h"
 
 #include <string.h>
+#include <strings.h>
+#include <stdio.h>
 
 #include "cc_hal_sys.h"
 #include "cc_hal_kvs.h"
@@ -13,7 +15,14 @@
 
 #include "cJSON.h"
 
+#include "get_time.h"
+#include "gs_mqtt.h"
+
 #define DEV_KVS_KEY    "gs_dev"
+#define LICENSE_KVS_KEY         "gs_license"
+#define LICENSE_SIGN_LEN        40
+#define LICENSE_RETRY_MIN_MS    (60 * 1000)
+#define LICENSE_RETRY_MAX_MS    (6 * 60 * 60 * 1000)
 
 static char *TAG = "gs_device";
 
@@ -28,12 +37,77 @@ typedef struct
 
 _dev_triple_t g_dev_triple = {.product_key = "", .device_name = "", .device_secret = ""};
 
+/*
+ * license 缓存：云端返回 "expire"（UTC 秒）和 "sign" 时，三元组连同有效期存入 KVS。
+ * sign = HMAC-SHA1(UKEY, "product_key&device_name&device_secret&expire") 的十六进制，启动时本地校验，
+ * 校验通过即直接使用，不等云端；时间有效后检查有效期，临近或已过期时后台刷新，失败按退避重试，
+ * 刷新期间继续使用旧的三元组。不带有效期的旧 license（单独的三个 KVS 键）视为长期有效。
+ */
+typedef struct{
+    _dev_triple_t triple;
+    uint32_t expire;
+    char sign[LICENSE_SIGN_LEN + 1];
+}_license_cache_t;
+
+static uint32_t g_license_expire = 0;       // 0 表示没有有效期
+static uint32_t g_license_retry_ms = LICENSE_RETRY_MIN_MS;
+static uint8_t g_license_refreshing = 0;
+
 static char g_token[GS_TOKEN_BUF_MAX_LEN] = "";
 
 static char g_sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
 static char g_hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
 
-static void __get_time_task(uint32_t interval, void *arg);
+static cc_err_t __license_sign(const _dev_triple_t *triple, uint32_t expire, char *sign){
+    char data[GS_PRODUCT_KEY_BUF_MAX_LEN + GS_DEVICE_NAME_BUF_MAX_LEN + GS_DEVICE_SECRET_BUF_MAX_LEN + 16] = "";
+    uint8_t hash[20] = "";
+    char *key = CONFIG_GAOSI_LICENSE_UKEY;
+
+    snprintf(data, sizeof(data), "%s&%s&%s&%lu", triple->product_key, triple->device_name, triple->device_secret, expire);
+    cc_err_t err = cc_hal_sys_hmac("SHA1", (uint8_t *)data, strlen(data), (uint8_t *)key, strlen(key), hash);
+    if(err != CC_OK){
+        return err;
+    }
+    for (int i = 0; i < 20; i++) {
+        sprintf(sign + 2 * i, "%02x", hash[i]);
+    }
+    sign[LICENSE_SIGN_LEN] = '\0';
+    return CC_OK;
+}
+
+static bool __license_cache_load(void){
+    _license_cache_t cache;
+    char sign[LICENSE_SIGN_LEN + 1] = "";
+    size_t len = sizeof(cache);
+
+    if(cc_hal_kvs_get(LICENSE_KVS_KEY, &cache, &len) != CC_OK || len != sizeof(cache)){
+        return false;
+    }
+    cache.sign[LICENSE_SIGN_LEN] = '\0';
+    cache.triple.product_key[GS_PRODUCT_KEY_BUF_MAX_LEN - 1] = '\0';
+    cache.triple.device_name[GS_DEVICE_NAME_BUF_MAX_LEN - 1] = '\0';
+    cache.triple.device_secret[GS_DEVICE_SECRET_BUF_MAX_LEN - 1] = '\0';
+    if(__license_sign(&cache.triple, cache.expire, sign) != CC_OK || strcmp(sign, cache.sign) != 0){
+        CC_LOGE(TAG, "license cache sign mismatch");
+        return false;
+    }
+    memcpy(&g_dev_triple, &cache.triple, sizeof(_dev_triple_t));
+    g_license_expire = cache.expire;
+    CC_LOGI(TAG, "license cache ok, expire %lu", g_license_expire);
+    return true;
+}
+
+static void __license_cache_save(uint32_t expire, const char *sign){
+    _license_cache_t cache;
+
+    memset(&cache, 0, sizeof(cache));
+    memcpy(&cache.triple, &g_dev_triple, sizeof(_dev_triple_t));
+    cache.expire = expire;
+    strncpy(cache.sign, sign, LICENSE_SIGN_LEN);
+    cc_hal_kvs_set(LICENSE_KVS_KEY, &cache, sizeof(cache));
+}
+
+static void __license_refresh_later(void);
 
 static void __get_license_http_cb(void *arg, int resp_code, uint8_t *buf, uint16_t len){
     CC_LOGD(TAG, "__get_license_http_cb: %s", buf);
@@ -83,13 +157,47 @@ static void __get_license_http_cb(void *arg, int resp_code, uint8_t *buf, uint16
         goto fail;
     }
 
-    CC_LOGI(TAG, "product_key: %s", product_key_obj->valuestring);
-    CC_LOGI(TAG, "device_name: %s", device_name_obj->valuestring);
-    CC_LOGI(TAG, "device_secret: %s", device_secret_obj->valuestring);
+    if(strlen(product_key_obj->valuestring) >= GS_PRODUCT_KEY_BUF_MAX_LEN ||
+            strlen(device_name_obj->valuestring) >= GS_DEVICE_NAME_BUF_MAX_LEN ||
+            strlen(device_secret_obj->valuestring) >= GS_DEVICE_SECRET_BUF_MAX_LEN){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_SIZE);
+        goto fail;
+    }
+
+    _dev_triple_t triple;
+    memset(&triple, 0, sizeof(triple));
+    strcpy(triple.product_key, product_key_obj->valuestring);
+    strcpy(triple.device_name, device_name_obj->valuestring);
+    strcpy(triple.device_secret, device_secret_obj->valuestring);
+
+    // 带有效期的 license 先验签，签名不对的结果不采用
+    cJSON *expire_obj = cJSON_GetObjectItem(data_obj, "expire");
+    cJSON *sign_obj = cJSON_GetObjectItem(data_obj, "sign");
+    uint32_t expire = 0;
+    char sign[LICENSE_SIGN_LEN + 1] = "";
+    if(expire_obj && expire_obj->type == cJSON_Number && sign_obj && sign_obj->type == cJSON_String){
+        expire = (uint32_t)expire_obj->valuedouble;
+        if(__license_sign(&triple, expire, sign) != CC_OK || strcasecmp(sign, sign_obj->valuestring) != 0){
+            CC_LOGE(TAG, "license sign mismatch");
+            goto fail;
+        }
+    }
 
-    strcpy(g_dev_triple.product_key, product_key_obj->valuestring);
-    strcpy(g_dev_triple.device_name, device_name_obj->valuestring);
-    strcpy(g_dev_triple.device_secret, device_secret_obj->valuestring);
+    CC_LOGI(TAG, "product_key: %s", triple.product_key);
+    CC_LOGI(TAG, "device_name: %s", triple.device_name);
+    CC_LOGI(TAG, "device_secret: %s", triple.device_secret);
+
+    // 后台刷新拿到的三元组没变时只更新有效期，不通知 MQTT 重连
+    bool changed = memcmp(&g_dev_triple, &triple, sizeof(_dev_triple_t)) != 0;
+    bool refreshing = g_license_refreshing;
+    memcpy(&g_dev_triple, &triple, sizeof(_dev_triple_t));
+    g_license_expire = expire;
+    g_license_refreshing = 0;
+    g_license_retry_ms = LICENSE_RETRY_MIN_MS;
+    if(expire){
+        CC_LOGI(TAG, "license expire %lu", expire);
+        __license_cache_save(expire, sign);
+    }
     len = GS_PRODUCT_KEY_BUF_MAX_LEN;
     cc_hal_kvs_set("gs_product_key", g_dev_triple.product_key, len);
     len = GS_DEVICE_NAME_BUF_MAX_LEN;
@@ -97,12 +205,23 @@ static void __get_license_http_cb(void *arg, int resp_code, uint8_t *buf, uint16
     len = GS_DEVICE_SECRET_BUF_MAX_LEN;
     cc_hal_kvs_set("gs_device_secret", g_dev_triple.device_secret, len);
 
-    cc_event_post(GS_DEVICE_EVENT, GS_DEVICE_EVENT_GET_LICENSE_SUCCESS, NULL, 0);
+    if(!refreshing || changed){
+        cc_event_post(GS_DEVICE_EVENT, GS_DEVICE_EVENT_GET_LICENSE_SUCCESS, NULL, 0);
+    }
     
     cJSON_Delete(root_obj);
     return;
 
 fail:
+    if(g_license_refreshing){
+        // 后台刷新失败：旧 license 继续可用，退避后再试，不通知失败
+        g_license_refreshing = 0;
+        __license_refresh_later();
+        if(root_obj){
+            cJSON_Delete(root_obj);
+        }
+        return;
+    }
     cc_event_post(GS_DEVICE_EVENT, GS_DEVICE_EVENT_GET_LICENSE_FAIL, NULL, 0);
 
     if(root_obj){
@@ -116,10 +235,11 @@ static void __get_license_task(uint32_t interval, void *arg){
     char data[32] = "";
     uint8_t hash[20] = "";
     char sign[41] = "";
+    char params[128] = "";
     char *uname = CONFIG_GAOSI_LICENSE_UNAME;
     char *key = CONFIG_GAOSI_LICENSE_UKEY;
 
-    uint32_t timestamp = cc_hal_sys_get_time();
+    uint32_t timestamp = get_time_get_utc();
 
     sprintf(data, "time=%ld&uname=%s", timestamp, uname);
     cc_err_t err =  cc_hal_sys_hmac("SHA1", (uint8_t *)data, strlen(data), (uint8_t *)key, strlen(key), hash);
@@ -132,62 +252,70 @@ static void __get_license_task(uint32_t interval, void *arg){
         sprintf(url_buf, "http://xxx.xxx.xx/app/api/?c=license&a=getLicenseInfo&uname=%s&time=%ld&sign=%s", uname, timestamp, sign);
         // sprintf(url_buf, "http://192.168.x.xxx:8080/app/api/?c=license&a=getLicenseInfo&uname=%s&time=%d&sign=%s", uname, timestamp, sign);
         CC_LOGD(TAG, "get license: %s", url_buf);
-        cc_http_simple_get(url_buf, __get_license_http_cb, NULL);
+        // 已连上 MQTT 时（如刷新）走 RPC，否则 HTTP
+        snprintf(params, sizeof(params), "{\"uname\":\"%s\",\"time\":%lu,\"sign\":\"%s\"}", uname, timestamp, sign);
+        gs_mqtt_rpc_call("license.get", params, url_buf, GS_MQTT_RPC_TIMEOUT_MS, __get_license_http_cb, NULL);
     }else{
         CC_LOGE_CODE(TAG, err);
     }
     cc_tmr_task_delete(__get_license_task);
 }
 
-static void __get_time_http_cb(void *arg, int resp_code, uint8_t *buf, uint16_t len){
-    CC_LOGI(TAG, "_get_list_http_cb recv len: %d  data: %.*s", len, len, buf);
+static void __license_refresh_task(uint32_t interval, void *arg){
+    cc_tmr_task_delete(__license_refresh_task);
+    CC_LOGI(TAG, "refresh license, expire %lu now %lu", g_license_expire, get_time_get_utc());
+    g_license_refreshing = 1;
+    cc_tmr_task_create(__get_license_task, 100, NULL);
+}
 
-    cJSON *root_obj = NULL, *time_obj = NULL;
+static void __license_refresh_later(void){
+    cc_tmr_task_delete(__license_refresh_task);
+    cc_tmr_task_create(__license_refresh_task, g_license_retry_ms, NULL);
+    g_license_retry_ms = g_license_retry_ms * 2 > LICENSE_RETRY_MAX_MS ? LICENSE_RETRY_MAX_MS : g_license_retry_ms * 2;
+}
 
-    if(resp_code != 200){
-        CC_LOGE(TAG, "resp_code: %d", resp_code);
-        return;
-    }
+// 有效期需要可信的当前时间，时间有效后才检查
+static void __license_check_expire(void){
+    uint32_t now = get_time_get_utc();
+    uint32_t margin = CONFIG_GS_LICENSE_REFRESH_DAYS * 24 * 3600;
 
-    buf[len] = '\0';
-    root_obj = cJSON_Parse((char *)buf);
-    if(root_obj == NULL){
-        CC_LOGE(TAG, "cJSON_Parse error");
+    if(g_license_expire == 0 || strlen(g_dev_triple.product_key) == 0 || g_license_refreshing){
         return;
     }
-
-    time_obj = cJSON_GetObjectItem(root_obj, "time");
-    if(time_obj == NULL || time_obj->type != cJSON_Number){
-        cJSON_Delete(root_obj);
-        return;
+    if(now + margin >= g_license_expire){
+        if(now >= g_license_expire){
+            CC_LOGW(TAG, "license expired at %lu", g_license_expire);
+        }
+        cc_tmr_task_delete(__license_refresh_task);
+        cc_tmr_task_create(__license_refresh_task, 100, NULL);
     }
+}
 
-    cc_hal_sys_set_time(time_obj->valueint);
-
-    CC_LOGI(TAG, "get time: %ld", time_obj->valueint);
-
-    // cc_tmr_task_set_interval(__get_time_task, 60*60*1000);
-    if(strlen(g_dev_triple.product_key) == 0){
-        cc_tmr_task_create(__get_license_task, 100, NULL);
+// license 签名需要当前时间，由 get_time 时间服务提供
+static void __time_event_handler(void* handler_args, cc_event_base_t base_event, int32_t id, void* event_data){
+    if(base_event == GET_TIME_EVENT && id == GET_TIME_EVENT_VALID){
+        cc_event_unregister_handler(GET_TIME_EVENT, __time_event_handler);
+        if(strlen(g_dev_triple.product_key) == 0){
+            cc_tmr_task_create(__get_license_task, 100, NULL);
+        }
     }
-
-    cJSON_Delete(root_obj);
 }
 
-void __get_time_task(uint32_t interval, void *arg){
-    char url_buf[128] = "";
-
-    CC_LOGI(TAG, "start get time");
-    sprintf(url_buf, "http://xxx.xxx.xx/mqtt/getTime.php?device_name=%s", g_dev_triple.device_name);
-    CC_LOGI(TAG, "__get_time_task: Sending request to URL: %s", url_buf);
-    cc_http_simple_get(url_buf, __get_time_http_cb, NULL);
-    CC_LOGI(TAG, "__get_time_task: HTTP request sent, task deleting itself");
-    cc_tmr_task_delete(__get_time_task);
+// 常驻：每次对时后检查一次有效期，长期在线的设备也能在到期前刷新
+static void __expire_event_handler(void* handler_args, cc_event_base_t base_event, int32_t id, void* event_data){
+    if(base_event == GET_TIME_EVENT && (id == GET_TIME_EVENT_VALID || id == GET_TIME_EVENT_SYNC)){
+        __license_check_expire();
+    }
 }
 
 cc_err_t gs_device_get_license(void){
     if(strlen(g_dev_triple.product_key) == 0){
-        cc_tmr_task_create(__get_time_task, 100, NULL);
+        if(get_time_is_valid()){
+            cc_tmr_task_create(__get_license_task, 100, NULL);
+        }else{
+            cc_event_register_handler(GET_TIME_EVENT, __time_event_handler);
+            get_time_start_update();
+        }
     }
     return CC_OK;
 }
@@ -285,6 +413,12 @@ cc_err_t gs_device_init(void){
     size_t len = 0;
 
     memset(&g_dev_triple, 0, sizeof(_dev_triple_t));
+    cc_event_register_handler(GET_TIME_EVENT, __expire_event_handler);
+
+    // 带有效期的缓存验签通过即可用，不需要网络
+    if(__license_cache_load()){
+        return CC_OK;
+    }
 
     // cc_hal_kvs_get(DEV_KVS_KEY, &g_dev_triple, &len);
     len = GS_PRODUCT_KEY_BUF_MAX_LEN;
@@ -0,0 +1,255 @@
+#include "gs_link.h"
+
+#include <string.h>
+
+#include "sdkconfig.h"
+
+#include "cc_log.h"
+#include "cc_hal_os.h"
+#include "cc_hal_sys.h"
+#include "cc_hal_wifi.h"
+#include "cc_tmr_task.h"
+
+#include "gs_wifi.h"
+#include "gs_bind.h"
+#include "gs_mqtt.h"
+
+#if CONFIG_GS_LINK_LTE_BACKUP
+#include "esp_event.h"
+#include "esp_netif.h"
+#include "usbh_modem_board.h"
+#endif
+
+CC_EVENT_DEFINE_BASE(GS_LINK_EVENT);
+
+#if CONFIG_GS_LINK_LTE_BACKUP
+
+static char *TAG = "gs_link";
+
+#define PROBE_WINDOW            8
+
+static const char *g_link_name[] = {"none", "wifi", "cell"};
+
+// 最近 PROBE_WINDOW 次网关探测的 RTT，-1 为超时；探测任务写，定时任务读
+static int16_t g_probe_rtt[PROBE_WINDOW];
+static uint8_t g_probe_pos = 0;
+static uint8_t g_probe_cnt = 0;
+static cc_os_spinlock_t g_probe_lock = CC_OS_SPINLOCK_INIT;
+
+static volatile uint8_t g_wifi_up = 0;
+static volatile uint8_t g_cell_up = 0;
+static volatile uint8_t g_reapply = 0;      // 其他接口拿到地址后可能改了默认路由/DNS，下一轮重新设置
+
+static gs_link_t g_active = GS_LINK_NONE;
+static uint64_t g_wifi_good_since = 0;      // Wi-Fi 连续达标的起始时间，0 为未达标
+
+static void __probe_cb(int32_t rtt_ms){
+    cc_hal_os_enter_critical(&g_probe_lock);
+    g_probe_rtt[g_probe_pos] = (rtt_ms < 0) ? -1 : (rtt_ms > INT16_MAX ? INT16_MAX : (int16_t)rtt_ms);
+    g_probe_pos = (g_probe_pos + 1) % PROBE_WINDOW;
+    if(g_probe_cnt < PROBE_WINDOW){
+        g_probe_cnt++;
+    }
+    cc_hal_os_exit_critical(&g_probe_lock);
+}
+
+static void __probe_reset(void){
+    cc_hal_os_enter_critical(&g_probe_lock);
+    g_probe_pos = 0;
+    g_probe_cnt = 0;
+    cc_hal_os_exit_critical(&g_probe_lock);
+}
+
+void gs_link_get_wifi_quality(uint16_t *rtt_ms, uint8_t *loss){
+    uint32_t sum = 0;
+    uint8_t ok = 0, lost = 0;
+
+    cc_hal_os_enter_critical(&g_probe_lock);
+    for(uint8_t i = 0; i < g_probe_cnt; i++){
+        if(g_probe_rtt[i] < 0){
+            lost++;
+        }else{
+            sum += g_probe_rtt[i];
+            ok++;
+        }
+    }
+    cc_hal_os_exit_critical(&g_probe_lock);
+
+    if(rtt_ms){
+        *rtt_ms = ok ? (uint16_t)(sum / ok) : 0;
+    }
+    if(loss){
+        *loss = lost;
+    }
+}
+
+static uint8_t __wifi_bad(void){
+    uint16_t rtt_ms = 0;
+    uint8_t loss = 0;
+    gs_link_get_wifi_quality(&rtt_ms, &loss);
+    return loss >= CONFIG_GS_LINK_LOSS_MAX || rtt_ms > CONFIG_GS_LINK_RTT_MAX_MS;
+}
+
+static void __link_apply(gs_link_t link){
+    if(link == GS_LINK_WIFI){
+        cc_hal_wifi_sta_set_default_route();
+    }else if(link == GS_LINK_CELL){
+        esp_netif_t *netif = modem_board_get_netif();
+        if(netif && esp_netif_get_default_netif() != netif){
+            esp_netif_set_default_netif(netif);
+        }
+        // STA 的 DNS 多为局域网地址，经 4G 不可达
+        esp_netif_dns_info_t dns;
+        if(netif && modem_board_get_dns_info(ESP_NETIF_DNS_MAIN, &dns) == ESP_OK){
+            esp_netif_set_dns_info(netif, ESP_NETIF_DNS_MAIN, &dns);
+        }
+        if(netif && modem_board_get_dns_info(ESP_NETIF_DNS_BACKUP, &dns) == ESP_OK){
+            esp_netif_set_dns_info(netif, ESP_NETIF_DNS_BACKUP, &dns);
+        }
+    }
+}
+
+static void __link_switch(gs_link_t link){
+    gs_link_t from = g_active;
+
+    CC_LOGI(TAG, "link %s -> %s", g_link_name[from], g_link_name[link]);
+    g_active = link;
+    __link_apply(link);
+    cc_event_post(GS_LINK_EVENT, GS_LINK_EVENT_CHANGED, &link, sizeof(link));
+
+    // 从无网恢复时 MQTT 客户端自己会重连；换出口时旧连接的源地址还在旧接口上，立即迁移
+    if(from != GS_LINK_NONE && link != GS_LINK_NONE && gs_bind_get_bind_status()){
+        gs_mqtt_reconnect();
+    }else if(from == GS_LINK_NONE && link == GS_LINK_CELL && gs_bind_get_bind_status()){
+        // Wi-Fi 从未拿到地址时 gs_mqtt 不会发起连接
+        gs_mqtt_start_connect();
+    }
+}
+
+static void __link_task(uint32_t interval, void *arg){
+    uint8_t wifi_up = g_wifi_up;
+    uint8_t cell_up = g_cell_up;
+    uint8_t wifi_bad = wifi_up ? __wifi_bad() : 1;
+    gs_link_t next = g_active;
+
+    if(!wifi_bad && g_probe_cnt == PROBE_WINDOW){
+        if(g_wifi_good_since == 0){
+            g_wifi_good_since = cc_hal_sys_get_ms();
+        }
+    }else{
+        g_wifi_good_since = 0;
+    }
+
+    switch(g_active){
+    case GS_LINK_WIFI:
+        if(wifi_bad && cell_up){
+            next = GS_LINK_CELL;
+        }else if(!wifi_up){
+            next = GS_LINK_NONE;
+        }
+        break;
+    case GS_LINK_CELL:
+        if(!cell_up){
+            next = wifi_up ? GS_LINK_WIFI : GS_LINK_NONE;
+        }else if(g_wifi_good_since && cc_hal_sys_get_ms() - g_wifi_good_since >= CONFIG_GS_LINK_FAILBACK_MS){
+            next = GS_LINK_WIFI;
+        }
+        break;
+    default:
+        if(wifi_up && (!wifi_bad || !cell_up)){
+            next = GS_LINK_WIFI;
+        }else if(cell_up){
+            next = GS_LINK_CELL;
+        }
+        break;
+    }
+
+    if(next != g_active){
+        __link_switch(next);
+    }else if(g_reapply){
+        __link_apply(g_active);
+    }
+    g_reapply = 0;
+}
+
+static void __wifi_event_handler(void* handler_args, cc_event_base_t base_event, int32_t id, void* event_data){
+    switch(id){
+    case GS_WIFI_EVENT_STA_GOT_IP:
+        __probe_reset();
+        cc_hal_wifi_probe_start(CONFIG_GS_LINK_PROBE_INTERVAL_MS, CONFIG_GS_LINK_PROBE_TIMEOUT_MS, __probe_cb);
+        g_wifi_up = 1;
+        g_reapply = 1;
+        break;
+    case GS_WIFI_EVENT_STA_DISCONNECTED:
+        g_wifi_up = 0;
+        cc_hal_wifi_probe_stop();
+        __probe_reset();
+        break;
+    default:
+        break;
+    }
+}
+
+static void __modem_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data){
+    switch(event_id){
+    case MODEM_EVENT_NET_CONN:
+        CC_LOGI(TAG, "cell up");
+        g_cell_up = 1;
+        g_reapply = 1;
+        break;
+    case MODEM_EVENT_NET_DISCONN:
+    case MODEM_EVENT_DTE_DISCONN:
+        if(g_cell_up){
+            CC_LOGI(TAG, "cell down");
+        }
+        g_cell_up = 0;
+        break;
+    default:
+        break;
+    }
+}
+
+gs_link_t gs_link_get_active(void){
+    return g_active;
+}
+
+cc_err_t gs_link_init(void){
+    // 模组守护任务会一直使用配置，不能放在栈上
+    static modem_config_t modem_config = MODEM_DEFAULT_CONFIG();
+    modem_config.handler = __modem_event_handler;
+    modem_config.flags = MODEM_FLAGS_INIT_NOT_BLOCK;
+
+    if(modem_board_init(&modem_config) != ESP_OK){
+        CC_LOGE(TAG, "modem init failed");
+        return CC_FAIL;
+    }
+
+    cc_event_register_handler(GS_WIFI_EVENT, __wifi_event_handler);
+
+    if(cc_tmr_task_create_handle(__link_task, CONFIG_GS_LINK_PROBE_INTERVAL_MS, NULL) == CC_TMR_TASK_INVALID){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+    return CC_OK;
+}
+
+#else
+
+gs_link_t gs_link_get_active(void){
+    return cc_hal_wifi_sta_get_connect_status() ? GS_LINK_WIFI : GS_LINK_NONE;
+}
+
+void gs_link_get_wifi_quality(uint16_t *rtt_ms, uint8_t *loss){
+    if(rtt_ms){
+        *rtt_ms = 0;
+    }
+    if(loss){
+        *loss = 0;
+    }
+}
+
+cc_err_t gs_link_init(void){
+    return CC_OK;
+}
+
+#endif
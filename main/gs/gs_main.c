@@ -9,6 +9,7 @@
 #include "gs_wifi.h"
 #include "gs_bind.h"
 #include "gs_mqtt.h"
+#include "gs_link.h"
 #include "gs_ota.h"
 
 static char *TAG = "gs_main";
@@ -24,5 +25,7 @@ void gs_init(char *sw_ver, char *hw_ver){
 
     gs_mqtt_init();
 
+    gs_link_init();
+
     gs_ota_init();
 }
@@ -11,19 +11,25 @@
 #include "gs_bind.h"
 #include "gs_device.h"
 
-#include "cc_list.h"
 #include "cc_tmr_task.h"
+#include "cc_sched.h"
 
 #include "cc_hal_sys.h"
 #include "cc_hal_os.h"
 #include "cc_hal_kvs.h"
 #include "cc_hal_network.h"
+#include "conn_mgr.h"
 
 #include "cJSON.h"
+#include "json_writer.h"
+#include "cbor_writer.h"
+
+#include "esp_heap_caps.h"
 
 static char *TAG = "gs_mqtt";
 
 #define MQTT_KVS_KEY    "gs_mqtt"
+#define FMT_KVS_KEY     "gs_fmt"
 
 CC_EVENT_DEFINE_BASE(GS_MQTT_EVENT);
 
@@ -39,25 +45,108 @@ typedef struct{
 static _mqtt_config_t g_mqtt_config = {0};
 
 static void *g_mqtt_handle = NULL;
-static cc_list_node *g_mqtt_msg_cb_list = NULL;
+static conn_mgr_conn_t g_mqtt_conn = CONN_MGR_CONN_INIT("mqtt");   // 控制通道长期占一个名额
 
 static char g_mqtt_topic_prefix[52] = "";
+static uint8_t g_mqtt_topic_prefix_len = 0;
+
+/*
+ * 下行消息回调按 topic 后缀（去掉前缀）哈希分桶，每条消息只比较同桶的回调；
+ * 不指定 topic 的回调挂在单独的链上，接收全部消息。
+ * 回调只增不删，写入完成后再挂到链头，分发时无需加锁。
+ */
+#define MSG_CB_MAX              16
+#define MSG_CB_BUCKETS          8       // 2 的幂
+
+typedef struct{
+    const char *suffix;
+    uint16_t suffix_len;
+    uint32_t hash;
+    gs_mqtt_msg_cb_t cb;
+    uint8_t next;                       // 同链下一个回调的下标 + 1，0 表示结束
+}_msg_cb_entry_t;
+
+static _msg_cb_entry_t g_msg_cbs[MSG_CB_MAX];
+static uint8_t g_msg_cb_cnt = 0;
+static uint8_t g_msg_cb_buckets[MSG_CB_BUCKETS];     // 链头下标 + 1
+static uint8_t g_msg_cb_any = 0;
+static cc_os_spinlock_t g_msg_cb_lock = CC_OS_SPINLOCK_INIT;
+
+// 预先拼好前缀的 topic，发布时不再格式化
+#define TOPIC_FULL_MAX          96
+
+typedef struct{
+    const char *suffix;
+    char full[TOPIC_FULL_MAX];
+}_topic_entry_t;
+
+static _topic_entry_t g_topics[GS_MQTT_TOPIC_MAX];
+static uint8_t g_topic_cnt = 0;
+static cc_os_spinlock_t g_topic_lock = CC_OS_SPINLOCK_INIT;
 
 static char g_mqtt_connect_status = 0;
+static gs_mqtt_fmt_t g_payload_fmt = GS_MQTT_FMT_JSON;
+
+/*
+ * 离线发件箱：断网期间的消息存入固定槽位（PSRAM 一次分配），按入队顺序补发。
+ * - 满时优先丢弃最旧的 QoS0 消息，QoS0 超过 OUTBOX_QOS0_TTL_MS 未发出即丢弃
+ * - 属性上报按 topic 去重，只保留最新一条
+ * - QoS1 消息同时写入 KVS，重启后恢复
+ * - 重连后每个周期补发 OUTBOX_DRAIN_BATCH 条，发布失败则保留等待下次
+ */
+#define OUTBOX_SLOTS            16
+#define OUTBOX_TOPIC_MAX        64
+#define OUTBOX_QOS0_TTL_MS      10000
+#define OUTBOX_DRAIN_BATCH      4
+#define OUTBOX_DRAIN_PERIOD_MS  100
+#define OUTBOX_KVS_KEY          "gs_outbox"
+#define OUTBOX_PERSIST_MAX      (1 + OUTBOX_SLOTS * (5 + OUTBOX_TOPIC_MAX + MSG_LEN_MAX))
 
 typedef struct{
-	char *topic;
-	uint8_t *data;
-	uint16_t len;
-	uint8_t qos;
-	uint8_t retain;
+    uint8_t qos;
+    uint8_t retain;
+    uint16_t len;
     uint32_t tm;
-}_msg_ctx_t;
+    char topic[OUTBOX_TOPIC_MAX];
+    uint8_t data[MSG_LEN_MAX];
+}_outbox_msg_t;
 
-static cc_list_node *g_msg_list = NULL;
+static _outbox_msg_t *g_outbox = NULL;
+static uint8_t g_outbox_order[OUTBOX_SLOTS];    // 按入队顺序排列的槽位号
+static uint8_t g_outbox_count = 0;
+static uint16_t g_outbox_free_mask = (1 << OUTBOX_SLOTS) - 1;
+static cc_os_semphr_handle_t g_outbox_lock = NULL;
+static cc_tmr_task_handle_t g_publish_task = CC_TMR_TASK_INVALID;
 
 static cc_err_t __mqtt_get_host(void);
 
+/*
+ * RPC：原来单独走 HTTP 的云端接口（license、时间、MQTT 地址）在已连接时改走 MQTT，省去新的 TCP/TLS 握手。
+ * 请求 {"id":N,"method":"...","params":{...}} 发到 GS_MQTT_RPC_TOPIC_REQ，
+ * 云端在 GS_MQTT_RPC_TOPIC_RESP 回 {"id":N,"code":200,"body":...}，body 为该接口 HTTP 响应的内容（字符串或对象）。
+ * 回调与 cc_http_simple_get 相同，在网络任务中执行；未连接、超时或断线时改走 fallback_url，
+ * 没有 fallback_url 时以 resp_code -1 回调。
+ */
+#define RPC_SLOTS               4
+#define RPC_POLL_MS             100
+
+typedef struct{
+    uint32_t id;                        // 0 表示空闲
+    uint64_t deadline;
+    cc_http_req_cb_t cb;
+    void *arg;
+    char *fallback_url;
+    char *body;                         // 收到的响应，多留 1 字节给回调写 '\0'
+    uint16_t body_len;
+    int code;
+    uint8_t done;
+}_rpc_slot_t;
+
+static _rpc_slot_t g_rpc_slots[RPC_SLOTS];
+static uint32_t g_rpc_id = 0;
+static cc_os_semphr_handle_t g_rpc_lock = NULL;
+static cc_tmr_task_handle_t g_rpc_task = CC_TMR_TASK_INVALID;
+
 static cc_err_t __mqtt_save_config(void){
     cc_err_t err = CC_FAIL;
 
@@ -93,34 +182,104 @@ cc_err_t gs_mqtt_reset_config(void){
         return err;
     }   
 
+    // 解绑后回到默认的 JSON，由新的云端重新协商
+    g_payload_fmt = GS_MQTT_FMT_JSON;
+    cc_hal_kvs_del(FMT_KVS_KEY);
+
     CC_LOGI(TAG, "gs_mqtt_reset_config");
 
     return CC_OK;
 }
 
+static size_t __birth_version_msg(uint8_t *buf, size_t size, const char *sw_version){
+    char seq[GS_MQTT_SEQ_LEN];
+
+    gs_mqtt_generate_seq(seq);
+    if(g_payload_fmt == GS_MQTT_FMT_CBOR){
+        cbor_writer_t w;
+        cbor_writer_init(&w, buf, size);
+        cbor_writer_map(&w, 4);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_VER);
+        cbor_writer_text(&w, sw_version);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_ACT);
+        cbor_writer_uint(&w, 0x0002);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_FMT);
+        cbor_writer_text(&w, GS_MQTT_FMT_SUPPORTED);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_SEQ);
+        cbor_writer_text(&w, seq);
+        return cbor_writer_finish(&w);
+    }
+
+    json_writer_t w;
+    json_writer_init(&w, (char *)buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_str(&w, "ver", sw_version);
+    json_writer_kv_str(&w, "act", "0002");
+    json_writer_kv_str(&w, "fmt", GS_MQTT_FMT_SUPPORTED);
+    json_writer_kv_str(&w, "seq_no", seq);
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
+
+static size_t __birth_rssi_msg(uint8_t *buf, size_t size, const char *sw_version){
+    int8_t rssi = cc_hal_wifi_get_connect_rssi();
+    char seq[GS_MQTT_SEQ_LEN];
+
+    gs_mqtt_generate_seq(seq);
+    if(g_payload_fmt == GS_MQTT_FMT_CBOR){
+        cbor_writer_t w;
+        cbor_writer_init(&w, buf, size);
+        cbor_writer_map(&w, 5);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_VER);
+        cbor_writer_text(&w, sw_version);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_ACT);
+        cbor_writer_uint(&w, 0x0003);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_TYPE);
+        cbor_writer_uint(&w, 0x02);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_DATA);
+        cbor_writer_int(&w, rssi);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_SEQ);
+        cbor_writer_text(&w, seq);
+        return cbor_writer_finish(&w);
+    }
+
+    // JSON 中 data 按协议为字符串
+    char rssi_str[8];
+    snprintf(rssi_str, sizeof(rssi_str), "%d", rssi);
+    json_writer_t w;
+    json_writer_init(&w, (char *)buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_str(&w, "ver", sw_version);
+    json_writer_kv_str(&w, "act", "0003");
+    json_writer_kv_str(&w, "type", "02");
+    json_writer_kv_str(&w, "data", rssi_str);
+    json_writer_kv_str(&w, "seq_no", seq);
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
+
 static void __mqtt_birth(void){
-    char msg[128];
+    uint8_t msg[128];
     char sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
     char hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+    size_t len;
     cc_err_t ret;
 
     gs_device_get_version(sw_version, hw_version);
 
     // 发送软件版本消息
-    sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0002\",\"seq_no\":\"%s\"}", 
-            sw_version, gs_mqtt_generate_seq());
-    ret = gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), 
-                         GS_MQTT_QOS0, 0);
+    len = __birth_version_msg(msg, sizeof(msg), sw_version);
+    ret = len ? gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, msg, len, GS_MQTT_QOS0, 0)
+              : CC_ERR_INVALID_SIZE;
     
     if(g_birth_callback) {
         g_birth_callback(0, (ret == CC_OK) ? 1 : 0);  // 0表示版本消息
     }
 
     // 发送WiFi信号强度消息
-    sprintf(msg, "{\"ver\":\"%s\",\"act\":\"0003\",\"type\":\"02\",\"data\":\"%d\",\"seq_no\":\"%s\"}", 
-            sw_version, cc_hal_wifi_get_connect_rssi(), gs_mqtt_generate_seq());
-    ret = gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, (uint8_t *)msg, strlen(msg), 
-                         GS_MQTT_QOS0, 0);
+    len = __birth_rssi_msg(msg, sizeof(msg), sw_version);
+    ret = len ? gs_mqtt_publish(PUB_TOPIC_PROPERTY_POST, msg, len, GS_MQTT_QOS0, 0)
+              : CC_ERR_INVALID_SIZE;
     
     if(g_birth_callback) {
         g_birth_callback(1, (ret == CC_OK) ? 1 : 0);  // 1表示信号强度消息
@@ -194,6 +353,7 @@ static void __event_handler(void* handler_args, cc_event_base_t base_event, int3
         switch (id)
         {
         case GS_MQTT_EVENT_CONNECTED:
+            gs_mqtt_subscribe(GS_MQTT_RPC_TOPIC_RESP, GS_MQTT_QOS0);
             if(gs_bind_get_bind_status()){
                 __mqtt_birth();
             }
@@ -267,10 +427,13 @@ static cc_err_t __mqtt_get_host(void){
     char device_name[GS_DEVICE_NAME_BUF_MAX_LEN] = "";
     gs_device_get_device_name(device_name);
 
+    char params[48] = "";
+
     CC_LOGI(TAG, "get mqtt host start");
     //TODO
-    sprintf(url_buf, "http://gaoshi.wdaoyun.cn/mqtt/getMqtt.php?device_name=%s", device_name);
-    cc_http_simple_get(url_buf, __get_mqtt_host_http_cb, NULL);
+    sprintf(url_buf, "http://" GS_MQTT_API_HOST "/mqtt/getMqtt.php?device_name=%s", device_name);
+    snprintf(params, sizeof(params), "{\"device_name\":\"%s\"}", device_name);
+    gs_mqtt_rpc_call("mqtt.host", params, url_buf, GS_MQTT_RPC_TIMEOUT_MS, __get_mqtt_host_http_cb, NULL);
 
     return CC_OK;
 }
@@ -281,24 +444,43 @@ static cc_err_t __connect_cb(void *arg){
     return CC_OK;
 }
 
-static cc_err_t __msg_cb(void *arg, char *topic, char *data, uint16_t len, cc_mqtt_qos_t qos, uint8_t retain){
-    CC_LOGD(TAG, "topic: %s, data: %.*s", topic, len, data);
-    if(g_mqtt_msg_cb_list){
-        if(strstr(topic, g_mqtt_topic_prefix)){
-            char topic[128] = "";
-            uint8_t prefix_len = strlen(g_mqtt_topic_prefix);
-            memcpy(topic, topic + prefix_len, strlen(topic) - prefix_len);
-            topic[strlen(topic) - prefix_len] = '\0';
-            cc_list_node *node = g_mqtt_msg_cb_list;
-            while (node){
-                gs_mqtt_msg_cb_t msg_cb = node->data;
-                if(msg_cb){
-                    msg_cb(topic, qos, retain, data, len);
-                }
-                node = node->next;
-            }
+static uint32_t __topic_hash(const char *topic, uint16_t len){
+    // FNV-1a
+    uint32_t hash = 2166136261u;
+    for(uint16_t i = 0; i < len; i++){
+        hash = (hash ^ (uint8_t)topic[i]) * 16777619u;
+    }
+    return hash;
+}
+
+static void __msg_cb_chain(uint8_t head, const char *topic, uint16_t topic_len, uint32_t hash,
+                           uint8_t qos, uint8_t retain, char *data, uint32_t len){
+    uint8_t idx = head;
+    while(idx){
+        const _msg_cb_entry_t *entry = &g_msg_cbs[idx - 1];
+        if(entry->suffix == NULL || (entry->hash == hash && entry->suffix_len == topic_len &&
+                                     memcmp(entry->suffix, topic, topic_len) == 0)){
+            entry->cb(topic, topic_len, qos, retain, data, len);
         }
+        idx = entry->next;
     }
+}
+
+static cc_err_t __msg_cb(void *arg, const char *topic, uint16_t topic_len, char *data, uint32_t len, cc_mqtt_qos_t qos, uint8_t retain){
+    CC_LOGD(TAG, "topic: %.*s, data: %.*s", topic_len, topic, (int)len, data);
+
+    // 只处理本设备前缀下的消息，回调拿到的是去掉前缀后的后缀视图
+    if(topic_len < g_mqtt_topic_prefix_len || memcmp(topic, g_mqtt_topic_prefix, g_mqtt_topic_prefix_len) != 0){
+        return CC_OK;
+    }
+    topic += g_mqtt_topic_prefix_len;
+    topic_len -= g_mqtt_topic_prefix_len;
+
+    uint32_t hash = __topic_hash(topic, topic_len);
+    __msg_cb_chain(__atomic_load_n(&g_msg_cb_buckets[hash & (MSG_CB_BUCKETS - 1)], __ATOMIC_ACQUIRE),
+                   topic, topic_len, hash, qos, retain, data, len);
+    __msg_cb_chain(__atomic_load_n(&g_msg_cb_any, __ATOMIC_ACQUIRE),
+                   topic, topic_len, hash, qos, retain, data, len);
     return CC_OK;
 }
 
@@ -308,13 +490,29 @@ static cc_err_t __disconnect_cb(void *arg){
     return CC_OK;
 }
 
-char *gs_mqtt_generate_seq(void){
-    static char seq[33] = {0};
-    for (uint16_t i = 0; i < 32; i++){   
-        seq[i] = '0' + (uint8_t)cc_hal_sys_get_rand(10);
+gs_mqtt_fmt_t gs_mqtt_get_payload_fmt(void){
+    return g_payload_fmt;
+}
+
+cc_err_t gs_mqtt_set_payload_fmt(gs_mqtt_fmt_t fmt){
+    if(fmt != GS_MQTT_FMT_JSON && fmt != GS_MQTT_FMT_CBOR){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(fmt == g_payload_fmt){
+        return CC_OK;
+    }
+    g_payload_fmt = fmt;
+    uint8_t val = fmt;
+    cc_err_t err = cc_hal_kvs_set(FMT_KVS_KEY, &val, sizeof(val));
+    if(err != CC_OK){
+        CC_LOGE_CODE(TAG, err);
     }
-    seq[32] = '\0';
-    return seq;
+    CC_LOGI(TAG, "payload format: %s", fmt == GS_MQTT_FMT_CBOR ? "cbor" : "json");
+    return err;
+}
+
+char *gs_mqtt_generate_seq(char seq[GS_MQTT_SEQ_LEN]){
+    return uplink_id_next_str(seq);
 }
 
 cc_err_t gs_mqtt_subscribe(const char *topic, gs_mqtt_qos_t qos){
@@ -329,97 +527,322 @@ cc_err_t gs_mqtt_subscribe(const char *topic, gs_mqtt_qos_t qos){
     return CC_OK;
 }
 
-void __mqtt_publish_task(uint32_t interval, void *arg){
-    
-    cc_list_node *node = NULL;
+static void __topics_resolve(void){
+    for(uint8_t i = 0; i < g_topic_cnt; i++){
+        snprintf(g_topics[i].full, TOPIC_FULL_MAX, "%s%s", g_mqtt_topic_prefix, g_topics[i].suffix);
+    }
+}
 
-    uint32_t now_tm = cc_hal_sys_get_ms();
+gs_mqtt_topic_t gs_mqtt_topic_register(const char *topic){
+    gs_mqtt_topic_t handle = GS_MQTT_TOPIC_INVALID;
 
-    node = g_msg_list;
-    while(node){
-        _msg_ctx_t* msg_ctx = node->data;
+    if(topic == NULL || strlen(g_mqtt_topic_prefix) + strlen(topic) >= TOPIC_FULL_MAX){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+        return GS_MQTT_TOPIC_INVALID;
+    }
 
-        if(g_mqtt_connect_status){
-            gs_mqtt_publish(msg_ctx->topic, msg_ctx->data, msg_ctx->len, msg_ctx->qos, msg_ctx->retain);
+    cc_hal_os_enter_critical(&g_topic_lock);
+    for(uint8_t i = 0; i < g_topic_cnt; i++){
+        if(g_topics[i].suffix == topic || strcmp(g_topics[i].suffix, topic) == 0){
+            handle = i;
+            break;
         }
+    }
+    if(handle == GS_MQTT_TOPIC_INVALID && g_topic_cnt < GS_MQTT_TOPIC_MAX){
+        handle = g_topic_cnt;
+        g_topics[handle].suffix = topic;
+        g_topics[handle].full[0] = '\0';
+        g_topic_cnt++;
+    }
+    cc_hal_os_exit_critical(&g_topic_lock);
 
-        if(now_tm - msg_ctx->tm > 10000 || g_mqtt_connect_status){
-            cc_list_node *del_node = node;
-            node = node->next;
-            cc_hal_sys_free(msg_ctx->topic);
-            cc_hal_sys_free(msg_ctx->data);
-            cc_hal_sys_free(msg_ctx);
-            cc_list_remove(&g_msg_list, del_node);
-        }else{
-            node = node->next;
-        }
+    if(handle == GS_MQTT_TOPIC_INVALID){
+        CC_LOGE(TAG, "topic registry full: %s", topic);
+    }else if(g_topics[handle].full[0] == '\0' && g_mqtt_topic_prefix[0]){
+        snprintf(g_topics[handle].full, TOPIC_FULL_MAX, "%s%s", g_mqtt_topic_prefix, topic);
     }
-    
-    if(g_msg_list == NULL){
-        cc_tmr_task_delete(__mqtt_publish_task);
+    return handle;
+}
+
+static cc_err_t __mqtt_publish_full(const char *full_topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain){
+    if(NULL == g_mqtt_handle){
+        CC_LOGE(TAG, "mqtt not connect");
+        return CC_FAIL;
     }
+    return cc_hal_mqtt_publish((cc_mqtt_t *)g_mqtt_handle, (char *)full_topic, (char *)data, len, qos, retain);
 }
 
-cc_err_t gs_mqtt_publish(const char *topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain){
+static cc_err_t __mqtt_publish_now(const char *topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain){
     char full_topic[128] = "";
 
-    if(g_mqtt_connect_status == 0){
-        CC_LOGW(TAG, "gs_mqtt not connect delay publish topic: %s data: %.*s", topic, len, data);
-        _msg_ctx_t* msg_ctx = cc_hal_sys_malloc(sizeof(_msg_ctx_t));
-        if(msg_ctx == NULL){
-            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-            return CC_ERR_NO_MEM;
+    // 已登记的 topic 直接使用预先拼好的全名
+    for(uint8_t i = 0; i < g_topic_cnt; i++){
+        if(g_topics[i].suffix == topic && g_topics[i].full[0]){
+            return __mqtt_publish_full(g_topics[i].full, data, len, qos, retain);
         }
-        msg_ctx->topic = cc_hal_sys_malloc(strlen(topic) + 1);
-        msg_ctx->data = cc_hal_sys_malloc(len);
-        if(msg_ctx->topic == NULL || msg_ctx->data == NULL){
-            cc_hal_sys_free(msg_ctx);
-            if(msg_ctx->topic){
-                cc_hal_sys_free(msg_ctx->topic);
+    }
+
+    snprintf(full_topic, 128, "%s%s", g_mqtt_topic_prefix, topic);
+    return __mqtt_publish_full(full_topic, data, len, qos, retain);
+}
+
+// 从发件箱移除第 pos 个（按顺序）消息，调用时持有锁
+static void __outbox_remove_at(uint8_t pos){
+    g_outbox_free_mask |= 1 << g_outbox_order[pos];
+    g_outbox_count--;
+    memmove(&g_outbox_order[pos], &g_outbox_order[pos + 1], g_outbox_count - pos);
+}
+
+// 将 QoS1 消息写入 KVS：[count] 后接每条 [qos retain len(2) topic_len topic data]
+static void __outbox_persist(void){
+    uint8_t *buf = NULL;
+    size_t len = 1;
+    uint8_t cnt = 0;
+
+    for(uint8_t i = 0; i < g_outbox_count; i++){
+        _outbox_msg_t *msg = &g_outbox[g_outbox_order[i]];
+        if(msg->qos > GS_MQTT_QOS0){
+            len += 5 + strlen(msg->topic) + msg->len;
+        }
+    }
+    if(len == 1){
+        cc_hal_kvs_del(OUTBOX_KVS_KEY);
+        return;
+    }
+
+    buf = cc_hal_sys_malloc_caps(len, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_APP);
+    if(buf == NULL){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return;
+    }
+    len = 1;
+    for(uint8_t i = 0; i < g_outbox_count; i++){
+        _outbox_msg_t *msg = &g_outbox[g_outbox_order[i]];
+        if(msg->qos == GS_MQTT_QOS0){
+            continue;
+        }
+        uint8_t topic_len = strlen(msg->topic);
+        buf[len++] = msg->qos;
+        buf[len++] = msg->retain;
+        buf[len++] = msg->len & 0xFF;
+        buf[len++] = msg->len >> 8;
+        buf[len++] = topic_len;
+        memcpy(buf + len, msg->topic, topic_len);
+        len += topic_len;
+        memcpy(buf + len, msg->data, msg->len);
+        len += msg->len;
+        cnt++;
+    }
+    buf[0] = cnt;
+    cc_hal_kvs_set(OUTBOX_KVS_KEY, buf, len);
+    cc_hal_sys_free(buf);
+}
+
+// 入队，调用时持有锁；返回是否有 QoS1 消息变化
+static bool __outbox_push(const char *topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain){
+    _outbox_msg_t *msg = NULL;
+    bool removed_qos1 = false;
+
+    // 属性上报只保留最新一条
+    if(strcmp(topic, PUB_TOPIC_PROPERTY_POST) == 0){
+        for(uint8_t i = 0; i < g_outbox_count; i++){
+            if(strcmp(g_outbox[g_outbox_order[i]].topic, topic) == 0){
+                removed_qos1 = g_outbox[g_outbox_order[i]].qos > GS_MQTT_QOS0;
+                __outbox_remove_at(i);
+                break;
             }
-            CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-            return CC_ERR_NO_MEM;
         }
-        strcpy(msg_ctx->topic, topic);
-        
-        memcpy(msg_ctx->data, data, len);
-        msg_ctx->len = len;
-        msg_ctx->qos = qos;
-        msg_ctx->retain = retain;
-        msg_ctx->tm = cc_hal_sys_get_ms();
-
-        if(g_msg_list == NULL){
-            g_msg_list = cc_list_create(msg_ctx);
-            cc_tmr_task_create(__mqtt_publish_task, 100, NULL);
-        }else{
-            cc_list_insert_end(g_msg_list, msg_ctx);
+    }
+
+    if(g_outbox_count == OUTBOX_SLOTS){
+        uint8_t victim = 0;
+        for(uint8_t i = 0; i < g_outbox_count; i++){
+            if(g_outbox[g_outbox_order[i]].qos == GS_MQTT_QOS0){
+                victim = i;
+                break;
+            }
         }
-    }else{
-        CC_LOGD(TAG, "gs_mqtt_publish topic: %s data: %.*s", topic, len, data);
-    
-        if(NULL == g_mqtt_handle){
-            CC_LOGE(TAG, "mqtt not connect");
-            return CC_FAIL;
+        CC_LOGW(TAG, "outbox full, drop topic: %s", g_outbox[g_outbox_order[victim]].topic);
+        removed_qos1 |= g_outbox[g_outbox_order[victim]].qos > GS_MQTT_QOS0;
+        __outbox_remove_at(victim);
+    }
+
+    uint8_t slot = __builtin_ctz(g_outbox_free_mask);
+    g_outbox_free_mask &= ~(1 << slot);
+    g_outbox_order[g_outbox_count++] = slot;
+
+    msg = &g_outbox[slot];
+    strncpy(msg->topic, topic, OUTBOX_TOPIC_MAX - 1);
+    msg->topic[OUTBOX_TOPIC_MAX - 1] = '\0';
+    memcpy(msg->data, data, len);
+    msg->len = len;
+    msg->qos = qos;
+    msg->retain = retain;
+    msg->tm = cc_hal_sys_get_ms();
+
+    return removed_qos1 || qos > GS_MQTT_QOS0;
+}
+
+static void __outbox_restore(void){
+    size_t len = OUTBOX_PERSIST_MAX;
+
+    uint8_t *buf = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if(buf == NULL){
+        return;
+    }
+    if(cc_hal_kvs_get(OUTBOX_KVS_KEY, buf, &len) == CC_OK && len > 1){
+        size_t off = 1;
+        for(uint8_t i = 0; i < buf[0] && off + 5 <= len; i++){
+            uint8_t qos = buf[off], retain = buf[off + 1];
+            uint16_t msg_len = buf[off + 2] | (buf[off + 3] << 8);
+            uint8_t topic_len = buf[off + 4];
+            off += 5;
+            if(topic_len >= OUTBOX_TOPIC_MAX || msg_len > MSG_LEN_MAX || off + topic_len + msg_len > len){
+                break;
+            }
+            char topic[OUTBOX_TOPIC_MAX];
+            memcpy(topic, buf + off, topic_len);
+            topic[topic_len] = '\0';
+            off += topic_len;
+            __outbox_push(topic, buf + off, msg_len, qos, retain);
+            off += msg_len;
         }
-        
-        snprintf(full_topic, 128, "%s%s", g_mqtt_topic_prefix, topic);
-        cc_hal_mqtt_publish((cc_mqtt_t *)g_mqtt_handle, full_topic, (char *)data, len, qos, retain);
+        CC_LOGI(TAG, "outbox restored %d msg", g_outbox_count);
     }
+    heap_caps_free(buf);
+}
+
+void __mqtt_publish_task(uint32_t interval, void *arg){
+
+    uint32_t now_tm = cc_hal_sys_get_ms();
+    uint8_t sent = 0;
+    bool qos1_changed = false;
+
+    cc_hal_os_semphr_take(g_outbox_lock, CC_OS_MAX_DELAY);
+    uint8_t i = 0;
+    while(i < g_outbox_count){
+        _outbox_msg_t *msg = &g_outbox[g_outbox_order[i]];
+        if(msg->qos == GS_MQTT_QOS0 && now_tm - msg->tm > OUTBOX_QOS0_TTL_MS){
+            __outbox_remove_at(i);
+            continue;
+        }
+        if(g_mqtt_connect_status && sent < OUTBOX_DRAIN_BATCH){
+            if(__mqtt_publish_now(msg->topic, msg->data, msg->len, msg->qos, msg->retain) != CC_OK){
+                // 发布失败，保留等待下一周期
+                sent = OUTBOX_DRAIN_BATCH;
+                i++;
+                continue;
+            }
+            sent++;
+            qos1_changed |= msg->qos > GS_MQTT_QOS0;
+            __outbox_remove_at(i);
+            continue;
+        }
+        i++;
+    }
+    if(qos1_changed){
+        __outbox_persist();
+    }
+    if(g_outbox_count == 0){
+        cc_tmr_task_delete_handle(g_publish_task);
+        g_publish_task = CC_TMR_TASK_INVALID;
+    }
+    cc_hal_os_semphr_give(g_outbox_lock);
+}
+
+cc_err_t gs_mqtt_publish(const char *topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain){
+
+    if(g_mqtt_connect_status){
+        CC_LOGD(TAG, "gs_mqtt_publish topic: %s data: %.*s", topic, len, data);
+        return __mqtt_publish_now(topic, data, len, qos, retain);
+    }
+
+    CC_LOGW(TAG, "gs_mqtt not connect delay publish topic: %s data: %.*s", topic, len, data);
+    if(g_outbox == NULL){
+        CC_LOGE(TAG, "outbox not init");
+        return CC_FAIL;
+    }
+    if(len > MSG_LEN_MAX || strlen(topic) >= OUTBOX_TOPIC_MAX){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+        return CC_ERR_INVALID_ARG;
+    }
+
+    cc_hal_os_semphr_take(g_outbox_lock, CC_OS_MAX_DELAY);
+    if(__outbox_push(topic, data, len, qos, retain)){
+        __outbox_persist();
+    }
+    if(g_publish_task == CC_TMR_TASK_INVALID){
+        g_publish_task = cc_tmr_task_create_handle(__mqtt_publish_task, OUTBOX_DRAIN_PERIOD_MS, NULL);
+    }
+    cc_hal_os_semphr_give(g_outbox_lock);
 
     return CC_OK;
 }
 
-cc_err_t gs_mqtt_register_msg_cb(gs_mqtt_msg_cb_t cb){
+cc_err_t gs_mqtt_publish_iov(gs_mqtt_topic_t topic, const gs_mqtt_iov_t *iov, uint8_t iovcnt, uint8_t qos, uint8_t retain){
+    uint8_t buf[MSG_LEN_MAX];
+    uint8_t *data = NULL;
+    uint16_t len = 0;
+
+    if(topic >= g_topic_cnt || (iov == NULL && iovcnt)){
+        CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+        return CC_ERR_INVALID_ARG;
+    }
 
-    if(NULL == g_mqtt_msg_cb_list){
-        g_mqtt_msg_cb_list = cc_list_create(cb);
+    if(iovcnt == 1){
+        // 单段直接发送，不拷贝
+        data = (uint8_t *)iov[0].base;
+        len = iov[0].len;
     }else{
-        cc_list_insert_end(g_mqtt_msg_cb_list, cb);
+        for(uint8_t i = 0; i < iovcnt; i++){
+            if(len + iov[i].len > MSG_LEN_MAX){
+                CC_LOGE_CODE(TAG, CC_ERR_INVALID_ARG);
+                return CC_ERR_INVALID_ARG;
+            }
+            memcpy(buf + len, iov[i].base, iov[i].len);
+            len += iov[i].len;
+        }
+        data = buf;
     }
-    
+
+    if(g_mqtt_connect_status && g_topics[topic].full[0]){
+        return __mqtt_publish_full(g_topics[topic].full, data, len, qos, retain);
+    }
+    return gs_mqtt_publish(g_topics[topic].suffix, data, len, qos, retain);
+}
+
+cc_err_t gs_mqtt_register_topic_msg_cb(const char *topic, gs_mqtt_msg_cb_t cb){
+    if(NULL == cb){
+        return CC_ERR_INVALID_ARG;
+    }
+
+    cc_hal_os_enter_critical(&g_msg_cb_lock);
+    if(g_msg_cb_cnt >= MSG_CB_MAX){
+        cc_hal_os_exit_critical(&g_msg_cb_lock);
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        return CC_ERR_NO_MEM;
+    }
+    uint8_t idx = g_msg_cb_cnt++;
+    _msg_cb_entry_t *entry = &g_msg_cbs[idx];
+    uint8_t *head = &g_msg_cb_any;
+    entry->suffix = topic;
+    entry->cb = cb;
+    if(topic){
+        entry->suffix_len = strlen(topic);
+        entry->hash = __topic_hash(topic, entry->suffix_len);
+        head = &g_msg_cb_buckets[entry->hash & (MSG_CB_BUCKETS - 1)];
+    }
+    entry->next = *head;
+    __atomic_store_n(head, idx + 1, __ATOMIC_RELEASE);
+    cc_hal_os_exit_critical(&g_msg_cb_lock);
+
     return CC_OK;
 }
 
+cc_err_t gs_mqtt_register_msg_cb(gs_mqtt_msg_cb_t cb){
+    return gs_mqtt_register_topic_msg_cb(NULL, cb);
+}
+
 uint8_t gs_mqtt_connect_status(void){
     return g_mqtt_connect_status;
 }
@@ -453,9 +876,10 @@ cc_err_t gs_mqtt_start_connect(void){
             return CC_FAIL;
         }
 
-        sprintf(g_mqtt_topic_prefix, "/sys/%s/%s", product_key, device_name);
+        g_mqtt_topic_prefix_len = sprintf(g_mqtt_topic_prefix, "/sys/%s/%s", product_key, device_name);
+        __topics_resolve();
 
-        cc_mqtt_t *mqtt = cc_hal_sys_malloc(sizeof(cc_mqtt_t));
+        cc_mqtt_t *mqtt = cc_hal_sys_malloc_caps(sizeof(cc_mqtt_t), CC_MEM_CAP_DEFAULT, CC_MEM_MOD_APP);
         if(NULL == mqtt){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
             return CC_ERR_NO_MEM;
@@ -474,8 +898,17 @@ cc_err_t gs_mqtt_start_connect(void){
 
         g_mqtt_handle = mqtt;
 
+        // 在网络任务中调用，不等待；名额被占满时照常连接，控制通道不能因此断开
+        char host_port[CONN_MGR_HOST_LEN];
+        snprintf(host_port, sizeof(host_port), "%s:%d", mqtt->host, mqtt->port);
+        conn_mgr_attach(&g_mqtt_conn, NULL, host_port);
+        if(conn_mgr_lease(&g_mqtt_conn, CONN_PRIO_EVENT, 0) != ESP_OK){
+            CC_LOGW(TAG, "mqtt connects without a connection slot");
+        }
+
         if(cc_hal_mqtt_create(mqtt) != CC_OK){
             CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+            conn_mgr_detach(&g_mqtt_conn);
             g_mqtt_handle = NULL;
             cc_hal_sys_free(mqtt);
             return CC_ERR_NO_MEM;
@@ -485,6 +918,156 @@ cc_err_t gs_mqtt_start_connect(void){
     return CC_OK;
 }
 
+cc_err_t gs_mqtt_reconnect(void){
+    if(g_mqtt_handle == NULL){
+        return gs_mqtt_start_connect();
+    }
+    CC_LOGI(TAG, "mqtt reconnect");
+    return cc_hal_mqtt_reconnect(g_mqtt_handle);
+}
+
+static void __rpc_finish(_rpc_slot_t *slot){
+    // 在网络任务中调用，slot 已从表中摘下
+    if(slot->done){
+        slot->cb(slot->arg, slot->code, (uint8_t *)slot->body, slot->body_len);
+    }else if(slot->fallback_url){
+        CC_LOGW(TAG, "rpc %lu unanswered, fall back to http", slot->id);
+        cc_http_simple_get(slot->fallback_url, slot->cb, slot->arg);
+    }else{
+        slot->cb(slot->arg, -1, NULL, 0);
+    }
+    free(slot->fallback_url);
+    free(slot->body);
+}
+
+static void __rpc_task(uint32_t interval, void *arg){
+    _rpc_slot_t ready[RPC_SLOTS];
+    uint8_t ready_num = 0;
+    uint8_t pending = 0;
+    uint64_t now = cc_hal_sys_get_ms();
+
+    cc_hal_os_semphr_take(g_rpc_lock, CC_OS_MAX_DELAY);
+    for(uint8_t i = 0; i < RPC_SLOTS; i++){
+        _rpc_slot_t *slot = &g_rpc_slots[i];
+        if(slot->id == 0){
+            continue;
+        }
+        if(slot->done || now >= slot->deadline || !g_mqtt_connect_status){
+            ready[ready_num++] = *slot;
+            memset(slot, 0, sizeof(_rpc_slot_t));
+        }else{
+            pending++;
+        }
+    }
+    if(pending == 0){
+        cc_tmr_task_delete_handle(g_rpc_task);
+        g_rpc_task = CC_TMR_TASK_INVALID;
+    }
+    cc_hal_os_semphr_give(g_rpc_lock);
+
+    for(uint8_t i = 0; i < ready_num; i++){
+        __rpc_finish(&ready[i]);
+    }
+}
+
+// 在 MQTT 任务中回调
+static void __rpc_resp_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len){
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if(root == NULL){
+        CC_LOGE(TAG, "rpc response parse error");
+        return;
+    }
+    cJSON *id_obj = cJSON_GetObjectItem(root, "id");
+    cJSON *code_obj = cJSON_GetObjectItem(root, "code");
+    cJSON *body_obj = cJSON_GetObjectItem(root, "body");
+    if(!cJSON_IsNumber(id_obj) || body_obj == NULL){
+        CC_LOGE(TAG, "rpc response data error");
+        cJSON_Delete(root);
+        return;
+    }
+
+    char *body = cJSON_IsString(body_obj) ? strdup(body_obj->valuestring) : cJSON_PrintUnformatted(body_obj);
+    uint32_t id = (uint32_t)id_obj->valuedouble;
+    cc_hal_os_semphr_take(g_rpc_lock, CC_OS_MAX_DELAY);
+    for(uint8_t i = 0; i < RPC_SLOTS; i++){
+        _rpc_slot_t *slot = &g_rpc_slots[i];
+        if(slot->id == id && !slot->done && body){
+            slot->body = body;
+            slot->body_len = strlen(body);
+            slot->code = cJSON_IsNumber(code_obj) ? code_obj->valueint : 200;
+            slot->done = 1;
+            body = NULL;
+            break;
+        }
+    }
+    cc_hal_os_semphr_give(g_rpc_lock);
+    if(body){
+        // 已超时改走 HTTP 的请求，迟到的响应丢弃
+        CC_LOGD(TAG, "rpc %lu response dropped", id);
+        free(body);
+    }
+    cJSON_Delete(root);
+    cc_sched_wakeup();
+}
+
+cc_err_t gs_mqtt_rpc_call(const char *method, const char *params, const char *fallback_url,
+                          uint32_t timeout_ms, cc_http_req_cb_t cb, void *arg){
+    char buf[MSG_LEN_MAX];
+    _rpc_slot_t *slot = NULL;
+    uint32_t id;
+    int len;
+
+    if(method == NULL || cb == NULL){
+        return CC_ERR_INVALID_ARG;
+    }
+    if(!g_mqtt_connect_status || g_rpc_lock == NULL){
+        if(fallback_url){
+            return cc_http_simple_get((char *)fallback_url, cb, arg);
+        }
+        return CC_ERR_INVALID_STATE;
+    }
+
+    cc_hal_os_semphr_take(g_rpc_lock, CC_OS_MAX_DELAY);
+    for(uint8_t i = 0; i < RPC_SLOTS; i++){
+        if(g_rpc_slots[i].id == 0){
+            slot = &g_rpc_slots[i];
+            break;
+        }
+    }
+    if(slot == NULL){
+        cc_hal_os_semphr_give(g_rpc_lock);
+        CC_LOGW(TAG, "rpc slots full");
+        return fallback_url ? cc_http_simple_get((char *)fallback_url, cb, arg) : CC_ERR_NO_MEM;
+    }
+    if(++g_rpc_id == 0){
+        g_rpc_id = 1;
+    }
+    id = g_rpc_id;
+    memset(slot, 0, sizeof(_rpc_slot_t));
+    slot->id = id;
+    slot->deadline = cc_hal_sys_get_ms() + timeout_ms;
+    slot->cb = cb;
+    slot->arg = arg;
+    slot->fallback_url = fallback_url ? strdup(fallback_url) : NULL;
+    if(g_rpc_task == CC_TMR_TASK_INVALID){
+        g_rpc_task = cc_tmr_task_create_handle(__rpc_task, RPC_POLL_MS, NULL);
+    }
+    cc_hal_os_semphr_give(g_rpc_lock);
+
+    len = snprintf(buf, sizeof(buf), "{\"id\":%lu,\"method\":\"%s\",\"params\":%s}", id, method, params ? params : "{}");
+    if(len <= 0 || len >= (int)sizeof(buf) ||
+       gs_mqtt_publish(GS_MQTT_RPC_TOPIC_REQ, (uint8_t *)buf, (uint16_t)len, GS_MQTT_QOS0, 0) != CC_OK){
+        // 立即到期，由 __rpc_task 走 fallback
+        cc_hal_os_semphr_take(g_rpc_lock, CC_OS_MAX_DELAY);
+        if(slot->id == id){
+            slot->deadline = 0;
+        }
+        cc_hal_os_semphr_give(g_rpc_lock);
+    }
+    CC_LOGD(TAG, "rpc %lu %s", id, method);
+    return CC_OK;
+}
+
 cc_err_t gs_mqtt_init(void){
 
     size_t len = 0;
@@ -502,8 +1085,38 @@ cc_err_t gs_mqtt_init(void){
         g_mqtt_config.port = 1883;
     }else{
         CC_LOGI(TAG, "read mqtt config %s:%d", g_mqtt_config.host, g_mqtt_config.port);
+        cc_hal_dns_prefetch((char *)g_mqtt_config.host);
+    }
+    // 对时、broker 查询的 HTTP 兜底接口，拿到 IP 后即预解析
+    cc_hal_dns_prefetch(GS_MQTT_API_HOST);
+
+    uint8_t fmt = GS_MQTT_FMT_JSON;
+    len = sizeof(fmt);
+    if(cc_hal_kvs_get(FMT_KVS_KEY, &fmt, &len) == CC_OK && fmt == GS_MQTT_FMT_CBOR){
+        g_payload_fmt = GS_MQTT_FMT_CBOR;
+    }
+
+    g_outbox_lock = cc_hal_os_semphr_create_mutex();
+    g_outbox = heap_caps_calloc(OUTBOX_SLOTS, sizeof(_outbox_msg_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if(g_outbox_lock == NULL || g_outbox == NULL){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+    }else{
+        cc_hal_os_semphr_take(g_outbox_lock, CC_OS_MAX_DELAY);
+        __outbox_restore();
+        if(g_outbox_count){
+            g_publish_task = cc_tmr_task_create_handle(__mqtt_publish_task, OUTBOX_DRAIN_PERIOD_MS, NULL);
+        }
+        cc_hal_os_semphr_give(g_outbox_lock);
+    }
+
+    g_rpc_lock = cc_hal_os_semphr_create_mutex();
+    if(g_rpc_lock == NULL){
+        CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
     }
+    gs_mqtt_register_topic_msg_cb(GS_MQTT_RPC_TOPIC_RESP, __rpc_resp_cb);
 
+    // 连接状态事件不排在 OTA 进度等事件之后
+    cc_event_set_base_prio(GS_MQTT_EVENT, CC_EVENT_PRIO_HIGH);
     cc_event_register_handler(GS_WIFI_EVENT, __event_handler);
     cc_event_register_handler(GS_BIND_EVENT, __event_handler);
     cc_event_register_handler(GS_DEVICE_EVENT, __event_handler);
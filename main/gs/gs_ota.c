@@ -1,28 +1,221 @@
 #include "gs_ota.h"
 
+#include <stdio.h>
 #include <string.h>
+#include <stdlib.h>
 
 #include "cc_log.h"
 #include "cc_hal_sys.h"
 #include "cc_hal_ota.h"
 #include "cc_hal_os.h"
+#include "cc_hal_kvs.h"
 #include "cc_timer.h"
 
 #include "http_client.h"
+#include "conn_mgr.h"
+
+#include "gs_ota_unpack.h"
 
 static char *TAG = "gs_ota";
 
 CC_EVENT_DEFINE_BASE(GS_OTA_EVENT);
 
-static char g_ota_ing = 0; 
-static char g_ota_url[256] = ""; 
-static int g_update_idx = 0;
-static cc_err_t g_hal_ota_err = CC_FAIL;
+// 接收与写 flash 重叠：接收回调把数据拷入块中，写满后交给写任务，另一块继续接收
+#define GS_OTA_BLOCK_SIZE       CC_HAL_OTA_SECTOR_SIZE  // 块与扇区对齐，断点总落在扇区边界
+#define GS_OTA_BLOCK_NUM        2
+#define GS_OTA_RESUME_STEP      (16 * GS_OTA_BLOCK_SIZE) // 每写入 64 KiB 保存一次断点
+#define GS_OTA_RESUME_KEY       "gs_ota_resume"
+#define GS_OTA_RETRY_MAX        3
+#define GS_OTA_RECV_BUF_SIZE    2048
+#define GS_OTA_LEASE_MS         60000   // 等待连接名额，门锁事件上传期间 OTA 让路
+
+// 断点记录：同一镜像（URL 去掉查询串后相同且总长一致）写入同一分区时才续传
+typedef struct{
+    uint32_t url_hash;
+    uint32_t part_id;
+    uint32_t total;
+    uint32_t offset;        // 已写入 flash 的长度，扇区对齐
+}_ota_resume_t;
+
+typedef struct{
+    uint8_t *buf;
+    uint32_t off;
+    uint16_t len;           // 0 表示结束标记
+}_ota_block_t;
+
+static char g_ota_ing = 0;
+static char g_ota_url[256] = "";
+static conn_mgr_conn_t g_ota_conn = CONN_MGR_CONN_INIT("ota");    // 下载不经 esp_http_client，只占名额
+static volatile cc_err_t g_hal_ota_err = CC_FAIL;
+
+static _ota_block_t g_blocks[GS_OTA_BLOCK_NUM];
+static _ota_block_t *g_fill = NULL;         // 正在接收的块
+static uint8_t g_fill_idx = 0;
+static cc_os_semphr_handle_t g_free_sem = NULL;
+static cc_os_semphr_handle_t g_full_sem = NULL;
+static cc_os_semphr_handle_t g_writer_done = NULL;
+
+static _ota_resume_t g_resume = {0};
+static volatile uint32_t g_written = 0;     // 写任务已写入 flash 的位置
+static uint32_t g_recv_off = 0;             // 下一个接收字节在下载文件中的位置
+static uint32_t g_out_off = 0;              // 下一个镜像字节的位置，原始镜像时与 g_recv_off 相同
+static uint8_t g_packed = 0;                // 下载的是压缩/差分升级包，见 gs_ota_unpack.h
+static uint32_t g_total = 0;
+static uint32_t g_skip = 0;                 // 服务器忽略 Range 时丢弃的已写入部分
+static uint8_t g_response_checked = 0;
+static uint8_t g_data_started = 0;
+static char g_range_hdr[40];
 
 static void __timer_cb_for_reboot(void *arg){
     cc_hal_sys_reboot();
 }
 
+static uint32_t __url_hash(const char *url){
+    uint32_t hash = 2166136261u;
+    for(; *url && *url != '?'; url++){
+        hash = (hash ^ (uint8_t)*url) * 16777619u;
+    }
+    return hash;
+}
+
+static void __resume_save(uint32_t offset){
+    g_resume.offset = offset;
+    cc_hal_kvs_set(GS_OTA_RESUME_KEY, &g_resume, sizeof(g_resume));
+}
+
+static void __ota_writer_task(void *arg){
+    uint8_t idx = 0;
+
+    while(1){
+        cc_hal_os_semphr_take(g_full_sem, CC_OS_MAX_DELAY);
+        _ota_block_t *block = &g_blocks[idx];
+        idx = (idx + 1) % GS_OTA_BLOCK_NUM;
+        if(block->len == 0){
+            break;
+        }
+
+        if(g_hal_ota_err == CC_OK){
+            g_hal_ota_err = cc_hal_ota_update(block->off, block->buf, block->len);
+            if(g_hal_ota_err == CC_OK){
+                g_written = block->off + block->len;
+                // 升级包的解码状态无法从 flash 恢复，只有原始镜像保存断点
+                if(!g_packed && g_written % GS_OTA_BLOCK_SIZE == 0 && g_written - g_resume.offset >= GS_OTA_RESUME_STEP){
+                    __resume_save(g_written);
+                }
+            }
+        }
+        cc_hal_os_semphr_give(g_free_sem);
+    }
+
+    // 结束标记所在的块也交还，下一次升级时两块都空闲
+    cc_hal_os_semphr_give(g_free_sem);
+    cc_hal_os_semphr_give(g_writer_done);
+    cc_hal_os_task_delete(NULL);
+}
+
+// 取一个空闲块，写任务来不及时在此等待，TCP 接收随之放缓
+static _ota_block_t *__block_get(void){
+    cc_hal_os_semphr_take(g_free_sem, CC_OS_MAX_DELAY);
+    _ota_block_t *block = &g_blocks[g_fill_idx];
+    g_fill_idx = (g_fill_idx + 1) % GS_OTA_BLOCK_NUM;
+    block->off = g_out_off;
+    block->len = 0;
+    return block;
+}
+
+static void __block_submit(_ota_block_t *block){
+    cc_hal_os_semphr_give(g_full_sem);
+    if(block == g_fill){
+        g_fill = NULL;
+    }
+}
+
+// 等已提交的块全部写完（接收回调或下载任务中调用）
+static void __writer_wait_idle(void){
+    int num = g_fill ? GS_OTA_BLOCK_NUM - 1 : GS_OTA_BLOCK_NUM;
+    for(int i = 0; i < num; i++){
+        cc_hal_os_semphr_take(g_free_sem, CC_OS_MAX_DELAY);
+    }
+    for(int i = 0; i < num; i++){
+        cc_hal_os_semphr_give(g_free_sem);
+    }
+}
+
+// 放弃从头下载：等写任务空闲后从 0 开始覆盖
+static void __restart_from_zero(uint32_t total){
+    __writer_wait_idle();
+    g_recv_off = 0;
+    g_out_off = 0;
+    g_written = 0;
+    if(g_fill){
+        g_fill->off = 0;
+        g_fill->len = 0;
+    }
+    g_total = total;
+    g_resume.total = total;
+    g_resume.offset = 0;
+    g_hal_ota_err = cc_hal_ota_begin_at(0);
+}
+
+// 解析 "bytes 4096-999999/1000000"
+static cc_err_t __parse_content_range(http_client_data_t *client_data, uint32_t *start, uint32_t *total){
+    const char *value = NULL;
+    int value_len = 0;
+    char buf[48];
+
+    if(http_client_get_header(client_data, "Content-Range", &value, &value_len) != 0 || value_len >= (int)sizeof(buf)){
+        return CC_FAIL;
+    }
+    memcpy(buf, value, value_len);
+    buf[value_len] = '\0';
+
+    char *p = strstr(buf, "bytes ");
+    char *slash = strchr(buf, '/');
+    if(p == NULL || slash == NULL){
+        return CC_FAIL;
+    }
+    *start = strtoul(p + 6, NULL, 10);
+    *total = strtoul(slash + 1, NULL, 10);
+    return CC_OK;
+}
+
+// 收到响应头后的第一次回调：确认服务器是否按 Range 返回，决定续传、跳过或从头开始
+static cc_err_t __check_response(http_client_t *client, http_client_data_t *client_data){
+    int code = http_client_get_response_code(client);
+    uint32_t content_len = client_data->response_content_len;
+
+    if(code == 206){
+        uint32_t start = 0, total = 0;
+        if(__parse_content_range(client_data, &start, &total) != CC_OK || start != g_recv_off || total == 0){
+            CC_LOGE(TAG, "bad Content-Range for offset %d", g_recv_off);
+            return CC_FAIL;
+        }
+        if(g_resume.total && total != g_resume.total){
+            // 同一 URL 换了镜像，下一次请求从头下载
+            CC_LOGW(TAG, "image size changed %d -> %d, restart", g_resume.total, total);
+            __restart_from_zero(total);
+            return CC_FAIL;
+        }
+        g_total = total;
+    }else if(code == 200 && content_len > 0){
+        if(g_recv_off && content_len == g_resume.total){
+            CC_LOGW(TAG, "server ignored Range, skip %d bytes", g_recv_off);
+            g_skip = g_recv_off;
+        }else if(g_recv_off){
+            CC_LOGW(TAG, "image size changed %d -> %d, restart", g_resume.total, content_len);
+            __restart_from_zero(content_len);
+        }
+        g_total = content_len;
+    }else{
+        CC_LOGE(TAG, "http response %d, length %d", code, content_len);
+        return CC_FAIL;
+    }
+
+    g_resume.total = g_total;
+    g_response_checked = 1;
+    return CC_OK;
+}
+
 static void __event_cb(http_client_t *client, HTTP_EVENT event, void *data){
 
     switch (event)
@@ -41,6 +234,28 @@ static void __event_cb(http_client_t *client, HTTP_EVENT event, void *data){
     }
 }
 
+// 镜像数据拷入块中，写满一块交给写任务；也是升级包解码的输出
+static cc_err_t __push_image(const uint8_t *data, uint32_t len){
+    while(len){
+        if(g_fill == NULL){
+            g_fill = __block_get();
+        }
+        uint32_t n = GS_OTA_BLOCK_SIZE - g_fill->len;
+        if(n > len){
+            n = len;
+        }
+        memcpy(g_fill->buf + g_fill->len, data, n);
+        g_fill->len += n;
+        g_out_off += n;
+        data += n;
+        len -= n;
+        if(g_fill->len == GS_OTA_BLOCK_SIZE){
+            __block_submit(g_fill);
+        }
+    }
+    return g_hal_ota_err;
+}
+
 static HTTPC_RESULT __recv_cb(http_client_t *client, http_client_data_t *client_data){
 
     static uint8_t last_progress = 101;
@@ -48,57 +263,151 @@ static HTTPC_RESULT __recv_cb(http_client_t *client, http_client_data_t *client_
     if(g_hal_ota_err != CC_OK){
         return HTTP_EUNKOWN;
     }
-    
-    uint32_t progress = ((client_data->response_content_len - client_data->retrieve_len) *100)/client_data->response_content_len;
-    if(last_progress != progress){
-        if(g_update_idx == 0 && progress == 100){
+    if(!g_response_checked && __check_response(client, client_data) != CC_OK){
+        return HTTP_EUNKOWN;
+    }
+
+    const uint8_t *data = (const uint8_t *)client_data->response_buf;
+    uint32_t len = client_data->response_len;
+
+    if(g_skip){
+        uint32_t n = len < g_skip ? len : g_skip;
+        data += n;
+        len -= n;
+        g_skip -= n;
+    }
+    if(g_recv_off + len > g_total){
+        CC_LOGE(TAG, "body longer than %d", g_total);
+        return HTTP_EUNKOWN;
+    }
+
+    // 从头下载时按第一个字节区分原始镜像和升级包
+    if(g_recv_off == 0 && len){
+        g_packed = gs_ota_unpack_is_packed(data[0]);
+        if(g_packed && gs_ota_unpack_begin(__push_image) != CC_OK){
+            g_hal_ota_err = CC_ERR_NO_MEM;
             return HTTP_EUNKOWN;
         }
+    }
+
+    if(g_packed){
+        cc_err_t err = gs_ota_unpack_feed(data, len);
+        if(err != CC_OK){
+            // 包内容有误，重试也无用
+            g_hal_ota_err = err;
+            return HTTP_EUNKOWN;
+        }
+    }else{
+        __push_image(data, len);
+    }
+    g_recv_off += len;
 
+    uint32_t progress = (uint32_t)(((uint64_t)g_recv_off * 100) / g_total);
+    if(last_progress != progress){
         CC_LOGI(TAG, "ota progress: %d", progress);
         last_progress = progress;
-        if(progress == 0){
+        if(!g_data_started){
+            g_data_started = 1;
             cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_GET_DTAT_START, NULL, 0);
         }
         cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_GET_DTAT_PROGRESS, (void *)&progress, sizeof(progress));
         if(progress == 100){
-            cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_GET_DTAT_FINISH, NULL, 0); 
+            cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_GET_DTAT_FINISH, NULL, 0);
         }
     }
 
-    g_hal_ota_err = cc_hal_ota_update(g_update_idx, (uint8_t *)client_data->response_buf, client_data->response_len);
-    if(g_hal_ota_err != CC_OK){
-        return HTTP_EUNKOWN;
-    }
-
-    g_update_idx += client_data->response_len;
-
-    return HTTP_SUCCESS;
+    return g_hal_ota_err == CC_OK ? HTTP_SUCCESS : HTTP_EUNKOWN;
 }
 
 static void __connect_cb(http_client_t *client){
-   
+
 }
 
 static void __close_cb(http_client_t *client){
 
 }
 
+static cc_err_t __ota_prepare(void){
+    uint8_t *buf = cc_hal_sys_malloc_caps(GS_OTA_BLOCK_SIZE * GS_OTA_BLOCK_NUM, CC_MEM_CAP_INTERNAL, CC_MEM_MOD_APP);
+    if(buf == NULL){
+        return CC_ERR_NO_MEM;
+    }
+    for(int i = 0; i < GS_OTA_BLOCK_NUM; i++){
+        g_blocks[i].buf = buf + i * GS_OTA_BLOCK_SIZE;
+    }
+    g_fill = NULL;
+    g_fill_idx = 0;
+
+    if(g_free_sem == NULL){
+        g_free_sem = cc_hal_os_semphr_create_counting(GS_OTA_BLOCK_NUM, GS_OTA_BLOCK_NUM);
+        g_full_sem = cc_hal_os_semphr_create_counting(GS_OTA_BLOCK_NUM, 0);
+        g_writer_done = cc_hal_os_semphr_create_binary();
+    }
+    if(g_free_sem == NULL || g_full_sem == NULL || g_writer_done == NULL){
+        cc_hal_sys_free(buf);
+        return CC_ERR_NO_MEM;
+    }
+    if(cc_hal_os_task_create(__ota_writer_task, "__ota_writer", 3072, NULL, 4, NULL) != CC_OK){
+        cc_hal_sys_free(buf);
+        return CC_ERR_NO_MEM;
+    }
+    return CC_OK;
+}
+
+// 交出最后一个不满的块（补齐到 16 字节，兼容 flash 加密）和结束标记，等写任务退出
+static void __ota_finish(uint8_t complete){
+    if(g_fill && g_fill->len && complete){
+        uint16_t pad = (16 - (g_fill->len & 15)) & 15;
+        memset(g_fill->buf + g_fill->len, 0xFF, pad);
+        g_fill->len += pad;
+        __block_submit(g_fill);
+    }
+    _ota_block_t *end = g_fill ? g_fill : __block_get();
+    end->len = 0;
+    __block_submit(end);
+    cc_hal_os_semphr_take(g_writer_done, CC_OS_MAX_DELAY);
+
+    cc_hal_sys_free(g_blocks[0].buf);
+}
+
 void __ota_http_task(void *arg){
     http_client_t http_client = {0};
     http_client_data_t client_data = {0};
     http_client_cb_t client_cb = {0};
+    HTTPC_RESULT status = HTTP_EUNKOWN;
 
     CC_LOGI(TAG, "ota_begin");
-    g_update_idx = 0;
-    g_hal_ota_err = cc_hal_ota_begin();
 
-    client_data.response_buf = cc_hal_sys_malloc(2048 + 1);
-    if(client_data.response_buf == NULL){
+    // 同一镜像、同一目标分区的断点才有效
+    size_t len = sizeof(g_resume);
+    _ota_resume_t saved = {0};
+    uint32_t url_hash = __url_hash(g_ota_url);
+    uint32_t part_id = cc_hal_ota_next_partition_id();
+    if(cc_hal_kvs_get(GS_OTA_RESUME_KEY, &saved, &len) == CC_OK && len == sizeof(saved)
+        && saved.url_hash == url_hash && saved.part_id == part_id && saved.offset < saved.total
+        && saved.offset % GS_OTA_BLOCK_SIZE == 0){
+        g_resume = saved;
+        CC_LOGI(TAG, "resume from %d/%d", g_resume.offset, g_resume.total);
+    }else{
+        g_resume = (_ota_resume_t){ .url_hash = url_hash, .part_id = part_id };
+    }
+
+    g_recv_off = g_out_off = g_written = g_resume.offset;
+    g_total = g_resume.total;
+    g_packed = 0;
+    g_data_started = 0;
+    g_hal_ota_err = cc_hal_ota_begin_at(g_resume.offset);
+
+    client_data.response_buf = cc_hal_sys_malloc_caps(GS_OTA_RECV_BUF_SIZE + 1, CC_MEM_CAP_SPIRAM, CC_MEM_MOD_APP);
+    if(client_data.response_buf == NULL || __ota_prepare() != CC_OK){
         CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+        cc_hal_sys_free(client_data.response_buf);
+        cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_FAIL, NULL, 0);
+        g_ota_ing = 0;
+        cc_hal_os_task_delete(NULL);
         return;
     }
-    client_data.response_buf_len = 2048 + 1;
+    client_data.response_buf_len = GS_OTA_RECV_BUF_SIZE + 1;
 
     client_cb.event_cb = __event_cb;
     client_cb.connect_cb = __connect_cb;
@@ -107,16 +416,70 @@ void __ota_http_task(void *arg){
 
     cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_HTTP_START, NULL, 0);
 
-    HTTPC_RESULT status = http_client_get_request(&http_client, g_ota_url, &client_data, &client_cb);
-    if(status != HTTP_SUCCESS && status != HTTP_EAGAIN){
-        CC_LOGE_CODE(TAG, CC_FAIL);
+    conn_mgr_attach(&g_ota_conn, NULL, g_ota_url);
+    int leased = conn_mgr_lease(&g_ota_conn, CONN_PRIO_BULK, GS_OTA_LEASE_MS) == ESP_OK;
+    if(!leased){
+        CC_LOGE(TAG, "no connection slot for download");
+    }
+    for(int retry = 0; leased && retry < GS_OTA_RETRY_MAX && g_hal_ota_err == CC_OK; retry++){
+        g_response_checked = 0;
+        g_skip = 0;
+        if(g_recv_off){
+            snprintf(g_range_hdr, sizeof(g_range_hdr), "Range: bytes=%u-\r\n", (unsigned)g_recv_off);
+            http_client_set_custom_header(&http_client, g_range_hdr);
+        }else{
+            http_client_set_custom_header(&http_client, NULL);
+        }
+
         status = http_client_get_request(&http_client, g_ota_url, &client_data, &client_cb);
+        if(g_total && g_recv_off == g_total && (status == HTTP_SUCCESS || status == HTTP_EAGAIN)){
+            status = HTTP_SUCCESS;
+            break;
+        }
+        CC_LOGE(TAG, "download stopped at %d/%d (%d), retry", g_recv_off, g_total, status);
+        status = HTTP_EUNKOWN;
+        // 原始镜像丢弃不满的块，下次从块边界（扇区边界）续传；
+        // 升级包的解码状态还在内存中，从断开处的字节继续
+        if(g_fill && !g_packed){
+            g_recv_off = g_out_off = g_fill->off;
+            g_fill->len = 0;
+        }
     }
+    conn_mgr_return(&g_ota_conn, false);
+
+    uint32_t image_size = g_total;
+    if(status == HTTP_SUCCESS && g_packed){
+        cc_err_t err = gs_ota_unpack_finish();
+        if(err != CC_OK){
+            g_hal_ota_err = err;
+            status = HTTP_EUNKOWN;
+        }
+        image_size = gs_ota_unpack_out_size();
+        CC_LOGI(TAG, "unpacked %d bytes from %d", image_size, g_total);
+    }
+
+    __ota_finish(status == HTTP_SUCCESS);
+    gs_ota_unpack_end();
+    cc_hal_sys_free(client_data.response_buf);
 
     CC_LOGI(TAG, "ota_end");
-    g_hal_ota_err = cc_hal_ota_end();
+    if(status == HTTP_SUCCESS && g_hal_ota_err == CC_OK && g_written >= image_size){
+        g_hal_ota_err = cc_hal_ota_end();
+        // 成功或镜像校验失败都不再续传
+        cc_hal_kvs_del(GS_OTA_RESUME_KEY);
+    }else{
+        if(g_hal_ota_err == CC_OK){
+            g_hal_ota_err = CC_FAIL;
+            if(!g_packed && g_written / GS_OTA_BLOCK_SIZE * GS_OTA_BLOCK_SIZE > g_resume.offset){
+                __resume_save(g_written / GS_OTA_BLOCK_SIZE * GS_OTA_BLOCK_SIZE);
+            }
+        }else{
+            // 写 flash 失败，断点之后的内容不可信
+            cc_hal_kvs_del(GS_OTA_RESUME_KEY);
+        }
+    }
 
-    if(status == HTTP_SUCCESS && g_hal_ota_err == CC_OK){
+    if(g_hal_ota_err == CC_OK){
         cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_SUCCESS, NULL, 0);
     }else{
         cc_event_post(GS_OTA_EVENT, GS_OTA_EVENT_FAIL, NULL, 0);
@@ -153,13 +516,13 @@ cc_err_t gs_ota_for_http(char *url){
     for (size_t i = 0; i < strlen(g_ota_url); i++){
         if(g_ota_url[i] == ' '){
             g_ota_url[i] = '&';
-        } 
+        }
     }
-    
+
     cc_hal_os_task_create(__ota_http_task, "__ota_task", 4096, NULL, 4, NULL);
     return CC_OK;
 }
 
 cc_err_t gs_ota_init(void){
     return CC_OK;
-}
\ No newline at end of file
+}
@@ -0,0 +1,380 @@
+#include "gs_ota_unpack.h"
+
+#include <string.h>
+
+#include "cc_log.h"
+#include "cc_hal_sys.h"
+#include "cc_hal_ota.h"
+
+static char *TAG = "gs_ota_unpack";
+
+#define __OUT_BUF_SIZE      256
+#define __SRC_BUF_SIZE      256
+
+#define __TYPE_FULL         0
+#define __TYPE_DELTA        1
+#define __COMPRESS_NONE     0
+#define __COMPRESS_HS       1
+
+// heatshrink 解码状态：标志位 1 为字面量（8 位），0 为回溯引用（window 位距离、lookahead 位长度，均减 1 存储）
+typedef enum{
+    __HS_TAG = 0,
+    __HS_LITERAL,
+    __HS_INDEX,
+    __HS_COUNT,
+}_hs_state_t;
+
+// 差分控制序列的解析状态
+typedef enum{
+    __PATCH_DIFF_LEN = 0,
+    __PATCH_DIFF,
+    __PATCH_EXTRA_LEN,
+    __PATCH_EXTRA,
+    __PATCH_ADJUST,
+}_patch_state_t;
+
+typedef struct{
+    uint8_t type;
+    uint8_t compress;
+    uint8_t window;
+    uint8_t lookahead;
+    uint32_t out_size;
+    uint32_t src_size;
+}_pack_info_t;
+
+static gs_ota_unpack_out_cb_t g_out_cb = NULL;
+static cc_err_t g_err = CC_OK;
+
+static uint8_t g_header[GS_OTA_PACK_HEADER_SIZE];
+static uint8_t g_header_len = 0;
+static _pack_info_t g_info = {0};
+
+static uint8_t *g_window = NULL;
+static uint16_t g_window_mask = 0;
+static uint16_t g_window_head = 0;
+static _hs_state_t g_hs_state = __HS_TAG;
+static uint8_t g_hs_need = 1;
+static uint8_t g_hs_got = 0;
+static uint16_t g_hs_acc = 0;
+static uint16_t g_hs_index = 0;
+
+static _patch_state_t g_patch_state = __PATCH_DIFF_LEN;
+static uint32_t g_patch_varint = 0;
+static uint8_t g_patch_shift = 0;
+static uint32_t g_patch_remain = 0;
+static uint32_t g_src_pos = 0;
+static uint8_t *g_src_buf = NULL;
+static uint32_t g_src_buf_off = 0;
+static uint32_t g_src_buf_len = 0;
+
+static uint8_t *g_out_buf = NULL;
+static uint16_t g_out_len = 0;
+static uint32_t g_out_total = 0;
+
+static uint32_t __get_le32(const uint8_t *p){
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static void __out_flush(void){
+    if(g_out_len && g_err == CC_OK){
+        g_err = g_out_cb(g_out_buf, g_out_len);
+    }
+    g_out_len = 0;
+}
+
+// 还原后的镜像字节
+static void __out_byte(uint8_t c){
+    if(g_out_total >= g_info.out_size){
+        CC_LOGE(TAG, "output longer than %d", g_info.out_size);
+        g_err = CC_ERR_INVALID_SIZE;
+        return;
+    }
+    g_out_buf[g_out_len++] = c;
+    g_out_total++;
+    if(g_out_len == __OUT_BUF_SIZE){
+        __out_flush();
+    }
+}
+
+// 旧镜像按顺序读取，缓存一段减少 flash 读次数
+static cc_err_t __src_byte(uint8_t *c){
+    if(g_src_pos >= g_info.src_size){
+        CC_LOGE(TAG, "source offset 0x%x out of range", g_src_pos);
+        return CC_ERR_INVALID_SIZE;
+    }
+    if(g_src_pos < g_src_buf_off || g_src_pos >= g_src_buf_off + g_src_buf_len){
+        uint32_t len = g_info.src_size - g_src_pos;
+        if(len > __SRC_BUF_SIZE){
+            len = __SRC_BUF_SIZE;
+        }
+        if(cc_hal_ota_read_running(g_src_pos, g_src_buf, len) != CC_OK){
+            return CC_FAIL;
+        }
+        g_src_buf_off = g_src_pos;
+        g_src_buf_len = len;
+    }
+    *c = g_src_buf[g_src_pos - g_src_buf_off];
+    g_src_pos++;
+    return CC_OK;
+}
+
+// 读 LEB128，返回 1 表示读完一个整数
+static uint8_t __patch_varint(uint8_t c){
+    if(g_patch_shift >= 32){
+        g_err = CC_ERR_INVALID_ARG;
+        return 0;
+    }
+    g_patch_varint |= (uint32_t)(c & 0x7F) << g_patch_shift;
+    g_patch_shift += 7;
+    if(c & 0x80){
+        return 0;
+    }
+    g_patch_remain = g_patch_varint;
+    g_patch_varint = 0;
+    g_patch_shift = 0;
+    return 1;
+}
+
+// 差分控制序列的一个字节；长度为 0 的段直接跳到下一状态
+static void __patch_byte(uint8_t c){
+    uint8_t src = 0;
+
+    switch (g_patch_state)
+    {
+    case __PATCH_DIFF_LEN:
+        if(__patch_varint(c)){
+            g_patch_state = g_patch_remain ? __PATCH_DIFF : __PATCH_EXTRA_LEN;
+        }
+        break;
+    case __PATCH_DIFF:
+        g_err = __src_byte(&src);
+        if(g_err == CC_OK){
+            __out_byte(src + c);
+        }
+        if(--g_patch_remain == 0){
+            g_patch_state = __PATCH_EXTRA_LEN;
+        }
+        break;
+    case __PATCH_EXTRA_LEN:
+        if(__patch_varint(c)){
+            g_patch_state = g_patch_remain ? __PATCH_EXTRA : __PATCH_ADJUST;
+        }
+        break;
+    case __PATCH_EXTRA:
+        __out_byte(c);
+        if(--g_patch_remain == 0){
+            g_patch_state = __PATCH_ADJUST;
+        }
+        break;
+    case __PATCH_ADJUST:
+        if(__patch_varint(c)){
+            // zigzag
+            int32_t adjust = (int32_t)(g_patch_remain >> 1) ^ -(int32_t)(g_patch_remain & 1);
+            g_src_pos += adjust;
+            g_patch_state = __PATCH_DIFF_LEN;
+        }
+        break;
+    default:
+        break;
+    }
+}
+
+// 解压（或未压缩）后的数据
+static void __stream_byte(uint8_t c){
+    if(g_info.type == __TYPE_DELTA){
+        __patch_byte(c);
+    }else{
+        __out_byte(c);
+    }
+}
+
+static void __hs_emit(uint8_t c){
+    g_window[g_window_head & g_window_mask] = c;
+    g_window_head++;
+    __stream_byte(c);
+}
+
+static void __hs_bit(uint8_t bit){
+    g_hs_acc = (g_hs_acc << 1) | bit;
+    if(++g_hs_got < g_hs_need){
+        return;
+    }
+    uint16_t value = g_hs_acc;
+    g_hs_acc = 0;
+    g_hs_got = 0;
+
+    switch (g_hs_state)
+    {
+    case __HS_TAG:
+        g_hs_state = value ? __HS_LITERAL : __HS_INDEX;
+        g_hs_need = value ? 8 : g_info.window;
+        break;
+    case __HS_LITERAL:
+        __hs_emit((uint8_t)value);
+        g_hs_state = __HS_TAG;
+        g_hs_need = 1;
+        break;
+    case __HS_INDEX:
+        g_hs_index = value + 1;
+        g_hs_state = __HS_COUNT;
+        g_hs_need = g_info.lookahead;
+        break;
+    case __HS_COUNT:
+        // 逐字节复制，距离小于长度时自然重复
+        for(uint32_t i = 0; i < (uint32_t)value + 1 && g_err == CC_OK; i++){
+            __hs_emit(g_window[(uint16_t)(g_window_head - g_hs_index) & g_window_mask]);
+        }
+        g_hs_state = __HS_TAG;
+        g_hs_need = 1;
+        break;
+    default:
+        break;
+    }
+}
+
+static cc_err_t __header_parse(void){
+    const uint8_t *h = g_header;
+
+    if(memcmp(h, GS_OTA_PACK_MAGIC, 4) != 0 || h[4] != 1){
+        CC_LOGE(TAG, "unsupported package %02x %02x %02x %02x v%d", h[0], h[1], h[2], h[3], h[4]);
+        return CC_ERR_INVALID_ARG;
+    }
+    g_info.type = h[5];
+    g_info.compress = h[6];
+    g_info.window = h[7];
+    g_info.lookahead = h[8];
+    g_info.out_size = __get_le32(h + 12);
+    g_info.src_size = __get_le32(h + 16);
+
+    if(g_info.type > __TYPE_DELTA || g_info.compress > __COMPRESS_HS || g_info.out_size == 0){
+        CC_LOGE(TAG, "bad package type %d compress %d size %d", g_info.type, g_info.compress, g_info.out_size);
+        return CC_ERR_INVALID_ARG;
+    }
+    if(g_info.compress == __COMPRESS_HS && (g_info.window < 4 || g_info.window > GS_OTA_UNPACK_WINDOW_MAX
+        || g_info.lookahead < 3 || g_info.lookahead >= g_info.window)){
+        CC_LOGE(TAG, "heatshrink -w %d -l %d not supported", g_info.window, g_info.lookahead);
+        return CC_ERR_INVALID_ARG;
+    }
+
+    if(g_info.type == __TYPE_DELTA){
+        uint8_t sha256[32];
+        uint8_t c;
+        if(g_info.src_size == 0 || cc_hal_ota_running_sha256(sha256) != CC_OK || memcmp(sha256, h + 20, 32) != 0){
+            CC_LOGE(TAG, "delta base is not the running image");
+            return CC_ERR_INVALID_ARG;
+        }
+        if(cc_hal_ota_read_running(g_info.src_size - 1, &c, 1) != CC_OK){
+            return CC_ERR_INVALID_SIZE;
+        }
+        g_src_buf = cc_hal_sys_malloc_caps(__SRC_BUF_SIZE, CC_MEM_CAP_INTERNAL, CC_MEM_MOD_APP);
+        if(g_src_buf == NULL){
+            return CC_ERR_NO_MEM;
+        }
+    }
+    if(g_info.compress == __COMPRESS_HS){
+        g_window = cc_hal_sys_malloc_caps(1 << g_info.window, CC_MEM_CAP_INTERNAL, CC_MEM_MOD_APP);
+        if(g_window == NULL){
+            return CC_ERR_NO_MEM;
+        }
+        // 编码器的初始窗口为全 0
+        memset(g_window, 0, 1 << g_info.window);
+        g_window_mask = (1 << g_info.window) - 1;
+    }
+
+    CC_LOGI(TAG, "%s image %d bytes, heatshrink %d/%d", g_info.type == __TYPE_DELTA ? "delta" : "full",
+            g_info.out_size, g_info.compress ? g_info.window : 0, g_info.compress ? g_info.lookahead : 0);
+    return CC_OK;
+}
+
+uint8_t gs_ota_unpack_is_packed(uint8_t first_byte){
+    return first_byte == (uint8_t)GS_OTA_PACK_MAGIC[0];
+}
+
+cc_err_t gs_ota_unpack_begin(gs_ota_unpack_out_cb_t out_cb){
+    gs_ota_unpack_end();
+
+    g_out_buf = cc_hal_sys_malloc_caps(__OUT_BUF_SIZE, CC_MEM_CAP_INTERNAL, CC_MEM_MOD_APP);
+    if(g_out_buf == NULL){
+        return CC_ERR_NO_MEM;
+    }
+    g_out_cb = out_cb;
+    g_err = CC_OK;
+    g_header_len = 0;
+    memset(&g_info, 0, sizeof(g_info));
+    g_window_head = 0;
+    g_hs_state = __HS_TAG;
+    g_hs_need = 1;
+    g_hs_got = 0;
+    g_hs_acc = 0;
+    g_patch_state = __PATCH_DIFF_LEN;
+    g_patch_varint = 0;
+    g_patch_shift = 0;
+    g_patch_remain = 0;
+    g_src_pos = 0;
+    g_src_buf_off = 0;
+    g_src_buf_len = 0;
+    g_out_len = 0;
+    g_out_total = 0;
+    return CC_OK;
+}
+
+cc_err_t gs_ota_unpack_feed(const uint8_t *data, uint32_t len){
+    if(g_out_buf == NULL){
+        return CC_FAIL;
+    }
+
+    if(g_header_len < GS_OTA_PACK_HEADER_SIZE){
+        uint32_t n = GS_OTA_PACK_HEADER_SIZE - g_header_len;
+        if(n > len){
+            n = len;
+        }
+        memcpy(g_header + g_header_len, data, n);
+        g_header_len += n;
+        data += n;
+        len -= n;
+        if(g_header_len < GS_OTA_PACK_HEADER_SIZE){
+            return CC_OK;
+        }
+        g_err = __header_parse();
+    }
+
+    for(uint32_t i = 0; i < len && g_err == CC_OK; i++){
+        if(g_info.compress == __COMPRESS_HS){
+            for(int8_t b = 7; b >= 0 && g_err == CC_OK; b--){
+                __hs_bit((data[i] >> b) & 1);
+            }
+        }else{
+            __stream_byte(data[i]);
+        }
+    }
+    if(g_err == CC_OK){
+        __out_flush();
+    }
+    return g_err;
+}
+
+uint32_t gs_ota_unpack_out_size(void){
+    return g_header_len == GS_OTA_PACK_HEADER_SIZE ? g_info.out_size : 0;
+}
+
+cc_err_t gs_ota_unpack_finish(void){
+    __out_flush();
+    if(g_err != CC_OK){
+        return g_err;
+    }
+    // heatshrink 末尾不足一个字节的填充位不会构成完整的符号，这里只看输出长度
+    if(g_header_len < GS_OTA_PACK_HEADER_SIZE || g_out_total != g_info.out_size){
+        CC_LOGE(TAG, "image incomplete: %d/%d", g_out_total, g_info.out_size);
+        return CC_ERR_INVALID_SIZE;
+    }
+    return CC_OK;
+}
+
+void gs_ota_unpack_end(void){
+    cc_hal_sys_free(g_window);
+    cc_hal_sys_free(g_src_buf);
+    cc_hal_sys_free(g_out_buf);
+    g_window = NULL;
+    g_src_buf = NULL;
+    g_out_buf = NULL;
+}
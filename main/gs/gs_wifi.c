@@ -30,6 +30,9 @@ static void __event_handler(void* handler_args, cc_event_base_t base_event, int3
             CC_LOGI(TAG, "wifi disconnect");
             cc_event_post(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_DISCONNECTED, NULL, 0);
             break;
+        case CC_HAL_WIFI_EVENT_STA_CONNECT_FAIL:
+            cc_event_post(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_CONNECT_FAIL, event_data, sizeof(cc_hal_wifi_connect_err_t));
+            break;
         case CC_HAL_WIFI_EVENT_SCAN_DONE:
             cc_event_post(GS_WIFI_EVENT, GS_WIFI_EVENT_SCAN_DONE, NULL, 0);
             break;
@@ -70,7 +73,36 @@ cc_err_t gs_wifi_sta_get_config(gs_wifi_config_t *wifi_config){
     return CC_OK;
 }
 
-cc_err_t gs_wifi_sta_start_connect(void){
+// 在扫描结果里找目标 SSID 信号最强的 BSSID
+static uint8_t __scan_hint(cc_hal_wifi_sta_config_t *config){
+    uint8_t ap_num = cc_hal_wifi_get_scan_ap_result_numbers();
+    uint8_t found = 0;
+    int8_t best_rssi = INT8_MIN;
+
+    if(ap_num == 0){
+        return 0;
+    }
+    gs_wifi_ap_info_t *ap_list = cc_hal_sys_malloc_caps(sizeof(gs_wifi_ap_info_t) * ap_num, CC_MEM_CAP_DEFAULT, CC_MEM_MOD_WIFI);
+    if(ap_list == NULL){
+        return 0;
+    }
+    if(cc_hal_wifi_get_scan_ap_result(ap_list, ap_num) == CC_OK){
+        for(size_t i = 0; i < ap_num; i++){
+            if(ap_list[i].ssid_len == config->ssid_len && memcmp(ap_list[i].ssid, config->ssid, config->ssid_len) == 0
+                && ap_list[i].rssi > best_rssi){
+                best_rssi = ap_list[i].rssi;
+                config->channel = ap_list[i].channel;
+                memcpy(config->bssid, ap_list[i].bssid, sizeof(config->bssid));
+                config->bssid_set = 1;
+                found = 1;
+            }
+        }
+    }
+    cc_hal_sys_free(ap_list);
+    return found;
+}
+
+static cc_err_t __sta_connect(uint8_t validate){
     cc_err_t err = CC_FAIL;
 
     if(g_wifi_sta_config.ssid_len == 0){
@@ -91,6 +123,13 @@ cc_err_t gs_wifi_sta_start_connect(void){
     config.password[g_wifi_sta_config.password_len] = '\0';
     config.password_len = g_wifi_sta_config.password_len;
 
+    if(validate){
+        config.auth_fail_stop = 1;
+        if(!__scan_hint(&config)){
+            CC_LOGW(TAG, "%s not in scan result => full scan", config.ssid);
+        }
+    }
+
     err = cc_hal_wifi_sta_start_connect(&config);
     
     if(err == CC_OK){
@@ -101,6 +140,14 @@ cc_err_t gs_wifi_sta_start_connect(void){
     return err;
 }
 
+cc_err_t gs_wifi_sta_start_connect(void){
+    return __sta_connect(0);
+}
+
+cc_err_t gs_wifi_sta_start_validate(void){
+    return __sta_connect(1);
+}
+
 
 cc_err_t gs_wifi_ap_start_setup(void){
     cc_err_t err = CC_FAIL;
@@ -155,5 +202,7 @@ void gs_wifi_init(void){
         CC_LOGI(TAG, "wifi not config");
     }
 
+    cc_event_set_base_prio(CC_HAL_WIFI_EVENT, CC_EVENT_PRIO_HIGH);
+    cc_event_set_base_prio(GS_WIFI_EVENT, CC_EVENT_PRIO_HIGH);
     cc_event_register_handler(CC_HAL_WIFI_EVENT, __event_handler);
 }
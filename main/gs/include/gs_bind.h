@@ -13,6 +13,7 @@ CC_EVENT_DECLARE_BASE(GS_BIND_EVENT);
 #define GS_BIND_CFG_MODE_NULL      0
 #define GS_BIND_CFG_MODE_AP        (0x01 << 0)
 #define GS_BIND_CFG_MODE_BLE       (0x01 << 1)
+#define GS_BIND_CFG_MODE_QR        (0x01 << 2)     // 摄像头扫码（CONFIG_GS_BIND_QR），不开额外的射频
 
 typedef enum{
     GS_BIND_ERR_TIMEOUT,
@@ -25,6 +26,7 @@ typedef enum{
     GS_BIND_EVENT_SUCCESS,
     GS_BIND_EVENT_FAIL,
     GS_BIND_EVENT_STOP,
+    GS_BIND_EVENT_CONNECT_FAIL,     // 收到的凭据连不上路由器（数据为 gs_bind_err_t），配网继续，可重新下发
 }gs_bind_event_t;
 
 void gs_bind_init(void);
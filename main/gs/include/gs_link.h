@@ -0,0 +1,44 @@
+#ifndef __GS_LINK_H__
+#define __GS_LINK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "cc_err.h"
+#include "cc_event.h"
+
+/*
+ * 双链路：Wi-Fi 为主，USB 4G 模组为备。模组保持 PPP 在线但不走流量（默认路由优先级低于 STA），
+ * 经 STA 接口持续探测网关 RTT 与丢包，Wi-Fi 断开或质量变差时把默认路由切到 PPP 并立即重连 MQTT，
+ * 不等 Wi-Fi 重连；Wi-Fi 恢复并稳定 CONFIG_GS_LINK_FAILBACK_MS 后切回。
+ * 切换耗时不超过 CONFIG_GS_LINK_LOSS_MAX 个探测周期加一次 MQTT 建连。
+ */
+
+CC_EVENT_DECLARE_BASE(GS_LINK_EVENT);
+
+typedef enum{
+    GS_LINK_EVENT_CHANGED = 0,      // data: gs_link_t，当前出口
+}gs_link_event_t;
+
+typedef enum{
+    GS_LINK_NONE = 0,
+    GS_LINK_WIFI,
+    GS_LINK_CELL,
+}gs_link_t;
+
+gs_link_t gs_link_get_active(void);
+
+// 最近探测窗口内的平均 RTT 与丢包数，窗口为空时 rtt_ms 为 0
+void gs_link_get_wifi_quality(uint16_t *rtt_ms, uint8_t *loss);
+
+// 未开启 CONFIG_GS_LINK_LTE_BACKUP 时只有 Wi-Fi，不做探测
+cc_err_t gs_link_init(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -7,6 +7,8 @@ extern "C" {
 
 #include "cc_err.h"
 #include "cc_event.h"
+#include "cc_http.h"
+#include "uplink_id.h"
 
 CC_EVENT_DECLARE_BASE(GS_MQTT_EVENT);
 
@@ -23,7 +25,43 @@ typedef enum {
     GS_MQTT_QOS2
 } gs_mqtt_qos_t;
 
-typedef void (*gs_mqtt_msg_cb_t)(const char *topic, uint8_t qos, uint8_t retain, char *data, uint32_t len);
+/*
+ * 上报负载格式，由云端协商：
+ * 版本消息中 "fmt" 列出设备支持的格式，云端下发 {"type":"0003","fmt":"cbor"} 切换，
+ * 切换结果保存在 KVS。CBOR 负载为整数 key 的 map，data 为原始字节而非十六进制字符串。
+ */
+typedef enum {
+    GS_MQTT_FMT_JSON = 0,
+    GS_MQTT_FMT_CBOR,
+} gs_mqtt_fmt_t;
+
+#define GS_MQTT_FMT_SUPPORTED       "json,cbor"
+
+// CBOR 负载的 key，与 JSON 字段一一对应
+#define GS_MQTT_CBOR_KEY_VER        0       // "ver"
+#define GS_MQTT_CBOR_KEY_TYPE       1       // "type"，值为整数，如 "0001" -> 1
+#define GS_MQTT_CBOR_KEY_DATA       2       // "data"，字节串
+#define GS_MQTT_CBOR_KEY_SEQ        3       // "seq_no"
+#define GS_MQTT_CBOR_KEY_ACT        4       // "act"，值为整数
+#define GS_MQTT_CBOR_KEY_FMT        5       // "fmt"
+#define GS_MQTT_CBOR_KEY_CMD        6       // "cmd"
+#define GS_MQTT_CBOR_KEY_DESC       7       // "desc"
+
+#define GS_MQTT_TOPIC_MAX           16      // 可登记的 topic 数
+#define GS_MQTT_TOPIC_INVALID       0xFF
+
+typedef uint8_t gs_mqtt_topic_t;
+
+typedef struct{
+    const void *base;
+    uint16_t len;
+}gs_mqtt_iov_t;
+
+/**
+ * @brief 下行消息回调，topic 为去掉设备前缀后的后缀，不以 '\0' 结尾，按 topic_len 使用；
+ *        分片消息重组完成后才回调；topic/data 仅在回调期间有效
+ */
+typedef void (*gs_mqtt_msg_cb_t)(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len);
 
 typedef void (*gs_mqtt_birth_cb_t)(uint8_t msg_type, uint8_t status);
 cc_err_t gs_mqtt_register_birth_callback(gs_mqtt_birth_cb_t cb);
@@ -35,14 +73,54 @@ cc_err_t gs_mqtt_reset_config(void);
 uint8_t gs_mqtt_connect_status(void);
 
 cc_err_t gs_mqtt_start_connect(void);
+// 出口链路切换后立即重连，尚未创建连接时等同 gs_mqtt_start_connect()
+cc_err_t gs_mqtt_reconnect(void);
 
-char *gs_mqtt_generate_seq(void);
+// 上行消息的 seq_no：uplink_id 的 32 位十进制文本，云端据此去重，重发同一条消息须沿用原来的 seq_no
+#define GS_MQTT_SEQ_LEN             UPLINK_ID_STR_LEN
+char *gs_mqtt_generate_seq(char seq[GS_MQTT_SEQ_LEN]);
 
+// 接收所有 topic 的消息
 cc_err_t gs_mqtt_register_msg_cb(gs_mqtt_msg_cb_t cb);
+// 只接收后缀与 topic 完全一致的消息，topic 须为常量字符串
+cc_err_t gs_mqtt_register_topic_msg_cb(const char *topic, gs_mqtt_msg_cb_t cb);
 
 cc_err_t gs_mqtt_subscribe(const char *topic, gs_mqtt_qos_t qos);
 cc_err_t gs_mqtt_publish(const char *topic, uint8_t *data, uint16_t len, uint8_t qos, uint8_t retain);
 
+gs_mqtt_fmt_t gs_mqtt_get_payload_fmt(void);
+cc_err_t gs_mqtt_set_payload_fmt(gs_mqtt_fmt_t fmt);
+
+/**
+ * 登记 topic（不含设备前缀），返回的句柄用于 gs_mqtt_publish_iov()。
+ * topic 字符串需长期有效（一般为常量），重复登记返回同一句柄。
+ */
+gs_mqtt_topic_t gs_mqtt_topic_register(const char *topic);
+
+/**
+ * 按句柄发布，payload 由多段拼接；单段时不拷贝，多段总长不超过 512 字节。
+ * 未连接时与 gs_mqtt_publish() 一样进入离线发件箱。
+ */
+cc_err_t gs_mqtt_publish_iov(gs_mqtt_topic_t topic, const gs_mqtt_iov_t *iov, uint8_t iovcnt, uint8_t qos, uint8_t retain);
+
+// broker 查询、对时等 HTTP 兜底接口所在的主机
+#define GS_MQTT_API_HOST            "gaoshi.wdaoyun.cn"
+
+#define GS_MQTT_RPC_TOPIC_REQ       "/rpc/request"
+#define GS_MQTT_RPC_TOPIC_RESP      "/rpc/response"
+#define GS_MQTT_RPC_TIMEOUT_MS      5000
+
+/**
+ * 在已连接的 MQTT 会话上调用云端接口，代替单独的 HTTP 请求。
+ * params 为 JSON 对象文本（NULL 表示 {}），请求与响应按 id 对应。
+ * cb 的语义与 cc_http_simple_get 相同：resp_code 为云端给出的状态码（通常 200），buf 为接口响应内容，
+ * 回调可在 buf[len] 写 '\0'；在网络任务中回调。
+ * 未连接、timeout_ms 内无响应或期间断线时改用 fallback_url 走 HTTP；fallback_url 为 NULL 时以 -1 回调，
+ * 未连接时直接返回 CC_ERR_INVALID_STATE 不回调。
+ */
+cc_err_t gs_mqtt_rpc_call(const char *method, const char *params, const char *fallback_url,
+                          uint32_t timeout_ms, cc_http_req_cb_t cb, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
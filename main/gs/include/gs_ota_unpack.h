@@ -0,0 +1,60 @@
+#ifndef __GS_OTA_UNPACK_H__
+#define __GS_OTA_UNPACK_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+
+#include "cc_err.h"
+
+/*
+ * 压缩/差分升级包，由 tools/ota_pack.py 生成。原始 app 镜像以 0xE9 开头，升级包以 GS_OTA_PACK_MAGIC 开头：
+ *
+ *   0   magic       "GSOP"
+ *   4   version     1
+ *   5   type        0 完整镜像，1 相对当前运行镜像的差分
+ *   6   compress    0 不压缩，1 heatshrink
+ *   7   window      heatshrink 窗口位数（4..GS_OTA_UNPACK_WINDOW_MAX）
+ *   8   lookahead   heatshrink lookahead 位数（3..window-1）
+ *   9   reserved[3]
+ *   12  out_size    还原后镜像长度（小端）
+ *   16  src_size    差分的旧镜像长度，完整镜像为 0
+ *   20  src_sha256  旧镜像 esp_app_desc_t.app_elf_sha256，完整镜像全 0
+ *   52  数据
+ *
+ * 差分数据（解压后）为 bsdiff 的控制序列，整数为 LEB128 变长编码：
+ *   diff_len, diff_len 字节（与旧镜像逐字节相加）, extra_len, extra_len 字节（原样输出）, adjust（zigzag，旧镜像位置偏移）
+ *
+ * 内存只有 heatshrink 窗口和两个小缓冲，与镜像大小无关。
+ */
+
+#define GS_OTA_PACK_MAGIC           "GSOP"
+#define GS_OTA_PACK_HEADER_SIZE     52
+#define GS_OTA_UNPACK_WINDOW_MAX    12
+
+// 还原出的镜像数据，按顺序交给调用方
+typedef cc_err_t (*gs_ota_unpack_out_cb_t)(const uint8_t *data, uint32_t len);
+
+// 下载流的第一个字节是否为升级包（否则按原始镜像处理）
+uint8_t gs_ota_unpack_is_packed(uint8_t first_byte);
+
+cc_err_t gs_ota_unpack_begin(gs_ota_unpack_out_cb_t out_cb);
+
+// 依次送入下载的数据，包头可以分多次送入
+cc_err_t gs_ota_unpack_feed(const uint8_t *data, uint32_t len);
+
+// 还原后的镜像长度，包头未收全时为 0
+uint32_t gs_ota_unpack_out_size(void);
+
+// 输出剩余数据并检查镜像是否完整
+cc_err_t gs_ota_unpack_finish(void);
+
+void gs_ota_unpack_end(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -26,6 +26,7 @@ typedef enum{
     GS_WIFI_EVENT_STA_AP_LEAVE,
     GS_WIFI_EVENT_SCAN_START,
     GS_WIFI_EVENT_SCAN_DONE,
+    GS_WIFI_EVENT_STA_CONNECT_FAIL,     // 数据为 cc_hal_wifi_connect_err_t
 }gs_wifi_event_t;
 
 typedef struct{
@@ -41,6 +42,8 @@ cc_err_t gs_wifi_sta_save_config(gs_wifi_config_t *wifi_config);
 cc_err_t gs_wifi_sta_get_config(gs_wifi_config_t *wifi_config);
 
 cc_err_t gs_wifi_sta_start_connect(void);
+// 配网校验：按最近一次扫描结果直连目标 AP，密码错误时不重试，上报 GS_WIFI_EVENT_STA_CONNECT_FAIL
+cc_err_t gs_wifi_sta_start_validate(void);
 
 cc_err_t gs_wifi_ap_stap(void);
 cc_err_t gs_wifi_ap_start_setup(void);
@@ -0,0 +1,241 @@
+// audio_dsp.c
+// 多相 FIR 采样率转换与混音，定点运算，不依赖 ESP-IDF（sdkconfig.h 在主机测试中由 shim 提供）
+#include "sdkconfig.h"
+#include "audio_dsp.h"
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#define RS_HIST_CAP     (AUDIO_DSP_RS_TAPS - 1 + AUDIO_DSP_RS_BLOCK)
+#define RS_CUTOFF       0.92f
+#define RS_COEF_ALIGN   16      // 每相 32 字节，PIE 按 16 字节对齐读取
+
+#if CONFIG_AUDIO_DSP_SIMD
+// simd/audio_dsp_esp32s3.S：c 16 字节对齐，x 任意偶地址，返回 16 个乘积之和
+int32_t audio_dsp_dot16_esp32s3(const int16_t *c, const int16_t *x);
+#endif
+
+static uint32_t gcd_u32(uint32_t a, uint32_t b)
+{
+    while (b) {
+        uint32_t t = a % b;
+        a = b;
+        b = t;
+    }
+    return a;
+}
+
+static inline int16_t sat16(int32_t v)
+{
+    if (v > INT16_MAX) {
+        return INT16_MAX;
+    }
+    if (v < INT16_MIN) {
+        return INT16_MIN;
+    }
+    return (int16_t)v;
+}
+
+// 原型低通长 up * TAPS，第 p 相取 h[p + t * up]（t 为距当前输入的样点数），倒序存放以便与历史正序点积
+static void rs_design(int16_t *coef, uint16_t up, uint16_t down)
+{
+    const int n = up * AUDIO_DSP_RS_TAPS;
+    const float center = (n - 1) / 2.0f;
+    // 以插值后的采样率归一化，取较低的奈奎斯特频率
+    const float fc = RS_CUTOFF * 0.5f / (up > down ? up : down);
+    float sum = 0;
+    for (int i = 0; i < n; i++) {
+        float x = i - center;
+        float sinc = x == 0 ? 2 * fc : sinf(2 * (float)M_PI * fc * x) / ((float)M_PI * x);
+        float w = 0.42f - 0.5f * cosf(2 * (float)M_PI * i / (n - 1)) + 0.08f * cosf(4 * (float)M_PI * i / (n - 1));
+        sum += sinc * w;
+    }
+    // 每相的直流增益为 1：整体和为 up
+    const float scale = up * 32768.0f / sum;
+    for (int i = 0; i < n; i++) {
+        float x = i - center;
+        float sinc = x == 0 ? 2 * fc : sinf(2 * (float)M_PI * fc * x) / ((float)M_PI * x);
+        float w = 0.42f - 0.5f * cosf(2 * (float)M_PI * i / (n - 1)) + 0.08f * cosf(4 * (float)M_PI * i / (n - 1));
+        int p = i % up;
+        int t = i / up;
+        coef[p * AUDIO_DSP_RS_TAPS + (AUDIO_DSP_RS_TAPS - 1 - t)] = sat16((int32_t)lrintf(sinc * w * scale));
+    }
+}
+
+bool audio_dsp_rs_init(audio_dsp_rs_t *rs, uint32_t in_rate, uint32_t out_rate, uint8_t ch)
+{
+    if (!rs || !in_rate || !out_rate || ch == 0 || ch > AUDIO_DSP_CH_MAX) {
+        return false;
+    }
+    memset(rs, 0, sizeof(*rs));
+    uint32_t g = gcd_u32(in_rate, out_rate);
+    if (out_rate / g > AUDIO_DSP_RS_PHASES_MAX || in_rate / g > UINT16_MAX) {
+        return false;
+    }
+    rs->up = out_rate / g;
+    rs->down = in_rate / g;
+    rs->ch = ch;
+    if (rs->up != 1 || rs->down != 1) {
+        void *coef = NULL;
+        if (posix_memalign(&coef, RS_COEF_ALIGN, rs->up * AUDIO_DSP_RS_TAPS * sizeof(int16_t)) != 0) {
+            return false;
+        }
+        rs->coef = coef;
+        rs_design(rs->coef, rs->up, rs->down);
+    }
+    audio_dsp_rs_reset(rs);
+    return true;
+}
+
+void audio_dsp_rs_deinit(audio_dsp_rs_t *rs)
+{
+    free(rs->coef);
+    rs->coef = NULL;
+}
+
+void audio_dsp_rs_reset(audio_dsp_rs_t *rs)
+{
+    // 历史以 TAPS-1 个 0 开头，第一个输出的窗口正好结束在第一个输入样点
+    memset(rs->hist, 0, sizeof(rs->hist));
+    rs->len = rs->coef ? AUDIO_DSP_RS_TAPS - 1 : 0;
+    rs->pos = 0;
+    rs->phase = 0;
+}
+
+// 抽头数固定为 16，展开成 4 路独立累加，编译器能排满乘加流水；S3 上两条向量乘加完成
+static inline int16_t rs_dot(const int16_t *c, const int16_t *x)
+{
+#if CONFIG_AUDIO_DSP_SIMD
+    return sat16((int32_t)(((int64_t)audio_dsp_dot16_esp32s3(c, x) + (1 << 14)) >> 15));
+#else
+    int32_t a0 = 0, a1 = 0, a2 = 0, a3 = 0;
+    for (int t = 0; t < AUDIO_DSP_RS_TAPS; t += 4) {
+        a0 += c[t] * x[t];
+        a1 += c[t + 1] * x[t + 1];
+        a2 += c[t + 2] * x[t + 2];
+        a3 += c[t + 3] * x[t + 3];
+    }
+    return sat16((a0 + a1 + a2 + a3 + (1 << 14)) >> 15);
+#endif
+}
+
+// 丢掉窗口起点之前的历史，再写入最多 AUDIO_DSP_RS_BLOCK 帧输入；返回消耗的输入帧数
+static size_t rs_fill(audio_dsp_rs_t *rs, const int16_t *in, size_t frames, uint8_t in_ch)
+{
+    size_t used = 0;
+    if (rs->pos >= rs->len) {
+        // 降采样时窗口可能越过尚未写入的输入，直接跳过
+        size_t skip = rs->pos - rs->len;
+        if (skip > frames) {
+            skip = frames;
+        }
+        used = skip;
+        rs->pos -= rs->len + skip;
+        rs->len = 0;
+        if (rs->pos) {
+            return used;
+        }
+    } else if (rs->pos) {
+        for (uint8_t c = 0; c < rs->ch; c++) {
+            memmove(rs->hist[c], rs->hist[c] + rs->pos, (rs->len - rs->pos) * sizeof(int16_t));
+        }
+        rs->len -= rs->pos;
+        rs->pos = 0;
+    }
+    size_t n = frames - used;
+    if (n > RS_HIST_CAP - rs->len) {
+        n = RS_HIST_CAP - rs->len;
+    }
+    const int16_t *p = in + used * in_ch;
+    if (in_ch == rs->ch) {
+        if (rs->ch == 1) {
+            memcpy(rs->hist[0] + rs->len, p, n * sizeof(int16_t));
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                rs->hist[0][rs->len + i] = p[2 * i];
+                rs->hist[1][rs->len + i] = p[2 * i + 1];
+            }
+        }
+    } else {
+        for (size_t i = 0; i < n; i++) {
+            rs->hist[0][rs->len + i] = (int16_t)((p[2 * i] + p[2 * i + 1]) >> 1);
+        }
+    }
+    rs->len += n;
+    return used + n;
+}
+
+size_t audio_dsp_rs_process(audio_dsp_rs_t *rs, const int16_t *in, size_t in_frames, uint8_t in_ch,
+                            size_t *in_used, int16_t *out, size_t out_frames)
+{
+    size_t used = 0;
+    size_t produced = 0;
+    if (in_ch < rs->ch) {
+        *in_used = 0;
+        return 0;
+    }
+    if (!rs->coef) {
+        produced = in_frames < out_frames ? in_frames : out_frames;
+        if (in_ch == rs->ch) {
+            memcpy(out, in, produced * rs->ch * sizeof(int16_t));
+        } else {
+            for (size_t i = 0; i < produced; i++) {
+                out[i] = (int16_t)((in[2 * i] + in[2 * i + 1]) >> 1);
+            }
+        }
+        *in_used = produced;
+        return produced;
+    }
+    while (produced < out_frames) {
+        if (rs->pos + AUDIO_DSP_RS_TAPS > rs->len) {
+            if (used == in_frames) {
+                break;
+            }
+            used += rs_fill(rs, in + used * in_ch, in_frames - used, in_ch);
+            continue;
+        }
+        const int16_t *c = rs->coef + rs->phase * AUDIO_DSP_RS_TAPS;
+        for (uint8_t ch = 0; ch < rs->ch; ch++) {
+            *out++ = rs_dot(c, rs->hist[ch] + rs->pos);
+        }
+        produced++;
+        rs->phase += rs->down;
+        while (rs->phase >= rs->up) {
+            rs->phase -= rs->up;
+            rs->pos++;
+        }
+    }
+    *in_used = used;
+    return produced;
+}
+
+void audio_dsp_mix_add(int32_t *acc, uint8_t out_ch, const int16_t *src, uint8_t src_ch, size_t frames, uint16_t gain)
+{
+    if (src_ch == out_ch) {
+        size_t n = frames * out_ch;
+        if (gain == AUDIO_DSP_GAIN_UNITY) {
+            for (size_t i = 0; i < n; i++) {
+                acc[i] += src[i];
+            }
+        } else {
+            for (size_t i = 0; i < n; i++) {
+                acc[i] += (src[i] * gain) >> 12;
+            }
+        }
+        return;
+    }
+    // 单声道源：每个输出声道相同
+    for (size_t i = 0; i < frames; i++) {
+        int32_t v = (src[i] * gain) >> 12;
+        for (uint8_t c = 0; c < out_ch; c++) {
+            *acc++ += v;
+        }
+    }
+}
+
+void audio_dsp_mix_out(const int32_t *acc, int16_t *out, size_t samples)
+{
+    for (size_t i = 0; i < samples; i++) {
+        out[i] = sat16(acc[i]);
+    }
+}
@@ -0,0 +1,408 @@
+/**
+ * @file audio_enc.c
+ * @brief UAC 麦克风上行的板载音频编码（IMA ADPCM）
+ */
+
+#include "audio_enc.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "audio_enc";
+
+#define AUDIO_ENC_TASK_STACK    3072
+#define AUDIO_ENC_SLOT_NONE     0xFF    // 同时作为编码任务的退出通知
+
+typedef struct {
+    int16_t *pcm;
+    uint32_t samples;
+    uint32_t sample_rate;
+    uint32_t seq;
+    int64_t timestamp_us;
+} pcm_slot_t;
+
+static audio_enc_config_t s_cfg;
+static pcm_slot_t *s_slots = NULL;
+static int16_t *s_pcm_buf = NULL;
+static uint8_t *s_out = NULL;
+static uint32_t s_slot_samples_max = 0;
+static QueueHandle_t s_free_q = NULL;       // 空闲帧索引
+static QueueHandle_t s_ready_q = NULL;      // 待编码帧索引
+static SemaphoreHandle_t s_done = NULL;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_running = false;
+static audio_enc_stats_t s_stats;
+static int8_t s_enc_index = 0;              // 沿用上一包结束时的步长索引，免得每包从最小步长重新收敛
+
+// 以下仅在 mic 回调中访问
+static uint8_t s_cur = AUDIO_ENC_SLOT_NONE;
+static uint32_t s_rate = 0;
+static uint32_t s_frame_samples = 0;
+static uint32_t s_drop_samples = 0;
+static uint32_t s_seq = 0;
+
+/* -------------------- IMA ADPCM -------------------- */
+
+static const int16_t s_step_table[89] = {
+    7, 8, 9, 10, 11, 12, 13, 14, 16, 17, 19, 21, 23, 25, 28, 31, 34, 37, 41, 45,
+    50, 55, 60, 66, 73, 80, 88, 97, 107, 118, 130, 143, 157, 173, 190, 209, 230,
+    253, 279, 307, 337, 371, 408, 449, 494, 544, 598, 658, 724, 796, 876, 963,
+    1060, 1166, 1282, 1411, 1552, 1707, 1878, 2066, 2272, 2499, 2749, 3024, 3327,
+    3660, 4026, 4428, 4871, 5358, 5894, 6484, 7132, 7845, 8630, 9493, 10442,
+    11487, 12635, 13899, 15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767
+};
+
+static const int8_t s_index_table[16] = {
+    -1, -1, -1, -1, 2, 4, 6, 8, -1, -1, -1, -1, 2, 4, 6, 8
+};
+
+static uint8_t adpcm_encode_sample(int16_t sample, int32_t *predictor, int8_t *index)
+{
+    int32_t step = s_step_table[*index];
+    int32_t diff = sample - *predictor;
+    uint8_t code = 0;
+    if (diff < 0) {
+        code = 8;
+        diff = -diff;
+    }
+    // 与解码端相同的量化重建，保证编解码两端预测值一致
+    int32_t delta = step >> 3;
+    if (diff >= step) {
+        code |= 4;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 2;
+        diff -= step;
+        delta += step;
+    }
+    step >>= 1;
+    if (diff >= step) {
+        code |= 1;
+        delta += step;
+    }
+
+    *predictor += (code & 8) ? -delta : delta;
+    if (*predictor > INT16_MAX) {
+        *predictor = INT16_MAX;
+    } else if (*predictor < INT16_MIN) {
+        *predictor = INT16_MIN;
+    }
+    *index += s_index_table[code];
+    if (*index < 0) {
+        *index = 0;
+    } else if (*index > 88) {
+        *index = 88;
+    }
+    return code;
+}
+
+// 每包独立：头部给出首样点和步长索引，其余样点每个 4 bit，低半字节在前
+static size_t adpcm_encode_packet(const int16_t *pcm, uint32_t samples, uint8_t *out)
+{
+    int32_t predictor = pcm[0];
+    int8_t index = s_enc_index;
+
+    out[0] = (uint8_t)(predictor & 0xFF);
+    out[1] = (uint8_t)((predictor >> 8) & 0xFF);
+    out[2] = (uint8_t)index;
+    out[3] = 0;
+
+    uint8_t *p = out + AUDIO_ENC_PACKET_HDR_LEN;
+    for (uint32_t i = 1; i < samples; i++) {
+        uint8_t code = adpcm_encode_sample(pcm[i], &predictor, &index);
+        if (i & 1) {
+            *p = code;
+        } else {
+            *p++ |= code << 4;
+        }
+    }
+    s_enc_index = index;
+    return AUDIO_ENC_PACKET_HDR_LEN + samples / 2;
+}
+
+// 与 adpcm_encode_sample 的重建完全相同，解码结果即编码端的预测值
+static int16_t adpcm_decode_sample(uint8_t code, int32_t *predictor, int8_t *index)
+{
+    int32_t step = s_step_table[*index];
+    int32_t delta = step >> 3;
+    if (code & 4) {
+        delta += step;
+    }
+    if (code & 2) {
+        delta += step >> 1;
+    }
+    if (code & 1) {
+        delta += step >> 2;
+    }
+    *predictor += (code & 8) ? -delta : delta;
+    if (*predictor > INT16_MAX) {
+        *predictor = INT16_MAX;
+    } else if (*predictor < INT16_MIN) {
+        *predictor = INT16_MIN;
+    }
+    *index += s_index_table[code];
+    if (*index < 0) {
+        *index = 0;
+    } else if (*index > 88) {
+        *index = 88;
+    }
+    return (int16_t)*predictor;
+}
+
+size_t audio_enc_adpcm_decode(const uint8_t *packet, size_t len, int16_t *pcm, size_t max_samples)
+{
+    if (len <= AUDIO_ENC_PACKET_HDR_LEN || !max_samples || packet[2] > 88) {
+        return 0;
+    }
+    int32_t predictor = (int16_t)(packet[0] | (packet[1] << 8));
+    int8_t index = (int8_t)packet[2];
+    size_t samples = (len - AUDIO_ENC_PACKET_HDR_LEN) * 2;
+    if (samples > max_samples) {
+        samples = max_samples;
+    }
+    const uint8_t *p = packet + AUDIO_ENC_PACKET_HDR_LEN;
+    pcm[0] = (int16_t)predictor;
+    for (size_t i = 1; i < samples; i++) {
+        uint8_t code = (i & 1) ? (*p & 0x0F) : (*p++ >> 4);
+        pcm[i] = adpcm_decode_sample(code, &predictor, &index);
+    }
+    return samples;
+}
+
+/* -------------------- 编码任务 -------------------- */
+
+static void audio_enc_task(void *arg)
+{
+    uint8_t idx;
+
+    ESP_LOGI(TAG, "Encoder task started");
+    while (1) {
+        if (xQueueReceive(s_ready_q, &idx, portMAX_DELAY) != pdTRUE) {
+            continue;
+        }
+        if (idx == AUDIO_ENC_SLOT_NONE) {
+            break;
+        }
+        pcm_slot_t *slot = &s_slots[idx];
+        audio_enc_packet_t packet = {
+            .data = s_out,
+            .len = adpcm_encode_packet(slot->pcm, slot->samples, s_out),
+            .seq = slot->seq,
+            .samples = slot->samples,
+            .sample_rate = slot->sample_rate,
+            .timestamp_us = slot->timestamp_us,
+        };
+        // 编码完即可归还，回调阻塞期间 mic 可继续使用该帧
+        xQueueSend(s_free_q, &idx, 0);
+        s_cfg.on_packet(&packet, s_cfg.arg);
+        s_stats.packets++;
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+/* -------------------- mic 回调 -------------------- */
+
+static void mic_frame_reset(uint32_t rate)
+{
+    s_rate = rate;
+    s_frame_samples = rate * s_cfg.frame_ms / 1000;
+    if (s_frame_samples > s_slot_samples_max) {
+        s_frame_samples = s_slot_samples_max;
+    }
+    if (s_frame_samples < 2) {
+        s_frame_samples = 2;
+    }
+    if (s_cur != AUDIO_ENC_SLOT_NONE) {
+        s_slots[s_cur].samples = 0;
+    }
+    s_drop_samples = 0;
+}
+
+void audio_enc_mic_cb(mic_frame_t *frame, void *ptr)
+{
+    if (!s_running || !frame || !frame->data) {
+        return;
+    }
+    if (frame->bit_resolution != 16) {
+        s_stats.format_err++;
+        return;
+    }
+    if (frame->samples_frequence != s_rate) {
+        ESP_LOGI(TAG, "Mic sample rate %lu", (unsigned long)frame->samples_frequence);
+        mic_frame_reset(frame->samples_frequence);
+    }
+
+    const int16_t *in = (const int16_t *)frame->data;
+    uint32_t in_samples = frame->data_bytes / sizeof(int16_t) / s_cfg.channels;
+    int64_t now = esp_timer_get_time();
+
+    while (in_samples > 0) {
+        if (s_cur == AUDIO_ENC_SLOT_NONE) {
+            if (xQueueReceive(s_free_q, &s_cur, 0) != pdTRUE) {
+                // 编码跟不上：丢弃本段，按整帧计数并跳过序号
+                s_cur = AUDIO_ENC_SLOT_NONE;
+                s_drop_samples += in_samples;
+                while (s_drop_samples >= s_frame_samples) {
+                    s_drop_samples -= s_frame_samples;
+                    s_stats.pcm_dropped++;
+                    s_seq++;
+                }
+                return;
+            }
+            s_slots[s_cur].samples = 0;
+        }
+
+        pcm_slot_t *slot = &s_slots[s_cur];
+        if (slot->samples == 0) {
+            slot->timestamp_us = now;
+        }
+        uint32_t n = s_frame_samples - slot->samples;
+        if (n > in_samples) {
+            n = in_samples;
+        }
+        if (s_cfg.channels == 1) {
+            memcpy(slot->pcm + slot->samples, in, n * sizeof(int16_t));
+            in += n;
+        } else {
+            for (uint32_t i = 0; i < n; i++, in += 2) {
+                slot->pcm[slot->samples + i] = (int16_t)(((int32_t)in[0] + in[1]) >> 1);
+            }
+        }
+        slot->samples += n;
+        in_samples -= n;
+
+        if (slot->samples >= s_frame_samples) {
+            slot->sample_rate = s_rate;
+            slot->seq = s_seq++;
+            // 就绪队列长度等于帧数，不会满
+            xQueueSend(s_ready_q, &s_cur, 0);
+            s_cur = AUDIO_ENC_SLOT_NONE;
+        }
+    }
+}
+
+/* -------------------- 启停 -------------------- */
+
+static void audio_enc_free(void)
+{
+    if (s_free_q) {
+        vQueueDelete(s_free_q);
+        s_free_q = NULL;
+    }
+    if (s_ready_q) {
+        vQueueDelete(s_ready_q);
+        s_ready_q = NULL;
+    }
+    if (s_done) {
+        vSemaphoreDelete(s_done);
+        s_done = NULL;
+    }
+    free(s_slots);
+    s_slots = NULL;
+    heap_caps_free(s_pcm_buf);
+    s_pcm_buf = NULL;
+    heap_caps_free(s_out);
+    s_out = NULL;
+}
+
+esp_err_t audio_enc_start(const audio_enc_config_t *config)
+{
+    if (!config || !config->on_packet || config->codec != AUDIO_ENC_IMA_ADPCM
+            || (config->channels != 1 && config->channels != 2)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_cfg = *config;
+    if (!s_cfg.frame_ms) {
+        s_cfg.frame_ms = AUDIO_ENC_DEFAULT_FRAME_MS;
+    }
+    if (!s_cfg.frame_num) {
+        s_cfg.frame_num = AUDIO_ENC_DEFAULT_FRAME_NUM;
+    }
+    if (!s_cfg.task_prio) {
+        s_cfg.task_prio = AUDIO_ENC_DEFAULT_TASK_PRIO;
+    }
+    if (s_cfg.frame_num >= AUDIO_ENC_SLOT_NONE) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_slot_samples_max = AUDIO_ENC_SAMPLE_RATE_MAX * s_cfg.frame_ms / 1000;
+    s_slots = calloc(s_cfg.frame_num, sizeof(pcm_slot_t));
+    s_pcm_buf = heap_caps_malloc(s_cfg.frame_num * s_slot_samples_max * sizeof(int16_t),
+                                 MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_out = heap_caps_malloc(AUDIO_ENC_PACKET_HDR_LEN + s_slot_samples_max / 2 + 1,
+                             MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_free_q = xQueueCreate(s_cfg.frame_num, sizeof(uint8_t));
+    // 多留一个位置给退出通知
+    s_ready_q = xQueueCreate(s_cfg.frame_num + 1, sizeof(uint8_t));
+    s_done = xSemaphoreCreateBinary();
+    if (!s_slots || !s_pcm_buf || !s_out || !s_free_q || !s_ready_q || !s_done) {
+        ESP_LOGE(TAG, "Failed to allocate %u frames of %lu samples",
+                 s_cfg.frame_num, (unsigned long)s_slot_samples_max);
+        audio_enc_free();
+        return ESP_ERR_NO_MEM;
+    }
+    for (uint8_t i = 0; i < s_cfg.frame_num; i++) {
+        s_slots[i].pcm = s_pcm_buf + i * s_slot_samples_max;
+        xQueueSend(s_free_q, &i, 0);
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_cur = AUDIO_ENC_SLOT_NONE;
+    s_rate = 0;
+    s_seq = 0;
+    s_enc_index = 0;
+    BaseType_t core = s_cfg.task_core < 0 ? tskNO_AFFINITY : s_cfg.task_core;
+    if (xTaskCreatePinnedToCore(audio_enc_task, "audio_enc", AUDIO_ENC_TASK_STACK, NULL,
+                                s_cfg.task_prio, &s_task, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create encoder task");
+        s_task = NULL;
+        audio_enc_free();
+        return ESP_FAIL;
+    }
+    s_running = true;
+
+    ESP_LOGI(TAG, "IMA ADPCM encoder started, %u ch, %u ms x %u frames",
+             s_cfg.channels, s_cfg.frame_ms, s_cfg.frame_num);
+    return ESP_OK;
+}
+
+void audio_enc_stop(void)
+{
+    if (!s_task) {
+        return;
+    }
+    s_running = false;
+    uint8_t quit = AUDIO_ENC_SLOT_NONE;
+    xQueueSend(s_ready_q, &quit, portMAX_DELAY);
+    xSemaphoreTake(s_done, portMAX_DELAY);
+    s_task = NULL;
+    audio_enc_free();
+
+    ESP_LOGI(TAG, "Encoder stopped, packets=%lu dropped=%lu format_err=%lu",
+             (unsigned long)s_stats.packets, (unsigned long)s_stats.pcm_dropped,
+             (unsigned long)s_stats.format_err);
+}
+
+esp_err_t audio_enc_get_stats(audio_enc_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,372 @@
+/**
+ * @file audio_mix.c
+ * @brief UAC 扬声器下行的多路混音与采样率转换
+ */
+
+#include "audio_mix.h"
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "rbuffer_spsc.h"
+#include "usb_stream.h"
+
+static const char *TAG = "audio_mix";
+
+#define AUDIO_MIX_TASK_STACK    3072
+
+typedef struct {
+    bool used;
+    uint8_t in_ch;
+    uint16_t gain;
+    audio_dsp_rs_t rs;
+    rbuffer_spsc_handle_t ring;     // 流；片段为 NULL
+    const int16_t *clip;            // 片段中下一个未送入转换器的帧
+    size_t clip_frames;
+} mix_source_t;
+
+static audio_mix_config_t s_cfg;
+static mix_source_t *s_src = NULL;          // AUDIO_MIX_SOURCE_MAX 个，较大，启动时分配
+static int32_t *s_acc = NULL;
+static int16_t *s_tmp = NULL;               // 单路转换后的输出
+static int16_t *s_out = NULL;
+static size_t s_period_frames = 0;
+static SemaphoreHandle_t s_lock = NULL;
+static SemaphoreHandle_t s_done = NULL;
+static TaskHandle_t s_task = NULL;
+static volatile bool s_running = false;
+static audio_mix_stats_t s_stats;
+
+/* -------------------- 混音任务 -------------------- */
+
+static void source_close(mix_source_t *src)
+{
+    audio_dsp_rs_deinit(&src->rs);
+    if (src->ring) {
+        rbuffer_spsc_delete(src->ring);
+        src->ring = NULL;
+    }
+    src->clip = NULL;
+    src->used = false;
+}
+
+// 流的环形缓冲容量与帧长都是 2 的幂且只按整帧读写，peek 的第一段总是整帧
+static size_t source_render(mix_source_t *src, int16_t *out, size_t frames)
+{
+    size_t frame_bytes = src->in_ch * sizeof(int16_t);
+    size_t produced = 0;
+    while (produced < frames) {
+        const int16_t *in = src->clip;
+        size_t avail = src->clip_frames;
+        if (src->ring) {
+            rbuffer_span_t span[2];
+            rbuffer_spsc_peek(src->ring, 0, span);
+            in = (const int16_t *)span[0].data;
+            avail = span[0].len / frame_bytes;
+        }
+        size_t used = 0;
+        size_t n = audio_dsp_rs_process(&src->rs, in, avail, src->in_ch, &used,
+                                        out + produced * src->rs.ch, frames - produced);
+        produced += n;
+        if (src->ring) {
+            rbuffer_spsc_commit_read(src->ring, used * frame_bytes);
+        } else {
+            src->clip += used * src->in_ch;
+            src->clip_frames -= used;
+        }
+        if (n == 0 && used == 0) {
+            break;
+        }
+    }
+    return produced;
+}
+
+static void audio_mix_task(void *arg)
+{
+    const size_t samples = s_period_frames * s_cfg.channels;
+    while (s_running) {
+        memset(s_acc, 0, samples * sizeof(int32_t));
+        uint8_t active = 0;
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        for (int i = 0; i < AUDIO_MIX_SOURCE_MAX; i++) {
+            mix_source_t *src = &s_src[i];
+            if (!src->used) {
+                continue;
+            }
+            size_t n = source_render(src, s_tmp, s_period_frames);
+            if (n) {
+                audio_dsp_mix_add(s_acc, s_cfg.channels, s_tmp, src->rs.ch, n, src->gain);
+                active++;
+            }
+            if (n < s_period_frames) {
+                if (!src->ring) {
+                    // 片段播完（转换器中的尾巴也已输出）
+                    source_close(src);
+                } else if (n) {
+                    s_stats.underruns++;
+                }
+            }
+        }
+        xSemaphoreGive(s_lock);
+
+        if (!active) {
+            // 新数据或新音源到来时唤醒
+            ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+            continue;
+        }
+        audio_dsp_mix_out(s_acc, s_out, samples);
+        if (uac_spk_streaming_write(s_out, samples * sizeof(int16_t), s_cfg.period_ms * 4) != ESP_OK) {
+            // 扬声器未连接：丢弃本周期，按周期节奏继续消耗音源，免得恢复后播放陈旧的数据
+            s_stats.write_err++;
+            vTaskDelay(pdMS_TO_TICKS(s_cfg.period_ms));
+            continue;
+        }
+        s_stats.periods++;
+    }
+    xSemaphoreGive(s_done);
+    vTaskDelete(NULL);
+}
+
+/* -------------------- 音源 -------------------- */
+
+static esp_err_t source_open(uint32_t sample_rate, uint8_t channels, uint16_t gain, audio_mix_source_t *source,
+                             mix_source_t **out)
+{
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!sample_rate || (channels != 1 && channels != 2)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (int i = 0; i < AUDIO_MIX_SOURCE_MAX; i++) {
+        mix_source_t *src = &s_src[i];
+        if (src->used) {
+            continue;
+        }
+        // 转换器声道数取两者较小值：多出的输入声道在转换前混缩，单声道在混音时复制到各输出声道
+        uint8_t ch = channels < s_cfg.channels ? channels : s_cfg.channels;
+        if (!audio_dsp_rs_init(&src->rs, sample_rate, s_cfg.sample_rate, ch)) {
+            ESP_LOGE(TAG, "Unsupported rate %lu -> %lu", (unsigned long)sample_rate,
+                     (unsigned long)s_cfg.sample_rate);
+            return ESP_ERR_NOT_SUPPORTED;
+        }
+        src->in_ch = channels;
+        src->gain = gain;
+        src->ring = NULL;
+        src->clip = NULL;
+        src->clip_frames = 0;
+        *source = i;
+        *out = src;
+        return ESP_OK;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+esp_err_t audio_mix_stream_open(uint32_t sample_rate, uint8_t channels, uint16_t gain, uint16_t buf_ms,
+                                audio_mix_source_t *source)
+{
+    if (!source) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!buf_ms) {
+        buf_ms = AUDIO_MIX_DEFAULT_STREAM_MS;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    mix_source_t *src = NULL;
+    esp_err_t ret = source_open(sample_rate, channels, gain, source, &src);
+    if (ret == ESP_OK) {
+        // 无锁环形缓冲要求容量为 2 的幂，向上取整
+        uint32_t size = sample_rate * buf_ms / 1000 * channels * sizeof(int16_t);
+        uint32_t cap = 1;
+        while (cap < size) {
+            cap <<= 1;
+        }
+        src->ring = rbuffer_spsc_create(cap);
+        if (!src->ring) {
+            audio_dsp_rs_deinit(&src->rs);
+            ret = ESP_ERR_NO_MEM;
+        } else {
+            src->used = true;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    return ret;
+}
+
+size_t audio_mix_stream_write(audio_mix_source_t source, const void *pcm, size_t bytes)
+{
+    if (source >= AUDIO_MIX_SOURCE_MAX || !s_src || !s_src[source].ring) {
+        return 0;
+    }
+    mix_source_t *src = &s_src[source];
+    size_t frame_bytes = src->in_ch * sizeof(int16_t);
+    // 可用空间总是整帧，截断后写入的也是整帧
+    size_t n = bytes / frame_bytes * frame_bytes;
+    size_t avail = rbuffer_spsc_available_size(src->ring);
+    if (n > avail) {
+        s_stats.stream_dropped += n - avail;
+        n = avail;
+    }
+    n = rbuffer_spsc_push(src->ring, pcm, n);
+    if (n) {
+        xTaskNotifyGive(s_task);
+    }
+    return n;
+}
+
+void audio_mix_stream_close(audio_mix_source_t source)
+{
+    if (source >= AUDIO_MIX_SOURCE_MAX || !s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_src[source].used) {
+        source_close(&s_src[source]);
+    }
+    xSemaphoreGive(s_lock);
+}
+
+esp_err_t audio_mix_play_clip(const int16_t *pcm, size_t frames, uint32_t sample_rate, uint8_t channels,
+                              uint16_t gain, audio_mix_source_t *source)
+{
+    if (!pcm || !frames) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    audio_mix_source_t id = AUDIO_MIX_SOURCE_NONE;
+    mix_source_t *src = NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    esp_err_t ret = source_open(sample_rate, channels, gain, &id, &src);
+    if (ret == ESP_OK) {
+        src->clip = pcm;
+        src->clip_frames = frames;
+        src->used = true;
+    }
+    xSemaphoreGive(s_lock);
+    if (source) {
+        *source = id;
+    }
+    if (ret == ESP_OK) {
+        xTaskNotifyGive(s_task);
+    }
+    return ret;
+}
+
+esp_err_t audio_mix_set_gain(audio_mix_source_t source, uint16_t gain)
+{
+    if (source >= AUDIO_MIX_SOURCE_MAX || !s_src || !s_src[source].used) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    s_src[source].gain = gain;
+    return ESP_OK;
+}
+
+/* -------------------- 启停 -------------------- */
+
+static void audio_mix_free(void)
+{
+    if (s_lock) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    if (s_done) {
+        vSemaphoreDelete(s_done);
+        s_done = NULL;
+    }
+    heap_caps_free(s_src);
+    s_src = NULL;
+    heap_caps_free(s_acc);
+    s_acc = NULL;
+    heap_caps_free(s_tmp);
+    s_tmp = NULL;
+    heap_caps_free(s_out);
+    s_out = NULL;
+}
+
+esp_err_t audio_mix_start(const audio_mix_config_t *config)
+{
+    if (!config || !config->sample_rate || (config->channels != 1 && config->channels != 2)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_cfg = *config;
+    if (!s_cfg.period_ms) {
+        s_cfg.period_ms = AUDIO_MIX_DEFAULT_PERIOD_MS;
+    }
+    if (!s_cfg.task_prio) {
+        s_cfg.task_prio = AUDIO_MIX_DEFAULT_TASK_PRIO;
+    }
+    s_period_frames = s_cfg.sample_rate * s_cfg.period_ms / 1000;
+    size_t samples = s_period_frames * s_cfg.channels;
+
+    // 转换器历史和系数在每个周期都要全部扫过，放内部 RAM
+    s_src = heap_caps_calloc(AUDIO_MIX_SOURCE_MAX, sizeof(mix_source_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_acc = heap_caps_malloc(samples * sizeof(int32_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_tmp = heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_out = heap_caps_malloc(samples * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_lock = xSemaphoreCreateMutex();
+    s_done = xSemaphoreCreateBinary();
+    if (!s_src || !s_acc || !s_tmp || !s_out || !s_lock || !s_done) {
+        ESP_LOGE(TAG, "Failed to allocate %u samples per period", (unsigned)samples);
+        audio_mix_free();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_running = true;
+    BaseType_t core = s_cfg.task_core < 0 ? tskNO_AFFINITY : s_cfg.task_core;
+    if (xTaskCreatePinnedToCore(audio_mix_task, "audio_mix", AUDIO_MIX_TASK_STACK, NULL,
+                                s_cfg.task_prio, &s_task, core) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create mixer task");
+        s_running = false;
+        s_task = NULL;
+        audio_mix_free();
+        return ESP_FAIL;
+    }
+
+    ESP_LOGI(TAG, "Mixer started, %lu Hz %u ch, %u ms period",
+             (unsigned long)s_cfg.sample_rate, s_cfg.channels, s_cfg.period_ms);
+    return ESP_OK;
+}
+
+void audio_mix_stop(void)
+{
+    if (!s_task) {
+        return;
+    }
+    s_running = false;
+    xTaskNotifyGive(s_task);
+    xSemaphoreTake(s_done, portMAX_DELAY);
+    s_task = NULL;
+    for (int i = 0; i < AUDIO_MIX_SOURCE_MAX; i++) {
+        if (s_src[i].used) {
+            source_close(&s_src[i]);
+        }
+    }
+    audio_mix_free();
+
+    ESP_LOGI(TAG, "Mixer stopped, periods=%lu underruns=%lu write_err=%lu dropped=%lu",
+             (unsigned long)s_stats.periods, (unsigned long)s_stats.underruns,
+             (unsigned long)s_stats.write_err, (unsigned long)s_stats.stream_dropped);
+}
+
+esp_err_t audio_mix_get_stats(audio_mix_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    return ESP_OK;
+}
@@ -0,0 +1,88 @@
+/**
+ * @file audio_dsp.h
+ * @brief 16 bit PCM 的采样率转换与混音，不依赖 ESP-IDF，主机测试直接编译（test_apps/host_test）
+ *
+ * 采样率转换为多相 FIR：in_rate:out_rate 约分为 down:up，原型低通（加 Blackman 窗的 sinc，
+ * 截止频率为两者较低奈奎斯特频率的 92%）按 up 个相拆开，每个输出样点只算一相的
+ * AUDIO_DSP_RS_TAPS 个抽头，与输入历史做连续的点积，32 位累加、Q15 系数。
+ * 8k/16k -> 48k 每个输出样点 16 次乘加，不需要先插零再滤波。
+ * ESP32-S3 上点积走 PIE 向量乘加（CONFIG_AUDIO_DSP_SIMD），结果与 C 实现逐位一致。
+ *
+ * 输入为交错的多声道，声道数多于转换器声道数时在写入历史时先混缩，
+ * 单声道升为双声道放在混音（audio_dsp_mix_add）里做，不重复转换同样的数据。
+ */
+
+#ifndef AUDIO_DSP_H
+#define AUDIO_DSP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_DSP_RS_TAPS           16      // 每相抽头数
+#define AUDIO_DSP_RS_PHASES_MAX     160     // up 的上限，44.1k -> 48k 需要 160
+#define AUDIO_DSP_RS_BLOCK          256     // 每次写入历史的输入帧数上限
+#define AUDIO_DSP_CH_MAX            2
+#define AUDIO_DSP_GAIN_UNITY        4096    // 混音增益为 Q12
+
+typedef struct {
+    int16_t *coef;          // up * TAPS，按相排列；NULL 表示采样率相同，直接拷贝
+    uint16_t up;
+    uint16_t down;
+    uint16_t phase;         // 当前输出样点落在哪一相
+    uint16_t len;           // hist 中的有效帧数
+    uint16_t pos;           // 下一个输出的窗口起点，可超过 len（降采样跳过的输入）
+    uint8_t ch;
+    int16_t hist[AUDIO_DSP_CH_MAX][AUDIO_DSP_RS_TAPS - 1 + AUDIO_DSP_RS_BLOCK];
+} audio_dsp_rs_t;
+
+/**
+ * @brief 初始化采样率转换器，系数表从堆上分配（最大 5 KB）
+ *
+ * @param ch 转换器声道数（1 或 2）
+ * @return false：参数无效、约分后 up 超过 AUDIO_DSP_RS_PHASES_MAX 或内存不足
+ */
+bool audio_dsp_rs_init(audio_dsp_rs_t *rs, uint32_t in_rate, uint32_t out_rate, uint8_t ch);
+
+void audio_dsp_rs_deinit(audio_dsp_rs_t *rs);
+
+/**
+ * @brief 清空历史，用于一段音频播完、下一段开始前
+ */
+void audio_dsp_rs_reset(audio_dsp_rs_t *rs);
+
+/**
+ * @brief 转换交错 PCM，输出帧数达到 out_frames 或输入用完时返回
+ *
+ * 输入先写入内部历史，输出满时历史中可能还有没算完的样点，下次调用（in_frames 可为 0）继续输出。
+ *
+ * @param in_ch 输入声道数，不少于 rs 的声道数，多出的声道在写入时平均混缩
+ * @param in_used 返回消耗的输入帧数，剩余的下次再送
+ * @return 输出帧数（每帧 rs->ch 个样点）
+ */
+size_t audio_dsp_rs_process(audio_dsp_rs_t *rs, const int16_t *in, size_t in_frames, uint8_t in_ch,
+                            size_t *in_used, int16_t *out, size_t out_frames);
+
+/**
+ * @brief 把一路音频乘以增益加到混音累加器上，单声道源加到每个输出声道
+ *
+ * @param acc 交错的 32 位累加器，frames * out_ch 个
+ * @param src_ch 1 或与 out_ch 相同
+ * @param gain Q12，AUDIO_DSP_GAIN_UNITY 为原音量
+ */
+void audio_dsp_mix_add(int32_t *acc, uint8_t out_ch, const int16_t *src, uint8_t src_ch, size_t frames, uint16_t gain);
+
+/**
+ * @brief 累加器饱和为 16 bit 输出
+ */
+void audio_dsp_mix_out(const int32_t *acc, int16_t *out, size_t samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_DSP_H
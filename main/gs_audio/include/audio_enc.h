@@ -0,0 +1,95 @@
+/**
+ * @file audio_enc.h
+ * @brief UAC 麦克风上行的板载音频编码
+ *
+ * mic 回调只把 PCM 拷入预分配的帧并交给编码任务，编码在独立任务中进行，
+ * 编码结果通过回调按包输出，调用方不再直接处理原始 PCM。
+ */
+
+#ifndef AUDIO_ENC_H
+#define AUDIO_ENC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "usb_stream.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_ENC_DEFAULT_FRAME_MS      20
+#define AUDIO_ENC_DEFAULT_FRAME_NUM     4
+#define AUDIO_ENC_DEFAULT_TASK_PRIO     4
+#define AUDIO_ENC_SAMPLE_RATE_MAX       48000   // 预分配按此采样率计算帧长
+#define AUDIO_ENC_PACKET_HDR_LEN        4       // 每包头：预测值 int16 LE、步长索引 u8、保留 u8
+
+typedef enum {
+    AUDIO_ENC_IMA_ADPCM = 0,    // IMA ADPCM，单声道，4 bit/样点，每包自带预测器状态，丢包不影响后续包
+} audio_enc_codec_t;
+
+/**
+ * @brief 一个编码包，data 仅在回调期间有效
+ */
+typedef struct {
+    const uint8_t *data;
+    size_t len;
+    uint32_t seq;               // 连续递增，跳号表示对应 PCM 在编码前已被丢弃
+    uint32_t samples;           // 本包样点数
+    uint32_t sample_rate;
+    int64_t timestamp_us;       // 本包首段 PCM 到达的时间（esp_timer_get_time）
+} audio_enc_packet_t;
+
+/**
+ * @brief 编码包回调（在编码任务中调用，可阻塞；阻塞期间 PCM 继续写入空闲帧，帧用尽时丢弃）
+ */
+typedef void (*audio_enc_packet_cb_t)(const audio_enc_packet_t *packet, void *arg);
+
+typedef struct {
+    audio_enc_codec_t codec;
+    uint8_t channels;           // mic 声道数（1 或 2），双声道先混为单声道再编码
+    uint16_t frame_ms;          // 每包时长，0 使用 AUDIO_ENC_DEFAULT_FRAME_MS
+    uint8_t frame_num;          // 预分配 PCM 帧数，0 使用 AUDIO_ENC_DEFAULT_FRAME_NUM
+    uint8_t task_prio;          // 0 使用 AUDIO_ENC_DEFAULT_TASK_PRIO
+    int8_t task_core;           // -1 不绑核
+    audio_enc_packet_cb_t on_packet;
+    void *arg;
+} audio_enc_config_t;
+
+typedef struct {
+    uint32_t packets;           // 已输出包数
+    uint32_t pcm_dropped;       // 无空闲帧而丢弃的整帧数
+    uint32_t format_err;        // 位深不是 16 bit 而丢弃的 mic 数据次数
+} audio_enc_stats_t;
+
+/**
+ * @brief 预分配 PCM 帧与输出缓冲并创建编码任务
+ */
+esp_err_t audio_enc_start(const audio_enc_config_t *config);
+
+/**
+ * @brief 停止编码任务并释放缓冲，调用前应先停止 mic 输入
+ */
+void audio_enc_stop(void);
+
+/**
+ * @brief mic 回调，直接用作 uac_config_t.mic_cb
+ *
+ * 在 usb_stream 任务中调用，只做拷贝和入队，不会阻塞。采样率取自 frame，变化时丢弃未满的当前帧。
+ */
+void audio_enc_mic_cb(mic_frame_t *frame, void *ptr);
+
+esp_err_t audio_enc_get_stats(audio_enc_stats_t *stats);
+
+/**
+ * @brief 解码一个 IMA ADPCM 包（对端按同一格式编码的下行音频），与编码任务无关，可在任意任务调用
+ *
+ * @return 样点数 (len - AUDIO_ENC_PACKET_HDR_LEN) * 2，超过 max_samples 时截断；包过短返回 0
+ */
+size_t audio_enc_adpcm_decode(const uint8_t *packet, size_t len, int16_t *pcm, size_t max_samples);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_ENC_H
@@ -0,0 +1,105 @@
+/**
+ * @file audio_mix.h
+ * @brief UAC 扬声器下行的多路混音：每路按自己的采样率/声道写入，统一转换为扬声器协商的格式后叠加
+ *
+ * 两类音源：
+ *   流   对讲、云端语音等连续音频，生产者任务按帧写入该路的无锁环形缓冲
+ *   片段 提示音等常驻 flash 的 PCM，直接按指针读取，播完自动释放
+ * 混音任务每个周期从各路取一个周期的数据，转换（audio_dsp）、乘增益、叠加、饱和后
+ * 一次写入 uac_spk_streaming_write，写满时阻塞，由扬声器的消耗速度控制节奏。
+ * 没有活动音源时混音任务休眠，不向扬声器写静音。
+ */
+
+#ifndef AUDIO_MIX_H
+#define AUDIO_MIX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "audio_dsp.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define AUDIO_MIX_SOURCE_MAX            4
+#define AUDIO_MIX_DEFAULT_PERIOD_MS     10
+#define AUDIO_MIX_DEFAULT_TASK_PRIO     5
+#define AUDIO_MIX_DEFAULT_STREAM_MS     200     // 流缓冲时长
+#define AUDIO_MIX_SOURCE_NONE           0xFF
+
+typedef uint8_t audio_mix_source_t;
+
+typedef struct {
+    uint32_t sample_rate;       // 扬声器协商的采样率（uac_frame_size_reset 所设）
+    uint8_t channels;           // 扬声器声道数（1 或 2）
+    uint16_t period_ms;         // 每次写入扬声器的时长，0 使用 AUDIO_MIX_DEFAULT_PERIOD_MS
+    uint8_t task_prio;          // 0 使用 AUDIO_MIX_DEFAULT_TASK_PRIO
+    int8_t task_core;           // -1 不绑核
+} audio_mix_config_t;
+
+typedef struct {
+    uint32_t periods;           // 已写入扬声器的周期数
+    uint32_t underruns;         // 流没有足够数据、以静音补齐的周期数
+    uint32_t write_err;         // 写扬声器失败（未连接或超时）的次数
+    uint32_t stream_dropped;    // 流缓冲满而丢弃的字节数
+} audio_mix_stats_t;
+
+/**
+ * @brief 分配输出缓冲并创建混音任务，扬声器格式变化时先 stop 再以新格式 start
+ */
+esp_err_t audio_mix_start(const audio_mix_config_t *config);
+
+/**
+ * @brief 停止混音任务并关闭所有音源
+ */
+void audio_mix_stop(void);
+
+/**
+ * @brief 打开一路流
+ *
+ * @param sample_rate 输入采样率，与扬声器之比约分后 up 不超过 AUDIO_DSP_RS_PHASES_MAX
+ * @param channels 输入声道数（1 或 2），双声道输入到单声道扬声器时先混缩
+ * @param gain Q12，AUDIO_DSP_GAIN_UNITY 为原音量
+ * @param buf_ms 缓冲时长，0 使用 AUDIO_MIX_DEFAULT_STREAM_MS
+ * @param[out] source 音源句柄
+ */
+esp_err_t audio_mix_stream_open(uint32_t sample_rate, uint8_t channels, uint16_t gain, uint16_t buf_ms,
+                                audio_mix_source_t *source);
+
+/**
+ * @brief 写入交错的 16 bit PCM，只写整帧，缓冲满时丢弃放不下的部分
+ *
+ * 同一路流只能在一个任务中写入，不能与 audio_mix_stream_close 并发。
+ *
+ * @return 写入的字节数
+ */
+size_t audio_mix_stream_write(audio_mix_source_t source, const void *pcm, size_t bytes);
+
+/**
+ * @brief 关闭一路流，缓冲中尚未播放的数据丢弃
+ */
+void audio_mix_stream_close(audio_mix_source_t source);
+
+/**
+ * @brief 播放一段常驻内存的 PCM（提示音），与其它音源叠加，播完自动释放
+ *
+ * @param pcm 交错的 16 bit PCM，播放期间必须有效
+ * @param frames 帧数
+ * @param[out] source 可为 NULL；用于提前 audio_mix_stream_close 或调增益
+ */
+esp_err_t audio_mix_play_clip(const int16_t *pcm, size_t frames, uint32_t sample_rate, uint8_t channels,
+                              uint16_t gain, audio_mix_source_t *source);
+
+/**
+ * @brief 修改一路音源的增益，下一个周期生效
+ */
+esp_err_t audio_mix_set_gain(audio_mix_source_t source, uint16_t gain);
+
+esp_err_t audio_mix_get_stats(audio_mix_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // AUDIO_MIX_H
@@ -0,0 +1,590 @@
+// call.c
+// 双向对讲：MQTT 信令、SRTP/UDP 收发、抖动缓冲播放
+#include "call.h"
+
+#if CONFIG_CALL
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/event_groups.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_random.h"
+#include "esp_heap_caps.h"
+#include "lwip/sockets.h"
+#include "mbedtls/base64.h"
+#include "cJSON.h"
+#include "gs_mqtt.h"
+#include "frame_bus.h"
+#include "usb_stream.h"
+#include "audio_enc.h"
+#include "audio_mix.h"
+#include "call_rtp.h"
+#include "call_srtp.h"
+
+static const char *TAG = "call";
+
+#define CALL_TOPIC_SET          "/service/call"
+#define CALL_TOPIC_EVENT        "/event/call"
+#define CALL_FRAME_MS           20          // 音频包时长，即 audio_enc 帧长
+#define CALL_PKT_MAX            1500
+#define CALL_VIDEO_MTU          1200        // 视频分片的 RTP 负载上限，给隧道/VPN 留出余量
+#define CALL_VIDEO_FRAG_HDR     4           // 分片负载头：本片在帧内的偏移（大端）
+#define CALL_VIDEO_CLOCK_KHZ    90
+#define CALL_VIDEO_WAIT_MS      200         // 结束通话时视频任务的最长响应时间
+#define CALL_PT_AUDIO           97          // audio_enc 的 IMA ADPCM 包，每包自带预测器状态
+#define CALL_PT_VIDEO           98          // 原样分片的 JPEG
+#define CALL_TASK_STACK         4096
+#define CALL_RX_TASK_PRIO       6           // 低于串口收发任务（10），对讲繁忙时不影响开锁协议
+#define CALL_VIDEO_TASK_PRIO    3
+#define CALL_PCM_MAX            (48000 * CALL_FRAME_MS / 1000)
+#define CALL_SPK_STREAM_MS      (CONFIG_CALL_JITTER_MS + 100)
+#define CALL_UAC_SPK_BUF_SIZE   (48000 * 2 * 2 * 40 / 1000)     // 48 kHz 双声道 40 ms
+
+#define CALL_BIT_RX_IDLE        BIT0
+#define CALL_BIT_VIDEO_IDLE     BIT1
+
+typedef struct {
+    uint8_t buf[CALL_PKT_MAX];
+    call_srtp_t srtp;
+    uint32_t ssrc;
+    uint16_t seq;
+    uint32_t ts;
+} call_tx_t;
+
+// 以下在 call_init() 时一次分配
+static call_tx_t *s_audio_tx = NULL;
+static call_tx_t *s_video_tx = NULL;
+static uint8_t *s_rx_buf = NULL;
+static int16_t *s_pcm = NULL;
+static call_jbuf_t *s_jbuf = NULL;
+
+static call_srtp_t s_rx_srtp;
+static uint32_t s_rx_ssrc = 0;
+static bool s_rx_locked = false;            // 已锁定对端音频 SSRC
+static uint32_t s_rx_rate = 0;
+static bool s_video = false;
+static int s_sock = -1;
+static SemaphoreHandle_t s_lock = NULL;     // 通话启停
+static SemaphoreHandle_t s_tx_lock = NULL;  // 发送与关闭套接字互斥
+static EventGroupHandle_t s_evt = NULL;
+static TaskHandle_t s_rx_task = NULL;
+static TaskHandle_t s_video_task = NULL;
+static volatile bool s_active = false;
+static bool s_audio_first = false;
+static audio_mix_source_t s_spk = AUDIO_MIX_SOURCE_NONE;
+static call_stats_t s_stats;
+
+/* -------------------- 发送 -------------------- */
+
+static bool call_send(call_tx_t *tx, size_t len)
+{
+    bool ok = false;
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    if (s_sock >= 0) {
+        size_t n = call_srtp_protect(&tx->srtp, tx->buf, len);
+        ok = n && send(s_sock, tx->buf, n, MSG_DONTWAIT) == (ssize_t)n;
+    }
+    xSemaphoreGive(s_tx_lock);
+    return ok;
+}
+
+// 编码任务中调用。RTP 序号与时间戳都跟随编码序号，编码前丢弃的包在对端表现为丢包，由抖动缓冲补静音
+static void call_audio_packet_cb(const audio_enc_packet_t *packet, void *arg)
+{
+    call_tx_t *tx = s_audio_tx;
+    if (!s_active || packet->len > CALL_PKT_MAX - CALL_RTP_HDR_LEN - CALL_SRTP_TAG_LEN) {
+        return;
+    }
+    call_rtp_hdr_t hdr = {
+        .pt = CALL_PT_AUDIO,
+        .marker = s_audio_first,
+        .seq = (uint16_t)(tx->seq + packet->seq),
+        .ts = tx->ts + packet->seq * packet->samples,
+        .ssrc = tx->ssrc,
+    };
+    call_rtp_write_hdr(tx->buf, &hdr);
+    memcpy(tx->buf + CALL_RTP_HDR_LEN, packet->data, packet->len);
+    if (call_send(tx, CALL_RTP_HDR_LEN + packet->len)) {
+        s_audio_first = false;
+        s_stats.audio_tx++;
+    }
+}
+
+static bool call_send_frame(call_tx_t *tx, const uint8_t *data, size_t len)
+{
+    call_rtp_hdr_t hdr = {
+        .pt = CALL_PT_VIDEO,
+        .ts = tx->ts + (uint32_t)(esp_timer_get_time() * CALL_VIDEO_CLOCK_KHZ / 1000),
+        .ssrc = tx->ssrc,
+    };
+    size_t off = 0;
+    while (off < len) {
+        size_t n = len - off;
+        if (n > CALL_VIDEO_MTU - CALL_VIDEO_FRAG_HDR) {
+            n = CALL_VIDEO_MTU - CALL_VIDEO_FRAG_HDR;
+        }
+        hdr.seq = tx->seq++;
+        hdr.marker = off + n == len;
+        call_rtp_write_hdr(tx->buf, &hdr);
+        uint8_t *p = tx->buf + CALL_RTP_HDR_LEN;
+        p[0] = (uint8_t)(off >> 24);
+        p[1] = (uint8_t)(off >> 16);
+        p[2] = (uint8_t)(off >> 8);
+        p[3] = (uint8_t)off;
+        memcpy(p + CALL_VIDEO_FRAG_HDR, data + off, n);
+        // 发送缓冲满：放弃本帧剩余分片，半帧对端也无法显示
+        if (!call_send(tx, CALL_RTP_HDR_LEN + CALL_VIDEO_FRAG_HDR + n)) {
+            return false;
+        }
+        off += n;
+    }
+    return true;
+}
+
+// 帧广播的订阅者，只在通话中订阅；MJPEG 帧按引用分片发送，不解码、不拷贝整帧
+static void call_video_task(void *arg)
+{
+    for (;;) {
+        xEventGroupSetBits(s_evt, CALL_BIT_VIDEO_IDLE);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (!s_active || !s_video) {
+            continue;
+        }
+        frame_bus_sub_t *sub = frame_bus_subscribe();
+        if (!sub) {
+            ESP_LOGW(TAG, "frame bus full, call without video");
+            continue;
+        }
+        frame_bus_set_interval(sub, 1000 / CONFIG_CALL_VIDEO_FPS);
+        bool congested = false;
+        while (s_active) {
+            camera_fb_t *fb = frame_bus_wait(sub, CALL_VIDEO_WAIT_MS);
+            if (!fb) {
+                continue;
+            }
+            bool ok = call_send_frame(s_video_tx, fb->buf, fb->len);
+            frame_bus_done(sub);
+            if (ok) {
+                s_stats.video_frames++;
+            } else {
+                s_stats.video_drop++;
+            }
+            // 连续发不出时请求降低分辨率，其他订阅者不拥塞时不会生效
+            if (ok == congested) {
+                congested = !ok;
+                frame_bus_set_congested(sub, congested);
+            }
+        }
+        frame_bus_unsubscribe(sub);
+    }
+}
+
+/* -------------------- 接收与播放 -------------------- */
+
+static void call_rx_packet(void)
+{
+    int len = recv(s_sock, s_rx_buf, CALL_PKT_MAX, MSG_DONTWAIT);
+    if (len < CALL_RTP_HDR_LEN + CALL_SRTP_TAG_LEN) {
+        return;
+    }
+    // 负载类型与 SSRC 不加密，先过滤再做认证；只接受一路对端音频，第一个通过认证的包锁定 SSRC
+    uint32_t ssrc = ((uint32_t)s_rx_buf[8] << 24) | ((uint32_t)s_rx_buf[9] << 16) |
+                    ((uint32_t)s_rx_buf[10] << 8) | s_rx_buf[11];
+    if ((s_rx_buf[1] & 0x7F) != CALL_PT_AUDIO || (s_rx_locked && ssrc != s_rx_ssrc)) {
+        s_stats.rx_rejected++;
+        return;
+    }
+    len = call_srtp_unprotect(&s_rx_srtp, s_rx_buf, len);
+    if (len < 0) {
+        s_stats.rx_rejected++;
+        return;
+    }
+    s_rx_locked = true;
+    s_rx_ssrc = ssrc;
+    call_rtp_hdr_t hdr;
+    size_t payload_len = 0;
+    int off = call_rtp_parse(s_rx_buf, len, &hdr, &payload_len);
+    if (off < 0) {
+        s_stats.rx_rejected++;
+        return;
+    }
+    s_stats.rx_packets++;
+    call_jbuf_put(s_jbuf, hdr.seq, s_rx_buf + off, payload_len);
+}
+
+// 每个包周期取一个包解码写入混音；缺包写一个包长的静音，保持扬声器侧的延迟不变
+static void call_play(void)
+{
+    int n = call_jbuf_get(s_jbuf, s_rx_buf, CALL_PKT_MAX);
+    if (n < 0 || s_spk == AUDIO_MIX_SOURCE_NONE) {
+        return;
+    }
+    size_t samples = n > 0 ? audio_enc_adpcm_decode(s_rx_buf, n, s_pcm, CALL_PCM_MAX) : 0;
+    if (samples == 0) {
+        samples = s_rx_rate * CALL_FRAME_MS / 1000;
+        memset(s_pcm, 0, samples * sizeof(int16_t));
+    }
+    audio_mix_stream_write(s_spk, s_pcm, samples * sizeof(int16_t));
+}
+
+// 收包与播放在同一任务：select 的超时即下一个播放时刻，不另设定时器
+static void call_rx_task(void *arg)
+{
+    for (;;) {
+        xEventGroupSetBits(s_evt, CALL_BIT_RX_IDLE);
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t next_us = esp_timer_get_time() + CALL_FRAME_MS * 1000;
+        while (s_active) {
+            int64_t now = esp_timer_get_time();
+            if (next_us > now) {
+                fd_set rfds;
+                FD_ZERO(&rfds);
+                FD_SET(s_sock, &rfds);
+                struct timeval tv = { .tv_sec = 0, .tv_usec = (long)(next_us - now) };
+                if (select(s_sock + 1, &rfds, NULL, NULL, &tv) > 0) {
+                    call_rx_packet();
+                }
+                continue;
+            }
+            call_play();
+            next_us += CALL_FRAME_MS * 1000;
+            // 任务被长时间占用后不连续补播，从当前时刻重新计时
+            if (next_us < now) {
+                next_us = now + CALL_FRAME_MS * 1000;
+            }
+        }
+    }
+}
+
+/* -------------------- 启停 -------------------- */
+
+// 取 UAC 流当前协商的格式
+static esp_err_t call_uac_format(usb_stream_t stream, uint32_t *rate, uint8_t *ch)
+{
+    size_t num = 0;
+    size_t cur = 0;
+    esp_err_t ret = uac_frame_size_list_get(stream, NULL, &num, &cur);
+    if (ret != ESP_OK || num == 0 || cur >= num) {
+        return ret != ESP_OK ? ret : ESP_ERR_NOT_FOUND;
+    }
+    uac_frame_size_t *list = malloc(num * sizeof(uac_frame_size_t));
+    if (!list) {
+        return ESP_ERR_NO_MEM;
+    }
+    ret = uac_frame_size_list_get(stream, list, NULL, NULL);
+    if (ret == ESP_OK) {
+        *rate = list[cur].samples_frequence;
+        *ch = list[cur].ch_num;
+    }
+    free(list);
+    return ret;
+}
+
+// 混音任务第一次通话时按扬声器格式启动，之后一直保留（无音源时休眠）
+static void call_spk_open(void)
+{
+    uint32_t rate = 0;
+    uint8_t ch = 0;
+    if (call_uac_format(STREAM_UAC_SPK, &rate, &ch) != ESP_OK || ch == 0) {
+        ESP_LOGW(TAG, "Speaker not found, call without playback");
+        return;
+    }
+    audio_mix_config_t mix = {
+        .sample_rate = rate,
+        .channels = ch > 2 ? 2 : ch,
+        .task_prio = CALL_RX_TASK_PRIO,
+        .task_core = CONFIG_CALL_TASK_CORE,
+    };
+    esp_err_t ret = audio_mix_start(&mix);
+    if (ret != ESP_OK && ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "audio_mix_start failed: 0x%x", ret);
+        return;
+    }
+    ret = audio_mix_stream_open(s_rx_rate, 1, AUDIO_DSP_GAIN_UNITY, CALL_SPK_STREAM_MS, &s_spk);
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "Speaker stream open failed: 0x%x", ret);
+        s_spk = AUDIO_MIX_SOURCE_NONE;
+    }
+}
+
+static void call_publish_state(const char *state)
+{
+    char buf[96];
+    uint32_t rate = 0;
+    uint8_t ch = 0;
+    call_uac_format(STREAM_UAC_MIC, &rate, &ch);
+    int len = snprintf(buf, sizeof(buf), "{\"state\":\"%s\",\"rate\":%lu,\"video\":%d}",
+                       state, (unsigned long)rate, s_video);
+    gs_mqtt_publish(CALL_TOPIC_EVENT, (uint8_t *)buf, len, GS_MQTT_QOS0, 0);
+}
+
+static void call_session_end(void)
+{
+    if (!s_active) {
+        return;
+    }
+    s_active = false;
+    xEventGroupWaitBits(s_evt, CALL_BIT_RX_IDLE | CALL_BIT_VIDEO_IDLE, pdFALSE, pdTRUE, portMAX_DELAY);
+    usb_streaming_control(STREAM_UAC_MIC, CTRL_SUSPEND, NULL);
+    usb_streaming_control(STREAM_UAC_SPK, CTRL_SUSPEND, NULL);
+    if (s_spk != AUDIO_MIX_SOURCE_NONE) {
+        audio_mix_stream_close(s_spk);
+        s_spk = AUDIO_MIX_SOURCE_NONE;
+    }
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    close(s_sock);
+    s_sock = -1;
+    xSemaphoreGive(s_tx_lock);
+    call_srtp_free(&s_audio_tx->srtp);
+    call_srtp_free(&s_video_tx->srtp);
+    call_srtp_free(&s_rx_srtp);
+
+    s_stats.jbuf_late = s_jbuf->stats.late;
+    s_stats.jbuf_lost = s_jbuf->stats.lost;
+    s_stats.jbuf_rebuffer = s_jbuf->stats.rebuffer;
+    ESP_LOGI(TAG, "Call ended: audio tx %lu, video %lu/%lu dropped, rx %lu rejected %lu, late %lu lost %lu rebuffer %lu",
+             (unsigned long)s_stats.audio_tx, (unsigned long)s_stats.video_frames, (unsigned long)s_stats.video_drop,
+             (unsigned long)s_stats.rx_packets, (unsigned long)s_stats.rx_rejected, (unsigned long)s_stats.jbuf_late,
+             (unsigned long)s_stats.jbuf_lost, (unsigned long)s_stats.jbuf_rebuffer);
+    call_publish_state("idle");
+}
+
+static esp_err_t call_session_begin(const call_params_t *params)
+{
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(params->port),
+    };
+    if (inet_pton(AF_INET, params->host, &addr.sin_addr) != 1) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0) {
+        return ESP_FAIL;
+    }
+    // connect 后只收这个地址发来的包；对端（媒体中继）按收到的源地址回发，穿过 NAT
+    if (connect(sock, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        close(sock);
+        return ESP_FAIL;
+    }
+    if (call_srtp_init(&s_audio_tx->srtp, params->tx_key) != ESP_OK) {
+        close(sock);
+        return ESP_FAIL;
+    }
+    if (call_srtp_init(&s_video_tx->srtp, params->tx_key) != ESP_OK) {
+        call_srtp_free(&s_audio_tx->srtp);
+        close(sock);
+        return ESP_FAIL;
+    }
+    if (call_srtp_init(&s_rx_srtp, params->rx_key) != ESP_OK) {
+        call_srtp_free(&s_audio_tx->srtp);
+        call_srtp_free(&s_video_tx->srtp);
+        close(sock);
+        return ESP_FAIL;
+    }
+
+    // 同一主密钥下两路 SSRC 不同，密钥流不重复
+    s_audio_tx->ssrc = esp_random();
+    s_video_tx->ssrc = s_audio_tx->ssrc ^ 0x5A5A5A5A;
+    s_audio_tx->seq = (uint16_t)esp_random();
+    s_audio_tx->ts = esp_random();
+    s_video_tx->seq = (uint16_t)esp_random();
+    s_video_tx->ts = esp_random();
+    s_audio_first = true;
+    s_rx_locked = false;
+    s_rx_rate = params->rx_rate;
+    s_video = params->video;
+    call_jbuf_init(s_jbuf, CONFIG_CALL_JITTER_MS / CALL_FRAME_MS);
+    memset(&s_stats, 0, sizeof(s_stats));
+
+    xSemaphoreTake(s_tx_lock, portMAX_DELAY);
+    s_sock = sock;
+    xSemaphoreGive(s_tx_lock);
+
+    usb_streaming_control(STREAM_UAC_SPK, CTRL_RESUME, NULL);
+    usb_streaming_control(STREAM_UAC_MIC, CTRL_RESUME, NULL);
+    call_spk_open();
+
+    // 先清空闲位再唤醒，结束通话时不会看到上一通残留的空闲状态
+    xEventGroupClearBits(s_evt, CALL_BIT_RX_IDLE | CALL_BIT_VIDEO_IDLE);
+    s_active = true;
+    xTaskNotifyGive(s_rx_task);
+    xTaskNotifyGive(s_video_task);
+
+    ESP_LOGI(TAG, "Call started with %s:%u, video %d", params->host, params->port, s_video);
+    call_publish_state("active");
+    return ESP_OK;
+}
+
+esp_err_t call_start(const call_params_t *params)
+{
+    if (!params || !params->host || !params->port || !params->rx_rate || params->rx_rate > 48000) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    call_session_end();
+    esp_err_t ret = call_session_begin(params);
+    xSemaphoreGive(s_lock);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Call start failed: 0x%x", ret);
+    }
+    return ret;
+}
+
+void call_stop(void)
+{
+    if (!s_lock) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    call_session_end();
+    xSemaphoreGive(s_lock);
+}
+
+bool call_active(void)
+{
+    return s_active;
+}
+
+esp_err_t call_get_stats(call_stats_t *stats)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    *stats = s_stats;
+    if (s_jbuf) {
+        stats->jbuf_late = s_jbuf->stats.late;
+        stats->jbuf_lost = s_jbuf->stats.lost;
+        stats->jbuf_rebuffer = s_jbuf->stats.rebuffer;
+    }
+    return ESP_OK;
+}
+
+/* -------------------- 信令 -------------------- */
+
+static bool call_json_key(cJSON *root, const char *name, uint8_t *key)
+{
+    cJSON *item = cJSON_GetObjectItem(root, name);
+    size_t olen = 0;
+    return cJSON_IsString(item) &&
+           mbedtls_base64_decode(key, CALL_MASTER_KEY_LEN, &olen, (const unsigned char *)item->valuestring,
+                                 strlen(item->valuestring)) == 0 && olen == CALL_MASTER_KEY_LEN;
+}
+
+// {"op":"start","host":"1.2.3.4","port":5004,"key":"<base64>","peer_key":"<base64>","rate":16000,"video":1}
+// {"op":"stop"}
+static void call_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGW(TAG, "Invalid call message");
+        return;
+    }
+    cJSON *op = cJSON_GetObjectItem(root, "op");
+    if (cJSON_IsString(op) && strcmp(op->valuestring, "stop") == 0) {
+        call_stop();
+    } else if (cJSON_IsString(op) && strcmp(op->valuestring, "start") == 0) {
+        cJSON *host = cJSON_GetObjectItem(root, "host");
+        cJSON *port = cJSON_GetObjectItem(root, "port");
+        cJSON *rate = cJSON_GetObjectItem(root, "rate");
+        cJSON *video = cJSON_GetObjectItem(root, "video");
+        call_params_t params = {
+            .host = cJSON_IsString(host) ? host->valuestring : NULL,
+            .port = cJSON_IsNumber(port) ? (uint16_t)port->valueint : 0,
+            .rx_rate = cJSON_IsNumber(rate) ? (uint32_t)rate->valueint : 16000,
+            .video = !cJSON_IsNumber(video) || video->valueint != 0,
+        };
+        if (!call_json_key(root, "key", params.tx_key) || !call_json_key(root, "peer_key", params.rx_key)) {
+            ESP_LOGW(TAG, "Call keys missing or invalid");
+        } else {
+            call_start(&params);
+        }
+        memset(params.tx_key, 0, sizeof(params.tx_key));
+        memset(params.rx_key, 0, sizeof(params.rx_key));
+    }
+    cJSON_Delete(root);
+}
+
+static void call_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(CALL_TOPIC_SET, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t call_uac_config(void)
+{
+    // 通话之外两个流都挂起，不占 USB 带宽
+    uac_config_t config = {
+        .spk_ch_num = UAC_CH_ANY,
+        .spk_bit_resolution = 16,
+        .spk_samples_frequence = UAC_FREQUENCY_ANY,
+        .spk_buf_size = CALL_UAC_SPK_BUF_SIZE,
+        .mic_ch_num = 1,
+        .mic_bit_resolution = 16,
+        .mic_samples_frequence = UAC_FREQUENCY_ANY,
+        .mic_cb = audio_enc_mic_cb,
+        .mic_cb_arg = NULL,
+        .flags = FLAG_UAC_SPK_SUSPEND_AFTER_START | FLAG_UAC_MIC_SUSPEND_AFTER_START,
+    };
+    return uac_streaming_config(&config);
+}
+
+esp_err_t call_init(void)
+{
+    if (s_lock) {
+        return ESP_OK;
+    }
+    s_audio_tx = heap_caps_calloc(1, sizeof(call_tx_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_video_tx = heap_caps_calloc(1, sizeof(call_tx_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_rx_buf = heap_caps_malloc(CALL_PKT_MAX, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    s_pcm = heap_caps_malloc(CALL_PCM_MAX * sizeof(int16_t), MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    // 抖动缓冲 8 KB，每个包周期只访问一两个槽位，优先放 PSRAM
+    s_jbuf = heap_caps_malloc(sizeof(call_jbuf_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!s_jbuf) {
+        s_jbuf = heap_caps_malloc(sizeof(call_jbuf_t), MALLOC_CAP_8BIT);
+    }
+    s_lock = xSemaphoreCreateMutex();
+    s_tx_lock = xSemaphoreCreateMutex();
+    s_evt = xEventGroupCreate();
+    if (!s_audio_tx || !s_video_tx || !s_rx_buf || !s_pcm || !s_jbuf || !s_lock || !s_tx_lock || !s_evt) {
+        ESP_LOGE(TAG, "Failed to allocate call buffers");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(call_rx_task, "call_rx", CALL_TASK_STACK, NULL, CALL_RX_TASK_PRIO,
+                                &s_rx_task, CONFIG_CALL_TASK_CORE) != pdPASS ||
+        xTaskCreatePinnedToCore(call_video_task, "call_video", CALL_TASK_STACK, NULL, CALL_VIDEO_TASK_PRIO,
+                                &s_video_task, CONFIG_CALL_TASK_CORE) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create call tasks");
+        return ESP_ERR_NO_MEM;
+    }
+    // 编码任务常驻，麦克风挂起时没有数据，任务阻塞等待
+    audio_enc_config_t enc = {
+        .codec = AUDIO_ENC_IMA_ADPCM,
+        .channels = 1,
+        .frame_ms = CALL_FRAME_MS,
+        .task_prio = CALL_RX_TASK_PRIO,
+        .task_core = CONFIG_CALL_TASK_CORE,
+        .on_packet = call_audio_packet_cb,
+    };
+    esp_err_t ret = audio_enc_start(&enc);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "audio_enc_start failed: 0x%x", ret);
+        return ret;
+    }
+    gs_mqtt_register_topic_msg_cb(CALL_TOPIC_SET, call_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, call_event_handler);
+    ESP_LOGI(TAG, "Intercom ready: jitter %d ms, video %d fps, core %d",
+             CONFIG_CALL_JITTER_MS, CONFIG_CALL_VIDEO_FPS, CONFIG_CALL_TASK_CORE);
+    return ESP_OK;
+}
+
+#endif // CONFIG_CALL
@@ -0,0 +1,142 @@
+// call_rtp.c
+// RTP 头与音频抖动缓冲，纯计算，不依赖 ESP-IDF
+#include "call_rtp.h"
+#include <string.h>
+
+#define JBUF_MASK       (CALL_JBUF_SLOTS - 1)
+
+void call_rtp_write_hdr(uint8_t *buf, const call_rtp_hdr_t *hdr)
+{
+    buf[0] = 0x80;                          // V=2，无填充、无扩展、无 CSRC
+    buf[1] = (hdr->marker ? 0x80 : 0) | (hdr->pt & 0x7F);
+    buf[2] = (uint8_t)(hdr->seq >> 8);
+    buf[3] = (uint8_t)hdr->seq;
+    buf[4] = (uint8_t)(hdr->ts >> 24);
+    buf[5] = (uint8_t)(hdr->ts >> 16);
+    buf[6] = (uint8_t)(hdr->ts >> 8);
+    buf[7] = (uint8_t)hdr->ts;
+    buf[8] = (uint8_t)(hdr->ssrc >> 24);
+    buf[9] = (uint8_t)(hdr->ssrc >> 16);
+    buf[10] = (uint8_t)(hdr->ssrc >> 8);
+    buf[11] = (uint8_t)hdr->ssrc;
+}
+
+int call_rtp_parse(const uint8_t *buf, size_t len, call_rtp_hdr_t *hdr, size_t *payload_len)
+{
+    if (len < CALL_RTP_HDR_LEN || (buf[0] >> 6) != 2) {
+        return -1;
+    }
+    size_t off = CALL_RTP_HDR_LEN + (buf[0] & 0x0F) * 4;
+    if (buf[0] & 0x10) {
+        if (off + 4 > len) {
+            return -1;
+        }
+        off += 4 + ((buf[off + 2] << 8) | buf[off + 3]) * 4;
+    }
+    size_t end = len;
+    if (buf[0] & 0x20) {
+        uint8_t pad = buf[len - 1];
+        if (pad == 0 || pad > len) {
+            return -1;
+        }
+        end -= pad;
+    }
+    if (off > end) {
+        return -1;
+    }
+    hdr->marker = buf[1] >> 7;
+    hdr->pt = buf[1] & 0x7F;
+    hdr->seq = (buf[2] << 8) | buf[3];
+    hdr->ts = ((uint32_t)buf[4] << 24) | ((uint32_t)buf[5] << 16) | ((uint32_t)buf[6] << 8) | buf[7];
+    hdr->ssrc = ((uint32_t)buf[8] << 24) | ((uint32_t)buf[9] << 16) | ((uint32_t)buf[10] << 8) | buf[11];
+    *payload_len = end - off;
+    return (int)off;
+}
+
+static void jbuf_clear(call_jbuf_t *jb)
+{
+    for (int i = 0; i < CALL_JBUF_SLOTS; i++) {
+        jb->slot[i].used = false;
+    }
+    jb->count = 0;
+    jb->synced = false;
+    jb->playing = false;
+}
+
+void call_jbuf_init(call_jbuf_t *jb, uint8_t depth)
+{
+    if (depth < 1) {
+        depth = 1;
+    } else if (depth > CALL_JBUF_SLOTS / 2) {
+        depth = CALL_JBUF_SLOTS / 2;
+    }
+    jb->depth = depth;
+    jb->play_seq = 0;
+    memset(&jb->stats, 0, sizeof(jb->stats));
+    jbuf_clear(jb);
+}
+
+bool call_jbuf_put(call_jbuf_t *jb, uint16_t seq, const uint8_t *data, size_t len)
+{
+    if (len > CALL_JBUF_PAYLOAD_MAX) {
+        return false;
+    }
+    if (!jb->synced) {
+        jb->play_seq = seq;
+        jb->synced = true;
+    }
+    int16_t d = (int16_t)(seq - jb->play_seq);
+    if (d < 0) {
+        jb->stats.late++;
+        return false;
+    }
+    if (d >= CALL_JBUF_SLOTS) {
+        // 超出窗口：对端序号跳变或中断太久，缓冲中的包已无意义
+        jb->stats.overflow++;
+        jbuf_clear(jb);
+        jb->play_seq = seq;
+        jb->synced = true;
+    }
+    call_jbuf_slot_t *s = &jb->slot[seq & JBUF_MASK];
+    if (s->used) {
+        // 窗口小于槽位数，占用同一槽位的只可能是同一个序号
+        jb->stats.dup++;
+        return false;
+    }
+    memcpy(s->data, data, len);
+    s->len = len;
+    s->seq = seq;
+    s->used = true;
+    jb->count++;
+    return true;
+}
+
+int call_jbuf_get(call_jbuf_t *jb, uint8_t *out, size_t out_size)
+{
+    if (!jb->playing) {
+        if (jb->count < jb->depth) {
+            return -1;
+        }
+        // 从最早的包开始播放，开头缺的包不计丢失
+        while (!jb->slot[jb->play_seq & JBUF_MASK].used) {
+            jb->play_seq++;
+        }
+        jb->playing = true;
+    }
+    call_jbuf_slot_t *s = &jb->slot[jb->play_seq & JBUF_MASK];
+    jb->play_seq++;
+    if (!s->used) {
+        jb->stats.lost++;
+        if (jb->count == 0) {
+            // 取空：重新攒包，早于 play_seq 的包仍算过期
+            jb->playing = false;
+            jb->stats.rebuffer++;
+        }
+        return 0;
+    }
+    s->used = false;
+    jb->count--;
+    size_t n = s->len < out_size ? s->len : out_size;
+    memcpy(out, s->data, n);
+    return (int)n;
+}
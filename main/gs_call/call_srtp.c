@@ -0,0 +1,197 @@
+// call_srtp.c
+// SRTP AES_CM_128_HMAC_SHA1_80（RFC 3711），密钥导出率为 0，只导出一次会话密钥
+#include "call_srtp.h"
+#include <string.h>
+
+#define SRTP_LABEL_ENC      0x00
+#define SRTP_LABEL_AUTH     0x01
+#define SRTP_LABEL_SALT     0x02
+#define SRTP_AUTH_KEY_LEN   20
+#define SRTP_REPLAY_WINDOW  64
+
+// RTP 头长度（含 CSRC 与扩展头），格式错误返回 0
+static size_t srtp_hdr_len(const uint8_t *pkt, size_t len)
+{
+    if (len < 12 || (pkt[0] >> 6) != 2) {
+        return 0;
+    }
+    size_t off = 12 + (pkt[0] & 0x0F) * 4;
+    if (pkt[0] & 0x10) {
+        if (off + 4 > len) {
+            return 0;
+        }
+        off += 4 + ((pkt[off + 2] << 8) | pkt[off + 3]) * 4;
+    }
+    return off <= len ? off : 0;
+}
+
+// 会话密钥导出（4.3.1）：以主密钥做 AES-CM，IV 为主盐与 label 异或（r = 0），计数从 0 开始
+static int srtp_derive(mbedtls_aes_context *master, const uint8_t *master_salt, uint8_t label,
+                       uint8_t *out, size_t len)
+{
+    uint8_t iv[16] = {0};
+    uint8_t stream[16];
+    size_t nc_off = 0;
+    memcpy(iv, master_salt, CALL_SRTP_SALT_LEN);
+    iv[7] ^= label;
+    memset(out, 0, len);
+    return mbedtls_aes_crypt_ctr(master, len, &nc_off, iv, stream, out, out);
+}
+
+esp_err_t call_srtp_init(call_srtp_t *ctx, const uint8_t master[CALL_SRTP_MASTER_LEN])
+{
+    uint8_t key[CALL_SRTP_KEY_LEN];
+    uint8_t auth[SRTP_AUTH_KEY_LEN];
+    mbedtls_aes_context m;
+    int ret;
+
+    memset(ctx, 0, sizeof(*ctx));
+    mbedtls_aes_init(&ctx->aes);
+    mbedtls_md_init(&ctx->hmac);
+    mbedtls_aes_init(&m);
+    ret = mbedtls_aes_setkey_enc(&m, master, 128);
+    if (ret == 0) {
+        ret = srtp_derive(&m, master + CALL_SRTP_KEY_LEN, SRTP_LABEL_ENC, key, sizeof(key));
+    }
+    if (ret == 0) {
+        ret = srtp_derive(&m, master + CALL_SRTP_KEY_LEN, SRTP_LABEL_AUTH, auth, sizeof(auth));
+    }
+    if (ret == 0) {
+        ret = srtp_derive(&m, master + CALL_SRTP_KEY_LEN, SRTP_LABEL_SALT, ctx->salt, sizeof(ctx->salt));
+    }
+    mbedtls_aes_free(&m);
+    if (ret == 0) {
+        ret = mbedtls_aes_setkey_enc(&ctx->aes, key, 128);
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_setup(&ctx->hmac, mbedtls_md_info_from_type(MBEDTLS_MD_SHA1), 1);
+    }
+    if (ret == 0) {
+        ret = mbedtls_md_hmac_starts(&ctx->hmac, auth, sizeof(auth));
+    }
+    memset(key, 0, sizeof(key));
+    memset(auth, 0, sizeof(auth));
+    if (ret != 0) {
+        call_srtp_free(ctx);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+void call_srtp_free(call_srtp_t *ctx)
+{
+    mbedtls_aes_free(&ctx->aes);
+    mbedtls_md_free(&ctx->hmac);
+    memset(ctx->salt, 0, sizeof(ctx->salt));
+}
+
+// 负载加解密（4.1.1）：IV = 会话盐 ^ (SSRC << 64) ^ (索引 << 16)
+static void srtp_crypt(call_srtp_t *ctx, uint8_t *pkt, size_t hdr_len, size_t len, uint32_t roc)
+{
+    uint8_t iv[16] = {0};
+    uint8_t stream[16];
+    size_t nc_off = 0;
+    memcpy(iv, ctx->salt, CALL_SRTP_SALT_LEN);
+    for (int i = 0; i < 4; i++) {
+        iv[4 + i] ^= pkt[8 + i];
+    }
+    iv[8] ^= (uint8_t)(roc >> 24);
+    iv[9] ^= (uint8_t)(roc >> 16);
+    iv[10] ^= (uint8_t)(roc >> 8);
+    iv[11] ^= (uint8_t)roc;
+    iv[12] ^= pkt[2];
+    iv[13] ^= pkt[3];
+    mbedtls_aes_crypt_ctr(&ctx->aes, len - hdr_len, &nc_off, iv, stream, pkt + hdr_len, pkt + hdr_len);
+}
+
+// 认证标签（4.2）：HMAC-SHA1(包 || ROC) 取前 80 位
+static void srtp_tag(call_srtp_t *ctx, const uint8_t *pkt, size_t len, uint32_t roc, uint8_t *tag)
+{
+    uint8_t roc_be[4] = { (uint8_t)(roc >> 24), (uint8_t)(roc >> 16), (uint8_t)(roc >> 8), (uint8_t)roc };
+    uint8_t mac[20];
+    mbedtls_md_hmac_reset(&ctx->hmac);
+    mbedtls_md_hmac_update(&ctx->hmac, pkt, len);
+    mbedtls_md_hmac_update(&ctx->hmac, roc_be, sizeof(roc_be));
+    mbedtls_md_hmac_finish(&ctx->hmac, mac);
+    memcpy(tag, mac, CALL_SRTP_TAG_LEN);
+}
+
+size_t call_srtp_protect(call_srtp_t *ctx, uint8_t *pkt, size_t len)
+{
+    size_t hdr_len = srtp_hdr_len(pkt, len);
+    if (!hdr_len) {
+        return 0;
+    }
+    // 发送端序号连续递增，回绕即 ROC 加一
+    uint16_t seq = (pkt[2] << 8) | pkt[3];
+    if (ctx->seq_valid && seq < ctx->s_l) {
+        ctx->roc++;
+    }
+    ctx->s_l = seq;
+    ctx->seq_valid = true;
+    srtp_crypt(ctx, pkt, hdr_len, len, ctx->roc);
+    srtp_tag(ctx, pkt, len, ctx->roc, pkt + len);
+    return len + CALL_SRTP_TAG_LEN;
+}
+
+int call_srtp_unprotect(call_srtp_t *ctx, uint8_t *pkt, size_t len)
+{
+    if (len < CALL_SRTP_TAG_LEN) {
+        return -1;
+    }
+    len -= CALL_SRTP_TAG_LEN;
+    size_t hdr_len = srtp_hdr_len(pkt, len);
+    if (!hdr_len) {
+        return -1;
+    }
+    uint16_t seq = (pkt[2] << 8) | pkt[3];
+
+    // 索引估计（附录 A）
+    uint32_t v = ctx->roc;
+    if (ctx->seq_valid) {
+        if (ctx->s_l < 32768) {
+            if (seq - ctx->s_l > 32768) {
+                v = ctx->roc - 1;
+            }
+        } else if (ctx->s_l - 32768 > seq) {
+            v = ctx->roc + 1;
+        }
+    }
+    uint64_t index = ((uint64_t)v << 16) | seq;
+    uint64_t top = ((uint64_t)ctx->roc << 16) | ctx->s_l;
+
+    // 先查重放，免得对重放包做 HMAC
+    if (ctx->seq_valid && index <= top) {
+        uint64_t d = top - index;
+        if (d >= SRTP_REPLAY_WINDOW || (ctx->replay & (1ULL << d))) {
+            return -1;
+        }
+    }
+
+    uint8_t tag[CALL_SRTP_TAG_LEN];
+    srtp_tag(ctx, pkt, len, v, tag);
+    // 定长比较，不因第一个不同字节提前返回
+    uint8_t diff = 0;
+    for (int i = 0; i < CALL_SRTP_TAG_LEN; i++) {
+        diff |= tag[i] ^ pkt[len + i];
+    }
+    if (diff) {
+        return -1;
+    }
+
+    if (!ctx->seq_valid) {
+        ctx->replay = 1;
+        ctx->roc = v;
+        ctx->s_l = seq;
+        ctx->seq_valid = true;
+    } else if (index > top) {
+        uint64_t d = index - top;
+        ctx->replay = d < SRTP_REPLAY_WINDOW ? (ctx->replay << d) | 1 : 1;
+        ctx->roc = v;
+        ctx->s_l = seq;
+    } else {
+        ctx->replay |= 1ULL << (top - index);
+    }
+    srtp_crypt(ctx, pkt, hdr_len, len, v);
+    return (int)len;
+}
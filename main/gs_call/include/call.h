@@ -0,0 +1,89 @@
+/**
+ * @file call.h
+ * @brief 双向对讲（CONFIG_CALL）：UAC 麦克风/扬声器与 UVC 视频经 SRTP/UDP 与对端实时互通
+ *
+ * 信令走 MQTT（/service/call），通话建立后媒体直接发往对端的 UDP 地址：
+ *   上行音频  麦克风 PCM -> audio_enc（IMA ADPCM，20 ms 一包）-> RTP -> SRTP
+ *   上行视频  帧广播上的 MJPEG 帧原样分片（不重新编码）-> RTP -> SRTP，可关闭
+ *   下行音频  SRTP -> RTP -> 抖动缓冲（call_rtp.h）-> ADPCM 解码 -> audio_mix 转换到扬声器格式
+ *
+ * 收发任务与编码任务在 call_init() 时一次建好并绑定到 CONFIG_CALL_TASK_CORE，优先级低于串口任务，
+ * 包缓冲、抖动缓冲同时预分配；通话之间任务阻塞等待，UAC 两个流保持挂起，不占 USB 带宽。
+ */
+
+#ifndef CALL_H
+#define CALL_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALL_MASTER_KEY_LEN     30          // SRTP 主密钥 16 字节 + 盐 14 字节
+
+typedef struct {
+    const char *host;                       // 对端 IPv4 地址
+    uint16_t port;
+    uint8_t tx_key[CALL_MASTER_KEY_LEN];    // 本端发送
+    uint8_t rx_key[CALL_MASTER_KEY_LEN];    // 对端发送
+    uint32_t rx_rate;                       // 对端音频采样率
+    bool video;
+} call_params_t;
+
+typedef struct {
+    uint32_t audio_tx;          // 已发送的音频包
+    uint32_t video_frames;      // 完整发出的视频帧
+    uint32_t video_drop;        // 发送缓冲满而放弃的视频帧
+    uint32_t rx_packets;        // 通过认证的下行包
+    uint32_t rx_rejected;       // 认证失败、重放或格式错误
+    uint32_t jbuf_late;
+    uint32_t jbuf_lost;
+    uint32_t jbuf_rebuffer;
+} call_stats_t;
+
+#if CONFIG_CALL
+
+/**
+ * @brief 配置 UAC 麦克风与扬声器（启动后挂起），须在 usb_streaming_start() 之前调用
+ */
+esp_err_t call_uac_config(void);
+
+/**
+ * @brief 预分配缓冲、创建收发任务并登记 MQTT 信令
+ */
+esp_err_t call_init(void);
+
+/**
+ * @brief 开始通话，已在通话中时先结束上一通
+ */
+esp_err_t call_start(const call_params_t *params);
+
+/**
+ * @brief 结束通话，等待收发任务停下后关闭套接字
+ */
+void call_stop(void);
+
+bool call_active(void);
+
+esp_err_t call_get_stats(call_stats_t *stats);
+
+#else
+
+static inline esp_err_t call_uac_config(void) { return ESP_OK; }
+static inline esp_err_t call_init(void) { return ESP_OK; }
+static inline esp_err_t call_start(const call_params_t *params) { return ESP_ERR_NOT_SUPPORTED; }
+static inline void call_stop(void) {}
+static inline bool call_active(void) { return false; }
+static inline esp_err_t call_get_stats(call_stats_t *stats) { return ESP_ERR_NOT_SUPPORTED; }
+
+#endif // CONFIG_CALL
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CALL_H
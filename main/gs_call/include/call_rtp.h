@@ -0,0 +1,96 @@
+/**
+ * @file call_rtp.h
+ * @brief 对讲媒体的 RTP 打包与音频抖动缓冲，不依赖 ESP-IDF，主机测试直接编译（test_apps/host_test）
+ *
+ * 抖动缓冲按序号放入固定槽位（CALL_JBUF_SLOTS 个，序号取模），不分配内存、不排序。
+ * 播放端每个包周期取一次：先攒够 depth 个包再开始播放，之后按序号逐个取出，
+ * 缺失的包返回 0 由调用方补静音；缓冲取空后重新攒包，网络恢复后延迟回到 depth。
+ */
+
+#ifndef CALL_RTP_H
+#define CALL_RTP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALL_RTP_HDR_LEN        12
+#define CALL_JBUF_SLOTS         16      // 2 的幂，20 ms 一包时可缓冲 320 ms
+#define CALL_JBUF_PAYLOAD_MAX   512     // 48 kHz 单声道 20 ms 的 ADPCM 为 484 字节
+
+typedef struct {
+    uint8_t pt;
+    bool marker;
+    uint16_t seq;
+    uint32_t ts;
+    uint32_t ssrc;
+} call_rtp_hdr_t;
+
+/**
+ * @brief 写 12 字节 RTP 固定头（无 CSRC、无扩展）
+ */
+void call_rtp_write_hdr(uint8_t *buf, const call_rtp_hdr_t *hdr);
+
+/**
+ * @brief 解析 RTP 头，跳过 CSRC 与扩展头，去掉填充
+ *
+ * @param[out] payload_len 负载长度
+ * @return 负载在 buf 中的偏移，格式错误返回 -1
+ */
+int call_rtp_parse(const uint8_t *buf, size_t len, call_rtp_hdr_t *hdr, size_t *payload_len);
+
+typedef struct {
+    uint16_t len;
+    uint16_t seq;
+    bool used;
+    uint8_t data[CALL_JBUF_PAYLOAD_MAX];
+} call_jbuf_slot_t;
+
+typedef struct {
+    uint32_t late;          // 到达时已过播放时刻而丢弃
+    uint32_t lost;          // 播放时缺失
+    uint32_t dup;           // 重复
+    uint32_t overflow;      // 超前太多（对端重启或长时间中断）而清空重来
+    uint32_t rebuffer;      // 取空后重新攒包
+} call_jbuf_stats_t;
+
+typedef struct {
+    uint8_t depth;          // 开始播放前攒的包数
+    uint8_t count;
+    bool synced;            // play_seq 有效；收到第一个包或清空重来时取该包的序号
+    bool playing;
+    uint16_t play_seq;      // 下一个要播放的序号，早于它的包都算过期
+    call_jbuf_stats_t stats;
+    call_jbuf_slot_t slot[CALL_JBUF_SLOTS];
+} call_jbuf_t;
+
+/**
+ * @brief 清空缓冲
+ *
+ * @param depth 开始播放前攒的包数（1 ~ CALL_JBUF_SLOTS / 2），即目标延迟
+ */
+void call_jbuf_init(call_jbuf_t *jb, uint8_t depth);
+
+/**
+ * @brief 放入一个包，过期、重复或过长时丢弃
+ *
+ * @return true 已放入
+ */
+bool call_jbuf_put(call_jbuf_t *jb, uint16_t seq, const uint8_t *data, size_t len);
+
+/**
+ * @brief 每个包周期调用一次，取出下一个要播放的包
+ *
+ * @return 包长度；0 该包缺失（已计入 lost，调用方补一个包长的静音）；-1 尚在攒包，不播放
+ */
+int call_jbuf_get(call_jbuf_t *jb, uint8_t *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CALL_RTP_H
@@ -0,0 +1,65 @@
+/**
+ * @file call_srtp.h
+ * @brief SRTP（RFC 3711）AES_CM_128_HMAC_SHA1_80，只做 RTP，不做 SRTCP
+ *
+ * 每个方向、每个 SSRC 一个上下文：发送端各路（音频、视频）用各自的 SSRC，
+ * 接收端按对端的 SSRC 各建一个。主密钥 16 字节 + 盐 14 字节，会话密钥在 init 时
+ * 一次导出（密钥导出率为 0），加解密在原缓冲上进行，不分配内存。
+ */
+
+#ifndef CALL_SRTP_H
+#define CALL_SRTP_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "mbedtls/aes.h"
+#include "mbedtls/md.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define CALL_SRTP_KEY_LEN       16
+#define CALL_SRTP_SALT_LEN      14
+#define CALL_SRTP_MASTER_LEN    (CALL_SRTP_KEY_LEN + CALL_SRTP_SALT_LEN)
+#define CALL_SRTP_TAG_LEN       10
+
+typedef struct {
+    mbedtls_aes_context aes;
+    mbedtls_md_context_t hmac;          // 已用会话认证密钥 starts，每包 reset
+    uint8_t salt[CALL_SRTP_SALT_LEN];
+    uint32_t roc;                       // 序号回绕计数
+    uint16_t s_l;                       // 已认证的最大序号
+    bool seq_valid;                     // 接收端尚未收到过包
+    uint64_t replay;                    // 接收端重放窗口，bit n 表示 s_l - n 已收到
+} call_srtp_t;
+
+/**
+ * @param master 主密钥 16 字节后接主盐 14 字节
+ */
+esp_err_t call_srtp_init(call_srtp_t *ctx, const uint8_t master[CALL_SRTP_MASTER_LEN]);
+
+void call_srtp_free(call_srtp_t *ctx);
+
+/**
+ * @brief 原地加密 RTP 负载并追加 10 字节认证标签
+ *
+ * @param pkt 完整的 RTP 包，缓冲至少 len + CALL_SRTP_TAG_LEN
+ * @return SRTP 包长度；不是有效的 RTP 包返回 0
+ */
+size_t call_srtp_protect(call_srtp_t *ctx, uint8_t *pkt, size_t len);
+
+/**
+ * @brief 校验标签、检查重放并原地解密，之后再用 call_rtp_parse 解析（填充在加密部分中）
+ *
+ * @return 去掉标签后的 RTP 包长度；认证失败、重放或格式错误返回 -1
+ */
+int call_srtp_unprotect(call_srtp_t *ctx, uint8_t *pkt, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CALL_SRTP_H
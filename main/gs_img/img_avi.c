@@ -0,0 +1,273 @@
+// img_avi.c
+// MJPEG AVI 流式封装：帧数据边写边交出，只保留索引，结束时写 idx1 并按需回写文件头
+#include "img_avi.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "string.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+static const char *TAG = "img_avi";
+
+// 文件头布局：RIFF/hdrl(avih, strl(strh, strf))/movi，共 224 字节
+#define AVI_HDR_SIZE            224
+#define AVI_HDRL_SIZE           192
+#define AVI_STRL_SIZE           116
+#define AVI_OFS_RIFF_SIZE       4
+#define AVI_OFS_TOTAL_FRAMES    48      // avih.dwTotalFrames
+#define AVI_OFS_LENGTH          140     // strh.dwLength
+#define AVI_OFS_MOVI_SIZE       216
+#define AVI_MOVI_FOURCC_POS     220     // idx1 偏移的基准：'movi' 所在位置
+
+#define AVIF_HASINDEX           0x00000010
+#define AVIIF_KEYFRAME          0x00000010
+
+typedef struct {
+    uint32_t ckid;
+    uint32_t flags;
+    uint32_t offset;
+    uint32_t size;
+} avi_index_t;
+
+struct img_avi {
+    img_avi_config_t cfg;
+    avi_index_t *index;
+    uint32_t frames;
+    uint32_t movi_size;             // 'movi' 之后已写的字节数
+    uint32_t max_frame_len;
+    bool header_written;
+};
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static inline void put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+}
+
+static inline uint32_t fourcc(const char *s)
+{
+    return s[0] | (s[1] << 8) | (s[2] << 16) | ((uint32_t)s[3] << 24);
+}
+
+// 从 SOFn 段取图像尺寸
+static bool jpeg_get_size(const uint8_t *jpg, size_t len, uint16_t *w, uint16_t *h)
+{
+    size_t i = 2;
+    while (i + 9 <= len) {
+        if (jpg[i] != 0xFF) {
+            return false;
+        }
+        uint8_t marker = jpg[i + 1];
+        if (marker == 0xFF) {
+            i++;
+            continue;
+        }
+        if (marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7)) {
+            i += 2;
+            continue;
+        }
+        if (marker >= 0xC0 && marker <= 0xCF && marker != 0xC4 && marker != 0xC8 && marker != 0xCC) {
+            *h = (jpg[i + 5] << 8) | jpg[i + 6];
+            *w = (jpg[i + 7] << 8) | jpg[i + 8];
+            return true;
+        }
+        if (marker == 0xDA) {
+            return false;
+        }
+        i += 2 + ((jpg[i + 2] << 8) | jpg[i + 3]);
+    }
+    return false;
+}
+
+static esp_err_t avi_write_header(img_avi_t *avi, uint16_t w, uint16_t h)
+{
+    uint8_t hdr[AVI_HDR_SIZE] = {0};
+    uint8_t *p = hdr;
+
+    memcpy(p, "RIFF", 4);
+    memcpy(p + 8, "AVI ", 4);
+    memcpy(p + 12, "LIST", 4);
+    put_le32(p + 16, AVI_HDRL_SIZE);
+    memcpy(p + 20, "hdrl", 4);
+
+    // avih
+    p = hdr + 24;
+    memcpy(p, "avih", 4);
+    put_le32(p + 4, 56);
+    put_le32(p + 8, avi->cfg.frame_us);
+    put_le32(p + 20, AVIF_HASINDEX);
+    put_le32(p + 32, 1);                    // dwStreams
+    put_le32(p + 40, w);
+    put_le32(p + 44, h);
+
+    // strl / strh
+    p = hdr + 88;
+    memcpy(p, "LIST", 4);
+    put_le32(p + 4, AVI_STRL_SIZE);
+    memcpy(p + 8, "strl", 4);
+    memcpy(p + 12, "strh", 4);
+    put_le32(p + 16, 56);
+    memcpy(p + 20, "vids", 4);
+    memcpy(p + 24, "MJPG", 4);
+    put_le32(p + 40, avi->cfg.frame_us);    // dwScale / dwRate = 帧间隔
+    put_le32(p + 44, 1000000);
+    put_le32(p + 60, 0xFFFFFFFF);           // dwQuality 未知
+    put_le16(p + 72, w);                    // rcFrame.right / bottom
+    put_le16(p + 74, h);
+
+    // strf：BITMAPINFOHEADER
+    p = hdr + 164;
+    memcpy(p, "strf", 4);
+    put_le32(p + 4, 40);
+    put_le32(p + 8, 40);
+    put_le32(p + 12, w);
+    put_le32(p + 16, h);
+    put_le16(p + 20, 1);
+    put_le16(p + 22, 24);
+    memcpy(p + 24, "MJPG", 4);
+    put_le32(p + 28, (uint32_t)w * h * 3);
+
+    memcpy(hdr + 212, "LIST", 4);
+    memcpy(hdr + 220, "movi", 4);
+    put_le32(hdr + AVI_OFS_MOVI_SIZE, 0);
+
+    esp_err_t ret = avi->cfg.write(avi->cfg.ctx, hdr, sizeof(hdr));
+    if (ret == ESP_OK) {
+        avi->header_written = true;
+        avi->movi_size = 4;
+    }
+    return ret;
+}
+
+esp_err_t img_avi_open(const img_avi_config_t *config, img_avi_t **out)
+{
+    if (!config || !config->write || !config->frame_us || !config->max_frames || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    img_avi_t *avi = calloc(1, sizeof(img_avi_t));
+    if (!avi) {
+        return ESP_ERR_NO_MEM;
+    }
+    avi->index = heap_caps_malloc(config->max_frames * sizeof(avi_index_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!avi->index) {
+        free(avi);
+        return ESP_ERR_NO_MEM;
+    }
+    avi->cfg = *config;
+    *out = avi;
+    return ESP_OK;
+}
+
+esp_err_t img_avi_add_frame(img_avi_t *avi, const uint8_t *jpg, size_t len)
+{
+    if (!avi) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (avi->frames >= avi->cfg.max_frames) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    if (!jpg) {
+        len = 0;
+    }
+    if (!avi->header_written) {
+        uint16_t w, h;
+        // 空帧不能作为第一帧，尺寸要从第一帧 JPEG 中取
+        if (!jpg || !jpeg_get_size(jpg, len, &w, &h)) {
+            return ESP_ERR_INVALID_STATE;
+        }
+        esp_err_t ret = avi_write_header(avi, w, h);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    uint8_t ck[8];
+    memcpy(ck, "00dc", 4);
+    put_le32(ck + 4, len);
+    esp_err_t ret = avi->cfg.write(avi->cfg.ctx, ck, sizeof(ck));
+    if (ret == ESP_OK && len) {
+        ret = avi->cfg.write(avi->cfg.ctx, jpg, len);
+    }
+    if (ret == ESP_OK && (len & 1)) {
+        // 块按偶数字节对齐
+        static const uint8_t pad = 0;
+        ret = avi->cfg.write(avi->cfg.ctx, &pad, 1);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    avi_index_t *idx = &avi->index[avi->frames++];
+    idx->ckid = fourcc("00dc");
+    idx->flags = len ? AVIIF_KEYFRAME : 0;
+    idx->offset = avi->movi_size;
+    idx->size = len;
+    avi->movi_size += sizeof(ck) + len + (len & 1);
+    if (len > avi->max_frame_len) {
+        avi->max_frame_len = len;
+    }
+    return ESP_OK;
+}
+
+uint32_t img_avi_frame_count(const img_avi_t *avi)
+{
+    return avi ? avi->frames : 0;
+}
+
+esp_err_t img_avi_close(img_avi_t *avi, size_t *total)
+{
+    if (!avi) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_err_t ret = ESP_ERR_INVALID_STATE;
+    if (avi->header_written) {
+        uint8_t ck[8];
+        uint32_t idx_size = avi->frames * sizeof(avi_index_t);
+        memcpy(ck, "idx1", 4);
+        put_le32(ck + 4, idx_size);
+        ret = avi->cfg.write(avi->cfg.ctx, ck, sizeof(ck));
+        if (ret == ESP_OK && idx_size) {
+            ret = avi->cfg.write(avi->cfg.ctx, avi->index, idx_size);
+        }
+        uint32_t file_size = AVI_MOVI_FOURCC_POS + avi->movi_size + sizeof(ck) + idx_size;
+        if (ret == ESP_OK && avi->cfg.patch) {
+            uint8_t v[4];
+            put_le32(v, file_size - 8);
+            ret = avi->cfg.patch(avi->cfg.ctx, AVI_OFS_RIFF_SIZE, v, 4);
+            put_le32(v, avi->frames);
+            if (ret == ESP_OK) {
+                ret = avi->cfg.patch(avi->cfg.ctx, AVI_OFS_TOTAL_FRAMES, v, 4);
+            }
+            if (ret == ESP_OK) {
+                ret = avi->cfg.patch(avi->cfg.ctx, AVI_OFS_LENGTH, v, 4);
+            }
+            put_le32(v, avi->movi_size);
+            if (ret == ESP_OK) {
+                ret = avi->cfg.patch(avi->cfg.ctx, AVI_OFS_MOVI_SIZE, v, 4);
+            }
+        }
+        if (total) {
+            *total = file_size;
+        }
+        ESP_LOGD(TAG, "%u frames, %u bytes, largest frame %u", (unsigned)avi->frames, (unsigned)file_size,
+                 (unsigned)avi->max_frame_len);
+    }
+    img_avi_abort(avi);
+    return ret;
+}
+
+void img_avi_abort(img_avi_t *avi)
+{
+    if (avi) {
+        free(avi->index);
+        free(avi);
+    }
+}
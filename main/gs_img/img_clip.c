@@ -0,0 +1,356 @@
+// img_clip.c
+// 事件短视频：预录帧 + 事件后的实时帧封装为 MJPEG AVI，写入 flash 暂存或直接分块上传
+#include "img_clip.h"
+#include "sdkconfig.h"
+
+#if CONFIG_IMG_CLIP
+
+#include "img_avi.h"
+#include "img_preroll.h"
+#include "img_upload.h"
+#include "img_upload_queue.h"
+#include "frame_bus.h"
+#include "evt_log.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <dirent.h>
+
+static const char *TAG = "img_clip";
+
+#define CLIP_TASK_STACK         4096
+#define CLIP_TASK_PRIO          3
+#define CLIP_WAIT_MS            200
+#define CLIP_FRAME_US           (1000000 / CONFIG_IMG_CLIP_FPS)
+// 索引容量：按帧率计的总帧数，多留两帧给时隙取整
+#define CLIP_MAX_FRAMES         ((CONFIG_IMG_CLIP_PRE_MS + CONFIG_IMG_CLIP_POST_MS) * CONFIG_IMG_CLIP_FPS / 1000 + 2)
+#define CLIP_PRE_MAX            32
+#define CLIP_FILE_PREFIX        "clip"
+#define CLIP_UPLOAD_BUF_SIZE    4096
+#define CLIP_CONTENT_TYPE       "video/x-msvideo"
+
+#define CLIP_NOTIFY_TRIGGER     (1 << 0)
+#define CLIP_NOTIFY_KICK        (1 << 1)
+
+// 录制中帧的时间轴：第一帧为 0 号时隙，之后每帧落到 (ts - t0) / CLIP_FRAME_US
+typedef struct {
+    img_avi_t *avi;
+    int64_t t0;
+    uint32_t next_slot;
+} clip_timeline_t;
+
+static TaskHandle_t s_task = NULL;
+static volatile int64_t s_trigger_us = 0;
+static volatile bool s_recording = false;
+static uint32_t s_file_seq = 1;
+
+// 按时间轴写入一帧：同一时隙已有帧则跳过，前面空出的时隙补空帧
+static esp_err_t clip_add(clip_timeline_t *tl, int64_t ts, const uint8_t *jpg, size_t len)
+{
+    if (img_avi_frame_count(tl->avi) == 0) {
+        tl->t0 = ts;
+    }
+    if (ts < tl->t0) {
+        return ESP_OK;
+    }
+    uint32_t slot = (ts - tl->t0) / CLIP_FRAME_US;
+    if (slot < tl->next_slot) {
+        return ESP_OK;
+    }
+    esp_err_t ret = ESP_OK;
+    while (ret == ESP_OK && tl->next_slot < slot) {
+        ret = img_avi_add_frame(tl->avi, NULL, 0);
+        tl->next_slot++;
+    }
+    if (ret == ESP_OK) {
+        ret = img_avi_add_frame(tl->avi, jpg, len);
+        tl->next_slot++;
+    }
+    return ret;
+}
+
+static esp_err_t clip_record(img_avi_write_cb_t write, img_avi_patch_cb_t patch, void *ctx, size_t *total)
+{
+    img_avi_config_t cfg = {
+        .frame_us = CLIP_FRAME_US,
+        .max_frames = CLIP_MAX_FRAMES,
+        .write = write,
+        .patch = patch,
+        .ctx = ctx,
+    };
+    clip_timeline_t tl = {0};
+    esp_err_t ret = img_avi_open(&cfg, &tl.avi);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    // 事件前：预录环中的帧，由旧到新
+    const img_preroll_frame_t *pre[CLIP_PRE_MAX];
+    size_t num = img_preroll_get_burst(pre, CLIP_PRE_MAX, CONFIG_IMG_CLIP_PRE_MS);
+    for (size_t i = 0; i < num; i++) {
+        if (ret == ESP_OK) {
+            ret = clip_add(&tl, pre[i]->timestamp_us, pre[i]->buf, pre[i]->len);
+        }
+        img_preroll_return(pre[i]);
+    }
+
+    // 事件后：帧广播上的实时帧，写出慢于采集时由帧广播跳帧，时间轴上补空帧
+    frame_bus_sub_t *sub = frame_bus_subscribe();
+    if (!sub) {
+        ESP_LOGW(TAG, "frame bus full, clip has preroll frames only");
+    }
+    // 只取时间轴需要的帧，摄像头更快时不必每帧唤醒
+    frame_bus_set_interval(sub, CLIP_FRAME_US / 1000);
+    int64_t end = s_trigger_us + (int64_t)CONFIG_IMG_CLIP_POST_MS * 1000;
+    while (ret == ESP_OK && sub && esp_timer_get_time() < end) {
+        camera_fb_t *fb = frame_bus_wait(sub, CLIP_WAIT_MS);
+        if (!fb) {
+            continue;
+        }
+        ret = clip_add(&tl, esp_timer_get_time(), fb->buf, fb->len);
+        frame_bus_done(sub);
+    }
+    if (sub) {
+        frame_bus_unsubscribe(sub);
+    }
+
+    if (ret == ESP_ERR_INVALID_SIZE) {
+        // 索引已满，到此为止
+        ret = ESP_OK;
+    }
+    uint32_t frames = img_avi_frame_count(tl.avi);
+    if (ret != ESP_OK || frames == 0) {
+        img_avi_abort(tl.avi);
+        return ret != ESP_OK ? ret : ESP_ERR_NOT_FOUND;
+    }
+    ret = img_avi_close(tl.avi, total);
+    ESP_LOGI(TAG, "clip recorded: %u frames (%u preroll), %u bytes", (unsigned)frames, (unsigned)num,
+             total ? (unsigned)*total : 0);
+    return ret;
+}
+
+// ========== flash 暂存输出 ==========
+static esp_err_t file_write(void *ctx, const void *data, size_t len)
+{
+    return fwrite(data, 1, len, (FILE *)ctx) == len ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t file_patch(void *ctx, uint32_t offset, const void *data, size_t len)
+{
+    FILE *f = ctx;
+    if (fseek(f, offset, SEEK_SET) != 0 || fwrite(data, 1, len, f) != len) {
+        return ESP_FAIL;
+    }
+    return fseek(f, 0, SEEK_END) == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static void clip_path(char *path, size_t size, uint32_t seq)
+{
+    snprintf(path, size, IMG_UPLOAD_SPOOL_PATH "/" CLIP_FILE_PREFIX "%06u.avi", (unsigned)seq);
+}
+
+// 扫描暂存的短视频，返回个数，oldest_out 为最旧的序号
+static int clip_scan(uint32_t *oldest_out)
+{
+    int count = 0;
+    uint32_t oldest = 0;
+    DIR *dir = opendir(IMG_UPLOAD_SPOOL_PATH);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        if (strncmp(ent->d_name, CLIP_FILE_PREFIX, strlen(CLIP_FILE_PREFIX)) != 0) {
+            continue;
+        }
+        uint32_t seq = strtoul(ent->d_name + strlen(CLIP_FILE_PREFIX), NULL, 10);
+        if (seq == 0) {
+            continue;
+        }
+        count++;
+        if (oldest == 0 || seq < oldest) {
+            oldest = seq;
+        }
+        if (seq >= s_file_seq) {
+            s_file_seq = seq + 1;
+        }
+    }
+    closedir(dir);
+    if (oldest_out) {
+        *oldest_out = oldest;
+    }
+    return count;
+}
+
+static esp_err_t clip_record_to_file(void)
+{
+    char path[40];
+    uint32_t oldest = 0;
+    // 为新短视频腾出位置，删除最旧的
+    while (clip_scan(&oldest) >= CONFIG_IMG_CLIP_SPOOL_MAX && oldest) {
+        clip_path(path, sizeof(path), oldest);
+        ESP_LOGW(TAG, "clip spool full, remove %s", path);
+        unlink(path);
+    }
+    clip_path(path, sizeof(path), s_file_seq++);
+    FILE *f = fopen(path, "w+b");
+    if (!f) {
+        ESP_LOGE(TAG, "open %s failed", path);
+        return ESP_FAIL;
+    }
+    size_t total = 0;
+    esp_err_t ret = clip_record(file_write, file_patch, f, &total);
+    fclose(f);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "clip to %s failed (0x%x)", path, ret);
+        unlink(path);
+    }
+    return ret;
+}
+
+// 上传一个暂存的短视频，成功后删除
+static esp_err_t clip_upload_file(uint32_t seq)
+{
+    char path[40];
+    char name[24];
+    clip_path(path, sizeof(path), seq);
+    snprintf(name, sizeof(name), CLIP_FILE_PREFIX "%06u.avi", (unsigned)seq);
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    uint8_t *buf = malloc(CLIP_UPLOAD_BUF_SIZE);
+    img_upload_handle_t up = NULL;
+    esp_err_t ret = buf ? img_upload_chunked_begin(name, CLIP_CONTENT_TYPE, &up) : ESP_ERR_NO_MEM;
+    if (ret == ESP_OK) {
+        size_t got;
+        while (ret == ESP_OK && (got = fread(buf, 1, CLIP_UPLOAD_BUF_SIZE, f)) > 0) {
+            ret = img_upload_chunked_write(up, buf, got);
+        }
+        ret = img_upload_chunked_end(up, ret != ESP_OK);
+    }
+    free(buf);
+    fclose(f);
+    if (ret == ESP_OK) {
+        unlink(path);
+    }
+    return ret;
+}
+
+// 由旧到新上传暂存的短视频，遇到失败停止等下次联网
+static void clip_upload_pending(void)
+{
+    uint32_t oldest = 0;
+    while (clip_scan(&oldest) > 0 && oldest) {
+        esp_err_t ret = clip_upload_file(oldest);
+        if (ret == ESP_OK) {
+            ESP_LOGI(TAG, "clip %u uploaded", (unsigned)oldest);
+        } else if (ret == ESP_ERR_NOT_FOUND) {
+            char path[40];
+            clip_path(path, sizeof(path), oldest);
+            unlink(path);
+        } else {
+            ESP_LOGW(TAG, "clip %u upload failed (0x%x), keep for later", (unsigned)oldest, ret);
+            break;
+        }
+    }
+}
+
+// ========== 直接上传输出 ==========
+static esp_err_t http_write(void *ctx, const void *data, size_t len)
+{
+    return img_upload_chunked_write((img_upload_handle_t)ctx, data, len);
+}
+
+static esp_err_t clip_record_to_http(void)
+{
+    img_upload_handle_t up = NULL;
+    esp_err_t ret = img_upload_chunked_begin(CLIP_FILE_PREFIX ".avi", CLIP_CONTENT_TYPE, &up);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    ret = clip_record(http_write, NULL, up, NULL);
+    esp_err_t end = img_upload_chunked_end(up, ret != ESP_OK);
+    return ret != ESP_OK ? ret : end;
+}
+
+static void clip_task(void *arg)
+{
+    while (1) {
+        uint32_t bits = 0;
+        xTaskNotifyWait(0, UINT32_MAX, &bits, portMAX_DELAY);
+        bool spool = img_upload_queue_spool_ready();
+        if (bits & CLIP_NOTIFY_TRIGGER) {
+            esp_err_t ret = spool ? clip_record_to_file() : clip_record_to_http();
+            evt_log(EVT_MOD_IMG, EVT_IMG_CLIP, ret, 0);
+            s_recording = false;
+            if (ret != ESP_OK) {
+                ESP_LOGE(TAG, "clip failed (0x%x)", ret);
+            }
+        }
+        if (spool) {
+            clip_upload_pending();
+        }
+    }
+}
+
+esp_err_t img_clip_init(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(clip_task, "img_clip", CLIP_TASK_STACK, NULL, CLIP_TASK_PRIO, &s_task) != pdPASS) {
+        s_task = NULL;
+        ESP_LOGE(TAG, "Failed to create clip task");
+        return ESP_ERR_NO_MEM;
+    }
+    int pending = img_upload_queue_spool_ready() ? clip_scan(NULL) : 0;
+    ESP_LOGI(TAG, "img_clip initialized: %d ms + %d ms at %d fps, %d clip(s) pending",
+             CONFIG_IMG_CLIP_PRE_MS, CONFIG_IMG_CLIP_POST_MS, CONFIG_IMG_CLIP_FPS, pending);
+    return ESP_OK;
+}
+
+esp_err_t img_clip_trigger(void)
+{
+    if (!s_task) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_recording) {
+        ESP_LOGD(TAG, "clip already recording");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_recording = true;
+    s_trigger_us = esp_timer_get_time();
+    xTaskNotify(s_task, CLIP_NOTIFY_TRIGGER, eSetBits);
+    return ESP_OK;
+}
+
+void img_clip_kick(void)
+{
+    if (s_task) {
+        xTaskNotify(s_task, CLIP_NOTIFY_KICK, eSetBits);
+    }
+}
+
+#else
+
+esp_err_t img_clip_init(void)
+{
+    return ESP_OK;
+}
+
+esp_err_t img_clip_trigger(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void img_clip_kick(void)
+{
+}
+
+#endif // CONFIG_IMG_CLIP
@@ -0,0 +1,278 @@
+// img_detect.c
+// 门铃事件的目标检测：缩小解码在调用方完成，推理在 core 1 的检测任务中进行，有目标时裁剪上传、原图按需补传
+#include "img_detect.h"
+
+#if CONFIG_IMG_DETECT
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "cJSON.h"
+#include "gs_mqtt.h"
+#include "img_thumb.h"
+#include "img_upload_queue.h"
+#include "evt_log.h"
+
+static const char *TAG = "img_detect";
+
+#define DETECT_TOPIC_SET        "/service/detect"
+#define DETECT_TOPIC_EVENT      "/event/detect"
+#define DETECT_TASK_STACK       (10 * 1024)     // esp-dl 推理的调用栈较深
+#define DETECT_TASK_PRIO        4               // 低于串口任务，高于移动侦测
+#define DETECT_TASK_CORE        1
+#define DETECT_DEC_MAX_W        320             // 送检图像的最大宽度，模型内部再缩放到输入尺寸
+#define DETECT_CROP_MARGIN      20              // 裁剪区域四周扩出的比例（%）
+#define DETECT_CROP_MAX_PIXELS  (640 * 480)     // 裁剪图超过此像素数时缩小编码
+#define DETECT_CROP_QUALITY     80
+#define DETECT_META_MAX         512
+
+// 送检图像与结果：s_busy 期间归检测任务所有
+static uint8_t *s_rgb = NULL;
+static size_t s_rgb_cap = 0;
+static uint16_t s_det_w;
+static uint16_t s_det_h;
+static img_roi_box_t s_boxes[IMG_DETECT_MAX_BOXES];
+static int s_box_num;
+static volatile bool s_busy = false;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_done = NULL;
+
+// 等待服务器索取的原图
+static SemaphoreHandle_t s_lock = NULL;
+static uint8_t *s_full = NULL;
+static size_t s_full_len;
+static uint32_t s_full_id;
+static int64_t s_full_at;
+
+static uint32_t s_event_id;
+static img_detect_stats_t s_stats;
+
+static void detect_task(void *arg)
+{
+    for (;;) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        int64_t start = esp_timer_get_time();
+        s_box_num = img_detect_model_run(s_rgb, s_det_w, s_det_h, CONFIG_IMG_DETECT_SCORE,
+                                         s_boxes, IMG_DETECT_MAX_BOXES);
+        s_stats.last_infer_ms = (esp_timer_get_time() - start) / 1000;
+        s_stats.model_loaded = s_box_num >= 0;
+        // 先给信号再清忙标志：调用方见到空闲后清掉超时遗留的信号，不会误取旧结果
+        xSemaphoreGive(s_done);
+        s_busy = false;
+    }
+}
+
+static void detect_publish(const char *json, size_t len)
+{
+    gs_mqtt_publish(DETECT_TOPIC_EVENT, (uint8_t *)json, len, GS_MQTT_QOS0, 0);
+}
+
+static void detect_full_free_locked(void)
+{
+    heap_caps_free(s_full);
+    s_full = NULL;
+    s_full_len = 0;
+}
+
+// 保留原图等服务器索取，新事件覆盖旧的
+static void detect_hold_full(uint32_t id, const uint8_t *jpg, size_t len)
+{
+    uint8_t *copy = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (copy) {
+        memcpy(copy, jpg, len);
+    } else {
+        ESP_LOGW(TAG, "No memory to hold full frame (%u bytes)", len);
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    detect_full_free_locked();
+    s_full = copy;
+    s_full_len = copy ? len : 0;
+    s_full_id = id;
+    s_full_at = esp_timer_get_time();
+    xSemaphoreGive(s_lock);
+}
+
+static esp_err_t detect_run(const uint8_t *jpg, size_t len, uint16_t *frame_w, uint16_t *frame_h, uint8_t *scale)
+{
+    esp_err_t ret = img_thumb_get_size(jpg, len, frame_w, frame_h);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    uint8_t s = 0;
+    while (s < 3 && (*frame_w >> s) > DETECT_DEC_MAX_W) {
+        s++;
+    }
+    size_t need = (size_t)((*frame_w + (1 << s) - 1) >> s) * ((*frame_h + (1 << s) - 1) >> s) * 3;
+    if (need > s_rgb_cap) {
+        heap_caps_free(s_rgb);
+        s_rgb_cap = 0;
+        s_rgb = heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_rgb) {
+            return ESP_ERR_NO_MEM;
+        }
+        s_rgb_cap = need;
+    }
+    ret = img_thumb_decode_rgb888(jpg, len, s, s_rgb, s_rgb_cap, &s_det_w, &s_det_h);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *scale = s;
+
+    xSemaphoreTake(s_done, 0);
+    s_busy = true;
+    xTaskNotifyGive(s_task);
+    if (xSemaphoreTake(s_done, pdMS_TO_TICKS(CONFIG_IMG_DETECT_TIMEOUT_MS)) != pdTRUE) {
+        // 结果作废，推理结束后检测任务自行清忙标志
+        s_stats.timeouts++;
+        ESP_LOGW(TAG, "Detection timed out%s", s_stats.model_loaded ? "" : " (model loading)");
+        return ESP_ERR_TIMEOUT;
+    }
+    return s_box_num < 0 ? ESP_FAIL : ESP_OK;
+}
+
+esp_err_t img_detect_event(const uint8_t *jpg, size_t len, uint8_t **crop, size_t *crop_len)
+{
+    if (!jpg || !crop || !crop_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_task || s_busy) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_stats.events++;
+
+    uint16_t frame_w = 0;
+    uint16_t frame_h = 0;
+    uint8_t det_scale = 0;
+    esp_err_t ret = detect_run(jpg, len, &frame_w, &frame_h, &det_scale);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    if (s_box_num == 0) {
+        ESP_LOGI(TAG, "No target in %ux%u (%u ms)", s_det_w, s_det_h, (unsigned)s_stats.last_infer_ms);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // 检测坐标换算回原图
+    img_roi_box_t boxes[IMG_DETECT_MAX_BOXES];
+    size_t n = s_box_num;
+    for (size_t i = 0; i < n; i++) {
+        boxes[i].x = s_boxes[i].x << det_scale;
+        boxes[i].y = s_boxes[i].y << det_scale;
+        boxes[i].w = s_boxes[i].w << det_scale;
+        boxes[i].h = s_boxes[i].h << det_scale;
+        boxes[i].score = s_boxes[i].score;
+    }
+    img_thumb_rect_t roi;
+    uint8_t crop_scale = 0;
+    if (!img_roi_select(boxes, n, frame_w, frame_h, DETECT_CROP_MARGIN, DETECT_CROP_MAX_PIXELS, &roi, &crop_scale)) {
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    char *meta = malloc(DETECT_META_MAX);
+    if (!meta) {
+        return ESP_ERR_NO_MEM;
+    }
+    uint32_t id = ++s_event_id;
+    size_t meta_len = img_roi_meta_json(meta, DETECT_META_MAX, id, frame_w, frame_h, &roi, boxes, n);
+    img_thumb_rect_t clip;
+    img_roi_scale_rect(&roi, crop_scale, &clip);
+    ret = img_thumb_crop(jpg, len, crop_scale, &clip, DETECT_CROP_QUALITY, meta_len ? meta : NULL, crop, crop_len);
+    if (ret == ESP_OK) {
+        s_stats.hits++;
+        detect_hold_full(id, jpg, len);
+        if (meta_len) {
+            detect_publish(meta, meta_len);
+        }
+        evt_log(EVT_MOD_IMG, EVT_IMG_DETECT, n, *crop_len);
+        ESP_LOGI(TAG, "Event %u: %u target(s), roi %ux%u+%u+%u, crop %u of %u bytes, infer %u ms",
+                 (unsigned)id, n, roi.w, roi.h, roi.x, roi.y, *crop_len, len, (unsigned)s_stats.last_infer_ms);
+    }
+    free(meta);
+    return ret;
+}
+
+// 按 id 把保留的原图交给上传队列，过期或已被新事件覆盖则回复 expired
+static void detect_request_full(uint32_t id)
+{
+    const char *state = "expired";
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_full && s_full_id == id &&
+            esp_timer_get_time() - s_full_at < (int64_t)CONFIG_IMG_DETECT_HOLD_S * 1000000) {
+        if (img_upload_queue_push(s_full, s_full_len) == ESP_OK) {
+            s_stats.full_requests++;
+            state = "queued";
+        } else {
+            state = "failed";
+        }
+    }
+    if (s_full && strcmp(state, "failed") != 0) {
+        detect_full_free_locked();
+    }
+    xSemaphoreGive(s_lock);
+
+    char buf[48];
+    int len = snprintf(buf, sizeof(buf), "{\"id\":%lu,\"full\":\"%s\"}", (unsigned long)id, state);
+    detect_publish(buf, len);
+}
+
+// {"op":"full","id":N}
+static void detect_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGW(TAG, "Invalid detect message");
+        return;
+    }
+    cJSON *op = cJSON_GetObjectItem(root, "op");
+    cJSON *id = cJSON_GetObjectItem(root, "id");
+    if (cJSON_IsString(op) && strcmp(op->valuestring, "full") == 0 && cJSON_IsNumber(id)) {
+        detect_request_full((uint32_t)id->valuedouble);
+    }
+    cJSON_Delete(root);
+}
+
+static void detect_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(DETECT_TOPIC_SET, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t img_detect_init(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    s_done = xSemaphoreCreateBinary();
+    s_lock = xSemaphoreCreateMutex();
+    if (!s_done || !s_lock) {
+        ESP_LOGE(TAG, "Failed to create detect semaphores");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreatePinnedToCore(detect_task, "img_detect", DETECT_TASK_STACK, NULL, DETECT_TASK_PRIO,
+                                &s_task, DETECT_TASK_CORE) != pdPASS) {
+        s_task = NULL;
+        ESP_LOGE(TAG, "Failed to create detect task");
+        return ESP_ERR_NO_MEM;
+    }
+    gs_mqtt_register_topic_msg_cb(DETECT_TOPIC_SET, detect_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, detect_event_handler);
+    ESP_LOGI(TAG, "Detection ready: score >= %d%%, timeout %d ms, hold %d s",
+             CONFIG_IMG_DETECT_SCORE, CONFIG_IMG_DETECT_TIMEOUT_MS, CONFIG_IMG_DETECT_HOLD_S);
+    return ESP_OK;
+}
+
+void img_detect_get_stats(img_detect_stats_t *stats)
+{
+    if (stats) {
+        *stats = s_stats;
+    }
+}
+
+#endif // CONFIG_IMG_DETECT
@@ -0,0 +1,63 @@
+// img_detect_model.cpp
+// esp-dl 检测模型的 C 接口：第一次检测时才构造模型，权重位置由模型组件的 Kconfig 决定（flash rodata / 分区），之后常驻
+#include "img_detect.h"
+#include "esp_log.h"
+#include <new>
+
+#if CONFIG_IMG_DETECT_MODEL_FACE
+#include "human_face_detect.hpp"
+typedef HumanFaceDetect detect_model_t;
+#else
+#include "pedestrian_detect.hpp"
+typedef PedestrianDetect detect_model_t;
+#endif
+
+static const char *TAG = "img_detect";
+
+static detect_model_t *s_model = nullptr;
+
+static uint16_t clamp_coord(int v, uint16_t limit)
+{
+    return v < 0 ? 0 : (v > limit ? limit : (uint16_t)v);
+}
+
+extern "C" int img_detect_model_run(const uint8_t *rgb, uint16_t width, uint16_t height, uint8_t min_score,
+                                    img_roi_box_t *boxes, int max)
+{
+    if (!s_model) {
+        s_model = new (std::nothrow) detect_model_t();
+        if (!s_model) {
+            ESP_LOGE(TAG, "Failed to load detection model");
+            return -1;
+        }
+        ESP_LOGI(TAG, "Detection model loaded");
+    }
+
+    dl::image::img_t img;
+    img.data = (void *)rgb;
+    img.width = width;
+    img.height = height;
+    img.pix_type = dl::image::DL_IMAGE_PIX_TYPE_RGB888;
+
+    // 结果已按置信度降序
+    int n = 0;
+    for (const auto &res : s_model->run(img)) {
+        if (n >= max || res.score * 100 < min_score) {
+            break;
+        }
+        uint16_t x0 = clamp_coord(res.box[0], width);
+        uint16_t y0 = clamp_coord(res.box[1], height);
+        uint16_t x1 = clamp_coord(res.box[2], width);
+        uint16_t y1 = clamp_coord(res.box[3], height);
+        if (x1 <= x0 || y1 <= y0) {
+            continue;
+        }
+        boxes[n].x = x0;
+        boxes[n].y = y0;
+        boxes[n].w = x1 - x0;
+        boxes[n].h = y1 - y0;
+        boxes[n].score = (uint8_t)(res.score * 100);
+        n++;
+    }
+    return n;
+}
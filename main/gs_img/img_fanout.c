@@ -0,0 +1,252 @@
+// img_fanout.c
+// 多目的地上传：同一帧按引用计数共享给各目的地的上传任务，并行上传，全部结束后归还帧
+#include "img_fanout.h"
+#include "esp_http_client.h"
+#include "conn_mgr.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+
+static const char *TAG = "img_fanout";
+
+#define IMG_FANOUT_TASK_STACK   6144
+#define IMG_FANOUT_TASK_PRIO    5
+// 每个目的地最多积压的帧数，上传慢的目的地跳过新帧，不拖住其他目的地和帧的归还
+#define IMG_FANOUT_QUEUE_LEN    2
+
+struct img_fanout_frame {
+    const uint8_t *data;
+    size_t len;
+    img_fanout_release_cb_t release;
+    void *ctx;
+    uint8_t refs;
+};
+
+typedef struct {
+    char name[16];
+    esp_http_client_handle_t client;
+    bool connected;                 // 由 HTTP 事件维护
+    char *part_head;                // multipart 头尾，原始数据上传时为 NULL
+    char *part_tail;
+    img_fanout_result_cb_t result_cb;
+    void *result_arg;
+    QueueHandle_t queue;
+    conn_mgr_conn_t mgr;            // 每帧租用连接名额，发完连接仍在则保持
+} fanout_dest_t;
+
+static fanout_dest_t s_dests[IMG_FANOUT_DEST_MAX];
+static size_t s_dest_num = 0;
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void frame_unref(img_fanout_frame_t *frame)
+{
+    portENTER_CRITICAL(&s_lock);
+    bool last = (--frame->refs == 0);
+    portEXIT_CRITICAL(&s_lock);
+    if (last) {
+        frame->release(frame->ctx);
+        free(frame);
+    }
+}
+
+static esp_err_t _http_event_handler(esp_http_client_event_t *evt)
+{
+    fanout_dest_t *dest = (fanout_dest_t *)evt->user_data;
+    switch (evt->event_id) {
+    case HTTP_EVENT_ON_CONNECTED:
+        dest->connected = true;
+        break;
+    case HTTP_EVENT_DISCONNECTED:
+        dest->connected = false;
+        break;
+    default:
+        break;
+    }
+    return ESP_OK;
+}
+
+// 发送一次请求，返回 HTTP 状态码，传输失败返回 -1
+static int post_frame(fanout_dest_t *dest, const img_fanout_frame_t *frame)
+{
+    esp_http_client_handle_t client = dest->client;
+    int head_len = dest->part_head ? strlen(dest->part_head) : 0;
+    int tail_len = dest->part_tail ? strlen(dest->part_tail) : 0;
+
+    esp_err_t err = esp_http_client_open(client, head_len + frame->len + tail_len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "[%s] open failed: %s", dest->name, esp_err_to_name(err));
+        return -1;
+    }
+    if ((head_len && esp_http_client_write(client, dest->part_head, head_len) != head_len)
+        || esp_http_client_write(client, (const char *)frame->data, frame->len) != (int)frame->len
+        || (tail_len && esp_http_client_write(client, dest->part_tail, tail_len) != tail_len)) {
+        ESP_LOGE(TAG, "[%s] write failed", dest->name);
+        return -1;
+    }
+    if (esp_http_client_fetch_headers(client) < 0) {
+        ESP_LOGE(TAG, "[%s] failed to fetch headers", dest->name);
+        return -1;
+    }
+    int status = esp_http_client_get_status_code(client);
+    // 读完响应体，连接才能复用
+    esp_http_client_flush_response(client, NULL);
+    return status;
+}
+
+static void fanout_task(void *arg)
+{
+    fanout_dest_t *dest = (fanout_dest_t *)arg;
+    img_fanout_frame_t *frame;
+    while (1) {
+        xQueueReceive(dest->queue, &frame, portMAX_DELAY);
+        TickType_t start = xTaskGetTickCount();
+
+        conn_mgr_lease(&dest->mgr, CONN_PRIO_NORMAL, portMAX_DELAY);
+        bool reused = dest->connected;
+        int status = post_frame(dest, frame);
+        if (status < 0 && reused) {
+            // 复用的连接可能已被服务器关闭，重新建立连接再试一次
+            ESP_LOGW(TAG, "[%s] keep-alive connection lost, reconnecting", dest->name);
+            esp_http_client_close(dest->client);
+            status = post_frame(dest, frame);
+        }
+        if (status < 0) {
+            esp_http_client_close(dest->client);
+        }
+        conn_mgr_return(&dest->mgr, dest->connected);
+        esp_err_t ret = (status >= 200 && status < 300) ? ESP_OK : ESP_FAIL;
+        ESP_LOGI(TAG, "[%s] %u bytes, status %d, %u ms", dest->name, frame->len, status,
+                 (unsigned)pdTICKS_TO_MS(xTaskGetTickCount() - start));
+
+        frame_unref(frame);
+        if (dest->result_cb) {
+            dest->result_cb(dest->result_arg, ret, status);
+        }
+    }
+}
+
+esp_err_t img_fanout_add_dest(const img_fanout_dest_config_t *config)
+{
+    if (!config || !config->url || !config->url[0]) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_dest_num >= IMG_FANOUT_DEST_MAX) {
+        ESP_LOGE(TAG, "Too many destinations");
+        return ESP_ERR_NO_MEM;
+    }
+    fanout_dest_t *dest = &s_dests[s_dest_num];
+    memset(dest, 0, sizeof(*dest));
+    snprintf(dest->name, sizeof(dest->name), "%s", config->name ? config->name : "fanout");
+    dest->result_cb = config->result_cb;
+    dest->result_arg = config->result_arg;
+
+    esp_http_client_config_t http_config = {
+        .url = config->url,
+        .method = config->boundary ? HTTP_METHOD_POST : HTTP_METHOD_PUT,
+        .event_handler = _http_event_handler,
+        .max_redirection_count = 5,
+        .keep_alive_enable = true,
+        .user_data = dest,
+    };
+    dest->client = esp_http_client_init(&http_config);
+    if (!dest->client) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_http_client_set_header(dest->client, "Expect", "");
+    for (size_t i = 0; i < config->header_num; i++) {
+        esp_http_client_set_header(dest->client, config->headers[i].key, config->headers[i].value);
+    }
+
+    if (config->boundary) {
+        char content_type[128];
+        snprintf(content_type, sizeof(content_type), "multipart/form-data; boundary=%s", config->boundary);
+        esp_http_client_set_header(dest->client, "Content-Type", content_type);
+        if (asprintf(&dest->part_head,
+                     "--%s\r\n"
+                     "Content-Disposition: form-data; name=\"%s\"; filename=\"%s\"\r\n"
+                     "Content-Type: image/jpeg\r\n\r\n",
+                     config->boundary, config->field ? config->field : "upload",
+                     config->filename ? config->filename : "image.jpg") < 0) {
+            dest->part_head = NULL;
+            goto fail;
+        }
+        if (asprintf(&dest->part_tail, "\r\n--%s--\r\n", config->boundary) < 0) {
+            dest->part_tail = NULL;
+            goto fail;
+        }
+    } else {
+        esp_http_client_set_header(dest->client, "Content-Type", "image/jpeg");
+    }
+
+    dest->queue = xQueueCreate(IMG_FANOUT_QUEUE_LEN, sizeof(img_fanout_frame_t *));
+    if (!dest->queue) {
+        goto fail;
+    }
+    dest->mgr.name = dest->name;
+    conn_mgr_attach(&dest->mgr, dest->client, config->url);
+    char task_name[configMAX_TASK_NAME_LEN];
+    snprintf(task_name, sizeof(task_name), "fan_%s", dest->name);
+    if (xTaskCreate(fanout_task, task_name, IMG_FANOUT_TASK_STACK, dest, IMG_FANOUT_TASK_PRIO, NULL) != pdPASS) {
+        vQueueDelete(dest->queue);
+        goto fail;
+    }
+
+    portENTER_CRITICAL(&s_lock);
+    s_dest_num++;
+    portEXIT_CRITICAL(&s_lock);
+    ESP_LOGI(TAG, "Destination %s: %s (%s)", dest->name, config->url, config->boundary ? "multipart" : "raw");
+    return ESP_OK;
+
+fail:
+    free(dest->part_head);
+    free(dest->part_tail);
+    conn_mgr_detach(&dest->mgr);
+    esp_http_client_cleanup(dest->client);
+    memset(dest, 0, sizeof(*dest));
+    return ESP_ERR_NO_MEM;
+}
+
+size_t img_fanout_dest_num(void)
+{
+    return s_dest_num;
+}
+
+img_fanout_frame_t *img_fanout_send(const uint8_t *data, size_t len, img_fanout_release_cb_t release, void *ctx)
+{
+    size_t num = s_dest_num;
+    if (!data || !len || !release || num == 0) {
+        return NULL;
+    }
+    img_fanout_frame_t *frame = malloc(sizeof(img_fanout_frame_t));
+    if (!frame) {
+        return NULL;
+    }
+    frame->data = data;
+    frame->len = len;
+    frame->release = release;
+    frame->ctx = ctx;
+    frame->refs = num + 1;
+
+    for (size_t i = 0; i < num; i++) {
+        if (xQueueSend(s_dests[i].queue, &frame, 0) != pdTRUE) {
+            ESP_LOGW(TAG, "[%s] busy, frame skipped", s_dests[i].name);
+            frame_unref(frame);
+            if (s_dests[i].result_cb) {
+                s_dests[i].result_cb(s_dests[i].result_arg, ESP_ERR_TIMEOUT, -1);
+            }
+        }
+    }
+    return frame;
+}
+
+void img_fanout_frame_put(img_fanout_frame_t *frame)
+{
+    if (frame) {
+        frame_unref(frame);
+    }
+}
@@ -0,0 +1,252 @@
+// img_motion.c
+// 移动侦测：帧广播上的 MJPEG 帧抽帧按 1/8 缩小解码，网格亮度与运行背景比较，不做完整解码
+#include "img_motion.h"
+#include "img_thumb.h"
+#include "img_upload_queue.h"
+#include "frame_bus.h"
+#include "state_report.h"
+#include "evt_log.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "string.h"
+#include <stdlib.h>
+
+#if CONFIG_IMG_MOTION
+
+static const char *TAG = "img_motion";
+
+#define MOTION_TASK_STACK       4096
+#define MOTION_TASK_PRIO        3       // 低于预览和图传
+#define MOTION_TASK_CORE        1
+#define MOTION_WAIT_MS          200     // 停止请求的最长响应时间
+#define MOTION_SCALE            3       // 1/8：每个 8x8 块只取 DC 系数
+#define MOTION_DEC_W            160     // 缩小后最多分析的区域，超出部分居中裁剪
+#define MOTION_DEC_H            120
+#define MOTION_GRID_W           16
+#define MOTION_GRID_H           12
+#define MOTION_GRID_NUM         (MOTION_GRID_W * MOTION_GRID_H)
+#define MOTION_BG_SHIFT         3       // 背景更新速度：每次向当前值靠近 1/8
+#define MOTION_WARMUP_FRAMES    8       // 背景建立前不判定
+#define MOTION_STAT_INTERVAL    (60 * 1000 * 1000)
+
+static uint16_t *s_dec_buf = NULL;
+static uint16_t s_bg[MOTION_GRID_NUM];          // 背景亮度，Q8 定点
+static uint8_t s_luma[MOTION_GRID_NUM];
+static uint32_t s_sum[MOTION_GRID_NUM];
+static uint16_t s_cnt[MOTION_GRID_NUM];
+static frame_bus_sub_t *s_sub = NULL;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_exit = NULL;
+static volatile bool s_stop = false;
+static img_motion_stats_t s_stats;
+
+// 缩小图按网格求平均亮度（Y ≈ (2R + 5G + B) / 8）
+static void motion_grid_luma(const uint16_t *buf, uint16_t w, uint16_t h)
+{
+    memset(s_sum, 0, sizeof(s_sum));
+    memset(s_cnt, 0, sizeof(s_cnt));
+    for (uint16_t y = 0; y < h; y++) {
+        const uint16_t *row = buf + (size_t)y * w;
+        uint16_t gy = (uint32_t)y * MOTION_GRID_H / h;
+        for (uint16_t x = 0; x < w; x++) {
+            uint16_t px = row[x];
+            uint32_t r = (px >> 8) & 0xF8;
+            uint32_t g = (px >> 3) & 0xFC;
+            uint32_t b = (px << 3) & 0xF8;
+            uint16_t idx = gy * MOTION_GRID_W + (uint32_t)x * MOTION_GRID_W / w;
+            s_sum[idx] += (2 * r + 5 * g + b) >> 3;
+            s_cnt[idx]++;
+        }
+    }
+    for (int i = 0; i < MOTION_GRID_NUM; i++) {
+        s_luma[i] = s_cnt[i] ? s_sum[i] / s_cnt[i] : 0;
+    }
+}
+
+// 与背景比较并更新背景，返回变化的网格数；整体亮度变化（开灯、自动曝光）先扣除
+static uint8_t motion_compare(bool warm)
+{
+    int32_t mean_diff = 0;
+    for (int i = 0; i < MOTION_GRID_NUM; i++) {
+        mean_diff += (int32_t)s_luma[i] - (s_bg[i] >> 8);
+    }
+    mean_diff /= MOTION_GRID_NUM;
+
+    uint8_t changed = 0;
+    for (int i = 0; i < MOTION_GRID_NUM; i++) {
+        int32_t diff = (int32_t)s_luma[i] - (s_bg[i] >> 8) - mean_diff;
+        if (warm && (diff > CONFIG_IMG_MOTION_THRESHOLD || diff < -CONFIG_IMG_MOTION_THRESHOLD)) {
+            changed++;
+        }
+        s_bg[i] += (((int32_t)s_luma[i] << 8) - (int32_t)s_bg[i]) >> MOTION_BG_SHIFT;
+    }
+    return changed;
+}
+
+static void motion_task(void *arg)
+{
+    uint32_t count = 0;
+    uint32_t warmup = 0;
+    int64_t busy_us = 0;
+    int64_t last_event = -(int64_t)CONFIG_IMG_MOTION_COOLDOWN_S * 1000000;
+    int64_t stat_start = esp_timer_get_time();
+    uint32_t stat_frames = 0;
+
+    while (!s_stop) {
+        camera_fb_t *fb = frame_bus_wait(s_sub, MOTION_WAIT_MS);
+        if (!fb) {
+            continue;
+        }
+        // 只分析每第 N 帧，其余立即归还
+        if (++count < CONFIG_IMG_MOTION_FRAME_INTERVAL) {
+            frame_bus_done(s_sub);
+            continue;
+        }
+        count = 0;
+
+        int64_t start = esp_timer_get_time();
+        uint16_t sw = (fb->width + (1 << MOTION_SCALE) - 1) >> MOTION_SCALE;
+        uint16_t sh = (fb->height + (1 << MOTION_SCALE) - 1) >> MOTION_SCALE;
+        img_thumb_rect_t clip = {
+            .w = sw < MOTION_DEC_W ? sw : MOTION_DEC_W,
+            .h = sh < MOTION_DEC_H ? sh : MOTION_DEC_H,
+        };
+        clip.x = (sw - clip.w) / 2;
+        clip.y = (sh - clip.h) / 2;
+        if (clip.w < MOTION_GRID_W || clip.h < MOTION_GRID_H ||
+                img_thumb_decode_rgb565(fb->buf, fb->len, MOTION_SCALE, &clip, false, s_dec_buf) != ESP_OK) {
+            frame_bus_done(s_sub);
+            continue;
+        }
+        motion_grid_luma(s_dec_buf, clip.w, clip.h);
+        bool warm = warmup >= MOTION_WARMUP_FRAMES;
+        if (!warm) {
+            warmup++;
+        }
+        uint8_t changed = motion_compare(warm);
+        s_stats.last_cells = changed;
+        s_stats.frames++;
+        stat_frames++;
+
+        int64_t now = esp_timer_get_time();
+        if (changed >= CONFIG_IMG_MOTION_MIN_CELLS &&
+                now - last_event >= (int64_t)CONFIG_IMG_MOTION_COOLDOWN_S * 1000000) {
+            last_event = now;
+            s_stats.events++;
+            ESP_LOGI(TAG, "motion: %u/%u cells changed", changed, MOTION_GRID_NUM);
+            evt_log(EVT_MOD_IMG, EVT_IMG_MOTION, changed, fb->len);
+#if CONFIG_IMG_MOTION_UPLOAD
+            // 上传队列内部拷贝，拷完即可归还帧
+            img_upload_queue_push(fb->buf, fb->len);
+#endif
+            state_report_mqtt_upload(IMG_MOTION_STATE, changed);
+        }
+        frame_bus_done(s_sub);
+        busy_us += esp_timer_get_time() - start;
+
+        if (now - stat_start >= MOTION_STAT_INTERVAL) {
+            s_stats.avg_us = busy_us / stat_frames;
+            ESP_LOGD(TAG, "%u frames analysed, %u us/frame, skipped %u", (unsigned)stat_frames,
+                     (unsigned)s_stats.avg_us, (unsigned)frame_bus_skipped(s_sub));
+            stat_frames = 0;
+            busy_us = 0;
+            stat_start = now;
+        }
+    }
+
+    xSemaphoreGive(s_exit);
+    vTaskSuspend(NULL);
+}
+
+static void motion_free(void)
+{
+    if (s_sub) {
+        frame_bus_unsubscribe(s_sub);
+        s_sub = NULL;
+    }
+    free(s_dec_buf);
+    s_dec_buf = NULL;
+    if (s_exit) {
+        vSemaphoreDelete(s_exit);
+        s_exit = NULL;
+    }
+}
+
+esp_err_t img_motion_start(void)
+{
+    if (s_task) {
+        ESP_LOGW(TAG, "img_motion already started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_dec_buf = heap_caps_malloc(MOTION_DEC_W * MOTION_DEC_H * sizeof(uint16_t), MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    s_exit = xSemaphoreCreateBinary();
+    if (!s_dec_buf || !s_exit) {
+        ESP_LOGE(TAG, "Failed to allocate motion buffers");
+        motion_free();
+        return ESP_ERR_NO_MEM;
+    }
+    s_sub = frame_bus_subscribe();
+    if (!s_sub) {
+        ESP_LOGE(TAG, "frame bus full");
+        motion_free();
+        return ESP_ERR_NO_MEM;
+    }
+
+    memset(s_bg, 0, sizeof(s_bg));
+    memset(&s_stats, 0, sizeof(s_stats));
+    s_stop = false;
+    if (xTaskCreatePinnedToCore(motion_task, "img_motion", MOTION_TASK_STACK, NULL, MOTION_TASK_PRIO,
+                                &s_task, MOTION_TASK_CORE) != pdPASS) {
+        s_task = NULL;
+        motion_free();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "img_motion started: every %d frames, threshold %d, %d cells",
+             CONFIG_IMG_MOTION_FRAME_INTERVAL, CONFIG_IMG_MOTION_THRESHOLD, CONFIG_IMG_MOTION_MIN_CELLS);
+    return ESP_OK;
+}
+
+void img_motion_stop(void)
+{
+    if (!s_task) {
+        return;
+    }
+    s_stop = true;
+    xSemaphoreTake(s_exit, portMAX_DELAY);
+    vTaskDelete(s_task);
+    s_task = NULL;
+    motion_free();
+}
+
+void img_motion_get_stats(img_motion_stats_t *stats)
+{
+    if (stats) {
+        *stats = s_stats;
+    }
+}
+
+#else
+
+esp_err_t img_motion_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void img_motion_stop(void)
+{
+}
+
+void img_motion_get_stats(img_motion_stats_t *stats)
+{
+    if (stats) {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+#endif // CONFIG_IMG_MOTION
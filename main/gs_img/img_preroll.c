@@ -0,0 +1,194 @@
+// img_preroll.c
+// 预录环：在 PSRAM 中保留最近 N 帧 JPEG，按键事件时可立即取到事件前的画面
+#include "img_preroll.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "usb_stream.h" // usb_stream_buf_alloc(), usb_stream_memcpy()
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "string.h"
+#include <stdbool.h>
+
+static const char *TAG = "img_preroll";
+
+typedef struct {
+    img_preroll_frame_t frame;  // 必须为第一个成员，img_preroll_return() 据此找回
+    uint8_t *data;              // 槽位缓冲（PSRAM）
+    uint8_t ref;                // 使用者引用数，非 0 时不会被覆盖
+    bool valid;                 // 槽位内有完整帧
+} preroll_slot_t;
+
+static SemaphoreHandle_t s_lock = NULL;
+static preroll_slot_t *s_slots = NULL;
+static uint8_t s_slot_num = 0;
+static size_t s_slot_size = 0;
+static uint32_t s_interval_ms = 0;
+static uint8_t s_write_idx = 0;      // 下一个写入位置（轮转）
+static int64_t s_last_push_us = 0;   // 上次存帧时间，用于抽帧
+
+esp_err_t img_preroll_init(uint8_t slot_num, size_t slot_size, uint32_t interval_ms)
+{
+    if (s_slots) {
+        ESP_LOGW(TAG, "img_preroll already initialized");
+        return ESP_OK;
+    }
+    if (slot_num == 0 || slot_size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_lock = xSemaphoreCreateMutex();
+    s_slots = heap_caps_calloc(slot_num, sizeof(preroll_slot_t), MALLOC_CAP_DEFAULT);
+    if (!s_lock || !s_slots) {
+        goto fail;
+    }
+    for (uint8_t i = 0; i < slot_num; i++) {
+        // 与驱动帧槽位同样对齐，整帧拷贝可走 GDMA
+        s_slots[i].data = usb_stream_buf_alloc(slot_size, USB_STREAM_BUF_FRAME, NULL);
+        if (!s_slots[i].data) {
+            goto fail;
+        }
+        s_slots[i].frame.buf = s_slots[i].data;
+    }
+    s_slot_num = slot_num;
+    s_slot_size = slot_size;
+    s_interval_ms = interval_ms;
+    ESP_LOGI(TAG, "img_preroll initialized: %u * %u B, interval %u ms", slot_num, slot_size, (unsigned)interval_ms);
+    return ESP_OK;
+
+fail:
+    ESP_LOGE(TAG, "Failed to allocate preroll ring");
+    if (s_slots) {
+        for (uint8_t i = 0; i < slot_num; i++) {
+            usb_stream_buf_free(s_slots[i].data);
+        }
+        free(s_slots);
+        s_slots = NULL;
+    }
+    if (s_lock) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+    }
+    return ESP_ERR_NO_MEM;
+}
+
+void img_preroll_push(const uint8_t *data, size_t len, uint32_t seq)
+{
+    if (!s_slots || !data || len == 0) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    if (s_last_push_us && (now - s_last_push_us) < (int64_t)s_interval_ms * 1000) {
+        return;
+    }
+    if (len > s_slot_size) {
+        ESP_LOGW(TAG, "Frame too large for preroll slot: %u > %u", len, s_slot_size);
+        return;
+    }
+
+    // 找到下一个无人持有的槽位，拷贝期间置为无效，拷贝在锁外进行
+    preroll_slot_t *slot = NULL;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < s_slot_num; i++) {
+        uint8_t idx = (s_write_idx + i) % s_slot_num;
+        if (s_slots[idx].ref == 0) {
+            slot = &s_slots[idx];
+            slot->valid = false;
+            s_write_idx = (idx + 1) % s_slot_num;
+            break;
+        }
+    }
+    xSemaphoreGive(s_lock);
+    if (!slot) {
+        ESP_LOGD(TAG, "All preroll slots in use, skip frame %u", (unsigned)seq);
+        return;
+    }
+
+    usb_stream_memcpy(slot->data, data, len);
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    slot->frame.len = len;
+    slot->frame.seq = seq;
+    slot->frame.timestamp_us = now;
+    slot->valid = true;
+    xSemaphoreGive(s_lock);
+    s_last_push_us = now;
+}
+
+const img_preroll_frame_t *img_preroll_get_latest(void)
+{
+    const img_preroll_frame_t *frames[1];
+    uint32_t fresh_ms = s_interval_ms * IMG_PREROLL_FRESH_INTERVALS;
+    if (fresh_ms < IMG_PREROLL_FRESH_MIN_MS) {
+        fresh_ms = IMG_PREROLL_FRESH_MIN_MS;
+    }
+    if (img_preroll_get_burst(frames, 1, fresh_ms) == 0) {
+        return NULL;
+    }
+    return frames[0];
+}
+
+size_t img_preroll_get_burst(const img_preroll_frame_t **frames, size_t max_num, uint32_t window_ms)
+{
+    if (!s_slots || !frames || max_num == 0) {
+        return 0;
+    }
+    int64_t since = esp_timer_get_time() - (int64_t)window_ms * 1000;
+    size_t count = 0;
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    // 按时间戳从新到旧逐帧挑选（槽位数很少，被持有的槽位会打乱写入顺序）
+    int64_t newer = INT64_MAX;
+    while (count < max_num) {
+        preroll_slot_t *pick = NULL;
+        for (uint8_t i = 0; i < s_slot_num; i++) {
+            preroll_slot_t *slot = &s_slots[i];
+            if (slot->valid && slot->frame.timestamp_us >= since && slot->frame.timestamp_us < newer
+                    && (!pick || slot->frame.timestamp_us > pick->frame.timestamp_us)) {
+                pick = slot;
+            }
+        }
+        if (!pick) {
+            break;
+        }
+        pick->ref++;
+        frames[count++] = &pick->frame;
+        newer = pick->frame.timestamp_us;
+    }
+    xSemaphoreGive(s_lock);
+
+    // 调整为由旧到新
+    for (size_t i = 0; i < count / 2; i++) {
+        const img_preroll_frame_t *tmp = frames[i];
+        frames[i] = frames[count - 1 - i];
+        frames[count - 1 - i] = tmp;
+    }
+    return count;
+}
+
+void img_preroll_return(const img_preroll_frame_t *frame)
+{
+    if (!s_slots || !frame) {
+        return;
+    }
+    preroll_slot_t *slot = (preroll_slot_t *)frame;
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (slot->ref > 0) {
+        slot->ref--;
+    }
+    xSemaphoreGive(s_lock);
+}
+
+void img_preroll_clear(void)
+{
+    if (!s_slots) {
+        return;
+    }
+    // 只标记无效：持有者仍引用着槽位数据，写入方也会跳过被持有的槽位
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    for (uint8_t i = 0; i < s_slot_num; i++) {
+        s_slots[i].valid = false;
+    }
+    s_last_push_us = 0;
+    xSemaphoreGive(s_lock);
+}
@@ -0,0 +1,160 @@
+// img_preview.c
+// 实时预览：帧广播上的 MJPEG 帧按 1/2^scale 缩小解码为 RGB565，只解码显示区域，双缓冲交给显示端
+#include "img_preview.h"
+#include "img_thumb.h"
+#include "frame_bus.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "string.h"
+#include <stdlib.h>
+
+static const char *TAG = "img_preview";
+
+#define PREVIEW_TASK_STACK      4096
+#define PREVIEW_TASK_PRIO       4
+#define PREVIEW_WAIT_MS         200     // 停止请求的最长响应时间
+#define PREVIEW_STAT_INTERVAL   (10 * 1000 * 1000)
+#define PREVIEW_BUF_ALIGN       16      // 不小于 LV_DRAW_BUF_ALIGN，LVGL 包装时不必挪动起始地址；PIE 混合内核按 16 字节取数
+
+static img_preview_config_t s_config;
+static uint16_t *s_buf[2] = {NULL, NULL};
+static uint8_t s_buf_idx = 0;
+static frame_bus_sub_t *s_sub = NULL;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_exit = NULL;
+static volatile bool s_stop = false;
+
+static uint8_t preview_pick_scale(size_t src_w, size_t src_h)
+{
+    if (s_config.scale != IMG_PREVIEW_SCALE_AUTO) {
+        return s_config.scale;
+    }
+    uint8_t scale = 0;
+    while (scale < 3 && (src_w >> (scale + 1)) >= s_config.width && (src_h >> (scale + 1)) >= s_config.height) {
+        scale++;
+    }
+    return scale;
+}
+
+static void preview_task(void *arg)
+{
+    uint32_t frames = 0;
+    int64_t decode_us = 0;
+    int64_t stat_start = esp_timer_get_time();
+
+    while (!s_stop) {
+        camera_fb_t *fb = frame_bus_wait(s_sub, PREVIEW_WAIT_MS);
+        if (!fb) {
+            continue;
+        }
+
+        uint8_t scale = preview_pick_scale(fb->width, fb->height);
+        uint16_t sw = (fb->width + (1 << scale) - 1) >> scale;
+        uint16_t sh = (fb->height + (1 << scale) - 1) >> scale;
+        // 缩小后大于显示区域时居中裁剪，小于时按实际尺寸输出
+        img_thumb_rect_t clip = {
+            .w = sw < s_config.width ? sw : s_config.width,
+            .h = sh < s_config.height ? sh : s_config.height,
+        };
+        clip.x = (sw - clip.w) / 2;
+        clip.y = (sh - clip.h) / 2;
+
+        uint16_t *buf = s_buf[s_buf_idx];
+        int64_t start = esp_timer_get_time();
+        esp_err_t ret = img_thumb_decode_rgb565(fb->buf, fb->len, scale, &clip, s_config.swap, buf);
+        decode_us += esp_timer_get_time() - start;
+        // 解码完立即归还，显示期间不占用摄像头帧
+        frame_bus_done(s_sub);
+
+        if (ret != ESP_OK) {
+            continue;
+        }
+        s_config.flush_cb(buf, clip.w, clip.h, s_config.arg);
+        s_buf_idx ^= 1;
+        frames++;
+
+        int64_t now = esp_timer_get_time();
+        if (now - stat_start >= PREVIEW_STAT_INTERVAL) {
+            ESP_LOGI(TAG, "%.1f fps, decode %d ms/frame, skipped %u", frames * 1000000.0f / (now - stat_start),
+                     (int)(decode_us / 1000 / frames), (unsigned)frame_bus_skipped(s_sub));
+            frames = 0;
+            decode_us = 0;
+            stat_start = now;
+        }
+    }
+
+    xSemaphoreGive(s_exit);
+    vTaskSuspend(NULL);
+}
+
+static void preview_free(void)
+{
+    if (s_sub) {
+        frame_bus_unsubscribe(s_sub);
+        s_sub = NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        heap_caps_free(s_buf[i]);
+        s_buf[i] = NULL;
+    }
+    if (s_exit) {
+        vSemaphoreDelete(s_exit);
+        s_exit = NULL;
+    }
+}
+
+esp_err_t img_preview_start(const img_preview_config_t *config)
+{
+    if (!config || !config->flush_cb || !config->width || !config->height ||
+            (config->scale > 3 && config->scale != IMG_PREVIEW_SCALE_AUTO)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task) {
+        ESP_LOGW(TAG, "img_preview already started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_config = *config;
+    size_t buf_size = (size_t)config->width * config->height * sizeof(uint16_t);
+    for (int i = 0; i < 2; i++) {
+        s_buf[i] = heap_caps_aligned_calloc(PREVIEW_BUF_ALIGN, 1, buf_size, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    }
+    s_exit = xSemaphoreCreateBinary();
+    if (!s_buf[0] || !s_buf[1] || !s_exit) {
+        ESP_LOGE(TAG, "Failed to allocate preview buffers");
+        preview_free();
+        return ESP_ERR_NO_MEM;
+    }
+    s_sub = frame_bus_subscribe();
+    if (!s_sub) {
+        ESP_LOGE(TAG, "frame bus full");
+        preview_free();
+        return ESP_ERR_NO_MEM;
+    }
+
+    s_stop = false;
+    s_buf_idx = 0;
+    if (xTaskCreate(preview_task, "img_preview", PREVIEW_TASK_STACK, NULL, PREVIEW_TASK_PRIO, &s_task) != pdPASS) {
+        s_task = NULL;
+        preview_free();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "img_preview started: %ux%u", config->width, config->height);
+    return ESP_OK;
+}
+
+void img_preview_stop(void)
+{
+    if (!s_task) {
+        return;
+    }
+    s_stop = true;
+    xSemaphoreTake(s_exit, portMAX_DELAY);
+    vTaskDelete(s_task);
+    s_task = NULL;
+    preview_free();
+}
@@ -0,0 +1,206 @@
+// img_qr.c
+// 配网扫码：帧广播上的 MJPEG 帧降帧率、缩小解码为亮度图，交给 esp-code-scanner 识别二维码
+#include "img_qr.h"
+#include "img_thumb.h"
+#include "frame_bus.h"
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "string.h"
+#include <stdlib.h>
+
+#if CONFIG_GS_BIND_QR
+
+#include "esp_code_scanner.h"
+
+static const char *TAG = "img_qr";
+
+#define QR_TASK_STACK       8192    // 扫码库的调用栈较深
+#define QR_TASK_PRIO        3       // 低于串口任务和图传
+#define QR_TASK_CORE        1
+#define QR_WAIT_MS          200     // 停止请求的最长响应时间
+#define QR_DEC_MAX_W        640     // 缩小解码后的最大宽度，二维码模块仍有 2 像素以上
+#define QR_REPEAT_MS        10000   // 同一内容的重复回调间隔
+
+static img_qr_cb_t s_cb = NULL;
+static uint8_t *s_gray = NULL;
+static size_t s_gray_cap = 0;
+static frame_bus_sub_t *s_sub = NULL;
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_exit = NULL;
+static volatile bool s_stop = false;
+static uint32_t s_last_hash;
+static int64_t s_last_us;
+
+static uint32_t qr_hash(const char *data, size_t len)
+{
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t)data[i]) * 16777619u;
+    }
+    return h;
+}
+
+// 为当前帧尺寸准备亮度缓冲，返回缩小级别，失败返回 -1
+static int qr_prepare(uint16_t width, uint16_t height)
+{
+    int scale = 0;
+    while (scale < 3 && (width >> scale) > QR_DEC_MAX_W) {
+        scale++;
+    }
+    size_t need = (size_t)((width + (1 << scale) - 1) >> scale) * ((height + (1 << scale) - 1) >> scale);
+    if (need > s_gray_cap) {
+        heap_caps_free(s_gray);
+        s_gray_cap = 0;
+        s_gray = heap_caps_malloc(need, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!s_gray) {
+            ESP_LOGE(TAG, "Failed to allocate %u bytes", need);
+            return -1;
+        }
+        s_gray_cap = need;
+    }
+    return scale;
+}
+
+static void qr_report(const char *data, size_t len)
+{
+    uint32_t hash = qr_hash(data, len);
+    int64_t now = esp_timer_get_time();
+    if (hash == s_last_hash && now - s_last_us < (int64_t)QR_REPEAT_MS * 1000) {
+        return;
+    }
+    s_last_hash = hash;
+    s_last_us = now;
+    ESP_LOGI(TAG, "QR code found: %u bytes", len);
+    s_cb(data, len);
+}
+
+static void qr_task(void *arg)
+{
+    esp_image_scanner_t *scanner = esp_code_scanner_create();
+    uint16_t cfg_w = 0;
+    uint16_t cfg_h = 0;
+
+    while (scanner && !s_stop) {
+        camera_fb_t *fb = frame_bus_wait(s_sub, QR_WAIT_MS);
+        if (!fb) {
+            continue;
+        }
+        int scale = qr_prepare(fb->width, fb->height);
+        uint16_t w = 0;
+        uint16_t h = 0;
+        esp_err_t ret = scale < 0 ? ESP_ERR_NO_MEM :
+                        img_thumb_decode_gray(fb->buf, fb->len, scale, s_gray, s_gray_cap, &w, &h);
+        // 解码完即归还，扫码期间不占帧
+        frame_bus_done(s_sub);
+        if (ret != ESP_OK) {
+            continue;
+        }
+        if (w != cfg_w || h != cfg_h) {
+            esp_code_scanner_config_t config = {
+                ESP_CODE_SCANNER_MODE_FAST, ESP_CODE_SCANNER_IMAGE_GRAY, w, h,
+            };
+            esp_code_scanner_set_config(scanner, config);
+            cfg_w = w;
+            cfg_h = h;
+        }
+        if (esp_code_scanner_scan_image(scanner, s_gray) > 0) {
+            esp_code_scanner_symbol_t result = esp_code_scanner_result(scanner);
+            if (result.data) {
+                qr_report(result.data, strlen(result.data));
+            }
+        }
+    }
+
+    if (scanner) {
+        esp_code_scanner_destroy(scanner);
+    } else {
+        ESP_LOGE(TAG, "Failed to create code scanner");
+    }
+    xSemaphoreGive(s_exit);
+    vTaskSuspend(NULL);
+}
+
+static void qr_free(void)
+{
+    if (s_sub) {
+        frame_bus_unsubscribe(s_sub);
+        s_sub = NULL;
+    }
+    heap_caps_free(s_gray);
+    s_gray = NULL;
+    s_gray_cap = 0;
+    if (s_exit) {
+        vSemaphoreDelete(s_exit);
+        s_exit = NULL;
+    }
+}
+
+esp_err_t img_qr_start(img_qr_cb_t cb)
+{
+    if (!cb) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_task && s_stop) {
+        // 上次在回调中请求的停止，在此回收任务
+        img_qr_stop();
+    }
+    if (s_task) {
+        ESP_LOGW(TAG, "img_qr already started");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    s_exit = xSemaphoreCreateBinary();
+    s_sub = frame_bus_subscribe();
+    if (!s_exit || !s_sub) {
+        ESP_LOGE(TAG, "Failed to start QR scanning");
+        qr_free();
+        return ESP_ERR_NO_MEM;
+    }
+    frame_bus_set_interval(s_sub, 1000 / CONFIG_GS_BIND_QR_FPS);
+
+    s_cb = cb;
+    s_last_hash = 0;
+    s_last_us = 0;
+    s_stop = false;
+    if (xTaskCreatePinnedToCore(qr_task, "img_qr", QR_TASK_STACK, NULL, QR_TASK_PRIO,
+                                &s_task, QR_TASK_CORE) != pdPASS) {
+        s_task = NULL;
+        qr_free();
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "QR scanning started: %d fps", CONFIG_GS_BIND_QR_FPS);
+    return ESP_OK;
+}
+
+void img_qr_stop(void)
+{
+    if (!s_task) {
+        return;
+    }
+    s_stop = true;
+    if (xTaskGetCurrentTaskHandle() == s_task) {
+        return;
+    }
+    xSemaphoreTake(s_exit, portMAX_DELAY);
+    vTaskDelete(s_task);
+    s_task = NULL;
+    qr_free();
+}
+
+#else
+
+esp_err_t img_qr_start(img_qr_cb_t cb)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void img_qr_stop(void)
+{
+}
+
+#endif // CONFIG_GS_BIND_QR
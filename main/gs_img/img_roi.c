@@ -0,0 +1,94 @@
+// img_roi.c
+// 目标框到裁剪区域的换算与元数据，不依赖 RTOS，可在主机上测试
+#include "img_roi.h"
+#include "json_writer.h"
+
+#define ROI_ALIGN       16
+
+bool img_roi_select(const img_roi_box_t *boxes, size_t n, uint16_t frame_w, uint16_t frame_h,
+                    uint8_t margin_pct, uint32_t max_pixels, img_thumb_rect_t *rect, uint8_t *scale)
+{
+    if (!boxes || !n || !frame_w || !frame_h || !rect || !scale) {
+        return false;
+    }
+    int32_t x0 = boxes[0].x;
+    int32_t y0 = boxes[0].y;
+    int32_t x1 = boxes[0].x + boxes[0].w;
+    int32_t y1 = boxes[0].y + boxes[0].h;
+    for (size_t i = 1; i < n; i++) {
+        x0 = boxes[i].x < x0 ? boxes[i].x : x0;
+        y0 = boxes[i].y < y0 ? boxes[i].y : y0;
+        x1 = boxes[i].x + boxes[i].w > x1 ? boxes[i].x + boxes[i].w : x1;
+        y1 = boxes[i].y + boxes[i].h > y1 ? boxes[i].y + boxes[i].h : y1;
+    }
+
+    int32_t mx = (x1 - x0) * margin_pct / 100;
+    int32_t my = (y1 - y0) * margin_pct / 100;
+    x0 = (x0 - mx) & ~(ROI_ALIGN - 1);
+    y0 = (y0 - my) & ~(ROI_ALIGN - 1);
+    x1 = (x1 + mx + ROI_ALIGN - 1) & ~(ROI_ALIGN - 1);
+    y1 = (y1 + my + ROI_ALIGN - 1) & ~(ROI_ALIGN - 1);
+    x0 = x0 < 0 ? 0 : x0;
+    y0 = y0 < 0 ? 0 : y0;
+    x1 = x1 > frame_w ? frame_w : x1;
+    y1 = y1 > frame_h ? frame_h : y1;
+    if (x0 >= x1 || y0 >= y1) {
+        return false;
+    }
+    rect->x = (uint16_t)x0;
+    rect->y = (uint16_t)y0;
+    rect->w = (uint16_t)(x1 - x0);
+    rect->h = (uint16_t)(y1 - y0);
+
+    uint8_t s = 0;
+    while (s < 3 && (uint32_t)(rect->w >> s) * (rect->h >> s) > max_pixels) {
+        s++;
+    }
+    *scale = s;
+    return true;
+}
+
+void img_roi_scale_rect(const img_thumb_rect_t *in, uint8_t scale, img_thumb_rect_t *out)
+{
+    uint32_t round = (1u << scale) - 1;
+    uint32_t x1 = ((uint32_t)in->x + in->w + round) >> scale;
+    uint32_t y1 = ((uint32_t)in->y + in->h + round) >> scale;
+    out->x = in->x >> scale;
+    out->y = in->y >> scale;
+    out->w = (uint16_t)(x1 - out->x);
+    out->h = (uint16_t)(y1 - out->y);
+}
+
+static void roi_json_rect(json_writer_t *w, uint16_t x, uint16_t y, uint16_t rw, uint16_t rh)
+{
+    json_writer_uint(w, x);
+    json_writer_uint(w, y);
+    json_writer_uint(w, rw);
+    json_writer_uint(w, rh);
+}
+
+size_t img_roi_meta_json(char *buf, size_t size, uint32_t id, uint16_t frame_w, uint16_t frame_h,
+                         const img_thumb_rect_t *roi, const img_roi_box_t *boxes, size_t n)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_uint(&w, "id", id);
+    json_writer_kv_uint(&w, "w", frame_w);
+    json_writer_kv_uint(&w, "h", frame_h);
+    json_writer_key(&w, "roi");
+    json_writer_array_begin(&w);
+    roi_json_rect(&w, roi->x, roi->y, roi->w, roi->h);
+    json_writer_array_end(&w);
+    json_writer_key(&w, "boxes");
+    json_writer_array_begin(&w);
+    for (size_t i = 0; i < n; i++) {
+        json_writer_array_begin(&w);
+        roi_json_rect(&w, boxes[i].x, boxes[i].y, boxes[i].w, boxes[i].h);
+        json_writer_uint(&w, boxes[i].score);
+        json_writer_array_end(&w);
+    }
+    json_writer_array_end(&w);
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
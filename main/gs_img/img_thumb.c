@@ -0,0 +1,916 @@
+// img_thumb.c
+// 缩略图：ROM TJpgDec 在 DCT 域按 1/2^scale 缩小解码，再以基线 JPEG（YUV420）重新编码
+#include "img_thumb.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "rom/tjpgd.h"
+#include "string.h"
+#include <stdlib.h>
+#include <stdbool.h>
+
+static const char *TAG = "img_thumb";
+
+// ROM TJpgDec 需要的工作区大小
+#define THUMB_DEC_WORK_SIZE     3100
+
+// ========== JPEG 标准表（ITU-T T.81 Annex K） ==========
+static const uint8_t s_zigzag[64] = {
+    0,  1,  8, 16,  9,  2,  3, 10, 17, 24, 32, 25, 18, 11,  4,  5,
+    12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13,  6,  7, 14, 21, 28,
+    35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+    58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+};
+
+static const uint8_t s_std_qt[2][64] = {
+    {
+        16, 11, 10, 16,  24,  40,  51,  61,
+        12, 12, 14, 19,  26,  58,  60,  55,
+        14, 13, 16, 24,  40,  57,  69,  56,
+        14, 17, 22, 29,  51,  87,  80,  62,
+        18, 22, 37, 56,  68, 109, 103,  77,
+        24, 35, 55, 64,  81, 104, 113,  92,
+        49, 64, 78, 87, 103, 121, 120, 101,
+        72, 92, 95, 98, 112, 100, 103,  99,
+    },
+    {
+        17, 18, 24, 47, 99, 99, 99, 99,
+        18, 21, 26, 66, 99, 99, 99, 99,
+        24, 26, 56, 99, 99, 99, 99, 99,
+        47, 66, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+        99, 99, 99, 99, 99, 99, 99, 99,
+    },
+};
+
+static const float s_aan_scale[8] = {
+    1.0f, 1.387039845f, 1.306562965f, 1.175875602f,
+    1.0f, 0.785694958f, 0.541196100f, 0.275899379f,
+};
+
+// Huffman 表：亮度 DC、亮度 AC、色度 DC、色度 AC
+#define HUFF_TABLE_NUM  4
+static const uint8_t s_huff_class_id[HUFF_TABLE_NUM] = { 0x00, 0x10, 0x01, 0x11 };
+static const uint8_t s_huff_bits[HUFF_TABLE_NUM][16] = {
+    { 0, 1, 5, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0, 0, 0 },
+    { 0, 2, 1, 3, 3, 2, 4, 3, 5, 5, 4, 4, 0, 0, 1, 0x7d },
+    { 0, 3, 1, 1, 1, 1, 1, 1, 1, 1, 1, 0, 0, 0, 0, 0 },
+    { 0, 2, 1, 2, 4, 4, 3, 4, 7, 5, 4, 4, 0, 1, 2, 0x77 },
+};
+static const uint8_t s_huff_dc_val[12] = { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11 };
+static const uint8_t s_huff_ac_lum_val[162] = {
+    0x01, 0x02, 0x03, 0x00, 0x04, 0x11, 0x05, 0x12, 0x21, 0x31, 0x41, 0x06, 0x13, 0x51, 0x61, 0x07,
+    0x22, 0x71, 0x14, 0x32, 0x81, 0x91, 0xa1, 0x08, 0x23, 0x42, 0xb1, 0xc1, 0x15, 0x52, 0xd1, 0xf0,
+    0x24, 0x33, 0x62, 0x72, 0x82, 0x09, 0x0a, 0x16, 0x17, 0x18, 0x19, 0x1a, 0x25, 0x26, 0x27, 0x28,
+    0x29, 0x2a, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49,
+    0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68, 0x69,
+    0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89,
+    0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5, 0xa6, 0xa7,
+    0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3, 0xc4, 0xc5,
+    0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda, 0xe1, 0xe2,
+    0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf1, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+static const uint8_t s_huff_ac_chr_val[162] = {
+    0x00, 0x01, 0x02, 0x03, 0x11, 0x04, 0x05, 0x21, 0x31, 0x06, 0x12, 0x41, 0x51, 0x07, 0x61, 0x71,
+    0x13, 0x22, 0x32, 0x81, 0x08, 0x14, 0x42, 0x91, 0xa1, 0xb1, 0xc1, 0x09, 0x23, 0x33, 0x52, 0xf0,
+    0x15, 0x62, 0x72, 0xd1, 0x0a, 0x16, 0x24, 0x34, 0xe1, 0x25, 0xf1, 0x17, 0x18, 0x19, 0x1a, 0x26,
+    0x27, 0x28, 0x29, 0x2a, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3a, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48,
+    0x49, 0x4a, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5a, 0x63, 0x64, 0x65, 0x66, 0x67, 0x68,
+    0x69, 0x6a, 0x73, 0x74, 0x75, 0x76, 0x77, 0x78, 0x79, 0x7a, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87,
+    0x88, 0x89, 0x8a, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9a, 0xa2, 0xa3, 0xa4, 0xa5,
+    0xa6, 0xa7, 0xa8, 0xa9, 0xaa, 0xb2, 0xb3, 0xb4, 0xb5, 0xb6, 0xb7, 0xb8, 0xb9, 0xba, 0xc2, 0xc3,
+    0xc4, 0xc5, 0xc6, 0xc7, 0xc8, 0xc9, 0xca, 0xd2, 0xd3, 0xd4, 0xd5, 0xd6, 0xd7, 0xd8, 0xd9, 0xda,
+    0xe2, 0xe3, 0xe4, 0xe5, 0xe6, 0xe7, 0xe8, 0xe9, 0xea, 0xf2, 0xf3, 0xf4, 0xf5, 0xf6, 0xf7, 0xf8,
+    0xf9, 0xfa,
+};
+static const uint8_t *const s_huff_val[HUFF_TABLE_NUM] = {
+    s_huff_dc_val, s_huff_ac_lum_val, s_huff_dc_val, s_huff_ac_chr_val,
+};
+
+// 标准 DHT 段：UVC MJPEG 帧通常省略 Huffman 表，解码前需补上；编码时也直接写入
+#define STD_DHT_SIZE    420
+static uint8_t s_std_dht[STD_DHT_SIZE];
+static bool s_std_dht_built = false;
+
+static void build_std_dht(void)
+{
+    if (s_std_dht_built) {
+        return;
+    }
+    size_t pos = 0;
+    s_std_dht[pos++] = 0xFF;
+    s_std_dht[pos++] = 0xC4;
+    s_std_dht[pos++] = (uint8_t)((STD_DHT_SIZE - 2) >> 8);
+    s_std_dht[pos++] = (uint8_t)((STD_DHT_SIZE - 2) & 0xFF);
+    for (int t = 0; t < HUFF_TABLE_NUM; t++) {
+        int count = 0;
+        s_std_dht[pos++] = s_huff_class_id[t];
+        for (int i = 0; i < 16; i++) {
+            s_std_dht[pos++] = s_huff_bits[t][i];
+            count += s_huff_bits[t][i];
+        }
+        memcpy(&s_std_dht[pos], s_huff_val[t], count);
+        pos += count;
+    }
+    s_std_dht_built = true;
+}
+
+// ========== 解码：ROM TJpgDec ==========
+typedef struct {
+    const uint8_t *seg[3];      // 输入分段：SOS 之前 / 补入的 DHT / SOS 及之后
+    size_t seg_len[3];
+    int seg_idx;
+    size_t seg_pos;
+    uint8_t *rgb;               // 缩小后的 RGB888 图像
+    uint8_t *gray;              // 缩小后的亮度图（扫码），与 rgb 二选一
+    uint16_t width;
+    uint16_t height;
+    uint16_t *rgb565;           // 预览输出：只写 clip 区域，每行 clip.w 像素
+    img_thumb_rect_t clip;      // 预览与裁剪的输出区域
+    bool swap;
+} thumb_dec_t;
+
+// 查找 SOS 标记位置，同时判断是否带有 DHT 段，格式错误返回 0
+static size_t jpeg_find_sos(const uint8_t *jpg, size_t len, bool *has_dht)
+{
+    size_t pos = 2;
+    *has_dht = false;
+    while (pos + 4 <= len) {
+        if (jpg[pos] != 0xFF) {
+            return 0;
+        }
+        uint8_t marker = jpg[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0xDA) {
+            return pos;
+        }
+        if (marker == 0xC4) {
+            *has_dht = true;
+        }
+        pos += 2 + ((jpg[pos + 2] << 8) | jpg[pos + 3]);
+    }
+    return 0;
+}
+
+// 从 SOF 段读取宽高，只扫描 SOS 之前的段
+static bool jpeg_read_size(const uint8_t *jpg, size_t len, uint16_t *width, uint16_t *height)
+{
+    size_t pos = 2;
+    while (pos + 9 <= len && jpg[pos] == 0xFF) {
+        uint8_t marker = jpg[pos + 1];
+        if (marker == 0xFF) {
+            pos++;
+            continue;
+        }
+        if (marker == 0xDA) {
+            break;
+        }
+        if (marker >= 0xC0 && marker <= 0xC2) {
+            *height = (jpg[pos + 5] << 8) | jpg[pos + 6];
+            *width = (jpg[pos + 7] << 8) | jpg[pos + 8];
+            return *width && *height;
+        }
+        pos += 2 + ((jpg[pos + 2] << 8) | jpg[pos + 3]);
+    }
+    return false;
+}
+
+static unsigned int thumb_dec_input(JDEC *jd, uint8_t *buf, unsigned int nbyte)
+{
+    thumb_dec_t *dec = (thumb_dec_t *)jd->device;
+    unsigned int done = 0;
+    while (done < nbyte && dec->seg_idx < 3) {
+        size_t left = dec->seg_len[dec->seg_idx] - dec->seg_pos;
+        if (left == 0) {
+            dec->seg_idx++;
+            dec->seg_pos = 0;
+            continue;
+        }
+        size_t n = (left < nbyte - done) ? left : nbyte - done;
+        if (buf) {
+            memcpy(buf + done, dec->seg[dec->seg_idx] + dec->seg_pos, n);
+        }
+        dec->seg_pos += n;
+        done += n;
+    }
+    return done;
+}
+
+static unsigned int thumb_dec_output(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    thumb_dec_t *dec = (thumb_dec_t *)jd->device;
+    const uint8_t *src = (const uint8_t *)bitmap;
+    int rect_w = rect->right - rect->left + 1;
+    if (rect->left >= dec->width) {
+        return 1;
+    }
+    int copy_w = (rect->left + rect_w <= dec->width) ? rect_w : dec->width - rect->left;
+    for (int y = rect->top; y <= rect->bottom && y < dec->height; y++) {
+        memcpy(dec->rgb + ((size_t)y * dec->width + rect->left) * 3, src, copy_w * 3);
+        src += rect_w * 3;
+    }
+    return 1;
+}
+
+// 只保留亮度：Y = (77R + 150G + 29B) / 256，每像素 1 字节
+static unsigned int thumb_dec_output_gray(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    thumb_dec_t *dec = (thumb_dec_t *)jd->device;
+    const uint8_t *src = (const uint8_t *)bitmap;
+    int rect_w = rect->right - rect->left + 1;
+    if (rect->left >= dec->width) {
+        return 1;
+    }
+    int copy_w = (rect->left + rect_w <= dec->width) ? rect_w : dec->width - rect->left;
+    for (int y = rect->top; y <= rect->bottom && y < dec->height; y++) {
+        uint8_t *dst = dec->gray + (size_t)y * dec->width + rect->left;
+        const uint8_t *p = src;
+        for (int x = 0; x < copy_w; x++, p += 3) {
+            dst[x] = (77 * p[0] + 150 * p[1] + 29 * p[2]) >> 8;
+        }
+        src += rect_w * 3;
+    }
+    return 1;
+}
+
+// 裁剪：只保留 clip 内的 RGB888（每行 clip.w 像素），越过 clip 底边后中断解码
+static unsigned int thumb_dec_output_crop(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    thumb_dec_t *dec = (thumb_dec_t *)jd->device;
+    const img_thumb_rect_t *clip = &dec->clip;
+    if (rect->top >= clip->y + clip->h) {
+        return 0;
+    }
+    int x0 = rect->left > clip->x ? rect->left : clip->x;
+    int x1 = rect->right < clip->x + clip->w - 1 ? rect->right : clip->x + clip->w - 1;
+    int y0 = rect->top > clip->y ? rect->top : clip->y;
+    int y1 = rect->bottom < clip->y + clip->h - 1 ? rect->bottom : clip->y + clip->h - 1;
+    if (x0 > x1 || y0 > y1) {
+        return 1;
+    }
+    int rect_w = rect->right - rect->left + 1;
+    for (int y = y0; y <= y1; y++) {
+        const uint8_t *src = (const uint8_t *)bitmap + ((size_t)(y - rect->top) * rect_w + (x0 - rect->left)) * 3;
+        memcpy(dec->rgb + ((size_t)(y - clip->y) * clip->w + (x0 - clip->x)) * 3, src, (x1 - x0 + 1) * 3);
+    }
+    return 1;
+}
+
+/*
+ * RGB888 行转 RGB565：hi = R5G3，lo = G3B5，按显示端字节序写入；
+ * 目标 4 字节对齐时两像素合成一次 32 位写，PSRAM 写次数减半
+ */
+#define RGB565_HI(p)    (((p)[0] & 0xF8) | ((p)[1] >> 5))
+#define RGB565_LO(p)    ((((p)[1] << 3) & 0xE0) | ((p)[2] >> 3))
+
+static void rgb888_to_rgb565_row(uint16_t *dst, const uint8_t *src, int n)
+{
+    if (n > 0 && ((uintptr_t)dst & 3)) {
+        *dst++ = (RGB565_HI(src) << 8) | RGB565_LO(src);
+        src += 3;
+        n--;
+    }
+    uint32_t *dst32 = (uint32_t *)dst;
+    for (; n >= 2; n -= 2, src += 6) {
+        *dst32++ = ((uint32_t)RGB565_HI(src + 3) << 24) | ((uint32_t)RGB565_LO(src + 3) << 16) |
+                   (RGB565_HI(src) << 8) | RGB565_LO(src);
+    }
+    if (n) {
+        *(uint16_t *)dst32 = (RGB565_HI(src) << 8) | RGB565_LO(src);
+    }
+}
+
+static void rgb888_to_rgb565_swap_row(uint16_t *dst, const uint8_t *src, int n)
+{
+    if (n > 0 && ((uintptr_t)dst & 3)) {
+        *dst++ = (RGB565_LO(src) << 8) | RGB565_HI(src);
+        src += 3;
+        n--;
+    }
+    uint32_t *dst32 = (uint32_t *)dst;
+    for (; n >= 2; n -= 2, src += 6) {
+        *dst32++ = ((uint32_t)RGB565_LO(src + 3) << 24) | ((uint32_t)RGB565_HI(src + 3) << 16) |
+                   (RGB565_LO(src) << 8) | RGB565_HI(src);
+    }
+    if (n) {
+        *(uint16_t *)dst32 = (RGB565_LO(src) << 8) | RGB565_HI(src);
+    }
+}
+
+// 只转换落在 clip 内的部分；越过 clip 底边后中断解码，其余 MCU 不再做 IDCT
+static unsigned int thumb_dec_output_rgb565(JDEC *jd, void *bitmap, JRECT *rect)
+{
+    thumb_dec_t *dec = (thumb_dec_t *)jd->device;
+    const img_thumb_rect_t *clip = &dec->clip;
+    if (rect->top >= clip->y + clip->h) {
+        return 0;
+    }
+    int x0 = rect->left > clip->x ? rect->left : clip->x;
+    int x1 = rect->right < clip->x + clip->w - 1 ? rect->right : clip->x + clip->w - 1;
+    int y0 = rect->top > clip->y ? rect->top : clip->y;
+    int y1 = rect->bottom < clip->y + clip->h - 1 ? rect->bottom : clip->y + clip->h - 1;
+    if (x0 > x1 || y0 > y1) {
+        return 1;
+    }
+    int rect_w = rect->right - rect->left + 1;
+    void (*convert)(uint16_t *, const uint8_t *, int) = dec->swap ? rgb888_to_rgb565_swap_row : rgb888_to_rgb565_row;
+    for (int y = y0; y <= y1; y++) {
+        const uint8_t *src = (const uint8_t *)bitmap + ((size_t)(y - rect->top) * rect_w + (x0 - rect->left)) * 3;
+        uint16_t *dst = dec->rgb565 + (size_t)(y - clip->y) * clip->w + (x0 - clip->x);
+        convert(dst, src, x1 - x0 + 1);
+    }
+    return 1;
+}
+
+// 设置输入分段，缺少 Huffman 表的 MJPEG 帧在 SOS 前补入标准 DHT
+static esp_err_t thumb_dec_setup(thumb_dec_t *dec, const uint8_t *jpg, size_t len)
+{
+    build_std_dht();
+
+    bool has_dht = false;
+    size_t sos = jpeg_find_sos(jpg, len, &has_dht);
+    if (sos == 0) {
+        ESP_LOGW(TAG, "No SOS marker found");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (has_dht) {
+        dec->seg[0] = jpg;
+        dec->seg_len[0] = len;
+    } else {
+        dec->seg[0] = jpg;
+        dec->seg_len[0] = sos;
+        dec->seg[1] = s_std_dht;
+        dec->seg_len[1] = STD_DHT_SIZE;
+        dec->seg[2] = jpg + sos;
+        dec->seg_len[2] = len - sos;
+    }
+    return ESP_OK;
+}
+
+// ========== 编码：基线 JPEG，YUV420 ==========
+typedef struct {
+    uint8_t *buf;
+    size_t cap;
+    size_t len;
+    bool overflow;
+    const char *comment;        // 非空时写入 COM 段
+    uint32_t bit_buf;
+    int bit_cnt;
+    int dc_pred[3];
+    uint8_t qt[2][64];          // 量化表（自然顺序），写入 DQT
+    float qdiv[2][64];          // 量化倒数（含 AAN 缩放）
+    uint16_t huff_code[HUFF_TABLE_NUM][256];
+    uint8_t huff_size[HUFF_TABLE_NUM][256];
+} jpeg_enc_t;
+
+static void enc_init_tables(jpeg_enc_t *enc, uint8_t quality)
+{
+    if (quality < 1) {
+        quality = 1;
+    } else if (quality > 100) {
+        quality = 100;
+    }
+    int scale = (quality < 50) ? 5000 / quality : 200 - quality * 2;
+    for (int t = 0; t < 2; t++) {
+        for (int i = 0; i < 64; i++) {
+            int q = (s_std_qt[t][i] * scale + 50) / 100;
+            q = (q < 1) ? 1 : (q > 255) ? 255 : q;
+            enc->qt[t][i] = (uint8_t)q;
+            enc->qdiv[t][i] = 1.0f / (q * s_aan_scale[i >> 3] * s_aan_scale[i & 7] * 8.0f);
+        }
+    }
+    for (int t = 0; t < HUFF_TABLE_NUM; t++) {
+        uint16_t code = 0;
+        int k = 0;
+        for (int len = 1; len <= 16; len++) {
+            for (int i = 0; i < s_huff_bits[t][len - 1]; i++) {
+                uint8_t val = s_huff_val[t][k++];
+                enc->huff_code[t][val] = code++;
+                enc->huff_size[t][val] = (uint8_t)len;
+            }
+            code <<= 1;
+        }
+    }
+}
+
+static void enc_put_byte(jpeg_enc_t *enc, uint8_t b)
+{
+    if (enc->len < enc->cap) {
+        enc->buf[enc->len++] = b;
+    } else {
+        enc->overflow = true;
+    }
+}
+
+static void enc_put_u16(jpeg_enc_t *enc, uint16_t v)
+{
+    enc_put_byte(enc, (uint8_t)(v >> 8));
+    enc_put_byte(enc, (uint8_t)(v & 0xFF));
+}
+
+static void enc_put_bits(jpeg_enc_t *enc, uint32_t code, int size)
+{
+    enc->bit_buf = (enc->bit_buf << size) | (code & ((1u << size) - 1));
+    enc->bit_cnt += size;
+    while (enc->bit_cnt >= 8) {
+        uint8_t b = (uint8_t)(enc->bit_buf >> (enc->bit_cnt - 8));
+        enc_put_byte(enc, b);
+        if (b == 0xFF) {
+            enc_put_byte(enc, 0x00);
+        }
+        enc->bit_cnt -= 8;
+    }
+}
+
+static void enc_put_huff(jpeg_enc_t *enc, int table, uint8_t sym)
+{
+    enc_put_bits(enc, enc->huff_code[table][sym], enc->huff_size[table][sym]);
+}
+
+static void enc_write_headers(jpeg_enc_t *enc, uint16_t width, uint16_t height)
+{
+    static const uint8_t app0[] = {
+        0xFF, 0xE0, 0x00, 0x10, 'J', 'F', 'I', 'F', 0x00, 0x01, 0x01, 0x00, 0x00, 0x01, 0x00, 0x01, 0x00, 0x00,
+    };
+    enc_put_u16(enc, 0xFFD8);
+    for (size_t i = 0; i < sizeof(app0); i++) {
+        enc_put_byte(enc, app0[i]);
+    }
+    if (enc->comment) {
+        size_t n = strlen(enc->comment);
+        n = n > 0xFFFD ? 0xFFFD : n;
+        enc_put_u16(enc, 0xFFFE);
+        enc_put_u16(enc, (uint16_t)(n + 2));
+        for (size_t i = 0; i < n; i++) {
+            enc_put_byte(enc, (uint8_t)enc->comment[i]);
+        }
+    }
+
+    // DQT：两张表，按 zigzag 顺序
+    enc_put_u16(enc, 0xFFDB);
+    enc_put_u16(enc, 2 + 2 * 65);
+    for (int t = 0; t < 2; t++) {
+        enc_put_byte(enc, (uint8_t)t);
+        for (int i = 0; i < 64; i++) {
+            enc_put_byte(enc, enc->qt[t][s_zigzag[i]]);
+        }
+    }
+
+    // SOF0：Y 2x2 采样，Cb/Cr 1x1
+    enc_put_u16(enc, 0xFFC0);
+    enc_put_u16(enc, 17);
+    enc_put_byte(enc, 8);
+    enc_put_u16(enc, height);
+    enc_put_u16(enc, width);
+    enc_put_byte(enc, 3);
+    static const uint8_t comps[3][3] = { { 1, 0x22, 0 }, { 2, 0x11, 1 }, { 3, 0x11, 1 } };
+    for (int c = 0; c < 3; c++) {
+        enc_put_byte(enc, comps[c][0]);
+        enc_put_byte(enc, comps[c][1]);
+        enc_put_byte(enc, comps[c][2]);
+    }
+
+    for (int i = 0; i < STD_DHT_SIZE; i++) {
+        enc_put_byte(enc, s_std_dht[i]);
+    }
+
+    // SOS
+    enc_put_u16(enc, 0xFFDA);
+    enc_put_u16(enc, 12);
+    enc_put_byte(enc, 3);
+    static const uint8_t sos[3][2] = { { 1, 0x00 }, { 2, 0x11 }, { 3, 0x11 } };
+    for (int c = 0; c < 3; c++) {
+        enc_put_byte(enc, sos[c][0]);
+        enc_put_byte(enc, sos[c][1]);
+    }
+    enc_put_byte(enc, 0);
+    enc_put_byte(enc, 63);
+    enc_put_byte(enc, 0);
+}
+
+// AAN 浮点前向 DCT（输出需再乘 qdiv 完成缩放与量化）
+static void enc_fdct(float *data)
+{
+    for (int pass = 0; pass < 2; pass++) {
+        int step = pass ? 8 : 1;       // 第一遍按行，第二遍按列
+        int next = pass ? 1 : 8;
+        for (int i = 0; i < 8; i++) {
+            float *p = data + i * next;
+            float tmp0 = p[0 * step] + p[7 * step];
+            float tmp7 = p[0 * step] - p[7 * step];
+            float tmp1 = p[1 * step] + p[6 * step];
+            float tmp6 = p[1 * step] - p[6 * step];
+            float tmp2 = p[2 * step] + p[5 * step];
+            float tmp5 = p[2 * step] - p[5 * step];
+            float tmp3 = p[3 * step] + p[4 * step];
+            float tmp4 = p[3 * step] - p[4 * step];
+
+            float tmp10 = tmp0 + tmp3;
+            float tmp13 = tmp0 - tmp3;
+            float tmp11 = tmp1 + tmp2;
+            float tmp12 = tmp1 - tmp2;
+            p[0 * step] = tmp10 + tmp11;
+            p[4 * step] = tmp10 - tmp11;
+            float z1 = (tmp12 + tmp13) * 0.707106781f;
+            p[2 * step] = tmp13 + z1;
+            p[6 * step] = tmp13 - z1;
+
+            tmp10 = tmp4 + tmp5;
+            tmp11 = tmp5 + tmp6;
+            tmp12 = tmp6 + tmp7;
+            float z5 = (tmp10 - tmp12) * 0.382683433f;
+            float z2 = 0.541196100f * tmp10 + z5;
+            float z4 = 1.306562965f * tmp12 + z5;
+            float z3 = tmp11 * 0.707106781f;
+            float z11 = tmp7 + z3;
+            float z13 = tmp7 - z3;
+            p[5 * step] = z13 + z2;
+            p[3 * step] = z13 - z2;
+            p[1 * step] = z11 + z4;
+            p[7 * step] = z11 - z4;
+        }
+    }
+}
+
+static inline int enc_bit_len(int v)
+{
+    return v ? 32 - __builtin_clz((unsigned)v) : 0;
+}
+
+static void enc_block(jpeg_enc_t *enc, float *data, int comp)
+{
+    int q = comp ? 1 : 0;
+    int dc_table = q * 2;
+    int ac_table = q * 2 + 1;
+    int coef[64];
+
+    enc_fdct(data);
+    for (int i = 0; i < 64; i++) {
+        float v = data[i] * enc->qdiv[q][i];
+        coef[i] = (int)(v < 0 ? v - 0.5f : v + 0.5f);
+    }
+
+    int diff = coef[0] - enc->dc_pred[comp];
+    enc->dc_pred[comp] = coef[0];
+    int nbits = enc_bit_len(diff < 0 ? -diff : diff);
+    enc_put_huff(enc, dc_table, (uint8_t)nbits);
+    if (nbits) {
+        enc_put_bits(enc, diff < 0 ? diff - 1 : diff, nbits);
+    }
+
+    int run = 0;
+    for (int k = 1; k < 64; k++) {
+        int v = coef[s_zigzag[k]];
+        if (v == 0) {
+            run++;
+            continue;
+        }
+        while (run > 15) {
+            enc_put_huff(enc, ac_table, 0xF0);
+            run -= 16;
+        }
+        nbits = enc_bit_len(v < 0 ? -v : v);
+        enc_put_huff(enc, ac_table, (uint8_t)((run << 4) | nbits));
+        enc_put_bits(enc, v < 0 ? v - 1 : v, nbits);
+        run = 0;
+    }
+    if (run > 0) {
+        enc_put_huff(enc, ac_table, 0x00);
+    }
+}
+
+// 编码一个 16x16 MCU：4 个 Y 块 + 2x2 平均后的 Cb、Cr 块，越界像素取边缘值
+static void enc_mcu(jpeg_enc_t *enc, const uint8_t *rgb, int width, int height, int mx, int my)
+{
+    float y[4][64];
+    float cb[64] = {0};
+    float cr[64] = {0};
+    for (int r = 0; r < 16; r++) {
+        int sy = (my + r < height) ? my + r : height - 1;
+        for (int c = 0; c < 16; c++) {
+            int sx = (mx + c < width) ? mx + c : width - 1;
+            const uint8_t *p = rgb + ((size_t)sy * width + sx) * 3;
+            float R = p[0], G = p[1], B = p[2];
+            y[(r >> 3) * 2 + (c >> 3)][(r & 7) * 8 + (c & 7)] = 0.299f * R + 0.587f * G + 0.114f * B - 128.0f;
+            int ci = (r >> 1) * 8 + (c >> 1);
+            cb[ci] += (-0.168736f * R - 0.331264f * G + 0.5f * B) * 0.25f;
+            cr[ci] += (0.5f * R - 0.418688f * G - 0.081312f * B) * 0.25f;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        enc_block(enc, y[i], 0);
+    }
+    enc_block(enc, cb, 1);
+    enc_block(enc, cr, 2);
+}
+
+// 编码一个 16x16 MCU，源为 YUY2（Y0 U Y1 V），4:2:2 的色度再按行两两平均成 4:2:0，越界像素取边缘值
+static void enc_mcu_yuyv(jpeg_enc_t *enc, const uint8_t *yuyv, int width, int height, int mx, int my)
+{
+    float y[4][64];
+    float cb[64] = {0};
+    float cr[64] = {0};
+    for (int r = 0; r < 16; r++) {
+        int sy = (my + r < height) ? my + r : height - 1;
+        const uint8_t *row = yuyv + (size_t)sy * width * 2;
+        for (int c = 0; c < 16; c++) {
+            int sx = (mx + c < width) ? mx + c : width - 1;
+            const uint8_t *pair = row + (sx & ~1) * 2;
+            y[(r >> 3) * 2 + (c >> 3)][(r & 7) * 8 + (c & 7)] = (float)row[sx * 2] - 128.0f;
+            int ci = (r >> 1) * 8 + (c >> 1);
+            cb[ci] += ((float)pair[1] - 128.0f) * 0.25f;
+            cr[ci] += ((float)pair[3] - 128.0f) * 0.25f;
+        }
+    }
+    for (int i = 0; i < 4; i++) {
+        enc_block(enc, y[i], 0);
+    }
+    enc_block(enc, cb, 1);
+    enc_block(enc, cr, 2);
+}
+
+typedef void (*enc_mcu_fn_t)(jpeg_enc_t *enc, const uint8_t *src, int width, int height, int mx, int my);
+
+// 编码整幅图像到 out，超出 cap 返回 ESP_ERR_INVALID_SIZE
+static esp_err_t enc_image(enc_mcu_fn_t mcu, const uint8_t *src, uint16_t width, uint16_t height, uint8_t quality,
+                           const char *comment, uint8_t *out, size_t cap, size_t *out_len)
+{
+    jpeg_enc_t *enc = heap_caps_calloc(1, sizeof(jpeg_enc_t), MALLOC_CAP_DEFAULT);
+    if (!enc) {
+        return ESP_ERR_NO_MEM;
+    }
+    enc->buf = out;
+    enc->cap = cap;
+    enc->comment = comment;
+    // 不经过解码直接编码时 DHT 尚未生成
+    build_std_dht();
+    enc_init_tables(enc, quality);
+    enc_write_headers(enc, width, height);
+    for (int my = 0; my < height; my += 16) {
+        for (int mx = 0; mx < width; mx += 16) {
+            mcu(enc, src, width, height, mx, my);
+        }
+    }
+    enc_put_bits(enc, 0x7F, 7);    // 用 1 填充最后一个字节
+    enc_put_u16(enc, 0xFFD9);
+
+    esp_err_t ret = enc->overflow ? ESP_ERR_INVALID_SIZE : ESP_OK;
+    *out_len = enc->len;
+    free(enc);
+    return ret;
+}
+
+static esp_err_t thumb_encode(const uint8_t *rgb, uint16_t width, uint16_t height, uint8_t quality,
+                              const char *comment, uint8_t **out, size_t *out_len)
+{
+    // 缩略图一般远小于 1 字节/像素，按此上限分配，超出则报错
+    size_t cap = (size_t)width * height + 2048 + (comment ? strlen(comment) + 4 : 0);
+    uint8_t *buf = heap_caps_malloc(cap, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    esp_err_t ret = enc_image(enc_mcu, rgb, width, height, quality, comment, buf, cap, out_len);
+    if (ret == ESP_OK) {
+        *out = buf;
+    } else {
+        if (ret == ESP_ERR_INVALID_SIZE) {
+            ESP_LOGW(TAG, "Thumbnail exceeds %u bytes", cap);
+        }
+        free(buf);
+    }
+    return ret;
+}
+
+esp_err_t img_thumb_encode_yuyv(const uint8_t *yuyv, uint16_t width, uint16_t height, uint8_t quality,
+                                uint8_t *out, size_t out_cap, size_t *out_len)
+{
+    if (!yuyv || !width || !height || !out || !out_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return enc_image(enc_mcu_yuyv, yuyv, width, height, quality, NULL, out, out_cap, out_len);
+}
+
+esp_err_t img_thumb_make(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t quality,
+                         uint8_t **out, size_t *out_len)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || scale > 3 || !out || !out_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t start_us = esp_timer_get_time();
+
+    thumb_dec_t dec = {0};
+    esp_err_t ret = thumb_dec_setup(&dec, jpg, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = ESP_FAIL;
+    void *work = heap_caps_malloc(THUMB_DEC_WORK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!work) {
+        return ESP_ERR_NO_MEM;
+    }
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, thumb_dec_input, work, THUMB_DEC_WORK_SIZE, &dec);
+    if (res != JDR_OK) {
+        ESP_LOGW(TAG, "jd_prepare failed: %d", res);
+        goto done;
+    }
+    dec.width = (jd.width + (1 << scale) - 1) >> scale;
+    dec.height = (jd.height + (1 << scale) - 1) >> scale;
+    dec.rgb = heap_caps_calloc((size_t)dec.width * dec.height, 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!dec.rgb) {
+        ret = ESP_ERR_NO_MEM;
+        goto done;
+    }
+    res = jd_decomp(&jd, thumb_dec_output, scale);
+    if (res != JDR_OK) {
+        ESP_LOGW(TAG, "jd_decomp failed: %d", res);
+        goto done;
+    }
+    int64_t decode_us = esp_timer_get_time();
+
+    ret = thumb_encode(dec.rgb, dec.width, dec.height, quality, NULL, out, out_len);
+    if (ret == ESP_OK) {
+        int64_t end_us = esp_timer_get_time();
+        ESP_LOGI(TAG, "Thumbnail %ux%u -> %ux%u, %u -> %u bytes, decode %d ms, encode %d ms",
+                 jd.width, jd.height, dec.width, dec.height, len, *out_len,
+                 (int)((decode_us - start_us) / 1000), (int)((end_us - decode_us) / 1000));
+    }
+
+done:
+    free(dec.rgb);
+    free(work);
+    return ret;
+}
+
+esp_err_t img_thumb_crop(const uint8_t *jpg, size_t len, uint8_t scale, const img_thumb_rect_t *rect,
+                         uint8_t quality, const char *comment, uint8_t **out, size_t *out_len)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || scale > 3 || !rect || !rect->w || !rect->h ||
+            !out || !out_len) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    int64_t start_us = esp_timer_get_time();
+
+    thumb_dec_t dec = {0};
+    esp_err_t ret = thumb_dec_setup(&dec, jpg, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    ret = ESP_FAIL;
+    void *work = heap_caps_malloc(THUMB_DEC_WORK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!work) {
+        return ESP_ERR_NO_MEM;
+    }
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, thumb_dec_input, work, THUMB_DEC_WORK_SIZE, &dec);
+    if (res != JDR_OK) {
+        ESP_LOGW(TAG, "jd_prepare failed: %d", res);
+        goto done;
+    }
+    // 区域限制在缩小后的图像内
+    uint16_t sw = (jd.width + (1 << scale) - 1) >> scale;
+    uint16_t sh = (jd.height + (1 << scale) - 1) >> scale;
+    if (rect->x >= sw || rect->y >= sh) {
+        ret = ESP_ERR_INVALID_ARG;
+        goto done;
+    }
+    dec.clip = *rect;
+    dec.clip.w = rect->x + rect->w > sw ? sw - rect->x : rect->w;
+    dec.clip.h = rect->y + rect->h > sh ? sh - rect->y : rect->h;
+    dec.rgb = heap_caps_calloc((size_t)dec.clip.w * dec.clip.h, 3, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!dec.rgb) {
+        ret = ESP_ERR_NO_MEM;
+        goto done;
+    }
+    res = jd_decomp(&jd, thumb_dec_output_crop, scale);
+    if (res != JDR_OK && res != JDR_INTR) {
+        ESP_LOGW(TAG, "jd_decomp failed: %d", res);
+        goto done;
+    }
+    int64_t decode_us = esp_timer_get_time();
+
+    ret = thumb_encode(dec.rgb, dec.clip.w, dec.clip.h, quality, comment, out, out_len);
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Crop %ux%u+%u+%u at 1/%d, %u -> %u bytes, decode %d ms, encode %d ms",
+                 dec.clip.w, dec.clip.h, dec.clip.x, dec.clip.y, 1 << scale, len, *out_len,
+                 (int)((decode_us - start_us) / 1000), (int)((esp_timer_get_time() - decode_us) / 1000));
+    }
+
+done:
+    free(dec.rgb);
+    free(work);
+    return ret;
+}
+
+esp_err_t img_thumb_get_size(const uint8_t *jpg, size_t len, uint16_t *width, uint16_t *height)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || !width || !height) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return jpeg_read_size(jpg, len, width, height) ? ESP_OK : ESP_ERR_INVALID_ARG;
+}
+
+// 整幅缩小解码到调用者的缓冲，bpp 为输出每像素字节数
+static esp_err_t thumb_decode_full(thumb_dec_t *dec, const uint8_t *jpg, size_t len, uint8_t scale,
+                                   unsigned int (*output)(JDEC *, void *, JRECT *), size_t bpp, size_t cap,
+                                   uint16_t *width, uint16_t *height)
+{
+    esp_err_t ret = thumb_dec_setup(dec, jpg, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    void *work = heap_caps_malloc(THUMB_DEC_WORK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!work) {
+        return ESP_ERR_NO_MEM;
+    }
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, thumb_dec_input, work, THUMB_DEC_WORK_SIZE, dec);
+    if (res == JDR_OK) {
+        dec->width = (jd.width + (1 << scale) - 1) >> scale;
+        dec->height = (jd.height + (1 << scale) - 1) >> scale;
+        *width = dec->width;
+        *height = dec->height;
+        if ((size_t)dec->width * dec->height * bpp > cap) {
+            free(work);
+            return ESP_ERR_INVALID_SIZE;
+        }
+        res = jd_decomp(&jd, output, scale);
+    }
+    free(work);
+    if (res != JDR_OK) {
+        ESP_LOGD(TAG, "full decode failed: %d", res);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+esp_err_t img_thumb_decode_rgb888(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t *out, size_t cap,
+                                  uint16_t *width, uint16_t *height)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || scale > 3 || !out || !width || !height) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    thumb_dec_t dec = { .rgb = out };
+    return thumb_decode_full(&dec, jpg, len, scale, thumb_dec_output, 3, cap, width, height);
+}
+
+esp_err_t img_thumb_decode_gray(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t *out, size_t cap,
+                                uint16_t *width, uint16_t *height)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || scale > 3 || !out || !width || !height) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    thumb_dec_t dec = { .gray = out };
+    return thumb_decode_full(&dec, jpg, len, scale, thumb_dec_output_gray, 1, cap, width, height);
+}
+
+void img_thumb_free(uint8_t *buf)
+{
+    free(buf);
+}
+
+esp_err_t img_thumb_decode_rgb565(const uint8_t *jpg, size_t len, uint8_t scale, const img_thumb_rect_t *clip,
+                                  bool swap, uint16_t *out)
+{
+    if (!jpg || len < 4 || jpg[0] != 0xFF || jpg[1] != 0xD8 || scale > 3 || !clip || !clip->w || !clip->h || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    thumb_dec_t dec = {
+        .rgb565 = out,
+        .clip = *clip,
+        .swap = swap,
+    };
+    esp_err_t ret = thumb_dec_setup(&dec, jpg, len);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+
+    void *work = heap_caps_malloc(THUMB_DEC_WORK_SIZE, MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    if (!work) {
+        return ESP_ERR_NO_MEM;
+    }
+    JDEC jd;
+    JRESULT res = jd_prepare(&jd, thumb_dec_input, work, THUMB_DEC_WORK_SIZE, &dec);
+    if (res == JDR_OK) {
+        res = jd_decomp(&jd, thumb_dec_output_rgb565, scale);
+    }
+    free(work);
+
+    // JDR_INTR：clip 以下的部分被跳过
+    if (res != JDR_OK && res != JDR_INTR) {
+        ESP_LOGD(TAG, "rgb565 decode failed: %d", res);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
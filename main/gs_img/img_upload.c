@@ -1,11 +1,24 @@
 // img_upload.c
 #include "img_upload.h"
+#include "checksum.h"
+#include "upload_resp.h"
+#include "lat_trace.h"
 #include "esp_http_client.h"
 #include "esp_log.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "freertos/stream_buffer.h"
+#include "esp_heap_caps.h"
 #include "string.h"
+#include <stdlib.h>
 #include "cJSON.h"
+#include "esp_timer.h"
+#include "gs_mqtt.h"
+#include "cc_hal_network.h"
+#include "conn_mgr.h"
+#include "cc_hal_os.h"
+#include "uplink_id.h"
 
 static const char *TAG = "img_upload";
 
@@ -17,69 +30,119 @@ static char auth_header[128] = {0};
 // multipart form-data 的 boundary
 #define BOUNDARY "------------------------d74496d66958873e"
 
-// 响应缓冲区
-static char response_buffer[1024];
-static int response_len = 0;
+// 后台保活周期：空闲超过该时间发一次轻量请求，保持连接不被服务器回收
+#define IMG_UPLOAD_KEEPALIVE_MS   30000
+
+// 持久连接数：允许同时进行的上传数
+#define IMG_UPLOAD_CONN_NUM       2
+
+// 持久连接：复用 keep-alive 客户端，上传时不再重新 TCP/TLS 握手
+typedef struct img_upload_conn {
+    esp_http_client_handle_t client;
+    SemaphoreHandle_t lock;
+    bool connected;                 // 由 HTTP 事件维护
+    TickType_t last_use_tick;       // 上次请求时间
+    upload_resp_t resp;             // 响应边收边扫描，不缓存响应体
+    uint8_t *chunk_buf;             // 分块上传：攒够一块再发，避免小块各占一个 TLS 记录
+    size_t chunk_len;
+    size_t body_len;
+    bool presigned;                 // 对象存储连接：响应不是 JSON
+    conn_mgr_conn_t mgr;            // 连接名额：持锁后租用，归还时连接仍在则保持
+} upload_conn_t;
+
+static upload_conn_t s_conns[IMG_UPLOAD_CONN_NUM];
+static bool s_conn_inited = false;
+static TaskHandle_t s_keepalive_task = NULL;
+
+#if CONFIG_IMG_UPLOAD_PRESIGNED
+// 预签名 URL：经 MQTT 预取并缓存，每个 URL 只用一次，上传时不再等待取 URL
+#define IMG_UPLOAD_URL_TOPIC_GET    "/event/upload_url/get"
+#define IMG_UPLOAD_URL_TOPIC_SET    "/service/upload_url"
+#define IMG_UPLOAD_URL_CACHE        CONFIG_IMG_UPLOAD_PRESIGNED_CACHE
+// 剩余有效期不足该时间的 URL 不再使用
+#define IMG_UPLOAD_URL_MARGIN_US    (30 * 1000000LL)
+// 请求未得到回复时，间隔该时间才再次请求
+#define IMG_UPLOAD_URL_RETRY_US     (10 * 1000000LL)
+
+typedef struct {
+    char *url;
+    int64_t expire_us;
+} presigned_url_t;
+
+static presigned_url_t s_urls[IMG_UPLOAD_URL_CACHE];
+static portMUX_TYPE s_url_lock = portMUX_INITIALIZER_UNLOCKED;
+static int64_t s_url_request_us = 0;
+// 对象存储单独一个持久连接，与表单上传服务器的连接互不影响
+static upload_conn_t s_put_conn = { .presigned = true, .mgr = CONN_MGR_CONN_INIT("img_put") };
+#endif
+
+// 流式上传：USB 负载边收边传，缓冲区需容纳上传慢于采集时的积压
+#define IMG_UPLOAD_STREAM_BUF_SIZE   (256 * 1024)
+#define IMG_UPLOAD_STREAM_CHUNK_SIZE 4096
+// 帧开始后超过该时间未收到数据视为中断
+#define IMG_UPLOAD_STREAM_STALL_MS   1000
+
+typedef enum {
+    STREAM_IDLE = 0,
+    STREAM_ARMED,       // 等待下一帧 SOF
+    STREAM_RUNNING,     // 帧数据接收中
+    STREAM_DONE,        // 收到 EOF
+    STREAM_ABORT,       // 丢帧或缓冲区溢出
+} stream_state_t;
+
+static volatile stream_state_t s_stream_state = STREAM_IDLE;
+static SemaphoreHandle_t s_stream_lock = NULL;     // 同一时间只允许一个流式上传
+static StreamBufferHandle_t s_stream_buf = NULL;
+static StaticStreamBuffer_t s_stream_buf_struct;
+static uint8_t *s_stream_chunk = NULL;
 
 // HTTP 事件回调
 static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
+    upload_conn_t *conn = (upload_conn_t *)evt->user_data;
     switch(evt->event_id) {
         case HTTP_EVENT_ERROR:
-            ESP_LOGI(TAG, "HTTP_EVENT_ERROR");
+            ESP_LOGW(TAG, "HTTP_EVENT_ERROR");
             break;
         case HTTP_EVENT_ON_CONNECTED:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_CONNECTED");
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_CONNECTED");
+            conn->connected = true;
             break;
         case HTTP_EVENT_HEADER_SENT:
-            ESP_LOGI(TAG, "HTTP_EVENT_HEADER_SENT");
+            ESP_LOGD(TAG, "HTTP_EVENT_HEADER_SENT");
             break;
         case HTTP_EVENT_REDIRECT:
             ESP_LOGI(TAG, "HTTP_EVENT_REDIRECT");
             break;
         case HTTP_EVENT_ON_HEADER:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_HEADER, key=%s, value=%s", evt->header_key, evt->header_value);
             break;
         case HTTP_EVENT_ON_DATA:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            // 打印服务器返回的部分数据
-            ESP_LOGI(TAG, "Response data: %.*s", evt->data_len, (char*)evt->data);
-
-            // 保存到本地缓冲区 (拼接)
-            if (response_len + evt->data_len < sizeof(response_buffer)) {
-                memcpy(response_buffer + response_len, evt->data, evt->data_len);
-                response_len += evt->data_len;
-                response_buffer[response_len] = '\0';
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
+            if (conn->presigned) {
+                break;
             }
+            upload_resp_feed(&conn->resp, (const char *)evt->data, evt->data_len);
             break;
         case HTTP_EVENT_ON_FINISH:
-            ESP_LOGI(TAG, "HTTP_EVENT_ON_FINISH");
-            ESP_LOGI(TAG, "Raw response: %s", response_buffer);
-            // 解析 JSON 响应
-            if (response_len > 0) {
-                cJSON *root = cJSON_Parse(response_buffer);
-                if (root) {
-                    cJSON *error = cJSON_GetObjectItem(root, "error");
-                    if (error && (error->valueint == 0)) {
-                        cJSON *img_url = cJSON_GetObjectItem(root, "img_url");
-                        if (img_url) {
-                            ESP_LOGI(TAG, "Upload OK, image URL: %s", img_url->valuestring);
-                        }
-                    } else {
-                        // 上传失败
-                        cJSON *showmsg = cJSON_GetObjectItem(root, "showmsg");
-                        if (showmsg) {
-                            ESP_LOGE(TAG, "Upload failed: %s", showmsg->valuestring);
-                        }
+            ESP_LOGD(TAG, "HTTP_EVENT_ON_FINISH");
+            // 响应字段已在收数据时提取
+            if (upload_resp_complete(&conn->resp)) {
+                if (conn->resp.has_error && conn->resp.error == 0) {
+                    if (conn->resp.img_url[0]) {
+                        ESP_LOGI(TAG, "Upload OK, image URL: %s", conn->resp.img_url);
                     }
-                    cJSON_Delete(root);
-                } else {
-                    ESP_LOGE(TAG, "JSON parse failed");
+                } else if (conn->resp.msg[0]) {
+                    // 上传失败
+                    ESP_LOGE(TAG, "Upload failed: %s", conn->resp.msg);
                 }
+            } else if (conn->resp.bytes > 0) {
+                ESP_LOGE(TAG, "Invalid JSON response");
             }
-            response_len = 0; // 清空缓冲区
+            upload_resp_init(&conn->resp);
             break;
         case HTTP_EVENT_DISCONNECTED:
-            ESP_LOGI(TAG, "HTTP_EVENT_DISCONNECTED");
+            ESP_LOGD(TAG, "HTTP_EVENT_DISCONNECTED");
+            conn->connected = false;
             break;
         default:
             break;
@@ -87,6 +150,121 @@ static esp_err_t _http_event_handler(esp_http_client_event_t *evt) {
     return ESP_OK;
 }
 
+#if CONFIG_IMG_UPLOAD_PRESIGNED
+static int presigned_url_count(int64_t now) {
+    int num = 0;
+    for (int i = 0; i < IMG_UPLOAD_URL_CACHE; i++) {
+        if (s_urls[i].url && s_urls[i].expire_us - now > IMG_UPLOAD_URL_MARGIN_US) {
+            num++;
+        }
+    }
+    return num;
+}
+
+// 缓存不足一半时向服务器请求补充，请求在途时不重复发
+static void presigned_url_refill(bool force) {
+    int64_t now = esp_timer_get_time();
+    portENTER_CRITICAL(&s_url_lock);
+    int num = presigned_url_count(now);
+    bool request = num * 2 <= IMG_UPLOAD_URL_CACHE
+                   && (force || s_url_request_us == 0 || now - s_url_request_us > IMG_UPLOAD_URL_RETRY_US);
+    if (request) {
+        s_url_request_us = now;
+    }
+    portEXIT_CRITICAL(&s_url_lock);
+    if (!request || !gs_mqtt_connect_status()) {
+        return;
+    }
+    char payload[24];
+    int len = snprintf(payload, sizeof(payload), "{\"n\":%d}", IMG_UPLOAD_URL_CACHE - num);
+    gs_mqtt_publish(IMG_UPLOAD_URL_TOPIC_GET, (uint8_t *)payload, len, GS_MQTT_QOS0, 0);
+    ESP_LOGD(TAG, "Request %d pre-signed URLs", IMG_UPLOAD_URL_CACHE - num);
+}
+
+// 服务器下发：{"urls":["https://...",...],"ttl":有效期秒数}
+static void presigned_url_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len) {
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGW(TAG, "Invalid pre-signed URL message");
+        return;
+    }
+    cJSON *urls = cJSON_GetObjectItem(root, "urls");
+    cJSON *ttl = cJSON_GetObjectItem(root, "ttl");
+    int64_t now = esp_timer_get_time();
+    // 未给出有效期时按 5 分钟计
+    int64_t expire_us = now + (int64_t)(cJSON_IsNumber(ttl) ? ttl->valuedouble : 300) * 1000000LL;
+    int added = 0;
+    cJSON *item;
+    cJSON_ArrayForEach(item, urls) {
+        if (!cJSON_IsString(item)) {
+            continue;
+        }
+        if (added == 0) {
+            cc_hal_dns_prefetch(item->valuestring);
+        }
+        char *url = strdup(item->valuestring);
+        if (!url) {
+            break;
+        }
+        char *old = NULL;
+        portENTER_CRITICAL(&s_url_lock);
+        // 放入空位或已过期的位置，缓存已满时丢弃新 URL
+        for (int i = 0; i < IMG_UPLOAD_URL_CACHE; i++) {
+            if (!s_urls[i].url || s_urls[i].expire_us - now <= IMG_UPLOAD_URL_MARGIN_US) {
+                old = s_urls[i].url;
+                s_urls[i].url = url;
+                s_urls[i].expire_us = expire_us;
+                url = NULL;
+                break;
+            }
+        }
+        portEXIT_CRITICAL(&s_url_lock);
+        free(old);
+        if (url) {
+            free(url);
+            break;
+        }
+        added++;
+    }
+    portENTER_CRITICAL(&s_url_lock);
+    s_url_request_us = 0;
+    portEXIT_CRITICAL(&s_url_lock);
+    cJSON_Delete(root);
+    ESP_LOGI(TAG, "Cached %d pre-signed URLs", added);
+}
+
+static void presigned_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data) {
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(IMG_UPLOAD_URL_TOPIC_SET, GS_MQTT_QOS0);
+        presigned_url_refill(true);
+    }
+}
+
+// 取出一个仍有效的 URL，调用方负责释放
+static char *presigned_url_take(void) {
+    int64_t now = esp_timer_get_time();
+    char *url = NULL;
+    int64_t expire_us = 0;
+    portENTER_CRITICAL(&s_url_lock);
+    // 先用最早过期的
+    int pick = -1;
+    for (int i = 0; i < IMG_UPLOAD_URL_CACHE; i++) {
+        if (s_urls[i].url && s_urls[i].expire_us - now > IMG_UPLOAD_URL_MARGIN_US
+            && (pick < 0 || s_urls[i].expire_us < expire_us)) {
+            pick = i;
+            expire_us = s_urls[i].expire_us;
+        }
+    }
+    if (pick >= 0) {
+        url = s_urls[pick].url;
+        s_urls[pick].url = NULL;
+    }
+    portEXIT_CRITICAL(&s_url_lock);
+    presigned_url_refill(false);
+    return url;
+}
+#endif
+
 // 初始化：设置服务器 URL，并设置 Authorization header
 esp_err_t img_upload_init(const char *server_url) {
     if (!server_url) {
@@ -98,6 +276,31 @@ esp_err_t img_upload_init(const char *server_url) {
         return ESP_ERR_INVALID_ARG;
     }
     strcpy(server_url_global, server_url);
+    // esp_http_client 自己解析域名，预解析让 lwIP 的 DNS 表在第一次上传前就有记录
+    cc_hal_dns_prefetch(server_url_global);
+
+    if (!s_conn_inited) {
+        for (int i = 0; i < IMG_UPLOAD_CONN_NUM; i++) {
+            s_conns[i].lock = xSemaphoreCreateMutex();
+            if (s_conns[i].lock == NULL) {
+                return ESP_ERR_NO_MEM;
+            }
+            s_conns[i].mgr.name = "img_upload";
+        }
+        s_stream_lock = xSemaphoreCreateMutex();
+        if (s_stream_lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+#if CONFIG_IMG_UPLOAD_PRESIGNED
+        s_put_conn.lock = xSemaphoreCreateMutex();
+        if (s_put_conn.lock == NULL) {
+            return ESP_ERR_NO_MEM;
+        }
+        gs_mqtt_register_topic_msg_cb(IMG_UPLOAD_URL_TOPIC_SET, presigned_url_cb);
+        cc_event_register_handler(GS_MQTT_EVENT, presigned_event_handler);
+#endif
+        s_conn_inited = true;
+    }
 
     // 构建 Authorization header (示例)
     snprintf(auth_header, sizeof(auth_header),
@@ -119,22 +322,27 @@ static bool is_valid_jpeg(const uint8_t *data, size_t len) {
     return true;
 }
 
-// 上传图片接口
-esp_err_t img_upload_send(const uint8_t *data, size_t len) {
-    if (!data || len == 0) {
-        ESP_LOGE(TAG, "Invalid input data");
-        return ESP_ERR_INVALID_ARG;
+// 获取一个空闲的持久连接并加锁，都忙时等待第一个
+static upload_conn_t *acquire_conn(void) {
+    for (int i = 0; i < IMG_UPLOAD_CONN_NUM; i++) {
+        if (xSemaphoreTake(s_conns[i].lock, 0) == pdTRUE) {
+            return &s_conns[i];
+        }
     }
+    xSemaphoreTake(s_conns[0].lock, portMAX_DELAY);
+    return &s_conns[0];
+}
 
-    // 可选：检查JPEG格式
-    if (!is_valid_jpeg(data, len)) {
-        ESP_LOGE(TAG, "Invalid JPEG format");
-        return ESP_ERR_INVALID_ARG;
-    }
+// 归还连接名额并解锁，连接仍在时保持供下次复用
+static void release_conn(upload_conn_t *conn) {
+    conn_mgr_return(&conn->mgr, conn->connected);
+    xSemaphoreGive(conn->lock);
+}
 
-    if (strlen(server_url_global) == 0) {
-        ESP_LOGE(TAG, "Server URL not set");
-        return ESP_ERR_INVALID_STATE;
+// 获取连接的客户端，首次调用时创建，需持有 conn->lock
+static esp_http_client_handle_t get_client_locked(upload_conn_t *conn) {
+    if (conn->client) {
+        return conn->client;
     }
 
     // 配置HTTP客户端
@@ -142,21 +350,62 @@ esp_err_t img_upload_send(const uint8_t *data, size_t len) {
         .url = server_url_global,
         .event_handler = _http_event_handler,
         .max_redirection_count = 5,
+        .keep_alive_enable = true,
+        .user_data = conn,
     };
 
     esp_http_client_handle_t client = esp_http_client_init(&config);
     if (!client) {
         ESP_LOGE(TAG, "esp_http_client_init failed");
-        return ESP_FAIL;
+        return NULL;
     }
 
-    // 设置HTTP头
+    // 设置HTTP头，在客户端生命周期内保持
     esp_http_client_set_header(client, "Authorization", auth_header);
-    esp_http_client_set_header(client, "Content-Type", 
+    esp_http_client_set_header(client, "Content-Type",
         "multipart/form-data; boundary=" BOUNDARY);
     // 一般不需要 Expect: 100-continue
     esp_http_client_set_header(client, "Expect", "");
+    conn->client = client;
+    conn_mgr_attach(&conn->mgr, client, server_url_global);
+    return client;
+}
+
+// 获取客户端并租用连接名额，之后才能读 conn->connected 和使用连接；失败返回 NULL，仍需 release_conn()
+static esp_http_client_handle_t lease_client_locked(upload_conn_t *conn, conn_prio_t prio, uint32_t timeout_ms) {
+    esp_http_client_handle_t client = get_client_locked(conn);
+    if (!client || conn_mgr_lease(&conn->mgr, prio, timeout_ms) != ESP_OK) {
+        return NULL;
+    }
+    return client;
+}
 
+// 幂等键：同一张图片的重试带同一个键，服务器据此去重；key 为 NULL 时去掉（保活等请求）
+static void set_uplink_key(esp_http_client_handle_t client, const char *key) {
+    if (key) {
+        esp_http_client_set_header(client, UPLINK_ID_HTTP_HEADER, key);
+    } else {
+        esp_http_client_delete_header(client, UPLINK_ID_HTTP_HEADER);
+    }
+}
+
+// 读完响应体，连接才能复用；返回 HTTP 状态码
+static int finish_response(upload_conn_t *conn) {
+    esp_http_client_handle_t client = conn->client;
+    if (esp_http_client_fetch_headers(client) < 0) {
+        ESP_LOGE(TAG, "Failed to fetch headers");
+        return -1;
+    }
+    int response_code = esp_http_client_get_status_code(client);
+    lat_trace_mark(LAT_TRACE_HTTP_RESPONSE, response_code);
+    esp_http_client_flush_response(client, NULL);
+    conn->last_use_tick = xTaskGetTickCount();
+    return response_code;
+}
+
+// 写出一次 multipart 上传请求（不等响应），传输失败返回 false
+static bool post_image_request(upload_conn_t *conn, const uint8_t *data, size_t len, const char *key) {
+    esp_http_client_handle_t client = conn->client;
     // multipart 格式头部
     const char *header_format =
         "--%s\r\n"
@@ -171,55 +420,584 @@ esp_err_t img_upload_send(const uint8_t *data, size_t len) {
     int footer_len = snprintf(footer, sizeof(footer), "\r\n--%s--\r\n", BOUNDARY);
 
     esp_http_client_set_method(client, HTTP_METHOD_POST);
+    set_uplink_key(client, key);
+    upload_resp_init(&conn->resp);
 
-    // 打开连接
+    // 打开连接（已连接时直接复用）
     int total_len = header_len + len + footer_len;
     esp_err_t err = esp_http_client_open(client, total_len);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to open HTTP connection: %s", esp_err_to_name(err));
-        esp_http_client_cleanup(client);
-        return err;
+        return false;
     }
+    lat_trace_mark(LAT_TRACE_HTTP_CONNECT, 0);
 
     // 写入头部
     int written = esp_http_client_write(client, header, header_len);
     if (written != header_len) {
         ESP_LOGE(TAG, "Failed to write multipart header");
-        err = ESP_FAIL;
-        goto cleanup;
+        return false;
     }
 
     // 写入图像数据
     written = esp_http_client_write(client, (const char*)data, len);
     if (written != (int)len) {
         ESP_LOGE(TAG, "Failed to write image data");
-        err = ESP_FAIL;
-        goto cleanup;
+        return false;
     }
 
     // 写入尾部
     written = esp_http_client_write(client, footer, footer_len);
     if (written != footer_len) {
         ESP_LOGE(TAG, "Failed to write multipart footer");
-        err = ESP_FAIL;
-        goto cleanup;
+        return false;
     }
+    lat_trace_mark(LAT_TRACE_HTTP_BODY_DONE, len);
+    return true;
+}
 
+// 发送一次 multipart 上传请求，返回 HTTP 状态码，传输失败返回 -1
+static int post_image(upload_conn_t *conn, const uint8_t *data, size_t len, const char *key) {
+    if (!post_image_request(conn, data, len, key)) {
+        return -1;
+    }
     // 获取响应
-    int status = esp_http_client_fetch_headers(client);
-    if (status < 0) {
-        ESP_LOGE(TAG, "Failed to fetch headers");
-        err = ESP_FAIL;
-        goto cleanup;
+    return finish_response(conn);
+}
+
+// 按 chunked 编码写一块数据
+static bool write_chunk(esp_http_client_handle_t client, const char *data, int len) {
+    char chunk_head[12];
+    int head_len = snprintf(chunk_head, sizeof(chunk_head), "%x\r\n", len);
+    return esp_http_client_write(client, chunk_head, head_len) == head_len
+           && esp_http_client_write(client, data, len) == len
+           && esp_http_client_write(client, "\r\n", 2) == 2;
+}
+
+#if CONFIG_IMG_UPLOAD_PRESIGNED
+// 获取对象存储连接的客户端并换成本次的 URL，需持有 conn->lock
+static esp_http_client_handle_t get_put_client_locked(upload_conn_t *conn, const char *url) {
+    if (!conn->client) {
+        esp_http_client_config_t config = {
+            .url = url,
+            .event_handler = _http_event_handler,
+            .keep_alive_enable = true,
+            .user_data = conn,
+        };
+        conn->client = esp_http_client_init(&config);
+        if (!conn->client) {
+            ESP_LOGE(TAG, "esp_http_client_init failed");
+            return NULL;
+        }
+        esp_http_client_set_header(conn->client, "Content-Type", "image/jpeg");
+        esp_http_client_set_header(conn->client, "Expect", "");
+    } else if (esp_http_client_set_url(conn->client, url) != ESP_OK) {
+        return NULL;
     }
+    // 预签名 URL 的主机一般不变，不变时保持的连接继续有效
+    conn_mgr_attach(&conn->mgr, conn->client, url);
+    return conn->client;
+}
+
+// 以原始 JPEG 直接 PUT 到预签名 URL，没有 multipart 封装，返回 HTTP 状态码，传输失败返回 -1
+static int put_image(upload_conn_t *conn, const uint8_t *data, size_t len) {
+    esp_http_client_handle_t client = conn->client;
+    esp_http_client_set_method(client, HTTP_METHOD_PUT);
+
+    esp_err_t err = esp_http_client_open(client, len);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to open PUT connection: %s", esp_err_to_name(err));
+        return -1;
+    }
+    lat_trace_mark(LAT_TRACE_HTTP_CONNECT, 0);
+    if (esp_http_client_write(client, (const char *)data, len) != (int)len) {
+        ESP_LOGE(TAG, "Failed to write image data");
+        return -1;
+    }
+    lat_trace_mark(LAT_TRACE_HTTP_BODY_DONE, len);
+    return finish_response(conn);
+}
+
+// 有缓存的预签名 URL 时直接上传到对象存储，没有 URL 返回 ESP_ERR_NOT_FOUND
+static esp_err_t presigned_send(const uint8_t *data, size_t len) {
+    char *url = presigned_url_take();
+    if (!url) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    upload_conn_t *conn = &s_put_conn;
+    xSemaphoreTake(conn->lock, portMAX_DELAY);
+    int response_code = -1;
+    if (get_put_client_locked(conn, url) && conn_mgr_lease(&conn->mgr, CONN_PRIO_EVENT, portMAX_DELAY) == ESP_OK) {
+        bool reused = conn->connected;
+        response_code = put_image(conn, data, len);
+        if (response_code < 0 && reused) {
+            ESP_LOGW(TAG, "Keep-alive connection lost, reconnecting");
+            esp_http_client_close(conn->client);
+            response_code = put_image(conn, data, len);
+        }
+        if (response_code < 0) {
+            esp_http_client_close(conn->client);
+        }
+    }
+    release_conn(conn);
+    free(url);
+
+    ESP_LOGI(TAG, "PUT response code: %d", response_code);
+    return (response_code >= 200 && response_code < 300) ? ESP_OK : ESP_FAIL;
+}
+#endif
+
+// 上传图片接口
+esp_err_t img_upload_send(const uint8_t *data, size_t len) {
+    char key[UPLINK_ID_STR_LEN];
+    return img_upload_send_keyed(data, len, uplink_id_next_str(key));
+}
+
+esp_err_t img_upload_send_keyed(const uint8_t *data, size_t len, const char *key) {
+    if (!data || len == 0) {
+        ESP_LOGE(TAG, "Invalid input data");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    // 可选：检查JPEG格式
+    if (!is_valid_jpeg(data, len)) {
+        ESP_LOGE(TAG, "Invalid JPEG format");
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    if (strlen(server_url_global) == 0 || !s_conn_inited) {
+        ESP_LOGE(TAG, "Server URL not set");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+#if CONFIG_IMG_UPLOAD_PRESIGNED
+    // 对象存储失败或没有 URL 时回退到表单上传
+    if (presigned_send(data, len) == ESP_OK) {
+        return ESP_OK;
+    }
+#endif
+
+    upload_conn_t *conn = acquire_conn();
+    esp_http_client_handle_t client = lease_client_locked(conn, CONN_PRIO_EVENT, portMAX_DELAY);
+    if (!client) {
+        release_conn(conn);
+        return ESP_FAIL;
+    }
+
+    bool reused = conn->connected;
+    int response_code = post_image(conn, data, len, key);
+    if (response_code < 0 && reused) {
+        // 复用的连接可能已被服务器关闭，重新建立连接再试一次
+        ESP_LOGW(TAG, "Keep-alive connection lost, reconnecting");
+        esp_http_client_close(client);
+        response_code = post_image(conn, data, len, key);
+    }
+    if (response_code < 0) {
+        esp_http_client_close(client);
+    }
+    release_conn(conn);
 
-    int response_code = esp_http_client_get_status_code(client);
     ESP_LOGI(TAG, "HTTP response code: %d", response_code);
+    return (response_code == 200) ? ESP_OK : ESP_FAIL;
+}
+
+// 在连接上写出请求，复用的连接失效时重连再写一次
+static bool burst_request(upload_conn_t *conn, const uint8_t *data, size_t len) {
+    char key[UPLINK_ID_STR_LEN];
+    bool reused = conn->connected;
+    uplink_id_next_str(key);
+    if (post_image_request(conn, data, len, key)) {
+        return true;
+    }
+    esp_http_client_close(conn->client);
+    if (reused) {
+        ESP_LOGW(TAG, "Keep-alive connection lost, reconnecting");
+        if (post_image_request(conn, data, len, key)) {
+            return true;
+        }
+        esp_http_client_close(conn->client);
+    }
+    return false;
+}
+
+// 连拍上传：空闲的持久连接轮流发请求，一个连接等响应时另一个连接在写下一帧，
+// 服务器处理和往返时间与后续帧的发送重叠，不再逐帧停等
+esp_err_t img_upload_send_burst(const uint8_t *const data[], const size_t len[], size_t num, esp_err_t ret[]) {
+    if (!data || !len || !ret || num == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(server_url_global) == 0 || !s_conn_inited) {
+        ESP_LOGE(TAG, "Server URL not set");
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    // 占用当前空闲的连接，都忙时等一个；第一个之外的连接名额不足时不等，少用一个连接
+    upload_conn_t *conns[IMG_UPLOAD_CONN_NUM];
+    int inflight[IMG_UPLOAD_CONN_NUM];
+    int conn_num = 0;
+    for (int i = 0; i < IMG_UPLOAD_CONN_NUM; i++) {
+        if (xSemaphoreTake(s_conns[i].lock, 0) != pdTRUE) {
+            continue;
+        }
+        if (lease_client_locked(&s_conns[i], CONN_PRIO_EVENT, conn_num ? 0 : portMAX_DELAY)) {
+            conns[conn_num++] = &s_conns[i];
+        } else {
+            release_conn(&s_conns[i]);
+        }
+    }
+    if (conn_num == 0) {
+        upload_conn_t *conn = acquire_conn();
+        if (!lease_client_locked(conn, CONN_PRIO_EVENT, portMAX_DELAY)) {
+            release_conn(conn);
+            for (size_t i = 0; i < num; i++) {
+                ret[i] = ESP_FAIL;
+            }
+            return ESP_FAIL;
+        }
+        conns[conn_num++] = conn;
+    }
+    for (int i = 0; i < conn_num; i++) {
+        inflight[i] = -1;
+    }
+
+    size_t next = 0;
+    size_t done = 0;
+    int ok = 0;
+    while (done < num) {
+        for (int c = 0; c < conn_num; c++) {
+            upload_conn_t *conn = conns[c];
+            if (inflight[c] >= 0) {
+                int response_code = finish_response(conn);
+                if (response_code < 0) {
+                    esp_http_client_close(conn->client);
+                }
+                ret[inflight[c]] = (response_code == 200) ? ESP_OK : ESP_FAIL;
+                ok += (response_code == 200);
+                inflight[c] = -1;
+                done++;
+            }
+            // 写出下一帧，跳过无效帧
+            while (next < num && inflight[c] < 0) {
+                size_t idx = next++;
+                if (!data[idx] || !is_valid_jpeg(data[idx], len[idx])) {
+                    ret[idx] = ESP_ERR_INVALID_ARG;
+                    done++;
+                } else if (!burst_request(conn, data[idx], len[idx])) {
+                    ret[idx] = ESP_FAIL;
+                    done++;
+                } else {
+                    inflight[c] = idx;
+                }
+            }
+        }
+    }
+
+    for (int i = 0; i < conn_num; i++) {
+        release_conn(conns[i]);
+    }
+    ESP_LOGI(TAG, "Burst upload: %d/%u frames on %d connections", ok, (unsigned)num, conn_num);
+    return ok == (int)num ? ESP_OK : ESP_FAIL;
+}
 
-    err = (response_code == 200) ? ESP_OK : ESP_FAIL;
+// 轻量请求，用于建立/保持连接，需已租用连接名额
+static void keepalive_request_locked(upload_conn_t *conn) {
+    esp_http_client_handle_t client = conn->client;
+    esp_http_client_set_method(client, HTTP_METHOD_GET);
+    set_uplink_key(client, NULL);
+    upload_resp_init(&conn->resp);
+    if (esp_http_client_open(client, 0) != ESP_OK || finish_response(conn) < 0) {
+        esp_http_client_close(client);
+        ESP_LOGW(TAG, "Keep-alive request failed");
+    }
+}
+
+// 后台任务：断线后重连，空闲时保活，让上传时连接已就绪
+static void keepalive_task(void *arg) {
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, pdMS_TO_TICKS(IMG_UPLOAD_KEEPALIVE_MS));
+        for (int i = 0; i < IMG_UPLOAD_CONN_NUM; i++) {
+            upload_conn_t *conn = &s_conns[i];
+            // 正在上传的连接无需保活
+            if (xSemaphoreTake(conn->lock, 0) != pdTRUE) {
+                continue;
+            }
+            // 名额紧张时不为保活占用新连接，下个周期再试
+            if (!lease_client_locked(conn, CONN_PRIO_NORMAL, 0)) {
+                release_conn(conn);
+                continue;
+            }
+            if (!conn->connected || (xTaskGetTickCount() - conn->last_use_tick) >= pdMS_TO_TICKS(IMG_UPLOAD_KEEPALIVE_MS)) {
+                bool reused = conn->connected;
+                keepalive_request_locked(conn);
+                if (reused && !conn->connected) {
+                    // 旧连接已失效，立即重连
+                    keepalive_request_locked(conn);
+                }
+            }
+            release_conn(conn);
+        }
+    }
+}
+
+// 网络就绪后调用：后台预先建立连接，并定期保活
+esp_err_t img_upload_warmup(void) {
+    if (strlen(server_url_global) == 0 || !s_conn_inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_keepalive_task == NULL) {
+        // 30 秒才保活一次，不在上传路径上，栈放 PSRAM
+        if (cc_hal_os_task_create_caps(keepalive_task, "img_upload_ka", 4096, NULL, 3, CC_OS_STACK_PSRAM, &s_keepalive_task) != CC_OK) {
+            ESP_LOGE(TAG, "Failed to create keepalive task");
+            return ESP_FAIL;
+        }
+    }
+    xTaskNotifyGive(s_keepalive_task);
+    return ESP_OK;
+}
+
+// UVC 负载回调中调用：只做非阻塞的拷贝，不能阻塞 USB 任务
+void img_upload_stream_feed(const uint8_t *data, size_t len, uint32_t flags) {
+    stream_state_t state = s_stream_state;
+    if (state == STREAM_ARMED && (flags & IMG_UPLOAD_STREAM_SOF)) {
+        // 只接受 JPEG 开头的帧
+        if (len < 2 || data[0] != 0xFF || data[1] != 0xD8) {
+            return;
+        }
+        state = s_stream_state = STREAM_RUNNING;
+    }
+    if (state != STREAM_RUNNING) {
+        return;
+    }
+    if (flags & IMG_UPLOAD_STREAM_DROP) {
+        s_stream_state = STREAM_ABORT;
+    } else if (flags & IMG_UPLOAD_STREAM_EOF) {
+        s_stream_state = STREAM_DONE;
+    } else if (xStreamBufferSend(s_stream_buf, data, len, 0) != len) {
+        s_stream_state = STREAM_ABORT;
+    }
+}
+
+// 流式上传下一帧：收到 SOF 即开始 chunked POST，边收边传，EOF 时写 multipart 尾部
+esp_err_t img_upload_stream_next_frame(uint32_t timeout_ms, size_t *out_len, uint32_t *out_sum) {
+    if (strlen(server_url_global) == 0 || !s_conn_inited) {
+        ESP_LOGE(TAG, "Server URL not set");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (xSemaphoreTake(s_stream_lock, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Stream upload busy");
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_stream_buf == NULL) {
+        uint8_t *storage = heap_caps_malloc(IMG_UPLOAD_STREAM_BUF_SIZE + 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        s_stream_chunk = malloc(IMG_UPLOAD_STREAM_CHUNK_SIZE);
+        if (!storage || !s_stream_chunk) {
+            free(storage);
+            free(s_stream_chunk);
+            s_stream_chunk = NULL;
+            xSemaphoreGive(s_stream_lock);
+            return ESP_ERR_NO_MEM;
+        }
+        s_stream_buf = xStreamBufferCreateStatic(IMG_UPLOAD_STREAM_BUF_SIZE, 1, storage, &s_stream_buf_struct);
+    }
 
-cleanup:
-    esp_http_client_close(client);
-    esp_http_client_cleanup(client);
+    upload_conn_t *conn = acquire_conn();
+    esp_http_client_handle_t client = lease_client_locked(conn, CONN_PRIO_EVENT, portMAX_DELAY);
+    if (!client) {
+        release_conn(conn);
+        xSemaphoreGive(s_stream_lock);
+        return ESP_FAIL;
+    }
+
+    xStreamBufferReset(s_stream_buf);
+    s_stream_state = STREAM_ARMED;
+
+    esp_err_t err = ESP_FAIL;
+    size_t total = 0;
+    uint32_t sum = 0;
+    bool opened = false;
+    TickType_t deadline = xTaskGetTickCount() + pdMS_TO_TICKS(timeout_ms);
+    TickType_t last_data_tick = 0;
+    while (1) {
+        size_t got = xStreamBufferReceive(s_stream_buf, s_stream_chunk, IMG_UPLOAD_STREAM_CHUNK_SIZE, pdMS_TO_TICKS(20));
+        stream_state_t state = s_stream_state;
+        if (got && !opened) {
+            // 第一块数据即 SOF，开始 POST（长度未知，使用 chunked 编码）
+            char header[256];
+            int header_len = snprintf(header, sizeof(header),
+                "--%s\r\n"
+                "Content-Disposition: form-data; name=\"upload\"; filename=\"image.jpg\"\r\n"
+                "Content-Type: image/jpeg\r\n\r\n", BOUNDARY);
+            char key[UPLINK_ID_STR_LEN];
+            esp_http_client_delete_header(client, "Content-Length");
+            esp_http_client_set_method(client, HTTP_METHOD_POST);
+            set_uplink_key(client, uplink_id_next_str(key));
+            upload_resp_init(&conn->resp);
+            if (esp_http_client_open(client, -1) != ESP_OK || !write_chunk(client, header, header_len)) {
+                ESP_LOGE(TAG, "Failed to start streaming upload");
+                break;
+            }
+            opened = true;
+            lat_trace_mark(LAT_TRACE_HTTP_CONNECT, 0);
+        }
+        if (got) {
+            sum = checksum_sum8_update(sum, s_stream_chunk, got);
+            total += got;
+            last_data_tick = xTaskGetTickCount();
+            if (!write_chunk(client, (const char *)s_stream_chunk, got)) {
+                ESP_LOGE(TAG, "Failed to write stream chunk");
+                break;
+            }
+            continue;
+        }
+        if (state == STREAM_ABORT) {
+            ESP_LOGW(TAG, "Stream frame aborted after %u bytes", total);
+            break;
+        }
+        if (state == STREAM_DONE && xStreamBufferIsEmpty(s_stream_buf)) {
+            char footer[64];
+            int footer_len = snprintf(footer, sizeof(footer), "\r\n--%s--\r\n", BOUNDARY);
+            if (write_chunk(client, footer, footer_len) && esp_http_client_write(client, "0\r\n\r\n", 5) == 5) {
+                lat_trace_mark(LAT_TRACE_HTTP_BODY_DONE, total);
+                int response_code = finish_response(conn);
+                ESP_LOGI(TAG, "Stream upload %u bytes, HTTP response code: %d", total, response_code);
+                err = (response_code == 200) ? ESP_OK : ESP_FAIL;
+                if (response_code >= 0) {
+                    opened = false;     // 响应已完整读取，连接可复用
+                }
+            }
+            break;
+        }
+        if (!opened && (int32_t)(xTaskGetTickCount() - deadline) >= 0) {
+            ESP_LOGW(TAG, "Stream upload wait frame timeout");
+            err = ESP_ERR_TIMEOUT;
+            break;
+        }
+        if (opened && (xTaskGetTickCount() - last_data_tick) > pdMS_TO_TICKS(IMG_UPLOAD_STREAM_STALL_MS)) {
+            ESP_LOGW(TAG, "Stream frame stalled after %u bytes", total);
+            break;
+        }
+    }
+    s_stream_state = STREAM_IDLE;
+    if (opened) {
+        // 请求未正常结束，连接不可复用
+        esp_http_client_close(client);
+    }
+    // 恢复普通上传使用的 Content-Length 方式
+    esp_http_client_delete_header(client, "Transfer-Encoding");
+    release_conn(conn);
+    xSemaphoreGive(s_stream_lock);
+
+    if (out_len) {
+        *out_len = total;
+    }
+    if (out_sum) {
+        *out_sum = sum;
+    }
+    return err;
+}
+
+// 分块上传：把攒下的数据作为一块发出
+static bool chunked_flush(upload_conn_t *conn) {
+    if (conn->chunk_len == 0) {
+        return true;
+    }
+    bool ok = write_chunk(conn->client, (const char *)conn->chunk_buf, conn->chunk_len);
+    conn->chunk_len = 0;
+    return ok;
+}
+
+esp_err_t img_upload_chunked_begin(const char *filename, const char *content_type, img_upload_handle_t *out) {
+    if (!filename || !content_type || !out) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (strlen(server_url_global) == 0 || !s_conn_inited) {
+        ESP_LOGE(TAG, "Server URL not set");
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint8_t *chunk_buf = malloc(IMG_UPLOAD_STREAM_CHUNK_SIZE);
+    if (!chunk_buf) {
+        return ESP_ERR_NO_MEM;
+    }
+    upload_conn_t *conn = acquire_conn();
+    esp_http_client_handle_t client = lease_client_locked(conn, CONN_PRIO_EVENT, portMAX_DELAY);
+    if (!client) {
+        release_conn(conn);
+        free(chunk_buf);
+        return ESP_FAIL;
+    }
+
+    char header[256];
+    int header_len = snprintf(header, sizeof(header),
+        "--%s\r\n"
+        "Content-Disposition: form-data; name=\"upload\"; filename=\"%s\"\r\n"
+        "Content-Type: %s\r\n\r\n", BOUNDARY, filename, content_type);
+    char key[UPLINK_ID_STR_LEN];
+    esp_http_client_delete_header(client, "Content-Length");
+    esp_http_client_set_method(client, HTTP_METHOD_POST);
+    set_uplink_key(client, uplink_id_next_str(key));
+    upload_resp_init(&conn->resp);
+    if (esp_http_client_open(client, -1) != ESP_OK || !write_chunk(client, header, header_len)) {
+        ESP_LOGE(TAG, "Failed to start chunked upload");
+        esp_http_client_close(client);
+        esp_http_client_delete_header(client, "Transfer-Encoding");
+        release_conn(conn);
+        free(chunk_buf);
+        return ESP_FAIL;
+    }
+    conn->chunk_buf = chunk_buf;
+    conn->chunk_len = 0;
+    conn->body_len = 0;
+    *out = conn;
+    return ESP_OK;
+}
+
+esp_err_t img_upload_chunked_write(img_upload_handle_t handle, const void *data, size_t len) {
+    upload_conn_t *conn = handle;
+    if (!conn || (!data && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    conn->body_len += len;
+    if (conn->chunk_len + len <= IMG_UPLOAD_STREAM_CHUNK_SIZE) {
+        memcpy(conn->chunk_buf + conn->chunk_len, data, len);
+        conn->chunk_len += len;
+        return ESP_OK;
+    }
+    if (!chunked_flush(conn)) {
+        return ESP_FAIL;
+    }
+    if (len >= IMG_UPLOAD_STREAM_CHUNK_SIZE) {
+        return write_chunk(conn->client, data, len) ? ESP_OK : ESP_FAIL;
+    }
+    memcpy(conn->chunk_buf, data, len);
+    conn->chunk_len = len;
+    return ESP_OK;
+}
+
+esp_err_t img_upload_chunked_end(img_upload_handle_t handle, bool abort) {
+    upload_conn_t *conn = handle;
+    if (!conn) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    esp_http_client_handle_t client = conn->client;
+    esp_err_t err = ESP_FAIL;
+    bool reusable = false;
+    if (!abort && chunked_flush(conn)) {
+        char footer[64];
+        int footer_len = snprintf(footer, sizeof(footer), "\r\n--%s--\r\n", BOUNDARY);
+        if (write_chunk(client, footer, footer_len) && esp_http_client_write(client, "0\r\n\r\n", 5) == 5) {
+            int response_code = finish_response(conn);
+            ESP_LOGI(TAG, "Chunked upload %u bytes, HTTP response code: %d", conn->body_len, response_code);
+            err = (response_code == 200) ? ESP_OK : ESP_FAIL;
+            reusable = response_code >= 0;
+        }
+    }
+    if (!reusable) {
+        // 请求未正常结束，连接不可复用
+        esp_http_client_close(client);
+    }
+    esp_http_client_delete_header(client, "Transfer-Encoding");
+    free(conn->chunk_buf);
+    conn->chunk_buf = NULL;
+    release_conn(conn);
     return err;
 }
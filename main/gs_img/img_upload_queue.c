@@ -0,0 +1,458 @@
+// img_upload_queue.c
+// 异步上传队列：逐张重试（指数退避），重试用尽后暂存到 flash，联网后补传
+#include "img_upload_queue.h"
+#include "img_upload.h"
+#include "power_fail.h"
+#include "uplink_id.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_spiffs.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "string.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <dirent.h>
+#include <sys/stat.h>
+
+static const char *TAG = "img_upload_queue";
+
+// 同时进行的上传数（与 img_upload 的持久连接数一致）
+#define UPLOAD_QUEUE_WORKERS        2
+#define UPLOAD_QUEUE_LEN            4
+// 单张图片的重试次数与退避
+#define UPLOAD_RETRY_MAX            3
+#define UPLOAD_RETRY_BASE_MS        1000
+// 空闲时检查 flash 暂存的周期，补传失败后加倍，最长 UPLOAD_DRAIN_MAX_MS
+#define UPLOAD_DRAIN_INTERVAL_MS    10000
+#define UPLOAD_DRAIN_MAX_MS         (5 * 60 * 1000)
+
+// flash 暂存分区，需在自定义分区表中添加（见 Kconfig 说明）
+#define SPOOL_PARTITION_LABEL       CONFIG_IMG_UPLOAD_SPOOL_PARTITION
+#define SPOOL_BASE_PATH             IMG_UPLOAD_SPOOL_PATH
+#define SPOOL_MAX_FILES             32
+// 暂存文件与断电记录以幂等键开头，后接 JPEG；以 JPEG SOI 开头的是旧格式，没有键
+#define UPLOAD_KEY_LEN              (UPLINK_ID_STR_LEN - 1)
+
+typedef struct {
+    uint8_t *data;          // PSRAM 中的 JPEG 拷贝
+    size_t len;
+    uint32_t spool_seq;     // 非 0 表示来自 flash 暂存，上传成功后删除
+    char key[UPLINK_ID_STR_LEN];    // 幂等键，入队时生成，重试、暂存、断电保存后都沿用
+} upload_item_t;
+
+static QueueHandle_t s_queue = NULL;
+static SemaphoreHandle_t s_spool_lock = NULL;
+static SemaphoreHandle_t s_drain_lock = NULL;      // 同一时间只有一个任务补传
+static bool s_spool_mounted = false;
+static uint32_t s_spool_next_seq = 1;       // 下一个暂存文件序号
+static uint32_t s_drain_interval_ms = UPLOAD_DRAIN_INTERVAL_MS;
+
+static esp_err_t queue_push(const uint8_t *data, size_t len, const char *key);
+
+// data 以幂等键开头时取出到 key 并返回键长，否则生成新键并返回 0
+static size_t item_key_parse(const uint8_t *data, size_t len, char key[UPLINK_ID_STR_LEN])
+{
+    bool keyed = len >= UPLOAD_KEY_LEN;
+    for (size_t i = 0; keyed && i < UPLOAD_KEY_LEN; i++) {
+        keyed = data[i] >= '0' && data[i] <= '9';
+    }
+    if (!keyed) {
+        uplink_id_next_str(key);
+        return 0;
+    }
+    memcpy(key, data, UPLOAD_KEY_LEN);
+    key[UPLOAD_KEY_LEN] = '\0';
+    return UPLOAD_KEY_LEN;
+}
+
+#if CONFIG_POWER_FAIL
+// 各上传任务正在上传的图片，断电时与队列中的一起保存；pinned 期间上传任务不释放
+static upload_item_t *s_inflight[UPLOAD_QUEUE_WORKERS];
+static bool s_inflight_pinned = false;
+static portMUX_TYPE s_inflight_lock = portMUX_INITIALIZER_UNLOCKED;
+
+static void inflight_set(int worker, upload_item_t *item)
+{
+    portENTER_CRITICAL(&s_inflight_lock);
+    s_inflight[worker] = item;
+    portEXIT_CRITICAL(&s_inflight_lock);
+}
+
+// 清除后才能释放 item；断电保存正在读它时等待
+static void inflight_clear(int worker)
+{
+    while (1) {
+        portENTER_CRITICAL(&s_inflight_lock);
+        bool pinned = s_inflight_pinned;
+        if (!pinned) {
+            s_inflight[worker] = NULL;
+        }
+        portEXIT_CRITICAL(&s_inflight_lock);
+        if (!pinned) {
+            return;
+        }
+        vTaskDelay(1);
+    }
+}
+
+static void upload_queue_power_fail_save(void)
+{
+    upload_item_t *items[UPLOAD_QUEUE_WORKERS + UPLOAD_QUEUE_LEN];
+    int n = 0;
+    portENTER_CRITICAL(&s_inflight_lock);
+    for (int i = 0; i < UPLOAD_QUEUE_WORKERS; i++) {
+        if (s_inflight[i]) {
+            items[n++] = s_inflight[i];
+        }
+    }
+    s_inflight_pinned = true;
+    portEXIT_CRITICAL(&s_inflight_lock);
+    // 队列中的先取出再按原顺序放回（kick 用的 NULL 丢掉）
+    int queued = n;
+    while (n < (int)(sizeof(items) / sizeof(items[0])) && xQueueReceive(s_queue, &items[n], 0) == pdTRUE) {
+        if (items[n]) {
+            n++;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        if (power_fail_write(items[i]->key, UPLOAD_KEY_LEN, items[i]->data, items[i]->len) != ESP_OK) {
+            break;
+        }
+    }
+    for (int i = queued; i < n; i++) {
+        if (xQueueSend(s_queue, &items[i], 0) != pdTRUE) {
+            free(items[i]->data);
+            free(items[i]);
+        }
+    }
+    portENTER_CRITICAL(&s_inflight_lock);
+    s_inflight_pinned = false;
+    portEXIT_CRITICAL(&s_inflight_lock);
+}
+
+static void upload_queue_power_fail_restore(const uint8_t *data, size_t len)
+{
+    char key[UPLINK_ID_STR_LEN];
+    size_t key_len = item_key_parse(data, len, key);
+    queue_push(data + key_len, len - key_len, key);
+}
+
+static power_fail_hook_t s_power_fail_hook = {
+    .id = POWER_FAIL_ID_IMG,
+    .save = upload_queue_power_fail_save,
+    .restore = upload_queue_power_fail_restore,
+};
+#else
+static inline void inflight_set(int worker, upload_item_t *item) {}
+static inline void inflight_clear(int worker) {}
+#endif
+
+static void spool_path(char *path, size_t size, uint32_t seq)
+{
+    snprintf(path, size, SPOOL_BASE_PATH "/%08u.jpg", (unsigned)seq);
+}
+
+// 扫描暂存目录，oldest_out 返回最旧的文件序号，返回文件数
+static int spool_scan(uint32_t *oldest_out)
+{
+    int count = 0;
+    uint32_t oldest = 0;
+    DIR *dir = opendir(SPOOL_BASE_PATH);
+    if (!dir) {
+        return 0;
+    }
+    struct dirent *ent;
+    while ((ent = readdir(dir)) != NULL) {
+        uint32_t seq = strtoul(ent->d_name, NULL, 10);
+        if (seq == 0) {
+            continue;
+        }
+        count++;
+        if (oldest == 0 || seq < oldest) {
+            oldest = seq;
+        }
+        if (seq >= s_spool_next_seq) {
+            s_spool_next_seq = seq + 1;
+        }
+    }
+    closedir(dir);
+    if (oldest_out) {
+        *oldest_out = oldest;
+    }
+    return count;
+}
+
+static void spool_mount(void)
+{
+    if (!esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_DATA_SPIFFS, SPOOL_PARTITION_LABEL)) {
+        ESP_LOGW(TAG, "No SPIFFS partition \"%s\" in the partition table, images that fail to upload are dropped",
+                 SPOOL_PARTITION_LABEL);
+        return;
+    }
+    esp_vfs_spiffs_conf_t conf = {
+        .base_path = SPOOL_BASE_PATH,
+        .partition_label = SPOOL_PARTITION_LABEL,
+        .max_files = 3,         // 补传与事件短视频录制可能同时打开文件
+        .format_if_mount_failed = true,
+    };
+    esp_err_t err = esp_vfs_spiffs_register(&conf);
+    if (err != ESP_OK) {
+        ESP_LOGW(TAG, "Spool partition not available (%s), retry in memory only", esp_err_to_name(err));
+        return;
+    }
+    s_spool_mounted = true;
+    int count = spool_scan(NULL);
+    ESP_LOGI(TAG, "Spool mounted, %d image(s) pending", count);
+}
+
+// 重试用尽的图片写入 flash，空间不足或文件过多时删除最旧的
+static void spool_write(const upload_item_t *item)
+{
+    if (!s_spool_mounted) {
+        // 启动时已告警过一次
+        ESP_LOGD(TAG, "No spool partition, drop image (%u bytes)", item->len);
+        return;
+    }
+    char path[32];
+    xSemaphoreTake(s_spool_lock, portMAX_DELAY);
+    while (1) {
+        size_t total = 0, used = 0;
+        uint32_t oldest = 0;
+        int count = spool_scan(&oldest);
+        if (esp_spiffs_info(SPOOL_PARTITION_LABEL, &total, &used) != ESP_OK) {
+            break;
+        }
+        // spiffs 需预留部分空间，按 1.2 倍估算
+        if (count < SPOOL_MAX_FILES && (total - used) > UPLOAD_KEY_LEN + item->len + item->len / 5) {
+            break;
+        }
+        if (oldest == 0) {
+            break;
+        }
+        spool_path(path, sizeof(path), oldest);
+        ESP_LOGW(TAG, "Spool full, remove oldest %s", path);
+        unlink(path);
+    }
+
+    spool_path(path, sizeof(path), s_spool_next_seq++);
+    FILE *f = fopen(path, "wb");
+    if (f) {
+        bool ok = fwrite(item->key, 1, UPLOAD_KEY_LEN, f) == UPLOAD_KEY_LEN
+                  && fwrite(item->data, 1, item->len, f) == item->len;
+        fclose(f);
+        if (!ok) {
+            ESP_LOGE(TAG, "Spool write failed: %s", path);
+            unlink(path);
+        } else {
+            ESP_LOGI(TAG, "Image spooled: %s (%u bytes)", path, item->len);
+        }
+    } else {
+        ESP_LOGE(TAG, "Spool open failed: %s", path);
+    }
+    xSemaphoreGive(s_spool_lock);
+}
+
+// 读出最旧的暂存图片，没有则返回 false
+static bool spool_read_oldest(upload_item_t *item)
+{
+    if (!s_spool_mounted) {
+        return false;
+    }
+    bool ok = false;
+    char path[32];
+    uint32_t oldest = 0;
+    xSemaphoreTake(s_spool_lock, portMAX_DELAY);
+    if (spool_scan(&oldest) > 0 && oldest != 0) {
+        spool_path(path, sizeof(path), oldest);
+        struct stat st;
+        FILE *f = NULL;
+        if (stat(path, &st) == 0 && st.st_size > 0 && (f = fopen(path, "rb")) != NULL) {
+            uint8_t head[UPLOAD_KEY_LEN];
+            size_t head_len = fread(head, 1, sizeof(head), f);
+            size_t key_len = item_key_parse(head, head_len < (size_t)st.st_size ? head_len : 0, item->key);
+            size_t len = st.st_size - key_len;
+            fseek(f, key_len, SEEK_SET);
+            item->data = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+            if (item->data && fread(item->data, 1, len, f) == len) {
+                item->len = len;
+                item->spool_seq = oldest;
+                ok = true;
+            } else {
+                free(item->data);
+                item->data = NULL;
+            }
+            fclose(f);
+        }
+        if (!ok && f == NULL) {
+            // 损坏的空文件，直接删除
+            unlink(path);
+        }
+    }
+    xSemaphoreGive(s_spool_lock);
+    return ok;
+}
+
+static void spool_remove(uint32_t seq)
+{
+    char path[32];
+    spool_path(path, sizeof(path), seq);
+    xSemaphoreTake(s_spool_lock, portMAX_DELAY);
+    unlink(path);
+    xSemaphoreGive(s_spool_lock);
+}
+
+// 上传一张，失败按指数退避重试；返回是否成功
+static bool upload_with_retry(const upload_item_t *item)
+{
+    for (int retry = 0; retry <= UPLOAD_RETRY_MAX; retry++) {
+        if (retry > 0) {
+            vTaskDelay(pdMS_TO_TICKS(UPLOAD_RETRY_BASE_MS << (retry - 1)));
+        }
+        esp_err_t ret = img_upload_send_keyed(item->data, item->len, item->key);
+        if (ret == ESP_OK) {
+            return true;
+        }
+        if (ret == ESP_ERR_INVALID_ARG) {
+            // 数据本身无效，重试无意义
+            ESP_LOGE(TAG, "Invalid image, drop");
+            return true;
+        }
+        ESP_LOGW(TAG, "Upload failed (0x%x), retry %d/%d", ret, retry + 1, UPLOAD_RETRY_MAX);
+    }
+    return false;
+}
+
+static void upload_queue_task(void *arg)
+{
+    int worker = (int)(intptr_t)arg;
+    TickType_t last_drain_tick = xTaskGetTickCount();
+    while (1) {
+        upload_item_t *item = NULL;
+        BaseType_t got = xQueueReceive(s_queue, &item, pdMS_TO_TICKS(UPLOAD_DRAIN_INTERVAL_MS));
+        if (got == pdTRUE && item) {
+            inflight_set(worker, item);
+            if (upload_with_retry(item)) {
+                s_drain_interval_ms = UPLOAD_DRAIN_INTERVAL_MS;
+            } else {
+                spool_write(item);
+            }
+            inflight_clear(worker);
+            free(item->data);
+            free(item);
+            continue;
+        }
+
+        // 空闲或被 kick：补传 flash 中最旧的一张（item 为 NULL 表示 kick）
+        bool kicked = (got == pdTRUE);
+        if (!kicked && (xTaskGetTickCount() - last_drain_tick) < pdMS_TO_TICKS(s_drain_interval_ms)) {
+            continue;
+        }
+        last_drain_tick = xTaskGetTickCount();
+        if (xSemaphoreTake(s_drain_lock, 0) != pdTRUE) {
+            continue;
+        }
+        upload_item_t spooled = {0};
+        if (!spool_read_oldest(&spooled)) {
+            xSemaphoreGive(s_drain_lock);
+            continue;
+        }
+        ESP_LOGI(TAG, "Draining spooled image %u (%u bytes)", (unsigned)spooled.spool_seq, spooled.len);
+        // 成功（或数据无效）即删除，网络失败则保留等待下次
+        if (upload_with_retry(&spooled)) {
+            spool_remove(spooled.spool_seq);
+            s_drain_interval_ms = UPLOAD_DRAIN_INTERVAL_MS;
+            // 还有暂存则尽快继续
+            upload_item_t *next = NULL;
+            xQueueSend(s_queue, &next, 0);
+        } else if (s_drain_interval_ms < UPLOAD_DRAIN_MAX_MS) {
+            s_drain_interval_ms *= 2;
+        }
+        free(spooled.data);
+        xSemaphoreGive(s_drain_lock);
+    }
+}
+
+esp_err_t img_upload_queue_init(void)
+{
+    if (s_queue) {
+        return ESP_OK;
+    }
+    s_queue = xQueueCreate(UPLOAD_QUEUE_LEN, sizeof(upload_item_t *));
+    s_spool_lock = xSemaphoreCreateMutex();
+    s_drain_lock = xSemaphoreCreateMutex();
+    if (!s_queue || !s_spool_lock || !s_drain_lock) {
+        ESP_LOGE(TAG, "Failed to create upload queue");
+        return ESP_ERR_NO_MEM;
+    }
+    spool_mount();
+    for (int i = 0; i < UPLOAD_QUEUE_WORKERS; i++) {
+        if (xTaskCreate(upload_queue_task, "img_upload_q", 4096, (void *)(intptr_t)i, 4, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create upload queue task");
+            return ESP_FAIL;
+        }
+    }
+#if CONFIG_POWER_FAIL
+    power_fail_register(&s_power_fail_hook);
+#endif
+    ESP_LOGI(TAG, "img_upload_queue initialized");
+    return ESP_OK;
+}
+
+esp_err_t img_upload_queue_push(const uint8_t *data, size_t len)
+{
+    char key[UPLINK_ID_STR_LEN];
+    if (!data || len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return queue_push(data, len, uplink_id_next_str(key));
+}
+
+static esp_err_t queue_push(const uint8_t *data, size_t len, const char *key)
+{
+    if (len == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_queue) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    upload_item_t *item = calloc(1, sizeof(upload_item_t));
+    if (!item) {
+        return ESP_ERR_NO_MEM;
+    }
+    item->data = heap_caps_malloc(len, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!item->data) {
+        free(item);
+        return ESP_ERR_NO_MEM;
+    }
+    memcpy(item->data, data, len);
+    item->len = len;
+    strncpy(item->key, key, sizeof(item->key) - 1);
+
+    if (xQueueSend(s_queue, &item, 0) != pdTRUE) {
+        // 队列已满，直接暂存到 flash
+        ESP_LOGW(TAG, "Upload queue full, spool image");
+        spool_write(item);
+        free(item->data);
+        free(item);
+    }
+    return ESP_OK;
+}
+
+bool img_upload_queue_spool_ready(void)
+{
+    return s_spool_mounted;
+}
+
+void img_upload_queue_kick(void)
+{
+    if (!s_queue) {
+        return;
+    }
+    upload_item_t *item = NULL;
+    xQueueSend(s_queue, &item, 0);
+}
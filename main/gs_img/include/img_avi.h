@@ -0,0 +1,56 @@
+#ifndef IMG_AVI_H
+#define IMG_AVI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// 顺序写出一段数据
+typedef esp_err_t (*img_avi_write_cb_t)(void *ctx, const void *data, size_t len);
+// 改写已写出的数据（文件头中的长度与帧数），输出不可回写时为 NULL
+typedef esp_err_t (*img_avi_patch_cb_t)(void *ctx, uint32_t offset, const void *data, size_t len);
+
+typedef struct {
+    uint32_t frame_us;              // 帧间隔（微秒），AVI 以固定帧率播放
+    uint32_t max_frames;            // 最多帧数（含补帧），用于分配索引
+    img_avi_write_cb_t write;
+    img_avi_patch_cb_t patch;
+    void *ctx;
+} img_avi_config_t;
+
+typedef struct img_avi img_avi_t;
+
+/**
+ * 创建 MJPEG AVI 流式封装：文件头在第一帧时写出，帧数据直接交给 write，只在内存中保留索引（每帧 16 字节），
+ * 结束时在文件末尾写 idx1。patch 为 NULL 时文件头中的长度与帧数保持 0，
+ * 播放器（ffmpeg/VLC 等）按文件长度和 idx1 读取
+ */
+esp_err_t img_avi_open(const img_avi_config_t *config, img_avi_t **out);
+
+/**
+ * 写入一帧 JPEG；jpg 为 NULL 时写空帧，播放器重复上一帧，用于补齐掉帧保持时间轴
+ * @return ESP_ERR_INVALID_SIZE 超过 max_frames；其他错误来自 write
+ */
+esp_err_t img_avi_add_frame(img_avi_t *avi, const uint8_t *jpg, size_t len);
+
+// 已写入的帧数（含空帧）
+uint32_t img_avi_frame_count(const img_avi_t *avi);
+
+/**
+ * 写出索引并（可回写时）补全文件头，释放 avi
+ * @param total 返回文件总字节数，可为 NULL
+ */
+esp_err_t img_avi_close(img_avi_t *avi, size_t *total);
+
+// 放弃封装并释放 avi，不再写出任何数据
+void img_avi_abort(img_avi_t *avi);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_AVI_H
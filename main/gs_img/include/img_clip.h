@@ -0,0 +1,29 @@
+#ifndef IMG_CLIP_H
+#define IMG_CLIP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "esp_err.h"
+
+/**
+ * 初始化事件短视频：创建录制任务，扫描 flash 中未上传的短视频
+ *
+ * 事件触发后把预录环中事件前 CONFIG_IMG_CLIP_PRE_MS 的帧与帧广播上事件后 CONFIG_IMG_CLIP_POST_MS 的帧
+ * 按固定帧率封装为 MJPEG AVI，边录边写：暂存分区可用时写入 flash 再上传，否则直接以 chunked 编码上传，
+ * 整个文件不在内存中。
+ */
+esp_err_t img_clip_init(void);
+
+// 门铃等事件发生时调用，不阻塞；录制中再次触发被忽略
+esp_err_t img_clip_trigger(void);
+
+// 联网后调用，上传 flash 中暂存的短视频
+void img_clip_kick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_CLIP_H
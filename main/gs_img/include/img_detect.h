@@ -0,0 +1,81 @@
+/**
+ * @file img_detect.h
+ * @brief 门铃事件的目标检测（CONFIG_IMG_DETECT）：有人/人脸时先上传目标区域的裁剪图，原图按需再传
+ *
+ * 事件帧先按 1/2^n 缩小解码为 RGB888（宽不超过 320），交给固定在 core 1 的检测任务跑 esp-dl 模型；
+ * 模型在第一次检测时才加载，之后常驻。检测到目标时：
+ *   - 按目标框并集裁剪原图并重新编码，目标框元数据（img_roi_meta_json）写入裁剪图的 COM 段，
+ *     同时发布到 /event/detect；
+ *   - 原图在 PSRAM 中保留 CONFIG_IMG_DETECT_HOLD_S 秒，服务器向 /service/detect 发送
+ *     {"op":"full","id":N} 时交给上传队列。
+ * 未检测到目标或检测超时，调用方按原流程上传整帧。
+ */
+
+#ifndef IMG_DETECT_H
+#define IMG_DETECT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "img_roi.h"
+
+#define IMG_DETECT_MAX_BOXES    8
+
+typedef struct {
+    uint32_t events;            // 送检的事件帧
+    uint32_t hits;              // 检测到目标并生成裁剪图
+    uint32_t timeouts;          // 未在 CONFIG_IMG_DETECT_TIMEOUT_MS 内完成（含首次加载模型）
+    uint32_t full_requests;     // 按请求补传的原图
+    uint32_t last_infer_ms;     // 最近一次推理耗时
+    bool model_loaded;
+} img_detect_stats_t;
+
+#if CONFIG_IMG_DETECT
+
+/**
+ * @brief 创建检测任务并登记 MQTT 请求，不加载模型
+ */
+esp_err_t img_detect_init(void);
+
+/**
+ * @brief 对事件帧做检测，检测到目标时返回裁剪图并保留原图待取
+ *
+ * @param jpg   事件帧，函数返回后即可归还
+ * @param crop  返回裁剪图（COM 段带目标框），使用后调用 img_thumb_free() 释放
+ * @return ESP_OK 有目标；ESP_ERR_NOT_FOUND 无目标；ESP_ERR_TIMEOUT / ESP_ERR_INVALID_STATE 检测未完成或正忙
+ */
+esp_err_t img_detect_event(const uint8_t *jpg, size_t len, uint8_t **crop, size_t *crop_len);
+
+void img_detect_get_stats(img_detect_stats_t *stats);
+
+/**
+ * @brief 在 RGB888 图像上运行检测模型（img_detect_model.cpp，esp-dl），首次调用时加载模型
+ *
+ * @param min_score 置信度下限 0~100
+ * @return 目标数，按置信度从高到低；模型加载失败返回 -1
+ */
+int img_detect_model_run(const uint8_t *rgb, uint16_t width, uint16_t height, uint8_t min_score,
+                         img_roi_box_t *boxes, int max);
+
+#else
+
+static inline esp_err_t img_detect_init(void) { return ESP_OK; }
+static inline esp_err_t img_detect_event(const uint8_t *jpg, size_t len, uint8_t **crop, size_t *crop_len)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+static inline void img_detect_get_stats(img_detect_stats_t *stats) {}
+
+#endif // CONFIG_IMG_DETECT
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_DETECT_H
@@ -0,0 +1,65 @@
+#ifndef IMG_FANOUT_H
+#define IMG_FANOUT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// 最多目的地数
+#define IMG_FANOUT_DEST_MAX     4
+
+typedef struct {
+    const char *key;
+    const char *value;
+} img_fanout_header_t;
+
+// 单个目的地上传结束后调用，在该目的地的上传任务中运行；status 为 HTTP 状态码，传输失败为 -1
+typedef void (*img_fanout_result_cb_t)(void *arg, esp_err_t ret, int status);
+
+// 所有目的地结束且调用方放弃引用后调用，用于归还帧
+typedef void (*img_fanout_release_cb_t)(void *ctx);
+
+typedef struct {
+    const char *name;                   // 用于日志与任务名
+    const char *url;
+    const img_fanout_header_t *headers; // 额外请求头，创建时复制
+    size_t header_num;
+    const char *boundary;               // multipart boundary，以 POST 表单上传；NULL 时以 image/jpeg 原始数据 PUT
+    const char *field;                  // 表单字段名，NULL 为 "upload"
+    const char *filename;               // 表单文件名，NULL 为 "image.jpg"
+    img_fanout_result_cb_t result_cb;
+    void *result_arg;
+} img_fanout_dest_config_t;
+
+typedef struct img_fanout_frame img_fanout_frame_t;
+
+/**
+ * 添加一个上传目的地：每个目的地有独立的上传任务和 keep-alive 连接，各目的地并行上传
+ * @return ESP_ERR_NO_MEM 目的地已满或内存不足
+ */
+esp_err_t img_fanout_add_dest(const img_fanout_dest_config_t *config);
+
+// 已添加的目的地数
+size_t img_fanout_dest_num(void);
+
+/**
+ * 把同一帧交给所有目的地上传，不复制数据，不阻塞
+ *
+ * 每个目的地和调用方各持有一个引用，目的地上传结束（或因积压被跳过）后放弃引用，
+ * 调用方用完后调用 img_fanout_frame_put()，最后一个引用放弃时调用 release(ctx)。
+ * @return 调用方持有的帧；没有目的地或内存不足时返回 NULL，此时不会调用 release，帧仍归调用方
+ */
+img_fanout_frame_t *img_fanout_send(const uint8_t *data, size_t len, img_fanout_release_cb_t release, void *ctx);
+
+// 放弃调用方的引用
+void img_fanout_frame_put(img_fanout_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_FANOUT_H
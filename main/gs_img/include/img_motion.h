@@ -0,0 +1,38 @@
+#ifndef IMG_MOTION_H
+#define IMG_MOTION_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// 移动侦测经 state_report_mqtt_upload() 上报的状态类型，值为变化的网格数
+#define IMG_MOTION_STATE        0x2101
+
+typedef struct {
+    uint32_t frames;            // 分析过的帧数
+    uint32_t events;            // 触发的移动事件数
+    uint32_t avg_us;            // 每帧平均分析耗时
+    uint8_t last_cells;         // 最近一帧变化的网格数
+} img_motion_stats_t;
+
+/**
+ * 启动移动侦测：订阅帧广播，每 N 帧取一帧按 1/8 缩小解码（TJpgDec 此时只解 DC 系数，不做 IDCT），
+ * 求网格亮度与运行背景比较，变化网格数超过阈值时上传该帧并上报状态，冷却期内不重复触发
+ * @note  占用一个帧广播订阅者，摄像头因此持续出流；任务固定在 core 1
+ */
+esp_err_t img_motion_start(void);
+
+// 停止移动侦测，阻塞到分析任务退出
+void img_motion_stop(void);
+
+void img_motion_get_stats(img_motion_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_MOTION_H
@@ -0,0 +1,46 @@
+#ifndef IMG_PREROLL_H
+#define IMG_PREROLL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// 预录环中的一帧 JPEG
+typedef struct {
+    const uint8_t *buf;     // JPEG 数据（PSRAM）
+    size_t len;             // 数据长度
+    uint32_t seq;           // UVC 帧序号
+    int64_t timestamp_us;   // 采集完成时间（esp_timer_get_time）
+} img_preroll_frame_t;
+
+// 初始化预录环：slot_num 个槽位，每个 slot_size 字节，最少间隔 interval_ms 存一帧
+esp_err_t img_preroll_init(uint8_t slot_num, size_t slot_size, uint32_t interval_ms);
+
+// 存入一帧（由 UVC 帧回调调用，内部按间隔抽帧并拷贝）
+void img_preroll_push(const uint8_t *data, size_t len, uint32_t seq);
+
+// 最新一帧须在 IMG_PREROLL_FRESH_INTERVALS 个抽帧间隔（至少 IMG_PREROLL_FRESH_MIN_MS）之内才算新鲜
+#define IMG_PREROLL_FRESH_INTERVALS  3
+#define IMG_PREROLL_FRESH_MIN_MS     200
+
+// 获取最新一帧，没有足够新的帧（摄像头挂起、断电后环中只剩旧帧）返回 NULL，用完需 img_preroll_return()
+const img_preroll_frame_t *img_preroll_get_latest(void);
+
+// 获取最近 window_ms 内的帧（由旧到新），最多 max_num 帧，返回实际帧数，每帧用完需 img_preroll_return()
+size_t img_preroll_get_burst(const img_preroll_frame_t **frames, size_t max_num, uint32_t window_ms);
+
+// 归还一帧
+void img_preroll_return(const img_preroll_frame_t *frame);
+
+// 丢弃环中所有帧（视频流挂起或摄像头断开时调用），已被持有的帧在归还前仍可使用
+void img_preroll_clear(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_PREROLL_H
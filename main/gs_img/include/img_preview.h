@@ -0,0 +1,46 @@
+#ifndef IMG_PREVIEW_H
+#define IMG_PREVIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// 按源分辨率自动选缩放：取缩小后仍能铺满显示区域的最大缩放，居中裁剪
+#define IMG_PREVIEW_SCALE_AUTO  0xFF
+
+/**
+ * 一帧预览画面就绪，在预览任务中调用
+ *
+ * rgb565 为 w * h 像素、行宽 w、16 字节对齐的 PSRAM 缓冲，双缓冲轮换：到下下次回调前保持不变，
+ * 可直接包装成 LVGL 图像源（见 ui_preview.h，CONFIG_UI_PREVIEW），
+ * 或交给 esp_lcd_panel_draw_bitmap()，无需再拷贝
+ */
+typedef void (*img_preview_flush_cb_t)(const uint16_t *rgb565, uint16_t w, uint16_t h, void *arg);
+
+typedef struct {
+    uint16_t width;                     // 显示区域宽高（像素）
+    uint16_t height;
+    uint8_t scale;                      // 0~3 对应 1/1~1/8，或 IMG_PREVIEW_SCALE_AUTO
+    bool swap;                          // RGB565 高低字节互换（SPI 屏 / LV_COLOR_16_SWAP）
+    img_preview_flush_cb_t flush_cb;
+    void *arg;
+} img_preview_config_t;
+
+/**
+ * 启动实时预览：订阅帧广播，MJPEG 在 DCT 域缩小解码，只解码显示区域
+ * @note  占用一个帧广播订阅者；解码慢于摄像头时自动跳帧，不影响其他订阅者
+ */
+esp_err_t img_preview_start(const img_preview_config_t *config);
+
+// 停止预览并释放缓冲，阻塞到预览任务退出
+void img_preview_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_PREVIEW_H
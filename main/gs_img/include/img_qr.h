@@ -0,0 +1,29 @@
+#ifndef IMG_QR_H
+#define IMG_QR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+// 识别到二维码时在扫码任务中调用，data 以 '\0' 结尾，只在回调期间有效
+typedef void (*img_qr_cb_t)(const char *data, size_t len);
+
+/**
+ * 开始扫码：订阅帧广播并限制为 CONFIG_GS_BIND_QR_FPS，每帧缩小解码（宽不超过 640）只取亮度交给扫码库；
+ * 同一内容在 10 s 内只回调一次，凭据错误时不会反复重试
+ * @note  占用一个帧广播订阅者；任务固定在 core 1，优先级低于串口任务
+ */
+esp_err_t img_qr_start(img_qr_cb_t cb);
+
+// 停止扫码，阻塞到扫码任务退出；在回调中调用时只发出停止请求
+void img_qr_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_QR_H
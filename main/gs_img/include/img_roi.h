@@ -0,0 +1,48 @@
+#ifndef IMG_ROI_H
+#define IMG_ROI_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "img_thumb.h"
+
+// 检测到的目标框，原图坐标
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+    uint8_t score;              // 置信度 0~100
+} img_roi_box_t;
+
+/**
+ * 由目标框求裁剪区域：取所有框的并集，四周各扩出并集宽高的 margin_pct%，
+ * 对齐到 16 像素（原图的 MCU 边界）并限制在画面内；再选最小的缩小级别，使裁剪图不超过 max_pixels
+ *
+ * @param rect   返回原图坐标系中的区域
+ * @param scale  返回缩小级别 0~3（1/1 ~ 1/8）
+ * @return n 为 0 或画面尺寸为 0 时返回 false
+ */
+bool img_roi_select(const img_roi_box_t *boxes, size_t n, uint16_t frame_w, uint16_t frame_h,
+                    uint8_t margin_pct, uint32_t max_pixels, img_thumb_rect_t *rect, uint8_t *scale);
+
+// 原图坐标的区域换算到 1/2^scale 坐标，起点向下、终点向上取整
+void img_roi_scale_rect(const img_thumb_rect_t *in, uint8_t scale, img_thumb_rect_t *out);
+
+/**
+ * 写目标框元数据：{"id":N,"w":W,"h":H,"roi":[x,y,w,h],"boxes":[[x,y,w,h,score],...]}，坐标均为原图坐标
+ *
+ * @return 长度（不含 '\0'），缓冲不足返回 0
+ */
+size_t img_roi_meta_json(char *buf, size_t size, uint32_t id, uint16_t frame_w, uint16_t frame_h,
+                         const img_thumb_rect_t *roi, const img_roi_box_t *boxes, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_ROI_H
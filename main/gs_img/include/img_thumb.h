@@ -0,0 +1,90 @@
+#ifndef IMG_THUMB_H
+#define IMG_THUMB_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// 缩小后图像中的矩形区域
+typedef struct {
+    uint16_t x;
+    uint16_t y;
+    uint16_t w;
+    uint16_t h;
+} img_thumb_rect_t;
+
+/**
+ * 由 JPEG 生成缩略图：按 1/2^scale 缩小解码（DCT 域缩放），再以基线 JPEG 重新编码
+ *
+ * @param jpg      原始 JPEG（支持省略 Huffman 表的 MJPEG 帧）
+ * @param len      原始 JPEG 长度
+ * @param scale    缩放级别 0~3，对应 1/1、1/2、1/4、1/8
+ * @param quality  编码质量 1~100
+ * @param out      返回缩略图缓冲（PSRAM），使用后调用 img_thumb_free() 释放
+ * @param out_len  返回缩略图长度
+ */
+esp_err_t img_thumb_make(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t quality,
+                         uint8_t **out, size_t *out_len);
+
+/**
+ * 按 1/2^scale 缩小解码 JPEG，只把 clip 区域转为 RGB565 写入 out，用于实时预览
+ *
+ * @param clip  缩小后坐标系中的输出区域，超出图像的部分 out 中保持不变；clip 以下的 MCU 不再解码
+ * @param swap  高低字节互换（SPI 屏 / LV_COLOR_16_SWAP）
+ * @param out   输出缓冲，clip->w * clip->h 像素，行宽 clip->w
+ */
+esp_err_t img_thumb_decode_rgb565(const uint8_t *jpg, size_t len, uint8_t scale, const img_thumb_rect_t *clip,
+                                  bool swap, uint16_t *out);
+
+/**
+ * 把 YUY2（YUYV 4:2:2 打包）图像编码为基线 JPEG（4:2:0），用于只输出非压缩格式的摄像头
+ *
+ * @param out      输出缓冲，由调用者提供
+ * @param out_cap  out 的大小，编码结果超出时返回 ESP_ERR_INVALID_SIZE
+ * @param out_len  返回 JPEG 长度
+ */
+esp_err_t img_thumb_encode_yuyv(const uint8_t *yuyv, uint16_t width, uint16_t height, uint8_t quality,
+                                uint8_t *out, size_t out_cap, size_t *out_len);
+
+/**
+ * 按 1/2^scale 缩小解码 JPEG 中的一块区域并重新编码，用于只上传画面中的目标
+ *
+ * @param rect     缩小后坐标系中的区域，超出图像的部分被裁掉；区域以下的 MCU 不再解码
+ * @param comment  写入 COM 段的文本（如目标框元数据），NULL 不写
+ * @param out      返回裁剪图缓冲（PSRAM），使用后调用 img_thumb_free() 释放
+ */
+esp_err_t img_thumb_crop(const uint8_t *jpg, size_t len, uint8_t scale, const img_thumb_rect_t *rect,
+                         uint8_t quality, const char *comment, uint8_t **out, size_t *out_len);
+
+// 从 SOF 段读取 JPEG 的宽高，不解码
+esp_err_t img_thumb_get_size(const uint8_t *jpg, size_t len, uint16_t *width, uint16_t *height);
+
+/**
+ * 按 1/2^scale 缩小解码整幅 JPEG 为 RGB888（每像素 R、G、B 三字节），用于目标检测
+ *
+ * @param cap     out 的大小，不足时返回 ESP_ERR_INVALID_SIZE，width/height 仍返回所需尺寸
+ * @param width   返回缩小后的宽
+ * @param height  返回缩小后的高
+ */
+esp_err_t img_thumb_decode_rgb888(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t *out, size_t cap,
+                                  uint16_t *width, uint16_t *height);
+
+/**
+ * 按 1/2^scale 缩小解码整幅 JPEG，只输出亮度（每像素 1 字节），用于扫码；参数同 img_thumb_decode_rgb888()
+ */
+esp_err_t img_thumb_decode_gray(const uint8_t *jpg, size_t len, uint8_t scale, uint8_t *out, size_t cap,
+                                uint16_t *width, uint16_t *height);
+
+// 释放 img_thumb_make() / img_thumb_crop() 返回的缓冲
+void img_thumb_free(uint8_t *buf);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_THUMB_H
@@ -5,14 +5,53 @@
 extern "C" {
 #endif
 
+#include <stdint.h>
+#include <stddef.h>
 #include "esp_err.h"
 
 // 初始化图片上传模块，设置服务器URL等
 esp_err_t img_upload_init(const char *server_url);
 
-// 上传图片数据（JPEG 格式）
+// 上传图片数据（JPEG 格式），复用持久连接；每次调用取一个新的幂等键
 esp_err_t img_upload_send(const uint8_t *data, size_t len);
 
+// 同上，带指定的幂等键（UPLINK_ID_HTTP_HEADER 头），同一张图片的每次重试须用同一个键；预签名 PUT 不带键
+esp_err_t img_upload_send_keyed(const uint8_t *data, size_t len, const char *key);
+
+/**
+ * 连拍上传多帧（JPEG）：空闲的持久连接同时各有一个请求在途，写完一帧不等响应就在另一连接上写下一帧
+ * @param ret 每帧的结果，ESP_ERR_INVALID_ARG 为非 JPEG
+ * @return 全部成功返回 ESP_OK
+ */
+esp_err_t img_upload_send_burst(const uint8_t *const data[], const size_t len[], size_t num, esp_err_t ret[]);
+
+// 网络就绪后调用，后台预先建立到上传服务器的连接并保活
+esp_err_t img_upload_warmup(void);
+
+// 流式上传的负载标志
+#define IMG_UPLOAD_STREAM_SOF   (1 << 0)    // 一帧的第一块数据
+#define IMG_UPLOAD_STREAM_EOF   (1 << 1)    // 一帧结束
+#define IMG_UPLOAD_STREAM_DROP  (1 << 2)    // 该帧被丢弃
+
+// 由摄像头负载回调调用，喂入正在接收的帧数据（非阻塞）
+void img_upload_stream_feed(const uint8_t *data, size_t len, uint32_t flags);
+
+// 流式上传下一帧，边采集边上传；timeout_ms 为等待帧开始的时间
+// out_len/out_sum 返回上传的字节数和逐字节累加和
+esp_err_t img_upload_stream_next_frame(uint32_t timeout_ms, size_t *out_len, uint32_t *out_sum);
+
+// 分块上传的句柄，占用一个持久连接直到 img_upload_chunked_end()
+typedef struct img_upload_conn *img_upload_handle_t;
+
+// 开始一次长度未知的 multipart 上传（chunked 编码），filename/content_type 为表单中的文件名与类型
+esp_err_t img_upload_chunked_begin(const char *filename, const char *content_type, img_upload_handle_t *out);
+
+// 追加数据，小块在内部攒够 4KB 再发出
+esp_err_t img_upload_chunked_write(img_upload_handle_t handle, const void *data, size_t len);
+
+// 结束上传并等待响应，abort 时直接断开；无论结果如何都会释放连接
+esp_err_t img_upload_chunked_end(img_upload_handle_t handle, bool abort);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,32 @@
+#ifndef IMG_UPLOAD_QUEUE_H
+#define IMG_UPLOAD_QUEUE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+// flash 暂存分区挂载点；其他模块存放的文件名不能以数字开头，以免被当作暂存图片补传
+#define IMG_UPLOAD_SPOOL_PATH   "/spool"
+
+// 初始化异步上传队列：创建上传任务，挂载 flash 暂存分区（CONFIG_IMG_UPLOAD_SPOOL_PARTITION，不存在则告警一次、只在内存中重试）
+esp_err_t img_upload_queue_init(void);
+
+// 异步上传一张 JPEG（内部拷贝数据），失败按退避重试，仍失败则暂存到 flash，联网后补传
+esp_err_t img_upload_queue_push(const uint8_t *data, size_t len);
+
+// 暂存分区是否已挂载
+bool img_upload_queue_spool_ready(void);
+
+// 网络恢复时调用，立即尝试补传 flash 中暂存的图片
+void img_upload_queue_kick(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // IMG_UPLOAD_QUEUE_H
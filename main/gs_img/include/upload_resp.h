@@ -0,0 +1,48 @@
+#ifndef UPLOAD_RESP_H
+#define UPLOAD_RESP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 上传服务器响应的流式扫描：{"error":0,"img_url":"...","showmsg":"..."}
+ *
+ * 响应体分块到达时逐字节喂入，只提取顶层的 error、img_url、showmsg，其余字段（含嵌套对象/数组）跳过，
+ * 不缓存响应体，不分配内存。字符串中的转义只去掉反斜杠，\uXXXX 原样保留；超长的值被截断。
+ */
+typedef struct {
+    bool has_error;             // 出现了 error 字段
+    int error;
+    char img_url[256];
+    char msg[64];               // showmsg
+    size_t bytes;               // 已喂入的字节数
+    // 扫描状态
+    uint8_t state;
+    uint8_t field;
+    uint16_t depth;
+    bool in_str;
+    bool esc;
+    uint16_t pos;
+    char key[12];
+    char num[12];
+} upload_resp_t;
+
+// 开始扫描一个新的响应
+void upload_resp_init(upload_resp_t *r);
+
+// 喂入一块响应数据
+void upload_resp_feed(upload_resp_t *r, const char *data, size_t len);
+
+// 顶层对象已完整结束
+bool upload_resp_complete(const upload_resp_t *r);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPLOAD_RESP_H
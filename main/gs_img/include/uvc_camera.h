@@ -11,25 +11,82 @@
 extern "C" {
 #endif
 
+#include <stdbool.h>
 #include "esp_camera.h"
 #include "esp_err.h"
 
+/**
+ * @brief  创建事件组、需求锁等，开机时先于其他模块调用
+ * @note   此后取帧接口可在摄像头就绪前调用，等待就绪的时间计入各自的超时
+ */
+esp_err_t uvc_camera_init(void);
+
 /**
  * @brief  启动UVC摄像头（分配传输缓冲区，启动流、创建采集上传任务等）
- *         注意：只有在 Wi-Fi + MQTT 已准备就绪后才调用
+ *         不依赖联网状态，由启动依赖图在开机时调用；阻塞到摄像头连接并预热
+ *         CONFIG_UVC_CAMERA_WARMUP_FRAMES 帧，须在独立任务中调用
  */
 void uvc_camera_start(void);
 
+/**
+ * @brief  等待摄像头连接并完成开机预热
+ * @return true 已就绪，false 超时
+ */
+bool uvc_camera_wait_ready(uint32_t timeout_ms);
+
+/**
+ * @brief  等待自动曝光稳定：连续 CONFIG_UVC_CAMERA_STABLE_FRAMES 帧曝光时间和增益不变（CONFIG_UVC_CAMERA_PREWARM）
+ * @note   恢复或重新连接后的第一次 esp_camera_fb_get_timeout() 内部已调用。读不到曝光的摄像头只按帧数等待；
+ *         按需模式下需在 uvc_camera_demand_begin() 之后调用，否则等不到帧。未开启时直接返回 true
+ *
+ * @return true 已稳定，false 超时
+ */
+bool uvc_camera_wait_stable(uint32_t timeout_ms);
+
+/**
+ * @brief  从UVC摄像头获取最新完成的一帧（带引用计数，多个使用者可同时持有）
+ * @note   持有期间采集不会停止，用完必须调用 esp_camera_fb_return()。
+ *         CONFIG_UVC_CAMERA_PREWARM 下恢复或重新连接后的第一次调用先等曝光稳定（计入超时）
+ *
+ * @param  timeout_ms     尚无可用帧时的最长等待时间，portMAX_DELAY 表示一直等待
+ * @return camera_fb_t*   成功则返回帧指针，超时返回NULL
+ */
+camera_fb_t *esp_camera_fb_get_timeout(uint32_t timeout_ms);
+
 /**
  * @brief  从UVC摄像头获取一帧
- * @note   同 esp_camera_fb_get() 功能类似
+ * @note   等价于 esp_camera_fb_get_timeout(portMAX_DELAY)
  *
  * @return camera_fb_t*   成功则返回帧指针，否则返回NULL
  */
 camera_fb_t *esp_camera_fb_get(void);
 
 /**
- * @brief  释放一帧
+ * @brief  登记一次取帧需求（CONFIG_UVC_CAMERA_ON_DEMAND）
+ * @note   按需模式下无人登记时驱动在负载层直接丢帧，payload_cb 也不会收到数据；
+ *         已因空闲挂起时在此热恢复视频流。esp_camera_fb_get_timeout() 内部已调用，
+ *         直接消费负载数据（流式上传）的模块需自行调用。未开启按需模式时直接返回 ESP_OK。
+ *
+ * @return ESP_OK 成功，需与 uvc_camera_demand_end() 成对调用；失败时不要调用 end
+ */
+esp_err_t uvc_camera_demand_begin(void);
+
+/**
+ * @brief  撤销一次取帧需求，全部撤销后停止交付帧并开始空闲计时
+ */
+void uvc_camera_demand_end(void);
+
+/**
+ * @brief  切断摄像头供电前调用：视频流未挂起时先挂起，重新上电枚举后保持挂起，由下一次需求恢复
+ * @note   仅按需模式支持（CONFIG_BOARD_POWER 使用）
+ *
+ * @return ESP_OK 可以断电；ESP_ERR_INVALID_STATE 有取帧需求或尚未预热；
+ *         ESP_ERR_NOT_FINISHED 仍有使用者持有帧；ESP_ERR_NOT_SUPPORTED 未开启按需模式
+ */
+esp_err_t uvc_camera_power_off_prepare(void);
+
+/**
+ * @brief  释放一帧（引用计数减一）
  * @param  fb  要释放的帧指针
  */
 void esp_camera_fb_return(camera_fb_t *fb);
@@ -0,0 +1,35 @@
+// uvc_quality.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * 帧大小闭环（CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0）：统计 MJPEG 帧的平均字节数，
+ * 周期性地经 uvc_compression_set() 调整摄像头的压缩质量（wCompQuality），使平均帧大小
+ * 落在目标值附近，帧池槽位和上传耗时都按目标值估算。
+ *
+ * 每次调整会重新协商视频流并丢弃正在接收的帧，所以只在偏差超过死区时调整，两次调整之间至少间隔一个周期，
+ * 单次变化不超过当前质量的 1/4。摄像头不接受质量请求（probe 返回其他值）时控制器停止；
+ * 接受但帧大小不随之变化时，质量到达上下限后不再调整。
+ */
+
+/**
+ * 记录一帧的大小，在帧回调中调用，只做计数
+ * @param width/height  帧尺寸，与上一帧不同（例如拥塞降分辨率）时重新统计
+ */
+void uvc_quality_feed(size_t bytes, uint16_t width, uint16_t height);
+
+/**
+ * 创建控制任务，在摄像头连接后调用
+ */
+esp_err_t uvc_quality_start(void);
+
+#ifdef __cplusplus
+}
+#endif
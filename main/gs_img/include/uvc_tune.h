@@ -0,0 +1,42 @@
+// uvc_tune.h
+#pragma once
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * 曝光/白平衡预置（CONFIG_UVC_CAMERA_PREWARM）：挂起视频流前经 UVC 的摄像头终端（CT）和
+ * 处理单元（PU）控制读出已收敛的曝光时间、增益和白平衡色温，缓存在内存并写入 KVS；
+ * 恢复或重新连接后先以手动模式写回这些值，再切回原来的自动模式，自动曝光从上次的结果起步，
+ * 不必从摄像头的默认值重新收敛。
+ *
+ * 摄像头没有声明的控制跳过；写回时按摄像头的 GET_MIN/GET_MAX 限幅，换了摄像头也不会写出越界值。
+ * 所有接口都会发起控制传输，在任务中调用，不能在 usb_stream 的回调里调用。
+ */
+
+/**
+ * 读取当前的曝光、增益和白平衡并缓存
+ * @return ESP_ERR_NOT_SUPPORTED 未连接，或摄像头的相关控制都没有声明、都读取失败
+ */
+esp_err_t uvc_tune_capture(void);
+
+/**
+ * 以缓存值预置摄像头，之后恢复采集时的自动模式
+ * @return ESP_ERR_NOT_FOUND 尚无缓存（内存和 KVS 中都没有）
+ */
+esp_err_t uvc_tune_apply(void);
+
+/**
+ * 读当前的曝光时间（100 µs 单位）和增益，用于判断自动曝光是否已稳定
+ * @note  摄像头没有声明的一项返回 0；两项都没有时返回 ESP_ERR_NOT_SUPPORTED
+ */
+esp_err_t uvc_tune_read(uint32_t *exposure, uint16_t *gain);
+
+#ifdef __cplusplus
+}
+#endif
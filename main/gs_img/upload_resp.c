@@ -0,0 +1,216 @@
+// upload_resp.c
+// 上传响应的流式 JSON 扫描：边收边提取需要的字段，不缓存响应体
+#include "upload_resp.h"
+#include <string.h>
+#include <stdlib.h>
+
+enum {
+    RESP_BEFORE = 0,    // 等待顶层 '{'
+    RESP_KEY_WAIT,      // 等待键或 '}'
+    RESP_KEY,           // 键字符串中
+    RESP_COLON,         // 等待 ':'
+    RESP_VALUE_WAIT,    // 等待值开始
+    RESP_VALUE_STR,     // 字符串值中
+    RESP_VALUE_BARE,    // 数字/true/false/null
+    RESP_SKIP,          // 跳过嵌套的对象或数组
+    RESP_COMMA,         // 等待 ',' 或 '}'
+    RESP_DONE,
+};
+
+enum {
+    FIELD_NONE = 0,
+    FIELD_ERROR,
+    FIELD_IMG_URL,
+    FIELD_MSG,
+};
+
+static bool is_space(char c)
+{
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+static uint8_t match_field(const upload_resp_t *r)
+{
+    if (r->pos >= sizeof(r->key)) {
+        return FIELD_NONE;
+    }
+    if (strcmp(r->key, "error") == 0) {
+        return FIELD_ERROR;
+    }
+    if (strcmp(r->key, "img_url") == 0) {
+        return FIELD_IMG_URL;
+    }
+    if (strcmp(r->key, "showmsg") == 0) {
+        return FIELD_MSG;
+    }
+    return FIELD_NONE;
+}
+
+static char *field_buf(upload_resp_t *r, size_t *size)
+{
+    switch (r->field) {
+    case FIELD_ERROR:
+        *size = sizeof(r->num);
+        return r->num;
+    case FIELD_IMG_URL:
+        *size = sizeof(r->img_url);
+        return r->img_url;
+    case FIELD_MSG:
+        *size = sizeof(r->msg);
+        return r->msg;
+    default:
+        return NULL;
+    }
+}
+
+static void key_put(upload_resp_t *r, char c)
+{
+    // 超长的键不会是要找的字段，pos 停在 sizeof(key) 作为标记
+    if (r->pos < sizeof(r->key) - 1) {
+        r->key[r->pos++] = c;
+    } else {
+        r->pos = sizeof(r->key);
+    }
+}
+
+static void value_put(upload_resp_t *r, char c)
+{
+    size_t size;
+    char *buf = field_buf(r, &size);
+    if (buf && r->pos < size - 1) {
+        buf[r->pos++] = c;
+    }
+}
+
+static void value_end(upload_resp_t *r)
+{
+    size_t size;
+    char *buf = field_buf(r, &size);
+    if (!buf) {
+        return;
+    }
+    buf[r->pos] = '\0';
+    if (r->field == FIELD_ERROR) {
+        r->error = atoi(r->num);
+        r->has_error = true;
+    }
+}
+
+void upload_resp_init(upload_resp_t *r)
+{
+    memset(r, 0, sizeof(*r));
+}
+
+void upload_resp_feed(upload_resp_t *r, const char *data, size_t len)
+{
+    r->bytes += len;
+    for (size_t i = 0; i < len && r->state != RESP_DONE; i++) {
+        char c = data[i];
+        switch (r->state) {
+        case RESP_BEFORE:
+            if (c == '{') {
+                r->state = RESP_KEY_WAIT;
+            }
+            break;
+        case RESP_KEY_WAIT:
+            if (c == '"') {
+                r->state = RESP_KEY;
+                r->pos = 0;
+                r->esc = false;
+            } else if (c == '}') {
+                r->state = RESP_DONE;
+            }
+            break;
+        case RESP_KEY:
+            if (r->esc) {
+                r->esc = false;
+                key_put(r, c);
+            } else if (c == '\\') {
+                r->esc = true;
+            } else if (c == '"') {
+                if (r->pos < sizeof(r->key)) {
+                    r->key[r->pos] = '\0';
+                }
+                r->field = match_field(r);
+                r->state = RESP_COLON;
+            } else {
+                key_put(r, c);
+            }
+            break;
+        case RESP_COLON:
+            if (c == ':') {
+                r->state = RESP_VALUE_WAIT;
+            }
+            break;
+        case RESP_VALUE_WAIT:
+            if (is_space(c)) {
+                break;
+            }
+            r->pos = 0;
+            r->esc = false;
+            if (c == '"') {
+                r->state = RESP_VALUE_STR;
+            } else if (c == '{' || c == '[') {
+                r->depth = 1;
+                r->in_str = false;
+                r->state = RESP_SKIP;
+            } else {
+                value_put(r, c);
+                r->state = RESP_VALUE_BARE;
+            }
+            break;
+        case RESP_VALUE_STR:
+            if (r->esc) {
+                r->esc = false;
+                value_put(r, c);
+            } else if (c == '\\') {
+                r->esc = true;
+            } else if (c == '"') {
+                value_end(r);
+                r->state = RESP_COMMA;
+            } else {
+                value_put(r, c);
+            }
+            break;
+        case RESP_VALUE_BARE:
+            if (c == ',' || c == '}' || is_space(c)) {
+                value_end(r);
+                r->state = (c == ',') ? RESP_KEY_WAIT : (c == '}') ? RESP_DONE : RESP_COMMA;
+            } else {
+                value_put(r, c);
+            }
+            break;
+        case RESP_SKIP:
+            if (r->in_str) {
+                if (r->esc) {
+                    r->esc = false;
+                } else if (c == '\\') {
+                    r->esc = true;
+                } else if (c == '"') {
+                    r->in_str = false;
+                }
+            } else if (c == '"') {
+                r->in_str = true;
+            } else if (c == '{' || c == '[') {
+                r->depth++;
+            } else if ((c == '}' || c == ']') && --r->depth == 0) {
+                r->state = RESP_COMMA;
+            }
+            break;
+        case RESP_COMMA:
+            if (c == ',') {
+                r->state = RESP_KEY_WAIT;
+            } else if (c == '}') {
+                r->state = RESP_DONE;
+            }
+            break;
+        default:
+            break;
+        }
+    }
+}
+
+bool upload_resp_complete(const upload_resp_t *r)
+{
+    return r->state == RESP_DONE;
+}
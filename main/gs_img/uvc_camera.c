@@ -6,6 +6,7 @@
  */
 
 #include <stdio.h>
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 #include <assert.h>
@@ -13,25 +14,64 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "esp_err.h"
+#include "cc_hal_os.h"
+#if CONFIG_PM_ENABLE
+#include "esp_pm.h"
+#endif
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+#include "soc/soc_caps.h"
+#if SOC_JPEG_CODEC_SUPPORTED
+#include "driver/jpeg_encode.h"
+#endif
+#include "img_thumb.h" // img_thumb_encode_yuyv()
+#endif
 
 #include "usb_stream.h"
 #include "esp_camera.h" // camera_fb_t, PIXFORMAT_JPEG
 #include "img_upload.h" // img_upload_send()
+#include "img_preroll.h" // img_preroll_push(), img_preroll_clear()
+#include "lat_trace.h"
+#include "metrics.h"
+#include "tunables.h"
+#include "frame_bus.h" // frame_bus_publish()
+#include "call.h" // call_uac_config()
+#include "board_power.h"
 
 #include "uvc_camera.h"
+#if CONFIG_UVC_CAMERA_PREWARM
+#include "uvc_tune.h"
+#endif
+#if CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0
+#include "uvc_quality.h"
+#endif
+#if CONFIG_UI_RENDER_DUAL_CORE
+#include "ui_render.h"
+#endif
 
 static const char *TAG = "uvc_camera_module";
 
 // ========== 事件位，用于帧同步 ==========
-#define BIT0_FRAME_START     (1 << 0)
-#define BIT1_NEW_FRAME_START (1 << 1)
-#define BIT2_NEW_FRAME_END   (1 << 2)
+#define BIT0_NEW_FRAME       (1 << 0)
+#define BIT1_DEMAND_IDLE     (1 << 1)   // 需求归零，空闲计时重新开始
+#define BIT2_READY           (1 << 2)   // 已连接且预热完成，可以取帧
 
 // ========== UVC 分辨率、缓冲区大小配置 ==========
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+#define DEMO_UVC_FRAME_WIDTH   CONFIG_UVC_CAMERA_YUY2_WIDTH
+#define DEMO_UVC_FRAME_HEIGHT  CONFIG_UVC_CAMERA_YUY2_HEIGHT
+#define DEMO_UVC_FRAME_FPS     CONFIG_UVC_CAMERA_YUY2_FPS
+#define DEMO_UVC_FORMAT        UVC_FORMAT_UNCOMPRESSED
+// 编码输出缓冲：按 1 字节/像素，超出则丢帧
+#define DEMO_UVC_JPEG_BUF_SIZE (DEMO_UVC_FRAME_WIDTH * DEMO_UVC_FRAME_HEIGHT)
+#else
 #define DEMO_UVC_FRAME_WIDTH   1280
 #define DEMO_UVC_FRAME_HEIGHT  720
+#define DEMO_UVC_FRAME_FPS     15
+#define DEMO_UVC_FORMAT        UVC_FORMAT_MJPEG
+#endif
 
 #ifdef CONFIG_IDF_TARGET_ESP32S2
 #define DEMO_UVC_XFER_BUFFER_SIZE (45 * 1024)
@@ -39,38 +79,303 @@ static const char *TAG = "uvc_camera_module";
 #define DEMO_UVC_XFER_BUFFER_SIZE (1024 * 1024)
 #endif
 
+// ========== 帧池槽位数，槽位大小由驱动按协商的帧大小分配 ==========
+// 驱动接收 1 + 最新帧 1 + 使用者持有 1 + 空闲 1，保证使用者持有帧时采集不中断
+#define DEMO_UVC_FRAME_POOL_NUM   4
+
+// ========== 预录环：保留最近的几帧，图传时可立即取用 ==========
+#define DEMO_UVC_PREROLL_SLOT_SIZE    (256 * 1024)
+#define DEMO_UVC_PREROLL_INTERVAL_MS  200
+#if CONFIG_IMG_CLIP && (CONFIG_IMG_CLIP_PRE_MS / DEMO_UVC_PREROLL_INTERVAL_MS + 1) > 4
+// 事件短视频要覆盖事件前 CONFIG_IMG_CLIP_PRE_MS
+#define DEMO_UVC_PREROLL_NUM          (CONFIG_IMG_CLIP_PRE_MS / DEMO_UVC_PREROLL_INTERVAL_MS + 1)
+#else
+#define DEMO_UVC_PREROLL_NUM          4
+#endif
+
+// ========== USB 任务拓扑：USB 中断与处理放在 core 1，网络协议栈在 core 0 ==========
+// 帧回调只做引用计数登记，与采集同核运行，避免被 Wi-Fi/lwIP 抢占造成抖动
+#define DEMO_USB_TASK_CORE          1
+#define DEMO_USB_PROC_TASK_PRIO     6
+#define DEMO_USB_STREAM_TASK_PRIO   5
+#define DEMO_UVC_SAMPLE_TASK_CORE   1
+#define DEMO_UVC_SAMPLE_TASK_PRIO   4
+
+// 请求的帧率，远程修改后下次启动生效；驱动只接受 5~30 fps，描述符中没有该帧间隔时用摄像头的默认间隔
+static tunable_t s_fps = TUNABLE_INT_INIT("uvc.fps", DEMO_UVC_FRAME_FPS, 5, 30);
+
 // ========== 抓取并上传的周期(ms) ==========
 #define UVC_CAPTURE_UPLOAD_PERIOD_MS   (5000)
 
-// ========== 静态全局变量：事件组 & 帧缓冲 ==========
+// ========== 开机预热：等待每个预热帧的超时 ==========
+#define DEMO_UVC_WARMUP_FRAME_TIMEOUT_MS  1000
+
+// ========== 带引用计数的帧 ==========
+typedef struct {
+    camera_fb_t fb;         // 必须为第一个成员，esp_camera_fb_return() 据此找回
+    uvc_frame_t *frame;     // 借用的驱动帧，NULL 表示空闲
+    uint8_t ref;            // 引用计数：“最新帧”、帧广播、每个使用者各占 1
+} uvc_camera_fb_t;
+
+// ========== 静态全局变量：事件组 & 帧表 ==========
 static EventGroupHandle_t s_evt_handle = NULL;
-static camera_fb_t s_fb = {0};  // 用于暂存当前帧
+static portMUX_TYPE s_fb_lock = portMUX_INITIALIZER_UNLOCKED;
+static uvc_camera_fb_t s_fbs[DEMO_UVC_FRAME_POOL_NUM];
+static uvc_camera_fb_t *s_latest = NULL;  // 最新完成的帧
+static uint32_t s_latest_gen = 0;         // 每换一次最新帧加一，用于判断帧是否在请求之后到达
+static bool s_warm = false;               // 开机预热已完成，此后重新连接即就绪
 
-// ========== UVC 回调：填充帧数据 ==========
-static void camera_frame_cb(uvc_frame_t *frame, void *ptr)
+#if CONFIG_UVC_CAMERA_PREWARM
+// ========== 曝光预置：恢复/重新连接后写回上次收敛的曝光，取帧前等曝光稳定 ==========
+#define DEMO_UVC_STABLE_MAX_MS    1000      // 超过此时间仍未稳定也照常交付
+static volatile bool s_prewarm_pending = false;  // 重新连接后尚未预置
+static volatile bool s_settle_pending = false;   // 预置后尚未确认曝光稳定
+#endif
+
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+// ========== 按需采集：无人取帧时驱动在负载层直接丢帧，空闲超时后挂起视频流 ==========
+static SemaphoreHandle_t s_demand_lock = NULL;  // 串行化抽帧设置与挂起/恢复
+static uint16_t s_demand_cnt = 0;               // 正在等待帧的使用者数
+static bool s_idle_pending = false;             // 需求已归零，等待空闲超时
+static bool s_suspended = false;                // 已因空闲挂起
+#endif
+
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+// ========== YUY2 编码：输出缓冲与硬件编码器（有 JPEG 编解码器的芯片） ==========
+static uint8_t *s_jpeg_buf = NULL;
+static size_t s_jpeg_buf_size = 0;
+#if SOC_JPEG_CODEC_SUPPORTED
+static jpeg_encoder_handle_t s_jpeg_enc = NULL;
+#endif
+#endif
+
+#if CONFIG_PM_ENABLE
+// 视频流传输期间 USB 主机不能进入 light sleep，空闲挂起后释放
+static esp_pm_lock_handle_t s_pm_lock = NULL;
+#endif
+
+static void camera_pm_awake(bool awake)
 {
-    // 若未设置开始采集，则忽略
-    if (!(xEventGroupGetBits(s_evt_handle) & BIT0_FRAME_START)) {
-        return;
+#if CONFIG_PM_ENABLE
+    if (s_pm_lock) {
+        if (awake) {
+            esp_pm_lock_acquire(s_pm_lock);
+        } else {
+            esp_pm_lock_release(s_pm_lock);
+        }
     }
+#endif
+}
 
+// 写回上次收敛的曝光和白平衡，之后的第一次取帧先等曝光稳定
+static void camera_prewarm(void)
+{
+#if CONFIG_UVC_CAMERA_PREWARM
+    s_prewarm_pending = false;
+    if (uvc_tune_apply() != ESP_ERR_NOT_FOUND) {
+        s_settle_pending = true;
+    }
+#endif
+}
+
+// 引用计数减一，归零时把帧还给驱动，需在 s_fb_lock 内调用
+static uvc_frame_t *fb_unref_locked(uvc_camera_fb_t *cfb)
+{
+    if (--cfb->ref > 0) {
+        return NULL;
+    }
+    uvc_frame_t *frame = cfb->frame;
+    cfb->frame = NULL;
+    return frame;
+}
+
+// 替换最新帧，旧的最新帧若无人持有则归还驱动
+static void fb_set_latest(uvc_camera_fb_t *cfb)
+{
+    uvc_frame_t *release = NULL;
+    portENTER_CRITICAL(&s_fb_lock);
+    if (s_latest) {
+        release = fb_unref_locked(s_latest);
+    }
+    s_latest = cfb;
+    if (cfb) {
+        s_latest_gen++;
+    }
+    portEXIT_CRITICAL(&s_fb_lock);
+    if (release) {
+        uvc_frame_release(release);
+    }
+}
+
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+// ========== YUY2 编码：有硬件编码器时使用硬件，失败则改用软件编码 ==========
+static esp_err_t camera_yuyv_init(void)
+{
+    if (s_jpeg_buf) {
+        return ESP_OK;
+    }
+#if SOC_JPEG_CODEC_SUPPORTED
+    jpeg_encode_engine_cfg_t engine_cfg = {
+        .timeout_ms = 100,
+    };
+    if (jpeg_new_encoder_engine(&engine_cfg, &s_jpeg_enc) == ESP_OK) {
+        // 硬件输出缓冲需按 DMA 要求对齐
+        jpeg_encode_memory_alloc_cfg_t mem_cfg = {
+            .buffer_direction = JPEG_ENC_ALLOC_OUTPUT_BUFFER,
+        };
+        s_jpeg_buf = jpeg_alloc_encoder_mem(DEMO_UVC_JPEG_BUF_SIZE, &mem_cfg, &s_jpeg_buf_size);
+        if (!s_jpeg_buf) {
+            jpeg_del_encoder_engine(s_jpeg_enc);
+            s_jpeg_enc = NULL;
+        }
+    }
+#endif
+    if (!s_jpeg_buf) {
+        s_jpeg_buf = usb_stream_buf_alloc(DEMO_UVC_JPEG_BUF_SIZE, USB_STREAM_BUF_FRAME, NULL);
+        s_jpeg_buf_size = DEMO_UVC_JPEG_BUF_SIZE;
+    }
+    if (!s_jpeg_buf) {
+        ESP_LOGE(TAG, "Failed to allocate JPEG encode buffer");
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "YUY2 %dx%d@%dfps, %s JPEG encoder", DEMO_UVC_FRAME_WIDTH, DEMO_UVC_FRAME_HEIGHT, (int)tunable_get(&s_fps),
+#if SOC_JPEG_CODEC_SUPPORTED
+             s_jpeg_enc ? "hardware" : "software");
+#else
+             "software");
+#endif
+    return ESP_OK;
+}
+
+// 把 YUY2 帧编码为 JPEG 并写回同一个驱动槽位（槽位按 2 字节/像素分配，必然放得下），之后按 MJPEG 帧处理
+static esp_err_t camera_encode_yuyv(uvc_frame_t *frame)
+{
+    if (frame->data_bytes < (size_t)frame->width * frame->height * 2) {
+        return ESP_ERR_INVALID_SIZE;
+    }
+    size_t len = 0;
+    esp_err_t ret = ESP_FAIL;
+#if SOC_JPEG_CODEC_SUPPORTED
+    if (s_jpeg_enc) {
+        jpeg_encode_cfg_t enc_cfg = {
+            .src_type = JPEG_ENCODE_IN_FORMAT_YUV422,
+            .sub_sample = JPEG_DOWN_SAMPLING_YUV422,
+            .image_quality = CONFIG_UVC_CAMERA_YUY2_JPEG_QUALITY,
+            .width = frame->width,
+            .height = frame->height,
+        };
+        uint32_t out_size = 0;
+        ret = jpeg_encoder_process(s_jpeg_enc, &enc_cfg, frame->data, frame->data_bytes,
+                                   s_jpeg_buf, s_jpeg_buf_size, &out_size);
+        len = out_size;
+        if (ret != ESP_OK) {
+            // 驱动槽位不满足硬件的对齐要求等，此后一直使用软件编码
+            ESP_LOGW(TAG, "Hardware JPEG encode failed (0x%x), use software encoder", ret);
+            jpeg_del_encoder_engine(s_jpeg_enc);
+            s_jpeg_enc = NULL;
+        }
+    }
+#endif
+    if (ret != ESP_OK) {
+        ret = img_thumb_encode_yuyv(frame->data, frame->width, frame->height, CONFIG_UVC_CAMERA_YUY2_JPEG_QUALITY,
+                                    s_jpeg_buf, s_jpeg_buf_size, &len);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    memcpy(frame->data, s_jpeg_buf, len);
+    frame->data_bytes = len;
+    frame->frame_format = UVC_FRAME_FORMAT_MJPEG;
+    return ESP_OK;
+}
+#endif
+
+static metrics_counter_t s_frame_drop = METRICS_COUNTER_INIT("usb.frame_drop");
+
+// ========== UVC 回调：更新最新帧 ==========
+// 零拷贝模式下 frame->data 直接指向驱动的帧池槽位，不再使用时必须 uvc_frame_release()
+// 回调不再阻塞，上传慢时采集照常进行
+static void camera_frame_cb(uvc_frame_t *frame, void *ptr)
+{
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+    // YUY2 帧在此编码（采集任务中，帧率低，编码期间驱动继续接收到其他槽位）
+    if (frame->frame_format == UVC_FRAME_FORMAT_YUYV) {
+        esp_err_t ret = camera_encode_yuyv(frame);
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "YUY2 frame %"PRIu32" encode failed (0x%x), drop", frame->sequence, ret);
+            metrics_counter_inc(&s_frame_drop);
+            uvc_frame_release(frame);
+            return;
+        }
+    }
+#endif
     // 仅支持 MJPEG (示例)
-    if (frame->frame_format == UVC_FRAME_FORMAT_MJPEG) {
-        s_fb.buf    = frame->data;
-        s_fb.len    = frame->data_bytes;
-        s_fb.width  = frame->width;
-        s_fb.height = frame->height;
-        s_fb.format = PIXFORMAT_JPEG;
-        s_fb.timestamp.tv_sec = frame->sequence;
-
-        // 通知有新帧到达
-        xEventGroupSetBits(s_evt_handle, BIT1_NEW_FRAME_START);
-        // 等待处理完再返回
-        xEventGroupWaitBits(s_evt_handle, BIT2_NEW_FRAME_END, pdTRUE, pdTRUE, portMAX_DELAY);
-    } else {
+    if (frame->frame_format != UVC_FRAME_FORMAT_MJPEG) {
         ESP_LOGW(TAG, "Received unsupported frame format: %d", frame->frame_format);
+        uvc_frame_release(frame);
+        return;
+    }
+
+    uvc_camera_fb_t *cfb = NULL;
+    portENTER_CRITICAL(&s_fb_lock);
+    for (size_t i = 0; i < DEMO_UVC_FRAME_POOL_NUM; i++) {
+        if (s_fbs[i].frame == NULL) {
+            cfb = &s_fbs[i];
+            cfb->frame = frame;
+            cfb->ref = 2;   // “最新帧” 1 + 帧广播 1
+            break;
+        }
     }
+    portEXIT_CRITICAL(&s_fb_lock);
+    if (cfb == NULL) {
+        // 驱动槽位数与帧表一致，正常不会发生
+        ESP_LOGW(TAG, "No free frame entry, drop frame %"PRIu32, frame->sequence);
+        metrics_counter_inc(&s_frame_drop);
+        uvc_frame_release(frame);
+        return;
+    }
+
+    cfb->fb.buf    = frame->data;
+    cfb->fb.len    = frame->data_bytes;
+    cfb->fb.width  = frame->width;
+    cfb->fb.height = frame->height;
+    cfb->fb.format = PIXFORMAT_JPEG;
+    // 开始曝光的时刻（esp_timer，开机以来），由驱动按 PTS/SCR 换算；墙钟时间在 frame->capture_time
+    cfb->fb.timestamp.tv_sec = frame->capture_us / 1000000;
+    cfb->fb.timestamp.tv_usec = frame->capture_us % 1000000;
+
+#if CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0
+    uvc_quality_feed(frame->data_bytes, frame->width, frame->height);
+#endif
+
+    fb_set_latest(cfb);
+    // 转给帧广播，HTTP 等多个订阅者各自取最新帧，慢的订阅者跳帧，不阻塞采集
+    frame_bus_publish(&cfb->fb);
+    // 存入预录环（内部按间隔抽帧）
+    img_preroll_push(frame->data, frame->data_bytes, frame->sequence);
+    // 通知有新帧到达
+    xEventGroupSetBits(s_evt_handle, BIT0_NEW_FRAME);
+}
+
+#if !CONFIG_UVC_CAMERA_FORMAT_YUY2
+// ========== UVC 负载回调：在 USB 任务中调用，转给流式上传，不能阻塞 ==========
+static void camera_payload_cb(const uint8_t *data, size_t len, uint32_t flags, void *ptr)
+{
+    uint32_t stream_flags = 0;
+    if (flags & UVC_PAYLOAD_FLAG_SOF) {
+        stream_flags |= IMG_UPLOAD_STREAM_SOF;
+        lat_trace_mark(LAT_TRACE_FRAME_SOF, 0);
+    }
+    if (flags & UVC_PAYLOAD_FLAG_EOF) {
+        stream_flags |= IMG_UPLOAD_STREAM_EOF;
+        lat_trace_mark(LAT_TRACE_FRAME_EOF, 0);
+    }
+    if (flags & UVC_PAYLOAD_FLAG_DROP) {
+        stream_flags |= IMG_UPLOAD_STREAM_DROP;
+    }
+    img_upload_stream_feed(data, len, stream_flags);
 }
+#endif
 
 // ========== UVC 状态回调 ==========
 static void stream_state_changed_cb(usb_stream_state_t event, void *arg)
@@ -78,9 +383,20 @@ static void stream_state_changed_cb(usb_stream_state_t event, void *arg)
     switch (event) {
     case STREAM_CONNECTED:
         ESP_LOGI(TAG, "UVC Device connected");
+        if (s_warm) {
+#if CONFIG_UVC_CAMERA_PREWARM
+            // 回调中不能发起控制传输，留到下一次取帧时预置
+            s_prewarm_pending = true;
+#endif
+            xEventGroupSetBits(s_evt_handle, BIT2_READY);
+        }
         break;
     case STREAM_DISCONNECTED:
         ESP_LOGI(TAG, "UVC Device disconnected");
+        xEventGroupClearBits(s_evt_handle, BIT2_READY);
+        // 断开后最新帧已过期，不再提供给使用者
+        fb_set_latest(NULL);
+        img_preroll_clear();
         break;
     default:
         ESP_LOGE(TAG, "Unknown UVC event");
@@ -88,54 +404,509 @@ static void stream_state_changed_cb(usb_stream_state_t event, void *arg)
     }
 }
 
-// ========== 采集帧接口：获取一帧 ==========
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+// 挂起视频流，需持有 s_demand_lock；仍有使用者持有帧时返回 ESP_ERR_NOT_FINISHED
+static esp_err_t camera_suspend_locked(void)
+{
+    // 挂起会关闭驱动的帧池，先交还最新帧
+    fb_set_latest(NULL);
+    bool held = false;
+    portENTER_CRITICAL(&s_fb_lock);
+    for (size_t i = 0; i < DEMO_UVC_FRAME_POOL_NUM; i++) {
+        held |= (s_fbs[i].frame != NULL);
+    }
+    portEXIT_CRITICAL(&s_fb_lock);
+    if (held) {
+        return ESP_ERR_NOT_FINISHED;
+    }
+#if CONFIG_UVC_CAMERA_PREWARM
+    // 挂起前自动曝光早已收敛，记下结果供恢复时预置
+    uvc_tune_capture();
+#endif
+    esp_err_t ret = usb_streaming_control(STREAM_UVC, CTRL_SUSPEND, NULL);
+    if (ret == ESP_OK) {
+        s_suspended = true;
+        camera_pm_awake(false);
+        // 挂起后不再有新帧，环中的帧只会越来越旧
+        img_preroll_clear();
+        ESP_LOGI(TAG, "UVC stream idle, suspended");
+    } else {
+        ESP_LOGW(TAG, "Idle suspend failed (0x%x)", ret);
+    }
+    return ret;
+}
+#endif
+
+#if CONFIG_UVC_CAMERA_ON_DEMAND && CONFIG_UVC_CAMERA_IDLE_SUSPEND_MS > 0
+// ========== 按需采集：空闲挂起任务 ==========
+// 需求归零 CONFIG_UVC_CAMERA_IDLE_SUSPEND_MS 后挂起视频流，期间有新需求则重新计时
+static void camera_idle_task(void *arg)
+{
+    while (1) {
+        TickType_t wait = s_idle_pending ? pdMS_TO_TICKS(CONFIG_UVC_CAMERA_IDLE_SUSPEND_MS) : portMAX_DELAY;
+        if (xEventGroupWaitBits(s_evt_handle, BIT1_DEMAND_IDLE, pdTRUE, pdTRUE, wait) & BIT1_DEMAND_IDLE) {
+            continue;
+        }
+        xSemaphoreTake(s_demand_lock, portMAX_DELAY);
+        // 仍有使用者持有帧时下个周期再试
+        if (s_idle_pending && s_demand_cnt == 0 && !s_suspended
+            && camera_suspend_locked() != ESP_ERR_NOT_FINISHED) {
+            s_idle_pending = false;
+        }
+        xSemaphoreGive(s_demand_lock);
+    }
+}
+#endif
+
+esp_err_t uvc_camera_power_off_prepare(void)
+{
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    // 开机预热完成前不断电
+    if (s_demand_lock == NULL || !s_warm) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_demand_lock, portMAX_DELAY);
+    if (s_demand_cnt > 0) {
+        ret = ESP_ERR_INVALID_STATE;
+    } else if (!s_suspended) {
+        ret = camera_suspend_locked();
+    }
+    if (ret == ESP_OK) {
+        s_idle_pending = false;
+    }
+    xSemaphoreGive(s_demand_lock);
+    return ret;
+#else
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+}
+
+// ========== 帧广播拥塞：所有实时观看者的链路都带不动时降一档分辨率，恢复后回到默认分辨率 ==========
+// 在订阅者（HTTP 任务）中调用，可以阻塞等待切换完成
+static void camera_bus_congestion(bool congested)
+{
+    uint16_t width = DEMO_UVC_FRAME_WIDTH;
+    uint16_t height = DEMO_UVC_FRAME_HEIGHT;
+
+    if (congested) {
+        size_t num = 0, cur = 0;
+        if (uvc_frame_size_list_get(NULL, &num, &cur) != ESP_OK || num == 0) {
+            return;
+        }
+        uvc_frame_size_t *list = malloc(num * sizeof(uvc_frame_size_t));
+        if (list == NULL) {
+            return;
+        }
+        width = 0;
+        if (uvc_frame_size_list_get(list, &num, &cur) == ESP_OK && cur < num) {
+            // 选比当前小的分辨率中最大的一个
+            uint32_t cur_area = (uint32_t)list[cur].width * list[cur].height;
+            uint32_t best = 0;
+            for (size_t i = 0; i < num; i++) {
+                uint32_t area = (uint32_t)list[i].width * list[i].height;
+                if (area < cur_area && area > best) {
+                    best = area;
+                    width = list[i].width;
+                    height = list[i].height;
+                }
+            }
+        }
+        free(list);
+        if (width == 0) {
+            ESP_LOGW(TAG, "Stream congested, already at the smallest frame size");
+            return;
+        }
+    }
+
+    esp_err_t ret = uvc_frame_size_switch(width, height, 0);
+    ESP_LOGI(TAG, "Stream %s, switch to %ux%u %s", congested ? "congested" : "recovered",
+             width, height, ret == ESP_OK ? "ok" : "failed");
+}
+
+#if CONFIG_BOARD_POWER
+// ========== 帧广播：有实时观看者期间保持摄像头上电与 CPU 最高频 ==========
+static esp_err_t camera_bus_demand_begin(void)
+{
+    // 等待就绪超时也照常登记，订阅者自己等帧
+    board_power_hold(BOARD_HOLD_STREAM);
+    esp_err_t ret = uvc_camera_demand_begin();
+    if (ret != ESP_OK) {
+        board_power_release(BOARD_HOLD_STREAM);
+    }
+    return ret;
+}
+
+static void camera_bus_demand_end(void)
+{
+    uvc_camera_demand_end();
+    board_power_release(BOARD_HOLD_STREAM);
+}
+#else
+#define camera_bus_demand_begin uvc_camera_demand_begin
+#define camera_bus_demand_end   uvc_camera_demand_end
+#endif
+
+// ========== 按需采集：登记/撤销取帧需求 ==========
+esp_err_t uvc_camera_demand_begin(void)
+{
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    if (s_demand_lock == NULL) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_demand_lock, portMAX_DELAY);
+    if (s_demand_cnt == 0) {
+        if (s_suspended) {
+            // 热恢复：驱动保留配置与缓存的协商结果，直接启动传输
+            camera_pm_awake(true);
+            // 启动传输前写入曝光，首帧的亮度就接近挂起前
+            camera_prewarm();
+            ret = usb_streaming_control(STREAM_UVC, CTRL_RESUME, NULL);
+            if (ret == ESP_ERR_INVALID_STATE) {
+                // 重新连接后驱动已自动恢复
+                ret = ESP_OK;
+            }
+            if (ret == ESP_OK) {
+                s_suspended = false;
+                ESP_LOGI(TAG, "UVC stream resumed on demand");
+            } else {
+                camera_pm_awake(false);
+                ESP_LOGE(TAG, "Resume on demand failed (0x%x)", ret);
+            }
+        }
+#if CONFIG_UVC_CAMERA_PREWARM
+        else if (s_prewarm_pending) {
+            camera_prewarm();
+        }
+#endif
+        if (ret == ESP_OK) {
+            uvc_frame_decimate(CONFIG_UVC_CAMERA_DEMAND_DECIMATE);
+        }
+    }
+    if (ret == ESP_OK) {
+#if CONFIG_UI_RENDER_DUAL_CORE
+        // 取帧期间 UVC 任务占着另一个核，界面只用一个绘制单元
+        if (s_demand_cnt == 0) {
+            ui_render_set_parallel(false);
+        }
+#endif
+        s_demand_cnt++;
+        s_idle_pending = false;
+    }
+    xSemaphoreGive(s_demand_lock);
+    return ret;
+#else
+    return ESP_OK;
+#endif
+}
+
+void uvc_camera_demand_end(void)
+{
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    if (s_demand_lock == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_demand_lock, portMAX_DELAY);
+    if (s_demand_cnt > 0 && --s_demand_cnt == 0) {
+        // 无人等待，新帧在驱动负载层直接丢弃，不再拷贝
+        uvc_frame_decimate(0);
+#if CONFIG_UI_RENDER_DUAL_CORE
+        ui_render_set_parallel(true);
+#endif
+#if CONFIG_UVC_CAMERA_IDLE_SUSPEND_MS > 0
+        s_idle_pending = true;
+        xEventGroupSetBits(s_evt_handle, BIT1_DEMAND_IDLE);
+#endif
+    }
+    xSemaphoreGive(s_demand_lock);
+#endif
+}
+
+// ========== 等待最新帧，fresh 为真时只接受 gen 之后到达的帧 ==========
+static camera_fb_t *fb_wait_latest(uint32_t timeout_ms, bool fresh, uint32_t gen)
+{
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TickType_t start_tick = xTaskGetTickCount();
+    do {
+        uvc_camera_fb_t *cfb = NULL;
+        portENTER_CRITICAL(&s_fb_lock);
+        if (s_latest && (!fresh || s_latest_gen != gen)) {
+            cfb = s_latest;
+            cfb->ref++;
+        }
+        portEXIT_CRITICAL(&s_fb_lock);
+        if (cfb) {
+            return &cfb->fb;
+        }
+        // 尚无可用帧，等待新帧到达
+        TickType_t elapsed = xTaskGetTickCount() - start_tick;
+        if (ticks != portMAX_DELAY && elapsed >= ticks) {
+            break;
+        }
+        xEventGroupWaitBits(s_evt_handle, BIT0_NEW_FRAME, pdTRUE, pdTRUE,
+                            (ticks == portMAX_DELAY) ? portMAX_DELAY : (ticks - elapsed));
+    } while (1);
+
+    ESP_LOGW(TAG, "Get frame timeout (%"PRIu32" ms)", timeout_ms);
+    return NULL;
+}
+
+// ========== 曝光稳定：连续 CONFIG_UVC_CAMERA_STABLE_FRAMES 帧曝光时间和增益不变 ==========
+bool uvc_camera_wait_stable(uint32_t timeout_ms)
+{
+#if CONFIG_UVC_CAMERA_PREWARM && CONFIG_UVC_CAMERA_STABLE_FRAMES > 0
+    if (s_evt_handle == NULL) {
+        return false;
+    }
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    TickType_t start_tick = xTaskGetTickCount();
+    uint32_t last_exp = 0;
+    uint16_t last_gain = 0;
+    int stable = -1;    // 第一帧只作基准
+    while (stable < CONFIG_UVC_CAMERA_STABLE_FRAMES) {
+        uint32_t wait_ms = portMAX_DELAY;
+        if (ticks != portMAX_DELAY) {
+            TickType_t elapsed = xTaskGetTickCount() - start_tick;
+            if (elapsed >= ticks) {
+                return false;
+            }
+            wait_ms = pdTICKS_TO_MS(ticks - elapsed);
+        }
+        portENTER_CRITICAL(&s_fb_lock);
+        uint32_t gen = s_latest_gen;
+        portEXIT_CRITICAL(&s_fb_lock);
+        camera_fb_t *fb = fb_wait_latest(wait_ms, true, gen);
+        if (fb == NULL) {
+            return false;
+        }
+        esp_camera_fb_return(fb);
+        uint32_t exp = 0;
+        uint16_t gain = 0;
+        if (uvc_tune_read(&exp, &gain) != ESP_OK) {
+            // 读不到曝光的摄像头只按帧数等待
+            stable++;
+            continue;
+        }
+        uint32_t tol = last_exp / 32;
+        if (stable >= 0 && gain == last_gain && exp + tol >= last_exp && exp <= last_exp + tol) {
+            stable++;
+        } else {
+            stable = 0;
+        }
+        last_exp = exp;
+        last_gain = gain;
+    }
+#endif
+    return true;
+}
+
+// 预置后的第一次取帧先等曝光稳定，最多 DEMO_UVC_STABLE_MAX_MS，所用时间从 *timeout_ms 扣除
+// 返回 true 表示刚确认稳定，最新帧即可交付
+static bool camera_settle(uint32_t *timeout_ms)
+{
+#if CONFIG_UVC_CAMERA_PREWARM && CONFIG_UVC_CAMERA_STABLE_FRAMES > 0
+    if (!s_settle_pending) {
+        return false;
+    }
+    uint32_t limit = *timeout_ms < DEMO_UVC_STABLE_MAX_MS ? *timeout_ms : DEMO_UVC_STABLE_MAX_MS;
+    TickType_t start_tick = xTaskGetTickCount();
+    bool stable = uvc_camera_wait_stable(limit);
+    uint32_t waited = pdTICKS_TO_MS(xTaskGetTickCount() - start_tick);
+    if (*timeout_ms != portMAX_DELAY) {
+        *timeout_ms = waited < *timeout_ms ? *timeout_ms - waited : 0;
+    }
+    // 等不到稳定也只等这一次，之后照常交付
+    s_settle_pending = false;
+    ESP_LOGI(TAG, "Exposure %s after %"PRIu32" ms", stable ? "stable" : "still changing", waited);
+    return stable;
+#else
+    return false;
+#endif
+}
+
+// ========== 采集帧接口：获取最新一帧 ==========
+camera_fb_t *esp_camera_fb_get_timeout(uint32_t timeout_ms)
+{
+    if (s_evt_handle == NULL) {
+        return NULL;
+    }
+    // 开机后摄像头仍在枚举/预热时，等待就绪的时间计入本次超时
+    if (!(xEventGroupGetBits(s_evt_handle) & BIT2_READY)) {
+        TickType_t start_tick = xTaskGetTickCount();
+        if (!uvc_camera_wait_ready(timeout_ms)) {
+            ESP_LOGW(TAG, "Camera not ready (%"PRIu32" ms)", timeout_ms);
+            return NULL;
+        }
+        if (timeout_ms != portMAX_DELAY) {
+            uint32_t waited = pdTICKS_TO_MS(xTaskGetTickCount() - start_tick);
+            timeout_ms = waited < timeout_ms ? timeout_ms - waited : 0;
+        }
+    }
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    // 按需模式下最新帧可能早已过期，登记需求后等待下一帧
+    portENTER_CRITICAL(&s_fb_lock);
+    uint32_t gen = s_latest_gen;
+    portEXIT_CRITICAL(&s_fb_lock);
+    if (uvc_camera_demand_begin() != ESP_OK) {
+        return NULL;
+    }
+    // 曝光稳定后直接交付稳定时的那一帧
+    bool fresh = !camera_settle(&timeout_ms);
+    camera_fb_t *fb = fb_wait_latest(timeout_ms, fresh, gen);
+    uvc_camera_demand_end();
+    return fb;
+#else
+#if CONFIG_UVC_CAMERA_PREWARM
+    if (s_prewarm_pending) {
+        camera_prewarm();
+    }
+#endif
+    camera_settle(&timeout_ms);
+    return fb_wait_latest(timeout_ms, false, 0);
+#endif
+}
+
 camera_fb_t *esp_camera_fb_get(void)
 {
-    // 标记开始采集
-    xEventGroupSetBits(s_evt_handle, BIT0_FRAME_START);
-    // 等待新帧到达
-    xEventGroupWaitBits(s_evt_handle, BIT1_NEW_FRAME_START, pdTRUE, pdTRUE, portMAX_DELAY);
-    return &s_fb;
+    return esp_camera_fb_get_timeout(portMAX_DELAY);
 }
 
 // ========== 采集帧接口：释放一帧 ==========
 void esp_camera_fb_return(camera_fb_t *fb)
 {
-    // 这里只是通知可以采集下一帧，实际不释放任何内存
-    (void)fb;
-    xEventGroupSetBits(s_evt_handle, BIT2_NEW_FRAME_END);
+    if (fb == NULL) {
+        return;
+    }
+    uvc_camera_fb_t *cfb = (uvc_camera_fb_t *)fb;
+    portENTER_CRITICAL(&s_fb_lock);
+    uvc_frame_t *release = fb_unref_locked(cfb);
+    portEXIT_CRITICAL(&s_fb_lock);
+    if (release) {
+        uvc_frame_release(release);
+    }
 }
 
-// ========== 启动UVC摄像头：对外暴露的接口 ==========
-void uvc_camera_start(void)
+bool uvc_camera_wait_ready(uint32_t timeout_ms)
 {
-    // 1. 创建事件组（若尚未创建）
+    if (s_evt_handle == NULL) {
+        return false;
+    }
+    TickType_t ticks = (timeout_ms == portMAX_DELAY) ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    return (xEventGroupWaitBits(s_evt_handle, BIT2_READY, pdFALSE, pdTRUE, ticks) & BIT2_READY) != 0;
+}
+
+// ========== 开机预热：完成 PROBE/COMMIT 后先取若干帧，让自动曝光收敛 ==========
+static void camera_warmup(void)
+{
+    // 上次运行记下的曝光先写入，预热帧从接近收敛的值开始
+    camera_prewarm();
+    if (CONFIG_UVC_CAMERA_WARMUP_FRAMES > 0 && uvc_camera_demand_begin() == ESP_OK) {
+        int i = 0;
+        for (; i < CONFIG_UVC_CAMERA_WARMUP_FRAMES; i++) {
+            portENTER_CRITICAL(&s_fb_lock);
+            uint32_t gen = s_latest_gen;
+            portEXIT_CRITICAL(&s_fb_lock);
+            camera_fb_t *fb = fb_wait_latest(DEMO_UVC_WARMUP_FRAME_TIMEOUT_MS, true, gen);
+            if (fb == NULL) {
+                break;
+            }
+            esp_camera_fb_return(fb);
+        }
+        uvc_camera_demand_end();
+        ESP_LOGI(TAG, "Warm-up done, %d frames", i);
+    }
+#if CONFIG_UVC_CAMERA_PREWARM
+    // 预热帧代替了曝光稳定等待；收敛结果存下来，下次开机即可预置
+    s_settle_pending = false;
+    if (CONFIG_UVC_CAMERA_WARMUP_FRAMES > 0) {
+        uvc_tune_capture();
+    }
+#endif
+    s_warm = true;
+    xEventGroupSetBits(s_evt_handle, BIT2_READY);
+}
+
+esp_err_t uvc_camera_init(void)
+{
+    metrics_register(&s_frame_drop.head);
+    tunables_register(&s_fps);
     if (s_evt_handle == NULL) {
         s_evt_handle = xEventGroupCreate();
         if (s_evt_handle == NULL) {
             ESP_LOGE(TAG, "Failed to create event group for UVC");
-            return;
+            return ESP_ERR_NO_MEM;
+        }
+    }
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    if (s_demand_lock == NULL) {
+        s_demand_lock = xSemaphoreCreateMutex();
+        if (s_demand_lock == NULL) {
+            ESP_LOGE(TAG, "Failed to create demand lock for UVC");
+            return ESP_ERR_NO_MEM;
         }
     }
+#endif
+#if CONFIG_PM_ENABLE
+    if (s_pm_lock == NULL && esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "uvc", &s_pm_lock) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to create pm lock for UVC");
+    }
+#endif
+    return ESP_OK;
+}
+
+// ========== 启动UVC摄像头：对外暴露的接口 ==========
+void uvc_camera_start(void)
+{
+    // 1. 创建事件组与需求锁（若开机时尚未调用 uvc_camera_init）
+    if (uvc_camera_init() != ESP_OK) {
+        return;
+    }
+
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    // 按需模式下没有连续帧，不启用预录环
+#else
+    // 预录环分配失败不影响实时取帧
+    if (img_preroll_init(DEMO_UVC_PREROLL_NUM, DEMO_UVC_PREROLL_SLOT_SIZE, DEMO_UVC_PREROLL_INTERVAL_MS) != ESP_OK) {
+        ESP_LOGW(TAG, "img_preroll_init failed, preroll disabled");
+    }
+#endif
+
+    // 帧广播：订阅者出现/全部离开时登记/撤销取帧需求，链路拥塞时调整分辨率
+    frame_bus_config_t bus_config = {
+        .demand_begin = camera_bus_demand_begin,
+        .demand_end   = camera_bus_demand_end,
+        .congestion   = camera_bus_congestion,
+    };
+    esp_err_t bus_ret = frame_bus_init(&bus_config);
+    if (bus_ret != ESP_OK && bus_ret != ESP_ERR_INVALID_STATE) {
+        ESP_LOGW(TAG, "frame_bus_init failed");
+    }
 
-    // 2. 分配传输与帧缓冲内存
-    uint8_t *xfer_buffer_a = (uint8_t *)malloc(DEMO_UVC_XFER_BUFFER_SIZE);
-    uint8_t *xfer_buffer_b = (uint8_t *)malloc(DEMO_UVC_XFER_BUFFER_SIZE);
-    uint8_t *frame_buffer  = (uint8_t *)malloc(DEMO_UVC_XFER_BUFFER_SIZE);
-    assert(xfer_buffer_a && xfer_buffer_b && frame_buffer);
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+    if (camera_yuyv_init() != ESP_OK) {
+        return;
+    }
+#endif
 
-    // 3. 配置 UVC
+    // 2. 配置 UVC（帧池由驱动分配，零拷贝模式，无需传输/帧缓冲）
+    //    xfer_buffer_size 作为单个槽位的上限
     uvc_config_t uvc_config = {
         .frame_width       = DEMO_UVC_FRAME_WIDTH,
         .frame_height      = DEMO_UVC_FRAME_HEIGHT,
-        .frame_interval    = FPS2INTERVAL(15),  // 15fps
+        .frame_interval    = FPS2INTERVAL(tunable_get(&s_fps)),
         .xfer_buffer_size  = DEMO_UVC_XFER_BUFFER_SIZE,
-        .xfer_buffer_a     = xfer_buffer_a,
-        .xfer_buffer_b     = xfer_buffer_b,
-        .frame_buffer_size = DEMO_UVC_XFER_BUFFER_SIZE,
-        .frame_buffer      = frame_buffer,
         .frame_cb          = camera_frame_cb,
         .frame_cb_arg      = NULL,
+        .flags             = FLAG_UVC_FRAME_ZERO_COPY,
+        .frame_pool_num    = DEMO_UVC_FRAME_POOL_NUM,
+        .format            = DEMO_UVC_FORMAT,
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+        // 负载是未压缩数据，不能边收边上传
+        .payload_cb        = NULL,
+#else
+        .payload_cb        = camera_payload_cb,
+#endif
     };
 
     esp_err_t ret = uvc_streaming_config(&uvc_config);
@@ -144,12 +915,51 @@ void uvc_camera_start(void)
         return;
     }
 
-    // 4. 注册UVC状态回调，启动并等待连接
+#if CONFIG_UVC_CAMERA_ON_DEMAND
+    // 启动后先不交付帧，首次取帧时再打开
+    uvc_frame_decimate(0);
+#endif
+
+    // 对讲的 UAC 麦克风/扬声器须与 UVC 一起在启动流之前配置
+    if (call_uac_config() != ESP_OK) {
+        ESP_LOGW(TAG, "uac_streaming_config failed, intercom without audio");
+    }
+
+    usb_stream_task_config_t task_config = {0};
+    usb_streaming_task_config_get(&task_config);
+    task_config.usb_proc.core_id = DEMO_USB_TASK_CORE;
+    task_config.usb_proc.priority = DEMO_USB_PROC_TASK_PRIO;
+    task_config.stream_proc.core_id = DEMO_USB_TASK_CORE;
+    task_config.stream_proc.priority = DEMO_USB_STREAM_TASK_PRIO;
+    task_config.sample_proc.core_id = DEMO_UVC_SAMPLE_TASK_CORE;
+    task_config.sample_proc.priority = DEMO_UVC_SAMPLE_TASK_PRIO;
+    if (usb_streaming_task_config(&task_config) != ESP_OK) {
+        ESP_LOGW(TAG, "usb_streaming_task_config failed, use Kconfig defaults");
+    }
+
+    // 3. 注册UVC状态回调，启动并等待连接
     ESP_ERROR_CHECK(usb_streaming_state_register(stream_state_changed_cb, NULL));
+    camera_pm_awake(true);
     ESP_ERROR_CHECK(usb_streaming_start());
     ESP_ERROR_CHECK(usb_streaming_connect_wait(portMAX_DELAY));
 
-    // 5. 不再启动周期性抓拍任务，而是等待其他模块（例如 img_transfer）调用 esp_camera_fb_get()
+#if CONFIG_UVC_CAMERA_ON_DEMAND && CONFIG_UVC_CAMERA_IDLE_SUSPEND_MS > 0
+    // 只在空闲超时时挂起相机，栈放 PSRAM
+    if (cc_hal_os_task_create_caps(camera_idle_task, "uvc_idle", 3072, NULL, 3, CC_OS_STACK_PSRAM, NULL) != CC_OK) {
+        ESP_LOGW(TAG, "Failed to create uvc idle task, idle suspend disabled");
+    } else {
+        // 启动后无人取帧同样按空闲处理
+        s_idle_pending = true;
+        xEventGroupSetBits(s_evt_handle, BIT1_DEMAND_IDLE);
+    }
+#endif
+
+    // 4. 预热后标记就绪；不启动周期性抓拍任务，而是等待其他模块（例如 img_transfer）调用 esp_camera_fb_get()
+    camera_warmup();
+#if CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0
+    // 预热后自动曝光已收敛，帧大小的统计从此开始
+    uvc_quality_start();
+#endif
     ESP_LOGI(TAG, "UVC camera initialized and streaming started.");
 }
 
@@ -0,0 +1,137 @@
+// uvc_quality.c
+// 帧大小闭环：按平均帧大小调整摄像头的压缩质量，使帧大小接近目标值
+#include "sdkconfig.h"
+
+#if CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0
+
+#include <inttypes.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "usb_stream.h"
+#include "uvc_quality.h"
+
+static const char *TAG = "uvc_quality";
+
+#define UVC_QUALITY_PERIOD_MS       2000
+#define UVC_QUALITY_MIN_FRAMES      8       // 一个周期内帧数不足（挂起、帧率低）时不调整
+#define UVC_QUALITY_DEADBAND        8       // 偏差在目标值的 1/8 以内不调整
+#define UVC_QUALITY_DEFAULT         5000    // 摄像头不报告当前质量时的起点
+#define UVC_QUALITY_TASK_STACK      3072
+#define UVC_QUALITY_TASK_PRIO       2
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static uint64_t s_bytes = 0;
+static uint32_t s_frames = 0;
+static uint32_t s_area = 0;
+static TaskHandle_t s_task = NULL;
+
+void uvc_quality_feed(size_t bytes, uint16_t width, uint16_t height)
+{
+    uint32_t area = (uint32_t)width * height;
+    portENTER_CRITICAL(&s_lock);
+    if (area != s_area) {
+        s_area = area;
+        s_bytes = 0;
+        s_frames = 0;
+    }
+    s_bytes += bytes;
+    s_frames++;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+// 取出并清零本周期的统计
+static uint32_t quality_take(uint32_t *frames)
+{
+    portENTER_CRITICAL(&s_lock);
+    uint64_t bytes = s_bytes;
+    uint32_t n = s_frames;
+    s_bytes = 0;
+    s_frames = 0;
+    portEXIT_CRITICAL(&s_lock);
+    if (frames) {
+        *frames = n;
+    }
+    return n ? (uint32_t)(bytes / n) : 0;
+}
+
+static uint16_t clamp_u16(uint32_t v, uint16_t lo, uint16_t hi)
+{
+    return v < lo ? lo : (v > hi ? hi : (uint16_t)v);
+}
+
+static void uvc_quality_task(void *arg)
+{
+    const uint32_t target = CONFIG_UVC_CAMERA_TARGET_FRAME_KB * 1024;
+    uint16_t quality = 0;
+    uint16_t qmin = 1, qmax = 10000;
+
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(UVC_QUALITY_PERIOD_MS));
+        uint32_t frames = 0;
+        uint32_t avg = quality_take(&frames);
+        if (frames < UVC_QUALITY_MIN_FRAMES) {
+            continue;
+        }
+        if (quality == 0) {
+            // 首次调整前取摄像头的质量范围和当前值
+            uvc_compression_t comp = {0};
+            if (uvc_compression_get(&comp) != ESP_OK) {
+                continue;
+            }
+            if (comp.quality_max) {
+                qmin = comp.quality_min ? comp.quality_min : 1;
+                qmax = comp.quality_max;
+            }
+            quality = clamp_u16(comp.quality ? comp.quality : UVC_QUALITY_DEFAULT, qmin, qmax);
+            ESP_LOGI(TAG, "quality %u (range %u ~ %u), max frame %"PRIu32" B, target %"PRIu32" B",
+                     quality, qmin, qmax, comp.max_frame_size, target);
+        }
+        uint32_t diff = avg > target ? avg - target : target - avg;
+        if (diff <= target / UVC_QUALITY_DEADBAND) {
+            continue;
+        }
+        // 帧大小随质量大致单调，按比例估算新质量，单次变化限制在 1/4 以内，剩下的留给下个周期
+        uint32_t next = (uint64_t)quality * target / avg;
+        uint32_t step = quality / 4 ? quality / 4 : 1;
+        if (next > quality + step) {
+            next = quality + step;
+        } else if (next + step < quality) {
+            next = quality - step;
+        }
+        next = clamp_u16(next, qmin, qmax);
+        if (next == quality) {
+            // 已到上下限
+            continue;
+        }
+        esp_err_t ret = uvc_compression_set(next, 0);
+        if (ret == ESP_ERR_NOT_SUPPORTED) {
+            ESP_LOGW(TAG, "Camera does not accept compression quality, stop");
+            break;
+        }
+        if (ret != ESP_OK) {
+            ESP_LOGW(TAG, "Set quality %"PRIu32" failed (0x%x)", next, ret);
+            continue;
+        }
+        ESP_LOGI(TAG, "avg frame %"PRIu32" B, target %"PRIu32" B, quality %u -> %"PRIu32, avg, target, quality, next);
+        quality = next;
+        // 切换期间的帧按旧质量编码，不计入下个周期
+        quality_take(NULL);
+    }
+    s_task = NULL;
+    vTaskDelete(NULL);
+}
+
+esp_err_t uvc_quality_start(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    if (xTaskCreate(uvc_quality_task, "uvc_quality", UVC_QUALITY_TASK_STACK, NULL, UVC_QUALITY_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create quality task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_UVC_CAMERA_TARGET_FRAME_KB > 0
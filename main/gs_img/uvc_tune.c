@@ -0,0 +1,177 @@
+// uvc_tune.c
+// 曝光/白平衡预置：挂起前记下自动曝光的收敛结果，恢复后先写回再交还给自动模式
+#include "sdkconfig.h"
+
+#if CONFIG_UVC_CAMERA_PREWARM
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_bit_defs.h"
+#include "usb_stream.h"
+#include "cc_hal_kvs.h"
+#include "uvc_tune.h"
+
+static const char *TAG = "uvc_tune";
+
+#define UVC_TUNE_KVS_KEY    "uvc_tune"
+
+// 写回顺序：先关自动模式，再写各个值，最后恢复采集时的模式
+enum {
+    TUNE_AE_MODE = 0,
+    TUNE_WB_AUTO,
+    TUNE_EXPOSURE,
+    TUNE_GAIN,
+    TUNE_WB_TEMP,
+    TUNE_NUM,
+};
+
+typedef struct {
+    uvc_vc_unit_t unit;
+    uint8_t selector;
+    uint8_t len;
+} uvc_tune_ctrl_t;
+
+static const uvc_tune_ctrl_t s_ctrls[TUNE_NUM] = {
+    [TUNE_AE_MODE]  = {UVC_VC_CAMERA_TERMINAL, UVC_CT_AE_MODE_CONTROL, 1},
+    [TUNE_WB_AUTO]  = {UVC_VC_PROCESSING_UNIT, UVC_PU_WHITE_BALANCE_TEMPERATURE_AUTO_CONTROL, 1},
+    [TUNE_EXPOSURE] = {UVC_VC_CAMERA_TERMINAL, UVC_CT_EXPOSURE_TIME_ABSOLUTE_CONTROL, 4},
+    [TUNE_GAIN]     = {UVC_VC_PROCESSING_UNIT, UVC_PU_GAIN_CONTROL, 2},
+    [TUNE_WB_TEMP]  = {UVC_VC_PROCESSING_UNIT, UVC_PU_WHITE_BALANCE_TEMPERATURE_CONTROL, 2},
+};
+
+typedef struct {
+    uint32_t value[TUNE_NUM];
+    uint32_t valid;         // 按 TUNE_* 的位
+} uvc_tune_cache_t;
+
+static uvc_tune_cache_t s_cache;
+static bool s_loaded = false;
+
+static bool ctrl_supported(int i)
+{
+    return uvc_vc_control_supported(s_ctrls[i].unit, s_ctrls[i].selector);
+}
+
+// 控制值为小端，按控制的长度读写
+static esp_err_t ctrl_get(int i, enum uvc_req_code req, uint32_t *value)
+{
+    uint8_t buf[4] = {0};
+    esp_err_t ret = uvc_vc_control_get(s_ctrls[i].unit, s_ctrls[i].selector, req, buf, s_ctrls[i].len);
+    if (ret == ESP_OK) {
+        *value = buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t)buf[3] << 24);
+    }
+    return ret;
+}
+
+static esp_err_t ctrl_set(int i, uint32_t value)
+{
+    uint8_t buf[4] = {value, value >> 8, value >> 16, value >> 24};
+    return uvc_vc_control_set(s_ctrls[i].unit, s_ctrls[i].selector, buf, s_ctrls[i].len);
+}
+
+// 自动曝光每次收敛的结果略有差别，变化在 1/16 以内时不重写 KVS
+static bool cache_close(const uvc_tune_cache_t *a, const uvc_tune_cache_t *b)
+{
+    if (a->valid != b->valid) {
+        return false;
+    }
+    for (int i = 0; i < TUNE_NUM; i++) {
+        uint32_t tol = a->value[i] / 16;
+        if (a->value[i] + tol < b->value[i] || b->value[i] + tol < a->value[i]) {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void cache_load(void)
+{
+    if (s_loaded) {
+        return;
+    }
+    size_t len = sizeof(s_cache);
+    if (cc_hal_kvs_get(UVC_TUNE_KVS_KEY, &s_cache, &len) != CC_OK || len != sizeof(s_cache)) {
+        memset(&s_cache, 0, sizeof(s_cache));
+    }
+    s_loaded = true;
+}
+
+esp_err_t uvc_tune_capture(void)
+{
+    uvc_tune_cache_t cache = {0};
+    for (int i = 0; i < TUNE_NUM; i++) {
+        if (ctrl_supported(i) && ctrl_get(i, UVC_GET_CUR, &cache.value[i]) == ESP_OK) {
+            cache.valid |= BIT(i);
+        }
+    }
+    if (!cache.valid) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    cache_load();
+    if (!cache_close(&cache, &s_cache)) {
+        cc_hal_kvs_set(UVC_TUNE_KVS_KEY, &cache, sizeof(cache));
+    }
+    s_cache = cache;
+    ESP_LOGI(TAG, "Captured exposure %lu, gain %lu, white balance %lu K (valid 0x%02lx)",
+             (unsigned long)cache.value[TUNE_EXPOSURE], (unsigned long)cache.value[TUNE_GAIN],
+             (unsigned long)cache.value[TUNE_WB_TEMP], (unsigned long)cache.valid);
+    return ESP_OK;
+}
+
+esp_err_t uvc_tune_apply(void)
+{
+    cache_load();
+    if (!s_cache.valid) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    bool ae = (s_cache.valid & BIT(TUNE_AE_MODE)) && ctrl_supported(TUNE_AE_MODE);
+    bool awb = (s_cache.valid & BIT(TUNE_WB_AUTO)) && ctrl_supported(TUNE_WB_AUTO);
+    // 自动模式下摄像头拒绝写曝光时间和色温
+    if (ae) {
+        ctrl_set(TUNE_AE_MODE, UVC_AE_MODE_MANUAL);
+    }
+    if (awb) {
+        ctrl_set(TUNE_WB_AUTO, 0);
+    }
+    int applied = 0;
+    for (int i = TUNE_EXPOSURE; i < TUNE_NUM; i++) {
+        if (!(s_cache.valid & BIT(i)) || !ctrl_supported(i)) {
+            continue;
+        }
+        uint32_t value = s_cache.value[i];
+        uint32_t min = 0, max = 0;
+        if (ctrl_get(i, UVC_GET_MIN, &min) == ESP_OK && ctrl_get(i, UVC_GET_MAX, &max) == ESP_OK && min <= max) {
+            value = value < min ? min : (value > max ? max : value);
+        }
+        if (ctrl_set(i, value) == ESP_OK) {
+            applied++;
+        }
+    }
+    // 恢复自动模式，自动曝光和白平衡从刚写入的值继续调整
+    if (ae) {
+        ctrl_set(TUNE_AE_MODE, s_cache.value[TUNE_AE_MODE]);
+    }
+    if (awb) {
+        ctrl_set(TUNE_WB_AUTO, s_cache.value[TUNE_WB_AUTO]);
+    }
+    ESP_LOGI(TAG, "Pre-set %d controls, exposure %lu, gain %lu, white balance %lu K", applied,
+             (unsigned long)s_cache.value[TUNE_EXPOSURE], (unsigned long)s_cache.value[TUNE_GAIN],
+             (unsigned long)s_cache.value[TUNE_WB_TEMP]);
+    return applied ? ESP_OK : ESP_FAIL;
+}
+
+esp_err_t uvc_tune_read(uint32_t *exposure, uint16_t *gain)
+{
+    uint32_t exp = 0, g = 0;
+    esp_err_t ret_exp = ctrl_supported(TUNE_EXPOSURE) ? ctrl_get(TUNE_EXPOSURE, UVC_GET_CUR, &exp) : ESP_ERR_NOT_SUPPORTED;
+    esp_err_t ret_gain = ctrl_supported(TUNE_GAIN) ? ctrl_get(TUNE_GAIN, UVC_GET_CUR, &g) : ESP_ERR_NOT_SUPPORTED;
+    if (exposure) {
+        *exposure = ret_exp == ESP_OK ? exp : 0;
+    }
+    if (gain) {
+        *gain = ret_gain == ESP_OK ? (uint16_t)g : 0;
+    }
+    return (ret_exp == ESP_OK || ret_gain == ESP_OK) ? ESP_OK : ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_UVC_CAMERA_PREWARM
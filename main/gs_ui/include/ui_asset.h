@@ -0,0 +1,83 @@
+#ifndef UI_ASSET_H
+#define UI_ASSET_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+/*
+ * 资源分区：界面图片、字体打包进独立的 data 分区（tools/asset_pack.py 生成），运行时整体 mmap，
+ * 不再编译成 C 数组、也不在启动时拷进 RAM。分区表中添加一行：
+ *
+ *   assets, data, 0x40, , 1M
+ *
+ * 分区布局（小端）：
+ *   ui_asset_part_header_t
+ *   ui_asset_entry_t[count]     按名字字节序升序，运行时二分查找
+ *   资源数据                    图片为 LVGLImage.py 输出的 .bin 原样（12 字节 lv_image_header_t + 数据）
+ */
+#define UI_ASSET_MAGIC          0x41555347      // "GSUA"
+#define UI_ASSET_VERSION        1
+#define UI_ASSET_NAME_LEN       24
+
+typedef enum {
+    UI_ASSET_TYPE_BLOB = 0,
+    UI_ASSET_TYPE_IMAGE = 1,    // LVGL .bin 图片，可带 RLE/LZ4 压缩
+    UI_ASSET_TYPE_FONT = 2,     // lv_font_conv --format bin 字体
+} ui_asset_type_t;
+
+typedef struct {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t count;
+    uint32_t total_size;        // 头 + 索引 + 数据，mmap 的长度
+    uint16_t table_crc;         // 索引表的 CRC16/CCITT-FALSE
+    uint16_t reserved;
+} ui_asset_part_header_t;
+
+typedef struct {
+    char name[UI_ASSET_NAME_LEN];   // 以 '\0' 结尾
+    uint32_t offset;                // 相对分区起始
+    uint32_t size;
+    uint8_t type;                   // ui_asset_type_t
+    uint8_t reserved[3];
+} ui_asset_entry_t;
+
+/**
+ * 映射资源分区，并把图片缓存设为 CONFIG_UI_ASSET_CACHE_KB
+ * @note  在 lv_init() 之后调用；只读分区头和索引，启动时不拷贝资源数据
+ */
+esp_err_t ui_asset_init(void);
+
+/**
+ * 按名字取图片描述，可直接作为 lv_image_set_src() 的参数
+ *
+ * 数据指向 flash 映射：未压缩的图片由 LVGL 直接从 flash 绘制，不占 RAM；
+ * RLE/LZ4 压缩的图片由 LVGL 的 bin 解码器解压进 lv_image_cache，超出预算时按 LRU 淘汰
+ * @return 描述在 ui_asset_init() 后一直有效；没有该资源或不是图片时返回 NULL
+ */
+const lv_image_dsc_t *ui_asset_image(const char *name);
+
+/**
+ * 按名字取任意资源的原始数据（flash 映射地址，只读）
+ */
+esp_err_t ui_asset_get(const char *name, const void **data, size_t *size);
+
+#if LV_USE_FS_MEMFS
+/**
+ * 从资源分区加载 bin 字体，用完后 lv_binfont_destroy()
+ * @note  字形表由 LVGL 读入 RAM，资源分区省掉的是 C 数组占用的 flash 和固件大小
+ */
+lv_font_t *ui_asset_font(const char *name);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_ASSET_H
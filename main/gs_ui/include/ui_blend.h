@@ -0,0 +1,60 @@
+#ifndef UI_BLEND_H
+#define UI_BLEND_H
+
+/*
+ * LVGL 软件渲染的 ESP32-S3 PIE 内核（CONFIG_UI_BLEND_SIMD）。
+ *
+ * 这个头文件由 LVGL 自己的绘制源码包含：LV_DRAW_SW_ASM 选 CUSTOM，
+ * LV_DRAW_SW_ASM_CUSTOM_INCLUDE 设为 "ui_blend.h"，main/CMakeLists.txt 把 gs_ui/include
+ * 加到 lvgl 库的头文件路径。下面的钩子返回 LV_RESULT_INVALID 时 LVGL 照常走自己的 C 实现。
+ *
+ * 覆盖 RGB565 目标上最常见的几条路径：纯色填充、RGB565 图像的 NORMAL 混合（直接复制、
+ * 固定透明度、逐像素遮罩、遮罩叠加透明度）以及送屏前的字节交换。
+ *
+ * esp_lvgl_port 有同样用途的 esp_lvgl_port_lv_blend.h，但它是带 .component_hash 的托管组件，
+ * 版本 2.4.3 只在 LVGL 9.1.x 下编译汇编、头文件用的是 9.1 的描述符类型名，与本项目的
+ * LVGL 9.2 对不上。它的两个填充内核在这里按 9.2 的描述符重新注册，组件本身不改。
+ */
+
+#include "sdkconfig.h"
+
+#if CONFIG_UI_BLEND_SIMD
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LV_DRAW_SW_COLOR_BLEND_TO_RGB565(dsc)                   ui_blend_fill_rgb565(dsc)
+#define LV_DRAW_SW_COLOR_BLEND_TO_ARGB8888(dsc)                 ui_blend_fill_argb8888(dsc)
+
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565(dsc)           ui_blend_image_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_OPA(dsc)  ui_blend_image_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_WITH_MASK(dsc) ui_blend_image_rgb565(dsc)
+#define LV_DRAW_SW_RGB565_BLEND_NORMAL_TO_RGB565_MIX_MASK_OPA(dsc) ui_blend_image_rgb565(dsc)
+
+#define LV_DRAW_SW_RGB565_SWAP(buf, buf_size_px)                ui_blend_swap_rgb565(buf, buf_size_px)
+
+/**
+ * 纯色填充（无遮罩、不透明），用 esp_lvgl_port 的填充内核
+ */
+lv_result_t ui_blend_fill_rgb565(lv_draw_sw_blend_fill_dsc_t *dsc);
+lv_result_t ui_blend_fill_argb8888(lv_draw_sw_blend_fill_dsc_t *dsc);
+
+/**
+ * RGB565 图像以 NORMAL 方式混合到 RGB565 目标，按描述符里的 mask_buf / opa 选内核。
+ * 与 LVGL 的 C 实现逐位一致；宽度不足 16 像素或地址不是 2 字节对齐时返回 LV_RESULT_INVALID
+ */
+lv_result_t ui_blend_image_rgb565(lv_draw_sw_blend_image_dsc_t *dsc);
+
+/**
+ * 原地交换 RGB565 的高低字节，即 ui_pixel_swap565()
+ */
+lv_result_t ui_blend_swap_rgb565(void *buf, uint32_t buf_size_px);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_UI_BLEND_SIMD
+
+#endif // UI_BLEND_H
@@ -0,0 +1,61 @@
+#ifndef UI_CACHE_H
+#define UI_CACHE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * LVGL 图片缓存统计（CONFIG_UI_CACHE_STATS）：lv_image_cache（解码后的图片，按字节计）和
+ * lv_image_header_cache（图片头，按条目计）各自的命中、未命中、淘汰次数和占用，预算可在运行时调整。
+ *
+ * LVGL 的缓存没有计数，这里与 test_apps/ui_bench 的做法相同：复制缓存类并替换其中的
+ * get_cb（查找）和 get_victim_cb（按 LRU 选出淘汰项）。lv_image_cache_drop() 内部也经 get_cb 查找，
+ * 这类调用同样计入命中/未命中，正常绘制中很少发生。
+ *
+ * 本头文件不依赖 LVGL，sys_stats 据此把统计放进 GET /stats 和 MQTT 上报，
+ * GET /stats?img_cache_kb=N&hdr_cache=N 调整预算。
+ */
+
+typedef enum {
+    UI_CACHE_IMAGE = 0,     // lv_image_cache，size 单位为字节
+    UI_CACHE_HEADER,        // lv_image_header_cache，size 单位为条目
+    UI_CACHE_MAX,
+} ui_cache_id_t;
+
+typedef struct {
+    uint32_t hits;
+    uint32_t misses;
+    uint32_t evictions;     // 为腾出空间按 LRU 淘汰的条目数，不含主动 drop
+    uint32_t size;          // 当前占用
+    uint32_t max_size;      // 预算，0 表示缓存关闭
+} ui_cache_stats_t;
+
+/**
+ * 挂接两个缓存的计数
+ * @note  在 lv_init() / lvgl_port_init() 之后、持有 LVGL 锁时调用；可重复调用
+ */
+esp_err_t ui_cache_init(void);
+
+/**
+ * 取统计，计数为上次清零以来的累计值
+ * @param reset  取完后清零计数，占用和预算不受影响
+ * @return ESP_ERR_INVALID_STATE 未初始化；ESP_ERR_NOT_SUPPORTED 未开启
+ */
+esp_err_t ui_cache_get_stats(ui_cache_id_t id, ui_cache_stats_t *stats, bool reset);
+
+/**
+ * 调整预算，超出新预算的条目立即按 LRU 淘汰（计入 evictions）
+ * @note  内部取 LVGL 锁（可重入），任意任务中可调用
+ */
+esp_err_t ui_cache_set_budget(ui_cache_id_t id, uint32_t max_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_CACHE_H
@@ -0,0 +1,71 @@
+#ifndef UI_FLUSH_H
+#define UI_FLUSH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+#include "esp_lcd_panel_ops.h"
+#include "driver/gpio.h"
+#include "lvgl.h"
+
+/*
+ * 送屏加速（CONFIG_UI_FLUSH_ACCEL）：替换 esp_lvgl_port 的 flush 回调，
+ * RGB565 的软件旋转和字节交换由 ui_pixel 在一遍内完成，再交给 esp_lcd_panel_draw_bitmap()。
+ * esp_lvgl_port 打开 sw_rotate 时先旋转再另行处理字节序，而且旋转时不交换字节。
+ *
+ * 同一个回调还可以：
+ * - double_buffer：显示只有一个局部绘制缓冲时自动补第二个，LVGL 渲染第 N+1 块时第 N 块在 DMA 中。
+ *   端口的缓冲可 DMA 时只补一个同样大小的，否则两个都在内部 RAM 重新分配（端口的那个不再使用，
+ *   这时 buffer_size 给小一些）；
+ * - merge_px：每帧的脏区在加入 LVGL 的列表时，与已有的一块合并后多画的像素不超过它就合成一块，
+ *   SPI 屏每块都有命令和 LVGL 逐块遍历对象的固定开销，零碎的小块合并后帧时间更短；
+ * - te_sync：每帧第一块等屏的 TE 上升沿（开始消隐）再送，送屏跟在扫描后面，不撕裂，
+ *   动画也不会因为与刷新相位漂移而掉到半帧率。等不到 TE 时超时后照常送。
+ *
+ * 用法：lvgl_port_add_disp() 时 flags.swap_bytes 置 false（字节交换改由这里做），
+ * 需要软件旋转时 flags.sw_rotate 置 true，端口就不去设置屏的硬件旋转；
+ * 之后在持有 LVGL 锁时调用 ui_flush_attach()，旋转仍用 lv_display_set_rotation()。
+ *
+ * 只适用于 SPI/I80 屏：传完一块后由端口注册的面板 IO 回调通知 LVGL，这里不调 flush_ready。
+ * ESP32-S3 没有 PPA/2D-DMA，旋转在 CPU 上做。只支持一个显示。
+ */
+
+typedef struct {
+    esp_lcd_panel_handle_t panel;   // 与 lvgl_port_display_cfg_t.panel_handle 相同
+    uint32_t buffer_size;           // LVGL 绘制缓冲的像素数，需要软件旋转时据此分配旋转缓冲
+    bool swap_bytes;                // 送屏前交换 RGB565 字节（大端屏）
+    bool sw_rotate;                 // 软件旋转，false 时不分配旋转缓冲、忽略显示的旋转设置
+    bool double_buffer;             // 只有一个局部绘制缓冲时补成两个
+    uint32_t merge_px;              // 脏区合并允许多画的像素数，0 不合并（只有 LVGL 自己的重叠合并）
+    bool te_sync;                   // 每帧第一块对齐 TE
+    gpio_num_t te_gpio;             // te_sync 时屏的 TE 引脚
+} ui_flush_config_t;
+
+/**
+ * 接管显示的 flush 回调
+ * @return ESP_ERR_NOT_SUPPORTED 显示不是 RGB565；ESP_ERR_NO_MEM 旋转缓冲或第二个绘制缓冲分配失败；
+ *         TE 引脚配置失败时返回 gpio 驱动的错误
+ */
+esp_err_t ui_flush_attach(lv_display_t *disp, const ui_flush_config_t *config);
+
+typedef struct {
+    uint32_t flushes;               // 送屏的块数
+    uint32_t merged;                // 合并进已有脏区的次数
+    uint32_t te_waits;              // 等到了 TE 的帧数
+    uint32_t te_timeouts;           // 等 TE 超时的帧数
+} ui_flush_stats_t;
+
+/**
+ * 读取并清零计数，未接管时全为 0
+ */
+void ui_flush_get_stats(ui_flush_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_FLUSH_H
@@ -0,0 +1,77 @@
+#ifndef UI_GLYPH_H
+#define UI_GLYPH_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+#include "lvgl.h"
+#include "ui_cache.h"
+
+/*
+ * 字形缓存（CONFIG_UI_GLYPH_CACHE）：LVGL 每次重绘文字都重新解压 / 展开字形位图，
+ * 每秒刷新的时钟、状态文字反复解同一批字形。这里把展开后的 A8 位图放进 PSRAM 中的 lv_cache
+ * （LRU，按字节计，预算 CONFIG_UI_GLYPH_CACHE_KB），键为字体和字形序号。
+ *
+ * 颜色不参与键：LVGL 的字形位图只是 A8 遮罩，颜色在混合时才加上，同一字形不同颜色共用一份。
+ * 只缓存 lv_font_fmt_txt 字体（内置字体和 ui_asset_font() 加载的 bin 字体），其他字体原样返回。
+ *
+ * 用法：
+ *   lv_obj_set_style_text_font(label, ui_glyph_font(&lv_font_montserrat_24), 0);
+ *
+ * 固定不变的字符串可由 tools/text_atlas.py 预渲染成 A8 图片打进资源分区，用 ui_glyph_text()
+ * 取出当作图片绘制，完全不经过字形解码；颜色由 image_recolor 样式给出：
+ *   lv_obj_t *img = lv_image_create(parent);
+ *   lv_image_set_src(img, ui_glyph_text("s24", "Door open"));
+ *   lv_obj_set_style_image_recolor(img, lv_color_white(), 0);
+ *   lv_obj_set_style_image_recolor_opa(img, LV_OPA_COVER, 0);
+ */
+
+#define UI_GLYPH_FONTS_MAX      8       // 可同时缓存的字体数
+#define UI_GLYPH_PREFIX_LEN     14      // ui_glyph_text() 前缀最长字符数，资源名为 <前缀>_<8 位哈希>
+
+#if CONFIG_UI_GLYPH_CACHE
+
+/**
+ * 创建字形缓存
+ * @note  在 lv_init() / lvgl_port_init() 之后、持有 LVGL 锁时调用
+ */
+esp_err_t ui_glyph_init(void);
+
+/**
+ * 取带缓存的字体：返回字体的 RAM 副本，取字形位图时先查缓存；同一字体重复调用返回同一副本
+ * @note  持有 LVGL 锁时调用。未初始化、不是 fmt_txt 字体或副本已满时返回原字体
+ */
+const lv_font_t *ui_glyph_font(const lv_font_t *font);
+
+/**
+ * 取统计，size / max_size 单位为字节；evictions 为按 LRU 淘汰的字形数
+ * @param reset  取完后清零计数
+ */
+esp_err_t ui_glyph_get_stats(ui_cache_stats_t *stats, bool reset);
+
+#else
+
+static inline esp_err_t ui_glyph_init(void) { return ESP_ERR_NOT_SUPPORTED; }
+static inline const lv_font_t *ui_glyph_font(const lv_font_t *font) { return font; }
+static inline esp_err_t ui_glyph_get_stats(ui_cache_stats_t *stats, bool reset) { return ESP_ERR_NOT_SUPPORTED; }
+
+#endif // CONFIG_UI_GLYPH_CACHE
+
+#if CONFIG_UI_ASSET
+/**
+ * 取 tools/text_atlas.py 预渲染的字符串（A8 图片，数据在 flash 映射中）
+ * @param prefix  渲染时的 --prefix，对应一种字体和字号
+ * @return 没有该字符串时返回 NULL，调用方改用 label 绘制
+ */
+const lv_image_dsc_t *ui_glyph_text(const char *prefix, const char *text);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_GLYPH_H
@@ -0,0 +1,54 @@
+#ifndef UI_PIXEL_H
+#define UI_PIXEL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/*
+ * RGB565 送屏前的像素变换，不依赖 LVGL，主机测试直接编译（test_apps/host_test）。
+ *
+ * 旋转与字节交换在同一遍内完成：每次读源相邻两行的各两个像素（两个 32 位字），
+ * 拼成目标的两个 32 位字写出，交换字节在拼字时顺带做，不再单独扫一遍缓冲。
+ * 地址不是 4 字节对齐、步长为奇数像素，或 180° 时宽为奇数，退回逐像素的写法。
+ *
+ * CONFIG_UI_BLEND_SIMD 时旋转改用 PIE 内核（simd/ui_rotate_rgb565_esp32s3.S）：90°/270° 按 8x8 块
+ * 转置，180° 一行 16 个像素倒序，交换字节同在寄存器内完成。要求源行距为 8 像素的整数倍、
+ * 目标 8 字节对齐且行距为 4 像素的整数倍；源左边不到 16 字节对齐的几列和凑不满一块的边缘走上面的字路径。
+ *
+ * 旋转方向与 lv_draw_sw_rotate() 一致（即 esp_lvgl_port 软件旋转的结果），
+ * 目标区域坐标用 lv_display_rotate_area() 换算。
+ */
+
+typedef enum {
+    UI_PIXEL_ROTATE_0 = 0,
+    UI_PIXEL_ROTATE_90,
+    UI_PIXEL_ROTATE_180,
+    UI_PIXEL_ROTATE_270,
+} ui_pixel_rotate_t;
+
+/**
+ * 原地交换每个像素的高低字节
+ */
+void ui_pixel_swap565(uint16_t *buf, size_t pixels);
+
+/**
+ * 旋转一块 RGB565 像素，可同时交换字节
+ * @param src, dst      源和目标，不能重叠
+ * @param w, h          源的宽高（像素），90°/270° 时目标为 h x w
+ * @param src_stride    源的行距（像素）
+ * @param dst_stride    目标的行距（像素）
+ * @param swap          是否交换字节
+ */
+void ui_pixel_rotate565(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                        int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_PIXEL_H
@@ -0,0 +1,46 @@
+#ifndef UI_PREVIEW_H
+#define UI_PREVIEW_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "lvgl.h"
+
+/*
+ * 摄像头实时预览控件（CONFIG_UI_PREVIEW）：把 img_preview 接到一个 lv_image 上。
+ *
+ * img_preview 订阅帧广播，MJPEG 在 DCT 域按 1/2^scale 缩小、只解码控件大小的居中区域，
+ * 直接写进 PSRAM 中的两块 RGB565 缓冲。这里把它们包装成 lv_draw_buf_t，每帧在 LVGL 锁内
+ * 换成图像源：lv_image_set_src() 只 invalidate 控件自身的区域，之后照常由显示的 flush 回调
+ * （esp_lvgl_port 的或 ui_flush 的）送屏，不多拷贝一遍。
+ *
+ * 解码输出为 LVGL 原生字节序，大端屏的字节交换仍由 flush 回调负责。
+ *
+ * 用法（持有 LVGL 锁时创建控件并确定大小，启动时不要持锁）：
+ *   lv_obj_t *img = lv_image_create(scr);
+ *   lv_obj_set_size(img, 320, 240);
+ *   ui_preview_start(img, IMG_PREVIEW_SCALE_AUTO);
+ */
+
+/**
+ * 开始在 img 上显示预览，解码区域为控件当前的大小
+ * @param scale  0~3 对应 1/1~1/8，或 IMG_PREVIEW_SCALE_AUTO
+ * @return ESP_ERR_INVALID_STATE 已在运行；其余见 img_preview_start()
+ * @note  只支持一个预览；控件在 ui_preview_stop() 之前不能删除
+ */
+esp_err_t ui_preview_start(lv_obj_t *img, uint8_t scale);
+
+/**
+ * 停止预览，控件清空图像源，释放解码缓冲
+ * @note  阻塞到预览任务退出，不能在持有 LVGL 锁时调用
+ */
+void ui_preview_stop(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_PREVIEW_H
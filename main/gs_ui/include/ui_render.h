@@ -0,0 +1,51 @@
+#ifndef UI_RENDER_H
+#define UI_RENDER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "esp_err.h"
+
+/*
+ * 双核并行渲染（CONFIG_UI_RENDER_DUAL_CORE）：LVGL 的软件绘制单元
+ * （LV_DRAW_SW_DRAW_UNIT_CNT >= 2，LV_OS_FREERTOS）各有一个绘制线程，LVGL 建线程时不绑核。
+ * 这里让 LVGL 按正常退出流程结束这些线程，再用同一个线程函数建绑核的任务：
+ * 第一个绘制单元与 LVGL 任务同核，其余放到另一个核，栈大小单独配置。
+ *
+ * 摄像头取帧期间 UVC 的处理任务占着另一个核，此时只用第一个绘制单元：
+ * 其余单元的派发回调直接返回空闲，不再接任务，正在画的任务照常画完。
+ *
+ * 效果用 test_apps/ui_bench 对比，见其中的 sdkconfig.dual_core。
+ */
+
+typedef struct {
+    uint32_t stack_size;    // 每个绘制线程的栈（字节）
+    int8_t main_core;       // 第一个绘制单元的核，与 LVGL 任务相同
+    int8_t second_core;     // 其余绘制单元的核
+} ui_render_config_t;
+
+/**
+ * 把绘制线程重建为绑核任务，默认开启并行
+ * @note  在 lvgl_port_init() / bsp_display_start() 之后、持有 LVGL 锁时调用，
+ *        此时没有正在进行的渲染；只能调用一次
+ */
+esp_err_t ui_render_init(const ui_render_config_t *config);
+
+/**
+ * 开关第二个及以后的绘制单元，可在任意任务中调用，不需要 LVGL 锁
+ */
+void ui_render_set_parallel(bool enable);
+
+/**
+ * 当前参与渲染的绘制单元数，未初始化时为 LVGL 配置的单元数
+ */
+uint32_t ui_render_active_units(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_RENDER_H
@@ -0,0 +1,189 @@
+// ui_asset.c
+// 界面资源：资源分区整体 mmap，图片描述直接指向 flash，压缩图片交给 LVGL 解压进图片缓存
+#include "sdkconfig.h"
+
+#if CONFIG_UI_ASSET
+
+#include "ui_asset.h"
+#include "checksum.h"
+#include "esp_log.h"
+#include "esp_partition.h"
+#include "string.h"
+#include <stdlib.h>
+#include <inttypes.h>
+
+static const char *TAG = "ui_asset";
+
+static const uint8_t *s_base = NULL;                // 分区映射起始
+static const ui_asset_entry_t *s_table = NULL;      // 指向映射内的索引表
+static uint16_t s_count = 0;
+static lv_image_dsc_t *s_images = NULL;             // 与索引表一一对应，非图片项 data 为 NULL
+static esp_partition_mmap_handle_t s_mmap;
+
+static const ui_asset_entry_t *asset_find(const char *name, uint16_t *index)
+{
+    if (!s_table || !name) {
+        return NULL;
+    }
+    int lo = 0;
+    int hi = (int)s_count - 1;
+    while (lo <= hi) {
+        int mid = (lo + hi) / 2;
+        int cmp = strncmp(name, s_table[mid].name, UI_ASSET_NAME_LEN);
+        if (cmp == 0) {
+            if (index) {
+                *index = mid;
+            }
+            return &s_table[mid];
+        }
+        if (cmp < 0) {
+            hi = mid - 1;
+        } else {
+            lo = mid + 1;
+        }
+    }
+    return NULL;
+}
+
+// 图片项：flash 中是 lv_image_header_t + 数据，描述只复制 12 字节头，数据仍指向 flash
+static bool asset_image_setup(const ui_asset_entry_t *entry, lv_image_dsc_t *dsc)
+{
+    if (entry->size <= sizeof(lv_image_header_t)) {
+        return false;
+    }
+    const uint8_t *raw = s_base + entry->offset;
+    memcpy(&dsc->header, raw, sizeof(lv_image_header_t));
+    if (dsc->header.magic != LV_IMAGE_HEADER_MAGIC || dsc->header.w == 0 || dsc->header.h == 0) {
+        return false;
+    }
+    // 数据在只读 flash 上，不能交给 LVGL 释放或原地修改
+    dsc->header.flags &= ~(LV_IMAGE_FLAGS_ALLOCATED | LV_IMAGE_FLAGS_MODIFIABLE);
+    dsc->data = raw + sizeof(lv_image_header_t);
+    dsc->data_size = entry->size - sizeof(lv_image_header_t);
+    if (!(dsc->header.flags & LV_IMAGE_FLAGS_COMPRESSED) &&
+        dsc->header.stride && dsc->data_size < (uint32_t)dsc->header.stride * dsc->header.h) {
+        return false;
+    }
+    return true;
+}
+
+esp_err_t ui_asset_init(void)
+{
+    if (s_base) {
+        return ESP_OK;
+    }
+
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           CONFIG_UI_ASSET_PARTITION);
+    if (!part) {
+        ESP_LOGE(TAG, "partition '%s' not found", CONFIG_UI_ASSET_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+
+    // 先读头确定映射长度，只映射实际用到的部分，省 MMU 页
+    ui_asset_part_header_t header;
+    esp_err_t ret = esp_partition_read(part, 0, &header, sizeof(header));
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    size_t table_end = sizeof(header) + (size_t)header.count * sizeof(ui_asset_entry_t);
+    if (header.magic != UI_ASSET_MAGIC || header.version != UI_ASSET_VERSION ||
+        header.total_size < table_end || header.total_size > part->size) {
+        ESP_LOGE(TAG, "bad partition header (magic 0x%08" PRIx32 ", version %u)", header.magic, header.version);
+        return ESP_ERR_INVALID_VERSION;
+    }
+
+    const void *ptr = NULL;
+    ret = esp_partition_mmap(part, 0, header.total_size, ESP_PARTITION_MMAP_DATA, &ptr, &s_mmap);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "mmap failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    const uint8_t *base = ptr;
+    const ui_asset_entry_t *table = (const ui_asset_entry_t *)(base + sizeof(header));
+
+    if (checksum_crc16((const uint8_t *)table, table_end - sizeof(header)) != header.table_crc) {
+        ESP_LOGE(TAG, "index crc mismatch");
+        ret = ESP_ERR_INVALID_CRC;
+        goto fail;
+    }
+    for (uint16_t i = 0; i < header.count; i++) {
+        const ui_asset_entry_t *e = &table[i];
+        if (memchr(e->name, '\0', UI_ASSET_NAME_LEN) == NULL ||
+            e->offset < table_end || e->size > header.total_size - e->offset) {
+            ESP_LOGE(TAG, "bad index entry %u", i);
+            ret = ESP_ERR_INVALID_SIZE;
+            goto fail;
+        }
+    }
+
+    s_images = calloc(header.count ? header.count : 1, sizeof(lv_image_dsc_t));
+    if (!s_images) {
+        ret = ESP_ERR_NO_MEM;
+        goto fail;
+    }
+    s_base = base;
+    s_table = table;
+    s_count = header.count;
+
+    uint16_t images = 0;
+    for (uint16_t i = 0; i < s_count; i++) {
+        if (s_table[i].type != UI_ASSET_TYPE_IMAGE) {
+            continue;
+        }
+        if (asset_image_setup(&s_table[i], &s_images[i])) {
+            images++;
+        } else {
+            memset(&s_images[i], 0, sizeof(lv_image_dsc_t));
+            ESP_LOGW(TAG, "skip invalid image '%s'", s_table[i].name);
+        }
+    }
+
+    // 未压缩图片不进缓存，预算只给解压后的图片
+    lv_image_cache_resize(CONFIG_UI_ASSET_CACHE_KB * 1024, true);
+
+    ESP_LOGI(TAG, "%u assets (%u images), %" PRIu32 " bytes mapped, image cache %d KB",
+             s_count, images, header.total_size, CONFIG_UI_ASSET_CACHE_KB);
+    return ESP_OK;
+
+fail:
+    esp_partition_munmap(s_mmap);
+    return ret;
+}
+
+const lv_image_dsc_t *ui_asset_image(const char *name)
+{
+    uint16_t index;
+    if (!asset_find(name, &index) || !s_images[index].data) {
+        return NULL;
+    }
+    return &s_images[index];
+}
+
+esp_err_t ui_asset_get(const char *name, const void **data, size_t *size)
+{
+    if (!data || !size) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    const ui_asset_entry_t *entry = asset_find(name, NULL);
+    if (!entry) {
+        return ESP_ERR_NOT_FOUND;
+    }
+    *data = s_base + entry->offset;
+    *size = entry->size;
+    return ESP_OK;
+}
+
+#if LV_USE_FS_MEMFS
+lv_font_t *ui_asset_font(const char *name)
+{
+    const ui_asset_entry_t *entry = asset_find(name, NULL);
+    if (!entry || entry->type != UI_ASSET_TYPE_FONT) {
+        return NULL;
+    }
+    // 加载器只读缓冲
+    return lv_binfont_create_from_buffer((void *)(s_base + entry->offset), entry->size);
+}
+#endif
+
+#endif // CONFIG_UI_ASSET
@@ -0,0 +1,151 @@
+// ui_blend.c
+// LVGL 软件渲染钩子：RGB565 图像混合、纯色填充和字节交换交给 ESP32-S3 PIE 内核
+#include "sdkconfig.h"
+
+#if CONFIG_UI_BLEND_SIMD
+
+#include <stdbool.h>
+#include <stdint.h>
+#include "lvgl.h"
+#include "src/draw/sw/blend/lv_draw_sw_blend_private.h"
+#include "ui_blend.h"
+#include "ui_pixel.h"
+
+// 比这更窄的区域对齐和分段的开销不划算，交还给 LVGL
+#define UI_BLEND_MIN_W      16
+// 遮罩换算出的 m 按段展开到栈上，段长为 8 的倍数
+#define UI_BLEND_CHUNK      128
+
+// simd/ui_blend_rgb565_esp32s3.S
+void ui_blend565_copy_esp32s3(uint16_t *dst, const uint16_t *src, uint32_t n8);
+void ui_blend565_mix_esp32s3(uint16_t *dst, const uint16_t *src, const uint16_t *mix,
+                             uint32_t n8, uint32_t mix_step);
+
+// esp_lvgl_port 的填充内核（src/lvgl9/simd/lv_color_blend_to_*_esp32s3.S），
+// 描述符与端口头文件里的 asm_dsc_t 布局相同
+typedef struct {
+    uint32_t opa;
+    void *dst_buf;
+    uint32_t dst_w;
+    uint32_t dst_h;
+    uint32_t dst_stride;
+    const void *src_buf;
+    uint32_t src_stride;
+    const lv_opa_t *mask_buf;
+    uint32_t mask_stride;
+} port_asm_dsc_t;
+
+int lv_color_blend_to_rgb565_esp(port_asm_dsc_t *asm_dsc);
+int lv_color_blend_to_argb8888_esp(port_asm_dsc_t *asm_dsc);
+
+lv_result_t ui_blend_fill_rgb565(lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    port_asm_dsc_t asm_dsc = {
+        .dst_buf = dsc->dest_buf,
+        .dst_w = dsc->dest_w,
+        .dst_h = dsc->dest_h,
+        .dst_stride = dsc->dest_stride,
+        .src_buf = &dsc->color,
+    };
+    return lv_color_blend_to_rgb565_esp(&asm_dsc);
+}
+
+lv_result_t ui_blend_fill_argb8888(lv_draw_sw_blend_fill_dsc_t *dsc)
+{
+    port_asm_dsc_t asm_dsc = {
+        .dst_buf = dsc->dest_buf,
+        .dst_w = dsc->dest_w,
+        .dst_h = dsc->dest_h,
+        .dst_stride = dsc->dest_stride,
+        .src_buf = &dsc->color,
+    };
+    return lv_color_blend_to_argb8888_esp(&asm_dsc);
+}
+
+// 与 LVGL 的 C 实现取同样的混合量：有遮罩时遮罩值，再有透明度时两者相乘
+static inline lv_opa_t px_mix(const lv_opa_t *mask, lv_opa_t opa, int32_t x)
+{
+    if (!mask) {
+        return opa;
+    }
+    return opa >= LV_OPA_MAX ? mask[x] : LV_OPA_MIX2(mask[x], opa);
+}
+
+static inline void blend_px(uint16_t *dst, const uint16_t *src, const lv_opa_t *mask,
+                            lv_opa_t opa, int32_t x)
+{
+    if (!mask && opa >= LV_OPA_MAX) {
+        dst[x] = src[x];
+    } else {
+        dst[x] = lv_color_16_16_mix(src[x], dst[x], px_mix(mask, opa, x));
+    }
+}
+
+// 一行：逐像素写到目标 16 字节对齐，中间 8 像素一组交给内核，剩下不足 8 个的逐像素补完
+static void blend_row(uint16_t *dst, const uint16_t *src, const lv_opa_t *mask, lv_opa_t opa,
+                      int32_t w, uint16_t *mix)
+{
+    int32_t head = (int32_t)((16 - ((uintptr_t)dst & 15)) & 15) / 2;
+    int32_t x = 0;
+
+    for (; x < head; x++) {
+        blend_px(dst, src, mask, opa, x);
+    }
+    uint32_t n8 = (uint32_t)(w - head) / 8;
+    if (!mask && opa >= LV_OPA_MAX) {
+        ui_blend565_copy_esp32s3(dst + x, src + x, n8);
+        x += n8 * 8;
+    } else if (!mask) {
+        // 固定透明度：8 个相同的 m，内核不前进 mix 指针
+        for (int i = 0; i < 8; i++) {
+            mix[i] = (uint16_t)((opa + 4) >> 3);
+        }
+        ui_blend565_mix_esp32s3(dst + x, src + x, mix, n8, 0);
+        x += n8 * 8;
+    } else {
+        while (n8) {
+            uint32_t n = n8 < UI_BLEND_CHUNK / 8 ? n8 : UI_BLEND_CHUNK / 8;
+            for (uint32_t i = 0; i < n * 8; i++) {
+                mix[i] = (uint16_t)((px_mix(mask, opa, x + i) + 4) >> 3);
+            }
+            ui_blend565_mix_esp32s3(dst + x, src + x, mix, n, 16);
+            x += n * 8;
+            n8 -= n;
+        }
+    }
+    for (; x < w; x++) {
+        blend_px(dst, src, mask, opa, x);
+    }
+}
+
+lv_result_t ui_blend_image_rgb565(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    int32_t w = dsc->dest_w;
+    if (w < UI_BLEND_MIN_W || dsc->blend_mode != LV_BLEND_MODE_NORMAL ||
+        (((uintptr_t)dsc->dest_buf | (uintptr_t)dsc->src_buf | dsc->dest_stride | dsc->src_stride) & 1)) {
+        return LV_RESULT_INVALID;
+    }
+
+    uint16_t mix[UI_BLEND_CHUNK] __attribute__((aligned(16)));
+    uint8_t *dst = dsc->dest_buf;
+    const uint8_t *src = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        blend_row((uint16_t *)dst, (const uint16_t *)src, mask, dsc->opa, w, mix);
+        dst += dsc->dest_stride;
+        src += dsc->src_stride;
+        if (mask) {
+            mask += dsc->mask_stride;
+        }
+    }
+    return LV_RESULT_OK;
+}
+
+lv_result_t ui_blend_swap_rgb565(void *buf, uint32_t buf_size_px)
+{
+    ui_pixel_swap565(buf, buf_size_px);
+    return LV_RESULT_OK;
+}
+
+#endif // CONFIG_UI_BLEND_SIMD
@@ -0,0 +1,152 @@
+// ui_cache.c
+// LVGL 图片缓存 / 图片头缓存的命中、淘汰计数和运行时预算
+#include "sdkconfig.h"
+#include "ui_cache.h"
+
+#if CONFIG_UI_CACHE_STATS
+
+#include <string.h>
+#include "esp_log.h"
+#include "esp_lvgl_port.h"
+#include "lvgl.h"
+// 缓存类和全局缓存指针只在私有头中可见
+#include "src/core/lv_global.h"
+#include "src/misc/cache/lv_cache_private.h"
+
+static const char *TAG = "ui_cache";
+
+#define UI_CACHE_LOCK_MS    1000
+
+typedef struct {
+    lv_cache_t *cache;
+    lv_cache_class_t clz;               // 替换了两个回调的类副本
+    const lv_cache_class_t *orig;
+    volatile uint32_t hits;
+    volatile uint32_t misses;
+    volatile uint32_t evictions;
+    uint32_t base[3];                   // 上次清零时的三个计数，只由读取方修改
+} ui_cache_slot_t;
+
+static ui_cache_slot_t s_slots[UI_CACHE_MAX];
+
+static lv_cache_t *ui_cache_global(ui_cache_id_t id)
+{
+    return id == UI_CACHE_IMAGE ? LV_GLOBAL_DEFAULT()->img_cache : LV_GLOBAL_DEFAULT()->img_header_cache;
+}
+
+static ui_cache_slot_t *ui_cache_slot(lv_cache_t *cache)
+{
+    return s_slots[UI_CACHE_IMAGE].cache == cache ? &s_slots[UI_CACHE_IMAGE] : &s_slots[UI_CACHE_HEADER];
+}
+
+// 以下两个回调都在缓存自己的锁内调用，每个缓存的计数只有一个写者
+static lv_cache_entry_t *counted_get(lv_cache_t *cache, const void *key, void *user_data)
+{
+    ui_cache_slot_t *slot = ui_cache_slot(cache);
+    lv_cache_entry_t *entry = slot->orig->get_cb(cache, key, user_data);
+    if (entry) {
+        slot->hits++;
+    } else {
+        slot->misses++;
+    }
+    return entry;
+}
+
+// 选出的淘汰项随后一定被移除；条目都在使用中时返回 NULL，不算淘汰
+static lv_cache_entry_t *counted_victim(lv_cache_t *cache, void *user_data)
+{
+    ui_cache_slot_t *slot = ui_cache_slot(cache);
+    lv_cache_entry_t *victim = slot->orig->get_victim_cb(cache, user_data);
+    if (victim) {
+        slot->evictions++;
+    }
+    return victim;
+}
+
+esp_err_t ui_cache_init(void)
+{
+    for (int id = 0; id < UI_CACHE_MAX; id++) {
+        ui_cache_slot_t *slot = &s_slots[id];
+        lv_cache_t *cache = ui_cache_global(id);
+        if (!cache) {
+            ESP_LOGE(TAG, "LVGL not initialized");
+            return ESP_ERR_INVALID_STATE;
+        }
+        if (cache->clz == &slot->clz) {
+            continue;
+        }
+        slot->orig = cache->clz;
+        slot->clz = *cache->clz;
+        slot->clz.get_cb = counted_get;
+        slot->clz.get_victim_cb = counted_victim;
+        slot->cache = cache;
+        cache->clz = &slot->clz;
+    }
+    ESP_LOGI(TAG, "image cache %lu bytes, header cache %lu entries",
+             (unsigned long)lv_cache_get_max_size(s_slots[UI_CACHE_IMAGE].cache, NULL),
+             (unsigned long)lv_cache_get_max_size(s_slots[UI_CACHE_HEADER].cache, NULL));
+    return ESP_OK;
+}
+
+esp_err_t ui_cache_get_stats(ui_cache_id_t id, ui_cache_stats_t *stats, bool reset)
+{
+    if (id >= UI_CACHE_MAX || !stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    ui_cache_slot_t *slot = &s_slots[id];
+    if (!slot->cache) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // 在其他任务中读：单个 32 位值的读取是完整的，各值之间可能差一次查找。
+    // 清零不改计数本身（写者在 LVGL 任务中），只记下当前值作为基准
+    uint32_t now[3] = {slot->hits, slot->misses, slot->evictions};
+    stats->hits = now[0] - slot->base[0];
+    stats->misses = now[1] - slot->base[1];
+    stats->evictions = now[2] - slot->base[2];
+    stats->size = slot->cache->size;
+    stats->max_size = slot->cache->max_size;
+    if (reset) {
+        memcpy(slot->base, now, sizeof(now));
+    }
+    return ESP_OK;
+}
+
+esp_err_t ui_cache_set_budget(ui_cache_id_t id, uint32_t max_size)
+{
+    if (id >= UI_CACHE_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_slots[id].cache) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!lvgl_port_lock(UI_CACHE_LOCK_MS)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (id == UI_CACHE_IMAGE) {
+        lv_image_cache_resize(max_size, true);
+    } else {
+        lv_image_header_cache_resize(max_size, true);
+    }
+    lvgl_port_unlock();
+    ESP_LOGI(TAG, "%s cache budget %lu", id == UI_CACHE_IMAGE ? "image" : "header", (unsigned long)max_size);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t ui_cache_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t ui_cache_get_stats(ui_cache_id_t id, ui_cache_stats_t *stats, bool reset)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t ui_cache_set_budget(ui_cache_id_t id, uint32_t max_size)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_UI_CACHE_STATS
@@ -0,0 +1,219 @@
+// ui_flush.c
+// 送屏加速：软件旋转与 RGB565 字节交换一遍完成后直接交给 LCD 面板；
+// 可选补齐双缓冲、合并脏区、每帧对齐 TE
+#include "sdkconfig.h"
+
+#if CONFIG_UI_FLUSH_ACCEL
+
+#include <string.h>
+#include "ui_flush.h"
+#include "ui_pixel.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "esp_memory_utils.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "src/display/lv_display_private.h"
+#include "src/misc/lv_area_private.h"
+
+static const char *TAG = "ui_flush";
+
+#define UI_FLUSH_TE_WAIT_MS     50      // 约 3 个 60 Hz 帧；等不到 TE 时照常送屏，不因缺信号卡住界面
+
+typedef struct {
+    esp_lcd_panel_handle_t panel;
+    uint16_t *rot_buf;      // 旋转目标，DMA 直接从这里读
+    bool swap_bytes;
+    uint32_t merge_px;
+    SemaphoreHandle_t te_sem;
+    bool frame_start;       // 下一块是一帧的第一块
+    ui_flush_stats_t stats;
+} ui_flush_t;
+
+static ui_flush_t s_flush;
+static lv_display_t *s_disp = NULL;
+
+static void IRAM_ATTR ui_flush_te_isr(void *arg)
+{
+    BaseType_t woken = pdFALSE;
+    xSemaphoreGiveFromISR(s_flush.te_sem, &woken);
+    if (woken == pdTRUE) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+// 丢掉渲染期间的旧信号，等下一次消隐开始
+static void ui_flush_wait_te(void)
+{
+    xSemaphoreTake(s_flush.te_sem, 0);
+    if (xSemaphoreTake(s_flush.te_sem, pdMS_TO_TICKS(UI_FLUSH_TE_WAIT_MS)) == pdTRUE) {
+        s_flush.stats.te_waits++;
+    } else {
+        s_flush.stats.te_timeouts++;
+    }
+}
+
+// 端口的刷新流程：LVGL 在上一块 flush_ready 之前不会再调用 flush，旋转缓冲不会被覆盖
+static void ui_flush_cb(lv_display_t *disp, const lv_area_t *area, uint8_t *px_map)
+{
+    lv_area_t a = *area;
+    int32_t w = lv_area_get_width(&a);
+    int32_t h = lv_area_get_height(&a);
+    int32_t stride = lv_draw_buf_width_to_stride(w, LV_COLOR_FORMAT_RGB565) / sizeof(uint16_t);
+    lv_display_rotation_t rotation = lv_display_get_rotation(disp);
+
+    if (s_flush.rot_buf && rotation != LV_DISPLAY_ROTATION_0) {
+        int32_t dst_stride = rotation == LV_DISPLAY_ROTATION_180 ? w : h;
+        ui_pixel_rotate565((const uint16_t *)px_map, s_flush.rot_buf, w, h, stride, dst_stride,
+                           (ui_pixel_rotate_t)rotation, s_flush.swap_bytes);
+        lv_display_rotate_area(disp, &a);
+        px_map = (uint8_t *)s_flush.rot_buf;
+    } else if (s_flush.swap_bytes) {
+        if (stride == w) {
+            ui_pixel_swap565((uint16_t *)px_map, (size_t)w * h);
+        } else {
+            for (int32_t y = 0; y < h; y++) {
+                ui_pixel_swap565((uint16_t *)px_map + y * stride, w);
+            }
+        }
+    }
+    if (s_flush.te_sem && s_flush.frame_start) {
+        ui_flush_wait_te();
+    }
+    s_flush.frame_start = lv_display_flush_is_last(disp);
+    s_flush.stats.flushes++;
+    esp_lcd_panel_draw_bitmap(s_flush.panel, a.x1, a.y1, a.x2 + 1, a.y2 + 1, px_map);
+}
+
+// 新脏区与已有的一块合成外接矩形后多画的像素不超过 merge_px 时，直接扩大已有的那块，
+// 再把事件参数改成同一矩形：LVGL 发现它已被已有脏区包含，就不再另存一块
+static void ui_flush_invalidate_cb(lv_event_t *e)
+{
+    lv_area_t *area = lv_event_get_param(e);
+
+    for (uint32_t i = 0; i < s_disp->inv_p; i++) {
+        lv_area_t *inv = &s_disp->inv_areas[i];
+        lv_area_t joined;
+        lv_area_join(&joined, inv, area);
+        int64_t extra = (int64_t)lv_area_get_size(&joined) - lv_area_get_size(inv) - lv_area_get_size(area);
+        if (extra <= (int64_t)s_flush.merge_px) {
+            *inv = joined;
+            *area = joined;
+            s_flush.stats.merged++;
+            return;
+        }
+    }
+}
+
+// 端口只分配了一个局部缓冲时补第二个；DMA 只能读内部 RAM，端口的缓冲不在那里就两个都重新分配
+static esp_err_t ui_flush_double_buffer(lv_display_t *disp)
+{
+    if (lv_display_is_double_buffered(disp) || disp->render_mode != LV_DISPLAY_RENDER_MODE_PARTIAL) {
+        return ESP_OK;
+    }
+    lv_draw_buf_t *buf1 = disp->buf_1;
+    uint32_t size = buf1->data_size;
+    uint32_t caps = MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL;
+    void *data1 = buf1->data;
+    void *data2 = heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, caps);
+    if (!data2) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!esp_ptr_dma_capable(data1)) {
+        data1 = heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, size, caps);
+        if (!data1) {
+            heap_caps_free(data2);
+            return ESP_ERR_NO_MEM;
+        }
+        ESP_LOGW(TAG, "port draw buffer is not DMA capable, both buffers re-allocated");
+    }
+    lv_display_set_buffers(disp, data1, data2, size, LV_DISPLAY_RENDER_MODE_PARTIAL);
+    ESP_LOGI(TAG, "double buffered, 2 x %lu bytes", (unsigned long)size);
+    return ESP_OK;
+}
+
+static esp_err_t ui_flush_te_init(gpio_num_t te_gpio)
+{
+    s_flush.te_sem = xSemaphoreCreateBinary();
+    if (!s_flush.te_sem) {
+        return ESP_ERR_NO_MEM;
+    }
+    const gpio_config_t io = {
+        .pin_bit_mask = 1ULL << te_gpio,
+        .mode = GPIO_MODE_INPUT,
+        .intr_type = GPIO_INTR_POSEDGE,
+    };
+    esp_err_t ret = gpio_config(&io);
+    if (ret == ESP_OK) {
+        // 其他模块可能已经装过 ISR 服务
+        ret = gpio_install_isr_service(0);
+        if (ret == ESP_ERR_INVALID_STATE) {
+            ret = ESP_OK;
+        }
+    }
+    if (ret == ESP_OK) {
+        ret = gpio_isr_handler_add(te_gpio, ui_flush_te_isr, NULL);
+    }
+    if (ret != ESP_OK) {
+        vSemaphoreDelete(s_flush.te_sem);
+        s_flush.te_sem = NULL;
+    }
+    return ret;
+}
+
+esp_err_t ui_flush_attach(lv_display_t *disp, const ui_flush_config_t *config)
+{
+    if (!disp || !config || !config->panel) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_disp) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (lv_display_get_color_format(disp) != LV_COLOR_FORMAT_RGB565) {
+        ESP_LOGE(TAG, "only RGB565 displays are supported");
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    if (config->double_buffer) {
+        esp_err_t ret = ui_flush_double_buffer(disp);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+    if (config->sw_rotate) {
+        // 与端口自己的旋转缓冲一样放在可 DMA 的内部 RAM；16 字节对齐，ui_pixel_rotate565() 可走 PIE 路径
+        s_flush.rot_buf = heap_caps_aligned_alloc(16, config->buffer_size * sizeof(uint16_t),
+                                                  MALLOC_CAP_DMA | MALLOC_CAP_INTERNAL);
+        if (!s_flush.rot_buf) {
+            return ESP_ERR_NO_MEM;
+        }
+    }
+    if (config->te_sync) {
+        esp_err_t ret = ui_flush_te_init(config->te_gpio);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "TE gpio %d: %s", config->te_gpio, esp_err_to_name(ret));
+            heap_caps_free(s_flush.rot_buf);
+            s_flush.rot_buf = NULL;
+            return ret;
+        }
+    }
+    s_flush.panel = config->panel;
+    s_flush.swap_bytes = config->swap_bytes;
+    s_flush.merge_px = config->merge_px;
+    s_flush.frame_start = true;
+    s_disp = disp;
+    lv_display_set_flush_cb(disp, ui_flush_cb);
+    if (config->merge_px) {
+        lv_display_add_event_cb(disp, ui_flush_invalidate_cb, LV_EVENT_INVALIDATE_AREA, NULL);
+    }
+    ESP_LOGI(TAG, "flush attached, swap %d, sw rotate %d, merge %lu px, te %d", config->swap_bytes,
+             config->sw_rotate, (unsigned long)config->merge_px, config->te_sync ? config->te_gpio : -1);
+    return ESP_OK;
+}
+
+void ui_flush_get_stats(ui_flush_stats_t *stats)
+{
+    *stats = s_flush.stats;
+    memset(&s_flush.stats, 0, sizeof(s_flush.stats));
+}
+
+#endif // CONFIG_UI_FLUSH_ACCEL
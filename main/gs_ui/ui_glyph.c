@@ -0,0 +1,227 @@
+// ui_glyph.c
+// 展开后的字形位图缓存在 PSRAM，预渲染字符串从资源分区取
+#include "sdkconfig.h"
+#include "ui_glyph.h"
+
+#include <stdio.h>
+#include <string.h>
+#include "esp_log.h"
+
+#if CONFIG_UI_GLYPH_CACHE || CONFIG_UI_ASSET
+static const char *TAG = "ui_glyph";
+#endif
+
+#if CONFIG_UI_GLYPH_CACHE
+
+#include "esp_heap_caps.h"
+// lv_cache_slot_size_t 只在私有头中可见
+#include "src/misc/cache/lv_cache_private.h"
+
+typedef struct {
+    lv_font_t font;                     // 副本，须为第一个成员：绘制时 resolved_font 指向这里
+    const lv_font_t *orig;
+} ui_glyph_font_t;
+
+// 缓存节点，同时作为查找的键
+typedef struct {
+    lv_cache_slot_size_t slot;          // 须为第一个成员，size 为位图字节数
+    const lv_font_t *font;              // 副本的地址
+    uint32_t gid;
+    lv_draw_buf_t *buf;                 // 与位图同一块 PSRAM
+} ui_glyph_node_t;
+
+static lv_cache_t *s_cache = NULL;
+static ui_glyph_font_t s_fonts[UI_GLYPH_FONTS_MAX];
+static uint32_t s_font_num = 0;
+
+// 取得缓存项和未经缓存的次数在各绘制单元的线程中累加；新建和淘汰在缓存的锁内计数
+static volatile uint32_t s_acquired = 0;
+static volatile uint32_t s_uncached = 0;
+static volatile uint32_t s_created = 0;
+static volatile uint32_t s_evictions = 0;
+static uint32_t s_base[4];              // 上次清零时的各计数，只由读取方修改
+
+static lv_cache_compare_res_t glyph_compare_cb(const ui_glyph_node_t *a, const ui_glyph_node_t *b)
+{
+    if (a->font != b->font) {
+        return a->font > b->font ? 1 : -1;
+    }
+    if (a->gid != b->gid) {
+        return a->gid > b->gid ? 1 : -1;
+    }
+    return 0;
+}
+
+// 在缓存的锁内调用：节点已从键复制过来，把字形展开进新分配的 A8 缓冲
+static bool glyph_create_cb(ui_glyph_node_t *node, void *user_data)
+{
+    lv_font_glyph_dsc_t *g = user_data;
+    const ui_glyph_font_t *f = (const ui_glyph_font_t *)node->font;
+    uint32_t stride = lv_draw_buf_width_to_stride(g->box_w, LV_COLOR_FORMAT_A8);
+    size_t head = LV_ALIGN_UP(sizeof(lv_draw_buf_t), LV_DRAW_BUF_ALIGN);
+
+    uint8_t *mem = heap_caps_aligned_alloc(LV_DRAW_BUF_ALIGN, head + node->slot.size,
+                                           MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!mem) {
+        return false;
+    }
+    lv_draw_buf_t *buf = (lv_draw_buf_t *)mem;
+    memset(buf, 0, sizeof(*buf));
+    if (lv_draw_buf_init(buf, g->box_w, g->box_h, LV_COLOR_FORMAT_A8, stride, mem + head,
+                         node->slot.size) != LV_RESULT_OK
+        || f->orig->get_glyph_bitmap(g, buf) != buf) {
+        heap_caps_free(mem);
+        return false;
+    }
+    node->buf = buf;
+    s_created++;
+    return true;
+}
+
+static void glyph_free_cb(ui_glyph_node_t *node, void *user_data)
+{
+    heap_caps_free(node->buf);
+    node->buf = NULL;
+    s_evictions++;
+}
+
+static bool cached_glyph_dsc(const lv_font_t *font, lv_font_glyph_dsc_t *g, uint32_t letter, uint32_t letter_next)
+{
+    const ui_glyph_font_t *f = (const ui_glyph_font_t *)font;
+    g->entry = NULL;
+    return f->orig->get_glyph_dsc(font, g, letter, letter_next);
+}
+
+static const void *cached_glyph_bitmap(lv_font_glyph_dsc_t *g, lv_draw_buf_t *draw_buf)
+{
+    const ui_glyph_font_t *f = (const ui_glyph_font_t *)g->resolved_font;
+    if (g->format <= LV_FONT_GLYPH_FORMAT_NONE || g->format > LV_FONT_GLYPH_FORMAT_A8) {
+        return f->orig->get_glyph_bitmap(g, draw_buf);
+    }
+
+    ui_glyph_node_t key = {
+        .slot.size = lv_draw_buf_width_to_stride(g->box_w, LV_COLOR_FORMAT_A8) * g->box_h,
+        .font = g->resolved_font,
+        .gid = g->gid.index,
+    };
+    lv_cache_entry_t *entry = lv_cache_acquire_or_create(s_cache, &key, g);
+    if (!entry) {
+        // 预算为 0、单个字形超出预算或 PSRAM 不足：照常展开到 LVGL 的临时缓冲
+        __atomic_fetch_add(&s_uncached, 1, __ATOMIC_RELAXED);
+        return f->orig->get_glyph_bitmap(g, draw_buf);
+    }
+    __atomic_fetch_add(&s_acquired, 1, __ATOMIC_RELAXED);
+    g->entry = entry;
+    return ((ui_glyph_node_t *)lv_cache_entry_get_data(entry))->buf;
+}
+
+// 绘制完一个字形后调用，放开对缓存项的引用，之后才可能被淘汰
+static void cached_glyph_release(const lv_font_t *font, lv_font_glyph_dsc_t *g)
+{
+    if (g->entry) {
+        lv_cache_release(s_cache, g->entry, NULL);
+        g->entry = NULL;
+    }
+}
+
+esp_err_t ui_glyph_init(void)
+{
+    if (s_cache) {
+        return ESP_OK;
+    }
+    lv_cache_ops_t ops = {
+        .compare_cb = (lv_cache_compare_cb_t)glyph_compare_cb,
+        .create_cb = (lv_cache_create_cb_t)glyph_create_cb,
+        .free_cb = (lv_cache_free_cb_t)glyph_free_cb,
+    };
+    s_cache = lv_cache_create(&lv_cache_class_lru_rb_size, sizeof(ui_glyph_node_t),
+                              CONFIG_UI_GLYPH_CACHE_KB * 1024, ops);
+    if (!s_cache) {
+        ESP_LOGE(TAG, "Failed to create glyph cache");
+        return ESP_ERR_NO_MEM;
+    }
+    lv_cache_set_name(s_cache, "GLYPH");
+    ESP_LOGI(TAG, "glyph cache %d KB", CONFIG_UI_GLYPH_CACHE_KB);
+    return ESP_OK;
+}
+
+const lv_font_t *ui_glyph_font(const lv_font_t *font)
+{
+    // tiny_ttf / FreeType 字体自己用 g->entry 管理缓存，不能再包一层
+    if (!s_cache || !font || font->get_glyph_bitmap != lv_font_get_bitmap_fmt_txt) {
+        return font;
+    }
+    for (uint32_t i = 0; i < s_font_num; i++) {
+        if (s_fonts[i].orig == font) {
+            return &s_fonts[i].font;
+        }
+    }
+    if (s_font_num >= UI_GLYPH_FONTS_MAX) {
+        ESP_LOGW(TAG, "Too many cached fonts, %p not cached", font);
+        return font;
+    }
+    ui_glyph_font_t *f = &s_fonts[s_font_num++];
+    f->font = *font;
+    f->orig = font;
+    f->font.get_glyph_dsc = cached_glyph_dsc;
+    f->font.get_glyph_bitmap = cached_glyph_bitmap;
+    f->font.release_glyph = cached_glyph_release;
+    return &f->font;
+}
+
+esp_err_t ui_glyph_get_stats(ui_cache_stats_t *stats, bool reset)
+{
+    if (!stats) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_cache) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // 与 ui_cache 相同：各值之间可能差一次查找，清零只记基准
+    // 未命中含新建的和没能缓存的，命中为取得的缓存项中不是新建的
+    uint32_t now[4] = {s_acquired, s_created, s_uncached, s_evictions};
+    uint32_t acquired = now[0] - s_base[0];
+    uint32_t created = now[1] - s_base[1];
+    stats->hits = acquired > created ? acquired - created : 0;
+    stats->misses = created + now[2] - s_base[2];
+    stats->evictions = now[3] - s_base[3];
+    stats->size = lv_cache_get_size(s_cache, NULL);
+    stats->max_size = lv_cache_get_max_size(s_cache, NULL);
+    if (reset) {
+        memcpy(s_base, now, sizeof(now));
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_UI_GLYPH_CACHE
+
+#if CONFIG_UI_ASSET
+
+#include "ui_asset.h"
+
+// 与 tools/text_atlas.py 的资源命名一致
+static uint32_t text_hash(const char *text)
+{
+    uint32_t h = 2166136261u;
+    for (const uint8_t *p = (const uint8_t *)text; *p; p++) {
+        h = (h ^ *p) * 16777619u;
+    }
+    return h;
+}
+
+const lv_image_dsc_t *ui_glyph_text(const char *prefix, const char *text)
+{
+    if (!prefix || !text || strlen(prefix) > UI_GLYPH_PREFIX_LEN) {
+        return NULL;
+    }
+    char name[UI_ASSET_NAME_LEN];
+    snprintf(name, sizeof(name), "%s_%08lx", prefix, (unsigned long)text_hash(text));
+    const lv_image_dsc_t *dsc = ui_asset_image(name);
+    if (dsc && dsc->header.cf != LV_COLOR_FORMAT_A8) {
+        ESP_LOGW(TAG, "%s is not an A8 text image", name);
+        return NULL;
+    }
+    return dsc;
+}
+
+#endif // CONFIG_UI_ASSET
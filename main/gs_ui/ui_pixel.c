@@ -0,0 +1,332 @@
+// ui_pixel.c
+// RGB565 旋转与字节交换：两像素一个 32 位字读写，交换字节与旋转合在一遍
+#include "sdkconfig.h"
+#include "ui_pixel.h"
+#include <string.h>
+
+#if CONFIG_UI_BLEND_SIMD
+// simd/ui_blend_rgb565_esp32s3.S：16 字节对齐的 buf，一组 8 像素
+void ui_blend565_swap_esp32s3(uint16_t *buf, uint32_t n8);
+// simd/ui_rotate_rgb565_esp32s3.S：步长以字节计，可为负
+void ui_rotate565_t8_esp32s3(const uint16_t *src, int32_t src_step, uint16_t *dst, int32_t dst_step,
+                             uint32_t n8, uint32_t swap);
+void ui_rotate565_rev_esp32s3(const uint16_t *src, uint16_t *dst_end, uint32_t n16, uint32_t swap);
+#endif
+
+// 一个字里的两个像素各自交换高低字节
+#define SWAP2(v)    ((((v) & 0x00FF00FFu) << 8) | (((v) >> 8) & 0x00FF00FFu))
+
+static inline uint16_t swap1(uint16_t v, bool swap)
+{
+    return swap ? (uint16_t)((v >> 8) | (v << 8)) : v;
+}
+
+static inline uint32_t swap2(uint32_t v, bool swap)
+{
+    return swap ? SWAP2(v) : v;
+}
+
+static inline bool aligned4(const void *p)
+{
+    return ((uintptr_t)p & 3) == 0;
+}
+
+void ui_pixel_swap565(uint16_t *buf, size_t pixels)
+{
+#if CONFIG_UI_BLEND_SIMD
+    // 逐像素交换到 16 字节对齐，中间交给 PIE，剩下不足 8 个的走下面的字路径
+    if (pixels >= 16 && ((uintptr_t)buf & 1) == 0) {
+        while ((uintptr_t)buf & 15) {
+            *buf = swap1(*buf, true);
+            buf++;
+            pixels--;
+        }
+        ui_blend565_swap_esp32s3(buf, (uint32_t)(pixels / 8));
+        buf += pixels & ~(size_t)7;
+        pixels &= 7;
+    }
+#endif
+    if (pixels && !aligned4(buf)) {
+        *buf = swap1(*buf, true);
+        buf++;
+        pixels--;
+    }
+    uint32_t *w = (uint32_t *)buf;
+    size_t words = pixels / 2;
+    size_t i = 0;
+    for (; i + 4 <= words; i += 4) {
+        uint32_t a = w[i], b = w[i + 1], c = w[i + 2], d = w[i + 3];
+        w[i] = SWAP2(a);
+        w[i + 1] = SWAP2(b);
+        w[i + 2] = SWAP2(c);
+        w[i + 3] = SWAP2(d);
+    }
+    for (; i < words; i++) {
+        w[i] = SWAP2(w[i]);
+    }
+    if (pixels & 1) {
+        buf[pixels - 1] = swap1(buf[pixels - 1], true);
+    }
+}
+
+// 逐像素的写法：对齐条件不满足时用，也处理快速路径剩下的奇数行列
+static inline void put(uint16_t *dst, int32_t dst_stride, int32_t w, int32_t h,
+                       int32_t x, int32_t y, uint16_t v, ui_pixel_rotate_t rotate)
+{
+    switch (rotate) {
+    case UI_PIXEL_ROTATE_90:
+        dst[(w - 1 - x) * dst_stride + y] = v;
+        break;
+    case UI_PIXEL_ROTATE_180:
+        dst[(h - 1 - y) * dst_stride + (w - 1 - x)] = v;
+        break;
+    case UI_PIXEL_ROTATE_270:
+        dst[x * dst_stride + (h - 1 - y)] = v;
+        break;
+    default:
+        dst[y * dst_stride + x] = v;
+        break;
+    }
+}
+
+static void rotate_slow(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                        int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap)
+{
+    for (int32_t y = 0; y < h; y++) {
+        const uint16_t *s = src + y * src_stride;
+        for (int32_t x = 0; x < w; x++) {
+            put(dst, dst_stride, w, h, x, y, swap1(s[x], swap), rotate);
+        }
+    }
+}
+
+static void rotate_row_slow(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                            int32_t src_stride, int32_t dst_stride, int32_t y, ui_pixel_rotate_t rotate, bool swap)
+{
+    const uint16_t *s = src + y * src_stride;
+    for (int32_t x = 0; x < w; x++) {
+        put(dst, dst_stride, w, h, x, y, swap1(s[x], swap), rotate);
+    }
+}
+
+// 源的 2x2 块 (a0 a1 / b0 b1) 转 90°：目标第 w-1-x 行得到 a0 b0，第 w-2-x 行得到 a1 b1。
+// 外层按源的列对、内层沿列向下，目标两行都顺序写
+static void rotate90_fast(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                          int32_t src_stride, int32_t dst_stride, bool swap)
+{
+    const int32_t h2 = h & ~1;
+    int32_t x = 0;
+    for (; x + 1 < w; x += 2) {
+        const uint32_t *s = (const uint32_t *)(src + x);
+        uint32_t *d0 = (uint32_t *)(dst + (w - 1 - x) * dst_stride);
+        uint32_t *d1 = (uint32_t *)(dst + (w - 2 - x) * dst_stride);
+        for (int32_t y = 0; y < h2; y += 2) {
+            uint32_t a = s[0];
+            uint32_t b = s[src_stride / 2];
+            s += src_stride;
+            *d0++ = swap2((a & 0xFFFFu) | (b << 16), swap);
+            *d1++ = swap2((a >> 16) | (b & 0xFFFF0000u), swap);
+        }
+    }
+    if (x < w) {
+        // 奇数宽的最后一列落在目标第 0 行
+        for (int32_t y = 0; y < h2; y++) {
+            dst[y] = swap1(src[y * src_stride + x], swap);
+        }
+    }
+    if (h2 < h) {
+        rotate_row_slow(src, dst, w, h, src_stride, dst_stride, h2, UI_PIXEL_ROTATE_90, swap);
+    }
+}
+
+// 转 270°：目标第 x 行的 h-2-y、h-1-y 两个位置依次是 b0 a0，第 x+1 行是 b1 a1。
+// 沿源的列向上读，目标两行顺序写；h 为奇数时源第 0 行单独写，其余每对行在目标中从偶数位置开始
+static void rotate270_fast(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                           int32_t src_stride, int32_t dst_stride, bool swap)
+{
+    const int32_t y0 = h & 1;
+    int32_t x = 0;
+    for (; x + 1 < w; x += 2) {
+        const uint32_t *s = (const uint32_t *)(src + (h - 2) * src_stride + x);
+        uint32_t *d0 = (uint32_t *)(dst + x * dst_stride + y0);
+        uint32_t *d1 = (uint32_t *)(dst + (x + 1) * dst_stride + y0);
+        for (int32_t y = h - 2; y >= y0; y -= 2) {
+            uint32_t a = s[0];                  // 源第 y 行
+            uint32_t b = s[src_stride / 2];     // 源第 y+1 行
+            s -= src_stride;
+            *d0++ = swap2((b & 0xFFFFu) | (a << 16), swap);
+            *d1++ = swap2((b >> 16) | (a & 0xFFFF0000u), swap);
+        }
+    }
+    if (x < w) {
+        for (int32_t y = y0; y < h; y++) {
+            dst[x * dst_stride + (h - 1 - y)] = swap1(src[y * src_stride + x], swap);
+        }
+    }
+    if (y0) {
+        rotate_row_slow(src, dst, w, h, src_stride, dst_stride, 0, UI_PIXEL_ROTATE_270, swap);
+    }
+}
+
+// 转 180°：每行倒序，字内两个像素互换位置
+static void rotate180_fast(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                           int32_t src_stride, int32_t dst_stride, bool swap)
+{
+    for (int32_t y = 0; y < h; y++) {
+        const uint32_t *s = (const uint32_t *)(src + y * src_stride);
+        uint32_t *d = (uint32_t *)(dst + (h - 1 - y) * dst_stride + w) - 1;
+        for (int32_t i = 0; i < w / 2; i++) {
+            uint32_t a = s[i];
+            *d-- = swap2((a >> 16) | (a << 16), swap);
+        }
+    }
+}
+
+static void copy_fast(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                      int32_t src_stride, int32_t dst_stride, bool swap)
+{
+    for (int32_t y = 0; y < h; y++) {
+        const uint16_t *s = src + y * src_stride;
+        uint16_t *d = dst + y * dst_stride;
+        if (!swap) {
+            memcpy(d, s, w * sizeof(uint16_t));
+            continue;
+        }
+        const uint32_t *sw = (const uint32_t *)s;
+        uint32_t *dw = (uint32_t *)d;
+        for (int32_t i = 0; i < w / 2; i++) {
+            dw[i] = SWAP2(sw[i]);
+        }
+        if (w & 1) {
+            d[w - 1] = swap1(s[w - 1], true);
+        }
+    }
+}
+
+static void rotate_c(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                     int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap)
+{
+    bool fast = aligned4(src) && aligned4(dst) && !(src_stride & 1) && !(dst_stride & 1);
+    if (rotate == UI_PIXEL_ROTATE_180 && (w & 1)) {
+        // 源与目标的字边界错开一个像素
+        fast = false;
+    }
+    if (!fast) {
+        rotate_slow(src, dst, w, h, src_stride, dst_stride, rotate, swap);
+        return;
+    }
+    switch (rotate) {
+    case UI_PIXEL_ROTATE_90:
+        rotate90_fast(src, dst, w, h, src_stride, dst_stride, swap);
+        break;
+    case UI_PIXEL_ROTATE_180:
+        rotate180_fast(src, dst, w, h, src_stride, dst_stride, swap);
+        break;
+    case UI_PIXEL_ROTATE_270:
+        rotate270_fast(src, dst, w, h, src_stride, dst_stride, swap);
+        break;
+    default:
+        copy_fast(src, dst, w, h, src_stride, dst_stride, swap);
+        break;
+    }
+}
+
+#if CONFIG_UI_BLEND_SIMD
+// 源的子块 [x0, x1) x [y0, y1) 交给 C 路径，目标为它在整块旋转结果中的位置
+static void rotate_part(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                        int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap,
+                        int32_t x0, int32_t x1, int32_t y0, int32_t y1)
+{
+    if (x0 >= x1 || y0 >= y1) {
+        return;
+    }
+    switch (rotate) {
+    case UI_PIXEL_ROTATE_90:
+        dst += (w - x1) * dst_stride + y0;
+        break;
+    case UI_PIXEL_ROTATE_180:
+        dst += (h - y1) * dst_stride + (w - x1);
+        break;
+    case UI_PIXEL_ROTATE_270:
+        dst += x0 * dst_stride + (h - y1);
+        break;
+    default:
+        dst += y0 * dst_stride + x0;
+        break;
+    }
+    rotate_c(src + y0 * src_stride + x0, dst, x1 - x0, y1 - y0, src_stride, dst_stride, rotate, swap);
+}
+
+// 源行距为 8 像素的整数倍时各行对齐情况相同：左边不到 16 字节对齐的几列、右边和上下凑不满
+// 一块的部分走 C 路径，中间交给 PIE。返回 false 表示整块都走 C 路径
+static bool rotate_simd(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                        int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap)
+{
+    if (((uintptr_t)src & 1) || (src_stride & 7) || ((uintptr_t)dst & 7) || (dst_stride & 3)) {
+        return false;
+    }
+    const int32_t x0 = (int32_t)((16 - ((uintptr_t)src & 15)) & 15) / 2;
+    int32_t x1, y0, y1;
+
+    switch (rotate) {
+    case UI_PIXEL_ROTATE_90:
+    case UI_PIXEL_ROTATE_270:
+        if (w - x0 < 8 || h < 8) {
+            return false;
+        }
+        x1 = x0 + ((w - x0) & ~7);
+        if (rotate == UI_PIXEL_ROTATE_90) {
+            // 源第 x 列写到目标第 w-1-x 行，目标行倒着走
+            y0 = 0;
+            y1 = h & ~7;
+            for (int32_t y = y0; y < y1; y += 8) {
+                ui_rotate565_t8_esp32s3(src + y * src_stride + x0, src_stride * 2,
+                                        dst + (w - 1 - x0) * dst_stride + y, -dst_stride * 2,
+                                        (x1 - x0) / 8, swap);
+            }
+        } else {
+            // 源各行倒着读，块落在目标的 h-8-y 列；零头留在上方，目标列保持 8 像素对齐
+            y0 = h & 7;
+            y1 = h;
+            for (int32_t y = y0; y < y1; y += 8) {
+                ui_rotate565_t8_esp32s3(src + (y + 7) * src_stride + x0, -src_stride * 2,
+                                        dst + x0 * dst_stride + (h - 8 - y), dst_stride * 2,
+                                        (x1 - x0) / 8, swap);
+            }
+        }
+        rotate_part(src, dst, w, h, src_stride, dst_stride, rotate, swap, x0, x1, 0, y0);
+        rotate_part(src, dst, w, h, src_stride, dst_stride, rotate, swap, x0, x1, y1, h);
+        break;
+    case UI_PIXEL_ROTATE_180:
+        // 源第 x0 列之前的部分写到目标行尾，目标一段的结尾也要 8 字节对齐
+        if (w - x0 < 16 || ((w - x0) & 3)) {
+            return false;
+        }
+        x1 = x0 + ((w - x0) & ~15);
+        for (int32_t y = 0; y < h; y++) {
+            ui_rotate565_rev_esp32s3(src + y * src_stride + x0, dst + (h - 1 - y) * dst_stride + (w - x0),
+                                     (x1 - x0) / 16, swap);
+        }
+        break;
+    default:
+        return false;
+    }
+    rotate_part(src, dst, w, h, src_stride, dst_stride, rotate, swap, 0, x0, 0, h);
+    rotate_part(src, dst, w, h, src_stride, dst_stride, rotate, swap, x1, w, 0, h);
+    return true;
+}
+#endif
+
+void ui_pixel_rotate565(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                        int32_t src_stride, int32_t dst_stride, ui_pixel_rotate_t rotate, bool swap)
+{
+    if (w <= 0 || h <= 0) {
+        return;
+    }
+#if CONFIG_UI_BLEND_SIMD
+    if (rotate_simd(src, dst, w, h, src_stride, dst_stride, rotate, swap)) {
+        return;
+    }
+#endif
+    rotate_c(src, dst, w, h, src_stride, dst_stride, rotate, swap);
+}
@@ -0,0 +1,96 @@
+// ui_preview.c
+// 摄像头预览控件：img_preview 解码出的 PSRAM 缓冲包装成 lv_draw_buf_t，轮流作为 lv_image 的源
+#include "sdkconfig.h"
+#include "ui_preview.h"
+
+#if CONFIG_UI_PREVIEW
+
+#include "esp_log.h"
+#include "esp_lvgl_port.h"
+#include "img_preview.h"
+
+static const char *TAG = "ui_preview";
+
+static lv_obj_t *s_img = NULL;
+static lv_draw_buf_t s_dbuf[2];
+static volatile bool s_stopping = false;
+
+// 预览任务中调用。控件当前显示的那块不动，另一块包装这一帧；
+// img_preview 两块缓冲轮换，被换下的那块要到下一帧解码时才会被覆盖
+static void ui_preview_flush(const uint16_t *rgb565, uint16_t w, uint16_t h, void *arg)
+{
+    lvgl_port_lock(0);
+    if (!s_stopping) {
+        lv_draw_buf_t *dbuf = lv_image_get_src(s_img) == &s_dbuf[0] ? &s_dbuf[1] : &s_dbuf[0];
+        uint32_t stride = w * sizeof(uint16_t);
+        lv_image_cache_drop(dbuf);
+        lv_draw_buf_init(dbuf, w, h, LV_COLOR_FORMAT_RGB565, stride, (void *)rgb565, stride * h);
+        lv_image_set_src(s_img, dbuf);
+    }
+    lvgl_port_unlock();
+}
+
+esp_err_t ui_preview_start(lv_obj_t *img, uint8_t scale)
+{
+    if (!img) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_img) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    lvgl_port_lock(0);
+    lv_obj_update_layout(img);
+    int32_t w = lv_obj_get_content_width(img);
+    int32_t h = lv_obj_get_content_height(img);
+    lvgl_port_unlock();
+    if (w <= 0 || h <= 0 || w > UINT16_MAX || h > UINT16_MAX) {
+        return ESP_ERR_INVALID_ARG;
+    }
+
+    s_img = img;
+    s_stopping = false;
+    const img_preview_config_t cfg = {
+        .width = w,
+        .height = h,
+        .scale = scale,
+        .swap = false,      // 由显示的 flush 回调交换
+        .flush_cb = ui_preview_flush,
+    };
+    esp_err_t ret = img_preview_start(&cfg);
+    if (ret != ESP_OK) {
+        s_img = NULL;
+        return ret;
+    }
+    ESP_LOGI(TAG, "preview on %ldx%ld image", (long)w, (long)h);
+    return ESP_OK;
+}
+
+void ui_preview_stop(void)
+{
+    if (!s_img) {
+        return;
+    }
+    // 先让控件放开缓冲，之后预览任务的回调不再设置图像源，img_preview 才能释放它们
+    lvgl_port_lock(0);
+    s_stopping = true;
+    lv_image_set_src(s_img, NULL);
+    lv_image_cache_drop(&s_dbuf[0]);
+    lv_image_cache_drop(&s_dbuf[1]);
+    lvgl_port_unlock();
+    img_preview_stop();
+    s_img = NULL;
+}
+
+#else
+
+esp_err_t ui_preview_start(lv_obj_t *img, uint8_t scale)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void ui_preview_stop(void)
+{
+}
+
+#endif // CONFIG_UI_PREVIEW
@@ -0,0 +1,134 @@
+// ui_render.c
+// 双核并行渲染：LVGL 软件绘制线程重建为绑核任务，摄像头忙时只用一个绘制单元
+#include "sdkconfig.h"
+
+#if CONFIG_UI_RENDER_DUAL_CORE
+
+#include "ui_render.h"
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "lvgl.h"
+// 绘制单元链表和软件绘制单元只在私有头中可见
+#include "src/core/lv_global.h"
+#include "src/draw/lv_draw_private.h"
+#include "src/draw/sw/lv_draw_sw_private.h"
+
+#if LV_USE_OS != LV_OS_FREERTOS || LV_DRAW_SW_DRAW_UNIT_CNT < 2 || !LV_USE_FREERTOS_TASK_NOTIFY
+#error "UI_RENDER_DUAL_CORE needs LV_OS_FREERTOS with task notify and LV_DRAW_SW_DRAW_UNIT_CNT >= 2"
+#endif
+
+static const char *TAG = "ui_render";
+
+#define UI_RENDER_WAIT_MS   100
+
+typedef int32_t (*ui_render_dispatch_t)(lv_draw_unit_t *draw_unit, lv_layer_t *layer);
+
+static ui_render_dispatch_t s_dispatch = NULL;     // 软件绘制单元原来的派发回调
+static volatile bool s_parallel = true;
+static bool s_inited = false;
+
+// 第二个及以后的绘制单元：关闭并行时不接新任务，LVGL 把任务都派给第一个单元
+static int32_t secondary_dispatch(lv_draw_unit_t *draw_unit, lv_layer_t *layer)
+{
+    if (!s_parallel) {
+        return LV_DRAW_UNIT_IDLE;
+    }
+    return s_dispatch(draw_unit, layer);
+}
+
+// 与 LVGL 的 FreeRTOS 线程入口相同：跑完线程函数后删除自己
+static void render_task(void *arg)
+{
+    lv_thread_t *thread = arg;
+    thread->pvStartRoutine(thread->pTaskArg);
+    vTaskDelete(NULL);
+}
+
+static bool wait_inited(lv_draw_sw_unit_t *u, bool inited)
+{
+    for (int i = 0; i < UI_RENDER_WAIT_MS; i++) {
+        if (u->inited == inited) {
+            return true;
+        }
+        vTaskDelay(pdMS_TO_TICKS(1));
+    }
+    return false;
+}
+
+static esp_err_t render_repin(lv_draw_sw_unit_t *u, uint32_t stack_size, int core)
+{
+    // 线程建好后先初始化同步量再置 inited，之后才会收到退出信号
+    if (!wait_inited(u, true)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    UBaseType_t prio = uxTaskPriorityGet(u->thread.xTaskHandle);
+
+    // LVGL 自己的退出流程：置 exit_status 并唤醒，线程函数返回后任务删除自身
+    u->exit_status = true;
+    lv_thread_sync_signal(&u->sync);
+    if (!wait_inited(u, false)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    // inited 清零后旧任务只剩释放同步量和删除自身，task notify 模式下新任务重新初始化不受影响
+    vTaskDelay(1);
+    u->exit_status = false;
+
+    if (xTaskCreatePinnedToCore(render_task, "lvglDraw", stack_size, &u->thread, prio,
+                                &u->thread.xTaskHandle, core) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+    if (!wait_inited(u, true)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    ESP_LOGI(TAG, "draw unit %lu on core %d, stack %lu", (unsigned long)u->idx, core, (unsigned long)stack_size);
+    return ESP_OK;
+}
+
+esp_err_t ui_render_init(const ui_render_config_t *config)
+{
+    if (!config || config->main_core < 0 || config->main_core >= portNUM_PROCESSORS
+        || config->second_core < 0 || config->second_core >= portNUM_PROCESSORS) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_inited) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    // 只开了软件绘制，链表里都是软件绘制单元
+    lv_draw_global_info_t *info = &LV_GLOBAL_DEFAULT()->draw_info;
+    if (info->unit_cnt != LV_DRAW_SW_DRAW_UNIT_CNT) {
+        ESP_LOGE(TAG, "%lu draw units, expected %d software units", (unsigned long)info->unit_cnt, LV_DRAW_SW_DRAW_UNIT_CNT);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    for (lv_draw_unit_t *unit = info->unit_head; unit; unit = unit->next) {
+        lv_draw_sw_unit_t *u = (lv_draw_sw_unit_t *)unit;
+        int core = u->idx == 0 ? config->main_core : config->second_core;
+        esp_err_t ret = render_repin(u, config->stack_size, core);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "draw unit %lu repin failed (0x%x)", (unsigned long)u->idx, ret);
+            return ret;
+        }
+        if (u->idx != 0) {
+            s_dispatch = unit->dispatch_cb;
+            unit->dispatch_cb = secondary_dispatch;
+        }
+    }
+    s_inited = true;
+    return ESP_OK;
+}
+
+void ui_render_set_parallel(bool enable)
+{
+    if (s_parallel != enable) {
+        s_parallel = enable;
+        ESP_LOGD(TAG, "parallel render %s", enable ? "on" : "off");
+    }
+}
+
+uint32_t ui_render_active_units(void)
+{
+    return s_parallel ? LV_DRAW_SW_DRAW_UNIT_CNT : 1;
+}
+
+#endif // CONFIG_UI_RENDER_DUAL_CORE
@@ -0,0 +1,137 @@
+// hot_profile.c
+// 热点函数采样：-finstrument-functions 的进入钩子按函数地址计数，周期打印给 tools/hot_profile.py
+#include "hot_profile.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_log.h"
+#include "cc_hal_os.h"
+
+static const char *TAG = "hot_profile";
+
+#if CONFIG_HOT_PROFILE_TRACE
+
+#define HOT_PROFILE_TASK_STACK  3072
+#define HOT_PROFILE_TASK_PRIO   1
+
+typedef struct {
+    uintptr_t fn;
+    uint32_t count;
+} hot_profile_slot_t;
+
+// 开放寻址哈希表，槽位只增不删，reset 只清计数；钩子在中断和各任务中都会进入，不能加锁
+static DRAM_ATTR hot_profile_slot_t s_slots[CONFIG_HOT_PROFILE_SLOTS];
+static DRAM_ATTR uint32_t s_dropped = 0;
+
+#define HOT_PROFILE_HOOK __attribute__((no_instrument_function)) IRAM_ATTR
+
+HOT_PROFILE_HOOK void __cyg_profile_func_enter(void *fn, void *call_site)
+{
+    (void)call_site;
+    uintptr_t key = (uintptr_t)fn;
+    // 函数地址至少 4 字节对齐，去掉低位再散列
+    uint32_t idx = ((key >> 2) * 2654435761u) % CONFIG_HOT_PROFILE_SLOTS;
+    for (uint32_t n = 0; n < CONFIG_HOT_PROFILE_SLOTS; n++) {
+        hot_profile_slot_t *slot = &s_slots[idx];
+        uintptr_t cur = __atomic_load_n(&slot->fn, __ATOMIC_RELAXED);
+        if (cur == 0) {
+            uintptr_t expected = 0;
+            if (__atomic_compare_exchange_n(&slot->fn, &expected, key, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                cur = key;
+            } else {
+                cur = expected;
+            }
+        }
+        if (cur == key) {
+            // 计数可能因并发少计几次，采样用途足够
+            slot->count++;
+            return;
+        }
+        idx = (idx + 1) % CONFIG_HOT_PROFILE_SLOTS;
+    }
+    s_dropped++;
+}
+
+HOT_PROFILE_HOOK void __cyg_profile_func_exit(void *fn, void *call_site)
+{
+    (void)fn;
+    (void)call_site;
+}
+
+static int hot_profile_cmp(const void *a, const void *b)
+{
+    uint32_t ca = ((const hot_profile_slot_t *)a)->count;
+    uint32_t cb = ((const hot_profile_slot_t *)b)->count;
+    return (ca < cb) - (ca > cb);
+}
+
+void hot_profile_dump(void)
+{
+    hot_profile_slot_t *snap = malloc(sizeof(s_slots));
+    if (!snap) {
+        ESP_LOGE(TAG, "no memory for snapshot");
+        return;
+    }
+    size_t num = 0;
+    for (size_t i = 0; i < CONFIG_HOT_PROFILE_SLOTS; i++) {
+        if (s_slots[i].fn && s_slots[i].count) {
+            snap[num++] = s_slots[i];
+        }
+    }
+    qsort(snap, num, sizeof(hot_profile_slot_t), hot_profile_cmp);
+    // 用 printf 而不是 ESP_LOG，行格式固定，便于工具从日志中提取
+    printf("HOT_PROFILE_BEGIN\n");
+    for (size_t i = 0; i < num; i++) {
+        printf("HOT 0x%08x %lu\n", (unsigned)snap[i].fn, (unsigned long)snap[i].count);
+    }
+    printf("HOT_PROFILE_END dropped=%lu\n", (unsigned long)s_dropped);
+    free(snap);
+}
+
+void hot_profile_reset(void)
+{
+    for (size_t i = 0; i < CONFIG_HOT_PROFILE_SLOTS; i++) {
+        s_slots[i].count = 0;
+    }
+    s_dropped = 0;
+}
+
+static void hot_profile_task(void *arg)
+{
+    while (1) {
+        vTaskDelay(pdMS_TO_TICKS(CONFIG_HOT_PROFILE_DUMP_S * 1000));
+        hot_profile_dump();
+    }
+}
+
+esp_err_t hot_profile_init(void)
+{
+    ESP_LOGW(TAG, "instrumented build, %d slots, dump every %d s", CONFIG_HOT_PROFILE_SLOTS, CONFIG_HOT_PROFILE_DUMP_S);
+    // 每隔几十秒才运行一次，栈放 PSRAM
+    if (cc_hal_os_task_create_caps(hot_profile_task, "hot_profile", HOT_PROFILE_TASK_STACK, NULL, HOT_PROFILE_TASK_PRIO,
+                                   CC_OS_STACK_PSRAM, NULL) != CC_OK) {
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t hot_profile_init(void)
+{
+    return ESP_OK;
+}
+
+void hot_profile_dump(void)
+{
+    ESP_LOGW(TAG, "disabled");
+}
+
+void hot_profile_reset(void)
+{
+}
+
+#endif // CONFIG_HOT_PROFILE_TRACE
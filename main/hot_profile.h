@@ -0,0 +1,46 @@
+/**
+ * @file hot_profile.h
+ * @brief 热点函数采样：追踪构建中统计各函数的调用次数，供 tools/hot_profile.py 生成 IRAM 放置的链接片段
+ *
+ * 打开 CONFIG_HOT_PROFILE_TRACE 后，uart/、gs_img/、校验与帧解析以及 rbuffer 以
+ * -finstrument-functions 编译，每次函数进入按函数地址计数。计数周期性打印到串口：
+ *
+ *   HOT_PROFILE_BEGIN
+ *   HOT 0x42012345 18230
+ *   ...
+ *   HOT_PROFILE_END dropped=0
+ *
+ * 把串口日志交给 tools/hot_profile.py gen，按 ELF 和 map 文件解析出函数所在的库与目标文件，
+ * 生成 main/hot_placement.lf。追踪构建只用于采样，插桩本身有开销，不要用于出货固件。
+ */
+
+#ifndef HOT_PROFILE_H
+#define HOT_PROFILE_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief 启动周期打印任务（CONFIG_HOT_PROFILE_DUMP_S），未开启追踪时为空操作
+ */
+esp_err_t hot_profile_init(void);
+
+/**
+ * @brief 立即按调用次数从高到低打印全部计数
+ */
+void hot_profile_dump(void);
+
+/**
+ * @brief 清零计数，例如跳过启动阶段只采样稳态
+ */
+void hot_profile_reset(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HOT_PROFILE_H
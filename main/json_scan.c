@@ -0,0 +1,319 @@
+// json_scan.c
+// 配网等小消息的原地 JSON 解析，替代 cJSON 建树的堆分配
+#include "json_scan.h"
+#include <string.h>
+
+static int alloc_tok(json_tok_t *toks, size_t num, size_t *next, uint8_t type, size_t start, int super)
+{
+    if (*next >= num) {
+        return JSON_SCAN_ERR_NOMEM;
+    }
+    json_tok_t *t = &toks[*next];
+    t->type = type;
+    t->start = (uint16_t)start;
+    t->end = 0;
+    t->size = 0;
+    t->parent = (int16_t)super;
+    if (super >= 0) {
+        toks[super].size++;
+    }
+    return (int)(*next)++;
+}
+
+static int hex_val(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
+
+// 从 pos（引号之后）扫到结束引号，返回结束引号的位置
+static int scan_string(const char *js, size_t len, size_t pos)
+{
+    for (; pos < len && js[pos]; pos++) {
+        char c = js[pos];
+        if (c == '"') {
+            return (int)pos;
+        }
+        if ((unsigned char)c < 0x20) {
+            return JSON_SCAN_ERR_INVAL;
+        }
+        if (c != '\\') {
+            continue;
+        }
+        if (++pos >= len || !js[pos]) {
+            break;
+        }
+        switch (js[pos]) {
+        case '"': case '\\': case '/': case 'b': case 'f': case 'n': case 'r': case 't':
+            break;
+        case 'u':
+            for (int i = 0; i < 4; i++) {
+                if (++pos >= len || !js[pos]) {
+                    return JSON_SCAN_ERR_PART;
+                }
+                if (hex_val(js[pos]) < 0) {
+                    return JSON_SCAN_ERR_INVAL;
+                }
+            }
+            break;
+        default:
+            return JSON_SCAN_ERR_INVAL;
+        }
+    }
+    return JSON_SCAN_ERR_PART;
+}
+
+int json_scan_parse(const char *js, size_t len, json_tok_t *toks, size_t num)
+{
+    if (!js || !toks || len > UINT16_MAX) {
+        return JSON_SCAN_ERR_INVAL;
+    }
+    size_t next = 0;
+    int super = -1;             // 当前所在的容器，或刚读完冒号的键
+    for (size_t pos = 0; pos < len && js[pos]; pos++) {
+        char c = js[pos];
+        int idx;
+        switch (c) {
+        case '{':
+        case '[':
+            if (super >= 0 && toks[super].type == JSON_TOK_OBJECT) {
+                return JSON_SCAN_ERR_INVAL;     // 对象的键必须是字符串
+            }
+            idx = alloc_tok(toks, num, &next, c == '{' ? JSON_TOK_OBJECT : JSON_TOK_ARRAY, pos, super);
+            if (idx < 0) {
+                return idx;
+            }
+            super = idx;
+            break;
+        case '}':
+        case ']':
+            if (super >= 0 && toks[super].type == JSON_TOK_STRING) {
+                super = toks[super].parent;
+            }
+            if (super < 0 || toks[super].end != 0
+                || toks[super].type != (c == '}' ? JSON_TOK_OBJECT : JSON_TOK_ARRAY)) {
+                return JSON_SCAN_ERR_INVAL;
+            }
+            toks[super].end = (uint16_t)(pos + 1);
+            super = toks[super].parent;
+            break;
+        case '"': {
+            int end = scan_string(js, len, pos + 1);
+            if (end < 0) {
+                return end;
+            }
+            idx = alloc_tok(toks, num, &next, JSON_TOK_STRING, pos + 1, super);
+            if (idx < 0) {
+                return idx;
+            }
+            toks[idx].end = (uint16_t)end;
+            pos = end;
+            break;
+        }
+        case ':':
+            // 冒号之后的值挂在键下面
+            if (super < 0 || toks[super].type != JSON_TOK_OBJECT || next == 0
+                || toks[next - 1].type != JSON_TOK_STRING || toks[next - 1].parent != super) {
+                return JSON_SCAN_ERR_INVAL;
+            }
+            super = (int)(next - 1);
+            break;
+        case ',':
+            if (super >= 0 && toks[super].type == JSON_TOK_STRING) {
+                super = toks[super].parent;
+            }
+            break;
+        case ' ':
+        case '\t':
+        case '\r':
+        case '\n':
+            break;
+        default: {
+            if (!(c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+                || (super >= 0 && toks[super].type == JSON_TOK_OBJECT)) {
+                return JSON_SCAN_ERR_INVAL;
+            }
+            size_t end = pos;
+            while (end < len && js[end] && !strchr(" \t\r\n,]}", js[end])) {
+                if ((unsigned char)js[end] < 0x20 || (unsigned char)js[end] >= 0x7f) {
+                    return JSON_SCAN_ERR_INVAL;
+                }
+                end++;
+            }
+            idx = alloc_tok(toks, num, &next, JSON_TOK_PRIMITIVE, pos, super);
+            if (idx < 0) {
+                return idx;
+            }
+            toks[idx].end = (uint16_t)end;
+            pos = end - 1;
+            break;
+        }
+        }
+    }
+    // 还有未闭合的容器
+    for (size_t i = 0; i < next; i++) {
+        if (toks[i].end == 0) {
+            return JSON_SCAN_ERR_PART;
+        }
+    }
+    return (int)next;
+}
+
+static size_t put_utf8(char *out, uint32_t cp)
+{
+    if (cp < 0x80) {
+        out[0] = (char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (char)(0xc0 | (cp >> 6));
+        out[1] = (char)(0x80 | (cp & 0x3f));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (char)(0xe0 | (cp >> 12));
+        out[1] = (char)(0x80 | ((cp >> 6) & 0x3f));
+        out[2] = (char)(0x80 | (cp & 0x3f));
+        return 3;
+    }
+    out[0] = (char)(0xf0 | (cp >> 18));
+    out[1] = (char)(0x80 | ((cp >> 12) & 0x3f));
+    out[2] = (char)(0x80 | ((cp >> 6) & 0x3f));
+    out[3] = (char)(0x80 | (cp & 0x3f));
+    return 4;
+}
+
+static uint32_t hex4(const char *p)
+{
+    return (uint32_t)(hex_val(p[0]) << 12 | hex_val(p[1]) << 8 | hex_val(p[2]) << 4 | hex_val(p[3]));
+}
+
+int json_scan_str(const char *js, const json_tok_t *tok, char *out, size_t size)
+{
+    if (tok->type != JSON_TOK_STRING || size == 0) {
+        return -1;
+    }
+    size_t n = 0;
+    for (size_t i = tok->start; i < tok->end; i++) {
+        char buf[4];
+        size_t k = 1;
+        buf[0] = js[i];
+        if (js[i] == '\\') {
+            char e = js[++i];
+            switch (e) {
+            case 'b': buf[0] = '\b'; break;
+            case 'f': buf[0] = '\f'; break;
+            case 'n': buf[0] = '\n'; break;
+            case 'r': buf[0] = '\r'; break;
+            case 't': buf[0] = '\t'; break;
+            case 'u': {
+                // 合法性已在切分时检查过
+                uint32_t cp = hex4(&js[i + 1]);
+                i += 4;
+                if (cp >= 0xd800 && cp < 0xdc00) {
+                    if (i + 6 >= tok->end || js[i + 1] != '\\' || js[i + 2] != 'u') {
+                        return -1;
+                    }
+                    uint32_t lo = hex4(&js[i + 3]);
+                    if (lo < 0xdc00 || lo >= 0xe000) {
+                        return -1;
+                    }
+                    cp = 0x10000 + ((cp - 0xd800) << 10) + (lo - 0xdc00);
+                    i += 6;
+                } else if (cp >= 0xdc00 && cp < 0xe000) {
+                    return -1;
+                }
+                if (cp == 0) {
+                    return -1;      // 不能放进 C 字符串
+                }
+                k = put_utf8(buf, cp);
+                break;
+            }
+            default: buf[0] = e; break;
+            }
+        }
+        if (n + k >= size) {
+            return -1;
+        }
+        memcpy(out + n, buf, k);
+        n += k;
+    }
+    out[n] = '\0';
+    return (int)n;
+}
+
+bool json_scan_eq(const char *js, const json_tok_t *tok, const char *s)
+{
+    size_t n = strlen(s);
+    return tok->type == JSON_TOK_STRING && (size_t)(tok->end - tok->start) == n
+           && memcmp(js + tok->start, s, n) == 0;
+}
+
+int json_scan_fields(const char *js, size_t len, const json_scan_field_t *fields, size_t num, uint32_t *found)
+{
+    json_tok_t toks[JSON_SCAN_FIELDS_TOKS];
+    uint32_t mask = 0;
+    if (found) {
+        *found = 0;
+    }
+    if (num > JSON_SCAN_FIELDS_MAX) {
+        return JSON_SCAN_ERR_INVAL;
+    }
+    for (size_t f = 0; f < num; f++) {
+        fields[f].out[0] = '\0';
+    }
+
+    int n = json_scan_parse(js, len, toks, JSON_SCAN_FIELDS_TOKS);
+    if (n < 0) {
+        return n;
+    }
+    if (n == 0 || toks[0].type != JSON_TOK_OBJECT) {
+        return JSON_SCAN_ERR_TYPE;
+    }
+    // 顶层对象的键依次为 parent == 0 的 token，值紧随其后
+    int err = JSON_SCAN_OK;
+    for (int i = 1; i < n; i++) {
+        if (toks[i].parent != 0) {
+            continue;
+        }
+        if (toks[i].size != 1) {
+            return JSON_SCAN_ERR_INVAL;     // 键后没有值
+        }
+        const json_tok_t *val = &toks[i + 1];
+        for (size_t f = 0; f < num; f++) {
+            if ((mask & (1u << f)) || !json_scan_eq(js, &toks[i], fields[f].key)) {
+                continue;
+            }
+            // 出错的字段不算取到，其余字段照常取，返回第一个错误
+            if (val->type != JSON_TOK_STRING) {
+                err = err ? err : JSON_SCAN_ERR_TYPE;
+            } else if (json_scan_str(js, val, fields[f].out, fields[f].size) < 0) {
+                fields[f].out[0] = '\0';
+                err = err ? err : JSON_SCAN_ERR_LEN;
+            } else {
+                mask |= 1u << f;
+            }
+            break;
+        }
+    }
+    if (found) {
+        *found = mask;
+    }
+    if (err != JSON_SCAN_OK) {
+        return err;
+    }
+    for (size_t f = 0; f < num; f++) {
+        if ((fields[f].flags & JSON_SCAN_REQUIRED) && !(mask & (1u << f))) {
+            return JSON_SCAN_ERR_MISSING;
+        }
+    }
+    return JSON_SCAN_OK;
+}
@@ -0,0 +1,97 @@
+#ifndef JSON_SCAN_H
+#define JSON_SCAN_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 原地 JSON 扫描：在接收缓冲上切分出 token（只记偏移，不拷贝、不分配堆内存），
+ * 再按字段表把需要的字符串解码到调用方的缓冲，替代 cJSON 建树
+ *
+ * 用法（配网信息）：
+ *   char ssid[33], password[65];
+ *   const json_scan_field_t fields[] = {
+ *       { "ssid", ssid, sizeof(ssid), JSON_SCAN_REQUIRED },
+ *       { "password", password, sizeof(password), JSON_SCAN_REQUIRED },
+ *   };
+ *   if (json_scan_fields(data, len, fields, 2, NULL) != JSON_SCAN_OK) { ... }
+ *
+ * 只取顶层对象中值为字符串的字段，转义（含 \uXXXX 与代理对）解码为 UTF-8；
+ * 同名字段取第一个；缺少的可选字段输出空串。遇到 '\0' 视为输入结束。
+ */
+
+#define JSON_SCAN_FIELDS_TOKS   48      // json_scan_fields() 栈上的 token 数，够配网消息用
+#define JSON_SCAN_FIELDS_MAX    32
+
+typedef enum {
+    JSON_SCAN_OK = 0,
+    JSON_SCAN_ERR_NOMEM = -1,           // token 不够
+    JSON_SCAN_ERR_INVAL = -2,           // 语法错误
+    JSON_SCAN_ERR_PART = -3,            // 输入不完整
+    JSON_SCAN_ERR_MISSING = -4,         // 缺少必需字段
+    JSON_SCAN_ERR_TYPE = -5,            // 根不是对象，或字段值不是字符串
+    JSON_SCAN_ERR_LEN = -6,             // 字段值超过输出缓冲
+} json_scan_err_t;
+
+typedef enum {
+    JSON_TOK_OBJECT = 1,
+    JSON_TOK_ARRAY,
+    JSON_TOK_STRING,
+    JSON_TOK_PRIMITIVE,                 // 数字、true、false、null
+} json_tok_type_t;
+
+// 偏移相对于输入起始；字符串不含引号。对象的 size 为键数，键的 size 为 1，数组的 size 为元素数
+typedef struct {
+    uint8_t type;                       // json_tok_type_t
+    uint16_t start;
+    uint16_t end;                       // 末尾之后的位置
+    uint16_t size;
+    int16_t parent;                     // 父 token 下标，顶层为 -1
+} json_tok_t;
+
+#define JSON_SCAN_REQUIRED      0x01
+
+typedef struct {
+    const char *key;
+    char *out;                          // 解码后的值，以 '\0' 结尾
+    uint16_t size;                      // out 的容量，含 '\0'
+    uint8_t flags;                      // JSON_SCAN_REQUIRED
+} json_scan_field_t;
+
+/**
+ * @brief 切分 token，输入最长 65535 字节
+ *
+ * @return token 数，出错返回 json_scan_err_t
+ */
+int json_scan_parse(const char *js, size_t len, json_tok_t *toks, size_t num);
+
+/**
+ * @brief 把字符串 token 解码到 out（含 '\0'）
+ *
+ * @return 解码后的长度，不是字符串、转义无效或放不下时返回 -1
+ */
+int json_scan_str(const char *js, const json_tok_t *tok, char *out, size_t size);
+
+// 字符串 token 是否等于 s（按原文比较，不解码转义）
+bool json_scan_eq(const char *js, const json_tok_t *tok, const char *s);
+
+/**
+ * @brief 按字段表取顶层对象中的字符串字段
+ *
+ * 字段值类型或长度不符时，该字段不算取到，其余字段照常取出并置位 found，返回第一个这样的错误
+ *
+ * @param found 可为 NULL；第 i 个字段取到时置位 bit i
+ * @return JSON_SCAN_OK 或 json_scan_err_t
+ */
+int json_scan_fields(const char *js, size_t len, const json_scan_field_t *fields, size_t num, uint32_t *found);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_SCAN_H
@@ -0,0 +1,193 @@
+// json_writer.c
+// 上报消息用的流式 JSON 写入，替代 cJSON 建树 + Print 的堆分配
+#include "json_writer.h"
+#include <string.h>
+
+static const char s_hex_digits[] = "0123456789ABCDEF";
+
+// 剩余可写字节数（保留结尾 '\0'）
+static inline size_t room(const json_writer_t *w)
+{
+    return w->size - 1 - w->len;
+}
+
+static void put_raw(json_writer_t *w, const char *s, size_t n)
+{
+    if (w->overflow) {
+        return;
+    }
+    if (n > room(w)) {
+        w->overflow = true;
+        return;
+    }
+    memcpy(w->buf + w->len, s, n);
+    w->len += n;
+}
+
+static inline void put_char(json_writer_t *w, char c)
+{
+    if (w->overflow) {
+        return;
+    }
+    if (room(w) == 0) {
+        w->overflow = true;
+        return;
+    }
+    w->buf[w->len++] = c;
+}
+
+// 写值或 key 之前按需补逗号
+static inline void begin_value(json_writer_t *w)
+{
+    if (w->need_comma) {
+        put_char(w, ',');
+    }
+    w->need_comma = true;
+}
+
+static void put_escaped(json_writer_t *w, const char *str)
+{
+    put_char(w, '"');
+    const char *run = str;
+    for (const char *p = str; *p; p++) {
+        unsigned char c = (unsigned char)*p;
+        if (c >= 0x20 && c != '"' && c != '\\') {
+            continue;
+        }
+        // 先整段拷贝无需转义的部分
+        put_raw(w, run, p - run);
+        run = p + 1;
+        switch (c) {
+        case '"':  put_raw(w, "\\\"", 2); break;
+        case '\\': put_raw(w, "\\\\", 2); break;
+        case '\n': put_raw(w, "\\n", 2); break;
+        case '\r': put_raw(w, "\\r", 2); break;
+        case '\t': put_raw(w, "\\t", 2); break;
+        default: {
+            char esc[6] = { '\\', 'u', '0', '0', s_hex_digits[c >> 4], s_hex_digits[c & 0x0F] };
+            put_raw(w, esc, sizeof(esc));
+            break;
+        }
+        }
+    }
+    put_raw(w, run, strlen(run));
+    put_char(w, '"');
+}
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size)
+{
+    w->buf = buf;
+    w->size = size;
+    w->len = 0;
+    w->overflow = (buf == NULL || size == 0);
+    w->need_comma = false;
+    if (!w->overflow) {
+        buf[0] = '\0';
+    }
+}
+
+void json_writer_object_begin(json_writer_t *w)
+{
+    begin_value(w);
+    put_char(w, '{');
+    w->need_comma = false;
+}
+
+void json_writer_object_end(json_writer_t *w)
+{
+    put_char(w, '}');
+    w->need_comma = true;
+}
+
+void json_writer_array_begin(json_writer_t *w)
+{
+    begin_value(w);
+    put_char(w, '[');
+    w->need_comma = false;
+}
+
+void json_writer_array_end(json_writer_t *w)
+{
+    put_char(w, ']');
+    w->need_comma = true;
+}
+
+void json_writer_key(json_writer_t *w, const char *key)
+{
+    begin_value(w);
+    put_escaped(w, key ? key : "");
+    put_char(w, ':');
+    // key 之后紧跟 value，不需要逗号
+    w->need_comma = false;
+}
+
+void json_writer_str(json_writer_t *w, const char *str)
+{
+    begin_value(w);
+    put_escaped(w, str ? str : "");
+}
+
+void json_writer_uint(json_writer_t *w, uint32_t value)
+{
+    char digits[10];
+    int n = 0;
+    do {
+        digits[sizeof(digits) - 1 - n++] = '0' + value % 10;
+        value /= 10;
+    } while (value);
+    begin_value(w);
+    put_raw(w, digits + sizeof(digits) - n, n);
+}
+
+void json_writer_int(json_writer_t *w, int32_t value)
+{
+    if (value >= 0) {
+        json_writer_uint(w, (uint32_t)value);
+        return;
+    }
+    begin_value(w);
+    put_char(w, '-');
+    // 负号已写出，数字部分不再补逗号
+    w->need_comma = false;
+    json_writer_uint(w, 0u - (uint32_t)value);
+}
+
+void json_writer_bool(json_writer_t *w, bool value)
+{
+    begin_value(w);
+    if (value) {
+        put_raw(w, "true", 4);
+    } else {
+        put_raw(w, "false", 5);
+    }
+}
+
+void json_writer_hex(json_writer_t *w, const uint8_t *data, size_t len)
+{
+    begin_value(w);
+    put_char(w, '"');
+    if (!w->overflow && len * 2 > room(w)) {
+        w->overflow = true;
+    }
+    if (!w->overflow) {
+        char *out = w->buf + w->len;
+        for (size_t i = 0; i < len; i++) {
+            *out++ = s_hex_digits[data[i] >> 4];
+            *out++ = s_hex_digits[data[i] & 0x0F];
+        }
+        w->len += len * 2;
+    }
+    put_char(w, '"');
+}
+
+size_t json_writer_finish(json_writer_t *w)
+{
+    if (w->overflow) {
+        if (w->buf && w->size) {
+            w->buf[0] = '\0';
+        }
+        return 0;
+    }
+    w->buf[w->len] = '\0';
+    return w->len;
+}
@@ -0,0 +1,93 @@
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+/**
+ * 流式 JSON 写入器：直接写入调用方提供的缓冲，不分配堆内存
+ *
+ * 用法：
+ *   char buf[128];
+ *   json_writer_t w;
+ *   json_writer_init(&w, buf, sizeof(buf));
+ *   json_writer_object_begin(&w);
+ *   json_writer_kv_str(&w, "ver", ver);
+ *   json_writer_kv_hex(&w, "data", data, len);
+ *   json_writer_object_end(&w);
+ *   size_t len = json_writer_finish(&w);    // 0 表示缓冲不足
+ *
+ * 缓冲不足时置 overflow，之后的写入全部忽略，不会越界；
+ * 缓冲中始终保留一个字节用于结尾的 '\0'。
+ * 逗号由写入器自动插入，调用方只需保证 key/value 成对出现。
+ */
+typedef struct {
+    char *buf;
+    size_t size;
+    size_t len;
+    bool overflow;
+    bool need_comma;
+} json_writer_t;
+
+void json_writer_init(json_writer_t *w, char *buf, size_t size);
+
+void json_writer_object_begin(json_writer_t *w);
+void json_writer_object_end(json_writer_t *w);
+void json_writer_array_begin(json_writer_t *w);
+void json_writer_array_end(json_writer_t *w);
+
+void json_writer_key(json_writer_t *w, const char *key);
+void json_writer_str(json_writer_t *w, const char *str);
+void json_writer_int(json_writer_t *w, int32_t value);
+void json_writer_uint(json_writer_t *w, uint32_t value);
+void json_writer_bool(json_writer_t *w, bool value);
+// 以大写十六进制字符串写入二进制数据，如 {0x01, 0xAB} -> "01AB"
+void json_writer_hex(json_writer_t *w, const uint8_t *data, size_t len);
+
+/**
+ * 结束写入并补 '\0'
+ *
+ * @return 已写入长度（不含 '\0'），溢出返回 0
+ */
+size_t json_writer_finish(json_writer_t *w);
+
+static inline void json_writer_kv_str(json_writer_t *w, const char *key, const char *str)
+{
+    json_writer_key(w, key);
+    json_writer_str(w, str);
+}
+
+static inline void json_writer_kv_int(json_writer_t *w, const char *key, int32_t value)
+{
+    json_writer_key(w, key);
+    json_writer_int(w, value);
+}
+
+static inline void json_writer_kv_uint(json_writer_t *w, const char *key, uint32_t value)
+{
+    json_writer_key(w, key);
+    json_writer_uint(w, value);
+}
+
+static inline void json_writer_kv_bool(json_writer_t *w, const char *key, bool value)
+{
+    json_writer_key(w, key);
+    json_writer_bool(w, value);
+}
+
+static inline void json_writer_kv_hex(json_writer_t *w, const char *key, const uint8_t *data, size_t len)
+{
+    json_writer_key(w, key);
+    json_writer_hex(w, data, len);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_WRITER_H
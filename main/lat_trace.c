@@ -0,0 +1,166 @@
+// lat_trace.c
+// 图传链路耗时打点：固定大小的无锁环，按会话汇总后打印并经 MQTT 上报
+#include "lat_trace.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "gs_mqtt.h"
+#include "crash_dump.h"
+#include "string.h"
+#include <stdio.h>
+#include <stdbool.h>
+
+static const char *TAG = "lat_trace";
+
+#define LAT_TRACE_RING_SIZE     64      // 必须为 2 的幂
+#define LAT_TRACE_MQTT_REPORT   1
+#define LAT_TRACE_MQTT_TOPIC    "/event/latency/post"
+
+typedef struct {
+    uint32_t seq;           // 写入序号，0 表示正在写或为空
+    uint32_t ts_us;         // esp_timer 时间低 32 位
+    uint32_t arg;
+    uint8_t point;
+} lat_trace_entry_t;
+
+// 打点环随崩溃转储保存
+static CRASH_DUMP_ATTR lat_trace_entry_t s_ring[LAT_TRACE_RING_SIZE];
+static CRASH_DUMP_ATTR uint32_t s_seq = 0;
+static CRASH_DUMP_ATTR volatile bool s_active = false;
+
+static const char *const s_point_name[LAT_TRACE_POINT_MAX] = {
+    "uart_rx", "sof", "eof", "fb_get", "connect", "body", "resp", "result",
+};
+
+void lat_trace_mark(lat_trace_point_t point, uint32_t arg)
+{
+    if (point >= LAT_TRACE_POINT_MAX) {
+        return;
+    }
+    if (point == LAT_TRACE_UART_RX) {
+        s_active = true;
+    } else if (!s_active) {
+        return;
+    }
+    uint32_t seq = __atomic_add_fetch(&s_seq, 1, __ATOMIC_RELAXED);
+    lat_trace_entry_t *entry = &s_ring[seq & (LAT_TRACE_RING_SIZE - 1)];
+    __atomic_store_n(&entry->seq, 0, __ATOMIC_RELAXED);
+    entry->ts_us = (uint32_t)esp_timer_get_time();
+    entry->arg = arg;
+    entry->point = (uint8_t)point;
+    __atomic_store_n(&entry->seq, seq, __ATOMIC_RELEASE);
+    if (point == LAT_TRACE_RESULT_TX) {
+        s_active = false;
+    }
+}
+
+// 按序号读一条记录，已被覆盖或正在写时返回 false
+static bool lat_trace_read(uint32_t seq, lat_trace_entry_t *out)
+{
+    const lat_trace_entry_t *entry = &s_ring[seq & (LAT_TRACE_RING_SIZE - 1)];
+    if (__atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) != seq) {
+        return false;
+    }
+    *out = *entry;
+    // 拷贝期间被覆盖则丢弃
+    return __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE) == seq;
+}
+
+// 环中仍可能有效的最早序号
+static uint32_t lat_trace_first(uint32_t head)
+{
+    return (head > LAT_TRACE_RING_SIZE) ? head - LAT_TRACE_RING_SIZE + 1 : 1;
+}
+
+// 按写入顺序拷贝出仍有效的记录，返回条数
+static size_t lat_trace_snapshot(lat_trace_entry_t *out)
+{
+    uint32_t head = __atomic_load_n(&s_seq, __ATOMIC_ACQUIRE);
+    size_t count = 0;
+    for (uint32_t seq = lat_trace_first(head); seq <= head && seq != 0; seq++) {
+        if (lat_trace_read(seq, &out[count])) {
+            count++;
+        }
+    }
+    return count;
+}
+
+void lat_trace_dump(void)
+{
+    static lat_trace_entry_t snap[LAT_TRACE_RING_SIZE];
+    size_t count = lat_trace_snapshot(snap);
+    ESP_LOGI(TAG, "===== latency trace (%u entries) =====", count);
+    for (size_t i = 0; i < count; i++) {
+        ESP_LOGI(TAG, "#%u %10u us %-8s arg=%u", (unsigned)snap[i].seq, (unsigned)snap[i].ts_us,
+                 s_point_name[snap[i].point], (unsigned)snap[i].arg);
+    }
+}
+
+// 逐条读环，不用快照缓冲，可在多个任务中同时调用
+bool lat_trace_last(int32_t delta_ms[LAT_TRACE_POINT_MAX])
+{
+    for (int p = 0; p < LAT_TRACE_POINT_MAX; p++) {
+        delta_ms[p] = -1;
+    }
+    uint32_t head = __atomic_load_n(&s_seq, __ATOMIC_ACQUIRE);
+    uint32_t first = lat_trace_first(head);
+    lat_trace_entry_t entry;
+
+    // 找到最近一次会话的起点
+    uint32_t start = 0;
+    uint32_t t0 = 0;
+    for (uint32_t seq = head; seq >= first && seq != 0; seq--) {
+        if (lat_trace_read(seq, &entry) && entry.point == LAT_TRACE_UART_RX) {
+            start = seq;
+            t0 = entry.ts_us;
+            break;
+        }
+    }
+    if (start == 0) {
+        return false;
+    }
+    for (uint32_t seq = start; seq <= head; seq++) {
+        if (!lat_trace_read(seq, &entry)) {
+            continue;
+        }
+        if (entry.point == LAT_TRACE_UART_RX && seq != start) {
+            break;
+        }
+        // 每个点取会话内第一次出现
+        if (delta_ms[entry.point] < 0) {
+            delta_ms[entry.point] = (int32_t)((entry.ts_us - t0) / 1000);
+        }
+    }
+    return true;
+}
+
+const char *lat_trace_point_name(lat_trace_point_t point)
+{
+    return point < LAT_TRACE_POINT_MAX ? s_point_name[point] : "?";
+}
+
+int lat_trace_summary(char *buf, size_t size)
+{
+    int32_t delta_ms[LAT_TRACE_POINT_MAX];
+    lat_trace_last(delta_ms);
+
+    int len = snprintf(buf, size, "{\"latency_ms\":{");
+    for (int p = 1; p < LAT_TRACE_POINT_MAX && len > 0 && (size_t)len < size; p++) {
+        len += snprintf(buf + len, size - len, "%s\"%s\":%d", p > 1 ? "," : "", s_point_name[p], (int)delta_ms[p]);
+    }
+    if (len > 0 && (size_t)len < size) {
+        len += snprintf(buf + len, size - len, "}}");
+    }
+    return ((size_t)len < size) ? len : (int)size - 1;
+}
+
+void lat_trace_report(void)
+{
+    char summary[192];
+    int len = lat_trace_summary(summary, sizeof(summary));
+    ESP_LOGI(TAG, "Capture->upload latency: %s", summary);
+#if LAT_TRACE_MQTT_REPORT
+    if (len > 0 && gs_mqtt_connect_status()) {
+        gs_mqtt_publish(LAT_TRACE_MQTT_TOPIC, (uint8_t *)summary, (uint16_t)len, GS_MQTT_QOS0, 0);
+    }
+#endif
+}
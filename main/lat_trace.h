@@ -0,0 +1,47 @@
+#ifndef LAT_TRACE_H
+#define LAT_TRACE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+// 图传链路（MCU 0x1C -> 0x27）上的打点位置
+typedef enum {
+    LAT_TRACE_UART_RX = 0,      // 收到 MCU 图传命令，开始一次会话
+    LAT_TRACE_FRAME_SOF,        // usb_stream 收到一帧的第一包
+    LAT_TRACE_FRAME_EOF,        // usb_stream 收齐一帧
+    LAT_TRACE_FB_GET,           // 取到待上传的帧（arg=1 表示来自预录环）
+    LAT_TRACE_HTTP_CONNECT,     // HTTP 连接就绪（open 返回）
+    LAT_TRACE_HTTP_BODY_DONE,   // 请求体写完
+    LAT_TRACE_HTTP_RESPONSE,    // 收到响应头（arg 为状态码）
+    LAT_TRACE_RESULT_TX,        // 发出 0x27 结果，结束会话（arg 为结果码）
+    LAT_TRACE_POINT_MAX,
+} lat_trace_point_t;
+
+// 打点，无锁，可在任意任务中调用；除 UART_RX 外仅在会话进行中记录
+void lat_trace_mark(lat_trace_point_t point, uint32_t arg);
+
+// 打印环中的全部记录
+void lat_trace_dump(void);
+
+// 最近一次会话中各点相对 UART_RX 的耗时（ms，未到达为 -1），没有会话时返回 false
+bool lat_trace_last(int32_t delta_ms[LAT_TRACE_POINT_MAX]);
+
+// 打点位置的名称，与摘要 JSON 中的键一致
+const char *lat_trace_point_name(lat_trace_point_t point);
+
+// 生成最近一次会话中各点相对 UART_RX 的耗时（JSON，单位 ms，未到达为 -1），返回长度
+int lat_trace_summary(char *buf, size_t size);
+
+// 打印最近一次会话的摘要，并在 MQTT 已连接时上报
+void lat_trace_report(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LAT_TRACE_H
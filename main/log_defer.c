@@ -0,0 +1,171 @@
+// log_defer.c
+// 延迟日志输出：esp_log 的 vprintf 改为格式化进环形缓冲，写任务在空闲时输出到控制台
+#include "log_defer.h"
+#include <stdio.h>
+#include <string.h>
+#include <stdarg.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_system.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/ringbuf.h"
+#include "cJSON.h"
+#include "cc_event.h"
+#include "cc_hal_os.h"
+#include "gs_mqtt.h"
+
+static const char *TAG = "log_defer";
+
+#define LOG_DEFER_TASK_STACK    2560
+#define LOG_DEFER_TASK_PRIO     1       // 只高于 idle，不与业务任务抢 CPU
+
+static RingbufHandle_t s_ring = NULL;
+static TaskHandle_t s_writer = NULL;
+static vprintf_like_t s_orig_vprintf = vprintf;
+static uint32_t s_dropped = 0;
+
+#if CONFIG_LOG_DEFER
+static int log_defer_vprintf(const char *fmt, va_list args)
+{
+    if (!s_ring || xPortInIsrContext() || xTaskGetSchedulerState() != taskSCHEDULER_RUNNING ||
+        xTaskGetCurrentTaskHandle() == s_writer) {
+        return s_orig_vprintf(fmt, args);
+    }
+
+    char line[CONFIG_LOG_DEFER_LINE_MAX];
+    int len = vsnprintf(line, sizeof(line), fmt, args);
+    if (len <= 0) {
+        return len;
+    }
+    if (len >= (int)sizeof(line)) {
+        // 截断的行保留换行，避免与下一行粘连
+        len = sizeof(line) - 1;
+        line[len - 1] = '\n';
+    }
+    if (xRingbufferSend(s_ring, line, len, 0) != pdTRUE) {
+        __atomic_add_fetch(&s_dropped, 1, __ATOMIC_RELAXED);
+    }
+    return len;
+}
+#endif
+
+// 写出缓冲内已有的日志，返回写出的条数
+static size_t log_defer_drain(TickType_t wait)
+{
+    size_t count = 0;
+    size_t size;
+    char *item;
+    while ((item = xRingbufferReceive(s_ring, &size, count ? 0 : wait)) != NULL) {
+        fwrite(item, 1, size, stdout);
+        vRingbufferReturnItem(s_ring, item);
+        count++;
+    }
+    return count;
+}
+
+#if CONFIG_LOG_DEFER
+static void log_defer_task(void *arg)
+{
+    uint32_t reported = 0;
+    while (1) {
+        if (log_defer_drain(portMAX_DELAY)) {
+            fflush(stdout);
+        }
+        uint32_t dropped = __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+        if (dropped != reported) {
+            // 写任务自身的日志直接输出
+            ESP_LOGW(TAG, "%u log lines dropped", (unsigned)(dropped - reported));
+            reported = dropped;
+        }
+    }
+}
+
+static void log_defer_shutdown(void)
+{
+    log_defer_flush();
+}
+#endif
+
+void log_defer_flush(void)
+{
+    if (s_ring) {
+        log_defer_drain(0);
+        fflush(stdout);
+    }
+}
+
+uint32_t log_defer_dropped(void)
+{
+    return __atomic_load_n(&s_dropped, __ATOMIC_RELAXED);
+}
+
+static bool log_level_parse(const char *str, esp_log_level_t *level)
+{
+    static const char *const names[] = {"none", "error", "warn", "info", "debug", "verbose"};
+    for (size_t i = 0; i < sizeof(names) / sizeof(names[0]); i++) {
+        if (strcmp(str, names[i]) == 0) {
+            *level = (esp_log_level_t)i;
+            return true;
+        }
+    }
+    return false;
+}
+
+// 云端下发日志级别
+static void log_level_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGE(TAG, "level msg: json error");
+        return;
+    }
+    cJSON *tag_obj = cJSON_GetObjectItem(root, "tag");
+    cJSON *level_obj = cJSON_GetObjectItem(root, "level");
+    esp_log_level_t level;
+    if (cJSON_IsString(level_obj) && log_level_parse(level_obj->valuestring, &level)) {
+        const char *tag = cJSON_IsString(tag_obj) ? tag_obj->valuestring : "*";
+        esp_log_level_set(tag, level);
+        ESP_LOGW(TAG, "log level %s => %s", tag, level_obj->valuestring);
+    } else {
+        ESP_LOGE(TAG, "level msg: field error");
+    }
+    cJSON_Delete(root);
+}
+
+static void log_defer_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(LOG_DEFER_TOPIC_LEVEL, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t log_defer_init(void)
+{
+    gs_mqtt_register_topic_msg_cb(LOG_DEFER_TOPIC_LEVEL, log_level_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, log_defer_event_handler);
+
+#if CONFIG_LOG_DEFER
+    if (s_ring) {
+        return ESP_OK;
+    }
+    s_ring = xRingbufferCreate(CONFIG_LOG_DEFER_BUF_SIZE, RINGBUF_TYPE_NOSPLIT);
+    if (!s_ring) {
+        ESP_LOGE(TAG, "no memory for log buffer");
+        return ESP_ERR_NO_MEM;
+    }
+    // 最低优先级的后台输出，栈放 PSRAM
+    if (cc_hal_os_task_create_caps(log_defer_task, "log_defer", LOG_DEFER_TASK_STACK, NULL, LOG_DEFER_TASK_PRIO,
+                                   CC_OS_STACK_PSRAM, &s_writer) != CC_OK) {
+        vRingbufferDelete(s_ring);
+        s_ring = NULL;
+        ESP_LOGE(TAG, "writer task create failed");
+        return ESP_ERR_NO_MEM;
+    }
+    esp_register_shutdown_handler(log_defer_shutdown);
+    s_orig_vprintf = esp_log_set_vprintf(log_defer_vprintf);
+    ESP_LOGI(TAG, "deferred log output, %u bytes buffer", (unsigned)CONFIG_LOG_DEFER_BUF_SIZE);
+#endif
+    return ESP_OK;
+}
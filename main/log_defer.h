@@ -0,0 +1,44 @@
+/**
+ * @file log_defer.h
+ * @brief 延迟日志输出：ESP_LOGx 格式化后放入环形缓冲，由低优先级任务写控制台
+ *
+ * 115200 波特率下一行日志要阻塞调用者数毫秒，接管 esp_log 的输出后生产者只做一次格式化和拷贝，
+ * 缓冲满时丢弃并计数，不等待。中断、调度器启动前及写任务自身的日志仍直接输出。
+ *
+ * 运行时日志级别可经 MQTT 下发：topic LOG_DEFER_TOPIC_LEVEL，
+ * {"tag":"uart_comm","level":"debug"}，tag 省略或为 "*" 时设置全部模块。
+ * 编译期高于 CONFIG_LOG_MAXIMUM_LEVEL（uart/、gs_img/ 下为 CONFIG_MAIN_HOT_LOG_LEVEL）的日志已被去掉，调高也不会出现。
+ */
+
+#ifndef LOG_DEFER_H
+#define LOG_DEFER_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LOG_DEFER_TOPIC_LEVEL   "/service/log"
+
+/**
+ * @brief 创建缓冲和写任务并接管 esp_log 输出，须在 cc_event_init() 之后调用
+ */
+esp_err_t log_defer_init(void);
+
+/**
+ * @brief 在调用者上下文中写出缓冲内的全部日志（重启前等场合）
+ */
+void log_defer_flush(void);
+
+/**
+ * @brief 因缓冲满丢弃的日志行数
+ */
+uint32_t log_defer_dropped(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_DEFER_H
@@ -11,6 +11,7 @@
 #include "esp_err.h"
 #include "esp_log.h"
 #include "nvs_flash.h"
+#include "esp_timer.h"
 
 // 项目相关头文件
 #include "cc_log.h"
@@ -21,13 +22,21 @@
 #include "cc_timer.h"
 #include "cc_tmr_task.h"
 #include "cc_http.h"
+#include "cc_sched.h"
+#include "cc_worker.h"
 #include "gs_main.h"
 #include "product.h"
 #include "gs_mqtt.h"
 #include "img_upload.h"
+#include "img_upload_queue.h"
+#include "img_fanout.h"
+#include "img_clip.h"
 #include "gs_bind.h"
 #include "gs_device.h"
 #include "uvc_camera.h"
+#include "call.h"
+#include "img_motion.h"
+#include "img_detect.h"
 #include "gs_wifi.h"
 
 // UART 通信头文件
@@ -50,10 +59,30 @@
 
 // img_transfer 模块头文件
 #include "img_transfer.h"
+#include "mcu_ota.h"
 
 // 新增：状态上传模块头文件
 #include "state_report.h"
 
+// 启动依赖图
+#include "boot_graph.h"
+
+// Wi-Fi 省电档位
+#include "power_profile.h"
+#include "board_power.h"
+#include "coex_policy.h"
+#include "conn_mgr.h"
+#include "uplink_id.h"
+#include "log_defer.h"
+#include "evt_log.h"
+#include "sys_stats.h"
+#include "metrics.h"
+#include "power_fail.h"
+#include "crash_dump.h"
+#include "tunables.h"
+#include "hot_profile.h"
+#include "pipe_bench.h"
+
 static const char *TAG = "app_main";
 
 // 判断 MQTT “出生消息”是否发送成功
@@ -81,39 +110,127 @@ static void network_task(void *arg)
         cc_http_run(ms);
         cc_tmr_task_run(ms);
 
-        vTaskDelay(pdMS_TO_TICKS(10));
+        // 睡到最近的到期时间，有新工作投递时被 cc_sched_wakeup() 提前唤醒
+        cc_sched_wait(cc_sched_next_ms());
     }
 }
 
-/**
- * @brief 当两条 MQTT 出生消息都成功后，将在这里启动一次异步任务
+/*
+ * 启动依赖图：
+ *   net(事件) ──> time（只发起，结果由 GET_TIME_EVENT 通知）
+ *   mqtt(事件) + storage ──> cloud
+ *   storage（无依赖，挂载暂存分区、启动上传队列与录像，UART 打开之后才执行）
+ *   camera（无依赖，开机即枚举，与联网并行）
+ * license/MQTT host/连接仍由 gs_mqtt 按事件推进；读时间的地方都读缓存的时钟，不等网络。
  */
-static void mqtt_done_task(void *arg)
-{
-    ESP_LOGI(TAG, "MQTT birth messages done. Starting time update...");
+static boot_graph_id_t s_boot_net;      // 拿到 IP
+static boot_graph_id_t s_boot_mqtt;     // 两条出生消息都已发出
+static boot_graph_id_t s_boot_cloud;
+static boot_graph_id_t s_boot_storage;  // 上传队列与录像的暂存分区
 
-    // 1) 启动时间更新
-    esp_err_t err = get_time_start_update(); 
+static esp_err_t boot_time_update(void *arg)
+{
+    esp_err_t err = get_time_start_update();
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to start time update (err=0x%x)", err);
     }
+    return err;
+}
 
-    // 2) 阻塞等待(最多等5秒)，看看是否成功
-    bool success = get_time_wait_done(5000);
-    if (success) {
-        ESP_LOGI(TAG, "Time update succeeded, valid UTC/timezone now.");
-    } else {
-        ESP_LOGW(TAG, "Time update failed or timed out, using old(0) value...");
-    }
-
-    // 3) 无论成功/失败，这里都认为已经连接云服务器 => 发送 0x23(0x04) 到 MCU
+static void cloud_connected(void)
+{
+    // 无论时间更新成功/失败，这里都认为已经连接云服务器 => 发送 0x23(0x04) 到 MCU
     net_sta_update_status(NET_STATUS_CONNECTED_SERVER);
 
-    // 4) 启动摄像头
+    // 后台预先建立图片上传连接，图传时省去握手
+    img_upload_warmup();
+    img_upload_queue_kick();   // 联网后补传 flash 中暂存的图片
+    img_clip_kick();
+}
+
+static esp_err_t boot_cloud_ready(void *arg)
+{
+    cloud_connected();
+    boot_graph_dump();
+    return ESP_OK;
+}
+
+static esp_err_t boot_storage_init(void *arg)
+{
+    // 挂载暂存分区较慢，放到 UART 打开之后；未就绪时入队返回 ESP_ERR_INVALID_STATE，补传由 boot_cloud 触发
+    esp_err_t err = img_upload_queue_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "img_upload_queue_init failed");
+        return err;
+    }
+    // 暂存分区由上传队列挂载，须在其后初始化
+    err = img_clip_init();
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "img_clip_init failed");
+    }
+    // 回放上次断电时保存的数据，各钩子所在模块（状态上报、上传队列）须已初始化
+    power_fail_init();
+    return err;
+}
+
+static esp_err_t boot_camera_start(void *arg)
+{
+    // 枚举、PROBE/COMMIT 与预热都在联网期间完成，返回时已有可用帧
     uvc_camera_start();
+#if CONFIG_IMG_MOTION
+    if (img_motion_start() != ESP_OK) {
+        ESP_LOGW(TAG, "motion detection disabled");
+    }
+#endif
+    return ESP_OK;
+}
 
-    // 任务结束
-    vTaskDelete(NULL);
+static void boot_graph_setup(void)
+{
+    boot_graph_id_t time_id, camera_id;
+    boot_graph_node_t net = { .name = "net" };
+    boot_graph_node_t mqtt = { .name = "mqtt" };
+
+    ESP_ERROR_CHECK(boot_graph_add(&net, &s_boot_net));
+    ESP_ERROR_CHECK(boot_graph_add(&mqtt, &s_boot_mqtt));
+
+    boot_graph_node_t storage = {
+        .name = "boot_storage",
+        .fn = boot_storage_init,
+    };
+    ESP_ERROR_CHECK(boot_graph_add(&storage, &s_boot_storage));
+
+    boot_graph_node_t time = {
+        .name = "boot_time",
+        .fn = boot_time_update,
+        .deps = BOOT_GRAPH_DEP(s_boot_net),
+    };
+    ESP_ERROR_CHECK(boot_graph_add(&time, &time_id));
+
+    boot_graph_node_t cloud = {
+        .name = "boot_cloud",
+        .fn = boot_cloud_ready,
+        .deps = BOOT_GRAPH_DEP(s_boot_mqtt) | BOOT_GRAPH_DEP(s_boot_storage),
+    };
+    ESP_ERROR_CHECK(boot_graph_add(&cloud, &s_boot_cloud));
+
+    boot_graph_node_t camera = {
+        .name = "boot_camera",
+        .fn = boot_camera_start,
+    };
+    ESP_ERROR_CHECK(boot_graph_add(&camera, &camera_id));
+}
+
+static void boot_event_handler(void *arg, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (base_event == GS_WIFI_EVENT && id == GS_WIFI_EVENT_STA_GOT_IP) {
+        boot_graph_done(s_boot_net, ESP_OK);
+    } else if (base_event == GET_TIME_EVENT && id == GET_TIME_EVENT_VALID) {
+        // 先连上云、后拿到时间时，补发一次带时间的 0x23
+        if (net_sta_get_status() == NET_STATUS_CONNECTED_SERVER) {
+            uart_comm_send_network_status(true);
+        }
+    }
 }
 
 /**
@@ -137,10 +254,17 @@ static void birth_msg_callback(uint8_t msg_type, uint8_t status)
         }
     }
 
-    // 当两条都成功后，就创建任务执行后续时间更新、状态更新和摄像头启动
-    if (s_version_msg_ok && s_rssi_msg_ok) {
-        ESP_LOGI(TAG, "MQTT birth messages all sent => create mqtt_done_task...");
-        xTaskCreate(mqtt_done_task, "mqtt_done_task", 4096, NULL, 5, NULL);
+    if (!s_version_msg_ok || !s_rssi_msg_ok) {
+        return;
+    }
+    if (!boot_graph_is_done(s_boot_cloud)) {
+        // 首次上线：由启动图执行 boot_cloud
+        ESP_LOGI(TAG, "MQTT birth messages all sent => boot graph continues");
+        boot_graph_done(s_boot_mqtt, ESP_OK);
+    } else if (msg_type == 1) {
+        // 重连后的出生消息：时间与摄像头已就绪，只需重新上报状态和补传
+        ESP_LOGI(TAG, "MQTT birth messages sent after reconnect");
+        cloud_connected();
     }
 }
 
@@ -157,88 +281,42 @@ static void do_wifi_connect_or_config(void)
         net_sta_update_status(NET_STATUS_CONNECTING_ROUTER);
         // 注意：当 Wi-Fi 连接成功后，应在 Wi-Fi 事件回调中调用 net_sta_update_status(NET_STATUS_CONNECTED_ROUTER)
     } else {
+#if CONFIG_GS_BIND_QR_ONLY
+        ESP_LOGI(TAG, "[do_wifi_connect_or_config] No Wi-Fi config => start QR provisioning");
+        gs_bind_start_cfg_mode(GS_BIND_CFG_MODE_QR);
+#elif CONFIG_GS_BIND_QR
+        ESP_LOGI(TAG, "[do_wifi_connect_or_config] No Wi-Fi config => start AP+BLE+QR provisioning");
+        gs_bind_start_cfg_mode(GS_BIND_CFG_MODE_AP | GS_BIND_CFG_MODE_BLE | GS_BIND_CFG_MODE_QR);
+#else
         ESP_LOGI(TAG, "[do_wifi_connect_or_config] No Wi-Fi config => start AP+BLE provisioning");
         gs_bind_start_cfg_mode(GS_BIND_CFG_MODE_AP | GS_BIND_CFG_MODE_BLE);
+#endif
         net_sta_update_status(NET_STATUS_NOT_CONFIGURED);
     }
 }
 
 /**
- * @brief UART 数据包回调：处理各种指令（0x01/0x1A/0x03/0x04/0x12/0x1C/...）
+ * @brief 命令表中 0x01（WiFi 配网）的处理函数，返回后由命令表回复 0x02
  */
-static void uart_packet_received(const uart_packet_t *packet)
+uint8_t app_uart_wifi_config(const uart_packet_t *packet)
 {
-    ESP_LOGI(TAG, "uart_packet_received: CMD=0x%02X", packet->command);
-
-    switch (packet->command) {
-
-    // 0x01: WiFi 配网指令
-    case CMD_WIFI_CONFIG: {
-        ESP_LOGI(TAG, "Got CMD_WIFI_CONFIG (0x01) => do_wifi_connect_or_config...");
-        do_wifi_connect_or_config();
+    ESP_LOGI(TAG, "Got CMD_WIFI_CONFIG (0x01) => do_wifi_connect_or_config...");
+    do_wifi_connect_or_config();
 #if FIRMWARE_VERSION_MAJOR >= 9
-        net_sta_start_monitor();
+    net_sta_start_monitor();
 #endif
-        vTaskDelay(pdMS_TO_TICKS(1000));
-        ESP_LOGI(TAG, "WiFi connect/config done? -> send CMD_WIFI_RESPONSE (0x02) ack => success=WIFI_CONFIG_SUCCESS (0x00)");
-        esp_err_t ret = uart_comm_send_wifi_response(WIFI_CONFIG_SUCCESS);
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send WiFi configuration response");
-        }
-        break;
-    }
-
-    // 0x1A: 退出配网
-    case CMD_EXIT_CONFIG: {
-        ESP_LOGI(TAG, "Got CMD_EXIT_CONFIG (0x1A) => stop provisioning");
-        gs_bind_stop_cfg_mode();
-        esp_err_t ret = uart_comm_send_exit_config_ack();
-        if (ret != ESP_OK) {
-            ESP_LOGE(TAG, "Failed to send Exit Config ACK");
-        } else {
-            ESP_LOGI(TAG, "Exit Config ACK sent successfully, waiting 3 seconds...");
-            vTaskDelay(pdMS_TO_TICKS(3000));
-        }
-        break;
-    }
-
-    // 0x23: 网络状态（WiFi→MCU，通常可忽略）
-    case CMD_NETWORK_STATUS: {
-        ESP_LOGI(TAG, "Received CMD_NETWORK_STATUS=0x23 from MCU (usually ignored)");
-        break;
-    }
-
-    // 0x03 / 0x04: 转交给 msg_upload 模块
-    case 0x03:
-    case 0x04:
-        ESP_LOGI(TAG, "Got CMD=0x%02X => forward to msg_upload...", packet->command);
-        msg_upload_uart_callback(packet);
-        break;
-
-    // 0x12: 远程开锁应答（MCU→WiFi）
-    case 0x12:
-        ESP_LOGI(TAG, "Got CMD=0x12 => unlock_handle_mcu_packet");
-        unlock_handle_mcu_packet(packet);
-        break;
-
-    // 0x1C: 图传设置（MCU→WiFi），交由 img_transfer 模块处理
-    case CMD_IMG_TRANSFER: {
-        ESP_LOGI(TAG, "Got CMD_IMG_TRANSFER (0x1C) => forward to img_transfer");
-        img_transfer_handle_uart_packet(packet);
-        break;
-    }
-
-    // 新增：0x42 状态上传，由 state_report 模块处理
-    case CMD_STATE_REPORT: {
-        ESP_LOGI(TAG, "Got CMD_STATE_REPORT (0x42) => forward to state_report module");
-        state_report_handle_uart_packet(packet);
-        break;
-    }
+    vTaskDelay(pdMS_TO_TICKS(1000));
+    return WIFI_CONFIG_SUCCESS;
+}
 
-    default:
-        ESP_LOGW(TAG, "Unknown cmd=0x%02X", packet->command);
-        break;
-    }
+/**
+ * @brief 命令表中 0x1A（退出配网）的处理函数，0x1B 应答已由命令表先行回复
+ */
+uint8_t app_uart_exit_config(const uart_packet_t *packet)
+{
+    ESP_LOGI(TAG, "Got CMD_EXIT_CONFIG (0x1A) => stop provisioning");
+    gs_bind_stop_cfg_mode();
+    return UART_CMD_OK;
 }
 
 void app_main(void)
@@ -250,25 +328,62 @@ void app_main(void)
         ret = nvs_flash_init();
     }
     ESP_ERROR_CHECK(ret);
+    boot_graph_mark("nvs");
 
     // 2. 初始化项目核心组件
     CC_LOGI(TAG, "=== cc_init from project ===");
     cc_hal_sys_init();
     cc_hal_kvs_init();
+    // 上行消息的 epoch 须在第一条消息之前落盘
+    if (uplink_id_init() != ESP_OK) {
+        ESP_LOGE(TAG, "uplink_id_init failed");
+    }
     cc_hal_wifi_init();
     cc_event_init();
+    log_defer_init();
+    evt_log_init();
+    evt_log_httpd_register();
+    sys_stats_init();
+    sys_stats_httpd_register();
+    metrics_init();
+    // 在各模块登记参数之前载入远程下发的值
+    tunables_init();
+    hot_profile_init();
     cc_timer_init();
     cc_tmr_task_init();
+    cc_http_init();
+    cc_sched_init();
+    cc_worker_init();
+    // HTTP、OTA、MQTT 共用连接名额，须在各网络模块登记连接之前
+    if (conn_mgr_init() != ESP_OK) {
+        ESP_LOGE(TAG, "conn_mgr_init failed");
+    }
+    boot_graph_mark("cc_core");
 
+    // 配网（AP/BLE）只在收到 0x01 且无配置时才启动，OTA 在收到升级命令时才建立连接
     gs_init("1.21.0.0", "1.0.0");
     product_init();
     gs_device_init();
+    boot_graph_mark("gs");
 
     // 3. 初始化 get_time 模块
     get_time_init();
 
-    // 4. 启动网络循环任务
-    xTaskCreate(network_task, "Network Task", 4096, NULL, 5, NULL);
+    // 摄像头的同步对象先建好，枚举完成前的取帧请求等待就绪而不是直接失败
+    uvc_camera_init();
+    // 开发板上摄像头由 VBUS 开关供电，须在启动依赖图启动摄像头之前上电
+    if (board_power_init() != ESP_OK) {
+        ESP_LOGE(TAG, "board_power_init failed");
+    }
+
+    // 启动依赖图，节点在 app_main 其余初始化完成后开始调度
+    boot_graph_setup();
+    cc_event_register_handler(GS_WIFI_EVENT, boot_event_handler);
+    cc_event_register_handler(GET_TIME_EVENT, boot_event_handler);
+    boot_graph_mark("graph");
+
+    // 4. 启动网络循环任务，与 Wi-Fi/lwIP 同在 core 0，core 1 留给 USB 采集
+    xTaskCreatePinnedToCore(network_task, "Network Task", 4096, NULL, 5, NULL, 0);
 
     // 5. 初始化 net_sta 模块（仅当固件版本 >= 9 时启用联网状态管理）
     if (FIRMWARE_VERSION_MAJOR >= 9) {
@@ -291,24 +406,63 @@ void app_main(void)
     // 注册 MQTT 出生消息回调
     gs_mqtt_register_birth_callback(birth_msg_callback);
 
-    // 初始化图片上传模块
+    // 初始化图片上传模块（只记下 URL、建锁，HTTP 连接在首次上传或 warmup 时才建立）
+#if CONFIG_PIPE_BENCH
+    // 基准测试上传到主机上的 tools/pipe_bench.py serve
+    const char *server_url = CONFIG_PIPE_BENCH_UPLOAD_URL;
+#else
     const char *server_url = "http://120.25.207.32:3466/upload/ajaxuploadfile.php";
+#endif
     ret = img_upload_init(server_url);
     if (ret != ESP_OK) {
         ESP_LOGE(TAG, "img_upload_init failed");
     } else {
         ESP_LOGI(TAG, "img_upload module initialized, URL: %s", server_url);
     }
+    // 第二个上传目的地（对象存储），与主上传服务器并行上传同一帧
+    if (strlen(CONFIG_IMG_FANOUT_URL) > 0) {
+        img_fanout_header_t auth = { "Authorization", CONFIG_IMG_FANOUT_AUTH };
+        img_fanout_dest_config_t dest = {
+            .name = "oss",
+            .url = CONFIG_IMG_FANOUT_URL,
+            .headers = &auth,
+            .header_num = strlen(CONFIG_IMG_FANOUT_AUTH) > 0 ? 1 : 0,
+        };
+        if (img_fanout_add_dest(&dest) != ESP_OK) {
+            ESP_LOGE(TAG, "img_fanout_add_dest failed");
+        }
+    }
 
-    // 6. 初始化 UART
-    ret = uart_comm_init();
+    // 对讲：预分配缓冲、建好收发任务并登记信令，UAC 在摄像头启动时配置
+    ret = call_init();
     if (ret != ESP_OK) {
-        ESP_LOGE(TAG, "UART communication init failed");
-    } else {
-        ESP_LOGI(TAG, "UART communication initialized");
+        ESP_LOGE(TAG, "call_init failed");
     }
-    uart_comm_register_callback(uart_packet_received);
 
+    // 门铃事件的目标检测：只建任务，模型在第一次检测时加载
+    ret = img_detect_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "img_detect_init failed");
+    }
+
+    // 空闲时 Wi-Fi modem sleep，须在 UART 收到第一条命令前就绪
+    ret = power_profile_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "power_profile_init failed");
+    }
+    // 上传与 OTA 期间优先 Wi-Fi，BLE 配网期间优先 BLE
+    ret = coex_policy_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "coex_policy_init failed");
+    }
+    // 上次崩溃的转储在启动稳定后低优先级上传，不影响门铃事件
+    ret = crash_dump_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "crash_dump_init failed");
+    }
+    boot_graph_mark("upload");
+
+    // 6. UART 命令的处理模块先就绪，再打开 UART，收到的第一条命令就能处理
     // 新增：初始化状态上报模块（包括重传与缓存机制）
     ret = state_report_init();
     if (ret != ESP_OK) {
@@ -340,9 +494,29 @@ void app_main(void)
     } else {
         ESP_LOGI(TAG, "img_transfer_init succeeded");
     }
+    boot_graph_mark("handlers");
 
-    // 7. 主循环（空转）
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(1000));
+    ret = uart_comm_init();
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART communication init failed");
+    } else {
+        ESP_LOGI(TAG, "UART communication initialized");
     }
+#if CONFIG_MCU_OTA
+    if (mcu_ota_init() != ESP_OK) {
+        ESP_LOGE(TAG, "mcu_ota_init failed");
+    }
+#endif
+    boot_graph_mark("uart");
+
+    // 开始调度：摄像头立即开始枚举、挂载暂存分区，时间更新等待拿到 IP
+    boot_graph_start();
+    ESP_LOGI(TAG, "UART link up at %lu ms", (unsigned long)(esp_timer_get_time() / 1000));
+#if CONFIG_PIPE_BENCH
+    if (pipe_bench_start() != ESP_OK) {
+        ESP_LOGE(TAG, "pipe_bench_start failed");
+    }
+#endif
+
+    // 7. 初始化完成，返回后主任务被删除，不再周期唤醒 CPU
 }
@@ -0,0 +1,221 @@
+// metrics.c
+// 运行指标登记与周期上报，记录路径只有原子操作
+#include "metrics.h"
+
+#if CONFIG_METRICS
+
+#include <string.h>
+#include <stdlib.h>
+#include <inttypes.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "cbor_writer.h"
+#include "gs_mqtt.h"
+
+static const char *TAG = "metrics";
+
+#define METRICS_CBOR_SIZE       2048
+
+static portMUX_TYPE s_list_lock = portMUX_INITIALIZER_UNLOCKED;
+static metrics_head_t *s_list = NULL;
+static SemaphoreHandle_t s_export_lock = NULL;
+static int64_t s_last_export_us = 0;
+// 导出时直方图的快照，由 s_export_lock 保护
+static uint32_t s_snap[METRICS_HIST_BUCKETS];
+
+void metrics_register(metrics_head_t *m)
+{
+    portENTER_CRITICAL(&s_list_lock);
+    if (!m->registered) {
+        m->registered = true;
+        m->next = s_list;
+        s_list = m;
+    }
+    portEXIT_CRITICAL(&s_list_lock);
+}
+
+static inline uint32_t metrics_hist_index(uint32_t v)
+{
+    if (v >= (1UL << METRICS_HIST_MAX_BITS)) {
+        v = (1UL << METRICS_HIST_MAX_BITS) - 1;
+    }
+    if (v < METRICS_HIST_SUB) {
+        return v;
+    }
+    uint32_t e = 31 - __builtin_clz(v);
+    return (e - METRICS_HIST_SUB_BITS + 1) * METRICS_HIST_SUB + ((v >> (e - METRICS_HIST_SUB_BITS)) & (METRICS_HIST_SUB - 1));
+}
+
+void metrics_hist_record(metrics_hist_t *h, uint32_t value)
+{
+    __atomic_fetch_add(&h->buckets[metrics_hist_index(value)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&h->sum, value, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_load_n(&h->max, __ATOMIC_RELAXED);
+    while (value > max && !__atomic_compare_exchange_n(&h->max, &max, value, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+    __atomic_fetch_add(&h->count, 1, __ATOMIC_RELAXED);
+}
+
+// 快照中第 permille‰ 个样本所在桶的下界
+static uint32_t metrics_snap_percentile(uint32_t total, uint32_t permille)
+{
+    uint32_t rank = (uint32_t)(((uint64_t)total * permille + 999) / 1000);
+    uint32_t seen = 0;
+    for (uint32_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        seen += s_snap[i];
+        if (seen >= rank && seen) {
+            return metrics_hist_bucket_low(i);
+        }
+    }
+    return 0;
+}
+
+static bool metrics_has_delta(const metrics_head_t *m)
+{
+    switch (m->kind) {
+    case METRICS_COUNTER: {
+        const metrics_counter_t *c = (const metrics_counter_t *)m;
+        return __atomic_load_n(&c->value, __ATOMIC_RELAXED) != c->exported;
+    }
+    case METRICS_HIST:
+        return __atomic_load_n(&((const metrics_hist_t *)m)->count, __ATOMIC_RELAXED) != 0;
+    default:
+        return true;
+    }
+}
+
+// 取走直方图的增量并写出，计数与桶在并发记录时可能差一两次，次数以桶的合计为准
+static void metrics_write_hist(cbor_writer_t *w, metrics_hist_t *h)
+{
+    uint32_t total = 0;
+    uint32_t used = 0;
+    __atomic_exchange_n(&h->count, 0, __ATOMIC_RELAXED);
+    uint32_t sum = __atomic_exchange_n(&h->sum, 0, __ATOMIC_RELAXED);
+    uint32_t max = __atomic_exchange_n(&h->max, 0, __ATOMIC_RELAXED);
+    for (uint32_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        s_snap[i] = __atomic_exchange_n(&h->buckets[i], 0, __ATOMIC_RELAXED);
+        total += s_snap[i];
+        used += s_snap[i] != 0;
+    }
+    cbor_writer_array(w, 6);
+    cbor_writer_text(w, h->head.name);
+    cbor_writer_uint(w, METRICS_HIST);
+    cbor_writer_uint(w, total);
+    cbor_writer_uint(w, sum);
+    cbor_writer_uint(w, max);
+    cbor_writer_array(w, used * 2);
+    for (uint32_t i = 0; i < METRICS_HIST_BUCKETS; i++) {
+        if (s_snap[i]) {
+            cbor_writer_uint(w, i);
+            cbor_writer_uint(w, s_snap[i]);
+        }
+    }
+    ESP_LOGD(TAG, "%s: n=%" PRIu32 " p50=%" PRIu32 " p99=%" PRIu32 " max=%" PRIu32, h->head.name, total,
+             metrics_snap_percentile(total, 500), metrics_snap_percentile(total, 990), max);
+}
+
+static size_t metrics_export(uint8_t *buf, size_t size)
+{
+    int64_t now = esp_timer_get_time();
+    metrics_head_t *list;
+    portENTER_CRITICAL(&s_list_lock);
+    list = s_list;
+    portEXIT_CRITICAL(&s_list_lock);
+
+    // 登记只在表头插入，取到的表头之后的部分不会再变
+    uint32_t n = 0;
+    for (metrics_head_t *m = list; m; m = m->next) {
+        n += metrics_has_delta(m);
+    }
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, size);
+    cbor_writer_map(&w, 4);
+    cbor_writer_uint(&w, 0);
+    cbor_writer_uint(&w, (uint32_t)(now / 1000000));
+    cbor_writer_uint(&w, 1);
+    cbor_writer_uint(&w, (uint32_t)((now - s_last_export_us) / 1000000));
+    cbor_writer_uint(&w, 2);
+    cbor_writer_uint(&w, METRICS_HIST_SUB_BITS);
+    cbor_writer_uint(&w, 3);
+    cbor_writer_array(&w, n);
+    // 增量只在本函数中取走，第一遍有增量的条目第二遍还有；两遍之间才有增量的条目可能占掉名额，被挤掉的留到下一次
+    for (metrics_head_t *m = list; m && n; m = m->next) {
+        if (!metrics_has_delta(m)) {
+            continue;
+        }
+        n--;
+        switch (m->kind) {
+        case METRICS_COUNTER: {
+            metrics_counter_t *c = (metrics_counter_t *)m;
+            uint32_t value = __atomic_load_n(&c->value, __ATOMIC_RELAXED);
+            cbor_writer_array(&w, 3);
+            cbor_writer_text(&w, m->name);
+            cbor_writer_uint(&w, METRICS_COUNTER);
+            cbor_writer_uint(&w, value - c->exported);
+            c->exported = value;
+            break;
+        }
+        case METRICS_GAUGE:
+            cbor_writer_array(&w, 3);
+            cbor_writer_text(&w, m->name);
+            cbor_writer_uint(&w, METRICS_GAUGE);
+            cbor_writer_int(&w, __atomic_load_n(&((metrics_gauge_t *)m)->value, __ATOMIC_RELAXED));
+            break;
+        default:
+            metrics_write_hist(&w, (metrics_hist_t *)m);
+            break;
+        }
+    }
+    s_last_export_us = now;
+    return cbor_writer_finish(&w);
+}
+
+static void metrics_timer_cb(TimerHandle_t timer)
+{
+    // 未连接时不取走增量，并入下一次上报
+    if (!gs_mqtt_connect_status()) {
+        return;
+    }
+    uint8_t *buf = heap_caps_malloc(METRICS_CBOR_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        buf = malloc(METRICS_CBOR_SIZE);
+    }
+    if (!buf) {
+        return;
+    }
+    xSemaphoreTake(s_export_lock, portMAX_DELAY);
+    size_t len = metrics_export(buf, METRICS_CBOR_SIZE);
+    xSemaphoreGive(s_export_lock);
+    if (len) {
+        gs_mqtt_publish(METRICS_TOPIC_POST, buf, (uint16_t)len, GS_MQTT_QOS0, 0);
+    } else {
+        ESP_LOGW(TAG, "Metrics do not fit in %d bytes, this period is lost", METRICS_CBOR_SIZE);
+    }
+    free(buf);
+}
+
+esp_err_t metrics_init(void)
+{
+    if (s_export_lock) {
+        return ESP_OK;
+    }
+    s_export_lock = xSemaphoreCreateMutex();
+    if (!s_export_lock) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_last_export_us = esp_timer_get_time();
+    TimerHandle_t timer = xTimerCreate("metrics", pdMS_TO_TICKS(CONFIG_METRICS_EXPORT_S * 1000UL),
+                                       pdTRUE, NULL, metrics_timer_cb);
+    if (!timer || xTimerStart(timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start export timer");
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "export every %d s", CONFIG_METRICS_EXPORT_S);
+    return ESP_OK;
+}
+
+#endif // CONFIG_METRICS
@@ -0,0 +1,132 @@
+/**
+ * @file metrics.h
+ * @brief 运行指标：计数器、量规和对数-线性延迟直方图，周期经 MQTT 上报增量（CONFIG_METRICS）
+ *
+ * 指标是各模块的静态变量，登记一次后由导出器遍历；记录只做原子操作，不加锁，
+ * 可在任意任务中调用（不可在 ISR 中）：
+ *   static metrics_hist_t s_total_ms = METRICS_HIST_INIT("img_upload.total_ms");
+ *   metrics_register(&s_total_ms.head);
+ *   metrics_hist_record(&s_total_ms, ms);
+ *
+ * 直方图桶：v < 4 各占一桶，其余每个 2 的幂区间等分 4 桶（取桶中点时相对误差 < 12.5%），
+ * v >= 2^24 计入最后一桶；桶号 i 的下界为 metrics_hist_bucket_low(i)。
+ *
+ * 上报负载（CBOR，见 cbor_writer.h）发布到 METRICS_TOPIC_POST：
+ *   {0: 运行秒数, 1: 距上次上报的秒数, 2: 子桶位数, 3: [条目, ...]}
+ *   计数器 [名称, 0, 增量]
+ *   量规   [名称, 1, 当前值]
+ *   直方图 [名称, 2, 次数, 总和, 最大值, [桶号, 次数, 桶号, 次数, ...]]（只列非空桶）
+ * 计数器和直方图都是两次上报之间的增量，没有变化的不上报；MQTT 未连接时这一段的数据并入下一次。
+ */
+
+#ifndef METRICS_H
+#define METRICS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define METRICS_TOPIC_POST          "/event/metrics/post"
+
+#define METRICS_HIST_SUB_BITS       2
+#define METRICS_HIST_SUB            (1 << METRICS_HIST_SUB_BITS)
+#define METRICS_HIST_MAX_BITS       24
+#define METRICS_HIST_BUCKETS        ((METRICS_HIST_MAX_BITS - METRICS_HIST_SUB_BITS + 1) * METRICS_HIST_SUB)
+
+typedef enum {
+    METRICS_COUNTER = 0,
+    METRICS_GAUGE,
+    METRICS_HIST,
+} metrics_kind_t;
+
+typedef struct metrics_head {
+    const char *name;
+    struct metrics_head *next;
+    uint8_t kind;
+    bool registered;
+} metrics_head_t;
+
+typedef struct {
+    metrics_head_t head;
+    uint32_t value;             // 上电以来的累计值
+    uint32_t exported;          // 上次上报时的累计值，仅导出器使用
+} metrics_counter_t;
+
+typedef struct {
+    metrics_head_t head;
+    int32_t value;
+} metrics_gauge_t;
+
+typedef struct {
+    metrics_head_t head;
+    uint32_t count;
+    uint32_t sum;               // 回绕计数，上报周期内不超过 2^32 即可
+    uint32_t max;
+    uint32_t buckets[METRICS_HIST_BUCKETS];
+} metrics_hist_t;
+
+#define METRICS_COUNTER_INIT(n)     { .head = { .name = (n), .kind = METRICS_COUNTER } }
+#define METRICS_GAUGE_INIT(n)       { .head = { .name = (n), .kind = METRICS_GAUGE } }
+#define METRICS_HIST_INIT(n)        { .head = { .name = (n), .kind = METRICS_HIST } }
+
+#if CONFIG_METRICS
+
+/**
+ * @brief 登记指标，重复登记忽略；可在 metrics_init() 之前调用
+ */
+void metrics_register(metrics_head_t *m);
+
+/**
+ * @brief 启动周期上报，须在 gs_mqtt 初始化之后调用
+ */
+esp_err_t metrics_init(void);
+
+void metrics_hist_record(metrics_hist_t *h, uint32_t value);
+
+static inline void metrics_counter_add(metrics_counter_t *c, uint32_t n)
+{
+    __atomic_fetch_add(&c->value, n, __ATOMIC_RELAXED);
+}
+
+static inline void metrics_gauge_set(metrics_gauge_t *g, int32_t value)
+{
+    __atomic_store_n(&g->value, value, __ATOMIC_RELAXED);
+}
+
+#else
+
+static inline void metrics_register(metrics_head_t *m) {}
+static inline esp_err_t metrics_init(void) { return ESP_OK; }
+static inline void metrics_hist_record(metrics_hist_t *h, uint32_t value) {}
+static inline void metrics_counter_add(metrics_counter_t *c, uint32_t n) {}
+static inline void metrics_gauge_set(metrics_gauge_t *g, int32_t value) {}
+
+#endif // CONFIG_METRICS
+
+static inline void metrics_counter_inc(metrics_counter_t *c)
+{
+    metrics_counter_add(c, 1);
+}
+
+/**
+ * @brief 直方图桶号 -> 该桶的下界
+ */
+static inline uint32_t metrics_hist_bucket_low(uint32_t index)
+{
+    if (index < METRICS_HIST_SUB) {
+        return index;
+    }
+    uint32_t shift = index / METRICS_HIST_SUB - 1;
+    return (METRICS_HIST_SUB + index % METRICS_HIST_SUB) << shift;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // METRICS_H
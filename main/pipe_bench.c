@@ -0,0 +1,365 @@
+/**
+ * @file pipe_bench.c
+ * @brief 门铃主链路端到端基准：第二个 UART 按脚本扮演 MCU，统计各阶段耗时、吞吐与堆余量
+ */
+
+#include "pipe_bench.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "uart_config.h"
+#include "uart_parse.h"
+#include "net_sta.h"
+#include "lat_trace.h"
+
+static const char *TAG = "pipe_bench";
+
+#define PIPE_BENCH_UART         CONFIG_PIPE_BENCH_UART_NUM
+#define PIPE_BENCH_RX_BUF       256
+#define PIPE_BENCH_PERIODS_MAX  8
+#define PIPE_BENCH_INFLIGHT     8       // 同时等待结果的命令上限，再多则推迟发送
+#define PIPE_BENCH_POLL_MS      20      // 无数据时的最长等待，也是堆采样间隔
+#define PIPE_BENCH_TASK_STACK   4096
+#define PIPE_BENCH_TASK_PRIO    3
+#define PIPE_BENCH_WAKE_BYTE    0x55    // 唤醒用，不是帧头，接收方解析时丢弃
+
+typedef struct {
+    int64_t sent_us;
+    bool acked;
+} pipe_bench_cmd_t;
+
+typedef struct {
+    uint32_t period_ms;
+    uint32_t sent;
+    uint32_t ok;
+    uint32_t fail;
+    uint32_t timeout;
+    uint32_t deferred;                  // 等待的命令已达上限，推迟发送的次数
+    uint32_t ack_sum_ms;
+    uint32_t ack_max_ms;
+    uint32_t ack_num;
+    uint32_t e2e_ms[CONFIG_PIPE_BENCH_EVENTS];
+    uint32_t e2e_num;
+    uint32_t stage_sum_ms[LAT_TRACE_POINT_MAX];
+    uint32_t stage_num[LAT_TRACE_POINT_MAX];
+    size_t int_low;
+    size_t psram_low;
+} pipe_bench_phase_t;
+
+static pipe_bench_phase_t s_phase;
+static pipe_bench_cmd_t s_cmds[PIPE_BENCH_INFLIGHT];   // 按发送顺序的环
+static uint32_t s_cmd_head = 0;
+static uint32_t s_cmd_num = 0;
+static volatile uint8_t s_net_status = 0;
+static uint8_t s_rx[PIPE_BENCH_RX_BUF];
+static size_t s_rx_len = 0;
+
+static void sim_send(uint8_t command, const uint8_t *data)
+{
+    uart_packet_t packet;
+    uart_packet_build(&packet, command, data);
+    uart_write_bytes(PIPE_BENCH_UART, (const char *)&packet, sizeof(packet));
+}
+
+static void on_ack(void)
+{
+    // 应答按发送顺序回来，记给第一个还没收到应答的命令
+    for (uint32_t i = 0; i < s_cmd_num; i++) {
+        pipe_bench_cmd_t *cmd = &s_cmds[(s_cmd_head + i) % PIPE_BENCH_INFLIGHT];
+        if (!cmd->acked) {
+            uint32_t ms = (uint32_t)((esp_timer_get_time() - cmd->sent_us) / 1000);
+            cmd->acked = true;
+            s_phase.ack_sum_ms += ms;
+            s_phase.ack_num++;
+            if (ms > s_phase.ack_max_ms) {
+                s_phase.ack_max_ms = ms;
+            }
+            return;
+        }
+    }
+}
+
+static void on_result(uint8_t result)
+{
+    if (s_cmd_num == 0) {
+        ESP_LOGW(TAG, "0x27 without a pending command");
+        return;
+    }
+    pipe_bench_cmd_t *cmd = &s_cmds[s_cmd_head];
+    uint32_t ms = (uint32_t)((esp_timer_get_time() - cmd->sent_us) / 1000);
+    // 命令重叠时 lat_trace 的会话已被后一个 0x1C 重新开始，只统计单独的会话
+    int32_t delta_ms[LAT_TRACE_POINT_MAX];
+    if (s_cmd_num == 1 && lat_trace_last(delta_ms)) {
+        for (int p = 1; p < LAT_TRACE_POINT_MAX; p++) {
+            if (delta_ms[p] >= 0) {
+                s_phase.stage_sum_ms[p] += delta_ms[p];
+                s_phase.stage_num[p]++;
+            }
+        }
+    }
+    s_cmd_head = (s_cmd_head + 1) % PIPE_BENCH_INFLIGHT;
+    s_cmd_num--;
+
+    if (result == 0x00) {
+        s_phase.ok++;
+    } else {
+        s_phase.fail++;
+    }
+    if (s_phase.e2e_num < CONFIG_PIPE_BENCH_EVENTS) {
+        s_phase.e2e_ms[s_phase.e2e_num++] = ms;
+    }
+}
+
+// 设备发来的包
+static void on_packet(const uart_packet_t *packet)
+{
+    switch (packet->command) {
+    case CMD_IMG_TRANSFER_ACK:
+        on_ack();
+        break;
+    case CMD_IMG_TRANSFER_RESULT:
+        on_result(packet->data[0]);
+        break;
+    case CMD_NETWORK_STATUS:
+        s_net_status = packet->data[0];
+        break;
+    case CMD_STATE_REPORT: {
+        // 与 MCU 一样回应答，否则设备会重发
+        uint8_t data[6] = {0};
+        data[0] = packet->data[0];
+        data[1] = packet->data[1];
+        sim_send(CMD_STATE_REPORT_ACK, data);
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+static bool on_ext_frame(const uint8_t *frame, size_t len)
+{
+    return true;    // 扩展帧与链路耗时无关，忽略
+}
+
+static const uart_parse_ops_t s_parse_ops = {
+    .on_packet = on_packet,
+    .on_ext_frame = on_ext_frame,
+};
+
+// 读一次串口并处理收到的包，最多等待 wait_ms
+static void sim_poll(uint32_t wait_ms)
+{
+    int n = uart_read_bytes(PIPE_BENCH_UART, s_rx + s_rx_len, sizeof(s_rx) - s_rx_len, pdMS_TO_TICKS(wait_ms));
+    if (n <= 0) {
+        return;
+    }
+    s_rx_len += n;
+    size_t used = uart_parse_packets(s_rx, s_rx_len, &s_parse_ops);
+    if (used == 0 && s_rx_len == sizeof(s_rx)) {
+        used = s_rx_len;    // 缓冲满仍凑不成帧，丢弃重新同步
+    }
+    memmove(s_rx, s_rx + used, s_rx_len - used);
+    s_rx_len -= used;
+}
+
+static void sim_send_capture(void)
+{
+#if CONFIG_PIPE_BENCH_WAKE_MS > 0
+    // 与 MCU 一样先用一个字节的边沿唤醒 light sleep 中的串口
+    const uint8_t wake = PIPE_BENCH_WAKE_BYTE;
+    uart_write_bytes(PIPE_BENCH_UART, (const char *)&wake, 1);
+    vTaskDelay(pdMS_TO_TICKS(CONFIG_PIPE_BENCH_WAKE_MS));
+#endif
+    uint8_t data[6] = {0};     // data[0] = 0x00 开启图传
+    pipe_bench_cmd_t *cmd = &s_cmds[(s_cmd_head + s_cmd_num) % PIPE_BENCH_INFLIGHT];
+    cmd->sent_us = esp_timer_get_time();
+    cmd->acked = false;
+    s_cmd_num++;
+    s_phase.sent++;
+    sim_send(CMD_IMG_TRANSFER, data);
+}
+
+static void sample_heap(void)
+{
+    size_t free_int = heap_caps_get_free_size(MALLOC_CAP_INTERNAL);
+    size_t free_psram = heap_caps_get_free_size(MALLOC_CAP_SPIRAM);
+    if (free_int < s_phase.int_low) {
+        s_phase.int_low = free_int;
+    }
+    if (free_psram < s_phase.psram_low) {
+        s_phase.psram_low = free_psram;
+    }
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a;
+    uint32_t y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void report_phase(int64_t elapsed_us)
+{
+    pipe_bench_phase_t *ph = &s_phase;
+    uint32_t n = ph->e2e_num;
+    uint64_t e2e_sum = 0;
+    qsort(ph->e2e_ms, n, sizeof(ph->e2e_ms[0]), cmp_u32);
+    for (uint32_t i = 0; i < n; i++) {
+        e2e_sum += ph->e2e_ms[i];
+    }
+    uint32_t done = ph->ok + ph->fail;
+
+    printf("PIPEBENCH {\"period_ms\":%lu,\"sent\":%lu,\"ok\":%lu,\"fail\":%lu,\"timeout\":%lu,\"deferred\":%lu,"
+           "\"ms\":%lu,\"eps\":%.3f,\"ack_ms\":{\"avg\":%lu,\"max\":%lu},"
+           "\"e2e_ms\":{\"avg\":%lu,\"p50\":%lu,\"p95\":%lu,\"max\":%lu},\"stage_ms\":{",
+           (unsigned long)ph->period_ms, (unsigned long)ph->sent, (unsigned long)ph->ok,
+           (unsigned long)ph->fail, (unsigned long)ph->timeout, (unsigned long)ph->deferred,
+           (unsigned long)(elapsed_us / 1000), elapsed_us > 0 ? done * 1e6 / elapsed_us : 0.0,
+           (unsigned long)(ph->ack_num ? ph->ack_sum_ms / ph->ack_num : 0), (unsigned long)ph->ack_max_ms,
+           (unsigned long)(n ? e2e_sum / n : 0), (unsigned long)(n ? ph->e2e_ms[(n - 1) / 2] : 0),
+           (unsigned long)(n ? ph->e2e_ms[(n - 1) * 95 / 100] : 0), (unsigned long)(n ? ph->e2e_ms[n - 1] : 0));
+    bool first = true;
+    for (int p = 1; p < LAT_TRACE_POINT_MAX; p++) {
+        if (ph->stage_num[p] == 0) {
+            continue;
+        }
+        printf("%s\"%s\":%lu", first ? "" : ",", lat_trace_point_name(p),
+               (unsigned long)(ph->stage_sum_ms[p] / ph->stage_num[p]));
+        first = false;
+    }
+    printf("},\"heap\":{\"int_low\":%lu,\"int_min\":%lu,\"int_largest\":%lu,\"psram_low\":%lu}}\n",
+           (unsigned long)ph->int_low, (unsigned long)heap_caps_get_minimum_free_size(MALLOC_CAP_INTERNAL),
+           (unsigned long)heap_caps_get_largest_free_block(MALLOC_CAP_INTERNAL), (unsigned long)ph->psram_low);
+}
+
+// 按周期发 events 次命令，等到全部结果回来或超时，返回阶段时长
+static int64_t run_phase(uint32_t period_ms, uint32_t events)
+{
+    memset(&s_phase, 0, sizeof(s_phase));
+    s_phase.period_ms = period_ms;
+    s_phase.int_low = SIZE_MAX;
+    s_phase.psram_low = SIZE_MAX;
+    sample_heap();
+
+    int64_t start = esp_timer_get_time();
+    int64_t next = start;
+    int64_t timeout_us = (int64_t)CONFIG_PIPE_BENCH_TIMEOUT_MS * 1000;
+    bool deferring = false;
+    while (true) {
+        int64_t now = esp_timer_get_time();
+        while (s_cmd_num && now - s_cmds[s_cmd_head].sent_us > timeout_us) {
+            s_cmd_head = (s_cmd_head + 1) % PIPE_BENCH_INFLIGHT;
+            s_cmd_num--;
+            s_phase.timeout++;
+        }
+        if (s_phase.sent < events && now >= next) {
+            if (s_cmd_num < PIPE_BENCH_INFLIGHT) {
+                sim_send_capture();
+                // 按计划时刻推进，发送推迟时不累积补发
+                next = (deferring || next + period_ms * 1000LL < now) ? now + period_ms * 1000LL
+                                                                      : next + period_ms * 1000LL;
+                deferring = false;
+            } else if (!deferring) {
+                s_phase.deferred++;
+                deferring = true;
+            }
+        }
+        if (s_phase.sent >= events && s_cmd_num == 0) {
+            break;
+        }
+        sample_heap();
+        int64_t wait_ms = (next - esp_timer_get_time()) / 1000;
+        if (s_phase.sent >= events || deferring || wait_ms > PIPE_BENCH_POLL_MS) {
+            wait_ms = PIPE_BENCH_POLL_MS;
+        }
+        sim_poll(wait_ms > 0 ? (uint32_t)wait_ms : 0);
+    }
+    return esp_timer_get_time() - start;
+}
+
+static bool wait_network(void)
+{
+    uint8_t data[6] = {0};
+    sim_send(CMD_WIFI_CONFIG, data);
+    int64_t deadline = esp_timer_get_time() + CONFIG_PIPE_BENCH_NET_TIMEOUT_S * 1000000LL;
+    while (esp_timer_get_time() < deadline) {
+        if (s_net_status >= NET_STATUS_CONNECTED_ROUTER) {
+            return true;
+        }
+        sim_poll(100);
+    }
+    return false;
+}
+
+static void pipe_bench_task(void *arg)
+{
+    uint32_t periods[PIPE_BENCH_PERIODS_MAX];
+    int num = 0;
+    const char *p = CONFIG_PIPE_BENCH_PERIODS;
+    while (*p && num < PIPE_BENCH_PERIODS_MAX) {
+        char *end;
+        unsigned long v = strtoul(p, &end, 10);
+        if (end == p) {
+            break;
+        }
+        if (v > 0) {
+            periods[num++] = (uint32_t)v;
+        }
+        p = (*end == ',') ? end + 1 : end;
+    }
+    if (num == 0) {
+        ESP_LOGE(TAG, "No period in PIPE_BENCH_PERIODS \"%s\"", CONFIG_PIPE_BENCH_PERIODS);
+        vTaskDelete(NULL);
+        return;
+    }
+
+    if (!wait_network()) {
+        ESP_LOGW(TAG, "Network not up after %d s, uploads will fail", CONFIG_PIPE_BENCH_NET_TIMEOUT_S);
+    }
+    // 第一阶段之前空跑一次，建连、摄像头上电预热不计入
+    run_phase(0, 1);
+    for (int i = 0; i < num; i++) {
+        ESP_LOGI(TAG, "Phase %d: %d commands every %lu ms", i, CONFIG_PIPE_BENCH_EVENTS, (unsigned long)periods[i]);
+        int64_t elapsed_us = run_phase(periods[i], CONFIG_PIPE_BENCH_EVENTS);
+        report_phase(elapsed_us);
+    }
+    printf("PIPEBENCH_DONE\n");
+    vTaskDelete(NULL);
+}
+
+esp_err_t pipe_bench_start(void)
+{
+    uart_config_t uart_config = {
+        .baud_rate = UART_BAUD_BASE,
+        .data_bits = UART_DATA_8_BITS,
+        .parity = UART_PARITY_DISABLE,
+        .stop_bits = UART_STOP_BITS_1,
+        .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+        .source_clk = UART_SCLK_DEFAULT,
+    };
+    esp_err_t ret = uart_param_config(PIPE_BENCH_UART, &uart_config);
+    if (ret == ESP_OK) {
+        ret = uart_set_pin(PIPE_BENCH_UART, CONFIG_PIPE_BENCH_TX_GPIO, CONFIG_PIPE_BENCH_RX_GPIO,
+                           UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
+    }
+    if (ret == ESP_OK) {
+        ret = uart_driver_install(PIPE_BENCH_UART, UART_BUFFER_SIZE, UART_BUFFER_SIZE, 0, NULL, 0);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "Simulator UART setup failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    if (xTaskCreate(pipe_bench_task, "pipe_bench", PIPE_BENCH_TASK_STACK, NULL, PIPE_BENCH_TASK_PRIO, NULL) != pdPASS) {
+        uart_driver_delete(PIPE_BENCH_UART);
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGW(TAG, "Pipeline benchmark: MCU simulated on UART%d (TX %d, RX %d)",
+             PIPE_BENCH_UART, CONFIG_PIPE_BENCH_TX_GPIO, CONFIG_PIPE_BENCH_RX_GPIO);
+    return ESP_OK;
+}
@@ -0,0 +1,51 @@
+/**
+ * @file pipe_bench.h
+ * @brief 门铃主链路端到端基准（CONFIG_PIPE_BENCH）：MCU 0x1C -> 取帧 -> 上传 -> 0x27
+ *
+ * 只用于不接 MCU 的测试板。第二个 UART 按脚本扮演 MCU，接线：
+ *   CONFIG_PIPE_BENCH_TX_GPIO -> GPIO 44（本模块 MCU 串口 RX）
+ *   CONFIG_PIPE_BENCH_RX_GPIO <- GPIO 43（本模块 MCU 串口 TX）
+ * 上传地址改为 CONFIG_PIPE_BENCH_UPLOAD_URL，指向跑 tools/pipe_bench.py serve 的主机。
+ *
+ * 脚本：先发 0x01 联网，等到 0x23 报告已连接路由器，再发一次不计入统计的 0x1C 预热；之后 CONFIG_PIPE_BENCH_PERIODS 中的每个周期
+ * 为一个阶段，按该周期发 CONFIG_PIPE_BENCH_EVENTS 次 0x1C（开启图传），记录 0x1D 应答和 0x27 结果的耗时。
+ * 上一次结果未回时照常发下一次（持续事件率），同时等待的命令达到上限时推迟发送并计数。
+ * 设备发来的 0x42 状态上报照常回 0x43。
+ *
+ * 每个阶段结束打印一行（控制台），全部结束后打印 PIPEBENCH_DONE：
+ *   PIPEBENCH {"period_ms":周期,"sent":N,"ok":N,"fail":N,"timeout":N,"deferred":N,"ms":阶段时长,
+ *              "eps":每秒完成数,"ack_ms":{"avg":,"max":},"e2e_ms":{"avg":,"p50":,"p95":,"max":},
+ *              "stage_ms":{"sof":平均,...},"heap":{"int_low":,"int_min":,"int_largest":,"psram_low":}}
+ * stage_ms 取自 lat_trace，为各打点相对收到 0x1C 的平均耗时；命令重叠时 lat_trace 只跟踪最近一次会话，
+ * 只统计结果回来时没有其他命令在等的会话。heap 的 *_low 为阶段内采样的最低空闲，int_min 为上电以来的历史最低。
+ * tools/pipe_bench.py report 汇总日志并与基线比较。
+ */
+
+#ifndef PIPE_BENCH_H
+#define PIPE_BENCH_H
+
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if CONFIG_PIPE_BENCH
+
+/**
+ * @brief 安装第二个 UART 并启动脚本任务，在 uart_comm_init() 之后调用
+ */
+esp_err_t pipe_bench_start(void);
+
+#else
+
+static inline esp_err_t pipe_bench_start(void) { return ESP_OK; }
+
+#endif // CONFIG_PIPE_BENCH
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PIPE_BENCH_H
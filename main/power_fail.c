@@ -0,0 +1,275 @@
+// power_fail.c
+// 断电通知后的限时落盘：钩子链按 id 执行，记录写入预先擦除好的分区，下次启动回放
+#include "power_fail.h"
+
+#if CONFIG_POWER_FAIL
+
+#include <string.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "esp_partition.h"
+#include "esp_rom_crc.h"
+#include "cc_hal_kvs.h"
+#include "cc_worker.h"
+
+static const char *TAG = "power_fail";
+
+#define POWER_FAIL_MAGIC            0x4650      // "PF"
+#define POWER_FAIL_ALIGN(n)         (((n) + 3) & ~3)
+// 负载分块写入，块之间检查时间预算
+#define POWER_FAIL_CHUNK            4096
+// 断电通知后这么久仍在运行，说明电源没有断开，丢弃记录并重新擦除
+#define POWER_FAIL_SURVIVE_MS       5000
+// 断电时等待 KVS 锁的上限，写入任务正在落盘时放弃
+#define POWER_FAIL_KVS_WAIT_MS      10
+
+typedef struct {
+    uint16_t magic;
+    uint8_t id;
+    uint8_t done;               // 0xFF 写入中，0 负载已写完
+    uint32_t len;
+    uint32_t crc;               // 负载的 esp_rom_crc32_le
+} power_fail_rec_t;
+
+static const esp_partition_t *s_part = NULL;
+static power_fail_hook_t *s_hooks = NULL;
+static TimerHandle_t s_survive_timer = NULL;
+static volatile bool s_armed = false;       // 分区已擦除，可以落盘
+static bool s_flushing = false;
+static bool s_closed = false;               // 有记录因超时作废，之后不再写
+static uint8_t s_cur_id = 0;
+static size_t s_used = 0;                   // 已写到的位置，擦除到这里为止
+static int64_t s_deadline_us = 0;
+
+void power_fail_register(power_fail_hook_t *hook)
+{
+    power_fail_hook_t **pp = &s_hooks;
+    while (*pp && (*pp)->id <= hook->id) {
+        if (*pp == hook) {
+            return;
+        }
+        pp = &(*pp)->next;
+    }
+    hook->next = *pp;
+    *pp = hook;
+}
+
+static power_fail_hook_t *power_fail_find(uint8_t id)
+{
+    for (power_fail_hook_t *h = s_hooks; h; h = h->next) {
+        if (h->id == id) {
+            return h;
+        }
+    }
+    return NULL;
+}
+
+esp_err_t power_fail_write(const void *head, size_t head_len, const void *data, size_t len)
+{
+    if (!s_flushing) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    size_t rec_size = POWER_FAIL_ALIGN(sizeof(power_fail_rec_t) + head_len + len);
+    if (s_closed || s_used + rec_size > s_part->size) {
+        return ESP_ERR_NO_MEM;
+    }
+    power_fail_rec_t rec = {
+        .magic = POWER_FAIL_MAGIC,
+        .id = s_cur_id,
+        .done = 0xFF,
+        .len = head_len + len,
+        .crc = esp_rom_crc32_le(esp_rom_crc32_le(0, head, head_len), data, len),
+    };
+    size_t off = s_used;
+    // 头一旦写入，这段空间就算用掉了，即使负载没写完
+    s_used += rec_size;
+    esp_err_t ret = esp_partition_write(s_part, off, &rec, sizeof(rec));
+    off += sizeof(rec);
+    if (ret == ESP_OK && head_len) {
+        ret = esp_partition_write(s_part, off, head, head_len);
+        off += head_len;
+    }
+    const uint8_t *p = data;
+    while (ret == ESP_OK && len) {
+        if (esp_timer_get_time() >= s_deadline_us) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+        size_t n = len < POWER_FAIL_CHUNK ? len : POWER_FAIL_CHUNK;
+        ret = esp_partition_write(s_part, off, p, n);
+        off += n;
+        p += n;
+        len -= n;
+    }
+    if (ret == ESP_OK) {
+        uint8_t done = 0;
+        ret = esp_partition_write(s_part, s_used - rec_size + offsetof(power_fail_rec_t, done), &done, 1);
+    }
+    if (ret != ESP_OK) {
+        s_closed = true;
+    }
+    return ret;
+}
+
+static void power_fail_erase_job(void *arg)
+{
+    size_t erase = (s_used + s_part->erase_size - 1) / s_part->erase_size * s_part->erase_size;
+    if (erase) {
+        esp_err_t ret = esp_partition_erase_range(s_part, 0, erase);
+        if (ret != ESP_OK) {
+            ESP_LOGE(TAG, "Erase failed: 0x%x", ret);
+            return;
+        }
+    }
+    s_used = 0;
+    s_closed = false;
+    s_armed = true;
+    ESP_LOGI(TAG, "Armed, %u bytes erased", (unsigned)erase);
+}
+
+static void power_fail_survive_cb(TimerHandle_t timer)
+{
+    ESP_LOGW(TAG, "Still powered after the power-off notify, discard saved records");
+    if (cc_worker_submit(power_fail_erase_job, NULL, CC_WORKER_PRIO_LOW) != CC_OK) {
+        // 作业池满，稍后再试
+        xTimerStart(timer, 0);
+    }
+}
+
+void power_fail_flush(void)
+{
+    if (!s_armed) {
+        ESP_LOGW(TAG, "Not armed, nothing saved");
+        return;
+    }
+    s_armed = false;
+    int64_t start = esp_timer_get_time();
+    s_deadline_us = start + CONFIG_POWER_FAIL_BUDGET_MS * 1000LL;
+    UBaseType_t prio = uxTaskPriorityGet(NULL);
+    vTaskPrioritySet(NULL, configMAX_PRIORITIES - 1);
+    s_flushing = true;
+    uint8_t skipped = 0;
+    // 执行期间不打日志，串口日志本身就要占用毫秒级时间
+    for (power_fail_hook_t *h = s_hooks; h; h = h->next) {
+        if (s_closed || esp_timer_get_time() >= s_deadline_us) {
+            skipped++;
+            continue;
+        }
+        s_cur_id = h->id;
+        h->save();
+    }
+    s_flushing = false;
+    vTaskPrioritySet(NULL, prio);
+    ESP_LOGI(TAG, "Saved %u bytes in %u ms, %u hooks skipped", (unsigned)s_used,
+             (unsigned)((esp_timer_get_time() - start) / 1000), skipped);
+    xTimerStart(s_survive_timer, 0);
+}
+
+// 回放记录，返回需要擦除到的位置
+static size_t power_fail_replay(void)
+{
+    size_t off = 0;
+    uint32_t count = 0;
+    while (off + sizeof(power_fail_rec_t) <= s_part->size) {
+        power_fail_rec_t rec;
+        if (esp_partition_read(s_part, off, &rec, sizeof(rec)) != ESP_OK) {
+            return s_part->size;
+        }
+        if (rec.magic == 0xFFFF) {
+            break;
+        }
+        if (rec.magic != POWER_FAIL_MAGIC || rec.len > s_part->size - off - sizeof(rec)) {
+            ESP_LOGW(TAG, "Corrupt record at 0x%x", (unsigned)off);
+            return s_part->size;
+        }
+        size_t data_off = off + sizeof(rec);
+        off += POWER_FAIL_ALIGN(sizeof(rec) + rec.len);
+        power_fail_hook_t *h = power_fail_find(rec.id);
+        if (rec.done != 0 || !h) {
+            continue;
+        }
+        uint8_t *buf = heap_caps_malloc(rec.len ? rec.len : 1, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+        if (!buf) {
+            buf = malloc(rec.len ? rec.len : 1);
+        }
+        if (!buf) {
+            ESP_LOGE(TAG, "No memory for a %u byte record", (unsigned)rec.len);
+            continue;
+        }
+        if (esp_partition_read(s_part, data_off, buf, rec.len) == ESP_OK &&
+            esp_rom_crc32_le(0, buf, rec.len) == rec.crc) {
+            h->restore(buf, rec.len);
+            count++;
+        }
+        free(buf);
+    }
+    if (count) {
+        ESP_LOGI(TAG, "Replayed %u records", (unsigned)count);
+    }
+    return off;
+}
+
+/* ---------- KVS 写回缓存 ---------- */
+
+static void power_fail_kvs_one(const char *key, const void *value, size_t len, void *arg)
+{
+    power_fail_write(key, strlen(key) + 1, value, len);
+}
+
+static void power_fail_kvs_save(void)
+{
+    cc_hal_kvs_foreach_dirty(power_fail_kvs_one, NULL, POWER_FAIL_KVS_WAIT_MS);
+}
+
+// 记录为 键名\0 值
+static void power_fail_kvs_restore(const uint8_t *data, size_t len)
+{
+    size_t key_len = strnlen((const char *)data, len);
+    if (key_len == len) {
+        return;
+    }
+    cc_hal_kvs_set((const char *)data, data + key_len + 1, len - key_len - 1);
+}
+
+static power_fail_hook_t s_kvs_hook = {
+    .id = POWER_FAIL_ID_KVS,
+    .save = power_fail_kvs_save,
+    .restore = power_fail_kvs_restore,
+};
+
+esp_err_t power_fail_init(void)
+{
+    if (s_part) {
+        return ESP_OK;
+    }
+    const esp_partition_t *part = esp_partition_find_first(ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY,
+                                                           CONFIG_POWER_FAIL_PARTITION);
+    if (!part) {
+        ESP_LOGW(TAG, "Partition %s not found, power-off data is not saved", CONFIG_POWER_FAIL_PARTITION);
+        return ESP_ERR_NOT_FOUND;
+    }
+    s_survive_timer = xTimerCreate("power_fail", pdMS_TO_TICKS(POWER_FAIL_SURVIVE_MS), pdFALSE, NULL,
+                                   power_fail_survive_cb);
+    if (!s_survive_timer) {
+        return ESP_ERR_NO_MEM;
+    }
+    power_fail_register(&s_kvs_hook);
+    s_part = part;
+    s_used = power_fail_replay();
+    if (s_used == 0) {
+        s_armed = true;
+        return ESP_OK;
+    }
+    if (cc_worker_submit(power_fail_erase_job, NULL, CC_WORKER_PRIO_LOW) != CC_OK) {
+        power_fail_erase_job(NULL);
+    }
+    return ESP_OK;
+}
+
+#endif // CONFIG_POWER_FAIL
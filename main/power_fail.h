@@ -0,0 +1,87 @@
+/**
+ * @file power_fail.h
+ * @brief 断电前快速落盘（CONFIG_POWER_FAIL）：收到 MCU 断电通知（0x04）后，在限定时间内把内存中
+ *        尚未持久化的数据写入预先擦除好的专用分区，下次启动时交还给各模块
+ *
+ * 各模块登记一个钩子：
+ *   save     断电时调用，用 power_fail_write() 写若干条记录；只拷贝，不取走内存中的数据
+ *   restore  启动时对本钩子的每条记录调用一次
+ * 钩子按 id 从小到大执行，时间预算（CONFIG_POWER_FAIL_BUDGET_MS）用完或分区写满后，剩下的钩子不再执行。
+ *
+ * 分区只在空闲时擦除（启动回放后、或断电通知后电源并未断开），断电时只写不擦。
+ * 记录为 头 + 负载，头先写、负载写完后再把 done 字节从 0xFF 改写为 0，写一半的记录回放时跳过。
+ * 改写已写入的字节，不能与 flash 加密同时使用。
+ */
+
+#ifndef POWER_FAIL_H
+#define POWER_FAIL_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 钩子 id 即执行顺序，重要且小的数据在前，图片这类大块数据放最后
+typedef enum {
+    POWER_FAIL_ID_STATE = 1,        // 待上报的 MCU 状态批次
+    POWER_FAIL_ID_KVS,              // KVS 写回缓存中尚未落盘的值
+    POWER_FAIL_ID_IMG,              // 上传队列中的图片
+} power_fail_id_t;
+
+typedef struct power_fail_hook {
+    uint8_t id;
+    void (*save)(void);
+    void (*restore)(const uint8_t *data, size_t len);
+    struct power_fail_hook *next;
+} power_fail_hook_t;
+
+#if CONFIG_POWER_FAIL
+
+/**
+ * @brief 登记钩子（静态变量，不拷贝），须在 power_fail_init() 之前调用
+ */
+void power_fail_register(power_fail_hook_t *hook);
+
+/**
+ * @brief 挂载分区、回放上次断电保存的记录并擦除，之后断电通知才会落盘
+ *
+ * 回放在调用者的任务中进行，须在所有钩子的模块初始化之后调用；擦除在 cc_worker 中进行。
+ */
+esp_err_t power_fail_init(void);
+
+/**
+ * @brief 执行全部钩子，在收到断电通知的任务中以最高优先级运行，最长约 CONFIG_POWER_FAIL_BUDGET_MS
+ *
+ * 数秒后电源仍未断开（测试模式或 MCU 取消断电）时丢弃这次保存的记录并重新擦除。
+ */
+void power_fail_flush(void);
+
+/**
+ * @brief 在 save 中调用，写一条记录，负载为 head 与 data 相接
+ *
+ * @return ESP_ERR_NO_MEM 分区剩余空间不足；ESP_ERR_TIMEOUT 时间预算用完，记录作废；
+ *         ESP_ERR_INVALID_STATE 不在 save 中调用
+ */
+esp_err_t power_fail_write(const void *head, size_t head_len, const void *data, size_t len);
+
+#else
+
+static inline void power_fail_register(power_fail_hook_t *hook) {}
+static inline esp_err_t power_fail_init(void) { return ESP_OK; }
+static inline void power_fail_flush(void) {}
+static inline esp_err_t power_fail_write(const void *head, size_t head_len, const void *data, size_t len)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_POWER_FAIL
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_FAIL_H
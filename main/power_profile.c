@@ -0,0 +1,293 @@
+/**
+ * @file power_profile.c
+ * @brief Wi-Fi 省电档位：空闲时 modem sleep，有上传或远程开锁等待时关闭省电
+ */
+
+#include "power_profile.h"
+#include <stdbool.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "freertos/timers.h"
+#include "sdkconfig.h"
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+#include "esp_pm.h"
+#include "esp_sleep.h"
+#include "esp_timer.h"
+#endif
+#include "cc_hal_sys.h"
+#include "cc_hal_wifi.h"
+#include "state_report.h"
+
+static const char *TAG = "power_profile";
+
+static uint8_t s_holds[POWER_HOLD_MAX];
+static uint16_t s_hold_total = 0;
+static power_profile_t s_profile = POWER_PROFILE_IDLE;
+static SemaphoreHandle_t s_mutex = NULL;
+static TimerHandle_t s_report_timer = NULL;
+
+// 估算电量累计（0.1 mA·ms），以及对应的时间段
+static uint64_t s_charge = 0;
+static uint32_t s_period_start_ms = 0;
+static uint32_t s_last_ms = 0;
+
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+static esp_pm_lock_handle_t s_perf_lock = NULL;     // 性能档期间不睡眠
+static esp_pm_lock_handle_t s_awake_lock = NULL;    // power_profile_stay_awake() 的保持窗口
+static esp_timer_handle_t s_awake_timer = NULL;
+static bool s_awake_held = false;
+static portMUX_TYPE s_awake_spin = portMUX_INITIALIZER_UNLOCKED;
+
+// UART 唤醒时延统计（us）
+static volatile int64_t s_wake_us = 0;              // 最近一次退出 light sleep 的时间
+static int64_t s_wake_measured_us = 0;              // 已统计过的那次唤醒
+static uint64_t s_wake_lat_sum = 0;
+static uint32_t s_wake_lat_num = 0;
+static uint32_t s_wake_lat_max = 0;
+#endif
+
+// 档位估算电流（0.1 mA）
+static uint32_t profile_current(power_profile_t profile)
+{
+    return (profile == POWER_PROFILE_PERF ? CONFIG_POWER_PROFILE_PERF_CURRENT_MA
+                                          : CONFIG_POWER_PROFILE_IDLE_CURRENT_MA) * 10;
+}
+
+// 把上次记账以来的时间按当前档位计入电量（持锁调用）
+static void account_locked(uint32_t now)
+{
+    s_charge += (uint64_t)(now - s_last_ms) * profile_current(s_profile);
+    s_last_ms = now;
+}
+
+static cc_err_t apply_profile(power_profile_t profile)
+{
+    if (profile == POWER_PROFILE_PERF) {
+        return cc_hal_wifi_set_ps(CC_HAL_WIFI_PS_NONE);
+    }
+    // 监听间隔为 0 时跟随 AP 的 DTIM 唤醒
+    return cc_hal_wifi_set_ps(CONFIG_POWER_PROFILE_LISTEN_INTERVAL ? CC_HAL_WIFI_PS_MAX_MODEM
+                                                                   : CC_HAL_WIFI_PS_MIN_MODEM);
+}
+
+// 按持有计数切换档位（持锁调用）
+static void update_locked(void)
+{
+    power_profile_t target = s_hold_total ? POWER_PROFILE_PERF : POWER_PROFILE_IDLE;
+    if (target == s_profile) {
+        return;
+    }
+    account_locked((uint32_t)cc_hal_sys_get_ms());
+    s_profile = target;
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    if (target == POWER_PROFILE_PERF) {
+        esp_pm_lock_acquire(s_perf_lock);
+    } else {
+        esp_pm_lock_release(s_perf_lock);
+    }
+#endif
+    if (apply_profile(target) != CC_OK) {
+        ESP_LOGW(TAG, "Failed to apply profile %d", target);
+    }
+    ESP_LOGI(TAG, "Power profile -> %s", target == POWER_PROFILE_PERF ? "perf" : "idle");
+    state_report_mqtt_upload(POWER_STATE_CURRENT, profile_current(target));
+}
+
+static void report_timer_cb(TimerHandle_t timer)
+{
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    uint32_t now = (uint32_t)cc_hal_sys_get_ms();
+    account_locked(now);
+    uint32_t elapsed = now - s_period_start_ms;
+    uint32_t avg = elapsed ? (uint32_t)(s_charge / elapsed) : profile_current(s_profile);
+    s_charge = 0;
+    s_period_start_ms = now;
+    xSemaphoreGive(s_mutex);
+
+    ESP_LOGI(TAG, "Estimated average current %lu.%lu mA", avg / 10, avg % 10);
+    state_report_mqtt_upload(POWER_STATE_AVG_CURRENT, avg);
+
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    portENTER_CRITICAL(&s_awake_spin);
+    uint64_t lat_sum = s_wake_lat_sum;
+    uint32_t lat_num = s_wake_lat_num;
+    uint32_t lat_max = s_wake_lat_max;
+    s_wake_lat_sum = 0;
+    s_wake_lat_num = 0;
+    s_wake_lat_max = 0;
+    portEXIT_CRITICAL(&s_awake_spin);
+    if (lat_num) {
+        uint32_t lat_avg = (uint32_t)(lat_sum / lat_num);
+        ESP_LOGI(TAG, "UART wake-to-data latency: %lu samples, avg %lu us, max %lu us", lat_num, lat_avg, lat_max);
+        state_report_mqtt_upload(POWER_STATE_WAKE_LATENCY, lat_avg / 100);
+    }
+#endif
+}
+
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+static void awake_timer_cb(void *arg)
+{
+    portENTER_CRITICAL(&s_awake_spin);
+    bool held = s_awake_held;
+    s_awake_held = false;
+    portEXIT_CRITICAL(&s_awake_spin);
+    if (held) {
+        esp_pm_lock_release(s_awake_lock);
+    }
+}
+
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+// 在睡眠流程的临界区中调用，只记录时间
+static IRAM_ATTR esp_err_t sleep_exit_cb(int64_t sleep_time_us, void *arg)
+{
+    s_wake_us = esp_timer_get_time();
+    return ESP_OK;
+}
+#endif
+
+static esp_err_t light_sleep_init(void)
+{
+    esp_pm_config_t pm_config = {
+        .max_freq_mhz = CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ,
+        .min_freq_mhz = CONFIG_XTAL_FREQ,
+        .light_sleep_enable = true,
+    };
+    esp_err_t ret = esp_pm_configure(&pm_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "esp_pm_configure failed: %s", esp_err_to_name(ret));
+        return ret;
+    }
+    ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pp_perf", &s_perf_lock);
+    if (ret == ESP_OK) {
+        ret = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "pp_awake", &s_awake_lock);
+    }
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    const esp_timer_create_args_t timer_args = {
+        .callback = awake_timer_cb,
+        .name = "pp_awake",
+    };
+    ret = esp_timer_create(&timer_args, &s_awake_timer);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+#if CONFIG_PM_LIGHT_SLEEP_CALLBACKS
+    esp_pm_sleep_cbs_register_config_t cbs = {
+        .exit_cb = sleep_exit_cb,
+    };
+    esp_pm_light_sleep_register_cbs(&cbs);
+#endif
+    ESP_LOGI(TAG, "Auto light sleep enabled, %d-%d MHz", pm_config.min_freq_mhz, pm_config.max_freq_mhz);
+    return ESP_OK;
+}
+#endif
+
+esp_err_t power_profile_init(void)
+{
+    if (s_mutex) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    // 失败时不睡眠，其余功能照常
+    if (light_sleep_init() != ESP_OK) {
+        ESP_LOGW(TAG, "Light sleep not available");
+    }
+#endif
+    cc_hal_wifi_set_listen_interval(CONFIG_POWER_PROFILE_LISTEN_INTERVAL);
+    s_last_ms = s_period_start_ms = (uint32_t)cc_hal_sys_get_ms();
+    s_profile = POWER_PROFILE_IDLE;
+    apply_profile(POWER_PROFILE_IDLE);
+
+#if CONFIG_POWER_PROFILE_REPORT_S > 0
+    s_report_timer = xTimerCreate("power_report", pdMS_TO_TICKS(CONFIG_POWER_PROFILE_REPORT_S * 1000UL),
+                                  pdTRUE, NULL, report_timer_cb);
+    if (!s_report_timer || xTimerStart(s_report_timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start report timer");
+    }
+#endif
+    ESP_LOGI(TAG, "Power profile idle, listen interval %d", CONFIG_POWER_PROFILE_LISTEN_INTERVAL);
+    return ESP_OK;
+}
+
+void power_profile_hold(power_hold_t reason)
+{
+    if (reason >= POWER_HOLD_MAX || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason] < UINT8_MAX) {
+        s_holds[reason]++;
+        s_hold_total++;
+    }
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+void power_profile_release(power_hold_t reason)
+{
+    if (reason >= POWER_HOLD_MAX || !s_mutex) {
+        return;
+    }
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    if (s_holds[reason]) {
+        s_holds[reason]--;
+        s_hold_total--;
+    } else {
+        ESP_LOGW(TAG, "Release without hold, reason %d", reason);
+    }
+    update_locked();
+    xSemaphoreGive(s_mutex);
+}
+
+power_profile_t power_profile_get(void)
+{
+    return s_profile;
+}
+
+void power_profile_stay_awake(uint32_t ms)
+{
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    if (!s_awake_timer) {
+        return;
+    }
+    portENTER_CRITICAL(&s_awake_spin);
+    bool take = !s_awake_held;
+    s_awake_held = true;
+    portEXIT_CRITICAL(&s_awake_spin);
+    if (take) {
+        esp_pm_lock_acquire(s_awake_lock);
+    }
+    esp_timer_stop(s_awake_timer);
+    esp_timer_start_once(s_awake_timer, (uint64_t)ms * 1000);
+#else
+    (void)ms;
+#endif
+}
+
+void power_profile_uart_activity(void)
+{
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    int64_t wake_us = s_wake_us;
+    // 只统计由 UART 唤醒后收到的第一段数据
+    if (wake_us != s_wake_measured_us && esp_sleep_get_wakeup_cause() == ESP_SLEEP_WAKEUP_UART) {
+        s_wake_measured_us = wake_us;
+        uint32_t lat = (uint32_t)(esp_timer_get_time() - wake_us);
+        portENTER_CRITICAL(&s_awake_spin);
+        s_wake_lat_sum += lat;
+        s_wake_lat_num++;
+        if (lat > s_wake_lat_max) {
+            s_wake_lat_max = lat;
+        }
+        portEXIT_CRITICAL(&s_awake_spin);
+        ESP_LOGD(TAG, "UART wake-to-data %lu us", lat);
+    }
+    power_profile_stay_awake(CONFIG_POWER_PROFILE_UART_AWAKE_MS);
+#endif
+}
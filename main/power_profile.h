@@ -0,0 +1,66 @@
+/**
+ * @file power_profile.h
+ * @brief Wi-Fi 省电档位：空闲时 modem sleep，有上传或远程开锁等待时关闭省电
+ *
+ * 各业务按原因持有/释放性能档，任一原因持有时为 WIFI_PS_NONE，全部释放后回到空闲档。
+ * 每次切换及周期性地经 state_report 上报估算电流。
+ *
+ * 开启 CONFIG_POWER_PROFILE_LIGHT_SLEEP 时，空闲档下由 tickless idle 自动进入 light sleep，
+ * 保持 Wi-Fi 关联，由门锁 UART 的 RX 边沿、最近的定时器到期点及 Wi-Fi 监听间隔唤醒。
+ */
+
+#ifndef POWER_PROFILE_H
+#define POWER_PROFILE_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// 上报的状态类型，电流单位 0.1 mA，时延单位 0.1 ms
+#define POWER_STATE_CURRENT             0x2001  // 切换后档位的估算电流
+#define POWER_STATE_AVG_CURRENT         0x2002  // 上个上报周期的估算平均电流
+#define POWER_STATE_WAKE_LATENCY        0x2003  // 上个上报周期 UART 唤醒到收到数据的平均时延
+
+typedef enum {
+    POWER_HOLD_IMG_UPLOAD = 0,  // 图传采集与上传
+    POWER_HOLD_REMOTE_UNLOCK,   // 远程开锁请求等待云端下发（60s）
+    POWER_HOLD_MAX,
+} power_hold_t;
+
+typedef enum {
+    POWER_PROFILE_IDLE = 0,     // modem sleep，按监听间隔或 DTIM 唤醒
+    POWER_PROFILE_PERF,         // 不省电，最低时延
+} power_profile_t;
+
+/**
+ * @brief 设置监听间隔并进入空闲档，启动周期上报，须在 cc_hal_wifi_init() 之后调用
+ */
+esp_err_t power_profile_init(void);
+
+/**
+ * @brief 持有性能档，同一原因可嵌套持有，须与 power_profile_release() 成对调用
+ */
+void power_profile_hold(power_hold_t reason);
+
+void power_profile_release(power_hold_t reason);
+
+power_profile_t power_profile_get(void);
+
+/**
+ * @brief 在 ms 毫秒内不进入 light sleep，重复调用从最后一次起计时；未开启 light sleep 时无作用
+ */
+void power_profile_stay_awake(uint32_t ms);
+
+/**
+ * @brief 收到门锁 UART 数据时调用（接收任务中）：保持唤醒以接收后续帧，并统计唤醒时延
+ */
+void power_profile_uart_activity(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // POWER_PROFILE_H
@@ -10,10 +10,16 @@
 
 #include "driver/uart.h"
 #include "driver/gpio.h"  
+#include "freertos/task.h"
 #include "string.h"
+#include <stdbool.h>
 
 #include "frame_parser.h"
+#include "checksum.h"
+#include "uart_rx.h"
 #include "cJSON.h"
+#include "json_writer.h"
+#include "cbor_writer.h"
 
 #include "cc_tmr_task.h"
 
@@ -21,9 +27,12 @@ static char *TAG = "product";
 
 #define MAX_LEN 32
 #define MAX_DATA_LEN (MAX_LEN - sizeof(frame_parser_head_t) - sizeof(frame_parser_last_t))
+// ver + type + 十六进制 data + 32 位 seq_no 及 JSON 符号
+#define DEVICE_PUB_MSG_MAX (GS_DEVICE_VERSION_BUF_MAX_LEN + MAX_DATA_LEN*2 + 96)
 
 #define EX_UART_NUM UART_NUM_1
 #define RX_BUF_SIZE 32*5
+#define EX_UART_QUEUE_LEN 10
 
 #define TXD_PIN (GPIO_NUM_15)
 #define RXD_PIN (GPIO_NUM_16)
@@ -31,82 +40,188 @@ static char *TAG = "product";
 #define SUB_TOPIC_SERVER_PUB   "/service/publish"
 #define PUB_TOPIC_DEVICE_PUB   "/event/notify"
 
+static gs_mqtt_topic_t g_device_pub_topic = GS_MQTT_TOPIC_INVALID;
+static QueueHandle_t g_uart_queue = NULL;
+static TaskHandle_t g_parse_task = NULL;
+
 void __reboot(uint32_t interval, void *arg){
     cc_tmr_task_delete(__reboot);
     cc_hal_sys_reboot();
 }
 
-static uint8_t __crc_high_first(uint8_t *ptr, uint16_t len)
+// 十六进制字符查表，存值 + 1，0 表示非法字符
+static const uint8_t s_hex_lut[256] = {
+    ['0'] = 1,  ['1'] = 2,  ['2'] = 3,  ['3'] = 4,  ['4'] = 5,
+    ['5'] = 6,  ['6'] = 7,  ['7'] = 8,  ['8'] = 9,  ['9'] = 10,
+    ['A'] = 11, ['B'] = 12, ['C'] = 13, ['D'] = 14, ['E'] = 15, ['F'] = 16,
+    ['a'] = 11, ['b'] = 12, ['c'] = 13, ['d'] = 14, ['e'] = 15, ['f'] = 16,
+};
+
+// 返回写入的字节数，长度为奇数、超长或含非法字符时返回 -1
+static int __hex_decode(const char *hex, size_t hex_len, uint8_t *out, size_t out_size)
 {
-    uint8_t i;
-    uint8_t crc=0x00;
-
-    while(len--)
-    {
-        crc ^= *ptr++;
-        for (i=8;i>0;--i)
-        { 
-            if (crc & 0x80)
-                crc = (crc << 1) ^ 0x7;
-            else
-                crc = (crc << 1);
+    if((hex_len & 1) || hex_len / 2 > out_size){
+        return -1;
+    }
+    for(size_t i = 0; i < hex_len / 2; i++){
+        uint8_t hi = s_hex_lut[(uint8_t)hex[2 * i]];
+        uint8_t lo = s_hex_lut[(uint8_t)hex[2 * i + 1]];
+        if(!hi || !lo){
+            return -1;
         }
+        out[i] = (uint8_t)(((hi - 1) << 4) | (lo - 1));
     }
-    return (crc);
+    return (int)(hex_len / 2);
 }
 
-uint8_t binaryToString(const unsigned char *buffer, uint8_t bufferSize, char *output, uint8_t outputSize) {
-    if (bufferSize*2 > outputSize) {
-        printf("Output buffer is too small\n");
-        return false;
+typedef struct{
+    const char *type;
+    size_t type_len;
+    const char *data;
+    size_t data_len;
+}downlink_fields_t;
+
+static const char *__skip_ws(const char *p, const char *end)
+{
+    while(p < end && (*p == ' ' || *p == '\t' || *p == '\r' || *p == '\n')){
+        p++;
     }
+    return p;
+}
 
-    for (uint8_t i = 0; i < bufferSize; i++) {
-        sprintf(output + (i * 2), "%02X", buffer[i]);
+/*
+ * 下行透传消息是一层的 {"ver":..,"type":"0002","data":"<hex>","seq_no":..}，
+ * 单遍扫描取出 type 和 data，不建树、不拷贝。遇到嵌套、转义等不认识的写法返回 false，由 cJSON 处理。
+ */
+static bool __downlink_scan(const char *json, size_t len, downlink_fields_t *f)
+{
+    const char *p = json, *end = json + len;
+
+    memset(f, 0, sizeof(*f));
+    p = __skip_ws(p, end);
+    if(p >= end || *p++ != '{'){
+        return false;
     }
-    output[bufferSize * 2] = '\0';
+    while(1){
+        p = __skip_ws(p, end);
+        if(p >= end || *p++ != '"'){
+            return false;
+        }
+        const char *key = p;
+        while(p < end && *p != '"' && *p != '\\'){
+            p++;
+        }
+        if(p >= end || *p != '"'){
+            return false;
+        }
+        size_t key_len = p++ - key;
 
-    return 1;
-}
+        p = __skip_ws(p, end);
+        if(p >= end || *p++ != ':'){
+            return false;
+        }
+        p = __skip_ws(p, end);
+        if(p >= end){
+            return false;
+        }
 
-unsigned char hexCharToByte(char c) {
-    if (c >= '0' && c <= '9') {
-        return c - '0';
-    } else if (c >= 'A' && c <= 'F') {
-        return c - 'A' + 10;
-    } else if (c >= 'a' && c <= 'f') {
-        return c - 'a' + 10;
-    } else {
-        printf("Invalid hex character: %c\n", c);
-        return 0;
+        if(*p == '"'){
+            const char *val = ++p;
+            while(p < end && *p != '"' && *p != '\\'){
+                p++;
+            }
+            if(p >= end || *p != '"'){
+                return false;
+            }
+            size_t val_len = p++ - val;
+            if(key_len == 4 && memcmp(key, "type", 4) == 0){
+                f->type = val;
+                f->type_len = val_len;
+            }else if(key_len == 4 && memcmp(key, "data", 4) == 0){
+                f->data = val;
+                f->data_len = val_len;
+            }
+        }else if(*p == '{' || *p == '['){
+            return false;
+        }else{
+            // 数字、true/false/null，跳过
+            while(p < end && *p != ',' && *p != '}'){
+                p++;
+            }
+        }
+
+        p = __skip_ws(p, end);
+        if(p >= end){
+            return false;
+        }
+        if(*p == '}'){
+            return f->type != NULL;
+        }
+        if(*p++ != ','){
+            return false;
+        }
     }
 }
 
-uint8_t stringToBinary(const char *str, unsigned char *output, uint8_t outputSize, uint8_t *output_len) {
-    uint8_t strLength = strlen(str);
-    uint8_t bufferSize = strLength / 2;
+// 云端下发的 hex 直接解码进发送帧，算 CRC 后写串口；只在 MQTT 任务中调用，帧缓冲静态复用
+static void __downlink_passthrough(const char *hex, size_t hex_len)
+{
+    static uint8_t s_tx_frame[FRAME_MAX_LEN];
 
-    if (bufferSize > outputSize) {
-        printf("Output buffer is too small\n");
-        return 0;
+    frame_parser_head_t *head = (frame_parser_head_t *)s_tx_frame;
+    int n = __hex_decode(hex, hex_len, head->data, MAX_DATA_LEN);
+    if(n < 0){
+        CC_LOGE(TAG, "data error: %u hex chars", (unsigned)hex_len);
+        return;
     }
+    head->head = 0x23BB;
+    head->cmd = 0x02;
+    head->len = (uint8_t)n;
 
-    for (uint8_t i = 0; i < bufferSize; i++) {
-        unsigned char byte = (hexCharToByte(str[i * 2]) << 4) | hexCharToByte(str[i * 2 + 1]);
-        output[i] = byte;
-    }
+    size_t body_len = sizeof(frame_parser_head_t) + head->len;
+    frame_parser_last_t *last = (frame_parser_last_t *)(s_tx_frame + body_len);
+    last->crc = checksum_crc8(s_tx_frame, body_len);
 
-    *output_len = bufferSize;
-    return 1;
+    uart_write_bytes(EX_UART_NUM, (const char *)s_tx_frame, body_len + sizeof(frame_parser_last_t));
+    ESP_LOG_BUFFER_HEXDUMP(TAG, s_tx_frame, body_len + sizeof(frame_parser_last_t), ESP_LOG_DEBUG);
 }
 
-static void __frame_process(uint8_t *data, uint8_t len)
+// 串口上报帧编码为云端消息，格式由 gs_mqtt 协商（JSON 时 data 为十六进制字符串）
+static size_t __device_pub_msg(uint8_t *buf, size_t size, const char *sw_version, const uint8_t *data, uint8_t len)
 {
-    cJSON *root_obj = NULL;
-    char hex_str[MAX_DATA_LEN*2 + 1] = {0};
+    char seq[GS_MQTT_SEQ_LEN];
+
+    gs_mqtt_generate_seq(seq);
+    if(gs_mqtt_get_payload_fmt() == GS_MQTT_FMT_CBOR){
+        cbor_writer_t w;
+        cbor_writer_init(&w, buf, size);
+        cbor_writer_map(&w, 4);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_VER);
+        cbor_writer_text(&w, sw_version);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_TYPE);
+        cbor_writer_uint(&w, 0x0001);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_DATA);
+        cbor_writer_bytes(&w, data, len);
+        cbor_writer_uint(&w, GS_MQTT_CBOR_KEY_SEQ);
+        cbor_writer_text(&w, seq);
+        return cbor_writer_finish(&w);
+    }
 
-    CC_LOGI_HEXDUMP(TAG, data, len);
-    frame_parser_add_buf(data, len);
+    // 直接写入栈上缓冲，data 在写入时转成十六进制，不再经过 cJSON 建树
+    json_writer_t w;
+    json_writer_init(&w, (char *)buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_str(&w, "ver", sw_version);
+    json_writer_kv_str(&w, "type", "0001");
+    json_writer_kv_hex(&w, "data", data, len);
+    json_writer_kv_str(&w, "seq_no", seq);
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
+
+static void __frame_process(void)
+{
+    uint8_t msg[DEVICE_PUB_MSG_MAX];
 
     while (1) {
         uint32_t get_len = 0;
@@ -119,7 +234,7 @@ static void __frame_process(uint8_t *data, uint8_t len)
             }
             frame_parser_head_t *head = (frame_parser_head_t *)get_buf;
             frame_parser_last_t *last = (frame_parser_last_t *)(get_buf + sizeof(frame_parser_head_t) + head->len);
-            uint8_t crc =  __crc_high_first((uint8_t *)head, sizeof(frame_parser_head_t) + head->len);
+            uint8_t crc = checksum_crc8((uint8_t *)head, sizeof(frame_parser_head_t) + head->len);
             if(crc != last->crc){
                 CC_LOGE(TAG, "crc error: %02x != %02x", crc, last->crc);
             }
@@ -129,29 +244,17 @@ static void __frame_process(uint8_t *data, uint8_t len)
             }
             CC_LOGI_HEXDUMP(TAG, head->data, head->len);
 
-            binaryToString(head->data, head->len, hex_str, sizeof(hex_str));
-            root_obj = cJSON_CreateObject();
-            if(root_obj){
-                char sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
-                char hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
-                gs_device_get_version(sw_version, hw_version);
-
-                cJSON_AddItemToObject(root_obj, "ver", cJSON_CreateString(sw_version));
-                cJSON_AddItemToObject(root_obj, "type", cJSON_CreateString("0001"));
-                cJSON_AddItemToObject(root_obj, "data", cJSON_CreateString(hex_str));
-                cJSON_AddItemToObject(root_obj, "seq_no", cJSON_CreateString(gs_mqtt_generate_seq()));
-
-                char *msg = cJSON_PrintUnformatted(root_obj);
-                if(msg){
-                    CC_LOGI(TAG, "pub %s: %s'", PUB_TOPIC_DEVICE_PUB, msg);
-                    gs_mqtt_publish(PUB_TOPIC_DEVICE_PUB, (uint8_t *)msg, strlen(msg), GS_MQTT_QOS0, 0);
-                    cJSON_free(msg);
-                } else {
-                    CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
-                }
-                cJSON_Delete(root_obj);
-            }else{
-                CC_LOGE_CODE(TAG, CC_ERR_NO_MEM);
+            char sw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+            char hw_version[GS_DEVICE_VERSION_BUF_MAX_LEN] = "";
+            gs_device_get_version(sw_version, hw_version);
+
+            size_t msg_len = __device_pub_msg(msg, sizeof(msg), sw_version, head->data, head->len);
+            if(msg_len){
+                CC_LOGI(TAG, "pub %s: %u bytes", PUB_TOPIC_DEVICE_PUB, msg_len);
+                gs_mqtt_iov_t iov = { msg, msg_len };
+                gs_mqtt_publish_iov(g_device_pub_topic, &iov, 1, GS_MQTT_QOS0, 0);
+            } else {
+                CC_LOGE_CODE(TAG, CC_ERR_INVALID_SIZE);
             }
         }else{
             break;
@@ -159,45 +262,64 @@ static void __frame_process(uint8_t *data, uint8_t len)
     }
 }
 
-static void __rx_task(void *arg)
+// 在 uart_rx 接收任务中调用：整段数据写入无锁环形缓冲，由解析任务处理
+static void __uart_rx_cb(const uint8_t *data, size_t len, void *arg)
+{
+    CC_LOGI_HEXDUMP(TAG, data, len);
+    if(frame_parser_add_buf((uint8_t *)data, len) != len){
+        CC_LOGE(TAG, "frame parser buffer full");
+    }
+    if(g_parse_task){
+        xTaskNotifyGive(g_parse_task);
+    }
+}
+
+static void __parse_task(void *arg)
 {
-    uint8_t* data = (uint8_t*) malloc(RX_BUF_SIZE + 1);
     while (1) {
-        const int len = uart_read_bytes(EX_UART_NUM, data, RX_BUF_SIZE, (100 / portTICK_PERIOD_MS));
-        if (len > 0) {
-            data[len] = 0;
-            __frame_process(data, len);
-        }
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        __frame_process();
     }
-    free(data);
 }
 
-void __mqtt_msg_cb(const char *topic, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+void __mqtt_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
 {
-    CC_LOGI(TAG, "msg %s: %.*s'", topic, len, data);
+    // 快速路径：透传给门锁的命令不经过 cJSON
+    downlink_fields_t fields;
+    if(__downlink_scan(data, len, &fields) && fields.type_len == 4 && memcmp(fields.type, "0002", 4) == 0){
+        ESP_LOGD(TAG, "msg %.*s: %.*s", topic_len, topic, (int)len, data);
+        if(fields.data){
+            __downlink_passthrough(fields.data, fields.data_len);
+        }else{
+            CC_LOGE(TAG, "data error");
+        }
+        return;
+    }
+
+    CC_LOGI(TAG, "msg %.*s: %.*s'", topic_len, topic, (int)len, data);
 
-    static uint8_t buf[FRAME_MAX_LEN] = {0};
     cJSON *root_obj = NULL, *type_obj = NULL, *data_obj = NULL;
 
-    root_obj = cJSON_Parse(data);
+    // data 不保证以 '\0' 结尾
+    root_obj = cJSON_ParseWithLength(data, len);
 
     if(root_obj){
         type_obj = cJSON_GetObjectItem(root_obj, "type");
-        if(type_obj && type_obj->type == cJSON_String && strcmp(type_obj->valuestring, "0002") == 0){
+        if(type_obj && type_obj->type == cJSON_String && strcmp(type_obj->valuestring, "0003") == 0){
+            // 云端选择上报负载格式
+            cJSON *fmt_obj = cJSON_GetObjectItem(root_obj, "fmt");
+            if(fmt_obj && fmt_obj->type == cJSON_String && strcmp(fmt_obj->valuestring, "cbor") == 0){
+                gs_mqtt_set_payload_fmt(GS_MQTT_FMT_CBOR);
+            }else if(fmt_obj && fmt_obj->type == cJSON_String && strcmp(fmt_obj->valuestring, "json") == 0){
+                gs_mqtt_set_payload_fmt(GS_MQTT_FMT_JSON);
+            }else{
+                CC_LOGE(TAG, "fmt error");
+            }
+        }else if(type_obj && type_obj->type == cJSON_String && strcmp(type_obj->valuestring, "0002") == 0){
+            // 快速路径不认识的写法（如带转义）
             data_obj = cJSON_GetObjectItem(root_obj, "data");
-            if(data_obj && data_obj->type == cJSON_String && strlen(data_obj->valuestring) <= MAX_DATA_LEN*2){
-                frame_parser_head_t *head = (frame_parser_head_t *)buf;
-                head->head = 0x23BB;
-                head->cmd = 0x02; 
-                stringToBinary(data_obj->valuestring, head->data, RX_BUF_SIZE, &head->len);
-                CC_LOGI_HEXDUMP(TAG, head->data, head->len);
-
-                frame_parser_last_t *last = (frame_parser_last_t *)(buf + sizeof(frame_parser_head_t) + head->len);
-                last->crc =  __crc_high_first((uint8_t *)head, sizeof(frame_parser_head_t) + head->len);
-                
-                // 发送回串口
-                uart_write_bytes(EX_UART_NUM, (const char *)head, 
-                                 sizeof(frame_parser_head_t) + head->len + sizeof(frame_parser_last_t));
+            if(data_obj && data_obj->type == cJSON_String){
+                __downlink_passthrough(data_obj->valuestring, strlen(data_obj->valuestring));
             }else{
                 CC_LOGE(TAG, "data error");
             }
@@ -220,12 +342,22 @@ cc_err_t __uart_init(void)
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
         .source_clk = UART_SCLK_DEFAULT,
     };
-    uart_driver_install(EX_UART_NUM, RX_BUF_SIZE * 2, 0, 0, NULL, 0);
+    uart_driver_install(EX_UART_NUM, RX_BUF_SIZE * 2, 0, EX_UART_QUEUE_LEN, &g_uart_queue, 0);
     uart_param_config(EX_UART_NUM, &uart_config);
 
     uart_set_pin(EX_UART_NUM, TXD_PIN, RXD_PIN, UART_PIN_NO_CHANGE, UART_PIN_NO_CHANGE);
 
-    xTaskCreate(__rx_task, "__rx_task", 3072, NULL, 6, NULL);
+    xTaskCreate(__parse_task, "__parse_task", 3072, NULL, 6, &g_parse_task);
+
+    uart_rx_port_config_t rx_config = {
+        .port = EX_UART_NUM,
+        .event_queue = g_uart_queue,
+        .on_data = __uart_rx_cb,
+    };
+    if(uart_rx_register(&rx_config) != ESP_OK){
+        CC_LOGE(TAG, "uart_rx_register failed");
+        return CC_FAIL;
+    }
     return CC_OK;
 }
 
@@ -259,12 +391,13 @@ cc_err_t product_init(void)
         CC_LOGI(TAG, "We have Wi-Fi config but won't connect now (waiting for 0x01)...");
     }
 
+    g_device_pub_topic = gs_mqtt_topic_register(PUB_TOPIC_DEVICE_PUB);
+    // 接收开始前准备好帧解析缓冲
+    frame_parser_init(32*5);
     __uart_init();
 
-    gs_mqtt_register_msg_cb(__mqtt_msg_cb);
-    cc_event_register_handler(GS_MQTT_EVENT, __event_handler);
-
-    frame_parser_init(32*5);
+    gs_mqtt_register_topic_msg_cb(SUB_TOPIC_SERVER_PUB, __mqtt_msg_cb);
+    cc_event_register_id(GS_MQTT_EVENT, GS_MQTT_EVENT_CONNECTED, __event_handler);
 
     return CC_OK;
 }
@@ -0,0 +1,291 @@
+// sys_stats.c
+// 任务与堆的运行时统计：周期采样经 MQTT 上报，或经 MQTT / HTTP 按需取回
+#include "sys_stats.h"
+#include <string.h>
+#include <stdlib.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/timers.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "esp_heap_caps.h"
+#include "json_writer.h"
+#include "cc_event.h"
+#include "gs_mqtt.h"
+#include "app_httpd.h"
+#include "boot_graph.h"
+#include "ui_cache.h"
+
+static const char *TAG = "sys_stats";
+
+#if CONFIG_SYS_STATS
+
+#define SYS_STATS_TASK_MAX      40
+#define SYS_STATS_JSON_SIZE     2560
+
+typedef struct {
+    UBaseType_t num;            // xTaskNumber，任务删除后不会复用
+    uint32_t run_time;
+} sys_stats_prev_t;
+
+static SemaphoreHandle_t s_mutex = NULL;
+static sys_stats_prev_t s_prev[SYS_STATS_TASK_MAX];
+static UBaseType_t s_prev_num = 0;
+static uint32_t s_prev_total = 0;
+
+static void sys_stats_heap(json_writer_t *w, const char *key, uint32_t caps)
+{
+    multi_heap_info_t info;
+    heap_caps_get_info(&info, caps);
+    if (info.total_free_bytes == 0 && info.total_allocated_bytes == 0) {
+        return;     // 没有该类内存（如未接 PSRAM）
+    }
+    // 碎片率：空闲内存中不能作为一整块分配出去的比例
+    uint32_t frag = info.total_free_bytes ? 100 - (uint32_t)((uint64_t)info.largest_free_block * 100 / info.total_free_bytes) : 0;
+    json_writer_key(w, key);
+    json_writer_array_begin(w);
+    json_writer_uint(w, info.total_free_bytes);
+    json_writer_uint(w, info.minimum_free_bytes);
+    json_writer_uint(w, info.largest_free_block);
+    json_writer_uint(w, frag);
+    json_writer_array_end(w);
+}
+
+// LVGL 图片缓存：未开启 CONFIG_UI_CACHE_STATS 或未初始化时不输出
+static void sys_stats_ui_cache(json_writer_t *w)
+{
+    static const char *const keys[UI_CACHE_MAX] = {"img", "hdr"};
+    ui_cache_stats_t st;
+    if (ui_cache_get_stats(UI_CACHE_IMAGE, &st, false) != ESP_OK) {
+        return;
+    }
+    json_writer_key(w, "ui_cache");
+    json_writer_object_begin(w);
+    for (int id = 0; id < UI_CACHE_MAX; id++) {
+        if (id && ui_cache_get_stats(id, &st, false) != ESP_OK) {
+            break;
+        }
+        json_writer_key(w, keys[id]);
+        json_writer_array_begin(w);
+        json_writer_uint(w, st.hits);
+        json_writer_uint(w, st.misses);
+        json_writer_uint(w, st.evictions);
+        json_writer_uint(w, st.size);
+        json_writer_uint(w, st.max_size);
+        json_writer_array_end(w);
+    }
+    json_writer_object_end(w);
+}
+
+static uint32_t sys_stats_prev_run_time(UBaseType_t num)
+{
+    for (UBaseType_t i = 0; i < s_prev_num; i++) {
+        if (s_prev[i].num == num) {
+            return s_prev[i].run_time;
+        }
+    }
+    return 0;
+}
+
+size_t sys_stats_sample(char *buf, size_t size)
+{
+    if (!s_mutex) {
+        return 0;
+    }
+    UBaseType_t cap = uxTaskGetNumberOfTasks() + 4;
+    TaskStatus_t *tasks = malloc(cap * sizeof(TaskStatus_t));
+    if (!tasks) {
+        return 0;
+    }
+
+    xSemaphoreTake(s_mutex, portMAX_DELAY);
+    configRUN_TIME_COUNTER_TYPE total = 0;
+    UBaseType_t n = uxTaskGetSystemState(tasks, cap, &total);
+    // 计数器是所有核共用的时间基准，每个核各自累计，总量按核数放大
+    uint32_t elapsed = (uint32_t)(total - s_prev_total) * portNUM_PROCESSORS;
+
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_object_begin(&w);
+    json_writer_kv_uint(&w, "up", (uint32_t)(esp_timer_get_time() / 1000000));
+    json_writer_key(&w, "heap");
+    json_writer_object_begin(&w);
+    sys_stats_heap(&w, "int", MALLOC_CAP_INTERNAL | MALLOC_CAP_8BIT);
+    sys_stats_heap(&w, "psram", MALLOC_CAP_SPIRAM);
+    sys_stats_heap(&w, "dma", MALLOC_CAP_DMA);
+    json_writer_object_end(&w);
+
+    json_writer_key(&w, "tasks");
+    json_writer_array_begin(&w);
+    for (UBaseType_t i = 0; i < n; i++) {
+        uint32_t run = (uint32_t)tasks[i].ulRunTimeCounter;
+        uint32_t delta = run - sys_stats_prev_run_time(tasks[i].xTaskNumber);
+        json_writer_array_begin(&w);
+        json_writer_str(&w, tasks[i].pcTaskName);
+        json_writer_uint(&w, elapsed ? (uint32_t)((uint64_t)delta * 100 / elapsed) : 0);
+        json_writer_uint(&w, tasks[i].usStackHighWaterMark);
+        json_writer_uint(&w, tasks[i].uxCurrentPriority);
+        json_writer_array_end(&w);
+    }
+    json_writer_array_end(&w);
+
+    const char *name;
+    uint32_t us;
+    json_writer_key(&w, "boot");
+    json_writer_array_begin(&w);
+    for (uint8_t i = 0; boot_graph_mark_get(i, &name, &us); i++) {
+        json_writer_array_begin(&w);
+        json_writer_str(&w, name);
+        json_writer_uint(&w, us);
+        json_writer_array_end(&w);
+    }
+    json_writer_array_end(&w);
+    sys_stats_ui_cache(&w);
+    json_writer_object_end(&w);
+
+    s_prev_num = n < SYS_STATS_TASK_MAX ? n : SYS_STATS_TASK_MAX;
+    for (UBaseType_t i = 0; i < s_prev_num; i++) {
+        s_prev[i].num = tasks[i].xTaskNumber;
+        s_prev[i].run_time = (uint32_t)tasks[i].ulRunTimeCounter;
+    }
+    s_prev_total = (uint32_t)total;
+    xSemaphoreGive(s_mutex);
+    free(tasks);
+
+    size_t len = json_writer_finish(&w);
+    if (len == 0) {
+        ESP_LOGW(TAG, "%u tasks do not fit in %u bytes", (unsigned)n, (unsigned)size);
+    }
+    return len;
+}
+
+static void sys_stats_publish(void)
+{
+    char *buf = heap_caps_malloc(SYS_STATS_JSON_SIZE, MALLOC_CAP_SPIRAM | MALLOC_CAP_8BIT);
+    if (!buf) {
+        buf = malloc(SYS_STATS_JSON_SIZE);
+    }
+    if (!buf) {
+        return;
+    }
+    size_t len = sys_stats_sample(buf, SYS_STATS_JSON_SIZE);
+    if (len) {
+        ESP_LOGI(TAG, "%s", buf);
+        cc_event_dump_stats();
+        // 统计只反映当时的状态，未连接时不进离线发件箱
+        if (gs_mqtt_connect_status()) {
+            gs_mqtt_publish(SYS_STATS_TOPIC_POST, (uint8_t *)buf, (uint16_t)len, GS_MQTT_QOS0, 0);
+        }
+    }
+    free(buf);
+}
+
+// 在 MQTT 任务中回调
+static void sys_stats_req_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    sys_stats_publish();
+}
+
+#if CONFIG_SYS_STATS_REPORT_S > 0
+static void sys_stats_timer_cb(TimerHandle_t timer)
+{
+    sys_stats_publish();
+}
+#endif
+
+// ?img_cache_kb=N / ?hdr_cache=N 先调整 LVGL 图片缓存预算，返回的统计已是新预算
+static void sys_stats_http_budget(httpd_req_t *req)
+{
+    char query[48];
+    char value[12];
+    if (httpd_req_get_url_query_str(req, query, sizeof(query)) != ESP_OK) {
+        return;
+    }
+    if (httpd_query_key_value(query, "img_cache_kb", value, sizeof(value)) == ESP_OK) {
+        ui_cache_set_budget(UI_CACHE_IMAGE, strtoul(value, NULL, 10) * 1024);
+    }
+    if (httpd_query_key_value(query, "hdr_cache", value, sizeof(value)) == ESP_OK) {
+        ui_cache_set_budget(UI_CACHE_HEADER, strtoul(value, NULL, 10));
+    }
+}
+
+static esp_err_t sys_stats_http_handler(httpd_req_t *req)
+{
+    sys_stats_http_budget(req);
+    char *buf = malloc(SYS_STATS_JSON_SIZE);
+    if (!buf) {
+        return httpd_resp_send_500(req);
+    }
+    size_t len = sys_stats_sample(buf, SYS_STATS_JSON_SIZE);
+    esp_err_t ret;
+    if (len) {
+        httpd_resp_set_type(req, "application/json");
+        ret = httpd_resp_send(req, buf, len);
+    } else {
+        ret = httpd_resp_send_500(req);
+    }
+    free(buf);
+    return ret;
+}
+
+static void sys_stats_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(SYS_STATS_TOPIC_REQ, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t sys_stats_init(void)
+{
+    if (s_mutex) {
+        return ESP_OK;
+    }
+    s_mutex = xSemaphoreCreateMutex();
+    if (!s_mutex) {
+        return ESP_ERR_NO_MEM;
+    }
+    gs_mqtt_register_topic_msg_cb(SYS_STATS_TOPIC_REQ, sys_stats_req_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, sys_stats_event_handler);
+
+#if CONFIG_SYS_STATS_REPORT_S > 0
+    TimerHandle_t timer = xTimerCreate("sys_stats", pdMS_TO_TICKS(CONFIG_SYS_STATS_REPORT_S * 1000UL),
+                                       pdTRUE, NULL, sys_stats_timer_cb);
+    if (!timer || xTimerStart(timer, 0) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to start report timer");
+    }
+#endif
+    ESP_LOGI(TAG, "report every %d s", CONFIG_SYS_STATS_REPORT_S);
+    return ESP_OK;
+}
+
+esp_err_t sys_stats_httpd_register(void)
+{
+    static const httpd_uri_t uri = {
+        .uri = "/stats",
+        .method = HTTP_GET,
+        .handler = sys_stats_http_handler,
+        .user_ctx = NULL,
+    };
+    return app_httpd_register_uri(&uri);
+}
+
+#else
+
+esp_err_t sys_stats_init(void)
+{
+    return ESP_OK;
+}
+
+size_t sys_stats_sample(char *buf, size_t size)
+{
+    return 0;
+}
+
+esp_err_t sys_stats_httpd_register(void)
+{
+    ESP_LOGW(TAG, "disabled");
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+#endif // CONFIG_SYS_STATS
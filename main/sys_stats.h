@@ -0,0 +1,54 @@
+/**
+ * @file sys_stats.h
+ * @brief 任务与堆的运行时统计：CPU 占用、栈余量、各能力堆的余量与碎片率
+ *
+ * 按 CONFIG_SYS_STATS_REPORT_S 周期采样并在 MQTT 已连接时发布到 SYS_STATS_TOPIC_POST，
+ * 也可随时取回：
+ *  - MQTT：向 SYS_STATS_TOPIC_REQ 发任意内容；
+ *  - HTTP：app_httpd 上的 GET /stats。
+ * CPU 占用为两次采样之间占全部核时间的百分比，取回也算一次采样。
+ *
+ * 负载（JSON）：
+ *   {"up":秒,"heap":{"int":[空闲,历史最小,最大块,碎片%],"psram":[...],"dma":[...]},
+ *    "tasks":[["名称",CPU%,栈最小余量(字节),优先级],...],
+ *    "boot":[["阶段",完成时间(us)],...],
+ *    "ui_cache":{"img":[命中,未命中,淘汰,占用(字节),预算],"hdr":[...,占用(条目),预算]}}
+ *
+ * ui_cache 只在开启 CONFIG_UI_CACHE_STATS 并调用 ui_cache_init() 后出现，计数为上电以来的累计值；
+ * GET /stats?img_cache_kb=N&hdr_cache=N 先调整图片缓存 / 图片头缓存的预算再返回统计。
+ */
+
+#ifndef SYS_STATS_H
+#define SYS_STATS_H
+
+#include <stddef.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SYS_STATS_TOPIC_REQ     "/service/stats"
+#define SYS_STATS_TOPIC_POST    "/event/stats/post"
+
+/**
+ * @brief 启动周期采样，登记 MQTT 取回命令，须在 gs_mqtt 初始化之后调用
+ */
+esp_err_t sys_stats_init(void);
+
+/**
+ * @brief 立即采样并生成 JSON，返回长度，缓冲不足或未开启返回 0
+ */
+size_t sys_stats_sample(char *buf, size_t size);
+
+/**
+ * @brief 在 app_httpd 上注册 GET /stats
+ */
+esp_err_t sys_stats_httpd_register(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYS_STATS_H
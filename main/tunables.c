@@ -0,0 +1,213 @@
+// tunables.c
+// 可调参数登记、整批校验与 KVS 序列化；与平台无关，MQTT 与 KVS 部分在 tunables_remote.c
+#include "tunables.h"
+#include <string.h>
+#include "json_writer.h"
+
+#define TUNABLES_BLOB_MAGIC     0x314E5554  // "TUN1"
+#define TUNABLES_BLOB_HDR       12
+
+typedef struct {
+    uint32_t hash;
+    int32_t value;
+} tunables_stored_t;
+
+static tunable_t *s_list = NULL;
+static uint32_t s_version = 0;
+// 从 KVS 载入的项，载入后只读，登记时按名称哈希取值
+static tunables_stored_t s_stored[TUNABLES_STORE_MAX];
+static uint32_t s_stored_num = 0;
+
+static uint32_t tunables_hash(const char *name)
+{
+    uint32_t h = 2166136261u;
+    while (*name) {
+        h = (h ^ (uint8_t)*name++) * 16777619u;
+    }
+    return h;
+}
+
+static inline bool tunables_in_range(const tunable_t *t, int32_t value)
+{
+    return value >= t->min && value <= t->max;
+}
+
+static bool tunables_stored_get(uint32_t hash, int32_t *value)
+{
+    for (uint32_t i = 0; i < s_stored_num; i++) {
+        if (s_stored[i].hash == hash) {
+            *value = s_stored[i].value;
+            return true;
+        }
+    }
+    return false;
+}
+
+void tunables_register(tunable_t *t)
+{
+    if (__atomic_exchange_n(&t->registered, true, __ATOMIC_ACQ_REL)) {
+        return;
+    }
+    int32_t value;
+    if (tunables_stored_get(tunables_hash(t->name), &value) && tunables_in_range(t, value)) {
+        __atomic_store_n(&t->value, value, __ATOMIC_RELAXED);
+    }
+    // 各模块可能在不同的启动任务中登记，无锁头插
+    tunable_t *head = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE);
+    do {
+        t->next = head;
+    } while (!__atomic_compare_exchange_n(&s_list, &head, t, true, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE));
+}
+
+tunable_t *tunables_find(const char *name)
+{
+    for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t; t = t->next) {
+        if (strcmp(t->name, name) == 0) {
+            return t;
+        }
+    }
+    return NULL;
+}
+
+uint32_t tunables_version(void)
+{
+    return __atomic_load_n(&s_version, __ATOMIC_RELAXED);
+}
+
+tunables_result_t tunables_apply(uint32_t version, const tunables_set_t *set, size_t n, size_t *bad)
+{
+    if (version <= tunables_version()) {
+        return TUNABLES_STALE;
+    }
+    // 先整批校验，全部通过再写入
+    for (size_t i = 0; i < n; i++) {
+        tunable_t *t = tunables_find(set[i].name);
+        tunables_result_t res = !t ? TUNABLES_UNKNOWN :
+                                !tunables_in_range(t, set[i].value) ? TUNABLES_RANGE : TUNABLES_OK;
+        if (res != TUNABLES_OK) {
+            if (bad) {
+                *bad = i;
+            }
+            return res;
+        }
+    }
+    for (size_t i = 0; i < n; i++) {
+        __atomic_store_n(&tunables_find(set[i].name)->value, set[i].value, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&s_version, version, __ATOMIC_RELAXED);
+    for (size_t i = 0; i < n; i++) {
+        tunable_t *t = tunables_find(set[i].name);
+        if (t->on_change) {
+            t->on_change(t);
+        }
+    }
+    return TUNABLES_OK;
+}
+
+tunables_result_t tunables_reset(uint32_t version)
+{
+    if (version <= tunables_version()) {
+        return TUNABLES_STALE;
+    }
+    s_stored_num = 0;
+    for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t; t = t->next) {
+        if (__atomic_exchange_n(&t->value, t->def, __ATOMIC_RELAXED) != t->def && t->on_change) {
+            t->on_change(t);
+        }
+    }
+    __atomic_store_n(&s_version, version, __ATOMIC_RELAXED);
+    return TUNABLES_OK;
+}
+
+static inline void tunables_put_u32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t tunables_get_u32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+static bool tunables_put_entry(uint8_t *buf, size_t cap, uint32_t *num, uint32_t hash, int32_t value)
+{
+    size_t off = TUNABLES_BLOB_HDR + *num * 8;
+    if (*num >= TUNABLES_STORE_MAX || off + 8 > cap) {
+        return false;
+    }
+    tunables_put_u32(buf + off, hash);
+    tunables_put_u32(buf + off + 4, (uint32_t)value);
+    (*num)++;
+    return true;
+}
+
+size_t tunables_encode(uint8_t *buf, size_t cap)
+{
+    uint32_t num = 0;
+    if (cap < TUNABLES_BLOB_HDR) {
+        return 0;
+    }
+    for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t; t = t->next) {
+        int32_t value = tunable_get(t);
+        if (value != t->def && !tunables_put_entry(buf, cap, &num, tunables_hash(t->name), value)) {
+            return 0;
+        }
+    }
+    // 尚未登记的模块的项原样保留
+    for (uint32_t i = 0; i < s_stored_num; i++) {
+        bool registered = false;
+        for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t && !registered; t = t->next) {
+            registered = tunables_hash(t->name) == s_stored[i].hash;
+        }
+        if (!registered && !tunables_put_entry(buf, cap, &num, s_stored[i].hash, s_stored[i].value)) {
+            return 0;
+        }
+    }
+    tunables_put_u32(buf, TUNABLES_BLOB_MAGIC);
+    tunables_put_u32(buf + 4, tunables_version());
+    tunables_put_u32(buf + 8, num);
+    return TUNABLES_BLOB_HDR + num * 8;
+}
+
+bool tunables_decode(const uint8_t *buf, size_t len)
+{
+    if (len < TUNABLES_BLOB_HDR || tunables_get_u32(buf) != TUNABLES_BLOB_MAGIC) {
+        return false;
+    }
+    uint32_t num = tunables_get_u32(buf + 8);
+    if (num > TUNABLES_STORE_MAX || len != TUNABLES_BLOB_HDR + num * 8) {
+        return false;
+    }
+    for (uint32_t i = 0; i < num; i++) {
+        s_stored[i].hash = tunables_get_u32(buf + TUNABLES_BLOB_HDR + i * 8);
+        s_stored[i].value = (int32_t)tunables_get_u32(buf + TUNABLES_BLOB_HDR + i * 8 + 4);
+    }
+    s_stored_num = num;
+    for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t; t = t->next) {
+        int32_t value;
+        if (tunables_stored_get(tunables_hash(t->name), &value) && tunables_in_range(t, value)) {
+            __atomic_store_n(&t->value, value, __ATOMIC_RELAXED);
+        }
+    }
+    __atomic_store_n(&s_version, tunables_get_u32(buf + 4), __ATOMIC_RELAXED);
+    return true;
+}
+
+size_t tunables_values_json(char *buf, size_t size)
+{
+    json_writer_t w;
+    json_writer_init(&w, buf, size);
+    json_writer_object_begin(&w);
+    for (tunable_t *t = __atomic_load_n(&s_list, __ATOMIC_ACQUIRE); t; t = t->next) {
+        if (t->type == TUNABLE_BOOL) {
+            json_writer_kv_bool(&w, t->name, tunable_get(t) != 0);
+        } else {
+            json_writer_kv_int(&w, t->name, tunable_get(t));
+        }
+    }
+    json_writer_object_end(&w);
+    return json_writer_finish(&w);
+}
@@ -0,0 +1,138 @@
+/**
+ * @file tunables.h
+ * @brief 运行时可调参数：带上下界的整型/布尔参数，经 MQTT 成批下发、带版本号，持久化到 KVS（CONFIG_TUNABLES）
+ *
+ * 参数是各模块的静态变量，登记后可被远程修改；读取只是一次原子加载，可在任意任务中调用：
+ *   static tunable_t s_timeout_ms = TUNABLE_INT_INIT("img_transfer.timeout_ms", 3000, 500, 15000);
+ *   tunables_register(&s_timeout_ms);
+ *   uint32_t ms = tunable_get(&s_timeout_ms);
+ * 只在启动时读取一次的参数（如帧率）修改后下次启动生效。
+ *
+ * 下发（TUNABLES_TOPIC_SET）：
+ *   {"version":N,"set":{"img_transfer.timeout_ms":2500,"log.level":3}}
+ *   {"version":N,"reset":true}       全部恢复默认值
+ *   {"op":"get"}                     只回报当前值
+ * 一批修改整体校验：版本号须大于当前版本，每一项都须已登记、是整数（布尔参数可用 true/false）且在上下界内，
+ * 任何一项不通过整批都不生效。通过后一起写入、保存到 KVS 并调用各参数的 on_change。
+ * 结果发布到 TUNABLES_TOPIC_EVENT：
+ *   {"version":当前版本,"result":"ok|stale|unknown|range|type","name":出错项,"values":{名称:值,...}}
+ *
+ * KVS 中只存与默认值不同的项（名称的 FNV-1a 哈希 + 值），尚未登记的模块的项保留到其登记时再生效。
+ */
+
+#ifndef TUNABLES_H
+#define TUNABLES_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "sdkconfig.h"
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TUNABLES_TOPIC_SET      "/service/tunables"
+#define TUNABLES_TOPIC_EVENT    "/event/tunables"
+#define TUNABLES_KVS_KEY        "tunables"
+
+#define TUNABLES_STORE_MAX      32          // KVS 中最多保存的非默认项
+#define TUNABLES_BLOB_MAX       (12 + TUNABLES_STORE_MAX * 8)
+
+typedef enum {
+    TUNABLE_INT = 0,
+    TUNABLE_BOOL,
+} tunable_type_t;
+
+typedef enum {
+    TUNABLES_OK = 0,
+    TUNABLES_STALE,             // 版本号不大于当前版本
+    TUNABLES_UNKNOWN,           // 名称未登记
+    TUNABLES_RANGE,             // 超出上下界
+    TUNABLES_TYPE,              // 不是整数或布尔值
+} tunables_result_t;
+
+typedef struct tunable {
+    const char *name;
+    struct tunable *next;
+    int32_t value;
+    int32_t def;
+    int32_t min;
+    int32_t max;
+    uint8_t type;
+    bool registered;
+    void (*on_change)(struct tunable *t);   // 远程修改生效后在 MQTT 任务中调用
+} tunable_t;
+
+#define TUNABLE_INT_INIT(n, d, lo, hi) \
+    { .name = (n), .value = (d), .def = (d), .min = (lo), .max = (hi), .type = TUNABLE_INT }
+#define TUNABLE_BOOL_INIT(n, d) \
+    { .name = (n), .value = (d), .def = (d), .min = 0, .max = 1, .type = TUNABLE_BOOL }
+
+typedef struct {
+    const char *name;
+    int32_t value;
+} tunables_set_t;
+
+static inline int32_t tunable_get(const tunable_t *t)
+{
+    return __atomic_load_n(&t->value, __ATOMIC_RELAXED);
+}
+
+/**
+ * @brief 登记参数，重复登记忽略；已从 KVS 载入该参数的值时立即生效。可在 tunables_init() 之前调用
+ */
+void tunables_register(tunable_t *t);
+
+tunable_t *tunables_find(const char *name);
+
+uint32_t tunables_version(void);
+
+/**
+ * @brief 校验一批修改，全部通过才一起写入并把版本号更新为 version，否则不做任何改动
+ *
+ * @param bad 不通过时置为出错项的下标，可为 NULL
+ */
+tunables_result_t tunables_apply(uint32_t version, const tunables_set_t *set, size_t n, size_t *bad);
+
+/**
+ * @brief 全部恢复默认值并丢弃 KVS 中尚未登记的项
+ */
+tunables_result_t tunables_reset(uint32_t version);
+
+/**
+ * @brief 序列化版本号与非默认项，供写入 KVS
+ *
+ * @return 写入的字节数；cap 不足返回 0
+ */
+size_t tunables_encode(uint8_t *buf, size_t cap);
+
+/**
+ * @brief 载入 tunables_encode() 的输出：恢复版本号，已登记的参数立即生效，其余的保留到登记时
+ */
+bool tunables_decode(const uint8_t *buf, size_t len);
+
+/**
+ * @brief 当前全部参数的 JSON 对象 {名称:值,...}
+ */
+size_t tunables_values_json(char *buf, size_t size);
+
+#if CONFIG_TUNABLES
+
+/**
+ * @brief 从 KVS 载入参数并登记 MQTT 下发主题，须在 cc_hal_kvs_init() 之后、gs_mqtt 连接之前调用
+ */
+esp_err_t tunables_init(void);
+
+#else
+
+static inline esp_err_t tunables_init(void) { return ESP_OK; }
+
+#endif // CONFIG_TUNABLES
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TUNABLES_H
@@ -0,0 +1,157 @@
+// tunables_remote.c
+// 可调参数的 KVS 持久化与 MQTT 下发，见 tunables.h
+#include "tunables.h"
+
+#if CONFIG_TUNABLES
+
+#include <string.h>
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "cJSON.h"
+#include "cc_hal_kvs.h"
+#include "cc_event.h"
+#include "gs_mqtt.h"
+
+static const char *TAG = "tunables";
+
+#define TUNABLES_SET_MAX        16          // 单次下发最多的项数
+#define TUNABLES_VALUES_SIZE    1024
+#define TUNABLES_EVENT_SIZE     (TUNABLES_VALUES_SIZE + 128)
+
+// 全局日志级别，0（ESP_LOG_NONE）到 5（ESP_LOG_VERBOSE），不超过编译期的 LOG_LOCAL_LEVEL
+static tunable_t s_log_level = TUNABLE_INT_INIT("log.level", CONFIG_LOG_DEFAULT_LEVEL, ESP_LOG_NONE, ESP_LOG_VERBOSE);
+
+static const char *const s_result_str[] = {
+    [TUNABLES_OK] = "ok",
+    [TUNABLES_STALE] = "stale",
+    [TUNABLES_UNKNOWN] = "unknown",
+    [TUNABLES_RANGE] = "range",
+    [TUNABLES_TYPE] = "type",
+};
+
+static char s_event[TUNABLES_EVENT_SIZE];
+
+static void tunables_log_level_changed(tunable_t *t)
+{
+    esp_log_level_set("*", (esp_log_level_t)tunable_get(t));
+}
+
+static void tunables_save(void)
+{
+    uint8_t blob[TUNABLES_BLOB_MAX];
+    size_t len = tunables_encode(blob, sizeof(blob));
+    if (!len) {
+        ESP_LOGW(TAG, "Too many non-default tunables, not saved");
+        return;
+    }
+    if (cc_hal_kvs_set(TUNABLES_KVS_KEY, blob, len) != CC_OK) {
+        ESP_LOGW(TAG, "Failed to save tunables");
+    }
+}
+
+// 只在 MQTT 任务中调用，s_event 不需要加锁
+static void tunables_report(tunables_result_t res, const char *name)
+{
+    char values[TUNABLES_VALUES_SIZE];
+    if (!tunables_values_json(values, sizeof(values))) {
+        strcpy(values, "{}");
+    }
+    int len = snprintf(s_event, sizeof(s_event), "{\"version\":%" PRIu32 ",\"result\":\"%s\",\"name\":\"%s\",\"values\":%s}",
+                       tunables_version(), s_result_str[res], name ? name : "", values);
+    if (len > 0 && len < (int)sizeof(s_event)) {
+        gs_mqtt_publish(TUNABLES_TOPIC_EVENT, (uint8_t *)s_event, (uint16_t)len, GS_MQTT_QOS0, 0);
+    }
+}
+
+// 整数或布尔值转为 int32，其他类型与非整数返回 false
+static bool tunables_json_value(const cJSON *item, int32_t *value)
+{
+    if (cJSON_IsBool(item)) {
+        *value = cJSON_IsTrue(item) ? 1 : 0;
+        return true;
+    }
+    if (!cJSON_IsNumber(item) || item->valuedouble < INT32_MIN || item->valuedouble > INT32_MAX) {
+        return false;
+    }
+    *value = (int32_t)item->valuedouble;
+    return (double)*value == item->valuedouble;
+}
+
+static void tunables_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGW(TAG, "Invalid tunables message");
+        return;
+    }
+    cJSON *op = cJSON_GetObjectItem(root, "op");
+    cJSON *ver = cJSON_GetObjectItem(root, "version");
+    cJSON *set = cJSON_GetObjectItem(root, "set");
+    tunables_result_t res = TUNABLES_OK;
+    const char *bad_name = NULL;
+
+    if (cJSON_IsString(op) && strcmp(op->valuestring, "get") == 0) {
+        // 只回报
+    } else if (!cJSON_IsNumber(ver) || ver->valuedouble < 1) {
+        res = TUNABLES_STALE;
+    } else if (cJSON_IsTrue(cJSON_GetObjectItem(root, "reset"))) {
+        res = tunables_reset((uint32_t)ver->valuedouble);
+    } else if (cJSON_IsObject(set)) {
+        tunables_set_t items[TUNABLES_SET_MAX];
+        size_t n = 0;
+        size_t bad = 0;
+        for (cJSON *item = set->child; item; item = item->next) {
+            if (n >= TUNABLES_SET_MAX || !tunables_json_value(item, &items[n].value)) {
+                res = TUNABLES_TYPE;
+                bad_name = item->string;
+                break;
+            }
+            items[n++].name = item->string;
+        }
+        if (res == TUNABLES_OK) {
+            res = tunables_apply((uint32_t)ver->valuedouble, items, n, &bad);
+            if (res == TUNABLES_UNKNOWN || res == TUNABLES_RANGE) {
+                bad_name = items[bad].name;
+            }
+        }
+    } else {
+        res = TUNABLES_TYPE;
+    }
+
+    if (res == TUNABLES_OK && !cJSON_IsString(op)) {
+        tunables_save();
+        ESP_LOGI(TAG, "Tunables updated to version %" PRIu32, tunables_version());
+    } else if (res != TUNABLES_OK) {
+        ESP_LOGW(TAG, "Tunables update rejected: %s %s", s_result_str[res], bad_name ? bad_name : "");
+    }
+    tunables_report(res, bad_name);
+    cJSON_Delete(root);
+}
+
+static void tunables_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        gs_mqtt_subscribe(TUNABLES_TOPIC_SET, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t tunables_init(void)
+{
+    uint8_t blob[TUNABLES_BLOB_MAX];
+    size_t len = sizeof(blob);
+    if (cc_hal_kvs_get(TUNABLES_KVS_KEY, blob, &len) == CC_OK && !tunables_decode(blob, len)) {
+        ESP_LOGW(TAG, "Stored tunables invalid, using defaults");
+    }
+    s_log_level.on_change = tunables_log_level_changed;
+    tunables_register(&s_log_level);
+    if (tunable_get(&s_log_level) != s_log_level.def) {
+        tunables_log_level_changed(&s_log_level);
+    }
+    gs_mqtt_register_topic_msg_cb(TUNABLES_TOPIC_SET, tunables_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, tunables_event_handler);
+    ESP_LOGI(TAG, "Tunables version %" PRIu32, tunables_version());
+    return ESP_OK;
+}
+
+#endif // CONFIG_TUNABLES
@@ -4,13 +4,50 @@
 #include "freertos/task.h"
 #include "uvc_camera.h"    // 提供 esp_camera_fb_get()/esp_camera_fb_return() 接口
 #include "img_upload.h"    // 提供 img_upload_send() 接口
+#include "img_upload_queue.h"  // 上传失败时转入后台重试/暂存
+#include "img_fanout.h"    // 同一帧并行上传到其他目的地
+#include "power_profile.h"
+#include "coex_policy.h"
+#include "board_power.h"   // 摄像头上电与 CPU 调频
+#include "img_preroll.h"   // 提供事件前的预录帧
+#include "img_thumb.h"     // 先传缩略图
+#include "img_clip.h"      // 事件前后的短视频
+#include "img_detect.h"    // 有目标时只先传裁剪图
 #include "cc_hal_sys.h"    // 用于获取系统时间（判断超时）
+#include "cc_worker.h"
 #include "net_uart_comm.h"
+#include "uart_parse.h"
+#include "checksum.h"
+#include "lat_trace.h"
+#include "evt_log.h"
+#include "metrics.h"
+#include "tunables.h"
 
 static const char *TAG = "img_transfer";
 
-// 定义图传任务超时（单位：毫秒）
+// 定义图传任务超时（单位：毫秒），可远程调整
 #define IMG_TRANSFER_TIMEOUT_MS    3000
+static tunable_t s_timeout_ms = TUNABLE_INT_INIT("img_transfer.timeout_ms", IMG_TRANSFER_TIMEOUT_MS, 500, 15000);
+
+// 从收到拍照命令到回复结果的耗时
+static metrics_hist_t s_total_ms = METRICS_HIST_INIT("img_upload.total_ms");
+
+// 预录连拍：1 表示只上传最新一帧，>1 时额外上传事件前 IMG_TRANSFER_PREROLL_WINDOW_MS 内的帧
+#define IMG_TRANSFER_PREROLL_BURST_NUM   1
+#define IMG_TRANSFER_PREROLL_WINDOW_MS   1000
+
+// 预录环为空时，是否对下一帧使用边采集边上传的流式上传（失败再回退到整帧上传）
+// YUY2 摄像头的帧在设备上编码，负载不是 JPEG，不能流式上传
+#if CONFIG_UVC_CAMERA_FORMAT_YUY2
+#define IMG_TRANSFER_STREAM_UPLOAD       0
+#else
+#define IMG_TRANSFER_STREAM_UPLOAD       1
+#endif
+
+// 先上传缩略图（1/2^SCALE 尺寸）并据此回复 MCU，原图随后交给后台队列上传
+#define IMG_TRANSFER_THUMB_FIRST         1
+#define IMG_TRANSFER_THUMB_SCALE         2      // 1280x720 -> 320x180
+#define IMG_TRANSFER_THUMB_QUALITY       60
 
 // 内部状态变量：记录图传是否已开启（后续可以用于禁止主动采集）
 static bool s_img_transfer_enabled = false;
@@ -22,11 +59,7 @@ static bool s_img_transfer_enabled = false;
  */
 static uint16_t calc_data_checksum(const uint8_t *data, size_t len)
 {
-    uint32_t sum = 0;
-    for (size_t i = 0; i < len; i++) {
-        sum += data[i];
-    }
-    return (uint16_t)(sum & 0xFFFF);
+    return (uint16_t)(checksum_sum8(data, len) & 0xFFFF);
 }
 
 /**
@@ -40,56 +73,183 @@ static uint16_t calc_data_checksum(const uint8_t *data, size_t len)
  */
 static void send_img_transfer_result(uint8_t result_code, uint16_t img_size, uint16_t img_checksum)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command   = 0x27;
-    packet.data[0] = result_code;
-    packet.data[1] = (uint8_t)(img_size & 0xFF);
-    packet.data[2] = (uint8_t)((img_size >> 8) & 0xFF);
-    packet.data[3] = (uint8_t)(img_checksum & 0xFF);
-    packet.data[4] = (uint8_t)((img_checksum >> 8) & 0xFF);
-    packet.data[5] = 0x00;
-    packet.checksum = uart_comm_calc_checksum((uint8_t *)&packet, sizeof(uart_packet_t) - 1);
+    uint8_t data[6] = {0};
+    data[0] = result_code;
+    uart_put_le16(data + 1, img_size);
+    uart_put_le16(data + 3, img_checksum);
 
     ESP_LOGI(TAG, "Sending img transfer result: result=0x%02X, size=%u, checksum=0x%04X", result_code, img_size, img_checksum);
-    esp_err_t err = uart_comm_send_packet(&packet);
+    esp_err_t err = uart_comm_send_cmd(CMD_IMG_TRANSFER_RESULT, data);
     if (err != ESP_OK) {
         ESP_LOGE(TAG, "Failed to send img transfer result, err=0x%x", err);
     }
+    evt_log(EVT_MOD_IMG, EVT_IMG_RESULT, result_code, img_size);
+    lat_trace_mark(LAT_TRACE_RESULT_TX, result_code);
+    lat_trace_report();
+}
+
+static void release_preroll(void *ctx)
+{
+    img_preroll_return((const img_preroll_frame_t *)ctx);
+}
+
+static void release_fb(void *ctx)
+{
+    esp_camera_fb_return((camera_fb_t *)ctx);
+}
+
+/**
+ * @brief 上传预录环中事件前的较旧帧（不含最新帧），失败不影响图传结果
+ */
+static void upload_preroll_burst(void)
+{
+#if IMG_TRANSFER_PREROLL_BURST_NUM > 1
+    const img_preroll_frame_t *frames[IMG_TRANSFER_PREROLL_BURST_NUM];
+    size_t num = img_preroll_get_burst(frames, IMG_TRANSFER_PREROLL_BURST_NUM, IMG_TRANSFER_PREROLL_WINDOW_MS);
+    // 最后一帧为最新帧，由主流程上传
+    if (num > 1) {
+        const uint8_t *data[IMG_TRANSFER_PREROLL_BURST_NUM];
+        size_t len[IMG_TRANSFER_PREROLL_BURST_NUM];
+        esp_err_t ret[IMG_TRANSFER_PREROLL_BURST_NUM];
+        for (size_t i = 0; i + 1 < num; i++) {
+            data[i] = frames[i]->buf;
+            len[i] = frames[i]->len;
+        }
+        img_upload_send_burst(data, len, num - 1, ret);
+    }
+    for (size_t i = 0; i < num; i++) {
+        img_preroll_return(frames[i]);
+    }
+#endif
 }
 
 /**
- * @brief 图传处理任务
+ * @brief 图传处理作业，在 cc_worker 的工作任务中运行
  *
- * 任务步骤：
- *   1. 调用摄像头接口采集一帧图片；
+ * 步骤：
+ *   1. 优先从预录环取足够新的最新一帧（无采集等待），没有新鲜的预录帧时再向摄像头取帧；
  *   2. 计算图片大小与校验和；
- *   3. 调用 img_upload_send() 接口上传图片数据；
- *   4. 判断采集上传过程是否超时（超过 IMG_TRANSFER_TIMEOUT_MS 则视为超时），
+ *   3. 按配置上传事件前的预录帧，再调用 img_upload_send() 上传最新一帧；
+ *      开启 CONFIG_IMG_DETECT 且检测到目标时只上传目标区域的裁剪图，原图等服务器索取；
+ *      否则开启 IMG_TRANSFER_THUMB_FIRST 时先上传缩略图，原图交给后台队列稍后上传；
+ *   4. 判断采集上传过程是否超时（超过 img_transfer.timeout_ms 则视为超时），
  *      并最终发送图传结果数据包（命令 0x27）。
  */
-static void img_transfer_task(void *arg)
+static void img_transfer_job(void *arg)
 {
     TickType_t start_tick = xTaskGetTickCount();
+    uint32_t timeout_ms = tunable_get(&s_timeout_ms);
+    // 采集上传期间关闭 Wi-Fi 省电，避免 modem sleep 拉长上传耗时
+    power_profile_hold(POWER_HOLD_IMG_UPLOAD);
+    coex_policy_hold(COEX_HOLD_IMG_UPLOAD);
+    // 摄像头断电时上电并等待重新枚举，所用时间计入本次超时
+    board_power_hold(BOARD_HOLD_CAPTURE);
 
-    // 采集一帧 JPEG 图片（内部采用同步方式）
-    camera_fb_t *fb = esp_camera_fb_get();
-    if (!fb) {
-        ESP_LOGE(TAG, "Failed to capture image from camera");
-        send_img_transfer_result(0x02, 0, 0);  // 超时或采集失败
-        vTaskDelete(NULL);
-        return;
+    const uint8_t *img_buf = NULL;
+    size_t img_len = 0;
+    camera_fb_t *fb = NULL;
+    const img_preroll_frame_t *pre = img_preroll_get_latest();
+#if IMG_TRANSFER_STREAM_UPLOAD
+    if (!pre) {
+        size_t stream_len = 0;
+        uint32_t stream_sum = 0;
+        // 按需采集模式下需登记需求，驱动才会把负载交给流式上传
+        esp_err_t ret = uvc_camera_demand_begin();
+        if (ret == ESP_OK) {
+            ret = img_upload_stream_next_frame(timeout_ms, &stream_len, &stream_sum);
+            uvc_camera_demand_end();
+        }
+        if (ret == ESP_OK) {
+            TickType_t elapsed = xTaskGetTickCount() - start_tick;
+            uint8_t result_code = (elapsed > pdMS_TO_TICKS(timeout_ms)) ? 0x02 : 0x00;
+            send_img_transfer_result(result_code, (uint16_t)stream_len, (uint16_t)(stream_sum & 0xFFFF));
+            power_profile_release(POWER_HOLD_IMG_UPLOAD);
+            coex_policy_release(COEX_HOLD_IMG_UPLOAD);
+            board_power_release(BOARD_HOLD_CAPTURE);
+            return;
+        }
+        ESP_LOGW(TAG, "Stream upload failed (0x%x), fallback to frame upload", ret);
     }
+#endif
+    if (pre) {
+        img_buf = pre->buf;
+        img_len = pre->len;
+        lat_trace_mark(LAT_TRACE_FB_GET, 1);
+    } else {
+        // 取最新一帧 JPEG 图片，超时则快速失败
+        fb = esp_camera_fb_get_timeout(timeout_ms);
+        if (!fb) {
+            ESP_LOGE(TAG, "Failed to capture image from camera");
+            send_img_transfer_result(0x02, 0, 0);  // 超时或采集失败
+            power_profile_release(POWER_HOLD_IMG_UPLOAD);
+            coex_policy_release(COEX_HOLD_IMG_UPLOAD);
+            board_power_release(BOARD_HOLD_CAPTURE);
+            return;
+        }
+        img_buf = fb->buf;
+        img_len = fb->len;
+        lat_trace_mark(LAT_TRACE_FB_GET, 0);
+    }
+
+    uint16_t img_size     = (uint16_t)img_len;
+    uint16_t img_checksum = calc_data_checksum(img_buf, img_len);
+    ESP_LOGI(TAG, "Captured image: size=%u bytes, checksum=0x%04X%s", img_len, img_checksum, pre ? " (preroll)" : "");
 
-    uint16_t img_size     = (uint16_t)fb->len;
-    uint16_t img_checksum = calc_data_checksum((const uint8_t *)fb->buf, fb->len);
-    ESP_LOGI(TAG, "Captured image: size=%u bytes, checksum=0x%04X", fb->len, img_checksum);
+    // 原图同时交给其他目的地上传，帧在所有目的地结束后才归还
+    img_fanout_frame_t *fanout = pre ? img_fanout_send(img_buf, img_len, release_preroll, (void *)pre)
+                                     : img_fanout_send(img_buf, img_len, release_fb, fb);
 
-    // 上传图片数据
-    esp_err_t ret = img_upload_send((const uint8_t *)fb->buf, fb->len);
+    upload_preroll_burst();
+    esp_err_t ret = ESP_FAIL;
+    bool thumb_sent = false;
+#if CONFIG_IMG_DETECT
+    uint8_t *crop = NULL;
+    size_t crop_len = 0;
+    if (img_detect_event(img_buf, img_len, &crop, &crop_len) == ESP_OK) {
+        ret = img_upload_send(crop, crop_len);
+        if (ret == ESP_OK) {
+            // 回复 MCU 的大小与校验和对应裁剪图，原图不再主动上传
+            thumb_sent = true;
+            img_size     = (uint16_t)crop_len;
+            img_checksum = calc_data_checksum(crop, crop_len);
+            ESP_LOGI(TAG, "ROI crop uploaded: size=%u bytes, full frame on request", crop_len);
+        }
+        img_thumb_free(crop);
+    }
+#endif
+#if IMG_TRANSFER_THUMB_FIRST
+    uint8_t *thumb = NULL;
+    size_t thumb_len = 0;
+    if (!thumb_sent && img_thumb_make(img_buf, img_len, IMG_TRANSFER_THUMB_SCALE, IMG_TRANSFER_THUMB_QUALITY,
+                                      &thumb, &thumb_len) == ESP_OK) {
+        ret = img_upload_send(thumb, thumb_len);
+        if (ret == ESP_OK) {
+            // 回复 MCU 的大小与校验和对应实际先上传的缩略图
+            thumb_sent = true;
+            img_size     = (uint16_t)thumb_len;
+            img_checksum = calc_data_checksum(thumb, thumb_len);
+            ESP_LOGI(TAG, "Thumbnail uploaded: size=%u bytes, original follows", thumb_len);
+            img_upload_queue_push(img_buf, img_len);
+        }
+        img_thumb_free(thumb);
+    }
+#endif
+    if (!thumb_sent) {
+        // 上传图片数据
+        ret = img_upload_send(img_buf, img_len);
+        if (ret != ESP_OK && ret != ESP_ERR_INVALID_ARG) {
+            // 交给后台队列重试，失败则暂存 flash，联网后补传
+            img_upload_queue_push(img_buf, img_len);
+        }
+    }
     // 释放采集的帧
-    esp_camera_fb_return(fb);
+    if (fanout) {
+        img_fanout_frame_put(fanout);
+    } else if (pre) {
+        img_preroll_return(pre);
+    } else {
+        esp_camera_fb_return(fb);
+    }
 
     uint8_t result_code = 0x00;
     if (ret != ESP_OK) {
@@ -99,53 +259,40 @@ static void img_transfer_task(void *arg)
 
     // 判断采集上传是否超时
     TickType_t elapsed = xTaskGetTickCount() - start_tick;
-    if (elapsed > pdMS_TO_TICKS(IMG_TRANSFER_TIMEOUT_MS)) {
+    metrics_hist_record(&s_total_ms, elapsed * portTICK_PERIOD_MS);
+    if (elapsed > pdMS_TO_TICKS(timeout_ms)) {
         ESP_LOGW(TAG, "Image transfer timeout: elapsed %u ms", (unsigned)(elapsed * portTICK_PERIOD_MS));
         result_code = 0x02;
     }
 
     // 发送图传结果数据包（命令 0x27）
     send_img_transfer_result(result_code, img_size, img_checksum);
-    vTaskDelete(NULL);
+    power_profile_release(POWER_HOLD_IMG_UPLOAD);
+    coex_policy_release(COEX_HOLD_IMG_UPLOAD);
+    board_power_release(BOARD_HOLD_CAPTURE);
 }
 
 /**
  * @brief 处理 MCU 发送的图传设置命令（命令 0x1C）
  *
- * 根据数据区 data[0] 判断：
- *   - 0x00 表示开启图传：回复应答后异步启动图传任务；
- *   - 0x01 表示关闭图传：仅回复应答并置 s_img_transfer_enabled 为 false。
+ * 应答（0x1D）已由命令表回复，根据数据区 data[0] 判断：
+ *   - 0x00 表示开启图传：提交图传作业；
+ *   - 0x01 表示关闭图传：置 s_img_transfer_enabled 为 false。
  */
-void img_transfer_handle_uart_packet(const uart_packet_t *packet)
+uint8_t img_transfer_handle_uart_packet(const uart_packet_t *packet)
 {
-    if (!packet) {
-        return;
-    }
-
+    lat_trace_mark(LAT_TRACE_UART_RX, 0);
     uint8_t mode = packet->data[0];
     ESP_LOGI(TAG, "Handling img transfer command: mode=0x%02X", mode);
 
-    // 构造并发送图传设置应答数据包（命令 0x1D），数据内容与请求一致，其余字节补 0
-    uart_packet_t ack_packet = {0};
-    ack_packet.header[0] = 0xAA;
-    ack_packet.header[1] = 0x55;
-    ack_packet.command   = 0x1D;
-    ack_packet.data[0] = mode;
-    for (int i = 1; i < 6; i++) {
-        ack_packet.data[i] = 0x00;
-    }
-    ack_packet.checksum = uart_comm_calc_checksum((uint8_t *)&ack_packet, sizeof(uart_packet_t) - 1);
-    esp_err_t err = uart_comm_send_packet(&ack_packet);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to send img transfer ack (0x1D), err=0x%x", err);
-    } else {
-        ESP_LOGI(TAG, "Sent img transfer ack (0x1D)");
-    }
-
     if (mode == 0x00) { // 开启图传
         s_img_transfer_enabled = true;
-        if (xTaskCreate(img_transfer_task, "img_transfer_task", 4096, NULL, 5, NULL) != pdPASS) {
-            ESP_LOGE(TAG, "Failed to create img_transfer_task");
+#if CONFIG_IMG_CLIP
+        img_clip_trigger();
+#endif
+        // 工作任务常驻，省去每次创建任务分配栈的开销
+        if (cc_worker_submit(img_transfer_job, NULL, CC_WORKER_PRIO_HIGH) != CC_OK) {
+            ESP_LOGE(TAG, "Failed to submit img transfer job");
         }
     } else if (mode == 0x01) { // 关闭图传
         s_img_transfer_enabled = false;
@@ -153,6 +300,7 @@ void img_transfer_handle_uart_packet(const uart_packet_t *packet)
     } else {
         ESP_LOGW(TAG, "Unknown mode 0x%02X in img transfer command", mode);
     }
+    return UART_CMD_OK;
 }
 
 /**
@@ -162,5 +310,7 @@ esp_err_t img_transfer_init(void)
 {
     ESP_LOGI(TAG, "img_transfer module initialized");
     s_img_transfer_enabled = false;
+    metrics_register(&s_total_ms.head);
+    tunables_register(&s_timeout_ms);
     return ESP_OK;
 }
@@ -21,13 +21,14 @@ esp_err_t img_transfer_init(void);
 /**
  * @brief 处理 MCU 发送的图传设置数据包（命令 0x1C）。
  *
- * 当 UART 接收到图传设置数据包后，调用此函数处理图传开启或关闭逻辑，
- * 同时回复应答（0x1D），若要求开启图传则异步启动图传任务完成采集、上传，
- * 并最终反馈图传结果（0x27）。
+ * 命令表在调用前已回复应答（0x1D），此函数处理图传开启或关闭逻辑，
+ * 若要求开启图传则异步启动图传任务完成采集、上传，并最终反馈图传结果（0x27）。
  *
  * @param packet 收到的图传设置数据包
+ *
+ * @return UART_CMD_OK
  */
-void img_transfer_handle_uart_packet(const uart_packet_t *packet);
+uint8_t img_transfer_handle_uart_packet(const uart_packet_t *packet);
 
 #ifdef __cplusplus
 }
@@ -0,0 +1,83 @@
+/**
+ * @file mcu_ota.h
+ * @brief 门锁 MCU 固件中继（CONFIG_MCU_OTA）：HTTP 分块下载 MCU 固件，经扩展帧转发给 MCU
+ *
+ * 扩展数据帧（uart_ext.h），多字节字段均为小端：
+ *   BEGIN   0x30  本端 -> MCU  total(4) image_crc32(4) block_size(2)
+ *   BLOCK   0x31  本端 -> MCU  offset(4) crc32(4) data(<= block_size)
+ *   END     0x32  本端 -> MCU  total(4) image_crc32(4)
+ *   STATUS  0x33  MCU -> 本端  cmd(1) status(1) next_offset(4)
+ * BEGIN 的 STATUS 带回 MCU 已写入的位置：total 与 image_crc32 都与上次相同时续传，否则从 0 开始；
+ * 下载从这个位置开始（HTTP Range）。BLOCK 的 crc32 只覆盖本块数据，MCU 校验通过并写入后回复 next_offset，
+ * 校验失败回复非 0 的 status，本端重发该块。END 时 MCU 校验整个镜像，status 为 0 表示可以切换到新固件。
+ * crc32 均为 esp_rom_crc32_le(0, ...)。
+ *
+ * 下载和串口发送重叠：HTTP 接收把数据填进几个块缓冲，发送任务把填满的块逐个发给 MCU，
+ * 串口慢时接收因拿不到空块而放慢，总耗时取决于较慢的一侧。
+ * 下载中断时从未发出的块边界重新请求；串口出错时重新 BEGIN，从 MCU 报告的位置继续。
+ */
+
+#ifndef MCU_OTA_H
+#define MCU_OTA_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define MCU_OTA_CMD_BEGIN           0x30
+#define MCU_OTA_CMD_BLOCK           0x31
+#define MCU_OTA_CMD_END             0x32
+#define MCU_OTA_CMD_STATUS          0x33
+
+// 云端下发升级：{"url": "...", "size": 123456, "crc32": 305419896}
+#define MCU_OTA_TOPIC_SUB           "/service/mcu_ota"
+// 升级结果：{"result": 0, "offset": 123456}，result 为 esp_err_t
+#define MCU_OTA_TOPIC_POST          "/event/mcu_ota/post"
+
+typedef enum {
+    MCU_OTA_IDLE = 0,
+    MCU_OTA_RUNNING,
+    MCU_OTA_DONE,
+    MCU_OTA_FAILED,
+} mcu_ota_state_t;
+
+typedef struct {
+    mcu_ota_state_t state;
+    uint32_t total;
+    uint32_t acked;             // MCU 已确认写入的字节数
+    uint32_t resumed_from;      // 本次升级开始时 MCU 报告的位置
+} mcu_ota_progress_t;
+
+/**
+ * @brief 注册云端下发的 topic 和 MCU 应答的接收回调，在 uart_comm_init() 之后调用
+ *
+ * @return ESP_ERR_NOT_SUPPORTED 未开启 CONFIG_MCU_OTA
+ */
+esp_err_t mcu_ota_init(void);
+
+/**
+ * @brief 开始升级，在后台任务中完成
+ *
+ * @param url       MCU 固件地址
+ * @param size      固件大小，须与服务器返回的长度一致
+ * @param crc32     整个固件的 crc32，交给 MCU 在 END 时校验
+ * @return
+ *      - ESP_OK: 已开始
+ *      - ESP_ERR_INVALID_STATE: 正在升级
+ *      - ESP_ERR_NOT_SUPPORTED: 未开启 CONFIG_MCU_OTA
+ */
+esp_err_t mcu_ota_start(const char *url, uint32_t size, uint32_t crc32);
+
+/**
+ * @brief 取当前或最近一次升级的进度
+ */
+void mcu_ota_get_progress(mcu_ota_progress_t *progress);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // MCU_OTA_H
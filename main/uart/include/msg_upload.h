@@ -9,8 +9,11 @@
 // 初始化本模块
 esp_err_t msg_upload_init(void);
 
-// UART 回调中调用该函数统一处理 0x03、0x04 等指令
-void msg_upload_uart_callback(const uart_packet_t *packet);
+// 命令表中 0x03（消息上传）的处理函数，返回值作为 0x02 应答的执行结果
+uint8_t msg_upload_handle_event(const uart_packet_t *packet);
+
+// 命令表中 0x04（断电通知）的处理函数，保存待发数据后返回，应答发出后 MCU 即可断电
+uint8_t msg_upload_handle_power_off(const uart_packet_t *packet);
 
 // MQTT 下行指令中，若检测到远程开锁命令，则调用此函数发送远程开锁指令
 esp_err_t msg_upload_send_remote_unlock_cmd_to_lock(void);
@@ -36,6 +36,10 @@ net_status_t net_sta_get_status(void);
 /**
  * @brief 更新联网状态并发送通知给 MCU
  *
+ * 状态立即生效（net_sta_get_status 返回新值），通知经过去抖：NET_STATUS_CONNECTED_SERVER 立即发送，
+ * 其余状态须稳定 0.5 s（比已通知的状态好）或 3 s（比已通知的状态差）才发送，
+ * 期间回到已通知的状态则不发送。
+ *
  * @param status 新的联网状态
  * @return esp_err_t
  */
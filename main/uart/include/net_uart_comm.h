@@ -3,25 +3,16 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
+#include "uart_cmd_schema.h"
 
-// ---- 协议指令枚举 ----
+// ---- 协议指令枚举，由 uart_cmd_schema.h 展开 ----
+#define UART_CMD_ENUM(name, cmd, dir, lane, ack_cmd, ack, handler, layout) CMD_##name = (cmd),
 typedef enum {
-    CMD_WIFI_CONFIG           = 0x01, // WiFi 配网
-    CMD_WIFI_RESPONSE         = 0x02, // WiFi 配网应答
-    CMD_NETWORK_STATUS        = 0x23, // 联网状态通知
-    CMD_EXIT_CONFIG           = 0x1A, // 配网退出
-    CMD_EXIT_CONFIG_ACK       = 0x1B, // 配网退出应答
-    CMD_GET_NETWORK_TIME      = 0x10, // MCU->WiFi 获取网络时间
-    CMD_GET_NETWORK_TIME_RSP  = 0x11, // WiFi->MCU 网络时间应答
-    CMD_GET_DEVICE_INFO       = 0x06, // MCU->WiFi 获取设备信息 
-    CMD_GET_DEVICE_INFO_RSP   = 0x07, // WiFi->MCU 设备信息应答
-    CMD_CLEAR_DATA            = 0x05, // 清除数据，恢复出厂设置
-    CMD_IMG_TRANSFER          = 0x1C, // 图传开启/关闭指令（MCU->WiFi）
-    // 状态上传相关命令
-    CMD_STATE_REPORT          = 0x42, // 主板上报状态
-    CMD_STATE_REPORT_ACK      = 0x43, // WiFi 模块对状态上报的应答
+    UART_CMD_SCHEMA(UART_CMD_ENUM)
 } uart_command_t;
+#undef UART_CMD_ENUM
 
 // WiFi 配网结果状态
 typedef enum {
@@ -58,35 +49,42 @@ typedef struct {
 // ---- 回调函数类型 ----
 typedef void (*uart_packet_callback_t)(const uart_packet_t *packet);
 
+// 命令处理函数，在串口接收任务中调用；返回值为 STATUS/STATUS_CMD 应答的 data[0]，其余应答方式忽略
+typedef uint8_t (*uart_cmd_handler_t)(const uart_packet_t *packet);
+
+#define UART_CMD_OK             0x00    // 执行成功
+#define UART_CMD_FAIL           0x02    // 执行失败
+
 // ---- 对外接口函数 ----
 esp_err_t uart_comm_init(void);
+
+// 命令表中没有处理函数或未列出的命令转发给该回调
 esp_err_t uart_comm_register_callback(uart_packet_callback_t callback);
 
+// 运行时开关逐包的收发日志（原始数据、包详情），默认关闭
+void uart_comm_set_verbose(bool verbose);
+
 // 计算校验和
 uint8_t uart_comm_calc_checksum(const uint8_t *data, size_t length);
 
-// 发送数据包
+// 发送数据包：放入发送队列后立即返回（通道按命令表选择），队列满返回 ESP_ERR_NO_MEM
 esp_err_t uart_comm_send_packet(const uart_packet_t *packet);
 
-// 发送 WiFi 配网响应
-esp_err_t uart_comm_send_wifi_response(wifi_config_status_t status);
+// 按命令字与 6 字节数据区组包发送，data 为 NULL 时数据区全 0
+esp_err_t uart_comm_send_cmd(uint8_t command, const uint8_t *data);
 
 // 发送网络状态通知
 esp_err_t uart_comm_send_network_status(bool connected);
 
-// 发送配网退出应答
-esp_err_t uart_comm_send_exit_config_ack(void);
-
-// 发送网络时间应答
-esp_err_t uart_comm_send_network_time(uint32_t utc_time_sec, int8_t timezone_15min);
-
-// 发送设备信息应答
-esp_err_t uart_comm_send_device_info(const char *device_id, const uint8_t *mac);
-
-// 发送清除数据响应
-esp_err_t uart_comm_send_clear_data_response(bool success);
+// ---- 命令表中的处理函数 ----
+// 由应用（main.c）实现：配网、退出配网
+uint8_t app_uart_wifi_config(const uart_packet_t *packet);
+uint8_t app_uart_exit_config(const uart_packet_t *packet);
 
-// 新增：用于断电通知的应答函数
-esp_err_t uart_comm_send_power_off_ack(bool success);
+// 由本模块实现：清除数据、设备信息、网络时间、联网状态
+uint8_t uart_comm_handle_clear_data(const uart_packet_t *packet);
+uint8_t uart_comm_handle_device_info(const uart_packet_t *packet);
+uint8_t uart_comm_handle_network_time(const uart_packet_t *packet);
+uint8_t uart_comm_handle_network_status(const uart_packet_t *packet);
 
 #endif // NET_UART_COMM_H
@@ -8,17 +8,15 @@
 extern "C" {
 #endif
 
-#define CMD_STATE_REPORT       0x42
-#define CMD_STATE_REPORT_ACK   0x43
 
 /**
- * @brief 处理接收到的状态上报数据包
+ * @brief 处理 MCU 上报的状态（0x42），经 MQTT 攒批上报；0x43 应答由命令表统一回复
  *
  * @param packet 指向接收到的数据包
  *
- * @return esp_err_t ESP_OK 表示处理成功
+ * @return UART_CMD_OK
  */
-esp_err_t state_report_handle_uart_packet(const uart_packet_t *packet);
+uint8_t state_report_handle_uart_packet(const uart_packet_t *packet);
 
 /**
  * @brief 主动上传状态
@@ -30,12 +28,6 @@ esp_err_t state_report_handle_uart_packet(const uart_packet_t *packet);
  */
 esp_err_t state_report_upload(uint16_t state_type, uint32_t state_value);
 
-/**
- * @brief 发送状态上报应答
- *
- * @return esp_err_t ESP_OK 表示发送成功
- */
-esp_err_t state_report_send_ack(void);
 
 /**
  * @brief 初始化状态上报模块（包括重传与缓存机制）
@@ -45,17 +37,23 @@ esp_err_t state_report_send_ack(void);
 esp_err_t state_report_init(void);
 
 /**
- * @brief 处理收到的状态上报应答，移除待重传的消息
+ * @brief 处理收到的状态上报应答，移除对应的待确认上报
+ *
+ * @param packet 收到的 0x43 应答；data[0-1] 回带状态类型时按类型匹配，否则确认最早的一条
  */
-void state_report_ack_handler(void);
+uint8_t state_report_ack_handler(const uart_packet_t *packet);
 
 /**
- * @brief 通过MQTT上报状态数据（接口函数，尚未实现实际上报逻辑）
+ * @brief 通过MQTT上报状态数据
+ *
+ * 不会每条单独发布：攒够 32 条或距第一条超过 5 秒时，以 CBOR 数组
+ * [t0, [type, value, dt, epoch, seq], ...] 合并为一次发布到 /event/state/batch（t0 为批次中最早的 UTC 秒，dt 为相对 t0 的非负秒数，
+ * epoch/seq 为每条的幂等键，见 uplink_id.h，断电保存后补发时不变）。
  *
  * @param state_type 状态类型（2 字节，小端序）
  * @param state_value 状态值（4 字节，小端序）
  *
- * @return esp_err_t ESP_OK 表示上传成功（TODO: 实际实现中应返回相应错误码）
+ * @return esp_err_t ESP_OK 表示已加入批次；ESP_ERR_INVALID_STATE 未调用 state_report_init()
  */
 esp_err_t state_report_mqtt_upload(uint16_t state_type, uint32_t state_value);
 
@@ -0,0 +1,56 @@
+/**
+ * @file uart_baud.h
+ * @brief 与门锁 MCU 协商更高的波特率（CONFIG_UART_BAUD_NEGOTIATE）
+ *
+ * 双方上电都使用 UART_BAUD_BASE。MCU 确认支持扩展帧后，经 BAUD 控制帧（uart_ext.h）协商：
+ *   1. PROPOSE：以当前波特率提议 baud，MCU 回复（REPLY）接受的 baud，不接受回复 0；
+ *      MCU 发完应答后切换到新波特率
+ *   2. TEST：本端切换后发送固定的测试图案，MCU 原样回显
+ *   3. COMMIT：回显一致后确认，MCU 回复后保持新波特率
+ * MCU 切换后 UART_BAUD_MCU_REVERT_MS 内没有收到 COMMIT 时自行回到原波特率；
+ * 本端任一步没有得到应答即回到原波特率，等 MCU 也回退后再提议下一档。
+ *
+ * 从上次成功的一档（保存在 KVS）开始提议，开机通常一次协商即可；不成功再从 CONFIG_UART_BAUD_MAX 逐档往下。
+ * 运行中定长包校验和或扩展帧 CRC 的错误在 10 s 内达到 8 次时回到 UART_BAUD_BASE（MCU 复位后也会出现这种情况），
+ * 一分钟后重新协商；切换后不久就出错的一档本次运行不再提议。MCU 侧应按同样的规则在连续校验错误时回到 UART_BAUD_BASE。
+ */
+
+#ifndef UART_BAUD_H
+#define UART_BAUD_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+// BAUD 控制帧的 op，payload: op, baud(4, 小端), [TEST 的测试图案]
+#define UART_BAUD_OP_PROPOSE        0x01
+#define UART_BAUD_OP_TEST           0x02
+#define UART_BAUD_OP_COMMIT         0x03
+
+#define UART_BAUD_MCU_REVERT_MS     1000    // MCU 等待 COMMIT 的时间
+
+/**
+ * @brief 创建协商任务，由 uart_comm_init() 在接收和发送就绪后调用
+ *
+ * @return ESP_ERR_NOT_SUPPORTED 未开启 CONFIG_UART_BAUD_NEGOTIATE
+ */
+esp_err_t uart_baud_start(void);
+
+/**
+ * @brief 收到 BAUD 控制帧（在 UART 接收任务中调用，由 uart_ext 转来）
+ */
+void uart_baud_on_frame(uint8_t flags, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief 收到一个校验失败的包或帧（在 UART 接收任务中调用）
+ */
+void uart_baud_link_error(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_BAUD_H
@@ -0,0 +1,47 @@
+/**
+ * @file uart_cmd_schema.h
+ * @brief 0xAA55 定长包的命令表：命令字、方向、发送通道、应答方式与处理函数都只在这里写一次
+ *
+ * 由表展开出 uart_command_t 枚举（CMD_<名称>）、net_uart_comm.c 中按命令字索引的分派表与发送通道，
+ * 新增命令只需加一行。每行的含义：
+ *   UART_CMD(名称, 命令字, 方向, 发送通道, 应答命令字, 应答方式, 处理函数, 数据区布局)
+ *
+ * 方向：RX 只由 MCU 发来，TX 只由本模块发出，BOTH 两个方向都有。
+ * 发送通道：HIGH 为开锁、应答类，在发送队列中优先；NORMAL 为通知、上报类。
+ * 应答方式（由分派统一回复，处理函数只管业务；ZERO/ECHO 表示确认收到，在调用处理函数之前回复，
+ * STATUS/STATUS_CMD 在处理函数返回之后回复）：
+ *   NONE        不回复
+ *   SELF        由处理函数自己回复（回复内容需查询或回复后重启），应答命令字仅作说明
+ *   ZERO        回复数据区全 0 的应答
+ *   ECHO        回复 data[0] 与请求相同、其余为 0 的应答
+ *   STATUS      data[0] 为处理函数的返回值
+ *   STATUS_CMD  data[0] 为处理函数的返回值，data[1] 为请求的命令字
+ * 处理函数为 uart_cmd_handler_t，只有 RX/BOTH 的命令需要，NULL 表示转发给 uart_comm_register_callback() 的回调。
+ * 数据区布局按字节顺序书写，多字节字段均为小端序，仅用于日志与文档。
+ */
+
+#ifndef UART_CMD_SCHEMA_H
+#define UART_CMD_SCHEMA_H
+
+#define UART_CMD_SCHEMA(UART_CMD) \
+    UART_CMD(WIFI_CONFIG,          0x01, RX,   NORMAL, 0x02, STATUS,     app_uart_wifi_config,            "") \
+    UART_CMD(WIFI_RESPONSE,        0x02, TX,   HIGH,   0x00, NONE,       NULL,                            "u8 status, u8 cmd") \
+    UART_CMD(MSG_UPLOAD,           0x03, RX,   NORMAL, 0x02, STATUS_CMD, msg_upload_handle_event,         "u8 event, u8 event_info") \
+    UART_CMD(POWER_OFF_NOTIFY,     0x04, RX,   NORMAL, 0x02, STATUS_CMD, msg_upload_handle_power_off,     "u8 mode") \
+    UART_CMD(CLEAR_DATA,           0x05, RX,   NORMAL, 0x02, SELF,       uart_comm_handle_clear_data,     "") \
+    UART_CMD(GET_DEVICE_INFO,      0x06, RX,   NORMAL, 0x07, SELF,       uart_comm_handle_device_info,    "") \
+    UART_CMD(GET_DEVICE_INFO_RSP,  0x07, TX,   NORMAL, 0x00, NONE,       NULL,                            "见 uart_device_info_packet_t") \
+    UART_CMD(GET_NETWORK_TIME,     0x10, RX,   NORMAL, 0x11, SELF,       uart_comm_handle_network_time,   "") \
+    UART_CMD(GET_NETWORK_TIME_RSP, 0x11, TX,   HIGH,   0x00, NONE,       NULL,                            "u32 utc, i8 tz_15min") \
+    UART_CMD(REMOTE_UNLOCK_RSP,    0x12, BOTH, HIGH,   0x00, NONE,       unlock_handle_mcu_packet,        "") \
+    UART_CMD(REMOTE_UNLOCK,        0x13, TX,   HIGH,   0x00, NONE,       NULL,                            "u8 user_type, u16 user_id") \
+    UART_CMD(EXIT_CONFIG,          0x1A, RX,   NORMAL, 0x1B, ZERO,       app_uart_exit_config,            "") \
+    UART_CMD(EXIT_CONFIG_ACK,      0x1B, TX,   HIGH,   0x00, NONE,       NULL,                            "") \
+    UART_CMD(IMG_TRANSFER,         0x1C, RX,   NORMAL, 0x1D, ECHO,       img_transfer_handle_uart_packet, "u8 mode") \
+    UART_CMD(IMG_TRANSFER_ACK,     0x1D, TX,   HIGH,   0x00, NONE,       NULL,                            "u8 mode") \
+    UART_CMD(NETWORK_STATUS,       0x23, BOTH, NORMAL, 0x00, NONE,       uart_comm_handle_network_status, "u8 status, u32 utc, i8 tz_15min") \
+    UART_CMD(IMG_TRANSFER_RESULT,  0x27, TX,   NORMAL, 0x00, NONE,       NULL,                            "u8 result, u16 size, u16 checksum") \
+    UART_CMD(STATE_REPORT,         0x42, BOTH, NORMAL, 0x43, ZERO,       state_report_handle_uart_packet, "u16 type, u32 value") \
+    UART_CMD(STATE_REPORT_ACK,     0x43, BOTH, HIGH,   0x00, NONE,       state_report_ack_handler,        "u16 type")
+
+#endif // UART_CMD_SCHEMA_H
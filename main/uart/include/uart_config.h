@@ -11,6 +11,8 @@
 #define UART_RX_GPIO        44  // 根据硬件情况修改
 #define UART_BUFFER_SIZE    1024
 #define UART_QUEUE_SIZE     20
+#define UART_WAKEUP_THRESHOLD   3   // 唤醒所需的 RX 边沿数，S3 最小为 3
+#define UART_BAUD_BASE      9600    // 上电时的波特率，MCU 复位后也回到此值
 
 /**
  * @brief 初始化UART配置
@@ -26,4 +28,18 @@ esp_err_t uart_config_init(void);
  */
 QueueHandle_t uart_config_get_queue(void);
 
+/**
+ * @brief 切换波特率：等待已写入的数据发完后切换，并丢弃切换前收到的残留数据
+ *
+ * 与其他任务的发送不互斥，切换瞬间正在写入的包可能损坏，由接收方的校验丢弃。
+ *
+ * @return ESP_ERR_TIMEOUT 发送缓冲未能在 timeout_ms 内发完，波特率未变
+ */
+esp_err_t uart_config_set_baud(uint32_t baud, uint32_t timeout_ms);
+
+/**
+ * @brief 当前波特率
+ */
+uint32_t uart_config_get_baud(void);
+
 #endif // UART_CONFIG_H
@@ -0,0 +1,103 @@
+/**
+ * @file uart_ext.h
+ * @brief 与门锁 MCU 之间的变长帧（扩展帧）
+ *
+ * 与 10 字节的 uart_packet_t 共用同一串口，以帧头 0xAA 0x56 区分：
+ *   0xAA 0x56 | cmd | seq | flags | len(2, 小端) | payload(len) | crc16(2, 小端)
+ * crc16 为 CRC16/CCITT-FALSE，覆盖 cmd 到 payload。
+ *
+ * 上电后发送 HELLO 协商窗口与最大负载，MCU 回复 HELLO 后才启用扩展帧；
+ * 不认识扩展帧的 MCU 会忽略它，继续只使用旧格式。
+ * 数据帧按 seq 编号，接收方回复累计 ACK（下一个期望的 seq），发送方按滑动窗口重传。
+ * BAUD 控制帧用于协商更高的波特率，过程见 uart_baud.h。
+ */
+
+#ifndef UART_EXT_H
+#define UART_EXT_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_EXT_HEADER0            0xAA
+#define UART_EXT_HEADER1            0x56
+#define UART_EXT_HEAD_SIZE          7
+#define UART_EXT_MAX_PAYLOAD        512
+#define UART_EXT_FRAME_MAX          (UART_EXT_HEAD_SIZE + UART_EXT_MAX_PAYLOAD + 2)
+
+// 控制命令，数据命令使用 0x00~0xEF
+#define UART_EXT_CMD_HELLO          0xF0    // payload: version, window, max_payload(2)
+#define UART_EXT_CMD_ACK            0xF1    // payload: 下一个期望的 seq
+#define UART_EXT_CMD_BAUD           0xF2    // payload: op, baud(4, 小端), [测试图案]，见 uart_baud.h
+
+// flags
+#define UART_EXT_FLAG_FIRST         (1 << 0)    // 一段数据的第一帧
+#define UART_EXT_FLAG_LAST          (1 << 1)    // 一段数据的最后一帧
+#define UART_EXT_FLAG_REPLY         (1 << 7)    // HELLO 的应答
+
+/**
+ * @brief 收到扩展数据帧的回调（在 UART 接收任务中调用，按 seq 顺序、不重复）
+ */
+typedef void (*uart_ext_callback_t)(uint8_t cmd, uint8_t flags, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief 初始化扩展帧并向 MCU 发送 HELLO，由 uart_comm_init() 调用
+ */
+esp_err_t uart_ext_init(void);
+
+/**
+ * @brief 注册扩展数据帧的接收回调
+ */
+void uart_ext_register_callback(uart_ext_callback_t cb);
+
+/**
+ * @brief MCU 是否已确认支持扩展帧
+ */
+bool uart_ext_is_ready(void);
+
+/**
+ * @brief 尚未确认时再发一次 HELLO 并等待应答（最多 200 ms）
+ *
+ * @return MCU 是否已确认支持扩展帧
+ */
+bool uart_ext_wait_ready(void);
+
+/**
+ * @brief 发送一段任意长度的数据，按协商的最大负载分帧，滑动窗口发送直到全部被确认
+ *
+ * @return
+ *      - ESP_OK: 全部被 MCU 确认
+ *      - ESP_ERR_NOT_SUPPORTED: MCU 未确认支持扩展帧
+ *      - ESP_ERR_TIMEOUT: 重传次数用尽或超时
+ */
+esp_err_t uart_ext_send(uint8_t cmd, const uint8_t *data, size_t len, uint32_t timeout_ms);
+
+/**
+ * @brief 发送一帧控制帧（不编号、不等待 ACK），cmd 为 0xF0 以上的控制命令
+ */
+esp_err_t uart_ext_send_ctrl(uint8_t cmd, uint8_t flags, const uint8_t *payload, uint16_t len);
+
+/**
+ * @brief 供接收解析使用：判断 buf 开头的扩展帧长度（实现在 uart_parse.c）
+ *
+ * @return 完整帧长度；0 表示数据不足需继续接收；SIZE_MAX 表示帧头无效
+ */
+size_t uart_ext_frame_len(const uint8_t *buf, size_t avail);
+
+/**
+ * @brief 供接收解析使用：校验并处理一帧完整的扩展帧
+ *
+ * @return CRC 正确返回 true
+ */
+bool uart_ext_on_frame(const uint8_t *frame, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_EXT_H
@@ -0,0 +1,71 @@
+/**
+ * @file uart_parse.h
+ * @brief 串口接收数据分帧：0xAA55 定长包与 0xAA56 扩展帧；定长包组包与数据区字段读写
+ *
+ * 只做分帧、组包与校验，不依赖 RTOS 和驱动，主机测试直接编译本文件（见 test_apps/host_test）。
+ */
+
+#ifndef UART_PARSE_H
+#define UART_PARSE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+#include "net_uart_comm.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+typedef struct {
+    void (*on_packet)(const uart_packet_t *packet);             // 校验通过的定长包
+    bool (*on_ext_frame)(const uint8_t *frame, size_t len);     // 完整的扩展帧，校验失败返回 false
+    void (*on_bad_checksum)(uint8_t calc, uint8_t recv);        // 定长包校验失败，可为 NULL
+} uart_parse_ops_t;
+
+/**
+ * @brief 从接收缓冲中解析数据包
+ *
+ * 帧在缓冲内原地校验后回调，校验失败从下一字节重新同步。
+ *
+ * @return 已消费的字节数，剩余的不完整帧留待下次读入后继续解析
+ */
+size_t uart_parse_packets(const uint8_t *buf, size_t len, const uart_parse_ops_t *ops);
+
+/**
+ * @brief 组一个定长包：填入帧头、命令字、数据区与校验和
+ *
+ * @param data 6 字节数据区，NULL 时全 0
+ */
+void uart_packet_build(uart_packet_t *packet, uint8_t command, const uint8_t *data);
+
+// 数据区中的多字节字段均为小端序
+static inline void uart_put_le16(uint8_t *p, uint16_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static inline void uart_put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint16_t uart_get_le16(const uint8_t *p)
+{
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static inline uint32_t uart_get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_PARSE_H
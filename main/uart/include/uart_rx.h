@@ -0,0 +1,59 @@
+/**
+ * @file uart_rx.h
+ * @brief 多个串口共用的接收任务
+ *
+ * 驱动在 RX FIFO 达到阈值或线路空闲超过 rx_timeout 个字符时间（idle-line）时产生 UART_DATA 事件，
+ * 本模块用一个任务通过队列集等待所有已登记串口的事件，每次把驱动缓冲中的数据整段读出交给回调，
+ * 不再按固定周期轮询 uart_read_bytes。
+ */
+
+#ifndef UART_RX_H
+#define UART_RX_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "driver/uart.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/queue.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UART_RX_PORT_MAX            2
+#define UART_RX_BURST_MAX           512     // 单次交给回调的最大字节数
+#define UART_RX_DEFAULT_TIMEOUT     3       // 空闲 3 个字符时间即认为一段数据结束
+#define UART_RX_QUEUE_LEN_MAX       20      // 每个串口事件队列的最大长度
+
+/**
+ * @brief 收到一段数据（在接收任务中调用，data 仅在回调期间有效）
+ */
+typedef void (*uart_rx_data_cb_t)(const uint8_t *data, size_t len, void *arg);
+
+/**
+ * @brief FIFO 或驱动缓冲溢出，驱动输入已清空，调用方应丢弃未完成的半帧
+ */
+typedef void (*uart_rx_reset_cb_t)(void *arg);
+
+typedef struct {
+    uart_port_t port;
+    QueueHandle_t event_queue;      // uart_driver_install() 返回的事件队列
+    uint8_t rx_timeout;             // 空闲判定的字符时间数，0 使用 UART_RX_DEFAULT_TIMEOUT
+    uart_rx_data_cb_t on_data;
+    uart_rx_reset_cb_t on_reset;    // 可为 NULL
+    void *arg;
+} uart_rx_port_config_t;
+
+/**
+ * @brief 登记一个已安装驱动的串口，首次调用时创建接收任务
+ *
+ * event_queue 长度不能超过 UART_RX_QUEUE_LEN_MAX（队列集按此预留空间）。
+ */
+esp_err_t uart_rx_register(const uart_rx_port_config_t *config);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UART_RX_H
@@ -10,6 +10,7 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "net_uart_comm.h"
 
@@ -17,6 +18,20 @@
 extern "C" {
 #endif
 
+// 远程开锁专用 topic（不含设备前缀），QoS1，与普通上报分开
+#define UNLOCK_TOPIC_REQ_POST   "/event/unlock/post"    // 开锁请求上报
+#define UNLOCK_TOPIC_CMD_SUB    "/service/unlock"       // 云端开锁指令 {"user_type":5,"user_id":N}
+
+// 远程开锁链路上的打点位置，按链路顺序
+typedef enum {
+    UNLOCK_TRACE_REQ_RX = 0,    // 收到 MCU 0x03 开锁请求，开始一次会话
+    UNLOCK_TRACE_REQ_PUB,       // 开锁请求已交给 MQTT
+    UNLOCK_TRACE_CMD_RX,        // 收到云端开锁指令
+    UNLOCK_TRACE_CMD_TX,        // 0x13 已写入 UART
+    UNLOCK_TRACE_ACK_RX,        // 收到 MCU 0x12，结束会话
+    UNLOCK_TRACE_POINT_MAX,
+} unlock_trace_point_t;
+
 /**
  * @brief 初始化远程开锁模块
  * 
@@ -41,11 +56,13 @@ esp_err_t unlock_init(void);
 esp_err_t unlock_send_remote_unlock_to_mcu(uint8_t user_type, uint16_t user_id);
 
 /**
- * @brief 在 UART 回调中，当收到MCU发来的指令(0x12等)时，调用此函数
+ * @brief 命令表中 0x12（MCU 远程开锁应答）的处理函数
  * 
  * @param[in] packet  已解析好的 UART 数据包
+ *
+ * @return UART_CMD_OK
  */
-void unlock_handle_mcu_packet(const uart_packet_t *packet);
+uint8_t unlock_handle_mcu_packet(const uart_packet_t *packet);
 
 /**
  * @brief 查询当前是否正在进行一次远程开锁流程
@@ -54,6 +71,18 @@ void unlock_handle_mcu_packet(const uart_packet_t *packet);
  */
 bool unlock_is_in_progress(void);
 
+/**
+ * @brief 远程开锁链路打点，可在任意任务中调用
+ *
+ * 收到 0x12 时按会话计算各段耗时，打印并上报最近若干次的 p50/p99。
+ */
+void unlock_trace_mark(unlock_trace_point_t point);
+
+/**
+ * @brief 生成最近若干次远程开锁耗时统计（JSON，单位 ms），返回长度
+ */
+int unlock_trace_summary(char *buf, size_t size);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,509 @@
+/**
+ * @file mcu_ota.c
+ * @brief 门锁 MCU 固件中继：HTTP 接收填块，发送任务逐块经扩展帧发给 MCU 并等待确认
+ */
+
+#include "mcu_ota.h"
+#include "sdkconfig.h"
+
+#if CONFIG_MCU_OTA
+
+#include <string.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "esp_rom_crc.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/queue.h"
+#include "freertos/semphr.h"
+#include "cJSON.h"
+#include "cc_event.h"
+#include "gs_mqtt.h"
+#include "http_client.h"
+#include "uart_config.h"
+#include "uart_ext.h"
+
+static const char *TAG = "mcu_ota";
+
+/* -------------------- 配置宏 -------------------- */
+
+#define MCU_OTA_BLOCK_SIZE          4096
+#define MCU_OTA_BLOCK_NUM           3       // 一块在发送、一块在填充，多一块吸收两侧的速度波动
+#define MCU_OTA_BLOCK_HEAD          8       // BLOCK 负载中数据前的 offset(4) crc32(4)
+#define MCU_OTA_RECV_BUF_SIZE       1024
+#define MCU_OTA_HTTP_RETRY          5
+#define MCU_OTA_SESSION_RETRY       3       // 串口出错后重新 BEGIN 的次数
+#define MCU_OTA_BLOCK_TRIES         3
+#define MCU_OTA_STATUS_MS           3000    // MCU 擦写一块后应答的时间
+#define MCU_OTA_VERIFY_MS           10000   // END 时 MCU 校验整个镜像的时间
+#define MCU_OTA_TASK_STACK          4096
+#define MCU_OTA_SEND_TASK_STACK     3072
+#define MCU_OTA_TASK_PRIO           4
+
+typedef struct {
+    uint32_t off;
+    uint32_t len;               // 数据长度，0 为下载结束的标记
+    uint8_t buf[MCU_OTA_BLOCK_HEAD + MCU_OTA_BLOCK_SIZE];   // 即 BLOCK 帧的负载，发送时不再拷贝
+} mcu_ota_block_t;
+
+/* -------------------- 状态 -------------------- */
+
+static volatile bool s_running = false;
+static char *s_url = NULL;
+static uint32_t s_image_crc = 0;
+static mcu_ota_progress_t s_progress = {0};
+
+static mcu_ota_block_t *s_blocks = NULL;
+static QueueHandle_t s_free_q = NULL;
+static QueueHandle_t s_full_q = NULL;
+static SemaphoreHandle_t s_sender_done = NULL;
+static mcu_ota_block_t *s_fill = NULL;          // 正在填充的块，只在 HTTP 任务中访问
+static uint32_t s_recv_off = 0;                 // 已填入块的镜像位置
+static uint32_t s_skip = 0;                     // 服务器忽略 Range 时跳过的字节
+static bool s_response_checked = false;
+static char s_range_hdr[40];
+// 本轮出错原因：发送任务的串口错误，或镜像长度不符（ESP_ERR_INVALID_SIZE）；出错后丢弃剩余的块
+static volatile esp_err_t s_err = ESP_OK;
+
+static SemaphoreHandle_t s_status_sem = NULL;
+static volatile uint8_t s_wait_cmd = 0;         // 正在等待 STATUS 的命令，0 表示不在等待
+static uint8_t s_status = 0;
+static uint32_t s_status_off = 0;
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+// 在 UART 接收任务中调用
+static void mcu_ota_on_frame(uint8_t cmd, uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    if (cmd != MCU_OTA_CMD_STATUS || len < 6 || !s_status_sem || s_wait_cmd == 0 || payload[0] != s_wait_cmd) {
+        return;
+    }
+    s_status = payload[1];
+    s_status_off = get_le32(payload + 2);
+    s_wait_cmd = 0;
+    xSemaphoreGive(s_status_sem);
+}
+
+// 按当前波特率估算发送 len 字节负载的时间：每字节 10 bit，分帧开销按最小负载 64 字节估算，再留一倍余量和几次重传
+static uint32_t ota_send_timeout(size_t len)
+{
+    uint64_t bytes = len + (len / 64 + 1) * (UART_EXT_HEAD_SIZE + 2);
+    return (uint32_t)(bytes * 10 * 1000 * 2 / uart_config_get_baud()) + 2000;
+}
+
+/**
+ * @brief 发送一条命令并等待 MCU 的 STATUS
+ *
+ * @return ESP_OK 且 *next_off 为 MCU 报告的位置；ESP_FAIL MCU 回复了非 0 的 status；其他为发送或等待失败
+ */
+static esp_err_t ota_request(uint8_t cmd, const uint8_t *data, size_t len, uint32_t wait_ms, uint32_t *next_off)
+{
+    xSemaphoreTake(s_status_sem, 0);
+    s_wait_cmd = cmd;
+    esp_err_t ret = uart_ext_send(cmd, data, len, ota_send_timeout(len));
+    if (ret == ESP_OK && xSemaphoreTake(s_status_sem, pdMS_TO_TICKS(wait_ms)) != pdTRUE) {
+        ret = ESP_ERR_TIMEOUT;
+    }
+    if (ret != ESP_OK) {
+        s_wait_cmd = 0;
+        return ret;
+    }
+    *next_off = s_status_off;
+    return s_status == 0 ? ESP_OK : ESP_FAIL;
+}
+
+static esp_err_t ota_send_block(mcu_ota_block_t *blk)
+{
+    put_le32(blk->buf, blk->off);
+    put_le32(blk->buf + 4, esp_rom_crc32_le(0, blk->buf + MCU_OTA_BLOCK_HEAD, blk->len));
+
+    esp_err_t ret = ESP_FAIL;
+    for (int i = 0; i < MCU_OTA_BLOCK_TRIES; i++) {
+        uint32_t next = 0;
+        ret = ota_request(MCU_OTA_CMD_BLOCK, blk->buf, MCU_OTA_BLOCK_HEAD + blk->len, MCU_OTA_STATUS_MS, &next);
+        if (ret == ESP_OK && next == blk->off + blk->len) {
+            uint32_t old = s_progress.acked;
+            s_progress.acked = next;
+            if (old * 10 / s_progress.total != next * 10 / s_progress.total) {
+                ESP_LOGI(TAG, "%lu/%lu bytes", (unsigned long)next, (unsigned long)s_progress.total);
+            }
+            return ESP_OK;
+        }
+        if (ret == ESP_OK) {
+            // MCU 的位置与本端不一致（中途复位等），重新 BEGIN 取它的位置
+            ESP_LOGW(TAG, "MCU at %lu after block %lu", (unsigned long)next, (unsigned long)blk->off);
+            return ESP_ERR_INVALID_STATE;
+        }
+        ESP_LOGW(TAG, "block %lu failed (0x%x), try %d", (unsigned long)blk->off, ret, i + 1);
+    }
+    return ret;
+}
+
+static void mcu_ota_send_task(void *arg)
+{
+    mcu_ota_block_t *blk = NULL;
+    while (xQueueReceive(s_full_q, &blk, portMAX_DELAY) == pdTRUE && blk->len) {
+        if (s_err == ESP_OK) {
+            esp_err_t ret = ota_send_block(blk);
+            if (ret != ESP_OK) {
+                s_err = ret;
+            }
+        }
+        // 出错后仍归还每一块，HTTP 接收不会卡在取空块上
+        xQueueSend(s_free_q, &blk, portMAX_DELAY);
+    }
+    xSemaphoreGive(s_sender_done);
+    vTaskDelete(NULL);
+}
+
+// 收到响应头后的第一次回调：确认服务器按 Range 返回且镜像长度与云端下发的一致
+static esp_err_t ota_check_response(http_client_t *client, http_client_data_t *client_data)
+{
+    int code = http_client_get_response_code(client);
+    uint32_t total = s_progress.total;
+
+    if (code == 206) {
+        // "bytes 4096-999999/1000000"
+        const char *value = NULL;
+        int value_len = 0;
+        char buf[48];
+        if (http_client_get_header(client_data, "Content-Range", &value, &value_len) != 0
+                || value_len >= (int)sizeof(buf)) {
+            ESP_LOGE(TAG, "206 without Content-Range");
+            return ESP_FAIL;
+        }
+        memcpy(buf, value, value_len);
+        buf[value_len] = '\0';
+        const char *p = strstr(buf, "bytes ");
+        const char *slash = strchr(buf, '/');
+        if (!p || !slash || strtoul(p + 6, NULL, 10) != s_recv_off) {
+            ESP_LOGE(TAG, "bad Content-Range for offset %lu", (unsigned long)s_recv_off);
+            return ESP_FAIL;
+        }
+        if (strtoul(slash + 1, NULL, 10) != total) {
+            ESP_LOGE(TAG, "image size %s, expect %lu", slash + 1, (unsigned long)total);
+            s_err = ESP_ERR_INVALID_SIZE;
+            return ESP_FAIL;
+        }
+    } else if (code == 200) {
+        if ((uint32_t)client_data->response_content_len != total) {
+            ESP_LOGE(TAG, "image size %d, expect %lu", client_data->response_content_len, (unsigned long)total);
+            s_err = ESP_ERR_INVALID_SIZE;
+            return ESP_FAIL;
+        }
+        s_skip = s_recv_off;
+    } else {
+        ESP_LOGE(TAG, "http response %d", code);
+        return ESP_FAIL;
+    }
+    s_response_checked = true;
+    return ESP_OK;
+}
+
+static HTTPC_RESULT mcu_ota_recv_cb(http_client_t *client, http_client_data_t *client_data)
+{
+    if (s_err != ESP_OK) {
+        return HTTP_EUNKOWN;
+    }
+    if (!s_response_checked && ota_check_response(client, client_data) != ESP_OK) {
+        return HTTP_EUNKOWN;
+    }
+
+    const uint8_t *data = (const uint8_t *)client_data->response_buf;
+    uint32_t len = client_data->response_len;
+    if (s_skip) {
+        uint32_t n = len < s_skip ? len : s_skip;
+        data += n;
+        len -= n;
+        s_skip -= n;
+    }
+    if (s_recv_off + len > s_progress.total) {
+        ESP_LOGE(TAG, "body longer than %lu", (unsigned long)s_progress.total);
+        return HTTP_EUNKOWN;
+    }
+
+    while (len && s_err == ESP_OK) {
+        if (!s_fill) {
+            // 串口较慢时在这里等待，下载随之放慢
+            xQueueReceive(s_free_q, &s_fill, portMAX_DELAY);
+            s_fill->off = s_recv_off;
+            s_fill->len = 0;
+        }
+        uint32_t n = MCU_OTA_BLOCK_SIZE - s_fill->len;
+        if (n > len) {
+            n = len;
+        }
+        memcpy(s_fill->buf + MCU_OTA_BLOCK_HEAD + s_fill->len, data, n);
+        s_fill->len += n;
+        s_recv_off += n;
+        data += n;
+        len -= n;
+        if (s_fill->len == MCU_OTA_BLOCK_SIZE || s_recv_off == s_progress.total) {
+            xQueueSend(s_full_q, &s_fill, portMAX_DELAY);
+            s_fill = NULL;
+        }
+    }
+    return s_err == ESP_OK ? HTTP_SUCCESS : HTTP_EUNKOWN;
+}
+
+// 从 offset 开始下载，同时由发送任务转发给 MCU，返回时发送任务已退出
+static esp_err_t ota_transfer(uint32_t offset, http_client_data_t *client_data, http_client_cb_t *client_cb)
+{
+    http_client_t client = {0};
+
+    xQueueReset(s_free_q);
+    xQueueReset(s_full_q);
+    for (int i = 0; i < MCU_OTA_BLOCK_NUM; i++) {
+        mcu_ota_block_t *blk = &s_blocks[i];
+        xQueueSend(s_free_q, &blk, 0);
+    }
+    s_fill = NULL;
+    s_recv_off = offset;
+    if (xTaskCreate(mcu_ota_send_task, "mcu_ota_tx", MCU_OTA_SEND_TASK_STACK, NULL, MCU_OTA_TASK_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+
+    for (int retry = 0; retry < MCU_OTA_HTTP_RETRY && s_err == ESP_OK; retry++) {
+        s_response_checked = false;
+        s_skip = 0;
+        if (s_recv_off) {
+            snprintf(s_range_hdr, sizeof(s_range_hdr), "Range: bytes=%lu-\r\n", (unsigned long)s_recv_off);
+            http_client_set_custom_header(&client, s_range_hdr);
+        } else {
+            http_client_set_custom_header(&client, NULL);
+        }
+        HTTPC_RESULT status = http_client_get_request(&client, s_url, client_data, client_cb);
+        if (s_recv_off == s_progress.total) {
+            break;
+        }
+        ESP_LOGW(TAG, "download stopped at %lu/%lu (%d)", (unsigned long)s_recv_off,
+                 (unsigned long)s_progress.total, status);
+        // 丢弃不满的块，下次从这一块的开头请求
+        if (s_fill) {
+            s_recv_off = s_fill->off;
+            s_fill->len = 0;
+        }
+    }
+
+    // 结束标记，等发送任务处理完之前的块
+    mcu_ota_block_t *end = s_fill;
+    if (!end) {
+        xQueueReceive(s_free_q, &end, portMAX_DELAY);
+    }
+    end->len = 0;
+    xQueueSend(s_full_q, &end, portMAX_DELAY);
+    xSemaphoreTake(s_sender_done, portMAX_DELAY);
+
+    if (s_err != ESP_OK) {
+        return s_err;
+    }
+    return s_recv_off == s_progress.total ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+// 一轮升级：BEGIN 取 MCU 的位置，传完剩余部分，END 校验
+static esp_err_t ota_session(bool first, http_client_data_t *client_data, http_client_cb_t *client_cb)
+{
+    uint8_t req[10];
+    uint32_t off = 0;
+    put_le32(req, s_progress.total);
+    put_le32(req + 4, s_image_crc);
+    req[8] = (uint8_t)(MCU_OTA_BLOCK_SIZE & 0xFF);
+    req[9] = (uint8_t)(MCU_OTA_BLOCK_SIZE >> 8);
+    esp_err_t ret = ota_request(MCU_OTA_CMD_BEGIN, req, sizeof(req), MCU_OTA_STATUS_MS, &off);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "MCU did not accept BEGIN (0x%x)", ret);
+        return ret;
+    }
+    if (off > s_progress.total) {
+        ESP_LOGE(TAG, "MCU reported offset %lu beyond %lu", (unsigned long)off, (unsigned long)s_progress.total);
+        return ESP_ERR_INVALID_RESPONSE;
+    }
+    if (first) {
+        s_progress.resumed_from = off;
+    }
+    s_progress.acked = off;
+    ESP_LOGI(TAG, "MCU at %lu/%lu", (unsigned long)off, (unsigned long)s_progress.total);
+
+    if (off < s_progress.total) {
+        ret = ota_transfer(off, client_data, client_cb);
+        if (ret != ESP_OK) {
+            return ret;
+        }
+    }
+
+    put_le32(req, s_progress.total);
+    put_le32(req + 4, s_image_crc);
+    ret = ota_request(MCU_OTA_CMD_END, req, 8, MCU_OTA_VERIFY_MS, &off);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "MCU image verify failed (0x%x)", ret);
+    }
+    return ret;
+}
+
+static void ota_report(esp_err_t result)
+{
+    char msg[64];
+    int len = snprintf(msg, sizeof(msg), "{\"result\":%d,\"offset\":%lu}", result, (unsigned long)s_progress.acked);
+    gs_mqtt_publish(MCU_OTA_TOPIC_POST, (uint8_t *)msg, (uint16_t)len, GS_MQTT_QOS0, 0);
+}
+
+static void mcu_ota_task(void *arg)
+{
+    http_client_data_t client_data = {0};
+    http_client_cb_t client_cb = {0};
+    esp_err_t ret = ESP_ERR_NO_MEM;
+
+    s_blocks = malloc(sizeof(mcu_ota_block_t) * MCU_OTA_BLOCK_NUM);
+    client_data.response_buf = malloc(MCU_OTA_RECV_BUF_SIZE + 1);
+    if (s_blocks && client_data.response_buf) {
+        client_data.response_buf_len = MCU_OTA_RECV_BUF_SIZE + 1;
+        client_cb.recv_cb = mcu_ota_recv_cb;
+
+        // 只有串口一侧出错才重新 BEGIN：MCU 可能已复位或丢了块，从它报告的位置继续；
+        // 下载重试用尽或镜像不符时重来也无用
+        int session = 0;
+        do {
+            s_err = ESP_OK;
+            ret = ota_session(session == 0, &client_data, &client_cb);
+        } while (ret != ESP_OK && s_err != ESP_OK && s_err != ESP_ERR_INVALID_SIZE
+                 && ++session < MCU_OTA_SESSION_RETRY);
+    }
+
+    free(client_data.response_buf);
+    free(s_blocks);
+    s_blocks = NULL;
+    free(s_url);
+    s_url = NULL;
+
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "MCU firmware updated, %lu bytes, %lu resumed",
+                 (unsigned long)s_progress.total, (unsigned long)s_progress.resumed_from);
+    } else {
+        ESP_LOGE(TAG, "MCU firmware update failed (0x%x) at %lu", ret, (unsigned long)s_progress.acked);
+    }
+    s_progress.state = ret == ESP_OK ? MCU_OTA_DONE : MCU_OTA_FAILED;
+    ota_report(ret);
+    s_running = false;
+    vTaskDelete(NULL);
+}
+
+esp_err_t mcu_ota_start(const char *url, uint32_t size, uint32_t crc32)
+{
+    if (!url || size == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_status_sem) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (s_running) {
+        ESP_LOGW(TAG, "update already running");
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_url = strdup(url);
+    if (!s_url) {
+        return ESP_ERR_NO_MEM;
+    }
+    s_image_crc = crc32;
+    s_progress = (mcu_ota_progress_t){ .state = MCU_OTA_RUNNING, .total = size };
+    s_running = true;
+    if (xTaskCreate(mcu_ota_task, "mcu_ota", MCU_OTA_TASK_STACK, NULL, MCU_OTA_TASK_PRIO, NULL) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create mcu_ota task");
+        free(s_url);
+        s_url = NULL;
+        s_progress.state = MCU_OTA_FAILED;
+        s_running = false;
+        return ESP_ERR_NO_MEM;
+    }
+    ESP_LOGI(TAG, "update %lu bytes from %s", (unsigned long)size, url);
+    return ESP_OK;
+}
+
+void mcu_ota_get_progress(mcu_ota_progress_t *progress)
+{
+    if (progress) {
+        *progress = s_progress;
+    }
+}
+
+/**
+ * @brief 云端下发的升级指令，在 MQTT 任务中回调
+ */
+static void mcu_ota_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGE(TAG, "mcu_ota cmd: json error");
+        return;
+    }
+    cJSON *url = cJSON_GetObjectItem(root, "url");
+    cJSON *size = cJSON_GetObjectItem(root, "size");
+    cJSON *crc = cJSON_GetObjectItem(root, "crc32");
+    if (cJSON_IsString(url) && cJSON_IsNumber(size) && cJSON_IsNumber(crc)) {
+        // crc32 可能超过 int 的范围，按 double 取
+        mcu_ota_start(url->valuestring, (uint32_t)size->valuedouble, (uint32_t)crc->valuedouble);
+    } else {
+        ESP_LOGE(TAG, "mcu_ota cmd: field error");
+    }
+    cJSON_Delete(root);
+}
+
+static void mcu_ota_mqtt_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        // QoS0：重复下发会在升级完成后再走一遍，结果由云端按上报决定是否重发
+        gs_mqtt_subscribe(MCU_OTA_TOPIC_SUB, GS_MQTT_QOS0);
+    }
+}
+
+esp_err_t mcu_ota_init(void)
+{
+    if (s_status_sem) {
+        return ESP_OK;
+    }
+    s_status_sem = xSemaphoreCreateBinary();
+    s_sender_done = xSemaphoreCreateBinary();
+    s_free_q = xQueueCreate(MCU_OTA_BLOCK_NUM, sizeof(mcu_ota_block_t *));
+    s_full_q = xQueueCreate(MCU_OTA_BLOCK_NUM, sizeof(mcu_ota_block_t *));
+    if (!s_status_sem || !s_sender_done || !s_free_q || !s_full_q) {
+        ESP_LOGE(TAG, "Failed to create mcu_ota queues");
+        return ESP_ERR_NO_MEM;
+    }
+    uart_ext_register_callback(mcu_ota_on_frame);
+    gs_mqtt_register_topic_msg_cb(MCU_OTA_TOPIC_SUB, mcu_ota_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, mcu_ota_mqtt_event_handler);
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t mcu_ota_init(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+esp_err_t mcu_ota_start(const char *url, uint32_t size, uint32_t crc32)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void mcu_ota_get_progress(mcu_ota_progress_t *progress)
+{
+    if (progress) {
+        *progress = (mcu_ota_progress_t){0};
+    }
+}
+
+#endif // CONFIG_MCU_OTA
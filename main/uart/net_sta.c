@@ -6,8 +6,10 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/timers.h"
+#include "freertos/semphr.h"
 #include "esp_log.h"
 #include "net_uart_comm.h"
+#include "uart_parse.h"
 #include "get_time.h"
 #include "cc_event.h"    // 事件机制头文件
 #include "gs_wifi.h"     // GS_WIFI_EVENT 定义在此文件中
@@ -22,6 +24,16 @@ static net_status_t current_status = NET_STATUS_NOT_CONFIGURED;
 static TimerHandle_t timer_5s = NULL;
 static TimerHandle_t timer_12s = NULL;
 
+// 状态稳定这么久才通知 MCU；下降（断网方向）要求更久，Wi-Fi 抖动时 MCU 看不到短暂的断开
+#define NET_STA_SETTLE_UP_MS        500
+#define NET_STA_SETTLE_DOWN_MS      3000
+
+// 已通知 MCU 的状态，0 表示尚未通知
+static net_status_t reported_status = 0;
+static TimerHandle_t settle_timer = NULL;
+// 串行化通知，保证 MCU 收到的顺序与决定的顺序一致
+static SemaphoreHandle_t report_lock = NULL;
+
 /**
  * @brief 5秒备份定时器回调函数
  *
@@ -46,6 +58,90 @@ static void timer_12s_callback(TimerHandle_t xTimer)
     }
 }
 
+/**
+ * @brief 构造并发送0x23网络状态通知数据包，调用者持有 report_lock
+ */
+static void net_sta_send_status(net_status_t status)
+{
+    uint32_t utc_time = 0;
+    int8_t timezone = 0;
+    if (status == NET_STATUS_CONNECTED_SERVER) {
+        utc_time = get_time_get_utc();
+        timezone = get_time_get_timezone();
+    }
+
+    uint8_t data[6];
+    data[0] = (uint8_t)status;
+    uart_put_le32(data + 1, utc_time);
+    data[5] = (uint8_t)timezone;
+
+    esp_err_t ret = uart_comm_send_cmd(CMD_NETWORK_STATUS, data);
+    if (ret == ESP_OK) {
+        reported_status = status;
+        ESP_LOGI(TAG, "Sent network status notification: 0x%02X", status);
+    } else {
+        ESP_LOGE(TAG, "Failed to send network status notification.");
+    }
+}
+
+static void net_sta_report_lock(void)
+{
+    if (report_lock) {
+        xSemaphoreTake(report_lock, portMAX_DELAY);
+    }
+}
+
+static void net_sta_report_unlock(void)
+{
+    if (report_lock) {
+        xSemaphoreGive(report_lock);
+    }
+}
+
+/**
+ * @brief 稳定窗口到期：状态在窗口内没有再变化，与已通知的不同时发送
+ */
+static void settle_timer_callback(TimerHandle_t xTimer)
+{
+    net_sta_report_lock();
+    net_status_t status = current_status;
+    if (status != reported_status) {
+        net_sta_send_status(status);
+    }
+    net_sta_report_unlock();
+}
+
+/**
+ * @brief 状态变化后决定何时通知 MCU
+ *
+ * 已连接云服务器立即发送；其余状态等待稳定窗口，窗口内再次变化则重新计时，
+ * 回到已通知的状态则取消，抖动期间不发送。
+ */
+static void net_sta_report(net_status_t status)
+{
+    net_sta_report_lock();
+    if (status == NET_STATUS_CONNECTED_SERVER || status == reported_status) {
+        if (settle_timer) {
+            xTimerStop(settle_timer, 0);
+        }
+        if (status != reported_status) {
+            net_sta_send_status(status);
+        }
+        net_sta_report_unlock();
+        return;
+    }
+    uint32_t settle_ms = status < reported_status ? NET_STA_SETTLE_DOWN_MS : NET_STA_SETTLE_UP_MS;
+    if (settle_timer == NULL) {
+        settle_timer = xTimerCreate("net_sta_settle", pdMS_TO_TICKS(settle_ms), pdFALSE, NULL, settle_timer_callback);
+    }
+    // xTimerChangePeriod 同时（重新）启动定时器
+    if (settle_timer == NULL || xTimerChangePeriod(settle_timer, pdMS_TO_TICKS(settle_ms), 0) != pdPASS) {
+        ESP_LOGW(TAG, "Settle timer unavailable, send status 0x%02X now", status);
+        net_sta_send_status(status);
+    }
+    net_sta_report_unlock();
+}
+
 /**
  * @brief 联网状态事件处理回调函数
  *
@@ -90,6 +186,15 @@ static void net_sta_event_handler(void *handler_args, cc_event_base_t base_event
     }
 }
 
+// 只订阅会改变联网状态的事件
+static const cc_event_sub_t s_net_sta_subs[] = {
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_CONNECTED, net_sta_event_handler),
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_GOT_IP, net_sta_event_handler),
+    CC_EVENT_SUB(GS_WIFI_EVENT, GS_WIFI_EVENT_STA_DISCONNECTED, net_sta_event_handler),
+    CC_EVENT_SUB(GS_MQTT_EVENT, GS_MQTT_EVENT_CONNECTED, net_sta_event_handler),
+    CC_EVENT_SUB(GS_MQTT_EVENT, GS_MQTT_EVENT_DISCONNECTED, net_sta_event_handler),
+};
+
 /**
  * @brief 初始化联网状态管理模块
  *
@@ -98,11 +203,13 @@ static void net_sta_event_handler(void *handler_args, cc_event_base_t base_event
 esp_err_t net_sta_init(void)
 {
     current_status = NET_STATUS_NOT_CONFIGURED;
+    if (report_lock == NULL) {
+        report_lock = xSemaphoreCreateMutex();
+    }
     ESP_LOGI(TAG, "Network STA initialized with status: 0x%02X", current_status);
 
     // 注册事件处理回调
-    cc_event_register_handler(GS_WIFI_EVENT, net_sta_event_handler);
-    cc_event_register_handler(GS_MQTT_EVENT, net_sta_event_handler);
+    cc_event_register_table(s_net_sta_subs, CC_EVENT_SUB_NUM(s_net_sta_subs));
 
     return ESP_OK;
 }
@@ -118,7 +225,7 @@ net_status_t net_sta_get_status(void)
 /**
  * @brief 更新联网状态并发送通知
  *
- * 当状态变化时，同时取消相关备份定时器，并构造UART数据包发送网络状态通知。
+ * 当状态变化时，同时取消相关备份定时器，并按 net_sta_report() 的规则通知 MCU。
  */
 esp_err_t net_sta_update_status(net_status_t status)
 {
@@ -148,35 +255,7 @@ esp_err_t net_sta_update_status(net_status_t status)
             timer_12s = NULL;
         }
 
-        // 构造并发送0x23网络状态通知数据包
-        uart_packet_t packet = {
-            .header = {0xAA, 0x55},
-            .command = CMD_NETWORK_STATUS,
-            .data = {0},
-        };
-
-        uint32_t utc_time = 0;
-        int8_t timezone = 0;
-        if (current_status == NET_STATUS_CONNECTED_SERVER) {
-            utc_time = get_time_get_utc();
-            timezone = get_time_get_timezone();
-        }
-
-        packet.data[0] = (uint8_t)current_status;
-        packet.data[1] = (uint8_t)(utc_time & 0xFF);
-        packet.data[2] = (uint8_t)((utc_time >> 8) & 0xFF);
-        packet.data[3] = (uint8_t)((utc_time >> 16) & 0xFF);
-        packet.data[4] = (uint8_t)((utc_time >> 24) & 0xFF);
-        packet.data[5] = (uint8_t)timezone;
-
-        packet.checksum = uart_comm_calc_checksum((uint8_t *)&packet, sizeof(uart_packet_t) - 1);
-
-        esp_err_t ret = uart_comm_send_packet(&packet);
-        if (ret == ESP_OK) {
-            ESP_LOGI(TAG, "Sent network status notification.");
-        } else {
-            ESP_LOGE(TAG, "Failed to send network status notification.");
-        }
+        net_sta_report(current_status);
     }
     return ESP_OK;
 }
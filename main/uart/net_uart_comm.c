@@ -15,21 +15,98 @@
 #include "uart_config.h"
 #include "nvs_flash.h"
 #include "esp_system.h"
-#include "state_report.h"  // 为了使用 CMD_STATE_REPORT 定义
+#include "state_report.h"
+#include "checksum.h"
+#include "lat_trace.h"
+#include "uart_ext.h"
+#include "uart_baud.h"
+#include "uart_rx.h"
+#include "uart_parse.h"
+#include "power_profile.h"
+#include "metrics.h"
+#include "esp_timer.h"
+#include "unlock.h"
+#include "msg_upload.h"
+#include "img_transfer.h"
+#include "evt_log.h"
 
 static const char *TAG = "uart_comm";
 
-// UART 事件队列句柄
-static QueueHandle_t uart_event_queue = NULL;
-// UART 事件任务句柄
-static TaskHandle_t  uart_task_handle = NULL;
-
 // 注册的数据包回调函数
 static uart_packet_callback_t s_packet_callback = NULL;
 
 // 清除数据互斥锁（用于 CMD_CLEAR_DATA 处理）
 static SemaphoreHandle_t clear_data_mutex = NULL;
 
+// 逐包打印收发详情（默认关闭，调试时通过 uart_comm_set_verbose() 打开）
+static bool s_log_verbose = false;
+
+// ========== 命令表，由 uart_cmd_schema.h 展开 ==========
+typedef enum {
+    UART_DIR_RX = 0,
+    UART_DIR_TX,
+    UART_DIR_BOTH,
+} uart_cmd_dir_t;
+
+typedef enum {
+    UART_LANE_HIGH = 0,     // 与 s_tx_lanes 的下标一致
+    UART_LANE_NORMAL,
+} uart_cmd_lane_t;
+
+typedef enum {
+    UART_ACK_NONE = 0,
+    UART_ACK_SELF,
+    UART_ACK_ZERO,
+    UART_ACK_ECHO,
+    UART_ACK_STATUS,
+    UART_ACK_STATUS_CMD,
+} uart_ack_policy_t;
+
+typedef struct {
+    uart_cmd_handler_t handler;
+    const char *name;
+    const char *layout;
+    uint8_t ack_cmd;
+    uint8_t ack;            // uart_ack_policy_t
+    uint8_t lane;           // uart_cmd_lane_t
+    uint8_t dir;            // uart_cmd_dir_t
+} uart_cmd_desc_t;
+
+#define UART_CMD_IDX(name, cmd, dir, lane, ack_cmd, ack, handler, layout) UART_CMD_IDX_##name,
+enum {
+    UART_CMD_SCHEMA(UART_CMD_IDX)
+    UART_CMD_NUM
+};
+
+#define UART_CMD_DESC(name, cmd, dir, lane, ack_cmd, ack, handler, layout) \
+    { handler, #name, layout, ack_cmd, UART_ACK_##ack, UART_LANE_##lane, UART_DIR_##dir },
+static const uart_cmd_desc_t s_cmds[UART_CMD_NUM] = {
+    UART_CMD_SCHEMA(UART_CMD_DESC)
+};
+
+// 命令字直接索引，值为 s_cmds 下标 + 1，0 表示未列出
+#define UART_CMD_INDEX(name, cmd, ...) [cmd] = UART_CMD_IDX_##name + 1,
+static const uint8_t s_cmd_index[256] = {
+    UART_CMD_SCHEMA(UART_CMD_INDEX)
+};
+
+// 命令字重复时 case 标签重复，编译报错
+#define UART_CMD_CASE(name, cmd, ...) case (cmd):
+static inline void uart_cmd_schema_check(uint8_t command)
+{
+    switch (command) {
+    UART_CMD_SCHEMA(UART_CMD_CASE)
+    default:
+        break;
+    }
+}
+
+static inline const uart_cmd_desc_t *uart_cmd_find(uint8_t command)
+{
+    uint8_t idx = s_cmd_index[command];
+    return idx ? &s_cmds[idx - 1] : NULL;
+}
+
 /**
  * @brief 调试打印原始数据
  */
@@ -49,9 +126,13 @@ static void print_raw_data(const char* prefix, const uint8_t* data, size_t len)
  */
 static void print_packet_details(const uart_packet_t *packet, const char* prefix)
 {
+    const uart_cmd_desc_t *desc = uart_cmd_find(packet->command);
     ESP_LOGI(TAG, "====== %s Packet Details ======", prefix);
     ESP_LOGI(TAG, "Header: 0x%02X 0x%02X", packet->header[0], packet->header[1]);
-    ESP_LOGI(TAG, "Command: 0x%02X", packet->command);
+    ESP_LOGI(TAG, "Command: 0x%02X %s", packet->command, desc ? desc->name : "?");
+    if (desc && desc->layout[0]) {
+        ESP_LOGI(TAG, "Layout: %s", desc->layout);
+    }
     ESP_LOGI(TAG, "Data: %02X %02X %02X %02X %02X %02X",
              packet->data[0], packet->data[1], packet->data[2],
              packet->data[3], packet->data[4], packet->data[5]);
@@ -61,107 +142,163 @@ static void print_packet_details(const uart_packet_t *packet, const char* prefix
 
 uint8_t uart_comm_calc_checksum(const uint8_t *data, size_t length)
 {
-    uint16_t sum = 0;
-    for (size_t i = 0; i < length; i++) {
-        sum += data[i];
-    }
-    return (uint8_t)(sum & 0xFF);
+    return (uint8_t)(checksum_sum8(data, length) & 0xFF);
 }
 
-esp_err_t uart_comm_send_packet(const uart_packet_t *packet)
-{
-    if (!packet) {
-        ESP_LOGE(TAG, "Invalid null packet pointer");
-        return ESP_ERR_INVALID_ARG;
-    }
+// ========== 异步发送：发送任务 + 两条优先级通道 ==========
+#define UART_TX_HIGH_LEN        8       // 开锁、应答类，最后一格只留给远程开锁
+#define UART_TX_NORMAL_LEN      16      // 状态通知、上报类
 
-    print_packet_details(packet, "Sending");
+typedef struct {
+    uart_packet_t *slots;
+    uint8_t cap;
+    uint8_t head;           // 最旧一包的位置
+    uint8_t count;
+} uart_tx_lane_t;
 
-    int tx_len = sizeof(uart_packet_t);
-    int ret = uart_write_bytes(UART_NUM, (const char *)packet, tx_len);
+static uart_packet_t s_tx_high_slots[UART_TX_HIGH_LEN];
+static uart_packet_t s_tx_normal_slots[UART_TX_NORMAL_LEN];
+static uart_tx_lane_t s_tx_lanes[2] = {
+    { .slots = s_tx_high_slots,   .cap = UART_TX_HIGH_LEN },
+    { .slots = s_tx_normal_slots, .cap = UART_TX_NORMAL_LEN },
+};
+static portMUX_TYPE s_tx_lock = portMUX_INITIALIZER_UNLOCKED;
+static TaskHandle_t s_tx_task_handle = NULL;
+
+// 命令表中未列出的命令走普通通道
+static bool uart_tx_is_high_priority(uint8_t command)
+{
+    const uart_cmd_desc_t *desc = uart_cmd_find(command);
+    return desc && desc->lane == UART_LANE_HIGH;
+}
+
+static esp_err_t uart_tx_write(const uart_packet_t *packet)
+{
+    if (s_log_verbose) {
+        print_packet_details(packet, "Sending");
+    }
+    int ret = uart_write_bytes(UART_NUM, (const char *)packet, sizeof(uart_packet_t));
     if (ret < 0) {
         ESP_LOGE(TAG, "uart_write_bytes failed: %d", ret);
         return ESP_FAIL;
     }
-
-    ESP_LOGI(TAG, "Successfully sent %d bytes", ret);
     return ESP_OK;
 }
 
-esp_err_t uart_comm_send_wifi_response(wifi_config_status_t status)
+// 入队，需在 s_tx_lock 内调用；联网状态只保留最新一包，重复的状态上报直接合并
+static bool uart_tx_push_locked(uart_tx_lane_t *lane, const uart_packet_t *packet)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command = CMD_WIFI_RESPONSE;
-    packet.data[0] = (uint8_t)status;
-    for (int i = 1; i < 6; i++) {
-        packet.data[i] = 0x00;
+    for (uint8_t i = 0; i < lane->count; i++) {
+        uart_packet_t *pending = &lane->slots[(lane->head + i) % lane->cap];
+        if (pending->command != packet->command) {
+            continue;
+        }
+        if (packet->command == CMD_NETWORK_STATUS) {
+            *pending = *packet;
+            return true;
+        }
+        if (packet->command == CMD_STATE_REPORT && memcmp(pending, packet, sizeof(uart_packet_t)) == 0) {
+            return true;
+        }
     }
-    packet.checksum = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_packet_t) - 1);
-    ESP_LOGI(TAG, "Sending WiFi configuration response, status=0x%02X", status);
-    return uart_comm_send_packet(&packet);
+    // 远程开锁插到队首；其余命令不能占用留给它的最后一格
+    if (packet->command == CMD_REMOTE_UNLOCK) {
+        if (lane->count >= lane->cap) {
+            return false;
+        }
+        lane->head = (lane->head + lane->cap - 1) % lane->cap;
+        lane->slots[lane->head] = *packet;
+        lane->count++;
+        return true;
+    }
+    if (lane->count >= lane->cap - (lane == &s_tx_lanes[0] ? 1 : 0)) {
+        return false;
+    }
+    lane->slots[(lane->head + lane->count) % lane->cap] = *packet;
+    lane->count++;
+    return true;
 }
 
-esp_err_t uart_comm_send_exit_config_ack(void)
+static bool uart_tx_pop(uart_packet_t *packet)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command = CMD_EXIT_CONFIG_ACK;
-    memset(packet.data, 0, sizeof(packet.data));
-    packet.checksum = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_packet_t) - 1);
-    ESP_LOGI(TAG, "Sending Exit Config ACK (0x1B)");
-    return uart_comm_send_packet(&packet);
+    bool got = false;
+    portENTER_CRITICAL(&s_tx_lock);
+    for (int i = 0; i < 2 && !got; i++) {
+        uart_tx_lane_t *lane = &s_tx_lanes[i];
+        if (lane->count) {
+            *packet = lane->slots[lane->head];
+            lane->head = (lane->head + 1) % lane->cap;
+            lane->count--;
+            got = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_tx_lock);
+    return got;
 }
 
-esp_err_t uart_comm_send_network_status(bool connected)
+static void uart_tx_task(void *arg)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command = CMD_NETWORK_STATUS;
-    packet.data[0] = connected ? 0x04 : 0x03;
-    uint32_t utc_time = get_time_get_utc();
-    int8_t timezone = get_time_get_timezone();
-    packet.data[1] = (uint8_t)(utc_time & 0xFF);
-    packet.data[2] = (uint8_t)((utc_time >> 8) & 0xFF);
-    packet.data[3] = (uint8_t)((utc_time >> 16) & 0xFF);
-    packet.data[4] = (uint8_t)((utc_time >> 24) & 0xFF);
-    packet.data[5] = (uint8_t)timezone;
-    packet.checksum = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_packet_t) - 1);
-    ESP_LOGI(TAG, "Sending network status, connected=%d", connected);
-    return uart_comm_send_packet(&packet);
+    uart_packet_t packet;
+    while (1) {
+        ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        while (uart_tx_pop(&packet)) {
+            if (uart_tx_write(&packet) == ESP_OK && packet.command == CMD_REMOTE_UNLOCK) {
+                unlock_trace_mark(UNLOCK_TRACE_CMD_TX);
+            }
+        }
+    }
 }
 
-esp_err_t uart_comm_send_network_time(uint32_t utc_time_sec, int8_t timezone_15min)
+esp_err_t uart_comm_send_packet(const uart_packet_t *packet)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command = CMD_GET_NETWORK_TIME_RSP;
-    packet.data[0] = (uint8_t)(utc_time_sec & 0xFF);
-    packet.data[1] = (uint8_t)((utc_time_sec >> 8) & 0xFF);
-    packet.data[2] = (uint8_t)((utc_time_sec >> 16) & 0xFF);
-    packet.data[3] = (uint8_t)((utc_time_sec >> 24) & 0xFF);
-    packet.data[4] = (uint8_t)timezone_15min;
-    packet.data[5] = 0x00;
-    packet.checksum = uart_comm_calc_checksum((uint8_t *)&packet, sizeof(uart_packet_t) - 1);
-    ESP_LOGI(TAG, "Send CMD=0x11, UTC=%u, TZ=%d", (unsigned)utc_time_sec, (int)timezone_15min);
+    if (!packet) {
+        ESP_LOGE(TAG, "Invalid null packet pointer");
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_tx_task_handle) {
+        // 发送任务尚未启动，直接同步发送
+        esp_err_t ret = uart_tx_write(packet);
+        if (ret == ESP_OK && packet->command == CMD_REMOTE_UNLOCK) {
+            unlock_trace_mark(UNLOCK_TRACE_CMD_TX);
+        }
+        return ret;
+    }
+
+    uart_tx_lane_t *lane = &s_tx_lanes[uart_tx_is_high_priority(packet->command) ? 0 : 1];
+    portENTER_CRITICAL(&s_tx_lock);
+    bool queued = uart_tx_push_locked(lane, packet);
+    portEXIT_CRITICAL(&s_tx_lock);
+    if (!queued) {
+        ESP_LOGW(TAG, "UART TX queue full, drop cmd=0x%02X", packet->command);
+        return ESP_ERR_NO_MEM;
+    }
+    xTaskNotifyGive(s_tx_task_handle);
+    return ESP_OK;
+}
+
+esp_err_t uart_comm_send_cmd(uint8_t command, const uint8_t *data)
+{
+    uart_packet_t packet;
+    uart_packet_build(&packet, command, data);
     return uart_comm_send_packet(&packet);
 }
 
-esp_err_t uart_comm_send_device_info(const char *device_id, const uint8_t *mac)
+esp_err_t uart_comm_send_network_status(bool connected)
+{
+    uint8_t data[6];
+    data[0] = connected ? 0x04 : 0x03;
+    uart_put_le32(data + 1, get_time_get_utc());
+    data[5] = (uint8_t)get_time_get_timezone();
+    ESP_LOGD(TAG, "Sending network status, connected=%d", connected);
+    return uart_comm_send_cmd(CMD_NETWORK_STATUS, data);
+}
+
+static esp_err_t uart_comm_send_device_info(const char *device_id, const uint8_t *mac)
 {
-    if (!device_id || !mac) {
-        ESP_LOGE(TAG, "Invalid parameters for device info");
-        return ESP_ERR_INVALID_ARG;
-    }
     uart_device_info_packet_t packet = {0};
     packet.header[0] = 0xAA;
     packet.header[1] = 0x55;
     packet.command = CMD_GET_DEVICE_INFO_RSP;
-    memset(packet.device_id, 0, sizeof(packet.device_id));
     size_t len = strlen(device_id);
     if (len > 12) {
         len = 12;
@@ -169,37 +306,31 @@ esp_err_t uart_comm_send_device_info(const char *device_id, const uint8_t *mac)
     }
     memcpy(packet.device_id, device_id, len);
     memcpy(packet.mac, mac, 6);
-    memset(packet.reserved, 0, sizeof(packet.reserved));
     packet.checksum = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_device_info_packet_t) - 1);
     ESP_LOGI(TAG, "Sending device info response, ID=%s, MAC=%02X:%02X:%02X:%02X:%02X:%02X",
              device_id, mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-    print_raw_data("UART Data Sent", (uint8_t *)&packet, sizeof(uart_device_info_packet_t));
+    if (s_log_verbose) {
+        print_raw_data("UART Data Sent", (uint8_t *)&packet, sizeof(uart_device_info_packet_t));
+    }
     int tx_len = sizeof(uart_device_info_packet_t);
     int ret = uart_write_bytes(UART_NUM, (const char *)&packet, tx_len);
     if (ret < 0) {
         ESP_LOGE(TAG, "uart_write_bytes failed: %d", ret);
         return ESP_FAIL;
     }
-    ESP_LOGI(TAG, "Successfully sent %d bytes", ret);
+    ESP_LOGD(TAG, "Successfully sent %d bytes", ret);
     return ESP_OK;
 }
 
-esp_err_t uart_comm_send_clear_data_response(bool success)
+static esp_err_t uart_comm_send_clear_data_response(bool success)
 {
-    uart_packet_t packet = {0};
-    packet.header[0] = 0xAA;
-    packet.header[1] = 0x55;
-    packet.command = CMD_WIFI_RESPONSE;
-    packet.data[0] = success ? 0x00 : 0x02;
-    for (int i = 1; i < 6; i++) {
-        packet.data[i] = 0x00;
-    }
-    packet.checksum = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_packet_t) - 1);
+    uint8_t data[6] = {0};
+    data[0] = success ? UART_CMD_OK : UART_CMD_FAIL;
     ESP_LOGI(TAG, "Sending CMD_WIFI_RESPONSE (0x02) for CMD_CLEAR_DATA, success=%d", success);
-    return uart_comm_send_packet(&packet);
+    return uart_comm_send_cmd(CMD_WIFI_RESPONSE, data);
 }
 
-static esp_err_t uart_comm_handle_clear_data(void)
+static esp_err_t uart_comm_clear_data(void)
 {
     ESP_LOGI(TAG, "Handling CMD_CLEAR_DATA: Clearing NVS and resetting state");
     if (xSemaphoreTake(clear_data_mutex, (TickType_t)10) != pdTRUE) {
@@ -240,214 +371,167 @@ static esp_err_t uart_comm_handle_clear_data(void)
     return ESP_OK;
 }
 
-static void uart_packet_received_internal(const uart_packet_t *packet)
+// ========== 本模块的命令处理函数 ==========
+uint8_t uart_comm_handle_network_status(const uart_packet_t *packet)
 {
-    ESP_LOGI(TAG, "uart_packet_received_internal: CMD=0x%02X", packet->command);
-    switch (packet->command) {
-    case CMD_WIFI_CONFIG:
-        ESP_LOGI(TAG, "Got CMD_WIFI_CONFIG (0x01)");
-        if (s_packet_callback) {
-            s_packet_callback(packet);
-        }
-        break;
-    case CMD_EXIT_CONFIG:
-        ESP_LOGI(TAG, "Got CMD_EXIT_CONFIG (0x1A)");
-        if (s_packet_callback) {
-            s_packet_callback(packet);
-        }
-        break;
-    case CMD_NETWORK_STATUS:
-        ESP_LOGI(TAG, "Got CMD_NETWORK_STATUS (0x23)");
-        {
-            if (packet->data[0] == 0x01) {
-                ESP_LOGI(TAG, "Network Status: Not Configured");
-            } else if (packet->data[0] == 0x02) {
-                ESP_LOGI(TAG, "Network Status: Connecting to Router/Base Station");
-            } else if (packet->data[0] == 0x03) {
-                ESP_LOGI(TAG, "Network Status: Connected to Router/Base Station");
-            } else if (packet->data[0] == 0x04) {
-                ESP_LOGI(TAG, "Network Status: Connected to Cloud Server");
-            } else {
-                ESP_LOGW(TAG, "Unknown Network Status: 0x%02X", packet->data[0]);
-            }
-            uint32_t utc_time_sec = packet->data[1] |
-                                    (packet->data[2] << 8) |
-                                    (packet->data[3] << 16) |
-                                    (packet->data[4] << 24);
-            int8_t timezone_15min = (int8_t)packet->data[5];
-            ESP_LOGI(TAG, "Received UTC Time: %u, Timezone: %d", utc_time_sec, timezone_15min);
-        }
-        break;
-    case CMD_GET_NETWORK_TIME:
-        ESP_LOGI(TAG, "Got CMD_GET_NETWORK_TIME (0x10)");
-        {
-            uint32_t utc_sec  = get_time_get_utc();
-            int8_t tz_15min = get_time_get_timezone();
-            ESP_LOGI(TAG, "Now cached time: UTC=%u, TimeZone=%d", (unsigned)utc_sec, (int)tz_15min);
-            esp_err_t ret = uart_comm_send_network_time(utc_sec, tz_15min);
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to send network time");
-            }
-        }
-        break;
-    case CMD_GET_DEVICE_INFO:
-        ESP_LOGI(TAG, "Got CMD_GET_DEVICE_INFO (0x06)");
-        {
-            char device_id[13] = {0};
-            uint8_t mac[6] = {0};
-            if (gs_device_get_product_key(device_id) != CC_OK) {
-                ESP_LOGE(TAG, "Failed to get device ID");
-                return;
-            }
-            if (cl_hal_wifi_sta_get_mac(mac) != CC_OK) {
-                ESP_LOGE(TAG, "Failed to get WiFi MAC");
-                return;
-            }
-            ESP_LOGI(TAG, "Retrieved Device ID: %s", device_id);
-            ESP_LOGI(TAG, "Retrieved MAC Address: %02X:%02X:%02X:%02X:%02X:%02X",
-                     mac[0], mac[1], mac[2], mac[3], mac[4], mac[5]);
-            esp_err_t ret = uart_comm_send_device_info(device_id, mac);
-            if (ret != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to send device info");
-            }
-        }
-        break;
-    case CMD_CLEAR_DATA:
-        ESP_LOGI(TAG, "Got CMD_CLEAR_DATA (0x05)");
-        {
-            esp_err_t ret = uart_comm_handle_clear_data();
-            if (ret != ESP_OK) {
-                uart_comm_send_clear_data_response(false);
-            }
-        }
+    if (!s_log_verbose) {
+        return UART_CMD_OK;
+    }
+    if (packet->data[0] == 0x01) {
+        ESP_LOGI(TAG, "Network Status: Not Configured");
+    } else if (packet->data[0] == 0x02) {
+        ESP_LOGI(TAG, "Network Status: Connecting to Router/Base Station");
+    } else if (packet->data[0] == 0x03) {
+        ESP_LOGI(TAG, "Network Status: Connected to Router/Base Station");
+    } else if (packet->data[0] == 0x04) {
+        ESP_LOGI(TAG, "Network Status: Connected to Cloud Server");
+    } else {
+        ESP_LOGW(TAG, "Unknown Network Status: 0x%02X", packet->data[0]);
+    }
+    ESP_LOGI(TAG, "Received UTC Time: %u, Timezone: %d",
+             (unsigned)uart_get_le32(packet->data + 1), (int8_t)packet->data[5]);
+    return UART_CMD_OK;
+}
+
+uint8_t uart_comm_handle_network_time(const uart_packet_t *packet)
+{
+    uint32_t utc_sec  = get_time_get_utc();
+    int8_t tz_15min = get_time_get_timezone();
+    ESP_LOGI(TAG, "Now cached time: UTC=%u, TimeZone=%d", (unsigned)utc_sec, (int)tz_15min);
+    uint8_t data[6] = {0};
+    uart_put_le32(data, utc_sec);
+    data[4] = (uint8_t)tz_15min;
+    if (uart_comm_send_cmd(CMD_GET_NETWORK_TIME_RSP, data) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send network time");
+        return UART_CMD_FAIL;
+    }
+    return UART_CMD_OK;
+}
+
+uint8_t uart_comm_handle_device_info(const uart_packet_t *packet)
+{
+    char device_id[13] = {0};
+    uint8_t mac[6] = {0};
+    if (gs_device_get_product_key(device_id) != CC_OK) {
+        ESP_LOGE(TAG, "Failed to get device ID");
+        return UART_CMD_FAIL;
+    }
+    if (cl_hal_wifi_sta_get_mac(mac) != CC_OK) {
+        ESP_LOGE(TAG, "Failed to get WiFi MAC");
+        return UART_CMD_FAIL;
+    }
+    if (uart_comm_send_device_info(device_id, mac) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send device info");
+        return UART_CMD_FAIL;
+    }
+    return UART_CMD_OK;
+}
+
+// 成功时回复后重启，不会返回
+uint8_t uart_comm_handle_clear_data(const uart_packet_t *packet)
+{
+    if (uart_comm_clear_data() != ESP_OK) {
+        uart_comm_send_clear_data_response(false);
+        return UART_CMD_FAIL;
+    }
+    return UART_CMD_OK;
+}
+
+// ========== 分派 ==========
+static void uart_cmd_send_ack(const uart_cmd_desc_t *desc, const uart_packet_t *packet, uint8_t status)
+{
+    uint8_t data[6] = {0};
+    switch (desc->ack) {
+    case UART_ACK_ECHO:
+        data[0] = packet->data[0];
         break;
-    case CMD_IMG_TRANSFER:
-        ESP_LOGI(TAG, "Got CMD_IMG_TRANSFER (0x1C)");
-        if (s_packet_callback) {
-            s_packet_callback(packet);
-        }
+    case UART_ACK_STATUS_CMD:
+        data[1] = packet->command;
+        data[0] = status;
         break;
-    case CMD_STATE_REPORT:
-        ESP_LOGI(TAG, "Got CMD_STATE_REPORT (0x42) => forward to state_report module");
-        if (s_packet_callback) {
-            s_packet_callback(packet);
-        }
+    case UART_ACK_STATUS:
+        data[0] = status;
         break;
-    case CMD_STATE_REPORT_ACK:
-        ESP_LOGI(TAG, "Received CMD_STATE_REPORT_ACK (0x43)");
-        state_report_ack_handler();
+    default:
         break;
-    case 0x03:
-        ESP_LOGI(TAG, "Got CMD=0x03, forwarding to callback");
-        if (s_packet_callback) {
-            s_packet_callback(packet);
+    }
+    if (uart_comm_send_cmd(desc->ack_cmd, data) != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to send %s ack (0x%02X)", desc->name, desc->ack_cmd);
+    }
+}
+
+// 从收到这一批数据到命令处理完成的耗时，同一批中靠后的命令包含前面命令的处理时间
+static metrics_hist_t s_dispatch_us = METRICS_HIST_INIT("uart.rx_to_dispatch_us");
+static int64_t s_rx_t0 = 0;
+
+static void uart_packet_dispatch(const uart_packet_t *packet)
+{
+    if (s_log_verbose) {
+        print_packet_details(packet, "Received");
+    }
+    evt_log(EVT_MOD_UART, packet->command, uart_get_le16(packet->data), uart_get_le32(packet->data + 2));
+
+    const uart_cmd_desc_t *desc = uart_cmd_find(packet->command);
+    if (!desc || !desc->handler) {
+        if (!desc || desc->dir == UART_DIR_TX) {
+            ESP_LOGW(TAG, "Unexpected cmd=0x%02X", packet->command);
         }
-        break;
-    case 0x12:
-        ESP_LOGI(TAG, "Got CMD=0x12, forwarding to callback");
         if (s_packet_callback) {
             s_packet_callback(packet);
         }
-        break;
-    default:
-        ESP_LOGW(TAG, "Unknown cmd=0x%02X", packet->command);
-        if (s_packet_callback) {
-            s_packet_callback(packet);
+    } else if (desc->ack == UART_ACK_ZERO || desc->ack == UART_ACK_ECHO) {
+        uart_cmd_send_ack(desc, packet, UART_CMD_OK);
+        desc->handler(packet);
+    } else {
+        uint8_t status = desc->handler(packet);
+        if (desc->ack == UART_ACK_STATUS || desc->ack == UART_ACK_STATUS_CMD) {
+            uart_cmd_send_ack(desc, packet, status);
         }
-        break;
     }
+    metrics_hist_record(&s_dispatch_us, (uint32_t)(esp_timer_get_time() - s_rx_t0));
 }
 
-static void uart_event_task(void *arg)
+static void uart_bad_checksum(uint8_t calc, uint8_t recv)
 {
-    uart_event_t event;
-    uint8_t data_buffer[UART_BUFFER_SIZE];
-    int state = 0;
-    uart_packet_t packet;
-    int len = 0;
+    ESP_LOGE(TAG, "Checksum mismatch: calc=0x%02X, recv=0x%02X", calc, recv);
+    uart_baud_link_error();
+}
 
-    ESP_LOGI(TAG, "UART event task started");
+static const uart_parse_ops_t s_parse_ops = {
+    .on_packet = uart_packet_dispatch,
+    .on_ext_frame = uart_ext_on_frame,
+    .on_bad_checksum = uart_bad_checksum,
+};
 
-    while (1) {
-        if (xQueueReceive(uart_event_queue, &event, portMAX_DELAY)) {
-            switch (event.type) {
-            case UART_DATA:
-                len = uart_read_bytes(UART_NUM, data_buffer, event.size, portMAX_DELAY);
-                if (len > 0) {
-                    print_raw_data("Raw data", data_buffer, len);
-                    for (int i = 0; i < len; i++) {
-                        uint8_t b = data_buffer[i];
-                        switch (state) {
-                        case 0:
-                            if (b == 0xAA) {
-                                packet.header[0] = b;
-                                state = 1;
-                            }
-                            break;
-                        case 1:
-                            if (b == 0x55) {
-                                packet.header[1] = b;
-                                state = 2;
-                            } else {
-                                state = 0;
-                            }
-                            break;
-                        case 2:
-                            packet.command = b;
-                            state = 3;
-                            break;
-                        case 3: case 4: case 5: case 6: case 7: case 8:
-                            packet.data[state - 3] = b;
-                            state++;
-                            break;
-                        case 9:
-                            packet.checksum = b;
-                            {
-                                uint8_t calc = uart_comm_calc_checksum((uint8_t*)&packet, sizeof(uart_packet_t) - 1);
-                                if (calc == packet.checksum) {
-                                    ESP_LOGI(TAG, "Received valid packet");
-                                    print_packet_details(&packet, "Received");
-                                    uart_packet_received_internal(&packet);
-                                } else {
-                                    ESP_LOGE(TAG, "Checksum mismatch: calc=0x%02X, recv=0x%02X", calc, packet.checksum);
-                                }
-                            }
-                            state = 0;
-                            break;
-                        default:
-                            state = 0;
-                            break;
-                        }
-                    }
-                }
-                break;
-            case UART_FIFO_OVF:
-                ESP_LOGE(TAG, "HW FIFO overflow");
-                uart_flush_input(UART_NUM);
-                xQueueReset(uart_event_queue);
-                break;
-            case UART_BUFFER_FULL:
-                ESP_LOGE(TAG, "Ring buffer full");
-                uart_flush_input(UART_NUM);
-                xQueueReset(uart_event_queue);
-                break;
-            case UART_BREAK:
-                ESP_LOGW(TAG, "UART Break");
-                break;
-            case UART_PARITY_ERR:
-                ESP_LOGW(TAG, "UART Parity Error");
-                break;
-            case UART_FRAME_ERR:
-                ESP_LOGW(TAG, "UART Frame Error");
-                break;
-            default:
-                ESP_LOGW(TAG, "Unhandled UART event type: %d", event.type);
-                break;
-            }
-        }
+// 前部保留上次未解析完的半帧
+static uint8_t s_rx_buf[UART_EXT_FRAME_MAX + UART_RX_BURST_MAX];
+static size_t s_rx_len = 0;
+
+// 在 uart_rx 接收任务中调用
+static void uart_rx_data_cb(const uint8_t *data, size_t len, void *arg)
+{
+    s_rx_t0 = esp_timer_get_time();
+    power_profile_uart_activity();
+    if (s_log_verbose) {
+        print_raw_data("Raw data", data, len);
+    }
+    memcpy(s_rx_buf + s_rx_len, data, len);
+    s_rx_len += len;
+    size_t used = uart_parse_packets(s_rx_buf, s_rx_len, &s_parse_ops);
+    s_rx_len -= used;
+    if (s_rx_len >= UART_EXT_FRAME_MAX) {
+        // 不会发生：剩余部分总是不足一帧
+        s_rx_len = 0;
+    } else if (s_rx_len) {
+        memmove(s_rx_buf, s_rx_buf + used, s_rx_len);
     }
 }
 
+static void uart_rx_reset_cb(void *arg)
+{
+    s_rx_len = 0;
+}
+
 static void init_clear_data_mutex(void)
 {
     clear_data_mutex = xSemaphoreCreateMutex();
@@ -466,17 +550,31 @@ esp_err_t uart_comm_init(void)
         ESP_LOGE(TAG, "uart_config_init failed: %d", ret);
         return ret;
     }
-    uart_event_queue = uart_config_get_queue();
-    if (uart_event_queue == NULL) {
-        ESP_LOGE(TAG, "Failed to get UART event queue");
-        return ESP_FAIL;
+    metrics_register(&s_dispatch_us.head);
+    // 扩展帧需在接收开始前就绪
+    uart_ext_init();
+    uart_rx_port_config_t rx_config = {
+        .port = UART_NUM,
+        .event_queue = uart_config_get_queue(),
+        .on_data = uart_rx_data_cb,
+        .on_reset = uart_rx_reset_cb,
+    };
+    ret = uart_rx_register(&rx_config);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "uart_rx_register failed: %d", ret);
+        return ret;
     }
-    BaseType_t xRet = xTaskCreate(uart_event_task, "uart_event_task", 4096, NULL, 10, &uart_task_handle);
+    BaseType_t xRet = xTaskCreate(uart_tx_task, "uart_tx_task", 3072, NULL, 10, &s_tx_task_handle);
     if (xRet != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create uart_event_task");
+        ESP_LOGE(TAG, "Failed to create uart_tx_task");
         return ESP_FAIL;
     }
     init_clear_data_mutex();
+    // 在后台与 MCU 协商更高的波特率，协商期间照常收发
+    ret = uart_baud_start();
+    if (ret != ESP_OK && ret != ESP_ERR_NOT_SUPPORTED) {
+        ESP_LOGW(TAG, "uart_baud_start failed: %d", ret);
+    }
     ESP_LOGI(TAG, "UART communication initialized successfully");
     return ESP_OK;
 }
@@ -487,24 +585,7 @@ esp_err_t uart_comm_register_callback(uart_packet_callback_t callback)
     return ESP_OK;
 }
 
-/* ----------------- 新增：用于断电通知的应答函数 ----------------- */
-esp_err_t uart_comm_send_power_off_ack(bool success)
+void uart_comm_set_verbose(bool verbose)
 {
-    uart_packet_t pkt;
-    memset(&pkt, 0, sizeof(pkt));
-
-    pkt.header[0] = 0xAA;
-    pkt.header[1] = 0x55;
-    pkt.command   = CMD_WIFI_RESPONSE;  // 0x02
-
-    pkt.data[0] = success ? 0x00 : 0x02;   // 执行结果
-    pkt.data[1] = 0x04;                    // 协议版本字段，按断电通知协议要求设置为 0x04
-    pkt.data[2] = 0x00;
-    pkt.data[3] = 0x00;
-    pkt.data[4] = 0x00;
-    pkt.data[5] = 0x00;
-    pkt.checksum = uart_comm_calc_checksum((uint8_t*)&pkt, sizeof(pkt) - 1);
-
-    ESP_LOGI(TAG, "Sending Power Off ACK: success=%d", success);
-    return uart_comm_send_packet(&pkt);
+    s_log_verbose = verbose;
 }
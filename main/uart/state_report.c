@@ -1,51 +1,77 @@
 #include "state_report.h"
 #include "esp_log.h"
+#include "uart_parse.h"
 #include <string.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/semphr.h"
+#include "freertos/timers.h"
 #include "cc_hal_sys.h"
 #include "get_time.h"
+#include "gs_mqtt.h"
+#include "cbor_writer.h"
+#include "power_fail.h"
+#include "tunables.h"
+#include "crash_dump.h"
+#include "uplink_id.h"
 
 static const char *TAG = "state_report";
 
 /* 重传参数定义 */
 #define STATE_REPORT_TIMEOUT_MS         100    // 超时时间100ms
 #define STATE_REPORT_MAX_RETRIES        3      // 最大重传次数
-#define STATE_REPORT_RETX_TASK_DELAY_MS 50     // 重传任务周期50ms
+#define STATE_REPORT_OFFLINE_CHECK_MS   500    // 未联网时检查联网状态的周期
+#define STATE_REPORT_RING_SIZE          16     // 待确认上报的最大条数，满时丢弃最旧的
 
-/* 待重传状态上报项结构体 */
-typedef struct state_report_item {
+/* 重传超时可远程调整 */
+static tunable_t s_timeout_ms = TUNABLE_INT_INIT("state_report.timeout_ms", STATE_REPORT_TIMEOUT_MS, 20, 2000);
+
+/* 待确认状态上报项 */
+typedef struct {
+    uint32_t seq;               // 本地序号，非 0 表示占用
     uint16_t state_type;
     uint32_t state_value;
-    uint32_t last_sent_time;    // 上次发送时间（毫秒）
+    uint32_t last_sent_time;    // 上次发送时间（毫秒），0 表示尚未发送
     uint8_t retry_count;        // 已重传次数
-    struct state_report_item *next;
 } state_report_item_t;
 
-/* 全局变量：待重传状态上报项链表、互斥信号量及重传任务句柄 */
-static state_report_item_t *s_pending_list = NULL;
+/* 全局变量：预分配的待确认环、互斥信号量及重传定时器；待确认环随崩溃转储保存 */
+static CRASH_DUMP_ATTR state_report_item_t s_pending[STATE_REPORT_RING_SIZE];
+static CRASH_DUMP_ATTR uint8_t s_pending_head = 0;      // 最旧一项的位置
+static CRASH_DUMP_ATTR uint8_t s_pending_count = 0;     // head 起占用的跨度（中间可能有已确认的空洞）
+static CRASH_DUMP_ATTR uint32_t s_next_seq = 1;
 static SemaphoreHandle_t s_state_report_mutex = NULL;
-static TaskHandle_t s_state_report_task_handle = NULL;
+static TimerHandle_t s_retx_timer = NULL;
+
+/* MQTT 批量上报参数：攒够条数或距第一条超过时间即发送一次 */
+#define STATE_REPORT_BATCH_MAX          32
+#define STATE_REPORT_BATCH_MS           5000
+#define STATE_REPORT_BATCH_TOPIC        "/event/state/batch"
+// CBOR 编码：每条最多 1+3+5+5+5+9 字节，外加数组头与基准时间
+#define STATE_REPORT_BATCH_BUF_SIZE     (8 + STATE_REPORT_BATCH_MAX * 28)
+
+typedef struct {
+    uint16_t state_type;
+    uint32_t state_value;
+    uint32_t timestamp;         // UTC 秒
+    uplink_id_t id;             // 幂等键，断电保存后补发时沿用
+} state_report_sample_t;
 
-/* 内部函数声明：重传任务 */
-static void state_report_retx_task(void *param);
+static state_report_sample_t s_batch[STATE_REPORT_BATCH_MAX];
+static uint8_t s_batch_count = 0;
+static portMUX_TYPE s_batch_lock = portMUX_INITIALIZER_UNLOCKED;
+static TimerHandle_t s_batch_timer = NULL;
+static void state_report_batch_timer_cb(TimerHandle_t timer);
+#if CONFIG_POWER_FAIL
+static power_fail_hook_t s_power_fail_hook;
+#endif
 
 /* 内部函数：根据状态类型和状态值构造数据包 */
 static void create_state_report_packet(uart_packet_t *packet, uint16_t state_type, uint32_t state_value) {
-    memset(packet, 0, sizeof(uart_packet_t));
-    packet->header[0] = 0xAA;
-    packet->header[1] = 0x55;
-    packet->command = CMD_STATE_REPORT;
-    /* 按小端序填入状态类型 */
-    packet->data[0] = (uint8_t)(state_type & 0xFF);
-    packet->data[1] = (uint8_t)((state_type >> 8) & 0xFF);
-    /* 按小端序填入状态值 */
-    packet->data[2] = (uint8_t)(state_value & 0xFF);
-    packet->data[3] = (uint8_t)((state_value >> 8) & 0xFF);
-    packet->data[4] = (uint8_t)((state_value >> 16) & 0xFF);
-    packet->data[5] = (uint8_t)((state_value >> 24) & 0xFF);
-    packet->checksum = uart_comm_calc_checksum((uint8_t *)packet, sizeof(uart_packet_t) - 1);
+    uint8_t data[6];
+    uart_put_le16(data, state_type);
+    uart_put_le32(data + 2, state_value);
+    uart_packet_build(packet, CMD_STATE_REPORT, data);
 }
 
 /* 内部函数：判断模块是否已联网（此处采用 get_time_get_utc() 不为0作为联网标志） */
@@ -53,57 +79,86 @@ static bool is_connected(void) {
     return (get_time_get_utc() != 0);
 }
 
-/* 内部函数：将状态上报项加入待重传链表 */
-static void add_pending_item(uint16_t state_type, uint32_t state_value) {
-    state_report_item_t *item = pvPortMalloc(sizeof(state_report_item_t));
-    if (item == NULL) {
-        ESP_LOGE(TAG, "Failed to allocate memory for state report item");
-        return;
+/* 内部函数：跳过环头部已确认的空洞，需持有互斥锁 */
+static void compact_pending_locked(void) {
+    while (s_pending_count && s_pending[s_pending_head].seq == 0) {
+        s_pending_head = (s_pending_head + 1) % STATE_REPORT_RING_SIZE;
+        s_pending_count--;
+    }
+}
+
+/* 内部函数：将状态上报项加入待确认环，返回序号 */
+static uint32_t add_pending_item(uint16_t state_type, uint32_t state_value) {
+    xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
+    compact_pending_locked();
+    if (s_pending_count == STATE_REPORT_RING_SIZE) {
+        state_report_item_t *oldest = &s_pending[s_pending_head];
+        ESP_LOGW(TAG, "Pending ring full, drop oldest report #%u: type=0x%04X", (unsigned)oldest->seq, oldest->state_type);
+        oldest->seq = 0;
+        compact_pending_locked();
+    }
+    state_report_item_t *item = &s_pending[(s_pending_head + s_pending_count) % STATE_REPORT_RING_SIZE];
+    item->seq = s_next_seq++;
+    if (s_next_seq == 0) {
+        s_next_seq = 1;
     }
     item->state_type = state_type;
     item->state_value = state_value;
     item->retry_count = 0;
-    item->last_sent_time = cc_hal_sys_get_ms();
-    item->next = NULL;
+    item->last_sent_time = 0;
+    s_pending_count++;
+    uint32_t seq = item->seq;
+    xSemaphoreGive(s_state_report_mutex);
+    return seq;
+}
 
+/* 内部函数：按 ACK 匹配并移除待确认项。
+   ACK 的 data[0-1] 回带状态类型时匹配该类型最早的一项，为 0（旧版 MCU）时确认最早的一项 */
+static void ack_pending_item(uint16_t ack_type) {
     xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
-    if (s_pending_list == NULL) {
-        s_pending_list = item;
-    } else {
-        state_report_item_t *cur = s_pending_list;
-        while (cur->next != NULL) {
-            cur = cur->next;
+    for (uint8_t i = 0; i < s_pending_count; i++) {
+        state_report_item_t *item = &s_pending[(s_pending_head + i) % STATE_REPORT_RING_SIZE];
+        if (item->seq == 0 || (ack_type != 0 && item->state_type != ack_type)) {
+            continue;
         }
-        cur->next = item;
+        ESP_LOGD(TAG, "State report #%u acknowledged: type=0x%04X, value=%u",
+                 (unsigned)item->seq, item->state_type, item->state_value);
+        item->seq = 0;
+        break;
     }
+    compact_pending_locked();
     xSemaphoreGive(s_state_report_mutex);
 }
 
-/* 内部函数：从待重传链表中移除第一个项（认为该项已收到ACK） */
-static void remove_first_pending_item(void) {
-    xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
-    if (s_pending_list != NULL) {
-        state_report_item_t *temp = s_pending_list;
-        s_pending_list = s_pending_list->next;
-        ESP_LOGI(TAG, "State report acknowledged, removed item: type=0x%04X, value=%u", temp->state_type, temp->state_value);
-        vPortFree(temp);
-    }
-    xSemaphoreGive(s_state_report_mutex);
+/* 外部接口：当收到状态上报ACK时调用，移除对应的待确认项 */
+uint8_t state_report_ack_handler(const uart_packet_t *packet) {
+    ack_pending_item(uart_get_le16(packet->data));
+    return UART_CMD_OK;
 }
 
-/* 外部接口：当收到状态上报ACK时调用，移除待重传项 */
-void state_report_ack_handler(void) {
-    ESP_LOGI(TAG, "Received state report ACK, processing pending list");
-    remove_first_pending_item();
+/* 内部函数：重新安排重传定时器，delay_ms 为 0 时停止；
+   新增上报时只在定时器空闲时启动（force=false），避免推迟已排定的更早到期点 */
+static void schedule_retx_timer(uint32_t delay_ms, bool force) {
+    if (!s_retx_timer) {
+        return;
+    }
+    if (!force && xTimerIsTimerActive(s_retx_timer)) {
+        return;
+    }
+    if (delay_ms == 0) {
+        xTimerStop(s_retx_timer, 0);
+        return;
+    }
+    xTimerChangePeriod(s_retx_timer, pdMS_TO_TICKS(delay_ms) ? pdMS_TO_TICKS(delay_ms) : 1, 0);
 }
 
 /* 主动上传状态接口：
    1. 将待上传项加入重传缓存链表；
    2. 若模块已联网，则立即发送；否则将缓存，待联网后由重传任务自动发送 */
 esp_err_t state_report_upload(uint16_t state_type, uint32_t state_value) {
-    ESP_LOGI(TAG, "Request to upload state: type=0x%04X, value=%u", state_type, state_value);
+    ESP_LOGD(TAG, "Request to upload state: type=0x%04X, value=%u", state_type, state_value);
 
-    add_pending_item(state_type, state_value);
+    uint32_t seq = add_pending_item(state_type, state_value);
 
     if (is_connected()) {
         uart_packet_t report_packet;
@@ -111,11 +166,24 @@ esp_err_t state_report_upload(uint16_t state_type, uint32_t state_value) {
         esp_err_t ret = uart_comm_send_packet(&report_packet);
         if (ret != ESP_OK) {
             ESP_LOGE(TAG, "Failed to send state report packet");
+            schedule_retx_timer(tunable_get(&s_timeout_ms), false);
             return ret;
         }
-        ESP_LOGI(TAG, "State report packet sent immediately");
+        xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
+        for (uint8_t i = 0; i < s_pending_count; i++) {
+            state_report_item_t *item = &s_pending[(s_pending_head + i) % STATE_REPORT_RING_SIZE];
+            if (item->seq == seq) {
+                uint32_t now = cc_hal_sys_get_ms();
+                item->last_sent_time = now ? now : 1;
+                break;
+            }
+        }
+        xSemaphoreGive(s_state_report_mutex);
+        ESP_LOGD(TAG, "State report #%u sent immediately", (unsigned)seq);
+        schedule_retx_timer(tunable_get(&s_timeout_ms), false);
     } else {
-        ESP_LOGW(TAG, "Not connected, state report cached for later transmission");
+        ESP_LOGW(TAG, "Not connected, state report #%u cached for later transmission", (unsigned)seq);
+        schedule_retx_timer(STATE_REPORT_OFFLINE_CHECK_MS, false);
     }
 
     /* TODO: 此处可以调用 MQTT 上报接口，将状态数据同时上传到云端 */
@@ -124,112 +192,214 @@ esp_err_t state_report_upload(uint16_t state_type, uint32_t state_value) {
     return ESP_OK;
 }
 
-/* 发送状态上报应答（用于MCU上报状态时，WiFi回复应答） */
-esp_err_t state_report_send_ack(void) {
-    uart_packet_t ack_packet = {0};
-    ack_packet.header[0] = 0xAA;
-    ack_packet.header[1] = 0x55;
-    ack_packet.command   = CMD_STATE_REPORT_ACK;
-    memset(ack_packet.data, 0, sizeof(ack_packet.data));
-    ack_packet.checksum  = uart_comm_calc_checksum((uint8_t *)&ack_packet, sizeof(uart_packet_t) - 1);
+/* 处理接收到的MCU上报状态数据包 */
+uint8_t state_report_handle_uart_packet(const uart_packet_t *packet) {
+    uint16_t state_type = uart_get_le16(packet->data);
+    uint32_t state_value = uart_get_le32(packet->data + 2);
+    ESP_LOGD(TAG, "Received state report from MCU: type=0x%04X, value=%u", state_type, state_value);
 
-    ESP_LOGI(TAG, "Sending state report ACK");
-    return uart_comm_send_packet(&ack_packet);
+    // 攒批后经 MQTT 上报云端
+    state_report_mqtt_upload(state_type, state_value);
+    return UART_CMD_OK;
 }
 
-/* 处理接收到的MCU上报状态数据包 */
-esp_err_t state_report_handle_uart_packet(const uart_packet_t *packet) {
-    if (!packet) {
-        ESP_LOGE(TAG, "Invalid packet pointer in state_report_handle_uart_packet");
-        return ESP_ERR_INVALID_ARG;
+/* 重传定时器回调：只在有待确认项时运行，发送到期项后按最早的下一个到期点重新定时 */
+static void state_report_retx_timer_cb(TimerHandle_t timer) {
+    if (!is_connected()) {
+        xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
+        bool pending = s_pending_count != 0;
+        xSemaphoreGive(s_state_report_mutex);
+        schedule_retx_timer(pending ? STATE_REPORT_OFFLINE_CHECK_MS : 0, true);
+        return;
     }
 
-    uint16_t state_type = packet->data[0] | (packet->data[1] << 8);
-    uint32_t state_value = packet->data[2] |
-                           (packet->data[3] << 8) |
-                           (packet->data[4] << 16) |
-                           (packet->data[5] << 24);
-    ESP_LOGI(TAG, "Received state report from MCU: type=0x%04X, value=%u", state_type, state_value);
-
-    // 根据实际需求进行处理，例如更新状态、记录日志等
-    // 此处仅记录日志，实际应用中可扩展更多业务逻辑
-
-    // 发送应答给MCU
-    return state_report_send_ack();
-}
-
-/* 重传任务：周期性检查待重传链表，如果联网且超时未ACK则重传 */
-static void state_report_retx_task(void *param) {
-    while (1) {
-        vTaskDelay(pdMS_TO_TICKS(STATE_REPORT_RETX_TASK_DELAY_MS));
+    uint32_t now = cc_hal_sys_get_ms();
+    uint32_t timeout_ms = tunable_get(&s_timeout_ms);
+    uint32_t next_delay = 0;
 
-        if (!is_connected()) {
+    xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
+    for (uint8_t i = 0; i < s_pending_count; i++) {
+        state_report_item_t *item = &s_pending[(s_pending_head + i) % STATE_REPORT_RING_SIZE];
+        if (item->seq == 0) {
             continue;
         }
-
-        uint32_t now = cc_hal_sys_get_ms();
-
-        xSemaphoreTake(s_state_report_mutex, portMAX_DELAY);
-        state_report_item_t *cur = s_pending_list;
-        while (cur != NULL) {
-            if ((now - cur->last_sent_time) >= STATE_REPORT_TIMEOUT_MS) {
-                if (cur->retry_count < STATE_REPORT_MAX_RETRIES) {
-                    uart_packet_t report_packet;
-                    create_state_report_packet(&report_packet, cur->state_type, cur->state_value);
-                    esp_err_t ret = uart_comm_send_packet(&report_packet);
-                    if (ret == ESP_OK) {
-                        cur->last_sent_time = now;
-                        cur->retry_count++;
-                        ESP_LOGI(TAG, "Retransmitted state report: type=0x%04X, value=%u, retry=%u",
-                                 cur->state_type, cur->state_value, cur->retry_count);
-                    } else {
-                        ESP_LOGE(TAG, "Retransmission failed for state report: type=0x%04X, value=%u",
-                                 cur->state_type, cur->state_value);
-                    }
-                } else {
-                    ESP_LOGW(TAG, "Max retries reached for state report: type=0x%04X, value=%u, dropping message",
-                             cur->state_type, cur->state_value);
-                    break; // 跳出循环，后续统一清除已超时项
-                }
+        uint32_t elapsed = now - item->last_sent_time;
+        if (item->last_sent_time != 0 && elapsed < timeout_ms) {
+            uint32_t remain = timeout_ms - elapsed;
+            if (next_delay == 0 || remain < next_delay) {
+                next_delay = remain;
+            }
+            continue;
+        }
+        if (item->last_sent_time != 0 && item->retry_count >= STATE_REPORT_MAX_RETRIES) {
+            ESP_LOGW(TAG, "Dropping state report #%u after max retries: type=0x%04X, value=%u",
+                     (unsigned)item->seq, item->state_type, item->state_value);
+            item->seq = 0;
+            continue;
+        }
+        uart_packet_t report_packet;
+        create_state_report_packet(&report_packet, item->state_type, item->state_value);
+        if (uart_comm_send_packet(&report_packet) == ESP_OK) {
+            if (item->last_sent_time != 0) {
+                item->retry_count++;
+                ESP_LOGI(TAG, "Retransmitted state report #%u: type=0x%04X, value=%u, retry=%u",
+                         (unsigned)item->seq, item->state_type, item->state_value, item->retry_count);
             }
-            cur = cur->next;
+            item->last_sent_time = now ? now : 1;
+        } else {
+            ESP_LOGE(TAG, "Retransmission failed for state report #%u", (unsigned)item->seq);
         }
-        /* 清除链表中超出最大重传次数的项 */
-        while (s_pending_list && s_pending_list->retry_count >= STATE_REPORT_MAX_RETRIES) {
-            state_report_item_t *temp = s_pending_list;
-            s_pending_list = s_pending_list->next;
-            ESP_LOGW(TAG, "Dropping state report after max retries: type=0x%04X, value=%u",
-                     temp->state_type, temp->state_value);
-            vPortFree(temp);
+        if (next_delay == 0 || timeout_ms < next_delay) {
+            next_delay = timeout_ms;
         }
-        xSemaphoreGive(s_state_report_mutex);
     }
+    compact_pending_locked();
+    xSemaphoreGive(s_state_report_mutex);
+    schedule_retx_timer(next_delay, true);
 }
 
-/* 初始化状态上报模块：创建互斥锁及启动重传任务 */
+/* 初始化状态上报模块：创建互斥锁、重传定时器及批量上报定时器 */
 esp_err_t state_report_init(void) {
+    tunables_register(&s_timeout_ms);
     s_state_report_mutex = xSemaphoreCreateMutex();
     if (s_state_report_mutex == NULL) {
         ESP_LOGE(TAG, "Failed to create state report mutex");
         return ESP_FAIL;
     }
-    BaseType_t ret = xTaskCreate(state_report_retx_task, "state_report_retx_task", 2048, NULL, 10, &s_state_report_task_handle);
-    if (ret != pdPASS) {
-        ESP_LOGE(TAG, "Failed to create state report retransmission task");
+    s_retx_timer = xTimerCreate("state_report_retx", pdMS_TO_TICKS(tunable_get(&s_timeout_ms)), pdFALSE,
+                                NULL, state_report_retx_timer_cb);
+    if (s_retx_timer == NULL) {
+        ESP_LOGE(TAG, "Failed to create state report retransmission timer");
+        return ESP_FAIL;
+    }
+    s_batch_timer = xTimerCreate("state_batch", pdMS_TO_TICKS(STATE_REPORT_BATCH_MS), pdFALSE,
+                                 NULL, state_report_batch_timer_cb);
+    if (s_batch_timer == NULL) {
+        ESP_LOGE(TAG, "Failed to create state batch timer");
         return ESP_FAIL;
     }
+#if CONFIG_POWER_FAIL
+    power_fail_register(&s_power_fail_hook);
+#endif
     ESP_LOGI(TAG, "State report module initialized");
     return ESP_OK;
 }
 
+/* 批量数据编码为 CBOR 数组：[t0, [type, value, dt, epoch, seq], ...]，dt 为相对 t0 的秒数。
+ * t0 取批次中最早的时间戳：断电恢复的旧样本、对时后时钟回拨都可能让后加入的样本更早，dt 始终非负 */
+static size_t encode_batch(const state_report_sample_t *samples, uint8_t count, uint8_t *buf, size_t size) {
+    cbor_writer_t w;
+    cbor_writer_init(&w, buf, size);
+    cbor_writer_array(&w, count + 1);
+    uint32_t t0 = count ? samples[0].timestamp : 0;
+    for (uint8_t i = 1; i < count; i++) {
+        if (samples[i].timestamp < t0) {
+            t0 = samples[i].timestamp;
+        }
+    }
+    cbor_writer_uint(&w, t0);
+    for (uint8_t i = 0; i < count; i++) {
+        cbor_writer_array(&w, 5);
+        cbor_writer_uint(&w, samples[i].state_type);
+        cbor_writer_uint(&w, samples[i].state_value);
+        cbor_writer_uint(&w, samples[i].timestamp - t0);
+        cbor_writer_uint(&w, samples[i].id.epoch);
+        cbor_writer_uint64(&w, samples[i].id.seq);
+    }
+    return cbor_writer_finish(&w);
+}
+
+/* 发送当前批次，可在定时器回调或上报接口中调用 */
+static void state_report_batch_flush(void) {
+    state_report_sample_t samples[STATE_REPORT_BATCH_MAX];
+    portENTER_CRITICAL(&s_batch_lock);
+    uint8_t count = s_batch_count;
+    memcpy(samples, s_batch, count * sizeof(state_report_sample_t));
+    s_batch_count = 0;
+    portEXIT_CRITICAL(&s_batch_lock);
+    if (count == 0) {
+        return;
+    }
+
+    uint8_t payload[STATE_REPORT_BATCH_BUF_SIZE];
+    size_t len = encode_batch(samples, count, payload, sizeof(payload));
+    cc_err_t err = gs_mqtt_publish(STATE_REPORT_BATCH_TOPIC, payload, (uint16_t)len, GS_MQTT_QOS0, 0);
+    ESP_LOGI(TAG, "State batch published: %u samples, %u bytes, err=%d", count, len, err);
+}
+
+static void state_report_batch_timer_cb(TimerHandle_t timer) {
+    state_report_batch_flush();
+}
+
+/* 加入批次，timestamp 为 UTC 秒 */
+static esp_err_t state_report_batch_add(uint16_t state_type, uint32_t state_value, uint32_t timestamp, uplink_id_t id)
+{
+    if (!s_batch_timer) {
+        return ESP_ERR_INVALID_STATE;
+    }
+
+    bool full = false;
+    bool first = false;
+    portENTER_CRITICAL(&s_batch_lock);
+    if (s_batch_count < STATE_REPORT_BATCH_MAX) {
+        state_report_sample_t *sample = &s_batch[s_batch_count++];
+        sample->state_type = state_type;
+        sample->state_value = state_value;
+        sample->timestamp = timestamp;
+        sample->id = id;
+        first = (s_batch_count == 1);
+        full = (s_batch_count == STATE_REPORT_BATCH_MAX);
+    }
+    portEXIT_CRITICAL(&s_batch_lock);
+
+    if (full) {
+        xTimerStop(s_batch_timer, 0);
+        state_report_batch_flush();
+    } else if (first) {
+        xTimerReset(s_batch_timer, 0);
+    }
+    return ESP_OK;
+}
+
 /**
- * @brief 通过MQTT上报状态数据接口（接口函数，未实际实现上报逻辑）
- *
- * TODO: 在实际应用中，请完善该函数，调用相应的MQTT模块接口上报数据
+ * @brief 通过MQTT上报状态数据：先攒批，条数或时间达到阈值时以 CBOR 合并为一次发布
  */
 esp_err_t state_report_mqtt_upload(uint16_t state_type, uint32_t state_value)
 {
-    ESP_LOGI(TAG, "TODO: Implement MQTT upload for state: type=0x%04X, value=%u", state_type, state_value);
-    // 此处返回ESP_OK，仅作占位，后续实现时请调用MQTT上报接口
-    return ESP_OK;
+    return state_report_batch_add(state_type, state_value, get_time_get_utc(), uplink_id_next());
 }
+
+#if CONFIG_POWER_FAIL
+/* 断电前保存尚未发布的批次 */
+static void state_report_power_fail_save(void)
+{
+    state_report_sample_t samples[STATE_REPORT_BATCH_MAX];
+    portENTER_CRITICAL(&s_batch_lock);
+    uint8_t count = s_batch_count;
+    memcpy(samples, s_batch, count * sizeof(state_report_sample_t));
+    portEXIT_CRITICAL(&s_batch_lock);
+    if (count) {
+        power_fail_write(NULL, 0, samples, count * sizeof(state_report_sample_t));
+    }
+}
+
+/* 启动时放回批次，保留原来的时间戳和幂等键 */
+static void state_report_power_fail_restore(const uint8_t *data, size_t len)
+{
+    if (len % sizeof(state_report_sample_t)) {
+        ESP_LOGW(TAG, "Power-fail record of %u bytes does not match sample layout, dropped", (unsigned)len);
+        return;
+    }
+    for (size_t off = 0; off + sizeof(state_report_sample_t) <= len; off += sizeof(state_report_sample_t)) {
+        state_report_sample_t sample;
+        memcpy(&sample, data + off, sizeof(sample));
+        state_report_batch_add(sample.state_type, sample.state_value, sample.timestamp, sample.id);
+    }
+}
+
+static power_fail_hook_t s_power_fail_hook = {
+    .id = POWER_FAIL_ID_STATE,
+    .save = state_report_power_fail_save,
+    .restore = state_report_power_fail_restore,
+};
+#endif
@@ -0,0 +1,275 @@
+/**
+ * @file uart_baud.c
+ * @brief 波特率协商：提议、测试图案回显、确认，校验错误过多时回退
+ */
+
+#include "uart_baud.h"
+#include "sdkconfig.h"
+
+#if CONFIG_UART_BAUD_NEGOTIATE
+
+#include <string.h>
+#include <stdbool.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "cc_hal_kvs.h"
+#include "uart_config.h"
+#include "uart_ext.h"
+
+static const char *TAG = "uart_baud";
+
+/* -------------------- 配置宏 -------------------- */
+
+#define UART_BAUD_KVS_KEY           "uart_baud"
+#define UART_BAUD_REPLY_MS          200     // 等待 MCU 应答的时间
+#define UART_BAUD_TRIES             3       // 每一步的发送次数
+#define UART_BAUD_SETTLE_MS         20      // MCU 发完 PROPOSE 应答后切换所需的时间
+#define UART_BAUD_ERR_MAX           8
+#define UART_BAUD_ERR_WINDOW_MS     10000
+#define UART_BAUD_STABLE_MS         60000   // 切换后这么久以内出错，视为这一档不稳定
+#define UART_BAUD_RETRY_MS          60000
+#define UART_BAUD_TASK_STACK        3072
+#define UART_BAUD_TASK_PRIO         5
+
+// 从高到低逐档提议，高于 CONFIG_UART_BAUD_MAX 的跳过
+static const uint32_t s_rates[] = {921600, 460800, 230400, 115200};
+
+// 0/1 交替、全 0/全 1 和单个位，覆盖采样点偏移最容易出错的情形；长度与控制帧头合计 16 字节，
+// 不超过 MCU 可声明的最小负载
+static const uint8_t s_pattern[] = {0x55, 0xAA, 0x00, 0xFF, 0x0F, 0xF0, 0x33, 0xCC, 0x01, 0x80, 0x7E};
+
+#define UART_BAUD_PAYLOAD_MAX       (5 + sizeof(s_pattern))
+
+/* -------------------- 状态 -------------------- */
+
+static TaskHandle_t s_task = NULL;
+static SemaphoreHandle_t s_reply_sem = NULL;
+static volatile uint8_t s_wait_op = 0;          // 正在等待应答的 op，0 表示不在等待
+static uint8_t s_reply[UART_BAUD_PAYLOAD_MAX];
+static uint16_t s_reply_len = 0;
+static volatile bool s_switching = false;       // 切换期间的乱码不计入错误
+static uint32_t s_err_cnt = 0;
+static TickType_t s_err_start = 0;
+static TickType_t s_switch_tick = 0;
+static uint32_t s_cap = CONFIG_UART_BAUD_MAX;   // 本次运行可提议的最高一档
+
+static inline void put_le32(uint8_t *p, uint32_t v)
+{
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static inline uint32_t get_le32(const uint8_t *p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+void uart_baud_on_frame(uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    if (!s_reply_sem || !(flags & UART_EXT_FLAG_REPLY) || len < 5 || payload[0] != s_wait_op) {
+        return;
+    }
+    s_reply_len = len < sizeof(s_reply) ? len : sizeof(s_reply);
+    memcpy(s_reply, payload, s_reply_len);
+    s_wait_op = 0;
+    xSemaphoreGive(s_reply_sem);
+}
+
+void uart_baud_link_error(void)
+{
+    // 只在接收任务中调用，计数没有并发写者
+    if (!s_task || s_switching || uart_config_get_baud() == UART_BAUD_BASE) {
+        return;
+    }
+    TickType_t now = xTaskGetTickCount();
+    if (s_err_cnt == 0 || now - s_err_start > pdMS_TO_TICKS(UART_BAUD_ERR_WINDOW_MS)) {
+        s_err_start = now;
+        s_err_cnt = 0;
+    }
+    if (++s_err_cnt == UART_BAUD_ERR_MAX) {
+        xTaskNotifyGive(s_task);
+    }
+}
+
+// 发送一步并等待应答；TEST 的应答须原样带回测试图案
+static bool baud_exchange(uint8_t op, uint32_t baud, uint32_t *reply)
+{
+    uint8_t payload[UART_BAUD_PAYLOAD_MAX];
+    uint16_t len = 5;
+    payload[0] = op;
+    put_le32(payload + 1, baud);
+    if (op == UART_BAUD_OP_TEST) {
+        memcpy(payload + 5, s_pattern, sizeof(s_pattern));
+        len += sizeof(s_pattern);
+    }
+    for (int i = 0; i < UART_BAUD_TRIES; i++) {
+        xSemaphoreTake(s_reply_sem, 0);
+        s_wait_op = op;
+        if (uart_ext_send_ctrl(UART_EXT_CMD_BAUD, 0, payload, len) != ESP_OK) {
+            break;
+        }
+        if (xSemaphoreTake(s_reply_sem, pdMS_TO_TICKS(UART_BAUD_REPLY_MS)) != pdTRUE) {
+            continue;
+        }
+        if (s_reply_len == len && memcmp(s_reply + 5, payload + 5, len - 5) == 0) {
+            *reply = get_le32(s_reply + 1);
+            return true;
+        }
+        ESP_LOGW(TAG, "Bad reply to op 0x%02X at %lu baud", op, (unsigned long)baud);
+    }
+    s_wait_op = 0;
+    return false;
+}
+
+static void baud_switch(uint32_t baud)
+{
+    s_switching = true;
+    uart_config_set_baud(baud, UART_BAUD_REPLY_MS);
+    s_err_cnt = 0;
+    s_switch_tick = xTaskGetTickCount();
+    s_switching = false;
+}
+
+static void baud_persist(uint32_t baud)
+{
+    uint32_t saved = 0;
+    size_t len = sizeof(saved);
+    if (cc_hal_kvs_get(UART_BAUD_KVS_KEY, &saved, &len) == CC_OK && len == sizeof(saved) && saved == baud) {
+        return;
+    }
+    cc_hal_kvs_set(UART_BAUD_KVS_KEY, &baud, sizeof(baud));
+}
+
+/**
+ * @return ESP_ERR_TIMEOUT MCU 不应答 PROPOSE（不认识 BAUD 帧）；ESP_ERR_NOT_SUPPORTED MCU 拒绝；ESP_FAIL 测试或确认失败
+ */
+static esp_err_t baud_try(uint32_t baud)
+{
+    uint32_t accepted = 0;
+    if (!baud_exchange(UART_BAUD_OP_PROPOSE, baud, &accepted)) {
+        return ESP_ERR_TIMEOUT;
+    }
+    if (accepted != baud) {
+        ESP_LOGI(TAG, "MCU declined %lu baud", (unsigned long)baud);
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+    uint32_t old = uart_config_get_baud();
+    vTaskDelay(pdMS_TO_TICKS(UART_BAUD_SETTLE_MS));
+    baud_switch(baud);
+    if (uart_config_get_baud() == baud
+            && baud_exchange(UART_BAUD_OP_TEST, baud, &accepted)
+            && baud_exchange(UART_BAUD_OP_COMMIT, baud, &accepted)) {
+        return ESP_OK;
+    }
+    ESP_LOGW(TAG, "%lu baud test failed, back to %lu", (unsigned long)baud, (unsigned long)old);
+    baud_switch(old);
+    // 等 MCU 超时回退后再提议下一档
+    vTaskDelay(pdMS_TO_TICKS(UART_BAUD_MCU_REVERT_MS));
+    return ESP_FAIL;
+}
+
+/**
+ * @return ESP_ERR_INVALID_STATE MCU 尚未确认扩展帧，稍后再试；ESP_ERR_NOT_SUPPORTED 没有可用的更高波特率
+ */
+static esp_err_t baud_negotiate(void)
+{
+    if (!uart_ext_wait_ready()) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    uint32_t saved = 0;
+    size_t len = sizeof(saved);
+    if (cc_hal_kvs_get(UART_BAUD_KVS_KEY, &saved, &len) != CC_OK || len != sizeof(saved) || saved > s_cap) {
+        saved = 0;
+    }
+    esp_err_t ret = saved ? baud_try(saved) : ESP_FAIL;
+    if (ret == ESP_OK) {
+        ESP_LOGI(TAG, "Resumed %lu baud", (unsigned long)saved);
+        return ESP_OK;
+    }
+    for (size_t i = 0; i < sizeof(s_rates) / sizeof(s_rates[0]) && ret != ESP_ERR_TIMEOUT; i++) {
+        if (s_rates[i] > s_cap || s_rates[i] == saved) {
+            continue;
+        }
+        ret = baud_try(s_rates[i]);
+        if (ret == ESP_OK) {
+            baud_persist(s_rates[i]);
+            ESP_LOGI(TAG, "Negotiated %lu baud", (unsigned long)s_rates[i]);
+            return ESP_OK;
+        }
+    }
+    if (ret == ESP_ERR_TIMEOUT) {
+        ESP_LOGI(TAG, "MCU does not answer baud negotiation");
+    }
+    if (saved) {
+        baud_persist(0);
+    }
+    ESP_LOGI(TAG, "Keep %d baud", UART_BAUD_BASE);
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+static void baud_fallback(void)
+{
+    uint32_t failed = uart_config_get_baud();
+    if (failed == UART_BAUD_BASE) {
+        return;
+    }
+    // 切换后不久就出错说明这一档不稳定，本次运行只提议更低的；运行很久才出错多半是 MCU 复位，下次仍从这一档开始
+    if (xTaskGetTickCount() - s_switch_tick < pdMS_TO_TICKS(UART_BAUD_STABLE_MS)) {
+        s_cap = failed - 1;
+        baud_persist(0);
+    }
+    ESP_LOGW(TAG, "Too many checksum errors at %lu baud, back to %d", (unsigned long)failed, UART_BAUD_BASE);
+    baud_switch(UART_BAUD_BASE);
+}
+
+static void uart_baud_task(void *arg)
+{
+    bool retry = baud_negotiate() == ESP_ERR_INVALID_STATE;
+    while (1) {
+        TickType_t wait = retry ? pdMS_TO_TICKS(UART_BAUD_RETRY_MS) : portMAX_DELAY;
+        if (ulTaskNotifyTake(pdTRUE, wait)) {
+            baud_fallback();
+            retry = true;
+            continue;
+        }
+        retry = baud_negotiate() == ESP_ERR_INVALID_STATE;
+    }
+}
+
+esp_err_t uart_baud_start(void)
+{
+    if (s_task) {
+        return ESP_OK;
+    }
+    s_reply_sem = xSemaphoreCreateBinary();
+    if (!s_reply_sem) {
+        ESP_LOGE(TAG, "Failed to create uart_baud semaphore");
+        return ESP_ERR_NO_MEM;
+    }
+    if (xTaskCreate(uart_baud_task, "uart_baud", UART_BAUD_TASK_STACK, NULL, UART_BAUD_TASK_PRIO, &s_task) != pdPASS) {
+        ESP_LOGE(TAG, "Failed to create uart_baud task");
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+#else
+
+esp_err_t uart_baud_start(void)
+{
+    return ESP_ERR_NOT_SUPPORTED;
+}
+
+void uart_baud_on_frame(uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+}
+
+void uart_baud_link_error(void)
+{
+}
+
+#endif // CONFIG_UART_BAUD_NEGOTIATE
@@ -3,21 +3,30 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "esp_log.h"
+#include "sdkconfig.h"
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+#include "esp_sleep.h"
+#endif
 
 static const char *TAG = "uart_config";
 
 // UART事件队列句柄
 static QueueHandle_t uart_event_queue_handle = NULL;
+static uint32_t s_baud = UART_BAUD_BASE;
 
 esp_err_t uart_config_init(void)
 {
     // 配置 UART 参数
     uart_config_t uart_config = {
-        .baud_rate = 9600,  // 根据需求设置波特率
+        .baud_rate = UART_BAUD_BASE,    // 更高的波特率由 uart_baud 与 MCU 协商后切换
         .data_bits = UART_DATA_8_BITS,
         .parity    = UART_PARITY_DISABLE,
         .stop_bits = UART_STOP_BITS_1,
         .flow_ctrl = UART_HW_FLOWCTRL_DISABLE,
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+        // 动态调频时 APB 频率会变化，改用 XTAL 时钟保持波特率
+        .source_clk = UART_SCLK_XTAL,
+#endif
     };
 
     esp_err_t ret = uart_param_config(UART_NUM, &uart_config);
@@ -40,6 +49,18 @@ esp_err_t uart_config_init(void)
         return ret;
     }
 
+#if CONFIG_POWER_PROFILE_LIGHT_SLEEP
+    // light sleep 中由 RX 线上的边沿唤醒，唤醒所用的字节不会进入 FIFO
+    ret = uart_set_wakeup_threshold(UART_NUM, UART_WAKEUP_THRESHOLD);
+    if (ret == ESP_OK) {
+        ret = esp_sleep_enable_uart_wakeup(UART_NUM);
+    }
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "UART wakeup setup failed: %d", ret);
+        return ret;
+    }
+#endif
+
     ESP_LOGI(TAG, "UART configured successfully on port %d", UART_NUM);
     return ESP_OK;
 }
@@ -48,3 +69,27 @@ QueueHandle_t uart_config_get_queue(void)
 {
     return uart_event_queue_handle;
 }
+
+esp_err_t uart_config_set_baud(uint32_t baud, uint32_t timeout_ms)
+{
+    esp_err_t ret = uart_wait_tx_done(UART_NUM, pdMS_TO_TICKS(timeout_ms));
+    if (ret != ESP_OK) {
+        ESP_LOGW(TAG, "TX not drained, keep %lu baud", (unsigned long)s_baud);
+        return ret;
+    }
+    ret = uart_set_baudrate(UART_NUM, baud);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "uart_set_baudrate %lu failed: %d", (unsigned long)baud, ret);
+        return ret;
+    }
+    // 对端切换前后收到的字节按错误的波特率采样，不交给解析
+    uart_flush_input(UART_NUM);
+    s_baud = baud;
+    ESP_LOGI(TAG, "UART baud rate %lu", (unsigned long)baud);
+    return ESP_OK;
+}
+
+uint32_t uart_config_get_baud(void)
+{
+    return s_baud;
+}
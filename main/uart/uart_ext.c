@@ -0,0 +1,260 @@
+/**
+ * @file uart_ext.c
+ * @brief 变长扩展帧：协商、分帧、累计 ACK 与滑动窗口重传
+ */
+
+#include "uart_ext.h"
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "driver/uart.h"
+#include "uart_config.h"
+#include "checksum.h"
+#include "uart_baud.h"
+
+static const char *TAG = "uart_ext";
+
+/* -------------------- 配置宏 -------------------- */
+
+#define UART_EXT_VERSION            1
+#define UART_EXT_WINDOW             4       // 未确认帧上限
+#define UART_EXT_RETX_MS            200     // 等待 ACK 的超时，超时后从最早未确认帧重发
+#define UART_EXT_MAX_RETRIES        5
+#define UART_EXT_HELLO_WAIT_MS      200
+#define UART_EXT_DUP_RANGE          16      // 落后期望 seq 这么多以内的帧视为重复帧
+
+/* -------------------- 状态 -------------------- */
+
+static SemaphoreHandle_t s_send_lock = NULL;    // 同一时间只有一个发送者
+static SemaphoreHandle_t s_ack_sem = NULL;      // 收到 ACK / HELLO 时释放
+static volatile bool s_ready = false;
+static uint8_t s_window = UART_EXT_WINDOW;
+static uint16_t s_max_payload = UART_EXT_MAX_PAYLOAD;
+static uint8_t s_tx_seq = 0;                    // 下一个待分配的 seq
+static volatile uint8_t s_tx_peer_next = 0;     // MCU 最近 ACK 的下一个期望 seq
+static uint8_t s_rx_expected = 0;
+static bool s_rx_synced = false;
+static uart_ext_callback_t s_callback = NULL;
+
+static esp_err_t ext_write(uint8_t cmd, uint8_t seq, uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    // 整帧一次写入，避免与发送任务中的旧格式包交错
+    uint8_t frame[UART_EXT_FRAME_MAX];
+    frame[0] = UART_EXT_HEADER0;
+    frame[1] = UART_EXT_HEADER1;
+    frame[2] = cmd;
+    frame[3] = seq;
+    frame[4] = flags;
+    frame[5] = (uint8_t)(len & 0xFF);
+    frame[6] = (uint8_t)(len >> 8);
+    if (len) {
+        memcpy(frame + UART_EXT_HEAD_SIZE, payload, len);
+    }
+    uint16_t crc = checksum_crc16(frame + 2, UART_EXT_HEAD_SIZE - 2 + len);
+    frame[UART_EXT_HEAD_SIZE + len] = (uint8_t)(crc & 0xFF);
+    frame[UART_EXT_HEAD_SIZE + len + 1] = (uint8_t)(crc >> 8);
+
+    int total = UART_EXT_HEAD_SIZE + len + 2;
+    if (uart_write_bytes(UART_NUM, (const char *)frame, total) != total) {
+        ESP_LOGE(TAG, "uart_write_bytes failed, cmd=0x%02X", cmd);
+        return ESP_FAIL;
+    }
+    return ESP_OK;
+}
+
+static void send_hello(uint8_t flags)
+{
+    uint8_t payload[4] = {
+        UART_EXT_VERSION, UART_EXT_WINDOW,
+        (uint8_t)(UART_EXT_MAX_PAYLOAD & 0xFF), (uint8_t)(UART_EXT_MAX_PAYLOAD >> 8),
+    };
+    ext_write(UART_EXT_CMD_HELLO, 0, flags, payload, sizeof(payload));
+}
+
+static void send_ack(void)
+{
+    uint8_t next = s_rx_expected;
+    ext_write(UART_EXT_CMD_ACK, 0, 0, &next, 1);
+}
+
+esp_err_t uart_ext_init(void)
+{
+    if (s_send_lock) {
+        return ESP_OK;
+    }
+    s_send_lock = xSemaphoreCreateMutex();
+    s_ack_sem = xSemaphoreCreateBinary();
+    if (!s_send_lock || !s_ack_sem) {
+        ESP_LOGE(TAG, "Failed to create uart_ext semaphores");
+        return ESP_ERR_NO_MEM;
+    }
+    send_hello(0);
+    return ESP_OK;
+}
+
+void uart_ext_register_callback(uart_ext_callback_t cb)
+{
+    s_callback = cb;
+}
+
+bool uart_ext_is_ready(void)
+{
+    return s_ready;
+}
+
+bool uart_ext_wait_ready(void)
+{
+    if (!s_ready && s_ack_sem) {
+        // MCU 可能比本模块晚启动，再问一次
+        send_hello(0);
+        xSemaphoreTake(s_ack_sem, pdMS_TO_TICKS(UART_EXT_HELLO_WAIT_MS));
+    }
+    return s_ready;
+}
+
+esp_err_t uart_ext_send_ctrl(uint8_t cmd, uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    if (cmd < UART_EXT_CMD_HELLO || len > UART_EXT_MAX_PAYLOAD || (!payload && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    return ext_write(cmd, 0, flags, payload, len);
+}
+
+esp_err_t uart_ext_send(uint8_t cmd, const uint8_t *data, size_t len, uint32_t timeout_ms)
+{
+    if (cmd >= UART_EXT_CMD_HELLO || (!data && len)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (!s_send_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    if (!uart_ext_wait_ready()) {
+        return ESP_ERR_NOT_SUPPORTED;
+    }
+
+    TickType_t start = xTaskGetTickCount();
+    if (xSemaphoreTake(s_send_lock, pdMS_TO_TICKS(timeout_ms)) != pdTRUE) {
+        return ESP_ERR_TIMEOUT;
+    }
+
+    size_t chunk = s_max_payload;
+    size_t frame_num = len ? (len + chunk - 1) / chunk : 1;
+    uint8_t base_seq = s_tx_seq;
+    size_t acked = 0;       // 已确认的帧数
+    size_t sent = 0;        // 已发出的帧数（重传时回退到 acked）
+    int retries = 0;
+    esp_err_t ret = ESP_OK;
+    xSemaphoreTake(s_ack_sem, 0);   // 清掉过期的通知
+
+    while (acked < frame_num) {
+        while (sent < frame_num && sent - acked < s_window) {
+            size_t off = sent * chunk;
+            uint16_t n = (uint16_t)((len - off < chunk) ? len - off : chunk);
+            uint8_t flags = 0;
+            if (sent == 0) {
+                flags |= UART_EXT_FLAG_FIRST;
+            }
+            if (sent + 1 == frame_num) {
+                flags |= UART_EXT_FLAG_LAST;
+            }
+            ext_write(cmd, (uint8_t)(base_seq + sent), flags, data + off, n);
+            sent++;
+        }
+
+        bool got = xSemaphoreTake(s_ack_sem, pdMS_TO_TICKS(UART_EXT_RETX_MS)) == pdTRUE;
+        uint8_t delta = (uint8_t)(s_tx_peer_next - (uint8_t)(base_seq + acked));
+        if (delta > 0 && delta <= sent - acked) {
+            acked += delta;
+            retries = 0;
+        } else if (!got) {
+            if (++retries > UART_EXT_MAX_RETRIES) {
+                ESP_LOGW(TAG, "No ACK after %d retries, %u/%u frames acked", UART_EXT_MAX_RETRIES, acked, frame_num);
+                ret = ESP_ERR_TIMEOUT;
+                break;
+            }
+            sent = acked;   // go-back-N
+        }
+        if (xTaskGetTickCount() - start > pdMS_TO_TICKS(timeout_ms)) {
+            ret = ESP_ERR_TIMEOUT;
+            break;
+        }
+    }
+    // 失败时接收方会在下一段的 FIRST 帧重新同步
+    s_tx_seq = (uint8_t)(base_seq + sent);
+    xSemaphoreGive(s_send_lock);
+    return ret;
+}
+
+static void handle_data_frame(uint8_t cmd, uint8_t seq, uint8_t flags, const uint8_t *payload, uint16_t len)
+{
+    if (seq != s_rx_expected) {
+        uint8_t behind = (uint8_t)(s_rx_expected - seq);
+        bool duplicate = s_rx_synced && behind >= 1 && behind <= UART_EXT_DUP_RANGE;
+        if (!(flags & UART_EXT_FLAG_FIRST) || duplicate) {
+            // 重复或乱序：丢弃，重发累计 ACK
+            send_ack();
+            return;
+        }
+        // 新一段数据的开始，重新同步
+        s_rx_expected = seq;
+    }
+    s_rx_synced = true;
+    s_rx_expected++;
+    send_ack();
+    if (s_callback) {
+        s_callback(cmd, flags, payload, len);
+    }
+}
+
+bool uart_ext_on_frame(const uint8_t *frame, size_t len)
+{
+    if (!s_ack_sem) {
+        return false;
+    }
+    uint16_t crc = checksum_crc16(frame + 2, len - 4);
+    uint16_t recv = frame[len - 2] | (frame[len - 1] << 8);
+    if (crc != recv) {
+        ESP_LOGE(TAG, "CRC mismatch: calc=0x%04X, recv=0x%04X", crc, recv);
+        uart_baud_link_error();
+        return false;
+    }
+    uint8_t cmd = frame[2];
+    uint8_t seq = frame[3];
+    uint8_t flags = frame[4];
+    uint16_t payload_len = frame[5] | (frame[6] << 8);
+    const uint8_t *payload = frame + UART_EXT_HEAD_SIZE;
+
+    switch (cmd) {
+    case UART_EXT_CMD_HELLO:
+        if (payload_len >= 4) {
+            uint8_t window = payload[1];
+            uint16_t max_payload = payload[2] | (payload[3] << 8);
+            s_window = (window && window < UART_EXT_WINDOW) ? window : UART_EXT_WINDOW;
+            s_max_payload = (max_payload >= 16 && max_payload < UART_EXT_MAX_PAYLOAD) ? max_payload : UART_EXT_MAX_PAYLOAD;
+            if (!s_ready) {
+                ESP_LOGI(TAG, "MCU supports ext frames v%u: window=%u, max_payload=%u", payload[0], s_window, s_max_payload);
+            }
+            s_ready = true;
+            if (!(flags & UART_EXT_FLAG_REPLY)) {
+                send_hello(UART_EXT_FLAG_REPLY);
+            }
+            xSemaphoreGive(s_ack_sem);
+        }
+        break;
+    case UART_EXT_CMD_ACK:
+        if (payload_len >= 1) {
+            s_tx_peer_next = payload[0];
+            xSemaphoreGive(s_ack_sem);
+        }
+        break;
+    case UART_EXT_CMD_BAUD:
+        uart_baud_on_frame(flags, payload, payload_len);
+        break;
+    default:
+        handle_data_frame(cmd, seq, flags, payload, payload_len);
+        break;
+    }
+    return true;
+}
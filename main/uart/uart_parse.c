@@ -0,0 +1,87 @@
+/**
+ * @file uart_parse.c
+ * @brief 串口接收数据分帧与定长包组包
+ */
+
+#include "uart_parse.h"
+#include <string.h>
+#include "uart_ext.h"
+#include "checksum.h"
+
+size_t uart_ext_frame_len(const uint8_t *buf, size_t avail)
+{
+    if (avail < UART_EXT_HEAD_SIZE) {
+        return 0;
+    }
+    if (buf[0] != UART_EXT_HEADER0 || buf[1] != UART_EXT_HEADER1) {
+        return SIZE_MAX;
+    }
+    size_t len = buf[5] | (buf[6] << 8);
+    if (len > UART_EXT_MAX_PAYLOAD) {
+        return SIZE_MAX;
+    }
+    size_t total = UART_EXT_HEAD_SIZE + len + 2;
+    return (avail >= total) ? total : 0;
+}
+
+/*
+ * 用 memchr 查找 0xAA 帧头，0xAA55 为旧格式定长包，0xAA56 为扩展变长帧（见 uart_ext.h）
+ */
+size_t uart_parse_packets(const uint8_t *buf, size_t len, const uart_parse_ops_t *ops)
+{
+    size_t pos = 0;
+    while (pos < len) {
+        const uint8_t *head = memchr(buf + pos, 0xAA, len - pos);
+        if (!head) {
+            return len;
+        }
+        pos = head - buf;
+        if (len - pos < 2) {
+            return pos;
+        }
+        if (head[1] == UART_EXT_HEADER1) {
+            size_t frame_len = uart_ext_frame_len(head, len - pos);
+            if (frame_len == 0) {
+                return pos;
+            }
+            if (frame_len == SIZE_MAX || !ops->on_ext_frame(head, frame_len)) {
+                pos++;
+                continue;
+            }
+            pos += frame_len;
+            continue;
+        }
+        if (head[1] != 0x55) {
+            pos++;
+            continue;
+        }
+        if (len - pos < sizeof(uart_packet_t)) {
+            return pos;
+        }
+        const uart_packet_t *packet = (const uart_packet_t *)head;
+        uint8_t calc = (uint8_t)checksum_sum8(head, sizeof(uart_packet_t) - 1);
+        if (calc != packet->checksum) {
+            if (ops->on_bad_checksum) {
+                ops->on_bad_checksum(calc, packet->checksum);
+            }
+            pos++;
+            continue;
+        }
+        ops->on_packet(packet);
+        pos += sizeof(uart_packet_t);
+    }
+    return pos;
+}
+
+void uart_packet_build(uart_packet_t *packet, uint8_t command, const uint8_t *data)
+{
+    packet->header[0] = 0xAA;
+    packet->header[1] = 0x55;
+    packet->command = command;
+    if (data) {
+        memcpy(packet->data, data, sizeof(packet->data));
+    } else {
+        memset(packet->data, 0, sizeof(packet->data));
+    }
+    packet->checksum = (uint8_t)checksum_sum8((const uint8_t *)packet, sizeof(uart_packet_t) - 1);
+}
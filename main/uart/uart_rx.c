@@ -0,0 +1,149 @@
+/**
+ * @file uart_rx.c
+ * @brief 多个串口共用的事件驱动接收任务
+ */
+
+#include "uart_rx.h"
+#include <string.h>
+#include "esp_log.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+
+static const char *TAG = "uart_rx";
+
+#define UART_RX_TASK_STACK      4096
+#define UART_RX_TASK_PRIO       10
+
+static uart_rx_port_config_t s_ports[UART_RX_PORT_MAX];
+static uint8_t s_port_num = 0;
+static QueueSetHandle_t s_queue_set = NULL;
+static SemaphoreHandle_t s_lock = NULL;
+
+static const uart_rx_port_config_t *find_port(QueueSetMemberHandle_t member)
+{
+    for (uint8_t i = 0; i < s_port_num; i++) {
+        if (s_ports[i].event_queue == member) {
+            return &s_ports[i];
+        }
+    }
+    return NULL;
+}
+
+// 把驱动缓冲中已有的数据整段读出，可能分多次交给回调
+static void drain_port(const uart_rx_port_config_t *p, uint8_t *buf)
+{
+    size_t buffered = 0;
+    while (uart_get_buffered_data_len(p->port, &buffered) == ESP_OK && buffered > 0) {
+        size_t want = buffered < UART_RX_BURST_MAX ? buffered : UART_RX_BURST_MAX;
+        int len = uart_read_bytes(p->port, buf, want, 0);
+        if (len <= 0) {
+            break;
+        }
+        p->on_data(buf, len, p->arg);
+    }
+}
+
+static void handle_event(const uart_rx_port_config_t *p, const uart_event_t *event, uint8_t *buf)
+{
+    switch (event->type) {
+    case UART_DATA:
+        drain_port(p, buf);
+        break;
+    case UART_FIFO_OVF:
+    case UART_BUFFER_FULL: {
+        uart_event_t stale;
+        ESP_LOGE(TAG, "UART%d %s, flush input", p->port,
+                 event->type == UART_FIFO_OVF ? "HW FIFO overflow" : "ring buffer full");
+        uart_flush_input(p->port);
+        // 逐条取出丢掉积压的事件，队列已在队列集中，不用 xQueueReset()。
+        // 集里仍留着这些事件的句柄，之后 select 到时取不到事件，任务循环直接跳过
+        while (xQueueReceive(p->event_queue, &stale, 0) == pdTRUE) {
+        }
+        if (p->on_reset) {
+            p->on_reset(p->arg);
+        }
+        break;
+    }
+    case UART_BREAK:
+        ESP_LOGW(TAG, "UART%d break", p->port);
+        break;
+    case UART_PARITY_ERR:
+        ESP_LOGW(TAG, "UART%d parity error", p->port);
+        break;
+    case UART_FRAME_ERR:
+        ESP_LOGW(TAG, "UART%d frame error", p->port);
+        break;
+    default:
+        break;
+    }
+}
+
+static void uart_rx_task(void *arg)
+{
+    static uint8_t buf[UART_RX_BURST_MAX];
+    uart_event_t event;
+
+    ESP_LOGI(TAG, "UART rx task started");
+    while (1) {
+        QueueSetMemberHandle_t member = xQueueSelectFromSet(s_queue_set, portMAX_DELAY);
+        if (!member) {
+            continue;
+        }
+        const uart_rx_port_config_t *p = find_port(member);
+        if (xQueueReceive((QueueHandle_t)member, &event, 0) != pdTRUE || !p) {
+            continue;
+        }
+        handle_event(p, &event, buf);
+    }
+}
+
+esp_err_t uart_rx_register(const uart_rx_port_config_t *config)
+{
+    if (!config || !config->event_queue || !config->on_data) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    UBaseType_t queue_len = uxQueueMessagesWaiting(config->event_queue) + uxQueueSpacesAvailable(config->event_queue);
+    if (queue_len > UART_RX_QUEUE_LEN_MAX) {
+        ESP_LOGE(TAG, "UART%d event queue too long: %u", config->port, queue_len);
+        return ESP_ERR_INVALID_SIZE;
+    }
+
+    if (!s_lock) {
+        s_lock = xSemaphoreCreateMutex();
+        // 溢出时丢掉的事件在集里留有句柄，与之后新来的事件合计最多是队列长度的两倍
+        s_queue_set = xQueueCreateSet(2 * UART_RX_PORT_MAX * UART_RX_QUEUE_LEN_MAX);
+        if (!s_lock || !s_queue_set) {
+            ESP_LOGE(TAG, "Failed to create uart_rx queue set");
+            return ESP_ERR_NO_MEM;
+        }
+        if (xTaskCreate(uart_rx_task, "uart_rx", UART_RX_TASK_STACK, NULL, UART_RX_TASK_PRIO, NULL) != pdPASS) {
+            ESP_LOGE(TAG, "Failed to create uart_rx task");
+            return ESP_FAIL;
+        }
+    }
+
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (s_port_num >= UART_RX_PORT_MAX) {
+        xSemaphoreGive(s_lock);
+        return ESP_ERR_NO_MEM;
+    }
+    uint8_t rx_timeout = config->rx_timeout ? config->rx_timeout : UART_RX_DEFAULT_TIMEOUT;
+    uart_set_rx_timeout(config->port, rx_timeout);
+
+    // 加入队列集前队列必须为空；已在驱动缓冲中的数据会在下一次事件时一并读出
+    xQueueReset(config->event_queue);
+    s_ports[s_port_num] = *config;
+    s_ports[s_port_num].rx_timeout = rx_timeout;
+    // 先登记再加入队列集，接收任务收到事件时一定能找到对应串口
+    s_port_num++;
+    if (xQueueAddToSet(config->event_queue, s_queue_set) != pdPASS) {
+        s_port_num--;
+        xSemaphoreGive(s_lock);
+        ESP_LOGE(TAG, "Failed to add UART%d to queue set", config->port);
+        return ESP_FAIL;
+    }
+    xSemaphoreGive(s_lock);
+
+    ESP_LOGI(TAG, "UART%d registered, rx_timeout=%u", config->port, rx_timeout);
+    return ESP_OK;
+}
@@ -7,13 +7,19 @@
 
 #include "unlock.h"
 #include <string.h>
+#include <stdio.h>
 #include "esp_log.h"
+#include "esp_timer.h"
 #include "freertos/FreeRTOS.h"
 #include "freertos/timers.h"
-#include "net_uart_comm.h"  // for uart_comm_send_packet(), uart_comm_calc_checksum()
+#include "cJSON.h"
+#include "cc_event.h"
+#include "net_uart_comm.h"  // for uart_comm_send_cmd()
+#include "uart_parse.h"
 #include "cc_hal_sys.h"     // if you need random, ms-tick etc
 #include "cc_hal_os.h"      // if you need semaphores, etc
 #include "gs_mqtt.h"        // if you want to publish results to cloud
+#include "evt_log.h"
 //#include "msg_upload.h"    // if you want to notify the msg_upload module
 
 static const char *TAG = "unlock";
@@ -25,6 +31,10 @@ static const char *TAG = "unlock";
 
 // 如果需要支持多次重发 0x13，可定义 RE_SEND_ATTEMPTS 等，这里先不实现
 
+// 保留最近多少次开锁耗时用于计算 p50/p99
+#define UNLOCK_TRACE_SAMPLES         32
+#define UNLOCK_TRACE_MQTT_TOPIC      "/event/latency/post"
+
 /* -------------------- 数据结构和状态 -------------------- */
 
 // 标记是否处于“等待MCU回包0x12”的状态
@@ -42,12 +52,55 @@ static uint16_t s_current_user_id  = 0;
  */
 static TimerHandle_t s_unlock_timer = NULL;
 
+/*
+ * 链路打点：s_trace_us 为进行中的会话，s_last_us 为最近一次完成的会话，
+ * s_samples 为最近若干次的总耗时（从 0x03 请求或云端指令开始，到 0x12 为止）。
+ */
+static int64_t s_trace_us[UNLOCK_TRACE_POINT_MAX];
+static int64_t s_last_us[UNLOCK_TRACE_POINT_MAX];
+static bool s_trace_active = false;
+static uint32_t s_samples[UNLOCK_TRACE_SAMPLES];
+static uint8_t s_sample_idx = 0;
+static uint8_t s_sample_cnt = 0;
+static portMUX_TYPE s_trace_lock = portMUX_INITIALIZER_UNLOCKED;
+
 /* -------------------- 静态函数声明 -------------------- */
 static void unlock_timeout_cb(TimerHandle_t xTimer);
 static esp_err_t send_cmd_13_to_mcu(uint8_t user_type, uint16_t user_id);
+static void unlock_trace_report(void);
 
 /* ----------------------------------------------------- */
 
+/**
+ * @brief 云端开锁指令，在 MQTT 任务中回调
+ */
+static void unlock_cmd_msg_cb(const char *topic, uint16_t topic_len, uint8_t qos, uint8_t retain, char *data, uint32_t len)
+{
+    unlock_trace_mark(UNLOCK_TRACE_CMD_RX);
+
+    cJSON *root = cJSON_ParseWithLength(data, len);
+    if (!root) {
+        ESP_LOGE(TAG, "unlock cmd: json error");
+        return;
+    }
+    cJSON *type_obj = cJSON_GetObjectItem(root, "user_type");
+    cJSON *id_obj = cJSON_GetObjectItem(root, "user_id");
+    if (cJSON_IsNumber(type_obj) && cJSON_IsNumber(id_obj)) {
+        unlock_send_remote_unlock_to_mcu((uint8_t)type_obj->valueint, (uint16_t)id_obj->valueint);
+    } else {
+        ESP_LOGE(TAG, "unlock cmd: field error");
+    }
+    cJSON_Delete(root);
+}
+
+static void unlock_mqtt_event_handler(void *handler_args, cc_event_base_t base_event, int32_t id, void *event_data)
+{
+    if (id == GS_MQTT_EVENT_CONNECTED) {
+        // QoS1：断线重连期间下发的指令由服务器补发
+        gs_mqtt_subscribe(UNLOCK_TOPIC_CMD_SUB, GS_MQTT_QOS1);
+    }
+}
+
 esp_err_t unlock_init(void)
 {
     ESP_LOGI(TAG, "unlock_init: create timer & reset state");
@@ -67,6 +120,9 @@ esp_err_t unlock_init(void)
         return ESP_FAIL;
     }
 
+    gs_mqtt_register_topic_msg_cb(UNLOCK_TOPIC_CMD_SUB, unlock_cmd_msg_cb);
+    cc_event_register_handler(GS_MQTT_EVENT, unlock_mqtt_event_handler);
+
     return ESP_OK;
 }
 
@@ -106,19 +162,15 @@ esp_err_t unlock_send_remote_unlock_to_mcu(uint8_t user_type, uint16_t user_id)
 /**
  * @brief 当 UART 收到 0x12(远程开锁应答) 时，调用此函数
  */
-void unlock_handle_mcu_packet(const uart_packet_t *packet)
+uint8_t unlock_handle_mcu_packet(const uart_packet_t *packet)
 {
-    if (packet->command != 0x12) {
-        // 只关心0x12
-        return;
-    }
-
     ESP_LOGI(TAG, "Got 0x12 from MCU => remote unlock ack");
 
     if (s_unlock_in_progress) {
         // 停止超时
         xTimerStop(s_unlock_timer, 0);
         s_unlock_in_progress = false;
+        unlock_trace_mark(UNLOCK_TRACE_ACK_RX);
         ESP_LOGI(TAG, "Remote unlock done, user_type=0x%02X, user_id=%u",
                  s_current_user_type, s_current_user_id);
 
@@ -133,6 +185,7 @@ void unlock_handle_mcu_packet(const uart_packet_t *packet)
     } else {
         ESP_LOGW(TAG, "Received 0x12 but s_unlock_in_progress == false (unexpected?)");
     }
+    return UART_CMD_OK;
 }
 
 /**
@@ -150,32 +203,13 @@ bool unlock_is_in_progress(void)
  */
 static esp_err_t send_cmd_13_to_mcu(uint8_t user_type, uint16_t user_id)
 {
-    uart_packet_t pkt;
-    memset(&pkt, 0, sizeof(pkt));
-
-    pkt.header[0] = 0xAA;
-    pkt.header[1] = 0x55;
-    pkt.command   = 0x13;   // 远程开锁指令
-
-    // data[0] = user_type (如0x05=手机用户)
-    pkt.data[0] = user_type;
-
-    // data[1..2] = user_id(2字节，小端)
-    pkt.data[1] = (uint8_t)(user_id & 0xFF);
-    pkt.data[2] = (uint8_t)((user_id >> 8) & 0xFF);
-
-    // data[3..5] = 0x00
-    pkt.data[3] = 0x00;
-    pkt.data[4] = 0x00;
-    pkt.data[5] = 0x00;
-
-    // 计算校验和
-    pkt.checksum = uart_comm_calc_checksum((uint8_t*)&pkt, sizeof(pkt)-1);
+    // data[0] = user_type (如0x05=手机用户)，data[1..2] = user_id(小端)，其余为 0
+    uint8_t data[6] = {0};
+    data[0] = user_type;
+    uart_put_le16(data + 1, user_id);
 
     ESP_LOGI(TAG, "Sending 0x13 => user_type=0x%02X, user_id=%u", user_type, user_id);
-
-    // 调用 UART 发送函数
-    return uart_comm_send_packet(&pkt);
+    return uart_comm_send_cmd(CMD_REMOTE_UNLOCK, data);
 }
 
 /**
@@ -188,9 +222,117 @@ static void unlock_timeout_cb(TimerHandle_t xTimer)
 
     if (s_unlock_in_progress) {
         s_unlock_in_progress = false;
+        portENTER_CRITICAL(&s_trace_lock);
+        s_trace_active = false;
+        portEXIT_CRITICAL(&s_trace_lock);
         // 可以在这里通知云端：远程开锁失败 or 超时
         // char payload[64];
         // sprintf(payload, "{\"event\":\"remote_unlock_fail\",\"reason\":\"timeout\"}");
         // gs_mqtt_publish("/event/property/post", (uint8_t*)payload, strlen(payload), GS_MQTT_QOS0, 0);
     }
 }
+
+/* -------------------- 链路耗时统计 -------------------- */
+
+void unlock_trace_mark(unlock_trace_point_t point)
+{
+    if (point >= UNLOCK_TRACE_POINT_MAX) {
+        return;
+    }
+    int64_t now = esp_timer_get_time();
+    bool done = false;
+
+    evt_log(EVT_MOD_UNLOCK, (uint8_t)point, 0, 0);
+
+    portENTER_CRITICAL(&s_trace_lock);
+    // App 直接下发的开锁没有 0x03 请求，从云端指令开始计
+    if (point == UNLOCK_TRACE_REQ_RX || (point == UNLOCK_TRACE_CMD_RX && !s_trace_active)) {
+        memset(s_trace_us, 0, sizeof(s_trace_us));
+        s_trace_active = true;
+    }
+    if (s_trace_active && s_trace_us[point] == 0) {
+        s_trace_us[point] = now;
+        if (point == UNLOCK_TRACE_ACK_RX) {
+            int64_t start = s_trace_us[UNLOCK_TRACE_REQ_RX] ? s_trace_us[UNLOCK_TRACE_REQ_RX]
+                                                            : s_trace_us[UNLOCK_TRACE_CMD_RX];
+            memcpy(s_last_us, s_trace_us, sizeof(s_last_us));
+            s_samples[s_sample_idx] = (uint32_t)((now - start) / 1000);
+            s_sample_idx = (s_sample_idx + 1) % UNLOCK_TRACE_SAMPLES;
+            if (s_sample_cnt < UNLOCK_TRACE_SAMPLES) {
+                s_sample_cnt++;
+            }
+            s_trace_active = false;
+            done = true;
+        }
+    }
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    if (done) {
+        unlock_trace_report();
+    }
+}
+
+// 两点间耗时(ms)，任一点未到达为 -1
+static int trace_delta_ms(const int64_t *ts, unlock_trace_point_t from, unlock_trace_point_t to)
+{
+    if (!ts[from] || !ts[to]) {
+        return -1;
+    }
+    return (int)((ts[to] - ts[from]) / 1000);
+}
+
+// 最近邻秩百分位，sorted 已升序
+static uint32_t trace_percentile(const uint32_t *sorted, uint8_t cnt, uint8_t pct)
+{
+    uint32_t rank = ((uint32_t)cnt * pct + 99) / 100;
+    return sorted[rank ? rank - 1 : 0];
+}
+
+int unlock_trace_summary(char *buf, size_t size)
+{
+    int64_t ts[UNLOCK_TRACE_POINT_MAX];
+    uint32_t sorted[UNLOCK_TRACE_SAMPLES];
+    uint8_t cnt;
+
+    portENTER_CRITICAL(&s_trace_lock);
+    memcpy(ts, s_last_us, sizeof(ts));
+    cnt = s_sample_cnt;
+    memcpy(sorted, s_samples, cnt * sizeof(uint32_t));
+    portEXIT_CRITICAL(&s_trace_lock);
+
+    for (uint8_t i = 1; i < cnt; i++) {
+        uint32_t v = sorted[i];
+        uint8_t j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) {
+            sorted[j] = sorted[j - 1];
+        }
+        sorted[j] = v;
+    }
+
+    unlock_trace_point_t start = ts[UNLOCK_TRACE_REQ_RX] ? UNLOCK_TRACE_REQ_RX : UNLOCK_TRACE_CMD_RX;
+    int len = snprintf(buf, size,
+                       "{\"unlock_ms\":{\"pub\":%d,\"cloud\":%d,\"uart\":%d,\"mcu\":%d,\"total\":%d},"
+                       "\"n\":%u,\"p50\":%d,\"p99\":%d}",
+                       trace_delta_ms(ts, UNLOCK_TRACE_REQ_RX, UNLOCK_TRACE_REQ_PUB),
+                       trace_delta_ms(ts, UNLOCK_TRACE_REQ_PUB, UNLOCK_TRACE_CMD_RX),
+                       trace_delta_ms(ts, UNLOCK_TRACE_CMD_RX, UNLOCK_TRACE_CMD_TX),
+                       trace_delta_ms(ts, UNLOCK_TRACE_CMD_TX, UNLOCK_TRACE_ACK_RX),
+                       trace_delta_ms(ts, start, UNLOCK_TRACE_ACK_RX),
+                       cnt,
+                       cnt ? (int)trace_percentile(sorted, cnt, 50) : -1,
+                       cnt ? (int)trace_percentile(sorted, cnt, 99) : -1);
+    if (len < 0) {
+        return 0;
+    }
+    return ((size_t)len < size) ? len : (int)size - 1;
+}
+
+static void unlock_trace_report(void)
+{
+    char summary[160];
+    int len = unlock_trace_summary(summary, sizeof(summary));
+    ESP_LOGI(TAG, "Remote unlock latency: %s", summary);
+    if (len > 0 && gs_mqtt_connect_status()) {
+        gs_mqtt_publish(UNLOCK_TRACE_MQTT_TOPIC, (uint8_t *)summary, (uint16_t)len, GS_MQTT_QOS0, 0);
+    }
+}
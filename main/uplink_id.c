@@ -0,0 +1,87 @@
+/**
+ * @file uplink_id.c
+ * @brief 上行消息的 epoch 与序号，见 uplink_id.h
+ */
+
+#include "uplink_id.h"
+#include <stdio.h>
+#include <inttypes.h>
+#include "esp_log.h"
+#include "cc_hal_kvs.h"
+#include "cc_worker.h"
+
+static const char *TAG = "uplink_id";
+
+#define UPLINK_ID_KVS_KEY       "uplink_id"
+
+typedef struct {
+    uint32_t epoch;
+    uint64_t seq_limit;         // 已预留到的序号（不含）
+} uplink_id_store_t;
+
+static uint32_t s_epoch = 0;
+static uint64_t s_base = 0;     // 本次启动的第一个序号，init 后不变
+static uint32_t s_count = 0;    // 本次启动已取的个数，只做原子加
+static uint64_t s_saved_limit = 0;
+
+static esp_err_t uplink_id_save(uint64_t limit)
+{
+    uplink_id_store_t store = { .epoch = s_epoch, .seq_limit = limit };
+    if (cc_hal_kvs_set(UPLINK_ID_KVS_KEY, &store, sizeof(store)) != CC_OK) {
+        return ESP_FAIL;
+    }
+    s_saved_limit = limit;
+    return ESP_OK;
+}
+
+// 预留到当前批之后再一批，只在 cc_worker 中运行
+static void uplink_id_reserve_job(void *arg)
+{
+    uint32_t count = __atomic_load_n(&s_count, __ATOMIC_RELAXED);
+    uint64_t limit = s_base + ((uint64_t)count / UPLINK_ID_BATCH + 2) * UPLINK_ID_BATCH;
+    if (limit > s_saved_limit && uplink_id_save(limit) != ESP_OK) {
+        ESP_LOGW(TAG, "Failed to reserve seq up to %" PRIu64, limit);
+    }
+}
+
+esp_err_t uplink_id_init(void)
+{
+    uplink_id_store_t store = {0};
+    size_t len = sizeof(store);
+    if (cc_hal_kvs_get(UPLINK_ID_KVS_KEY, &store, &len) != CC_OK || len != sizeof(store)) {
+        store.epoch = 0;
+        store.seq_limit = 0;
+    }
+
+    // 上次启动用到哪里未知，从预留的上限接着取
+    s_epoch = store.epoch + 1;
+    s_base = store.seq_limit;
+    esp_err_t err = uplink_id_save(s_base + 2 * UPLINK_ID_BATCH);
+    // epoch 必须在发出第一条消息前落盘，否则掉电后会与本次启动重复
+    if (err != ESP_OK || cc_hal_kvs_flush() != CC_OK) {
+        ESP_LOGE(TAG, "Failed to persist epoch %" PRIu32, s_epoch);
+        return ESP_FAIL;
+    }
+    ESP_LOGI(TAG, "epoch %" PRIu32 ", seq from %" PRIu64, s_epoch, s_base);
+    return ESP_OK;
+}
+
+uplink_id_t uplink_id_next(void)
+{
+    uint32_t count = __atomic_fetch_add(&s_count, 1, __ATOMIC_RELAXED);
+    // 每批用到一半时续订下一批，取号本身不碰 flash
+    if (count % UPLINK_ID_BATCH == UPLINK_ID_BATCH / 2) {
+        cc_worker_submit(uplink_id_reserve_job, NULL, CC_WORKER_PRIO_LOW);
+    }
+    uplink_id_t id = {
+        .epoch = s_epoch,
+        .seq = s_base + count,
+    };
+    return id;
+}
+
+char *uplink_id_str(uplink_id_t id, char buf[UPLINK_ID_STR_LEN])
+{
+    snprintf(buf, UPLINK_ID_STR_LEN, "%012" PRIu32 "%020" PRIu64, id.epoch, id.seq);
+    return buf;
+}
@@ -0,0 +1,64 @@
+/**
+ * @file uplink_id.h
+ * @brief 上行消息的序号与幂等键：每次启动一个 epoch，启动内 64 位序号原子递增，(epoch, seq) 全局唯一
+ *
+ * 云端按幂等键去重，客户端可以放心重试：同一条消息的每次重发都带同一个键，不会重复上报开锁等事件。
+ *   MQTT      seq_no 字段（gs_mqtt_generate_seq()）
+ *   状态批次  每条状态带 epoch 与 seq
+ *   图片上传  HTTP 头 UPLINK_ID_HTTP_HEADER，随上传队列、flash 暂存和断电记录一起保存
+ *
+ * epoch 每次启动加 1 并立即落盘；seq 跨启动单调递增，落盘的是预留的上限，每用掉半批才在 cc_worker 中
+ * 续订一批（UPLINK_ID_BATCH），平时取号不写 flash、不加锁。掉电丢失的预留只会让 seq 重复，epoch 不同，键仍唯一。
+ */
+
+#ifndef UPLINK_ID_H
+#define UPLINK_ID_H
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define UPLINK_ID_STR_LEN       33          // 12 位 epoch + 20 位 seq，十进制，含 '\0'
+#define UPLINK_ID_HTTP_HEADER   "Idempotency-Key"
+#define UPLINK_ID_BATCH         1024
+
+typedef struct {
+    uint32_t epoch;
+    uint64_t seq;
+} uplink_id_t;
+
+/**
+ * @brief 读取并递增 epoch、预留第一批序号，须在 cc_hal_kvs_init() 之后调用；之前取到的 epoch 为 0
+ */
+esp_err_t uplink_id_init(void);
+
+/**
+ * @brief 取下一个 id，可在任意任务中调用
+ */
+uplink_id_t uplink_id_next(void);
+
+/**
+ * @brief id 的 32 位十进制文本形式，与原来随机的 seq_no 等长
+ *
+ * @return buf
+ */
+char *uplink_id_str(uplink_id_t id, char buf[UPLINK_ID_STR_LEN]);
+
+/**
+ * @brief 取下一个 id 的文本形式
+ *
+ * @return buf
+ */
+static inline char *uplink_id_next_str(char buf[UPLINK_ID_STR_LEN])
+{
+    return uplink_id_str(uplink_id_next(), buf);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UPLINK_ID_H
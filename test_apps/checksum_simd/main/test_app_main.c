@@ -0,0 +1,25 @@
+// checksum_simd 测试入口：unity 菜单，每个用例前后检查内存泄漏
+#include <stdio.h>
+#include "unity.h"
+#include "unity_test_utils.h"
+
+#define TEST_MEMORY_LEAK_THRESHOLD  (300)
+
+void app_main(void)
+{
+    printf("checksum_simd: PIE kernel of main/checksum.c\n");
+    UNITY_BEGIN();
+    unity_run_menu();
+    UNITY_END();
+}
+
+void setUp(void)
+{
+    unity_utils_set_leak_level(TEST_MEMORY_LEAK_THRESHOLD);
+    unity_utils_record_free_mem();
+}
+
+void tearDown(void)
+{
+    unity_utils_evaluate_leaks();
+}
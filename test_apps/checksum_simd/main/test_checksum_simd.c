@@ -0,0 +1,94 @@
+// checksum_sum8_update() 的 PIE 路径与逐字节相加比较：起点错开 0..15 字节，长度跨过
+// PIE 路径的门槛、16 字节块边界和分段边界；再比较每字节周期数
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "checksum.h"
+
+#define BUF_LEN         (8192 + 64)
+#define BENCH_LEN       4096
+#define BENCH_RUNS      100
+
+static const char *TAG = "checksum_simd";
+
+static uint32_t ref_sum8(const uint8_t *data, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+static uint8_t *make_buf(void)
+{
+    uint8_t *buf = memalign(16, BUF_LEN);
+    TEST_ASSERT_NOT_NULL(buf);
+    for (int i = 0; i < BUF_LEN; i++) {
+        buf[i] = (uint8_t)(i * 2654435761u >> 13);
+    }
+    return buf;
+}
+
+TEST_CASE("sum8 matches byte-wise sum for every offset and length", "[checksum][functionality]")
+{
+    uint8_t *buf = make_buf();
+    int combinations = 0;
+    for (int off = 0; off < 16; off++) {
+        for (size_t len = 0; len <= 300; len++) {
+            TEST_ASSERT_EQUAL_UINT32(ref_sum8(buf + off, len), checksum_sum8(buf + off, len));
+            combinations++;
+        }
+        for (size_t len = 301; len + off <= BUF_LEN; len = len * 3 / 2 + 7) {
+            TEST_ASSERT_EQUAL_UINT32(ref_sum8(buf + off, len), checksum_sum8(buf + off, len));
+            combinations++;
+        }
+    }
+    ESP_LOGI(TAG, "%d combinations", combinations);
+    free(buf);
+}
+
+TEST_CASE("sum8 of 0xFF bytes and chunked updates", "[checksum][functionality]")
+{
+    uint8_t *buf = make_buf();
+    for (int cut = 0; cut < 200; cut += 13) {
+        uint32_t sum = checksum_sum8_update(0, buf + 5, cut);
+        sum = checksum_sum8_update(sum, buf + 5 + cut, 4000 - cut);
+        TEST_ASSERT_EQUAL_UINT32(ref_sum8(buf + 5, 4000), sum);
+    }
+    // 每个乘加通道都取最大值
+    memset(buf, 0xFF, BUF_LEN);
+    TEST_ASSERT_EQUAL_UINT32(255u * (BUF_LEN - 7), checksum_sum8(buf + 7, BUF_LEN - 7));
+    free(buf);
+}
+
+TEST_CASE("sum8 benchmark", "[checksum][benchmark]")
+{
+    uint8_t *buf = make_buf();
+    volatile uint32_t sink = 0;
+
+    sink += checksum_sum8(buf, BENCH_LEN);      // 预热缓存
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        sink += checksum_sum8(buf, BENCH_LEN);
+    }
+    float simd = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / BENCH_LEN;
+
+    // 长度不足 PIE 门槛时的字路径，逐段累加同样的字节数
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        uint32_t sum = 0;
+        for (int off = 0; off < BENCH_LEN; off += 32) {
+            sum = checksum_sum8_update(sum, buf + off, 32);
+        }
+        sink += sum;
+    }
+    float swar = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / BENCH_LEN;
+
+    ESP_LOGI(TAG, "sum8 %d bytes: simd %.3f, word path %.3f cycles/byte", BENCH_LEN, simd, swar);
+    TEST_ASSERT_LESS_THAN_FLOAT(swar, simd);
+    free(buf);
+}
@@ -0,0 +1,64 @@
+/*
+ * 没有 libFuzzer（gcc 构建）时的入口：
+ *   fuzz_xxx file...          逐个回放语料/崩溃样本
+ *   fuzz_xxx -runs=N [-seed=S] 生成 N 个随机输入，偏向帧头字节以便走到解析深处
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size);
+
+#define DRIVER_MAX_INPUT    4096
+
+static const uint8_t s_dict[] = {0xAA, 0x55, 0x56, 0xBB, 0x22, 0x00, 0xFF, 0x01, 0x02};
+
+static int run_file(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "open %s failed\n", path);
+        return 1;
+    }
+    static uint8_t buf[1 << 20];
+    size_t n = fread(buf, 1, sizeof(buf), f);
+    fclose(f);
+    LLVMFuzzerTestOneInput(buf, n);
+    return 0;
+}
+
+static void run_random(long runs, unsigned seed)
+{
+    static uint8_t buf[DRIVER_MAX_INPUT];
+    srand(seed);
+    for (long i = 0; i < runs; i++) {
+        size_t n = rand() % DRIVER_MAX_INPUT;
+        for (size_t j = 0; j < n; j++) {
+            int r = rand();
+            buf[j] = (r & 3) ? s_dict[(r >> 2) % sizeof(s_dict)] : (uint8_t)(r >> 8);
+        }
+        LLVMFuzzerTestOneInput(buf, n);
+    }
+    printf("%ld runs, seed %u, ok\n", runs, seed);
+}
+
+int main(int argc, char **argv)
+{
+    long runs = 0;
+    unsigned seed = 1;
+    int ret = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strncmp(argv[i], "-runs=", 6) == 0) {
+            runs = atol(argv[i] + 6);
+        } else if (strncmp(argv[i], "-seed=", 6) == 0) {
+            seed = strtoul(argv[i] + 6, NULL, 0);
+        } else if (argv[i][0] != '-') {
+            ret |= run_file(argv[i]);
+        }
+    }
+    if (runs) {
+        run_random(runs, seed);
+    }
+    return ret;
+}
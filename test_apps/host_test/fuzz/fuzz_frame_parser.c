@@ -0,0 +1,46 @@
+// frame_parser 模糊测试：输入按首字节决定的大小分段写入，模拟串口分批到达
+#include <stdint.h>
+#include <stddef.h>
+#include <stdlib.h>
+#include <string.h>
+#include "frame_parser.h"
+
+#define FUZZ_RING_SIZE      1024
+
+int LLVMFuzzerTestOneInput(const uint8_t *data, size_t size)
+{
+    static bool inited;
+    if (!inited) {
+        frame_parser_init(FUZZ_RING_SIZE);
+        inited = true;
+    }
+    frame_parser_reset();
+    if (size < 1) {
+        return 0;
+    }
+    size_t segment = (data[0] & 0x3F) + 1;
+    data++;
+    size--;
+
+    uint8_t frame[FRAME_MAX_LEN];
+    uint32_t len;
+    size_t out_total = 0;
+    for (size_t pos = 0; pos < size; pos += segment) {
+        size_t n = size - pos < segment ? size - pos : segment;
+        if (frame_parser_add_buf((uint8_t *)data + pos, n) != n) {
+            abort();        // 每段后都取完了所有帧，剩余的半帧不会占满缓冲
+        }
+        while (frame_parser_get_frame(frame, &len)) {
+            const frame_parser_head_t *head = (const frame_parser_head_t *)frame;
+            if (head->head != FRAME_PARSER_HEAD || len > FRAME_MAX_LEN || len < FRAME_MIN_LEN - 1 ||
+                len != sizeof(*head) + head->len + sizeof(frame_parser_last_t)) {
+                abort();
+            }
+            out_total += len;
+        }
+    }
+    if (out_total > size) {
+        abort();
+    }
+    return 0;
+}
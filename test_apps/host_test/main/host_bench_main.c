@@ -0,0 +1,378 @@
+// 主机微基准：每项输出一行 HOSTBENCH {json}，--quick 只做冒烟运行
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+#include "rbuffer_spsc.h"
+#include "frame_parser.h"
+#include "uart_parse.h"
+#include "uart_ext.h"
+#include "checksum.h"
+#include "cc_list.h"
+#include "cc_timer.h"
+#include "http_fake_conn.h"
+#include "ui_pixel.h"
+#include "audio_dsp.h"
+
+static int s_scale = 1;
+static volatile uint32_t s_sink;
+
+static uint64_t now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+// bytes 为 0 时不输出吞吐
+static void bench_report(const char *name, uint64_t ops, uint64_t bytes, uint64_t ns)
+{
+    printf("HOSTBENCH {\"name\":\"%s\",\"ops\":%llu,\"ns_per_op\":%.2f,\"mb_s\":%.2f}\n",
+           name, (unsigned long long)ops, ops ? (double)ns / ops : 0.0,
+           ns && bytes ? bytes * 1000.0 / ns : 0.0);
+}
+
+static void bench_rbuffer_spsc(void)
+{
+    rbuffer_spsc_handle_t rb = rbuffer_spsc_create(4096);
+    uint8_t chunk[256];
+    memset(chunk, 0x5A, sizeof(chunk));
+    uint64_t ops = 200000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t i = 0; i < ops; i++) {
+        rbuffer_spsc_push(rb, chunk, sizeof(chunk));
+        s_sink += rbuffer_spsc_pop(rb, chunk, sizeof(chunk));
+    }
+    bench_report("rbuffer_spsc_push_pop_256", ops, ops * sizeof(chunk), now_ns() - t0);
+    rbuffer_spsc_delete(rb);
+}
+
+static void bench_frame_parser(void)
+{
+    // 64 个帧连在一起，每个 4 字节数据，一次喂入后全部取出
+    uint8_t stream[64 * 9];
+    for (int i = 0; i < 64; i++) {
+        uint8_t *f = stream + i * 9;
+        f[0] = FRAME_PARSER_HEAD & 0xFF;
+        f[1] = FRAME_PARSER_HEAD >> 8;
+        f[2] = 0x31;
+        f[3] = 4;
+        memset(f + 4, i, 4);
+        f[8] = 0;
+    }
+    frame_parser_init(1024);
+    uint8_t out[FRAME_MAX_LEN];
+    uint32_t out_len;
+    uint64_t rounds = 20000 / s_scale;
+    uint64_t frames = 0;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        frame_parser_add_buf(stream, sizeof(stream));
+        while (frame_parser_get_frame(out, &out_len)) {
+            frames++;
+        }
+    }
+    bench_report("frame_parser_9b_frames", frames, rounds * sizeof(stream), now_ns() - t0);
+}
+
+// 解析器在噪声或恶意输入下每字节的开销，输入分 64 字节一段写入，与串口中断一次交付的量级相当
+static void bench_frame_parser_stream(const char *name, const uint8_t *stream, size_t len)
+{
+    uint8_t out[FRAME_MAX_LEN];
+    uint32_t out_len;
+    uint64_t rounds = 2000 / s_scale;
+    frame_parser_reset();
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (size_t pos = 0; pos < len; pos += 64) {
+            frame_parser_add_buf((uint8_t *)stream + pos, len - pos < 64 ? len - pos : 64);
+            while (frame_parser_get_frame(out, &out_len)) {
+                s_sink += out_len;
+            }
+        }
+    }
+    bench_report(name, rounds * len, rounds * len, now_ns() - t0);
+}
+
+static void bench_frame_parser_resync(void)
+{
+    static uint8_t stream[16384];
+    srand(1);
+    for (size_t i = 0; i < sizeof(stream); i++) {
+        stream[i] = rand();
+    }
+    bench_frame_parser_stream("frame_parser_noise", stream, sizeof(stream));
+
+    // 最坏情况：处处是帧头，长度字段指向缓冲末尾之后，每个帧头都要向后扫描下一个帧头
+    for (size_t i = 0; i + 4 <= sizeof(stream); i += 4) {
+        stream[i] = FRAME_PARSER_HEAD & 0xFF;
+        stream[i + 1] = FRAME_PARSER_HEAD >> 8;
+        stream[i + 2] = 0;
+        stream[i + 3] = FRAME_MAX_LEN - 5;
+    }
+    bench_frame_parser_stream("frame_parser_resync_worst", stream, sizeof(stream));
+}
+
+static void bench_on_packet(const uart_packet_t *packet)
+{
+    s_sink += packet->command;
+}
+
+static bool bench_on_ext_frame(const uint8_t *frame, size_t len)
+{
+    s_sink += len;
+    return true;
+}
+
+// 与 net_uart_comm.c 相同的拼接方式，按 burst 字节一段送入
+static void bench_uart_parse_stream(const char *name, const uint8_t *stream, size_t len,
+                                    bool (*on_ext_frame)(const uint8_t *, size_t))
+{
+    static uint8_t rx_buf[UART_EXT_FRAME_MAX + 256];
+    const uart_parse_ops_t ops = { .on_packet = bench_on_packet, .on_ext_frame = on_ext_frame };
+    uint64_t rounds = 200 / s_scale + 1;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        size_t rx_len = 0;
+        for (size_t pos = 0; pos < len; pos += 256) {
+            size_t n = len - pos < 256 ? len - pos : 256;
+            memcpy(rx_buf + rx_len, stream + pos, n);
+            rx_len += n;
+            size_t used = uart_parse_packets(rx_buf, rx_len, &ops);
+            rx_len -= used;
+            memmove(rx_buf, rx_buf + used, rx_len);
+        }
+    }
+    bench_report(name, rounds * len, rounds * len, now_ns() - t0);
+}
+
+static bool bench_ext_crc_check(const uint8_t *frame, size_t len)
+{
+    uint16_t crc = checksum_crc16(frame + 2, len - 4);
+    return crc == (frame[len - 2] | (frame[len - 1] << 8));
+}
+
+static void bench_uart_parse_resync(void)
+{
+    static uint8_t stream[65536];
+    srand(2);
+    for (size_t i = 0; i < sizeof(stream); i++) {
+        stream[i] = rand();
+    }
+    bench_uart_parse_stream("uart_parse_noise", stream, sizeof(stream), bench_ext_crc_check);
+
+    // 最坏情况：每 7 字节一个声明最大长度的扩展帧头，校验都失败，每个帧头都要对整帧算一次 CRC
+    for (size_t i = 0; i + UART_EXT_HEAD_SIZE <= sizeof(stream); i += UART_EXT_HEAD_SIZE) {
+        stream[i] = UART_EXT_HEADER0;
+        stream[i + 1] = UART_EXT_HEADER1;
+        stream[i + 2] = 0;
+        stream[i + 3] = 0;
+        stream[i + 4] = 0;
+        stream[i + 5] = UART_EXT_MAX_PAYLOAD & 0xFF;
+        stream[i + 6] = UART_EXT_MAX_PAYLOAD >> 8;
+    }
+    bench_uart_parse_stream("uart_parse_resync_worst", stream, sizeof(stream), bench_ext_crc_check);
+}
+
+static void bench_uart_parse(void)
+{
+    static uint8_t buf[32 * sizeof(uart_packet_t)];
+    for (size_t i = 0; i < 32; i++) {
+        uart_packet_t *p = (uart_packet_t *)(buf + i * sizeof(uart_packet_t));
+        memset(p, 0, sizeof(*p));
+        p->header[0] = 0xAA;
+        p->header[1] = 0x55;
+        p->command = i;
+        p->checksum = (uint8_t)checksum_sum8((uint8_t *)p, sizeof(*p) - 1);
+    }
+    const uart_parse_ops_t ops = { .on_packet = bench_on_packet, .on_ext_frame = bench_on_ext_frame };
+    uint64_t rounds = 50000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        s_sink += uart_parse_packets(buf, sizeof(buf), &ops);
+    }
+    bench_report("uart_parse_packets", rounds * 32, rounds * sizeof(buf), now_ns() - t0);
+}
+
+static void bench_crc16(void)
+{
+    static uint8_t buf[4096];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = i * 7;
+    }
+    uint64_t rounds = 20000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        s_sink += checksum_crc16(buf, sizeof(buf));
+    }
+    bench_report("checksum_crc16_4k", rounds, rounds * sizeof(buf), now_ns() - t0);
+}
+
+CC_POOL_DEFINE(s_bench_pool, 32, 64);
+
+static void bench_cc_pool(void)
+{
+    void *elem[64];
+    cc_pool_init(&s_bench_pool, s_bench_pool_buf, 32, 64);
+    uint64_t rounds = 100000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int i = 0; i < 64; i++) {
+            elem[i] = cc_pool_alloc(&s_bench_pool);
+        }
+        for (int i = 63; i >= 0; i--) {
+            cc_pool_free(&s_bench_pool, elem[i]);
+        }
+    }
+    bench_report("cc_pool_alloc_free", rounds * 64, 0, now_ns() - t0);
+}
+
+static void bench_timer_cb(void *arg)
+{
+    s_sink++;
+}
+
+// 1000 个周期各不相同的定时器，测推进一个 tick 的平均开销
+static void bench_cc_timer(void)
+{
+    enum { TIMER_NUM = 1000 };
+    static cc_timer_handle_t timers[TIMER_NUM];
+    cc_timer_init();
+    cc_timer_config_t cfg = { .type = CC_TIMER_TYPE_SW, .callback = bench_timer_cb };
+    for (int i = 0; i < TIMER_NUM; i++) {
+        timers[i] = cc_timer_create(&cfg);
+        cc_timer_start_periodic(timers[i], CC_TIMMER_MS(10 + i * 7));
+    }
+    uint64_t ticks = 100000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t i = 0; i < ticks; i++) {
+        cc_timer_run(CC_TIMER_TICK_US);
+    }
+    bench_report("cc_timer_tick_1000_timers", ticks, 0, now_ns() - t0);
+    for (int i = 0; i < TIMER_NUM; i++) {
+        cc_timer_delete(&timers[i]);
+    }
+}
+
+static void bench_http_chunked(void)
+{
+    // 64 个 48 字节的块，按 TCP 报文大小分段到达
+    static char resp[8192];
+    int len = sprintf(resp, "HTTP/1.1 200 OK\r\nContent-Type: application/json\r\nTransfer-Encoding: chunked\r\n\r\n");
+    for (int i = 0; i < 64; i++) {
+        len += sprintf(resp + len, "30\r\n%048d\r\n", i);
+    }
+    len += sprintf(resp + len, "0\r\n\r\n");
+
+    static http_client_t client;
+    static http_client_data_t data;
+    static char body[4096];
+    http_client_prepare(&data, 2048, 4096);
+    uint64_t rounds = 20000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        int body_len;
+        http_fake_conn_set(resp, len, 1460);
+        http_fake_conn_recv_all(&client, &data, body, sizeof(body), &body_len);
+        s_sink += body_len;
+    }
+    bench_report("http_chunked_parse_3k", rounds, rounds * len, now_ns() - t0);
+    http_client_unprepare(&data);
+}
+
+// 一块 240x30 的 LVGL 绘制缓冲：逐像素旋转后再单独交换字节（端口原来的做法）对比合成一遍的 ui_pixel。
+// x86 会把前者的简单循环自动向量化，Xtensa 不会；接近目标的对比用 -DCMAKE_C_FLAGS=-fno-tree-vectorize 构建
+static void bench_ui_pixel(void)
+{
+    enum { W = 240, H = 30 };
+    static uint16_t src[W * H];
+    static uint16_t dst[W * H];
+    for (int i = 0; i < W * H; i++) {
+        src[i] = (uint16_t)(i * 40503u);
+    }
+    uint64_t rounds = 20000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        for (int32_t x = 0; x < W; x++) {
+            for (int32_t y = 0; y < H; y++) {
+                dst[(W - x - 1) * H + y] = src[y * W + x];
+            }
+        }
+        for (int i = 0; i < W * H; i++) {
+            dst[i] = (uint16_t)((dst[i] >> 8) | (dst[i] << 8));
+        }
+        s_sink += dst[r % (W * H)];
+    }
+    bench_report("rgb565_rotate90_then_swap_240x30", rounds, rounds * sizeof(src), now_ns() - t0);
+
+    t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        ui_pixel_rotate565(src, dst, W, H, W, H, UI_PIXEL_ROTATE_90, true);
+        s_sink += dst[r % (W * H)];
+    }
+    bench_report("ui_pixel_rotate90_swap_240x30", rounds, rounds * sizeof(src), now_ns() - t0);
+
+    t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        ui_pixel_swap565(dst, W * H);
+        s_sink += dst[r % (W * H)];
+    }
+    bench_report("ui_pixel_swap_240x30", rounds, rounds * sizeof(src), now_ns() - t0);
+}
+
+// 云端 16k 单声道语音转到 48k 扬声器，每次 10 ms；ns_per_op 为每块耗时
+static void bench_audio_dsp(void)
+{
+    enum { IN = 160, OUT = 480 };
+    static int16_t in[IN];
+    static int16_t out[OUT];
+    static int32_t acc[OUT * 2];
+    static int16_t mixed[OUT * 2];
+    audio_dsp_rs_t *rs = malloc(sizeof(*rs));
+    if (!rs || !audio_dsp_rs_init(rs, 16000, 48000, 1)) {
+        free(rs);
+        return;
+    }
+    for (int i = 0; i < IN; i++) {
+        in[i] = (int16_t)(i * 409);
+    }
+    uint64_t rounds = 200000 / s_scale;
+    uint64_t t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        size_t used;
+        s_sink += audio_dsp_rs_process(rs, in, IN, 1, &used, out, OUT);
+    }
+    bench_report("audio_rs_16k_to_48k_10ms", rounds, rounds * sizeof(out), now_ns() - t0);
+
+    t0 = now_ns();
+    for (uint64_t r = 0; r < rounds; r++) {
+        memset(acc, 0, sizeof(acc));
+        audio_dsp_mix_add(acc, 2, out, 1, OUT, AUDIO_DSP_GAIN_UNITY / 2);
+        audio_dsp_mix_add(acc, 2, out, 1, OUT, AUDIO_DSP_GAIN_UNITY);
+        audio_dsp_mix_out(acc, mixed, OUT * 2);
+        s_sink += mixed[r % (OUT * 2)];
+    }
+    bench_report("audio_mix_2src_stereo_48k_10ms", rounds, rounds * sizeof(mixed), now_ns() - t0);
+    audio_dsp_rs_deinit(rs);
+    free(rs);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && strcmp(argv[1], "--quick") == 0) {
+        s_scale = 100;
+    }
+    bench_rbuffer_spsc();
+    bench_frame_parser();
+    bench_frame_parser_resync();
+    bench_uart_parse();
+    bench_uart_parse_resync();
+    bench_crc16();
+    bench_cc_pool();
+    bench_cc_timer();
+    bench_http_chunked();
+    bench_ui_pixel();
+    bench_audio_dsp();
+    return 0;
+}
@@ -0,0 +1,57 @@
+#ifndef HOST_TEST_H
+#define HOST_TEST_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+
+/*
+ * 极简断言：失败时打印位置并从当前用例返回，host_test_main.c 汇总结果，有失败时进程返回非 0
+ */
+extern int g_host_test_failed;
+
+#define HT_ASSERT(cond) do { \
+        if (!(cond)) { \
+            printf("%s:%d: FAIL: %s\n", __FILE__, __LINE__, #cond); \
+            g_host_test_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define HT_ASSERT_EQ(expect, actual) do { \
+        long long _e = (long long)(expect), _a = (long long)(actual); \
+        if (_e != _a) { \
+            printf("%s:%d: FAIL: %s == %s (%lld != %lld)\n", __FILE__, __LINE__, #expect, #actual, _e, _a); \
+            g_host_test_failed = 1; \
+            return; \
+        } \
+    } while (0)
+
+#define HT_ASSERT_MEM_EQ(expect, actual, len) HT_ASSERT(memcmp((expect), (actual), (len)) == 0)
+
+// 各测试文件的用例表
+typedef struct {
+    const char *name;
+    void (*fn)(void);
+} host_test_case_t;
+
+#define HT_CASE(fn)     { #fn, fn }
+
+extern const host_test_case_t g_rbuffer_cases[];
+extern const host_test_case_t g_frame_parser_cases[];
+extern const host_test_case_t g_cc_cases[];
+extern const host_test_case_t g_uart_parse_cases[];
+extern const host_test_case_t g_http_parse_cases[];
+extern const host_test_case_t g_upload_resp_cases[];
+extern const host_test_case_t g_img_roi_cases[];
+extern const host_test_case_t g_ui_pixel_cases[];
+extern const host_test_case_t g_audio_dsp_cases[];
+extern const host_test_case_t g_call_rtp_cases[];
+extern const host_test_case_t g_tunables_cases[];
+extern const host_test_case_t g_crash_pack_cases[];
+extern const host_test_case_t g_json_scan_cases[];
+extern const host_test_case_t g_uac_fifo_cases[];
+extern const host_test_case_t g_checksum_cases[];
+
+#endif // HOST_TEST_H
@@ -0,0 +1,48 @@
+// 主机单元测试入口：依次运行各模块的用例，可用参数过滤用例名（子串匹配）
+#include <stdio.h>
+#include <string.h>
+#include "host_test.h"
+
+int g_host_test_failed;
+
+static const host_test_case_t *const s_suites[] = {
+    g_rbuffer_cases,
+    g_frame_parser_cases,
+    g_cc_cases,
+    g_uart_parse_cases,
+    g_http_parse_cases,
+    g_upload_resp_cases,
+    g_img_roi_cases,
+    g_ui_pixel_cases,
+    g_audio_dsp_cases,
+    g_call_rtp_cases,
+    g_tunables_cases,
+    g_crash_pack_cases,
+    g_json_scan_cases,
+    g_uac_fifo_cases,
+    g_checksum_cases,
+};
+
+int main(int argc, char **argv)
+{
+    const char *filter = argc > 1 ? argv[1] : NULL;
+    int run = 0;
+    int failed = 0;
+
+    for (size_t i = 0; i < sizeof(s_suites) / sizeof(s_suites[0]); i++) {
+        for (const host_test_case_t *tc = s_suites[i]; tc->name; tc++) {
+            if (filter && !strstr(tc->name, filter)) {
+                continue;
+            }
+            g_host_test_failed = 0;
+            tc->fn();
+            run++;
+            if (g_host_test_failed) {
+                failed++;
+            }
+            printf("%s %s\n", g_host_test_failed ? "FAIL" : "PASS", tc->name);
+        }
+    }
+    printf("%d tests, %d failures\n", run, failed);
+    return failed ? 1 : 0;
+}
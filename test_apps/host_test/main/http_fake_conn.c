@@ -0,0 +1,69 @@
+#include <string.h>
+#include "http_fake_conn.h"
+#include "http_wrappers.h"
+
+static const char *s_resp;
+static int s_len;
+static int s_pos;
+static int s_segment;
+
+void http_fake_conn_set(const char *response, int len, int segment)
+{
+    s_resp = response;
+    s_len = len;
+    s_pos = 0;
+    s_segment = segment > 0 ? segment : len;
+}
+
+int http_tcp_conn_wrapper(http_client_t *client, const char *host)
+{
+    return 0;
+}
+
+int http_tcp_close_wrapper(http_client_t *client)
+{
+    return 0;
+}
+
+int http_tcp_send_wrapper(http_client_t *client, const char *data, int length)
+{
+    return length;
+}
+
+int http_tcp_recv_wrapper(http_client_t *client, char *buf, int buflen, int timeout_ms, int *p_read_len)
+{
+    int n = s_len - s_pos;
+    if (n > buflen) {
+        n = buflen;
+    }
+    if (n > s_segment) {
+        n = s_segment;
+    }
+    memcpy(buf, s_resp + s_pos, n);
+    s_pos += n;
+    *p_read_len = n;
+    return n ? HTTP_SUCCESS : HTTP_ECLSD;
+}
+
+HTTPC_RESULT http_fake_conn_recv_all(http_client_t *client, http_client_data_t *data, char *body_buf, int body_cap, int *body_len)
+{
+    HTTPC_RESULT ret;
+    *body_len = 0;
+    memset(client, 0, sizeof(*client));
+    client->is_http = true;
+    client->socket = 0;
+    http_client_reset(data);
+    do {
+        ret = http_client_recv(client, data);
+        if (ret < 0) {
+            break;
+        }
+        int n = data->response_len;
+        if (*body_len + n > body_cap) {
+            n = body_cap - *body_len;
+        }
+        memcpy(body_buf + *body_len, data->response_buf, n);
+        *body_len += n;
+    } while (data->is_more && ret == HTTP_EAGAIN);
+    return ret;
+}
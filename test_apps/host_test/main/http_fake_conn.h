@@ -0,0 +1,18 @@
+#ifndef HTTP_FAKE_CONN_H
+#define HTTP_FAKE_CONN_H
+
+#include "http_client.h"
+
+/*
+ * 替代 http_aos_wrapper.c 的 TCP 收发：接收数据来自内存中的响应，每次最多返回 segment 字节，
+ * 用来模拟响应被拆成多次到达；数据读完后返回 HTTP_ECLSD
+ */
+void http_fake_conn_set(const char *response, int len, int segment);
+
+/**
+ * 准备好 client 与 client_data 并解析整个响应（含 is_more 时的后续读取），
+ * body 拼接到 body_buf，返回最后一次 http_client_recv 的结果
+ */
+HTTPC_RESULT http_fake_conn_recv_all(http_client_t *client, http_client_data_t *data, char *body_buf, int body_cap, int *body_len);
+
+#endif // HTTP_FAKE_CONN_H
@@ -0,0 +1,180 @@
+#include <stdlib.h>
+#include <math.h>
+#include "host_test.h"
+#include "audio_dsp.h"
+
+// 单频点的幅度（Goertzel），用于检查通带增益和镜像抑制
+static double tone_amp(const int16_t *x, size_t n, size_t stride, double freq, double rate)
+{
+    double w = 2 * M_PI * freq / rate;
+    double c = 2 * cos(w);
+    double s1 = 0, s2 = 0;
+    for (size_t i = 0; i < n; i++) {
+        double s0 = x[i * stride] + c * s1 - s2;
+        s2 = s1;
+        s1 = s0;
+    }
+    return 2 * sqrt(s1 * s1 + s2 * s2 - c * s1 * s2) / n;
+}
+
+// 按不规则的块大小送入，输出缓冲每次也只给一小段，最后取完历史中剩下的输出
+static size_t feed(audio_dsp_rs_t *rs, const int16_t *in, size_t frames, uint8_t in_ch, int16_t *out, size_t out_max)
+{
+    static const size_t chunks[] = {37, 1, 160, 5, 511};
+    size_t off = 0, produced = 0, k = 0;
+    while (off < frames) {
+        size_t n = chunks[k++ % 5];
+        if (n > frames - off) {
+            n = frames - off;
+        }
+        size_t used = 0;
+        size_t total_used = 0;
+        while (total_used < n) {
+            size_t got = audio_dsp_rs_process(rs, in + (off + total_used) * in_ch, n - total_used, in_ch, &used,
+                                              out + produced * rs->ch, out_max - produced < 64 ? out_max - produced : 64);
+            produced += got;
+            total_used += used;
+            if (got == 0 && used == 0) {
+                break;
+            }
+        }
+        off += n;
+    }
+    // 已写入历史、因输出缓冲满而没算完的部分
+    size_t used = 0;
+    size_t got;
+    while ((got = audio_dsp_rs_process(rs, NULL, 0, in_ch, &used, out + produced * rs->ch, out_max - produced)) > 0) {
+        produced += got;
+    }
+    return produced;
+}
+
+// 相同采样率直接拷贝，双声道输入混缩为单声道
+static void test_audio_dsp_passthrough(void)
+{
+    audio_dsp_rs_t *rs = malloc(sizeof(*rs));
+    int16_t in[8] = {100, 300, -200, -400, 32767, 32767, -32768, -32768};
+    int16_t out[8];
+    size_t used = 0;
+    HT_ASSERT(audio_dsp_rs_init(rs, 16000, 16000, 1));
+    HT_ASSERT(rs->coef == NULL);
+    HT_ASSERT_EQ(4, audio_dsp_rs_process(rs, in, 4, 2, &used, out, 8));
+    HT_ASSERT_EQ(4, used);
+    HT_ASSERT_EQ(200, out[0]);
+    HT_ASSERT_EQ(-300, out[1]);
+    HT_ASSERT_EQ(32767, out[2]);
+    HT_ASSERT_EQ(-32768, out[3]);
+    HT_ASSERT_EQ(2, audio_dsp_rs_process(rs, in, 4, 1, &used, out, 2));
+    HT_ASSERT_EQ(2, used);
+    HT_ASSERT_MEM_EQ(in, out, 2 * sizeof(int16_t));
+    audio_dsp_rs_deinit(rs);
+    // 约分后 up 太大的比例不支持
+    HT_ASSERT(!audio_dsp_rs_init(rs, 11025, 48000, 1));
+    HT_ASSERT(!audio_dsp_rs_init(rs, 16000, 48000, 3));
+    free(rs);
+}
+
+// 8k -> 48k：输出正好是输入的 6 倍，直流增益为 1，1 kHz 幅度不变，7 kHz 镜像被滤掉
+static void test_audio_dsp_upsample(void)
+{
+    enum { IN = 800, OUT = IN * 6 };
+    audio_dsp_rs_t *rs = malloc(sizeof(*rs));
+    int16_t *in = malloc(IN * sizeof(int16_t));
+    int16_t *out = malloc(OUT * sizeof(int16_t));
+    HT_ASSERT(rs && in && out);
+    HT_ASSERT(audio_dsp_rs_init(rs, 8000, 48000, 1));
+    HT_ASSERT_EQ(6, rs->up);
+    HT_ASSERT_EQ(1, rs->down);
+
+    for (int i = 0; i < IN; i++) {
+        in[i] = 1000;
+    }
+    HT_ASSERT_EQ(OUT, feed(rs, in, IN, 1, out, OUT));
+    for (int i = 200; i < OUT; i++) {
+        HT_ASSERT(abs(out[i] - 1000) <= 2);
+    }
+
+    audio_dsp_rs_reset(rs);
+    for (int i = 0; i < IN; i++) {
+        in[i] = (int16_t)lrint(10000 * sin(2 * M_PI * 1000 * i / 8000.0));
+    }
+    HT_ASSERT_EQ(OUT, feed(rs, in, IN, 1, out, OUT));
+    // 跳过滤波器延迟，取整数个周期
+    double amp = tone_amp(out + 480, 4320, 1, 1000, 48000);
+    double image = tone_amp(out + 480, 4320, 1, 7000, 48000);
+    HT_ASSERT(fabs(amp - 10000) < 300);
+    HT_ASSERT(image < 100);
+    audio_dsp_rs_deinit(rs);
+    free(rs);
+    free(in);
+    free(out);
+}
+
+// 44.1k -> 48k 双声道：两个声道分别转换，帧数比例正确
+static void test_audio_dsp_fractional(void)
+{
+    enum { IN = 4410 };
+    audio_dsp_rs_t *rs = malloc(sizeof(*rs));
+    int16_t *in = malloc(IN * 2 * sizeof(int16_t));
+    int16_t *out = malloc(5000 * 2 * sizeof(int16_t));
+    HT_ASSERT(rs && in && out);
+    HT_ASSERT(audio_dsp_rs_init(rs, 44100, 48000, 2));
+    HT_ASSERT_EQ(160, rs->up);
+    HT_ASSERT_EQ(147, rs->down);
+    for (int i = 0; i < IN; i++) {
+        in[2 * i] = (int16_t)lrint(8000 * sin(2 * M_PI * 1000 * i / 44100.0));
+        in[2 * i + 1] = (int16_t)lrint(4000 * sin(2 * M_PI * 3000 * i / 44100.0));
+    }
+    size_t n = feed(rs, in, IN, 2, out, 5000);
+    HT_ASSERT_EQ(4800, n);
+    HT_ASSERT(fabs(tone_amp(out + 2 * 240, 4320, 2, 1000, 48000) - 8000) < 250);
+    HT_ASSERT(fabs(tone_amp(out + 2 * 240 + 1, 4320, 2, 3000, 48000) - 4000) < 150);
+    HT_ASSERT(tone_amp(out + 2 * 240, 4320, 2, 3000, 48000) < 20);
+    audio_dsp_rs_deinit(rs);
+    free(rs);
+    free(in);
+    free(out);
+}
+
+// 48k -> 16k：输出为输入的 1/3，1 kHz 幅度不变
+static void test_audio_dsp_downsample(void)
+{
+    enum { IN = 4800 };
+    audio_dsp_rs_t *rs = malloc(sizeof(*rs));
+    int16_t *in = malloc(IN * sizeof(int16_t));
+    int16_t *out = malloc(IN * sizeof(int16_t));
+    HT_ASSERT(rs && in && out);
+    HT_ASSERT(audio_dsp_rs_init(rs, 48000, 16000, 1));
+    for (int i = 0; i < IN; i++) {
+        in[i] = (int16_t)lrint(10000 * sin(2 * M_PI * 1000 * i / 48000.0));
+    }
+    HT_ASSERT_EQ(IN / 3, feed(rs, in, IN, 1, out, IN));
+    HT_ASSERT(fabs(tone_amp(out + 160, 1440, 1, 1000, 16000) - 10000) < 300);
+    audio_dsp_rs_deinit(rs);
+    free(rs);
+    free(in);
+    free(out);
+}
+
+// 单声道源加到双声道，增益 Q12，输出饱和
+static void test_audio_dsp_mix(void)
+{
+    int32_t acc[6] = {0};
+    int16_t mono[3] = {1000, -2000, 30000};
+    int16_t stereo[6] = {1, 2, 3, 4, 30000, -30000};
+    int16_t out[6];
+    audio_dsp_mix_add(acc, 2, mono, 1, 3, AUDIO_DSP_GAIN_UNITY / 2);
+    audio_dsp_mix_add(acc, 2, stereo, 2, 3, AUDIO_DSP_GAIN_UNITY);
+    audio_dsp_mix_out(acc, out, 6);
+    static const int16_t expect[6] = {501, 502, -997, -996, 32767, -15000};
+    HT_ASSERT_MEM_EQ(expect, out, sizeof(expect));
+}
+
+const host_test_case_t g_audio_dsp_cases[] = {
+    HT_CASE(test_audio_dsp_passthrough),
+    HT_CASE(test_audio_dsp_upsample),
+    HT_CASE(test_audio_dsp_fractional),
+    HT_CASE(test_audio_dsp_downsample),
+    HT_CASE(test_audio_dsp_mix),
+    { NULL, NULL },
+};
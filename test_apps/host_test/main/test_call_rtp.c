@@ -0,0 +1,147 @@
+#include "host_test.h"
+#include "call_rtp.h"
+
+// 写出的固定头能解析回来，CSRC、扩展头与填充被跳过
+static void test_call_rtp_header(void)
+{
+    uint8_t buf[64];
+    call_rtp_hdr_t in = { .pt = 97, .marker = true, .seq = 0xFFFE, .ts = 0x12345678, .ssrc = 0xDEADBEEF };
+    call_rtp_hdr_t out;
+    size_t plen = 0;
+    call_rtp_write_hdr(buf, &in);
+    memset(buf + CALL_RTP_HDR_LEN, 0xAA, 8);
+    HT_ASSERT_EQ(CALL_RTP_HDR_LEN, call_rtp_parse(buf, CALL_RTP_HDR_LEN + 8, &out, &plen));
+    HT_ASSERT_EQ(8, plen);
+    HT_ASSERT_EQ(97, out.pt);
+    HT_ASSERT(out.marker);
+    HT_ASSERT_EQ(0xFFFE, out.seq);
+    HT_ASSERT_EQ(0x12345678, out.ts);
+    HT_ASSERT_EQ(0xDEADBEEF, out.ssrc);
+
+    // 1 个 CSRC + 1 个字的扩展头 + 3 字节填充
+    static const uint8_t ext[] = {
+        0xB1, 0x61, 0x00, 0x01, 0, 0, 0, 1, 0, 0, 0, 2,
+        0, 0, 0, 3,
+        0xBE, 0xDE, 0x00, 0x01, 1, 2, 3, 4,
+        0x55, 0x66, 0, 0, 3,
+    };
+    HT_ASSERT_EQ(24, call_rtp_parse(ext, sizeof(ext), &out, &plen));
+    HT_ASSERT_EQ(2, plen);
+    HT_ASSERT_EQ(0x61, out.pt);
+
+    // 版本不对、扩展头越界、填充过长
+    buf[0] = 0x40;
+    HT_ASSERT_EQ(-1, call_rtp_parse(buf, CALL_RTP_HDR_LEN + 8, &out, &plen));
+    HT_ASSERT_EQ(-1, call_rtp_parse(ext, 18, &out, &plen));
+    uint8_t pad[CALL_RTP_HDR_LEN + 2];
+    call_rtp_write_hdr(pad, &in);
+    pad[0] |= 0x20;
+    pad[sizeof(pad) - 1] = 20;
+    HT_ASSERT_EQ(-1, call_rtp_parse(pad, sizeof(pad), &out, &plen));
+}
+
+static bool put_seq(call_jbuf_t *jb, uint16_t seq)
+{
+    uint8_t data[4] = { (uint8_t)seq, (uint8_t)(seq >> 8), 0x5A, 0xA5 };
+    return call_jbuf_put(jb, seq, data, sizeof(data));
+}
+
+// 取出的包返回其序号，缺包返回 -2，攒包中返回 -1
+static int get_seq(call_jbuf_t *jb)
+{
+    uint8_t out[CALL_JBUF_PAYLOAD_MAX];
+    int n = call_jbuf_get(jb, out, sizeof(out));
+    if (n < 0) {
+        return -1;
+    }
+    if (n == 0) {
+        return -2;
+    }
+    return out[0] | (out[1] << 8);
+}
+
+// 攒够 depth 个包才开始播放，乱序到达按序号取出
+static void test_call_jbuf_reorder(void)
+{
+    static call_jbuf_t jb;
+    call_jbuf_init(&jb, 3);
+    HT_ASSERT(put_seq(&jb, 101));
+    HT_ASSERT_EQ(-1, get_seq(&jb));
+    HT_ASSERT(put_seq(&jb, 103));
+    HT_ASSERT(put_seq(&jb, 102));
+    HT_ASSERT_EQ(101, get_seq(&jb));
+    HT_ASSERT(put_seq(&jb, 105));
+    HT_ASSERT(put_seq(&jb, 104));
+    HT_ASSERT_EQ(102, get_seq(&jb));
+    HT_ASSERT_EQ(103, get_seq(&jb));
+    HT_ASSERT_EQ(104, get_seq(&jb));
+    HT_ASSERT_EQ(105, get_seq(&jb));
+    HT_ASSERT_EQ(0, jb.stats.lost);
+}
+
+// 缺包返回 0 并计数，过期与重复的包丢弃
+static void test_call_jbuf_loss(void)
+{
+    static call_jbuf_t jb;
+    call_jbuf_init(&jb, 2);
+    put_seq(&jb, 10);
+    put_seq(&jb, 12);
+    put_seq(&jb, 13);
+    HT_ASSERT_EQ(10, get_seq(&jb));
+    HT_ASSERT_EQ(-2, get_seq(&jb));
+    HT_ASSERT_EQ(1, jb.stats.lost);
+    // 11 已过播放时刻
+    HT_ASSERT(!put_seq(&jb, 11));
+    HT_ASSERT_EQ(1, jb.stats.late);
+    HT_ASSERT(!put_seq(&jb, 13));
+    HT_ASSERT_EQ(1, jb.stats.dup);
+    HT_ASSERT_EQ(12, get_seq(&jb));
+    HT_ASSERT_EQ(13, get_seq(&jb));
+}
+
+// 取空后重新攒包，期间到达的旧包仍算过期；序号 0xFFFF -> 0 回绕
+static void test_call_jbuf_rebuffer_wrap(void)
+{
+    static call_jbuf_t jb;
+    call_jbuf_init(&jb, 2);
+    put_seq(&jb, 0xFFFE);
+    put_seq(&jb, 0xFFFF);
+    HT_ASSERT_EQ(0xFFFE, get_seq(&jb));
+    HT_ASSERT_EQ(0xFFFF, get_seq(&jb));
+    HT_ASSERT_EQ(-2, get_seq(&jb));
+    HT_ASSERT_EQ(1, jb.stats.rebuffer);
+    HT_ASSERT(!jb.playing);
+    HT_ASSERT(!put_seq(&jb, 0xFFFF));
+    put_seq(&jb, 1);
+    HT_ASSERT_EQ(-1, get_seq(&jb));
+    put_seq(&jb, 2);
+    // 接着取空时的位置继续播放
+    HT_ASSERT_EQ(1, get_seq(&jb));
+    HT_ASSERT_EQ(2, get_seq(&jb));
+    HT_ASSERT_EQ(1, jb.stats.lost);
+}
+
+// 序号超前超过槽位数（对端重启）时清空，从新序号重新攒包
+static void test_call_jbuf_overflow(void)
+{
+    static call_jbuf_t jb;
+    uint8_t big[CALL_JBUF_PAYLOAD_MAX + 1] = {0};
+    call_jbuf_init(&jb, 1);
+    HT_ASSERT(!call_jbuf_put(&jb, 1, big, sizeof(big)));
+    put_seq(&jb, 500);
+    put_seq(&jb, 501);
+    HT_ASSERT_EQ(500, get_seq(&jb));
+    HT_ASSERT(put_seq(&jb, 501 + CALL_JBUF_SLOTS));
+    HT_ASSERT_EQ(1, jb.stats.overflow);
+    HT_ASSERT_EQ(1, jb.count);
+    HT_ASSERT_EQ(501 + CALL_JBUF_SLOTS, get_seq(&jb));
+}
+
+const host_test_case_t g_call_rtp_cases[] = {
+    HT_CASE(test_call_rtp_header),
+    HT_CASE(test_call_jbuf_reorder),
+    HT_CASE(test_call_jbuf_loss),
+    HT_CASE(test_call_jbuf_rebuffer_wrap),
+    HT_CASE(test_call_jbuf_overflow),
+    { NULL, NULL },
+};
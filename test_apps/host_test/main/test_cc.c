@@ -0,0 +1,220 @@
+#include "host_test.h"
+#include "cc_list.h"
+#include "cc_timer.h"
+#include "cc_worker.h"
+
+static int match_int(cc_list_node *node, void *data)
+{
+    return *(int *)node->data == *(int *)data;
+}
+
+static void test_cc_list(void)
+{
+    int v[4] = {10, 20, 30, 40};
+    cc_list_node *list = cc_list_create(&v[0]);
+    HT_ASSERT(list != NULL);
+    cc_list_insert_end(list, &v[2]);
+    cc_list_insert_after(list, &v[1]);
+    list = cc_list_insert_beginning(list, &v[3]);
+
+    int expect[4] = {40, 10, 20, 30};
+    int i = 0;
+    for (cc_list_node *n = list; n; n = n->next, i++) {
+        HT_ASSERT(i < 4);
+        HT_ASSERT_EQ(expect[i], *(int *)n->data);
+    }
+    HT_ASSERT_EQ(4, i);
+
+    int key = 20;
+    cc_list_node *found = cc_list_find(list, match_int, &key);
+    HT_ASSERT(found && found->data == &v[1]);
+    cc_list_remove_by_data(&list, &v[3]);
+    HT_ASSERT(list->data == &v[0]);
+    HT_ASSERT(cc_list_find_by_data(list, &v[3]) == NULL);
+    cc_list_destroy(&list);
+    HT_ASSERT(list == NULL);
+}
+
+typedef struct {
+    int id;
+    cc_dlist_node_t node;
+} dl_item_t;
+
+static void test_cc_dlist(void)
+{
+    cc_dlist_t list = CC_DLIST_INIT;
+    dl_item_t items[3] = {{1}, {2}, {3}};
+    cc_dlist_push_back(&list, &items[1].node);
+    cc_dlist_push_back(&list, &items[2].node);
+    cc_dlist_push_front(&list, &items[0].node);
+    HT_ASSERT_EQ(3, list.count);
+    cc_dlist_remove(&list, &items[1].node);
+    HT_ASSERT_EQ(2, list.count);
+
+    cc_dlist_node_t *n = cc_dlist_pop_front(&list);
+    HT_ASSERT_EQ(1, cc_dlist_entry(n, dl_item_t, node)->id);
+    n = cc_dlist_pop_front(&list);
+    HT_ASSERT_EQ(3, cc_dlist_entry(n, dl_item_t, node)->id);
+    HT_ASSERT(cc_dlist_pop_front(&list) == NULL);
+    HT_ASSERT(list.head == NULL && list.tail == NULL);
+}
+
+CC_POOL_DEFINE(s_test_pool, 24, 4);
+
+static void test_cc_pool(void)
+{
+    void *elem[5];
+    cc_pool_init(&s_test_pool, s_test_pool_buf, 24, 4);
+    for (int i = 0; i < 4; i++) {
+        elem[i] = cc_pool_alloc(&s_test_pool);
+        HT_ASSERT(elem[i] != NULL);
+        HT_ASSERT(cc_pool_owns(&s_test_pool, elem[i]));
+    }
+    HT_ASSERT(cc_pool_alloc(&s_test_pool) == NULL);
+    int on_stack;
+    HT_ASSERT(!cc_pool_owns(&s_test_pool, &on_stack));
+    cc_pool_free(&s_test_pool, elem[2]);
+    elem[4] = cc_pool_alloc(&s_test_pool);
+    HT_ASSERT(elem[4] == elem[2]);
+}
+
+typedef struct {
+    int count;
+    uint64_t last_us;
+} timer_probe_t;
+
+static uint64_t s_now_us;
+
+static void timer_probe_cb(void *arg)
+{
+    timer_probe_t *probe = arg;
+    probe->count++;
+    probe->last_us = s_now_us;
+}
+
+// 以 CC_TIMER_TICK_US 为步长推进虚拟时间
+static void timer_advance(uint64_t us)
+{
+    for (uint64_t t = 0; t < us; t += CC_TIMER_TICK_US) {
+        s_now_us += CC_TIMER_TICK_US;
+        cc_timer_run(CC_TIMER_TICK_US);
+    }
+}
+
+static void timer_setup(void)
+{
+    static bool inited;
+    if (!inited) {
+        cc_timer_init();
+        inited = true;
+    }
+}
+
+static void test_cc_timer_periodic_once(void)
+{
+    timer_setup();
+    timer_probe_t periodic = {0}, once = {0};
+    cc_timer_config_t cfg = { .type = CC_TIMER_TYPE_SW, .callback = timer_probe_cb, .arg = &periodic };
+    cc_timer_handle_t tp = cc_timer_create(&cfg);
+    cfg.arg = &once;
+    cc_timer_handle_t to = cc_timer_create(&cfg);
+    HT_ASSERT(tp && to);
+
+    s_now_us = 0;
+    HT_ASSERT_EQ(CC_OK, cc_timer_start_periodic(tp, CC_TIMMER_MS(100)));
+    HT_ASSERT_EQ(CC_OK, cc_timer_start_once(to, CC_TIMMER_MS(250)));
+    HT_ASSERT_EQ(CC_TIMMER_MS(100), cc_timer_next_us());
+    timer_advance(CC_TIMMER_MS(1000));
+    HT_ASSERT_EQ(10, periodic.count);
+    HT_ASSERT_EQ(1, once.count);
+    HT_ASSERT_EQ(CC_TIMMER_MS(250), once.last_us);
+
+    cc_timer_stop(tp);
+    timer_advance(CC_TIMMER_MS(300));
+    HT_ASSERT_EQ(10, periodic.count);
+    HT_ASSERT_EQ(CC_TIMER_NO_DEADLINE, cc_timer_next_us());
+    cc_timer_delete(&tp);
+    cc_timer_delete(&to);
+}
+
+// 超出第 0 层范围的定时器经过下放后在准确的 tick 触发
+static void test_cc_timer_cascade(void)
+{
+    timer_setup();
+    timer_probe_t far = {0};
+    cc_timer_config_t cfg = { .type = CC_TIMER_TYPE_SW, .callback = timer_probe_cb, .arg = &far };
+    cc_timer_handle_t t = cc_timer_create(&cfg);
+    HT_ASSERT(t != NULL);
+    s_now_us = 0;
+    uint64_t delay = CC_TIMMER_MS(123450);
+    cc_timer_start_once(t, delay);
+    timer_advance(delay + CC_TIMMER_MS(100));
+    HT_ASSERT_EQ(1, far.count);
+    HT_ASSERT_EQ(delay, far.last_us);
+    cc_timer_delete(&t);
+}
+
+static cc_os_semphr_handle_t s_worker_gate[2];
+static cc_os_semphr_handle_t s_worker_done;
+static char s_worker_order[8];
+static int s_worker_order_len;
+
+static void worker_block_job(void *arg)
+{
+    cc_hal_os_semphr_take(arg, CC_OS_MAX_DELAY);
+}
+
+static void worker_record_job(void *arg)
+{
+    s_worker_order[s_worker_order_len++] = (char)(intptr_t)arg;
+    cc_hal_os_semphr_give(s_worker_done);
+}
+
+static void worker_noop_job(void *arg)
+{
+}
+
+// 工作任务全部阻塞时作业排队；放开一个后按优先级取出，池满时提交失败
+static void test_cc_worker(void)
+{
+    HT_ASSERT_EQ(CC_OK, cc_worker_init());
+    s_worker_done = cc_hal_os_semphr_create_counting(16, 0);
+    for (int i = 0; i < 2; i++) {
+        s_worker_gate[i] = cc_hal_os_semphr_create_binary();
+        HT_ASSERT_EQ(CC_OK, cc_worker_submit(worker_block_job, s_worker_gate[i], CC_WORKER_PRIO_LOW));
+    }
+    while (cc_worker_pending()) {
+        cc_hal_os_task_delay(1);
+    }
+
+    HT_ASSERT_EQ(CC_OK, cc_worker_submit(worker_record_job, (void *)'L', CC_WORKER_PRIO_LOW));
+    HT_ASSERT_EQ(CC_OK, cc_worker_submit(worker_record_job, (void *)'N', CC_WORKER_PRIO_NORMAL));
+    HT_ASSERT_EQ(CC_OK, cc_worker_submit(worker_record_job, (void *)'H', CC_WORKER_PRIO_HIGH));
+    int submitted = 3;
+    while (cc_worker_submit(worker_noop_job, NULL, CC_WORKER_PRIO_LOW) == CC_OK) {
+        submitted++;
+    }
+    HT_ASSERT_EQ(16, submitted);
+    HT_ASSERT_EQ(16, cc_worker_pending());
+    HT_ASSERT_EQ(CC_ERR_INVALID_ARG, cc_worker_submit(worker_noop_job, NULL, CC_WORKER_PRIO_MAX));
+
+    cc_hal_os_semphr_give(s_worker_gate[0]);
+    for (int i = 0; i < 3; i++) {
+        HT_ASSERT_EQ(CC_OK, cc_hal_os_semphr_take(s_worker_done, 1000));
+    }
+    HT_ASSERT_MEM_EQ("HNL", s_worker_order, 3);
+    cc_hal_os_semphr_give(s_worker_gate[1]);
+    while (cc_worker_pending()) {
+        cc_hal_os_task_delay(1);
+    }
+}
+
+const host_test_case_t g_cc_cases[] = {
+    HT_CASE(test_cc_list),
+    HT_CASE(test_cc_dlist),
+    HT_CASE(test_cc_pool),
+    HT_CASE(test_cc_timer_periodic_once),
+    HT_CASE(test_cc_timer_cascade),
+    HT_CASE(test_cc_worker),
+    { NULL, NULL },
+};
@@ -0,0 +1,55 @@
+#include <stdlib.h>
+#include "host_test.h"
+#include "checksum.h"
+
+static uint32_t ref_sum8(const uint8_t *data, size_t len)
+{
+    uint32_t sum = 0;
+    for (size_t i = 0; i < len; i++) {
+        sum += data[i];
+    }
+    return sum;
+}
+
+// 起点错开 0..15 字节、长度跨过字路径和 PIE 路径（64 字节起）的边界，都与逐字节相加一致
+static void test_checksum_sum8(void)
+{
+    enum { BUF_LEN = 4096 + 32 };
+    uint8_t *buf = malloc(BUF_LEN);
+    HT_ASSERT(buf);
+    for (int i = 0; i < BUF_LEN; i++) {
+        buf[i] = (uint8_t)(i * 2654435761u >> 13);
+    }
+    static const size_t lens[] = {0, 1, 3, 4, 15, 16, 17, 63, 64, 65, 79, 127, 128, 129, 255, 513, 1031, 4096};
+    for (int off = 0; off < 16; off++) {
+        for (size_t n = 0; n < sizeof(lens) / sizeof(lens[0]); n++) {
+            HT_ASSERT_EQ(ref_sum8(buf + off, lens[n]), checksum_sum8(buf + off, lens[n]));
+        }
+    }
+    // 全 0xFF 时 16 位通道最满
+    memset(buf, 0xFF, BUF_LEN);
+    HT_ASSERT_EQ(255u * 4099, checksum_sum8(buf + 3, 4099));
+    free(buf);
+}
+
+// 分段累加与一次算完相同，段界落在任意位置
+static void test_checksum_sum8_chunked(void)
+{
+    uint8_t buf[1000];
+    for (size_t i = 0; i < sizeof(buf); i++) {
+        buf[i] = (uint8_t)(i * 31 + 7);
+    }
+    uint32_t whole = ref_sum8(buf, sizeof(buf));
+    for (size_t cut = 0; cut <= sizeof(buf); cut += 37) {
+        uint32_t sum = checksum_sum8_update(0, buf, cut);
+        sum = checksum_sum8_update(sum, buf + cut, sizeof(buf) - cut);
+        HT_ASSERT_EQ(whole, sum);
+    }
+    HT_ASSERT_EQ(5, checksum_sum8_update(5, NULL, 10));
+}
+
+const host_test_case_t g_checksum_cases[] = {
+    HT_CASE(test_checksum_sum8),
+    HT_CASE(test_checksum_sum8_chunked),
+    { NULL, NULL },
+};
@@ -0,0 +1,96 @@
+#include "host_test.h"
+#include "crash_pack.h"
+
+// heatshrink 解码（-w 8 -l 4），返回解出的字节数
+static size_t hs_decode(const uint8_t *in, size_t len, uint8_t *out, size_t cap)
+{
+    size_t bit = 0;
+    size_t n = 0;
+#define TAKE(cnt) ({ uint32_t v_ = 0; for (int k_ = 0; k_ < (cnt); k_++, bit++) { \
+        v_ = (v_ << 1) | ((in[bit >> 3] >> (7 - (bit & 7))) & 1); } v_; })
+    while (bit + 9 <= len * 8 && n < cap) {
+        if (TAKE(1)) {
+            out[n++] = (uint8_t)TAKE(8);
+        } else {
+            if (bit + CRASH_PACK_WINDOW + CRASH_PACK_LOOKAHEAD > len * 8) {
+                break;
+            }
+            size_t dist = TAKE(CRASH_PACK_WINDOW) + 1;
+            size_t cnt = TAKE(CRASH_PACK_LOOKAHEAD) + 1;
+            for (size_t i = 0; i < cnt && n < cap; i++, n++) {
+                out[n] = out[n - dist];
+            }
+        }
+    }
+#undef TAKE
+    return n;
+}
+
+static size_t unblock(const uint8_t *blk, uint8_t *out)
+{
+    uint16_t raw = blk[0] | (blk[1] << 8);
+    uint16_t stored = blk[2] | (blk[3] << 8);
+    if (stored & CRASH_PACK_STORED) {
+        memcpy(out, blk + CRASH_PACK_BLOCK_HDR_LEN, stored & ~CRASH_PACK_STORED);
+        return stored & ~CRASH_PACK_STORED;
+    }
+    return stored >= raw ? 0 : hs_decode(blk + CRASH_PACK_BLOCK_HDR_LEN, stored, out, raw);
+}
+
+// 栈这类以填充值和小整数为主的数据压缩后能还原，且明显变短
+static void test_crash_pack_roundtrip(void)
+{
+    static crash_pack_t p;
+    static uint8_t in[CRASH_PACK_BLOCK];
+    static uint8_t blk[CRASH_PACK_BLOCK_MAX];
+    static uint8_t out[CRASH_PACK_BLOCK];
+    memset(in, 0xA5, sizeof(in));
+    for (size_t i = 0; i < 600; i++) {
+        in[3000 + i] = (uint8_t)(i % 7 == 0 ? i : i >> 4);
+    }
+    memcpy(in + 100, "abcabcabcabcabcabcabcabcabc", 27);
+    size_t len = crash_pack_block(&p, in, sizeof(in), blk);
+    HT_ASSERT(len > CRASH_PACK_BLOCK_HDR_LEN && len < sizeof(in) / 4);
+    HT_ASSERT_EQ(0, (blk[3] << 8) & CRASH_PACK_STORED);
+    HT_ASSERT_EQ(sizeof(in), unblock(blk, out));
+    HT_ASSERT(memcmp(in, out, sizeof(in)) == 0);
+
+    // 短块与一个字节
+    HT_ASSERT_EQ(CRASH_PACK_BLOCK_HDR_LEN + 1, crash_pack_block(&p, in, 1, blk));
+    HT_ASSERT_EQ(1, unblock(blk, out));
+    HT_ASSERT_EQ(0xA5, out[0]);
+    HT_ASSERT_EQ(0, crash_pack_block(&p, in, CRASH_PACK_BLOCK + 1, blk));
+}
+
+// 压不短的数据原样存储
+static void test_crash_pack_stored(void)
+{
+    static crash_pack_t p;
+    static uint8_t in[1024];
+    static uint8_t blk[CRASH_PACK_BLOCK_MAX];
+    static uint8_t out[sizeof(in)];
+    uint32_t x = 12345;
+    for (size_t i = 0; i < sizeof(in); i++) {
+        x = x * 1103515245u + 12345u;
+        in[i] = (uint8_t)(x >> 16);
+    }
+    HT_ASSERT_EQ(CRASH_PACK_BLOCK_HDR_LEN + sizeof(in), crash_pack_block(&p, in, sizeof(in), blk));
+    HT_ASSERT(blk[3] & (CRASH_PACK_STORED >> 8));
+    HT_ASSERT_EQ(sizeof(in), unblock(blk, out));
+    HT_ASSERT(memcmp(in, out, sizeof(in)) == 0);
+
+    uint8_t hdr[CRASH_PACK_HDR_LEN + CRASH_PACK_SEC_HDR_LEN];
+    HT_ASSERT_EQ(CRASH_PACK_HDR_LEN, crash_pack_header(hdr));
+    HT_ASSERT_EQ(CRASH_PACK_SEC_HDR_LEN, crash_pack_section(hdr + CRASH_PACK_HDR_LEN, CRASH_SEC_COREDUMP, 0x12345));
+    HT_ASSERT(memcmp(hdr, "GSCD", 4) == 0);
+    HT_ASSERT_EQ(CRASH_PACK_WINDOW, hdr[5]);
+    HT_ASSERT_EQ(CRASH_SEC_COREDUMP, hdr[8]);
+    HT_ASSERT_EQ(0x45, hdr[12]);
+    HT_ASSERT_EQ(0x01, hdr[14]);
+}
+
+const host_test_case_t g_crash_pack_cases[] = {
+    HT_CASE(test_crash_pack_roundtrip),
+    HT_CASE(test_crash_pack_stored),
+    { NULL, NULL },
+};
@@ -0,0 +1,89 @@
+#include "host_test.h"
+#include "frame_parser.h"
+
+// 帧：0xBB 0x22 | cmd | len | data(len) | crc（解析器不校验 crc）
+static uint32_t make_frame(uint8_t *buf, uint8_t cmd, const uint8_t *data, uint8_t len)
+{
+    buf[0] = FRAME_PARSER_HEAD & 0xFF;
+    buf[1] = FRAME_PARSER_HEAD >> 8;
+    buf[2] = cmd;
+    buf[3] = len;
+    memcpy(buf + 4, data, len);
+    buf[4 + len] = 0x5A;
+    return 5 + len;
+}
+
+static void parser_setup(void)
+{
+    static bool inited;
+    if (!inited) {
+        frame_parser_init(256);
+        inited = true;
+    }
+    frame_parser_reset();
+}
+
+static void test_frame_parser_noise_and_split(void)
+{
+    parser_setup();
+    uint8_t frame[32];
+    uint8_t out[FRAME_MAX_LEN];
+    uint32_t out_len = 0;
+    uint8_t data[3] = {1, 2, 3};
+    uint32_t len = make_frame(frame, 0x31, data, sizeof(data));
+    uint8_t noise[5] = {0x00, 0xBB, 0x00, 0x22, 0xFF};
+
+    frame_parser_add_buf(noise, sizeof(noise));
+    frame_parser_add_buf(frame, 3);
+    HT_ASSERT(!frame_parser_get_frame(out, &out_len));
+    frame_parser_add_buf(frame + 3, len - 3);
+    HT_ASSERT(frame_parser_get_frame(out, &out_len));
+    HT_ASSERT_EQ(len, out_len);
+    HT_ASSERT_MEM_EQ(frame, out, len);
+    HT_ASSERT(!frame_parser_get_frame(out, &out_len));
+}
+
+static void test_frame_parser_back_to_back(void)
+{
+    parser_setup();
+    uint8_t buf[64];
+    uint8_t out[FRAME_MAX_LEN];
+    uint32_t out_len = 0;
+    uint8_t data[4] = {9, 8, 7, 6};
+    uint32_t len1 = make_frame(buf, 0x01, data, 4);
+    uint32_t len2 = make_frame(buf + len1, 0x02, data, 2);
+
+    frame_parser_add_buf(buf, len1 + len2);
+    HT_ASSERT(frame_parser_get_frame(out, &out_len));
+    HT_ASSERT_EQ(0x01, out[2]);
+    HT_ASSERT(frame_parser_get_frame(out, &out_len));
+    HT_ASSERT_EQ(0x02, out[2]);
+    HT_ASSERT_EQ(len2, out_len);
+}
+
+// 长度超过 FRAME_MAX_LEN 的帧头被跳过，随后的正常帧仍能解析
+static void test_frame_parser_bad_len_resync(void)
+{
+    parser_setup();
+    uint8_t buf[64];
+    uint8_t out[FRAME_MAX_LEN];
+    uint32_t out_len = 0;
+    uint8_t data[2] = {0xAB, 0xCD};
+    buf[0] = 0xBB;
+    buf[1] = 0x22;
+    buf[2] = 0x10;
+    buf[3] = 0xF0;
+    uint32_t len = make_frame(buf + 4, 0x20, data, 2);
+
+    frame_parser_add_buf(buf, 4 + len);
+    HT_ASSERT(frame_parser_get_frame(out, &out_len));
+    HT_ASSERT_EQ(0x20, out[2]);
+    HT_ASSERT_EQ(len, out_len);
+}
+
+const host_test_case_t g_frame_parser_cases[] = {
+    HT_CASE(test_frame_parser_noise_and_split),
+    HT_CASE(test_frame_parser_back_to_back),
+    HT_CASE(test_frame_parser_bad_len_resync),
+    { NULL, NULL },
+};
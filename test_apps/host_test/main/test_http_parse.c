@@ -0,0 +1,98 @@
+#include <stdlib.h>
+#include "host_test.h"
+#include "http_client.h"
+#include "http_fake_conn.h"
+
+#define HTTP_TEST_BUF_SIZE      4096
+
+static http_client_t s_client;
+static http_client_data_t s_data;
+static char s_body[16384];
+
+static int http_parse(const char *resp, int segment, int *body_len)
+{
+    if (!s_data.header_buf) {
+        http_client_prepare(&s_data, HTTP_TEST_BUF_SIZE, HTTP_TEST_BUF_SIZE);
+    }
+    http_fake_conn_set(resp, strlen(resp), segment);
+    return http_fake_conn_recv_all(&s_client, &s_data, s_body, sizeof(s_body), body_len);
+}
+
+static void test_http_content_length(void)
+{
+    static const char resp[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Content-Type: application/json\r\n"
+        "Content-Length:   13  \r\n"
+        "X-Empty:\r\n"
+        "\r\n"
+        "{\"code\":\"ok\"}";
+    // 整段到达、逐字节到达、以及任意拆分，结果都一样
+    static const int segments[] = {0, 1, 7, 64};
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        int body_len = 0;
+        HT_ASSERT_EQ(HTTP_SUCCESS, http_parse(resp, segments[i], &body_len));
+        HT_ASSERT_EQ(200, http_client_get_response_code(&s_client));
+        HT_ASSERT_EQ(13, body_len);
+        HT_ASSERT_MEM_EQ("{\"code\":\"ok\"}", s_body, 13);
+        HT_ASSERT(!s_data.is_more);
+
+        const char *value;
+        int value_len;
+        HT_ASSERT(http_client_get_header(&s_data, "content-length", &value, &value_len) == 0);
+        HT_ASSERT_EQ(2, value_len);
+        HT_ASSERT_MEM_EQ("13", value, 2);
+        HT_ASSERT(http_client_get_header(&s_data, "X-Empty", &value, &value_len) == 0);
+        HT_ASSERT_EQ(0, value_len);
+        HT_ASSERT(http_client_get_header(&s_data, "Location", &value, &value_len) != 0);
+    }
+}
+
+static void test_http_chunked(void)
+{
+    static const char resp[] =
+        "HTTP/1.1 200 OK\r\n"
+        "Transfer-Encoding: chunked\r\n"
+        "\r\n"
+        "5\r\nhello\r\n"
+        "1;ext=1\r\n,\r\n"
+        "6\r\n world\r\n"
+        "0\r\n\r\n";
+    static const int segments[] = {0, 1, 3, 16};
+    for (size_t i = 0; i < sizeof(segments) / sizeof(segments[0]); i++) {
+        int body_len = 0;
+        HT_ASSERT_EQ(HTTP_SUCCESS, http_parse(resp, segments[i], &body_len));
+        HT_ASSERT(s_data.is_chunked);
+        HT_ASSERT_EQ(12, body_len);
+        HT_ASSERT_MEM_EQ("hello, world", s_body, 12);
+        HT_ASSERT_EQ(12, s_data.response_content_len);
+    }
+}
+
+static void test_http_no_body_and_redirect(void)
+{
+    int body_len = 0;
+    HT_ASSERT_EQ(HTTP_SUCCESS, http_parse("HTTP/1.1 204 No Content\r\nServer: x\r\n\r\n", 0, &body_len));
+    HT_ASSERT_EQ(204, http_client_get_response_code(&s_client));
+    HT_ASSERT_EQ(0, body_len);
+
+    HT_ASSERT_EQ(HTTP_SUCCESS, http_parse("HTTP/1.1 302 Found\r\nLocation: http://a.b/c\r\nContent-Length: 0\r\n\r\n", 5, &body_len));
+    HT_ASSERT(s_data.is_redirected);
+    HT_ASSERT(strcmp(s_data.redirect_url, "http://a.b/c") == 0);
+    http_client_unprepare(&s_data);
+}
+
+static void test_http_bad_status(void)
+{
+    int body_len = 0;
+    HT_ASSERT_EQ(HTTP_EPROTO, http_parse("HTTX 200\r\n\r\n", 0, &body_len));
+    http_client_unprepare(&s_data);
+}
+
+const host_test_case_t g_http_parse_cases[] = {
+    HT_CASE(test_http_content_length),
+    HT_CASE(test_http_chunked),
+    HT_CASE(test_http_no_body_and_redirect),
+    HT_CASE(test_http_bad_status),
+    { NULL, NULL },
+};
@@ -0,0 +1,77 @@
+#include "host_test.h"
+#include "img_roi.h"
+
+// 单个框：四周扩边后对齐到 16，越出画面的部分截掉
+static void test_img_roi_single(void)
+{
+    img_roi_box_t box = { .x = 100, .y = 50, .w = 200, .h = 300, .score = 90 };
+    img_thumb_rect_t r;
+    uint8_t scale = 0xFF;
+    HT_ASSERT(img_roi_select(&box, 1, 1280, 720, 20, 640 * 480, &r, &scale));
+    HT_ASSERT_EQ(48, r.x);
+    HT_ASSERT_EQ(0, r.y);
+    HT_ASSERT_EQ(304, r.w);
+    HT_ASSERT_EQ(416, r.h);
+    HT_ASSERT_EQ(0, scale);
+    HT_ASSERT(!img_roi_select(&box, 0, 1280, 720, 20, 640 * 480, &r, &scale));
+}
+
+// 多个框取并集，区域过大时缩小到不超过像素上限
+static void test_img_roi_union_scale(void)
+{
+    img_roi_box_t boxes[] = {
+        { .x = 0, .y = 0, .w = 100, .h = 100, .score = 60 },
+        { .x = 1100, .y = 600, .w = 180, .h = 120, .score = 70 },
+    };
+    img_thumb_rect_t r;
+    uint8_t scale = 0;
+    HT_ASSERT(img_roi_select(boxes, 2, 1280, 720, 20, 640 * 480, &r, &scale));
+    HT_ASSERT_EQ(0, r.x);
+    HT_ASSERT_EQ(0, r.y);
+    HT_ASSERT_EQ(1280, r.w);
+    HT_ASSERT_EQ(720, r.h);
+    HT_ASSERT_EQ(1, scale);
+    HT_ASSERT(img_roi_select(boxes, 2, 1280, 720, 20, 100, &r, &scale));
+    HT_ASSERT_EQ(3, scale);
+}
+
+// 换算到缩小坐标时起点向下、终点向上取整，不丢掉边缘像素
+static void test_img_roi_scale_rect(void)
+{
+    img_thumb_rect_t in = { .x = 48, .y = 0, .w = 304, .h = 416 };
+    img_thumb_rect_t out;
+    img_roi_scale_rect(&in, 1, &out);
+    HT_ASSERT_EQ(24, out.x);
+    HT_ASSERT_EQ(0, out.y);
+    HT_ASSERT_EQ(152, out.w);
+    HT_ASSERT_EQ(208, out.h);
+    in = (img_thumb_rect_t){ .x = 17, .y = 9, .w = 10, .h = 10 };
+    img_roi_scale_rect(&in, 2, &out);
+    HT_ASSERT_EQ(4, out.x);
+    HT_ASSERT_EQ(2, out.y);
+    HT_ASSERT_EQ(3, out.w);
+    HT_ASSERT_EQ(3, out.h);
+}
+
+static void test_img_roi_meta_json(void)
+{
+    img_roi_box_t boxes[] = {
+        { .x = 100, .y = 50, .w = 200, .h = 300, .score = 90 },
+        { .x = 400, .y = 60, .w = 80, .h = 160, .score = 55 },
+    };
+    img_thumb_rect_t roi = { .x = 48, .y = 0, .w = 464, .h = 416 };
+    char buf[128];
+    const char *expect = "{\"id\":7,\"w\":1280,\"h\":720,\"roi\":[48,0,464,416],"
+                         "\"boxes\":[[100,50,200,300,90],[400,60,80,160,55]]}";
+    HT_ASSERT_EQ(strlen(expect), img_roi_meta_json(buf, sizeof(buf), 7, 1280, 720, &roi, boxes, 2));
+    HT_ASSERT(strcmp(buf, expect) == 0);
+    HT_ASSERT_EQ(0, img_roi_meta_json(buf, 32, 7, 1280, 720, &roi, boxes, 2));
+}
+
+const host_test_case_t g_img_roi_cases[] = {
+    HT_CASE(test_img_roi_single),
+    HT_CASE(test_img_roi_union_scale),
+    HT_CASE(test_img_roi_scale_rect),
+    HT_CASE(test_img_roi_meta_json),
+    { NULL, NULL },
+};
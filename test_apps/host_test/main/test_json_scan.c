@@ -0,0 +1,82 @@
+#include "host_test.h"
+#include "json_scan.h"
+
+// 配网消息：字段顺序任意，嵌套值与未登记的字段跳过，转义解码为 UTF-8
+static void test_json_scan_fields(void)
+{
+    const char *js = "{\"token\":\"t0k\",\"extra\":{\"ssid\":\"no\",\"a\":[1,2,{}]},"
+                     "\"ssid\":\"caf\\u00e9 \\\"5G\\\"\",\"password\":\"p\\\\w\\ud83d\\ude00\",\"n\":-1.5e3,\"ok\":true}";
+    char ssid[33], password[65], token[33], region[4];
+    const json_scan_field_t fields[] = {
+        { "ssid", ssid, sizeof(ssid), JSON_SCAN_REQUIRED },
+        { "password", password, sizeof(password), JSON_SCAN_REQUIRED },
+        { "token", token, sizeof(token), JSON_SCAN_REQUIRED },
+        { "region", region, sizeof(region), 0 },
+    };
+    uint32_t found = 0;
+    HT_ASSERT_EQ(JSON_SCAN_OK, json_scan_fields(js, strlen(js), fields, 4, &found));
+    HT_ASSERT_EQ(0x7, found);
+    HT_ASSERT(strcmp(ssid, "caf\xc3\xa9 \"5G\"") == 0);
+    HT_ASSERT(strcmp(password, "p\\w\xf0\x9f\x98\x80") == 0);
+    HT_ASSERT(strcmp(token, "t0k") == 0);
+    HT_ASSERT_EQ(0, region[0]);
+
+    // 按长度解析，后面的字节不读；结尾的 '\0' 视为结束
+    const char *cut = "{\"ssid\":\"a\",\"password\":\"b\",\"token\":\"c\",\"region\":\"CN\"}garbage";
+    HT_ASSERT_EQ(JSON_SCAN_OK, json_scan_fields(cut, strlen(cut) - 7, fields, 4, &found));
+    HT_ASSERT_EQ(0xf, found);
+    HT_ASSERT(strcmp(region, "CN") == 0);
+    char nul[] = "{\"ssid\":\"a\",\"password\":\"b\",\"token\":\"c\"}\0{";
+    HT_ASSERT_EQ(JSON_SCAN_OK, json_scan_fields(nul, sizeof(nul) - 1, fields, 4, &found));
+    HT_ASSERT_EQ(0x7, found);
+
+    HT_ASSERT_EQ(JSON_SCAN_ERR_MISSING, json_scan_fields("{\"ssid\":\"a\",\"token\":\"c\"}", 24, fields, 4, NULL));
+    HT_ASSERT_EQ(JSON_SCAN_ERR_TYPE, json_scan_fields("{\"ssid\":1}", 10, fields, 4, NULL));
+    HT_ASSERT_EQ(JSON_SCAN_ERR_TYPE, json_scan_fields("[\"ssid\"]", 8, fields, 4, NULL));
+    const char *long_region = "{\"ssid\":\"a\",\"region\":\"ABCD\",\"token\":\"c\"}";
+    HT_ASSERT_EQ(JSON_SCAN_ERR_LEN, json_scan_fields(long_region, strlen(long_region), fields, 4, &found));
+    HT_ASSERT_EQ(0x5, found);
+    HT_ASSERT_EQ(0, region[0]);
+}
+
+static void test_json_scan_errors(void)
+{
+    json_tok_t toks[8];
+    const char *bad[] = {
+        "{\"a\" 1}", "{1:2}", "{\"a\":1]", "[1}", "{\"a\":\"\\x\"}", "{\"a\":\"\\u12g4\"}",
+        "{\"a\":\"x\ny\"}", "{\"a\":@}", "{\"a\"::1}", "{{}}",
+    };
+    for (size_t i = 0; i < sizeof(bad) / sizeof(bad[0]); i++) {
+        int ret = json_scan_parse(bad[i], strlen(bad[i]), toks, 8);
+        if (ret >= 0) {
+            printf("accepted: %s\n", bad[i]);
+        }
+        HT_ASSERT(ret < 0);
+    }
+    HT_ASSERT_EQ(JSON_SCAN_ERR_PART, json_scan_parse("{\"a\":[1,2", 9, toks, 8));
+    HT_ASSERT_EQ(JSON_SCAN_ERR_PART, json_scan_parse("{\"a\":\"xy", 8, toks, 8));
+    HT_ASSERT_EQ(JSON_SCAN_ERR_NOMEM, json_scan_parse("[1,2,3,4,5,6,7,8]", 17, toks, 8));
+
+    // 键后没有值、孤立的代理项
+    char out[8];
+    const json_scan_field_t f = { "a", out, sizeof(out), 0 };
+    HT_ASSERT_EQ(JSON_SCAN_ERR_INVAL, json_scan_fields("{\"a\"}", 5, &f, 1, NULL));
+    HT_ASSERT_EQ(JSON_SCAN_ERR_LEN, json_scan_fields("{\"a\":\"\\udc00\"}", 14, &f, 1, NULL));
+
+    // token 结构：对象 size 为键数，键 size 为 1
+    HT_ASSERT_EQ(5, json_scan_parse(" {\"k\": [true, null]} ", 21, toks, 8));
+    HT_ASSERT_EQ(JSON_TOK_OBJECT, toks[0].type);
+    HT_ASSERT_EQ(1, toks[0].size);
+    HT_ASSERT(json_scan_eq(" {\"k\": [true, null]} ", &toks[1], "k"));
+    HT_ASSERT_EQ(1, toks[1].size);
+    HT_ASSERT_EQ(JSON_TOK_ARRAY, toks[2].type);
+    HT_ASSERT_EQ(2, toks[2].size);
+    HT_ASSERT_EQ(JSON_TOK_PRIMITIVE, toks[4].type);
+    HT_ASSERT_EQ(4, toks[4].end - toks[4].start);
+}
+
+const host_test_case_t g_json_scan_cases[] = {
+    HT_CASE(test_json_scan_fields),
+    HT_CASE(test_json_scan_errors),
+    { NULL, NULL },
+};
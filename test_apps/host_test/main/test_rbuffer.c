@@ -0,0 +1,128 @@
+#include <pthread.h>
+#include <sched.h>
+#include "host_test.h"
+#include "rbuffer.h"
+#include "rbuffer_spsc.h"
+
+static void test_rbuffer_wrap(void)
+{
+    rbuffer_handle_t rb = rbuffer_create(8);
+    HT_ASSERT(rb != NULL);
+    uint8_t in[8] = {1, 2, 3, 4, 5, 6, 7, 8};
+    uint8_t out[8];
+
+    HT_ASSERT_EQ(6, rbuffer_push(rb, in, 6, false));
+    HT_ASSERT_EQ(4, rbuffer_pop(rb, out, 4));
+    HT_ASSERT_MEM_EQ(in, out, 4);
+    // 写满时不覆盖只写入剩余空间，写位置回绕
+    HT_ASSERT_EQ(6, rbuffer_push(rb, in, 8, false));
+    HT_ASSERT(rbuffer_is_full(rb));
+    HT_ASSERT_EQ(8, rbuffer_pop(rb, out, 8));
+    uint8_t expect[8] = {5, 6, 1, 2, 3, 4, 5, 6};
+    HT_ASSERT_MEM_EQ(expect, out, 8);
+    HT_ASSERT(rbuffer_is_empty(rb));
+    rbuffer_delete(rb);
+}
+
+static void test_rbuffer_peek_find(void)
+{
+    rbuffer_handle_t rb = rbuffer_create(8);
+    uint8_t in[8] = {0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17};
+    uint8_t out[8];
+    rbuffer_span_t span[2];
+
+    rbuffer_push(rb, in, 6, false);
+    rbuffer_pop(rb, out, 5);
+    rbuffer_push(rb, in, 6, false);
+    // 读位置 5，数据跨越缓冲末尾
+    HT_ASSERT_EQ(7, rbuffer_peek(rb, 0, span));
+    HT_ASSERT_EQ(3, span[0].len);
+    HT_ASSERT_EQ(4, span[1].len);
+    HT_ASSERT_EQ(0x15, span[0].data[0]);
+    HT_ASSERT_EQ(0x10, span[0].data[1]);
+    HT_ASSERT_EQ(0x13, span[1].data[1]);
+    HT_ASSERT_EQ(4, rbuffer_find_byte(rb, 0, 0x13));
+    HT_ASSERT_EQ(-1, rbuffer_find_byte(rb, 5, 0x13));
+    HT_ASSERT_EQ(3, rbuffer_commit_read(rb, 3));
+    HT_ASSERT_EQ(4, rbuffer_used_size(rb));
+    rbuffer_delete(rb);
+}
+
+static void test_rbuffer_spsc_basic(void)
+{
+    HT_ASSERT(rbuffer_spsc_create(12) == NULL);
+    rbuffer_spsc_handle_t rb = rbuffer_spsc_create(16);
+    HT_ASSERT(rb != NULL);
+    uint8_t in[20];
+    uint8_t out[20];
+    for (int i = 0; i < 20; i++) {
+        in[i] = i;
+    }
+    HT_ASSERT_EQ(16, rbuffer_spsc_push(rb, in, 20));
+    HT_ASSERT_EQ(0, rbuffer_spsc_available_size(rb));
+    HT_ASSERT_EQ(10, rbuffer_spsc_pop(rb, out, 10));
+    HT_ASSERT_EQ(8, rbuffer_spsc_push(rb, in, 8));
+    rbuffer_span_t span[2];
+    HT_ASSERT_EQ(14, rbuffer_spsc_peek(rb, 0, span));
+    HT_ASSERT_EQ(6, span[0].len);
+    HT_ASSERT_EQ(8, span[1].len);
+    HT_ASSERT_EQ(8, rbuffer_spsc_find_byte(rb, 0, 2));
+    HT_ASSERT_EQ(14, rbuffer_spsc_pop(rb, out, 20));
+    uint8_t expect[14] = {10, 11, 12, 13, 14, 15, 0, 1, 2, 3, 4, 5, 6, 7};
+    HT_ASSERT_MEM_EQ(expect, out, 14);
+    rbuffer_spsc_delete(rb);
+}
+
+#define SPSC_STRESS_BYTES   (4 * 1024 * 1024)
+
+static void *spsc_producer(void *arg)
+{
+    rbuffer_spsc_handle_t rb = arg;
+    uint8_t chunk[61];
+    uint32_t sent = 0;
+    while (sent < SPSC_STRESS_BYTES) {
+        uint32_t n = SPSC_STRESS_BYTES - sent < sizeof(chunk) ? SPSC_STRESS_BYTES - sent : sizeof(chunk);
+        for (uint32_t i = 0; i < n; i++) {
+            chunk[i] = (uint8_t)((sent + i) * 7);
+        }
+        uint32_t pushed = rbuffer_spsc_push(rb, chunk, n);
+        if (!pushed) {
+            sched_yield();      // 单核机器上让出给消费者
+        }
+        sent += pushed;
+    }
+    return NULL;
+}
+
+// 两个线程并发读写，检查字节序列不丢不乱
+static void test_rbuffer_spsc_threads(void)
+{
+    rbuffer_spsc_handle_t rb = rbuffer_spsc_create(1024);
+    pthread_t producer;
+    pthread_create(&producer, NULL, spsc_producer, rb);
+    uint8_t out[97];
+    uint32_t received = 0;
+    int bad = 0;
+    while (received < SPSC_STRESS_BYTES) {
+        uint32_t n = rbuffer_spsc_pop(rb, out, sizeof(out));
+        if (!n) {
+            sched_yield();
+        }
+        for (uint32_t i = 0; i < n; i++) {
+            bad |= out[i] != (uint8_t)((received + i) * 7);
+        }
+        received += n;
+    }
+    pthread_join(producer, NULL);
+    HT_ASSERT(!bad);
+    HT_ASSERT_EQ(0, rbuffer_spsc_used_size(rb));
+    rbuffer_spsc_delete(rb);
+}
+
+const host_test_case_t g_rbuffer_cases[] = {
+    HT_CASE(test_rbuffer_wrap),
+    HT_CASE(test_rbuffer_peek_find),
+    HT_CASE(test_rbuffer_spsc_basic),
+    HT_CASE(test_rbuffer_spsc_threads),
+    { NULL, NULL },
+};
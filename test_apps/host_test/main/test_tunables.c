@@ -0,0 +1,95 @@
+#include "host_test.h"
+#include "tunables.h"
+
+// 登记表是全局的，各用例用各自的参数名，版本号只增不减
+static tunable_t s_period = TUNABLE_INT_INIT("test.period_ms", 3000, 500, 15000);
+static tunable_t s_enable = TUNABLE_BOOL_INIT("test.enable", 0);
+static tunable_t s_late = TUNABLE_INT_INIT("test.late", 10, 0, 100);
+static int s_changed;
+
+static void on_period_changed(tunable_t *t)
+{
+    s_changed++;
+}
+
+// 整批校验：任一项不通过都不改动；版本号须递增
+static void test_tunables_apply(void)
+{
+    s_period.on_change = on_period_changed;
+    tunables_register(&s_period);
+    tunables_register(&s_period);
+    tunables_register(&s_enable);
+    HT_ASSERT(tunables_find("test.period_ms") == &s_period);
+    HT_ASSERT(tunables_find("test.nope") == NULL);
+
+    size_t bad = 0;
+    tunables_set_t range[] = { { "test.enable", 1 }, { "test.period_ms", 100 } };
+    HT_ASSERT_EQ(TUNABLES_RANGE, tunables_apply(10, range, 2, &bad));
+    HT_ASSERT_EQ(1, bad);
+    tunables_set_t unknown[] = { { "test.period_ms", 1000 }, { "test.nope", 1 } };
+    HT_ASSERT_EQ(TUNABLES_UNKNOWN, tunables_apply(10, unknown, 2, &bad));
+    HT_ASSERT_EQ(1, bad);
+    HT_ASSERT_EQ(3000, tunable_get(&s_period));
+    HT_ASSERT_EQ(0, tunable_get(&s_enable));
+    HT_ASSERT_EQ(0, s_changed);
+
+    tunables_set_t ok[] = { { "test.enable", 1 }, { "test.period_ms", 1000 } };
+    HT_ASSERT_EQ(TUNABLES_OK, tunables_apply(10, ok, 2, &bad));
+    HT_ASSERT_EQ(10, tunables_version());
+    HT_ASSERT_EQ(1000, tunable_get(&s_period));
+    HT_ASSERT_EQ(1, tunable_get(&s_enable));
+    HT_ASSERT_EQ(1, s_changed);
+    HT_ASSERT_EQ(TUNABLES_STALE, tunables_apply(10, ok, 2, &bad));
+
+    char json[256];
+    HT_ASSERT(tunables_values_json(json, sizeof(json)) > 0);
+    HT_ASSERT(strstr(json, "\"test.period_ms\":1000") != NULL);
+    HT_ASSERT(strstr(json, "\"test.enable\":true") != NULL);
+}
+
+// 保存的值在登记时生效，尚未登记的项原样保留，越界的值被忽略
+static void test_tunables_persist(void)
+{
+    uint8_t blob[TUNABLES_BLOB_MAX];
+    uint8_t again[TUNABLES_BLOB_MAX];
+    size_t len = tunables_encode(blob, sizeof(blob));
+    HT_ASSERT(len > 0);
+    HT_ASSERT_EQ(0, tunables_encode(blob, 16));
+
+    tunables_set_t restore[] = { { "test.period_ms", 3000 }, { "test.enable", 0 } };
+    HT_ASSERT_EQ(TUNABLES_OK, tunables_apply(11, restore, 2, NULL));
+    HT_ASSERT(tunables_decode(blob, len));
+    HT_ASSERT_EQ(10, tunables_version());
+    HT_ASSERT_EQ(1000, tunable_get(&s_period));
+    HT_ASSERT_EQ(1, tunable_get(&s_enable));
+
+    // 手工加入一项未登记参数 test.late = 42 后重新载入
+    blob[8]++;
+    uint32_t h = 2166136261u;
+    for (const char *p = "test.late"; *p; p++) {
+        h = (h ^ (uint8_t)*p) * 16777619u;
+    }
+    uint8_t entry[8] = { (uint8_t)h, (uint8_t)(h >> 8), (uint8_t)(h >> 16), (uint8_t)(h >> 24), 42, 0, 0, 0 };
+    memcpy(blob + len, entry, sizeof(entry));
+    HT_ASSERT(tunables_decode(blob, len + 8));
+    HT_ASSERT_EQ(len + 8, tunables_encode(again, sizeof(again)));
+    tunables_register(&s_late);
+    HT_ASSERT_EQ(42, tunable_get(&s_late));
+
+    // 长度不符或魔数不对
+    HT_ASSERT(!tunables_decode(blob, len + 4));
+    blob[0] ^= 1;
+    HT_ASSERT(!tunables_decode(blob, len + 8));
+
+    HT_ASSERT_EQ(TUNABLES_STALE, tunables_reset(10));
+    HT_ASSERT_EQ(TUNABLES_OK, tunables_reset(12));
+    HT_ASSERT_EQ(3000, tunable_get(&s_period));
+    HT_ASSERT_EQ(10, tunable_get(&s_late));
+    HT_ASSERT_EQ(12, tunables_encode(again, sizeof(again)));
+}
+
+const host_test_case_t g_tunables_cases[] = {
+    HT_CASE(test_tunables_apply),
+    HT_CASE(test_tunables_persist),
+    { NULL, NULL },
+};
@@ -0,0 +1,48 @@
+#include "host_test.h"
+#include "uac_fifo_level.h"
+
+#define DEPTH   1920    // 10 ms，48 kHz 双声道 16 位
+#define CHUNK   192     // 每次读 1 ms
+
+// 开始播放前蓄到半满，之后每次够一块就读
+static void test_uac_fifo_prefill(void)
+{
+    bool prefill = true;
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PREFILL, uac_spk_fifo_next(&prefill, 0, DEPTH, CHUNK, true));
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PREFILL, uac_spk_fifo_next(&prefill, DEPTH / 2 - 1, DEPTH, CHUNK, true));
+    HT_ASSERT(prefill);
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PLAY, uac_spk_fifo_next(&prefill, DEPTH / 2, DEPTH, CHUNK, true));
+    HT_ASSERT(!prefill);
+    // 已在播放时低于半满也继续读
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PLAY, uac_spk_fifo_next(&prefill, CHUNK, DEPTH, CHUNK, true));
+}
+
+// 主机仍在发送时读空算一次欠载并重新蓄到半满；主机已停发只是回到等待，不计欠载
+static void test_uac_fifo_underrun(void)
+{
+    bool prefill = false;
+    HT_ASSERT_EQ(UAC_SPK_FIFO_UNDERRUN, uac_spk_fifo_next(&prefill, CHUNK - 1, DEPTH, CHUNK, true));
+    HT_ASSERT(prefill);
+    // 蓄满之前不会再报欠载
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PREFILL, uac_spk_fifo_next(&prefill, CHUNK, DEPTH, CHUNK, true));
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PLAY, uac_spk_fifo_next(&prefill, DEPTH / 2, DEPTH, CHUNK, true));
+
+    prefill = false;
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PREFILL, uac_spk_fifo_next(&prefill, 0, DEPTH, CHUNK, false));
+    HT_ASSERT(prefill);
+}
+
+// FIFO 比两块还浅时起播水位取一块，避免起播后立即欠载
+static void test_uac_fifo_shallow(void)
+{
+    bool prefill = true;
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PREFILL, uac_spk_fifo_next(&prefill, CHUNK - 1, CHUNK + 10, CHUNK, true));
+    HT_ASSERT_EQ(UAC_SPK_FIFO_PLAY, uac_spk_fifo_next(&prefill, CHUNK, CHUNK + 10, CHUNK, true));
+}
+
+const host_test_case_t g_uac_fifo_cases[] = {
+    HT_CASE(test_uac_fifo_prefill),
+    HT_CASE(test_uac_fifo_underrun),
+    HT_CASE(test_uac_fifo_shallow),
+    { NULL, NULL },
+};
@@ -0,0 +1,179 @@
+#include "host_test.h"
+#include "uart_parse.h"
+#include "uart_ext.h"
+#include "checksum.h"
+
+static int s_packets;
+static int s_ext_frames;
+static int s_bad;
+static uint8_t s_last_cmd;
+
+static void on_packet(const uart_packet_t *packet)
+{
+    s_packets++;
+    s_last_cmd = packet->command;
+}
+
+static bool on_ext_frame(const uint8_t *frame, size_t len)
+{
+    uint16_t crc = checksum_crc16(frame + 2, len - 4);
+    if (crc != (frame[len - 2] | (frame[len - 1] << 8))) {
+        return false;
+    }
+    s_ext_frames++;
+    s_last_cmd = frame[2];
+    return true;
+}
+
+static void on_bad_checksum(uint8_t calc, uint8_t recv)
+{
+    s_bad++;
+}
+
+static const uart_parse_ops_t s_ops = {
+    .on_packet = on_packet,
+    .on_ext_frame = on_ext_frame,
+    .on_bad_checksum = on_bad_checksum,
+};
+
+static void parse_reset(void)
+{
+    s_packets = 0;
+    s_ext_frames = 0;
+    s_bad = 0;
+    s_last_cmd = 0;
+}
+
+static size_t make_packet(uint8_t *buf, uint8_t cmd)
+{
+    uart_packet_t *p = (uart_packet_t *)buf;
+    memset(p, 0, sizeof(*p));
+    p->header[0] = 0xAA;
+    p->header[1] = 0x55;
+    p->command = cmd;
+    p->data[0] = 0xAA;      // 数据区中出现帧头字节
+    p->checksum = (uint8_t)checksum_sum8(buf, sizeof(*p) - 1);
+    return sizeof(*p);
+}
+
+static size_t make_ext(uint8_t *buf, uint8_t cmd, const uint8_t *payload, uint16_t len)
+{
+    buf[0] = UART_EXT_HEADER0;
+    buf[1] = UART_EXT_HEADER1;
+    buf[2] = cmd;
+    buf[3] = 0;
+    buf[4] = UART_EXT_FLAG_FIRST | UART_EXT_FLAG_LAST;
+    buf[5] = len & 0xFF;
+    buf[6] = len >> 8;
+    memcpy(buf + UART_EXT_HEAD_SIZE, payload, len);
+    uint16_t crc = checksum_crc16(buf + 2, UART_EXT_HEAD_SIZE - 2 + len);
+    buf[UART_EXT_HEAD_SIZE + len] = crc & 0xFF;
+    buf[UART_EXT_HEAD_SIZE + len + 1] = crc >> 8;
+    return UART_EXT_HEAD_SIZE + len + 2;
+}
+
+static void test_uart_parse_mixed(void)
+{
+    uint8_t buf[128];
+    uint8_t payload[20];
+    memset(payload, 0xAA, sizeof(payload));
+    size_t len = 0;
+    buf[len++] = 0x00;
+    buf[len++] = 0xAA;
+    len += make_packet(buf + len, 0x23);
+    len += make_ext(buf + len, 0x30, payload, sizeof(payload));
+    len += make_packet(buf + len, 0x42);
+
+    parse_reset();
+    HT_ASSERT_EQ(len, uart_parse_packets(buf, len, &s_ops));
+    HT_ASSERT_EQ(2, s_packets);
+    HT_ASSERT_EQ(1, s_ext_frames);
+    HT_ASSERT_EQ(0x42, s_last_cmd);
+}
+
+// 每次只多给一个字节，未消费的部分留到下次，结果与整段解析相同
+static void test_uart_parse_byte_by_byte(void)
+{
+    uint8_t buf[128];
+    uint8_t payload[5] = {1, 2, 3, 4, 5};
+    size_t len = make_ext(buf, 0x31, payload, sizeof(payload));
+    len += make_packet(buf + len, 0x10);
+
+    parse_reset();
+    size_t start = 0;
+    for (size_t end = 1; end <= len; end++) {
+        start += uart_parse_packets(buf + start, end - start, &s_ops);
+    }
+    HT_ASSERT_EQ(len, start);
+    HT_ASSERT_EQ(1, s_packets);
+    HT_ASSERT_EQ(1, s_ext_frames);
+}
+
+static void test_uart_parse_bad_checksum(void)
+{
+    uint8_t buf[64];
+    size_t len = make_packet(buf, 0x05);
+    buf[len - 1] ^= 0xFF;
+    len += make_packet(buf + len, 0x06);
+    uint8_t payload[3] = {7, 8, 9};
+    size_t ext = make_ext(buf + len, 0x32, payload, sizeof(payload));
+    buf[len + ext - 1] ^= 0x01;
+    len += ext;
+
+    parse_reset();
+    HT_ASSERT_EQ(len, uart_parse_packets(buf, len, &s_ops));
+    HT_ASSERT_EQ(1, s_bad);
+    HT_ASSERT_EQ(1, s_packets);
+    HT_ASSERT_EQ(0, s_ext_frames);
+    HT_ASSERT_EQ(0x06, s_last_cmd);
+}
+
+static void test_uart_parse_partial(void)
+{
+    uint8_t buf[64];
+    size_t len = make_packet(buf, 0x01);
+    size_t second = make_packet(buf + len, 0x02);
+
+    parse_reset();
+    HT_ASSERT_EQ(len, uart_parse_packets(buf, len + second - 3, &s_ops));
+    HT_ASSERT_EQ(1, s_packets);
+    // 扩展帧长度超过 UART_EXT_MAX_PAYLOAD 视为无效帧头
+    uint8_t bad_ext[UART_EXT_HEAD_SIZE] = {UART_EXT_HEADER0, UART_EXT_HEADER1, 0, 0, 0, 0xFF, 0xFF};
+    HT_ASSERT_EQ(SIZE_MAX, uart_ext_frame_len(bad_ext, sizeof(bad_ext)));
+    HT_ASSERT_EQ(0, uart_ext_frame_len(bad_ext, 3));
+}
+
+// 组出的包能被解析回来，数据区字段按小端序读写
+static void test_uart_packet_build(void)
+{
+    uart_packet_t packet;
+    uint8_t data[6] = {0};
+    data[0] = 0x01;
+    uart_put_le16(data + 1, 0x1234);
+    uart_put_le16(data + 3, 0xBEEF);
+    uart_packet_build(&packet, CMD_IMG_TRANSFER_RESULT, data);
+    HT_ASSERT_EQ(0x27, packet.command);
+    HT_ASSERT_EQ(0x34, packet.data[1]);
+    HT_ASSERT_EQ(0x1234, uart_get_le16(packet.data + 1));
+    HT_ASSERT_EQ(0xBEEF, uart_get_le16(packet.data + 3));
+
+    parse_reset();
+    HT_ASSERT_EQ(sizeof(packet), uart_parse_packets((const uint8_t *)&packet, sizeof(packet), &s_ops));
+    HT_ASSERT_EQ(1, s_packets);
+    HT_ASSERT_EQ(0x27, s_last_cmd);
+
+    uart_put_le32(data + 2, 0xA1B2C3D4);
+    HT_ASSERT_EQ(0xA1B2C3D4, uart_get_le32(data + 2));
+    uart_packet_build(&packet, CMD_EXIT_CONFIG_ACK, NULL);
+    HT_ASSERT_EQ(0, packet.data[0] | packet.data[5]);
+    HT_ASSERT_EQ((0xAA + 0x55 + 0x1B) & 0xFF, packet.checksum);
+}
+
+const host_test_case_t g_uart_parse_cases[] = {
+    HT_CASE(test_uart_parse_mixed),
+    HT_CASE(test_uart_parse_byte_by_byte),
+    HT_CASE(test_uart_parse_bad_checksum),
+    HT_CASE(test_uart_parse_partial),
+    HT_CASE(test_uart_packet_build),
+    { NULL, NULL },
+};
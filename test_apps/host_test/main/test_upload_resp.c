@@ -0,0 +1,74 @@
+#include "host_test.h"
+#include "upload_resp.h"
+
+static const char s_ok[] =
+    "{\"error\":0,\"meta\":{\"w\":[1,2,{\"x\":\"}\"}]},\"img_url\":\"http:\\/\\/host\\/a.jpg\",\"size\":123}";
+
+static void test_upload_resp_ok(void)
+{
+    upload_resp_t r;
+    upload_resp_init(&r);
+    upload_resp_feed(&r, s_ok, strlen(s_ok));
+    HT_ASSERT(upload_resp_complete(&r));
+    HT_ASSERT(r.has_error);
+    HT_ASSERT_EQ(0, r.error);
+    HT_ASSERT(strcmp(r.img_url, "http://host/a.jpg") == 0);
+    HT_ASSERT_EQ(0, r.msg[0]);
+}
+
+// 响应按任意位置分块到达，结果与整块相同
+static void test_upload_resp_byte_by_byte(void)
+{
+    upload_resp_t r;
+    upload_resp_init(&r);
+    for (size_t i = 0; i < strlen(s_ok); i++) {
+        HT_ASSERT(!upload_resp_complete(&r));
+        upload_resp_feed(&r, s_ok + i, 1);
+    }
+    HT_ASSERT(upload_resp_complete(&r));
+    HT_ASSERT_EQ(0, r.error);
+    HT_ASSERT(strcmp(r.img_url, "http://host/a.jpg") == 0);
+    HT_ASSERT_EQ(strlen(s_ok), r.bytes);
+}
+
+static void test_upload_resp_error(void)
+{
+    const char *resp = " {\n  \"showmsg\" : \"bad \\\"type\\\"\",\n  \"error\" : -2 \n}";
+    upload_resp_t r;
+    upload_resp_init(&r);
+    upload_resp_feed(&r, resp, strlen(resp));
+    HT_ASSERT(upload_resp_complete(&r));
+    HT_ASSERT(r.has_error);
+    HT_ASSERT_EQ(-2, r.error);
+    HT_ASSERT(strcmp(r.msg, "bad \"type\"") == 0);
+    HT_ASSERT_EQ(0, r.img_url[0]);
+}
+
+// 超长的值截断，超长的键不匹配，非 JSON 响应不算完成
+static void test_upload_resp_limits(void)
+{
+    char resp[512];
+    char url[300];
+    memset(url, 'u', sizeof(url) - 1);
+    url[sizeof(url) - 1] = '\0';
+    snprintf(resp, sizeof(resp), "{\"error_code_long_key\":5,\"img_url\":\"%s\"}", url);
+    upload_resp_t r;
+    upload_resp_init(&r);
+    upload_resp_feed(&r, resp, strlen(resp));
+    HT_ASSERT(upload_resp_complete(&r));
+    HT_ASSERT(!r.has_error);
+    HT_ASSERT_EQ(sizeof(r.img_url) - 1, strlen(r.img_url));
+
+    upload_resp_init(&r);
+    upload_resp_feed(&r, "<html>502</html>", 16);
+    HT_ASSERT(!upload_resp_complete(&r));
+    HT_ASSERT_EQ(16, r.bytes);
+}
+
+const host_test_case_t g_upload_resp_cases[] = {
+    HT_CASE(test_upload_resp_ok),
+    HT_CASE(test_upload_resp_byte_by_byte),
+    HT_CASE(test_upload_resp_error),
+    HT_CASE(test_upload_resp_limits),
+    { NULL, NULL },
+};
@@ -0,0 +1,182 @@
+// 主机构建用的 cc_hal 实现：只覆盖被测模块用到的接口
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <errno.h>
+
+#include "cc_hal_os.h"
+#include "cc_hal_sys.h"
+#include "cc_sched.h"
+
+typedef cc_os_semphr_buf_t host_semphr_t;
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting_static(uint32_t max_count, uint32_t init_count, cc_os_semphr_buf_t *buf)
+{
+    if (buf) {
+        pthread_mutex_init(&buf->lock, NULL);
+        pthread_cond_init(&buf->cond, NULL);
+        buf->count = init_count;
+        buf->max = max_count;
+    }
+    return buf;
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary_static(cc_os_semphr_buf_t *buf)
+{
+    return cc_hal_os_semphr_create_counting_static(1, 0, buf);
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex_static(cc_os_semphr_buf_t *buf)
+{
+    return cc_hal_os_semphr_create_counting_static(1, 1, buf);
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting(uint32_t max_count, uint32_t init_count)
+{
+    return cc_hal_os_semphr_create_counting_static(max_count, init_count, calloc(1, sizeof(host_semphr_t)));
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary(void)
+{
+    return cc_hal_os_semphr_create_counting(1, 0);
+}
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex(void)
+{
+    return cc_hal_os_semphr_create_counting(1, 1);
+}
+
+cc_err_t cc_hal_os_semphr_delete(cc_os_semphr_handle_t handle)
+{
+    host_semphr_t *sem = handle;
+    if (!sem) {
+        return CC_ERR_INVALID_ARG;
+    }
+    pthread_cond_destroy(&sem->cond);
+    pthread_mutex_destroy(&sem->lock);
+    free(sem);
+    return CC_OK;
+}
+
+cc_err_t cc_hal_os_semphr_take(cc_os_semphr_handle_t handle, cc_os_tick_t tick)
+{
+    host_semphr_t *sem = handle;
+    cc_err_t ret = CC_OK;
+    struct timespec deadline;
+    clock_gettime(CLOCK_REALTIME, &deadline);
+    deadline.tv_sec += tick / 1000;
+    deadline.tv_nsec += (tick % 1000) * 1000000L;
+    if (deadline.tv_nsec >= 1000000000L) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000L;
+    }
+
+    pthread_mutex_lock(&sem->lock);
+    while (sem->count == 0) {
+        if (tick == CC_OS_MAX_DELAY) {
+            pthread_cond_wait(&sem->cond, &sem->lock);
+        } else if (tick == 0 || pthread_cond_timedwait(&sem->cond, &sem->lock, &deadline) == ETIMEDOUT) {
+            ret = CC_ERR_TIMEOUT;
+            break;
+        }
+    }
+    if (ret == CC_OK) {
+        sem->count--;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+cc_err_t cc_hal_os_semphr_give(cc_os_semphr_handle_t handle)
+{
+    host_semphr_t *sem = handle;
+    cc_err_t ret = CC_OK;
+    pthread_mutex_lock(&sem->lock);
+    if (sem->count < sem->max) {
+        sem->count++;
+        pthread_cond_signal(&sem->cond);
+    } else {
+        ret = CC_FAIL;
+    }
+    pthread_mutex_unlock(&sem->lock);
+    return ret;
+}
+
+void cc_hal_os_task_delay(cc_os_tick_t tick)
+{
+    struct timespec ts = { tick / 1000, (tick % 1000) * 1000000L };
+    nanosleep(&ts, NULL);
+}
+
+typedef struct {
+    cc_os_task_t task;
+    void *arg;
+} host_task_start_t;
+
+static void *host_task_entry(void *p)
+{
+    host_task_start_t start = *(host_task_start_t *)p;
+    free(p);
+    start.task(start.arg);
+    return NULL;
+}
+
+cc_err_t cc_hal_os_task_create(cc_os_task_t task, const char *name, uint32_t stack_size, void *arg, uint8_t priority, cc_os_task_handle_t *handle)
+{
+    host_task_start_t *start = malloc(sizeof(host_task_start_t));
+    pthread_t thread;
+    if (!start) {
+        return CC_ERR_NO_MEM;
+    }
+    start->task = task;
+    start->arg = arg;
+    if (pthread_create(&thread, NULL, host_task_entry, start) != 0) {
+        free(start);
+        return CC_FAIL;
+    }
+    pthread_detach(thread);
+    if (handle) {
+        *handle = NULL;
+    }
+    return CC_OK;
+}
+
+void *cc_hal_sys_malloc(size_t size)
+{
+    return malloc(size);
+}
+
+void *cc_hal_sys_malloc_caps(size_t size, uint32_t caps, cc_mem_mod_t mod)
+{
+    return malloc(size);
+}
+
+void cc_hal_sys_free(void *ptr)
+{
+    free(ptr);
+}
+
+uint32_t cc_hal_sys_get_rand(uint32_t range)
+{
+    return range ? (uint32_t)rand() % range : 0;
+}
+
+uint64_t cc_hal_sys_get_ms(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+// 主机上用纳秒代替 CPU 周期，同样只取差值
+uint32_t cc_hal_sys_get_cycles(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint32_t)((uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec);
+}
+
+// 主机测试直接调用 cc_timer_run()，没有调度任务需要唤醒
+void cc_sched_wakeup(void)
+{
+}
@@ -0,0 +1,55 @@
+// 主机构建用的 cc_hal_os：接口与 components/cc/port/include/cc_hal_os.h 相同，用 pthread 实现
+#ifndef __CC_HAL_OS_H__
+#define __CC_HAL_OS_H__
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "cc_err.h"
+
+typedef void *cc_os_task_handle_t;
+typedef void *cc_os_semphr_handle_t;
+// 信号量：互斥锁 + 条件变量的计数信号量，mutex 即初值 1、上限 1
+typedef struct {
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    uint32_t count;
+    uint32_t max;
+} cc_os_semphr_buf_t;
+
+typedef void (*cc_os_task_t)(void *arg);
+
+typedef uint32_t cc_os_tick_t;
+#define CC_OS_TICK_PERIOD_MS            1
+#define CC_OS_MAX_DELAY                 UINT32_MAX
+#define CC_OS_MS_TO_TICK(ms)            ((cc_os_tick_t)(ms))
+
+typedef pthread_mutex_t cc_os_spinlock_t;
+#define CC_OS_SPINLOCK_INIT             PTHREAD_MUTEX_INITIALIZER
+#define cc_hal_os_spinlock_init(lock)   pthread_mutex_init(lock, NULL)
+#define cc_hal_os_enter_critical(lock)  pthread_mutex_lock(lock)
+#define cc_hal_os_exit_critical(lock)   pthread_mutex_unlock(lock)
+
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary(void);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex(void);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting(uint32_t max_count, uint32_t init_count);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_binary_static(cc_os_semphr_buf_t *buf);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_mutex_static(cc_os_semphr_buf_t *buf);
+cc_os_semphr_handle_t cc_hal_os_semphr_create_counting_static(uint32_t max_count, uint32_t init_count, cc_os_semphr_buf_t *buf);
+cc_err_t cc_hal_os_semphr_delete(cc_os_semphr_handle_t handle);
+cc_err_t cc_hal_os_semphr_take(cc_os_semphr_handle_t handle, cc_os_tick_t tick);
+cc_err_t cc_hal_os_semphr_give(cc_os_semphr_handle_t handle);
+
+void cc_hal_os_task_delay(cc_os_tick_t tick);
+// 以分离的线程运行，stack_size 与 priority 被忽略
+cc_err_t cc_hal_os_task_create(cc_os_task_t task, const char *name, uint32_t stack_size, void *arg, uint8_t priority, cc_os_task_handle_t *handle);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -0,0 +1,32 @@
+// 主机构建用：错误和警告输出到 stderr，其余级别只在定义 HOST_LOG_VERBOSE 时输出
+#ifndef ESP_LOG_H
+#define ESP_LOG_H
+
+#include <stdio.h>
+
+typedef enum {
+    ESP_LOG_NONE,
+    ESP_LOG_ERROR,
+    ESP_LOG_WARN,
+    ESP_LOG_INFO,
+    ESP_LOG_DEBUG,
+    ESP_LOG_VERBOSE,
+} esp_log_level_t;
+
+#define HOST_LOG(level, tag, format, ...)   fprintf(stderr, level " (%s) " format "\n", tag, ##__VA_ARGS__)
+
+#define ESP_LOGE(tag, format, ...)  HOST_LOG("E", tag, format, ##__VA_ARGS__)
+#define ESP_LOGW(tag, format, ...)  HOST_LOG("W", tag, format, ##__VA_ARGS__)
+#ifdef HOST_LOG_VERBOSE
+#define ESP_LOGI(tag, format, ...)  HOST_LOG("I", tag, format, ##__VA_ARGS__)
+#define ESP_LOGD(tag, format, ...)  HOST_LOG("D", tag, format, ##__VA_ARGS__)
+#define ESP_LOGV(tag, format, ...)  HOST_LOG("V", tag, format, ##__VA_ARGS__)
+#else
+#define ESP_LOGI(tag, format, ...)  do { (void)(tag); } while (0)
+#define ESP_LOGD(tag, format, ...)  do { (void)(tag); } while (0)
+#define ESP_LOGV(tag, format, ...)  do { (void)(tag); } while (0)
+#endif
+
+#define ESP_LOG_BUFFER_HEXDUMP(tag, buf, len, level)    do { (void)(tag); (void)(buf); (void)(len); } while (0)
+
+#endif // ESP_LOG_H
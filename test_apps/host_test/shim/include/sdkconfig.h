@@ -0,0 +1,5 @@
+// 主机构建用：不开启任何 CONFIG_ 选项，被测头文件中依赖配置的部分走关闭时的分支
+#ifndef SDKCONFIG_H
+#define SDKCONFIG_H
+
+#endif // SDKCONFIG_H
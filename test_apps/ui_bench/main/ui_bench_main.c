@@ -0,0 +1,279 @@
+// ui_bench_main.c
+// UI 渲染基准：依次运行本项目的界面场景和 LVGL benchmark demo，统计由 ui_bench_stats 按周期输出
+#include <stdio.h>
+#include "sdkconfig.h"
+#include "esp_log.h"
+#include "esp_heap_caps.h"
+#include "bsp/esp-bsp.h"
+#include "lvgl.h"
+#include "demos/lv_demos.h"
+#include "ui_bench_stats.h"
+#include "ui_glyph.h"
+#if CONFIG_UI_RENDER_DUAL_CORE
+#include "ui_render.h"
+#endif
+#if CONFIG_UI_FLUSH_ACCEL
+#include "ui_flush.h"
+#endif
+
+static const char *TAG = "ui_bench";
+
+#define PREVIEW_FRAME_MS    33      // 与摄像头 30fps 预览的送显节奏一致
+
+typedef struct {
+    const char *name;
+    void (*create)(lv_obj_t *scr);
+} bench_scene_t;
+
+static lv_image_dsc_t s_preview_dsc;
+static uint16_t *s_preview_buf = NULL;
+static lv_obj_t *s_preview_img = NULL;
+static lv_obj_t *s_clock = NULL;
+static lv_timer_t *s_scene_timer = NULL;     // 当前场景的动画定时器，切场景时删除
+static uint32_t s_tick = 0;
+static size_t s_scene_idx = 0;
+
+// ========== 场景：实时预览 ==========
+// 与 img_preview 送显 LVGL 的路径相同：整屏 RGB565 缓冲作为 lv_image 源，每帧改内容后 invalidate
+static void preview_timer_cb(lv_timer_t *timer)
+{
+    uint32_t w = s_preview_dsc.header.w;
+    uint32_t h = s_preview_dsc.header.h;
+    s_tick++;
+    for (uint32_t y = 0; y < h; y++) {
+        uint16_t *row = s_preview_buf + y * w;
+        for (uint32_t x = 0; x < w; x++) {
+            row[x] = (uint16_t)((((x + s_tick) & 0x1F) << 11) | (((y + s_tick) & 0x3F) << 5) | ((x ^ y) & 0x1F));
+        }
+    }
+    lv_obj_invalidate(s_preview_img);
+}
+
+static void scene_preview_common(lv_obj_t *scr)
+{
+    int32_t w = lv_display_get_horizontal_resolution(NULL);
+    int32_t h = lv_display_get_vertical_resolution(NULL);
+    if (!s_preview_buf) {
+        s_preview_buf = heap_caps_malloc(w * h * sizeof(uint16_t), MALLOC_CAP_SPIRAM);
+        if (!s_preview_buf) {
+            ESP_LOGE(TAG, "no memory for preview buffer");
+            return;
+        }
+    }
+    s_preview_dsc.header.magic = LV_IMAGE_HEADER_MAGIC;
+    s_preview_dsc.header.cf = LV_COLOR_FORMAT_RGB565;
+    s_preview_dsc.header.w = w;
+    s_preview_dsc.header.h = h;
+    s_preview_dsc.header.stride = w * sizeof(uint16_t);
+    s_preview_dsc.data_size = w * h * sizeof(uint16_t);
+    s_preview_dsc.data = (const uint8_t *)s_preview_buf;
+
+    s_preview_img = lv_image_create(scr);
+    lv_image_set_src(s_preview_img, &s_preview_dsc);
+    lv_obj_center(s_preview_img);
+    s_scene_timer = lv_timer_create(preview_timer_cb, PREVIEW_FRAME_MS, NULL);
+}
+
+static void scene_preview(lv_obj_t *scr)
+{
+    scene_preview_common(scr);
+}
+
+// 通话界面：预览上叠半透明按钮栏
+static void scene_preview_overlay(lv_obj_t *scr)
+{
+    scene_preview_common(scr);
+
+    lv_obj_t *bar = lv_obj_create(scr);
+    lv_obj_set_size(bar, lv_pct(100), lv_pct(25));
+    lv_obj_align(bar, LV_ALIGN_BOTTOM_MID, 0, 0);
+    lv_obj_set_style_bg_color(bar, lv_color_black(), 0);
+    lv_obj_set_style_bg_opa(bar, LV_OPA_50, 0);
+    lv_obj_set_style_border_width(bar, 0, 0);
+    lv_obj_set_style_radius(bar, 0, 0);
+    lv_obj_set_flex_flow(bar, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(bar, LV_FLEX_ALIGN_SPACE_EVENLY, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+
+    static const char *const icons[] = {LV_SYMBOL_CALL, LV_SYMBOL_OK, LV_SYMBOL_CLOSE};
+    for (size_t i = 0; i < sizeof(icons) / sizeof(icons[0]); i++) {
+        lv_obj_t *btn = lv_button_create(bar);
+        lv_obj_t *label = lv_label_create(btn);
+        lv_label_set_text(label, icons[i]);
+    }
+}
+
+// ========== 场景：待机状态页 ==========
+static void clock_timer_cb(lv_timer_t *timer)
+{
+    s_tick++;
+    lv_label_set_text_fmt(s_clock, "%02lu:%02lu:%02lu.%lu", (unsigned long)(s_tick / 36000 % 24),
+                          (unsigned long)(s_tick / 600 % 60), (unsigned long)(s_tick / 10 % 60),
+                          (unsigned long)(s_tick % 10));
+}
+
+static void scene_status(lv_obj_t *scr)
+{
+    lv_obj_t *top = lv_obj_create(scr);
+    lv_obj_set_size(top, lv_pct(100), LV_SIZE_CONTENT);
+    lv_obj_align(top, LV_ALIGN_TOP_MID, 0, 0);
+    lv_obj_set_flex_flow(top, LV_FLEX_FLOW_ROW);
+    lv_obj_set_flex_align(top, LV_FLEX_ALIGN_SPACE_BETWEEN, LV_FLEX_ALIGN_CENTER, LV_FLEX_ALIGN_CENTER);
+    lv_label_set_text(lv_label_create(top), LV_SYMBOL_WIFI " " LV_SYMBOL_BLUETOOTH);
+    lv_label_set_text(lv_label_create(top), LV_SYMBOL_BATTERY_3);
+
+    s_clock = lv_label_create(scr);
+    // CONFIG_UI_GLYPH_CACHE 时每 100 ms 重绘的数字取自字形缓存
+    lv_obj_set_style_text_font(s_clock, ui_glyph_font(&lv_font_montserrat_24), 0);
+    lv_obj_center(s_clock);
+
+    lv_obj_t *spinner = lv_spinner_create(scr);
+    lv_obj_set_size(spinner, 48, 48);
+    lv_obj_align(spinner, LV_ALIGN_BOTTOM_MID, 0, -16);
+
+    s_scene_timer = lv_timer_create(clock_timer_cb, 100, NULL);
+}
+
+static const bench_scene_t s_scenes[] = {
+    {"status", scene_status},
+    {"preview", scene_preview},
+    {"preview_overlay", scene_preview_overlay},
+};
+
+#define SCENE_NUM   (sizeof(s_scenes) / sizeof(s_scenes[0]))
+
+// 返回 false 表示所有场景已跑完
+static bool scene_load(size_t idx)
+{
+    lv_obj_t *scr = lv_screen_active();
+    if (s_scene_timer) {
+        lv_timer_delete(s_scene_timer);
+        s_scene_timer = NULL;
+    }
+    s_preview_img = NULL;
+    s_clock = NULL;
+    lv_obj_clean(scr);
+    s_tick = 0;
+
+    if (idx < SCENE_NUM) {
+        ui_bench_stats_scene(s_scenes[idx].name);
+        s_scenes[idx].create(scr);
+        return true;
+    }
+#if CONFIG_UI_BENCH_DEMO_MS
+    if (idx == SCENE_NUM) {
+        ui_bench_stats_scene("lvgl_benchmark");
+        lv_demo_benchmark();
+        return true;
+    }
+#endif
+    ui_bench_stats_scene("done");
+    printf("UIBENCH_DONE\n");
+    return false;
+}
+
+static void scene_timer_cb(lv_timer_t *timer)
+{
+    s_scene_idx++;
+    if (!scene_load(s_scene_idx)) {
+        lv_timer_delete(timer);
+    } else if (s_scene_idx == SCENE_NUM) {
+        lv_timer_set_period(timer, CONFIG_UI_BENCH_DEMO_MS);
+    }
+}
+
+// 与 bsp_display_start_with_config() 相同，只是 swap_bytes / sw_rotate 按对比的配置设置，
+// 并拿到面板句柄交给 ui_flush
+static lv_display_t *display_start(void)
+{
+    lvgl_port_cfg_t port_cfg = ESP_LVGL_PORT_INIT_CONFIG();
+#if CONFIG_UI_RENDER_DUAL_CORE
+    // LVGL 任务与第一个绘制单元同核
+    port_cfg.task_affinity = CONFIG_UI_RENDER_MAIN_CORE;
+#endif
+    if (lvgl_port_init(&port_cfg) != ESP_OK) {
+        return NULL;
+    }
+    esp_lcd_panel_io_handle_t io = NULL;
+    esp_lcd_panel_handle_t panel = NULL;
+    const bsp_display_config_t bsp_cfg = {
+        .max_transfer_sz = BSP_LCD_DRAW_BUFF_SIZE * sizeof(uint16_t),
+    };
+    if (bsp_display_new(&bsp_cfg, &panel, &io) != ESP_OK) {
+        return NULL;
+    }
+    esp_lcd_panel_disp_on_off(panel, true);
+
+    const bool sw_rotate = CONFIG_UI_BENCH_ROTATION != 0;
+#if CONFIG_UI_FLUSH_ACCEL
+    const bool port_swap = false;       // 字节交换由 ui_flush 做
+#else
+    const bool port_swap = BSP_LCD_BIGENDIAN;
+#endif
+    const lvgl_port_display_cfg_t disp_cfg = {
+        .io_handle = io,
+        .panel_handle = panel,
+        .buffer_size = BSP_LCD_DRAW_BUFF_SIZE,
+        .double_buffer = BSP_LCD_DRAW_BUFF_DOUBLE,
+        .hres = BSP_LCD_H_RES,
+        .vres = BSP_LCD_V_RES,
+        .flags = {
+            .buff_dma = true,
+            .sw_rotate = sw_rotate,
+            .swap_bytes = port_swap,
+        },
+    };
+    lv_display_t *disp = lvgl_port_add_disp(&disp_cfg);
+    if (!disp) {
+        return NULL;
+    }
+    lvgl_port_lock(0);
+#if CONFIG_UI_FLUSH_ACCEL
+#if CONFIG_UI_BENCH_DOUBLE_BUFFER
+    const bool flush_double = true;
+#else
+    const bool flush_double = false;
+#endif
+    const ui_flush_config_t flush_cfg = {
+        .panel = panel,
+        .buffer_size = BSP_LCD_DRAW_BUFF_SIZE,
+        .swap_bytes = BSP_LCD_BIGENDIAN,
+        .sw_rotate = sw_rotate,
+        .double_buffer = flush_double,
+        .merge_px = CONFIG_UI_BENCH_MERGE_PX,
+        .te_sync = CONFIG_UI_BENCH_TE_GPIO >= 0,
+        .te_gpio = CONFIG_UI_BENCH_TE_GPIO,
+    };
+    if (ui_flush_attach(disp, &flush_cfg) != ESP_OK) {
+        ESP_LOGW(TAG, "flush accel not available, using the port flush");
+    }
+#endif
+    lv_display_set_rotation(disp, CONFIG_UI_BENCH_ROTATION / 90);
+    lvgl_port_unlock();
+    return disp;
+}
+
+void app_main(void)
+{
+    lv_display_t *disp = display_start();
+    if (!disp) {
+        ESP_LOGE(TAG, "display start failed");
+        return;
+    }
+    bsp_display_backlight_on();
+
+    bsp_display_lock(0);
+#if CONFIG_UI_RENDER_DUAL_CORE
+    const ui_render_config_t render_cfg = {
+        .stack_size = CONFIG_UI_RENDER_DRAW_STACK,
+        .main_core = CONFIG_UI_RENDER_MAIN_CORE,
+        .second_core = CONFIG_UI_RENDER_SECOND_CORE,
+    };
+    if (ui_render_init(&render_cfg) != ESP_OK) {
+        ESP_LOGW(TAG, "dual core render not available, draw threads left unpinned");
+    }
+#endif
+    ui_bench_stats_start(disp, CONFIG_UI_BENCH_SAMPLE_MS);
+    scene_load(0);
+    lv_timer_create(scene_timer_cb, CONFIG_UI_BENCH_SCENE_MS, NULL);
+    bsp_display_unlock();
+}
@@ -0,0 +1,188 @@
+// ui_bench_stats.c
+// 渲染统计：显示刷新事件计时，IDLE 运行时间算各核占用，图片缓存计数来自 ui_cache，字形缓存计数来自 ui_glyph，
+// 送屏块数与脏区合并、TE 计数来自 ui_flush
+#include "ui_bench_stats.h"
+#include "sdkconfig.h"
+#include <stdio.h>
+#include <string.h>
+#include "esp_timer.h"
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#if CONFIG_UI_RENDER_DUAL_CORE
+#include "ui_render.h"
+#endif
+#include "ui_cache.h"
+#include "ui_glyph.h"
+#if CONFIG_UI_FLUSH_ACCEL
+#include "ui_flush.h"
+#endif
+
+typedef struct {
+    uint32_t frames;
+    uint64_t render_sum;
+    uint64_t flush_sum;
+    uint32_t render_max;
+    uint32_t flush_max;
+} bench_window_t;
+
+static const char *s_scene = "idle";
+static bench_window_t s_win;
+static int64_t s_win_start;
+static lv_timer_t *s_timer = NULL;
+
+// 当前这次刷新
+static int64_t s_refr_start;
+static int64_t s_flush_start;
+static int64_t s_wait_start;
+static uint32_t s_frame_flush;
+
+static uint32_t s_idle_prev[portNUM_PROCESSORS];
+static int64_t s_cpu_prev;
+
+static void refr_event_cb(lv_event_t *e)
+{
+    int64_t now = esp_timer_get_time();
+    switch (lv_event_get_code(e)) {
+    case LV_EVENT_REFR_START:
+        s_refr_start = now;
+        s_frame_flush = 0;
+        break;
+    case LV_EVENT_FLUSH_START:
+        s_flush_start = now;
+        break;
+    case LV_EVENT_FLUSH_FINISH:
+        s_frame_flush += now - s_flush_start;
+        break;
+    case LV_EVENT_FLUSH_WAIT_START:
+        s_wait_start = now;
+        break;
+    case LV_EVENT_FLUSH_WAIT_FINISH:
+        s_frame_flush += now - s_wait_start;
+        break;
+    case LV_EVENT_RENDER_READY: {
+        // 只有真正重绘过的刷新才算一帧
+        uint32_t total = now - s_refr_start;
+        uint32_t render = total > s_frame_flush ? total - s_frame_flush : 0;
+        s_win.frames++;
+        s_win.render_sum += render;
+        s_win.flush_sum += s_frame_flush;
+        if (render > s_win.render_max) {
+            s_win.render_max = render;
+        }
+        if (s_frame_flush > s_win.flush_max) {
+            s_win.flush_max = s_frame_flush;
+        }
+#if CONFIG_UI_BENCH_FRAME_LOG
+        printf("UIFRAME {\"scene\":\"%s\",\"render_us\":%lu,\"flush_us\":%lu}\n",
+               s_scene, (unsigned long)render, (unsigned long)s_frame_flush);
+#endif
+        break;
+    }
+    default:
+        break;
+    }
+}
+
+// 各核 IDLE 任务运行时间的增量换算占用，运行时间计时源为 esp_timer
+static void cpu_load(uint32_t load[portNUM_PROCESSORS])
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t elapsed = now - s_cpu_prev;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        uint32_t idle = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+        uint32_t busy = elapsed > (idle - s_idle_prev[core]) ? elapsed - (idle - s_idle_prev[core]) : 0;
+        load[core] = elapsed ? (uint32_t)((uint64_t)busy * 100 / elapsed) : 0;
+        s_idle_prev[core] = idle;
+    }
+    s_cpu_prev = now;
+}
+
+static void report(void)
+{
+    int64_t now = esp_timer_get_time();
+    uint32_t load[portNUM_PROCESSORS];
+    cpu_load(load);
+
+    uint32_t n = s_win.frames ? s_win.frames : 1;
+
+    printf("UIBENCH {\"scene\":\"%s\",\"ms\":%lu,\"frames\":%lu,"
+           "\"render_us\":{\"avg\":%lu,\"max\":%lu},\"flush_us\":{\"avg\":%lu,\"max\":%lu},"
+           "\"lv_cpu\":%lu,\"cpu\":[",
+           s_scene, (unsigned long)((now - s_win_start) / 1000), (unsigned long)s_win.frames,
+           (unsigned long)(s_win.render_sum / n), (unsigned long)s_win.render_max,
+           (unsigned long)(s_win.flush_sum / n), (unsigned long)s_win.flush_max,
+           (unsigned long)(100 - lv_timer_get_idle()));
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        printf(core ? ",%lu" : "%lu", (unsigned long)load[core]);
+    }
+#if CONFIG_UI_RENDER_DUAL_CORE
+    uint32_t units = ui_render_active_units();
+#else
+    uint32_t units = LV_DRAW_SW_DRAW_UNIT_CNT;
+#endif
+    printf("],\"draw_units\":%lu", (unsigned long)units);
+    static const char *const names[UI_CACHE_MAX] = {"img_cache", "hdr_cache"};
+    for (int id = 0; id < UI_CACHE_MAX; id++) {
+        ui_cache_stats_t st = {0};
+        ui_cache_get_stats(id, &st, true);
+        printf(",\"%s\":{\"hit\":%lu,\"miss\":%lu,\"evict\":%lu,\"size\":%lu,\"max\":%lu}",
+               names[id], (unsigned long)st.hits, (unsigned long)st.misses, (unsigned long)st.evictions,
+               (unsigned long)st.size, (unsigned long)st.max_size);
+    }
+    ui_cache_stats_t glyph = {0};
+    ui_glyph_get_stats(&glyph, true);
+    printf(",\"glyph_cache\":{\"hit\":%lu,\"miss\":%lu,\"evict\":%lu,\"size\":%lu,\"max\":%lu}",
+           (unsigned long)glyph.hits, (unsigned long)glyph.misses, (unsigned long)glyph.evictions,
+           (unsigned long)glyph.size, (unsigned long)glyph.max_size);
+#if CONFIG_UI_FLUSH_ACCEL
+    ui_flush_stats_t flush;
+    ui_flush_get_stats(&flush);
+    printf(",\"flush\":{\"areas\":%lu,\"merged\":%lu,\"te_wait\":%lu,\"te_timeout\":%lu}",
+           (unsigned long)flush.flushes, (unsigned long)flush.merged, (unsigned long)flush.te_waits,
+           (unsigned long)flush.te_timeouts);
+#endif
+    printf("}\n");
+
+    memset(&s_win, 0, sizeof(s_win));
+    s_win_start = now;
+}
+
+static void report_timer_cb(lv_timer_t *timer)
+{
+    report();
+}
+
+void ui_bench_stats_start(lv_display_t *disp, uint32_t sample_ms)
+{
+    static const lv_event_code_t codes[] = {
+        LV_EVENT_REFR_START, LV_EVENT_RENDER_READY, LV_EVENT_FLUSH_START,
+        LV_EVENT_FLUSH_FINISH, LV_EVENT_FLUSH_WAIT_START, LV_EVENT_FLUSH_WAIT_FINISH,
+    };
+    for (size_t i = 0; i < sizeof(codes) / sizeof(codes[0]); i++) {
+        lv_display_add_event_cb(disp, refr_event_cb, codes[i], NULL);
+    }
+    if (ui_cache_init() != ESP_OK) {
+        printf("ui_cache not available, cache counters stay 0\n");
+    }
+    // 须在场景创建之前，status 场景的时钟才拿到带缓存的字体
+    if (ui_glyph_init() != ESP_OK) {
+        printf("ui_glyph not available, glyph counters stay 0\n");
+    }
+
+    memset(&s_win, 0, sizeof(s_win));
+    s_win_start = esp_timer_get_time();
+    s_cpu_prev = s_win_start;
+    for (int core = 0; core < portNUM_PROCESSORS; core++) {
+        s_idle_prev[core] = ulTaskGetRunTimeCounter(xTaskGetIdleTaskHandleForCore(core));
+    }
+    s_timer = lv_timer_create(report_timer_cb, sample_ms, NULL);
+}
+
+void ui_bench_stats_scene(const char *name)
+{
+    if (s_timer) {
+        report();
+        lv_timer_reset(s_timer);
+    }
+    s_scene = name;
+}
@@ -0,0 +1,44 @@
+#ifndef UI_BENCH_STATS_H
+#define UI_BENCH_STATS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include "lvgl.h"
+
+/*
+ * 每个统计周期输出一行（单位：微秒 / 百分比）：
+ *
+ * UIBENCH {"scene":"preview","ms":1000,"frames":24,
+ *          "render_us":{"avg":8123,"max":9800},"flush_us":{"avg":21000,"max":23100},
+ *          "lv_cpu":92,"cpu":[97,12],"draw_units":1,
+ *          "img_cache":{"hit":40,"miss":2,"evict":0,"size":115200,"max":262144},
+ *          "hdr_cache":{"hit":12,"miss":1,"evict":0,"size":3,"max":16}}
+ *
+ * render_us：一次刷新中 LVGL 绘制的时间（整次刷新减去 flush）
+ * flush_us：flush_cb 本身加上等待上一块 DMA 传完的时间
+ * lv_cpu：LVGL 任务忙碌比例（lv_timer_get_idle），cpu：各核非 IDLE 时间比例
+ * draw_units：参与渲染的软件绘制单元数（双核渲染见 sdkconfig.dual_core）
+ * img_cache：lv_image_cache 本周期的查找命中 / 未命中 / LRU 淘汰次数和当前 / 最大字节数
+ * hdr_cache：lv_image_header_cache 的同样计数，size / max 为条目数（计数见 main/gs_ui/ui_cache.c）
+ */
+
+/**
+ * 挂接显示事件和图片缓存计数，并启动周期输出
+ * @note  在持有 LVGL 锁时调用
+ */
+void ui_bench_stats_start(lv_display_t *disp, uint32_t sample_ms);
+
+/**
+ * 切换场景名，当前周期立即结束并输出，之后的统计计入新场景
+ * @note  在持有 LVGL 锁时调用
+ */
+void ui_bench_stats_scene(const char *name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // UI_BENCH_STATS_H
@@ -0,0 +1,164 @@
+// PIE 内核与 LVGL C 实现的每像素周期数：128x128 16 字节对齐（理想情况）和
+// 127x127 源目标都错开 2 字节（最差情况），内核须比 C 实现快
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "esp_cpu.h"
+#include "ui_simd_ref.h"
+#include "ui_blend.h"
+#include "ui_pixel.h"
+
+#define BENCH_W         128
+#define BENCH_H         128
+#define BENCH_RUNS      50
+
+static const char *TAG = "ui_blend_bench";
+
+typedef struct {
+    const char *name;
+    lv_opa_t opa;
+    bool mask;
+} bench_case_t;
+
+static const bench_case_t s_cases[] = {
+    {"copy", LV_OPA_COVER, false},
+    {"opa", LV_OPA_50, false},
+    {"mask", LV_OPA_COVER, true},
+    {"mask+opa", LV_OPA_50, true},
+};
+
+static float cycles_per_px(void (*run)(lv_draw_sw_blend_image_dsc_t *), lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    run(dsc);   // 预热缓存
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        run(dsc);
+    }
+    uint32_t cycles = esp_cpu_get_cycle_count() - start;
+    return (float)cycles / BENCH_RUNS / (dsc->dest_w * dsc->dest_h);
+}
+
+static void run_simd(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    ui_blend_image_rgb565(dsc);
+}
+
+static void run_ref(lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    ui_simd_ref_image_rgb565(dsc);
+}
+
+static void bench_image(int32_t w, int32_t h, int off)
+{
+    size_t len = off + BENCH_W * 2 * BENCH_H;
+    uint8_t *dst = memalign(16, len);
+    uint8_t *src = memalign(16, len);
+    uint8_t *mask = malloc(BENCH_W * BENCH_H);
+    TEST_ASSERT_NOT_NULL(dst);
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(mask);
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = (uint8_t)(i * 7);
+        src[i] = (uint8_t)(i * 13);
+    }
+    for (size_t i = 0; i < BENCH_W * BENCH_H; i++) {
+        mask[i] = (uint8_t)(i * 5);
+    }
+
+    for (size_t c = 0; c < sizeof(s_cases) / sizeof(s_cases[0]); c++) {
+        lv_draw_sw_blend_image_dsc_t dsc = {
+            .dest_buf = dst + off,
+            .dest_w = w,
+            .dest_h = h,
+            .dest_stride = BENCH_W * 2,
+            .mask_buf = s_cases[c].mask ? mask : NULL,
+            .mask_stride = BENCH_W,
+            .src_buf = src + off,
+            .src_stride = BENCH_W * 2,
+            .src_color_format = LV_COLOR_FORMAT_RGB565,
+            .opa = s_cases[c].opa,
+            .blend_mode = LV_BLEND_MODE_NORMAL,
+        };
+        float simd = cycles_per_px(run_simd, &dsc);
+        float ref = cycles_per_px(run_ref, &dsc);
+        ESP_LOGI(TAG, "%-8s %ldx%ld off %d: simd %.3f, C %.3f cycles/px", s_cases[c].name,
+                 (long)w, (long)h, off, simd, ref);
+        TEST_ASSERT_LESS_THAN_FLOAT(ref, simd);
+    }
+    free(dst);
+    free(src);
+    free(mask);
+}
+
+TEST_CASE("image blend RGB565 benchmark", "[blend][benchmark]")
+{
+    bench_image(BENCH_W, BENCH_H, 0);
+    bench_image(BENCH_W - 1, BENCH_H - 1, 2);
+}
+
+TEST_CASE("swap RGB565 bytes benchmark", "[swap][benchmark]")
+{
+    size_t pixels = BENCH_W * BENCH_H;
+    uint16_t *buf = memalign(16, pixels * 2);
+    TEST_ASSERT_NOT_NULL(buf);
+    memset(buf, 0x5a, pixels * 2);
+
+    ui_pixel_swap565(buf, pixels);
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        ui_pixel_swap565(buf, pixels);
+    }
+    float simd = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / pixels;
+
+    // LVGL 的 C 实现：一次两个像素
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        uint32_t *w = (uint32_t *)buf;
+        for (size_t j = 0; j < pixels / 2; j++) {
+            w[j] = ((w[j] & 0xff00ff00) >> 8) | ((w[j] & 0x00ff00ff) << 8);
+        }
+    }
+    float ref = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / pixels;
+
+    ESP_LOGI(TAG, "swap %u px: simd %.3f, C %.3f cycles/px", (unsigned)pixels, simd, ref);
+    TEST_ASSERT_LESS_THAN_FLOAT(ref, simd);
+    free(buf);
+}
+
+// 送屏时的旋转加字节交换（ui_flush 的软件旋转），与逐像素的 C 循环比较
+static void bench_rotate(int rotate)
+{
+    size_t pixels = BENCH_W * BENCH_H;
+    uint16_t *src = memalign(16, pixels * 2);
+    uint16_t *dst = memalign(16, pixels * 2);
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(dst);
+    memset(src, 0x5a, pixels * 2);
+
+    ui_pixel_rotate565(src, dst, BENCH_W, BENCH_H, BENCH_W, BENCH_H, (ui_pixel_rotate_t)rotate, true);
+    uint32_t start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        ui_pixel_rotate565(src, dst, BENCH_W, BENCH_H, BENCH_W, BENCH_H, (ui_pixel_rotate_t)rotate, true);
+    }
+    float simd = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / pixels;
+
+    start = esp_cpu_get_cycle_count();
+    for (int i = 0; i < BENCH_RUNS; i++) {
+        ui_simd_ref_rotate565(src, dst, BENCH_W, BENCH_H, BENCH_W, BENCH_H, rotate, true);
+    }
+    float ref = (float)(esp_cpu_get_cycle_count() - start) / BENCH_RUNS / pixels;
+
+    ESP_LOGI(TAG, "rotate %d + swap %u px: simd %.3f, C %.3f cycles/px", rotate * 90, (unsigned)pixels, simd, ref);
+    TEST_ASSERT_LESS_THAN_FLOAT(ref, simd);
+    free(src);
+    free(dst);
+}
+
+TEST_CASE("rotate RGB565 benchmark", "[rotate][benchmark]")
+{
+    bench_rotate(UI_PIXEL_ROTATE_90);
+    bench_rotate(UI_PIXEL_ROTATE_180);
+    bench_rotate(UI_PIXEL_ROTATE_270);
+}
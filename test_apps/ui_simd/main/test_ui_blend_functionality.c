@@ -0,0 +1,287 @@
+// PIE 内核与 LVGL C 实现逐位比较：宽、高、行跨度、目标和源的对齐逐一组合，
+// 缓冲前后留哨兵字节，内核越界写同样会被比较出来
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+#include "unity.h"
+#include "esp_log.h"
+#include "ui_simd_ref.h"
+#include "ui_blend.h"
+#include "ui_pixel.h"
+
+#define CANARY_BYTES    16
+
+typedef enum {
+    MODE_COPY,
+    MODE_OPA,
+    MODE_MASK,
+    MODE_MASK_OPA,
+} blend_mode_t;
+
+static const char *TAG = "ui_blend_func";
+static const char *s_mode_name[] = {"copy", "opa", "mask", "mask+opa"};
+// 含 LVGL 短路的边界：m 为 0 的 1..3、m 为 32 的 252，以及 LV_OPA_MAX 以下的最大值
+static const lv_opa_t s_opa[] = {1, 4, 60, 128, 200, 252};
+
+static uint32_t s_seed = 1;
+
+static uint32_t rnd(void)
+{
+    s_seed = s_seed * 1664525u + 1013904223u;
+    return s_seed >> 8;
+}
+
+static void fill_rnd(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = (uint8_t)rnd();
+    }
+}
+
+// 遮罩里多放些 0 和 255，覆盖 LVGL 的短路分支
+static void fill_mask(uint8_t *buf, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        uint32_t r = rnd();
+        buf[i] = (r & 7) == 0 ? 0 : (r & 7) == 1 ? 255 : (uint8_t)(r >> 3);
+    }
+}
+
+static int check_image(blend_mode_t mode, lv_opa_t opa, int32_t w, int32_t h,
+                       int dst_off, int src_off, int pad)
+{
+    int32_t dst_stride = (w + pad) * 2;
+    int32_t src_stride = (w + pad + 1) * 2;
+    int32_t mask_stride = w + 3;
+    size_t dst_len = CANARY_BYTES * 2 + dst_off + dst_stride * h;
+    size_t src_len = src_off + src_stride * h;
+
+    uint8_t *dst = memalign(16, dst_len);
+    uint8_t *ref = memalign(16, dst_len);
+    uint8_t *src = memalign(16, src_len);
+    uint8_t *mask = malloc(mask_stride * h);
+    TEST_ASSERT_NOT_NULL(dst);
+    TEST_ASSERT_NOT_NULL(ref);
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(mask);
+    fill_rnd(dst, dst_len);
+    memcpy(ref, dst, dst_len);
+    fill_rnd(src, src_len);
+    fill_mask(mask, mask_stride * h);
+
+    lv_draw_sw_blend_image_dsc_t dsc = {
+        .dest_buf = dst + CANARY_BYTES + dst_off,
+        .dest_w = w,
+        .dest_h = h,
+        .dest_stride = dst_stride,
+        .mask_buf = (mode == MODE_MASK || mode == MODE_MASK_OPA) ? mask : NULL,
+        .mask_stride = mask_stride,
+        .src_buf = src + src_off,
+        .src_stride = src_stride,
+        .src_color_format = LV_COLOR_FORMAT_RGB565,
+        .opa = (mode == MODE_OPA || mode == MODE_MASK_OPA) ? opa : LV_OPA_COVER,
+        .blend_mode = LV_BLEND_MODE_NORMAL,
+    };
+    TEST_ASSERT_EQUAL(LV_RESULT_OK, ui_blend_image_rgb565(&dsc));
+    dsc.dest_buf = ref + CANARY_BYTES + dst_off;
+    ui_simd_ref_image_rgb565(&dsc);
+
+    int diff = memcmp(dst, ref, dst_len);
+    if (diff) {
+        ESP_LOGE(TAG, "%s opa %d: w %ld h %ld dst_off %d src_off %d pad %d", s_mode_name[mode], opa,
+                 (long)w, (long)h, dst_off, src_off, pad);
+    }
+    free(dst);
+    free(ref);
+    free(src);
+    free(mask);
+    return diff;
+}
+
+static void image_matrix(blend_mode_t mode)
+{
+    int combinations = 0;
+    bool with_opa = mode == MODE_OPA || mode == MODE_MASK_OPA;
+    size_t opa_count = with_opa ? sizeof(s_opa) / sizeof(s_opa[0]) : 1;
+
+    for (size_t o = 0; o < opa_count; o++) {
+        for (int32_t w = 16; w <= 40; w++) {
+            for (int32_t h = 1; h <= 3; h++) {
+                for (int dst_off = 0; dst_off < 16; dst_off += 2) {
+                    for (int src_off = 0; src_off < 16; src_off += 2) {
+                        TEST_ASSERT_EQUAL(0, check_image(mode, s_opa[o], w, h, dst_off, src_off, w & 3));
+                        combinations++;
+                    }
+                }
+            }
+        }
+    }
+    ESP_LOGI(TAG, "%s: %d combinations", s_mode_name[mode], combinations);
+}
+
+TEST_CASE("image blend RGB565 copy", "[blend][functionality]")
+{
+    image_matrix(MODE_COPY);
+}
+
+TEST_CASE("image blend RGB565 with opa", "[blend][functionality]")
+{
+    image_matrix(MODE_OPA);
+}
+
+TEST_CASE("image blend RGB565 with mask", "[blend][functionality]")
+{
+    image_matrix(MODE_MASK);
+}
+
+TEST_CASE("image blend RGB565 with mask and opa", "[blend][functionality]")
+{
+    image_matrix(MODE_MASK_OPA);
+}
+
+TEST_CASE("image blend narrow or odd areas fall back to LVGL", "[blend][functionality]")
+{
+    uint16_t buf[32] __attribute__((aligned(16))) = {0};
+    lv_draw_sw_blend_image_dsc_t dsc = {
+        .dest_buf = buf,
+        .dest_w = 15,
+        .dest_h = 1,
+        .dest_stride = sizeof(buf),
+        .src_buf = buf,
+        .src_stride = sizeof(buf),
+        .opa = LV_OPA_COVER,
+        .blend_mode = LV_BLEND_MODE_NORMAL,
+    };
+    TEST_ASSERT_EQUAL(LV_RESULT_INVALID, ui_blend_image_rgb565(&dsc));
+    dsc.dest_w = 16;
+    dsc.src_buf = (uint8_t *)buf + 1;
+    TEST_ASSERT_EQUAL(LV_RESULT_INVALID, ui_blend_image_rgb565(&dsc));
+    dsc.src_buf = buf;
+    dsc.blend_mode = LV_BLEND_MODE_ADDITIVE;
+    TEST_ASSERT_EQUAL(LV_RESULT_INVALID, ui_blend_image_rgb565(&dsc));
+}
+
+TEST_CASE("swap RGB565 bytes", "[swap][functionality]")
+{
+    uint8_t *buf = memalign(16, 256);
+    uint8_t *ref = memalign(16, 256);
+    TEST_ASSERT_NOT_NULL(buf);
+    TEST_ASSERT_NOT_NULL(ref);
+
+    for (size_t pixels = 0; pixels <= 80; pixels++) {
+        for (int off = 0; off < 16; off += 2) {
+            fill_rnd(buf, 256);
+            memcpy(ref, buf, 256);
+            uint16_t *r = (uint16_t *)(ref + CANARY_BYTES + off);
+            for (size_t i = 0; i < pixels; i++) {
+                r[i] = (uint16_t)((r[i] >> 8) | (r[i] << 8));
+            }
+            TEST_ASSERT_EQUAL(LV_RESULT_OK, ui_blend_swap_rgb565(buf + CANARY_BYTES + off, pixels));
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, buf, 256);
+        }
+    }
+    free(buf);
+    free(ref);
+}
+
+TEST_CASE("fill RGB565 through the esp_lvgl_port kernel", "[fill][functionality]")
+{
+    for (int32_t w = 1; w <= 40; w++) {
+        for (int off = 0; off < 16; off += 2) {
+            int32_t stride = (w + 3) * 2;
+            size_t len = CANARY_BYTES * 2 + off + stride * 3;
+            uint8_t *dst = memalign(16, len);
+            uint8_t *ref = memalign(16, len);
+            TEST_ASSERT_NOT_NULL(dst);
+            TEST_ASSERT_NOT_NULL(ref);
+            fill_rnd(dst, len);
+            memcpy(ref, dst, len);
+
+            lv_draw_sw_blend_fill_dsc_t dsc = {
+                .dest_buf = dst + CANARY_BYTES + off,
+                .dest_w = w,
+                .dest_h = 3,
+                .dest_stride = stride,
+                .color = lv_color_make(0x12, 0x34, 0x56),
+                .opa = LV_OPA_COVER,
+            };
+            TEST_ASSERT_EQUAL(LV_RESULT_OK, ui_blend_fill_rgb565(&dsc));
+            uint16_t c = lv_color_to_u16(dsc.color);
+            for (int32_t y = 0; y < 3; y++) {
+                uint16_t *r = (uint16_t *)(ref + CANARY_BYTES + off + y * stride);
+                for (int32_t x = 0; x < w; x++) {
+                    r[x] = c;
+                }
+            }
+            TEST_ASSERT_EQUAL_HEX8_ARRAY(ref, dst, len);
+            free(dst);
+            free(ref);
+        }
+    }
+}
+
+// 旋转：PIE 路径只处理源 16 字节对齐的列起、凑满 8x8 块（180° 为 16 个像素）的部分，
+// 源起点错开 0~7 个像素、宽高不是块的整数倍时，C 路径补齐的边缘也一并比较；
+// 目标前后留哨兵，各边按旋转后的位置写到别处也会被比较出来
+static int check_rotate(int rotate, bool swap, int32_t w, int32_t h, int src_off)
+{
+    int32_t src_stride = (src_off + w + 7) & ~7;
+    bool quarter = rotate == 1 || rotate == 3;
+    int32_t dst_stride = ((quarter ? h : w) + 3) & ~3;
+    size_t src_len = (size_t)src_stride * h * 2;
+    size_t dst_len = CANARY_BYTES * 2 + (size_t)dst_stride * (quarter ? w : h) * 2;
+
+    uint8_t *src = memalign(16, src_len);
+    uint8_t *dst = memalign(16, dst_len);
+    uint8_t *ref = memalign(16, dst_len);
+    TEST_ASSERT_NOT_NULL(src);
+    TEST_ASSERT_NOT_NULL(dst);
+    TEST_ASSERT_NOT_NULL(ref);
+    fill_rnd(src, src_len);
+    fill_rnd(dst, dst_len);
+    memcpy(ref, dst, dst_len);
+
+    const uint16_t *s = (const uint16_t *)src + src_off;
+    ui_pixel_rotate565(s, (uint16_t *)(dst + CANARY_BYTES), w, h, src_stride, dst_stride,
+                       (ui_pixel_rotate_t)rotate, swap);
+    ui_simd_ref_rotate565(s, (uint16_t *)(ref + CANARY_BYTES), w, h, src_stride, dst_stride, rotate, swap);
+
+    int diff = memcmp(dst, ref, dst_len);
+    if (diff) {
+        ESP_LOGE(TAG, "rotate %d swap %d: w %ld h %ld src_off %d", rotate * 90, swap, (long)w, (long)h, src_off);
+    }
+    free(src);
+    free(dst);
+    free(ref);
+    return diff;
+}
+
+static void rotate_matrix(int rotate)
+{
+    int combinations = 0;
+    for (int32_t w = 1; w <= 48; w++) {
+        for (int32_t h = 1; h <= 24; h++) {
+            for (int src_off = 0; src_off < 8; src_off++) {
+                TEST_ASSERT_EQUAL(0, check_rotate(rotate, false, w, h, src_off));
+                TEST_ASSERT_EQUAL(0, check_rotate(rotate, true, w, h, src_off));
+                combinations += 2;
+            }
+        }
+    }
+    ESP_LOGI(TAG, "rotate %d: %d combinations", rotate * 90, combinations);
+}
+
+TEST_CASE("rotate RGB565 90", "[rotate][functionality]")
+{
+    rotate_matrix(UI_PIXEL_ROTATE_90);
+}
+
+TEST_CASE("rotate RGB565 180", "[rotate][functionality]")
+{
+    rotate_matrix(UI_PIXEL_ROTATE_180);
+}
+
+TEST_CASE("rotate RGB565 270", "[rotate][functionality]")
+{
+    rotate_matrix(UI_PIXEL_ROTATE_270);
+}
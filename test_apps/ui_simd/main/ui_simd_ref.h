@@ -0,0 +1,67 @@
+#ifndef UI_SIMD_REF_H
+#define UI_SIMD_REF_H
+
+// LVGL 9.2 lv_draw_sw_blend_to_rgb565.c 中 rgb565_image_blend() NORMAL 分支的 C 实现，作为比较基准
+#include <stdint.h>
+#include <string.h>
+#include "lvgl.h"
+#include "src/draw/sw/blend/lv_draw_sw_blend_private.h"
+
+static inline void ui_simd_ref_image_rgb565(const lv_draw_sw_blend_image_dsc_t *dsc)
+{
+    uint8_t *dst = dsc->dest_buf;
+    const uint8_t *src = dsc->src_buf;
+    const lv_opa_t *mask = dsc->mask_buf;
+    lv_opa_t opa = dsc->opa;
+
+    for (int32_t y = 0; y < dsc->dest_h; y++) {
+        uint16_t *d = (uint16_t *)dst;
+        const uint16_t *s = (const uint16_t *)src;
+        for (int32_t x = 0; x < dsc->dest_w; x++) {
+            if (!mask && opa >= LV_OPA_MAX) {
+                d[x] = s[x];
+            } else if (!mask) {
+                d[x] = lv_color_16_16_mix(s[x], d[x], opa);
+            } else if (opa >= LV_OPA_MAX) {
+                d[x] = lv_color_16_16_mix(s[x], d[x], mask[x]);
+            } else {
+                d[x] = lv_color_16_16_mix(s[x], d[x], LV_OPA_MIX2(mask[x], opa));
+            }
+        }
+        dst += dsc->dest_stride;
+        src += dsc->src_stride;
+        if (mask) {
+            mask += dsc->mask_stride;
+        }
+    }
+}
+
+// lv_draw_sw_rotate() 的 RGB565 逐像素循环，之后再单独交换字节；ui_pixel_rotate565() 的比较基准
+static inline void ui_simd_ref_rotate565(const uint16_t *src, uint16_t *dst, int32_t w, int32_t h,
+                                         int32_t src_stride, int32_t dst_stride, int rotate, bool swap)
+{
+    for (int32_t y = 0; y < h; y++) {
+        for (int32_t x = 0; x < w; x++) {
+            uint16_t v = src[y * src_stride + x];
+            if (swap) {
+                v = (uint16_t)((v >> 8) | (v << 8));
+            }
+            switch (rotate) {
+            case 1:
+                dst[(w - x - 1) * dst_stride + y] = v;
+                break;
+            case 2:
+                dst[(h - y - 1) * dst_stride + (w - x - 1)] = v;
+                break;
+            case 3:
+                dst[x * dst_stride + (h - y - 1)] = v;
+                break;
+            default:
+                dst[y * dst_stride + x] = v;
+                break;
+            }
+        }
+    }
+}
+
+#endif // UI_SIMD_REF_H
@@ -0,0 +1,126 @@
+#!/usr/bin/env python3
+# 生成 ui_asset 的资源分区镜像，格式见 main/gs_ui/include/ui_asset.h
+#
+#   图片先用 LVGL 的 scripts/LVGLImage.py 转成 .bin，可带 --compress LZ4/RLE：
+#     LVGLImage.py --ofmt BIN --cf RGB565 --compress LZ4 -o out logo.png
+#   字体用 lv_font_conv --format bin。
+#
+#   asset_pack.py out/logo.bin out/bg.bin font/ui_16.bin -o build/assets.bin
+#   esptool.py write_flash <assets 分区偏移> build/assets.bin
+#
+# 资源名取文件名去掉扩展名，可用 name=path 指定。.bin 图片按 lv_image_header_t 魔数识别，
+# 其他文件以 --font 指定为字体，剩下的作为原始数据。
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = 0x41555347              # "GSUA"
+VERSION = 1
+NAME_LEN = 24
+HEADER_SIZE = 16
+ENTRY_SIZE = 36
+
+TYPE_BLOB = 0
+TYPE_IMAGE = 1
+TYPE_FONT = 2
+
+LV_IMAGE_HEADER_MAGIC = 0x19
+LV_IMAGE_HEADER_SIZE = 12
+LV_IMAGE_FLAGS_COMPRESSED = 0x0008
+LV_IMAGE_COMPRESS_HEADER_SIZE = 12
+
+
+def crc16(data):
+    """CRC16/CCITT-FALSE，与 main/checksum.c 一致"""
+    crc = 0xFFFF
+    for b in data:
+        crc ^= b << 8
+        for _ in range(8):
+            crc = ((crc << 1) ^ 0x1021) if crc & 0x8000 else (crc << 1)
+            crc &= 0xFFFF
+    return crc
+
+
+def check_image(name, data):
+    """返回 True 表示是 LVGL .bin 图片，格式不对时退出"""
+    if len(data) <= LV_IMAGE_HEADER_SIZE or data[0] != LV_IMAGE_HEADER_MAGIC:
+        return False
+    _, cf, flags, w, h, stride, _ = struct.unpack_from("<BBHHHHH", data, 0)
+    body = len(data) - LV_IMAGE_HEADER_SIZE
+    if not w or not h:
+        sys.exit("%s: empty image" % name)
+    if flags & LV_IMAGE_FLAGS_COMPRESSED:
+        # LVGL 的 bin 解码器会核对压缩头里的长度，这里提前报错
+        method, csize, rsize = struct.unpack_from("<III", data, LV_IMAGE_HEADER_SIZE)
+        if csize != body - LV_IMAGE_COMPRESS_HEADER_SIZE:
+            sys.exit("%s: compressed size mismatch" % name)
+        if stride and rsize > stride * h:
+            sys.exit("%s: decompressed size exceeds stride * h" % name)
+    elif stride and body < stride * h:
+        sys.exit("%s: truncated image data" % name)
+    return True
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pack LVGL images and fonts into a ui_asset partition")
+    parser.add_argument("inputs", nargs="+", help="file or name=file")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--font", action="append", default=[], help="asset name that is a binary font")
+    parser.add_argument("--align", type=int, default=64,
+                        help="data alignment in bytes, must cover LV_DRAW_BUF_ALIGN")
+    parser.add_argument("--size", type=lambda s: int(s, 0), help="partition size, fail if exceeded")
+    args = parser.parse_args()
+
+    if args.align < 4 or args.align & (args.align - 1):
+        sys.exit("align must be a power of two >= 4")
+
+    assets = {}
+    for item in args.inputs:
+        name, _, path = item.rpartition("=")
+        if not name:
+            name = os.path.splitext(os.path.basename(path))[0]
+        raw = name.encode()
+        if len(raw) >= NAME_LEN:
+            sys.exit("%s: name longer than %d bytes" % (name, NAME_LEN - 1))
+        if raw in assets:
+            sys.exit("%s: duplicate name" % name)
+        data = open(path, "rb").read()
+        if name in args.font:
+            atype = TYPE_FONT
+        elif check_image(name, data):
+            atype = TYPE_IMAGE
+        else:
+            atype = TYPE_BLOB
+        assets[raw] = (atype, data)
+
+    # 设备端二分查找，名字按字节序排
+    names = sorted(assets)
+    offset = HEADER_SIZE + ENTRY_SIZE * len(names)
+    table = bytearray()
+    body = bytearray()
+    for raw in names:
+        atype, data = assets[raw]
+        # 图片对齐的是 12 字节头之后的像素数据
+        skip = LV_IMAGE_HEADER_SIZE if atype == TYPE_IMAGE else 0
+        pad = -(offset + len(body) + skip) % args.align
+        body += bytes(pad)
+        table += struct.pack("<%dsIIB3x" % NAME_LEN, raw, offset + len(body), len(data), atype)
+        body += data
+
+    total = offset + len(body)
+    if args.size and total > args.size:
+        sys.exit("assets need %d bytes, partition has %d" % (total, args.size))
+    header = struct.pack("<IHHIHH", MAGIC, VERSION, len(names), total, crc16(table), 0)
+    assert len(header) == HEADER_SIZE and len(table) == ENTRY_SIZE * len(names)
+    with open(args.output, "wb") as f:
+        f.write(header + table + body)
+    for raw in names:
+        atype, data = assets[raw]
+        print("  %-24s %-5s %7d" % (raw.decode(), ("blob", "image", "font")[atype], len(data)))
+    print("%s: %d assets, %d bytes" % (args.output, len(names), total))
+
+
+if __name__ == "__main__":
+    main()
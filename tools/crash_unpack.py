@@ -0,0 +1,95 @@
+#!/usr/bin/env python3
+# 解开 crash_dump 上传的 .gscd 文件，格式见 main/crash_pack.h
+#
+#   crash_unpack.py crash_1a2b3c4d.gscd -o out/
+#   idf.py coredump-info -c out/coredump.elf --core-format elf
+#
+# 输出 info.json、coredump.elf 与 evt_log.bin（evt_log_rec_t 数组）。
+
+import argparse
+import os
+import struct
+import sys
+
+MAGIC = b"GSCD"
+STORED = 0x8000
+SECTIONS = {1: "info.json", 2: "coredump.elf", 3: "evt_log.bin"}
+
+
+class BitReader:
+    def __init__(self, data):
+        self.data = data
+        self.pos = 0
+
+    def left(self):
+        return len(self.data) * 8 - self.pos
+
+    def get(self, count):
+        value = 0
+        for _ in range(count):
+            byte = self.data[self.pos >> 3]
+            value = (value << 1) | ((byte >> (7 - (self.pos & 7))) & 1)
+            self.pos += 1
+        return value
+
+
+def heatshrink_decompress(data, window, lookahead, size):
+    r = BitReader(data)
+    out = bytearray()
+    while len(out) < size and r.left() >= 9:
+        if r.get(1):
+            out.append(r.get(8))
+        else:
+            if r.left() < window + lookahead:
+                break
+            dist = r.get(window) + 1
+            count = r.get(lookahead) + 1
+            for _ in range(count):
+                out.append(out[-dist])
+    return bytes(out[:size])
+
+
+def unpack(blob):
+    if blob[:4] != MAGIC:
+        sys.exit("not a crash dump")
+    version, window, lookahead = blob[4], blob[5], blob[6]
+    if version != 1:
+        sys.exit("unsupported version %d" % version)
+    pos = 8
+    sections = {}
+    while pos + 8 <= len(blob):
+        stype, = struct.unpack_from("<B", blob, pos)
+        raw_len, = struct.unpack_from("<I", blob, pos + 4)
+        pos += 8
+        data = bytearray()
+        while len(data) < raw_len:
+            raw, stored = struct.unpack_from("<HH", blob, pos)
+            pos += 4
+            n = stored & ~STORED
+            chunk = blob[pos:pos + n]
+            pos += n
+            data += chunk if stored & STORED else heatshrink_decompress(chunk, window, lookahead, raw)
+        sections[stype] = bytes(data)
+    return sections
+
+
+def main():
+    parser = argparse.ArgumentParser(description="unpack a crash dump upload")
+    parser.add_argument("input")
+    parser.add_argument("-o", "--output", default=".", help="output directory")
+    args = parser.parse_args()
+
+    with open(args.input, "rb") as f:
+        sections = unpack(f.read())
+    os.makedirs(args.output, exist_ok=True)
+    for stype, data in sections.items():
+        name = SECTIONS.get(stype, "section%d.bin" % stype)
+        with open(os.path.join(args.output, name), "wb") as f:
+            f.write(data)
+        print("%-14s %d bytes" % (name, len(data)))
+    if 1 in sections:
+        print(sections[1].decode(errors="replace"))
+
+
+if __name__ == "__main__":
+    main()
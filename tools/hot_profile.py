@@ -0,0 +1,218 @@
+#!/usr/bin/env python3
+# 热点函数放置：由追踪构建的调用计数生成 IRAM 链接片段，并按组件统计 IRAM 占用
+#
+#   1. 打开 CONFIG_HOT_PROFILE_TRACE 编译运行，跑典型场景，保存串口日志（含 HOT_PROFILE_BEGIN/END 块）
+#   2. 生成片段，写回 main/hot_placement.lf 后关掉追踪重新编译：
+#        hot_profile.py gen monitor.log --elf build/app.elf --map build/app.map -o main/hot_placement.lf
+#   3. 检查各组件的 IRAM 占用，可给出预算（JSON：{"libmain.a": 8192, ...}），超出时返回非 0：
+#        hot_profile.py iram --map build/app.map --budget tools/iram_budget.json
+#
+# 日志取最后一个完整的计数块。调用次数低于 --min-count 的函数（初始化等冷代码）不放进 IRAM，
+# 已在 IRAM 中但很少调用的函数列为冷函数，可考虑去掉 IRAM_ATTR。
+
+import argparse
+import collections
+import json
+import os
+import re
+import shutil
+import subprocess
+import sys
+
+HOT_LINE = re.compile(r"HOT (0x[0-9a-fA-F]+) (\d+)")
+# 输入段：" .text.foo  0x4200abcd  0x40 esp-idf/main/libmain.a(uart_parse.c.obj)"，段名过长时地址换到下一行
+INPUT_SECTION = re.compile(r"^ (\.\S+)(?:\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+))?\s*$")
+INPUT_CONT = re.compile(r"^\s+(0x[0-9a-f]+)\s+(0x[0-9a-f]+)\s+(\S+)\s*$")
+OUTPUT_SECTION = re.compile(r"^(\.\S+)")
+MEMBER = re.compile(r"([^/\\]+\.a)\(([^)]+)\)$")
+NM_PREFIXES = ("xtensa-esp32s3-elf-", "xtensa-esp32s2-elf-", "xtensa-esp32-elf-", "riscv32-esp-elf-", "")
+
+
+def parse_log(path):
+    blocks, cur = [], None
+    with open(path, errors="replace") as f:
+        for line in f:
+            if "HOT_PROFILE_BEGIN" in line:
+                cur = {}
+            elif "HOT_PROFILE_END" in line:
+                if cur is not None:
+                    blocks.append(cur)
+                cur = None
+            elif cur is not None:
+                m = HOT_LINE.search(line)
+                if m:
+                    cur[int(m.group(1), 16)] = int(m.group(2))
+    if not blocks:
+        sys.exit("no complete HOT_PROFILE block in %s" % path)
+    return blocks[-1]
+
+
+def parse_map(path):
+    """返回 [(输出段, 输入段, 大小, 库, 目标文件)]"""
+    sections = []
+    out_sec, pending = None, None
+    in_memory_map = False
+    with open(path, errors="replace") as f:
+        for line in f:
+            line = line.rstrip("\n")
+            if not in_memory_map:
+                in_memory_map = line.startswith("Linker script and memory map")
+                continue
+            m = OUTPUT_SECTION.match(line)
+            if m:
+                out_sec, pending = m.group(1), None
+                continue
+            if pending:
+                c = INPUT_CONT.match(line)
+                if c:
+                    sections.append((out_sec, pending, int(c.group(2), 16), c.group(3)))
+                pending = None
+                continue
+            m = INPUT_SECTION.match(line)
+            if not m:
+                continue
+            if m.group(2):
+                sections.append((out_sec, m.group(1), int(m.group(3), 16), m.group(4)))
+            else:
+                pending = m.group(1)
+    result = []
+    for out_sec, in_sec, size, origin in sections:
+        mm = MEMBER.search(origin)
+        if mm:
+            result.append((out_sec, in_sec, size, mm.group(1), mm.group(2)))
+        else:
+            result.append((out_sec, in_sec, size, os.path.basename(origin), None))
+    return result
+
+
+def obj_name(obj):
+    # ldgen 的目标文件名不带 .c.obj 之类的后缀
+    return re.sub(r"(\.(c|cc|cpp|S))?\.(obj|o)$", "", obj)
+
+
+def find_nm(nm):
+    if nm:
+        return nm
+    for prefix in NM_PREFIXES:
+        path = shutil.which(prefix + "nm")
+        if path:
+            return path
+    sys.exit("nm not found, use --nm")
+
+
+def elf_symbols(elf, nm):
+    out = subprocess.check_output([nm, "-S", "--defined-only", elf], text=True)
+    syms = {}
+    for line in out.splitlines():
+        parts = line.split()
+        if len(parts) == 4 and parts[2] in "tTwW":
+            syms.setdefault(int(parts[0], 16), (parts[3], int(parts[1], 16)))
+    return syms
+
+
+def cmd_gen(args):
+    counts = parse_log(args.log)
+    syms = elf_symbols(args.elf, find_nm(args.nm))
+    origin = {}
+    in_iram = set()
+    for out_sec, in_sec, size, archive, obj in parse_map(args.map):
+        if obj is None:
+            continue
+        name = in_sec.split(".", 2)[2] if in_sec.startswith((".text.", ".literal.")) else None
+        if name:
+            origin[name] = (archive, obj_name(obj))
+        if out_sec == ".iram0.text" and name:
+            in_iram.add(name)
+
+    hot, cold = [], []
+    unresolved = 0
+    for addr, count in sorted(counts.items(), key=lambda kv: -kv[1]):
+        sym = syms.get(addr)
+        if not sym:
+            unresolved += 1
+            continue
+        name, size = sym
+        if name in in_iram and count < args.min_count:
+            cold.append((name, count))
+        if count >= args.min_count and name in origin:
+            hot.append((name, size, count))
+
+    placed = collections.defaultdict(list)
+    total = 0
+    for name, size, count in hot[:args.top]:
+        if args.budget and total + size > args.budget:
+            print("budget %d reached, %s (%d bytes, %d calls) and colder functions left in flash" % (args.budget, name, size, count), file=sys.stderr)
+            break
+        archive, obj = origin[name]
+        placed[archive].append((obj, name, count))
+        total += size
+
+    lines = [
+        "# 热点函数放进 IRAM（CONFIG_HOT_PROFILE_PLACEMENT）",
+        "# 由 tools/hot_profile.py gen 根据追踪构建的调用计数生成，重新采样后整体覆盖本文件",
+        "# %d 个函数，%d 字节，调用次数不低于 %d" % (sum(len(v) for v in placed.values()), total, args.min_count),
+    ]
+    for archive in sorted(placed):
+        section = re.sub(r"\W", "_", re.sub(r"^lib|\.a$", "", archive))
+        lines += ["", "[mapping:hot_profile_%s]" % section, "archive: %s" % archive, "entries:"]
+        for obj, name, count in sorted(placed[archive]):
+            lines.append("    %s:%s (noflash)" % (obj, name))
+    with open(args.output, "w") as f:
+        f.write("\n".join(lines) + "\n")
+    print("%s: %d functions, %d bytes of IRAM" % (args.output, sum(len(v) for v in placed.values()), total))
+    if unresolved:
+        print("%d addresses not found in %s, is it the traced build?" % (unresolved, args.elf), file=sys.stderr)
+    for name, count in cold:
+        print("cold IRAM function: %s (%d calls)" % (name, count), file=sys.stderr)
+
+
+def cmd_iram(args):
+    usage = collections.Counter()
+    for out_sec, in_sec, size, archive, obj in parse_map(args.map):
+        if out_sec == ".iram0.text":
+            usage[archive] += size
+    total = sum(usage.values())
+    for archive, size in usage.most_common():
+        print("%-40s %8d" % (archive, size))
+    print("%-40s %8d" % ("total", total))
+    if args.json:
+        with open(args.json, "w") as f:
+            json.dump(dict(usage), f, indent=2, sort_keys=True)
+    if args.budget:
+        with open(args.budget) as f:
+            budget = json.load(f)
+        over = [(a, usage.get(a, 0), b) for a, b in sorted(budget.items()) if usage.get(a, 0) > b]
+        for archive, size, limit in over:
+            print("%s uses %d bytes of IRAM, budget %d" % (archive, size, limit), file=sys.stderr)
+        return 1 if over else 0
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="profile-guided IRAM placement")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    gen = sub.add_parser("gen", help="generate the linker fragment from a traced run")
+    gen.add_argument("log", help="console log with HOT_PROFILE blocks")
+    gen.add_argument("--elf", required=True, help="ELF of the traced build")
+    gen.add_argument("--map", required=True, help="map file of the traced build")
+    gen.add_argument("-o", "--output", required=True, help="linker fragment to write")
+    gen.add_argument("--nm", help="nm of the toolchain, found in PATH by default")
+    gen.add_argument("--top", type=int, default=64, help="max functions placed")
+    gen.add_argument("--min-count", type=int, default=1000, help="min calls for a function to be placed")
+    gen.add_argument("--budget", type=int, default=0, help="max IRAM bytes of the placed functions")
+
+    iram = sub.add_parser("iram", help="IRAM usage per component")
+    iram.add_argument("--map", required=True)
+    iram.add_argument("--json", help="write the usage as JSON, for tracking between builds")
+    iram.add_argument("--budget", help="JSON of archive name to max IRAM bytes")
+
+    args = parser.parse_args()
+    if args.cmd == "gen":
+        cmd_gen(args)
+        return 0
+    return cmd_iram(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,224 @@
+#!/usr/bin/env python3
+# 生成 gs_ota 支持的压缩/差分升级包，格式见 main/gs/include/gs_ota_unpack.h
+#
+#   压缩完整镜像：  ota_pack.py build/app.bin -o app.gsop
+#   差分升级包：    ota_pack.py build/app.bin --base old/app.bin -o app.delta.gsop
+#
+# 差分包只能用于正在运行 old/app.bin 的设备，设备以 app_elf_sha256 校验基准，不匹配时拒绝升级。
+
+import argparse
+import struct
+import sys
+
+MAGIC = b"GSOP"
+VERSION = 1
+TYPE_FULL = 0
+TYPE_DELTA = 1
+COMPRESS_NONE = 0
+COMPRESS_HS = 1
+
+IMAGE_MAGIC = 0xE9
+APP_DESC_OFFSET = 32            # esp_image_header_t + esp_image_segment_header_t
+APP_DESC_MAGIC = 0xABCD5432
+APP_ELF_SHA256_OFFSET = APP_DESC_OFFSET + 144
+
+
+def app_elf_sha256(image):
+    if image[0] != IMAGE_MAGIC:
+        sys.exit("base is not an app image")
+    magic, = struct.unpack_from("<I", image, APP_DESC_OFFSET)
+    if magic != APP_DESC_MAGIC:
+        sys.exit("base has no esp_app_desc_t")
+    return image[APP_ELF_SHA256_OFFSET:APP_ELF_SHA256_OFFSET + 32]
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.acc = 0
+        self.bits = 0
+
+    def put(self, value, count):
+        for i in range(count - 1, -1, -1):
+            self.acc = (self.acc << 1) | ((value >> i) & 1)
+            self.bits += 1
+            if self.bits == 8:
+                self.out.append(self.acc)
+                self.acc = 0
+                self.bits = 0
+
+    def finish(self):
+        # 末尾补 0，解码端不会把不足一个符号的位当作数据
+        if self.bits:
+            self.out.append(self.acc << (8 - self.bits))
+        return bytes(self.out)
+
+
+def heatshrink_compress(data, window, lookahead, chain=32):
+    """贪心 LZSS，输出与 heatshrink（-w window -l lookahead）兼容的位流"""
+    w = BitWriter()
+    max_dist = 1 << window
+    max_len = 1 << lookahead
+    # 回溯引用比对应字面量短时才使用
+    min_len = (1 + window + lookahead) // 9 + 1
+    head = {}
+    prev = [0] * len(data)
+    n = len(data)
+    i = 0
+
+    def insert(pos):
+        if pos + 3 <= n:
+            key = data[pos:pos + 3]
+            prev[pos] = head.get(key, -1)
+            head[key] = pos
+
+    while i < n:
+        best_len, best_dist = 0, 0
+        if i + 3 <= n:
+            cand = head.get(data[i:i + 3], -1)
+            limit = min(max_len, n - i)
+            tries = chain
+            while cand >= 0 and i - cand <= max_dist and tries:
+                length = 3
+                while length < limit and data[cand + length] == data[i + length]:
+                    length += 1
+                if length > best_len:
+                    best_len, best_dist = length, i - cand
+                    if length == limit:
+                        break
+                cand = prev[cand]
+                tries -= 1
+        if best_len >= min_len:
+            w.put(0, 1)
+            w.put(best_dist - 1, window)
+            w.put(best_len - 1, lookahead)
+            for k in range(best_len):
+                insert(i + k)
+            i += best_len
+        else:
+            w.put(1, 1)
+            w.put(data[i], 8)
+            insert(i)
+            i += 1
+    return w.finish()
+
+
+def varint(value):
+    out = bytearray()
+    while True:
+        b = value & 0x7F
+        value >>= 7
+        if value:
+            out.append(b | 0x80)
+        else:
+            out.append(b)
+            return bytes(out)
+
+
+def zigzag(value):
+    return (value << 1) if value >= 0 else ((-value << 1) - 1)
+
+
+def control_to_patch(old, new, control):
+    """(diff_len, extra_len, adjust) 控制序列转为设备端的差分数据"""
+    out = bytearray()
+    oldpos = newpos = 0
+    for diff_len, extra_len, adjust in control:
+        out += varint(diff_len)
+        out += bytes((new[newpos + k] - old[oldpos + k]) & 0xFF for k in range(diff_len))
+        newpos += diff_len
+        oldpos += diff_len
+        out += varint(extra_len)
+        out += new[newpos:newpos + extra_len]
+        newpos += extra_len
+        out += varint(zigzag(adjust))
+        oldpos += adjust
+    if newpos != len(new):
+        sys.exit("internal error: patch covers %d of %d bytes" % (newpos, len(new)))
+    return bytes(out)
+
+
+def simple_diff(old, new, block=16):
+    """没有 bsdiff4 时的简易匹配：旧镜像按块建索引，命中后允许少量不同字节向后延伸"""
+    index = {}
+    for pos in range(0, len(old) - block + 1, block):
+        index.setdefault(old[pos:pos + block], pos)
+
+    control = []
+    d_new, d_old, d_len = 0, 0, 0
+    i = 0
+    n = len(new)
+    while i <= n - block:
+        m_old = index.get(new[i:i + block])
+        if m_old is None:
+            i += 1
+            continue
+        # 延伸：得分为相同字节数减两倍不同字节数，取最高分处为止
+        score = best = 0
+        best_len = length = 0
+        while i + length < n and m_old + length < len(old) and length - best_len < 64:
+            score += 1 if new[i + length] == old[m_old + length] else -2
+            length += 1
+            if score > best:
+                best, best_len = score, length
+        control.append((d_len, i - (d_new + d_len), m_old - (d_old + d_len)))
+        d_new, d_old, d_len = i, m_old, best_len
+        i += best_len
+    control.append((d_len, n - (d_new + d_len), 0))
+    return control
+
+
+def make_delta(old, new):
+    try:
+        import bsdiff4.core
+        control, _, _ = bsdiff4.core.diff(old, new)
+        return control_to_patch(old, new, control)
+    except ImportError:
+        print("bsdiff4 not installed, using simple block matching", file=sys.stderr)
+        return control_to_patch(old, new, simple_diff(old, new))
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pack an app image for gs_ota")
+    parser.add_argument("image", help="new app .bin")
+    parser.add_argument("-o", "--output", required=True)
+    parser.add_argument("--base", help="app .bin running on the device, makes a delta package")
+    parser.add_argument("-w", "--window", type=int, default=11, help="heatshrink window bits (4..12)")
+    parser.add_argument("-l", "--lookahead", type=int, default=4, help="heatshrink lookahead bits")
+    parser.add_argument("--no-compress", action="store_true")
+    args = parser.parse_args()
+
+    if not 4 <= args.window <= 12 or not 3 <= args.lookahead < args.window:
+        sys.exit("unsupported window/lookahead")
+
+    new = open(args.image, "rb").read()
+    if not new or new[0] != IMAGE_MAGIC:
+        sys.exit("image is not an app image")
+
+    if args.base:
+        old = open(args.base, "rb").read()
+        sha = app_elf_sha256(old)
+        payload = make_delta(old, new)
+        ptype, src_size = TYPE_DELTA, len(old)
+    else:
+        sha = bytes(32)
+        payload = new
+        ptype, src_size = TYPE_FULL, 0
+
+    if args.no_compress:
+        compress, window, lookahead = COMPRESS_NONE, 0, 0
+    else:
+        compress, window, lookahead = COMPRESS_HS, args.window, args.lookahead
+        payload = heatshrink_compress(payload, window, lookahead)
+
+    header = MAGIC + struct.pack("<BBBBB3xII", VERSION, ptype, compress, window, lookahead,
+                                 len(new), src_size) + sha
+    assert len(header) == 52
+    with open(args.output, "wb") as f:
+        f.write(header + payload)
+    print("%s: %d -> %d bytes (%.1fx)" % (args.output, len(new), len(header) + len(payload),
+                                         len(new) / (len(header) + len(payload))))
+
+
+if __name__ == "__main__":
+    main()
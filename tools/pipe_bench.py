@@ -0,0 +1,201 @@
+#!/usr/bin/env python3
+# 门铃主链路端到端基准的主机侧（固件侧见 main/pipe_bench.h）
+#
+#   1. 主机上起模拟上传服务器，固件打开 CONFIG_PIPE_BENCH，上传地址指向它：
+#        pipe_bench.py serve --port 8080 [--delay-ms 200] [--fail-every 10]
+#   2. 测试板跑完后保存串口日志（到 PIPEBENCH_DONE 为止），汇总并与基线比较，有回退时返回非 0：
+#        pipe_bench.py report monitor.log -o result.json --baseline baseline.json
+#
+# 汇总按 period_ms 对齐基线。耗时类（ack / e2e / stage）超过基线的 --tolerance 百分比且
+# 超出 --slack-ms 才算回退，避免几毫秒的抖动误报；吞吐、成功率、int_min 低于基线的 --tolerance 百分比算回退。
+# 基线就是一次正常运行的 -o 输出。
+
+import argparse
+import json
+import re
+import sys
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+BENCH_LINE = re.compile(r"PIPEBENCH (\{.*\})\s*$")
+DONE_LINE = "PIPEBENCH_DONE"
+
+
+class UploadHandler(BaseHTTPRequestHandler):
+    protocol_version = "HTTP/1.1"   # 固件复用连接，须支持 keep-alive 和 chunked 请求体
+
+    def read_body(self):
+        if self.headers.get("Transfer-Encoding", "").lower() == "chunked":
+            size = 0
+            while True:
+                n = int(self.rfile.readline().split(b";")[0].strip() or b"0", 16)
+                if n == 0:
+                    while self.rfile.readline() not in (b"\r\n", b"\n", b""):
+                        pass
+                    return size
+                self.rfile.read(n)
+                self.rfile.readline()
+                size += n
+        n = int(self.headers.get("Content-Length", 0))
+        self.rfile.read(n)
+        return n
+
+    def reply(self, obj):
+        body = json.dumps(obj).encode()
+        self.send_response(200)
+        self.send_header("Content-Type", "application/json")
+        self.send_header("Content-Length", str(len(body)))
+        self.end_headers()
+        self.wfile.write(body)
+
+    def do_POST(self):
+        size = self.read_body()
+        server = self.server
+        with server.lock:
+            server.count += 1
+            seq = server.count
+        if server.delay_ms:
+            time.sleep(server.delay_ms / 1000.0)
+        if server.fail_every and seq % server.fail_every == 0:
+            self.reply({"error": 1, "msg": "injected failure"})
+            result = "fail"
+        else:
+            self.reply({"error": 0, "img_url": "http://bench/%d.jpg" % seq, "msg": "ok"})
+            result = "ok"
+        print("%5d %s %7d bytes %s" % (seq, self.client_address[0], size, result), flush=True)
+
+    def do_GET(self):
+        self.reply({"error": 0, "msg": "ok"})
+
+    def log_message(self, fmt, *args):
+        pass
+
+
+def cmd_serve(args):
+    server = ThreadingHTTPServer((args.bind, args.port), UploadHandler)
+    server.lock = threading.Lock()
+    server.count = 0
+    server.delay_ms = args.delay_ms
+    server.fail_every = args.fail_every
+    print("upload server on %s:%d" % (args.bind, args.port), flush=True)
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    return 0
+
+
+def parse_log(path):
+    phases = []
+    done = False
+    with open(path, encoding="utf-8", errors="replace") as f:
+        for line in f:
+            m = BENCH_LINE.search(line)
+            if m:
+                try:
+                    phases.append(json.loads(m.group(1)))
+                except ValueError:
+                    print("warning: bad PIPEBENCH line: %s" % line.strip(), file=sys.stderr)
+            elif DONE_LINE in line:
+                done = True
+    return phases, done
+
+
+def ok_ratio(phase):
+    return phase["ok"] / phase["sent"] if phase["sent"] else 0.0
+
+
+def compare(cur, base, tolerance, slack_ms):
+    """返回回退说明的列表"""
+    regressions = []
+    base_by_period = {p["period_ms"]: p for p in base["phases"]}
+    up = 1 + tolerance / 100.0
+    down = 1 - tolerance / 100.0
+    for phase in cur["phases"]:
+        period = phase["period_ms"]
+        b = base_by_period.get(period)
+        if not b:
+            print("warning: period %d ms not in baseline" % period, file=sys.stderr)
+            continue
+        tag = "period %d ms" % period
+
+        def later(name, now, was):
+            if now > was * up and now - was > slack_ms:
+                regressions.append("%s: %s %d ms (baseline %d ms)" % (tag, name, now, was))
+
+        def lower(name, now, was, fmt="%d"):
+            if now < was * down:
+                regressions.append(("%s: %s " + fmt + " (baseline " + fmt + ")") % (tag, name, now, was))
+
+        for key in ("avg", "max"):
+            later("ack_ms." + key, phase["ack_ms"][key], b["ack_ms"][key])
+        for key in ("avg", "p50", "p95"):
+            later("e2e_ms." + key, phase["e2e_ms"][key], b["e2e_ms"][key])
+        for stage, ms in phase["stage_ms"].items():
+            if stage in b["stage_ms"]:
+                later("stage_ms." + stage, ms, b["stage_ms"][stage])
+        lower("eps", phase["eps"], b["eps"], "%.3f")
+        lower("ok ratio", ok_ratio(phase), ok_ratio(b), "%.2f")
+        lower("heap.int_min", phase["heap"]["int_min"], b["heap"]["int_min"])
+    return regressions
+
+
+def cmd_report(args):
+    phases, done = parse_log(args.log)
+    if not phases:
+        sys.exit("no PIPEBENCH lines in %s" % args.log)
+    if not done:
+        print("warning: %s has no %s, run incomplete" % (args.log, DONE_LINE), file=sys.stderr)
+    result = {"phases": phases, "complete": done}
+
+    print("%8s %5s %5s %5s %7s %8s %8s %8s %8s %9s" %
+          ("period", "sent", "ok", "fail", "timeout", "eps", "e2e_p50", "e2e_p95", "ack_avg", "int_min"))
+    for p in phases:
+        print("%8d %5d %5d %5d %7d %8.3f %8d %8d %8d %9d" %
+              (p["period_ms"], p["sent"], p["ok"], p["fail"], p["timeout"], p["eps"],
+               p["e2e_ms"]["p50"], p["e2e_ms"]["p95"], p["ack_ms"]["avg"], p["heap"]["int_min"]))
+
+    if args.output:
+        with open(args.output, "w") as f:
+            json.dump(result, f, indent=2)
+            f.write("\n")
+
+    if not args.baseline:
+        return 0
+    with open(args.baseline) as f:
+        base = json.load(f)
+    regressions = compare(result, base, args.tolerance, args.slack_ms)
+    for r in regressions:
+        print("REGRESSION " + r)
+    if regressions:
+        return 1
+    print("no regression against %s" % args.baseline)
+    return 0
+
+
+def main():
+    parser = argparse.ArgumentParser(description="doorbell pipeline benchmark: upload server and report")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+
+    serve = sub.add_parser("serve", help="mock upload server for CONFIG_PIPE_BENCH_UPLOAD_URL")
+    serve.add_argument("--bind", default="0.0.0.0")
+    serve.add_argument("--port", type=int, default=8080)
+    serve.add_argument("--delay-ms", type=int, default=0, help="extra server latency per upload")
+    serve.add_argument("--fail-every", type=int, default=0, help="answer error 1 to every Nth upload")
+
+    report = sub.add_parser("report", help="summarize PIPEBENCH lines and compare with a baseline")
+    report.add_argument("log", help="console log of a CONFIG_PIPE_BENCH run")
+    report.add_argument("-o", "--output", help="write the summary as JSON, usable as a baseline")
+    report.add_argument("--baseline", help="summary JSON of a known-good run")
+    report.add_argument("--tolerance", type=float, default=20.0, help="allowed change in percent")
+    report.add_argument("--slack-ms", type=int, default=20, help="latency increase always allowed")
+
+    args = parser.parse_args()
+    if args.cmd == "serve":
+        return cmd_serve(args)
+    return cmd_report(args)
+
+
+if __name__ == "__main__":
+    sys.exit(main())
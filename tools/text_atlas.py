@@ -0,0 +1,99 @@
+#!/usr/bin/env python3
+# 把界面上固定不变的字符串预渲染成 A8 图片（LVGL .bin），交给 asset_pack.py 打进资源分区，
+# 运行时由 main/gs_ui/ui_glyph.c 的 ui_glyph_text() 取出当作图片绘制，不再逐字解码字形
+#
+#   text_atlas.py --font NotoSansSC.ttf --size 24 --prefix s24 strings.txt -o out/text
+#   asset_pack.py out/text/*.bin out/logo.bin -o build/assets.bin
+#
+# strings.txt 每行一个字符串（UTF-8），空行和 # 开头的行忽略。每个字符串一张图片，
+# 资源名为 <prefix>_<字符串 UTF-8 字节的 FNV-1a 32 位哈希，8 位十六进制>，与 ui_glyph_text() 一致。
+# 图片高度为字体的 ascent + descent，同一前缀的字符串基线对齐，可与同字号的 label 混排。
+# 需要 Pillow（pip install pillow）。
+
+import argparse
+import math
+import os
+import struct
+import sys
+
+PREFIX_LEN = 14
+
+LV_IMAGE_HEADER_MAGIC = 0x19
+LV_COLOR_FORMAT_A8 = 0x0E
+
+
+def fnv1a32(data):
+    h = 2166136261
+    for b in data:
+        h = ((h ^ b) * 16777619) & 0xFFFFFFFF
+    return h
+
+
+def read_strings(path):
+    with open(path, encoding="utf-8") as f:
+        lines = [line.rstrip("\r\n") for line in f]
+    return [s for s in lines if s and not s.startswith("#")]
+
+
+def render(font, text, stride_align):
+    """返回 (w, h, stride, 按行补齐到 stride 的 A8 数据)"""
+    from PIL import Image, ImageDraw
+
+    ascent, descent = font.getmetrics()
+    w = max(1, math.ceil(font.getlength(text)))
+    h = ascent + descent
+    img = Image.new("L", (w, h), 0)
+    ImageDraw.Draw(img).text((0, 0), text, font=font, fill=255)
+    # 与 lv_draw_buf_width_to_stride() 一致（LV_DRAW_BUF_STRIDE_ALIGN）
+    stride = (w + stride_align - 1) // stride_align * stride_align
+    raw = img.tobytes()
+    pad = bytes(stride - w)
+    data = b"".join(raw[y * w:(y + 1) * w] + pad for y in range(h))
+    return w, h, stride, data
+
+
+def main():
+    parser = argparse.ArgumentParser(description="pre-render fixed UI strings into A8 LVGL images")
+    parser.add_argument("strings", help="UTF-8 text file, one string per line")
+    parser.add_argument("-o", "--output", required=True, help="output directory")
+    parser.add_argument("--font", required=True, help="TTF/OTF file")
+    parser.add_argument("--size", type=int, required=True, help="pixel size")
+    parser.add_argument("--prefix", required=True, help="asset name prefix passed to ui_glyph_text()")
+    parser.add_argument("--stride-align", type=int, default=1, help="LV_DRAW_BUF_STRIDE_ALIGN of the firmware")
+    args = parser.parse_args()
+
+    try:
+        from PIL import ImageFont
+    except ImportError:
+        sys.exit("Pillow is required: pip install pillow")
+    if not args.prefix or len(args.prefix) > PREFIX_LEN:
+        sys.exit("prefix must be 1..%d characters" % PREFIX_LEN)
+    if args.stride_align < 1:
+        sys.exit("stride align must be >= 1")
+
+    font = ImageFont.truetype(args.font, args.size)
+    os.makedirs(args.output, exist_ok=True)
+
+    names = {}
+    total = 0
+    for text in read_strings(args.strings):
+        name = "%s_%08x" % (args.prefix, fnv1a32(text.encode("utf-8")))
+        if name in names:
+            if names[name] != text:
+                sys.exit("hash collision: %r and %r, change one of them" % (names[name], text))
+            continue
+        names[name] = text
+        w, h, stride, data = render(font, text, args.stride_align)
+        if w > 0xFFFF or stride > 0xFFFF:
+            sys.exit("%r: too wide" % text)
+        header = struct.pack("<BBHHHHH", LV_IMAGE_HEADER_MAGIC, LV_COLOR_FORMAT_A8, 0, w, h, stride, 0)
+        with open(os.path.join(args.output, name + ".bin"), "wb") as f:
+            f.write(header + data)
+        total += len(header) + len(data)
+        print("%s  %3dx%-3d %r" % (name, w, h, text))
+
+    print("%d strings, %d bytes" % (len(names), total))
+
+
+if __name__ == "__main__":
+    main()